@@ -382,6 +382,13 @@ class RegionField(numpy.ndarray):
             _my.ctx.runtime, region.ispace.handle[0])
         dim = domain.dim
         rect = getattr(c, 'legion_domain_get_rect_{}d'.format(dim))(domain)
+        shape = tuple(max(rect.hi.x[i] - rect.lo.x[i] + 1, 0) for i in xrange(dim))
+        field_size = region.fspace.field_types[field_name].size
+
+        # Empty regions have no instance data to point at.
+        if 0 in shape:
+            return 0, shape, (field_size,) * dim
+
         subrect = ffi.new('legion_rect_{}d_t *'.format(dim))
         offsets = ffi.new('legion_byte_offset_t[]', dim)
 
@@ -391,9 +398,10 @@ class RegionField(numpy.ndarray):
         for i in xrange(dim):
             assert subrect[0].lo.x[i] == rect.lo.x[i]
             assert subrect[0].hi.x[i] == rect.hi.x[i]
-        assert offsets[0].offset == region.fspace.field_types[field_name].size
 
-        shape = tuple(rect.hi.x[i] - rect.lo.x[i] + 1 for i in xrange(dim))
+        # The strides come straight from the affine layout of the
+        # instance, so this works for both SOA and AOS layouts (where
+        # the stride of the first dimension is larger than the field).
         strides = tuple(offsets[i].offset for i in xrange(dim))
 
         return base_ptr, shape, strides
@@ -404,11 +412,19 @@ class RegionField(numpy.ndarray):
             region, field_name, accessor)
         field_type = region.fspace.field_types[field_name]
 
+        if 0 in shape:
+            return numpy.empty(shape, dtype=field_type.numpy_type)
+
         # Numpy doesn't know about CFFI pointers, so we have to cast
         # this to a Python long before we can hand it off to Numpy.
         base_ptr = long(ffi.cast("size_t", base_ptr))
 
-        return _RegionNdarray(shape, field_type, base_ptr, strides, False)
+        # Fields mapped without write privileges get read-only arrays
+        # so that stray writes raise instead of racing other tasks.
+        privilege = region.privileges.get(field_name)
+        read_only = privilege is None or not privilege.write
+
+        return _RegionNdarray(shape, field_type, base_ptr, strides, read_only)
 
 # This is a dummy object that is only used as an initializer for the
 # RegionField object above. It is thrown away as soon as the
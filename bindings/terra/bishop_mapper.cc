@@ -144,6 +144,20 @@ bishop_matching_state_t BishopMapper::get_current_state(
                                                                const Task& task)
 //------------------------------------------------------------------------------
 {
+  MatchingKey key;
+  key.state = curr_state;
+  key.task_id = task.task_id;
+  key.kind = task.target_proc.exists() ? task.target_proc.kind()
+                                       : Processor::NO_KIND;
+  std::map<MatchingKey, bishop_matching_state_t>::const_iterator finder =
+    matching_cache.find(key);
+  if (finder != matching_cache.end())
+  {
+    log_bishop.debug("[get_current_state] state %d --> state %d (cached)",
+        curr_state, finder->second);
+    return finder->second;
+  }
+
   bishop_matching_state_t prev_state = curr_state;
   legion_task_t task_ = CObjectWrapper::wrap_const(&task);
   while (true)
@@ -155,6 +169,7 @@ bishop_matching_state_t BishopMapper::get_current_state(
     prev_state = curr_state;
   }
 
+  matching_cache[key] = curr_state;
   return curr_state;
 }
 
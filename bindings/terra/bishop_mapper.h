@@ -57,9 +57,25 @@ namespace Legion {
 
         bishop_matching_state_t get_current_state(bishop_matching_state_t prev_state,
                                                   const Task& task);
+      private:
+        // The transitions only look at the task ID and the kind of the
+        // target processor, so the state they reach from a given state
+        // can be memoized on those
+        struct MatchingKey {
+          bishop_matching_state_t state;
+          TaskID task_id;
+          Processor::Kind kind;
+          bool operator<(const MatchingKey& rhs) const
+          {
+            if (state != rhs.state) return state < rhs.state;
+            if (task_id != rhs.task_id) return task_id < rhs.task_id;
+            return kind < rhs.kind;
+          }
+        };
       private:
         std::vector<bishop_mapper_impl_t> mapper_impls;
         std::vector<bishop_transition_fn_t> transitions;
+        std::map<MatchingKey, bishop_matching_state_t> matching_cache;
 
         bishop_mapper_state_init_fn_t mapper_init;
         bishop_mapper_state_t mapper_state;
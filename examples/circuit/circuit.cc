@@ -32,7 +32,10 @@ Logger log_circuit("circuit");
 void parse_input_args(char **argv, int argc, int &num_loops, int &num_pieces,
                       int &nodes_per_piece, int &wires_per_piece,
                       int &pct_wire_in_piece, int &random_seed,
-                      int &steps, int &sync, bool &perform_checks, bool &dump_values);
+                      int &steps, int &sync, bool &perform_checks, bool &dump_values,
+                      int &num_warmup);
+
+void report_iteration_times(std::vector<double> &times);
 
 Partitions load_circuit(Circuit &ckt, std::vector<CircuitPiece> &pieces, Context ctx,
                         Runtime *runtime, int num_pieces, int nodes_per_piece,
@@ -57,6 +60,7 @@ void top_level_task(const Task *task,
   int sync = 0;
   bool perform_checks = false;
   bool dump_values = false;
+  int num_warmup = 0;
   {
     const InputArgs &command_args = Runtime::get_input_args();
     char **argv = command_args.argv;
@@ -64,11 +68,12 @@ void top_level_task(const Task *task,
 
     parse_input_args(argv, argc, num_loops, num_pieces, nodes_per_piece, 
 		     wires_per_piece, pct_wire_in_piece, random_seed,
-		     steps, sync, perform_checks, dump_values);
+		     steps, sync, perform_checks, dump_values, num_warmup);
 
-    log_circuit.print("circuit settings: loops=%d pieces=%d nodes/piece=%d "
-                            "wires/piece=%d pct_in_piece=%d seed=%d",
-       num_loops, num_pieces, nodes_per_piece, wires_per_piece,
+    log_circuit.print("circuit settings: loops=%d warmup=%d pieces=%d "
+                            "nodes/piece=%d wires/piece=%d pct_in_piece=%d "
+                            "seed=%d",
+       num_loops, num_warmup, num_pieces, nodes_per_piece, wires_per_piece,
        pct_wire_in_piece, random_seed);
   }
 
@@ -130,26 +135,38 @@ void top_level_task(const Task *task,
                                  circuit.all_nodes, circuit.node_locator, launch_rect, local_args);
 
   printf("Starting main simulation loop\n");
-  //struct timespec ts_start, ts_end;
-  //clock_gettime(CLOCK_MONOTONIC, &ts_start);
-  Future f_start = runtime->get_current_time_in_microseconds(ctx);
-  double ts_start = f_start.get_result<long long>();
-  // Run the main loop
+  // Run the main loop, the first num_warmup loops are not timed
+  // and every timed loop is fenced so we can time it separately
   bool simulation_success = true;
-  for (int i = 0; i < num_loops; i++)
+  std::vector<Future> f_times;
+  const int total_loops = num_warmup + num_loops;
+  for (int i = 0; i < total_loops; i++)
   {
+    if (i == num_warmup)
+    {
+      runtime->issue_execution_fence(ctx);
+      f_times.push_back(runtime->get_current_time_in_microseconds(ctx));
+    }
     TaskHelper::dispatch_task<CalcNewCurrentsTask>(cnc_launcher, ctx, runtime, 
                                                    perform_checks, simulation_success);
     TaskHelper::dispatch_task<DistributeChargeTask>(dsc_launcher, ctx, runtime, 
                                                     perform_checks, simulation_success);
     TaskHelper::dispatch_task<UpdateVoltagesTask>(upv_launcher, ctx, runtime, 
                                                   perform_checks, simulation_success,
-                                                  ((i+1)==num_loops));
+                                                  ((i+1)==total_loops));
+    if (i >= num_warmup)
+    {
+      // Execution fence to wait for all prior operations to be done before getting our timing result
+      runtime->issue_execution_fence(ctx);
+      f_times.push_back(runtime->get_current_time_in_microseconds(ctx));
+    }
   }
-  // Execution fence to wait for all prior operations to be done before getting our timing result
-  runtime->issue_execution_fence(ctx);
-  Future f_end = runtime->get_current_time_in_microseconds(ctx);
-  double ts_end = f_end.get_result<long long>();
+  std::vector<double> iteration_times(num_loops);
+  for (int i = 0; i < num_loops; i++)
+    iteration_times[i] = 1e-6 * (f_times[i+1].get_result<long long>() -
+                                 f_times[i].get_result<long long>());
+  double ts_start = f_times.front().get_result<long long>();
+  double ts_end = f_times.back().get_result<long long>();
   if (simulation_success)
     printf("SUCCESS!\n");
   else
@@ -174,6 +191,7 @@ void top_level_task(const Task *task,
     double gflops = (1e-9*operations)/sim_time;
     printf("GFLOPS = %7.3f GFLOPS\n", gflops);
   }
+  report_iteration_times(iteration_times);
   log_circuit.print("simulation complete - destroying regions");
 
   if (dump_values)
@@ -246,7 +264,7 @@ void parse_input_args(char **argv, int argc, int &num_loops, int &num_pieces,
                       int &nodes_per_piece, int &wires_per_piece,
                       int &pct_wire_in_piece, int &random_seed,
                       int &steps, int &sync, bool &perform_checks,
-                      bool &dump_values)
+                      bool &dump_values, int &num_warmup)
 {
   for (int i = 1; i < argc; i++) 
   {
@@ -309,7 +327,32 @@ void parse_input_args(char **argv, int argc, int &num_loops, int &num_pieces,
       dump_values = true;
       continue;
     }
+
+    if(!strcmp(argv[i], "-w"))
+    {
+      num_warmup = atoi(argv[++i]);
+      continue;
+    }
+  }
+}
+
+void report_iteration_times(std::vector<double> &times)
+{
+  if (times.empty())
+    return;
+  std::sort(times.begin(), times.end());
+  double total = 0.0;
+  for (unsigned i = 0; i < times.size(); i++)
+    total += times[i];
+  const char *names[] = { "min", "p50", "p90", "p99", "max" };
+  const double percents[] = { 0.0, 50.0, 90.0, 99.0, 100.0 };
+  for (unsigned i = 0; i < sizeof(percents)/sizeof(percents[0]); i++)
+  {
+    // Nearest rank percentile
+    size_t rank = (size_t)(percents[i] / 100.0 * (times.size() - 1) + 0.5);
+    printf("ITERATION TIME %s = %7.6f s\n", names[i], times[rank]);
   }
+  printf("ITERATION TIME mean = %7.6f s\n", total / times.size());
 }
 
 void allocate_node_fields(Context ctx, Runtime *runtime, FieldSpace node_space)
@@ -420,6 +420,22 @@ void create_region_done_task(const void *args, size_t arglen,
   *a.dest_inst = a.inst;
 }
 
+void report_iteration_times(std::vector<long long> &times)
+{
+  if (times.empty()) return;
+  std::sort(times.begin(), times.end());
+  long long total = 0;
+  for (size_t i = 0; i < times.size(); i++) total += times[i];
+  const char *names[] = { "min", "p50", "p90", "p99", "max" };
+  const double percents[] = { 0.0, 50.0, 90.0, 99.0, 100.0 };
+  for (size_t i = 0; i < sizeof(percents)/sizeof(percents[0]); i++) {
+    // Nearest rank percentile
+    size_t rank = (size_t)(percents[i] / 100.0 * (times.size() - 1) + 0.5);
+    printf("Iteration time %s: %e seconds\n", names[i], times[rank]/1e6);
+  }
+  printf("Iteration time mean: %e seconds\n", total/1e6/times.size());
+}
+
 void shard_task(const void *args, size_t arglen,
                 const void *userdata, size_t userlen, Processor p)
 {
@@ -516,6 +532,8 @@ void shard_task(const void *args, size_t arglen,
   Event xm_copy_done = Event::NO_EVENT;
   Event yp_copy_done = Event::NO_EVENT;
   Event ym_copy_done = Event::NO_EVENT;
+  std::vector<Event> timed_steps;
+  timed_steps.reserve(a.tsteps - a.tprune);
   for (coord_t t = 0; t < a.tsteps; t++) {
     {
       StencilArgs args;
@@ -552,6 +570,7 @@ void shard_task(const void *args, size_t arglen,
       Event precondition = Event::merge_events(
         stencil_done, xp_copy_done, xm_copy_done, yp_copy_done, ym_copy_done);
       increment_done = p.spawn(INCREMENT_TASK, &args, sizeof(args), precondition);
+      if (t >= a.tprune) timed_steps.push_back(increment_done);
     }
 
     if (a.xp_inst_out.exists()) {
@@ -602,9 +621,22 @@ void shard_task(const void *args, size_t arglen,
   // This task hasn't blocked, so no subtasks have executed yet.
   // Only time subtask execution
   long long start = Realm::Clock::current_time_in_microseconds();
+  std::vector<long long> step_times(timed_steps.size());
+  long long step_start = start;
+  for (size_t i = 0; i < timed_steps.size(); i++) {
+    timed_steps[i].wait();
+    long long step_stop = Realm::Clock::current_time_in_microseconds();
+    step_times[i] = step_stop - step_start;
+    step_start = step_stop;
+  }
   increment_done.wait();
   long long stop = Realm::Clock::current_time_in_microseconds();
 
+  // Per-iteration times are local to this shard, so only report one
+  if (a.point == Point2(0, 0)) {
+    report_iteration_times(step_times);
+  }
+
   // Send start and stop times back to top level task
   a.first_start.arrive(1, Event::NO_EVENT, &start, sizeof(start));
   a.last_start.arrive(1, Event::NO_EVENT, &start, sizeof(start));
@@ -2565,7 +2565,8 @@ local function expr_call_setup_list_of_regions_arg(
 end
 
 local function expr_call_setup_partition_arg(
-    cx, task, arg_type, param_type, partition, launcher, index, args_setup)
+    cx, task, arg_type, param_type, partition, launcher, index, args_setup,
+    projection)
   assert(index)
   local privileges, privilege_field_paths, privilege_field_types, coherences, flags =
     std.find_task_privileges(param_type, task)
@@ -2603,7 +2604,7 @@ local function expr_call_setup_partition_arg(
 
     local requirement = terralib.newsymbol(uint, "requirement")
     local requirement_args = terralib.newlist({
-        launcher, `([partition].impl), 0 --[[ default projection ID ]]})
+        launcher, `([partition].impl), projection})
     if reduction_op then
       requirement_args:insert(reduction_op)
     else
@@ -3424,20 +3425,31 @@ function codegen.expr_region(cx, node)
     fs_naming_actions = quote end
   end
 
+  -- Allocate all the fields in a single call so that the field space
+  -- only needs one round trip to its owner no matter how many fields
+  local fsa = terralib.newsymbol(c.legion_field_allocator_t, "fsa")
+  local fs_alloc_actions
+  if #field_ids > 0 then
+    fs_alloc_actions = quote
+      var field_sizes = arrayof(c.size_t,
+        [field_types:map(function(field_type) return `(terralib.sizeof([field_type])) end)])
+      var fids = arrayof(c.legion_field_id_t, [field_ids])
+      c.legion_field_allocator_allocate_fields(
+        [fsa], &field_sizes[0], &fids[0], [#field_ids])
+    end
+  else
+    fs_alloc_actions = quote end
+  end
+
   actions = quote
     [actions]
     var capacity = [ispace.value]
     var [is] = [ispace.value].impl
     var [fs] = c.legion_field_space_create([cx.runtime], [cx.context])
-    var fsa = c.legion_field_allocator_create([cx.runtime], [cx.context],  [fs]);
-    [data.zip(field_types, field_ids):map(
-       function(field)
-         local field_type, field_id = unpack(field)
-         return `(c.legion_field_allocator_allocate_field(
-                    fsa, terralib.sizeof([field_type]), [field_id]))
-       end)]
+    var [fsa] = c.legion_field_allocator_create([cx.runtime], [cx.context],  [fs]);
+    [fs_alloc_actions];
     [fs_naming_actions];
-    c.legion_field_allocator_destroy(fsa)
+    c.legion_field_allocator_destroy([fsa])
     var [lr] = c.legion_logical_region_create([cx.runtime], [cx.context], [is], [fs])
     var [r] = [region_type]{ impl = [lr] }
   end
@@ -7244,22 +7256,57 @@ function codegen.stat_for_list(cx, node)
       end)
     end
 
+    local args, reduction_variables = collect_symbols(cx, node)
+
+    local reductions = terralib.newlist()
+    for red_var, red_op in pairs(reduction_variables) do
+      local red_init = std.reduction_op_init[red_op][red_var.type]
+      if red_init == nil then
+        report.error(node, "unsupported reduction " .. red_op ..
+          " to a variable of type " .. tostring(red_var.type) ..
+          " in a CUDA kernel")
+      end
+      reductions:insert({ symbol = red_var, op = red_op, init = red_init })
+    end
+    local red_buffers, red_preamble, red_postamble =
+      cudahelper.generate_reduction_host(reductions)
+    local red_init, red_finalize =
+      cudahelper.generate_reduction_kernel(reductions, red_buffers)
+
+    local in_range = terralib.newsymbol(bool, "in_range")
     local index_checks = terralib.newlist()
     for idx = 1, #indices do
       index_checks:insert(quote
-        if [ indices[idx] ] > [ upper_bounds[idx] ] then return end
+        [in_range] = [in_range] and [ indices[idx] ] <= [ upper_bounds[idx] ]
       end)
     end
 
-    body = quote
-      [index_inits]
-      [index_checks]
-      [body]
+    -- Threads past the bounds cannot return early when there are
+    -- reductions as the whole block takes part in combining them
+    if #reductions == 0 then
+      body = quote
+        [index_inits]
+        var [in_range] = true
+        [index_checks]
+        if not [in_range] then return end
+        [body]
+      end
+    else
+      body = quote
+        [red_init]
+        [index_inits]
+        var [in_range] = true
+        [index_checks]
+        if [in_range] then
+          [body]
+        end
+        [red_finalize]
+      end
     end
 
-    local args = collect_symbols(cx, node)
     args:insertall(lower_bounds)
     args:insertall(upper_bounds)
+    args:insertall(red_buffers)
     args:sort(function(s1, s2) return sizeof(s1.type) > sizeof(s2.type) end)
 
     local terra kernel([args]) [body] end
@@ -7277,12 +7324,14 @@ function codegen.stat_for_list(cx, node)
     if ispace_type:is_opaque() then
       return quote
         [actions]
+        [red_preamble]
         while iterator_has_next([it]) do
           var [ counts[1] ] = 0
           var [ lower_bounds[1] ] = iterator_next_span([it], &[ counts[1] ], -1).value
           var [ upper_bounds[1] ] = [ lower_bounds[1] ] + [ counts[1] ] - 1
           [kernel_call]
         end
+        [red_postamble]
         [cleanup_actions]
       end
     else
@@ -7308,7 +7357,9 @@ function codegen.stat_for_list(cx, node)
         [actions]
         var [rect] = [domain_get_rect]([domain])
         [bounds_setup]
+        [red_preamble]
         [kernel_call]
+        [red_postamble]
         [cleanup_actions]
       end
     end
@@ -7740,9 +7791,16 @@ local function stat_index_launch_setup(cx, node, domain, actions)
     else
       local partition = args_partitions[i]
       assert(partition)
+      -- Shifted colors go through an affine projection functor,
+      -- everything else through the default (identity) projection
+      local projection = 0
+      local offset = node.args_provably.offset[i]
+      if offset and offset ~= 0 then
+        projection = std.get_affine_projection_id(offset)
+      end
       expr_call_setup_partition_arg(
         cx, fn.value, arg_type, param_type, partition.value, launcher, true,
-        args_setup)
+        args_setup, projection)
     end
   end
 
@@ -35,6 +35,7 @@ local default_options = {
   ["skip-empty-tasks"] = true,
   ["vectorize"] = true,
   ["vectorize-unsafe"] = false,
+  ["vectorize-width"] = 0,
 
   -- Legion runtime optimization flags:
   ["legion-leaf"] = true,
@@ -273,6 +273,184 @@ function cudahelper.codegen_kernel_call(kernel_id, counts, args)
   end
 end
 
+-- Reductions to scalars in kernels are done hierarchically: every
+-- thread accumulates into its own copy of the variable, the copies
+-- are combined within each warp with shuffles, then across the warps
+-- of a block through shared memory, and finally one thread per block
+-- folds the result of the block into global memory with an atomic.
+
+-- Operators used to combine the partial results of the threads (a
+-- thread computing 'x -= e' accumulates the negated sum from zero)
+local fold_ops = {
+  ["+"] = "+", ["-"] = "+", ["*"] = "*", ["/"] = "*",
+  ["max"] = "max", ["min"] = "min",
+}
+
+local function quote_fold(op, lhs, rhs)
+  if op == "+" then
+    return `([lhs] + [rhs])
+  elseif op == "*" then
+    return `([lhs] * [rhs])
+  elseif op == "max" then
+    return `(terralib.select([lhs] > [rhs], [lhs], [rhs]))
+  elseif op == "min" then
+    return `(terralib.select([lhs] < [rhs], [lhs], [rhs]))
+  else
+    assert(false, "unknown fold operator " .. tostring(op))
+  end
+end
+
+local terra shfl_down_b32(value : uint32, delta : uint32) : uint32
+  return terralib.asm(uint32, "shfl.down.b32 $0, $1, $2, 0x1f;",
+                      "=r,r,r", true, value, delta)
+end
+
+local shfl_down_cache = {}
+local function generate_shfl_down(ty)
+  if shfl_down_cache[ty] then return shfl_down_cache[ty] end
+  local words = terralib.sizeof(ty) / 4
+  assert(words == 1 or words == 2)
+  local terra shfl_down(value : ty, delta : uint32) : ty
+    var result : ty
+    var src = [&uint32](&value)
+    var dst = [&uint32](&result)
+    for i = 0, words do
+      dst[i] = shfl_down_b32(src[i], delta)
+    end
+    return result
+  end
+  shfl_down_cache[ty] = shfl_down
+  return shfl_down
+end
+
+local atomic_cache = {}
+local function generate_atomic_update(op, ty)
+  if not atomic_cache[op] then atomic_cache[op] = {} end
+  if atomic_cache[op][ty] then return atomic_cache[op][ty] end
+  local cas_type, cas_asm, cas_constraints
+  if terralib.sizeof(ty) == 4 then
+    cas_type = uint32
+    cas_asm = "atom.global.cas.b32 $0, [$1], $2, $3;"
+    cas_constraints = "=r,l,r,r"
+  else
+    assert(terralib.sizeof(ty) == 8)
+    cas_type = uint64
+    cas_asm = "atom.global.cas.b64 $0, [$1], $2, $3;"
+    cas_constraints = "=l,l,l,l"
+  end
+  local assumed = terralib.newsymbol(ty, "assumed")
+  local operand = terralib.newsymbol(ty, "operand")
+  local terra atomic_update(address : &ty, [operand])
+    var old : ty = @address
+    while true do
+      var [assumed] = old
+      var new_value : ty = [quote_fold(op, assumed, operand)]
+      var result : cas_type = terralib.asm(cas_type, cas_asm, cas_constraints,
+        true, address, @[&cas_type](&[assumed]), @[&cas_type](&new_value))
+      old = @[&ty](&result)
+      -- Compare the bits so that NaNs cannot make this spin forever
+      if result == @[&cas_type](&[assumed]) then break end
+    end
+  end
+  atomic_cache[op][ty] = atomic_update
+  return atomic_update
+end
+
+-- Each reduction is a table with the variable ('symbol'), the
+-- reduction operator ('op') and its identity ('init'). Returns the
+-- symbols of the device buffers along with the host code that sets
+-- them up before the kernel launches and folds them back afterwards.
+function cudahelper.generate_reduction_host(reductions)
+  local buffers = terralib.newlist()
+  local preamble = terralib.newlist()
+  local postamble = terralib.newlist()
+  for _, red in ipairs(reductions) do
+    local ty = red.symbol.type
+    local buffer = terralib.newsymbol(&ty, "red_" .. tostring(red.symbol))
+    buffers:insert(buffer)
+    preamble:insert(quote
+      var [buffer]
+      RuntimeAPI.cudaMalloc([&&opaque](&[buffer]), [terralib.sizeof(ty)])
+      do
+        var init : ty = [red.init]
+        RuntimeAPI.cudaMemcpy([buffer], &init, [terralib.sizeof(ty)],
+                              RuntimeAPI.cudaMemcpyHostToDevice)
+      end
+    end)
+    local total = terralib.newsymbol(ty, "total")
+    postamble:insert(quote
+      do
+        var [total]
+        RuntimeAPI.cudaMemcpy(&[total], [buffer], [terralib.sizeof(ty)],
+                              RuntimeAPI.cudaMemcpyDeviceToHost)
+        [red.symbol] = [quote_fold(fold_ops[red.op], red.symbol, total)]
+        RuntimeAPI.cudaFree([buffer])
+      end
+    end)
+  end
+  return buffers, preamble, postamble
+end
+
+-- Returns the code that starts each thread from the identity and the
+-- code that combines the values of the threads at the end of the
+-- kernel. Every thread of the block must reach the latter.
+function cudahelper.generate_reduction_kernel(reductions, buffers)
+  local tid_x   = cudalib.nvvm_read_ptx_sreg_tid_x
+  local tid_y   = cudalib.nvvm_read_ptx_sreg_tid_y
+  local tid_z   = cudalib.nvvm_read_ptx_sreg_tid_z
+  local n_tid_x = cudalib.nvvm_read_ptx_sreg_ntid_x
+  local n_tid_y = cudalib.nvvm_read_ptx_sreg_ntid_y
+  local n_tid_z = cudalib.nvvm_read_ptx_sreg_ntid_z
+  local barrier = cudalib.nvvm_barrier0
+
+  local init = terralib.newlist()
+  local finalize = terralib.newlist()
+  local lane = terralib.newsymbol(uint32, "lane")
+  local warp = terralib.newsymbol(uint32, "warp")
+  local num_warps = terralib.newsymbol(uint32, "num_warps")
+  finalize:insert(quote
+    var tid = tid_x() + n_tid_x() * (tid_y() + n_tid_y() * tid_z())
+    var [lane] = tid % 32
+    var [warp] = tid / 32
+    var [num_warps] = (n_tid_x() * n_tid_y() * n_tid_z() + 31) / 32
+  end)
+  for i, red in ipairs(reductions) do
+    local ty = red.symbol.type
+    local op = fold_ops[red.op]
+    local shfl_down = generate_shfl_down(ty)
+    local atomic_update = generate_atomic_update(op, ty)
+    -- One slot for each of the (at most 32) warps of a block
+    local shared = cudalib.sharedmemory(ty, 32)
+    local value = terralib.newsymbol(ty, "value")
+    local warp_reduce = terralib.newlist()
+    for _, offset in ipairs({16, 8, 4, 2, 1}) do
+      warp_reduce:insert(quote
+        do
+          var other = shfl_down([value], offset)
+          [value] = [quote_fold(op, value, other)]
+        end
+      end)
+    end
+
+    init:insert(quote [red.symbol] = [red.init] end)
+    finalize:insert(quote
+      do
+        var [value] = [red.symbol]
+        [warp_reduce]
+        if [lane] == 0 then [shared][ [warp] ] = [value] end
+        barrier()
+        if [warp] == 0 then
+          [value] = terralib.select([lane] < [num_warps],
+                                    [shared][ [lane] ], [red.init])
+          [warp_reduce]
+          if [lane] == 0 then atomic_update([ buffers[i] ], [value]) end
+        end
+      end
+    end)
+  end
+  return init, finalize
+end
+
 local builtin_gpu_fns = {
   acos  = externcall_builtin("__nv_acos"  , double -> double),
   asin  = externcall_builtin("__nv_asin"  , double -> double),
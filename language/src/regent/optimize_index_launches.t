@@ -146,6 +146,72 @@ local function analyze_noninterference_self(
   return true
 end
 
+local function is_loop_symbol(node, symbol)
+  return (node:is(ast.typed.expr.ID) and node.value == symbol) or
+    (node:is(ast.typed.expr.Cast) and
+       node.arg:is(ast.typed.expr.ID) and
+       node.arg.value == symbol)
+end
+
+local function is_integer_constant(node)
+  return node:is(ast.typed.expr.Constant) and
+    type(node.value) == "number" and
+    node.value == math.floor(node.value)
+end
+
+-- Returns the offset k if the index is of the form 'i', 'i + k',
+-- 'k + i' or 'i - k' where 'i' is the loop variable and 'k' is an
+-- integer constant, and nil otherwise.
+local function analyze_index_offset(index, symbol)
+  if is_loop_symbol(index, symbol) then
+    return 0
+  end
+  if not (index:is(ast.typed.expr.Binary) and
+          std.as_read(index.expr_type):isintegral())
+  then
+    return nil
+  end
+  if index.op == "+" then
+    if is_loop_symbol(index.lhs, symbol) and is_integer_constant(index.rhs) then
+      return index.rhs.value
+    elseif is_loop_symbol(index.rhs, symbol) and is_integer_constant(index.lhs) then
+      return index.lhs.value
+    end
+  elseif index.op == "-" then
+    if is_loop_symbol(index.lhs, symbol) and is_integer_constant(index.rhs) then
+      return -index.rhs.value
+    end
+  end
+  return nil
+end
+
+-- A shifted argument (e.g. 'p[i + 1]') uses the subregion that a
+-- different point of the launch gets for an unshifted use of the same
+-- partition, so it must not interfere with any other region argument
+-- unless that argument is provably disjoint from the partition.
+local function analyze_noninterference_shifted(
+    cx, task, arg, partition_type, args, mapping)
+  local parent_region_type = partition_type:parent_region()
+  for i, other_arg in pairs(args) do
+    if other_arg ~= arg then
+      local other_region_type = std.as_read(other_arg.expr_type)
+      local constraint = std.constraint(
+        parent_region_type,
+        other_region_type,
+        std.disjointness)
+
+      if std.type_maybe_eq(parent_region_type.fspace_type,
+                           other_region_type.fspace_type) and
+        not std.check_constraint(cx, constraint) and
+        not check_privilege_noninterference(cx, task, arg, other_arg, mapping)
+      then
+        return false, i
+      end
+    end
+  end
+  return true
+end
+
 local function analyze_is_side_effect_free_node(cx)
   return function(node)
     -- Expressions:
@@ -460,6 +526,7 @@ local function optimize_loop_body(cx, node, report_pass, report_fail)
   local args_provably = ast.IndexLaunchArgsProvably {
     invariant = terralib.newlist(),
     variant = terralib.newlist(),
+    offset = terralib.newlist(),
   }
   local regions_previously_used = terralib.newlist()
   local mapping = {}
@@ -472,6 +539,7 @@ local function optimize_loop_body(cx, node, report_pass, report_fail)
     local arg_invariant = analyze_is_loop_invariant(loop_cx, arg)
 
     local arg_variant = false
+    local arg_offset = false
     local partition_type
 
     local arg_type = std.as_read(arg.expr_type)
@@ -485,13 +553,14 @@ local function optimize_loop_body(cx, node, report_pass, report_fail)
         (std.is_partition(std.as_read(arg.value.expr_type)) or
            std.is_cross_product(std.as_read(arg.value.expr_type)))
       then
-        if (arg.index:is(ast.typed.expr.ID) and arg.index.value == node.symbol) or
-          (arg.index:is(ast.typed.expr.Cast) and
-             arg.index.arg:is(ast.typed.expr.ID) and
-             arg.index.arg.value == node.symbol)
+        local offset = analyze_index_offset(arg.index, node.symbol)
+        -- Shifted colors are only supported for (1D) partitions
+        if offset == 0 or
+          (offset and std.is_partition(std.as_read(arg.value.expr_type)))
         then
           partition_type = std.as_read(arg.value.expr_type)
           arg_variant = true
+          arg_offset = offset
         end
       end
 
@@ -544,6 +613,7 @@ local function optimize_loop_body(cx, node, report_pass, report_fail)
 
     args_provably.invariant[i] = arg_invariant
     args_provably.variant[i] = arg_variant
+    args_provably.offset[i] = arg_offset
 
     regions_previously_used[i] = nil
     if std.is_region(arg_type) then
@@ -551,6 +621,23 @@ local function optimize_loop_body(cx, node, report_pass, report_fail)
     end
   end
 
+  for i, arg in ipairs(args) do
+    if args_provably.offset[i] and args_provably.offset[i] ~= 0 then
+      local region_args = {}
+      for j, other_arg in ipairs(args) do
+        if std.is_region(std.as_read(other_arg.expr_type)) then
+          region_args[j] = other_arg
+        end
+      end
+      local passed, failure_i = analyze_noninterference_shifted(
+        cx, task, arg, std.as_read(arg.value.expr_type), region_args, mapping)
+      if not passed then
+        report_fail(call, "loop optimization failed: argument " .. tostring(i) .. " interferes with argument " .. tostring(failure_i))
+        return
+      end
+    end
+  end
+
   report_pass("loop optimization succeeded")
   return {
     preamble = preamble,
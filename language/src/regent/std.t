@@ -3652,6 +3652,20 @@ do
   end
 end
 
+-- Projection IDs of the affine projection functors used by index
+-- launches over shifted colors of a partition (e.g. p[i + 1]), keyed
+-- by the offset. The IDs are generated when the functors are
+-- registered in std.setup.
+local affine_projection_ids = {}
+
+function std.get_affine_projection_id(offset)
+  assert(type(offset) == "number")
+  if not affine_projection_ids[offset] then
+    affine_projection_ids[offset] = global(c.legion_projection_id_t)
+  end
+  return affine_projection_ids[offset]
+end
+
 local function make_task_wrapper(task_body)
   local return_type = task_body:gettype().returntype
   if return_type == terralib.types.unit then
@@ -3786,6 +3800,18 @@ function std.setup(main_task, extra_setup_thunk, registration_name)
     end
   end
 
+  local projection_registrations = terralib.newlist()
+  for offset, projection_id in pairs(affine_projection_ids) do
+    projection_registrations:insert(
+      quote
+        [projection_id] = c.legion_runtime_generate_static_projection_id()
+        var transform_data = arrayof(c.coord_t, 1)
+        var offset_data = arrayof(c.coord_t, [offset])
+        c.legion_runtime_preregister_affine_projection_functor(
+          [projection_id], 1, transform_data, offset_data)
+      end)
+  end
+
   local layout_registrations = terralib.newlist()
   local layout_normal = data.newmap()
   do
@@ -3957,6 +3983,7 @@ function std.setup(main_task, extra_setup_thunk, registration_name)
 
   local terra main([argc], [argv])
     [reduction_registrations];
+    [projection_registrations];
     [layout_registrations];
     [task_registrations];
     [cuda_setup];
@@ -29,9 +29,16 @@ local bounds_checks = std.config["bounds-checks"]
 
 -- vectorizer
 
+-- The register size can be given explicitly (e.g. when compiling for a
+-- machine other than the one running the compiler), otherwise it is
+-- detected from the features of the host CPU
 local SIMD_REG_SIZE
-if os.execute("bash -c \"[ `uname` == 'Darwin' ]\"") == 0 then
-  if os.execute("sysctl -a | grep machdep.cpu.features | grep AVX > /dev/null") == 0 then
+if std.config["vectorize-width"] > 0 then
+  SIMD_REG_SIZE = std.config["vectorize-width"]
+elseif os.execute("bash -c \"[ `uname` == 'Darwin' ]\"") == 0 then
+  if os.execute("sysctl -a | grep machdep.cpu.leaf7_features | grep AVX512F > /dev/null") == 0 then
+    SIMD_REG_SIZE = 64
+  elseif os.execute("sysctl -a | grep machdep.cpu.features | grep AVX > /dev/null") == 0 then
     SIMD_REG_SIZE = 32
   elseif os.execute("sysctl -a | grep machdep.cpu.features | grep SSE > /dev/null") == 0 then
     SIMD_REG_SIZE = 16
@@ -39,7 +46,9 @@ if os.execute("bash -c \"[ `uname` == 'Darwin' ]\"") == 0 then
     error("Unable to determine CPU architecture")
   end
 else
-  if os.execute("grep avx /proc/cpuinfo > /dev/null") == 0 then
+  if os.execute("grep avx512f /proc/cpuinfo > /dev/null") == 0 then
+    SIMD_REG_SIZE = 64
+  elseif os.execute("grep avx /proc/cpuinfo > /dev/null") == 0 then
     SIMD_REG_SIZE = 32
   elseif os.execute("grep sse /proc/cpuinfo > /dev/null") == 0 then
     SIMD_REG_SIZE = 16
@@ -389,15 +398,20 @@ function min_simd_width.stat(cx, reg_size, node)
 
   elseif node:is(ast.typed.stat.If) then
     local simd_width = reg_size
-    min(simd_width, min_simd_width.block(cx, reg_size, node.then_block))
+    simd_width = min(simd_width, min_simd_width.expr(cx, reg_size, node.cond))
+    simd_width =
+      min(simd_width, min_simd_width.block(cx, reg_size, node.then_block))
     node.elseif_blocks:map(function(elseif_block)
-      min(simd_width, min_simd_width.stat(cx, reg_size, elseif_block))
+      simd_width =
+        min(simd_width, min_simd_width.stat(cx, reg_size, elseif_block))
     end)
-    min(simd_width, min_simd_width.block(cx, reg_size, node.else_block))
+    simd_width =
+      min(simd_width, min_simd_width.block(cx, reg_size, node.else_block))
     return simd_width
 
   elseif node:is(ast.typed.stat.Elseif) then
-    return min_simd_width.block(cx, reg_size, node.block)
+    return min(min_simd_width.expr(cx, reg_size, node.cond),
+               min_simd_width.block(cx, reg_size, node.block))
 
   else
     assert(false, "unexpected node type " .. tostring(node:type()))
@@ -86,10 +86,23 @@ class CommandMeasurement(object):
             raise Exception('Command produced no output')
         return result
 
+class JSONMeasurement(object):
+    __slots__ = ['key']
+    def __init__(self, key=None):
+        # dot-separated path into the output (e.g. the output of
+        #  test/performance/realm/realm_bench.py), with list indices as numbers
+        self.key = key
+    def measure(self, argv, output):
+        result = json.loads(output)
+        for part in self.key.split('.'):
+            result = result[int(part)] if isinstance(result, list) else result[part]
+        return result
+
 measurement_types = {
     'argv': ArgvMeasurement,
     'regex': RegexMeasurement,
     'command': CommandMeasurement,
+    'json': JSONMeasurement,
 }
 
 def strip_type(type=None, **kwargs):
@@ -1885,6 +1885,15 @@ namespace Legion {
      * programs. We provide a generic attach launcher than can handle
      * all kinds of attachments. Each attach launcher should be used
      * for attaching only one kind of resource.
+     *
+     * Attaching a file does not read any of its data. The attached
+     * instance becomes the valid copy of the region and data is only
+     * read out of it when an operation maps an instance that needs it,
+     * and then only for the region that operation requested (HDF5
+     * files are read with hyperslab selections of that region). To
+     * load just the pieces of a large file that are actually used,
+     * acquire the attached region and launch the tasks on subregions
+     * directly rather than copying the whole region into another one.
      * @see Runtime
      */
     struct AttachLauncher {
@@ -2975,6 +2984,37 @@ namespace Legion {
        */
       virtual bool is_exclusive(void) const { return false; }
 
+      /**
+       * Indicate whether the result of this projection functor 
+       * depends only on the upper bound and the point being 
+       * projected (and not on the operation, the index of the
+       * region requirement, or any state in the functor). The
+       * runtime will cache the results of functional projection
+       * functors and skip invoking them again for repeated
+       * index space launches.
+       */
+      virtual bool is_functional(void) const { return false; }
+
+      /**
+       * Optionally describe this projection functor symbolically as
+       * an affine map from the points of the launch space to the 
+       * colors of the children of an upper bound partition:
+       *   color = transform * point + offset
+       * This is only consulted for depth 0 functors projecting from
+       * partitions. The runtime uses the description to prove that
+       * one index space launch only touches subregions written by an
+       * earlier launch without enumerating the points of either.
+       * The default implementation is not affine.
+       * @param dim the number of dimensions of the launch space
+       *            (and of the colors of the partition)
+       * @param transform row-major dim x dim matrix to fill in
+       * @param offset vector of dim elements to fill in
+       * @return true if the functor is affine for this dimension
+       */
+      virtual bool get_affine_projection(int dim, coord_t *transform,
+                                         coord_t *offset) const
+        { return false; }
+
       /**
        * Specify the depth which this projection function goes
        * for all the points in an index space launch from 
@@ -3808,6 +3848,29 @@ namespace Legion {
                               Color color = AUTO_GENERATE_ID,
                               MapperID id = 0, MappingTagID tag = 0);
       ///@}
+      ///@{
+      /**
+       * Dependent partitioning calls made between these two calls
+       * are batched together when they need to read fields of the
+       * same logical region. Consecutive calls to create partitions 
+       * by field, image, image range, preimage, or preimage range that
+       * read fields of the same region with the same parent region,
+       * mapper, and tag are fused into a single operation which maps 
+       * the region once and issues all the partitioning computations 
+       * on the same instances together. The names of the partitions 
+       * are still returned right away so later calls in the batch can
+       * use the results of earlier ones (e.g. an image of a partition
+       * computed by field). The batched operation is issued when the
+       * batch ends, when a call that cannot be fused is made, or when
+       * any other operation is launched in the context. The application
+       * must not wait on anything that depends on a batched partition 
+       * before the batch is issued or deadlock will result. Batches
+       * may be nested in which case only the outermost one counts.
+       * @param ctx the enclosing task context
+       */
+      void begin_dependent_partition_batch(Context ctx);
+      void end_dependent_partition_batch(Context ctx);
+      ///@}
     public:
       //------------------------------------------------------------------------
       // Computed Index Spaces and Partitions 
@@ -5718,6 +5781,21 @@ namespace Legion {
        */
       Processor get_executing_processor(Context ctx);
 
+      /**
+       * Report how much memory the runtime's own data structures are
+       * using in this process right now. The usage is broken down by
+       * the kind of data structure (e.g. "Individual Task" or "Version
+       * State") and each entry holds the live bytes followed by the
+       * number of live allocations. Kinds with nothing live are left
+       * out. This is cheap enough to call periodically in long-running
+       * applications to find out what is growing. The map is left
+       * empty if the runtime was built with
+       * LEGION_DISABLE_ALLOCATION_COUNTERS.
+       * @param usage map to fill in with the usage of each kind
+       */
+      void get_internal_memory_usage(
+                      std::map<std::string,std::pair<size_t,size_t> > &usage);
+
       /**
        * Indicate that data in a particular physical region
        * appears to be incorrect for whatever reason.  This
@@ -6372,7 +6450,12 @@ namespace Legion {
        * interface.  Reduction operations can be used either for reduction
        * privileges on a region or for performing reduction of values across
        * index space task launches.  The reduction operation ID zero is
-       * reserved for runtime use.
+       * reserved for runtime use. If this is called from a CUDA source
+       * file compiled with LEGION_GPU_REDUCTIONS defined then the 'apply' 
+       * and 'fold' methods of the reduction operation must also be callable
+       * from device code (e.g. using __CUDA_HD__ and atomics for the 
+       * non-exclusive versions) and reductions between instances in 
+       * GPU framebuffers will then be performed on the GPU.
        * @param redop_id ID at which to register the reduction operation
        */
       template<typename REDOP>
@@ -82,6 +82,9 @@ namespace Legion {
       inline void add_user(const UT &user, bool precise);
       inline void add_single_user(unsigned index, const UT &user);
       inline void add_child(FieldTree<UT> *child_node);
+      inline void remove_child(FieldTree<UT> *child_node);
+      inline void find_children(const FieldMask &mask,
+                                std::set<FieldTree<UT>*> &overlaps) const;
       void check_state(void);
     public:
       // Not constant so we can mutate it when packing/unpacking
@@ -90,9 +93,18 @@ namespace Legion {
       const bool single_node;
       // If a single node then this is the index of the set field
       const unsigned single_index;
+    private:
+      // Once a node has this many children we also keep them in
+      // per-field buckets so that lookups only visit the children
+      // that actually overlap the query mask
+      static const size_t FIELD_INDEX_THRESHOLD = 16;
     private:
       std::set<FieldTree<UT>*> children;
-      std::set<FieldTree<UT>*> single_children;
+      // Single field children are keyed by their field index
+      std::map<unsigned,FieldTree<UT>*> single_children;
+      // Per-field buckets of children, only used when indexed
+      std::map<unsigned,std::set<FieldTree<UT>*> > field_children;
+      bool field_indexed;
     private:
       std::list<UT> precise_users;
       std::list<UT> imprecise_users;
@@ -108,7 +120,8 @@ namespace Legion {
     FieldTree<UT>::FieldTree(const FieldMask &mask, bool merge/* = false*/)
       : local_mask(mask), merge_node(merge),
         single_node(FieldMask::pop_count(mask) == 1), 
-        single_index(single_node ? mask.find_first_set() : 0)
+        single_index(single_node ? mask.find_first_set() : 0),
+        field_indexed(false)
     //--------------------------------------------------------------------------
     {
     }
@@ -117,7 +130,7 @@ namespace Legion {
     template<typename UT>
     FieldTree<UT>::FieldTree(const FieldTree<UT> &rhs)
       : local_mask(FieldMask()), merge_node(false), single_node(false), 
-        single_index(0)
+        single_index(0), field_indexed(false)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -138,12 +151,13 @@ namespace Legion {
         delete (*it);
       }
       children.clear();
-      for (typename std::set<FieldTree<UT>*>::const_iterator it =
+      for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it =
             single_children.begin(); it != single_children.end(); it++)
       {
-        delete (*it);
+        delete it->second;
       }
       single_children.clear();
+      field_children.clear();
     }
 
     //--------------------------------------------------------------------------
@@ -227,11 +241,11 @@ namespace Legion {
           rez.serialize((*it)->local_mask);
           rez.serialize((*it)->merge_node);
         }
-        for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+        for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it = 
               single_children.begin(); it != single_children.end(); it++)
         {
-          rez.serialize((*it)->local_mask);
-          rez.serialize((*it)->merge_node);
+          rez.serialize(it->second->local_mask);
+          rez.serialize(it->second->merge_node);
         }
       }
       // Finally pack each of the children
@@ -240,10 +254,10 @@ namespace Legion {
       {
         (*it)->pack_field_tree(rez);
       }
-      for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+      for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it = 
             single_children.begin(); it != single_children.end(); it++)
       {
-        (*it)->pack_field_tree(rez);
+        it->second->pack_field_tree(rez);
       }
     }
 
@@ -326,29 +340,40 @@ namespace Legion {
         {
           (*it)->analyze_no_checks(analyzer);
         }
-        for (typename std::set<FieldTree<UT>*>::const_iterator it =
+        for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it =
               single_children.begin(); it != single_children.end(); it++)
         {
-          (*it)->analyze_no_checks(analyzer);
+          it->second->analyze_no_checks(analyzer);
         }
       }
       else
       {
         // Now figure out which of our children we need to traverse
-        for (typename std::set<FieldTree<UT>*>::const_iterator it = 
-              children.begin(); it != children.end(); it++)
+        if (field_indexed)
         {
-          // Skip any children with disjoint fields
-          if ((*it)->local_mask * mask)
-            continue;
-          (*it)->analyze_recurse(mask, analyzer);
+          std::set<FieldTree<UT>*> overlaps;
+          find_children(mask, overlaps);
+          for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+                overlaps.begin(); it != overlaps.end(); it++)
+            (*it)->analyze_recurse(mask, analyzer);
         }
-        for (typename std::set<FieldTree<UT>*>::const_iterator it =
+        else
+        {
+          for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+                children.begin(); it != children.end(); it++)
+          {
+            // Skip any children with disjoint fields
+            if ((*it)->local_mask * mask)
+              continue;
+            (*it)->analyze_recurse(mask, analyzer);
+          }
+        }
+        for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it =
               single_children.begin(); it != single_children.end(); it++)
         {
-          if (!mask.is_set((*it)->single_index))
+          if (!mask.is_set(it->first))
             continue;
-          (*it)->analyze_recurse(mask, analyzer);
+          it->second->analyze_recurse(mask, analyzer);
         }
       }
       analyzer.end_node(this);
@@ -389,10 +414,10 @@ namespace Legion {
       {
         (*it)->analyze_no_checks(analyzer);
       }
-      for (typename std::set<FieldTree<UT>*>::const_iterator it =
+      for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it =
             single_children.begin(); it != single_children.end(); it++)
       {
-        (*it)->analyze_no_checks(analyzer);
+        it->second->analyze_no_checks(analyzer);
       }
       analyzer.end_node(this);
     }
@@ -417,21 +442,32 @@ namespace Legion {
         return;
       }
       // Now figure out which of our children we need to traverse
-      for (typename std::set<FieldTree<UT>*>::const_iterator it = 
-            children.begin(); it != children.end(); it++)
+      if (field_indexed)
       {
-        // Skip any children with disjoint fields
-        if (!(*it)->local_mask.is_set(index))
-          continue;
-        (*it)->analyze_single(index, analyzer);
+        typename std::map<unsigned,std::set<FieldTree<UT>*> >::const_iterator
+          finder = field_children.find(index);
+        if (finder != field_children.end())
+        {
+          for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+                finder->second.begin(); it != finder->second.end(); it++)
+            (*it)->analyze_single(index, analyzer);
+        }
       }
-      for (typename std::set<FieldTree<UT>*>::const_iterator it =
-            single_children.begin(); it != single_children.end(); it++)
+      else
       {
-        if ((*it)->single_index != index)
-          continue;
-        (*it)->analyze_single(index, analyzer);
+        for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+              children.begin(); it != children.end(); it++)
+        {
+          // Skip any children with disjoint fields
+          if (!(*it)->local_mask.is_set(index))
+            continue;
+          (*it)->analyze_single(index, analyzer);
+        }
       }
+      typename std::map<unsigned,FieldTree<UT>*>::const_iterator single_finder =
+        single_children.find(index);
+      if (single_finder != single_children.end())
+        single_finder->second->analyze_single(index, analyzer);
       analyzer.end_node(this);
     }
 
@@ -603,25 +639,27 @@ namespace Legion {
         //      children that we may traverse
         typename std::map<FieldTree<UT>*,bool/*single*/> overlaps;
         typename std::set<FieldTree<UT>*> dominators;
-        for (typename std::set<FieldTree*>::const_iterator it = 
-              children.begin(); it != children.end(); it++)
         {
-          if ((*it)->local_mask * user.field_mask)
-            continue;
-          overlaps[*it] = false;
-          if (!(user.field_mask - (*it)->local_mask))
-            dominators.insert(*it);
+          std::set<FieldTree<UT>*> child_overlaps;
+          find_children(user.field_mask, child_overlaps);
+          for (typename std::set<FieldTree*>::const_iterator it = 
+                child_overlaps.begin(); it != child_overlaps.end(); it++)
+          {
+            overlaps[*it] = false;
+            if (!(user.field_mask - (*it)->local_mask))
+              dominators.insert(*it);
+          }
         }
-        for (typename std::set<FieldTree<UT>*>::const_iterator it =
+        for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it =
               single_children.begin(); it != single_children.end(); it++)
         {
-          if (!user.field_mask.is_set((*it)->single_index))
+          if (!user.field_mask.is_set(it->first))
             continue;
-          overlaps[*it] = true;
+          overlaps[it->second] = true;
           FieldMask copy = user.field_mask;
-          copy.unset_bit((*it)->single_index);
+          copy.unset_bit(it->first);
           if (!copy)
-            dominators.insert(*it);
+            dominators.insert(it->second);
         }
         // There are three scenarios here:
         //  - No overlaps: make a new node and add it to the children
@@ -659,10 +697,7 @@ namespace Legion {
             child_node->add_user(user, true/*precise*/);
             child_node->add_child(next->first);
             // Remove the old child and add it to the new child
-            if (next->second)
-              single_children.erase(next->first);
-            else
-              children.erase(next->first);
+            remove_child(next->first);
             // Now add the new child to this node
             add_child(child_node);
           }
@@ -697,10 +732,7 @@ namespace Legion {
               // Skip anything we don't dominate
               if (!!(it->first->local_mask - user.field_mask))
                 continue;
-              if (it->second)
-                single_children.erase(it->first);
-              else
-                children.erase(it->first);
+              remove_child(it->first);
               child_node->add_child(it->first);
             }
             add_child(child_node);
@@ -765,24 +797,17 @@ namespace Legion {
       }
       // Now check the single users to see if we find the node
       // we're looking for.  If we do then we're done.
-      for (typename std::set<FieldTree<UT>*>::const_iterator it = 
-            single_children.begin(); it != single_children.end(); it++)
+      typename std::map<unsigned,FieldTree<UT>*>::const_iterator single_finder =
+        single_children.find(index);
+      if (single_finder != single_children.end())
       {
-        if ((*it)->single_index == index)
-        {
-          (*it)->insert_single(index, user);
-          return;
-        }
+        single_finder->second->insert_single(index, user);
+        return;
       }
       // Now find overlaps/dominators.  Since we are a single field
       // mask we know that any overlap by definition dominates us.
       typename std::set<FieldTree<UT>*> dominators;
-      for (typename std::set<FieldTree<UT>*>::const_iterator it = 
-            children.begin(); it != children.end(); it++)
-      {
-        if ((*it)->local_mask.is_set(index))
-          dominators.insert(*it);
-      }
+      find_children(user.field_mask, dominators);
       // See how many dominators we had
       if (dominators.empty())
       {
@@ -847,7 +872,7 @@ namespace Legion {
         // only one field would be dominated by all the other 
         // dominators which violates the invariant that no child
         // dominates any others which is always maintained.
-        children.erase(*it);
+        remove_child(*it);
         // If the dominator is precise then add it, otherwise flatten
         // it into this node.
         if (!(*it)->merge_node)
@@ -890,10 +915,10 @@ namespace Legion {
       }
       single_users.clear();
       // Copy up the single children
-      for (typename std::set<FieldTree<UT>*>::const_iterator it =
+      for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator it =
             single_children.begin(); it != single_children.end(); it++)
       {
-        dominator_node->add_child(*it);
+        dominator_node->add_child(it->second);
       }
       // Clear them so we don't delete them when we delete the node
       single_children.clear();
@@ -904,6 +929,8 @@ namespace Legion {
       }
       // clear them so we don't delete them when we delete the node
       children.clear();
+      field_children.clear();
+      field_indexed = false;
     }
 
     //--------------------------------------------------------------------------
@@ -937,7 +964,7 @@ namespace Legion {
         assert(child->local_mask != local_mask);
         assert(!(child->local_mask - local_mask));
 #endif
-        single_children.insert(child);
+        single_children[child->single_index] = child;
       }
       else
       {
@@ -947,6 +974,88 @@ namespace Legion {
         assert(!(child->local_mask - local_mask));
 #endif
         children.insert(child);
+        if (field_indexed)
+        {
+          for (int idx = child->local_mask.find_first_set(); idx >= 0;
+                idx = child->local_mask.find_next_set(idx+1))
+            field_children[idx].insert(child);
+        }
+        else if (children.size() >= FIELD_INDEX_THRESHOLD)
+        {
+          // Wide enough now that it is worth building the index
+          for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+                children.begin(); it != children.end(); it++)
+          {
+            for (int idx = (*it)->local_mask.find_first_set(); idx >= 0;
+                  idx = (*it)->local_mask.find_next_set(idx+1))
+              field_children[idx].insert(*it);
+          }
+          field_indexed = true;
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename UT>
+    inline void FieldTree<UT>::remove_child(FieldTree<UT> *child)
+    //--------------------------------------------------------------------------
+    {
+      if (child->single_node)
+      {
+#ifdef DEBUG_LEGION
+        assert(single_children.find(child->single_index) != 
+                single_children.end());
+        assert(single_children[child->single_index] == child);
+#endif
+        single_children.erase(child->single_index);
+        return;
+      }
+      children.erase(child);
+      if (field_indexed)
+      {
+        for (int idx = child->local_mask.find_first_set(); idx >= 0;
+              idx = child->local_mask.find_next_set(idx+1))
+        {
+          typename std::map<unsigned,std::set<FieldTree<UT>*> >::iterator
+            finder = field_children.find(idx);
+#ifdef DEBUG_LEGION
+          assert(finder != field_children.end());
+#endif
+          finder->second.erase(child);
+          if (finder->second.empty())
+            field_children.erase(finder);
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename UT>
+    inline void FieldTree<UT>::find_children(const FieldMask &mask,
+                                   std::set<FieldTree<UT>*> &overlaps) const
+    //--------------------------------------------------------------------------
+    {
+      // Only walk the per-field buckets when that visits fewer
+      // entries than just testing every child against the mask
+      if (field_indexed && 
+          (size_t(FieldMask::pop_count(mask)) < children.size()))
+      {
+        for (int idx = mask.find_first_set(); idx >= 0;
+              idx = mask.find_next_set(idx+1))
+        {
+          typename std::map<unsigned,std::set<FieldTree<UT>*> >::const_iterator
+            finder = field_children.find(idx);
+          if (finder != field_children.end())
+            overlaps.insert(finder->second.begin(), finder->second.end());
+        }
+      }
+      else
+      {
+        for (typename std::set<FieldTree<UT>*>::const_iterator it = 
+              children.begin(); it != children.end(); it++)
+        {
+          if (!((*it)->local_mask * mask))
+            overlaps.insert(*it);
+        }
       }
     }
 
@@ -966,19 +1075,37 @@ namespace Legion {
           assert(!!((*it2)->local_mask - (*it1)->local_mask));
         }
       }
-      for (typename std::set<FieldTree<UT>*>::const_iterator sit = 
+      for (typename std::map<unsigned,FieldTree<UT>*>::const_iterator sit = 
             single_children.begin(); sit != single_children.end(); sit++)
       {
+        assert(sit->second->single_index == sit->first);
         for (typename std::set<FieldTree<UT>*>::const_iterator cit = 
               children.begin(); cit != children.end(); cit++)
         {
-          assert(!((*cit)->local_mask.is_set((*sit)->single_index)));
+          assert(!((*cit)->local_mask.is_set(sit->first)));
         }
-        for (typename std::set<FieldTree<UT>*>::const_iterator cit = 
-              single_children.begin(); cit != sit; cit++)
+      }
+      // Check that the field index matches the children
+      if (field_indexed)
+      {
+        size_t total = 0;
+        for (typename std::map<unsigned,std::set<FieldTree<UT>*> >::
+              const_iterator fit = field_children.begin(); 
+              fit != field_children.end(); fit++)
         {
-          assert((*sit)->single_index != (*cit)->single_index);
+          for (typename std::set<FieldTree<UT>*>::const_iterator cit = 
+                fit->second.begin(); cit != fit->second.end(); cit++)
+          {
+            assert(children.find(*cit) != children.end());
+            assert((*cit)->local_mask.is_set(fit->first));
+          }
+          total += fit->second.size();
         }
+        size_t expected = 0;
+        for (typename std::set<FieldTree<UT>*>::const_iterator cit = 
+              children.begin(); cit != children.end(); cit++)
+          expected += FieldMask::pop_count((*cit)->local_mask);
+        assert(total == expected);
       }
     }
     
@@ -1309,23 +1309,24 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
-      int signed_count = count;
-      RtUserEvent done_event = RtUserEvent::NO_RT_USER_EVENT;
       if (!add)
-        signed_count = -signed_count;
-      else
-        done_event = Runtime::create_rt_user_event();
+      {
+        // Removals don't need a response so they can be batched
+        runtime->defer_remote_reference_release(target, did, VALID_REF_KIND,
+                                         count, (target == owner_space));
+        return;
+      }
+      RtUserEvent done_event = Runtime::create_rt_user_event();
       Serializer rez;
       {
         RezCheck z(rez);
         rez.serialize(did);
-        rez.serialize(signed_count);
+        rez.serialize<int>(count);
         rez.serialize<bool>(target == owner_space);
-        if (add)
-          rez.serialize(done_event);
+        rez.serialize(done_event);
       }
       runtime->send_did_remote_valid_update(target, rez);
-      if (add && (mutator != NULL))
+      if (mutator != NULL)
         mutator->record_reference_mutation_effect(done_event);
     }
 
@@ -1338,23 +1339,24 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
-      int signed_count = count;
-      RtUserEvent done_event = RtUserEvent::NO_RT_USER_EVENT;
       if (!add)
-        signed_count = -signed_count;
-      else
-        done_event = Runtime::create_rt_user_event();
+      {
+        // Removals don't need a response so they can be batched
+        runtime->defer_remote_reference_release(target, did, GC_REF_KIND,
+                                         count, (target == owner_space));
+        return;
+      }
+      RtUserEvent done_event = Runtime::create_rt_user_event();
       Serializer rez;
       {
         RezCheck z(rez);
         rez.serialize(did);
-        rez.serialize(signed_count);
+        rez.serialize<int>(count);
         rez.serialize<bool>(target == owner_space);
-        if (add)
-          rez.serialize(done_event);
+        rez.serialize(done_event);
       }
       runtime->send_did_remote_gc_update(target, rez);
-      if (add && (mutator != NULL))
+      if (mutator != NULL)
         mutator->record_reference_mutation_effect(done_event);
     }
 
@@ -1367,14 +1369,18 @@ namespace Legion {
       assert(count != 0);
       assert(registered_with_runtime);
 #endif
-      int signed_count = count;
       if (!add)
-        signed_count = -signed_count;
+      {
+        // Removals don't need a response so they can be batched
+        runtime->defer_remote_reference_release(target, did, 
+                    RESOURCE_REF_KIND, count, (target == owner_space));
+        return;
+      }
       Serializer rez;
       {
         RezCheck z(rez);
         rez.serialize(did);
-        rez.serialize(signed_count);
+        rez.serialize<int>(count);
         rez.serialize<bool>(target == owner_space);
       }
       runtime->send_did_remote_resource_update(target, rez);
@@ -1571,6 +1577,54 @@ namespace Legion {
         delete target;
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ void DistributedCollectable::handle_did_remote_release_batch(
+                                         Runtime *runtime, Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      size_t num_releases;
+      derez.deserialize(num_releases);
+      for (unsigned idx = 0; idx < num_releases; idx++)
+      {
+        DistributedID did;
+        derez.deserialize(did);
+        bool is_owner;
+        derez.deserialize(is_owner);
+        unsigned valid_count, gc_count, resource_count;
+        derez.deserialize(valid_count);
+        derez.deserialize(gc_count);
+        derez.deserialize(resource_count);
+        DistributedCollectable *target = NULL;
+        if (!is_owner)
+        {
+          RtEvent ready;
+          target = runtime->find_distributed_collectable(did, ready);
+          if (ready.exists() && !ready.has_triggered())
+            ready.lg_wait();
+        }
+        else
+          target = runtime->find_distributed_collectable(did);
+        // Remove them in the same order as the references nest so
+        // that the last one to go is the one that reports deletion
+        if ((valid_count > 0) && 
+            target->remove_base_valid_ref(REMOTE_DID_REF, NULL, valid_count))
+        {
+          delete target;
+          continue;
+        }
+        if ((gc_count > 0) && 
+            target->remove_base_gc_ref(REMOTE_DID_REF, NULL, gc_count))
+        {
+          delete target;
+          continue;
+        }
+        if ((resource_count > 0) && 
+            target->remove_base_resource_ref(REMOTE_DID_REF, resource_count))
+          delete target;
+      }
+    }
+
     //--------------------------------------------------------------------------
     /*static*/ void DistributedCollectable::handle_did_add_create(
                                          Runtime *runtime, Deserializer &derez)
@@ -4235,6 +4235,20 @@ namespace Legion {
                                                        part_kind, color,id,tag);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::begin_dependent_partition_batch(Context ctx)
+    //--------------------------------------------------------------------------
+    {
+      runtime->begin_dependent_partition_batch(ctx);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::end_dependent_partition_batch(Context ctx)
+    //--------------------------------------------------------------------------
+    {
+      runtime->end_dependent_partition_batch(ctx);
+    }
+
     //--------------------------------------------------------------------------
     IndexPartition Runtime::create_pending_partition(Context ctx,
                              IndexSpace parent, IndexSpace color_space, 
@@ -6167,6 +6181,14 @@ namespace Legion {
       return runtime->get_executing_processor(ctx);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::get_internal_memory_usage(
+                       std::map<std::string,std::pair<size_t,size_t> > &usage)
+    //--------------------------------------------------------------------------
+    {
+      Internal::Runtime::get_internal_memory_usage(usage);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::raise_region_exception(Context ctx, 
                                                   PhysicalRegion region,
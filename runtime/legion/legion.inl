@@ -18,6 +18,10 @@
 // Useful for IDEs 
 #include "legion.h"
 
+#if defined(__CUDACC__) && defined(LEGION_GPU_REDUCTIONS)
+#include "realm/cuda/cuda_redop.h"
+#endif
+
 namespace Legion {
 
     /**
@@ -4835,8 +4839,14 @@ namespace Legion {
 #endif
         exit(ERROR_DUPLICATE_REDOP_ID);
       }
-      red_table[redop_id] = 
-        Realm::ReductionOpUntyped::create_reduction_op<REDOP>(); 
+      Realm::ReductionOpUntyped *redop = 
+        Realm::ReductionOpUntyped::create_reduction_op<REDOP>();
+#if defined(__CUDACC__) && defined(LEGION_GPU_REDUCTIONS)
+      // Reduction operators registered from CUDA source files can also
+      // be applied to instances in GPU framebuffers by the device itself
+      Realm::Cuda::add_cuda_redop_kernels<REDOP>(redop);
+#endif
+      red_table[redop_id] = redop;
       // We also have to check to see if there are explicit serialization
       // and deserialization methods on the RHS type for doing fold reductions
       SerdezRedopTable &serdez_red_table = Runtime::get_serdez_redop_table();
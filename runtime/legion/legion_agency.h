@@ -35,14 +35,60 @@
 #ifdef __CUDACC__
 #include <agency/cuda/execution/executor/parallel_executor.hpp>
 #endif
+#include <type_traits>
+
+#ifdef REALM_USE_OPENMP
+// Provided by Realm's OpenMP module, runs fnptr over blocks of [0,count)
+// on the thread pool of the OpenMP processor running the caller
+extern "C" void realm_omp_bulk_execute(
+    void (*fnptr)(void *data, size_t first, size_t last),
+    void *data, size_t count);
+#endif
 
 namespace Legion {
 
+#ifdef REALM_USE_OPENMP
+  /**
+   * \class RealmOMPExecutor
+   * An Agency executor that runs bulk work directly on the Realm
+   * thread pool of the OpenMP processor executing the current task
+   * so it never goes through (and oversubscribes cores with) the
+   * system OpenMP runtime.
+   */
+  class RealmOMPExecutor {
+  public:
+    using execution_category = agency::parallel_execution_tag;
+  public:
+    template<typename Function, typename ResultFactory, 
+             typename SharedFactory>
+    typename std::result_of<ResultFactory()>::type
+      bulk_sync_execute(Function f, size_t n, ResultFactory result_factory,
+                        SharedFactory shared_factory) const;
+  public:
+    inline bool operator==(const RealmOMPExecutor &rhs) const { return true; }
+    inline bool operator!=(const RealmOMPExecutor &rhs) const { return false; }
+  protected:
+    template<typename Function, typename Result, typename Shared>
+    struct BulkArgs {
+    public:
+      Function *f;
+      Result *result;
+      Shared *shared;
+    };
+    template<typename Function, typename Result, typename Shared>
+    static void bulk_entry(void *data, size_t first, size_t last);
+  };
+#endif
+
   namespace Internal {
     using VariantExecutor = agency::variant_executor<
                                   agency::sequenced_executor,
                                   agency::vector_executor,
+#ifdef REALM_USE_OPENMP
+                                  RealmOMPExecutor
+#else
                                   agency::omp::parallel_for_executor
+#endif
 #ifdef __CUDACC__
                                   , agency::cuda_parallel_executor
 #endif
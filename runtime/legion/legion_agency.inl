@@ -15,6 +15,44 @@
 
 namespace Legion {
 
+#ifdef REALM_USE_OPENMP
+    /////////////////////////////////////////////////////////////
+    // Realm OpenMP Executor 
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    template<typename Function, typename ResultFactory, typename SharedFactory>
+    inline typename std::result_of<ResultFactory()>::type 
+      RealmOMPExecutor::bulk_sync_execute(Function f, size_t n, 
+                                          ResultFactory result_factory,
+                                          SharedFactory shared_factory) const
+    //--------------------------------------------------------------------------
+    {
+      typedef typename std::result_of<ResultFactory()>::type Result;
+      typedef typename std::result_of<SharedFactory()>::type Shared;
+      Result result = result_factory();
+      Shared shared = shared_factory();
+      BulkArgs<Function,Result,Shared> args;
+      args.f = &f;
+      args.result = &result;
+      args.shared = &shared;
+      realm_omp_bulk_execute(&bulk_entry<Function,Result,Shared>, &args, n);
+      return std::move(result);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename Function, typename Result, typename Shared>
+    /*static*/ inline void RealmOMPExecutor::bulk_entry(void *data, 
+                                                 size_t first, size_t last)
+    //--------------------------------------------------------------------------
+    {
+      const BulkArgs<Function,Result,Shared> *args = 
+        static_cast<const BulkArgs<Function,Result,Shared>*>(data);
+      for (size_t idx = first; idx < last; idx++)
+        (*args->f)(idx, *args->result, *args->shared);
+    }
+#endif
+
     /////////////////////////////////////////////////////////////
     // Legion Executor 
     /////////////////////////////////////////////////////////////
@@ -50,8 +88,13 @@ namespace Legion {
           }
         case Processor::OMP_PROC:
           {
+#ifdef REALM_USE_OPENMP
+            // Run straight on the Realm thread pool for this processor
+            return Internal::VariantExecutor(RealmOMPExecutor());
+#else
             return Internal::VariantExecutor(
                       agency::omp::parallel_for_executor());
+#endif
           }
         case Processor::TOC_PROC:
           {
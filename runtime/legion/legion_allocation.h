@@ -213,22 +213,6 @@ namespace Legion {
               AlignmentTrait<T>::AlignmentOf,BYTES>(cnt);
     }
 
-#ifdef TRACE_ALLOCATION
-    // forward declaration of runtime
-    class Runtime;
-
-    // Implementations in runtime.cc
-    struct LegionAllocation {
-    public:
-      static void trace_allocation(AllocationType a, size_t size, int elems=1);
-      static void trace_free(AllocationType a, size_t size, int elems=1);
-      static Runtime* find_runtime(void);
-      static void trace_allocation(Runtime *&rt, AllocationType a, 
-                                   size_t size, int elems=1);
-      static void trace_free(Runtime *&rt, AllocationType a, 
-                             size_t size, int elems=1);
-    };
-
     // A Helper class for determining if we have an allocation type
     template<typename T>
     struct HasAllocType {
@@ -251,6 +235,113 @@ namespace Legion {
         (sizeof(test_for_alloc_type<Derived>(0)) == sizeof(yes));
     };
 
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+    /**
+     * \struct AllocationCounters
+     * The live bytes and live allocations of each kind of internal
+     * data structure as seen by one thread. Counters are always on so
+     * that the runtime can be asked at any point what is using its
+     * memory. A thread only ever updates its own counters so they need
+     * no synchronization; freeing memory allocated by another thread
+     * just drives the counters of the freeing thread negative. Counters
+     * are never deleted so the sums stay right after a thread exits.
+     */
+    struct AllocationCounters {
+    public:
+      long long bytes[LAST_ALLOC];
+      long long count[LAST_ALLOC];
+      AllocationCounters *next;
+    public:
+      static inline void record_allocation(AllocationType a, size_t size);
+      static inline void record_free(AllocationType a, size_t size);
+      // Sum the counters of every thread, the result is only a snapshot
+      // if other threads are still allocating (implementations in runtime.cc)
+      static void sum_counters(long long *bytes, long long *count);
+    protected:
+      static inline AllocationCounters* local_counters(void);
+      static AllocationCounters* register_thread(void);
+    protected:
+      static __thread AllocationCounters *local;
+      static AllocationCounters *all_counters;
+    };
+
+    //--------------------------------------------------------------------------
+    /*static*/ inline AllocationCounters* 
+                                      AllocationCounters::local_counters(void)
+    //--------------------------------------------------------------------------
+    {
+      AllocationCounters *result = local;
+      if (result == NULL)
+        result = register_thread();
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ inline void AllocationCounters::record_allocation(
+                                                  AllocationType a, size_t size)
+    //--------------------------------------------------------------------------
+    {
+      AllocationCounters *counters = local_counters();
+      counters->bytes[a] += size;
+      counters->count[a]++;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ inline void AllocationCounters::record_free(
+                                                  AllocationType a, size_t size)
+    //--------------------------------------------------------------------------
+    {
+      AllocationCounters *counters = local_counters();
+      counters->bytes[a] -= size;
+      counters->count[a]--;
+    }
+#endif
+
+    template<typename T, bool HAS_ALLOC_TYPE>
+    struct CountAllocation {
+      static inline void record_allocation(size_t size)
+      {
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+        AllocationCounters::record_allocation(T::alloc_type, size);
+#endif
+      }
+      static inline void record_free(size_t size)
+      {
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+        AllocationCounters::record_free(T::alloc_type, size);
+#endif
+      }
+    };
+
+    template<typename T>
+    struct CountAllocation<T,false> {
+      static inline void record_allocation(size_t size) { /*nothing*/ }
+      static inline void record_free(size_t size) { /*nothing*/ }
+    };
+
+#ifdef TRACE_ALLOCATION
+    // forward declaration of runtime
+    class Runtime;
+
+    enum SlabEventKind {
+      SLAB_CREATED_EVENT, // a new slab was allocated from the heap
+      SLAB_REFILL_EVENT, // a thread took a batch from the global pool
+      SLAB_RETURN_EVENT, // a thread gave a batch back to the global pool
+    };
+
+    // Implementations in runtime.cc
+    struct LegionAllocation {
+    public:
+      static void trace_allocation(AllocationType a, size_t size, int elems=1);
+      static void trace_free(AllocationType a, size_t size, int elems=1);
+      static Runtime* find_runtime(void);
+      static void trace_allocation(Runtime *&rt, AllocationType a, 
+                                   size_t size, int elems=1);
+      static void trace_free(Runtime *&rt, AllocationType a, 
+                             size_t size, int elems=1);
+      static void trace_slab(AllocationType a, SlabEventKind kind);
+    };
+
     template<typename T, bool HAS_ALLOC_TYPE>
     struct HandleAllocation {
       static inline void trace_allocation(void)
@@ -261,12 +352,17 @@ namespace Legion {
       {
         LegionAllocation::trace_free(T::alloc_type, sizeof(T));
       }
+      static inline void trace_slab(SlabEventKind kind)
+      {
+        LegionAllocation::trace_slab(T::alloc_type, kind);
+      }
     };
 
     template<typename T>
     struct HandleAllocation<T,false> {
       static inline void trace_allocation(void) { /*nothing*/ }
       static inline void trace_free(void) { /*nothing*/ }
+      static inline void trace_slab(SlabEventKind kind) { /*nothing*/ }
     };
 #endif
 
@@ -277,6 +373,9 @@ namespace Legion {
     {
 #ifdef TRACE_ALLOCATION
       LegionAllocation::trace_allocation(a, size);
+#endif
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+      AllocationCounters::record_allocation(a, size);
 #endif
       return malloc(size);
     }
@@ -290,6 +389,10 @@ namespace Legion {
       Runtime *rt = LegionAllocation::find_runtime(); 
       LegionAllocation::trace_free(rt, a, old_size);
       LegionAllocation::trace_allocation(rt, a, new_size);
+#endif
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+      AllocationCounters::record_free(a, old_size);
+      AllocationCounters::record_allocation(a, new_size);
 #endif
       return realloc(ptr, new_size);
     }
@@ -300,12 +403,147 @@ namespace Legion {
     {
 #ifdef TRACE_ALLOCATION
       LegionAllocation::trace_free(a, size);
+#endif
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+      AllocationCounters::record_free(a, size);
 #endif
       free(ptr);
     }
 
+    /**
+     * \class LegionSlabAllocator
+     * Hands out blocks for objects of type T from free lists kept
+     * per thread so that the small objects the runtime churns through
+     * (operations, views, version states, ...) rarely go to malloc.
+     * Blocks are carved out of slabs of LEGION_SLAB_BATCH_SIZE objects.
+     * A thread whose free list grows too long gives a batch of blocks
+     * back to a global pool for the other threads. Slabs are never
+     * returned to the heap. Types smaller than the free list header
+     * get blocks padded up to the size of the header.
+     */
+    template<typename T>
+    class LegionSlabAllocator {
+    public:
+      static inline void* allocate(void);
+      static inline void deallocate(void *ptr);
+    protected:
+      struct FreeBlock {
+        FreeBlock *next; // next block on the same free list
+        FreeBlock *next_batch; // next batch in the global pool
+      };
+      // Blocks have to be able to hold a FreeBlock while they are free,
+      // rounded up so that the FreeBlock in each of them stays aligned
+      // (this keeps the alignment of T since sizeof(T) is a multiple of it)
+      static const size_t BLOCK_SIZE =
+        (((sizeof(T) > sizeof(FreeBlock)) ? sizeof(T) : sizeof(FreeBlock)) +
+          sizeof(void*) - 1) / sizeof(void*) * sizeof(void*);
+      static inline void refill(void);
+      static inline void release_batch(void);
+    protected:
+      static __thread FreeBlock *local_blocks;
+      static __thread unsigned local_count;
+      static FreeBlock *global_batches;
+      static int global_lock;
+    };
+
+    template<typename T> __thread typename LegionSlabAllocator<T>::FreeBlock*
+      LegionSlabAllocator<T>::local_blocks = NULL;
+    template<typename T> __thread unsigned 
+      LegionSlabAllocator<T>::local_count = 0;
+    template<typename T> typename LegionSlabAllocator<T>::FreeBlock*
+      LegionSlabAllocator<T>::global_batches = NULL;
+    template<typename T> int LegionSlabAllocator<T>::global_lock = 0;
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void* LegionSlabAllocator<T>::allocate(void)
+    //--------------------------------------------------------------------------
+    {
+      if (local_blocks == NULL)
+        refill();
+      FreeBlock *result = local_blocks;
+      local_blocks = result->next;
+      local_count--;
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void LegionSlabAllocator<T>::deallocate(void *ptr)
+    //--------------------------------------------------------------------------
+    {
+      FreeBlock *block = static_cast<FreeBlock*>(ptr);
+      block->next = local_blocks;
+      local_blocks = block;
+      // Keep one batch around locally so that a thread going back and
+      // forth across the boundary doesn't keep hitting the global pool
+      if (++local_count == (2 * LEGION_SLAB_BATCH_SIZE))
+        release_batch();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void LegionSlabAllocator<T>::refill(void)
+    //--------------------------------------------------------------------------
+    {
+      while (__sync_lock_test_and_set(&global_lock, 1) != 0) { }
+      FreeBlock *batch = global_batches;
+      if (batch != NULL)
+        global_batches = batch->next_batch;
+      __sync_lock_release(&global_lock);
+      if (batch == NULL)
+      {
+        // Nothing in the pool, so thread a new slab into a batch
+        char *slab = static_cast<char*>(legion_alloc_aligned<BLOCK_SIZE,
+            AlignmentTrait<T>::AlignmentOf,false/*bytes*/>(
+              LEGION_SLAB_BATCH_SIZE));
+        batch = reinterpret_cast<FreeBlock*>(slab);
+        for (unsigned idx = 0; idx < (LEGION_SLAB_BATCH_SIZE-1); idx++)
+          reinterpret_cast<FreeBlock*>(slab + idx*BLOCK_SIZE)->next = 
+            reinterpret_cast<FreeBlock*>(slab + (idx+1)*BLOCK_SIZE);
+        reinterpret_cast<FreeBlock*>(
+            slab + (LEGION_SLAB_BATCH_SIZE-1)*BLOCK_SIZE)->next = NULL;
+#ifdef TRACE_ALLOCATION
+        HandleAllocation<T,HasAllocType<T>::value>::trace_slab(
+                                                    SLAB_CREATED_EVENT);
+#endif
+      }
+#ifdef TRACE_ALLOCATION
+      else
+        HandleAllocation<T,HasAllocType<T>::value>::trace_slab(
+                                                    SLAB_REFILL_EVENT);
+#endif
+      local_blocks = batch;
+      local_count = LEGION_SLAB_BATCH_SIZE;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    /*static*/ inline void LegionSlabAllocator<T>::release_batch(void)
+    //--------------------------------------------------------------------------
+    {
+      // Split the most recently freed blocks off into a batch
+      FreeBlock *batch = local_blocks;
+      FreeBlock *last = batch;
+      for (unsigned idx = 1; idx < LEGION_SLAB_BATCH_SIZE; idx++)
+        last = last->next;
+      local_blocks = last->next;
+      local_count -= LEGION_SLAB_BATCH_SIZE;
+      last->next = NULL;
+      while (__sync_lock_test_and_set(&global_lock, 1) != 0) { }
+      batch->next_batch = global_batches;
+      global_batches = batch;
+      __sync_lock_release(&global_lock);
+#ifdef TRACE_ALLOCATION
+      HandleAllocation<T,HasAllocType<T>::value>::trace_slab(
+                                                  SLAB_RETURN_EVENT);
+#endif
+    }
+
     // A class for Legion objects to inherit from to have their dynamic
-    // memory allocations managed for alignment and tracing
+    // memory allocations managed for alignment and tracing. Objects of
+    // exactly type T come from a LegionSlabAllocator unless the runtime
+    // is built with LEGION_DISABLE_SLAB_ALLOCATION.
     template<typename T>
     class LegionHeapify {
     public:
@@ -315,7 +553,7 @@ namespace Legion {
       static inline void* operator new(size_t count, void *ptr);
       static inline void* operator new[](size_t count, void *ptr);
     public:
-      static inline void operator delete(void *ptr);
+      static inline void operator delete(void *ptr, size_t size);
       static inline void operator delete[](void *ptr);
     public:
       static inline void operator delete(void *ptr, void *place);
@@ -329,6 +567,13 @@ namespace Legion {
     {
 #ifdef TRACE_ALLOCATION
       HandleAllocation<T,HasAllocType<T>::value>::trace_allocation();
+#endif
+      CountAllocation<T,HasAllocType<T>::value>::record_allocation(count);
+#ifndef LEGION_DISABLE_SLAB_ALLOCATION
+      // Types derived from T without their own heapify are bigger
+      // than T and have to come from the heap
+      if (count == sizeof(T))
+        return LegionSlabAllocator<T>::allocate();
 #endif
       return legion_alloc_aligned<T,true/*bytes*/>(count);  
     }
@@ -370,11 +615,22 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     template<typename T>
-    /*static*/ inline void LegionHeapify<T>::operator delete(void *ptr)
+    /*static*/ inline void LegionHeapify<T>::operator delete(void *ptr,
+                                                             size_t size)
     //--------------------------------------------------------------------------
     {
 #ifdef TRACE_ALLOCATION
       HandleAllocation<T,HasAllocType<T>::value>::trace_free();
+#endif
+      CountAllocation<T,HasAllocType<T>::value>::record_free(size);
+#ifndef LEGION_DISABLE_SLAB_ALLOCATION
+      // The size is that of the most derived type so it matches
+      // the size that this object was allocated with
+      if (size == sizeof(T))
+      {
+        LegionSlabAllocator<T>::deallocate(ptr);
+        return;
+      }
 #endif
       free(ptr);
     }
@@ -469,8 +725,8 @@ namespace Legion {
 
     /**
      * \class LegionAllocator
-     * A custom Legion allocator for tracing memory usage in STL
-     * data structures. When tracing is disabled, it defaults back
+     * A custom Legion allocator for tracing and counting memory usage
+     * in STL data structures. When tracing is disabled, it defaults back
      * to using the standard malloc/free and new/delete operations.
      */
     template<typename T, AllocationType A, bool ALIGNED>
@@ -519,12 +775,20 @@ namespace Legion {
                                     std::align_val_t(alignof(T))));
 #ifdef TRACE_ALLOCATION
         LegionAllocation::trace_allocation(runtime, A, sizeof(T), cnt);
+#endif
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+        if (A != LAST_ALLOC)
+          AllocationCounters::record_allocation(A, cnt * sizeof(T));
 #endif
         return result;
       }
       inline void deallocate(T *ptr, std::size_t size) { 
 #ifdef TRACE_ALLOCATION
         LegionAllocation::trace_free(runtime, A, sizeof(T), size);
+#endif
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+        if (A != LAST_ALLOC)
+          AllocationCounters::record_free(A, size * sizeof(T));
 #endif
         ::operator delete (ptr); 
       }
@@ -533,6 +797,10 @@ namespace Legion {
                       typename std::allocator<void>::const_pointer = 0) {
 #ifdef TRACE_ALLOCATION
         LegionAllocation::trace_allocation(runtime, A, sizeof(T), cnt);
+#endif
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+        if (A != LAST_ALLOC)
+          AllocationCounters::record_allocation(A, cnt * sizeof(T));
 #endif
         void *result;
         if (ALIGNED)
@@ -544,6 +812,10 @@ namespace Legion {
       inline void deallocate(pointer p, size_type size) {
 #ifdef TRACE_ALLOCATION
         LegionAllocation::trace_free(runtime, A, sizeof(T), size);
+#endif
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+        if (A != LAST_ALLOC)
+          AllocationCounters::record_free(A, size * sizeof(T));
 #endif
         free(p);
       }
@@ -1914,6 +1914,64 @@ namespace Legion {
       dirty_reduction = false;
     }
 
+    //--------------------------------------------------------------------------
+    bool ProjectionInfo::is_image_contained(ProjectionFunction *prev_projection,
+                                            IndexSpaceNode *prev_space) const
+    //--------------------------------------------------------------------------
+    {
+      // Only handle depth 0 projections from partitions where the
+      // image of each launch is a set of colors of the same partition
+      if ((projection_type != PART_PROJECTION) || (projection == NULL) ||
+          (prev_projection == NULL) || (projection->depth != 0) || 
+          (prev_projection->depth != 0))
+        return false;
+      if (projection_space->handle.get_type_tag() != 
+          prev_space->handle.get_type_tag())
+        return false;
+      Domain next_domain, prev_domain;
+      projection_space->get_launch_space_domain(next_domain);
+      prev_space->get_launch_space_domain(prev_domain);
+      if (!next_domain.dense() || !prev_domain.dense())
+        return false;
+      const int dim = next_domain.get_dim();
+      if ((dim < 1) || (dim != prev_domain.get_dim()))
+        return false;
+      coord_t next_transform[MAX_POINT_DIM*MAX_POINT_DIM];
+      coord_t prev_transform[MAX_POINT_DIM*MAX_POINT_DIM];
+      coord_t next_offset[MAX_POINT_DIM], prev_offset[MAX_POINT_DIM];
+      if (!projection->functor->get_affine_projection(dim, 
+                                          next_transform, next_offset) ||
+          !prev_projection->functor->get_affine_projection(dim,
+                                          prev_transform, prev_offset))
+        return false;
+      // With the same diagonal transform A the images are contained if
+      // there is an integer shift s with A*s = next_offset - prev_offset
+      // that moves the next launch domain inside the previous one
+      for (int i = 0; i < dim; i++)
+      {
+        for (int j = 0; j < dim; j++)
+        {
+          if (next_transform[i*dim + j] != prev_transform[i*dim + j])
+            return false;
+          if ((i != j) && (next_transform[i*dim + j] != 0))
+            return false;
+        }
+        const coord_t scale = next_transform[i*dim + i];
+        if (scale == 0)
+          return false;
+        const coord_t delta = next_offset[i] - prev_offset[i];
+        if ((delta % scale) != 0)
+          return false;
+        const coord_t shift = delta / scale;
+        if ((next_domain.rect_data[i] + shift) < prev_domain.rect_data[i])
+          return false;
+        if ((next_domain.rect_data[dim + i] + shift) > 
+            prev_domain.rect_data[dim + i])
+          return false;
+      }
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     void ProjectionInfo::pack_info(Serializer &rez) const
     //--------------------------------------------------------------------------
@@ -3644,7 +3702,7 @@ namespace Legion {
       // that this operation recorded dependences on above in the tree so we
       // don't run too early.
       LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned &above_users = 
-                                              current.op->get_logical_records();
+                                  current.op->get_logical_records(current.idx);
       if (normal_close_op != NULL)
       {
         LogicalUser normal_close_user(normal_close_op, 0/*idx*/, 
@@ -6415,6 +6473,7 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         , currently_active(true), currently_valid(true)
 #endif
+        , pending_requests(NULL)
     //--------------------------------------------------------------------------
     {
       // If we're not the owner then add a remove gc ref that will
@@ -6447,6 +6506,8 @@ namespace Legion {
         unregister_with_runtime(REFERENCE_VIRTUAL_CHANNEL);
       state_lock.destroy_reservation();
       state_lock = Reservation::NO_RESERVATION;
+      if (pending_requests != NULL)
+        delete pending_requests;
 #ifdef DEBUG_LEGION
       if (is_owner())
         assert(!currently_valid);
@@ -6924,8 +6985,10 @@ namespace Legion {
       if (is_owner())
       {
         // We are the owner node so see if we need to do any reequests
-        // to remote nodes to get our valid data
-        AutoLock s_lock(state_lock);
+        // to remote nodes to get our valid data, we only read our data
+        // structures here so the lock only needs to be in read-only mode
+        // so that analyses of different fields do not serialize here
+        AutoLock s_lock(state_lock,1,false/*exclusive*/);
         if (!remote_valid_instances.empty())
         {
           // We always have to request these from scratch for
@@ -6962,65 +7025,55 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(context != NULL);
 #endif
-      FieldMask needed_fields = request_mask;
       if (is_owner())
       {
         // We're the owner, if we have remote copies then send a 
-        // request to them for the needed fields
-        AutoLock s_lock(state_lock);
+        // request to them for the needed fields, we don't record
+        // anything so we only need the lock in read-only mode
+        AutoLock s_lock(state_lock,1,false/*exclusive*/);
         if (!remote_valid_instances.empty())
         {
-          for (LegionMap<RtEvent,FieldMask>::aligned::const_iterator it = 
-                initial_events.begin(); it != initial_events.end(); it++)
-          {
-            FieldMask overlap = it->second & needed_fields;
-            if (!overlap)
-              continue;
-            preconditions.insert(it->first);
-            needed_fields -= overlap;
-            if (!needed_fields)
-              return; 
-          }
+          FieldMask needed_fields = request_mask;
+          if (find_pending_requests(INITIAL_VERSION_REQUEST, needed_fields, 
+                                    preconditions))
+            return;
           // If we still have remaining fields, we have to send requests to
           // all the other nodes asking for their data
-          if (!!needed_fields)
-          {
-            std::set<RtEvent> local_preconditions;
-            RequestFunctor<INITIAL_VERSION_REQUEST> functor(this, context,
-                local_space, needed_fields, local_preconditions);
-            remote_valid_instances.map(functor);
-            RtEvent ready_event = Runtime::merge_events(local_preconditions);
-            preconditions.insert(ready_event);
-          }
+          std::set<RtEvent> local_preconditions;
+          RequestFunctor<INITIAL_VERSION_REQUEST> functor(this, context,
+              local_space, needed_fields, local_preconditions);
+          remote_valid_instances.map(functor);
+          RtEvent ready_event = Runtime::merge_events(local_preconditions);
+          preconditions.insert(ready_event);
         }
         // Otherwise no one has anything so we are done
       }
       else
       {
-        AutoLock s_lock(state_lock);
-        // Figure out which requests we haven't sent yet
-        for (LegionMap<RtEvent,FieldMask>::aligned::const_iterator it = 
-              initial_events.begin(); it != initial_events.end(); it++)
+        // In the common case the requests are already in flight so 
+        // check for that with the lock in read-only mode first
         {
-          FieldMask overlap = needed_fields & it->second;
-          if (!overlap)
-            continue;
-          preconditions.insert(it->first);
-          needed_fields -= overlap;
-          if (!needed_fields)
+          FieldMask needed_fields = request_mask;
+          AutoLock s_lock(state_lock,1,false/*exclusive*/);
+          if (find_pending_requests(INITIAL_VERSION_REQUEST, needed_fields,
+                                    preconditions))
             return;
         }
+        // Retake the lock in exclusive mode and check again in case 
+        // someone else sent the requests while we didn't hold it
+        FieldMask needed_fields = request_mask;
+        AutoLock s_lock(state_lock);
+        if (find_pending_requests(INITIAL_VERSION_REQUEST, needed_fields,
+                                  preconditions))
+          return;
         // If we still have remaining fields, make a new event and 
         // send a request to the intial owner
-        if (!!needed_fields)
-        {
-          RtUserEvent ready_event = Runtime::create_rt_user_event();
-          send_version_state_update_request(owner_space, context, local_space,
-              ready_event, needed_fields, INITIAL_VERSION_REQUEST);
-          // Save the event indicating when the fields will be ready
-          initial_events[ready_event] = needed_fields;
-          preconditions.insert(ready_event);
-        }
+        RtUserEvent ready_event = Runtime::create_rt_user_event();
+        send_version_state_update_request(owner_space, context, local_space,
+            ready_event, needed_fields, INITIAL_VERSION_REQUEST);
+        // Save the event indicating when the fields will be ready
+        get_pending_requests()->initial_events[ready_event] = needed_fields;
+        preconditions.insert(ready_event);
       }
     }
 
@@ -7033,70 +7086,82 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(context != NULL);
 #endif
+      // In the common case there is nothing to request or the requests
+      // are already in flight so check for that with the lock in 
+      // read-only mode before we try to take it exclusively
+      {
+        AutoLock s_lock(state_lock,1,false/*exclusive*/);
+        // If we're the owner and the only copy there is nothing to do
+        if (is_owner() && remote_valid_instances.empty())
+          return;
+        FieldMask remaining_mask = req_mask;
+        if (find_pending_requests(FINAL_VERSION_REQUEST, remaining_mask, preconditions))
+          return;
+      }
+      // Retake the lock in exclusive mode and check again in case 
+      // someone else sent the requests while we didn't hold it
+      FieldMask remaining_mask = req_mask;
+      AutoLock s_lock(state_lock);
+      if (find_pending_requests(FINAL_VERSION_REQUEST, remaining_mask, preconditions))
+        return;
       if (is_owner())
       {
-        // We are the owner node so see if we need to do any reequests
-        // to remote nodes to get our valid data
-        AutoLock s_lock(state_lock);
-        if (!remote_valid_instances.empty())
-        {
-          // Figure out which fields we need to request
-          FieldMask remaining_mask = req_mask;
-          for (LegionMap<RtEvent,FieldMask>::aligned::const_iterator it = 
-                final_events.begin(); it != final_events.end(); it++)
-          {
-            FieldMask overlap = it->second & remaining_mask;
-            if (!overlap)
-              continue;
-            preconditions.insert(it->first);
-            remaining_mask -= overlap;
-            if (!remaining_mask)
-              return; 
-          }
-          // If we still have remaining fields, we have to send requests to
-          // all the other nodes asking for their data
-          if (!!remaining_mask)
-          {
-            std::set<RtEvent> local_preconditions;
-            RequestFunctor<FINAL_VERSION_REQUEST> functor(this, context,
-                local_space, remaining_mask, local_preconditions);
-            remote_valid_instances.map(functor);
-            RtEvent ready_event = Runtime::merge_events(local_preconditions);
-            final_events[ready_event] = remaining_mask;
-            preconditions.insert(ready_event);
-          }
-        }
-        // otherwise we're the only copy so there is nothing to do
+        if (remote_valid_instances.empty())
+          return;
+        // We are the owner node so we have to send requests to
+        // all the other nodes asking for their data
+        std::set<RtEvent> local_preconditions;
+        RequestFunctor<FINAL_VERSION_REQUEST> functor(this, context,
+            local_space, remaining_mask, local_preconditions);
+        remote_valid_instances.map(functor);
+        RtEvent ready_event = Runtime::merge_events(local_preconditions);
+        get_pending_requests()->final_events[ready_event] = remaining_mask;
+        preconditions.insert(ready_event);
       }
       else
       {
-        FieldMask remaining_mask = req_mask;
-        // We are not the owner so figure out which fields we still need to
-        // send a request for
-        AutoLock s_lock(state_lock); 
-        for (LegionMap<RtEvent,FieldMask>::aligned::const_iterator it = 
-              final_events.begin(); it != final_events.end(); it++)
-        {
-          FieldMask overlap = it->second & remaining_mask;
-          if (!overlap)
-            continue;
-          preconditions.insert(it->first);
-          remaining_mask -= overlap;
-          if (!remaining_mask)
-            return;
-        }
-        if (!!remaining_mask)
-        {
-          RtUserEvent ready_event = Runtime::create_rt_user_event();
-          send_version_state_update_request(owner_space, context, local_space,
-              ready_event, remaining_mask, FINAL_VERSION_REQUEST);
-          // Save the event indicating when the fields will be ready
-          final_events[ready_event] = remaining_mask;
-          preconditions.insert(ready_event);
-        }
+        // We are not the owner so send a request for the fields
+        // we still need to the owner
+        RtUserEvent ready_event = Runtime::create_rt_user_event();
+        send_version_state_update_request(owner_space, context, local_space,
+            ready_event, remaining_mask, FINAL_VERSION_REQUEST);
+        // Save the event indicating when the fields will be ready
+        get_pending_requests()->final_events[ready_event] = remaining_mask;
+        preconditions.insert(ready_event);
       }
     }
 
+    //--------------------------------------------------------------------------
+    bool VersionState::find_pending_requests(VersionRequestKind request_kind,
+                                             FieldMask &needed_fields, 
+                                         std::set<RtEvent> &preconditions) const
+    //--------------------------------------------------------------------------
+    {
+      if (!needed_fields)
+        return true;
+      if (pending_requests == NULL)
+        return false;
+#ifdef DEBUG_LEGION
+      assert((request_kind == INITIAL_VERSION_REQUEST) ||
+             (request_kind == FINAL_VERSION_REQUEST));
+#endif
+      const LegionMap<RtEvent,FieldMask>::aligned &pending = 
+        (request_kind == INITIAL_VERSION_REQUEST) ?
+          pending_requests->initial_events : pending_requests->final_events;
+      for (LegionMap<RtEvent,FieldMask>::aligned::const_iterator it = 
+            pending.begin(); it != pending.end(); it++)
+      {
+        const FieldMask overlap = it->second & needed_fields;
+        if (!overlap)
+          continue;
+        preconditions.insert(it->first);
+        needed_fields -= overlap;
+        if (!needed_fields)
+          return true;
+      }
+      return false;
+    }
+
     //--------------------------------------------------------------------------
     void VersionState::send_version_state_update(AddressSpaceID target,
                                                 InnerContext *context,
@@ -7836,6 +7901,9 @@ namespace Legion {
             RtEvent ready;
             PhysicalManager *manager = 
               runtime->find_or_request_physical_manager(manager_did, ready);
+            LegionMap<PhysicalManager*,
+              std::pair<RtEvent,FieldMask> >::aligned &pending_instances = 
+                get_pending_requests()->pending_instances;
             LegionMap<PhysicalManager*,
               std::pair<RtEvent,FieldMask> >::aligned::iterator finder = 
                 pending_instances.find(manager);
@@ -8064,6 +8132,12 @@ namespace Legion {
 #endif
       InstanceView *view = logical_node->convert_manager(manager, context);
       AutoLock s_lock(state_lock);
+#ifdef DEBUG_LEGION
+      assert(pending_requests != NULL);
+#endif
+      LegionMap<PhysicalManager*,
+                std::pair<RtEvent,FieldMask> >::aligned &pending_instances = 
+                  pending_requests->pending_instances;
       LegionMap<PhysicalManager*,
                 std::pair<RtEvent,FieldMask> >::aligned::iterator finder = 
                   pending_instances.find(manager);
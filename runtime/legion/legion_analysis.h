@@ -411,6 +411,10 @@ namespace Legion {
       void record_projection_epoch(ProjectionEpochID epoch,
                                    const FieldMask &epoch_mask);
       void clear(void);
+      // Prove symbolically that every child this projection touches was 
+      // also touched by a previous projection over a launch space
+      bool is_image_contained(ProjectionFunction *prev_projection,
+                              IndexSpaceNode *prev_space) const;
     public:
       void pack_info(Serializer &rez) const;
       void unpack_info(Deserializer &derez, Runtime *runtime,
@@ -1151,6 +1155,17 @@ namespace Legion {
         const FieldMask &mask;
         std::set<RtEvent> &preconditions;
       };
+      // Bookkeeping for in-flight requests between copies of a version
+      // state, most version states never see any remote traffic so this
+      // is only allocated the first time it is needed
+      struct PendingRequests : public LegionHeapify<PendingRequests> {
+      public:
+        // Track when we have valid data for initial and final fields
+        LegionMap<RtEvent,FieldMask>::aligned initial_events;
+        LegionMap<RtEvent,FieldMask>::aligned final_events;
+        LegionMap<PhysicalManager*,
+                  std::pair<RtEvent,FieldMask> >::aligned pending_instances;
+      };
     public:
       VersionState(VersionID vid, Runtime *rt, DistributedID did,
                    AddressSpaceID owner_space, 
@@ -1206,6 +1221,17 @@ namespace Legion {
       void request_final_version_state(InnerContext *context,
                                        const FieldMask &request_mask,
                                        std::set<RtEvent> &preconditions);
+    protected:
+      // Record the preconditions of any requests already in flight for
+      // the needed fields and remove them, returns true if none remain
+      bool find_pending_requests(VersionRequestKind request_kind,
+                                 FieldMask &needed_fields, 
+                                 std::set<RtEvent> &preconditions) const;
+      // Must be called while holding the state lock in exclusive mode
+      inline PendingRequests* get_pending_requests(void)
+        { if (pending_requests == NULL) 
+            pending_requests = new PendingRequests();
+          return pending_requests; }
     public:
       void send_version_state_update(AddressSpaceID target,
                                      InnerContext *context,
@@ -1290,18 +1316,13 @@ namespace Legion {
     protected:
       // Fields which we have applied updates to
       FieldMask update_fields;
-      // Track when we have valid data for initial and final fields
-      LegionMap<RtEvent,FieldMask>::aligned initial_events;
-      LegionMap<RtEvent,FieldMask>::aligned final_events;
+      PendingRequests *pending_requests;
     protected:
       // Track which nodes we have remote data, note that this only 
       // tracks nodes which have either done a 'merge_physical_state'
       // or 'reduce_open_children' and not nodes that have final 
       // states but haven't contributed any data
       NodeSet remote_valid_instances;
-    protected:
-      LegionMap<PhysicalManager*,
-                std::pair<RtEvent,FieldMask> >::aligned pending_instances;
     };
 
     /**
@@ -1707,6 +1707,29 @@ legion_field_allocator_free_field(legion_field_allocator_t allocator_,
   allocator->free_field(fid);
 }
 
+void
+legion_field_allocator_allocate_fields(legion_field_allocator_t allocator_,
+                                       const size_t *field_sizes_,
+                                       legion_field_id_t *field_ids_,
+                                       size_t num_fields)
+{
+  FieldAllocator *allocator = CObjectWrapper::unwrap(allocator_);
+  std::vector<size_t> field_sizes(field_sizes_, field_sizes_ + num_fields);
+  std::vector<FieldID> field_ids(field_ids_, field_ids_ + num_fields);
+  allocator->allocate_fields(field_sizes, field_ids);
+  std::copy(field_ids.begin(), field_ids.end(), field_ids_);
+}
+
+void
+legion_field_allocator_free_fields(legion_field_allocator_t allocator_,
+                                   const legion_field_id_t *fields_,
+                                   size_t num_fields)
+{
+  FieldAllocator *allocator = CObjectWrapper::unwrap(allocator_);
+  std::set<FieldID> fields(fields_, fields_ + num_fields);
+  allocator->free_fields(fields);
+}
+
 legion_field_id_t
 legion_field_allocator_allocate_local_field(legion_field_allocator_t allocator_,
                                             size_t field_size,
@@ -2078,6 +2101,33 @@ legion_task_launcher_execute(legion_runtime_t runtime_,
   return CObjectWrapper::wrap(new Future(f));
 }
 
+void
+legion_task_launcher_execute_batch(legion_runtime_t runtime_,
+                                   legion_context_t ctx_,
+                                   const legion_task_launch_desc_t *launches,
+                                   size_t num_launches,
+                                   legion_future_t *futures /* = NULL */)
+{
+  Runtime *runtime = CObjectWrapper::unwrap(runtime_);
+  Context ctx = CObjectWrapper::unwrap(ctx_)->context();
+
+  for (size_t i = 0; i < num_launches; i++) {
+    const legion_task_launch_desc_t &desc = launches[i];
+    TaskLauncher *launcher = CObjectWrapper::unwrap(desc.launcher);
+    if (desc.arg.args != NULL)
+      launcher->argument = CObjectWrapper::unwrap(desc.arg);
+    assert(desc.num_regions <= launcher->region_requirements.size());
+    for (size_t r = 0; r < desc.num_regions; r++)
+      launcher->region_requirements[r].region =
+        CObjectWrapper::unwrap(desc.regions[r]);
+
+    Future f = runtime->execute_task(ctx, *launcher);
+    // Only pay for wrapping the future if the caller wants it
+    if (futures != NULL)
+      futures[i] = CObjectWrapper::wrap(new Future(f));
+  }
+}
+
 unsigned
 legion_task_launcher_add_region_requirement_logical_region(
   legion_task_launcher_t launcher_,
@@ -2239,6 +2289,26 @@ legion_index_launcher_execute(legion_runtime_t runtime_,
   return CObjectWrapper::wrap(new FutureMap(f));
 }
 
+void
+legion_index_launcher_execute_batch(legion_runtime_t runtime_,
+                                    legion_context_t ctx_,
+                                    const legion_index_launcher_t *launchers,
+                                    size_t num_launchers,
+                                    legion_future_map_t *future_maps
+                                      /* = NULL */)
+{
+  Runtime *runtime = CObjectWrapper::unwrap(runtime_);
+  Context ctx = CObjectWrapper::unwrap(ctx_)->context();
+
+  for (size_t i = 0; i < num_launchers; i++) {
+    IndexTaskLauncher *launcher = CObjectWrapper::unwrap(launchers[i]);
+
+    FutureMap f = runtime->execute_index_space(ctx, *launcher);
+    if (future_maps != NULL)
+      future_maps[i] = CObjectWrapper::wrap(new FutureMap(f));
+  }
+}
+
 legion_future_t
 legion_index_launcher_execute_reduction(legion_runtime_t runtime_,
                                         legion_context_t ctx_,
@@ -2550,6 +2620,28 @@ legion_runtime_fill_field_future(
   runtime->fill_field(ctx, handle, parent, fid, *f, *pred);
 }
 
+void
+legion_runtime_fill_field_batch(
+  legion_runtime_t runtime_,
+  legion_context_t ctx_,
+  const legion_fill_field_desc_t *fills,
+  size_t num_fills,
+  legion_predicate_t pred_ /* = legion_predicate_true() */)
+{
+  Runtime *runtime = CObjectWrapper::unwrap(runtime_);
+  Context ctx = CObjectWrapper::unwrap(ctx_)->context();
+  Predicate *pred = CObjectWrapper::unwrap(pred_);
+
+  for (size_t i = 0; i < num_fills; i++) {
+    const legion_fill_field_desc_t &fill = fills[i];
+    LogicalRegion handle = CObjectWrapper::unwrap(fill.handle);
+    LogicalRegion parent = CObjectWrapper::unwrap(fill.parent);
+
+    runtime->fill_field(ctx, handle, parent, fill.fid,
+                        fill.value, fill.value_size, *pred);
+  }
+}
+
 // -----------------------------------------------------------------------
 // File Operations
 // -----------------------------------------------------------------------
@@ -2655,6 +2747,22 @@ legion_copy_launcher_execute(legion_runtime_t runtime_,
   runtime->issue_copy_operation(ctx, *launcher);
 }
 
+void
+legion_copy_launcher_execute_batch(legion_runtime_t runtime_,
+                                   legion_context_t ctx_,
+                                   const legion_copy_launcher_t *launchers,
+                                   size_t num_launchers)
+{
+  Runtime *runtime = CObjectWrapper::unwrap(runtime_);
+  Context ctx = CObjectWrapper::unwrap(ctx_)->context();
+
+  for (size_t i = 0; i < num_launchers; i++) {
+    CopyLauncher *launcher = CObjectWrapper::unwrap(launchers[i]);
+
+    runtime->issue_copy_operation(ctx, *launcher);
+  }
+}
+
 unsigned
 legion_copy_launcher_add_src_region_requirement_logical_region(
   legion_copy_launcher_t launcher_,
@@ -4351,6 +4459,79 @@ legion_runtime_register_projection_functor(
   runtime->register_projection_functor(id, functor);
 }
 
+class AffineFunctorWrapper : public ProjectionFunctor {
+public:
+  AffineFunctorWrapper(int d, const coord_t *trans, const coord_t *off)
+    : ProjectionFunctor()
+    , dim(d)
+    , transform(trans, trans + d * d)
+    , offset(off, off + d)
+  {
+  }
+
+  LogicalRegion project(const Mappable *mappable, unsigned index,
+                        LogicalRegion upper_bound,
+                        const DomainPoint &point)
+  {
+    // Depth 0 functors leave region upper bounds alone
+    return upper_bound;
+  }
+
+  LogicalRegion project(const Mappable *mappable, unsigned index,
+                        LogicalPartition upper_bound,
+                        const DomainPoint &point)
+  {
+    assert(point.get_dim() == dim);
+    DomainPoint color;
+    color.dim = dim;
+    for (int i = 0; i < dim; i++) {
+      coord_t value = offset[i];
+      for (int j = 0; j < dim; j++)
+        value += transform[i * dim + j] * point[j];
+      color[i] = value;
+    }
+    return runtime->get_logical_subregion_by_color(upper_bound, color);
+  }
+
+  bool is_exclusive(void) const { return true; }
+
+  bool is_functional(void) const { return true; }
+
+  bool get_affine_projection(int d, coord_t *trans, coord_t *off) const
+  {
+    if (d != dim)
+      return false;
+    std::copy(transform.begin(), transform.end(), trans);
+    std::copy(offset.begin(), offset.end(), off);
+    return true;
+  }
+
+  unsigned get_depth(void) const { return 0; }
+
+private:
+  const int dim;
+  const std::vector<coord_t> transform;
+  const std::vector<coord_t> offset;
+};
+
+legion_projection_id_t
+legion_runtime_generate_static_projection_id(void)
+{
+  return Runtime::generate_static_projection_id();
+}
+
+void
+legion_runtime_preregister_affine_projection_functor(
+  legion_projection_id_t id,
+  int dim,
+  const coord_t *transform,
+  const coord_t *offset)
+{
+  AffineFunctorWrapper *functor =
+    new AffineFunctorWrapper(dim, transform, offset);
+  Runtime::preregister_projection_functor(id, functor);
+}
+
 // -----------------------------------------------------------------------
 // Timing Operations
 // -----------------------------------------------------------------------
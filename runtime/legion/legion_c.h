@@ -279,6 +279,37 @@ extern "C" {
     legion_domain_t domain;
   } legion_slice_task_input_t;
 
+  /**
+   * A packed descriptor for one launch in a batch of task launches.
+   * The launcher is used as a template for the launch: if 'arg.args'
+   * is not NULL it replaces the argument of the launcher, and the
+   * first 'num_regions' region requirements of the launcher are
+   * pointed at the logical regions in 'regions' while keeping their
+   * privileges, parents and fields. The launcher keeps the values
+   * from the last launch that used it.
+   *
+   * @see legion_task_launcher_execute_batch()
+   */
+  typedef struct legion_task_launch_desc_t {
+    legion_task_launcher_t launcher;
+    legion_task_argument_t arg;
+    const legion_logical_region_t *regions;
+    size_t num_regions;
+  } legion_task_launch_desc_t;
+
+  /**
+   * A packed descriptor for one fill in a batch of fill operations.
+   *
+   * @see legion_runtime_fill_field_batch()
+   */
+  typedef struct legion_fill_field_desc_t {
+    legion_logical_region_t handle;
+    legion_logical_region_t parent;
+    legion_field_id_t fid;
+    const void *value;
+    size_t value_size;
+  } legion_fill_field_desc_t;
+
   /**
    * Interface for a Legion C registration callback.
    */
@@ -1540,6 +1571,26 @@ extern "C" {
   legion_field_allocator_free_field(legion_field_allocator_t allocator,
                                     legion_field_id_t fid);
 
+  /**
+   * @param field_ids Array of length `num_fields`. Entries equal to
+   *   AUTO_GENERATE_ID are replaced with the allocated field IDs.
+   *
+   * @see Legion::FieldAllocator::allocate_fields()
+   */
+  void
+  legion_field_allocator_allocate_fields(legion_field_allocator_t allocator,
+                                         const size_t *field_sizes,
+                                         legion_field_id_t *field_ids,
+                                         size_t num_fields);
+
+  /**
+   * @see Legion::FieldAllocator::free_fields()
+   */
+  void
+  legion_field_allocator_free_fields(legion_field_allocator_t allocator,
+                                     const legion_field_id_t *fields,
+                                     size_t num_fields);
+
   /**
    * @see Legion::FieldAllocator::allocate_local_field()
    */
@@ -1857,6 +1908,22 @@ extern "C" {
                                legion_context_t ctx,
                                legion_task_launcher_t launcher);
 
+  /**
+   * Issue a batch of task launches in a single call. If 'futures' is
+   * not NULL it must have room for 'num_launches' entries and the
+   * caller takes ownership of the futures written into it, otherwise
+   * the futures of the launches are not returned.
+   *
+   * @see legion_task_launch_desc_t
+   * @see Legion::Runtime::execute_task()
+   */
+  void
+  legion_task_launcher_execute_batch(legion_runtime_t runtime,
+                                     legion_context_t ctx,
+                                     const legion_task_launch_desc_t *launches,
+                                     size_t num_launches,
+                                     legion_future_t *futures /* = NULL */);
+
   /**
    * @see Legion::TaskLauncher::add_region_requirement()
    */
@@ -1974,6 +2041,22 @@ extern "C" {
                                legion_context_t ctx,
                                legion_index_launcher_t launcher);
 
+  /**
+   * Issue a batch of index space launches in a single call. If
+   * 'future_maps' is not NULL it must have room for 'num_launchers'
+   * entries and the caller takes ownership of the future maps written
+   * into it.
+   *
+   * @see Legion::Runtime::execute_index_space(Context, const IndexTaskLauncher &)
+   */
+  void
+  legion_index_launcher_execute_batch(legion_runtime_t runtime,
+                                      legion_context_t ctx,
+                                      const legion_index_launcher_t *launchers,
+                                      size_t num_launchers,
+                                      legion_future_map_t *future_maps
+                                        /* = NULL */);
+
   /**
    * @return Caller takes ownership of return value.
    *
@@ -2198,6 +2281,20 @@ extern "C" {
     legion_future_t f,
     legion_predicate_t pred /* = legion_predicate_true() */);
 
+  /**
+   * Issue a batch of fill operations in a single call.
+   *
+   * @see legion_fill_field_desc_t
+   * @see Legion::Runtime::fill_field()
+   */
+  void
+  legion_runtime_fill_field_batch(
+    legion_runtime_t runtime,
+    legion_context_t ctx,
+    const legion_fill_field_desc_t *fills,
+    size_t num_fills,
+    legion_predicate_t pred /* = legion_predicate_true() */);
+
   // -----------------------------------------------------------------------
   // File Operations
   // -----------------------------------------------------------------------
@@ -2276,6 +2373,17 @@ extern "C" {
                                legion_context_t ctx,
                                legion_copy_launcher_t launcher);
 
+  /**
+   * Issue a batch of copy operations in a single call.
+   *
+   * @see Legion::Runtime::issue_copy_operation()
+   */
+  void
+  legion_copy_launcher_execute_batch(legion_runtime_t runtime,
+                                     legion_context_t ctx,
+                                     const legion_copy_launcher_t *launchers,
+                                     size_t num_launchers);
+
   /**
    * @see Legion::CopyLauncher::add_copy_requirements()
    */
@@ -3368,6 +3476,33 @@ extern "C" {
     legion_projection_functor_logical_region_t region_functor,
     legion_projection_functor_logical_partition_t partition_functor);
 
+  /**
+   * @see Legion::Runtime::generate_static_projection_id()
+   */
+  legion_projection_id_t
+  legion_runtime_generate_static_projection_id(void);
+
+  /**
+   * Preregister a projection functor that maps the points of an index
+   * space launch to the subregions of a partition with the colors
+   *   color = transform * point + offset
+   * Since the runtime is told that the functor is affine it can analyze
+   * launches using it without projecting the points one at a time.
+   *
+   * @param dim the number of dimensions of the points and colors
+   * @param transform row-major dim x dim matrix (copied)
+   * @param offset vector of dim elements (copied)
+   *
+   * @see Legion::Runtime::preregister_projection_functor()
+   * @see Legion::ProjectionFunctor::get_affine_projection()
+   */
+  void
+  legion_runtime_preregister_affine_projection_functor(
+    legion_projection_id_t id,
+    int dim,
+    const coord_t *transform,
+    const coord_t *offset);
+
   // -----------------------------------------------------------------------
   // Timing Operations
   // -----------------------------------------------------------------------
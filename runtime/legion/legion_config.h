@@ -59,6 +59,12 @@
 #define MAX_FIELDS         512 // must be a power of 2
 #endif
 
+// Number of 64-bit words that field masks use to store small sets of
+// fields inline when building with LEGION_SPARSE_FIELD_MASKS
+#ifndef LEGION_SPARSE_FIELD_MASK_WORDS
+#define LEGION_SPARSE_FIELD_MASK_WORDS  2
+#endif
+
 // Some default values
 
 // The maximum number of nodes to be run on
@@ -107,10 +113,64 @@
 #ifndef DEFAULT_TASK_WINDOW_HYSTERESIS
 #define DEFAULT_TASK_WINDOW_HYSTERESIS  75
 #endif
+// Default bounds on the size of the task window when it is
+// being sized adaptively by the runtime (-lg:window_adaptive)
+#ifndef LEGION_ADAPTIVE_WINDOW_MIN
+#define LEGION_ADAPTIVE_WINDOW_MIN      64
+#endif
+#ifndef LEGION_ADAPTIVE_WINDOW_MAX
+#define LEGION_ADAPTIVE_WINDOW_MAX      (16 * DEFAULT_MAX_TASK_WINDOW)
+#endif
+// How many child operations have to map between adjustments
+// of an adaptive task window
+#ifndef LEGION_ADAPTIVE_WINDOW_PERIOD
+#define LEGION_ADAPTIVE_WINDOW_PERIOD   256
+#endif
+// An adaptive task window shrinks when child operations take
+// this many times longer to map than the fastest observed
+#ifndef LEGION_ADAPTIVE_WINDOW_LATENCY_FACTOR
+#define LEGION_ADAPTIVE_WINDOW_LATENCY_FACTOR 4
+#endif
+// Number of objects in each slab allocated for the per-thread free
+// lists behind LegionHeapify, which is also the number of objects that
+// move between a thread's free list and the global pool at a time
+#ifndef LEGION_SLAB_BATCH_SIZE
+#define LEGION_SLAB_BATCH_SIZE          64
+#endif
+// Default size of the first chunk of a Serializer buffer, each later
+// chunk is twice as large as the one before it
+#ifndef LEGION_SERIALIZER_CHUNK_SIZE
+#define LEGION_SERIALIZER_CHUNK_SIZE    4096
+#endif
+// Number of default sized Serializer chunks each thread keeps around
+// for reuse instead of returning them to the heap
+#ifndef LEGION_SERIALIZER_CACHED_CHUNKS
+#define LEGION_SERIALIZER_CACHED_CHUNKS 8
+#endif
+// Buffers at least this large that are serialized with
+// Serializer::serialize_external are referenced in place rather
+// than being copied into the Serializer's own chunks
+#ifndef LEGION_SERIALIZER_EXTERNAL_BYTES
+#define LEGION_SERIALIZER_EXTERNAL_BYTES 16384
+#endif
+// Number of distributed IDs that a thread reserves from the runtime
+// at a time, and the most recycled distributed IDs a thread will hold
+// before it hands half of them back to the runtime for other threads
+#ifndef LEGION_DISTRIBUTED_ID_BLOCK
+#define LEGION_DISTRIBUTED_ID_BLOCK     64
+#endif
+#ifndef LEGION_DISTRIBUTED_ID_CACHE
+#define LEGION_DISTRIBUTED_ID_CACHE     64
+#endif
 // How many tasks to group together for runtime operations
 #ifndef DEFAULT_MIN_TASKS_TO_SCHEDULE
 #define DEFAULT_MIN_TASKS_TO_SCHEDULE   32
 #endif
+// The shortest repeating sequence of operations that the runtime
+// will turn into a trace when detecting traces automatically
+#ifndef DEFAULT_MIN_AUTO_TRACE_LENGTH
+#define DEFAULT_MIN_AUTO_TRACE_LENGTH   2
+#endif
 // The maximum size of active messages sent by the runtime in bytes
 // Note this value was picked based on making a tradeoff between
 // latency and bandwidth numbers on both Cray and Infiniband
@@ -118,6 +178,21 @@
 #ifndef DEFAULT_MAX_MESSAGE_SIZE
 #define DEFAULT_MAX_MESSAGE_SIZE        16384
 #endif
+// The longest time in microseconds that a virtual channel will hold
+// on to small messages that asked to be flushed in order to aggregate
+// them with later messages, zero disables aggregation
+#ifndef LEGION_DEFAULT_MESSAGE_WINDOW
+#define LEGION_DEFAULT_MESSAGE_WINDOW   0
+#endif
+// Future values up to this many bytes are stored inside the future
+// itself rather than in a separate heap allocation
+#ifndef LEGION_FUTURE_INLINE_SIZE
+#define LEGION_FUTURE_INLINE_SIZE       16
+#endif
+// Messages up to this size in bytes may be held back for aggregation
+#ifndef LEGION_SMALL_MESSAGE_SIZE
+#define LEGION_SMALL_MESSAGE_SIZE       1024
+#endif
 // Timeout before checking for whether a logical user
 // should be pruned from the logical region tree data strucutre
 // Making the value less than or equal to zero will
@@ -125,6 +200,12 @@
 #ifndef DEFAULT_LOGICAL_USER_TIMEOUT
 #define DEFAULT_LOGICAL_USER_TIMEOUT    32
 #endif
+// Number of events with users that a materialized view can
+// accumulate before it sweeps out the users whose events have
+// already triggered (the threshold grows with the live users)
+#ifndef DEFAULT_PHYSICAL_USER_COMPACTION
+#define DEFAULT_PHYSICAL_USER_COMPACTION 64
+#endif
 // Number of events to place in each GC epoch
 // Large counts improve efficiency but add latency to
 // garbage collection.  Smaller count reduce efficiency
@@ -132,6 +213,56 @@
 #ifndef DEFAULT_GC_EPOCH_SIZE
 #define DEFAULT_GC_EPOCH_SIZE           64
 #endif
+// Microseconds that the storage of a collected instance is kept
+// around for reuse by a new instance with the same layout, zero
+// disables recycling of instances
+#ifndef DEFAULT_INSTANCE_RECYCLE_WINDOW
+#define DEFAULT_INSTANCE_RECYCLE_WINDOW 0
+#endif
+// Maximum number of views collected by each deferred collection
+// meta-task that a GC epoch launches
+#ifndef LEGION_GC_COLLECT_BATCH_SIZE
+#define LEGION_GC_COLLECT_BATCH_SIZE    256
+#endif
+// Percentage of a memory's capacity at which the runtime starts
+// eagerly collecting instances in the background, zero disables it
+#ifndef DEFAULT_GC_HIGH_WATER_MARK
+#define DEFAULT_GC_HIGH_WATER_MARK      0
+#endif
+// Percentage below the high-water mark to collect down to
+#ifndef LEGION_EAGER_GC_HYSTERESIS
+#define LEGION_EAGER_GC_HYSTERESIS      10
+#endif
+// Maximum number of ready tasks handed to a mapper in a single
+// map_tasks call, zero or one disables batching of map_task calls
+#ifndef DEFAULT_MAP_TASK_BATCH_SIZE
+#define DEFAULT_MAP_TASK_BATCH_SIZE     0
+#endif
+// Number of power-of-two nanosecond buckets in the histograms
+// of mapper call latencies recorded with -lg:mapper_stats
+#ifndef LEGION_MAPPER_CALL_HISTOGRAM_BUCKETS
+#define LEGION_MAPPER_CALL_HISTOGRAM_BUCKETS 48
+#endif
+// Size in bytes of each of the two buffers that the binary profiling
+// serializer fills while its background thread writes out the other
+#ifndef LEGION_PROF_OUTPUT_BUFFER_SIZE
+#define LEGION_PROF_OUTPUT_BUFFER_SIZE  (4 << 20)
+#endif
+// Size in bytes at which a chunk of records in a binary profiling
+// log is written out and recorded in the log's index
+#ifndef LEGION_PROF_CHUNK_SIZE
+#define LEGION_PROF_CHUNK_SIZE          (1 << 20)
+#endif
+// Compression level (1-9) of binary profiling logs when built with
+// zlib, the fastest level keeps up with the profiling output stream
+#ifndef LEGION_PROF_COMPRESSION_LEVEL
+#define LEGION_PROF_COMPRESSION_LEVEL   1
+#endif
+// Size in bytes of the buffer in which binary Legion Spy records
+// are accumulated before being written to the log file
+#ifndef LEGION_SPY_OUTPUT_BUFFER_SIZE
+#define LEGION_SPY_OUTPUT_BUFFER_SIZE   (1 << 20)
+#endif
 
 // Used for debugging memory leaks
 // How often tracing information is dumped
@@ -174,11 +305,27 @@
 #define LEGION_SHUTDOWN_RADIX             8
 #endif
 
+// The radix for the tree used to send the slices
+// of an index space task launch out to remote nodes
+#ifndef LEGION_SLICE_DISTRIBUTION_RADIX
+#define LEGION_SLICE_DISTRIBUTION_RADIX   8
+#endif
+
 // Maximum depth of composite instances before warnings
 #ifndef LEGION_PRUNE_DEPTH_WARNING
 #define LEGION_PRUNE_DEPTH_WARNING        8
 #endif
 
+// Maximum number of copy plans memoized by each composite view
+#ifndef LEGION_MAX_COMPOSITE_COPY_PLANS
+#define LEGION_MAX_COMPOSITE_COPY_PLANS   16
+#endif
+
+// Maximum number of collected instances held for recycling per memory
+#ifndef LEGION_MAX_RECYCLED_INSTANCES
+#define LEGION_MAX_RECYCLED_INSTANCES     32
+#endif
+
 // Some helper macros
 
 // This statically computes an integer log base 2 for a number
@@ -546,6 +693,7 @@ typedef enum legion_error_t {
   ERROR_ILLEGAL_LAYOUT_CONSTRAINT = 543,
   ERROR_UNSUPPORTED_LAYOUT_CONSTRAINT = 544,
   ERROR_ACCESSOR_FIELD_SIZE_CHECK = 545,
+  ERROR_ILLEGAL_DEPENDENT_PARTITION_BATCH = 549,
   
   
 
@@ -1924,7 +1924,14 @@ namespace Legion {
         parent_req_indexes(parent_indexes), virtual_mapped(virt_mapped), 
         total_children_count(0), total_close_count(0), 
         outstanding_children_count(0), current_trace(NULL), 
-        valid_wait_event(false), outstanding_subtasks(0), pending_subtasks(0), 
+        partition_batch(NULL), partition_batch_depth(0),
+        auto_tracing(Runtime::auto_trace_max_length > 0),
+        auto_trace_pending(false), issuing_auto_trace_ops(false),
+        auto_trace_position(0), auto_trace(NULL),
+        valid_wait_event(false), window_latency_total(0), 
+        window_base_latency(0), window_latency_samples(0), 
+        window_stalled(false), window_drained(false),
+        outstanding_subtasks(0), pending_subtasks(0), 
         pending_frames(0), currently_active_context(false),
         current_fence(NULL), fence_gen(0), current_fence_index(0) 
     //--------------------------------------------------------------------------
@@ -1983,6 +1990,20 @@ namespace Legion {
           delete (it->second);
       }
       traces.clear();
+      for (std::map<std::vector<uint64_t>,DynamicTrace*>::const_iterator it =
+            auto_traces.begin(); it != auto_traces.end(); it++)
+      {
+        if (it->second->remove_reference())
+          delete (it->second);
+      }
+      auto_traces.clear();
+      for (std::vector<DynamicTrace*>::const_iterator it = 
+            retired_auto_traces.begin(); it != retired_auto_traces.end(); it++)
+      {
+        if ((*it)->remove_reference())
+          delete (*it);
+      }
+      retired_auto_traces.clear();
       // Clean up any locks and barriers that the user
       // asked us to destroy
       while (!context_locks.empty())
@@ -2410,6 +2431,8 @@ namespace Legion {
       log_index.debug("Destroying index space %x in task %s (ID %lld)", 
                       handle.id, get_task_name(), get_unique_id());
 #endif
+      if (Runtime::cache_dependent_partitions)
+        invalidate_cached_partitions(handle.get_tree_id());
       DeletionOp *op = runtime->get_available_deletion_op(true);
       op->initialize_index_space_deletion(this, handle);
       runtime->add_to_dependence_queue(this, executing_processor, op);
@@ -2424,6 +2447,8 @@ namespace Legion {
       log_index.debug("Destroying index partition %x in task %s (ID %lld)", 
                       handle.id, get_task_name(), get_unique_id());
 #endif
+      if (Runtime::cache_dependent_partitions)
+        invalidate_cached_partitions(handle.get_tree_id());
       DeletionOp *op = runtime->get_available_deletion_op(true);
       op->initialize_index_part_deletion(this, handle);
       runtime->add_to_dependence_queue(this, executing_processor, op);
@@ -2782,9 +2807,12 @@ namespace Legion {
       LegionColor part_color = INVALID_COLOR;
       if (color != AUTO_GENERATE_ID)
         part_color = color;
-      // Allocate the partition operation
+      // Allocate the partition operation unless we can fuse this
+      // with the one that is being built for a batch
       DependentPartitionOp *part_op = 
-        runtime->get_available_dependent_partition_op(true);
+        find_batched_partition(handle, parent_priv, id, tag);
+      if (part_op == NULL)
+        part_op = runtime->get_available_dependent_partition_op(true);
       ApEvent term_event = part_op->get_completion_event();
       // Tell the region tree forest about this partition 
       RtEvent safe = forest->create_pending_partition(pid, parent, color_space,
@@ -2792,27 +2820,7 @@ namespace Legion {
       // Do this after creating the pending partition so the node exists
       // in case we need to look at it during initialization
       part_op->initialize_by_field(this, pid, handle, parent_priv, fid, id,tag);
-      // Now figure out if we need to unmap and re-map any inline mappings
-      std::vector<PhysicalRegion> unmapped_regions;
-      if (!Runtime::unsafe_launch)
-        find_conflicting_regions(part_op, unmapped_regions);
-      if (!unmapped_regions.empty())
-      {
-        if (Runtime::runtime_warnings)
-        {
-          REPORT_LEGION_WARNING(LEGION_WARNING_RUNTIME_UNMAPPING_REMAPPING,
-            "Runtime is unmapping and remapping "
-              "physical regions around create_partition_by_field call "
-              "in task %s (UID %lld).", get_task_name(), get_unique_id());
-        }
-        for (unsigned idx = 0; idx < unmapped_regions.size(); idx++)
-          unmapped_regions[idx].impl->unmap_region();
-      }
-      // Issue the copy operation
-      runtime->add_to_dependence_queue(this, executing_processor, part_op);
-      // Remap any unmapped regions
-      if (!unmapped_regions.empty())
-        remap_unmapped_regions(current_trace, unmapped_regions);
+      issue_dependent_partition(part_op, "create_partition_by_field");
       // Wait for any notifications to occur before returning
       if (safe.exists())
         safe.lg_wait();
@@ -2844,9 +2852,12 @@ namespace Legion {
       LegionColor part_color = INVALID_COLOR;
       if (color != AUTO_GENERATE_ID)
         part_color = color;
-      // Allocate the partition operation
-      DependentPartitionOp *part_op = 
-        runtime->get_available_dependent_partition_op(true);
+      // Allocate the partition operation unless we can fuse this
+      // with the one that is being built for a batch
+      DependentPartitionOp *part_op = find_batched_partition(
+          forest->get_parent_logical_region(projection), parent, id, tag);
+      if (part_op == NULL)
+        part_op = runtime->get_available_dependent_partition_op(true);
       ApEvent term_event = part_op->get_completion_event(); 
       // Tell the region tree forest about this partition
       RtEvent safe = forest->create_pending_partition(pid, handle, color_space,
@@ -2854,27 +2865,7 @@ namespace Legion {
       // Do this after creating the pending partition so the node exists
       // in case we need to look at it during initialization
       part_op->initialize_by_image(this, pid, projection, parent, fid, id, tag);
-      // Now figure out if we need to unmap and re-map any inline mappings
-      std::vector<PhysicalRegion> unmapped_regions;
-      if (!Runtime::unsafe_launch)
-        find_conflicting_regions(part_op, unmapped_regions);
-      if (!unmapped_regions.empty())
-      {
-        if (Runtime::runtime_warnings)
-        {
-          REPORT_LEGION_WARNING(LEGION_WARNING_RUNTIME_UNMAPPING_REMAPPING,
-            "Runtime is unmapping and remapping "
-              "physical regions around create_partition_by_image call "
-              "in task %s (UID %lld).", get_task_name(), get_unique_id());
-        }
-        for (unsigned idx = 0; idx < unmapped_regions.size(); idx++)
-          unmapped_regions[idx].impl->unmap_region();
-      }
-      // Issue the copy operation
-      runtime->add_to_dependence_queue(this, executing_processor, part_op);
-      // Remap any unmapped regions
-      if (!unmapped_regions.empty())
-        remap_unmapped_regions(current_trace, unmapped_regions);
+      issue_dependent_partition(part_op, "create_partition_by_image");
       // Wait for any notifications to occur before returning
       if (safe.exists())
         safe.lg_wait();
@@ -2906,9 +2897,12 @@ namespace Legion {
       LegionColor part_color = INVALID_COLOR;
       if (color != AUTO_GENERATE_ID)
         part_color = color;
-      // Allocate the partition operation
-      DependentPartitionOp *part_op = 
-        runtime->get_available_dependent_partition_op(true);
+      // Allocate the partition operation unless we can fuse this
+      // with the one that is being built for a batch
+      DependentPartitionOp *part_op = find_batched_partition(
+          forest->get_parent_logical_region(projection), parent, id, tag);
+      if (part_op == NULL)
+        part_op = runtime->get_available_dependent_partition_op(true);
       ApEvent term_event = part_op->get_completion_event();
       // Tell the region tree forest about this partition
       RtEvent safe = forest->create_pending_partition(pid, handle, color_space,
@@ -2917,27 +2911,7 @@ namespace Legion {
       // in case we need to look at it during initialization
       part_op->initialize_by_image_range(this, pid, projection, parent, 
                                          fid, id, tag);
-      // Now figure out if we need to unmap and re-map any inline mappings
-      std::vector<PhysicalRegion> unmapped_regions;
-      if (!Runtime::unsafe_launch)
-        find_conflicting_regions(part_op, unmapped_regions);
-      if (!unmapped_regions.empty())
-      {
-        if (Runtime::runtime_warnings)
-        {
-          REPORT_LEGION_WARNING(LEGION_WARNING_RUNTIME_UNMAPPING_REMAPPING,
-            "Runtime is unmapping and remapping "
-              "physical regions around create_partition_by_image_range call "
-              "in task %s (UID %lld).", get_task_name(), get_unique_id());
-        }
-        for (unsigned idx = 0; idx < unmapped_regions.size(); idx++)
-          unmapped_regions[idx].impl->unmap_region();
-      }
-      // Issue the copy operation
-      runtime->add_to_dependence_queue(this, executing_processor, part_op);
-      // Remap any unmapped regions
-      if (!unmapped_regions.empty())
-        remap_unmapped_regions(current_trace, unmapped_regions);
+      issue_dependent_partition(part_op, "create_partition_by_image_range");
       // Wait for any notifications to occur before returning
       if (safe.exists())
         safe.lg_wait();
@@ -2969,9 +2943,12 @@ namespace Legion {
       LegionColor part_color = INVALID_COLOR;
       if (color != AUTO_GENERATE_ID)
         part_color = color;
-      // Allocate the partition operation
+      // Allocate the partition operation unless we can fuse this
+      // with the one that is being built for a batch
       DependentPartitionOp *part_op = 
-        runtime->get_available_dependent_partition_op(true); 
+        find_batched_partition(handle, parent, id, tag);
+      if (part_op == NULL)
+        part_op = runtime->get_available_dependent_partition_op(true);
       ApEvent term_event = part_op->get_completion_event();
       // If the source of the preimage is disjoint then the result is disjoint
       // Note this only applies here and not to range
@@ -2989,27 +2966,7 @@ namespace Legion {
       // in case we need to look at it during initialization
       part_op->initialize_by_preimage(this, pid, projection, handle, 
                                       parent, fid, id, tag);
-      // Now figure out if we need to unmap and re-map any inline mappings
-      std::vector<PhysicalRegion> unmapped_regions;
-      if (!Runtime::unsafe_launch)
-        find_conflicting_regions(part_op, unmapped_regions);
-      if (!unmapped_regions.empty())
-      {
-        if (Runtime::runtime_warnings)
-        {
-          REPORT_LEGION_WARNING(LEGION_WARNING_RUNTIME_UNMAPPING_REMAPPING,
-            "Runtime is unmapping and remapping "
-              "physical regions around create_partition_by_preimage call "
-              "in task %s (UID %lld).", get_task_name(), get_unique_id());
-        }
-        for (unsigned idx = 0; idx < unmapped_regions.size(); idx++)
-          unmapped_regions[idx].impl->unmap_region();
-      }
-      // Issue the copy operation
-      runtime->add_to_dependence_queue(this, executing_processor, part_op);
-      // Remap any unmapped regions
-      if (!unmapped_regions.empty())
-        remap_unmapped_regions(current_trace, unmapped_regions);
+      issue_dependent_partition(part_op, "create_partition_by_preimage");
       // Wait for any notifications to occur before returning
       if (safe.exists())
         safe.lg_wait();
@@ -3041,9 +2998,12 @@ namespace Legion {
       LegionColor part_color = INVALID_COLOR;
       if (color != AUTO_GENERATE_ID)
         part_color = color;
-      // Allocate the partition operation
+      // Allocate the partition operation unless we can fuse this
+      // with the one that is being built for a batch
       DependentPartitionOp *part_op = 
-        runtime->get_available_dependent_partition_op(true); 
+        find_batched_partition(handle, parent, id, tag);
+      if (part_op == NULL)
+        part_op = runtime->get_available_dependent_partition_op(true);
       ApEvent term_event = part_op->get_completion_event();
       // Tell the region tree forest about this partition
       RtEvent safe = forest->create_pending_partition(pid, 
@@ -3053,31 +3013,175 @@ namespace Legion {
       // in case we need to look at it during initialization
       part_op->initialize_by_preimage_range(this, pid, projection, handle,
                                             parent, fid, id, tag);
+      issue_dependent_partition(part_op, "create_partition_by_preimage_range");
+      // Wait for any notifications to occur before returning
+      if (safe.exists())
+        safe.lg_wait();
+      return pid;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::begin_dependent_partition_batch(void)
+    //--------------------------------------------------------------------------
+    {
+      partition_batch_depth++;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::end_dependent_partition_batch(void)
+    //--------------------------------------------------------------------------
+    {
+      if (partition_batch_depth == 0)
+        REPORT_LEGION_ERROR(ERROR_ILLEGAL_DEPENDENT_PARTITION_BATCH,
+          "Illegal end dependent partition batch call without a matching "
+          "begin call in task %s (UID %lld)", get_task_name(), get_unique_id())
+      if ((--partition_batch_depth == 0) && (partition_batch != NULL))
+        issue_partition_batch();
+    }
+
+    //--------------------------------------------------------------------------
+    DependentPartitionOp* InnerContext::find_batched_partition(
+                                      LogicalRegion handle, LogicalRegion parent,
+                                      MapperID id, MappingTagID tag)
+    //--------------------------------------------------------------------------
+    {
+      // Checking disjointness has to wait for the partition to be 
+      // computed so we can't hold onto operations in that case
+      if ((partition_batch_depth == 0) || Runtime::verify_disjointness)
+        return NULL;
+      if (partition_batch != NULL)
+      {
+        if (partition_batch->can_fuse(handle, parent, id, tag))
+          return partition_batch;
+        // Can't fuse with this one so issue it now
+        issue_partition_batch();
+      }
+      return NULL;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::issue_dependent_partition(DependentPartitionOp *op,
+                                                 const char *call_name)
+    //--------------------------------------------------------------------------
+    {
+      if ((partition_batch_depth > 0) && !Runtime::verify_disjointness)
+      {
+        // Hold onto it in case later calls in the batch can fuse with it
+#ifdef DEBUG_LEGION
+        assert((partition_batch == NULL) || (partition_batch == op));
+#endif
+        partition_batch = op;
+      }
+      else
+        launch_dependent_partition(op, call_name);
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::launch_dependent_partition(DependentPartitionOp *op,
+                                                  const char *call_name)
+    //--------------------------------------------------------------------------
+    {
       // Now figure out if we need to unmap and re-map any inline mappings
       std::vector<PhysicalRegion> unmapped_regions;
       if (!Runtime::unsafe_launch)
-        find_conflicting_regions(part_op, unmapped_regions);
+        find_conflicting_regions(op, unmapped_regions);
       if (!unmapped_regions.empty())
       {
         if (Runtime::runtime_warnings)
         {
           REPORT_LEGION_WARNING(LEGION_WARNING_RUNTIME_UNMAPPING_REMAPPING,
             "Runtime is unmapping and remapping "
-              "physical regions around create_partition_by_preimage_range call "
-              "in task %s (UID %lld).", get_task_name(), get_unique_id());
+              "physical regions around %s call "
+              "in task %s (UID %lld).", call_name, get_task_name(), 
+              get_unique_id());
         }
         for (unsigned idx = 0; idx < unmapped_regions.size(); idx++)
           unmapped_regions[idx].impl->unmap_region();
       }
-      // Issue the copy operation
-      runtime->add_to_dependence_queue(this, executing_processor, part_op);
+      // Issue the partition operation
+      runtime->add_to_dependence_queue(this, executing_processor, op);
       // Remap any unmapped regions
       if (!unmapped_regions.empty())
         remap_unmapped_regions(current_trace, unmapped_regions);
-      // Wait for any notifications to occur before returning
-      if (safe.exists())
-        safe.lg_wait();
-      return pid;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::issue_partition_batch(void)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(partition_batch != NULL);
+#endif
+      DependentPartitionOp *op = partition_batch;
+      // Clear this first since we'll come back through the
+      // dependence queue when we launch the operation
+      partition_batch = NULL;
+      launch_dependent_partition(op, "end_dependent_partition_batch");
+    }
+
+    //--------------------------------------------------------------------------
+    bool InnerContext::find_cached_partition(const PartitionCacheKey &key,
+                  Operation *op, IndexPartition pending, ApEvent &ready)
+    //--------------------------------------------------------------------------
+    {
+      // Hold the lock while copying so the source can't be invalidated
+      AutoLock ctx_lock(context_lock);
+      std::map<PartitionCacheKey,IndexPartition>::const_iterator finder = 
+        partition_cache.find(key);
+      if (finder == partition_cache.end())
+        return false;
+      ready = runtime->forest->create_partition_by_copy(op, pending, 
+                                                        finder->second);
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::record_cached_partition(const PartitionCacheKey &key,
+                                               IndexPartition pid)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock ctx_lock(context_lock);
+      // Keep the first one we saw since it was computed first
+      if (partition_cache.find(key) == partition_cache.end())
+        partition_cache[key] = pid;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::invalidate_cached_partitions(IndexTreeID tid)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock ctx_lock(context_lock);
+      std::map<PartitionCacheKey,IndexPartition>::iterator it = 
+        partition_cache.begin();
+      while (it != partition_cache.end())
+      {
+        if (it->second.get_tree_id() == tid)
+        {
+          std::map<PartitionCacheKey,IndexPartition>::iterator to_delete = it++;
+          partition_cache.erase(to_delete);
+        }
+        else
+          it++;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::invalidate_cached_partitions(FieldSpace space)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock ctx_lock(context_lock);
+      std::map<PartitionCacheKey,IndexPartition>::iterator it = 
+        partition_cache.begin();
+      while (it != partition_cache.end())
+      {
+        if (it->first.region.get_field_space() == space)
+        {
+          std::map<PartitionCacheKey,IndexPartition>::iterator to_delete = it++;
+          partition_cache.erase(to_delete);
+        }
+        else
+          it++;
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -3266,6 +3370,8 @@ namespace Legion {
       log_field.debug("Destroying field space %x in task %s (ID %lld)", 
                       handle.id, get_task_name(), get_unique_id());
 #endif
+      if (Runtime::cache_dependent_partitions)
+        invalidate_cached_partitions(handle);
       DeletionOp *op = runtime->get_available_deletion_op(true);
       op->initialize_field_space_deletion(this, handle);
       runtime->add_to_dependence_queue(this, executing_processor, op);
@@ -3368,6 +3474,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       AutoRuntimeCall call(this);
+      if (Runtime::cache_dependent_partitions)
+        invalidate_cached_partitions(space);
       DeletionOp *op = runtime->get_available_deletion_op(true);
       op->initialize_field_deletion(this, space, fid);
       runtime->add_to_dependence_queue(this, executing_processor, op);
@@ -3477,6 +3585,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       AutoRuntimeCall call(this);
+      if (Runtime::cache_dependent_partitions)
+        invalidate_cached_partitions(space);
       DeletionOp *op = runtime->get_available_deletion_op(true);
       op->initialize_field_deletions(this, space, to_free);
       runtime->add_to_dependence_queue(this, executing_processor, op);
@@ -3516,6 +3626,8 @@ namespace Legion {
                        handle.index_space.id, handle.field_space.id, 
                        get_task_name(), get_unique_id());
 #endif
+      if (Runtime::cache_dependent_partitions)
+        invalidate_cached_partitions(handle.get_field_space());
       DeletionOp *op = runtime->get_available_deletion_op(true);
       op->initialize_logical_region_deletion(this, handle);
       runtime->add_to_dependence_queue(this, executing_processor, op);
@@ -3556,7 +3668,7 @@ namespace Legion {
         if (launcher.predicate_false_future.impl != NULL)
           return launcher.predicate_false_future;
         // Otherwise check to see if we have a value
-        FutureImpl *result = new FutureImpl(runtime, true/*register*/,
+        FutureImpl *result = new FutureImpl(runtime, false/*register*/,
           runtime->get_available_distributed_id(true), runtime->address_space);
         if (launcher.predicate_false_result.get_size() > 0)
           result->set_result(launcher.predicate_false_result.get_ptr(),
@@ -3582,6 +3694,14 @@ namespace Legion {
         result->complete_future();
         return Future(result);
       }
+      if (auto_tracing)
+      {
+        uint64_t hash = hash_auto_trace(Operation::TASK_OP_KIND, 
+                                        launcher.task_id);
+        for (unsigned idx = 0; idx < launcher.region_requirements.size(); idx++)
+          hash = hash_auto_trace(hash, launcher.region_requirements[idx]);
+        predict_auto_trace(hash);
+      }
       IndividualTask *task = runtime->get_available_individual_task(true);
 #ifdef DEBUG_LEGION
       Future result = 
@@ -3701,6 +3821,15 @@ namespace Legion {
       IndexSpace launch_space = launcher.launch_space;
       if (!launch_space.exists())
         launch_space = find_index_launch_space(launcher.launch_domain);
+      if (auto_tracing)
+      {
+        uint64_t hash = hash_auto_trace(Operation::TASK_OP_KIND, 
+                                        launcher.task_id);
+        hash = hash_auto_trace(hash, launch_space.get_id());
+        for (unsigned idx = 0; idx < launcher.region_requirements.size(); idx++)
+          hash = hash_auto_trace(hash, launcher.region_requirements[idx]);
+        predict_auto_trace(hash);
+      }
       IndexTask *task = runtime->get_available_index_task(true);
 #ifdef DEBUG_LEGION
       FutureMap result = 
@@ -3734,7 +3863,7 @@ namespace Legion {
         if (launcher.predicate_false_future.impl != NULL)
           return launcher.predicate_false_future;
         // Otherwise check to see if we have a value
-        FutureImpl *result = new FutureImpl(runtime, true/*register*/, 
+        FutureImpl *result = new FutureImpl(runtime, false/*register*/, 
           runtime->get_available_distributed_id(true), runtime->address_space);
         if (launcher.predicate_false_result.get_size() > 0)
           result->set_result(launcher.predicate_false_result.get_ptr(),
@@ -3772,6 +3901,15 @@ namespace Legion {
       IndexSpace launch_space = launcher.launch_space;
       if (!launch_space.exists())
         launch_space = find_index_launch_space(launcher.launch_domain);
+      if (auto_tracing)
+      {
+        uint64_t hash = hash_auto_trace(Operation::TASK_OP_KIND, 
+                                        launcher.task_id);
+        hash = hash_auto_trace(hash, launch_space.get_id());
+        for (unsigned idx = 0; idx < launcher.region_requirements.size(); idx++)
+          hash = hash_auto_trace(hash, launcher.region_requirements[idx]);
+        predict_auto_trace(hash);
+      }
       IndexTask *task = runtime->get_available_index_task(true);
 #ifdef DEBUG_LEGION
       Future result = 
@@ -3875,6 +4013,17 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       AutoRuntimeCall call(this);
+      if (auto_tracing)
+      {
+        uint64_t hash = hash_auto_trace(Operation::FILL_OP_KIND,
+                                        launcher.handle.get_tree_id());
+        hash = hash_auto_trace(hash, launcher.handle.get_index_space().get_id());
+        hash = hash_auto_trace(hash, launcher.parent.get_index_space().get_id());
+        for (std::set<FieldID>::const_iterator it = 
+              launcher.fields.begin(); it != launcher.fields.end(); it++)
+          hash = hash_auto_trace(hash, *it);
+        predict_auto_trace(hash);
+      }
       FillOp *fill_op = runtime->get_available_fill_op(true);
 #ifdef DEBUG_LEGION
       fill_op->initialize(this, launcher, Runtime::check_privileges);
@@ -3964,6 +4113,16 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       AutoRuntimeCall call(this);
+      if (auto_tracing)
+      {
+        uint64_t hash = hash_auto_trace(Operation::COPY_OP_KIND,
+                                        launcher.src_requirements.size());
+        for (unsigned idx = 0; idx < launcher.src_requirements.size(); idx++)
+          hash = hash_auto_trace(hash, launcher.src_requirements[idx]);
+        for (unsigned idx = 0; idx < launcher.dst_requirements.size(); idx++)
+          hash = hash_auto_trace(hash, launcher.dst_requirements[idx]);
+        predict_auto_trace(hash);
+      }
       CopyOp *copy_op = runtime->get_available_copy_op(true);
 #ifdef DEBUG_LEGION
       copy_op->initialize(this, launcher, Runtime::check_privileges);
@@ -4412,6 +4571,16 @@ namespace Legion {
                       const std::vector<StaticDependence> *dependences)
     //--------------------------------------------------------------------------
     {
+      // Only operations announced by predict_auto_trace can be part of 
+      // an automatic trace, anything else has to end it before it can 
+      // be given a context index
+      if (auto_tracing && !issuing_auto_trace_ops)
+      {
+        if (auto_trace_pending)
+          auto_trace_pending = false;
+        else
+          interrupt_auto_trace();
+      }
       // If we are performing a trace mark that the child has a trace
       if (current_trace != NULL)
         op->set_trace(current_trace, !current_trace->is_fixed(), dependences);
@@ -4463,7 +4632,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // For now we just bump our counter
-      unsigned result = total_close_count++;
+      unsigned result = __sync_fetch_and_add(&total_close_count, 1);
       if (Runtime::legion_spy_enabled)
         LegionSpy::log_close_operation_index(get_context_uid(), result, 
                                              op->get_unique_op_id());
@@ -4493,6 +4662,7 @@ namespace Legion {
         window_wait = Runtime::create_rt_user_event();
         valid_wait_event = true;
         wait_event = window_wait;
+        window_stalled = true;
       }
       // Release our lock now
       context_lock.release();
@@ -4501,6 +4671,46 @@ namespace Legion {
       __sync_fetch_and_add(&outstanding_children_count,1);
     }
 
+    //--------------------------------------------------------------------------
+    void InnerContext::adapt_window_size(void)
+    //--------------------------------------------------------------------------
+    {
+      // We already hold our lock from the callsite
+      // The window only matters if it held back the application. If we
+      // then ran out of children the utility processors went idle and
+      // need more lookahead to hide the latency of resuming the task. 
+      // If instead children took much longer to map than they do when
+      // nothing is queued up in front of them, then the extra lookahead
+      // is only sitting around using memory.
+      const unsigned long long latency = 
+        window_latency_total / window_latency_samples;
+      // Slowly forget the fastest latency in case the mix changes
+      if ((window_base_latency == 0) || (latency < window_base_latency))
+        window_base_latency = latency;
+      else
+        window_base_latency += window_base_latency / 16;
+      if ((context_configuration.max_window_size > 0) && 
+          (context_configuration.min_frames_to_schedule == 0) && 
+          window_stalled)
+      {
+        int window_size = context_configuration.max_window_size;
+        if (window_drained)
+          window_size *= 2;
+        else if (latency > 
+            (LEGION_ADAPTIVE_WINDOW_LATENCY_FACTOR * window_base_latency))
+          window_size -= window_size / 4;
+        if (window_size < Runtime::adaptive_window_min)
+          window_size = Runtime::adaptive_window_min;
+        if (window_size > Runtime::adaptive_window_max)
+          window_size = Runtime::adaptive_window_max;
+        context_configuration.max_window_size = window_size;
+      }
+      window_latency_total = 0;
+      window_latency_samples = 0;
+      window_stalled = false;
+      window_drained = false;
+    }
+
     //--------------------------------------------------------------------------
     void InnerContext::add_to_dependence_queue(Operation *op, bool has_lock,
                                                RtEvent op_precondition)
@@ -4508,6 +4718,10 @@ namespace Legion {
     {
       if (!has_lock)
       {
+        // Any batched partition operation has to go first so that
+        // it stays in program order with this operation
+        if ((partition_batch != NULL) && (partition_batch != op))
+          issue_partition_batch();
         RtEvent lock_acquire = Runtime::acquire_rt_reservation(context_lock,
                                 true/*exclusive*/, last_registration);
         if (!lock_acquire.has_triggered())
@@ -4532,6 +4746,8 @@ namespace Legion {
         outstanding_children[op->get_ctx_index()] = op;
 #endif       
         executing_children[op] = op->get_generation();
+        if (Runtime::adaptive_task_window)
+          window_entry_times[op] = Realm::Clock::current_time_in_nanoseconds();
       }
       // Issue the next dependence analysis task
       DeferredDependenceArgs args;
@@ -4590,6 +4806,22 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(outstanding_count >= 0);
 #endif
+        if (Runtime::adaptive_task_window)
+        {
+          std::map<Operation*,unsigned long long>::iterator entry = 
+            window_entry_times.find(op);
+          if (entry != window_entry_times.end())
+          {
+            window_latency_total += 
+              Realm::Clock::current_time_in_nanoseconds() - entry->second;
+            window_entry_times.erase(entry);
+            if (++window_latency_samples == LEGION_ADAPTIVE_WINDOW_PERIOD)
+              adapt_window_size();
+          }
+          // Out of children while the application was held back
+          if ((outstanding_count == 0) && window_stalled)
+            window_drained = true;
+        }
         if (valid_wait_event && (context_configuration.max_window_size > 0) &&
             (outstanding_count <=
              int((100 - context_configuration.hysteresis_percentage) * 
@@ -4681,6 +4913,12 @@ namespace Legion {
 #ifdef DEBUG_LEGION
         assert(outstanding_count >= 0);
 #endif
+        if (Runtime::adaptive_task_window)
+        {
+          window_entry_times.erase(op);
+          if ((outstanding_count == 0) && window_stalled)
+            window_drained = true;
+        }
         if (valid_wait_event && (context_configuration.max_window_size > 0) &&
             (outstanding_count <=
              int((100 - context_configuration.hysteresis_percentage) *
@@ -4900,6 +5138,12 @@ namespace Legion {
 #endif
       // No need to hold the lock here, this is only ever called
       // by the one thread that is running the task.
+      // Applications that trace themselves don't get automatic traces
+      if (auto_tracing)
+      {
+        interrupt_auto_trace();
+        auto_tracing = false;
+      }
       if (current_trace != NULL)
         REPORT_LEGION_ERROR(ERROR_ILLEGAL_NESTED_TRACE,
           "Illegal nested trace with ID %d attempted in "
@@ -4974,6 +5218,11 @@ namespace Legion {
 #endif
       // No need to hold the lock here, this is only ever called
       // by the one thread that is running the task.
+      if (auto_tracing)
+      {
+        interrupt_auto_trace();
+        auto_tracing = false;
+      }
       if (current_trace != NULL)
         REPORT_LEGION_ERROR(ERROR_ILLEGAL_NESTED_STATIC_TRACE,
           "Illegal nested static trace attempted in "
@@ -5011,6 +5260,194 @@ namespace Legion {
       current_trace = NULL;
     }
 
+    //--------------------------------------------------------------------------
+    void InnerContext::predict_auto_trace(uint64_t hash)
+    //--------------------------------------------------------------------------
+    {
+      // Only the task's own thread gets here so no need for the lock
+      // The operation we're predicting for always registers next
+      auto_trace_pending = true;
+      // Finish the previous period of the trace if it is done
+      if ((auto_trace != NULL) && 
+          (auto_trace_position == auto_trace_period.size()))
+      {
+        end_auto_trace(true/*completed*/);
+        auto_trace_position = 0;
+      }
+      if (!auto_trace_period.empty())
+      {
+        if (hash == auto_trace_period[auto_trace_position])
+        {
+          // Prediction holds, this operation goes in the trace
+          if (auto_trace_position == 0)
+            begin_auto_trace();
+          auto_trace_position++;
+          return;
+        }
+        // The prediction failed, roll back to detecting 
+        interrupt_auto_trace();
+        // Still need to register this operation
+        auto_trace_pending = true;
+      }
+      // See if this operation finishes a sequence of operations
+      // that has been issued twice in a row
+      auto_trace_history.push_back(hash);
+      if (auto_trace_history.size() > (2 * Runtime::auto_trace_max_length))
+        auto_trace_history.pop_front();
+      const size_t history_size = auto_trace_history.size();
+      for (size_t length = DEFAULT_MIN_AUTO_TRACE_LENGTH; 
+            (2 * length) <= history_size; length++)
+      {
+        if (auto_trace_history[history_size - 1 - length] != hash)
+          continue;
+        bool repeated = true;
+        for (size_t idx = 1; idx < length; idx++)
+        {
+          if (auto_trace_history[history_size - 1 - idx] != 
+              auto_trace_history[history_size - 1 - length - idx])
+          {
+            repeated = false;
+            break;
+          }
+        }
+        if (!repeated)
+          continue;
+        // Predict that the sequence will keep repeating starting
+        // with the next operation
+        auto_trace_period.assign(auto_trace_history.end() - length,
+                                 auto_trace_history.end());
+        auto_trace_position = 0;
+        auto_trace_history.clear();
+        break;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::interrupt_auto_trace(void)
+    //--------------------------------------------------------------------------
+    {
+      if (auto_trace != NULL)
+        end_auto_trace(auto_trace_position == auto_trace_period.size());
+      auto_trace_period.clear();
+      auto_trace_position = 0;
+      auto_trace_history.clear();
+      auto_trace_pending = false;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::begin_auto_trace(void)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(auto_trace == NULL);
+      assert(current_trace == NULL);
+#endif
+      std::map<std::vector<uint64_t>,DynamicTrace*>::const_iterator finder = 
+        auto_traces.find(auto_trace_period);
+      if (finder == auto_traces.end())
+      {
+        // First time we've seen this sequence so capture it
+        const TraceID tid = auto_traces.size() + retired_auto_traces.size();
+        auto_trace = new DynamicTrace(tid, this);
+        auto_trace->add_reference();
+        auto_traces[auto_trace_period] = auto_trace;
+      }
+      else
+      {
+        // Replaying so we need a mapping fence just like begin_trace
+        issuing_auto_trace_ops = true;
+        runtime->issue_mapping_fence(this);
+        issuing_auto_trace_ops = false;
+        auto_trace = finder->second;
+      }
+      current_trace = auto_trace;
+    }
+
+    //--------------------------------------------------------------------------
+    void InnerContext::end_auto_trace(bool completed)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(auto_trace != NULL);
+      assert(current_trace == auto_trace);
+#endif
+      // Same as end_trace, the trace operations pick up the trace 
+      // from current_trace when they register
+      issuing_auto_trace_ops = true;
+      if (auto_trace->is_fixed())
+      {
+        // A replay that stopped early is still sound since the 
+        // recorded dependences only ever point backwards
+        TraceCompleteOp *complete_op = runtime->get_available_trace_op(true);
+        complete_op->initialize_complete(this);
+        runtime->add_to_dependence_queue(this, executing_processor, complete_op);
+      }
+      else
+      {
+        TraceCaptureOp *capture_op = runtime->get_available_capture_op(true); 
+        capture_op->initialize_capture(this);
+        runtime->add_to_dependence_queue(this, executing_processor, capture_op);
+        auto_trace->fix_trace();
+        // A capture that stopped early only recorded a prefix of the
+        // sequence so it can never be replayed for the whole thing
+        if (!completed)
+        {
+          auto_traces.erase(auto_trace_period);
+          retired_auto_traces.push_back(auto_trace);
+        }
+      }
+      issuing_auto_trace_ops = false;
+      current_trace = NULL;
+      auto_trace = NULL;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ uint64_t InnerContext::hash_auto_trace(uint64_t hash, 
+                                                      uint64_t value)
+    //--------------------------------------------------------------------------
+    {
+      // FNV-1a over the bytes of the value
+      if (hash == 0)
+        hash = 14695981039346656037ULL;
+      for (unsigned idx = 0; idx < sizeof(value); idx++)
+      {
+        hash ^= (value >> (8 * idx)) & 0xff;
+        hash *= 1099511628211ULL;
+      }
+      return hash;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ uint64_t InnerContext::hash_auto_trace(uint64_t hash,
+                                                const RegionRequirement &req)
+    //--------------------------------------------------------------------------
+    {
+      // Everything that the dependence analysis looks at
+      hash = hash_auto_trace(hash, req.handle_type);
+      if (req.handle_type == PART_PROJECTION)
+      {
+        hash = hash_auto_trace(hash, req.partition.get_tree_id());
+        hash = hash_auto_trace(hash, 
+                               req.partition.get_index_partition().get_id());
+      }
+      else
+      {
+        hash = hash_auto_trace(hash, req.region.get_tree_id());
+        hash = hash_auto_trace(hash, req.region.get_index_space().get_id());
+      }
+      hash = hash_auto_trace(hash, req.projection);
+      hash = hash_auto_trace(hash, req.parent.get_index_space().get_id());
+      hash = hash_auto_trace(hash, req.privilege);
+      hash = hash_auto_trace(hash, req.prop);
+      hash = hash_auto_trace(hash, req.redop);
+      hash = hash_auto_trace(hash, req.flags);
+      for (std::set<FieldID>::const_iterator it = 
+            req.privilege_fields.begin(); it != 
+            req.privilege_fields.end(); it++)
+        hash = hash_auto_trace(hash, *it);
+      return hash;
+    }
+
     //--------------------------------------------------------------------------
     void InnerContext::issue_frame(FrameOp *frame, ApEvent frame_termination)
     //--------------------------------------------------------------------------
@@ -5861,6 +6298,12 @@ namespace Legion {
     void InnerContext::end_task(const void *res, size_t res_size, bool owned)
     //--------------------------------------------------------------------------
     {
+      // Issue any partition batch that the application did not end
+      if (partition_batch != NULL)
+      {
+        partition_batch_depth = 0;
+        issue_partition_batch();
+      }
       if (overhead_tracker != NULL)
       {
         const long long current = Realm::Clock::current_time_in_nanoseconds();
@@ -5921,6 +6364,12 @@ namespace Legion {
           }
         }
       }
+      // Close out any automatic trace before we check for user traces
+      if (auto_tracing)
+      {
+        interrupt_auto_trace();
+        auto_tracing = false;
+      }
       // Quick check to make sure the user didn't forget to end a trace
       if (current_trace != NULL)
         REPORT_LEGION_ERROR(ERROR_TASK_FAILED_END_TRACE,
@@ -6327,6 +6776,31 @@ namespace Legion {
       return result;
     }
 
+    //--------------------------------------------------------------------------
+    bool InnerContext::can_inline_in_place(TaskOp *child)
+    //--------------------------------------------------------------------------
+    {
+      // A child can be run directly in our context without going through
+      // the operation pipeline if every one of its regions is covered by
+      // one of our physical regions that is already mapped and valid, so
+      // there is nothing for it to wait on or map. We can look at the
+      // physical regions without the lock since we're running in the
+      // application thread.
+      for (unsigned idx = 0; idx < child->regions.size(); idx++)
+      {
+        const RegionRequirement &req = child->regions[idx];
+        if ((req.handle_type != SINGULAR) || IS_REDUCE(req))
+          return false;
+        const int parent_index = find_parent_region_req(req);
+        if ((parent_index < 0) || (unsigned(parent_index) >= regions.size()))
+          return false;
+        PhysicalRegionImpl *impl = physical_regions[parent_index].impl;
+        if (!impl->is_mapped() || !impl->is_valid())
+          return false;
+      }
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     void InnerContext::execute_task_launch(TaskOp *task, bool index,
        LegionTrace *current_trace, bool silence_warnings, bool inlining_enabled)
@@ -6335,6 +6809,10 @@ namespace Legion {
       bool inline_task = false;
       if (inlining_enabled)
         inline_task = task->select_task_options();
+      // Even if the launcher didn't enable inlining, the mapper can still
+      // ask for it for single tasks that won't need any new mappings
+      else if (!index && can_inline_in_place(task))
+        inline_task = task->select_task_options();
       // Now check to see if we're inling the task or just performing
       // a normal asynchronous task launch
       if (inline_task)
@@ -7156,6 +7634,7 @@ namespace Legion {
       : TaskContext(rt, owner, owner->regions)
     //--------------------------------------------------------------------------
     {
+      physical_regions.reserve(regions.size());
     }
 
     //--------------------------------------------------------------------------
@@ -7516,6 +7995,24 @@ namespace Legion {
       return IndexPartition::NO_PART;
     }
 
+    //--------------------------------------------------------------------------
+    void LeafContext::begin_dependent_partition_batch(void)
+    //--------------------------------------------------------------------------
+    {
+      REPORT_LEGION_ERROR(ERROR_ILLEGAL_DEPENDENT_PARTITION_BATCH,
+        "Illegal begin dependent partition batch performed in leaf "
+                     "task %s (ID %lld)", get_task_name(), get_unique_id())
+    }
+
+    //--------------------------------------------------------------------------
+    void LeafContext::end_dependent_partition_batch(void)
+    //--------------------------------------------------------------------------
+    {
+      REPORT_LEGION_ERROR(ERROR_ILLEGAL_DEPENDENT_PARTITION_BATCH,
+        "Illegal end dependent partition batch performed in leaf "
+                     "task %s (ID %lld)", get_task_name(), get_unique_id())
+    }
+
     //--------------------------------------------------------------------------
     IndexPartition LeafContext::create_pending_partition(
                                               RegionTreeForest *forest,
@@ -8258,7 +8755,6 @@ namespace Legion {
       single_task->handle_future(res, res_size, owned);
       bool need_complete = false;
       bool need_commit = false;
-      std::vector<PhysicalRegion> unmap_regions;
       {
         AutoLock ctx_lock(context_lock);
 #ifdef DEBUG_LEGION
@@ -8277,23 +8773,19 @@ namespace Legion {
           need_commit = true;
           children_commit_invoked = true;
         }
-        // Finally unmap any physical regions that we mapped
+      }
+      // Finally unmap any physical regions that we mapped. Leaf tasks
+      // can't make new physical regions so now that the task is done
+      // executing we can walk them without holding the lock, which
+      // also means we won't be holding it if an unmap has to block
 #ifdef DEBUG_LEGION
-        assert((regions.size() + 
-                  created_requirements.size()) == physical_regions.size());
+      assert((regions.size() + 
+                created_requirements.size()) == physical_regions.size());
 #endif
-        for (std::vector<PhysicalRegion>::const_iterator it = 
-              physical_regions.begin(); it != physical_regions.end(); it++)
-        {
-          if (it->impl->is_mapped())
-            unmap_regions.push_back(*it);
-        }
-      }
-      // Do the unmappings while not holding the lock in case we block
-      if (!unmap_regions.empty())
+      for (std::vector<PhysicalRegion>::const_iterator it = 
+            physical_regions.begin(); it != physical_regions.end(); it++)
       {
-        for (std::vector<PhysicalRegion>::const_iterator it = 
-              unmap_regions.begin(); it != unmap_regions.end(); it++)
+        if (it->impl->is_mapped())
           it->impl->unmap_region();
       }
       // Mark that we are done executing this operation
@@ -8738,6 +9230,20 @@ namespace Legion {
                   handle, parent, fid, color_space, part_kind, color, id, tag);
     }
 
+    //--------------------------------------------------------------------------
+    void InlineContext::begin_dependent_partition_batch(void)
+    //--------------------------------------------------------------------------
+    {
+      enclosing->begin_dependent_partition_batch();
+    }
+
+    //--------------------------------------------------------------------------
+    void InlineContext::end_dependent_partition_batch(void)
+    //--------------------------------------------------------------------------
+    {
+      enclosing->end_dependent_partition_batch();
+    }
+
     //--------------------------------------------------------------------------
     IndexPartition InlineContext::create_pending_partition(
                                                     RegionTreeForest *forest,
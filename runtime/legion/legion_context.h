@@ -200,6 +200,8 @@ namespace Legion {
                                             PartitionKind part_kind,
                                             Color color,
                                             MapperID id, MappingTagID tag) = 0;
+      virtual void begin_dependent_partition_batch(void) = 0;
+      virtual void end_dependent_partition_batch(void) = 0;
       virtual IndexPartition create_pending_partition(
                                             RegionTreeForest *forest,
                                             IndexSpace parent,
@@ -645,6 +647,8 @@ namespace Legion {
     public:
       void print_children(void);
       void perform_window_wait(void);
+    protected:
+      void adapt_window_size(void);
     public:
       // Interface for task contexts
       virtual RegionTreeContext get_context(void) const;
@@ -773,6 +777,8 @@ namespace Legion {
                                             PartitionKind part_kind,
                                             Color color,
                                             MapperID id, MappingTagID tag);
+      virtual void begin_dependent_partition_batch(void);
+      virtual void end_dependent_partition_batch(void);
       virtual IndexPartition create_pending_partition(
                                             RegionTreeForest *forest,
                                             IndexSpace parent,
@@ -883,6 +889,18 @@ namespace Legion {
       virtual void end_trace(TraceID tid);
       virtual void begin_static_trace(const std::set<RegionTreeID> *managed);
       virtual void end_static_trace(void);
+    protected:
+      // Automatic trace detection (enabled with -lg:auto_trace)
+      // Called with a summary of each operation that we know how to
+      // trace just before it is registered, any other operation
+      // registering with the context interrupts the current trace
+      void predict_auto_trace(uint64_t hash);
+      void interrupt_auto_trace(void);
+      void begin_auto_trace(void);
+      void end_auto_trace(bool completed);
+      static uint64_t hash_auto_trace(uint64_t hash, uint64_t value);
+      static uint64_t hash_auto_trace(uint64_t hash, 
+                                      const RegionRequirement &req);
     public:
       virtual void issue_frame(FrameOp *frame, ApEvent frame_termination);
       virtual void perform_frame_issue(FrameOp *frame, 
@@ -965,6 +983,7 @@ namespace Legion {
       void execute_task_launch(TaskOp *task, bool index, 
                                LegionTrace *current_trace, 
                                bool silence_warnings, bool inlining_enabled);
+      bool can_inline_in_place(TaskOp *child);
     public:
       void clone_local_fields(
           std::map<FieldSpace,std::vector<LocalFieldInfo> > &child_local) const;
@@ -999,10 +1018,83 @@ namespace Legion {
       // Traces for this task's execution
       LegionMap<TraceID,DynamicTrace*,TASK_TRACES_ALLOC>::tracked traces;
       LegionTrace *current_trace;
+    protected:
+      // Dependent partitioning operation being built by a batch
+      DependentPartitionOp* find_batched_partition(LogicalRegion handle,
+                          LogicalRegion parent, MapperID id, MappingTagID tag);
+      void issue_dependent_partition(DependentPartitionOp *op,
+                                     const char *call_name);
+      void launch_dependent_partition(DependentPartitionOp *op,
+                                      const char *call_name);
+      void issue_partition_batch(void);
+    protected:
+      DependentPartitionOp *partition_batch;
+      unsigned partition_batch_depth;
+    public:
+      // Dependent partitions that can be reused by later identical 
+      // requests as long as the field they read has not been written
+      struct PartitionCacheKey {
+      public:
+        inline bool operator<(const PartitionCacheKey &rhs) const
+        {
+          if (kind != rhs.kind) return (kind < rhs.kind);
+          if (fid != rhs.fid) return (fid < rhs.fid);
+          if (version != rhs.version) return (version < rhs.version);
+          if (region != rhs.region) return (region < rhs.region);
+          if (projection != rhs.projection) 
+            return (projection < rhs.projection);
+          if (parent != rhs.parent) return (parent < rhs.parent);
+          return (color_space < rhs.color_space);
+        }
+      public:
+        int kind;
+        FieldID fid;
+        VersionID version;
+        LogicalRegion region;
+        IndexPartition projection;
+        IndexSpace parent;
+        IndexSpace color_space;
+      };
+      // Copy the subspaces of a matching partition into the pending
+      // one if there is one, returns false if there is no match
+      bool find_cached_partition(const PartitionCacheKey &key, 
+                                 Operation *op, IndexPartition pending,
+                                 ApEvent &ready);
+      void record_cached_partition(const PartitionCacheKey &key,
+                                   IndexPartition pid);
+    protected:
+      void invalidate_cached_partitions(IndexTreeID tid);
+      void invalidate_cached_partitions(FieldSpace space);
+    protected:
+      std::map<PartitionCacheKey,IndexPartition> partition_cache;
+    protected:
+      // State for automatic trace detection, only touched by the
+      // thread running the task
+      bool auto_tracing;
+      bool auto_trace_pending;
+      bool issuing_auto_trace_ops;
+      // Recent operation hashes that we search for repeats
+      std::deque<uint64_t> auto_trace_history;
+      // The sequence we expect to repeat and where we are in it
+      std::vector<uint64_t> auto_trace_period;
+      unsigned auto_trace_position;
+      DynamicTrace *auto_trace;
+      std::map<std::vector<uint64_t>,DynamicTrace*> auto_traces;
+      // Traces that failed during capture and can't be replayed
+      std::vector<DynamicTrace*> retired_auto_traces;
       // Event for waiting when the number of mapping+executing
       // child operations has grown too large.
       bool valid_wait_event;
       RtUserEvent window_wait;
+      // State for sizing the window adaptively (-lg:window_adaptive)
+      // from how long children take to go from the dependence queue
+      // to being executed, protected by the context lock
+      std::map<Operation*,unsigned long long> window_entry_times;
+      unsigned long long window_latency_total;
+      unsigned long long window_base_latency;
+      unsigned window_latency_samples;
+      bool window_stalled;
+      bool window_drained;
       std::deque<ApEvent> frame_events;
       RtEvent last_registration;
       RtEvent dependence_precondition;
@@ -1300,6 +1392,8 @@ namespace Legion {
                                             PartitionKind part_kind,
                                             Color color,
                                             MapperID id, MappingTagID tag);
+      virtual void begin_dependent_partition_batch(void);
+      virtual void end_dependent_partition_batch(void);
       virtual IndexPartition create_pending_partition(
                                             RegionTreeForest *forest,
                                             IndexSpace parent,
@@ -1606,6 +1700,8 @@ namespace Legion {
                                             PartitionKind part_kind,
                                             Color color,
                                             MapperID id, MappingTagID tag);
+      virtual void begin_dependent_partition_batch(void);
+      virtual void end_dependent_partition_batch(void);
       virtual IndexPartition create_pending_partition(
                                             RegionTreeForest *forest,
                                             IndexSpace parent,
@@ -898,12 +898,17 @@ namespace Legion {
       log_garbage.spew("Deleting physical instance " IDFMT " in memory " 
                        IDFMT "", instance.id, memory_manager->memory.id);
 #ifndef DISABLE_GC
-      std::vector<PhysicalInstance::DestroyedField> serdez_fields;
-      layout->compute_destroyed_fields(serdez_fields); 
-      if (!serdez_fields.empty())
-        instance.destroy(serdez_fields, deferred_event);
-      else
-        instance.destroy(deferred_event);
+      // See if the memory manager wants to hold onto the storage
+      // for a little while in case someone needs the same layout
+      if (!memory_manager->recycle_instance(this, deferred_event))
+      {
+        std::vector<PhysicalInstance::DestroyedField> serdez_fields;
+        layout->compute_destroyed_fields(serdez_fields); 
+        if (!serdez_fields.empty())
+          instance.destroy(serdez_fields, deferred_event);
+        else
+          instance.destroy(deferred_event);
+      }
 #endif
       // Notify any contexts of our deletion
       // Grab a copy of this in case we get any removal calls
@@ -1959,46 +1964,53 @@ namespace Legion {
       // If there are no fields then we are done
 #ifdef DEBUG_LEGION
       assert(realm_layout != NULL);
-#endif
-      Realm::ProfilingRequestSet requests;
-      // Add a profiling request to see if the instance is actually allocated
-      // Make it very high priority so we get the response quickly
-      ProfilingResponseBase base(this);
-      Realm::ProfilingRequest &req = requests.add_request(
-          runtime->find_utility_group(), LG_LEGION_PROFILING_ID,
-          &base, sizeof(base), LG_RESOURCE_PRIORITY);
-      req.add_measurement<Realm::ProfilingMeasurements::InstanceAllocResult>();
-      // Create a user event to wait on for the result of the profiling response
-      profiling_ready = Runtime::create_rt_user_event();
-#ifdef DEBUG_LEGION
       assert(!instance.exists()); // shouldn't exist before this
 #endif
       ApEvent ready;
-      if (runtime->profiler != NULL)
+      // See if we can reuse the storage of a recently collected instance
+      // with exactly the same layout instead of making a new one
+      LayoutDescription *recycled_layout = find_recycled_instance(ready);
+      if (recycled_layout == NULL)
       {
-        runtime->profiler->add_inst_request(requests, creator_id);
-        ready = ApEvent(PhysicalInstance::create_instance(instance,
-                  memory_manager->memory, realm_layout, requests));
-        if (instance.exists())
+        Realm::ProfilingRequestSet requests;
+        // Add a profiling request to see if the instance is actually 
+        // allocated. Make it very high priority so we get the response 
+        // quickly
+        ProfilingResponseBase base(this);
+        Realm::ProfilingRequest &req = requests.add_request(
+            runtime->find_utility_group(), LG_LEGION_PROFILING_ID,
+            &base, sizeof(base), LG_RESOURCE_PRIORITY);
+        req.add_measurement<
+          Realm::ProfilingMeasurements::InstanceAllocResult>();
+        // Create a user event to wait on for the result of the 
+        // profiling response
+        profiling_ready = Runtime::create_rt_user_event();
+        if (runtime->profiler != NULL)
         {
-          unsigned long long creation_time = 
-            Realm::Clock::current_time_in_nanoseconds();
-          runtime->profiler->record_instance_creation(instance, 
-              memory_manager->memory, creator_id, creation_time);
+          runtime->profiler->add_inst_request(requests, creator_id);
+          ready = ApEvent(PhysicalInstance::create_instance(instance,
+                    memory_manager->memory, realm_layout, requests));
+          if (instance.exists())
+          {
+            unsigned long long creation_time = 
+              Realm::Clock::current_time_in_nanoseconds();
+            runtime->profiler->record_instance_creation(instance, 
+                memory_manager->memory, creator_id, creation_time);
+          }
         }
+        else
+          ready = ApEvent(PhysicalInstance::create_instance(instance,
+                    memory_manager->memory, realm_layout, requests));
+        // Wait for the profiling response
+        if (!profiling_ready.has_triggered())
+          profiling_ready.lg_wait();
+        // If we couldn't make it then we are done
+        if (!instance.exists())
+          return NULL;
+        // If we successfully made the instance then Realm 
+        // took over ownership of the layout
+        own_realm_layout = false;
       }
-      else
-        ready = ApEvent(PhysicalInstance::create_instance(instance,
-                  memory_manager->memory, realm_layout, requests));
-      // Wait for the profiling response
-      if (!profiling_ready.has_triggered())
-        profiling_ready.lg_wait();
-      // If we couldn't make it then we are done
-      if (!instance.exists())
-        return NULL;
-      // If we successfully made the instance then Realm 
-      // took over ownership of the layout
-      own_realm_layout = false;
       PhysicalManager *result = NULL;
       DistributedID did = forest->runtime->get_available_distributed_id(false);
       AddressSpaceID local_space = forest->runtime->address_space;
@@ -2107,9 +2119,54 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(result != NULL);
 #endif
+      // The manager has its own reference to the layout now so we 
+      // can drop the one that came along with the recycled instance
+      if (recycled_layout != NULL)
+      {
+#ifdef DEBUG_LEGION
+        assert(recycled_layout == layout);
+#endif
+        if (recycled_layout->remove_reference())
+          delete recycled_layout;
+      }
       return result;
     }
 
+    //--------------------------------------------------------------------------
+    LayoutDescription* InstanceBuilder::find_recycled_instance(ApEvent &ready)
+    //--------------------------------------------------------------------------
+    {
+      if (Runtime::instance_recycle_window == 0)
+        return NULL;
+      // Instances that own their domain never have a match and only
+      // normal instances are recycled since reduction instances have
+      // to be initialized and external instances don't own their storage
+      if (own_domain || constraints.pointer_constraint.is_valid)
+        return NULL;
+      const SpecializedKind kind = constraints.specialized_constraint.kind;
+      if ((kind != NO_SPECIALIZE) && (kind != NORMAL_SPECIALIZE))
+        return NULL;
+      // Make the same adjustments to the constraints that we will make
+      // after creating the instance so that we find the same layout
+      LayoutConstraintSet adjusted = constraints;
+      adjusted.pointer_constraint = PointerConstraint();
+      adjusted.field_constraint.contiguous = true;
+      adjusted.field_constraint.inorder = true;
+      adjusted.ordering_constraint.contiguous = true;
+      adjusted.memory_constraint = MemoryConstraint(
+                                        memory_manager->memory.kind());
+      LayoutDescription *layout = 
+        ancestor->column_source->find_layout_description(instance_mask,
+                                  instance_domain->get_num_dims(), adjusted);
+      // If there is no layout then there can't be an instance with it
+      if (layout == NULL)
+        return NULL;
+      if (!memory_manager->find_recycled_instance(layout, 
+                              instance_domain->handle, instance, ready))
+        return NULL;
+      return layout;
+    }
+
     //--------------------------------------------------------------------------
     void InstanceBuilder::handle_profiling_response(
                                        const Realm::ProfilingResponse &response)
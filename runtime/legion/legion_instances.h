@@ -517,6 +517,7 @@ namespace Legion {
       RegionNode* find_common_ancestor(RegionNode *one, RegionNode *two) const;
     protected:
       void compute_layout_parameters(void);
+      LayoutDescription* find_recycled_instance(ApEvent &ready);
     protected:
       const std::vector<LogicalRegion> &regions;
       LayoutConstraintSet constraints;
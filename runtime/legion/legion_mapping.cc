@@ -290,6 +290,16 @@ namespace Legion {
     {
     }
 
+    //--------------------------------------------------------------------------
+    void Mapper::map_tasks(const MapperContext ctx, const MapTasksInput &input,
+                           MapTasksOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < input.tasks.size(); idx++)
+        map_task(ctx, *(input.tasks[idx]), *(input.inputs[idx]),
+                 *(output.outputs[idx]));
+    }
+
     /////////////////////////////////////////////////////////////
     // MapperRuntime
     /////////////////////////////////////////////////////////////
@@ -412,6 +422,30 @@ namespace Legion {
       ctx->manager->wait_on_mapper_event(ctx, event);
     }
 
+    //--------------------------------------------------------------------------
+    unsigned long long MapperRuntime::get_mapper_call_count(MapperContext ctx,
+                                                   const char *call_name) const
+    //--------------------------------------------------------------------------
+    {
+      return ctx->manager->get_call_count(call_name);
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned long long MapperRuntime::get_mapper_call_latency(
+          MapperContext ctx, const char *call_name, double percentile) const
+    //--------------------------------------------------------------------------
+    {
+      return ctx->manager->get_call_latency(call_name, percentile);
+    }
+
+    //--------------------------------------------------------------------------
+    void MapperRuntime::get_internal_memory_usage(MapperContext ctx,
+               std::map<std::string,std::pair<size_t,size_t> > &usage) const
+    //--------------------------------------------------------------------------
+    {
+      Internal::Runtime::get_internal_memory_usage(usage);
+    }
+
     //--------------------------------------------------------------------------
     const ExecutionConstraintSet& MapperRuntime::find_execution_constraints(
                          MapperContext ctx, TaskID task_id, VariantID vid) const
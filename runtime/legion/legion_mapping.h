@@ -272,7 +272,13 @@ namespace Legion {
        *     are not already mapped, they will be re-mapped and the task
        *     will be executed on the local processor. The mapper should
        *     select an alternative call to the select_inline_variant call
-       *     to select the task variant to be used.
+       *     to select the task variant to be used. Inlining is always
+       *     permitted for launchers that set 'enable_inlining'. For other
+       *     single task launches it is honored only when all of the
+       *     task's regions (none of which may be reductions) are already
+       *     mapped and valid in the parent task, in which case the task
+       *     runs synchronously in the parent's context without going
+       *     through the task pipeline; otherwise it is ignored.
        *
        * spawn_task default:false
        *     This field is inspired by Cilk and has equivalent semantics.
@@ -466,6 +472,16 @@ namespace Legion {
        * also ask for profiling information for the copies generated
        * as part of the mapping of the task through the 
        * 'copy_prof_requests' field.
+       *
+       * For tasks launched inside of a dynamic trace, the mapper can set
+       * the 'memoize' flag while the trace is being captured to ask the
+       * runtime to remember this output. When the trace is replayed, the
+       * runtime will reuse the same instances, processors, variant, and
+       * priority for the corresponding task without invoking 'map_task'
+       * again, provided the task was sent to one of the same target
+       * processors and all the instances can still be acquired. Otherwise
+       * the mapper is invoked as usual. Profiling requests are not
+       * memoized.
        */
       struct MapTaskInput {
         std::vector<std::vector<PhysicalInstance> >     valid_instances;
@@ -480,6 +496,7 @@ namespace Legion {
         TaskPriority                                    profiling_priority;
         TaskPriority                                    task_priority;  // = 0
         bool                                            postmap_task; // = false
+        bool                                            memoize; // = false
       };
       //------------------------------------------------------------------------
       virtual void map_task(const MapperContext      ctx,
@@ -488,6 +505,37 @@ namespace Legion {
                                   MapTaskOutput&     output) = 0;
       //------------------------------------------------------------------------
 
+      /**
+       * ----------------------------------------------------------------------
+       *  Map Tasks
+       * ----------------------------------------------------------------------
+       * When the runtime is run with '-lg:map_batch' set larger than one,
+       * tasks that become ready to map on the same processor at the same
+       * time are handed to the mapper together through 'map_tasks' rather
+       * than through one 'map_task' call each. The 'tasks' and 'inputs'
+       * fields contain the same information that would have been passed
+       * to 'map_task' for each task, and the mapper must fill in the
+       * corresponding entry in 'outputs' exactly as it would for
+       * 'map_task'. Mappers that map many similar point tasks can
+       * override this method to share work across the batch. The default
+       * implementation simply invokes 'map_task' for each task in order.
+       * Instances acquired during this call are attributed to each task
+       * based on the instances that it chose, any other acquired instances
+       * are released when the call returns.
+       */
+      struct MapTasksInput {
+        std::vector<const Task*>                        tasks;
+        std::vector<const MapTaskInput*>                inputs;
+      };
+      struct MapTasksOutput {
+        std::vector<MapTaskOutput*>                     outputs;
+      };
+      //------------------------------------------------------------------------
+      virtual void map_tasks(const MapperContext      ctx,
+                             const MapTasksInput&     input,
+                                   MapTasksOutput&    output);
+      //------------------------------------------------------------------------
+
       /**
        * ----------------------------------------------------------------------
        *  Select Task Variant 
@@ -1396,6 +1444,14 @@ namespace Legion {
        * field which says which logical regions in different tasks must be 
        * mapped to the same physical instance. The mapper is also given 
        * the mapping tag passed at the callsite in 'mapping_tag'.
+       *
+       * Programs that relaunch the same must epoch many times can set
+       * the 'memoize' flag to ask the runtime to remember this mapping.
+       * Later must epoch launches with the same mapping tag, the same
+       * tasks and points, and the same constraints on the same logical
+       * regions will then reuse the processors and instances chosen
+       * here without invoking this mapper call again, provided all the
+       * instances can still be acquired.
        */
       struct MappingConstraint {
         std::vector<Task*>                          constrained_tasks;
@@ -1410,6 +1466,7 @@ namespace Legion {
       struct MapMustEpochOutput {
         std::vector<Processor>                      task_processors;
         std::vector<std::vector<PhysicalInstance> > constraint_mappings;
+        bool                                        memoize; // = false
       };
       //------------------------------------------------------------------------
       virtual void map_must_epoch(const MapperContext           ctx,
@@ -1638,6 +1695,24 @@ namespace Legion {
                                           MapperEvent event) const;
       void wait_on_mapper_event(MapperContext ctx,
                                           MapperEvent event) const;
+    public:
+      //------------------------------------------------------------------------
+      // Methods for querying the latency of calls to this mapper, these
+      // are only recorded when running with -lg:mapper_stats. Call names
+      // are the names of the mapper methods (e.g. "map_task") and 
+      // latencies are in nanoseconds
+      //------------------------------------------------------------------------
+      unsigned long long get_mapper_call_count(MapperContext ctx,
+                                               const char *call_name) const;
+      unsigned long long get_mapper_call_latency(MapperContext ctx,
+                          const char *call_name, double percentile) const;
+    public:
+      //------------------------------------------------------------------------
+      // Methods for querying the memory used by the runtime's internal
+      // data structures in this process, see Runtime::get_internal_memory_usage
+      //------------------------------------------------------------------------
+      void get_internal_memory_usage(MapperContext ctx,
+              std::map<std::string,std::pair<size_t,size_t> > &usage) const;
     public:
       //------------------------------------------------------------------------
       // Methods for managing constraint information
@@ -93,6 +93,7 @@ namespace Legion {
       execution_fence_event = ApEvent::NO_AP_EVENT;
       trace = NULL;
       tracing = false;
+      trace_local_id = 0;
       must_epoch = NULL;
 #ifdef DEBUG_LEGION
       assert(mapped_event.exists());
@@ -294,6 +295,7 @@ namespace Legion {
     void Operation::execute_dependence_analysis(void)
     //--------------------------------------------------------------------------
     {
+      DETAILED_PROFILER(runtime, OPERATION_DEPENDENCE_ANALYSIS_CALL);
       // Always wrap this call with calls to begin/end dependence analysis
       begin_dependence_analysis();
       trigger_dependence_analysis();
@@ -1159,24 +1161,42 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void Operation::record_logical_dependence(const LogicalUser &user)
+    void Operation::prepare_logical_records(unsigned num_regions)
     //--------------------------------------------------------------------------
     {
+      // Only ever grows so that traversals running in parallel for 
+      // requirements that have already been prepared never resize it
+      if (logical_records.size() < num_regions)
+        logical_records.resize(num_regions);
+    }
+
+    //--------------------------------------------------------------------------
+    void Operation::record_logical_dependence(unsigned idx,
+                                              const LogicalUser &user)
+    //--------------------------------------------------------------------------
+    {
+      // Traversals running in parallel have already been prepared
+      // so this will only ever grow the records for serial traversals
+      if (idx >= logical_records.size())
+        logical_records.resize(idx+1);
       // Record the advance operations separately, in many cases we don't
       // need to include them in our analysis of above users, but in the case
       // of creating new advance operations below in the tree we do
       if (user.op->get_operation_kind() == ADVANCE_OP_KIND)
-        logical_advances.push_back(user);
+        logical_records[idx].advances.push_back(user);
       else
-        logical_records.push_back(user);
+        logical_records[idx].records.push_back(user);
     }
 
     //--------------------------------------------------------------------------
-    void Operation::clear_logical_records(void)
+    void Operation::clear_logical_records(unsigned idx)
     //--------------------------------------------------------------------------
     {
-      logical_records.clear();
-      logical_advances.clear();
+#ifdef DEBUG_LEGION
+      assert(idx < logical_records.size());
+#endif
+      logical_records[idx].records.clear();
+      logical_records[idx].advances.clear();
     }
 
     //--------------------------------------------------------------------------
@@ -1717,7 +1737,7 @@ namespace Legion {
       if (result_future.impl == NULL)
       {
         Future temp = Future(
-              new FutureImpl(runtime, true/*register*/,
+              new FutureImpl(runtime, false/*register*/,
                 runtime->get_available_distributed_id(true),
                 runtime->address_space, this));
         AutoLock o_lock(op_lock);
@@ -2374,9 +2394,37 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       InstanceSet mapped_instances;
+      // Read-only mappings record the versions of their fields so that
+      // remapping them later can tell if anyone wrote to them since
+      FieldVersions field_versions;
+      const bool track_versions = IS_READ_ONLY(requirement) && 
+                                  !restrict_info.has_restrictions();
+      if (track_versions)
+      {
+        RegionNode *node = runtime->forest->get_node(requirement.region);
+        const FieldMask version_mask = 
+          node->get_column_source()->get_field_mask(
+                                          requirement.privilege_fields);
+        version_info.get_field_versions(node, false/*split prev*/,
+                                        version_mask, field_versions);
+      }
+      // If nothing has changed since we were last mapped then our 
+      // instances are still valid and all we have to do is register
+      // ourselves as a user of them, so skip the full physical analysis
+      const bool still_valid = remap_region && track_versions && 
+        region.impl->has_mapped_versions(field_versions);
+      if (still_valid)
+      {
+        region.impl->get_references(mapped_instances);
+        runtime->forest->physical_register_valid(requirement, version_info,
+                                                 this, 0/*idx*/,
+                                                 termination_event,
+                                                 map_applied_conditions,
+                                                 mapped_instances);
+      }
       // If we are remapping then we know the answer
       // so we don't need to do any premapping
-      if (remap_region)
+      else if (remap_region)
       {
         region.impl->get_references(mapped_instances);
         runtime->forest->physical_register_only(requirement,
@@ -2422,8 +2470,10 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(!mapped_instances.empty());
 #endif 
-      // We're done so apply our mapping changes
-      version_info.apply_mapping(map_applied_conditions);
+      // We're done so apply our mapping changes, there are none to 
+      // apply if we didn't touch the physical state
+      if (!still_valid)
+        version_info.apply_mapping(map_applied_conditions);
       // If we have any wait preconditions from phase barriers or 
       // grants then we can add them to the mapping preconditions
       if (!wait_barriers.empty() || !grants.empty())
@@ -2455,6 +2505,8 @@ namespace Legion {
       }
       else // The normal path here
         region.impl->reset_references(mapped_instances, termination_event);
+      if (track_versions)
+        region.impl->record_mapped_versions(field_versions);
       ApEvent map_complete_event = ApEvent::NO_AP_EVENT;
       if (mapped_instances.size() > 1)
       {
@@ -9079,7 +9131,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       initialize_operation(ctx, true/*track*/);
-      future = Future(new FutureImpl(runtime, true/*register*/,
+      future = Future(new FutureImpl(runtime, false/*register*/,
             runtime->get_available_distributed_id(true), 
             runtime->address_space, this));
       collective = dc;
@@ -10125,15 +10177,17 @@ namespace Legion {
               single_indexes.insert(key.first);
             }
           }
-          // Record the mapping dependences
-          for (std::set<unsigned>::const_iterator it1 = 
-                single_indexes.begin(); it1 != single_indexes.end(); it1++)
+          // Record the mapping dependences, each task only needs to
+          // wait on the previous task in the constraint since mapping
+          // dependences are transitive which keeps this linear in the
+          // number of tasks sharing a constraint
+          if (single_indexes.size() > 1)
           {
-            for (std::set<unsigned>::const_iterator it2 = 
-                  single_indexes.begin(); it2 != it1; it2++)
-            {
-              mapping_dependences[*it1].insert(*it2);
-            }
+            std::set<unsigned>::const_iterator prev = single_indexes.begin();
+            for (std::set<unsigned>::const_iterator next = 
+                  single_indexes.begin(); ++next != single_indexes.end(); 
+                  prev = next)
+              mapping_dependences[*next].insert(*prev);
           }
         }
         // Clear this eagerly to save space
@@ -10154,10 +10208,32 @@ namespace Legion {
       // Also resize the outputs so the mapper knows what it is doing
       output.constraint_mappings.resize(input.constraints.size());
       output.task_processors.resize(single_tasks.size(), Processor::NO_PROC);
+      output.memoize = false;
       Processor mapper_proc = parent_ctx->get_executing_processor();
       MapperManager *mapper = runtime->find_mapper(mapper_proc, mapper_id);
-      // We've got all our meta-data set up so go ahead and issue the call
-      mapper->invoke_map_must_epoch(this, &input, &output);
+      // See if the mapper memoized the mapping for a previous must epoch
+      // launch with the same shape, in which case we can skip the call
+      bool memoized = false;
+      if (mapper->find_memoized_must_epoch(input, output))
+      {
+        memoized = acquire_memoized_instances();
+        if (!memoized)
+        {
+          output.constraint_mappings.clear();
+          output.constraint_mappings.resize(input.constraints.size());
+          output.task_processors.clear();
+          output.task_processors.resize(single_tasks.size(), 
+                                        Processor::NO_PROC);
+          output.memoize = false;
+        }
+      }
+      if (!memoized)
+      {
+        // We've got all our meta-data set up so go ahead and issue the call
+        mapper->invoke_map_must_epoch(this, &input, &output);
+        if (output.memoize)
+          mapper->memoize_must_epoch(input, output);
+      }
       // Check that all the tasks have been assigned to different processors
       {
         std::map<Processor,SingleTask*> target_procs;
@@ -10424,6 +10500,42 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    bool MustEpochOp::acquire_memoized_instances(void)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(acquired_instances.empty());
+#endif
+      for (std::vector<std::vector<Mapping::PhysicalInstance> >::const_iterator
+            cit = output.constraint_mappings.begin(); 
+            cit != output.constraint_mappings.end(); cit++)
+      {
+        for (std::vector<Mapping::PhysicalInstance>::const_iterator it = 
+              cit->begin(); it != cit->end(); it++)
+        {
+          PhysicalManager *manager = it->impl;
+          if ((manager == NULL) || manager->is_virtual_manager())
+            continue;
+          std::map<PhysicalManager*,std::pair<unsigned,bool> >::iterator
+            finder = acquired_instances.find(manager);
+          if (finder != acquired_instances.end())
+            continue;
+          // Only take the fast path here, if the instance has been
+          // collected then the mapper will have to pick again
+          if (!manager->try_add_base_valid_ref(MAPPING_ACQUIRE_REF, this,
+                                               !manager->is_owner()))
+          {
+            release_acquired_instances(acquired_instances);
+            return false;
+          }
+          acquired_instances[manager] = 
+            std::pair<unsigned,bool>(1/*first ref*/, false/*created*/);
+        }
+      }
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     std::map<PhysicalManager*,std::pair<unsigned,bool> >*
                                    MustEpochOp::get_acquired_instances_ref(void)
@@ -11317,6 +11429,12 @@ namespace Legion {
         assert(false);
       }
 #endif
+      if (thunk != NULL)
+      {
+        // Fusing another partition into this operation for a batch
+        fuse_thunk(new ByFieldThunk(pid), fid);
+        return;
+      }
       parent_task = ctx->get_task();
       initialize_operation(ctx, true/*track*/); 
       // Start without the projection requirement, we'll ask
@@ -11352,6 +11470,13 @@ namespace Legion {
         assert(false);
       }
 #endif
+      if (thunk != NULL)
+      {
+        // Fusing another partition into this operation for a batch
+        fuse_thunk(new ByImageThunk(pid,
+              projection.get_index_partition()), fid);
+        return;
+      }
       parent_task = ctx->get_task();
       initialize_operation(ctx, true/*track*/);
       // Start without the projection requirement, we'll ask
@@ -11390,6 +11515,13 @@ namespace Legion {
         assert(false);
       }
 #endif
+      if (thunk != NULL)
+      {
+        // Fusing another partition into this operation for a batch
+        fuse_thunk(new ByImageRangeThunk(pid,
+              projection.get_index_partition()), fid);
+        return;
+      }
       parent_task = ctx->get_task();
       initialize_operation(ctx, true/*track*/);
       // Start without the projection requirement, we'll ask
@@ -11426,6 +11558,12 @@ namespace Legion {
         assert(false);
       }
 #endif
+      if (thunk != NULL)
+      {
+        // Fusing another partition into this operation for a batch
+        fuse_thunk(new ByPreimageThunk(pid, proj), fid);
+        return;
+      }
       parent_task = ctx->get_task();
       initialize_operation(ctx, true/*track*/);
       // Start without the projection requirement, we'll ask
@@ -11460,6 +11598,12 @@ namespace Legion {
         assert(false);
       }
 #endif
+      if (thunk != NULL)
+      {
+        // Fusing another partition into this operation for a batch
+        fuse_thunk(new ByPreimageRangeThunk(pid, proj), fid);
+        return;
+      }
       parent_task = ctx->get_task();
       initialize_operation(ctx, true/*track*/);
       // Start without the projection requirement, we'll ask
@@ -11559,6 +11703,35 @@ namespace Legion {
       return requirement;
     }
 
+    //--------------------------------------------------------------------------
+    bool DependentPartitionOp::can_fuse(LogicalRegion handle, 
+            LogicalRegion parent, MapperID id, MappingTagID t) const
+    //--------------------------------------------------------------------------
+    {
+      if (thunk == NULL)
+        return false;
+      // Associations write their field so they can't share a mapping
+      if (thunk->get_kind() == BY_ASSOCIATION)
+        return false;
+      return ((requirement.region == handle) && 
+              (requirement.parent == parent) && (map_id == id) && (tag == t));
+    }
+
+    //--------------------------------------------------------------------------
+    void DependentPartitionOp::fuse_thunk(DepPartThunk *next, FieldID fid)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(thunk != NULL);
+      assert(requirement.handle_type == SINGULAR);
+#endif
+      fused_thunks.push_back(next);
+      fused_fields.push_back(fid);
+      if (requirement.privilege_fields.find(fid) == 
+          requirement.privilege_fields.end())
+        requirement.add_field(fid);
+    }
+
     //--------------------------------------------------------------------------
     void DependentPartitionOp::trigger_prepipeline_stage(void)
     //--------------------------------------------------------------------------
@@ -11777,9 +11950,11 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
 #ifdef DEBUG_LEGION
-      assert(requirement.privilege_fields.size() == 1);
-      assert(mapped_insts.size() == 1);
+      assert(!mapped_insts.empty());
+      assert(!requirement.instance_fields.empty());
 #endif
+      // The first instance field is always the one for our first thunk
+      const FieldID fid = requirement.instance_fields[0];
       if (is_index_space)
       {
         // Update our data structure and see if we are the ones
@@ -11788,14 +11963,19 @@ namespace Legion {
         {
           AutoLock o_lock(op_lock);
           instances.resize(instances.size() + 1);
-          FieldDataDescriptor &desc = instances.back();
-          const InstanceRef &ref = mapped_insts[0];
-          PhysicalManager *manager = ref.get_manager();
-          desc.index_space = handle;
-          desc.inst = manager->get_instance();
-          desc.field_offset = manager->layout->find_field_info(
-                        *(requirement.privilege_fields.begin())).field_id;
-          index_preconditions.insert(ref.get_ready_event());
+          index_preconditions.insert(find_field_data(handle, fid,
+                                       mapped_insts, instances.back()));
+          if (!fused_thunks.empty())
+          {
+            fused_instances.resize(fused_thunks.size());
+            for (unsigned idx = 0; idx < fused_thunks.size(); idx++)
+            {
+              std::vector<FieldDataDescriptor> &descs = fused_instances[idx];
+              descs.resize(descs.size() + 1);
+              index_preconditions.insert(find_field_data(handle, 
+                        fused_fields[idx], mapped_insts, descs.back()));
+            }
+          }
 #ifdef DEBUG_LEGION
           assert(!points.empty());
 #endif
@@ -11803,8 +11983,8 @@ namespace Legion {
         }
         if (ready)
         {
-          ApEvent done_event = thunk->perform(this, runtime->forest,
-              Runtime::merge_events(index_preconditions), instances);
+          ApEvent done_event = 
+            perform_thunks(Runtime::merge_events(index_preconditions));
           Runtime::trigger_event(completion_event, done_event);
           need_completion_trigger = false;
 #ifdef LEGION_SPY
@@ -11824,17 +12004,107 @@ namespace Legion {
         assert(instances.empty());
 #endif
         instances.resize(1);
-        FieldDataDescriptor &desc = instances[0];
-        const InstanceRef &ref = mapped_insts[0];
+        ApEvent ready_event = 
+          find_field_data(handle, fid, mapped_insts, instances[0]);
+        if (!fused_thunks.empty())
+        {
+          std::set<ApEvent> ready_events;
+          ready_events.insert(ready_event);
+          fused_instances.resize(fused_thunks.size());
+          for (unsigned idx = 0; idx < fused_thunks.size(); idx++)
+          {
+            fused_instances[idx].resize(1);
+            ready_events.insert(find_field_data(handle, fused_fields[idx],
+                                    mapped_insts, fused_instances[idx][0]));
+          }
+          ready_event = Runtime::merge_events(ready_events);
+        }
+        return perform_thunks(ready_event);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    ApEvent DependentPartitionOp::find_field_data(IndexSpace handle, 
+                     FieldID fid, const InstanceSet &mapped_insts,
+                     FieldDataDescriptor &desc) const
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < mapped_insts.size(); idx++)
+      {
+        const InstanceRef &ref = mapped_insts[idx];
         PhysicalManager *manager = ref.get_manager();
+        if (!manager->layout->has_field(fid))
+          continue;
         desc.index_space = handle;
         desc.inst = manager->get_instance();
-        desc.field_offset = manager->layout->find_field_info(
-                      *(requirement.privilege_fields.begin())).field_id;
-        ApEvent ready_event = ref.get_ready_event();
-        return thunk->perform(this, runtime->forest, 
-                              ready_event, instances);
+        desc.field_offset = manager->layout->find_field_info(fid).field_id;
+        return ref.get_ready_event();
       }
+      // Should never get here since the mapper output was checked
+      assert(false);
+      return ApEvent::NO_AP_EVENT;
+    }
+
+    //--------------------------------------------------------------------------
+    ApEvent DependentPartitionOp::perform_thunks(ApEvent instances_ready)
+    //--------------------------------------------------------------------------
+    {
+      ApEvent result = perform_thunk(thunk, requirement.instance_fields[0],
+                                     instances_ready, instances);
+      if (fused_thunks.empty())
+        return result;
+      // Perform the fused thunks in the order they were made since later 
+      // ones can depend on the partitions computed by earlier ones, they
+      // all run on the same instances once they are ready
+      std::set<ApEvent> done_events;
+      done_events.insert(result);
+      for (unsigned idx = 0; idx < fused_thunks.size(); idx++)
+        done_events.insert(perform_thunk(fused_thunks[idx], fused_fields[idx],
+                                      instances_ready, fused_instances[idx]));
+      return Runtime::merge_events(done_events);
+    }
+
+    //--------------------------------------------------------------------------
+    ApEvent DependentPartitionOp::perform_thunk(DepPartThunk *to_perform,
+                      FieldID fid, ApEvent instances_ready,
+                      const std::vector<FieldDataDescriptor> &descs)
+    //--------------------------------------------------------------------------
+    {
+      // Index space launches don't have a single set of version numbers
+      // for the region so we only cache the results of singular ones
+      if (!Runtime::cache_dependent_partitions || is_index_space ||
+          (to_perform->get_kind() == BY_ASSOCIATION))
+        return to_perform->perform(this, runtime->forest, 
+                                   instances_ready, descs);
+      // The version number of the field tells us whether it has been
+      // written since the last time we computed this partition
+      RegionNode *node = runtime->forest->get_node(requirement.region);
+      FieldMask mask;
+      mask.set_bit(node->get_column_source()->get_field_index(fid));
+      FieldVersions versions;
+      version_info.get_field_versions(node, false/*split prev*/, 
+                                      mask, versions);
+      if (versions.size() != 1)
+        return to_perform->perform(this, runtime->forest, 
+                                   instances_ready, descs);
+      IndexPartNode *pending = 
+        runtime->forest->get_node(to_perform->get_partition());
+      InnerContext::PartitionCacheKey key;
+      key.kind = to_perform->get_kind();
+      key.fid = fid;
+      key.version = versions.begin()->first;
+      key.region = requirement.region;
+      key.projection = to_perform->get_projection();
+      key.parent = pending->parent->handle;
+      key.color_space = pending->color_space->handle;
+      InnerContext *context = static_cast<InnerContext*>(parent_ctx);
+      ApEvent result;
+      if (context->find_cached_partition(key, this, pending->handle, result))
+        return result;
+      result = to_perform->perform(this, runtime->forest, 
+                                   instances_ready, descs);
+      context->record_cached_partition(key, pending->handle);
+      return result;
     }
 
     //--------------------------------------------------------------------------
@@ -12157,6 +12427,11 @@ namespace Legion {
         delete thunk;
         thunk = NULL;
       }
+      for (std::vector<DepPartThunk*>::const_iterator it = 
+            fused_thunks.begin(); it != fused_thunks.end(); it++)
+        delete (*it);
+      fused_thunks.clear();
+      fused_fields.clear();
       privilege_path = RegionTreePath();
       projection_info.clear();
       version_info.clear();
@@ -12170,6 +12445,7 @@ namespace Legion {
         (*it)->deactivate();
       points.clear();
       instances.clear();
+      fused_instances.clear();
       index_preconditions.clear();
       commit_preconditions.clear();
       profiling_requests.clear();
@@ -14455,7 +14731,7 @@ namespace Legion {
       initialize_operation(ctx, true/*track*/);
       measurement = launcher.measurement;
       preconditions = launcher.preconditions;
-      result = Future(new FutureImpl(runtime, true/*register*/,
+      result = Future(new FutureImpl(runtime, false/*register*/,
                   runtime->get_available_distributed_id(true),
                   runtime->address_space, this));
       if (Runtime::legion_spy_enabled)
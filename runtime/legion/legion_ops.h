@@ -224,6 +224,9 @@ namespace Legion {
       inline bool already_traced(void) const 
         { return ((trace != NULL) && !tracing); }
       inline LegionTrace* get_trace(void) const { return trace; }
+      inline MustEpochOp* get_must_epoch(void) const { return must_epoch; }
+      inline unsigned get_trace_local_id(void) const { return trace_local_id; }
+      inline void set_trace_local_id(unsigned id) { trace_local_id = id; }
       inline unsigned get_ctx_index(void) const { return context_index; }
     public:
       // Be careful using this call as it is only valid when the operation
@@ -438,13 +441,23 @@ namespace Legion {
       void remove_mapping_reference(GenerationID gen);
     public:
       // Some extra support for tracking dependences that we've 
-      // registered as part of our logical traversal
-      void record_logical_dependence(const LogicalUser &user);
+      // registered as part of our logical traversal, these are kept
+      // per region requirement so that the traversals for requirements
+      // in different region trees can be performed in parallel
+      struct LogicalRecords {
+      public:
+        LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned records;
+        LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned advances;
+      };
+      void prepare_logical_records(unsigned num_regions);
+      void record_logical_dependence(unsigned idx, const LogicalUser &user);
       inline LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned&
-          get_logical_records(void) { return logical_records; }
+          get_logical_records(unsigned idx) 
+        { return logical_records[idx].records; }
       inline LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned&
-          get_logical_advances(void) { return logical_advances; }
-      void clear_logical_records(void);
+          get_logical_advances(unsigned idx) 
+        { return logical_records[idx].advances; }
+      void clear_logical_records(unsigned idx);
     public:
       // Notify when a region from a dependent task has 
       // been verified (flows up edges)
@@ -542,12 +555,13 @@ namespace Legion {
       LegionTrace *trace;
       // Track whether we are tracing this operation
       bool tracing;
+      // Our index in the trace if we are in one
+      unsigned trace_local_id;
       // Our must epoch if we have one
       MustEpochOp *must_epoch;
-      // A set list or recorded dependences during logical traversal
-      LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned logical_records;
-      // A set of advance operations recorded during logical traversal
-      LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned logical_advances;
+      // The dependences and advance operations recorded during the
+      // logical traversal of each region requirement
+      std::vector<LogicalRecords> logical_records;
       // A dependence tracker for this operation
       union {
         MappingDependenceTracker *mapping;
@@ -1838,6 +1852,7 @@ namespace Legion {
       void must_epoch_map_task_callback(SingleTask *task, 
                                         Mapper::MapTaskInput &input,
                                         Mapper::MapTaskOutput &output);
+      bool acquire_memoized_instances(void);
       // Get a reference to our data structure for tracking acquired instances
       virtual std::map<PhysicalManager*,std::pair<unsigned,bool> >*
                                        get_acquired_instances_ref(void);
@@ -2246,6 +2261,8 @@ namespace Legion {
             const std::vector<FieldDataDescriptor> &instances) = 0;
         virtual PartitionKind get_kind(void) const = 0;
         virtual IndexPartition get_partition(void) const = 0;
+        virtual IndexPartition get_projection(void) const
+          { return IndexPartition::NO_PART; }
       };
       class ByFieldThunk : public DepPartThunk {
       public:
@@ -2270,6 +2287,8 @@ namespace Legion {
             const std::vector<FieldDataDescriptor> &instances);
         virtual PartitionKind get_kind(void) const { return BY_IMAGE; }
         virtual IndexPartition get_partition(void) const { return pid; }
+        virtual IndexPartition get_projection(void) const 
+          { return projection; }
       protected:
         IndexPartition pid;
         IndexPartition projection;
@@ -2284,6 +2303,8 @@ namespace Legion {
             const std::vector<FieldDataDescriptor> &instances);
         virtual PartitionKind get_kind(void) const { return BY_IMAGE_RANGE; }
         virtual IndexPartition get_partition(void) const { return pid; }
+        virtual IndexPartition get_projection(void) const 
+          { return projection; }
       protected:
         IndexPartition pid;
         IndexPartition projection;
@@ -2298,6 +2319,8 @@ namespace Legion {
             const std::vector<FieldDataDescriptor> &instances);
         virtual PartitionKind get_kind(void) const { return BY_PREIMAGE; }
         virtual IndexPartition get_partition(void) const { return pid; }
+        virtual IndexPartition get_projection(void) const 
+          { return projection; }
       protected:
         IndexPartition pid;
         IndexPartition projection;
@@ -2312,6 +2335,8 @@ namespace Legion {
             const std::vector<FieldDataDescriptor> &instances);
         virtual PartitionKind get_kind(void) const { return BY_PREIMAGE_RANGE; }
         virtual IndexPartition get_partition(void) const { return pid; }
+        virtual IndexPartition get_projection(void) const 
+          { return projection; }
       protected:
         IndexPartition pid;
         IndexPartition projection;
@@ -2363,6 +2388,10 @@ namespace Legion {
       void perform_logging(void) const;
       void log_requirement(void) const;
       const RegionRequirement& get_requirement(void) const;
+      // Check whether another partition computed from fields of the 
+      // same region can be fused into this operation by batching
+      bool can_fuse(LogicalRegion handle, LogicalRegion parent,
+                    MapperID id, MappingTagID tag) const;
     public:
       virtual bool has_prepipeline_stage(void) const { return true; }
       virtual void trigger_prepipeline_stage(void);
@@ -2405,6 +2434,14 @@ namespace Legion {
       void select_partition_projection(void);
       void invoke_mapper(const InstanceSet &valid_instances,
                                InstanceSet &mapped_instances);
+      void fuse_thunk(DepPartThunk *next, FieldID fid);
+      ApEvent find_field_data(IndexSpace handle, FieldID fid,
+                              const InstanceSet &mapped_insts,
+                              FieldDataDescriptor &desc) const;
+      ApEvent perform_thunk(DepPartThunk *to_perform, FieldID fid,
+                            ApEvent instances_ready,
+                            const std::vector<FieldDataDescriptor> &descs);
+      ApEvent perform_thunks(ApEvent instances_ready);
       void activate_dependent_op(void);
       void deactivate_dependent_op(void);
     public:
@@ -2419,12 +2456,17 @@ namespace Legion {
       std::set<RtEvent> map_applied_conditions;
       std::set<ApEvent> restricted_postconditions;
       DepPartThunk *thunk;
+      // Other partitions fused into this operation by batching
+      // along with the fields that each of them reads
+      std::vector<DepPartThunk*> fused_thunks;
+      std::vector<FieldID>       fused_fields;
     protected:
       MapperManager *mapper;
     protected:
       // For index versions of this operation
       IndexSpace                        launch_space;
       std::vector<FieldDataDescriptor>  instances;
+      std::vector<std::vector<FieldDataDescriptor> > fused_instances;
       std::set<ApEvent>                 index_preconditions;
       std::vector<PointDepPartOp*>      points; 
       unsigned                          points_committed;
@@ -156,7 +156,9 @@ namespace Legion {
     void LegionProfInstance::process_task(VariantID variant_id, UniqueID op_id,
             const Realm::ProfilingMeasurements::OperationTimeline &timeline,
             const Realm::ProfilingMeasurements::OperationProcessorUsage &usage,
-            const Realm::ProfilingMeasurements::OperationEventWaits &waits)
+            const Realm::ProfilingMeasurements::OperationEventWaits &waits,
+            const Realm::ProfilingMeasurements::IPCPerfCounters *ipc,
+            const Realm::ProfilingMeasurements::L3CachePerfCounters *llc)
     //--------------------------------------------------------------------------
     {
 #ifdef DEBUG_LEGION
@@ -184,6 +186,11 @@ namespace Legion {
           wait_info.wait_end = waits.intervals[idx].wait_end;
         }
       }
+      info.has_perf = ((ipc != NULL) || (llc != NULL));
+      info.perf.total_insts = (ipc != NULL) ? ipc->total_insts : -1;
+      info.perf.total_cycles = (ipc != NULL) ? ipc->total_cycles : -1;
+      info.perf.llc_accesses = (llc != NULL) ? llc->accesses : -1;
+      info.perf.llc_misses = (llc != NULL) ? llc->misses : -1;
       const size_t diff = sizeof(TaskInfo) + num_intervals * sizeof(WaitInfo);
       owner->increase_footprint(diff);
     }
@@ -363,6 +370,41 @@ namespace Legion {
       owner->increase_footprint(sizeof(PartitionInfo));
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfInstance::process_aggregate(unsigned kind, 
+                                               unsigned long long id,
+                const Realm::ProfilingMeasurements::OperationTimeline &timeline)
+    //--------------------------------------------------------------------------
+    {
+      // Copies and partitions can finish asynchronously after they end
+      const timestamp_t duration = (timeline.complete_time > timeline.end_time)
+        ? timeline.complete_time - timeline.start_time
+        : timeline.end_time - timeline.start_time;
+      const std::pair<unsigned,unsigned long long> key(kind, id);
+      std::map<std::pair<unsigned,unsigned long long>,AggregateInfo>::iterator
+        finder = aggregate_infos.find(key);
+      if (finder == aggregate_infos.end())
+      {
+        AggregateInfo &info = aggregate_infos[key];
+        info.kind = kind;
+        info.id = id;
+        info.count = 1;
+        info.total = duration;
+        info.min = duration;
+        info.max = duration;
+      }
+      else
+      {
+        AggregateInfo &info = finder->second;
+        info.count++;
+        info.total += duration;
+        if (duration < info.min)
+          info.min = duration;
+        if (duration > info.max)
+          info.max = duration;
+      }
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfInstance::record_message(Processor proc, MessageKind kind, 
                                             unsigned long long start,
@@ -465,6 +507,8 @@ namespace Legion {
         {
           serializer->serialize(*wit, *it);
         }
+        if (it->has_perf)
+          serializer->serialize(it->perf, *it);
       }
       for (std::deque<MetaInfo>::const_iterator it = meta_infos.begin();
             it != meta_infos.end(); it++)
@@ -521,6 +565,12 @@ namespace Legion {
       {
         serializer->serialize(*it);
       }
+      for (std::map<std::pair<unsigned,unsigned long long>,AggregateInfo>::
+            const_iterator it = aggregate_infos.begin(); 
+            it != aggregate_infos.end(); it++)
+      {
+        serializer->serialize(it->second);
+      }
 #ifdef LEGION_PROF_SELF_PROFILE
       for (std::deque<ProfTaskInfo>::const_iterator it = 
             prof_task_infos.begin(); it != prof_task_infos.end(); it++)
@@ -541,6 +591,7 @@ namespace Legion {
       partition_infos.clear();
       message_infos.clear();
       mapper_call_infos.clear();
+      aggregate_infos.clear();
     }
 
     //--------------------------------------------------------------------------
@@ -611,6 +662,8 @@ namespace Legion {
               front.wait_intervals.begin(); wit != 
               front.wait_intervals.end(); wit++)
           serializer->serialize(*wit, front);
+        if (front.has_perf)
+          serializer->serialize(front.perf, front);
         diff += sizeof(front) + front.wait_intervals.size() * sizeof(WaitInfo);
         task_infos.pop_front();
         const long long t_curr = Realm::Clock::current_time_in_microseconds();
@@ -738,10 +791,18 @@ namespace Legion {
                                    const char *prof_logfile,
                                    const size_t total_runtime_instances,
                                    const size_t footprint_threshold,
-                                   const size_t target_latency)
+                                   const size_t target_latency,
+                                   const bool counters,
+                                   const bool proc_chunks,
+                                   const unsigned interval,
+                                   const bool random,
+                                   const char *sample_tasks,
+                                   const bool aggregate)
       : runtime(rt), done_event(Runtime::create_rt_user_event()), 
         output_footprint_threshold(footprint_threshold), 
         output_target_latency(target_latency), target_proc(target), 
+        perf_counters(counters), sample_interval(interval), 
+        sample_random(random), aggregate_only(aggregate), 
 #ifndef DEBUG_LEGION
         total_outstanding_requests(1/*start with guard*/),
 #endif
@@ -766,7 +827,8 @@ namespace Legion {
             REPORT_LEGION_ERROR(ERROR_MISSING_PROFILER_OPTION,
                 "ERROR: The logfile name must contain '%%' "
                 "which will be replaced with the node id\n")
-          serializer = new LegionProfBinarySerializer(filename.c_str());
+          serializer = 
+            new LegionProfBinarySerializer(filename.c_str(), proc_chunks);
         }
         else
         {
@@ -775,7 +837,7 @@ namespace Legion {
           std::stringstream ss;
           ss << filename.substr(0, pct) << current.address_space() <<
                 filename.substr(pct + 1);
-          serializer = new LegionProfBinarySerializer(ss.str());
+          serializer = new LegionProfBinarySerializer(ss.str(), proc_chunks);
         }
       } 
       else if (!strcmp(serializer_type, "ascii")) 
@@ -832,6 +894,27 @@ namespace Legion {
         total_outstanding_requests[idx] = 0;
       total_outstanding_requests[LEGION_PROF_META] = 1; // guard
 #endif
+      for (unsigned idx = 0; idx < LEGION_PROF_LAST; idx++)
+      {
+        sample_totals[idx] = 0;
+        sample_counts[idx] = 0;
+      }
+      // Parse the comma-separated list of tasks to always record
+      if (sample_tasks != NULL)
+      {
+        const char *ptr = sample_tasks;
+        while (*ptr != '\0')
+        {
+          char *next;
+          const unsigned long tid = strtoul(ptr, &next, 10);
+          if (next == ptr)
+            REPORT_LEGION_ERROR(ERROR_UNKNOWN_PROFILER_OPTION,
+                "Invalid task ID list '%s' for -lg:prof_sample_tasks",
+                sample_tasks)
+          always_sampled_tasks.insert(tid);
+          ptr = (*next == ',') ? next + 1 : next;
+        }
+      }
       // Get a processor group for all the local I/O processors if we have any 
       Machine::ProcessorQuery local_io_procs(machine);
       local_io_procs.local_address_space();
@@ -852,7 +935,8 @@ namespace Legion {
     LegionProfiler::LegionProfiler(const LegionProfiler &rhs)
       : runtime(NULL), done_event(RtUserEvent::NO_RT_USER_EVENT),
         output_footprint_threshold(0), output_target_latency(0), 
-        target_proc(rhs.target_proc)
+        target_proc(rhs.target_proc), perf_counters(false),
+        sample_interval(0), sample_random(false), aggregate_only(false)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -937,6 +1021,10 @@ namespace Legion {
                                           TaskID tid, SingleTask *task)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_TASK, task->get_unique_id(),
+            always_sampled_tasks.find(task->task_id) != 
+              always_sampled_tasks.end()))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_TASK);
 #else
@@ -954,6 +1042,13 @@ namespace Legion {
                 Realm::ProfilingMeasurements::OperationProcessorUsage>();
       req.add_measurement<
                 Realm::ProfilingMeasurements::OperationEventWaits>();
+      if (perf_counters)
+      {
+        req.add_measurement<
+                Realm::ProfilingMeasurements::IPCPerfCounters>();
+        req.add_measurement<
+                Realm::ProfilingMeasurements::L3CachePerfCounters>();
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -961,6 +1056,9 @@ namespace Legion {
                                           LgTaskID tid, Operation *op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_META, 
+            (op != NULL) ? op->get_unique_op_id() : 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_META);
 #else
@@ -1003,6 +1101,9 @@ namespace Legion {
                                           Operation *op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_COPY,
+            (op != NULL) ? op->get_unique_op_id() : 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_COPY);
 #else
@@ -1025,6 +1126,9 @@ namespace Legion {
                                           Operation *op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_FILL,
+            (op != NULL) ? op->get_unique_op_id() : 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_FILL);
 #else
@@ -1076,6 +1180,9 @@ namespace Legion {
                                            Operation *op, DepPartOpKind part_op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_PARTITION,
+            (op != NULL) ? op->get_unique_op_id() : 0))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_PARTITION);
 #else
@@ -1097,6 +1204,8 @@ namespace Legion {
                                           TaskID tid, UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_TASK, uid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_TASK);
 #else
@@ -1114,6 +1223,13 @@ namespace Legion {
                 Realm::ProfilingMeasurements::OperationProcessorUsage>();
       req.add_measurement<
                 Realm::ProfilingMeasurements::OperationEventWaits>();
+      if (perf_counters)
+      {
+        req.add_measurement<
+                Realm::ProfilingMeasurements::IPCPerfCounters>();
+        req.add_measurement<
+                Realm::ProfilingMeasurements::L3CachePerfCounters>();
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -1121,6 +1237,8 @@ namespace Legion {
                                           LgTaskID tid, UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_META, uid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_META);
 #else
@@ -1145,6 +1263,8 @@ namespace Legion {
                                           UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_COPY, uid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_COPY);
 #else
@@ -1167,6 +1287,8 @@ namespace Legion {
                                           UniqueID uid)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_FILL, uid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_FILL);
 #else
@@ -1218,6 +1340,8 @@ namespace Legion {
                                            UniqueID uid, DepPartOpKind part_op)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_PARTITION, uid))
+        return;
 #ifdef DEBUG_LEGION
       increment_total_outstanding_requests(LEGION_PROF_PARTITION);
 #else
@@ -1267,10 +1391,23 @@ namespace Legion {
             Realm::ProfilingMeasurements::OperationEventWaits waits;
             response.get_measurement<
                   Realm::ProfilingMeasurements::OperationEventWaits>(waits);
+            // Counters are only present if requested and available
+            Realm::ProfilingMeasurements::IPCPerfCounters ipc;
+            const bool has_ipc = response.get_measurement<
+                  Realm::ProfilingMeasurements::IPCPerfCounters>(ipc);
+            Realm::ProfilingMeasurements::L3CachePerfCounters llc;
+            const bool has_llc = response.get_measurement<
+                  Realm::ProfilingMeasurements::L3CachePerfCounters>(llc);
             // Ignore anything that was predicated false for now
-            if (has_usage)
+            if (!has_usage)
+              break;
+            if (aggregate_only)
+              thread_local_profiling_instance->process_aggregate(info->kind,
+                  info->id, timeline);
+            else
               thread_local_profiling_instance->process_task(info->id, 
-                  info->op_id, timeline, usage, waits);
+                  info->op_id, timeline, usage, waits,
+                  has_ipc ? &ipc : NULL, has_llc ? &llc : NULL);
             break;
           }
         case LEGION_PROF_META:
@@ -1291,7 +1428,12 @@ namespace Legion {
             response.get_measurement<
                   Realm::ProfilingMeasurements::OperationEventWaits>(waits);
             // Ignore anything that was predicated false for now
-            if (has_usage)
+            if (!has_usage)
+              break;
+            if (aggregate_only)
+              thread_local_profiling_instance->process_aggregate(info->kind,
+                  info->id, timeline);
+            else
               thread_local_profiling_instance->process_meta(info->id, 
                   info->op_id, timeline, usage, waits);
             break;
@@ -1333,7 +1475,12 @@ namespace Legion {
             const bool has_usage = response.get_measurement<
                   Realm::ProfilingMeasurements::OperationMemoryUsage>(usage);
             // Ignore anything that was predicated false for now
-            if (has_usage)
+            if (!has_usage)
+              break;
+            if (aggregate_only)
+              thread_local_profiling_instance->process_aggregate(info->kind,
+                  0/*no id*/, timeline);
+            else
               thread_local_profiling_instance->process_copy(info->op_id,
                                                             timeline, usage);
             break;
@@ -1353,7 +1500,12 @@ namespace Legion {
             const bool has_usage = response.get_measurement<
                     Realm::ProfilingMeasurements::OperationMemoryUsage>(usage);
             // Ignore anything that was predicated false for now
-            if (has_usage)
+            if (!has_usage)
+              break;
+            if (aggregate_only)
+              thread_local_profiling_instance->process_aggregate(info->kind,
+                  0/*no id*/, timeline);
+            else
               thread_local_profiling_instance->process_fill(info->op_id,
                                                             timeline, usage);
             break;
@@ -1391,7 +1543,11 @@ namespace Legion {
             Realm::ProfilingMeasurements::OperationTimeline timeline;
             response.get_measurement<
                   Realm::ProfilingMeasurements::OperationTimeline>(timeline);
-            thread_local_profiling_instance->process_partition(info->op_id,
+            if (aggregate_only)
+              thread_local_profiling_instance->process_aggregate(info->kind,
+                  info->id, timeline);
+            else
+              thread_local_profiling_instance->process_partition(info->op_id,
                                         (DepPartOpKind)info->id, timeline);
             break;
           }
@@ -1428,6 +1584,25 @@ namespace Legion {
 #endif
       if (!done_event.has_triggered())
         done_event.lg_wait();
+      // Record the realized sampling ratio for each kind of record
+      if ((sample_interval > 1) || aggregate_only)
+      {
+        const char *const kind_names[LEGION_PROF_LAST] = {
+          "task", "meta", "message", "copy", "fill", 
+          "instance", "partition", "mapper_call" };
+        for (unsigned idx = 0; idx < LEGION_PROF_LAST; idx++)
+        {
+          if (sample_totals[idx] == 0)
+            continue;
+          LegionProfDesc::SampleDesc sample_desc;
+          sample_desc.kind = idx;
+          sample_desc.name = kind_names[idx];
+          sample_desc.interval = sample_interval;
+          sample_desc.total = sample_totals[idx];
+          sample_desc.sampled = sample_counts[idx];
+          serializer->serialize(sample_desc);
+        }
+      }
       for (std::vector<LegionProfInstance*>::const_iterator it = 
             instances.begin(); it != instances.end(); it++) {
         (*it)->dump_state(serializer);
@@ -1490,6 +1665,8 @@ namespace Legion {
                               unsigned long long start, unsigned long long stop)
     //--------------------------------------------------------------------------
     {
+      if (!sample_operation(LEGION_PROF_MAPPER_CALL, uid))
+        return;
       Processor current = Processor::get_executing_processor();
       if (thread_local_profiling_instance == NULL)
         create_thread_local_profiling_instance();
@@ -1665,6 +1842,35 @@ namespace Legion {
       instances.push_back(thread_local_profiling_instance);
     }
 
+    //--------------------------------------------------------------------------
+    bool LegionProfiler::sample_operation(ProfilingKind kind, UniqueID op_id,
+                                          bool always)
+    //--------------------------------------------------------------------------
+    {
+      const unsigned long long count = 
+        __sync_fetch_and_add(&sample_totals[kind], 1);
+      if (!always && (sample_interval > 1))
+      {
+        // Sample by operation so that all the records for an operation
+        // are kept together, things without one are sampled by count
+        unsigned long long key = (op_id > 0) ? op_id : count;
+        if (sample_random)
+        {
+          // Mix the bits so that the choice looks random but is 
+          // still the same for every record of an operation
+          key ^= key >> 33;
+          key *= 0xff51afd7ed558ccdULL;
+          key ^= key >> 33;
+          key *= 0xc4ceb9fe1a85ec53ULL;
+          key ^= key >> 33;
+        }
+        if ((key % sample_interval) != 0)
+          return false;
+      }
+      __sync_fetch_and_add(&sample_counts[kind], 1);
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     DetailedProfiler::DetailedProfiler(Runtime *runtime, RuntimeCallKind call)
       : profiler(runtime->profiler), call_kind(call), start_time(0)
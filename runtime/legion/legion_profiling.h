@@ -98,6 +98,14 @@ namespace Legion {
         MemKind kind;
         unsigned long long capacity;
       };
+      // Realized sampling ratio for one kind of profiling record
+      struct SampleDesc {
+      public:
+        unsigned kind;
+        const char *name;
+        unsigned interval;
+        unsigned long long total, sampled;
+      };
     };
 
     class LegionProfInstance {
@@ -133,6 +141,12 @@ namespace Legion {
       public:
         timestamp_t wait_start, wait_ready, wait_end;
       };
+      // hardware counters for a task (-1 for any that weren't available)
+      struct PerfInfo {
+      public:
+        long long total_insts, total_cycles;
+        long long llc_accesses, llc_misses;
+      };
       struct TaskInfo {
       public:
         UniqueID op_id;
@@ -140,6 +154,8 @@ namespace Legion {
         ProcID proc_id;
         timestamp_t create, ready, start, stop;
         std::deque<WaitInfo> wait_intervals;
+        bool has_perf;
+        PerfInfo perf;
       };
       struct MetaInfo {
       public:
@@ -206,6 +222,15 @@ namespace Legion {
         timestamp_t start, stop;
         ProcID proc_id;
       };
+      // Statistics kept in place of the records for each kind of
+      // operation (and variant, meta-task or partition kind)
+      struct AggregateInfo {
+      public:
+        unsigned kind;
+        unsigned long long id;
+        unsigned long long count;
+        timestamp_t total, min, max;
+      };
 #ifdef LEGION_PROF_SELF_PROFILE
       struct ProfTaskInfo {
       public:
@@ -232,7 +257,9 @@ namespace Legion {
       void process_task(VariantID variant_id, UniqueID op_id, 
             const Realm::ProfilingMeasurements::OperationTimeline &timeline,
             const Realm::ProfilingMeasurements::OperationProcessorUsage &usage,
-            const Realm::ProfilingMeasurements::OperationEventWaits &waits);
+            const Realm::ProfilingMeasurements::OperationEventWaits &waits,
+            const Realm::ProfilingMeasurements::IPCPerfCounters *ipc = NULL,
+            const Realm::ProfilingMeasurements::L3CachePerfCounters *llc = NULL);
       void process_meta(size_t id, UniqueID op_id,
             const Realm::ProfilingMeasurements::OperationTimeline &timeline,
             const Realm::ProfilingMeasurements::OperationProcessorUsage &usage,
@@ -255,6 +282,8 @@ namespace Legion {
             const Realm::ProfilingMeasurements::InstanceTimeline &timeline);
       void process_partition(UniqueID op_id, DepPartOpKind part_op,
             const Realm::ProfilingMeasurements::OperationTimeline &timeline);
+      void process_aggregate(unsigned kind, unsigned long long id,
+            const Realm::ProfilingMeasurements::OperationTimeline &timeline);
     public:
       void record_message(Processor proc, MessageKind kind, timestamp_t start,
                           timestamp_t stop);
@@ -291,6 +320,9 @@ namespace Legion {
       std::deque<MessageInfo> message_infos;
       std::deque<MapperCallInfo> mapper_call_infos;
       std::deque<RuntimeCallInfo> runtime_call_infos;
+    private:
+      std::map<std::pair<unsigned,unsigned long long>,
+               AggregateInfo> aggregate_infos;
 #ifdef LEGION_PROF_SELF_PROFILE
     private:
       std::deque<ProfTaskInfo> prof_task_infos;
@@ -307,6 +339,7 @@ namespace Legion {
         LEGION_PROF_FILL,
         LEGION_PROF_INST,
         LEGION_PROF_PARTITION,
+        LEGION_PROF_MAPPER_CALL, // only used for sampling
         LEGION_PROF_LAST,
       };
       struct ProfilingInfo : public ProfilingResponseBase {
@@ -336,7 +369,13 @@ namespace Legion {
                      const char *prof_logname,
                      const size_t total_runtime_instances,
                      const size_t footprint_threshold,
-                     const size_t target_latency);
+                     const size_t target_latency,
+                     const bool perf_counters,
+                     const bool proc_chunks,
+                     const unsigned sample_interval,
+                     const bool sample_random,
+                     const char *sample_tasks,
+                     const bool aggregate_only);
       LegionProfiler(const LegionProfiler &rhs);
       virtual ~LegionProfiler(void);
     public:
@@ -425,6 +464,8 @@ namespace Legion {
       void perform_intermediate_output(void);
     private:
       void create_thread_local_profiling_instance(void);
+      bool sample_operation(ProfilingKind kind, UniqueID op_id,
+                            bool always = false);
     public:
       Runtime *const runtime;
       // Event to trigger once the profiling is actually done
@@ -435,10 +476,23 @@ namespace Legion {
       const long long output_target_latency;
       // Target processor on which to launch jobs
       const Processor target_proc;
+      // Whether to sample hardware counters for every task
+      const bool perf_counters;
+      // Record one in every sample_interval operations, either every
+      // Nth one or a pseudo-random selection by unique ID
+      const unsigned sample_interval;
+      const bool sample_random;
+      // Only keep aggregate statistics instead of individual records
+      // for tasks, meta-tasks, copies, fills and partitions
+      const bool aggregate_only;
     private:
       LegionProfSerializer* serializer;
       Reservation profiler_lock;
       std::vector<LegionProfInstance*> instances;
+      // Tasks that are always recorded regardless of sampling
+      std::set<TaskID> always_sampled_tasks;
+      unsigned long long sample_totals[LEGION_PROF_LAST];
+      unsigned long long sample_counts[LEGION_PROF_LAST];
 #ifdef DEBUG_LEGION
       unsigned total_outstanding_requests[LEGION_PROF_LAST];
 #else
@@ -15,16 +15,201 @@ namespace Legion {
     extern Realm::Logger log_prof;
 
     //--------------------------------------------------------------------------
-    LegionProfBinarySerializer::LegionProfBinarySerializer(std::string filename)
+    LegionProfBinarySerializer::LegionProfBinarySerializer(std::string filename,
+                                                           bool proc_chunks)
     //--------------------------------------------------------------------------
+      : index_filename(filename + ".idx"), per_proc_chunks(proc_chunks),
+        current_chunk(&metadata_chunk), output_offset(0),
+        active_buffer(0), active_size(0), pending_buffer(NULL), 
+        pending_size(0), writer_done(false)
     {
+#ifdef USE_ZLIB
+      char mode[8];
+      snprintf(mode, sizeof(mode), "wb%d", LEGION_PROF_COMPRESSION_LEVEL);
+      f = lp_fopen(filename, mode);
+#else
       f = lp_fopen(filename, "wb");
+#endif
       if (!f)
         REPORT_LEGION_ERROR(ERROR_INVALID_PROFILER_FILE,
             "Unable to open legion logfile %s for writing!", filename.c_str())
+      buffers[0] = (char*)malloc(LEGION_PROF_OUTPUT_BUFFER_SIZE);
+      buffers[1] = (char*)malloc(LEGION_PROF_OUTPUT_BUFFER_SIZE);
+      pthread_mutex_init(&writer_lock, NULL);
+      pthread_cond_init(&writer_cond, NULL);
+      if (pthread_create(&writer_thread, NULL, writer_thread_main, this))
+        REPORT_LEGION_ERROR(ERROR_INVALID_PROFILER_FILE,
+            "Unable to create writer thread for legion logfile %s!",
+            filename.c_str())
       writePreamble();
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::begin_record(void)
+    //--------------------------------------------------------------------------
+    {
+      current_chunk = &metadata_chunk;
+      if (metadata_chunk.data.size() >= LEGION_PROF_CHUNK_SIZE)
+        write_chunk(metadata_chunk, METADATA_CHUNK);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::begin_record(ProcID proc_id,
+                                      timestamp_t start, timestamp_t stop)
+    //--------------------------------------------------------------------------
+    {
+      // Without the per-processor layout all timed records share a chunk
+      if (!per_proc_chunks)
+        proc_id = 0;
+      OutputChunk &chunk = timed_chunks[proc_id];
+      if (chunk.data.size() >= LEGION_PROF_CHUNK_SIZE)
+        write_chunk(chunk, TIMED_CHUNK);
+      if (chunk.data.empty())
+      {
+        chunk.proc_id = proc_id;
+        chunk.start = start;
+        chunk.stop = stop;
+      }
+      else
+      {
+        if (start < chunk.start)
+          chunk.start = start;
+        if (stop > chunk.stop)
+          chunk.stop = stop;
+      }
+      current_chunk = &chunk;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::write_bytes(const void *data,
+                                                 size_t num_bytes)
+    //--------------------------------------------------------------------------
+    {
+      const char *ptr = (const char*)data;
+      current_chunk->data.insert(current_chunk->data.end(), 
+                                 ptr, ptr + num_bytes);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::write_chunk(OutputChunk &chunk,
+                                                 unsigned kind)
+    //--------------------------------------------------------------------------
+    {
+      if (chunk.data.empty())
+        return;
+      // Timed records can refer to descriptions and operations in the
+      // metadata so make sure that everything before them is written
+      // first, which keeps the log readable from front to back
+      if (kind == TIMED_CHUNK)
+        write_chunk(metadata_chunk, METADATA_CHUNK);
+      ChunkIndexEntry entry;
+      entry.offset = output_offset;
+      entry.size = chunk.data.size();
+      entry.proc_id = chunk.proc_id;
+      entry.start = chunk.start;
+      entry.stop = chunk.stop;
+      entry.kind = kind;
+      entry.padding = 0;
+      chunk_index.push_back(entry);
+      write_output(&chunk.data.front(), chunk.data.size());
+      chunk.data.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::write_index(void)
+    //--------------------------------------------------------------------------
+    {
+      FILE *index_file = fopen(index_filename.c_str(), "wb");
+      if (index_file == NULL)
+      {
+        log_prof.warning("Unable to open legion prof index file %s",
+                         index_filename.c_str());
+        return;
+      }
+      const unsigned header[2] = { INDEX_MAGIC, INDEX_VERSION };
+      fwrite(header, sizeof(header), 1, index_file);
+      if (!chunk_index.empty())
+        fwrite(&chunk_index.front(), sizeof(ChunkIndexEntry),
+               chunk_index.size(), index_file);
+      fclose(index_file);
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::write_output(const void *data,
+                                                  size_t num_bytes)
+    //--------------------------------------------------------------------------
+    {
+      output_offset += num_bytes;
+      const char *ptr = (const char*)data;
+      while (num_bytes > 0)
+      {
+        if (active_size == LEGION_PROF_OUTPUT_BUFFER_SIZE)
+          flush_buffer();
+        size_t chunk = LEGION_PROF_OUTPUT_BUFFER_SIZE - active_size;
+        if (num_bytes < chunk)
+          chunk = num_bytes;
+        memcpy(buffers[active_buffer] + active_size, ptr, chunk);
+        active_size += chunk;
+        ptr += chunk;
+        num_bytes -= chunk;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::flush_buffer(void)
+    //--------------------------------------------------------------------------
+    {
+      if (active_size == 0)
+        return;
+      pthread_mutex_lock(&writer_lock);
+      // Only block if the writer is still busy with the other buffer
+      while (pending_buffer != NULL)
+        pthread_cond_wait(&writer_cond, &writer_lock);
+      pending_buffer = buffers[active_buffer];
+      pending_size = active_size;
+      pthread_cond_broadcast(&writer_cond);
+      pthread_mutex_unlock(&writer_lock);
+      active_buffer = 1 - active_buffer;
+      active_size = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::writer_loop(void)
+    //--------------------------------------------------------------------------
+    {
+      pthread_mutex_lock(&writer_lock);
+      while (true)
+      {
+        if (pending_buffer != NULL)
+        {
+          const char *buffer = pending_buffer;
+          const size_t size = pending_size;
+          // Do the I/O (and compression) without holding the lock
+          pthread_mutex_unlock(&writer_lock);
+          lp_fwrite(f, buffer, size);
+          pthread_mutex_lock(&writer_lock);
+          pending_buffer = NULL;
+          pending_size = 0;
+          pthread_cond_broadcast(&writer_cond);
+        }
+        else if (writer_done)
+          break;
+        else
+          pthread_cond_wait(&writer_cond, &writer_lock);
+      }
+      pthread_mutex_unlock(&writer_lock);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void* LegionProfBinarySerializer::writer_thread_main(void *args)
+    //--------------------------------------------------------------------------
+    {
+      LegionProfBinarySerializer *serializer = 
+        static_cast<LegionProfBinarySerializer*>(args);
+      serializer->writer_loop();
+      return NULL;
+    }
+
     // Every legion prof instance that you want to serialize must be written 
     // in the preamble. The preamble defines the format that we'll use for 
     // the serialization.
@@ -152,6 +337,15 @@ namespace Legion {
          << "stop:timestamp_t:"    << sizeof(timestamp_t)
          << "}" << std::endl;
 
+      ss << "TaskPerfInfo {"
+         << "id:" << TASK_PERF_INFO_ID                     << delim
+         << "op_id:UniqueID:"       << sizeof(UniqueID)    << delim
+         << "total_insts:long long:"  << sizeof(long long) << delim
+         << "total_cycles:long long:" << sizeof(long long) << delim
+         << "llc_accesses:long long:" << sizeof(long long) << delim
+         << "llc_misses:long long:"   << sizeof(long long)
+         << "}" << std::endl;
+
       ss << "MetaInfo {"
          << "id:" << META_INFO_ID                         << delim
          << "op_id:UniqueID:"     << sizeof(UniqueID)     << delim
@@ -243,6 +437,25 @@ namespace Legion {
          << "proc_id:ProcID:"       << sizeof(ProcID)
          << "}" << std::endl;
 
+      ss << "SampleDesc {"
+         << "id:" << SAMPLE_DESC_ID                            << delim
+         << "kind:unsigned:"     << sizeof(unsigned)           << delim
+         << "interval:unsigned:" << sizeof(unsigned)           << delim
+         << "total:unsigned long long:"   << sizeof(unsigned long long) << delim
+         << "sampled:unsigned long long:" << sizeof(unsigned long long) << delim
+         << "name:string:"       << "-1"
+         << "}" << std::endl;
+
+      ss << "AggregateInfo {"
+         << "id:" << AGGREGATE_INFO_ID                         << delim
+         << "kind:unsigned:"     << sizeof(unsigned)           << delim
+         << "agg_id:unsigned long long:" << sizeof(unsigned long long) << delim
+         << "count:unsigned long long:"  << sizeof(unsigned long long) << delim
+         << "total_time:timestamp_t:" << sizeof(timestamp_t)   << delim
+         << "min_time:timestamp_t:"   << sizeof(timestamp_t)   << delim
+         << "max_time:timestamp_t:"   << sizeof(timestamp_t)
+         << "}" << std::endl;
+
 #ifdef LEGION_PROF_SELF_PROFILE
       ss << "ProfTaskInfo {"
          << "id:" << PROFTASK_INFO_ID                        << delim
@@ -257,7 +470,7 @@ namespace Legion {
       ss << std::endl;
       std::string preamble = ss.str();
 
-      lp_fwrite(f, preamble.c_str(), strlen(preamble.c_str()));
+      write_output(preamble.c_str(), strlen(preamble.c_str()));
     }
 
 
@@ -267,10 +480,11 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // XXX: For now, we will assume little endian
+      begin_record();
       int ID = MESSAGE_DESC_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(message_desc.kind), sizeof(message_desc.kind));
-      lp_fwrite(f, message_desc.name, strlen(message_desc.name) + 1);
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(message_desc.kind), sizeof(message_desc.kind));
+      write_bytes(message_desc.name, strlen(message_desc.name) + 1);
     }
 
     //--------------------------------------------------------------------------
@@ -278,10 +492,11 @@ namespace Legion {
                          const LegionProfDesc::MapperCallDesc &mapper_call_desc)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = MAPPER_CALL_DESC_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(mapper_call_desc.kind), sizeof(mapper_call_desc.kind));
-      lp_fwrite(f, mapper_call_desc.name, strlen(mapper_call_desc.name) + 1);
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(mapper_call_desc.kind), sizeof(mapper_call_desc.kind));
+      write_bytes(mapper_call_desc.name, strlen(mapper_call_desc.name) + 1);
     }
 
     //--------------------------------------------------------------------------
@@ -289,11 +504,12 @@ namespace Legion {
                        const LegionProfDesc::RuntimeCallDesc &runtime_call_desc)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = RUNTIME_CALL_DESC_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(runtime_call_desc.kind), 
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(runtime_call_desc.kind), 
                 sizeof(runtime_call_desc.kind));
-      lp_fwrite(f, runtime_call_desc.name, strlen(runtime_call_desc.name) + 1);
+      write_bytes(runtime_call_desc.name, strlen(runtime_call_desc.name) + 1);
     }
 
     //--------------------------------------------------------------------------
@@ -301,10 +517,11 @@ namespace Legion {
                                       const LegionProfDesc::MetaDesc& meta_desc)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = META_DESC_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(meta_desc.kind), sizeof(meta_desc.kind));
-      lp_fwrite(f, meta_desc.name, strlen(meta_desc.name) + 1);
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(meta_desc.kind), sizeof(meta_desc.kind));
+      write_bytes(meta_desc.name, strlen(meta_desc.name) + 1);
     }
 
     //--------------------------------------------------------------------------
@@ -312,10 +529,11 @@ namespace Legion {
                                           const LegionProfDesc::OpDesc& op_desc)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = OP_DESC_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(op_desc.kind), sizeof(op_desc.kind));
-      lp_fwrite(f, op_desc.name, strlen(op_desc.name) + 1);
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(op_desc.kind), sizeof(op_desc.kind));
+      write_bytes(op_desc.name, strlen(op_desc.name) + 1);
     }
 
     //--------------------------------------------------------------------------
@@ -323,10 +541,11 @@ namespace Legion {
                                       const LegionProfDesc::ProcDesc& proc_desc)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = PROC_DESC_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(proc_desc.proc_id), sizeof(proc_desc.proc_id));
-      lp_fwrite(f, (char*)&(proc_desc.kind),    sizeof(proc_desc.kind));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(proc_desc.proc_id), sizeof(proc_desc.proc_id));
+      write_bytes((char*)&(proc_desc.kind),    sizeof(proc_desc.kind));
     }
 
     //--------------------------------------------------------------------------
@@ -334,11 +553,27 @@ namespace Legion {
                                         const LegionProfDesc::MemDesc& mem_desc)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = MEM_DESC_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(mem_desc.mem_id),   sizeof(mem_desc.mem_id));
-      lp_fwrite(f, (char*)&(mem_desc.kind),     sizeof(mem_desc.kind));
-      lp_fwrite(f, (char*)&(mem_desc.capacity), sizeof(mem_desc.capacity));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(mem_desc.mem_id),   sizeof(mem_desc.mem_id));
+      write_bytes((char*)&(mem_desc.kind),     sizeof(mem_desc.kind));
+      write_bytes((char*)&(mem_desc.capacity), sizeof(mem_desc.capacity));
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                                  const LegionProfDesc::SampleDesc& sample_desc)
+    //--------------------------------------------------------------------------
+    {
+      begin_record();
+      int ID = SAMPLE_DESC_ID;
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(sample_desc.kind),     sizeof(sample_desc.kind));
+      write_bytes((char*)&(sample_desc.interval), sizeof(sample_desc.interval));
+      write_bytes((char*)&(sample_desc.total),    sizeof(sample_desc.total));
+      write_bytes((char*)&(sample_desc.sampled),  sizeof(sample_desc.sampled));
+      write_bytes(sample_desc.name, strlen(sample_desc.name) + 1);
     }
 
     // Serialize Methods
@@ -348,11 +583,12 @@ namespace Legion {
                                   const LegionProfInstance::TaskKind& task_kind)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = TASK_KIND_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(task_kind.task_id), sizeof(task_kind.task_id));
-      lp_fwrite(f, task_kind.name, strlen(task_kind.name) + 1);
-      lp_fwrite(f, (char*)&(task_kind.overwrite), sizeof(task_kind.overwrite));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(task_kind.task_id), sizeof(task_kind.task_id));
+      write_bytes(task_kind.name, strlen(task_kind.name) + 1);
+      write_bytes((char*)&(task_kind.overwrite), sizeof(task_kind.overwrite));
     }
 
     //--------------------------------------------------------------------------
@@ -360,12 +596,13 @@ namespace Legion {
                             const LegionProfInstance::TaskVariant& task_variant)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = TASK_VARIANT_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(task_variant.task_id),sizeof(task_variant.task_id));
-      lp_fwrite(f, (char*)&(task_variant.variant_id), 
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(task_variant.task_id),sizeof(task_variant.task_id));
+      write_bytes((char*)&(task_variant.variant_id), 
                 sizeof(task_variant.variant_id));
-      lp_fwrite(f, task_variant.name, strlen(task_variant.name) + 1);
+      write_bytes(task_variant.name, strlen(task_variant.name) + 1);
     }
 
     //--------------------------------------------------------------------------
@@ -373,11 +610,12 @@ namespace Legion {
                 const LegionProfInstance::OperationInstance& operation_instance)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = OPERATION_INSTANCE_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(operation_instance.op_id), 
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(operation_instance.op_id), 
                 sizeof(operation_instance.op_id));
-      lp_fwrite(f, (char*)&(operation_instance.kind),
+      write_bytes((char*)&(operation_instance.kind),
                 sizeof(operation_instance.kind));
     }
 
@@ -386,10 +624,11 @@ namespace Legion {
                                 const LegionProfInstance::MultiTask& multi_task)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = MULTI_TASK_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(multi_task.op_id),   sizeof(multi_task.op_id));
-      lp_fwrite(f, (char*)&(multi_task.task_id), sizeof(multi_task.task_id));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(multi_task.op_id),   sizeof(multi_task.op_id));
+      write_bytes((char*)&(multi_task.task_id), sizeof(multi_task.task_id));
     }
 
     //--------------------------------------------------------------------------
@@ -397,11 +636,12 @@ namespace Legion {
                               const LegionProfInstance::SliceOwner& slice_owner)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = SLICE_OWNER_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(slice_owner.parent_id), 
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(slice_owner.parent_id), 
                 sizeof(slice_owner.parent_id));
-      lp_fwrite(f, (char*)&(slice_owner.op_id), sizeof(slice_owner.op_id));
+      write_bytes((char*)&(slice_owner.op_id), sizeof(slice_owner.op_id));
     }
 
     //--------------------------------------------------------------------------
@@ -410,13 +650,15 @@ namespace Legion {
                                   const LegionProfInstance::TaskInfo& task_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(task_info.proc_id, wait_info.wait_start, 
+                   wait_info.wait_end);
       int ID = TASK_WAIT_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(task_info.op_id),     sizeof(task_info.op_id));
-      lp_fwrite(f, (char*)&(task_info.variant_id),sizeof(task_info.variant_id));
-      lp_fwrite(f, (char*)&(wait_info.wait_start),sizeof(wait_info.wait_start));
-      lp_fwrite(f, (char*)&(wait_info.wait_ready),sizeof(wait_info.wait_ready));
-      lp_fwrite(f, (char*)&(wait_info.wait_end),  sizeof(wait_info.wait_end));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(task_info.op_id),     sizeof(task_info.op_id));
+      write_bytes((char*)&(task_info.variant_id),sizeof(task_info.variant_id));
+      write_bytes((char*)&(wait_info.wait_start),sizeof(wait_info.wait_start));
+      write_bytes((char*)&(wait_info.wait_ready),sizeof(wait_info.wait_ready));
+      write_bytes((char*)&(wait_info.wait_end),  sizeof(wait_info.wait_end));
     }
 
     //--------------------------------------------------------------------------
@@ -425,29 +667,52 @@ namespace Legion {
                                   const LegionProfInstance::MetaInfo& meta_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(meta_info.proc_id, wait_info.wait_start, 
+                   wait_info.wait_end);
       int ID = META_WAIT_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(meta_info.op_id),     sizeof(meta_info.op_id));
-      lp_fwrite(f, (char*)&(meta_info.lg_id),     sizeof(meta_info.lg_id));
-      lp_fwrite(f, (char*)&(wait_info.wait_start),sizeof(wait_info.wait_start));
-      lp_fwrite(f, (char*)&(wait_info.wait_ready),sizeof(wait_info.wait_ready));
-      lp_fwrite(f, (char*)&(wait_info.wait_end),  sizeof(wait_info.wait_end));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(meta_info.op_id),     sizeof(meta_info.op_id));
+      write_bytes((char*)&(meta_info.lg_id),     sizeof(meta_info.lg_id));
+      write_bytes((char*)&(wait_info.wait_start),sizeof(wait_info.wait_start));
+      write_bytes((char*)&(wait_info.wait_ready),sizeof(wait_info.wait_ready));
+      write_bytes((char*)&(wait_info.wait_end),  sizeof(wait_info.wait_end));
     }
  
     //--------------------------------------------------------------------------
     void LegionProfBinarySerializer::serialize(
+                                  const LegionProfInstance::PerfInfo& perf_info,
                                   const LegionProfInstance::TaskInfo& task_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(task_info.proc_id, task_info.start, task_info.stop);
+      int ID = TASK_PERF_INFO_ID;
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(task_info.op_id),     sizeof(task_info.op_id));
+      write_bytes((char*)&(perf_info.total_insts), 
+                sizeof(perf_info.total_insts));
+      write_bytes((char*)&(perf_info.total_cycles), 
+                sizeof(perf_info.total_cycles));
+      write_bytes((char*)&(perf_info.llc_accesses), 
+                sizeof(perf_info.llc_accesses));
+      write_bytes((char*)&(perf_info.llc_misses), 
+                sizeof(perf_info.llc_misses));
+    }
+
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                                  const LegionProfInstance::TaskInfo& task_info)
+    //--------------------------------------------------------------------------
+    {
+      begin_record(task_info.proc_id, task_info.start, task_info.stop);
       int ID = TASK_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(task_info.op_id),     sizeof(task_info.op_id));
-      lp_fwrite(f, (char*)&(task_info.variant_id),sizeof(task_info.variant_id));
-      lp_fwrite(f, (char*)&(task_info.proc_id),   sizeof(task_info.proc_id));
-      lp_fwrite(f, (char*)&(task_info.create),    sizeof(task_info.create));
-      lp_fwrite(f, (char*)&(task_info.ready),     sizeof(task_info.ready));
-      lp_fwrite(f, (char*)&(task_info.start),     sizeof(task_info.start));
-      lp_fwrite(f, (char*)&(task_info.stop),      sizeof(task_info.stop));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(task_info.op_id),     sizeof(task_info.op_id));
+      write_bytes((char*)&(task_info.variant_id),sizeof(task_info.variant_id));
+      write_bytes((char*)&(task_info.proc_id),   sizeof(task_info.proc_id));
+      write_bytes((char*)&(task_info.create),    sizeof(task_info.create));
+      write_bytes((char*)&(task_info.ready),     sizeof(task_info.ready));
+      write_bytes((char*)&(task_info.start),     sizeof(task_info.start));
+      write_bytes((char*)&(task_info.stop),      sizeof(task_info.stop));
     }
 
     //--------------------------------------------------------------------------
@@ -455,15 +720,16 @@ namespace Legion {
                                   const LegionProfInstance::MetaInfo& meta_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(meta_info.proc_id, meta_info.start, meta_info.stop);
       int ID = META_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(meta_info.op_id),   sizeof(meta_info.op_id));
-      lp_fwrite(f, (char*)&(meta_info.lg_id),   sizeof(meta_info.lg_id));
-      lp_fwrite(f, (char*)&(meta_info.proc_id), sizeof(meta_info.proc_id));
-      lp_fwrite(f, (char*)&(meta_info.create),  sizeof(meta_info.create));
-      lp_fwrite(f, (char*)&(meta_info.ready),   sizeof(meta_info.ready));
-      lp_fwrite(f, (char*)&(meta_info.start),   sizeof(meta_info.start));
-      lp_fwrite(f, (char*)&(meta_info.stop),    sizeof(meta_info.stop));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(meta_info.op_id),   sizeof(meta_info.op_id));
+      write_bytes((char*)&(meta_info.lg_id),   sizeof(meta_info.lg_id));
+      write_bytes((char*)&(meta_info.proc_id), sizeof(meta_info.proc_id));
+      write_bytes((char*)&(meta_info.create),  sizeof(meta_info.create));
+      write_bytes((char*)&(meta_info.ready),   sizeof(meta_info.ready));
+      write_bytes((char*)&(meta_info.start),   sizeof(meta_info.start));
+      write_bytes((char*)&(meta_info.stop),    sizeof(meta_info.stop));
     }
 
     //--------------------------------------------------------------------------
@@ -471,17 +737,18 @@ namespace Legion {
                                   const LegionProfInstance::CopyInfo& copy_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(0/*no proc*/, copy_info.start, copy_info.stop);
       int ID = COPY_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-
-      lp_fwrite(f, (char*)&(copy_info.op_id),  sizeof(copy_info.op_id));
-      lp_fwrite(f, (char*)&(copy_info.src),    sizeof(copy_info.src));
-      lp_fwrite(f, (char*)&(copy_info.dst),    sizeof(copy_info.dst));
-      lp_fwrite(f, (char*)&(copy_info.size),   sizeof(copy_info.size));
-      lp_fwrite(f, (char*)&(copy_info.create), sizeof(copy_info.create));
-      lp_fwrite(f, (char*)&(copy_info.ready),  sizeof(copy_info.ready));
-      lp_fwrite(f, (char*)&(copy_info.start),  sizeof(copy_info.start));
-      lp_fwrite(f, (char*)&(copy_info.stop),   sizeof(copy_info.stop));
+      write_bytes((char*)&ID, sizeof(ID));
+
+      write_bytes((char*)&(copy_info.op_id),  sizeof(copy_info.op_id));
+      write_bytes((char*)&(copy_info.src),    sizeof(copy_info.src));
+      write_bytes((char*)&(copy_info.dst),    sizeof(copy_info.dst));
+      write_bytes((char*)&(copy_info.size),   sizeof(copy_info.size));
+      write_bytes((char*)&(copy_info.create), sizeof(copy_info.create));
+      write_bytes((char*)&(copy_info.ready),  sizeof(copy_info.ready));
+      write_bytes((char*)&(copy_info.start),  sizeof(copy_info.start));
+      write_bytes((char*)&(copy_info.stop),   sizeof(copy_info.stop));
     }
 
     //--------------------------------------------------------------------------
@@ -489,15 +756,16 @@ namespace Legion {
                                   const LegionProfInstance::FillInfo& fill_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(0/*no proc*/, fill_info.start, fill_info.stop);
       int ID = FILL_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-
-      lp_fwrite(f, (char*)&(fill_info.op_id),  sizeof(fill_info.op_id));
-      lp_fwrite(f, (char*)&(fill_info.dst),    sizeof(fill_info.dst));
-      lp_fwrite(f, (char*)&(fill_info.create), sizeof(fill_info.create));
-      lp_fwrite(f, (char*)&(fill_info.ready),  sizeof(fill_info.ready));
-      lp_fwrite(f, (char*)&(fill_info.start),  sizeof(fill_info.start));
-      lp_fwrite(f, (char*)&(fill_info.stop),   sizeof(fill_info.stop));
+      write_bytes((char*)&ID, sizeof(ID));
+
+      write_bytes((char*)&(fill_info.op_id),  sizeof(fill_info.op_id));
+      write_bytes((char*)&(fill_info.dst),    sizeof(fill_info.dst));
+      write_bytes((char*)&(fill_info.create), sizeof(fill_info.create));
+      write_bytes((char*)&(fill_info.ready),  sizeof(fill_info.ready));
+      write_bytes((char*)&(fill_info.start),  sizeof(fill_info.start));
+      write_bytes((char*)&(fill_info.stop),   sizeof(fill_info.stop));
     }
 
     //--------------------------------------------------------------------------
@@ -505,13 +773,14 @@ namespace Legion {
                      const LegionProfInstance::InstCreateInfo& inst_create_info)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = INST_CREATE_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(inst_create_info.op_id),   
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(inst_create_info.op_id),   
                 sizeof(inst_create_info.op_id));
-      lp_fwrite(f, (char*)&(inst_create_info.inst_id), 
+      write_bytes((char*)&(inst_create_info.inst_id), 
                 sizeof(inst_create_info.inst_id));
-      lp_fwrite(f, (char*)&(inst_create_info.create),  
+      write_bytes((char*)&(inst_create_info.create),  
                 sizeof(inst_create_info.create));
     }
 
@@ -520,15 +789,16 @@ namespace Legion {
                        const LegionProfInstance::InstUsageInfo& inst_usage_info)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = INST_USAGE_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(inst_usage_info.op_id),   
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(inst_usage_info.op_id),   
                 sizeof(inst_usage_info.op_id));
-      lp_fwrite(f, (char*)&(inst_usage_info.inst_id), 
+      write_bytes((char*)&(inst_usage_info.inst_id), 
                 sizeof(inst_usage_info.inst_id));
-      lp_fwrite(f, (char*)&(inst_usage_info.mem_id),  
+      write_bytes((char*)&(inst_usage_info.mem_id),  
                 sizeof(inst_usage_info.mem_id));
-      lp_fwrite(f, (char*)&(inst_usage_info.size),    
+      write_bytes((char*)&(inst_usage_info.size),    
                 sizeof(inst_usage_info.size));
     }
 
@@ -537,15 +807,16 @@ namespace Legion {
                  const LegionProfInstance::InstTimelineInfo& inst_timeline_info)
     //--------------------------------------------------------------------------
     {
+      begin_record();
       int ID = INST_TIMELINE_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(inst_timeline_info.op_id),   
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(inst_timeline_info.op_id),   
                 sizeof(inst_timeline_info.op_id));
-      lp_fwrite(f, (char*)&(inst_timeline_info.inst_id), 
+      write_bytes((char*)&(inst_timeline_info.inst_id), 
                 sizeof(inst_timeline_info.inst_id));
-      lp_fwrite(f, (char*)&(inst_timeline_info.create),  
+      write_bytes((char*)&(inst_timeline_info.create),  
                 sizeof(inst_timeline_info.create));
-      lp_fwrite(f, (char*)&(inst_timeline_info.destroy), 
+      write_bytes((char*)&(inst_timeline_info.destroy), 
                 sizeof(inst_timeline_info.destroy));
     }
 
@@ -554,19 +825,21 @@ namespace Legion {
                         const LegionProfInstance::PartitionInfo& partition_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(0/*no proc*/, partition_info.start, 
+                   partition_info.stop);
       int ID = PARTITION_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(partition_info.op_id),
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(partition_info.op_id),
                 sizeof(partition_info.op_id));
-      lp_fwrite(f, (char*)&(partition_info.part_op),
+      write_bytes((char*)&(partition_info.part_op),
                 sizeof(partition_info.part_op));
-      lp_fwrite(f, (char*)&(partition_info.create),
+      write_bytes((char*)&(partition_info.create),
                 sizeof(partition_info.create));
-      lp_fwrite(f, (char*)&(partition_info.ready),
+      write_bytes((char*)&(partition_info.ready),
                 sizeof(partition_info.ready));
-      lp_fwrite(f, (char*)&(partition_info.start),
+      write_bytes((char*)&(partition_info.start),
                 sizeof(partition_info.start));
-      lp_fwrite(f, (char*)&(partition_info.stop),
+      write_bytes((char*)&(partition_info.stop),
                 sizeof(partition_info.stop));
     }
 
@@ -575,12 +848,14 @@ namespace Legion {
                             const LegionProfInstance::MessageInfo& message_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(message_info.proc_id, message_info.start, 
+                   message_info.stop);
       int ID = MESSAGE_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(message_info.kind),   sizeof(message_info.kind));
-      lp_fwrite(f, (char*)&(message_info.start),  sizeof(message_info.start));
-      lp_fwrite(f, (char*)&(message_info.stop),   sizeof(message_info.stop));
-      lp_fwrite(f, (char*)&(message_info.proc_id),sizeof(message_info.proc_id));
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(message_info.kind),   sizeof(message_info.kind));
+      write_bytes((char*)&(message_info.start),  sizeof(message_info.start));
+      write_bytes((char*)&(message_info.stop),   sizeof(message_info.stop));
+      write_bytes((char*)&(message_info.proc_id),sizeof(message_info.proc_id));
     }
 
     //--------------------------------------------------------------------------
@@ -588,17 +863,19 @@ namespace Legion {
                      const LegionProfInstance::MapperCallInfo& mapper_call_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(mapper_call_info.proc_id, mapper_call_info.start,
+                   mapper_call_info.stop);
       int ID = MAPPER_CALL_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(mapper_call_info.kind),    
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(mapper_call_info.kind),    
                 sizeof(mapper_call_info.kind));
-      lp_fwrite(f, (char*)&(mapper_call_info.op_id),   
+      write_bytes((char*)&(mapper_call_info.op_id),   
                 sizeof(mapper_call_info.op_id));
-      lp_fwrite(f, (char*)&(mapper_call_info.start),   
+      write_bytes((char*)&(mapper_call_info.start),   
                 sizeof(mapper_call_info.start));
-      lp_fwrite(f, (char*)&(mapper_call_info.stop),    
+      write_bytes((char*)&(mapper_call_info.stop),    
                 sizeof(mapper_call_info.stop));
-      lp_fwrite(f, (char*)&(mapper_call_info.proc_id), 
+      write_bytes((char*)&(mapper_call_info.proc_id), 
                 sizeof(mapper_call_info.proc_id));
     }
 
@@ -607,31 +884,51 @@ namespace Legion {
                    const LegionProfInstance::RuntimeCallInfo& runtime_call_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(runtime_call_info.proc_id, runtime_call_info.start,
+                   runtime_call_info.stop);
       int ID = RUNTIME_CALL_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(runtime_call_info.kind),    
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(runtime_call_info.kind),    
                 sizeof(runtime_call_info.kind));
-      lp_fwrite(f, (char*)&(runtime_call_info.start),   
+      write_bytes((char*)&(runtime_call_info.start),   
                 sizeof(runtime_call_info.start));
-      lp_fwrite(f, (char*)&(runtime_call_info.stop),    
+      write_bytes((char*)&(runtime_call_info.stop),    
                 sizeof(runtime_call_info.stop));
-      lp_fwrite(f, (char*)&(runtime_call_info.proc_id), 
+      write_bytes((char*)&(runtime_call_info.proc_id), 
                 sizeof(runtime_call_info.proc_id));
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfBinarySerializer::serialize(
+                            const LegionProfInstance::AggregateInfo& aggregate)
+    //--------------------------------------------------------------------------
+    {
+      begin_record();
+      int ID = AGGREGATE_INFO_ID;
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(aggregate.kind),  sizeof(aggregate.kind));
+      write_bytes((char*)&(aggregate.id),    sizeof(aggregate.id));
+      write_bytes((char*)&(aggregate.count), sizeof(aggregate.count));
+      write_bytes((char*)&(aggregate.total), sizeof(aggregate.total));
+      write_bytes((char*)&(aggregate.min),   sizeof(aggregate.min));
+      write_bytes((char*)&(aggregate.max),   sizeof(aggregate.max));
+    }
+
 #ifdef LEGION_PROF_SELF_PROFILE
     //--------------------------------------------------------------------------
     void LegionProfBinarySerializer::serialize(
                           const LegionProfInstance::ProfTaskInfo& proftask_info)
     //--------------------------------------------------------------------------
     {
+      begin_record(proftask_info.proc_id, proftask_info.start, 
+                   proftask_info.stop);
       int ID = PROFTASK_INFO_ID;
-      lp_fwrite(f, (char*)&ID, sizeof(ID));
-      lp_fwrite(f, (char*)&(proftask_info.proc_id), 
+      write_bytes((char*)&ID, sizeof(ID));
+      write_bytes((char*)&(proftask_info.proc_id), 
                 sizeof(proftask_info.proc_id));
-      lp_fwrite(f, (char*)&(proftask_info.op_id), sizeof(proftask_info.op_id));
-      lp_fwrite(f, (char*)&(proftask_info.start), sizeof(proftask_info.start));
-      lp_fwrite(f, (char*)&(proftask_info.stop),  sizeof(proftask_info.stop));
+      write_bytes((char*)&(proftask_info.op_id), sizeof(proftask_info.op_id));
+      write_bytes((char*)&(proftask_info.start), sizeof(proftask_info.start));
+      write_bytes((char*)&(proftask_info.stop),  sizeof(proftask_info.stop));
     }
 #endif
 
@@ -639,8 +936,23 @@ namespace Legion {
     LegionProfBinarySerializer::~LegionProfBinarySerializer()
     //--------------------------------------------------------------------------
     {
+      write_chunk(metadata_chunk, METADATA_CHUNK);
+      for (std::map<ProcID,OutputChunk>::iterator it = 
+            timed_chunks.begin(); it != timed_chunks.end(); it++)
+        write_chunk(it->second, TIMED_CHUNK);
+      flush_buffer();
+      pthread_mutex_lock(&writer_lock);
+      writer_done = true;
+      pthread_cond_broadcast(&writer_cond);
+      pthread_mutex_unlock(&writer_lock);
+      pthread_join(writer_thread, NULL);
+      pthread_cond_destroy(&writer_cond);
+      pthread_mutex_destroy(&writer_lock);
+      free(buffers[0]);
+      free(buffers[1]);
       lp_fflush(f, Z_FULL_FLUSH);
       lp_fclose(f);
+      write_index();
     }
 
 
@@ -716,6 +1028,16 @@ namespace Legion {
                       mem_desc.mem_id, mem_desc.kind, mem_desc.capacity);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                                  const LegionProfDesc::SampleDesc& sample_desc)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Sample Desc %u %u %llu %llu %s", sample_desc.kind,
+                     sample_desc.interval, sample_desc.total, 
+                     sample_desc.sampled, sample_desc.name);
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfASCIISerializer::serialize(
                                   const LegionProfInstance::TaskKind &task_kind)
@@ -782,6 +1104,18 @@ namespace Legion {
                    wait_info.wait_ready, wait_info.wait_end);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                                  const LegionProfInstance::PerfInfo& perf_info,
+                                  const LegionProfInstance::TaskInfo& task_info)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Task Perf Info %llu %lld %lld %lld %lld",
+                  task_info.op_id, perf_info.total_insts, 
+                  perf_info.total_cycles, perf_info.llc_accesses,
+                  perf_info.llc_misses);
+    }
+
     //--------------------------------------------------------------------------
     void LegionProfASCIISerializer::serialize(
                                   const LegionProfInstance::TaskInfo& task_info)
@@ -894,6 +1228,16 @@ namespace Legion {
                      runtime_call_info.start, runtime_call_info.stop);
     }
 
+    //--------------------------------------------------------------------------
+    void LegionProfASCIISerializer::serialize(
+                            const LegionProfInstance::AggregateInfo& aggregate)
+    //--------------------------------------------------------------------------
+    {
+      log_prof.print("Prof Aggregate Info %u %llu %llu %llu %llu %llu",
+                     aggregate.kind, aggregate.id, aggregate.count,
+                     aggregate.total, aggregate.min, aggregate.max);
+    }
+
 #ifdef LEGION_PROF_SELF_PROFILE
     //--------------------------------------------------------------------------
     void LegionProfASCIISerializer::serialize(
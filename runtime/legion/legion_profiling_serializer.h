@@ -17,6 +17,7 @@
 
 #include <string>
 #include <stdio.h>
+#include <pthread.h>
 #include "legion/legion_profiling.h"
 
 #ifdef USE_ZLIB
@@ -49,6 +50,7 @@ namespace Legion {
       virtual void serialize(const LegionProfDesc::OpDesc&) = 0;
       virtual void serialize(const LegionProfDesc::ProcDesc&) = 0;
       virtual void serialize(const LegionProfDesc::MemDesc&) = 0;
+      virtual void serialize(const LegionProfDesc::SampleDesc&) = 0;
       virtual void serialize(const LegionProfInstance::TaskKind&) = 0;
       virtual void serialize(const LegionProfInstance::TaskVariant&) = 0;
       virtual void serialize(const LegionProfInstance::OperationInstance&) = 0;
@@ -58,6 +60,8 @@ namespace Legion {
                              const LegionProfInstance::TaskInfo&) = 0;
       virtual void serialize(const LegionProfInstance::WaitInfo, 
                              const LegionProfInstance::MetaInfo&) = 0;
+      virtual void serialize(const LegionProfInstance::PerfInfo&,
+                             const LegionProfInstance::TaskInfo&) = 0;
       virtual void serialize(const LegionProfInstance::TaskInfo&) = 0;
       virtual void serialize(const LegionProfInstance::MetaInfo&) = 0;
       virtual void serialize(const LegionProfInstance::CopyInfo&) = 0;
@@ -69,6 +73,7 @@ namespace Legion {
       virtual void serialize(const LegionProfInstance::MessageInfo&) = 0;
       virtual void serialize(const LegionProfInstance::MapperCallInfo&) = 0;
       virtual void serialize(const LegionProfInstance::RuntimeCallInfo&) = 0;
+      virtual void serialize(const LegionProfInstance::AggregateInfo&) = 0;
 #ifdef LEGION_PROF_SELF_PROFILE
       virtual void serialize(const LegionProfInstance::ProfTaskInfo&) = 0;
 #endif
@@ -77,7 +82,8 @@ namespace Legion {
     // This is the Internal Binary Format Serializer
     class LegionProfBinarySerializer: public LegionProfSerializer {
     public:
-      LegionProfBinarySerializer(std::string filename);
+      LegionProfBinarySerializer(std::string filename, 
+                                 bool per_proc_chunks = false);
       ~LegionProfBinarySerializer();
 
       void writePreamble();
@@ -90,6 +96,7 @@ namespace Legion {
       void serialize(const LegionProfDesc::OpDesc&);
       void serialize(const LegionProfDesc::ProcDesc&);
       void serialize(const LegionProfDesc::MemDesc&);
+      void serialize(const LegionProfDesc::SampleDesc&);
       void serialize(const LegionProfInstance::TaskKind&);
       void serialize(const LegionProfInstance::TaskVariant&);
       void serialize(const LegionProfInstance::OperationInstance&);
@@ -99,6 +106,8 @@ namespace Legion {
                      const LegionProfInstance::TaskInfo&);
       void serialize(const LegionProfInstance::WaitInfo, 
                      const LegionProfInstance::MetaInfo&);
+      void serialize(const LegionProfInstance::PerfInfo&,
+                     const LegionProfInstance::TaskInfo&);
       void serialize(const LegionProfInstance::TaskInfo&);
       void serialize(const LegionProfInstance::MetaInfo&);
       void serialize(const LegionProfInstance::CopyInfo&);
@@ -110,15 +119,72 @@ namespace Legion {
       void serialize(const LegionProfInstance::MessageInfo&);
       void serialize(const LegionProfInstance::MapperCallInfo&);
       void serialize(const LegionProfInstance::RuntimeCallInfo&);
+      void serialize(const LegionProfInstance::AggregateInfo&);
 #ifdef LEGION_PROF_SELF_PROFILE
       void serialize(const LegionProfInstance::ProfTaskInfo&);
 #endif
     private:
+      // Records are grouped into chunks of metadata and of timed records
+      // (optionally one stream of chunks per processor) and each chunk
+      // written to the log gets an entry in an index file next to it,
+      // which lets legion_prof.py load just a window of the profile
+      struct OutputChunk {
+      public:
+        OutputChunk(void) : proc_id(0), start(0), stop(0) { }
+      public:
+        std::vector<char> data;
+        ProcID proc_id; // zero for records that are not on a processor
+        timestamp_t start, stop;
+      };
+      // This layout is read by tools/legion_serializer.py
+      struct ChunkIndexEntry {
+      public:
+        unsigned long long offset; // uncompressed offset in the log
+        unsigned long long size;
+        unsigned long long proc_id;
+        unsigned long long start, stop;
+        unsigned kind, padding;
+      };
+      enum ChunkKind {
+        METADATA_CHUNK = 0,
+        TIMED_CHUNK = 1
+      };
+      static const unsigned INDEX_MAGIC = 0x4C504958; // 'LPIX'
+      static const unsigned INDEX_VERSION = 1;
+      void begin_record(void);
+      void begin_record(ProcID proc_id, timestamp_t start, timestamp_t stop);
+      void write_bytes(const void *data, size_t num_bytes);
+      void write_chunk(OutputChunk &chunk, unsigned kind);
+      void write_index(void);
+      // Chunks are appended to the active buffer and full buffers
+      // are handed off to a background thread that does the I/O
+      void write_output(const void *data, size_t num_bytes);
+      void flush_buffer(void);
+      void writer_loop(void);
+      static void* writer_thread_main(void *args);
+    private:
 #ifdef USE_ZLIB
       gzFile f;
 #else
       FILE *f;
 #endif
+      const std::string index_filename;
+      const bool per_proc_chunks;
+      OutputChunk metadata_chunk;
+      std::map<ProcID,OutputChunk> timed_chunks;
+      OutputChunk *current_chunk;
+      std::vector<ChunkIndexEntry> chunk_index;
+      unsigned long long output_offset;
+      char *buffers[2];
+      unsigned active_buffer;
+      size_t active_size;
+      // Buffer waiting for the writer thread if any
+      const char *pending_buffer;
+      size_t pending_size;
+      bool writer_done;
+      pthread_t writer_thread;
+      pthread_mutex_t writer_lock;
+      pthread_cond_t writer_cond;
       enum LegionProfInstanceIDs {
         MESSAGE_DESC_ID,
         MAPPER_CALL_DESC_ID,
@@ -145,6 +211,9 @@ namespace Legion {
         MESSAGE_INFO_ID,
         MAPPER_CALL_INFO_ID,
         RUNTIME_CALL_INFO_ID,
+        TASK_PERF_INFO_ID,
+        SAMPLE_DESC_ID,
+        AGGREGATE_INFO_ID,
 #ifdef LEGION_PROF_SELF_PROFILE
         PROFTASK_INFO_ID
 #endif
@@ -165,6 +234,7 @@ namespace Legion {
       void serialize(const LegionProfDesc::OpDesc&);
       void serialize(const LegionProfDesc::ProcDesc&);
       void serialize(const LegionProfDesc::MemDesc&);
+      void serialize(const LegionProfDesc::SampleDesc&);
       void serialize(const LegionProfInstance::TaskKind&);
       void serialize(const LegionProfInstance::TaskVariant&);
       void serialize(const LegionProfInstance::OperationInstance&);
@@ -174,6 +244,8 @@ namespace Legion {
                      const LegionProfInstance::TaskInfo&);
       void serialize(const LegionProfInstance::WaitInfo, 
                      const LegionProfInstance::MetaInfo&);
+      void serialize(const LegionProfInstance::PerfInfo&,
+                     const LegionProfInstance::TaskInfo&);
       void serialize(const LegionProfInstance::TaskInfo&);
       void serialize(const LegionProfInstance::MetaInfo&);
       void serialize(const LegionProfInstance::CopyInfo&);
@@ -185,6 +257,7 @@ namespace Legion {
       void serialize(const LegionProfInstance::MessageInfo&);
       void serialize(const LegionProfInstance::MapperCallInfo&);
       void serialize(const LegionProfInstance::RuntimeCallInfo&);
+      void serialize(const LegionProfInstance::AggregateInfo&);
 #ifdef LEGION_PROF_SELF_PROFILE
       void serialize(const LegionProfInstance::ProfTaskInfo&);
 #endif
@@ -21,6 +21,286 @@
 
 namespace Legion {
   namespace Internal {
+    namespace LegionSpy {
+
+      BinaryLogger *binary_logger = NULL;
+
+      // Identifies binary Legion Spy logs, must match
+      // tools/legion_spy_decoder.py
+      static const char binary_log_magic[8] = 
+        { 'L', 'G', 'S', 'P', 'Y', 'B', 'I', 'N' };
+      static const unsigned binary_log_version = 1;
+
+      //------------------------------------------------------------------------
+      BinaryLogger::BinaryLogger(const char *filename, AddressSpaceID space)
+      //------------------------------------------------------------------------
+      {
+#ifdef USE_ZLIB
+        log_file = gzopen(filename, "wb1");
+#else
+        log_file = fopen(filename, "wb");
+#endif
+        if (log_file == NULL)
+          REPORT_LEGION_ERROR(ERROR_INVALID_PROFILER_FILE,
+                              "Unable to open Legion Spy log file %s "
+                              "for writing", filename)
+        pthread_mutex_init(&logger_lock, NULL);
+        buffer.reserve(LEGION_SPY_OUTPUT_BUFFER_SIZE);
+        buffer.insert(buffer.end(), binary_log_magic, 
+                      binary_log_magic + sizeof(binary_log_magic));
+        append<unsigned>(binary_log_version);
+        append<unsigned>(space);
+      }
+
+      //------------------------------------------------------------------------
+      BinaryLogger::BinaryLogger(const BinaryLogger &rhs)
+      //------------------------------------------------------------------------
+      {
+        // should never be called
+        assert(false);
+      }
+
+      //------------------------------------------------------------------------
+      BinaryLogger::~BinaryLogger(void)
+      //------------------------------------------------------------------------
+      {
+        flush_buffer();
+#ifdef USE_ZLIB
+        gzclose(log_file);
+#else
+        fclose(log_file);
+#endif
+        pthread_mutex_destroy(&logger_lock);
+      }
+
+      //------------------------------------------------------------------------
+      BinaryLogger& BinaryLogger::operator=(const BinaryLogger &rhs)
+      //------------------------------------------------------------------------
+      {
+        // should never be called
+        assert(false);
+        return *this;
+      }
+
+      //------------------------------------------------------------------------
+      void BinaryLogger::log_record(const char *fmt, va_list args)
+      //------------------------------------------------------------------------
+      {
+        // A single buffer under a lock keeps the records in the same
+        // order that they would have had in the text log
+        pthread_mutex_lock(&logger_lock);
+        append<unsigned short>(find_format(fmt));
+        // Walk the conversions in the format string and copy out each
+        // argument at the width given by its length modifier
+        for (const char *p = fmt; *p != '\0'; p++)
+        {
+          if ((*p != '%') || (*(++p) == '%'))
+            continue;
+          while ((*p == '-') || (*p == '+') || (*p == ' ') || 
+                 (*p == '#') || (*p == '0'))
+            p++;
+          if (*p == '*')
+          {
+            append<int>(va_arg(args, int));
+            p++;
+          }
+          while ((*p >= '0') && (*p <= '9'))
+            p++;
+          if (*p == '.')
+          {
+            p++;
+            if (*p == '*')
+            {
+              append<int>(va_arg(args, int));
+              p++;
+            }
+            while ((*p >= '0') && (*p <= '9'))
+              p++;
+          }
+          char length = '\0';
+          if ((*p == 'h') || (*p == 'z') || (*p == 'j') || (*p == 't'))
+          {
+            length = *p++;
+            if (*p == 'h')
+              p++;
+          }
+          else if (*p == 'l')
+          {
+            length = *p++;
+            if (*p == 'l')
+            {
+              length = 'q';
+              p++;
+            }
+          }
+          switch (*p)
+          {
+            case 'd':
+            case 'i':
+              {
+                switch (length)
+                {
+                  case 'l':
+                    append<long long>(va_arg(args, long));
+                    break;
+                  case 'q':
+                    append<long long>(va_arg(args, long long));
+                    break;
+                  case 'z':
+                    append<long long>(va_arg(args, size_t));
+                    break;
+                  case 'j':
+                    append<long long>(va_arg(args, intmax_t));
+                    break;
+                  case 't':
+                    append<long long>(va_arg(args, ptrdiff_t));
+                    break;
+                  default:
+                    append<int>(va_arg(args, int));
+                }
+                break;
+              }
+            case 'u':
+            case 'x':
+            case 'X':
+            case 'o':
+              {
+                switch (length)
+                {
+                  case 'l':
+                    append<unsigned long long>(va_arg(args, unsigned long));
+                    break;
+                  case 'q':
+                    append<unsigned long long>(
+                        va_arg(args, unsigned long long));
+                    break;
+                  case 'z':
+                    append<unsigned long long>(va_arg(args, size_t));
+                    break;
+                  case 'j':
+                    append<unsigned long long>(va_arg(args, uintmax_t));
+                    break;
+                  case 't':
+                    append<unsigned long long>(va_arg(args, ptrdiff_t));
+                    break;
+                  default:
+                    append<unsigned>(va_arg(args, unsigned));
+                }
+                break;
+              }
+            case 'c':
+              {
+                append<int>(va_arg(args, int));
+                break;
+              }
+            case 'p':
+              {
+                append<unsigned long long>(
+                    reinterpret_cast<uintptr_t>(va_arg(args, void*)));
+                break;
+              }
+            case 'f':
+            case 'F':
+            case 'e':
+            case 'E':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A':
+              {
+                append<double>(va_arg(args, double));
+                break;
+              }
+            case 's':
+              {
+                append_string(va_arg(args, const char*));
+                break;
+              }
+            default:
+              // Legion Spy never uses any other conversions
+              assert(false);
+          }
+        }
+        if (buffer.size() >= LEGION_SPY_OUTPUT_BUFFER_SIZE)
+          flush_buffer();
+        pthread_mutex_unlock(&logger_lock);
+      }
+
+      //------------------------------------------------------------------------
+      unsigned BinaryLogger::find_format(const char *fmt)
+      //------------------------------------------------------------------------
+      {
+        // Format strings are literals so we can key on their addresses
+        std::map<const char*,unsigned>::const_iterator finder = 
+          format_ids.find(fmt);
+        if (finder != format_ids.end())
+          return finder->second;
+        // ID zero announces a new format string
+        const unsigned result = format_ids.size() + 1;
+        assert(result <= USHRT_MAX);
+        format_ids[fmt] = result;
+        append<unsigned short>(0);
+        append<unsigned short>(result);
+        append_string(fmt);
+        return result;
+      }
+
+      //------------------------------------------------------------------------
+      void BinaryLogger::append_string(const char *str)
+      //------------------------------------------------------------------------
+      {
+        if (str == NULL)
+          str = "(null)";
+        buffer.insert(buffer.end(), str, str + strlen(str) + 1);
+      }
+
+      //------------------------------------------------------------------------
+      void BinaryLogger::flush_buffer(void)
+      //------------------------------------------------------------------------
+      {
+        if (buffer.empty())
+          return;
+#ifdef USE_ZLIB
+        gzwrite(log_file, &buffer.front(), buffer.size());
+#else
+        fwrite(&buffer.front(), buffer.size(), 1, log_file);
+#endif
+        buffer.clear();
+      }
+
+      //------------------------------------------------------------------------
+      void open_binary_log(const char *filename, AddressSpaceID space)
+      //------------------------------------------------------------------------
+      {
+        if (binary_logger != NULL)
+          return;
+        // Replace any '%' in the file name with the address space
+        std::string file_name(filename);
+        const size_t pct = file_name.find('%');
+        if (pct != std::string::npos)
+        {
+          std::stringstream ss;
+          ss << file_name.substr(0, pct) << space 
+             << file_name.substr(pct + 1);
+          file_name = ss.str();
+        }
+        binary_logger = new BinaryLogger(file_name.c_str(), space);
+        // Records keep coming until the very end of shutdown
+        atexit(close_binary_log);
+      }
+
+      //------------------------------------------------------------------------
+      void close_binary_log(void)
+      //------------------------------------------------------------------------
+      {
+        if (binary_logger == NULL)
+          return;
+        BinaryLogger *logger = binary_logger;
+        binary_logger = NULL;
+        delete logger;
+      }
+
+    }; // namespace LegionSpy
 
     //--------------------------------------------------------------------------
     TreeStateLogger::TreeStateLogger(void)
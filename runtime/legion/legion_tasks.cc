@@ -398,7 +398,7 @@ namespace Legion {
       rez.serialize(futures.size());
       // If we are remote we can just do the normal pack
       for (unsigned idx = 0; idx < futures.size(); idx++)
-        rez.serialize(futures[idx].impl->did);
+        futures[idx].impl->pack_future(rez);
       rez.serialize(grants.size());
       for (unsigned idx = 0; idx < grants.size(); idx++)
         pack_grant(grants[idx], rez);
@@ -410,7 +410,9 @@ namespace Legion {
         pack_phase_barrier(arrive_barriers[idx], rez);
       rez.serialize<bool>((arg_manager != NULL));
       rez.serialize(arglen);
-      rez.serialize(args,arglen);
+      // Large arguments are sent straight out of our buffer since
+      // the message is always packaged before this task can go away
+      rez.serialize_external(args,arglen);
       rez.serialize(map_id);
       rez.serialize(tag);
       rez.serialize(is_index_space);
@@ -862,7 +864,7 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     /*static*/ void TaskOp::process_unpack_task(Runtime *rt, 
-                                                Deserializer &derez)
+                                Deserializer &derez, SliceAggregator *aggregator)
     //--------------------------------------------------------------------------
     {
       // Figure out what kind of task this is and where it came from
@@ -893,7 +895,12 @@ namespace Legion {
           {
             SliceTask *task = rt->get_available_slice_task(false);
             std::set<RtEvent> ready_events;
-            if (task->unpack_task(derez, current, ready_events))
+            const bool ready = task->unpack_task(derez, current, ready_events);
+            // Slices delivered by the distribution tree report to the
+            // aggregator for this node
+            if (aggregator != NULL)
+              task->set_aggregator(aggregator, rt->address_space);
+            if (ready)
             {
               if (!ready_events.empty())
               {
@@ -2692,6 +2699,7 @@ namespace Legion {
       output.chosen_variant = 0;
       output.postmap_task = false;
       output.task_priority = 0;
+      output.memoize = false;
     }
 
     //--------------------------------------------------------------------------
@@ -3285,7 +3293,24 @@ namespace Legion {
       // Now we can invoke the mapper to do the mapping
       if (mapper == NULL)
         mapper = runtime->find_mapper(current_proc, map_id);
-      mapper->invoke_map_task(this, &input, &output);
+      // Tasks in a dynamic trace can reuse the mapping that was memoized
+      // when the trace was captured, premapped regions and must epoch
+      // launches are decided elsewhere so we never memoize them
+      unsigned trace_index = 0;
+      DomainPoint trace_point;
+      bool capturing = false;
+      DynamicTrace *mapping_trace = NULL;
+      if ((must_epoch_owner == NULL) && (must_epoch == NULL) &&
+          input.premapped_regions.empty())
+        mapping_trace = find_mapping_trace(trace_index, trace_point, capturing);
+      if ((mapping_trace == NULL) || capturing ||
+          !replay_memoized_mapping(mapping_trace, trace_index, 
+                                   trace_point, output))
+      {
+        mapper->invoke_map_task(this, &input, &output);
+        if ((mapping_trace != NULL) && capturing && output.memoize)
+          mapping_trace->record_mapping(trace_index, trace_point, output);
+      }
       // Sort out any profiling requests that we need to perform
       if (!output.task_prof_requests.empty())
       {
@@ -3356,6 +3381,70 @@ namespace Legion {
                                valid_instances);
     }
 
+    //--------------------------------------------------------------------------
+    bool SingleTask::replay_memoized_mapping(DynamicTrace *mapping_trace,
+                                             unsigned trace_index,
+                                             const DomainPoint &point,
+                                             Mapper::MapTaskOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      Mapper::MapTaskOutput memoized;
+      if (!mapping_trace->find_mapping(trace_index, point, memoized))
+        return false;
+      // The decision only holds if we ended up on the same processor
+      if (!memoized.target_procs.empty() &&
+          (std::find(memoized.target_procs.begin(), memoized.target_procs.end(),
+                     this->target_proc) == memoized.target_procs.end()))
+        return false;
+      // Acquire the instances just like the mapper would have had to,
+      // if any of them have been collected then we have to ask the
+      // mapper to make a new decision
+      std::map<PhysicalManager*,std::pair<unsigned,bool> > *acquired = 
+        get_acquired_instances_ref();
+      std::vector<PhysicalManager*> added;
+      bool success = true;
+      for (unsigned idx = 0; success && 
+            (idx < memoized.chosen_instances.size()); idx++)
+      {
+        const std::vector<Mapping::PhysicalInstance> &instances = 
+          memoized.chosen_instances[idx];
+        for (unsigned idx2 = 0; idx2 < instances.size(); idx2++)
+        {
+          PhysicalManager *manager = instances[idx2].impl;
+          if (manager->is_virtual_manager())
+            continue;
+          if (acquired->find(manager) != acquired->end())
+            continue;
+          if (!manager->try_add_base_valid_ref(MAPPING_ACQUIRE_REF, this,
+                                               !manager->is_owner()))
+          {
+            success = false;
+            break;
+          }
+          (*acquired)[manager] = 
+            std::pair<unsigned,bool>(1/*first ref*/, false/*created*/);
+          added.push_back(manager);
+        }
+      }
+      if (!success)
+      {
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              added.begin(); it != added.end(); it++)
+        {
+          acquired->erase(*it);
+          if ((*it)->remove_base_valid_ref(MAPPING_ACQUIRE_REF, this))
+            delete (*it);
+        }
+        return false;
+      }
+      output.chosen_instances = memoized.chosen_instances;
+      output.target_procs = memoized.target_procs;
+      output.chosen_variant = memoized.chosen_variant;
+      output.task_priority = memoized.task_priority;
+      output.postmap_task = memoized.postmap_task;
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     void SingleTask::map_all_regions(ApEvent local_termination_event,
                                      MustEpochOp *must_epoch_op /*=NULL*/)
@@ -3724,6 +3813,33 @@ namespace Legion {
           execution_context = new LeafContext(runtime, this);
         // Add a reference to our execution context
         execution_context->add_reference();
+      }
+      if (execution_context->is_leaf_context() && !do_inner_task_optimization)
+      {
+        // Leaf tasks can't launch sub-operations so there is nothing
+        // that will ever wait on the unmap events of their regions and
+        // no region tree contexts to initialize. Just make the physical
+        // regions directly without any of that bookkeeping.
+        for (unsigned idx = 0; idx < regions.size(); idx++)
+        {
+#ifdef DEBUG_LEGION
+          assert(regions[idx].handle_type == SINGULAR);
+          assert(!virtual_mapped[idx]);
+#endif
+          if (regions[idx].privilege == WRITE_DISCARD)
+            regions[idx].privilege = READ_WRITE;
+          RegionRequirement clone_requirement = regions[idx];
+          localize_region_requirement(clone_requirement);
+          execution_context->add_physical_region(clone_requirement,
+              !no_access_regions[idx]/*mapped*/, map_id, tag,
+              ApUserEvent::NO_AP_USER_EVENT, false/*virtual mapped*/,
+              physical_instances[idx]);
+          if (no_access_regions[idx] && regions[idx].region.exists())
+            runtime->forest->get_node(clone_requirement.region);
+        }
+      }
+      else
+      {
         std::vector<ApUserEvent> unmap_events(regions.size());
         std::vector<RegionRequirement> clone_requirements(regions.size());
         // Make physical regions for each our region requirements
@@ -4178,6 +4294,10 @@ namespace Legion {
       // Watch out for the cleanup race with some acrobatics here
       // to handle the case where the iterator is invalidated
       std::set<RtEvent> wait_for;
+      // The origin node sends its remote slices out down a tree
+      const bool use_tree = (Runtime::slice_distribution_radix > 0) &&
+        (must_epoch == NULL) && (get_task_kind() == INDEX_TASK_KIND);
+      std::vector<SliceTask*> remote_slices;
       std::list<SliceTask*>::const_iterator it = slices.begin();
       while (true)
       {
@@ -4202,7 +4322,12 @@ namespace Legion {
           // We can only send it away if it is not locally mapped
           // otherwise it has to stay here until it is fully mapped
           if (!slice->is_locally_mapped())
-            runtime->send_task(slice);
+          {
+            if (use_tree && slice->target_proc.exists())
+              remote_slices.push_back(slice);
+            else
+              runtime->send_task(slice);
+          }
           else
             slice->enqueue_ready_task(false/*use target*/);
         }
@@ -4211,6 +4336,10 @@ namespace Legion {
         if (done)
           break;
       }
+      // None of the remote slices have been sent yet so we are
+      // still safe from the clean-up race at this point
+      if (!remote_slices.empty())
+        static_cast<IndexTask*>(this)->distribute_slice_tree(remote_slices);
       // Must-epoch operations are nasty little beasts and have
       // to wait for the effects to finish before returning
       if (!wait_for.empty())
@@ -4665,7 +4794,7 @@ namespace Legion {
       if (check_privileges)
         perform_privilege_checks();
       // Get a future from the parent context to use as the result
-      result = Future(new FutureImpl(runtime, true/*register*/,
+      result = Future(new FutureImpl(runtime, false/*register*/,
             runtime->get_available_distributed_id(!top_level_task), 
             runtime->address_space, this));
       check_empty_field_requirements(); 
@@ -4715,8 +4844,10 @@ namespace Legion {
           REPORT_LEGION_WARNING(LEGION_WARNING_MAPPER_REQUESTED_INLINE,
                           "Mapper %s requested to inline task %s "
                           "(UID %lld) but the 'enable_inlining' option was "
-                          "not set on the task launcher so the request is "
-                          "being ignored", mapper->get_mapper_name(),
+                          "not set on the task launcher and not all of its "
+                          "regions were already mapped by the parent task "
+                          "so the request is being ignored", 
+                          mapper->get_mapper_name(),
                           get_task_name(), get_unique_id());
         }
       }
@@ -4784,15 +4915,11 @@ namespace Legion {
       register_predicate_dependence();
       restrict_infos.resize(regions.size());
       version_infos.resize(regions.size());
-      ProjectionInfo projection_info;
-      for (unsigned idx = 0; idx < regions.size(); idx++)
-      {
-        runtime->forest->perform_dependence_analysis(this, idx, regions[idx], 
-                                                     restrict_infos[idx],
-                                                     version_infos[idx],
-                                                     projection_info,
-                                                     privilege_paths[idx]);
-      }
+      runtime->forest->perform_dependence_analysis(this, regions, 
+                                                   restrict_infos,
+                                                   version_infos,
+                                                   NULL/*no projections*/,
+                                                   privilege_paths);
     }
 
     //--------------------------------------------------------------------------
@@ -5085,6 +5212,20 @@ namespace Legion {
       return true;
     }
 
+    //--------------------------------------------------------------------------
+    DynamicTrace* IndividualTask::find_mapping_trace(unsigned &trace_index,
+                                       DomainPoint &point, bool &capturing)
+    //--------------------------------------------------------------------------
+    {
+      // Remote copies of the task don't know about the trace
+      if (is_remote() || (trace == NULL) || !trace->is_dynamic_trace())
+        return NULL;
+      trace_index = get_trace_local_id();
+      point = DomainPoint();
+      capturing = is_tracing();
+      return trace->as_dynamic_trace();
+    }
+
     //--------------------------------------------------------------------------
     VersionInfo& IndividualTask::get_version_info(unsigned idx)
     //--------------------------------------------------------------------------
@@ -5392,7 +5533,7 @@ namespace Legion {
         pack_version_infos(rez, version_infos, virtual_mapped);
       pack_restrict_infos(rez, restrict_infos);
       if (predicate_false_future.impl != NULL)
-        rez.serialize(predicate_false_future.impl->did);
+        predicate_false_future.impl->pack_future(rez);
       else
         rez.serialize<DistributedID>(0);
       rez.serialize(predicate_false_size);
@@ -6022,6 +6163,24 @@ namespace Legion {
       return true;
     }
 
+    //--------------------------------------------------------------------------
+    DynamicTrace* PointTask::find_mapping_trace(unsigned &trace_index,
+                                       DomainPoint &point, bool &capturing)
+    //--------------------------------------------------------------------------
+    {
+      // Only slices on the origin node can look at their index task
+      if (slice_owner->is_remote())
+        return NULL;
+      IndexTask *index_owner = slice_owner->index_owner;
+      LegionTrace *index_trace = index_owner->get_trace();
+      if ((index_trace == NULL) || !index_trace->is_dynamic_trace())
+        return NULL;
+      trace_index = index_owner->get_trace_local_id();
+      point = index_point;
+      capturing = index_owner->is_tracing();
+      return index_trace->as_dynamic_trace();
+    }
+
     //--------------------------------------------------------------------------
     VersionInfo& PointTask::get_version_info(unsigned idx)
     //--------------------------------------------------------------------------
@@ -6582,7 +6741,7 @@ namespace Legion {
         initialize_predicate(launcher.predicate_false_future,
                              launcher.predicate_false_result);
       reduction_future = Future(new FutureImpl(runtime,
-            true/*register*/, runtime->get_available_distributed_id(true), 
+            false/*register*/, runtime->get_available_distributed_id(true), 
             runtime->address_space, this));
       check_empty_field_requirements();
       if (check_privileges)
@@ -6760,15 +6919,13 @@ namespace Legion {
       restrict_infos.resize(regions.size());
       projection_infos.resize(regions.size());
       for (unsigned idx = 0; idx < regions.size(); idx++)
-      {
         projection_infos[idx] = 
           ProjectionInfo(runtime, regions[idx], launch_space);
-        runtime->forest->perform_dependence_analysis(this, idx, regions[idx], 
-                                                     restrict_infos[idx],
-                                                     version_infos[idx],
-                                                     projection_infos[idx],
-                                                     privilege_paths[idx]);
-      }
+      runtime->forest->perform_dependence_analysis(this, regions, 
+                                                   restrict_infos,
+                                                   version_infos,
+                                                   &projection_infos,
+                                                   privilege_paths);
     }
 
     //--------------------------------------------------------------------------
@@ -7285,6 +7442,65 @@ namespace Legion {
       locally_mapped_slices.push_back(local_slice);
     }
 
+    //--------------------------------------------------------------------------
+    void IndexTask::distribute_slice_tree(
+                                        std::vector<SliceTask*> &remote_slices)
+    //--------------------------------------------------------------------------
+    {
+      // Pack up each of the slices for its target node and group 
+      // them together by the node that they are going to
+      SliceAggregator::SliceBundle bundle;
+      std::map<AddressSpaceID,unsigned> bundle_indexes;
+      for (std::vector<SliceTask*>::const_iterator it = 
+            remote_slices.begin(); it != remote_slices.end(); it++)
+      {
+        SliceTask *slice = *it;
+        const Processor target = slice->target_proc;
+        const AddressSpaceID space = runtime->find_address_space(target);
+        std::map<AddressSpaceID,unsigned>::const_iterator finder = 
+          bundle_indexes.find(space);
+        unsigned index;
+        if (finder == bundle_indexes.end())
+        {
+          index = bundle.size();
+          bundle_indexes[space] = index;
+          bundle.resize(index + 1);
+          bundle[index].first = space;
+        }
+        else
+          index = finder->second;
+        SliceAggregator::SliceRecord record;
+        record.points = slice->get_domain_volume();
+        // Same format as Runtime::send_task so it can be unpacked
+        // with the normal task unpacking path on the target node
+        Serializer rez;
+        bool deactivate_task;
+        {
+          RezCheck z(rez);
+          rez.serialize(target);
+          rez.serialize(slice->get_task_kind());
+          deactivate_task = slice->pack_task(rez, target);
+        }
+        record.size = rez.get_used_bytes();
+        void *buffer = malloc(record.size);
+        memcpy(buffer, rez.get_buffer(), record.size);
+        record.buffer = buffer;
+        bundle[index].second.push_back(record);
+        if (deactivate_task)
+          slice->deactivate();
+      }
+      // Once the first subtree is sent this task can be completed
+      // and deactivated so we can't touch any of our members after
+      Runtime *const rt = runtime;
+      SliceAggregator::send_subtrees(rt, this, rt->address_space,
+                                     NULL/*parent*/, bundle, 0/*offset*/);
+      for (SliceAggregator::SliceBundle::const_iterator it = 
+            bundle.begin(); it != bundle.end(); it++)
+        for (std::vector<SliceAggregator::SliceRecord>::const_iterator rit =
+              it->second.begin(); rit != it->second.end(); rit++)
+          free(const_cast<void*>(rit->buffer));
+    }
+
     //--------------------------------------------------------------------------
     void IndexTask::return_slice_mapped(unsigned points, long long denom,
                                RtEvent applied_condition, ApEvent restrict_post)
@@ -7670,6 +7886,8 @@ namespace Legion {
       remote_unique_id = get_unique_id();
       locally_mapped = false;
       need_versioning_analysis = true;
+      aggregator = NULL;
+      aggregator_space = 0;
     }
 
     //--------------------------------------------------------------------------
@@ -8009,6 +8227,8 @@ namespace Legion {
       rez.serialize(remote_unique_id);
       rez.serialize(locally_mapped);
       rez.serialize(remote_owner_uid);
+      rez.serialize(aggregator);
+      rez.serialize(aggregator_space);
       rez.serialize(internal_space);
       if (is_locally_mapped())
       {
@@ -8034,7 +8254,7 @@ namespace Legion {
       else
         index_owner->pack_projection_infos(rez, index_owner->projection_infos);
       if (predicate_false_future.impl != NULL)
-        rez.serialize(predicate_false_future.impl->did);
+        predicate_false_future.impl->pack_future(rez);
       else
         rez.serialize<DistributedID>(0);
       rez.serialize(predicate_false_size);
@@ -8088,6 +8308,8 @@ namespace Legion {
       derez.deserialize(remote_unique_id); 
       derez.deserialize(locally_mapped);
       derez.deserialize(remote_owner_uid);
+      derez.deserialize(aggregator);
+      derez.deserialize(aggregator_space);
       derez.deserialize(internal_space);
       unpack_version_infos(derez, version_infos, ready_events);
       unpack_restrict_infos(derez, restrict_infos, ready_events);
@@ -8178,6 +8400,8 @@ namespace Legion {
       result->denominator = this->denominator * scale_denominator;
       result->index_owner = this->index_owner;
       result->remote_owner_uid = this->remote_owner_uid;
+      result->aggregator = this->aggregator;
+      result->aggregator_space = this->aggregator_space;
       if (Runtime::legion_spy_enabled)
         LegionSpy::log_slice_slice(get_unique_id(), 
                                    result->get_unique_id());
@@ -8277,6 +8501,11 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(num_points > 0);
 #endif
+      // If the argument map lives on another node then fetch all of it
+      // at once rather than requesting each point's argument separately
+      if ((point_arguments.impl != NULL) && (num_points > 1) &&
+          !point_arguments.impl->is_owner())
+        point_arguments.impl->request_all_futures();
       unsigned point_idx = 0;
       points.resize(num_points);
       // Enumerate all the points in our slice and make point tasks
@@ -8423,6 +8652,45 @@ namespace Legion {
         trigger_children_committed();
     }
 
+    //--------------------------------------------------------------------------
+    size_t SliceTask::get_domain_volume(void) const
+    //--------------------------------------------------------------------------
+    {
+      Domain internal_domain;
+      runtime->forest->find_launch_space_domain(internal_space,internal_domain);
+      return internal_domain.get_volume();
+    }
+
+    //--------------------------------------------------------------------------
+    void SliceTask::set_aggregator(SliceAggregator *agg, AddressSpaceID space)
+    //--------------------------------------------------------------------------
+    {
+      aggregator = agg;
+      aggregator_space = space;
+    }
+
+    //--------------------------------------------------------------------------
+    bool SliceTask::record_aggregated_return(
+                     SliceAggregator::ReturnKind kind, Serializer *payload)
+    //--------------------------------------------------------------------------
+    {
+      if (aggregator == NULL)
+        return false;
+      // We can only hand our notification to the aggregator if we are
+      // on its node, otherwise it would no longer be ordered with the
+      // state updates we sent straight to the origin node
+      if (aggregator_space == runtime->address_space)
+      {
+        aggregator->record_return(kind, points.size(), payload);
+        return true;
+      }
+      SliceAggregator::send_count(runtime, aggregator_space, aggregator,
+                                  index_owner, kind, points.size());
+      // Commits have nothing to be ordered with so the count is all
+      // that is needed, the others still go straight to the origin
+      return (kind == SliceAggregator::SLICE_COMMIT_RETURN);
+    }
+
     //--------------------------------------------------------------------------
     void SliceTask::trigger_slice_mapped(void)
     //--------------------------------------------------------------------------
@@ -8450,8 +8718,12 @@ namespace Legion {
         {
           Serializer rez;
           pack_remote_mapped(rez, applied_condition);
-          runtime->send_slice_remote_mapped(orig_proc, rez);
+          if (!record_aggregated_return(
+                SliceAggregator::SLICE_MAPPED_RETURN, &rez))
+            runtime->send_slice_remote_mapped(orig_proc, rez);
         }
+        else
+          record_aggregated_return(SliceAggregator::SLICE_MAPPED_RETURN,NULL);
       }
       else
       {
@@ -8493,6 +8765,7 @@ namespace Legion {
         else
           index_owner->return_slice_mapped(points.size(), denominator, 
                              applied_condition, ApEvent::NO_AP_EVENT);
+        record_aggregated_return(SliceAggregator::SLICE_MAPPED_RETURN, NULL);
       }
       complete_mapping(applied_condition);
       if (!acquired_instances.empty())
@@ -8526,12 +8799,14 @@ namespace Legion {
         // Send back the message saying that this slice is complete
         Serializer rez;
         pack_remote_complete(rez, slice_postcondition);
-        runtime->send_slice_remote_complete(orig_proc, rez);
+        if (!record_aggregated_return(
+              SliceAggregator::SLICE_COMPLETE_RETURN, &rez))
+          runtime->send_slice_remote_complete(orig_proc, rez);
       }
       else
       {
-        std::set<ApEvent> slice_postconditions;
         index_owner->return_slice_complete(points.size(), slice_postcondition);
+        record_aggregated_return(SliceAggregator::SLICE_COMPLETE_RETURN, NULL);
       }
       complete_operation();
     }
@@ -8541,17 +8816,23 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       DETAILED_PROFILER(runtime, SLICE_COMMIT_CALL);
-      if (is_remote())
+      // Commits of slices from the distribution tree are 
+      // summed up by the tree on the way back to the origin
+      if (!record_aggregated_return(SliceAggregator::SLICE_COMMIT_RETURN, 
+                                    NULL/*payload*/))
       {
-        Serializer rez;
-        pack_remote_commit(rez);
-        runtime->send_slice_remote_commit(orig_proc, rez);
-      }
-      else
-      {
-        // created and deleted privilege information already passed back
-        // futures already sent back
-        index_owner->return_slice_commit(points.size());
+        if (is_remote())
+        {
+          Serializer rez;
+          pack_remote_commit(rez);
+          runtime->send_slice_remote_commit(orig_proc, rez);
+        }
+        else
+        {
+          // created and deleted privilege information already passed back
+          // futures already sent back
+          index_owner->return_slice_commit(points.size());
+        }
       }
       // We can release our version infos now
       version_infos.clear();
@@ -8809,6 +9090,324 @@ namespace Legion {
         deleted_index_partitions.insert(*it);
     }
 
+    /////////////////////////////////////////////////////////////
+    // Slice Aggregator 
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    SliceAggregator::SliceAggregator(Runtime *rt, IndexTask *owner,
+                                     AddressSpaceID origin, SliceAggregator *p,
+                                     AddressSpaceID p_space, size_t local,
+                                     size_t subtree)
+      : runtime(rt), index_owner(owner), origin_space(origin), parent(p),
+        parent_space(p_space), local_points(local), subtree_points(subtree),
+        aggregator_lock(Reservation::create_reservation()), mapped_points(0),
+        complete_points(0), committed_points(0)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(local_points > 0);
+      assert(local_points <= subtree_points);
+#endif
+    }
+
+    //--------------------------------------------------------------------------
+    SliceAggregator::SliceAggregator(const SliceAggregator &rhs)
+      : runtime(NULL), index_owner(NULL), origin_space(0), parent(NULL),
+        parent_space(0), local_points(0), subtree_points(0)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+    }
+
+    //--------------------------------------------------------------------------
+    SliceAggregator::~SliceAggregator(void)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(mapped_returns.empty());
+      assert(complete_returns.empty());
+#endif
+      aggregator_lock.destroy_reservation();
+      aggregator_lock = Reservation::NO_RESERVATION;
+    }
+
+    //--------------------------------------------------------------------------
+    SliceAggregator& SliceAggregator::operator=(const SliceAggregator &rhs)
+    //--------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+      return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    void SliceAggregator::record_return(ReturnKind kind, size_t points,
+                                        Serializer *payload)
+    //--------------------------------------------------------------------------
+    {
+      std::vector<std::pair<void*,size_t> > to_send;
+      bool subtree_committed = false;
+      {
+        AutoLock a_lock(aggregator_lock);
+        switch (kind)
+        {
+          case SLICE_MAPPED_RETURN:
+          case SLICE_COMPLETE_RETURN:
+            {
+              std::vector<std::pair<void*,size_t> > &returns = 
+                (kind == SLICE_MAPPED_RETURN) ? mapped_returns : 
+                                                complete_returns;
+              size_t &returned = (kind == SLICE_MAPPED_RETURN) ? 
+                                  mapped_points : complete_points;
+              if (payload != NULL)
+              {
+                const size_t size = payload->get_used_bytes();
+                void *buffer = malloc(size);
+                memcpy(buffer, payload->get_buffer(), size);
+                returns.push_back(std::pair<void*,size_t>(buffer, size));
+              }
+              returned += points;
+#ifdef DEBUG_LEGION
+              assert(returned <= local_points);
+#endif
+              if (returned == local_points)
+                to_send.swap(returns);
+              break;
+            }
+          case SLICE_COMMIT_RETURN:
+            {
+              committed_points += points;
+#ifdef DEBUG_LEGION
+              assert(committed_points <= subtree_points);
+#endif
+              if (committed_points == subtree_points)
+                subtree_committed = true;
+              break;
+            }
+          default:
+            assert(false);
+        }
+      }
+      if (!to_send.empty())
+        send_returns(kind, to_send);
+      if (subtree_committed)
+      {
+        // Every slice in our subtree has committed, which means all 
+        // our batches have been sent, so pass the count up and we're done
+        send_count(runtime, parent_space, parent, index_owner,
+                   SLICE_COMMIT_RETURN, subtree_points);
+        delete this;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void SliceAggregator::send_returns(ReturnKind kind,
+                                std::vector<std::pair<void*,size_t> > &returns)
+    //--------------------------------------------------------------------------
+    {
+      Serializer rez;
+      {
+        RezCheck z(rez);
+        rez.serialize(kind);
+        rez.serialize<size_t>(returns.size());
+        for (std::vector<std::pair<void*,size_t> >::const_iterator it = 
+              returns.begin(); it != returns.end(); it++)
+        {
+          rez.serialize(it->second);
+          rez.serialize(it->first, it->second);
+          free(it->first);
+        }
+      }
+      returns.clear();
+      runtime->send_slice_aggregate_return(origin_space, rez);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void SliceAggregator::send_subtrees(Runtime *runtime, 
+                          IndexTask *owner, AddressSpaceID origin, 
+                          SliceAggregator *parent, const SliceBundle &bundle,
+                          unsigned offset)
+    //--------------------------------------------------------------------------
+    {
+      if (offset >= bundle.size())
+        return;
+      // Split the remaining nodes into at most radix subtrees, the
+      // first node of each subtree is the one that we send it to
+      const unsigned radix = (Runtime::slice_distribution_radix > 0) ?
+        Runtime::slice_distribution_radix : 1;
+      const unsigned remaining = bundle.size() - offset;
+      const unsigned chunk = (remaining + radix - 1) / radix;
+      for (unsigned start = offset; start < bundle.size(); start += chunk)
+      {
+        const unsigned stop = ((start + chunk) < bundle.size()) ? 
+                                (start + chunk) : bundle.size();
+        Serializer rez;
+        {
+          RezCheck z(rez);
+          rez.serialize(owner);
+          rez.serialize(origin);
+          rez.serialize(parent);
+          rez.serialize(runtime->address_space);
+          rez.serialize<size_t>(stop - start);
+          for (unsigned idx = start; idx < stop; idx++)
+          {
+            rez.serialize(bundle[idx].first);
+            const std::vector<SliceRecord> &records = bundle[idx].second;
+            rez.serialize<size_t>(records.size());
+            for (std::vector<SliceRecord>::const_iterator it = 
+                  records.begin(); it != records.end(); it++)
+            {
+              rez.serialize(it->points);
+              rez.serialize(it->size);
+              rez.serialize(it->buffer, it->size);
+            }
+          }
+        }
+        runtime->send_slice_distribution(bundle[start].first, rez);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void SliceAggregator::send_count(Runtime *runtime,
+                          AddressSpaceID target, SliceAggregator *aggregator,
+                          IndexTask *owner, ReturnKind kind, size_t points)
+    //--------------------------------------------------------------------------
+    {
+      if (target == runtime->address_space)
+      {
+        if (aggregator != NULL)
+          aggregator->record_return(kind, points, NULL/*payload*/);
+        else
+        {
+#ifdef DEBUG_LEGION
+          assert(kind == SLICE_COMMIT_RETURN);
+#endif
+          owner->return_slice_commit(points);
+        }
+        return;
+      }
+      Serializer rez;
+      {
+        RezCheck z(rez);
+        rez.serialize(aggregator);
+        rez.serialize(owner);
+        rez.serialize(kind);
+        rez.serialize(points);
+      }
+      runtime->send_slice_aggregate_count(target, rez);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void SliceAggregator::handle_slice_distribution(
+                                          Runtime *runtime, Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      IndexTask *owner;
+      derez.deserialize(owner);
+      AddressSpaceID origin;
+      derez.deserialize(origin);
+      SliceAggregator *parent;
+      derez.deserialize(parent);
+      AddressSpaceID parent_space;
+      derez.deserialize(parent_space);
+      size_t num_spaces;
+      derez.deserialize(num_spaces);
+      // The records point straight into the message buffer
+      SliceBundle bundle(num_spaces);
+      size_t local_points = 0, subtree_points = 0;
+      for (unsigned idx = 0; idx < num_spaces; idx++)
+      {
+        derez.deserialize(bundle[idx].first);
+        size_t num_records;
+        derez.deserialize(num_records);
+        std::vector<SliceRecord> &records = bundle[idx].second;
+        records.resize(num_records);
+        for (unsigned ridx = 0; ridx < num_records; ridx++)
+        {
+          derez.deserialize(records[ridx].points);
+          derez.deserialize(records[ridx].size);
+          records[ridx].buffer = derez.get_current_pointer();
+          derez.advance_pointer(records[ridx].size);
+          subtree_points += records[ridx].points;
+          if (idx == 0)
+            local_points += records[ridx].points;
+        }
+      }
+#ifdef DEBUG_LEGION
+      assert(num_spaces > 0);
+      assert(bundle[0].first == runtime->address_space);
+#endif
+      SliceAggregator *aggregator = new SliceAggregator(runtime, owner, origin,
+                      parent, parent_space, local_points, subtree_points);
+      // Send the rest of the slices on to our children before
+      // unpacking ours so they get started as soon as possible
+      send_subtrees(runtime, owner, origin, aggregator, bundle, 1/*offset*/);
+      const std::vector<SliceRecord> &local_records = bundle[0].second;
+      for (std::vector<SliceRecord>::const_iterator it = 
+            local_records.begin(); it != local_records.end(); it++)
+      {
+        Deserializer task_derez(it->buffer, it->size);
+        TaskOp::process_unpack_task(runtime, task_derez, aggregator);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void SliceAggregator::handle_aggregate_return(Runtime *runtime,
+                                   Deserializer &derez, AddressSpaceID source)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      ReturnKind kind;
+      derez.deserialize(kind);
+      size_t num_returns;
+      derez.deserialize(num_returns);
+      for (unsigned idx = 0; idx < num_returns; idx++)
+      {
+        size_t size;
+        derez.deserialize(size);
+        // Each return is exactly what the slice would have sent itself
+        Deserializer return_derez(derez.get_current_pointer(), size);
+        if (kind == SLICE_MAPPED_RETURN)
+          IndexTask::process_slice_mapped(return_derez, source);
+        else
+        {
+#ifdef DEBUG_LEGION
+          assert(kind == SLICE_COMPLETE_RETURN);
+#endif
+          IndexTask::process_slice_complete(return_derez);
+        }
+        derez.advance_pointer(size);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void SliceAggregator::handle_aggregate_count(Runtime *runtime,
+                                                           Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      SliceAggregator *aggregator;
+      derez.deserialize(aggregator);
+      IndexTask *owner;
+      derez.deserialize(owner);
+      ReturnKind kind;
+      derez.deserialize(kind);
+      size_t points;
+      derez.deserialize(points);
+      if (aggregator != NULL)
+        aggregator->record_return(kind, points, NULL/*payload*/);
+      else
+      {
+#ifdef DEBUG_LEGION
+        assert(kind == SLICE_COMMIT_RETURN);
+#endif
+        owner->return_slice_commit(points);
+      }
+    }
+
   }; // namespace Internal 
 }; // namespace Legion 
 
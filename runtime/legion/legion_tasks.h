@@ -343,8 +343,8 @@ namespace Legion {
       unsigned must_epoch_index;
     public:
       // Static methods
-      static void process_unpack_task(Runtime *rt,
-                                      Deserializer &derez); 
+      static void process_unpack_task(Runtime *rt, Deserializer &derez,
+                                      SliceAggregator *aggregator = NULL); 
     public:
       static void log_requirement(UniqueID uid, unsigned idx,
                                  const RegionRequirement &req);
@@ -414,6 +414,9 @@ namespace Legion {
                     VariantImpl *impl, const char *call_name) const;
     protected:
       void invoke_mapper(MustEpochOp *must_epoch_owner);
+      bool replay_memoized_mapping(DynamicTrace *trace, unsigned trace_index,
+                                   const DomainPoint &point,
+                                   Mapper::MapTaskOutput &output);
       void map_all_regions(ApEvent user_event,
                            MustEpochOp *must_epoch_owner = NULL); 
       void perform_post_mapping(void);
@@ -440,6 +443,9 @@ namespace Legion {
       virtual bool is_stealable(void) const = 0;
       virtual bool has_restrictions(unsigned idx, LogicalRegion handle) = 0;
       virtual bool can_early_complete(ApUserEvent &chain_event) = 0; 
+      // Find the dynamic trace that can memoize our mapping (if any)
+      virtual DynamicTrace* find_mapping_trace(unsigned &trace_index,
+                                DomainPoint &point, bool &capturing) = 0;
     public:
       virtual ApEvent get_task_completion(void) const = 0;
       virtual TaskKind get_task_kind(void) const = 0;
@@ -635,6 +641,8 @@ namespace Legion {
       virtual bool is_stealable(void) const;
       virtual bool has_restrictions(unsigned idx, LogicalRegion handle);
       virtual bool can_early_complete(ApUserEvent &chain_event);
+      virtual DynamicTrace* find_mapping_trace(unsigned &trace_index,
+                                DomainPoint &point, bool &capturing);
       virtual VersionInfo& get_version_info(unsigned idx);
       virtual RestrictInfo& get_restrict_info(unsigned idx);
       virtual const ProjectionInfo* get_projection_info(unsigned idx);
@@ -744,6 +752,8 @@ namespace Legion {
       virtual bool is_stealable(void) const;
       virtual bool has_restrictions(unsigned idx, LogicalRegion handle);
       virtual bool can_early_complete(ApUserEvent &chain_event);
+      virtual DynamicTrace* find_mapping_trace(unsigned &trace_index,
+                                DomainPoint &point, bool &capturing);
       virtual VersionInfo& get_version_info(unsigned idx);
       virtual RestrictInfo& get_restrict_info(unsigned idx);
       virtual const ProjectionInfo* get_projection_info(unsigned idx);
@@ -794,6 +804,79 @@ namespace Legion {
       std::vector<VersionInfo>    version_infos;
     };
 
+    /**
+     * \class SliceAggregator
+     * The origin node of an index space task launch sends its remote
+     * slices out down a tree of nodes and each node that receives
+     * slices makes one of these. It batches the mapped and complete
+     * notifications of all the slices on its node into a single
+     * message for the origin node, which keeps them ordered with 
+     * the state updates the slices sent, and sums up the commit
+     * notifications for its whole subtree before passing them on
+     * to its parent in the tree.
+     */
+    class SliceAggregator {
+    public:
+      enum ReturnKind {
+        SLICE_MAPPED_RETURN,
+        SLICE_COMPLETE_RETURN,
+        SLICE_COMMIT_RETURN,
+      };
+      struct SliceRecord {
+      public:
+        SliceRecord(void) : points(0), size(0), buffer(NULL) { }
+      public:
+        size_t points;
+        size_t size;
+        const void *buffer;
+      };
+      typedef std::vector<std::pair<AddressSpaceID,
+                          std::vector<SliceRecord> > > SliceBundle;
+    public:
+      SliceAggregator(Runtime *rt, IndexTask *owner, AddressSpaceID origin,
+                      SliceAggregator *parent, AddressSpaceID parent_space,
+                      size_t local_points, size_t subtree_points);
+      SliceAggregator(const SliceAggregator &rhs);
+      ~SliceAggregator(void);
+    public:
+      SliceAggregator& operator=(const SliceAggregator &rhs);
+    public:
+      void record_return(ReturnKind kind, size_t points, Serializer *payload);
+    protected:
+      void send_returns(ReturnKind kind, 
+                        std::vector<std::pair<void*,size_t> > &returns);
+    public:
+      static void send_subtrees(Runtime *runtime, IndexTask *owner,
+                                AddressSpaceID origin, SliceAggregator *parent,
+                                const SliceBundle &bundle, unsigned offset);
+      static void send_count(Runtime *runtime, AddressSpaceID target,
+                             SliceAggregator *aggregator, IndexTask *owner,
+                             ReturnKind kind, size_t points);
+      static void handle_slice_distribution(Runtime *runtime,
+                                            Deserializer &derez);
+      static void handle_aggregate_return(Runtime *runtime,
+                              Deserializer &derez, AddressSpaceID source);
+      static void handle_aggregate_count(Runtime *runtime, 
+                                         Deserializer &derez);
+    public:
+      Runtime *const runtime;
+      IndexTask *const index_owner;
+      const AddressSpaceID origin_space;
+      SliceAggregator *const parent;
+      const AddressSpaceID parent_space;
+      // Points of the slices sent to this node
+      const size_t local_points;
+      // Points of the slices sent to this node and its children
+      const size_t subtree_points;
+    protected:
+      Reservation aggregator_lock;
+      size_t mapped_points;
+      size_t complete_points;
+      size_t committed_points;
+      std::vector<std::pair<void*,size_t> > mapped_returns;
+      std::vector<std::pair<void*,size_t> > complete_returns;
+    };
+
     /**
      * \class IndexTask
      * An index task is used to represent an index space task
@@ -873,6 +956,8 @@ namespace Legion {
       virtual void record_reference_mutation_effect(RtEvent event);
     public:
       void record_locally_mapped_slice(SliceTask *local_slice);
+    public:
+      void distribute_slice_tree(std::vector<SliceTask*> &remote_slices);
     public:
       void return_slice_mapped(unsigned points, long long denom,
                                RtEvent applied_condition, 
@@ -996,6 +1081,12 @@ namespace Legion {
       void record_child_complete(void);
       void record_child_committed(RtEvent commit_precondition = 
                                   RtEvent::NO_RT_EVENT);
+    public:
+      size_t get_domain_volume(void) const;
+      void set_aggregator(SliceAggregator *agg, AddressSpaceID space);
+    protected:
+      bool record_aggregated_return(SliceAggregator::ReturnKind kind,
+                                    Serializer *payload);
     protected:
       void trigger_slice_mapped(void);
       void trigger_slice_complete(void);
@@ -1051,6 +1142,10 @@ namespace Legion {
       bool locally_mapped;
       bool need_versioning_analysis;
       UniqueID remote_owner_uid;
+      // The aggregator for the node that this slice was sent to
+      // by the slice distribution tree if there is one
+      SliceAggregator *aggregator;
+      AddressSpaceID aggregator_space;
     protected:
       // Temporary storage for future results
       std::map<DomainPoint,std::pair<void*,size_t> > temporary_futures;
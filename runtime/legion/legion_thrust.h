@@ -0,0 +1,266 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef __LEGION_THRUST_H__
+#define __LEGION_THRUST_H__
+
+/**
+ * \file legion_thrust.h
+ * Support for Thrust temporary allocations inside of Legion GPU tasks
+ */
+
+#include "legion.h"
+#include <cuda_runtime.h>
+#include <pthread.h>
+#include <cassert>
+#include <cstddef>
+#include <map>
+#include <vector>
+
+namespace Legion {
+
+  /**
+   * \class ThrustAllocator
+   * A Thrust-compatible allocator for the temporary storage that Thrust
+   * algorithms (sort, reduce, scan, ...) need. Pass one to an algorithm
+   * with thrust::cuda::par(alloc). Instead of going through cudaMalloc
+   * and cudaFree, which are slow and can synchronize the whole device,
+   * storage is carved out of Realm instances in the framebuffer memory
+   * of the GPU running the task. Blocks are cached in a per-GPU pool
+   * when they are freed and are only handed out again once the work
+   * that was queued on the task's stream before the free has finished,
+   * so blocks can be shared between tasks without synchronizing.
+   * Construct the allocator inside of a GPU task and only use it there.
+   */
+  class ThrustAllocator {
+  public:
+    typedef char value_type;
+  public:
+    // Allocations are rounded up to a power of two no smaller than this
+    static const size_t MIN_BLOCK_SIZE = 1 << 12;
+    // Free bytes a pool keeps before it starts releasing blocks to Realm
+    static const size_t MAX_CACHED_BYTES = 1 << 28;
+  public:
+    ThrustAllocator(void);
+    ThrustAllocator(Memory memory);
+    ~ThrustAllocator(void);
+  private:
+    ThrustAllocator(const ThrustAllocator &rhs);
+    ThrustAllocator& operator=(const ThrustAllocator &rhs);
+  public:
+    char* allocate(std::ptrdiff_t num_bytes);
+    void deallocate(char *ptr, size_t num_bytes);
+  public:
+    // Release all the cached blocks in the pool of this allocator's
+    // memory back to Realm (once any pending work on them is done)
+    void release_cached_blocks(void);
+  protected:
+    struct Block {
+    public:
+      Realm::RegionInstance instance;
+      char *ptr;
+      size_t bytes;
+      cudaEvent_t ready;
+    };
+    struct Pool {
+    public:
+      Pool(void) : cached_bytes(0) { pthread_mutex_init(&lock, NULL); }
+    public:
+      pthread_mutex_t lock;
+      std::multimap<size_t,Block> free_blocks;
+      size_t cached_bytes;
+    };
+  protected:
+    static Memory find_local_framebuffer(void);
+    static Pool& find_pool(Memory memory);
+    static void release_block(Block &block);
+  protected:
+    const Memory memory;
+    Pool &pool;
+    std::map<char*,Block> live_blocks;
+  };
+
+  //--------------------------------------------------------------------------
+  inline ThrustAllocator::ThrustAllocator(void)
+    : memory(find_local_framebuffer()), pool(find_pool(memory))
+  //--------------------------------------------------------------------------
+  {
+  }
+
+  //--------------------------------------------------------------------------
+  inline ThrustAllocator::ThrustAllocator(Memory m)
+    : memory(m), pool(find_pool(memory))
+  //--------------------------------------------------------------------------
+  {
+    assert(memory.kind() == Memory::GPU_FB_MEM);
+  }
+
+  //--------------------------------------------------------------------------
+  inline ThrustAllocator::~ThrustAllocator(void)
+  //--------------------------------------------------------------------------
+  {
+    // Anything Thrust didn't give back goes back to the pool now
+    while (!live_blocks.empty())
+    {
+      std::map<char*,Block>::iterator it = live_blocks.begin();
+      deallocate(it->first, it->second.bytes);
+    }
+  }
+
+  //--------------------------------------------------------------------------
+  inline char* ThrustAllocator::allocate(std::ptrdiff_t num_bytes)
+  //--------------------------------------------------------------------------
+  {
+    size_t bytes = MIN_BLOCK_SIZE;
+    while (bytes < size_t(num_bytes))
+      bytes <<= 1;
+    // First see if the pool has a block of this size with no pending work
+    Block block;
+    bool found = false;
+    pthread_mutex_lock(&pool.lock);
+    std::pair<std::multimap<size_t,Block>::iterator,
+              std::multimap<size_t,Block>::iterator> range =
+      pool.free_blocks.equal_range(bytes);
+    for (std::multimap<size_t,Block>::iterator it = range.first;
+          it != range.second; it++)
+    {
+      if (cudaEventQuery(it->second.ready) != cudaSuccess)
+        continue;
+      block = it->second;
+      pool.free_blocks.erase(it);
+      pool.cached_bytes -= bytes;
+      found = true;
+      break;
+    }
+    pthread_mutex_unlock(&pool.lock);
+    if (found)
+      cudaEventDestroy(block.ready);
+    else
+    {
+      // Otherwise make a new instance to hold the block
+      std::vector<size_t> field_sizes(1, 1);
+      Realm::ProfilingRequestSet no_requests;
+      Realm::RegionInstance::create_instance(block.instance, memory,
+          Rect<1>(0, bytes - 1), field_sizes, 0/*SOA*/, no_requests).wait();
+      if (!block.instance.exists())
+        return NULL;
+      block.ptr = static_cast<char*>(
+          block.instance.pointer_untyped(0/*offset*/, bytes));
+      assert(block.ptr != NULL);
+      block.bytes = bytes;
+    }
+    block.ready = NULL;
+    live_blocks[block.ptr] = block;
+    return block.ptr;
+  }
+
+  //--------------------------------------------------------------------------
+  inline void ThrustAllocator::deallocate(char *ptr, size_t num_bytes)
+  //--------------------------------------------------------------------------
+  {
+    std::map<char*,Block>::iterator finder = live_blocks.find(ptr);
+    assert(finder != live_blocks.end());
+    Block block = finder->second;
+    live_blocks.erase(finder);
+    // The block can be reused once everything issued so far on this
+    // task's stream (which is where the hijack puts all our work) is done
+    cudaEventCreate(&block.ready);
+    cudaEventRecord(block.ready);
+    std::vector<Block> to_release;
+    pthread_mutex_lock(&pool.lock);
+    pool.free_blocks.insert(std::pair<const size_t,Block>(block.bytes, block));
+    pool.cached_bytes += block.bytes;
+    // Trim the pool starting from the largest blocks, skipping any
+    // that still have pending work so that we never have to wait here
+    std::multimap<size_t,Block>::iterator it = pool.free_blocks.end();
+    while ((pool.cached_bytes > MAX_CACHED_BYTES) &&
+           (it != pool.free_blocks.begin()))
+    {
+      it--;
+      if (cudaEventQuery(it->second.ready) != cudaSuccess)
+        continue;
+      pool.cached_bytes -= it->first;
+      to_release.push_back(it->second);
+      pool.free_blocks.erase(it++);
+    }
+    pthread_mutex_unlock(&pool.lock);
+    for (unsigned idx = 0; idx < to_release.size(); idx++)
+      release_block(to_release[idx]);
+  }
+
+  //--------------------------------------------------------------------------
+  inline void ThrustAllocator::release_cached_blocks(void)
+  //--------------------------------------------------------------------------
+  {
+    std::vector<Block> to_release;
+    pthread_mutex_lock(&pool.lock);
+    for (std::multimap<size_t,Block>::iterator it = pool.free_blocks.begin();
+          it != pool.free_blocks.end(); it++)
+      to_release.push_back(it->second);
+    pool.free_blocks.clear();
+    pool.cached_bytes = 0;
+    pthread_mutex_unlock(&pool.lock);
+    for (unsigned idx = 0; idx < to_release.size(); idx++)
+      release_block(to_release[idx]);
+  }
+
+  //--------------------------------------------------------------------------
+  /*static*/ inline Memory ThrustAllocator::find_local_framebuffer(void)
+  //--------------------------------------------------------------------------
+  {
+    const Processor proc = Processor::get_executing_processor();
+    assert(proc.kind() == Processor::TOC_PROC);
+    Machine::MemoryQuery finder(Machine::get_machine());
+    finder.only_kind(Memory::GPU_FB_MEM).best_affinity_to(proc);
+    assert(finder.count() > 0);
+    return finder.first();
+  }
+
+  //--------------------------------------------------------------------------
+  /*static*/ inline ThrustAllocator::Pool& ThrustAllocator::find_pool(
+                                                                 Memory memory)
+  //--------------------------------------------------------------------------
+  {
+    // Pools live until the process exits, one for each framebuffer
+    static pthread_mutex_t pools_lock = PTHREAD_MUTEX_INITIALIZER;
+    static std::map<Memory,Pool*> pools;
+    pthread_mutex_lock(&pools_lock);
+    std::map<Memory,Pool*>::const_iterator finder = pools.find(memory);
+    Pool *result;
+    if (finder == pools.end())
+    {
+      result = new Pool();
+      pools[memory] = result;
+    }
+    else
+      result = finder->second;
+    pthread_mutex_unlock(&pools_lock);
+    return *result;
+  }
+
+  //--------------------------------------------------------------------------
+  /*static*/ inline void ThrustAllocator::release_block(Block &block)
+  //--------------------------------------------------------------------------
+  {
+    // Make sure there is no pending work on the block before
+    // Realm gets it back (this is a no-op for trimmed blocks)
+    cudaEventSynchronize(block.ready);
+    cudaEventDestroy(block.ready);
+    block.instance.destroy();
+  }
+
+}; // namespace Legion
+
+#endif // __LEGION_THRUST_H__
@@ -365,6 +365,7 @@ namespace Legion {
       : LegionTrace(c), tid(t), fixed(false), tracing(true)
     //--------------------------------------------------------------------------
     {
+      memo_lock = Reservation::create_reservation();
     }
 
     //--------------------------------------------------------------------------
@@ -380,6 +381,8 @@ namespace Legion {
     DynamicTrace::~DynamicTrace(void)
     //--------------------------------------------------------------------------
     {
+      memo_lock.destroy_reservation();
+      memo_lock = Reservation::NO_RESERVATION;
     }
 
     //--------------------------------------------------------------------------
@@ -446,6 +449,7 @@ namespace Legion {
         // This is the normal case
         if (!op->is_internal_op())
         {
+          op->set_trace_local_id(index);
           operations.push_back(key);
           op_map[key] = index;
           // Add a new vector for storing dependences onto the back
@@ -496,6 +500,7 @@ namespace Legion {
           // If we make it here, everything is good
           const LegionVector<DependenceRecord>::aligned &deps = 
                                                           dependences[index];
+          op->set_trace_local_id(index);
           operations.push_back(key);
 #ifdef LEGION_SPY
           current_uids.push_back(op->get_unique_op_id());
@@ -784,6 +789,42 @@ namespace Legion {
       aliased_children[index].push_back(AliasChildren(req_index, depth, mask));
     } 
 
+    //--------------------------------------------------------------------------
+    void DynamicTrace::record_mapping(unsigned trace_index, 
+                                      const DomainPoint &point,
+                                      const Mapper::MapTaskOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      const std::pair<unsigned,DomainPoint> key(trace_index, point);
+      AutoLock m_lock(memo_lock);
+      MemoizedMapping &mapping = memoized_mappings[key];
+      mapping.chosen_instances = output.chosen_instances;
+      mapping.target_procs = output.target_procs;
+      mapping.chosen_variant = output.chosen_variant;
+      mapping.task_priority = output.task_priority;
+      mapping.postmap_task = output.postmap_task;
+    }
+
+    //--------------------------------------------------------------------------
+    bool DynamicTrace::find_mapping(unsigned trace_index, 
+                                    const DomainPoint &point,
+                                    Mapper::MapTaskOutput &output) const
+    //--------------------------------------------------------------------------
+    {
+      const std::pair<unsigned,DomainPoint> key(trace_index, point);
+      AutoLock m_lock(memo_lock,1,false/*exclusive*/);
+      std::map<std::pair<unsigned,DomainPoint>,MemoizedMapping>::const_iterator
+        finder = memoized_mappings.find(key);
+      if (finder == memoized_mappings.end())
+        return false;
+      output.chosen_instances = finder->second.chosen_instances;
+      output.target_procs = finder->second.target_procs;
+      output.chosen_variant = finder->second.chosen_variant;
+      output.task_priority = finder->second.task_priority;
+      output.postmap_task = finder->second.postmap_task;
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     void DynamicTrace::insert_dependence(const DependenceRecord &record)
     //--------------------------------------------------------------------------
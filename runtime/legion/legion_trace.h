@@ -178,6 +178,16 @@ namespace Legion {
         Operation::OpKind kind;
         unsigned count;
       }; 
+      // The output of a 'map_task' call that the mapper asked us to
+      // remember while capturing so that replays can skip the call
+      struct MemoizedMapping {
+      public:
+        std::vector<std::vector<Mapping::PhysicalInstance> > chosen_instances;
+        std::vector<Processor> target_procs;
+        VariantID chosen_variant;
+        TaskPriority task_priority;
+        bool postmap_task;
+      };
     public:
       DynamicTrace(TraceID tid, TaskContext *ctx);
       DynamicTrace(const DynamicTrace &rhs);
@@ -212,6 +222,13 @@ namespace Legion {
                                     const FieldMask &dependent_mask);
       virtual void record_aliased_children(unsigned req_index, unsigned depth,
                                            const FieldMask &aliased_mask);
+    public:
+      // Called by mapping threads, tasks are named by their index
+      // in the trace and their point for index space launches
+      void record_mapping(unsigned trace_index, const DomainPoint &point,
+                          const Mapper::MapTaskOutput &output);
+      bool find_mapping(unsigned trace_index, const DomainPoint &point,
+                        Mapper::MapTaskOutput &output) const;
     protected:
       // Insert a normal dependence for the current operation
       void insert_dependence(const DependenceRecord &record);
@@ -237,6 +254,12 @@ namespace Legion {
       std::deque<LegionVector<DependenceRecord>::aligned> dependences;
       // Metadata for checking the validity of a trace when it is replayed
       std::vector<OperationInfo> op_info;
+    protected:
+      // Mapping decisions are recorded and looked up by mapping threads
+      // concurrently with the analysis so they need their own lock
+      mutable Reservation memo_lock;
+      std::map<std::pair<unsigned,DomainPoint>,MemoizedMapping> 
+                                                        memoized_mappings;
     protected:
       const TraceID tid;
       bool fixed;
@@ -190,6 +190,12 @@ namespace Legion {
   template<unsigned int MAX> class AVXBitMask;
   template<unsigned int MAX> class AVXTLBitMask;
 #endif
+#ifdef __AVX512F__
+  template<unsigned int MAX> class AVX512BitMask;
+  template<unsigned int MAX> class AVX512TLBitMask;
+#endif
+  template<typename BITMASK, unsigned int MAX, 
+           unsigned int WORDS> class CompoundBitMask;
   template<typename T, unsigned LOG2MAX> class BitPermutation;
   template<typename IT, typename DT, bool BIDIR = false> class IntegerSet;
 
@@ -363,6 +369,10 @@ namespace Legion {
       LG_DEFER_PHI_VIEW_REF_TASK_ID,
       LG_DEFER_PHI_VIEW_REGISTRATION_TASK_ID,
       LG_TIGHTEN_INDEX_SPACE_TASK_ID,
+      LG_LOGICAL_ANALYSIS_TASK_ID,
+      LG_FLUSH_REFERENCE_RELEASES_TASK_ID,
+      LG_EAGER_COLLECTION_TASK_ID,
+      LG_FLUSH_AGGREGATED_MESSAGES_TASK_ID,
       LG_PROF_OUTPUT_TASK_ID,
       LG_MESSAGE_ID, // These two must be the last two
       LG_RETRY_SHUTDOWN_TASK_ID,
@@ -461,6 +471,10 @@ namespace Legion {
         "Defer Phi View Reference",                               \
         "Defer Phi View Registration",                            \
         "Tighten Index Space",                                    \
+        "Parallel Logical Analysis",                              \
+        "Flush Reference Releases",                               \
+        "Eager Instance Collection",                              \
+        "Flush Aggregated Messages",                              \
         "Legion Prof Early Output",                               \
         "Remote Message",                                         \
         "Retry Shutdown",                                         \
@@ -514,6 +528,7 @@ namespace Legion {
       PERMIT_STEAL_REQUEST_CALL,
       HANDLE_MESSAGE_CALL,
       HANDLE_TASK_RESULT_CALL,
+      MAP_TASKS_CALL,
       LAST_MAPPER_CALL,
     };
 
@@ -566,6 +581,7 @@ namespace Legion {
       "permit_steal_request",                       \
       "handle_message",                             \
       "handle_task_result",                         \
+      "map_tasks",                                  \
     }
 
     // Methodology for assigning priorities to meta-tasks
@@ -655,10 +671,14 @@ namespace Legion {
       SLICE_REMOTE_MAPPED,
       SLICE_REMOTE_COMPLETE,
       SLICE_REMOTE_COMMIT,
+      SLICE_DISTRIBUTION,
+      SLICE_AGGREGATE_RETURN,
+      SLICE_AGGREGATE_COUNT,
       DISTRIBUTED_REMOTE_REGISTRATION,
       DISTRIBUTED_VALID_UPDATE,
       DISTRIBUTED_GC_UPDATE,
       DISTRIBUTED_RESOURCE_UPDATE,
+      DISTRIBUTED_RELEASE_BATCH,
       DISTRIBUTED_CREATE_ADD,
       DISTRIBUTED_CREATE_REMOVE,
       DISTRIBUTED_UNREGISTER,
@@ -686,6 +706,8 @@ namespace Legion {
       SEND_FUTURE_SUBSCRIPTION,
       SEND_FUTURE_MAP_REQUEST,
       SEND_FUTURE_MAP_RESPONSE,
+      SEND_FUTURE_MAP_ALL_REQUEST,
+      SEND_FUTURE_MAP_ALL_RESPONSE,
       SEND_MAPPER_MESSAGE,
       SEND_MAPPER_BROADCAST,
       SEND_TASK_IMPL_SEMANTIC_REQ,
@@ -786,10 +808,14 @@ namespace Legion {
         "Slice Remote Mapped",                                        \
         "Slice Remote Complete",                                      \
         "Slice Remote Commit",                                        \
+        "Slice Distribution",                                         \
+        "Slice Aggregate Return",                                     \
+        "Slice Aggregate Count",                                      \
         "Distributed Remote Registration",                            \
         "Distributed Valid Update",                                   \
         "Distributed GC Update",                                      \
         "Distributed Resource Update",                                \
+        "Distributed Release Batch",                                  \
         "Distributed Create Add",                                     \
         "Distributed Create Remove",                                  \
         "Distributed Unregister",                                     \
@@ -817,6 +843,8 @@ namespace Legion {
         "Send Future Subscription",                                   \
         "Send Future Map Future Request",                             \
         "Send Future Map Future Response",                            \
+        "Send Future Map All Request",                                \
+        "Send Future Map All Response",                               \
         "Send Mapper Message",                                        \
         "Send Mapper Broadcast",                                      \
         "Send Task Impl Semantic Req",                                \
@@ -1026,6 +1054,15 @@ namespace Legion {
       REDUCTION_VIEW_FIND_COPY_PRECONDITIONS_CALL,
       REDUCTION_VIEW_FIND_USER_PRECONDITIONS_CALL,
       REDUCTION_VIEW_FILTER_LOCAL_USERS_CALL,
+      OPERATION_DEPENDENCE_ANALYSIS_CALL,
+      OPERATION_TRIGGER_READY_CALL,
+      OPERATION_TRIGGER_MAPPING_CALL,
+      TASK_TRIGGER_MAPPING_CALL,
+      OPERATION_DEFERRED_EXECUTE_CALL,
+      OPERATION_TRIGGER_COMPLETE_CALL,
+      REGION_TREE_DEFERRED_LOGICAL_ANALYSIS_CALL,
+      GARBAGE_COLLECTION_DEFERRED_COLLECT_CALL,
+      VIRTUAL_CHANNEL_HANDLE_MESSAGES_CALL,
       LAST_RUNTIME_CALL_KIND, // This one must be last
     };
 
@@ -1184,6 +1221,15 @@ namespace Legion {
       "Reduction View Find Copy Preconditions",                       \
       "Reduction View Find User Preconditions",                       \
       "Reduction View Filter Local Users",                            \
+      "Operation Dependence Analysis",                                \
+      "Operation Trigger Ready",                                      \
+      "Operation Trigger Mapping",                                    \
+      "Task Trigger Mapping",                                         \
+      "Operation Deferred Execute",                                   \
+      "Operation Trigger Complete",                                   \
+      "Region Tree Deferred Logical Analysis",                        \
+      "Garbage Collection Deferred Collect",                          \
+      "Virtual Channel Handle Messages",                              \
     };
 
     enum SemanticInfoKind {
@@ -1277,6 +1323,7 @@ namespace Legion {
     class PointTask;
     class IndexTask;
     class SliceTask;
+    class SliceAggregator;
     class RemoteTask;
 
     // legion_context.h
@@ -1639,38 +1686,61 @@ namespace Legion {
 #define LEGION_FIELD_MASK_FIELD_MASK          0x3F
 #define LEGION_FIELD_MASK_FIELD_ALL_ONES      0xFFFFFFFFFFFFFFFF
 
-#if defined(__AVX__)
+#if defined(__AVX512F__)
+#if (MAX_FIELDS > 512)
+    typedef AVX512TLBitMask<MAX_FIELDS> DenseFieldMask;
+#elif (MAX_FIELDS > 256)
+    typedef AVX512BitMask<MAX_FIELDS> DenseFieldMask;
+#elif (MAX_FIELDS > 128)
+    typedef AVXBitMask<MAX_FIELDS> DenseFieldMask;
+#elif (MAX_FIELDS > 64)
+    typedef SSEBitMask<MAX_FIELDS> DenseFieldMask;
+#else
+    typedef BitMask<LEGION_FIELD_MASK_FIELD_TYPE,MAX_FIELDS,
+                    LEGION_FIELD_MASK_FIELD_SHIFT,
+                    LEGION_FIELD_MASK_FIELD_MASK> DenseFieldMask;
+#endif
+#elif defined(__AVX__)
 #if (MAX_FIELDS > 256)
-    typedef AVXTLBitMask<MAX_FIELDS> FieldMask;
+    typedef AVXTLBitMask<MAX_FIELDS> DenseFieldMask;
 #elif (MAX_FIELDS > 128)
-    typedef AVXBitMask<MAX_FIELDS> FieldMask;
+    typedef AVXBitMask<MAX_FIELDS> DenseFieldMask;
 #elif (MAX_FIELDS > 64)
-    typedef SSEBitMask<MAX_FIELDS> FieldMask;
+    typedef SSEBitMask<MAX_FIELDS> DenseFieldMask;
 #else
     typedef BitMask<LEGION_FIELD_MASK_FIELD_TYPE,MAX_FIELDS,
                     LEGION_FIELD_MASK_FIELD_SHIFT,
-                    LEGION_FIELD_MASK_FIELD_MASK> FieldMask;
+                    LEGION_FIELD_MASK_FIELD_MASK> DenseFieldMask;
 #endif
 #elif defined(__SSE2__)
 #if (MAX_FIELDS > 128)
-    typedef SSETLBitMask<MAX_FIELDS> FieldMask;
+    typedef SSETLBitMask<MAX_FIELDS> DenseFieldMask;
 #elif (MAX_FIELDS > 64)
-    typedef SSEBitMask<MAX_FIELDS> FieldMask;
+    typedef SSEBitMask<MAX_FIELDS> DenseFieldMask;
 #else
     typedef BitMask<LEGION_FIELD_MASK_FIELD_TYPE,MAX_FIELDS,
                     LEGION_FIELD_MASK_FIELD_SHIFT,
-                    LEGION_FIELD_MASK_FIELD_MASK> FieldMask;
+                    LEGION_FIELD_MASK_FIELD_MASK> DenseFieldMask;
 #endif
 #else
 #if (MAX_FIELDS > 64)
     typedef TLBitMask<LEGION_FIELD_MASK_FIELD_TYPE,MAX_FIELDS,
                       LEGION_FIELD_MASK_FIELD_SHIFT,
-                      LEGION_FIELD_MASK_FIELD_MASK> FieldMask;
+                      LEGION_FIELD_MASK_FIELD_MASK> DenseFieldMask;
 #else
     typedef BitMask<LEGION_FIELD_MASK_FIELD_TYPE,MAX_FIELDS,
                     LEGION_FIELD_MASK_FIELD_SHIFT,
-                    LEGION_FIELD_MASK_FIELD_MASK> FieldMask;
+                    LEGION_FIELD_MASK_FIELD_MASK> DenseFieldMask;
 #endif
+#endif
+    // Field spaces usually only use a few of the MAX_FIELDS fields so 
+    // masks can optionally store small sets of fields sparsely and only 
+    // switch to the dense SIMD representation above for larger sets
+#ifdef LEGION_SPARSE_FIELD_MASKS
+    typedef CompoundBitMask<DenseFieldMask,MAX_FIELDS,
+                            LEGION_SPARSE_FIELD_MASK_WORDS> FieldMask;
+#else
+    typedef DenseFieldMask FieldMask;
 #endif
     typedef BitPermutation<FieldMask,LEGION_FIELD_LOG2> FieldPermutation;
     typedef Fraction<unsigned long> InstFrac;
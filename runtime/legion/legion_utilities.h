@@ -265,9 +265,25 @@ namespace Legion {
     /////////////////////////////////////////////////////////////
     class Serializer {
     public:
-      Serializer(size_t base_bytes = 4096)
-        : total_bytes(base_bytes), buffer((char*)malloc(base_bytes)), 
-          index(0) 
+      // The buffer is a chain of chunks that are never reallocated, each
+      // new chunk is at least twice the size of the one before it and
+      // every element is serialized contiguously into a single chunk.
+      // External chunks have no storage of their own and just point
+      // at a buffer owned by the caller of serialize_external.
+      struct Chunk {
+      public:
+        inline char* data(void) { return ptr; }
+        inline const char* data(void) const { return ptr; }
+      public:
+        Chunk *next;
+        char *ptr;
+        size_t size, used;
+      };
+    public:
+      Serializer(size_t base_bytes = LEGION_SERIALIZER_CHUNK_SIZE)
+        : head(allocate_chunk(base_bytes)), current(head), 
+          total_bytes(base_bytes), buffer(head->data()), 
+          index(0), previous_bytes(0)
 #ifdef DEBUG_LEGION
           , context_bytes(0)
 #endif
@@ -280,7 +296,12 @@ namespace Legion {
     public:
       ~Serializer(void)
       {
-        free(buffer);
+        while (head != NULL)
+        {
+          Chunk *next = head->next;
+          free_chunk(head);
+          head = next;
+        }
       }
     public:
       inline Serializer& operator=(const Serializer &rhs);
@@ -304,26 +325,52 @@ namespace Legion {
       template<unsigned int MAX>
       inline void serialize(const AVXTLBitMask<MAX> &mask);
 #endif
+#ifdef __AVX512F__
+      template<unsigned int MAX>
+      inline void serialize(const AVX512BitMask<MAX> &mask);
+      template<unsigned int MAX>
+      inline void serialize(const AVX512TLBitMask<MAX> &mask);
+#endif
+      template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
+      inline void serialize(const CompoundBitMask<BITMASK,MAX,WORDS> &mask);
       template<typename IT, typename DT, bool BIDIR>
       inline void serialize(const IntegerSet<IT,DT,BIDIR> &index_set);
       inline void serialize(const Domain &domain);
       inline void serialize(const DomainPoint &dp);
       inline void serialize(const void *src, size_t bytes);
+      // Same format as serialize(src, bytes) but large buffers are
+      // referenced instead of copied, so src must stay valid until
+      // the Serializer is packaged or destroyed
+      inline void serialize_external(const void *src, size_t bytes);
     public:
       inline void begin_context(void);
       inline void end_context(void);
     public:
-      inline size_t get_index(void) const { return index; }
-      inline const void* get_buffer(void) const { return buffer; }
-      inline size_t get_buffer_size(void) const { return total_bytes; }
-      inline size_t get_used_bytes(void) const { return index; }
+      inline size_t get_index(void) const { return previous_bytes + index; }
+      // Coalesces the chunks if there is more than one
+      inline const void* get_buffer(void);
+      inline size_t get_buffer_size(void) const 
+        { return previous_bytes + total_bytes; }
+      inline size_t get_used_bytes(void) const 
+        { return previous_bytes + index; }
       inline void* reserve_bytes(size_t size);
+      // Walk the chunks in order with Chunk::next without coalescing them
+      inline const Chunk* get_chunks(void);
     private:
-      inline void resize(void);
+      inline void resize(size_t needed);
+      static inline Chunk* allocate_chunk(size_t size);
+      static inline void free_chunk(Chunk *chunk);
+      // Per-thread cache of default sized chunks
+      static inline Chunk*& cached_chunks(void);
+      static inline unsigned& num_cached_chunks(void);
     private:
+      Chunk *head, *current;
+      // Capacity, data, and used bytes of the current chunk
       size_t total_bytes;
       char *buffer;
       size_t index;
+      // Bytes used in all the chunks before the current one
+      size_t previous_bytes;
 #ifdef DEBUG_LEGION
       size_t context_bytes;
 #endif
@@ -376,6 +423,14 @@ namespace Legion {
       template<unsigned int MAX>
       inline void deserialize(AVXTLBitMask<MAX> &mask);
 #endif
+#ifdef __AVX512F__
+      template<unsigned int MAX>
+      inline void deserialize(AVX512BitMask<MAX> &mask);
+      template<unsigned int MAX>
+      inline void deserialize(AVX512TLBitMask<MAX> &mask);
+#endif
+      template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
+      inline void deserialize(CompoundBitMask<BITMASK,MAX,WORDS> &mask);
       template<typename IT, typename DT, bool BIDIR>
       inline void deserialize(IntegerSet<IT,DT,BIDIR> &index_set);
       inline void deserialize(Domain &domain);
@@ -954,6 +1009,177 @@ namespace Legion {
 #endif
 #endif // __AVX__
 
+#ifdef __AVX512F__
+    /////////////////////////////////////////////////////////////
+    // AVX-512 Bit Mask  
+    /////////////////////////////////////////////////////////////
+    template<unsigned int MAX>
+#if __cplusplus >= 201103L
+    class alignas(64) AVX512BitMask 
+#else
+    class AVX512BitMask // alignment handled below
+#endif
+      : public Internal::LegionHeapify<AVX512BitMask<MAX> > {
+    public:
+      explicit AVX512BitMask(uint64_t init = 0);
+      AVX512BitMask(const AVX512BitMask &rhs);
+      ~AVX512BitMask(void);
+    public:
+      inline void set_bit(unsigned bit);
+      inline void unset_bit(unsigned bit);
+      inline void assign_bit(unsigned bit, bool val);
+      inline bool is_set(unsigned bit) const;
+      inline int find_first_set(void) const;
+      inline int find_index_set(int index) const;
+      inline int find_next_set(int start) const;
+      inline void clear(void);
+    public:
+      inline bool operator==(const AVX512BitMask &rhs) const;
+      inline bool operator<(const AVX512BitMask &rhs) const;
+      inline bool operator!=(const AVX512BitMask &rhs) const;
+    public:
+      inline const __m512i& operator()(const unsigned &idx) const;
+      inline __m512i& operator()(const unsigned &idx);
+      inline const uint64_t& operator[](const unsigned &idx) const;
+      inline uint64_t& operator[](const unsigned &idx);
+      inline AVX512BitMask& operator=(const AVX512BitMask &rhs);
+      inline const __m512d& elem(const unsigned &idx) const;
+      inline __m512d& elem(const unsigned &idx);
+    public:
+      inline AVX512BitMask operator~(void) const;
+      inline AVX512BitMask operator|(const AVX512BitMask &rhs) const;
+      inline AVX512BitMask operator&(const AVX512BitMask &rhs) const;
+      inline AVX512BitMask operator^(const AVX512BitMask &rhs) const;
+    public:
+      inline AVX512BitMask& operator|=(const AVX512BitMask &rhs);
+      inline AVX512BitMask& operator&=(const AVX512BitMask &rhs);
+      inline AVX512BitMask& operator^=(const AVX512BitMask &rhs);
+    public:
+      // Use * for disjointness testing
+      inline bool operator*(const AVX512BitMask &rhs) const;
+      // Set difference
+      inline AVX512BitMask operator-(const AVX512BitMask &rhs) const;
+      inline AVX512BitMask& operator-=(const AVX512BitMask &rhs);
+      // Test to see if everything is zeros
+      inline bool operator!(void) const;
+    public:
+      inline AVX512BitMask operator<<(unsigned shift) const;
+      inline AVX512BitMask operator>>(unsigned shift) const;
+    public:
+      inline AVX512BitMask& operator<<=(unsigned shift);
+      inline AVX512BitMask& operator>>=(unsigned shift);
+    public:
+      inline uint64_t get_hash_key(void) const;
+      inline const uint64_t* base(void) const;
+      inline void serialize(Serializer &rez) const;
+      inline void deserialize(Deserializer &derez);
+    public:
+      // Allocates memory that becomes owned by the caller
+      inline char* to_string(void) const;
+    public:
+      static inline int pop_count(const AVX512BitMask<MAX> &mask);
+    protected:
+      union {
+        __m512i avx512_vector[MAX/512];
+        __m512d avx512_double[MAX/512];
+        uint64_t bit_vector[MAX/64];
+      } bits;
+    public:
+      static const unsigned ELEMENT_SIZE = 64;
+      static const unsigned ELEMENTS = MAX/ELEMENT_SIZE;
+#if __cplusplus >= 201103L
+    }; // alignment handled above
+#else
+    } __attribute__((aligned(64)));
+#endif
+    
+    /////////////////////////////////////////////////////////////
+    // AVX-512 Two-Level Bit Mask  
+    /////////////////////////////////////////////////////////////
+    template<unsigned int MAX>
+#if __cplusplus >= 201103L
+    class alignas(64) AVX512TLBitMask
+#else
+    class AVX512TLBitMask // alignment handled below
+#endif
+      : public Internal::LegionHeapify<AVX512TLBitMask<MAX> > {
+    public:
+      explicit AVX512TLBitMask(uint64_t init = 0);
+      AVX512TLBitMask(const AVX512TLBitMask &rhs);
+      ~AVX512TLBitMask(void);
+    public:
+      inline void set_bit(unsigned bit);
+      inline void unset_bit(unsigned bit);
+      inline void assign_bit(unsigned bit, bool val);
+      inline bool is_set(unsigned bit) const;
+      inline int find_first_set(void) const;
+      inline int find_index_set(int index) const;
+      inline int find_next_set(int start) const;
+      inline void clear(void);
+    public:
+      inline bool operator==(const AVX512TLBitMask &rhs) const;
+      inline bool operator<(const AVX512TLBitMask &rhs) const;
+      inline bool operator!=(const AVX512TLBitMask &rhs) const;
+    public:
+      inline const __m512i& operator()(const unsigned &idx) const;
+      inline __m512i& operator()(const unsigned &idx);
+      inline const uint64_t& operator[](const unsigned &idx) const;
+      inline uint64_t& operator[](const unsigned &idx);
+      inline AVX512TLBitMask& operator=(const AVX512TLBitMask &rhs);
+      inline const __m512d& elem(const unsigned &idx) const;
+      inline __m512d& elem(const unsigned &idx);
+    public:
+      inline AVX512TLBitMask operator~(void) const;
+      inline AVX512TLBitMask operator|(const AVX512TLBitMask &rhs) const;
+      inline AVX512TLBitMask operator&(const AVX512TLBitMask &rhs) const;
+      inline AVX512TLBitMask operator^(const AVX512TLBitMask &rhs) const;
+    public:
+      inline AVX512TLBitMask& operator|=(const AVX512TLBitMask &rhs);
+      inline AVX512TLBitMask& operator&=(const AVX512TLBitMask &rhs);
+      inline AVX512TLBitMask& operator^=(const AVX512TLBitMask &rhs);
+    public:
+      // Use * for disjointness testing
+      inline bool operator*(const AVX512TLBitMask &rhs) const;
+      // Set difference
+      inline AVX512TLBitMask operator-(const AVX512TLBitMask &rhs) const;
+      inline AVX512TLBitMask& operator-=(const AVX512TLBitMask &rhs);
+      // Test to see if everything is zeros
+      inline bool operator!(void) const;
+    public:
+      inline AVX512TLBitMask operator<<(unsigned shift) const;
+      inline AVX512TLBitMask operator>>(unsigned shift) const;
+    public:
+      inline AVX512TLBitMask& operator<<=(unsigned shift);
+      inline AVX512TLBitMask& operator>>=(unsigned shift);
+    public:
+      inline uint64_t get_hash_key(void) const;
+      inline const uint64_t* base(void) const;
+      inline void serialize(Serializer &rez) const;
+      inline void deserialize(Deserializer &derez);
+    public:
+      // Allocates memory that becomes owned by the caller
+      inline char* to_string(void) const;
+    public:
+      static inline int pop_count(const AVX512TLBitMask<MAX> &mask);
+      static inline uint64_t extract_mask(__m512i value);
+      static inline uint64_t extract_mask(__m512d value);
+    protected:
+      union {
+        __m512i avx512_vector[MAX/512];
+        __m512d avx512_double[MAX/512];
+        uint64_t bit_vector[MAX/64];
+      } bits;
+      uint64_t sum_mask;
+    public:
+      static const unsigned ELEMENT_SIZE = 64;
+      static const unsigned ELEMENTS = MAX/ELEMENT_SIZE;
+#if __cplusplus >= 201103L
+    }; // alignment handled above
+#else
+    } __attribute__((aligned(64)));
+#endif
+#endif // __AVX512F__
+
     template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
     class CompoundBitMask {
     public:
@@ -1004,6 +1230,7 @@ namespace Legion {
       inline bool is_set(unsigned bit) const;
       inline int find_first_set(void) const;
       inline int find_index_set(int index) const;
+      inline int find_next_set(int start) const;
       inline void clear(void);
     public:
       inline bool operator==(const CompoundBitMask &rhs) const;
@@ -1106,10 +1333,11 @@ namespace Legion {
              bool BIDIR/* = false (bi-directional)*/>
     class IntegerSet {
     public:
-      // Size of an STL Node object in bytes
-      // This value is approximated over different STL
-      // implementations but in general it should be close
-      static const size_t STL_SET_NODE_SIZE = 32;
+      // Small sets are stored inline in the object itself with no
+      // allocation, medium ones in a sorted vector, and large ones
+      // in a bitmask once the vector would be bigger than the mask
+      static const size_t INLINE_ENTRIES = 
+        (2 * sizeof(void*) > sizeof(IT)) ? (2 * sizeof(void*) / sizeof(IT)) : 1;
     public:
       // Need to inherit form LegionHeapify for alignment
       struct DenseSet : public Internal::LegionHeapify<DenseSet> {
@@ -1143,6 +1371,32 @@ namespace Legion {
       private:
         IntegerSet &target;
       };
+      // Visits the values in increasing order for every representation
+      class const_iterator {
+      public:
+        typedef std::forward_iterator_tag iterator_category;
+        typedef IT value_type;
+        typedef ptrdiff_t difference_type;
+        typedef const IT* pointer;
+        typedef IT reference;
+      public:
+        const_iterator(void) : set(NULL), offset(0), value(0) { }
+        const_iterator(const IntegerSet *s, bool begin);
+      public:
+        inline IT operator*(void) const { return value; }
+        inline const_iterator& operator++(void);
+        inline const_iterator operator++(int);
+        inline bool operator==(const const_iterator &rhs) const
+          { return ((set == rhs.set) && (offset == rhs.offset)); }
+        inline bool operator!=(const const_iterator &rhs) const
+          { return !(*this == rhs); }
+      private:
+        const IntegerSet *set;
+        // Position in the sparse values, or for a dense set the number
+        // of values already visited
+        size_t offset;
+        IT value;
+      };
     public:
       IntegerSet(void);
       IntegerSet(const IntegerSet &rhs);
@@ -1160,6 +1414,10 @@ namespace Legion {
       // the functor over all the entries in the set.
       template<typename FUNCTOR>
       inline void map(FUNCTOR &functor) const;
+      inline const_iterator begin(void) const 
+        { return const_iterator(this, true/*begin*/); }
+      inline const_iterator end(void) const
+        { return const_iterator(this, false/*begin*/); }
     public:
       inline void serialize(Serializer &rez) const;
       inline void deserialize(Deserializer &derez);
@@ -1178,9 +1436,24 @@ namespace Legion {
       inline void clear(void);
       inline IntegerSet& swap(IntegerSet &rhs);
     protected:
-      bool sparse;
+      // The values of an inline or sorted set, in increasing order
+      inline const IT* sparse_values(void) const;
+      inline size_t sparse_size(void) const;
+      // Replaces the contents with the given sorted values
+      inline void set_sparse(const IT *values, size_t count);
+      inline void make_dense(void);
+      inline void release(void);
+    protected:
+      enum Representation {
+        INLINE_REP,
+        SORTED_REP,
+        DENSE_REP,
+      };
+      unsigned char rep;
+      unsigned char inline_count;
       union {
-        typename std::set<IT>* sparse;
+        IT                     values[INLINE_ENTRIES];
+        typename std::vector<IT>* sorted;
         DenseSet*              dense;
       } set_ptr;
     };
@@ -1304,6 +1577,81 @@ namespace Legion {
       }
     };
 
+    /////////////////////////////////////////////////////////////
+    // Concurrent Lookup Table 
+    /////////////////////////////////////////////////////////////
+    /**
+     * \class ConcurrentLookupTable
+     * A hash table from keys to pointers that supports lookups 
+     * without taking any locks. Writers (insert and erase) must be 
+     * serialized by the caller. Entries and bucket arrays that are
+     * unlinked are retired rather than freed. Readers register in one
+     * of two counters picked by the parity of the table's epoch, and
+     * the writers periodically advance the epoch and free whatever was
+     * retired before the previous advance once no reader from before
+     * it remains, so a concurrent reader will never touch freed
+     * memory. A reader can miss an entry that is being
+     * inserted concurrently, so callers must retry a failed lookup
+     * while holding the lock that serializes the writers.
+     */
+    template<typename KEY, typename VAL, typename HASH>
+    class ConcurrentLookupTable {
+    public:
+      struct Entry : public Internal::LegionHeapify<Entry> {
+      public:
+        Entry(const KEY &k, VAL v, Entry *n)
+          : key(k), value(v), next(n) { }
+      public:
+        const KEY key;
+        const VAL value;
+        Entry *volatile next;
+      };
+      struct BucketArray {
+      public:
+        BucketArray(size_t count);
+        ~BucketArray(void);
+      private:
+        BucketArray(const BucketArray &rhs);
+        BucketArray& operator=(const BucketArray &rhs);
+      public:
+        const size_t mask;
+        Entry *volatile *const heads;
+      };
+    public:
+      // Retired entries that trigger an attempt to reclaim memory
+      static const size_t RECLAIM_THRESHOLD = 256;
+    public:
+      ConcurrentLookupTable(size_t initial_buckets = 64);
+      ConcurrentLookupTable(const ConcurrentLookupTable &rhs);
+      ~ConcurrentLookupTable(void);
+    public:
+      ConcurrentLookupTable& operator=(const ConcurrentLookupTable &rhs);
+    public:
+      // Lock-free, returns NULL if the key is not present
+      VAL find(const KEY &key) const;
+      inline bool contains(const KEY &key) const { return (find(key) != NULL); }
+      // The caller must serialize these
+      void insert(const KEY &key, VAL value);
+      VAL erase(const KEY &key);
+      void get_values(std::vector<VAL> &values) const;
+      inline size_t size(void) const { return count; }
+    protected:
+      static inline size_t hash(const KEY &key);
+      void grow(void);
+      // Returns the parity that has to be passed to end_read
+      unsigned begin_read(void) const;
+      void end_read(unsigned parity) const;
+      void try_reclaim(void);
+    protected:
+      BucketArray *volatile current;
+      size_t count;
+      volatile unsigned epoch;
+      mutable volatile unsigned active_readers[2];
+      // Retired since the last epoch advance and before it
+      std::vector<Entry*> retired_entries, pending_entries;
+      std::vector<BucketArray*> retired_arrays, pending_arrays;
+    };
+
     //--------------------------------------------------------------------------
     // Give the implementations here so the templates get instantiated
     //--------------------------------------------------------------------------
@@ -1322,8 +1670,8 @@ namespace Legion {
     inline void Serializer::serialize(const T &element)
     //--------------------------------------------------------------------------
     {
-      while ((index + sizeof(T)) > total_bytes)
-        resize();
+      if ((index + sizeof(T)) > total_bytes)
+        resize(sizeof(T));
       *((T*)(buffer+index)) = element;
       index += sizeof(T);
 #ifdef DEBUG_LEGION
@@ -1336,8 +1684,8 @@ namespace Legion {
     inline void Serializer::serialize<bool>(const bool &element)
     //--------------------------------------------------------------------------
     {
-      while ((index + 4) > total_bytes)
-        resize();
+      if ((index + 4) > total_bytes)
+        resize(4);
       *((bool*)buffer+index) = element;
       index += 4;
 #ifdef DEBUG_LEGION
@@ -1397,6 +1745,33 @@ namespace Legion {
     }
 #endif
 
+#ifdef __AVX512F__
+    //--------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void Serializer::serialize(const AVX512BitMask<MAX> &mask)
+    //--------------------------------------------------------------------------
+    {
+      mask.serialize(*this);
+    }
+
+    //--------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void Serializer::serialize(const AVX512TLBitMask<MAX> &mask)
+    //--------------------------------------------------------------------------
+    {
+      mask.serialize(*this);
+    }
+#endif
+
+    //--------------------------------------------------------------------------
+    template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
+    inline void Serializer::serialize(
+                                const CompoundBitMask<BITMASK,MAX,WORDS> &mask)
+    //--------------------------------------------------------------------------
+    {
+      mask.serialize(*this);
+    }
+
     //--------------------------------------------------------------------------
     template<typename IT, typename DT, bool BIDIR>
     inline void Serializer::serialize(const IntegerSet<IT,DT,BIDIR> &int_set)
@@ -1437,8 +1812,8 @@ namespace Legion {
     inline void Serializer::serialize(const void *src, size_t bytes)
     //--------------------------------------------------------------------------
     {
-      while ((index + bytes) > total_bytes)
-        resize();
+      if ((index + bytes) > total_bytes)
+        resize(bytes);
       memcpy(buffer+index,src,bytes);
       index += bytes;
 #ifdef DEBUG_LEGION
@@ -1446,13 +1821,44 @@ namespace Legion {
 #endif
     }
 
+    //--------------------------------------------------------------------------
+    inline void Serializer::serialize_external(const void *src, size_t bytes)
+    //--------------------------------------------------------------------------
+    {
+      if (bytes < LEGION_SERIALIZER_EXTERNAL_BYTES)
+      {
+        serialize(src, bytes);
+        return;
+      }
+      // Link in a chunk that refers to the source buffer followed by
+      // a fresh chunk of the current size for anything that comes after
+      Chunk *external = (Chunk*)malloc(sizeof(Chunk));
+#ifdef DEBUG_LEGION
+      assert(external != NULL);
+#endif
+      external->ptr = const_cast<char*>(static_cast<const char*>(src));
+      external->size = 0;
+      external->used = bytes;
+      Chunk *next = allocate_chunk(total_bytes);
+      external->next = next;
+      current->used = index;
+      current->next = external;
+      current = next;
+      previous_bytes += index + bytes;
+      buffer = next->data();
+      index = 0;
+#ifdef DEBUG_LEGION
+      context_bytes += bytes;
+#endif
+    }
+
     //--------------------------------------------------------------------------
     inline void Serializer::begin_context(void)
     //--------------------------------------------------------------------------
     {
 #ifdef DEBUG_LEGION
-      while ((index + sizeof(size_t)) > total_bytes)
-        resize();
+      if ((index + sizeof(size_t)) > total_bytes)
+        resize(sizeof(size_t));
       *((size_t*)(buffer+index)) = context_bytes;
       index += sizeof(size_t);
       context_bytes = 0;
@@ -1465,8 +1871,8 @@ namespace Legion {
     {
 #ifdef DEBUG_LEGION
       // Save the size into the buffer
-      while ((index + sizeof(size_t)) > total_bytes)
-        resize();
+      if ((index + sizeof(size_t)) > total_bytes)
+        resize(sizeof(size_t));
       *((size_t*)(buffer+index)) = context_bytes;
       index += sizeof(size_t);
       context_bytes = 0;
@@ -1477,8 +1883,8 @@ namespace Legion {
     inline void* Serializer::reserve_bytes(size_t bytes)
     //--------------------------------------------------------------------------
     {
-      while ((index + bytes) > total_bytes)
-        resize();
+      if ((index + bytes) > total_bytes)
+        resize(bytes);
       void *result = buffer+index;
       index += bytes;
 #ifdef DEBUG_LEGION
@@ -1488,19 +1894,120 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    inline void Serializer::resize(void)
+    inline const void* Serializer::get_buffer(void)
+    //--------------------------------------------------------------------------
+    {
+      if (head == current)
+        return buffer;
+      // Copy all the chunks into one chunk large enough to hold them
+      const size_t used = get_used_bytes();
+      size_t merged_bytes = total_bytes;
+      while (merged_bytes < used)
+        merged_bytes *= 2;
+      Chunk *merged = allocate_chunk(merged_bytes);
+      char *target = merged->data();
+      current->used = index;
+      while (head != NULL)
+      {
+        memcpy(target, head->data(), head->used);
+        target += head->used;
+        Chunk *next = head->next;
+        free_chunk(head);
+        head = next;
+      }
+      head = merged;
+      current = merged;
+      total_bytes = merged_bytes;
+      buffer = merged->data();
+      index = used;
+      previous_bytes = 0;
+      return buffer;
+    }
+
+    //--------------------------------------------------------------------------
+    inline const Serializer::Chunk* Serializer::get_chunks(void)
     //--------------------------------------------------------------------------
     {
-      // Double the buffer size
-      total_bytes *= 2;
+      current->used = index;
+      return head;
+    }
+
+    //--------------------------------------------------------------------------
+    inline void Serializer::resize(size_t needed)
+    //--------------------------------------------------------------------------
+    {
+      // Start a new chunk at least double the size of the current one,
+      // the data already serialized stays where it is
+      size_t next_bytes = 2 * total_bytes;
 #ifdef DEBUG_LEGION
-      assert(total_bytes != 0); // this would cause deallocation
+      assert(next_bytes != 0);
 #endif
-      char *next = (char*)realloc(buffer,total_bytes);
+      while (next_bytes < needed)
+        next_bytes *= 2;
+      Chunk *next = allocate_chunk(next_bytes);
+      current->used = index;
+      current->next = next;
+      current = next;
+      previous_bytes += index;
+      total_bytes = next_bytes;
+      buffer = next->data();
+      index = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ inline Serializer::Chunk* Serializer::allocate_chunk(size_t size)
+    //--------------------------------------------------------------------------
+    {
+      Chunk *result = NULL;
+      if ((size == LEGION_SERIALIZER_CHUNK_SIZE) && (cached_chunks() != NULL))
+      {
+        result = cached_chunks();
+        cached_chunks() = result->next;
+        num_cached_chunks()--;
+      }
+      else
+      {
+        result = (Chunk*)malloc(sizeof(Chunk) + size);
 #ifdef DEBUG_LEGION
-      assert(next != NULL);
+        assert(result != NULL);
 #endif
-      buffer = next;
+        result->ptr = reinterpret_cast<char*>(result+1);
+        result->size = size;
+      }
+      result->next = NULL;
+      result->used = 0;
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ inline void Serializer::free_chunk(Chunk *chunk)
+    //--------------------------------------------------------------------------
+    {
+      if ((chunk->size == LEGION_SERIALIZER_CHUNK_SIZE) && 
+          (num_cached_chunks() < LEGION_SERIALIZER_CACHED_CHUNKS))
+      {
+        chunk->next = cached_chunks();
+        cached_chunks() = chunk;
+        num_cached_chunks()++;
+      }
+      else
+        free(chunk);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ inline Serializer::Chunk*& Serializer::cached_chunks(void)
+    //--------------------------------------------------------------------------
+    {
+      static __thread Chunk *chunks = NULL;
+      return chunks;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ inline unsigned& Serializer::num_cached_chunks(void)
+    //--------------------------------------------------------------------------
+    {
+      static __thread unsigned num_chunks = 0;
+      return num_chunks;
     }
 
     //--------------------------------------------------------------------------
@@ -1596,6 +2103,33 @@ namespace Legion {
     }
 #endif
 
+#ifdef __AVX512F__
+    //--------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void Deserializer::deserialize(AVX512BitMask<MAX> &mask)
+    //--------------------------------------------------------------------------
+    {
+      mask.deserialize(*this);
+    }
+
+    //--------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void Deserializer::deserialize(AVX512TLBitMask<MAX> &mask)
+    //--------------------------------------------------------------------------
+    {
+      mask.deserialize(*this);
+    }
+#endif
+
+    //--------------------------------------------------------------------------
+    template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
+    inline void Deserializer::deserialize(
+                                      CompoundBitMask<BITMASK,MAX,WORDS> &mask)
+    //--------------------------------------------------------------------------
+    {
+      mask.deserialize(*this);
+    }
+
     //--------------------------------------------------------------------------
     template<typename IT, typename DT, bool BIDIR>
     inline void Deserializer::deserialize(IntegerSet<IT,DT,BIDIR> &int_set)
@@ -2050,8 +2584,8 @@ namespace Legion {
       int offset = 0;
       for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
       {
-        int local = __builtin_popcount(bit_vector[idx]);
-        if (index <= local)
+        int local = __builtin_popcountll(bit_vector[idx]);
+        if (index < local)
         {
           for (unsigned j = 0; j < ELEMENT_SIZE; j++)
           {
@@ -2717,8 +3251,8 @@ namespace Legion {
       int offset = 0;
       for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
       {
-        int local = __builtin_popcount(bit_vector[idx]);
-        if (index <= local)
+        int local = __builtin_popcountll(bit_vector[idx]);
+        if (index < local)
         {
           for (unsigned j = 0; j < ELEMENT_SIZE; j++)
           {
@@ -3417,8 +3951,8 @@ namespace Legion {
       int offset = 0;
       for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
       {
-        int local = __builtin_popcount(bits.bit_vector[idx]);
-        if (index <= local)
+        int local = __builtin_popcountll(bits.bit_vector[idx]);
+        if (index < local)
         {
           for (unsigned j = 0; j < ELEMENT_SIZE; j++)
           {
@@ -4045,8 +4579,8 @@ namespace Legion {
       int offset = 0;
       for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
       {
-        int local = __builtin_popcount(bits.bit_vector[idx]);
-        if (index <= local)
+        int local = __builtin_popcountll(bits.bit_vector[idx]);
+        if (index < local)
         {
           for (unsigned j = 0; j < ELEMENT_SIZE; j++)
           {
@@ -4626,7 +5160,7 @@ namespace Legion {
       uint64_t right = _mm_extract_epi64(value, 1);
 #else // Assume we have sse 2
       uint64_t left = _mm_cvtsi128_si64(value);
-      uint64_t right = _mm_cvtsi128_si64(_mm_shuffle_epi32(value, 7));
+      uint64_t right = _mm_cvtsi128_si64(_mm_shuffle_epi32(value, 14));
 #endif
       return (left | right);
     }
@@ -4744,8 +5278,8 @@ namespace Legion {
       int offset = 0;
       for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
       {
-        int local = __builtin_popcount(bits.bit_vector[idx]);
-        if (index <= local)
+        int local = __builtin_popcountll(bits.bit_vector[idx]);
+        if (index < local)
         {
           for (unsigned j = 0; j < ELEMENT_SIZE; j++)
           {
@@ -5461,8 +5995,8 @@ namespace Legion {
       int offset = 0;
       for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
       {
-        int local = __builtin_popcount(bits.bit_vector[idx]);
-        if (index <= local)
+        int local = __builtin_popcountll(bits.bit_vector[idx]);
+        if (index < local)
         {
           for (unsigned j = 0; j < ELEMENT_SIZE; j++)
           {
@@ -6148,9 +6682,9 @@ namespace Legion {
       result |= _mm_extract_epi64(left, 1);
 #else // Assume we have sse 2
       uint64_t result = _mm_cvtsi128_si64(right);
-      result |= _mm_cvtsi128_si64(_mm_shuffle_epi32(right, 7));
+      result |= _mm_cvtsi128_si64(_mm_shuffle_epi32(right, 14));
       result |= _mm_cvtsi128_si64(left);
-      result |= _mm_cvtsi128_si64(_mm_shuffle_epi32(left, 7));
+      result |= _mm_cvtsi128_si64(_mm_shuffle_epi32(left, 14));
 #endif
       return result;
     }
@@ -6167,22 +6701,1402 @@ namespace Legion {
 #undef AVX_ELMTS
 #endif // __AVX__
 
+#ifdef __AVX512F__
+#define AVX512_ELMTS (MAX/512)
+#define BIT_ELMTS (MAX/64)
     //-------------------------------------------------------------------------
-    template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
-    CompoundBitMask<BITMASK,MAX,WORDS>::CompoundBitMask(uint64_t init)
+    template<unsigned int MAX>
+    AVX512BitMask<MAX>::AVX512BitMask(uint64_t init /*= 0*/)
     //-------------------------------------------------------------------------
     {
-      LEGION_STATIC_ASSERT(WORDS >= 2);
-      LEGION_STATIC_ASSERT(VAL_BITS <= (8*sizeof(uint64_t)));
-      LEGION_STATIC_ASSERT((1 << VAL_BITS) >= MAX);
-      if (init == 0)
-      {
-        set_count(0);
-      }
-      else
+      LEGION_STATIC_ASSERT((MAX % 512) == 0);
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
       {
-        set_count(DENSE_CNT);
-        set_dense(new BITMASK(init));
+        bits.bit_vector[idx] = init;
+      }
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    AVX512BitMask<MAX>::AVX512BitMask(const AVX512BitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      LEGION_STATIC_ASSERT((MAX % 512) == 0);
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = rhs(idx);
+      }
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    AVX512BitMask<MAX>::~AVX512BitMask(void)
+    //-------------------------------------------------------------------------
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512BitMask<MAX>::set_bit(unsigned bit)
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(bit < MAX);
+#endif
+      unsigned idx = bit >> 6;
+      bits.bit_vector[idx] |= (1UL << (bit & 0x3F));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512BitMask<MAX>::unset_bit(unsigned bit)
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(bit < MAX);
+#endif
+      unsigned idx = bit >> 6;
+      bits.bit_vector[idx] &= ~(1UL << (bit & 0x3F));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512BitMask<MAX>::assign_bit(unsigned bit, bool val)
+    //-------------------------------------------------------------------------
+    {
+      if (val)
+        set_bit(bit);
+      else
+        unset_bit(bit);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512BitMask<MAX>::is_set(unsigned bit) const
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(bit < MAX);
+#endif
+      unsigned idx = bit >> 6;
+      return (bits.bit_vector[idx] & (1UL << (bit & 0x3F)));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline int AVX512BitMask<MAX>::find_first_set(void) const
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx])
+        {
+          for (unsigned j = 0; j < ELEMENT_SIZE; j++)
+          {
+            if (bits.bit_vector[idx] & (1UL << j))
+            {
+              return (idx*ELEMENT_SIZE + j);
+            }
+          }
+        }
+      }
+      return -1;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline int AVX512BitMask<MAX>::find_index_set(int index) const
+    //-------------------------------------------------------------------------
+    {
+      int offset = 0;
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        int local = __builtin_popcountll(bits.bit_vector[idx]);
+        if (index < local)
+        {
+          for (unsigned j = 0; j < ELEMENT_SIZE; j++)
+          {
+            if (bits.bit_vector[idx] & (1ULL << j))
+            {
+              if (index == 0)
+                return (offset + j);
+              index--;
+            }
+          }
+        }
+        index -= local;
+        offset += ELEMENT_SIZE;
+      }
+      return -1;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline int AVX512BitMask<MAX>::find_next_set(int start) const
+    //-------------------------------------------------------------------------
+    {
+      if (start < 0)
+        start = 0;
+      int idx = start / ELEMENT_SIZE; // truncate
+      int offset = idx * ELEMENT_SIZE; 
+      int j = start % ELEMENT_SIZE;
+      if (j > 0) // if we are already in the middle of element search it
+      {
+        for ( ; j < int(ELEMENT_SIZE); j++)
+        {
+          if (bits.bit_vector[idx] & (1ULL << j))
+            return (offset + j);
+        }
+        idx++;
+        offset += ELEMENT_SIZE;
+      }
+      for ( ; idx < int(BIT_ELMTS); idx++)
+      {
+        if (bits.bit_vector[idx] > 0) // if it has any valid entries, find next
+        {
+          for (j = 0; j < int(ELEMENT_SIZE); j++)
+          {
+            if (bits.bit_vector[idx] & (1ULL << j))
+              return (offset + j);
+          }
+        }
+        offset += ELEMENT_SIZE;
+      }
+      return -1;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512BitMask<MAX>::clear(void)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_set1_epi32(0);
+      }
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const __m512i& AVX512BitMask<MAX>::operator()(
+                                                 const unsigned int &idx) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_vector[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline __m512i& AVX512BitMask<MAX>::operator()(const unsigned int &idx)
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_vector[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const uint64_t& AVX512BitMask<MAX>::operator[](
+                                                 const unsigned int &idx) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.bit_vector[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline uint64_t& AVX512BitMask<MAX>::operator[](const unsigned int &idx) 
+    //-------------------------------------------------------------------------
+    {
+      return bits.bit_vector[idx]; 
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const __m512d& AVX512BitMask<MAX>::elem(
+                                                  const unsigned int &idx) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_double[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline __m512d& AVX512BitMask<MAX>::elem(const unsigned int &idx)
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_double[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512BitMask<MAX>::operator==(const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx] != rhs[idx]) 
+          return false;
+      }
+      return true;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512BitMask<MAX>::operator<(const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      // Only be less than if the bits are a subset of the rhs bits
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx] < rhs[idx])
+          return true;
+        else if (bits.bit_vector[idx] > rhs[idx])
+          return false;
+      }
+      // Otherwise they are equal so false
+      return false;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512BitMask<MAX>::operator!=(const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      return !(*this == rhs);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX>& AVX512BitMask<MAX>::operator=(
+                                                       const AVX512BitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = rhs(idx);
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX> AVX512BitMask<MAX>::operator~(void) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512BitMask<MAX> result;
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        result[idx] = ~(bits.bit_vector[idx]);
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX> AVX512BitMask<MAX>::operator|(
+                                                 const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512BitMask<MAX> result;
+      // If we have this instruction use it because it has higher throughput
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        result(idx) = _mm512_or_si512(bits.avx512_vector[idx], rhs(idx));
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX> AVX512BitMask<MAX>::operator&(
+                                                 const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512BitMask<MAX> result;
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        result(idx) = _mm512_and_si512(bits.avx512_vector[idx], rhs(idx));
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX> AVX512BitMask<MAX>::operator^(
+                                                 const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512BitMask<MAX> result;
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        result(idx) = _mm512_xor_si512(bits.avx512_vector[idx], rhs(idx));
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX>& AVX512BitMask<MAX>::operator|=(
+                                                       const AVX512BitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_or_si512(bits.avx512_vector[idx],
+                                                  rhs(idx));
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX>& AVX512BitMask<MAX>::operator&=(
+                                                       const AVX512BitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_and_si512(bits.avx512_vector[idx],
+                                                   rhs(idx));
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX>& AVX512BitMask<MAX>::operator^=(
+                                                       const AVX512BitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_xor_si512(bits.avx512_vector[idx],
+                                                   rhs(idx));
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512BitMask<MAX>::operator*(const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx] & rhs[idx])
+          return false;
+      }
+      return true;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX> AVX512BitMask<MAX>::operator-(
+                                                 const AVX512BitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512BitMask<MAX> result;
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        result(idx) = _mm512_andnot_si512(rhs(idx), bits.avx512_vector[idx]);
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX>& AVX512BitMask<MAX>::operator-=(
+                                                       const AVX512BitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_andnot_si512(rhs(idx), 
+                                                   bits.avx512_vector[idx]);
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512BitMask<MAX>::operator!(void) const
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx] != 0)
+          return false;
+      }
+      return true;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX> AVX512BitMask<MAX>::operator<<(
+                                                           unsigned shift) const
+    //-------------------------------------------------------------------------
+    {
+      // Find the range
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      AVX512BitMask<MAX> result;
+      if (!local)
+      {
+        // Fast case where we just have to move the individual words
+        for (int idx = (BIT_ELMTS-1); idx >= int(range); idx--)
+        {
+          result[idx] = bits.bit_vector[idx-range]; 
+        }
+        // fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          result[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        for (int idx = (BIT_ELMTS-1); idx > int(range); idx--)
+        {
+          uint64_t left = bits.bit_vector[idx-range] << local;
+          uint64_t right = bits.bit_vector[idx-(range+1)] >> ((1 << 6) - local);
+          result[idx] = left | right;
+        }
+        // Handle the last case
+        result[range] = bits.bit_vector[0] << local; 
+        // Fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          result[idx] = 0;
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX> AVX512BitMask<MAX>::operator>>(
+                                                           unsigned shift) const
+    //-------------------------------------------------------------------------
+    {
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      AVX512BitMask<MAX> result;
+      if (!local)
+      {
+        // Fast case where we just have to move individual words
+        for (unsigned idx = 0; idx < (BIT_ELMTS-range); idx++)
+        {
+          result[idx] = bits.bit_vector[idx+range];
+        }
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < (BIT_ELMTS); idx++)
+          result[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        for (unsigned idx = 0; idx < (BIT_ELMTS-(range+1)); idx++)
+        {
+          uint64_t right = bits.bit_vector[idx+range] >> local;
+          uint64_t left = bits.bit_vector[idx+range+1] << ((1 << 6) - local);
+          result[idx] = left | right;
+        }
+        // Handle the last case
+        result[BIT_ELMTS-(range+1)] = bits.bit_vector[BIT_ELMTS-1] >> local;
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < BIT_ELMTS; idx++)
+          result[idx] = 0;
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX>& AVX512BitMask<MAX>::operator<<=(unsigned shift)
+    //-------------------------------------------------------------------------
+    {
+      // Find the range
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      if (!local)
+      {
+        // Fast case where we just have to move the individual words
+        for (int idx = (BIT_ELMTS-1); idx >= int(range); idx--)
+        {
+          bits.bit_vector[idx] = bits.bit_vector[idx-range]; 
+        }
+        // fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        for (int idx = (BIT_ELMTS-1); idx > int(range); idx--)
+        {
+          uint64_t left = bits.bit_vector[idx-range] << local;
+          uint64_t right = bits.bit_vector[idx-(range+1)] >> ((1 << 6) - local);
+          bits.bit_vector[idx] = left | right;
+        }
+        // Handle the last case
+        bits.bit_vector[range] = bits.bit_vector[0] << local; 
+        // Fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512BitMask<MAX>& AVX512BitMask<MAX>::operator>>=(unsigned shift)
+    //-------------------------------------------------------------------------
+    {
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      if (!local)
+      {
+        // Fast case where we just have to move individual words
+        for (unsigned idx = 0; idx < (BIT_ELMTS-range); idx++)
+        {
+          bits.bit_vector[idx] = bits.bit_vector[idx+range];
+        }
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < (BIT_ELMTS); idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        uint64_t carry_mask = 0;
+        for (unsigned idx = 0; idx < local; idx++)
+          carry_mask |= (1 << idx);
+        for (unsigned idx = 0; idx < (BIT_ELMTS-(range+1)); idx++)
+        {
+          uint64_t right = bits.bit_vector[idx+range] >> local;
+          uint64_t left = bits.bit_vector[idx+range+1] << ((1 << 6) - local);
+          bits.bit_vector[idx] = left | right;
+        }
+        // Handle the last case
+        bits.bit_vector[BIT_ELMTS-(range+1)] = 
+                                      bits.bit_vector[BIT_ELMTS-1] >> local;
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < BIT_ELMTS; idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline uint64_t AVX512BitMask<MAX>::get_hash_key(void) const
+    //-------------------------------------------------------------------------
+    {
+      uint64_t result = 0;
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        result |= bits.bit_vector[idx];
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const uint64_t* AVX512BitMask<MAX>::base(void) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.bit_vector;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512BitMask<MAX>::serialize(Serializer &rez) const
+    //-------------------------------------------------------------------------
+    {
+      rez.serialize(bits.bit_vector, (MAX/8));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512BitMask<MAX>::deserialize(Deserializer &derez)
+    //-------------------------------------------------------------------------
+    {
+      derez.deserialize(bits.bit_vector, (MAX/8));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline char* AVX512BitMask<MAX>::to_string(void) const
+    //-------------------------------------------------------------------------
+    {
+      return BitMaskHelper::to_string(bits.bit_vector, MAX);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    /*static*/ inline int AVX512BitMask<MAX>::pop_count(
+                                                 const AVX512BitMask<MAX> &mask)
+    //-------------------------------------------------------------------------
+    {
+      int result = 0;
+#ifndef VALGRIND
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        result += __builtin_popcountl(mask[idx]);
+      }
+#else
+      for (unsigned idx = 0; idx < MAX; idx++)
+      {
+        if (mask.is_set(idx))
+          result++;
+      }
+#endif
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    AVX512TLBitMask<MAX>::AVX512TLBitMask(uint64_t init /*= 0*/)
+      : sum_mask(init)
+    //-------------------------------------------------------------------------
+    {
+      LEGION_STATIC_ASSERT((MAX % 512) == 0);
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        bits.bit_vector[idx] = init;
+      }
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    AVX512TLBitMask<MAX>::AVX512TLBitMask(const AVX512TLBitMask &rhs)
+      : sum_mask(rhs.sum_mask)
+    //-------------------------------------------------------------------------
+    {
+      LEGION_STATIC_ASSERT((MAX % 512) == 0);
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = rhs(idx);
+      }
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    AVX512TLBitMask<MAX>::~AVX512TLBitMask(void)
+    //-------------------------------------------------------------------------
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512TLBitMask<MAX>::set_bit(unsigned bit)
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(bit < MAX);
+#endif
+      unsigned idx = bit >> 6;
+      const uint64_t set_mask = (1UL << (bit & 0x3F));
+      bits.bit_vector[idx] |= set_mask;
+      sum_mask |= set_mask;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512TLBitMask<MAX>::unset_bit(unsigned bit)
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(bit < MAX);
+#endif
+      unsigned idx = bit >> 6;
+      const uint64_t set_mask = (1UL << (bit & 0x3F));
+      const uint64_t unset_mask = ~set_mask;
+      bits.bit_vector[idx] &= unset_mask;
+      // Unset the summary mask and then reset if necessary
+      sum_mask &= unset_mask;
+      for (unsigned i = 0; i < BIT_ELMTS; i++)
+        sum_mask |= bits.bit_vector[i];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512TLBitMask<MAX>::assign_bit(unsigned bit, bool val)
+    //-------------------------------------------------------------------------
+    {
+      if (val)
+        set_bit(bit);
+      else
+        unset_bit(bit);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512TLBitMask<MAX>::is_set(unsigned bit) const
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(bit < MAX);
+#endif
+      unsigned idx = bit >> 6;
+      return (bits.bit_vector[idx] & (1UL << (bit & 0x3F)));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline int AVX512TLBitMask<MAX>::find_first_set(void) const
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx])
+        {
+          for (unsigned j = 0; j < ELEMENT_SIZE; j++)
+          {
+            if (bits.bit_vector[idx] & (1UL << j))
+            {
+              return (idx*ELEMENT_SIZE+ j);
+            }
+          }
+        }
+      }
+      return -1;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline int AVX512TLBitMask<MAX>::find_index_set(int index) const
+    //-------------------------------------------------------------------------
+    {
+      int offset = 0;
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        int local = __builtin_popcountll(bits.bit_vector[idx]);
+        if (index < local)
+        {
+          for (unsigned j = 0; j < ELEMENT_SIZE; j++)
+          {
+            if (bits.bit_vector[idx] & (1ULL << j))
+            {
+              if (index == 0)
+                return (offset + j);
+              index--;
+            }
+          }
+        }
+        index -= local;
+        offset += ELEMENT_SIZE;
+      }
+      return -1;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline int AVX512TLBitMask<MAX>::find_next_set(int start) const
+    //-------------------------------------------------------------------------
+    {
+      if (start < 0)
+        start = 0;
+      int idx = start / ELEMENT_SIZE; // truncate
+      int offset = idx * ELEMENT_SIZE; 
+      int j = start % ELEMENT_SIZE;
+      if (j > 0) // if we are already in the middle of element search it
+      {
+        for ( ; j < int(ELEMENT_SIZE); j++)
+        {
+          if (bits.bit_vector[idx] & (1ULL << j))
+            return (offset + j);
+        }
+        idx++;
+        offset += ELEMENT_SIZE;
+      }
+      for ( ; idx < int(BIT_ELMTS); idx++)
+      {
+        if (bits.bit_vector[idx] > 0) // if it has any valid entries, find next
+        {
+          for (j = 0; j < int(ELEMENT_SIZE); j++)
+          {
+            if (bits.bit_vector[idx] & (1ULL << j))
+              return (offset + j);
+          }
+        }
+        offset += ELEMENT_SIZE;
+      }
+      return -1;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512TLBitMask<MAX>::clear(void)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_set1_epi32(0);
+      }
+      sum_mask = 0;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const __m512i& AVX512TLBitMask<MAX>::operator()(
+                                                 const unsigned int &idx) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_vector[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline __m512i& AVX512TLBitMask<MAX>::operator()(const unsigned int &idx)
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_vector[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const uint64_t& AVX512TLBitMask<MAX>::operator[](
+                                                 const unsigned int &idx) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.bit_vector[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline uint64_t& AVX512TLBitMask<MAX>::operator[](const unsigned int &idx) 
+    //-------------------------------------------------------------------------
+    {
+      return bits.bit_vector[idx]; 
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const __m512d& AVX512TLBitMask<MAX>::elem(const unsigned &idx) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_double[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline __m512d& AVX512TLBitMask<MAX>::elem(const unsigned &idx)
+    //-------------------------------------------------------------------------
+    {
+      return bits.avx512_double[idx];
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512TLBitMask<MAX>::operator==(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      if (sum_mask != rhs.sum_mask)
+        return false;
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx] != rhs[idx]) 
+          return false;
+      }
+      return true;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512TLBitMask<MAX>::operator<(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      // Only be less than if the bits are a subset of the rhs bits
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        if (bits.bit_vector[idx] < rhs[idx])
+          return true;
+        else if (bits.bit_vector[idx] > rhs[idx])
+          return false;
+      }
+      // Otherwise they are equal so false
+      return false;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512TLBitMask<MAX>::operator!=(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      return !(*this == rhs);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX>& AVX512TLBitMask<MAX>::operator=(
+                                                     const AVX512TLBitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      sum_mask = rhs.sum_mask;
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = rhs(idx);
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX> AVX512TLBitMask<MAX>::operator~(void) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512TLBitMask<MAX> result;
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        result[idx] = ~(bits.bit_vector[idx]);
+        result.sum_mask |= result[idx];
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX> AVX512TLBitMask<MAX>::operator|(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512TLBitMask<MAX> result;
+      result.sum_mask = sum_mask | rhs.sum_mask;
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        result(idx) = _mm512_or_si512(bits.avx512_vector[idx], rhs(idx));
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX> AVX512TLBitMask<MAX>::operator&(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512TLBitMask<MAX> result;
+      // If they are independent then we are done
+      if (sum_mask & rhs.sum_mask)
+      {
+        __m512i temp_sum = _mm512_set1_epi32(0);
+        for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+        {
+          result(idx) = _mm512_and_si512(bits.avx512_vector[idx], rhs(idx));
+          temp_sum = _mm512_or_si512(temp_sum, result(idx));
+        }
+        result.sum_mask = extract_mask(temp_sum); 
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX> AVX512TLBitMask<MAX>::operator^(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512TLBitMask<MAX> result;
+      __m512i temp_sum = _mm512_set1_epi32(0);
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        result(idx) = _mm512_xor_si512(bits.avx512_vector[idx], rhs(idx));
+        temp_sum = _mm512_or_si512(temp_sum, result(idx));
+      }
+      result.sum_mask = extract_mask(temp_sum);
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX>& AVX512TLBitMask<MAX>::operator|=(
+                                                     const AVX512TLBitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      sum_mask |= rhs.sum_mask;
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_or_si512(bits.avx512_vector[idx],
+                                                  rhs(idx));
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX>& AVX512TLBitMask<MAX>::operator&=(
+                                                     const AVX512TLBitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      if (sum_mask & rhs.sum_mask)
+      {
+        __m512i temp_sum = _mm512_set1_epi32(0);
+        for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+        {
+          bits.avx512_vector[idx] = _mm512_and_si512(bits.avx512_vector[idx], 
+                                                  rhs(idx));
+          temp_sum = _mm512_or_si512(temp_sum, bits.avx512_vector[idx]);
+        }
+        sum_mask = extract_mask(temp_sum); 
+      }
+      else
+      {
+        sum_mask = 0;
+        for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+          bits.avx512_vector[idx] = _mm512_set1_epi32(0);
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX>& AVX512TLBitMask<MAX>::operator^=(
+                                                     const AVX512TLBitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      __m512i temp_sum = _mm512_set1_epi32(0);
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_xor_si512(bits.avx512_vector[idx],
+                                                   rhs(idx));
+        temp_sum = _mm512_or_si512(temp_sum, bits.avx512_vector[idx]);
+      }
+      sum_mask = extract_mask(temp_sum);
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512TLBitMask<MAX>::operator*(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      if (sum_mask & rhs.sum_mask)
+      {
+        for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+        {
+          if (bits.bit_vector[idx] & rhs[idx])
+            return false;
+        }
+      }
+      return true;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX> AVX512TLBitMask<MAX>::operator-(
+                                               const AVX512TLBitMask &rhs) const
+    //-------------------------------------------------------------------------
+    {
+      AVX512TLBitMask<MAX> result;
+      __m512i temp_sum = _mm512_set1_epi32(0);
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        result(idx) = _mm512_andnot_si512(rhs(idx), bits.avx512_vector[idx]);
+        temp_sum = _mm512_or_si512(temp_sum, result(idx));
+      }
+      result.sum_mask = extract_mask(temp_sum);
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX>& AVX512TLBitMask<MAX>::operator-=(
+                                                     const AVX512TLBitMask &rhs)
+    //-------------------------------------------------------------------------
+    {
+      __m512i temp_sum = _mm512_set1_epi32(0);
+      for (unsigned idx = 0; idx < AVX512_ELMTS; idx++)
+      {
+        bits.avx512_vector[idx] = _mm512_andnot_si512(rhs(idx), 
+                                                   bits.avx512_vector[idx]);
+        temp_sum = _mm512_or_si512(temp_sum, bits.avx512_vector[idx]);
+      }
+      sum_mask = extract_mask(temp_sum);
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline bool AVX512TLBitMask<MAX>::operator!(void) const
+    //-------------------------------------------------------------------------
+    {
+      // A great reason to have a summary mask
+      return (sum_mask == 0);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX> AVX512TLBitMask<MAX>::operator<<(
+                                                          unsigned shift) const
+    //-------------------------------------------------------------------------
+    {
+      // Find the range
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      AVX512TLBitMask<MAX> result;
+      if (!local)
+      {
+        // Fast case where we just have to move the individual words
+        for (int idx = (BIT_ELMTS-1); idx >= int(range); idx--)
+        {
+          result[idx] = bits.bit_vector[idx-range]; 
+          result.sum_mask |= result[idx];
+        }
+        // fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          result[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        for (int idx = (BIT_ELMTS-1); idx > int(range); idx--)
+        {
+          uint64_t left = bits.bit_vector[idx-range] << local;
+          uint64_t right = bits.bit_vector[idx-(range+1)] >> ((1 << 6) - local);
+          result[idx] = left | right;
+          result.sum_mask |= result[idx];
+        }
+        // Handle the last case
+        result[range] = bits.bit_vector[0] << local; 
+        result.sum_mask |= result[range];
+        // Fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          result[idx] = 0;
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX> AVX512TLBitMask<MAX>::operator>>(
+                                                          unsigned shift) const
+    //-------------------------------------------------------------------------
+    {
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      AVX512TLBitMask<MAX> result;
+      if (!local)
+      {
+        // Fast case where we just have to move individual words
+        for (unsigned idx = 0; idx < (BIT_ELMTS-range); idx++)
+        {
+          result[idx] = bits.bit_vector[idx+range];
+          result.sum_mask |= result[idx];
+        }
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < (BIT_ELMTS); idx++)
+          result[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        for (unsigned idx = 0; idx < (BIT_ELMTS-(range+1)); idx++)
+        {
+          uint64_t right = bits.bit_vector[idx+range] >> local;
+          uint64_t left = bits.bit_vector[idx+range+1] << ((1 << 6) - local);
+          result[idx] = left | right;
+          result.sum_mask |= result[idx];
+        }
+        // Handle the last case
+        result[BIT_ELMTS-(range+1)] = bits.bit_vector[BIT_ELMTS-1] >> local;
+        result.sum_mask |= result[BIT_ELMTS-(range+1)];
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < BIT_ELMTS; idx++)
+          result[idx] = 0;
+      }
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX>& AVX512TLBitMask<MAX>::operator<<=(
+                                                                 unsigned shift)
+    //-------------------------------------------------------------------------
+    {
+      // Find the range
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      sum_mask = 0;
+      if (!local)
+      {
+        // Fast case where we just have to move the individual words
+        for (int idx = (BIT_ELMTS-1); idx >= int(range); idx--)
+        {
+          bits.bit_vector[idx] = bits.bit_vector[idx-range]; 
+          sum_mask |= bits.bit_vector[idx];
+        }
+        // fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        for (int idx = (BIT_ELMTS-1); idx > int(range); idx--)
+        {
+          uint64_t left = bits.bit_vector[idx-range] << local;
+          uint64_t right = bits.bit_vector[idx-(range+1)] >> ((1 << 6) - local);
+          bits.bit_vector[idx] = left | right;
+          sum_mask |= bits.bit_vector[idx];
+        }
+        // Handle the last case
+        bits.bit_vector[range] = bits.bit_vector[0] << local; 
+        sum_mask |= bits.bit_vector[range];
+        // Fill in everything else with zeros
+        for (unsigned idx = 0; idx < range; idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline AVX512TLBitMask<MAX>& AVX512TLBitMask<MAX>::operator>>=(
+                                                                 unsigned shift)
+    //-------------------------------------------------------------------------
+    {
+      unsigned range = shift >> 6;
+      unsigned local = shift & 0x3F;
+      sum_mask = 0;
+      if (!local)
+      {
+        // Fast case where we just have to move individual words
+        for (unsigned idx = 0; idx < (BIT_ELMTS-range); idx++)
+        {
+          bits.bit_vector[idx] = bits.bit_vector[idx+range];
+          sum_mask |= bits.bit_vector[idx];
+        }
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < (BIT_ELMTS); idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      else
+      {
+        // Slow case with merging words
+        uint64_t carry_mask = 0;
+        for (unsigned idx = 0; idx < local; idx++)
+          carry_mask |= (1 << idx);
+        for (unsigned idx = 0; idx < (BIT_ELMTS-(range+1)); idx++)
+        {
+          uint64_t right = bits.bit_vector[idx+range] >> local;
+          uint64_t left = bits.bit_vector[idx+range+1] << ((1 << 6) - local);
+          bits.bit_vector[idx] = left | right;
+          sum_mask |= bits.bit_vector[idx];
+        }
+        // Handle the last case
+        bits.bit_vector[BIT_ELMTS-(range+1)] = 
+                                        bits.bit_vector[BIT_ELMTS-1] >> local;
+        sum_mask |= bits.bit_vector[BIT_ELMTS-(range+1)];
+        // Fill in everything else with zeros
+        for (unsigned idx = (BIT_ELMTS-range); idx < BIT_ELMTS; idx++)
+          bits.bit_vector[idx] = 0;
+      }
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline uint64_t AVX512TLBitMask<MAX>::get_hash_key(void) const
+    //-------------------------------------------------------------------------
+    {
+      return sum_mask;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline const uint64_t* AVX512TLBitMask<MAX>::base(void) const
+    //-------------------------------------------------------------------------
+    {
+      return bits.bit_vector;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512TLBitMask<MAX>::serialize(Serializer &rez) const
+    //-------------------------------------------------------------------------
+    {
+      rez.serialize(sum_mask);
+      rez.serialize(bits.bit_vector, (MAX/8));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline void AVX512TLBitMask<MAX>::deserialize(Deserializer &derez)
+    //-------------------------------------------------------------------------
+    {
+      derez.deserialize(sum_mask);
+      derez.deserialize(bits.bit_vector, (MAX/8));
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    inline char* AVX512TLBitMask<MAX>::to_string(void) const
+    //-------------------------------------------------------------------------
+    {
+      return BitMaskHelper::to_string(bits.bit_vector, MAX);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    /*static*/ inline int AVX512TLBitMask<MAX>::pop_count(
+                                               const AVX512TLBitMask<MAX> &mask)
+    //-------------------------------------------------------------------------
+    {
+      int result = 0;
+#ifndef VALGRIND
+      for (unsigned idx = 0; idx < BIT_ELMTS; idx++)
+      {
+        result += __builtin_popcountl(mask[idx]);
+      }
+#else
+      for (unsigned idx = 0; idx < MAX; idx++)
+      {
+        if (mask.is_set(idx))
+          result++;
+      }
+#endif
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    /*static*/ inline uint64_t AVX512TLBitMask<MAX>::extract_mask(__m512i value)
+    //-------------------------------------------------------------------------
+    {
+      // Fold all the 64-bit lanes together
+      return _mm512_reduce_or_epi64(value);
+    }
+
+    //-------------------------------------------------------------------------
+    template<unsigned int MAX>
+    /*static*/ inline uint64_t AVX512TLBitMask<MAX>::extract_mask(__m512d value)
+    //-------------------------------------------------------------------------
+    {
+      __m512i temp = _mm512_castpd_si512(value);
+      return extract_mask(temp);
+    }
+#undef BIT_ELMTS
+#undef AVX512_ELMTS
+#endif // __AVX512F__
+
+    //-------------------------------------------------------------------------
+    template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
+    CompoundBitMask<BITMASK,MAX,WORDS>::CompoundBitMask(uint64_t init)
+    //-------------------------------------------------------------------------
+    {
+      LEGION_STATIC_ASSERT(WORDS >= 2);
+      LEGION_STATIC_ASSERT(VAL_BITS <= (8*sizeof(uint64_t)));
+      LEGION_STATIC_ASSERT((1 << VAL_BITS) >= MAX);
+      if (init == 0)
+      {
+        set_count(0);
+      }
+      else
+      {
+        set_count(DENSE_CNT);
+        set_dense(new BITMASK(init));
       }
     }
 
@@ -6586,6 +8500,34 @@ namespace Legion {
         return -1;
       return get_value<OVERLAP>(index);
     }
+
+    //-------------------------------------------------------------------------
+    template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
+    inline int CompoundBitMask<BITMASK,MAX,WORDS>::find_next_set(
+                                                               int start) const
+    //-------------------------------------------------------------------------
+    {
+      int count = get_count();
+      if (count == DENSE_CNT)
+        return get_dense()->find_next_set(start);
+      if (count == SPARSE_CNT)
+      {
+        SparseSet *sparse = get_sparse();
+        SparseSet::const_iterator finder = sparse->lower_bound(start);
+        if (finder == sparse->end())
+          return -1;
+        return (*finder);
+      }
+      // Inline values are not sorted so find the smallest one past start
+      int result = -1;
+      for (int idx = 0; idx < count; idx++)
+      {
+        int value = get_value<OVERLAP>(idx);
+        if ((value >= start) && ((result < 0) || (value < result)))
+          result = value;
+      }
+      return result;
+    }
     
     //-------------------------------------------------------------------------
     template<typename BITMASK, unsigned int MAX, unsigned int WORDS>
@@ -8082,131 +10024,242 @@ namespace Legion {
     }
 
     //-------------------------------------------------------------------------
-    template<typename BITMASK, unsigned LOG2MAX>
-    void BitPermutation<BITMASK,LOG2MAX>::compress_representation(void)
+    template<typename BITMASK, unsigned LOG2MAX>
+    void BitPermutation<BITMASK,LOG2MAX>::compress_representation(void)
+    //-------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < LOG2MAX; idx++)
+      {
+        if (idx == 0)
+          comp[0] = p[0];
+        else
+        {
+          comp[idx] = sheep_and_goats(p[idx],comp[0]);
+          for (unsigned i = 1; i < idx; i++)
+            comp[idx] = sheep_and_goats(comp[idx],comp[i]);
+        }
+      }
+      dirty = false;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename BITMASK, unsigned LOG2MAX>
+    void BitPermutation<BITMASK,LOG2MAX>::test_identity(void)
+    //-------------------------------------------------------------------------
+    {
+      // If we're still the identity then we're done
+      if (identity)
+        return;
+      for (unsigned idx = 0; idx < (1 << LOG2MAX); idx++)
+      {
+        unsigned src = 1 << idx;
+        unsigned dst = get_dst(src);
+        if (src != dst)
+        {
+          identity = false;
+          return;
+        }
+      }
+      identity = true;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename IT, typename DT, bool BIDIR>
+    IntegerSet<IT,DT,BIDIR>::const_iterator::const_iterator(
+                                             const IntegerSet *s, bool begin)
+      : set(s), offset(0), value(0)
+    //-------------------------------------------------------------------------
+    {
+      if (set->rep == DENSE_REP)
+      {
+        if (!begin || !(set->set_ptr.dense->set))
+          offset = set->size();
+        else
+          value = set->set_ptr.dense->set.find_first_set();
+      }
+      else
+      {
+        if (begin)
+        {
+          if (set->sparse_size() > 0)
+            value = set->sparse_values()[0];
+        }
+        else
+          offset = set->sparse_size();
+      }
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename IT, typename DT, bool BIDIR>
+    inline typename IntegerSet<IT,DT,BIDIR>::const_iterator& 
+                      IntegerSet<IT,DT,BIDIR>::const_iterator::operator++(void)
+    //-------------------------------------------------------------------------
+    {
+      offset++;
+      if (set->rep == DENSE_REP)
+      {
+        const int next = set->set_ptr.dense->set.find_next_set(value+1);
+        // Past the last value offset already equals the size
+        if (next >= 0)
+          value = next;
+      }
+      else if (offset < set->sparse_size())
+        value = set->sparse_values()[offset];
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename IT, typename DT, bool BIDIR>
+    inline typename IntegerSet<IT,DT,BIDIR>::const_iterator
+                       IntegerSet<IT,DT,BIDIR>::const_iterator::operator++(int)
+    //-------------------------------------------------------------------------
+    {
+      const_iterator result = *this;
+      ++(*this);
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename IT, typename DT, bool BIDIR>
+    IntegerSet<IT,DT,BIDIR>::IntegerSet(void)
+      : rep(INLINE_REP), inline_count(0)
+    //-------------------------------------------------------------------------
+    {
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename IT, typename DT, bool BIDIR>
+    IntegerSet<IT,DT,BIDIR>::IntegerSet(const IntegerSet &rhs)
+      : rep(INLINE_REP), inline_count(0)
+    //-------------------------------------------------------------------------
+    {
+      if (rhs.rep == DENSE_REP)
+      {
+        set_ptr.dense = new DenseSet();
+        set_ptr.dense->set = rhs.set_ptr.dense->set;
+        rep = DENSE_REP;
+      }
+      else
+        set_sparse(rhs.sparse_values(), rhs.sparse_size());
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename IT, typename DT, bool BIDIR>
+    IntegerSet<IT,DT,BIDIR>::~IntegerSet(void)
+    //-------------------------------------------------------------------------
+    {
+      release();
+    }
+    
+    //-------------------------------------------------------------------------
+    template<typename IT, typename DT, bool BIDIR>
+    IntegerSet<IT,DT,BIDIR>& 
+                      IntegerSet<IT,DT,BIDIR>::operator=(const IntegerSet &rhs)
     //-------------------------------------------------------------------------
     {
-      for (unsigned idx = 0; idx < LOG2MAX; idx++)
+      if (this == &rhs)
+        return *this;
+      if (rhs.rep == DENSE_REP)
       {
-        if (idx == 0)
-          comp[0] = p[0];
-        else
+        if (rep != DENSE_REP)
         {
-          comp[idx] = sheep_and_goats(p[idx],comp[0]);
-          for (unsigned i = 1; i < idx; i++)
-            comp[idx] = sheep_and_goats(comp[idx],comp[i]);
+          release();
+          set_ptr.dense = new DenseSet();
+          rep = DENSE_REP;
         }
+        set_ptr.dense->set = rhs.set_ptr.dense->set;
       }
-      dirty = false;
+      else
+        set_sparse(rhs.sparse_values(), rhs.sparse_size());
+      return *this;
     }
 
     //-------------------------------------------------------------------------
-    template<typename BITMASK, unsigned LOG2MAX>
-    void BitPermutation<BITMASK,LOG2MAX>::test_identity(void)
+    template<typename IT, typename DT, bool BIDIR>
+    inline const IT* IntegerSet<IT,DT,BIDIR>::sparse_values(void) const
     //-------------------------------------------------------------------------
     {
-      // If we're still the identity then we're done
-      if (identity)
-        return;
-      for (unsigned idx = 0; idx < (1 << LOG2MAX); idx++)
-      {
-        unsigned src = 1 << idx;
-        unsigned dst = get_dst(src);
-        if (src != dst)
-        {
-          identity = false;
-          return;
-        }
-      }
-      identity = true;
+#ifdef DEBUG_LEGION
+      assert(rep != DENSE_REP);
+#endif
+      if (rep == INLINE_REP)
+        return set_ptr.values;
+      else if (set_ptr.sorted->empty())
+        return NULL;
+      else
+        return &(set_ptr.sorted->front());
     }
 
     //-------------------------------------------------------------------------
     template<typename IT, typename DT, bool BIDIR>
-    IntegerSet<IT,DT,BIDIR>::IntegerSet(void)
-      : sparse(true)
+    inline size_t IntegerSet<IT,DT,BIDIR>::sparse_size(void) const
     //-------------------------------------------------------------------------
     {
-      set_ptr.sparse = 0;
+#ifdef DEBUG_LEGION
+      assert(rep != DENSE_REP);
+#endif
+      if (rep == INLINE_REP)
+        return inline_count;
+      else
+        return set_ptr.sorted->size();
     }
 
     //-------------------------------------------------------------------------
     template<typename IT, typename DT, bool BIDIR>
-    IntegerSet<IT,DT,BIDIR>::IntegerSet(const IntegerSet &rhs)
-      : sparse(rhs.sparse)
+    inline void IntegerSet<IT,DT,BIDIR>::set_sparse(const IT *values,
+                                                    size_t count)
     //-------------------------------------------------------------------------
     {
-      if (rhs.sparse)
+      if (count <= INLINE_ENTRIES)
       {
-	if (rhs.set_ptr.sparse && !rhs.set_ptr.sparse->empty())
-	  set_ptr.sparse = new typename std::set<IT>(*rhs.set_ptr.sparse);
-	else
-	  set_ptr.sparse = 0;
+        // Copy first in case the values are our own sorted vector
+        IT temp[INLINE_ENTRIES];
+        for (unsigned idx = 0; idx < count; idx++)
+          temp[idx] = values[idx];
+        release();
+        for (unsigned idx = 0; idx < count; idx++)
+          set_ptr.values[idx] = temp[idx];
+        inline_count = count;
       }
       else
       {
-        set_ptr.dense = new DenseSet();
-        set_ptr.dense->set = rhs.set_ptr.dense->set;
+        typename std::vector<IT> *sorted = 
+          new typename std::vector<IT>(values, values + count);
+        release();
+        set_ptr.sorted = sorted;
+        rep = SORTED_REP;
       }
     }
 
     //-------------------------------------------------------------------------
     template<typename IT, typename DT, bool BIDIR>
-    IntegerSet<IT,DT,BIDIR>::~IntegerSet(void)
+    inline void IntegerSet<IT,DT,BIDIR>::make_dense(void)
     //-------------------------------------------------------------------------
     {
-      if (sparse)
-      {
-	// this may be a null pointer, but delete does the right thing
-        delete set_ptr.sparse;
-      }
-      else
-      {
 #ifdef DEBUG_LEGION
-	assert(set_ptr.dense != NULL);
+      assert(rep != DENSE_REP);
 #endif
-        delete set_ptr.dense;
-      }
+      DenseSet *dense_set = new DenseSet();
+      const IT *values = sparse_values();
+      const size_t count = sparse_size();
+      for (unsigned idx = 0; idx < count; idx++)
+        dense_set->set.set_bit(values[idx]);
+      release();
+      set_ptr.dense = dense_set;
+      rep = DENSE_REP;
     }
-    
+
     //-------------------------------------------------------------------------
     template<typename IT, typename DT, bool BIDIR>
-    IntegerSet<IT,DT,BIDIR>& 
-                      IntegerSet<IT,DT,BIDIR>::operator=(const IntegerSet &rhs)
+    inline void IntegerSet<IT,DT,BIDIR>::release(void)
     //-------------------------------------------------------------------------
     {
-      if (rhs.sparse)
-      {
-        if (!sparse)
-        {
-          delete set_ptr.dense;
-          set_ptr.sparse = 0;
-	  sparse = true;
-        }
-        else if (set_ptr.sparse)
-	  set_ptr.sparse->clear();
-	// if rhs has any contents, copy them over, creating set if needed
-	if (rhs.set_ptr.sparse && !rhs.set_ptr.sparse->empty())
-	{
-	  if (!set_ptr.sparse)
-	    set_ptr.sparse = new typename std::set<IT>(*rhs.set_ptr.sparse);
-	  else
-	    *(set_ptr.sparse) = *(rhs.set_ptr.sparse);
-	}
-      }
-      else
-      {
-        if (sparse)
-        {
-          delete set_ptr.sparse;
-          set_ptr.dense = new DenseSet();
-	  sparse = false;
-        }
-        else
-          set_ptr.dense->set.clear();
-        set_ptr.dense->set = rhs.set_ptr.dense->set;
-      }
-      return *this;
+      if (rep == SORTED_REP)
+        delete set_ptr.sorted;
+      else if (rep == DENSE_REP)
+        delete set_ptr.dense;
+      rep = INLINE_REP;
+      inline_count = 0;
     }
 
     //-------------------------------------------------------------------------
@@ -8214,11 +10267,22 @@ namespace Legion {
     inline bool IntegerSet<IT,DT,BIDIR>::contains(IT index) const
     //-------------------------------------------------------------------------
     {
-      if (sparse)
-        return (set_ptr.sparse &&
-		(set_ptr.sparse->find(index) != set_ptr.sparse->end()));
-      else
-        return set_ptr.dense->set.is_set(index);
+      switch (rep)
+      {
+        case INLINE_REP:
+          {
+            for (unsigned idx = 0; idx < inline_count; idx++)
+              if (set_ptr.values[idx] == index)
+                return true;
+            return false;
+          }
+        case SORTED_REP:
+          return std::binary_search(set_ptr.sorted->begin(),
+                                    set_ptr.sorted->end(), index);
+        default:
+          break;
+      }
+      return set_ptr.dense->set.is_set(index);
     }
     
     //-------------------------------------------------------------------------
@@ -8226,31 +10290,41 @@ namespace Legion {
     inline void IntegerSet<IT,DT,BIDIR>::add(IT index)
     //-------------------------------------------------------------------------
     {
-      if (sparse)
+      if (rep == DENSE_REP)
       {
-	// Create set if this is the first addition
-	if (!set_ptr.sparse)
-	  set_ptr.sparse = new typename std::set<IT>;
-
-        // Add it and see if it is too big
-        set_ptr.sparse->insert(index);
-        if (sizeof(DT) < (set_ptr.sparse->size() * 
-                          (sizeof(IT) + STL_SET_NODE_SIZE)))
+        set_ptr.dense->set.set_bit(index);
+        return;
+      }
+      if (rep == INLINE_REP)
+      {
+        unsigned pos = 0;
+        while ((pos < inline_count) && (set_ptr.values[pos] < index))
+          pos++;
+        if ((pos < inline_count) && (set_ptr.values[pos] == index))
+          return;
+        if (inline_count < INLINE_ENTRIES)
         {
-          DenseSet *dense_set = new DenseSet();
-          for (typename std::set<IT>::const_iterator it = 
-                set_ptr.sparse->begin(); it != set_ptr.sparse->end(); it++)
-          {
-            dense_set->set.set_bit(*it);
-          }
-          // Delete the sparse set
-          delete set_ptr.sparse;
-          set_ptr.dense = dense_set;
-          sparse = false;
+          for (unsigned idx = inline_count; idx > pos; idx--)
+            set_ptr.values[idx] = set_ptr.values[idx-1];
+          set_ptr.values[pos] = index;
+          inline_count++;
+          return;
         }
+        // Out of inline space so move to a sorted vector
+        typename std::vector<IT> *sorted = new typename std::vector<IT>(
+            set_ptr.values, set_ptr.values + inline_count);
+        set_ptr.sorted = sorted;
+        rep = SORTED_REP;
+        inline_count = 0;
       }
-      else
-        set_ptr.dense->set.set_bit(index);
+      typename std::vector<IT>::iterator finder = 
+        std::lower_bound(set_ptr.sorted->begin(), set_ptr.sorted->end(), index);
+      if ((finder != set_ptr.sorted->end()) && (*finder == index))
+        return;
+      set_ptr.sorted->insert(finder, index);
+      // Switch to the bitmask once it is smaller than the vector
+      if (sizeof(DT) < (set_ptr.sorted->size() * sizeof(IT)))
+        make_dense();
     }
 
     //-------------------------------------------------------------------------
@@ -8258,38 +10332,62 @@ namespace Legion {
     inline void IntegerSet<IT,DT,BIDIR>::remove(IT index)
     //-------------------------------------------------------------------------
     {
-      if (!sparse)
+      switch (rep)
       {
-        set_ptr.dense->set.unset_bit(index); 
-        // Only check for flip back if we are bi-directional
-        if (BIDIR)
-        {
-          IT count = DT::pop_count(set_ptr.dense->set);
-          if ((count * (sizeof(IT) + STL_SET_NODE_SIZE)) < sizeof(DT))
+        case INLINE_REP:
+          {
+            for (unsigned idx = 0; idx < inline_count; idx++)
+            {
+              if (set_ptr.values[idx] != index)
+                continue;
+              for (unsigned idx2 = idx+1; idx2 < inline_count; idx2++)
+                set_ptr.values[idx2-1] = set_ptr.values[idx2];
+              inline_count--;
+              break;
+            }
+            break;
+          }
+        case SORTED_REP:
           {
-            typename std::set<IT> *sparse_set = new typename std::set<IT>();
-            for (IT idx = 0; idx < DT::ELEMENTS; idx++)
+            typename std::vector<IT>::iterator finder = 
+              std::lower_bound(set_ptr.sorted->begin(), 
+                               set_ptr.sorted->end(), index);
+            if ((finder == set_ptr.sorted->end()) || (*finder != index))
+              break;
+            set_ptr.sorted->erase(finder);
+            // Always go back to inline once we are empty, otherwise
+            // only check for flip back if we are bi-directional
+            if (set_ptr.sorted->empty())
+              release();
+            else if (BIDIR && (set_ptr.sorted->size() <= INLINE_ENTRIES))
+              set_sparse(sparse_values(), sparse_size());
+            break;
+          }
+        case DENSE_REP:
+          {
+            set_ptr.dense->set.unset_bit(index); 
+            // Only check for flip back if we are bi-directional, and 
+            // leave some slack so we don't bounce back and forth
+            if (BIDIR)
             {
-              if (set_ptr.dense->set[idx])
+              const size_t count = DT::pop_count(set_ptr.dense->set);
+              if ((2 * count * sizeof(IT)) < sizeof(DT))
               {
-                for (IT i = 0; i < DT::ELEMENT_SIZE; i++)
-                {
-                  IT value = idx * DT::ELEMENT_SIZE + i;
-                  if (set_ptr.dense->set.is_set(value))
-                    sparse_set->insert(value);
-                }
+                std::vector<IT> values;
+                values.reserve(count);
+                for (const_iterator it = begin(); it != end(); it++)
+                  values.push_back(*it);
+                if (values.empty())
+                  release();
+                else
+                  set_sparse(&values.front(), values.size());
               }
             }
-            // Delete the dense set
-            delete set_ptr.dense;
-            set_ptr.sparse = sparse_set;
-            sparse = true;
+            break;
           }
-        }
+        default:
+          assert(false);
       }
-      else
-	if (set_ptr.sparse)
-	  set_ptr.sparse->erase(index);
     }
 
     //-------------------------------------------------------------------------
@@ -8297,12 +10395,12 @@ namespace Legion {
     inline IT IntegerSet<IT,DT,BIDIR>::find_first_set(void) const
     //-------------------------------------------------------------------------
     {
-      if (sparse)
+      if (rep != DENSE_REP)
       {
 #ifdef DEBUG_LEGION
-        assert(set_ptr.sparse && !set_ptr.sparse->empty());
+        assert(sparse_size() > 0);
 #endif
-        return *(set_ptr.sparse->begin());
+        return sparse_values()[0];
       }
       else
       {
@@ -8322,23 +10420,11 @@ namespace Legion {
       assert(index >= 0);
       assert(index < int(size()));
 #endif
+      if (rep != DENSE_REP)
+        return sparse_values()[index];
       if (index == 0)
         return find_first_set();
-      if (sparse)
-      {
-#ifdef DEBUG_LEGION
-	assert(set_ptr.sparse);
-#endif
-        typename std::set<IT>::const_iterator it = set_ptr.sparse->begin();
-        while (index > 0)
-        {
-          it++;
-          index--;
-        }
-        return *it;
-      }
-      else
-        return set_ptr.dense->set.find_index_set(index);
+      return set_ptr.dense->set.find_index_set(index);
     }
 
     //-------------------------------------------------------------------------
@@ -8346,15 +10432,24 @@ namespace Legion {
     inline void IntegerSet<IT,DT,BIDIR>::map(FUNCTOR &functor) const
     //-------------------------------------------------------------------------
     {
-      if (sparse)
+      if (rep != DENSE_REP)
       {
-	if (set_ptr.sparse)
-	{
-	  for (typename std::set<IT>::const_iterator it = 
-                set_ptr.sparse->begin(); it != set_ptr.sparse->end(); it++)
-          {
-	    functor.apply(*it);
-          }
+        // Copy the values out in case the functor changes this set
+        const size_t count = sparse_size();
+        if (count <= INLINE_ENTRIES)
+        {
+          IT values[INLINE_ENTRIES];
+          for (unsigned idx = 0; idx < count; idx++)
+            values[idx] = sparse_values()[idx];
+          for (unsigned idx = 0; idx < count; idx++)
+            functor.apply(values[idx]);
+        }
+        else
+        {
+          const std::vector<IT> values(*set_ptr.sorted);
+          for (typename std::vector<IT>::const_iterator it = 
+                values.begin(); it != values.end(); it++)
+            functor.apply(*it);
         }
       }
       else
@@ -8379,20 +10474,14 @@ namespace Legion {
     inline void IntegerSet<IT,DT,BIDIR>::serialize(Serializer &rez) const
     //-------------------------------------------------------------------------
     {
-      rez.serialize<bool>(sparse);
-      if (sparse)
+      rez.serialize<bool>(rep != DENSE_REP);
+      if (rep != DENSE_REP)
       {
-	if (set_ptr.sparse)
-	{
-          rez.serialize<size_t>(set_ptr.sparse->size());
-          for (typename std::set<IT>::const_iterator it = 
-                set_ptr.sparse->begin(); it != set_ptr.sparse->end(); it++)
-          {
-            rez.serialize(*it);
-          }
-        }
-	else
-          rez.serialize<size_t>(0);
+        const IT *values = sparse_values();
+        const size_t count = sparse_size();
+        rez.serialize<size_t>(count);
+        for (unsigned idx = 0; idx < count; idx++)
+          rez.serialize(values[idx]);
       }
       else
         rez.serialize(set_ptr.dense->set);
@@ -8407,36 +10496,37 @@ namespace Legion {
       derez.deserialize<bool>(is_sparse);
       if (is_sparse)
       {
-        // If it doesn't match then replace the old one
-        if (!sparse)
-        {
-          delete set_ptr.dense;
-          set_ptr.sparse = 0;
-	  sparse = true;
-        }
-        else if (set_ptr.sparse)
-	  set_ptr.sparse->clear();
         size_t num_elements;
         derez.deserialize<size_t>(num_elements);
-	if (num_elements > 0) {
-	  if (!set_ptr.sparse)
-	    set_ptr.sparse = new typename std::set<IT>;
+        // Values were packed in sorted order
+        if (num_elements <= INLINE_ENTRIES)
+        {
+          release();
           for (unsigned idx = 0; idx < num_elements; idx++)
+            derez.deserialize(set_ptr.values[idx]);
+          inline_count = num_elements;
+        }
+        else
+        {
+          if (rep != SORTED_REP)
           {
-	    IT element;
-            derez.deserialize(element);
-            set_ptr.sparse->insert(element);
+            release();
+            set_ptr.sorted = new typename std::vector<IT>();
+            rep = SORTED_REP;
           }
+          set_ptr.sorted->resize(num_elements);
+          for (unsigned idx = 0; idx < num_elements; idx++)
+            derez.deserialize((*set_ptr.sorted)[idx]);
         }
       }
       else
       {
         // If it doesn't match then replace the old one
-        if (sparse)
+        if (rep != DENSE_REP)
         {
-          delete set_ptr.sparse;
+          release();
           set_ptr.dense = new DenseSet();
-	  sparse = false;
+          rep = DENSE_REP;
         }
         else
           set_ptr.dense->set.clear();
@@ -8450,22 +10540,16 @@ namespace Legion {
                 IntegerSet<IT,DT,BIDIR>::operator|(const IntegerSet &rhs) const
     //-------------------------------------------------------------------------
     {
-      // Do the fast case here
-      if (!sparse)
+      // Start from the bigger representation
+      if ((rep == DENSE_REP) || (rhs.rep != DENSE_REP && 
+                                 (sparse_size() >= rhs.sparse_size())))
       {
         IntegerSet<IT,DT,BIDIR> result(*this);
-        if (rhs.sparse)
-        {
-          UnionFunctor functor(result);
-          rhs.map(functor);
-        }
-        else
-          result.set_ptr.dense->set |= rhs.set_ptr.dense->set;
+        result |= rhs;
         return result;
       }
       IntegerSet<IT,DT,BIDIR> result(rhs); 
-      UnionFunctor functor(result);
-      this->map(functor);
+      result |= *this;
       return result;
     }
 
@@ -8476,15 +10560,24 @@ namespace Legion {
     //-------------------------------------------------------------------------
     {
       // Do the fast case here
-      if (!sparse && !rhs.sparse)
+      if ((rep == DENSE_REP) && (rhs.rep == DENSE_REP))
       {
         IntegerSet<IT,DT,BIDIR> result(*this);
         result.set_ptr.dense->set &= rhs.set_ptr.dense->set;
         return result;
       }
       IntegerSet<IT,DT,BIDIR> result;
-      IntersectFunctor functor(result, *this);
-      rhs.map(functor);
+      // Walk whichever one is sparse
+      if (rep != DENSE_REP)
+      {
+        IntersectFunctor functor(result, rhs);
+        this->map(functor);
+      }
+      else
+      {
+        IntersectFunctor functor(result, *this);
+        rhs.map(functor);
+      }
       return result;
     }
 
@@ -8494,16 +10587,8 @@ namespace Legion {
                 IntegerSet<IT,DT,BIDIR>::operator-(const IntegerSet &rhs) const
     //-------------------------------------------------------------------------
     {
-      // Do the fast case here
-      if (!sparse && !rhs.sparse)
-      {
-        IntegerSet<IT,DT,BIDIR> result(*this); 
-        result.set_ptr.dense->set -= rhs.set_ptr.dense->set;
-        return result;
-      }
       IntegerSet<IT,DT,BIDIR> result(*this);
-      DifferenceFunctor functor(result);
-      rhs.map(functor);
+      result -= rhs;
       return result;
     }
 
@@ -8513,12 +10598,31 @@ namespace Legion {
                      IntegerSet<IT,DT,BIDIR>::operator|=(const IntegerSet &rhs)
     //-------------------------------------------------------------------------
     {
-      // Do the fast case here
-      if (!sparse && !rhs.sparse)
+      if (rhs.rep == DENSE_REP)
       {
+        // Union into a dense copy of ourselves
+        if (rep != DENSE_REP)
+          make_dense();
         set_ptr.dense->set |= rhs.set_ptr.dense->set;
         return *this;
       }
+      if ((rep != DENSE_REP) && (rhs.sparse_size() > 0))
+      {
+        // Merge the two sorted lists in one pass
+        const IT *lhs_values = sparse_values();
+        const size_t lhs_count = sparse_size();
+        const IT *rhs_values = rhs.sparse_values();
+        const size_t rhs_count = rhs.sparse_size();
+        std::vector<IT> merged(lhs_count + rhs_count);
+        merged.resize(std::set_union(lhs_values, lhs_values + lhs_count,
+                                     rhs_values, rhs_values + rhs_count,
+                                     merged.begin()) - merged.begin());
+        set_sparse(&merged.front(), merged.size());
+        if ((rep == SORTED_REP) && 
+            (sizeof(DT) < (set_ptr.sorted->size() * sizeof(IT))))
+          make_dense();
+        return *this;
+      }
       UnionFunctor functor(*this);
       rhs.map(functor);
       return *this;
@@ -8531,16 +10635,13 @@ namespace Legion {
     //-------------------------------------------------------------------------
     {
       // Do the fast case
-      if (!sparse && !rhs.sparse)
+      if ((rep == DENSE_REP) && (rhs.rep == DENSE_REP))
       {
         set_ptr.dense->set &= rhs.set_ptr.dense->set;
         return *this;
       }
-      // Can't overwrite ourselves
-      IntegerSet<IT,DT,BIDIR> temp;
-      IntersectFunctor functor(temp, *this);
-      rhs.map(functor);
-      (*this) = temp;
+      IntegerSet<IT,DT,BIDIR> temp = (*this) & rhs;
+      swap(temp);
       return *this;
     }
 
@@ -8551,7 +10652,7 @@ namespace Legion {
     //-------------------------------------------------------------------------
     {
       // Do the fast case
-      if (!sparse && !rhs.sparse)
+      if ((rep == DENSE_REP) && (rhs.rep == DENSE_REP))
       {
         set_ptr.dense->set -= rhs.set_ptr.dense->set;
         return *this;
@@ -8566,8 +10667,8 @@ namespace Legion {
     inline bool IntegerSet<IT,DT,BIDIR>::operator!(void) const
     //-------------------------------------------------------------------------
     {
-      if (sparse)
-        return (!set_ptr.sparse || set_ptr.sparse->empty());
+      if (rep != DENSE_REP)
+        return (sparse_size() == 0);
       else
         return !(set_ptr.dense->set);
     }
@@ -8577,8 +10678,8 @@ namespace Legion {
     inline size_t IntegerSet<IT,DT,BIDIR>::size(void) const
     //-------------------------------------------------------------------------
     {
-      if (sparse)
-        return (set_ptr.sparse ? set_ptr.sparse->size() : 0);
+      if (rep != DENSE_REP)
+        return sparse_size();
       else
         return set_ptr.dense->set.pop_count(set_ptr.dense->set);
     }
@@ -8588,15 +10689,8 @@ namespace Legion {
     inline void IntegerSet<IT,DT,BIDIR>::clear(void)
     //-------------------------------------------------------------------------
     {
-      // always switch back to set on a clear
-      if (!sparse)
-      {
-	delete set_ptr.dense;
-	set_ptr.sparse = 0;
-	sparse = true;
-      } 
-      else if (set_ptr.sparse)
-	set_ptr.sparse->clear();
+      // always switch back to the inline representation on a clear
+      release();
     }
 
     //-------------------------------------------------------------------------
@@ -8605,9 +10699,10 @@ namespace Legion {
                                  IntegerSet<IT,DT,BIDIR>::swap(IntegerSet &rhs)
     //-------------------------------------------------------------------------
     {
-      std::swap(sparse, rhs.sparse);
-      std::swap(set_ptr.sparse, rhs.set_ptr.sparse);
-      // don't do dense because it's a union and that'd just swap things back
+      std::swap(rep, rhs.rep);
+      std::swap(inline_count, rhs.inline_count);
+      // the union is plain data so it can be swapped wholesale
+      std::swap(set_ptr, rhs.set_ptr);
       return *this;
     }
 
@@ -8902,6 +10997,272 @@ namespace Legion {
       return n;
     }
 
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    ConcurrentLookupTable<KEY,VAL,HASH>::BucketArray::BucketArray(size_t num)
+      : mask(num - 1), heads(new Entry*volatile[num])
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      // Must be a power of two
+      assert((num > 0) && ((num & mask) == 0));
+#endif
+      for (size_t idx = 0; idx < num; idx++)
+        heads[idx] = NULL;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    ConcurrentLookupTable<KEY,VAL,HASH>::BucketArray::~BucketArray(void)
+    //-------------------------------------------------------------------------
+    {
+      delete [] heads;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    ConcurrentLookupTable<KEY,VAL,HASH>::ConcurrentLookupTable(size_t init)
+      : current(NULL), count(0), epoch(0)
+    //-------------------------------------------------------------------------
+    {
+      active_readers[0] = 0;
+      active_readers[1] = 0;
+      size_t buckets = 1;
+      while (buckets < init)
+        buckets <<= 1;
+      current = new BucketArray(buckets);
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    ConcurrentLookupTable<KEY,VAL,HASH>::ConcurrentLookupTable(
+                                               const ConcurrentLookupTable &rhs)
+    //-------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    ConcurrentLookupTable<KEY,VAL,HASH>::~ConcurrentLookupTable(void)
+    //-------------------------------------------------------------------------
+    {
+      for (size_t idx = 0; idx <= current->mask; idx++)
+      {
+        Entry *entry = current->heads[idx];
+        while (entry != NULL)
+        {
+          Entry *next = entry->next;
+          delete entry;
+          entry = next;
+        }
+      }
+      delete current;
+      for (typename std::vector<Entry*>::const_iterator it = 
+            retired_entries.begin(); it != retired_entries.end(); it++)
+        delete (*it);
+      for (typename std::vector<Entry*>::const_iterator it = 
+            pending_entries.begin(); it != pending_entries.end(); it++)
+        delete (*it);
+      for (typename std::vector<BucketArray*>::const_iterator it = 
+            retired_arrays.begin(); it != retired_arrays.end(); it++)
+        delete (*it);
+      for (typename std::vector<BucketArray*>::const_iterator it = 
+            pending_arrays.begin(); it != pending_arrays.end(); it++)
+        delete (*it);
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    ConcurrentLookupTable<KEY,VAL,HASH>& 
+      ConcurrentLookupTable<KEY,VAL,HASH>::operator=(
+                                               const ConcurrentLookupTable &rhs)
+    //-------------------------------------------------------------------------
+    {
+      // should never be called
+      assert(false);
+      return *this;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    /*static*/ inline size_t ConcurrentLookupTable<KEY,VAL,HASH>::hash(
+                                                                const KEY &key)
+    //-------------------------------------------------------------------------
+    {
+      // Mix the bits since handle IDs are mostly small and sequential
+      unsigned long long h = HASH()(key);
+      h ^= (h >> 33);
+      h *= 0xff51afd7ed558ccdULL;
+      h ^= (h >> 33);
+      return size_t(h);
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    VAL ConcurrentLookupTable<KEY,VAL,HASH>::find(const KEY &key) const
+    //-------------------------------------------------------------------------
+    {
+      const unsigned parity = begin_read();
+      VAL result = NULL;
+      const BucketArray *array = current;
+      const Entry *entry = array->heads[hash(key) & array->mask];
+      while (entry != NULL)
+      {
+        if (entry->key == key)
+        {
+          result = entry->value;
+          break;
+        }
+        entry = entry->next;
+      }
+      end_read(parity);
+      return result;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    void ConcurrentLookupTable<KEY,VAL,HASH>::insert(const KEY &key, VAL value)
+    //-------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(find(key) == NULL);
+#endif
+      if (count > current->mask)
+        grow();
+      BucketArray *array = current;
+      const size_t index = hash(key) & array->mask;
+      Entry *entry = new Entry(key, value, array->heads[index]);
+      // Make sure the entry is visible before we publish it
+      __sync_synchronize();
+      array->heads[index] = entry;
+      count++;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    VAL ConcurrentLookupTable<KEY,VAL,HASH>::erase(const KEY &key)
+    //-------------------------------------------------------------------------
+    {
+      BucketArray *array = current;
+      Entry *volatile *prev = &(array->heads[hash(key) & array->mask]);
+      Entry *entry = *prev;
+      while (entry != NULL)
+      {
+        if (entry->key == key)
+        {
+          // Readers still on the entry can follow its next pointer
+          *prev = entry->next;
+          retired_entries.push_back(entry);
+          count--;
+          const VAL result = entry->value;
+          if (retired_entries.size() >= RECLAIM_THRESHOLD)
+            try_reclaim();
+          return result;
+        }
+        prev = &(entry->next);
+        entry = entry->next;
+      }
+      return NULL;
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    void ConcurrentLookupTable<KEY,VAL,HASH>::get_values(
+                                                std::vector<VAL> &values) const
+    //-------------------------------------------------------------------------
+    {
+      const unsigned parity = begin_read();
+      const BucketArray *array = current;
+      values.reserve(values.size() + count);
+      for (size_t idx = 0; idx <= array->mask; idx++)
+        for (const Entry *entry = array->heads[idx]; 
+              entry != NULL; entry = entry->next)
+          values.push_back(entry->value);
+      end_read(parity);
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    void ConcurrentLookupTable<KEY,VAL,HASH>::grow(void)
+    //-------------------------------------------------------------------------
+    {
+      BucketArray *old_array = current;
+      BucketArray *new_array = new BucketArray(2 * (old_array->mask + 1));
+      // Copy the entries into the new array, readers can keep using
+      // the old array and its entries until they are reclaimed
+      for (size_t idx = 0; idx <= old_array->mask; idx++)
+      {
+        for (Entry *entry = old_array->heads[idx]; 
+              entry != NULL; entry = entry->next)
+        {
+          const size_t index = hash(entry->key) & new_array->mask;
+          new_array->heads[index] = 
+            new Entry(entry->key, entry->value, new_array->heads[index]);
+          retired_entries.push_back(entry);
+        }
+      }
+      // Make sure the new array is visible before we publish it
+      __sync_synchronize();
+      current = new_array;
+      retired_arrays.push_back(old_array);
+      try_reclaim();
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    unsigned ConcurrentLookupTable<KEY,VAL,HASH>::begin_read(void) const
+    //-------------------------------------------------------------------------
+    {
+      while (true)
+      {
+        const unsigned parity = epoch & 1;
+        __sync_fetch_and_add(&active_readers[parity], 1);
+        // If the epoch advanced before we were counted, the writer may
+        // not have seen us, so count ourselves in the new epoch instead
+        if ((epoch & 1) == parity)
+          return parity;
+        __sync_fetch_and_sub(&active_readers[parity], 1);
+      }
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    void ConcurrentLookupTable<KEY,VAL,HASH>::end_read(unsigned parity) const
+    //-------------------------------------------------------------------------
+    {
+      __sync_fetch_and_sub(&active_readers[parity], 1);
+    }
+
+    //-------------------------------------------------------------------------
+    template<typename KEY, typename VAL, typename HASH>
+    void ConcurrentLookupTable<KEY,VAL,HASH>::try_reclaim(void)
+    //-------------------------------------------------------------------------
+    {
+      // Everything pending was unlinked before the last epoch advance, so
+      // only readers counted in the previous epoch can still be using it
+      // (readers from the epoch before that were gone when we advanced)
+      const unsigned previous = (epoch + 1) & 1;
+      __sync_synchronize();
+      if (active_readers[previous] != 0)
+        return;
+      for (typename std::vector<Entry*>::const_iterator it = 
+            pending_entries.begin(); it != pending_entries.end(); it++)
+        delete (*it);
+      pending_entries.clear();
+      for (typename std::vector<BucketArray*>::const_iterator it = 
+            pending_arrays.begin(); it != pending_arrays.end(); it++)
+        delete (*it);
+      pending_arrays.clear();
+      pending_entries.swap(retired_entries);
+      pending_arrays.swap(retired_arrays);
+      // New readers go in the counter we just checked
+      __sync_synchronize();
+      epoch = epoch + 1;
+      __sync_synchronize();
+    }
+
 }; // namespace Legion 
 
 #endif // __LEGION_UTILITIES_H__
@@ -223,7 +223,8 @@ namespace Legion {
       : InstanceView(ctx, encode_materialized_did(did, par == NULL), own_addr, 
                      log_own, node, own_ctx, register_now), 
         manager(man), parent(par), 
-        disjoint_children(node->are_all_children_disjoint())
+        disjoint_children(node->are_all_children_disjoint()),
+        next_user_compaction(DEFAULT_PHYSICAL_USER_COMPACTION)
     //--------------------------------------------------------------------------
     {
       // Otherwise the instance lock will get filled in when we are unpacked
@@ -247,7 +248,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     MaterializedView::MaterializedView(const MaterializedView &rhs)
       : InstanceView(NULL, 0, 0, 0, NULL, 0, false),
-        manager(NULL), parent(NULL), disjoint_children(false)
+        manager(NULL), parent(NULL), disjoint_children(false),
+        next_user_compaction(0)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -1956,6 +1958,12 @@ namespace Legion {
     {
       // Must be called while holding the lock
       // Reference should already have been added
+      // Sweep out any users whose events have triggered before the
+      // lists get long enough to slow down precondition queries
+      if ((current_epoch_users.size() + previous_epoch_users.size()) >= 
+          next_user_compaction)
+        compact_epoch_users();
+      current_epoch_summary |= user_mask;
       EventUsers &event_users = current_epoch_users[term_event];
       if (event_users.single)
       {
@@ -1985,6 +1993,50 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    void MaterializedView::compact_epoch_users(void)
+    //--------------------------------------------------------------------------
+    {
+      // Must be called while holding the lock in exclusive mode
+#if !defined(LEGION_SPY) && !defined(EVENT_GRAPH_TRACE)
+      std::vector<ApEvent> dead_events;
+      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator it = 
+            current_epoch_users.begin(); it != current_epoch_users.end(); it++)
+        if (it->first.has_triggered_faultignorant())
+          dead_events.push_back(it->first);
+      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator it = 
+           previous_epoch_users.begin(); it != previous_epoch_users.end(); it++)
+        if (it->first.has_triggered_faultignorant())
+          dead_events.push_back(it->first);
+      // This only removes the events with outstanding collections
+      for (std::vector<ApEvent>::const_iterator it = 
+            dead_events.begin(); it != dead_events.end(); it++)
+        filter_local_users(*it);
+#endif
+      recompute_epoch_summaries();
+      // Back off so the sweeps stay amortized when most users are live
+      const size_t remaining = 
+        current_epoch_users.size() + previous_epoch_users.size();
+      next_user_compaction = 
+        (2 * remaining > size_t(DEFAULT_PHYSICAL_USER_COMPACTION)) ?
+          2 * remaining : size_t(DEFAULT_PHYSICAL_USER_COMPACTION);
+    }
+
+    //--------------------------------------------------------------------------
+    void MaterializedView::recompute_epoch_summaries(void)
+    //--------------------------------------------------------------------------
+    {
+      // Must be called while holding the lock in exclusive mode
+      current_epoch_summary.clear();
+      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator it = 
+            current_epoch_users.begin(); it != current_epoch_users.end(); it++)
+        current_epoch_summary |= it->second.user_mask;
+      previous_epoch_summary.clear();
+      for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator it = 
+           previous_epoch_users.begin(); it != previous_epoch_users.end(); it++)
+        previous_epoch_summary |= it->second.user_mask;
+    }
+
     //--------------------------------------------------------------------------
     void MaterializedView::filter_local_users(ApEvent term_event) 
     //--------------------------------------------------------------------------
@@ -2180,6 +2232,7 @@ namespace Legion {
       if (!summary_overlap)
         return;
       current_users.user_mask -= summary_overlap;
+      previous_epoch_summary |= summary_overlap;
       EventUsers &prev_users = previous_epoch_users[cit->first];
       if (current_users.single)
       {
@@ -2543,6 +2596,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
+      // No need to walk the users if none of them use these fields
+      if (user_mask * current_epoch_summary)
+        return;
       for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator cit = 
            current_epoch_users.begin(); cit != current_epoch_users.end(); cit++)
       {
@@ -2615,6 +2671,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
+      // No need to walk the users if none of them use these fields
+      if (user_mask * previous_epoch_summary)
+        return;
       for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator pit = 
             previous_epoch_users.begin(); pit != 
             previous_epoch_users.end(); pit++)
@@ -2675,6 +2734,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
+      // No need to walk the users if none of them use these fields
+      if (user_mask * current_epoch_summary)
+        return;
       for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator cit = 
            current_epoch_users.begin(); cit != current_epoch_users.end(); cit++)
       {
@@ -2758,6 +2820,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Caller must be holding the lock
+      // No need to walk the users if none of them use these fields
+      if (user_mask * previous_epoch_summary)
+        return;
       for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator pit = 
             previous_epoch_users.begin(); pit != 
             previous_epoch_users.end(); pit++)
@@ -2829,6 +2894,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Lock better be held by caller
+      if (dom_mask * previous_epoch_summary)
+        return;
       for (LegionMap<ApEvent,EventUsers>::aligned::const_iterator it = 
            previous_epoch_users.begin(); it != previous_epoch_users.end(); it++)
       {
@@ -3673,6 +3740,8 @@ namespace Legion {
             }
           }
         }
+        // The users we just unpacked can be for any fields
+        recompute_epoch_summaries();
         // Update our remote valid mask
         remote_valid_mask |= response_mask;
         // Prune out the request event
@@ -4932,7 +5001,8 @@ namespace Legion {
                               InnerContext *context, bool register_now)
       : DeferredView(ctx, encode_composite_did(did), owner_proc, 
                      node, register_now), CompositeBase(view_lock),
-        version_info(info), closed_tree(tree), owner_context(context)
+        version_info(info), closed_tree(tree), owner_context(context),
+        total_copy_plans(0)
     {
       // Add our references
       version_info->add_reference();
@@ -4963,6 +5033,19 @@ namespace Legion {
     CompositeView::~CompositeView(void)
     //--------------------------------------------------------------------------
     {
+      // Release any copy plans that we memoized
+      for (LegionMap<MaterializedView*,
+                     LegionList<CompositeCopyPlan>::aligned>::aligned::
+            const_iterator pit = copy_plans.begin(); 
+            pit != copy_plans.end(); pit++)
+      {
+        for (LegionList<CompositeCopyPlan>::aligned::const_iterator it = 
+              pit->second.begin(); it != pit->second.end(); it++)
+          delete it->copy_tree;
+        if (pit->first->remove_nested_resource_ref(did))
+          delete pit->first;
+      }
+      copy_plans.clear();
       // Delete our children
       for (LegionMap<CompositeNode*,FieldMask>::aligned::const_iterator it = 
             children.begin(); it != children.end(); it++)
@@ -5237,21 +5320,17 @@ namespace Legion {
                                               bool restrict_out)
     //--------------------------------------------------------------------------
     {
-      CompositeCopier copier(copy_mask);
-      FieldMask top_locally_complete;
-      FieldMask dominate_capture(copy_mask);
-      CompositeCopyNode *copy_tree = construct_copy_tree(dst, logical_node,
-          copy_mask, top_locally_complete, dominate_capture, copier, this);
-#ifdef DEBUG_LEGION
-      assert(copy_tree != NULL);
-#endif
-      copy_mask -= copier.get_already_valid_fields();       
+      CompositeCopyPlan plan;
+      const bool cached_plan = find_copy_plan(dst, copy_mask, plan);
+      CompositeCopyNode *copy_tree = plan.copy_tree;
+      copy_mask -= plan.already_valid;       
       // If we have any reduction fields though we still need to 
-      copy_mask |= copier.get_reduction_fields();
+      copy_mask |= plan.reduction_fields;
       // issue copies for them
       if (!copy_mask)
       {
-        delete copy_tree;
+        if (!cached_plan)
+          delete copy_tree;
         return;
       }
       LegionMap<ApEvent,FieldMask>::aligned preconditions;
@@ -5271,7 +5350,7 @@ namespace Legion {
       // We have to do the copy for the remaining fields, see if we
       // need to make a temporary instance to avoid overwriting data
       // in the destination instance as part of the painter's algorithm
-      if (copier.has_dirty_destination_fields())
+      if (plan.dirty_destination)
       {
         // We need to make a temporary instance 
         copy_tree->copy_to_temporary(info, dst, copy_mask, this,
@@ -5297,7 +5376,8 @@ namespace Legion {
           postconditions.insert(postreductions.begin(),
                                 postreductions.end());
       }
-      delete copy_tree;
+      if (!cached_plan)
+        delete copy_tree;
       // If we have no postconditions, then we are done
       if (postconditions.empty())
         return;
@@ -5348,17 +5428,12 @@ namespace Legion {
       DETAILED_PROFILER(context->runtime, 
                         COMPOSITE_VIEW_ISSUE_DEFERRED_COPIES_CALL);
       LegionMap<ApEvent,FieldMask>::aligned postreductions;
-      CompositeCopier copier(copy_mask);
-      FieldMask dummy_locally_complete;
-      FieldMask dominate_capture(copy_mask);
-      CompositeCopyNode *copy_tree = construct_copy_tree(dst, logical_node,
-          copy_mask, dummy_locally_complete, dominate_capture, copier, this);
-#ifdef DEBUG_LEGION
-      assert(copy_tree != NULL);
-#endif
-      copy_tree->issue_copies(info, dst, copy_mask, this, preconditions, 
+      CompositeCopyPlan plan;
+      const bool cached_plan = find_copy_plan(dst, copy_mask, plan);
+      plan.copy_tree->issue_copies(info, dst, copy_mask, this, preconditions, 
               postconditions, postreductions, pred_guard, across_helper);
-      delete copy_tree;
+      if (!cached_plan)
+        delete plan.copy_tree;
       if (!postreductions.empty())
       {
         for (LegionMap<ApEvent,FieldMask>::aligned::const_iterator it = 
@@ -5367,6 +5442,77 @@ namespace Legion {
       }
     } 
 
+    //--------------------------------------------------------------------------
+    bool CompositeView::find_copy_plan(MaterializedView *dst,
+                                       const FieldMask &copy_mask,
+                                       CompositeCopyPlan &plan)
+    //--------------------------------------------------------------------------
+    {
+      // See if we already computed the copy tree for this destination
+      {
+        AutoLock v_lock(view_lock,1,false/*exclusive*/);
+        LegionMap<MaterializedView*,
+                  LegionList<CompositeCopyPlan>::aligned>::aligned::
+          const_iterator finder = copy_plans.find(dst);
+        if (finder != copy_plans.end())
+        {
+          for (LegionList<CompositeCopyPlan>::aligned::const_iterator it = 
+                finder->second.begin(); it != finder->second.end(); it++)
+          {
+            if (it->copy_mask != copy_mask)
+              continue;
+            plan = *it;
+            return true;
+          }
+        }
+      }
+      // Not cached so we have to traverse the composite tree
+      CompositeCopier copier(copy_mask);
+      FieldMask tree_mask(copy_mask);
+      FieldMask top_locally_complete;
+      FieldMask dominate_capture(copy_mask);
+      plan.copy_tree = construct_copy_tree(dst, logical_node, tree_mask,
+          top_locally_complete, dominate_capture, copier, this);
+#ifdef DEBUG_LEGION
+      assert(plan.copy_tree != NULL);
+#endif
+      plan.copy_mask = copy_mask;
+      plan.already_valid = copier.get_already_valid_fields();
+      plan.reduction_fields = copier.get_reduction_fields();
+      plan.dirty_destination = copier.has_dirty_destination_fields();
+      AutoLock v_lock(view_lock);
+      LegionMap<MaterializedView*,
+                LegionList<CompositeCopyPlan>::aligned>::aligned::iterator
+                  finder = copy_plans.find(dst);
+      if (finder != copy_plans.end())
+      {
+        // Someone else might have beaten us to it
+        for (LegionList<CompositeCopyPlan>::aligned::const_iterator it = 
+              finder->second.begin(); it != finder->second.end(); it++)
+        {
+          if (it->copy_mask != copy_mask)
+            continue;
+          delete plan.copy_tree;
+          plan = *it;
+          return true;
+        }
+      }
+      // Plans are never evicted since other threads could be using
+      // them, so once we are full the caller owns the copy tree
+      if (total_copy_plans == LEGION_MAX_COMPOSITE_COPY_PLANS)
+        return false;
+      if (finder == copy_plans.end())
+      {
+        // Keep the destination alive as long as we have plans for it
+        dst->add_nested_resource_ref(did);
+        finder = copy_plans.insert(std::make_pair(dst,
+                    LegionList<CompositeCopyPlan>::aligned())).first;
+      }
+      finder->second.push_back(plan);
+      total_copy_plans++;
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     bool CompositeView::is_upper_bound_node(RegionTreeNode *node) const
     //--------------------------------------------------------------------------
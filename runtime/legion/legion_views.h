@@ -521,6 +521,8 @@ namespace Legion {
     protected:
       void add_current_user(PhysicalUser *user, ApEvent term_event,
                             const FieldMask &user_mask);
+      void compact_epoch_users(void);
+      void recompute_epoch_summaries(void);
       void filter_local_users(ApEvent term_event);
       void filter_local_users(const FieldMask &filter_mask,
           LegionMap<ApEvent,EventUsers>::aligned &local_epoch_users);
@@ -660,6 +662,13 @@ namespace Legion {
       // the view tree that less frequently filter their sub-users.
       LegionMap<ApEvent,EventUsers>::aligned current_epoch_users;
       LegionMap<ApEvent,EventUsers>::aligned previous_epoch_users;
+      // Summaries of the fields used by each epoch so queries for
+      // other fields can skip the lists entirely. These are supersets
+      // since users are filtered in many places, and are made exact
+      // again whenever we compact the lists.
+      FieldMask current_epoch_summary, previous_epoch_summary;
+      // Number of events at which we next sweep triggered users
+      size_t next_user_compaction;
       // Also keep a set of events for which we have outstanding
       // garbage collection meta-tasks so we don't launch more than one
       // We need this even though we have the data structures above because
@@ -1162,6 +1171,17 @@ namespace Legion {
         FieldVersions versions;
         FieldMask valid_fields;
       };
+      struct CompositeCopyPlan {
+      public:
+        CompositeCopyPlan(void)
+          : copy_tree(NULL), dirty_destination(false) { }
+      public:
+        CompositeCopyNode *copy_tree;
+        FieldMask copy_mask;
+        FieldMask already_valid;
+        FieldMask reduction_fields;
+        bool dirty_destination;
+      };
     public:
       CompositeView(RegionTreeForest *ctx, DistributedID did,
                     AddressSpaceID owner_proc, RegionTreeNode *node, 
@@ -1218,6 +1238,8 @@ namespace Legion {
     protected:
       CompositeNode* capture_above(RegionTreeNode *node,
                                    const FieldMask &needed_fields);
+      bool find_copy_plan(MaterializedView *dst, const FieldMask &copy_mask,
+                          CompositeCopyPlan &plan);
     public:
       // From CompositeBase
       virtual InnerContext* get_owner_context(void) const;
@@ -1259,6 +1281,13 @@ namespace Legion {
       LegionMap<CompositeView*,FieldMask>::aligned nested_composite_views;
     protected:
       LegionMap<RegionTreeNode*,NodeVersionInfo>::aligned node_versions;
+    protected:
+      // Composite views never change once they are captured so the copy
+      // trees for a destination and set of fields can be reused by
+      // every later read of the same view
+      LegionMap<MaterializedView*,
+                LegionList<CompositeCopyPlan>::aligned>::aligned copy_plans;
+      unsigned total_copy_plans;
     };
 
     /**
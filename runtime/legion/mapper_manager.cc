@@ -39,6 +39,56 @@ namespace Legion {
     {
     }
 
+    /////////////////////////////////////////////////////////////
+    // Call Statistics 
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    MapperManager::CallStatistics::CallStatistics(void)
+      : count(0), total_time(0), max_time(0)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < LEGION_MAPPER_CALL_HISTOGRAM_BUCKETS; idx++)
+        buckets[idx] = 0;
+    }
+
+    //--------------------------------------------------------------------------
+    void MapperManager::CallStatistics::record(unsigned long long duration)
+    //--------------------------------------------------------------------------
+    {
+      count++;
+      total_time += duration;
+      if (duration > max_time)
+        max_time = duration;
+      unsigned bucket = 0;
+      while ((bucket < (LEGION_MAPPER_CALL_HISTOGRAM_BUCKETS-1)) &&
+             (duration >= (2ULL << bucket)))
+        bucket++;
+      buckets[bucket]++;
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned long long MapperManager::CallStatistics::find_percentile(
+                                                       double percentile) const
+    //--------------------------------------------------------------------------
+    {
+      if (count == 0)
+        return 0;
+      // Report the upper bound of the bucket containing the percentile
+      const double target = (percentile / 100.0) * count;
+      unsigned long long seen = 0;
+      for (unsigned idx = 0; idx < LEGION_MAPPER_CALL_HISTOGRAM_BUCKETS; idx++)
+      {
+        seen += buckets[idx];
+        if ((seen > 0) && (double(seen) >= target))
+        {
+          const unsigned long long bound = (2ULL << idx);
+          return (bound < max_time) ? bound : max_time;
+        }
+      }
+      return max_time;
+    }
+
     /////////////////////////////////////////////////////////////
     // Mapper Manager 
     /////////////////////////////////////////////////////////////
@@ -47,7 +97,9 @@ namespace Legion {
     MapperManager::MapperManager(Runtime *rt, Mapping::Mapper *mp, 
                                  MapperID mid, Processor p)
       : runtime(rt), mapper(mp), mapper_id(mid), processor(p),
-        mapper_lock(Reservation::create_reservation()), next_mapper_event(1)
+        mapper_lock(Reservation::create_reservation()),
+        batch_lock(Reservation::create_reservation()), map_tasks_leader(false),
+        next_mapper_event(1)
     //--------------------------------------------------------------------------
     {
     }
@@ -60,6 +112,8 @@ namespace Legion {
       delete mapper;
       mapper_lock.destroy_reservation();
       mapper_lock = Reservation::NO_RESERVATION;
+      batch_lock.destroy_reservation();
+      batch_lock = Reservation::NO_RESERVATION;
     }
 
     //--------------------------------------------------------------------------
@@ -158,6 +212,13 @@ namespace Legion {
     {
       if (info == NULL)
       {
+        // If batching is enabled, hand this task to the mapper 
+        // along with any others that are ready to map right now
+        if (first_invocation && (Runtime::max_map_task_batch > 1))
+        {
+          batch_map_task(task, input, output);
+          return;
+        }
         RtEvent continuation_precondition;
         info = begin_mapper_call(MAP_TASK_CALL,
                              task, first_invocation, continuation_precondition);
@@ -175,6 +236,105 @@ namespace Legion {
       finish_mapper_call(info);
     }
 
+    //--------------------------------------------------------------------------
+    void MapperManager::invoke_map_tasks(std::vector<TaskOp*> *tasks,
+                                         Mapper::MapTasksInput *input,
+                                         Mapper::MapTasksOutput *output,
+                                         bool first_invocation,
+                                         MappingCallInfo *info)
+    //--------------------------------------------------------------------------
+    {
+      // The call has no single operation so instances acquired by the
+      // mapper are recorded here and then handed out to the tasks 
+      std::map<PhysicalManager*,std::pair<unsigned,bool> > batch_acquired;
+      if (info == NULL)
+      {
+        RtEvent continuation_precondition;
+        info = begin_mapper_call(MAP_TASKS_CALL,
+                             NULL, first_invocation, continuation_precondition);
+        info->acquired_instances = &batch_acquired;
+        // Build a continuation if necessary
+        if (continuation_precondition.exists())
+        {
+          MapperContinuation3<std::vector<TaskOp*>,Mapper::MapTasksInput,
+                              Mapper::MapTasksOutput,
+                              &MapperManager::invoke_map_tasks>
+                                continuation(this, tasks, input, output, info);
+          continuation.defer(runtime, continuation_precondition);
+          return;
+        }
+      }
+      mapper->map_tasks(info, *input, *output);
+      distribute_acquired_instances(info, *tasks, *output);
+      finish_mapper_call(info);
+    }
+
+    //--------------------------------------------------------------------------
+    void MapperManager::batch_map_task(TaskOp *task, 
+                                       Mapper::MapTaskInput *input,
+                                       Mapper::MapTaskOutput *output)
+    //--------------------------------------------------------------------------
+    {
+      RtUserEvent done;
+      {
+        AutoLock b_lock(batch_lock);
+        // If someone else is already mapping batches then they
+        // will map us too so we just need to wait for them
+        if (map_tasks_leader)
+          done = Runtime::create_rt_user_event();
+        else
+          map_tasks_leader = true;
+        pending_map_tasks.push_back(PendingMapTask(task, input, output, done));
+      }
+      if (done.exists())
+      {
+        done.lg_wait();
+        return;
+      }
+      // We're the leader so keep mapping batches until there are no
+      // more tasks waiting, our own task is always in the first batch
+      std::vector<PendingMapTask> batch;
+      while (true)
+      {
+        {
+          AutoLock b_lock(batch_lock);
+          if (pending_map_tasks.empty())
+          {
+            map_tasks_leader = false;
+            break;
+          }
+          if (pending_map_tasks.size() > Runtime::max_map_task_batch)
+          {
+            std::vector<PendingMapTask>::iterator split = 
+              pending_map_tasks.begin() + Runtime::max_map_task_batch;
+            batch.insert(batch.end(), pending_map_tasks.begin(), split);
+            pending_map_tasks.erase(pending_map_tasks.begin(), split);
+          }
+          else
+            batch.swap(pending_map_tasks);
+        }
+        std::vector<TaskOp*> tasks(batch.size());
+        Mapper::MapTasksInput batch_input;
+        Mapper::MapTasksOutput batch_output;
+        batch_input.tasks.resize(batch.size());
+        batch_input.inputs.resize(batch.size());
+        batch_output.outputs.resize(batch.size());
+        for (unsigned idx = 0; idx < batch.size(); idx++)
+        {
+          tasks[idx] = batch[idx].task;
+          batch_input.tasks[idx] = batch[idx].task;
+          batch_input.inputs[idx] = batch[idx].input;
+          batch_output.outputs[idx] = batch[idx].output;
+        }
+        invoke_map_tasks(&tasks, &batch_input, &batch_output);
+        for (std::vector<PendingMapTask>::const_iterator it = 
+              batch.begin(); it != batch.end(); it++)
+          if (it->done.exists())
+            Runtime::trigger_event(it->done);
+        batch.clear();
+      }
+    }
+
     //--------------------------------------------------------------------------
     void MapperManager::invoke_select_task_variant(TaskOp *task,
                                             Mapper::SelectVariantInput *input,
@@ -1095,6 +1255,86 @@ namespace Legion {
       finish_mapper_call(info);
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ void MapperManager::compute_must_epoch_shape(
+                                        const Mapper::MapMustEpochInput &input,
+                                        MemoizedMustEpoch &shape)
+    //--------------------------------------------------------------------------
+    {
+      std::map<const Task*,unsigned> task_indexes;
+      shape.tasks.resize(input.tasks.size());
+      for (unsigned idx = 0; idx < input.tasks.size(); idx++)
+      {
+        const Task *task = input.tasks[idx];
+        shape.tasks[idx] = 
+          std::pair<TaskID,DomainPoint>(task->task_id, task->index_point);
+        task_indexes[task] = idx;
+      }
+      shape.constraints.resize(input.constraints.size());
+      shape.constraint_regions.resize(input.constraints.size());
+      for (unsigned idx = 0; idx < input.constraints.size(); idx++)
+      {
+        const Mapper::MappingConstraint &constraint = input.constraints[idx];
+#ifdef DEBUG_LEGION
+        assert(constraint.constrained_tasks.size() == 
+               constraint.requirement_indexes.size());
+#endif
+        for (unsigned i = 0; i < constraint.constrained_tasks.size(); i++)
+        {
+          const Task *task = constraint.constrained_tasks[i];
+          const unsigned req_index = constraint.requirement_indexes[i];
+#ifdef DEBUG_LEGION
+          assert(task_indexes.find(task) != task_indexes.end());
+          assert(req_index < task->regions.size());
+#endif
+          shape.constraints[idx].push_back(
+              std::pair<unsigned,unsigned>(task_indexes[task], req_index));
+          shape.constraint_regions[idx].push_back(
+              task->regions[req_index].region);
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    bool MapperManager::find_memoized_must_epoch(
+                                        const Mapper::MapMustEpochInput &input,
+                                        Mapper::MapMustEpochOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      MemoizedMustEpoch shape;
+      compute_must_epoch_shape(input, shape);
+      AutoLock m_lock(mapper_lock,1,false/*exclusive*/);
+      std::map<MappingTagID,MemoizedMustEpoch>::const_iterator finder = 
+        memoized_must_epochs.find(input.mapping_tag);
+      if (finder == memoized_must_epochs.end())
+        return false;
+      if ((finder->second.tasks != shape.tasks) ||
+          (finder->second.constraints != shape.constraints) ||
+          (finder->second.constraint_regions != shape.constraint_regions))
+        return false;
+      output.task_processors = finder->second.output.task_processors;
+      output.constraint_mappings = finder->second.output.constraint_mappings;
+      output.memoize = true;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    void MapperManager::memoize_must_epoch(
+                                  const Mapper::MapMustEpochInput &input,
+                                  const Mapper::MapMustEpochOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      MemoizedMustEpoch memo;
+      compute_must_epoch_shape(input, memo);
+      memo.output.task_processors = output.task_processors;
+      memo.output.constraint_mappings = output.constraint_mappings;
+      memo.output.memoize = true;
+      AutoLock m_lock(mapper_lock);
+      // Only remember the most recent mapping for each tag so the
+      // memoized instances do not accumulate without bound
+      memoized_must_epochs[input.mapping_tag] = memo;
+    }
+
     //--------------------------------------------------------------------------
     void MapperManager::invoke_map_dataflow_graph(
                                    Mapper::MapDataflowGraphInput *input,
@@ -2327,6 +2567,53 @@ namespace Legion {
       resume_mapper_call(ctx);
     }
 
+    //--------------------------------------------------------------------------
+    void MapperManager::distribute_acquired_instances(MappingCallInfo *info,
+                                              const std::vector<TaskOp*> &tasks,
+                                           const Mapper::MapTasksOutput &output)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(info->acquired_instances != NULL);
+      assert(tasks.size() == output.outputs.size());
+#endif
+      std::map<PhysicalManager*,std::pair<unsigned,bool> > &batch_acquired =
+        *(info->acquired_instances);
+      if (batch_acquired.empty())
+        return;
+      // Give each task its own reference on the acquired instances it chose
+      for (unsigned idx = 0; idx < tasks.size(); idx++)
+      {
+        TaskOp *task = tasks[idx];
+        std::map<PhysicalManager*,std::pair<unsigned,bool> > &task_acquired =
+          *(task->get_acquired_instances_ref());
+        const std::vector<std::vector<MappingInstance> > &chosen = 
+          output.outputs[idx]->chosen_instances;
+        for (unsigned idx2 = 0; idx2 < chosen.size(); idx2++)
+        {
+          for (unsigned idx3 = 0; idx3 < chosen[idx2].size(); idx3++)
+          {
+            PhysicalManager *manager = chosen[idx2][idx3].impl;
+            std::map<PhysicalManager*,std::pair<unsigned,bool> >::const_iterator
+              finder = batch_acquired.find(manager);
+            if (finder == batch_acquired.end())
+              continue;
+            if (task_acquired.find(manager) != task_acquired.end())
+              continue;
+            manager->add_base_valid_ref(MAPPING_ACQUIRE_REF, task);
+            task_acquired[manager] = 
+              std::pair<unsigned,bool>(1/*first ref*/, finder->second.second);
+          }
+        }
+      }
+      // Then remove the references held on behalf of the whole batch
+      for (std::map<PhysicalManager*,std::pair<unsigned,bool> >::const_iterator
+            it = batch_acquired.begin(); it != batch_acquired.end(); it++)
+        it->first->remove_base_valid_ref(MAPPING_ACQUIRE_REF, NULL,
+                                         it->second.first);
+      batch_acquired.clear();
+    }
+
     //--------------------------------------------------------------------------
     void MapperManager::record_acquired_instance(MappingCallInfo *ctx,
                                          PhysicalManager *manager, bool created)
@@ -3065,12 +3352,12 @@ namespace Legion {
         result->operation = op;
         if (op != NULL)
           result->acquired_instances = op->get_acquired_instances_ref();
-        if (runtime->profiler != NULL)
+        if ((runtime->profiler != NULL) || Runtime::mapper_call_statistics)
           result->start_time = Realm::Clock::current_time_in_nanoseconds();
         return result;
       }
       MappingCallInfo *result = new MappingCallInfo(this, kind, op);
-      if (runtime->profiler != NULL)
+      if ((runtime->profiler != NULL) || Runtime::mapper_call_statistics)
         result->start_time = Realm::Clock::current_time_in_nanoseconds();
       return result;
     }
@@ -3085,13 +3372,21 @@ namespace Legion {
         free_call_info(info, false/*need lock*/);
         return;
       }
-      if (runtime->profiler != NULL)
+      if ((runtime->profiler != NULL) || Runtime::mapper_call_statistics)
       {
         unsigned long long stop_time = 
           Realm::Clock::current_time_in_nanoseconds();
-        runtime->profiler->record_mapper_call(info->kind, 
+        if (runtime->profiler != NULL)
+          runtime->profiler->record_mapper_call(info->kind, 
             (info->operation == NULL) ? 0 : info->operation->get_unique_op_id(),
             info->start_time, stop_time); 
+        // We're holding the lock so we can update the histograms
+        if (Runtime::mapper_call_statistics)
+        {
+          if (call_statistics.empty())
+            call_statistics.resize(LAST_MAPPER_CALL);
+          call_statistics[info->kind].record(stop_time - info->start_time);
+        }
       }
       info->resume = RtUserEvent::NO_RT_USER_EVENT;
       info->operation = NULL;
@@ -3100,6 +3395,63 @@ namespace Legion {
       available_infos.push_back(info);
     }
 
+    //--------------------------------------------------------------------------
+    unsigned long long MapperManager::get_call_count(const char *call_name)
+    //--------------------------------------------------------------------------
+    {
+      MAPPER_CALL_NAMES(call_names);
+      AutoLock m_lock(mapper_lock,1,false/*exclusive*/);
+      if (call_statistics.empty())
+        return 0;
+      for (unsigned idx = 0; idx < LAST_MAPPER_CALL; idx++)
+        if (strcmp(call_names[idx], call_name) == 0)
+          return call_statistics[idx].count;
+      return 0;
+    }
+
+    //--------------------------------------------------------------------------
+    unsigned long long MapperManager::get_call_latency(const char *call_name,
+                                                       double percentile)
+    //--------------------------------------------------------------------------
+    {
+      MAPPER_CALL_NAMES(call_names);
+      AutoLock m_lock(mapper_lock,1,false/*exclusive*/);
+      if (call_statistics.empty())
+        return 0;
+      for (unsigned idx = 0; idx < LAST_MAPPER_CALL; idx++)
+        if (strcmp(call_names[idx], call_name) == 0)
+          return call_statistics[idx].find_percentile(percentile);
+      return 0;
+    }
+
+    //--------------------------------------------------------------------------
+    void MapperManager::report_call_statistics(void)
+    //--------------------------------------------------------------------------
+    {
+      MAPPER_CALL_NAMES(call_names);
+      AutoLock m_lock(mapper_lock,1,false/*exclusive*/);
+      if (call_statistics.empty())
+        return;
+      unsigned long long total_calls = 0, total_time = 0;
+      for (unsigned idx = 0; idx < LAST_MAPPER_CALL; idx++)
+      {
+        const CallStatistics &stats = call_statistics[idx];
+        if (stats.count == 0)
+          continue;
+        total_calls += stats.count;
+        total_time += stats.total_time;
+        log_run.info("Mapper %s on processor " IDFMT " call %s: %llu calls, "
+                     "mean %llu ns, p50 %llu ns, p99 %llu ns, max %llu ns",
+                     get_mapper_name(), processor.id, call_names[idx],
+                     stats.count, stats.total_time / stats.count,
+                     stats.find_percentile(50.0), stats.find_percentile(99.0),
+                     stats.max_time);
+      }
+      log_run.info("Mapper %s on processor " IDFMT " overhead: %llu calls "
+                   "totaling %llu ns", get_mapper_name(), processor.id,
+                   total_calls, total_time);
+    }
+
     //--------------------------------------------------------------------------
     /*static*/ const char* MapperManager::get_mapper_call_name(
                                                            MappingCallKind kind)
@@ -46,6 +46,14 @@ namespace Legion {
      */
     class MapperManager {
     public:
+      struct MemoizedMustEpoch {
+      public:
+        // The shape of the must epoch launch this mapping is valid for
+        std::vector<std::pair<TaskID,DomainPoint> > tasks;
+        std::vector<std::vector<std::pair<unsigned,unsigned> > > constraints;
+        std::vector<std::vector<LogicalRegion> > constraint_regions;
+        Mapper::MapMustEpochOutput output;
+      };
       struct FinishMapperCallContinuationArgs : 
         public LgTaskArgs<FinishMapperCallContinuationArgs> {
       public:
@@ -59,6 +67,32 @@ namespace Legion {
         std::set<PhysicalManager*> instances;
         std::vector<bool> results;
       };
+      struct CallStatistics {
+      public:
+        CallStatistics(void);
+      public:
+        void record(unsigned long long duration);
+        unsigned long long find_percentile(double percentile) const;
+      public:
+        unsigned long long count;
+        unsigned long long total_time;
+        unsigned long long max_time;
+        // Bucket i counts calls that took less than 2^(i+1) nanoseconds
+        unsigned long long buckets[LEGION_MAPPER_CALL_HISTOGRAM_BUCKETS];
+      };
+      struct PendingMapTask {
+      public:
+        PendingMapTask(void)
+          : task(NULL), input(NULL), output(NULL) { }
+        PendingMapTask(TaskOp *t, Mapper::MapTaskInput *i,
+                       Mapper::MapTaskOutput *o, RtUserEvent d)
+          : task(t), input(i), output(o), done(d) { }
+      public:
+        TaskOp *task;
+        Mapper::MapTaskInput *input;
+        Mapper::MapTaskOutput *output;
+        RtUserEvent done;
+      };
       struct DeferMessageArgs : public LgTaskArgs<DeferMessageArgs> {
       public:
         static const LgTaskID TASK_ID = LG_DEFER_MAPPER_MESSAGE_TASK_ID;
@@ -92,6 +126,11 @@ namespace Legion {
                            Mapper::MapTaskOutput *output, 
                            bool first_invocation = true,
                            MappingCallInfo *info = NULL);
+      void invoke_map_tasks(std::vector<TaskOp*> *tasks,
+                            Mapper::MapTasksInput *input,
+                            Mapper::MapTasksOutput *output,
+                            bool first_invocation = true,
+                            MappingCallInfo *info = NULL);
       void invoke_select_task_variant(TaskOp *task, 
                                       Mapper::SelectVariantInput *input,
                                       Mapper::SelectVariantOutput *output,
@@ -260,6 +299,13 @@ namespace Legion {
                                  Mapper::MapMustEpochOutput *output,
                                  bool first_invocation = true,
                                  MappingCallInfo *info = NULL);
+      bool find_memoized_must_epoch(const Mapper::MapMustEpochInput &input,
+                                    Mapper::MapMustEpochOutput &output);
+      void memoize_must_epoch(const Mapper::MapMustEpochInput &input,
+                              const Mapper::MapMustEpochOutput &output);
+      static void compute_must_epoch_shape(
+                              const Mapper::MapMustEpochInput &input,
+                              MemoizedMustEpoch &shape);
       void invoke_map_dataflow_graph(Mapper::MapDataflowGraphInput *input,
                                      Mapper::MapDataflowGraphOutput *output,
                                      bool first_invocation = true,
@@ -412,6 +458,12 @@ namespace Legion {
                                     const std::vector<MappingInstance> &insts);
       void release_instances(       MappingCallInfo *ctx, const std::vector<
                                     std::vector<MappingInstance> > &instances);
+    protected:
+      void batch_map_task(TaskOp *task, Mapper::MapTaskInput *input,
+                          Mapper::MapTaskOutput *output);
+      void distribute_acquired_instances(MappingCallInfo *info,
+                                         const std::vector<TaskOp*> &tasks,
+                                         const Mapper::MapTasksOutput &output);
     public:
       void record_acquired_instance(MappingCallInfo *info, 
                                     PhysicalManager *manager, bool created);
@@ -544,6 +596,12 @@ namespace Legion {
       void free_call_info(MappingCallInfo *info, bool need_lock);
     public:
       static const char* get_mapper_call_name(MappingCallKind kind);
+    public:
+      // Only valid when running with -lg:mapper_stats
+      unsigned long long get_call_count(const char *call_name);
+      unsigned long long get_call_latency(const char *call_name, 
+                                          double percentile);
+      void report_call_statistics(void);
     public:
       void defer_message(Mapper::MapperMessage *message);
       static void handle_deferred_message(const void *args);
@@ -564,6 +622,17 @@ namespace Legion {
       Reservation mapper_lock;
     protected:
       std::vector<MappingCallInfo*> available_infos;
+      // Latency histograms for each kind of mapper call
+      std::vector<CallStatistics> call_statistics;
+    protected:
+      // Tasks waiting to be handed to the mapper in a map_tasks call,
+      // whichever caller finds no leader maps batches for the others
+      Reservation batch_lock;
+      std::vector<PendingMapTask> pending_map_tasks;
+      bool map_tasks_leader;
+    protected:
+      // The last memoized must epoch mapping for each mapping tag
+      std::map<MappingTagID,MemoizedMustEpoch> memoized_must_epochs;
     protected:
       unsigned next_mapper_event;
       std::map<unsigned,RtUserEvent> mapper_events;
@@ -20,6 +20,7 @@
 #include <set>
 #include <list>
 #include <vector>
+#include <algorithm>
 
 #include <stdio.h>
 #include <assert.h>
@@ -168,6 +169,86 @@ namespace Legion {
       typename std::set<Segment<T>*> x_segments, y_segments;
     };
 
+    /**
+     * \class SweepRectangleSet
+     * A set of DIM-dimensional rectangles stored as a flat
+     * array of disjoint boxes. Set operations are performed
+     * in bulk by sweeping the sorted edges of both operands
+     * one dimension at a time, which keeps the boxes in a
+     * canonical form so two sets with the same points always
+     * have the same representation. Rectangles added one at a
+     * time are buffered and folded in by a single sweep the
+     * next time the set is queried.
+     */
+    template<typename T, int DIM, bool DISCRETE>
+    class SweepRectangleSet {
+    public:
+      enum SetOp {
+        UNION_OP,
+        INTERSECT_OP,
+        DIFFERENCE_OP,
+      };
+      struct SweepEvent {
+      public:
+        SweepEvent(void) { }
+        SweepEvent(T c, const T *b, bool l, bool s)
+          : coord(c), box(b), lhs(l), start(s) { }
+      public:
+        inline bool operator<(const SweepEvent &rhs) const
+          { return (coord < rhs.coord); }
+      public:
+        T coord;
+        const T *box;
+        bool lhs, start;
+      };
+    public:
+      SweepRectangleSet(void);
+      SweepRectangleSet(const SweepRectangleSet &rhs);
+      ~SweepRectangleSet(void);
+    public:
+      SweepRectangleSet& operator=(const SweepRectangleSet &rhs);
+      inline bool operator==(const SweepRectangleSet &rhs) const;
+    public:
+      inline void add_rectangle(const T lower[DIM], const T upper[DIM]);
+      inline void add_rectangle(T lower_x, T lower_y, T upper_x, T upper_y);
+      inline bool covers(const T lower[DIM], const T upper[DIM]) const;
+      inline bool covers(T lower_x, T lower_y, T upper_x, T upper_y) const;
+      inline bool empty(void) const;
+      inline size_t size(void) const;
+      inline void get_rectangle(size_t idx, T lower[DIM], T upper[DIM]) const;
+      inline void clear(void);
+    public:
+      inline void union_with(const SweepRectangleSet &rhs);
+      inline void intersect_with(const SweepRectangleSet &rhs);
+      inline void subtract(const SweepRectangleSet &rhs);
+      static inline void compute_union(const SweepRectangleSet &lhs,
+                                       const SweepRectangleSet &rhs,
+                                       SweepRectangleSet &result);
+      static inline void compute_intersection(const SweepRectangleSet &lhs,
+                                              const SweepRectangleSet &rhs,
+                                              SweepRectangleSet &result);
+      static inline void compute_difference(const SweepRectangleSet &lhs,
+                                            const SweepRectangleSet &rhs,
+                                            SweepRectangleSet &result);
+    protected:
+      inline void flush_pending(void) const;
+      static inline void compute_operation(const SweepRectangleSet &lhs,
+                                           const SweepRectangleSet &rhs,
+                                           SetOp op, SweepRectangleSet &result);
+      static inline void gather_boxes(const std::vector<T> &bounds,
+                                      std::vector<const T*> &boxes);
+      static inline bool may_contain(SetOp op, bool has_lhs, bool has_rhs);
+      static void sweep(const std::vector<const T*> &lhs,
+                        const std::vector<const T*> &rhs,
+                        SetOp op, int dim, std::vector<T> &result);
+    protected:
+      // Half-open boxes, each stored as DIM lower bounds
+      // followed by DIM upper bounds
+      mutable std::vector<T> bounds;
+      // Rectangles added since the last sweep in the same layout
+      mutable std::vector<T> pending;
+    };
+
     /////////////////////////////////////////////////////////////
     // Segment 
     /////////////////////////////////////////////////////////////
@@ -2416,6 +2497,393 @@ namespace Legion {
       }
       return false;
     } 
+    /////////////////////////////////////////////////////////////
+    // SweepRectangleSet 
+    /////////////////////////////////////////////////////////////
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    SweepRectangleSet<T,DIM,DISCRETE>::SweepRectangleSet(void)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    SweepRectangleSet<T,DIM,DISCRETE>::SweepRectangleSet(
+                                                  const SweepRectangleSet &rhs)
+      : bounds(rhs.bounds), pending(rhs.pending)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    SweepRectangleSet<T,DIM,DISCRETE>::~SweepRectangleSet(void)
+    //--------------------------------------------------------------------------
+    {
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    SweepRectangleSet<T,DIM,DISCRETE>& 
+         SweepRectangleSet<T,DIM,DISCRETE>::operator=(const SweepRectangleSet &rhs)
+    //--------------------------------------------------------------------------
+    {
+      bounds = rhs.bounds;
+      pending = rhs.pending;
+      return *this;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline bool SweepRectangleSet<T,DIM,DISCRETE>::operator==(
+                                            const SweepRectangleSet &rhs) const
+    //--------------------------------------------------------------------------
+    {
+      // Canonical form means equal point sets have equal boxes
+      flush_pending();
+      rhs.flush_pending();
+      return (bounds == rhs.bounds);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::add_rectangle(
+                                       const T lower[DIM], const T upper[DIM])
+    //--------------------------------------------------------------------------
+    {
+      for (int d = 0; d < DIM; d++)
+      {
+#ifdef DEBUG_LEGION
+        assert(lower[d] <= upper[d]);
+#endif
+        if (!DISCRETE && (lower[d] == upper[d]))
+          return;
+      }
+      for (int d = 0; d < DIM; d++)
+        pending.push_back(lower[d]);
+      // Discrete rectangles are inclusive so make them half-open
+      for (int d = 0; d < DIM; d++)
+        pending.push_back(DISCRETE ? upper[d] + 1 : upper[d]);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::add_rectangle(T lower_x,
+                                      T lower_y, T upper_x, T upper_y)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(DIM == 2);
+#endif
+      const T lower[2] = { lower_x, lower_y };
+      const T upper[2] = { upper_x, upper_y };
+      add_rectangle(lower, upper);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline bool SweepRectangleSet<T,DIM,DISCRETE>::covers(
+                                 const T lower[DIM], const T upper[DIM]) const
+    //--------------------------------------------------------------------------
+    {
+      SweepRectangleSet query;
+      query.add_rectangle(lower, upper);
+      if (query.pending.empty())
+        return true;
+      // Covered if nothing is left after removing our boxes
+      SweepRectangleSet remainder;
+      compute_difference(query, *this, remainder);
+      return remainder.bounds.empty();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline bool SweepRectangleSet<T,DIM,DISCRETE>::covers(T lower_x, 
+                                 T lower_y, T upper_x, T upper_y) const
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(DIM == 2);
+#endif
+      const T lower[2] = { lower_x, lower_y };
+      const T upper[2] = { upper_x, upper_y };
+      return covers(lower, upper);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline bool SweepRectangleSet<T,DIM,DISCRETE>::empty(void) const
+    //--------------------------------------------------------------------------
+    {
+      return (bounds.empty() && pending.empty());
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline size_t SweepRectangleSet<T,DIM,DISCRETE>::size(void) const
+    //--------------------------------------------------------------------------
+    {
+      flush_pending();
+      return (bounds.size() / (2*DIM));
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::get_rectangle(size_t idx,
+                                         T lower[DIM], T upper[DIM]) const
+    //--------------------------------------------------------------------------
+    {
+      flush_pending();
+#ifdef DEBUG_LEGION
+      assert(((idx+1) * 2 * DIM) <= bounds.size());
+#endif
+      const T *box = &bounds[idx * 2 * DIM];
+      for (int d = 0; d < DIM; d++)
+      {
+        lower[d] = box[d];
+        upper[d] = DISCRETE ? box[DIM+d] - 1 : box[DIM+d];
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::clear(void)
+    //--------------------------------------------------------------------------
+    {
+      bounds.clear();
+      pending.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::union_with(
+                                                  const SweepRectangleSet &rhs)
+    //--------------------------------------------------------------------------
+    {
+      if (&rhs == this)
+        return;
+      // Unions can just be folded into the next sweep
+      pending.insert(pending.end(), rhs.bounds.begin(), rhs.bounds.end());
+      pending.insert(pending.end(), rhs.pending.begin(), rhs.pending.end());
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::intersect_with(
+                                                  const SweepRectangleSet &rhs)
+    //--------------------------------------------------------------------------
+    {
+      SweepRectangleSet result;
+      compute_intersection(*this, rhs, result);
+      bounds.swap(result.bounds);
+      pending.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::subtract(
+                                                  const SweepRectangleSet &rhs)
+    //--------------------------------------------------------------------------
+    {
+      SweepRectangleSet result;
+      compute_difference(*this, rhs, result);
+      bounds.swap(result.bounds);
+      pending.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    /*static*/ inline void SweepRectangleSet<T,DIM,DISCRETE>::compute_union(
+                 const SweepRectangleSet &lhs, const SweepRectangleSet &rhs,
+                 SweepRectangleSet &result)
+    //--------------------------------------------------------------------------
+    {
+      compute_operation(lhs, rhs, UNION_OP, result);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    /*static*/ inline void 
+      SweepRectangleSet<T,DIM,DISCRETE>::compute_intersection(
+                 const SweepRectangleSet &lhs, const SweepRectangleSet &rhs,
+                 SweepRectangleSet &result)
+    //--------------------------------------------------------------------------
+    {
+      compute_operation(lhs, rhs, INTERSECT_OP, result);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    /*static*/ inline void 
+      SweepRectangleSet<T,DIM,DISCRETE>::compute_difference(
+                 const SweepRectangleSet &lhs, const SweepRectangleSet &rhs,
+                 SweepRectangleSet &result)
+    //--------------------------------------------------------------------------
+    {
+      compute_operation(lhs, rhs, DIFFERENCE_OP, result);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    inline void SweepRectangleSet<T,DIM,DISCRETE>::flush_pending(void) const
+    //--------------------------------------------------------------------------
+    {
+      if (pending.empty())
+        return;
+      std::vector<const T*> lhs, rhs;
+      gather_boxes(bounds, lhs);
+      gather_boxes(pending, lhs);
+      std::vector<T> result;
+      sweep(lhs, rhs, UNION_OP, 0/*dim*/, result);
+      bounds.swap(result);
+      pending.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    /*static*/ inline void SweepRectangleSet<T,DIM,DISCRETE>::compute_operation(
+                 const SweepRectangleSet &lhs, const SweepRectangleSet &rhs,
+                 SetOp op, SweepRectangleSet &result)
+    //--------------------------------------------------------------------------
+    {
+      // Pending boxes may overlap, which the sweep handles just fine,
+      // so there is no need to flush them first
+      std::vector<const T*> lhs_boxes, rhs_boxes;
+      gather_boxes(lhs.bounds, lhs_boxes);
+      gather_boxes(lhs.pending, lhs_boxes);
+      gather_boxes(rhs.bounds, rhs_boxes);
+      gather_boxes(rhs.pending, rhs_boxes);
+      std::vector<T> boxes;
+      sweep(lhs_boxes, rhs_boxes, op, 0/*dim*/, boxes);
+      result.bounds.swap(boxes);
+      result.pending.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    /*static*/ inline void SweepRectangleSet<T,DIM,DISCRETE>::gather_boxes(
+                   const std::vector<T> &bounds, std::vector<const T*> &boxes)
+    //--------------------------------------------------------------------------
+    {
+      for (unsigned idx = 0; idx < bounds.size(); idx += 2*DIM)
+        boxes.push_back(&bounds[idx]);
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    /*static*/ inline bool SweepRectangleSet<T,DIM,DISCRETE>::may_contain(
+                                     SetOp op, bool has_lhs, bool has_rhs)
+    //--------------------------------------------------------------------------
+    {
+      switch (op)
+      {
+        case UNION_OP:
+          return (has_lhs || has_rhs);
+        case INTERSECT_OP:
+          return (has_lhs && has_rhs);
+        case DIFFERENCE_OP:
+          return has_lhs;
+        default:
+          assert(false);
+      }
+      return false;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T, int DIM, bool DISCRETE>
+    /*static*/ void SweepRectangleSet<T,DIM,DISCRETE>::sweep(
+                  const std::vector<const T*> &lhs, 
+                  const std::vector<const T*> &rhs,
+                  SetOp op, int dim, std::vector<T> &result)
+    //--------------------------------------------------------------------------
+    {
+      // Sort the edges of all the boxes along this dimension
+      std::vector<SweepEvent> events;
+      events.reserve(2 * (lhs.size() + rhs.size()));
+      for (typename std::vector<const T*>::const_iterator it = 
+            lhs.begin(); it != lhs.end(); it++)
+      {
+        events.push_back(SweepEvent((*it)[dim], *it, true/*lhs*/, true));
+        events.push_back(SweepEvent((*it)[DIM+dim], *it, true/*lhs*/, false));
+      }
+      for (typename std::vector<const T*>::const_iterator it = 
+            rhs.begin(); it != rhs.end(); it++)
+      {
+        events.push_back(SweepEvent((*it)[dim], *it, false/*lhs*/, true));
+        events.push_back(SweepEvent((*it)[DIM+dim], *it, false/*lhs*/, false));
+      }
+      std::sort(events.begin(), events.end());
+      // Walk the slabs between consecutive edges, computing the 
+      // cross-section of each slab in the remaining dimensions and
+      // extending the previous slab whenever the cross-section is
+      // the same so that the result stays canonical
+      std::vector<const T*> active_lhs, active_rhs;
+      std::vector<T> previous, current;
+      T previous_lo = 0, previous_hi = 0;
+      unsigned idx = 0;
+      while (idx < events.size())
+      {
+        const T line = events[idx].coord;
+        for ( ; (idx < events.size()) && (events[idx].coord == line); idx++)
+        {
+          const SweepEvent &event = events[idx];
+          std::vector<const T*> &active = 
+            event.lhs ? active_lhs : active_rhs;
+          if (!event.start)
+          {
+            for (unsigned i = 0; i < active.size(); i++)
+            {
+              if (active[i] != event.box)
+                continue;
+              active[i] = active.back();
+              active.pop_back();
+              break;
+            }
+          }
+          else
+            active.push_back(event.box);
+        }
+        if (idx == events.size())
+          break;
+        const T next_line = events[idx].coord;
+        current.clear();
+        if (may_contain(op, !active_lhs.empty(), !active_rhs.empty()))
+        {
+          if (dim == (DIM-1))
+          {
+            // Last dimension, so the slab is either all in or all out
+            if ((op != DIFFERENCE_OP) || active_rhs.empty())
+              current.resize(2*DIM, 0);
+          }
+          else
+            sweep(active_lhs, active_rhs, op, dim+1, current);
+        }
+        if (!previous.empty() && (previous_hi == line) && 
+            (previous == current))
+        {
+          previous_hi = next_line;
+          continue;
+        }
+        // Emit the previous slab with its bounds in this dimension
+        for (unsigned i = 0; i < previous.size(); i += 2*DIM)
+        {
+          previous[i+dim] = previous_lo;
+          previous[i+DIM+dim] = previous_hi;
+        }
+        result.insert(result.end(), previous.begin(), previous.end());
+        previous.swap(current);
+        previous_lo = line;
+        previous_hi = next_line;
+      }
+      for (unsigned i = 0; i < previous.size(); i += 2*DIM)
+      {
+        previous[i+dim] = previous_lo;
+        previous[i+DIM+dim] = previous_hi;
+      }
+      result.insert(result.end(), previous.begin(), previous.end());
+    }
   }; // namespace Internal
 }; // namespace Legion
 
@@ -38,7 +38,7 @@ namespace Legion {
 
     //--------------------------------------------------------------------------
     RegionTreeForest::RegionTreeForest(Runtime *rt)
-      : runtime(rt)
+      : runtime(rt), copies_issued(0), copies_coalesced(0)
     //--------------------------------------------------------------------------
     {
       this->lookup_lock = Reservation::create_reservation();
@@ -57,11 +57,25 @@ namespace Legion {
     RegionTreeForest::~RegionTreeForest(void)
     //--------------------------------------------------------------------------
     {
+      if (Runtime::copy_statistics)
+        log_run.print("Copies on node %d: %zd issued %zd coalesced",
+                      runtime->address_space, copies_issued, copies_coalesced);
       // We can delete the lookup lock now that we no longer need it
       lookup_lock.destroy_reservation();
       lookup_lock = Reservation::NO_RESERVATION;
     }
 
+    //--------------------------------------------------------------------------
+    void RegionTreeForest::record_copy_statistics(unsigned issued,
+                                                  unsigned coalesced)
+    //--------------------------------------------------------------------------
+    {
+      if (issued > 0)
+        __sync_fetch_and_add(&copies_issued, issued);
+      if (coalesced > 0)
+        __sync_fetch_and_add(&copies_coalesced, coalesced);
+    }
+
     //--------------------------------------------------------------------------
     RegionTreeForest& RegionTreeForest::operator=(const RegionTreeForest &rhs)
     //--------------------------------------------------------------------------
@@ -99,17 +113,21 @@ namespace Legion {
       // Then do field space nodes
       std::vector<FieldSpaceNode*> fields_to_delete;
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        for (std::map<FieldSpace,FieldSpaceNode*>::const_iterator it = 
-              field_nodes.begin(); it != field_nodes.end(); it++)
+        std::vector<FieldSpaceNode*> field_space_nodes;
+        {
+          AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
+          field_nodes.get_values(field_space_nodes);
+        }
+        for (std::vector<FieldSpaceNode*>::const_iterator it = 
+              field_space_nodes.begin(); it != field_space_nodes.end(); it++)
         {
           // Only care about nodes that we own
-          if (!it->second->is_owner())
+          if (!(*it)->is_owner())
             continue;
           // If we can actively delete it then it isn't valid
-          if (it->second->destroyed)
+          if ((*it)->destroyed)
             continue;
-          fields_to_delete.push_back(it->second);
+          fields_to_delete.push_back(*it);
         }
       }
       for (std::vector<FieldSpaceNode*>::const_iterator it =
@@ -119,20 +137,24 @@ namespace Legion {
       // Then do index space nodes
       std::vector<IndexSpaceNode*> indexes_to_delete;
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        for (std::map<IndexSpace,IndexSpaceNode*>::const_iterator it = 
-              index_nodes.begin(); it != index_nodes.end(); it++)
+        std::vector<IndexSpaceNode*> index_space_nodes;
+        {
+          AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
+          index_nodes.get_values(index_space_nodes);
+        }
+        for (std::vector<IndexSpaceNode*>::const_iterator it = 
+              index_space_nodes.begin(); it != index_space_nodes.end(); it++)
         {
           // Only care about nodes at the top of the tree
-          if (it->second->parent != NULL)
+          if ((*it)->parent != NULL)
             continue;
           // Only care about nodes that we own
-          if (!it->second->is_owner())
+          if (!(*it)->is_owner())
             continue;
           // If we can actively delete it then it isn't valid
-          if (it->second->destroyed)
+          if ((*it)->destroyed)
             continue;
-          indexes_to_delete.push_back(it->second);
+          indexes_to_delete.push_back(*it);
         }
       }
       for (std::vector<IndexSpaceNode*>::const_iterator it = 
@@ -570,6 +592,36 @@ namespace Legion {
                                 projection, instances, instances_ready);
     }
 
+    //--------------------------------------------------------------------------
+    ApEvent RegionTreeForest::create_partition_by_copy(Operation *op,
+                                                       IndexPartition pending,
+                                                       IndexPartition source)
+    //--------------------------------------------------------------------------
+    {
+      IndexPartNode *partition = get_node(pending);
+      IndexPartNode *src_part = get_node(source);
+#ifdef DEBUG_LEGION
+      assert(partition->parent == src_part->parent);
+      assert(partition->color_space == src_part->color_space);
+#endif
+      std::set<ApEvent> ready_events;
+      for (LegionColor color = 0; 
+            color < partition->max_linearized_color; color++)
+      {
+        if ((partition->total_children != partition->max_linearized_color) &&
+            !partition->color_space->contains_color(color))
+          continue;
+        IndexSpaceNode *child = partition->get_child(color);
+        ApEvent ready = child->copy_realm_index_space(
+                                    src_part->get_child(color));
+        if (ready.exists())
+          ready_events.insert(ready);
+      }
+      if (op->has_execution_fence_event())
+        ready_events.insert(op->get_execution_fence_event());
+      return Runtime::merge_events(ready_events);
+    }
+
     //--------------------------------------------------------------------------
     ApEvent RegionTreeForest::create_association(Operation *op,
                                                  IndexSpace dom, IndexSpace ran,
@@ -1213,6 +1265,7 @@ namespace Legion {
         parent_node->column_source->get_field_mask(req.privilege_fields);
       // Then compute the logical user
       LogicalUser user(op, idx, RegionUsage(req), user_mask); 
+      op->prepare_logical_records(idx+1);
       TraceInfo trace_info(op->already_traced(), op->get_trace(), idx, req); 
       // Update the version info to set the maximum depth
       if (projection_info.is_projecting())
@@ -1247,7 +1300,7 @@ namespace Legion {
                        FieldMask(LEGION_FIELD_MASK_FIELD_ALL_ONES), user_mask);
 #endif
       // Once we are done we can clear out the list of recorded dependences
-      op->clear_logical_records();
+      op->clear_logical_records(idx);
       // Do our check for restricted coherence
       TaskContext *parent_ctx = op->get_context();
       if (parent_ctx->has_restrictions())
@@ -1257,6 +1310,102 @@ namespace Legion {
         req.flags |= RESTRICTED_FLAG;
     }
 
+    //--------------------------------------------------------------------------
+    void RegionTreeForest::perform_dependence_analysis(Operation *op,
+                                  std::vector<RegionRequirement> &regions,
+                                  std::vector<RestrictInfo> &restrict_infos,
+                                  std::vector<VersionInfo> &version_infos,
+                                  std::vector<ProjectionInfo> *projection_infos,
+                                  std::vector<RegionTreePath> &paths)
+    //--------------------------------------------------------------------------
+    {
+      // Group the requirements by the region tree that they analyze, 
+      // traversals of different trees never touch the same logical state.
+      // Traces and must epochs record dependences on shared structures and
+      // legion spy needs close indexes in a deterministic order so all of
+      // those still get analyzed serially
+      std::map<RegionTreeID,std::vector<unsigned> > tree_groups;
+#ifndef LEGION_SPY
+      if (Runtime::parallel_logical_analysis && (regions.size() > 1) &&
+          !op->is_tracing() && (op->get_must_epoch() == NULL) &&
+          !Runtime::legion_spy_enabled)
+      {
+        for (unsigned idx = 0; idx < regions.size(); idx++)
+          tree_groups[regions[idx].parent.get_tree_id()].push_back(idx);
+      }
+#endif
+      if (tree_groups.size() <= 1)
+      {
+        ProjectionInfo projection_info;
+        for (unsigned idx = 0; idx < regions.size(); idx++)
+          perform_dependence_analysis(op, idx, regions[idx], 
+                                      restrict_infos[idx], version_infos[idx],
+              (projection_infos == NULL) ? projection_info : 
+                                           (*projection_infos)[idx],
+                                      paths[idx]);
+        return;
+      }
+      // Size the records up front so no traversal has to resize them
+      op->prepare_logical_records(regions.size());
+      LogicalAnalysisArgs args;
+      args.op = op;
+      args.regions = &regions;
+      args.restrict_infos = &restrict_infos;
+      args.version_infos = &version_infos;
+      args.projection_infos = projection_infos;
+      args.privilege_paths = &paths;
+      std::set<RtEvent> analyzed_events;
+      std::map<RegionTreeID,std::vector<unsigned> >::const_iterator it = 
+        tree_groups.begin();
+      // Do the first tree ourselves and hand the rest to other 
+      // utility processors to analyze at the same time
+      for (++it; it != tree_groups.end(); it++)
+      {
+        args.indexes = &it->second;
+        analyzed_events.insert(
+            runtime->issue_runtime_meta_task(args, LG_LATENCY_PRIORITY, op));
+      }
+      perform_dependence_analysis(op, tree_groups.begin()->second, regions,
+                     restrict_infos, version_infos, projection_infos, paths);
+      // The stack-allocated groups must outlive all the analyses
+      const RtEvent wait_on = Runtime::merge_events(analyzed_events);
+      if (wait_on.exists())
+        wait_on.lg_wait();
+    }
+
+    //--------------------------------------------------------------------------
+    void RegionTreeForest::perform_dependence_analysis(Operation *op,
+                                  const std::vector<unsigned> &indexes,
+                                  std::vector<RegionRequirement> &regions,
+                                  std::vector<RestrictInfo> &restrict_infos,
+                                  std::vector<VersionInfo> &version_infos,
+                                  std::vector<ProjectionInfo> *projection_infos,
+                                  std::vector<RegionTreePath> &paths)
+    //--------------------------------------------------------------------------
+    {
+      ProjectionInfo projection_info;
+      for (std::vector<unsigned>::const_iterator it = indexes.begin();
+            it != indexes.end(); it++)
+        perform_dependence_analysis(op, *it, regions[*it], 
+                                    restrict_infos[*it], version_infos[*it],
+            (projection_infos == NULL) ? projection_info : 
+                                         (*projection_infos)[*it],
+                                    paths[*it]);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void RegionTreeForest::handle_logical_analysis(const void *args)
+    //--------------------------------------------------------------------------
+    {
+      const LogicalAnalysisArgs *largs = (const LogicalAnalysisArgs*)args;
+      DETAILED_PROFILER(largs->op->runtime, 
+                        REGION_TREE_DEFERRED_LOGICAL_ANALYSIS_CALL);
+      largs->op->runtime->forest->perform_dependence_analysis(largs->op,
+          *(largs->indexes), *(largs->regions), *(largs->restrict_infos),
+          *(largs->version_infos), largs->projection_infos, 
+          *(largs->privilege_paths));
+    }
+
     //--------------------------------------------------------------------------
     void RegionTreeForest::perform_fence_analysis(RegionTreeContext ctx,
                                                   Operation *fence,
@@ -1292,6 +1441,7 @@ namespace Legion {
         parent_node->column_source->get_field_mask(req.privilege_fields);
       // Then compute the logical user
       LogicalUser user(op, idx, RegionUsage(req), user_mask);
+      op->prepare_logical_records(idx+1);
       TraceInfo trace_info(op->already_traced(), op->get_trace(), idx, req);
 #ifdef DEBUG_LEGION
       TreeStateLogger::capture_state(runtime, &req, idx, op->get_logging_name(),
@@ -1311,7 +1461,7 @@ namespace Legion {
                                              path, restrict_info, 
                                              version_info, trace_info);
       // Once we are done we can clear out the list of recorded dependences
-      op->clear_logical_records();
+      op->clear_logical_records(idx);
 #ifdef DEBUG_LEGION
       TreeStateLogger::capture_state(runtime, &req, idx, op->get_logging_name(),
                                      op->get_unique_op_id(), parent_node,
@@ -1979,6 +2129,57 @@ namespace Legion {
 #endif
     }
 
+    //--------------------------------------------------------------------------
+    void RegionTreeForest::physical_register_valid(const RegionRequirement &req,
+                                                   VersionInfo &version_info,
+                                                   Operation *op, unsigned index,
+                                                   ApEvent term_event,
+                                                   std::set<RtEvent> &map_applied,
+                                                   InstanceSet &targets)
+    //--------------------------------------------------------------------------
+    {
+      DETAILED_PROFILER(runtime, REGION_TREE_PHYSICAL_REGISTER_ONLY_CALL);
+      InnerContext *context = op->find_physical_context(index);
+#ifdef DEBUG_LEGION
+      assert(req.handle_type == SINGULAR);
+      assert(!targets.empty());
+      assert(!targets.is_virtual_mapping());
+#endif
+      // The caller has guaranteed that the targets still hold valid
+      // data for all the fields so there is no need to look for valid
+      // views or issue any copies, just record ourselves as a user
+      RegionNode *region_node = get_node(req.region);
+      std::vector<InstanceView*> target_views(targets.size());
+      region_node->convert_target_views(targets, context, target_views);
+      const RegionUsage usage(req);
+      if (targets.size() == 1)
+      {
+        InstanceRef &ref = targets[0];
+        ApEvent ready = target_views[0]->add_user_fused(usage, term_event,
+                                  ref.get_valid_fields(), op, index, 
+                                  &version_info, runtime->address_space, 
+                                  map_applied);
+        ref.set_ready_event(ready);
+        return;
+      }
+      // Two pass approach so we don't depend on ourselves
+      for (unsigned idx = 0; idx < targets.size(); idx++)
+      {
+        InstanceRef &ref = targets[idx];
+        ApEvent ready = target_views[idx]->find_user_precondition(usage,
+                          term_event, ref.get_valid_fields(), op, index,
+                          &version_info, map_applied);
+        ref.set_ready_event(ready);
+      }
+      for (unsigned idx = 0; idx < targets.size(); idx++)
+      {
+        InstanceRef &ref = targets[idx];
+        target_views[idx]->add_user(usage, term_event, ref.get_valid_fields(),
+                                    op, index, runtime->address_space,
+                                    &version_info, map_applied);
+      }
+    }
+
     //--------------------------------------------------------------------------
     void RegionTreeForest::physical_register_users(
                                   Operation *op, ApEvent term_event,
@@ -2461,7 +2662,10 @@ namespace Legion {
           }
           if (src_fields.empty())
             continue;
-          ApEvent dst_precondition = dst_ref.get_ready_event(); 
+          // Source instances that become ready at the same time can
+          // all be handled by a single copy to this destination
+          std::map<ApEvent,std::pair<std::vector<CopySrcDstField>,
+                                     std::vector<CopySrcDstField> > > copies;
           for (std::map<unsigned,std::vector<CopySrcDstField> >::
                 const_iterator src_it = src_fields.begin(); 
                 src_it != src_fields.end(); src_it++)
@@ -2472,13 +2676,27 @@ namespace Legion {
             assert(dst_it != dst_fields.end());
             assert(src_it->second.size() == dst_it->second.size());
 #endif
-            ApEvent src_precondition = 
-              src_targets[src_it->first].get_ready_event();
-            ApEvent copy_pre = Runtime::merge_events(src_precondition,
+            std::pair<std::vector<CopySrcDstField>,
+                      std::vector<CopySrcDstField> > &copy = 
+              copies[src_targets[src_it->first].get_ready_event()];
+            copy.first.insert(copy.first.end(), 
+                              src_it->second.begin(), src_it->second.end());
+            copy.second.insert(copy.second.end(),
+                               dst_it->second.begin(), dst_it->second.end());
+          }
+          if (Runtime::copy_statistics)
+            record_copy_statistics(0/*issued*/, 
+                                   src_fields.size() - copies.size());
+          ApEvent dst_precondition = dst_ref.get_ready_event(); 
+          for (std::map<ApEvent,std::pair<std::vector<CopySrcDstField>,
+                std::vector<CopySrcDstField> > >::const_iterator it = 
+                copies.begin(); it != copies.end(); it++)
+          {
+            ApEvent copy_pre = Runtime::merge_events(it->first,
                                                      dst_precondition,
                                                      precondition);
-            ApEvent copy_post = dst_node->issue_copy(op, src_it->second,
-                                       dst_it->second, copy_pre, guard);
+            ApEvent copy_post = dst_node->issue_copy(op, it->second.first,
+                                       it->second.second, copy_pre, guard);
             if (copy_post.exists())
               result_events.insert(copy_post);
           }
@@ -3096,17 +3314,16 @@ namespace Legion {
       {
         // Hold the lookup lock while modifying the lookup table
         AutoLock l_lock(lookup_lock);
-        std::map<IndexSpace,IndexSpaceNode*>::const_iterator it =
-          index_nodes.find(sp);
-        if (it != index_nodes.end())
+        IndexSpaceNode *existing = index_nodes.find(sp);
+        if (existing != NULL)
         {
           // Need to remove resource reference if not owner
           if (result->is_owner() || 
               result->remove_base_resource_ref(REMOTE_DID_REF))
             delete result;
-          return it->second;
+          return existing;
         }
-        index_nodes[sp] = result;
+        index_nodes.insert(sp, result);
         index_space_requests.erase(sp);
       }
       LocalReferenceMutator mutator;
@@ -3145,9 +3362,8 @@ namespace Legion {
       {
         // Hold the lookup lock while modifying the lookup table
         AutoLock l_lock(lookup_lock);
-        std::map<IndexSpace,IndexSpaceNode*>::const_iterator it =
-          index_nodes.find(sp);
-        if (it != index_nodes.end())
+        IndexSpaceNode *existing = index_nodes.find(sp);
+        if (existing != NULL)
         {
           // Need to remove resource reference if not owner
           if (result->is_owner() || 
@@ -3155,9 +3371,9 @@ namespace Legion {
             delete result;
           // Free up the event since we didn't use it
           Runtime::trigger_event(is_ready);
-          return it->second;
+          return existing;
         }
-        index_nodes[sp] = result;
+        index_nodes.insert(sp, result);
         index_space_requests.erase(sp);
       }
       LocalReferenceMutator mutator;
@@ -3199,17 +3415,16 @@ namespace Legion {
       {
         // Hold the lookup lock while modifying the lookup table
         AutoLock l_lock(lookup_lock);
-        std::map<IndexPartition,IndexPartNode*>::const_iterator it =
-          index_parts.find(p);
-        if (it != index_parts.end())
+        IndexPartNode *existing = index_parts.find(p);
+        if (existing != NULL)
         {
           // Need to remove resource reference if not owner
           if (result->is_owner() || 
               result->remove_base_resource_ref(REMOTE_DID_REF))
             delete result;
-          return it->second;
+          return existing;
         }
-        index_parts[p] = result;
+        index_parts.insert(p, result);
         index_part_requests.erase(p);
       }
       LocalReferenceMutator mutator;
@@ -3256,17 +3471,16 @@ namespace Legion {
       {
         // Hold the lookup lock while modifying the lookup table
         AutoLock l_lock(lookup_lock);
-        std::map<IndexPartition,IndexPartNode*>::const_iterator it =
-          index_parts.find(p);
-        if (it != index_parts.end())
+        IndexPartNode *existing = index_parts.find(p);
+        if (existing != NULL)
         {
           // Need to remove resource reference if not owner
           if (result->is_owner() || 
               result->remove_base_resource_ref(REMOTE_DID_REF))
             delete result;
-          return it->second;
+          return existing;
         }
-        index_parts[p] = result;
+        index_parts.insert(p, result);
         index_part_requests.erase(p);
       }
       LocalReferenceMutator mutator;
@@ -3302,17 +3516,16 @@ namespace Legion {
       // Hold the lookup lock while modifying the lookup table
       {
         AutoLock l_lock(lookup_lock);
-        std::map<FieldSpace,FieldSpaceNode*>::const_iterator it =
-          field_nodes.find(space);
-        if (it != field_nodes.end())
+        FieldSpaceNode *existing = field_nodes.find(space);
+        if (existing != NULL)
         {
           // Need to remove resource reference if not owner
           if (result->is_owner() || 
               result->remove_base_resource_ref(REMOTE_DID_REF))
             delete result;
-          return it->second;
+          return existing;
         }
-        field_nodes[space] = result;
+        field_nodes.insert(space, result);
         field_space_requests.erase(space);
       }
       LocalReferenceMutator mutator;
@@ -3341,17 +3554,16 @@ namespace Legion {
       // Hold the lookup lock while modifying the lookup table
       {
         AutoLock l_lock(lookup_lock);
-        std::map<FieldSpace,FieldSpaceNode*>::const_iterator it =
-          field_nodes.find(space);
-        if (it != field_nodes.end())
+        FieldSpaceNode *existing = field_nodes.find(space);
+        if (existing != NULL)
         {
           // Need to remove resource reference if not owner
           if (result->is_owner() || 
               result->remove_base_resource_ref(REMOTE_DID_REF))
             delete result;
-          return it->second;
+          return existing;
         }
-        field_nodes[space] = result;
+        field_nodes.insert(space, result);
         field_space_requests.erase(space);
       }
       LocalReferenceMutator mutator;
@@ -3392,9 +3604,8 @@ namespace Legion {
         // Hold the lookup lock when modifying the lookup table
         AutoLock l_lock(lookup_lock);
         // Check to see if it already exists
-        std::map<LogicalRegion,RegionNode*>::const_iterator it =
-          region_nodes.find(r);
-        if (it != region_nodes.end())
+        RegionNode *existing = region_nodes.find(r);
+        if (existing != NULL)
         {
           // It already exists, delete our copy and return
           // the one that has already been made
@@ -3403,10 +3614,10 @@ namespace Legion {
               result->remove_base_resource_ref(REMOTE_DID_REF))
 #endif
           delete result;
-          return it->second;
+          return existing;
         }
-        // Now we can add it to the map
-        region_nodes[r] = result;
+        // Now we can add it to the table
+        region_nodes.insert(r, result);
         // If this is a top level region add it to the collection
         // of top level tree IDs
         if (parent == NULL)
@@ -3445,9 +3656,8 @@ namespace Legion {
       {
         // Hole the lookup lock when modifying the lookup table
         AutoLock l_lock(lookup_lock);
-        std::map<LogicalPartition,PartitionNode*>::const_iterator it =
-          part_nodes.find(p);
-        if (it != part_nodes.end())
+        PartitionNode *existing = part_nodes.find(p);
+        if (existing != NULL)
         {
           // It already exists, delete our copy and
           // return the one that has already been made
@@ -3456,10 +3666,10 @@ namespace Legion {
               result->remove_base_resource_ref(REMOTE_DID_REF))
 #endif
           delete result;
-          return it->second;
+          return existing;
         }
-        // Now we can put the node in the map
-        part_nodes[p] = result;
+        // Now we can put the node in the table
+        part_nodes.insert(p, result);
       }
       result->record_registered();
       
@@ -3474,26 +3684,23 @@ namespace Legion {
         REPORT_LEGION_ERROR(ERROR_INVALID_REQUEST_FOR_INDEXSPACE,
           "Invalid request for IndexSpace NO_SPACE.")
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/); 
-        std::map<IndexSpace,IndexSpaceNode*>::const_iterator finder = 
-          index_nodes.find(space);
-        if (finder != index_nodes.end())
-          return finder->second;
+        IndexSpaceNode *finder = index_nodes.find(space);
+        if (finder != NULL)
+          return finder;
       }
       // Couldn't find it, so send a request to the owner node
       AddressSpace owner = IndexSpaceNode::get_owner_space(space, runtime);
       if (owner == runtime->address_space)
         REPORT_LEGION_ERROR(ERROR_UNABLE_FIND_ENTRY,
           "Unable to find entry for index space %x.", space.id)
-      // Retake the lock and get something to wait on
+      // Take the lock and get something to wait on
       RtEvent wait_on;
       {
         AutoLock l_lock(lookup_lock);
         // Check to make sure we didn't loose the race
-        std::map<IndexSpace,IndexSpaceNode*>::const_iterator finder = 
-          index_nodes.find(space);
-        if (finder != index_nodes.end())
-          return finder->second;
+        IndexSpaceNode *finder = index_nodes.find(space);
+        if (finder != NULL)
+          return finder;
         // Still doesn't exists, see if we sent a request already
         std::map<IndexSpace,RtEvent>::const_iterator wait_finder = 
           index_space_requests.find(space);
@@ -3512,14 +3719,12 @@ namespace Legion {
       }
       // Wait on the event
       wait_on.lg_wait();
-      AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-      std::map<IndexSpace,IndexSpaceNode*>::const_iterator finder = 
-          index_nodes.find(space);
-      if (finder == index_nodes.end())
+      IndexSpaceNode *finder = index_nodes.find(space);
+      if (finder == NULL)
         REPORT_LEGION_ERROR(ERROR_UNABLE_FIND_ENTRY,
           "Unable to find entry for index space %x."
                         "This is definitely a runtime bug.", space.id)
-      return finder->second;
+      return finder;
     }
 
     //--------------------------------------------------------------------------
@@ -3530,11 +3735,9 @@ namespace Legion {
         REPORT_LEGION_ERROR(ERROR_INVALID_REQUEST_INDEXPARTITION,
           "Invalid request for IndexPartition NO_PART.")
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        std::map<IndexPartition,IndexPartNode*>::const_iterator finder =
-          index_parts.find(part);
-        if (finder != index_parts.end())
-          return finder->second;
+        IndexPartNode *finder = index_parts.find(part);
+        if (finder != NULL)
+          return finder;
       }
       // Couldn't find it, so send a request to the owner node
       AddressSpace owner = IndexPartNode::get_owner_space(part, runtime);
@@ -3543,13 +3746,12 @@ namespace Legion {
           "Unable to find entry for index partition %x.",part.id)
       RtEvent wait_on;
       {
-        // Retake the lock in exclusive mode and make
+        // Take the lock in exclusive mode and make
         // sure we didn't loose the race
         AutoLock l_lock(lookup_lock);
-        std::map<IndexPartition,IndexPartNode*>::const_iterator finder =
-          index_parts.find(part);
-        if (finder != index_parts.end())
-          return finder->second;
+        IndexPartNode *finder = index_parts.find(part);
+        if (finder != NULL)
+          return finder;
         // See if we've already sent the request or not
         std::map<IndexPartition,RtEvent>::const_iterator wait_finder = 
           index_part_requests.find(part);
@@ -3568,14 +3770,12 @@ namespace Legion {
       }
       // Wait for the event
       wait_on.lg_wait();
-      AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-      std::map<IndexPartition,IndexPartNode*>::const_iterator finder = 
-        index_parts.find(part);
-      if (finder == index_parts.end())
+      IndexPartNode *finder = index_parts.find(part);
+      if (finder == NULL)
         REPORT_LEGION_ERROR(ERROR_UNABLE_FIND_ENTRY,
           "Unable to find entry for index partition %x. "
                         "This is definitely a runtime bug.", part.id)
-      return finder->second;
+      return finder;
     }
 
     //--------------------------------------------------------------------------
@@ -3586,11 +3786,9 @@ namespace Legion {
         REPORT_LEGION_ERROR(ERROR_INVALID_REQUEST_FIELDSPACE,
           "Invalid request for FieldSpace NO_SPACE.")
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        std::map<FieldSpace,FieldSpaceNode*>::const_iterator finder = 
-          field_nodes.find(space);
-        if (finder != field_nodes.end())
-          return finder->second;
+        FieldSpaceNode *finder = field_nodes.find(space);
+        if (finder != NULL)
+          return finder;
       }
       // Couldn't find it, so send a request to the owner node
       AddressSpaceID owner = FieldSpaceNode::get_owner_space(space, runtime); 
@@ -3599,13 +3797,12 @@ namespace Legion {
           "Unable to find entry for field space %x.", space.id)
       RtEvent wait_on;
       {
-        // Retake the lock in exclusive mode and 
+        // Take the lock in exclusive mode and 
         // check to make sure we didn't loose the race
         AutoLock l_lock(lookup_lock);
-        std::map<FieldSpace,FieldSpaceNode*>::const_iterator finder = 
-          field_nodes.find(space);
-        if (finder != field_nodes.end())
-          return finder->second;
+        FieldSpaceNode *finder = field_nodes.find(space);
+        if (finder != NULL)
+          return finder;
         // Now see if we've already sent a request
         std::map<FieldSpace,RtEvent>::const_iterator wait_finder = 
           field_space_requests.find(space);
@@ -3624,14 +3821,12 @@ namespace Legion {
       }
       // Wait for the event to be ready
       wait_on.lg_wait();
-      AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-      std::map<FieldSpace,FieldSpaceNode*>::const_iterator finder = 
-        field_nodes.find(space);
-      if (finder == field_nodes.end())
+      FieldSpaceNode *finder = field_nodes.find(space);
+      if (finder == NULL)
         REPORT_LEGION_ERROR(ERROR_UNABLE_FIND_ENTRY,
           "Unable to find entry for field space %x. "
                         "This is definitely a runtime bug.", space.id)
-      return finder->second;
+      return finder;
     }
 
     //--------------------------------------------------------------------------
@@ -3643,20 +3838,21 @@ namespace Legion {
         REPORT_LEGION_ERROR(ERROR_INVALID_REQUEST_LOGICALREGION,
           "Invalid request for LogicalRegion NO_REGION.")
       // Check to see if the node already exists
+      {
+        RegionNode *it = region_nodes.find(handle);
+        if (it != NULL)
+          return it;
+      }
       bool has_top_level_region;
+      if (need_check)
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        std::map<LogicalRegion,RegionNode*>::const_iterator it = 
-          region_nodes.find(handle);
-        if (it != region_nodes.end())
-          return it->second;
         // Check to see if we have the top level region
-        if (need_check)
-          has_top_level_region = 
-            (tree_nodes.find(handle.get_tree_id()) != tree_nodes.end());
-        else
-          has_top_level_region = true;
+        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
+        has_top_level_region = 
+          (tree_nodes.find(handle.get_tree_id()) != tree_nodes.end());
       }
+      else
+        has_top_level_region = true;
       // If we don't have the top-level region, we need to request it before
       // we go crawling up the tree so we know where to stop
       if (!has_top_level_region)
@@ -3695,23 +3891,20 @@ namespace Legion {
           else
           {
             // We lost the race and it may be here now
-            std::map<LogicalRegion,RegionNode*>::const_iterator it = 
-              region_nodes.find(handle);
-            if (it != region_nodes.end())
-              return it->second;
+            RegionNode *it = region_nodes.find(handle);
+            if (it != NULL)
+              return it;
           }
         }
         // If we did find something to wait on, do that now
         if (wait_on.exists())
         {
           wait_on.lg_wait();
-          // Retake the lock and see again if the handle we
-          // were looking for was the top-level node or not
-          AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-          std::map<LogicalRegion,RegionNode*>::const_iterator it = 
-            region_nodes.find(handle);
-          if (it != region_nodes.end())
-            return it->second;
+          // See again if the handle we were looking
+          // for was the top-level node or not
+          RegionNode *it = region_nodes.find(handle);
+          if (it != NULL)
+            return it;
         }
       }
       // Otherwise it hasn't been made yet, so make it
@@ -3742,11 +3935,9 @@ namespace Legion {
           "Invalid request for LogicalPartition NO_PART.")
       // Check to see if the node already exists
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        std::map<LogicalPartition,PartitionNode*>::const_iterator it =
-          part_nodes.find(handle);
-        if (it != part_nodes.end())
-          return it->second;
+        PartitionNode *it = part_nodes.find(handle);
+        if (it != NULL)
+          return it;
       }
       // Otherwise it hasn't been made yet so make it
       IndexPartNode *index_node = get_node(handle.index_partition);
@@ -3825,10 +4016,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/); 
-        std::map<IndexSpace,IndexSpaceNode*>::const_iterator finder = 
-          index_nodes.find(space);
-        if (finder != index_nodes.end())
+        IndexSpaceNode *finder = index_nodes.find(space);
+        if (finder != NULL)
           return RtEvent::NO_RT_EVENT;
       }
       // Couldn't find it, so send a request to the owner node
@@ -3838,9 +4027,8 @@ namespace Legion {
           "Unable to find entry for index space %x.", space.id)
       AutoLock l_lock(lookup_lock);
       // Check to make sure we didn't loose the race
-      std::map<IndexSpace,IndexSpaceNode*>::const_iterator finder = 
-        index_nodes.find(space);
-      if (finder != index_nodes.end())
+      IndexSpaceNode *finder = index_nodes.find(space);
+      if (finder != NULL)
         return RtEvent::NO_RT_EVENT;
       // Still doesn't exists, see if we sent a request already
       std::map<IndexSpace,RtEvent>::const_iterator wait_finder = 
@@ -3863,13 +4051,10 @@ namespace Legion {
     bool RegionTreeForest::has_node(IndexSpace space, bool local_only)
     //--------------------------------------------------------------------------
     {
-      {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        if (index_nodes.find(space) != index_nodes.end())
-          return true;
-        if (local_only)
-          return false;
-      }
+      if (index_nodes.contains(space))
+        return true;
+      if (local_only)
+        return false;
       return (get_node(space) != NULL);
     }
     
@@ -3877,13 +4062,10 @@ namespace Legion {
     bool RegionTreeForest::has_node(IndexPartition part, bool local_only)
     //--------------------------------------------------------------------------
     {
-      {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        if (index_parts.find(part) != index_parts.end())
-          return true;
-        if (local_only)
-          return false;
-      }
+      if (index_parts.contains(part))
+        return true;
+      if (local_only)
+        return false;
       return (get_node(part) != NULL);
     }
 
@@ -3891,13 +4073,10 @@ namespace Legion {
     bool RegionTreeForest::has_node(FieldSpace space, bool local_only)
     //--------------------------------------------------------------------------
     {
-      {
-        AutoLock l_lock(lookup_lock,1,false/*exclusive*/);
-        if (field_nodes.find(space) != field_nodes.end())
-          return true;
-        if (local_only)
-          return false;
-      }
+      if (field_nodes.contains(space))
+        return true;
+      if (local_only)
+        return false;
       return (get_node(space) != NULL);
     }
 
@@ -3948,12 +4127,11 @@ namespace Legion {
     {
       AutoLock l_lock(lookup_lock);
 #ifdef DEBUG_LEGION
-      std::map<IndexSpace,IndexSpaceNode*>::iterator finder = 
-        index_nodes.find(space);
-      assert(finder != index_nodes.end());
-      index_nodes.erase(finder);
-#else
-      index_nodes.erase(space);
+      IndexSpaceNode *removed = 
+#endif
+        index_nodes.erase(space);
+#ifdef DEBUG_LEGION
+      assert(removed != NULL);
 #endif
     }
 
@@ -3963,12 +4141,11 @@ namespace Legion {
     {
       AutoLock l_lock(lookup_lock);
 #ifdef DEBUG_LEGION
-      std::map<IndexPartition,IndexPartNode*>::iterator finder = 
-        index_parts.find(part);
-      assert(finder != index_parts.end());
-      index_parts.erase(finder);
-#else
-      index_parts.erase(part);
+      IndexPartNode *removed = 
+#endif
+        index_parts.erase(part);
+#ifdef DEBUG_LEGION
+      assert(removed != NULL);
 #endif
     }
 
@@ -3978,12 +4155,11 @@ namespace Legion {
     {
       AutoLock l_lock(lookup_lock);
 #ifdef DEBUG_LEGION
-      std::map<FieldSpace,FieldSpaceNode*>::iterator finder = 
-        field_nodes.find(space);
-      assert(finder != field_nodes.end());
-      field_nodes.erase(finder);
-#else
-      field_nodes.erase(space);
+      FieldSpaceNode *removed = 
+#endif
+        field_nodes.erase(space);
+#ifdef DEBUG_LEGION
+      assert(removed != NULL);
 #endif
     }
 
@@ -4000,10 +4176,8 @@ namespace Legion {
         assert(finder != tree_nodes.end());
         tree_nodes.erase(finder);
       }
-      std::map<LogicalRegion,RegionNode*>::iterator finder = 
-        region_nodes.find(handle);
-      assert(finder != region_nodes.end());
-      region_nodes.erase(finder);
+      RegionNode *removed = region_nodes.erase(handle);
+      assert(removed != NULL);
 #else
       if (top)
         tree_nodes.erase(handle.get_tree_id());
@@ -4017,12 +4191,11 @@ namespace Legion {
     {
       AutoLock l_lock(lookup_lock);
 #ifdef DEBUG_LEGION
-      std::map<LogicalPartition,PartitionNode*>::iterator finder = 
-        part_nodes.find(handle);
-      assert(finder != part_nodes.end());
-      part_nodes.erase(finder);
-#else
-      part_nodes.erase(handle);
+      PartitionNode *removed = 
+#endif
+        part_nodes.erase(handle);
+#ifdef DEBUG_LEGION
+      assert(removed != NULL);
 #endif
     }
 
@@ -4342,8 +4515,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       TreeStateLogger dump_logger; 
-      assert(region_nodes.find(region) != region_nodes.end());
-      region_nodes[region]->dump_logical_context(ctx, &dump_logger,
+      assert(region_nodes.contains(region));
+      region_nodes.find(region)->dump_logical_context(ctx, &dump_logger,
                                  FieldMask(LEGION_FIELD_MASK_FIELD_ALL_ONES));
     }
 
@@ -4353,8 +4526,8 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       TreeStateLogger dump_logger;
-      assert(region_nodes.find(region) != region_nodes.end());
-      region_nodes[region]->dump_physical_context(ctx, &dump_logger,
+      assert(region_nodes.contains(region));
+      region_nodes.find(region)->dump_physical_context(ctx, &dump_logger,
                                 FieldMask(LEGION_FIELD_MASK_FIELD_ALL_ONES));
     }
 #endif
@@ -7642,7 +7815,11 @@ namespace Legion {
         std::map<FieldID,FieldInfo>::iterator finder = fields.find(fid);
         finder->second.destroyed = true;
         if (is_owner())
-          free_index(finder->second.idx);
+        {
+          FieldMask freed;
+          freed.set_bit(finder->second.idx);
+          free_indexes(freed);
+        }
         if (is_owner() && !!remote_instances)
         {
           FindTargetsFunctor functor(targets);
@@ -7690,14 +7867,19 @@ namespace Legion {
         // not actually going to change the allocation of the fields
         // data structure
         AutoLock n_lock(node_lock); 
+        FieldMask freed;
         for (std::vector<FieldID>::const_iterator it = to_free.begin();
               it != to_free.end(); it++)
         {
           std::map<FieldID,FieldInfo>::iterator finder = fields.find(*it);
           finder->second.destroyed = true;  
           if (is_owner())
-            free_index(finder->second.idx);
+            freed.set_bit(finder->second.idx);
         }
+        // Release all the indexes together so we only have to walk
+        // the layout descriptions once for the whole batch
+        if (!!freed)
+          free_indexes(freed);
         if (is_owner() && !!remote_instances)
         {
           FindTargetsFunctor functor(targets);
@@ -8742,24 +8924,25 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void FieldSpaceNode::free_index(unsigned index)
+    void FieldSpaceNode::free_indexes(const FieldMask &indexes)
     //--------------------------------------------------------------------------
     {
 #ifdef DEBUG_LEGION
       assert(is_owner());
-      assert(!available_indexes.is_set(index));
+      assert(available_indexes * indexes);
 #endif
       // Assume we are already holding the node lock
-      available_indexes.set_bit(index);
+      available_indexes |= indexes;
       // We also need to invalidate all our layout descriptions
-      // that contain this field
+      // that contain any of these fields
+      const LEGION_FIELD_MASK_FIELD_TYPE hash_key = indexes.get_hash_key();
       std::vector<LEGION_FIELD_MASK_FIELD_TYPE> to_delete;
       for (std::map<LEGION_FIELD_MASK_FIELD_TYPE,LegionList<LayoutDescription*,
                   LAYOUT_DESCRIPTION_ALLOC>::tracked>::iterator lit = 
             layouts.begin(); lit != layouts.end(); lit++)
       {
-        // If the bit is set, remove the layout descriptions
-        if (lit->first & (1ULL << index))
+        // If any of the bits are set, remove the layout descriptions
+        if (lit->first & hash_key)
         {
           LegionList<LayoutDescription*,LAYOUT_DESCRIPTION_ALLOC>::tracked
             &descs = lit->second;
@@ -8768,7 +8951,7 @@ namespace Legion {
                 tracked::iterator it = descs.begin(); 
                 it != descs.end(); /*nothing*/)
           {
-            if ((*it)->allocated_fields.is_set(index))
+            if (!((*it)->allocated_fields * indexes))
             {
               if ((*it)->remove_reference())
                 delete (*it);
@@ -9477,7 +9660,7 @@ namespace Legion {
       // operation has_dependences on 
       open->begin_dependence_analysis();
       LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned &above_users =
-        creator.op->get_logical_records();
+        creator.op->get_logical_records(creator.idx);
       perform_dependence_checks<LOGICAL_REC_ALLOC,
             false/*record*/, false/*has skip*/, false/*track dom*/>(
                 open_user, above_users, open_mask, 
@@ -9513,7 +9696,7 @@ namespace Legion {
       // Perform analysis against everything the creating operation had
       // dependences on as well
       LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned &above_users = 
-        creator.op->get_logical_records();
+        creator.op->get_logical_records(creator.idx);
       if (!above_users.empty())
         perform_dependence_checks<LOGICAL_REC_ALLOC,
           false/*record*/, false/*has skip*/, false/*track dom*/>(
@@ -9525,7 +9708,7 @@ namespace Legion {
       // region requirements as we will only issue one advance per
       // field for a given region requirement
       LegionList<LogicalUser,LOGICAL_REC_ALLOC>::track_aligned &above_advances =
-        creator.op->get_logical_advances();
+        creator.op->get_logical_advances(creator.idx);
       if (!above_advances.empty())
         perform_dependence_checks<LOGICAL_REC_ALLOC,
           false/*record*/, false/*has skip*/, false/*track dom*/>(
@@ -10278,9 +10461,14 @@ namespace Legion {
             {
               // Can only avoid a close operation if we have the 
               // same projection function with the same or smaller
-              // size domain as the original index space launch
-              if ((it->projection == proj_info.projection) &&
-                  it->projection_domain_dominates(proj_info.projection_space)) 
+              // size domain as the original index space launch, or
+              // if we can prove with affine projections that we only
+              // touch children that the original launch touched
+              const bool same_projection = 
+                (it->projection == proj_info.projection) &&
+                it->projection_domain_dominates(proj_info.projection_space);
+              if (same_projection || proj_info.is_image_contained(
+                                    it->projection, it->projection_space))
               {
                 // If we're a reduction we have to go into a dirty 
                 // reduction mode since we know we're already open below
@@ -10303,8 +10491,11 @@ namespace Legion {
                 }
                 else
                 {
-                  // Update the domain  
-                  it->projection_space = proj_info.projection_space;
+                  // Update the domain if it is still the same projection,
+                  // otherwise the original launch still describes the
+                  // superset of children that are open
+                  if (same_projection)
+                    it->projection_space = proj_info.projection_space;
                   open_below |= (it->valid_fields & current_mask);
                   it++;
                 }
@@ -12384,7 +12575,10 @@ namespace Legion {
       // identical event preconditions. Use a list so our
       // iterators remain valid under insertion and push back
       LegionList<EventSet>::aligned precondition_sets;
-      compute_event_sets(update_mask, preconditions, precondition_sets);
+      const unsigned coalesced = 
+        compute_event_sets(update_mask, preconditions, precondition_sets);
+      if (Runtime::copy_statistics)
+        context->record_copy_statistics(0/*issued*/, coalesced);
       // Now that we have our precondition sets, it's time
       // to issue the distinct copies to the low-level runtime
       // Issue a copy for each of the different precondition sets
@@ -12439,7 +12633,8 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    /*static*/ void RegionTreeNode::compute_event_sets(FieldMask update_mask, 
+    /*static*/ unsigned RegionTreeNode::compute_event_sets(
+                                                    FieldMask update_mask, 
                     const LegionMap<ApEvent,FieldMask>::aligned &preconditions,
                     LegionList<EventSet>::aligned &precondition_sets)
     //--------------------------------------------------------------------------
@@ -12515,6 +12710,34 @@ namespace Legion {
       // no preconditions so it can start right away!
       if (!!update_mask)
         precondition_sets.push_front(EventSet(update_mask));
+      // Sets can still end up waiting on the same events after ignoring
+      // the ones that do not exist, so fold any such sets together
+      // since they can share the same copy (or fill) with more fields
+      unsigned coalesced = 0;
+      if (precondition_sets.size() > 1)
+      {
+        for (LegionList<EventSet>::aligned::iterator it = 
+              precondition_sets.begin(); it != precondition_sets.end(); it++)
+          it->preconditions.erase(ApEvent::NO_AP_EVENT);
+        for (LegionList<EventSet>::aligned::iterator it1 = 
+              precondition_sets.begin(); it1 != precondition_sets.end(); it1++)
+        {
+          LegionList<EventSet>::aligned::iterator it2 = it1;
+          it2++;
+          while (it2 != precondition_sets.end())
+          {
+            if (it2->preconditions == it1->preconditions)
+            {
+              it1->set_mask |= it2->set_mask;
+              it2 = precondition_sets.erase(it2);
+              coalesced++;
+            }
+            else
+              it2++;
+          }
+        }
+      }
+      return coalesced;
     }
 
     //--------------------------------------------------------------------------
@@ -13244,7 +13467,7 @@ namespace Legion {
                     it->uid, it->idx, user.uid, user.idx, dtype);
 #endif
                 if (RECORD)
-                  user.op->record_logical_dependence(*it);
+                  user.op->record_logical_dependence(user.idx, *it);
                 // Do this after the logging since we might 
                 // update the iterator.
                 // If we can validate a region record which of our
@@ -13852,6 +14075,8 @@ namespace Legion {
           precondition, predicate_guard, 
           (intersect == NULL) ? NULL : intersect->get_row_source(),
           redop, reduction_fold);
+      if (Runtime::copy_statistics)
+        context->record_copy_statistics(1/*issued*/, 0/*coalesced*/);
 #ifdef LEGION_SPY
       LegionSpy::log_copy_events(op->get_unique_op_id(), handle, 
                                  precondition, result);
@@ -38,6 +38,28 @@ namespace Legion {
       PhysicalInstance inst;
       size_t field_offset;
     };
+
+    /**
+     * \struct RegionTreeHandleHash
+     * Hash functions for the handles used to look up region tree nodes
+     */
+    struct RegionTreeHandleHash {
+    public:
+      inline size_t operator()(const IndexSpace &handle) const
+        { return handle.get_id(); }
+      inline size_t operator()(const IndexPartition &handle) const
+        { return handle.get_id(); }
+      inline size_t operator()(const FieldSpace &handle) const
+        { return handle.get_id(); }
+      inline size_t operator()(const LogicalRegion &handle) const
+        { return (size_t(handle.get_index_space().get_id()) ^
+                  (size_t(handle.get_field_space().get_id()) << 20) ^
+                  (size_t(handle.get_tree_id()) << 40)); }
+      inline size_t operator()(const LogicalPartition &handle) const
+        { return (size_t(handle.get_index_partition().get_id()) ^
+                  (size_t(handle.get_field_space().get_id()) << 20) ^
+                  (size_t(handle.get_tree_id()) << 40)); }
+    };
     
     /**
      * \class RegionTreeForest
@@ -70,6 +92,18 @@ namespace Legion {
         IndexPartition handle;
         RtUserEvent ready;
       };   
+      struct LogicalAnalysisArgs : public LgTaskArgs<LogicalAnalysisArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_LOGICAL_ANALYSIS_TASK_ID;
+      public:
+        Operation *op;
+        const std::vector<unsigned> *indexes;
+        std::vector<RegionRequirement> *regions;
+        std::vector<RestrictInfo> *restrict_infos;
+        std::vector<VersionInfo> *version_infos;
+        std::vector<ProjectionInfo> *projection_infos;
+        std::vector<RegionTreePath> *privilege_paths;
+      };
     public:
       RegionTreeForest(Runtime *rt);
       RegionTreeForest(const RegionTreeForest &rhs);
@@ -154,6 +188,11 @@ namespace Legion {
                                                  IndexPartition projection,
                     const std::vector<FieldDataDescriptor> &instances,
                                                  ApEvent instances_ready);
+      // Give a pending partition the same subspaces as another
+      // partition with the same parent and color space
+      ApEvent create_partition_by_copy(Operation *op,
+                                       IndexPartition pending,
+                                       IndexPartition source);
       ApEvent create_association(Operation *op, 
                                  IndexSpace domain, IndexSpace range,
                     const std::vector<FieldDataDescriptor> &instances,
@@ -283,6 +322,24 @@ namespace Legion {
                                        VersionInfo &version_info,
                                        ProjectionInfo &projection_info,
                                        RegionTreePath &path);
+      // Perform the logical analysis for all the region requirements of
+      // an operation, requirements in different region trees touch 
+      // disjoint logical state so they can be analyzed in parallel,
+      // if projection_infos is NULL none of the requirements project
+      void perform_dependence_analysis(Operation *op,
+                                  std::vector<RegionRequirement> &regions,
+                                  std::vector<RestrictInfo> &restrict_infos,
+                                  std::vector<VersionInfo> &version_infos,
+                                  std::vector<ProjectionInfo> *projection_infos,
+                                  std::vector<RegionTreePath> &paths);
+      void perform_dependence_analysis(Operation *op,
+                                  const std::vector<unsigned> &indexes,
+                                  std::vector<RegionRequirement> &regions,
+                                  std::vector<RestrictInfo> &restrict_infos,
+                                  std::vector<VersionInfo> &version_infos,
+                                  std::vector<ProjectionInfo> *projection_infos,
+                                  std::vector<RegionTreePath> &paths);
+      static void handle_logical_analysis(const void *args);
       void perform_fence_analysis(RegionTreeContext ctx, Operation *fence,
                                   LogicalRegion handle, bool dominate);
       void perform_deletion_analysis(DeletionOp *op, unsigned idx,
@@ -376,6 +433,13 @@ namespace Legion {
                                  , UniqueID uid
 #endif
                                  );
+      // For when the targets are known to already be valid
+      void physical_register_valid(const RegionRequirement &req,
+                                   VersionInfo &version_info,
+                                   Operation *op, unsigned index,
+                                   ApEvent term_event,
+                                   std::set<RtEvent> &map_applied,
+                                   InstanceSet &targets);
       // For when we deferred registration of users
       void physical_register_users(Operation *op, ApEvent term_event,
                    const std::vector<RegionRequirement> &regions,
@@ -626,18 +690,30 @@ namespace Legion {
       bool retrieve_semantic_information(LogicalPartition part, SemanticTag tag,
                                          const void *&result, size_t &size,
                                          bool can_fail, bool wait_until);
+    public:
+      void record_copy_statistics(unsigned issued, unsigned coalesced);
     public:
       Runtime *const runtime;
     protected:
       Reservation lookup_lock;
+    protected:
+      // Realm copies issued and copies that were merged into
+      // other copies instead of being issued with -lg:copy_stats
+      size_t copies_issued, copies_coalesced;
     private:
-      // The lookup lock must be held when accessing these
-      // data structures
-      std::map<IndexSpace,IndexSpaceNode*>     index_nodes;
-      std::map<IndexPartition,IndexPartNode*>  index_parts;
-      std::map<FieldSpace,FieldSpaceNode*>     field_nodes;
-      std::map<LogicalRegion,RegionNode*>     region_nodes;
-      std::map<LogicalPartition,PartitionNode*> part_nodes;
+      // The node tables can be read without any locks, but the lookup
+      // lock must be held exclusively when modifying them
+      ConcurrentLookupTable<IndexSpace,IndexSpaceNode*,
+                            RegionTreeHandleHash>         index_nodes;
+      ConcurrentLookupTable<IndexPartition,IndexPartNode*,
+                            RegionTreeHandleHash>         index_parts;
+      ConcurrentLookupTable<FieldSpace,FieldSpaceNode*,
+                            RegionTreeHandleHash>         field_nodes;
+      ConcurrentLookupTable<LogicalRegion,RegionNode*,
+                            RegionTreeHandleHash>         region_nodes;
+      ConcurrentLookupTable<LogicalPartition,PartitionNode*,
+                            RegionTreeHandleHash>         part_nodes;
+      // The lookup lock must be held when accessing this
       std::map<RegionTreeID,RegionNode*>        tree_nodes;
     private:
       // pending events for requested nodes
@@ -845,6 +921,7 @@ namespace Legion {
                               IndexPartition handle, bool is_union) = 0;
       virtual ApEvent compute_pending_difference(Operation *op, 
           IndexSpace initial, const std::vector<IndexSpace> &handles) = 0;
+      virtual ApEvent copy_realm_index_space(IndexSpaceNode *source) = 0;
       virtual void get_index_space_domain(void *realm_is, TypeTag type_tag) = 0;
       virtual size_t get_volume(void) = 0;
       virtual size_t get_num_dims(void) const = 0;
@@ -1022,6 +1099,19 @@ namespace Legion {
     public:
       virtual void log_index_space_points(void);
       void log_index_space_points(const Realm::IndexSpace<DIM,T> &space) const;
+    public:
+      // Compute set operations inline when all the inputs are dense, 
+      // these return false if the result would not be a dense space
+      static bool compute_dense_union(
+          const std::vector<Realm::IndexSpace<DIM,T> > &spaces,
+          Realm::IndexSpace<DIM,T> &result);
+      static bool compute_dense_intersection(
+          const std::vector<Realm::IndexSpace<DIM,T> > &spaces,
+          Realm::IndexSpace<DIM,T> &result);
+      static bool compute_dense_difference(
+          const Realm::IndexSpace<DIM,T> &lhs,
+          const Realm::IndexSpace<DIM,T> &rhs,
+          Realm::IndexSpace<DIM,T> &result);
     public:
       virtual ApEvent compute_pending_space(Operation *op,
             const std::vector<IndexSpace> &handles, bool is_union);
@@ -1029,6 +1119,7 @@ namespace Legion {
                              IndexPartition handle, bool is_union);
       virtual ApEvent compute_pending_difference(Operation *op,
           IndexSpace initial, const std::vector<IndexSpace> &handles);
+      virtual ApEvent copy_realm_index_space(IndexSpaceNode *source);
       virtual void get_index_space_domain(void *realm_is, TypeTag type_tag);
       virtual size_t get_volume(void);
       virtual size_t get_num_dims(void) const;
@@ -1854,7 +1945,7 @@ namespace Legion {
       // Assume we are already holding the node lock
       // when calling these methods
       int allocate_index(void);
-      void free_index(unsigned index);
+      void free_indexes(const FieldMask &indexes);
     protected:
       bool allocate_local_indexes(
             const std::vector<size_t> &sizes,
@@ -2155,7 +2246,9 @@ namespace Legion {
                       LegionMap<ApEvent,FieldMask>::aligned &postconditions,
                                 CopyAcrossHelper *across_helper = NULL,
                                 RegionTreeNode *intersect = NULL);
-      static void compute_event_sets(FieldMask update_mask,
+      // Returns the number of sets that were folded into others
+      // because they ended up with the same preconditions
+      static unsigned compute_event_sets(FieldMask update_mask,
           const LegionMap<ApEvent,FieldMask>::aligned &preconditions,
           LegionList<EventSet>::aligned &event_sets);
       void issue_update_reductions(LogicalView *target,
@@ -189,6 +189,126 @@ namespace Legion {
       old_space.destroy();
     }
 
+    //--------------------------------------------------------------------------
+    template<int DIM, typename T>
+    /*static*/ bool IndexSpaceNodeT<DIM,T>::compute_dense_union(
+                           const std::vector<Realm::IndexSpace<DIM,T> > &spaces,
+                           Realm::IndexSpace<DIM,T> &result)
+    //--------------------------------------------------------------------------
+    {
+      Realm::Rect<DIM,T> bounds = Realm::Rect<DIM,T>::make_empty();
+      for (typename std::vector<Realm::IndexSpace<DIM,T> >::const_iterator 
+            it = spaces.begin(); it != spaces.end(); it++)
+      {
+        if (!it->dense())
+          return false;
+        const Realm::Rect<DIM,T> &next = it->bounds;
+        if (next.empty() || bounds.contains(next))
+          continue;
+        if (bounds.empty() || next.contains(bounds))
+        {
+          bounds = next;
+          continue;
+        }
+        // The union of two rectangles is only a rectangle if they
+        // match in all but one dimension and they overlap or abut
+        // each other in that dimension
+        int diff_dim = -1;
+        for (int d = 0; d < DIM; d++)
+        {
+          if ((bounds.lo[d] == next.lo[d]) && (bounds.hi[d] == next.hi[d]))
+            continue;
+          if (diff_dim >= 0)
+            return false;
+          diff_dim = d;
+        }
+#ifdef DEBUG_LEGION
+        assert(diff_dim >= 0);
+#endif
+        if ((bounds.hi[diff_dim] < next.lo[diff_dim]) &&
+            ((bounds.hi[diff_dim] + 1) != next.lo[diff_dim]))
+          return false;
+        if ((next.hi[diff_dim] < bounds.lo[diff_dim]) &&
+            ((next.hi[diff_dim] + 1) != bounds.lo[diff_dim]))
+          return false;
+        bounds = bounds.union_bbox(next);
+      }
+      result = Realm::IndexSpace<DIM,T>(bounds);
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    template<int DIM, typename T>
+    /*static*/ bool IndexSpaceNodeT<DIM,T>::compute_dense_intersection(
+                           const std::vector<Realm::IndexSpace<DIM,T> > &spaces,
+                           Realm::IndexSpace<DIM,T> &result)
+    //--------------------------------------------------------------------------
+    {
+      if (spaces.empty())
+      {
+        result = Realm::IndexSpace<DIM,T>::make_empty();
+        return true;
+      }
+      Realm::Rect<DIM,T> bounds = spaces.front().bounds;
+      for (typename std::vector<Realm::IndexSpace<DIM,T> >::const_iterator 
+            it = spaces.begin(); it != spaces.end(); it++)
+      {
+        if (!it->dense())
+          return false;
+        bounds = bounds.intersection(it->bounds);
+      }
+      result = Realm::IndexSpace<DIM,T>(bounds);
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    template<int DIM, typename T>
+    /*static*/ bool IndexSpaceNodeT<DIM,T>::compute_dense_difference(
+                                          const Realm::IndexSpace<DIM,T> &lhs,
+                                          const Realm::IndexSpace<DIM,T> &rhs,
+                                          Realm::IndexSpace<DIM,T> &result)
+    //--------------------------------------------------------------------------
+    {
+      if (!lhs.dense() || !rhs.dense())
+        return false;
+      const Realm::Rect<DIM,T> overlap = lhs.bounds.intersection(rhs.bounds);
+      if (overlap.empty())
+      {
+        result = lhs;
+        return true;
+      }
+      if (rhs.bounds.contains(lhs.bounds))
+      {
+        result = Realm::IndexSpace<DIM,T>::make_empty();
+        return true;
+      }
+      // The difference is only a rectangle if the right-hand side 
+      // covers the left-hand side in all but one dimension and it
+      // covers one of the ends of the left-hand side in that dimension
+      int diff_dim = -1;
+      for (int d = 0; d < DIM; d++)
+      {
+        if ((overlap.lo[d] == lhs.bounds.lo[d]) &&
+            (overlap.hi[d] == lhs.bounds.hi[d]))
+          continue;
+        if (diff_dim >= 0)
+          return false;
+        diff_dim = d;
+      }
+#ifdef DEBUG_LEGION
+      assert(diff_dim >= 0);
+#endif
+      Realm::Rect<DIM,T> bounds = lhs.bounds;
+      if (overlap.lo[diff_dim] == lhs.bounds.lo[diff_dim])
+        bounds.lo[diff_dim] = overlap.hi[diff_dim] + 1;
+      else if (overlap.hi[diff_dim] == lhs.bounds.hi[diff_dim])
+        bounds.hi[diff_dim] = overlap.lo[diff_dim] - 1;
+      else
+        return false;
+      result = Realm::IndexSpace<DIM,T>(bounds);
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     template<int DIM, typename T>
     void IndexSpaceNodeT<DIM,T>::initialize_union_space(ApUserEvent to_trigger,
@@ -211,13 +331,20 @@ namespace Legion {
         if (ready.exists())
           preconditions.insert(ready);
       }
-      // Kick this off to Realm
       ApEvent precondition = Runtime::merge_events(preconditions);
+      Realm::IndexSpace<DIM,T> result_space;
+      // If everything is dense we can probably do this ourselves
+      if (compute_dense_union(spaces, result_space))
+      {
+        set_realm_index_space(context->runtime->address_space, result_space);
+        Runtime::trigger_event(to_trigger, precondition);
+        return;
+      }
+      // Kick this off to Realm
       Realm::ProfilingRequestSet requests;
       if (context->runtime->profiler != NULL)
         context->runtime->profiler->add_partition_request(requests,
                                       op, DEP_PART_UNION_REDUCTION);
-      Realm::IndexSpace<DIM,T> result_space;
       ApEvent done(Realm::IndexSpace<DIM,T>::compute_union(
             spaces, result_space, requests, precondition));
       set_realm_index_space(context->runtime->address_space, result_space);
@@ -246,13 +373,20 @@ namespace Legion {
         if (ready.exists())
           preconditions.insert(ready);
       }
-      // Kick this off to Realm
       ApEvent precondition = Runtime::merge_events(preconditions);
+      Realm::IndexSpace<DIM,T> result_space;
+      // If everything is dense we can do this ourselves
+      if (compute_dense_intersection(spaces, result_space))
+      {
+        set_realm_index_space(context->runtime->address_space, result_space);
+        Runtime::trigger_event(to_trigger, precondition);
+        return;
+      }
+      // Kick this off to Realm
       Realm::ProfilingRequestSet requests;
       if (context->runtime->profiler != NULL)
         context->runtime->profiler->add_partition_request(requests,
                                       op, DEP_PART_INTERSECTION_REDUCTION);
-      Realm::IndexSpace<DIM,T> result_space;
       ApEvent done(Realm::IndexSpace<DIM,T>::compute_intersection(
             spaces, result_space, requests, precondition));
       set_realm_index_space(context->runtime->address_space, result_space);
@@ -279,11 +413,18 @@ namespace Legion {
       ApEvent right_ready = right_node->get_realm_index_space(right_space, 
                                                               false);
       ApEvent precondition = Runtime::merge_events(left_ready, right_ready);
+      Realm::IndexSpace<DIM,T> result_space;
+      // If both are dense we can probably do this ourselves
+      if (compute_dense_difference(left_space, right_space, result_space))
+      {
+        set_realm_index_space(context->runtime->address_space, result_space);
+        Runtime::trigger_event(to_trigger, precondition);
+        return;
+      }
       Realm::ProfilingRequestSet requests;
       if (context->runtime->profiler != NULL)
         context->runtime->profiler->add_partition_request(requests,
                                           op, DEP_PART_DIFFERENCE);
-      Realm::IndexSpace<DIM,T> result_space;
       ApEvent done(Realm::IndexSpace<DIM,T>::compute_difference(
            left_space, right_space, result_space, requests, precondition));
       set_realm_index_space(context->runtime->address_space, result_space);
@@ -358,9 +499,16 @@ namespace Legion {
       }
       if (op->has_execution_fence_event())
         preconditions.insert(op->get_execution_fence_event());
-      // Kick this off to Realm
       ApEvent precondition = Runtime::merge_events(preconditions);
       Realm::IndexSpace<DIM,T> result_space;
+      // See if we can do this ourselves because everything is dense
+      if (is_union ? compute_dense_union(spaces, result_space) :
+                     compute_dense_intersection(spaces, result_space))
+      {
+        set_realm_index_space(context->runtime->address_space, result_space);
+        return precondition;
+      }
+      // Kick this off to Realm
       if (is_union)
       {
         Realm::ProfilingRequestSet requests;
@@ -440,9 +588,16 @@ namespace Legion {
       }
       if (op->has_execution_fence_event())
         preconditions.insert(op->get_execution_fence_event());
-      // Kick this off to Realm
       ApEvent precondition = Runtime::merge_events(preconditions);
       Realm::IndexSpace<DIM,T> result_space;
+      // See if we can do this ourselves because everything is dense
+      if (is_union ? compute_dense_union(spaces, result_space) :
+                     compute_dense_intersection(spaces, result_space))
+      {
+        set_realm_index_space(context->runtime->address_space, result_space);
+        return precondition;
+      }
+      // Kick this off to Realm
       if (is_union)
       {
         Realm::ProfilingRequestSet requests;
@@ -506,6 +661,20 @@ namespace Legion {
       if (op->has_execution_fence_event())
         preconditions.insert(op->get_execution_fence_event());
       ApEvent precondition = Runtime::merge_events(preconditions);
+      IndexSpaceNodeT<DIM,T> *lhs_node = 
+        static_cast<IndexSpaceNodeT<DIM,T>*>(context->get_node(init));
+      Realm::IndexSpace<DIM,T> lhs_space, result_space;
+      ApEvent lhs_ready = lhs_node->get_realm_index_space(lhs_space, false);
+      // See if we can do this ourselves because everything is dense
+      {
+        Realm::IndexSpace<DIM,T> rhs_space;
+        if (compute_dense_union(spaces, rhs_space) &&
+            compute_dense_difference(lhs_space, rhs_space, result_space))
+        {
+          set_realm_index_space(context->runtime->address_space,result_space);
+          return Runtime::merge_events(lhs_ready, precondition);
+        }
+      }
       Realm::ProfilingRequestSet union_requests;
       Realm::ProfilingRequestSet diff_requests;
       if (context->runtime->profiler != NULL)
@@ -519,10 +688,6 @@ namespace Legion {
       Realm::IndexSpace<DIM,T> rhs_space;
       ApEvent rhs_ready(Realm::IndexSpace<DIM,T>::compute_union(
             spaces, rhs_space, union_requests, precondition));
-      IndexSpaceNodeT<DIM,T> *lhs_node = 
-        static_cast<IndexSpaceNodeT<DIM,T>*>(context->get_node(init));
-      Realm::IndexSpace<DIM,T> lhs_space, result_space;
-      ApEvent lhs_ready = lhs_node->get_realm_index_space(lhs_space, false);
       ApEvent result(Realm::IndexSpace<DIM,T>::compute_difference(
             lhs_space, rhs_space, result_space, diff_requests,
             Runtime::merge_events(lhs_ready, rhs_ready)));
@@ -532,6 +697,24 @@ namespace Legion {
       return result;
     } 
 
+    //--------------------------------------------------------------------------
+    template<int DIM, typename T>
+    ApEvent IndexSpaceNodeT<DIM,T>::copy_realm_index_space(
+                                                       IndexSpaceNode *source)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(source->handle.get_type_tag() == handle.get_type_tag());
+#endif
+      IndexSpaceNodeT<DIM,T> *src_node = 
+        static_cast<IndexSpaceNodeT<DIM,T>*>(source);
+      // Realm index spaces are just names so we can share them
+      Realm::IndexSpace<DIM,T> value;
+      ApEvent ready = src_node->get_realm_index_space(value, false/*tight*/);
+      set_realm_index_space(context->runtime->address_space, value);
+      return ready;
+    }
+
     //--------------------------------------------------------------------------
     template<int DIM, typename T>
     void IndexSpaceNodeT<DIM,T>::get_index_space_domain(void *realm_is, 
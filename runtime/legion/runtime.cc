@@ -73,6 +73,16 @@ namespace Legion {
     __thread TaskContext *implicit_context = NULL;
 #endif
 
+    // Per-thread caches of distributed IDs so that the common case of
+    // getting and freeing a distributed ID never needs to take the
+    // distributed ID lock. The owner makes sure that we never mix IDs
+    // from different runtime instances when they are separate.
+    static __thread Runtime *local_did_owner = NULL;
+    static __thread DistributedID local_did_next = 0;
+    static __thread DistributedID local_did_limit = 0;
+    static __thread unsigned local_did_count = 0;
+    static __thread DistributedID local_dids[LEGION_DISTRIBUTED_ID_CACHE];
+
     /////////////////////////////////////////////////////////////
     // Argument Map Impl
     /////////////////////////////////////////////////////////////
@@ -147,6 +157,12 @@ namespace Legion {
         // If it already exists and we're not replacing it then we're done
         if (!replace)
           return;
+        // Applications often set every point again before each launch
+        // with the same values, in which case nothing has changed and
+        // we can keep the frozen future map so launches continue to
+        // share it and remote nodes keep their cached copy of it
+        if (same_argument(finder->second, arg))
+          return;
         if (arg.get_size() > 0)
           finder->second = 
             Future::from_untyped_pointer(runtime->external,
@@ -209,6 +225,24 @@ namespace Legion {
                           finder->second.impl->get_untyped_size());
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ bool ArgumentMapImpl::same_argument(const Future &current,
+                                                   const TaskArgument &arg)
+    //--------------------------------------------------------------------------
+    {
+      if (current.impl == NULL)
+        return (arg.get_size() == 0);
+      // Don't wait for futures that came from a future map 
+      if (!current.impl->get_ready_event().has_triggered())
+        return false;
+      if (current.impl->is_empty(false/*block*/))
+        return false;
+      if (current.impl->get_untyped_size() != arg.get_size())
+        return false;
+      return (memcmp(current.impl->get_untyped_result(), 
+                     arg.get_ptr(), arg.get_size()) == 0);
+    }
+
     //--------------------------------------------------------------------------
     FutureMapImpl* ArgumentMapImpl::freeze(TaskContext *ctx)
     //--------------------------------------------------------------------------
@@ -292,12 +326,7 @@ namespace Legion {
       // don't want to leak events
       if (!ready_event.has_triggered())
         Runtime::trigger_event(ready_event);
-      if (result != NULL)
-      {
-        free(result);
-        result = NULL;
-        result_size = 0;
-      }
+      free_result();
       if (producer_op != NULL)
         producer_op->remove_mapping_reference(op_gen);
     }
@@ -438,9 +467,18 @@ namespace Legion {
       assert(is_owner());
 #endif
       // Clean out any previous results we've save
-      if (result != NULL)
-        free(result);
-      if (own)
+      free_result();
+      if (arglen <= LEGION_FUTURE_INLINE_SIZE)
+      {
+        // Small values are copied into the future itself
+        result_size = arglen;
+        result = inline_result.bytes;
+        if (arglen > 0)
+          memcpy(result,args,result_size);
+        if (own)
+          free(const_cast<void*>(args));
+      }
+      else if (own)
       {
         result = const_cast<void*>(args);
         result_size = arglen;
@@ -454,6 +492,16 @@ namespace Legion {
       empty = false; 
     }
 
+    //--------------------------------------------------------------------------
+    void FutureImpl::free_result(void)
+    //--------------------------------------------------------------------------
+    {
+      if ((result != NULL) && (result != inline_result.bytes))
+        free(result);
+      result = NULL;
+      result_size = 0;
+    }
+
     //--------------------------------------------------------------------------
     void FutureImpl::unpack_future(Deserializer &derez)
     //-------------------------------------------------------------------------
@@ -466,7 +514,8 @@ namespace Legion {
       // result once from another remote node and once
       // from the original owner
       if (result == NULL)
-        result = malloc(result_size);
+        result = (result_size <= LEGION_FUTURE_INLINE_SIZE) ? 
+          inline_result.bytes : malloc(result_size);
       if (!ready_event.has_triggered())
       {
         derez.deserialize(result,result_size);
@@ -513,6 +562,22 @@ namespace Legion {
       return false; 
     }
 
+    //--------------------------------------------------------------------------
+    void FutureImpl::pack_future(Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      // Futures made on the owner node are only registered with the
+      // runtime once their name escapes to another node, so purely
+      // local futures never touch the distributed collectable table
+      if (!registered_with_runtime)
+      {
+        AutoLock gc(gc_lock);
+        if (!registered_with_runtime)
+          register_with_runtime(NULL/*no remote registration*/);
+      }
+      rez.serialize(did);
+    }
+
     //--------------------------------------------------------------------------
     void FutureImpl::notify_active(ReferenceMutator *mutator)
     //--------------------------------------------------------------------------
@@ -736,7 +801,8 @@ namespace Legion {
       : DistributedCollectable(rt, 
           LEGION_DISTRIBUTED_HELP_ENCODE(did, FUTURE_MAP_DC),  owner_space), 
         context(ctx), op(o), op_gen(o->get_generation()),
-        ready_event(o->get_completion_event()), valid(true)
+        ready_event(o->get_completion_event()), valid(true),
+        has_all_futures(false)
     //--------------------------------------------------------------------------
     {
 #ifdef LEGION_GC
@@ -753,7 +819,8 @@ namespace Legion {
           LEGION_DISTRIBUTED_HELP_ENCODE(did, FUTURE_MAP_DC), 
           owner_space, register_now), 
         context(ctx), op(NULL), op_gen(0),
-        ready_event(ApEvent::NO_AP_EVENT), valid(!is_owner())
+        ready_event(ApEvent::NO_AP_EVENT), valid(!is_owner()),
+        has_all_futures(false)
     //--------------------------------------------------------------------------
     {
 #ifdef LEGION_GC
@@ -765,7 +832,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     FutureMapImpl::FutureMapImpl(const FutureMapImpl &rhs)
       : DistributedCollectable(rhs), context(NULL), op(NULL), 
-        op_gen(0), valid(false)
+        op_gen(0), valid(false), has_all_futures(false)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -837,6 +904,9 @@ namespace Legion {
                                                 futures.find(point);
           if (finder != futures.end())
             return finder->second;
+          // If we pulled down the whole map then the point is empty
+          if (has_all_futures && allow_empty)
+            return Future();
         }
         // Make an event for when we have the answer
         RtUserEvent ready_event = Runtime::create_rt_user_event();
@@ -948,9 +1018,24 @@ namespace Legion {
     void FutureMapImpl::wait_all_results(bool silence_warnings)
     //--------------------------------------------------------------------------
     {
-#ifdef DEBUG_LEGION
-      assert(is_owner());
-#endif
+      if (!is_owner())
+      {
+        // Pull down the names of all the futures in one message
+        // and then wait on each of them locally
+        request_all_futures();
+        std::vector<Future> to_wait;
+        {
+          AutoLock g_lock(gc_lock,1,false/*exclusive*/);
+          to_wait.reserve(futures.size());
+          for (std::map<DomainPoint,Future>::const_iterator it = 
+                futures.begin(); it != futures.end(); it++)
+            to_wait.push_back(it->second);
+        }
+        for (std::vector<Future>::const_iterator it = 
+              to_wait.begin(); it != to_wait.end(); it++)
+          it->impl->get_void_result(silence_warnings);
+        return;
+      }
       if (Runtime::runtime_warnings && !silence_warnings && 
           (context != NULL) && !context->is_leaf_context())
         REPORT_LEGION_WARNING(LEGION_WARNING_WAITING_ALL_FUTURES, 
@@ -1109,7 +1194,7 @@ namespace Legion {
         RezCheck z2(rez);
         rez.serialize(did);
         rez.serialize(point);
-        rez.serialize(f.impl->did);
+        f.impl->pack_future(rez);
         rez.serialize(done);
       }
       runtime->send_future_map_response_future(source, rez);
@@ -1144,6 +1229,208 @@ namespace Legion {
         Runtime::trigger_event(done);
     }
 
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::request_all_futures(void)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(!is_owner());
+#endif
+      RtEvent wait_on;
+      bool send_request = false;
+      {
+        AutoLock g_lock(gc_lock);
+        if (has_all_futures)
+          return;
+        if (!all_futures_ready.exists())
+        {
+          all_futures_ready = Runtime::create_rt_user_event();
+          send_request = true;
+        }
+        wait_on = all_futures_ready;
+      }
+      if (send_request)
+      {
+        Serializer rez;
+        {
+          RezCheck z(rez);
+          rez.serialize(did);
+        }
+        runtime->send_future_map_request_all(get_gather_parent(), rez);
+      }
+      wait_on.lg_wait();
+    }
+
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::pack_all_futures(Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      // Caller makes sure the map is not changing anymore
+      rez.serialize<size_t>(futures.size());
+      for (std::map<DomainPoint,Future>::const_iterator it = 
+            futures.begin(); it != futures.end(); it++)
+      {
+        rez.serialize(it->first);
+        it->second.impl->pack_future(rez);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::unpack_all_futures(Deserializer &derez,
+                                           ReferenceMutator *mutator)
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(!is_owner());
+#endif
+      size_t num_futures;
+      derez.deserialize(num_futures);
+      std::vector<AddressSpaceID> to_send;
+      RtUserEvent to_trigger;
+      {
+        AutoLock g_lock(gc_lock);
+        for (unsigned idx = 0; idx < num_futures; idx++)
+        {
+          DomainPoint point;
+          derez.deserialize(point);
+          DistributedID future_did;
+          derez.deserialize(future_did);
+          if (futures.find(point) != futures.end())
+            continue;
+          FutureImpl *impl = runtime->find_or_create_future(future_did,mutator);
+          impl->add_base_gc_ref(FUTURE_HANDLE_REF, mutator);
+          futures[point] = Future(impl, false/*need reference*/);
+        }
+        has_all_futures = true;
+        to_trigger = all_futures_ready;
+        to_send.swap(all_futures_waiters);
+      }
+      // Forward the map on to any children waiting on us
+      for (std::vector<AddressSpaceID>::const_iterator it = 
+            to_send.begin(); it != to_send.end(); it++)
+        send_all_futures(*it);
+#ifdef DEBUG_LEGION
+      assert(to_trigger.exists());
+#endif
+      Runtime::trigger_event(to_trigger);
+    }
+
+    //--------------------------------------------------------------------------
+    void FutureMapImpl::send_all_futures(AddressSpaceID target)
+    //--------------------------------------------------------------------------
+    {
+      Serializer rez;
+      {
+        RezCheck z(rez);
+        rez.serialize(did);
+        if (is_owner())
+        {
+          // Wait for all the points to be filled in
+          if (valid && ready_event.exists() && !ready_event.has_triggered())
+            ready_event.lg_wait();
+          AutoLock g_lock(gc_lock,1,false/*exclusive*/);
+          pack_all_futures(rez);
+        }
+        else
+        {
+          AutoLock g_lock(gc_lock,1,false/*exclusive*/);
+#ifdef DEBUG_LEGION
+          assert(has_all_futures);
+#endif
+          pack_all_futures(rez);
+        }
+      }
+      runtime->send_future_map_response_all(target, rez);
+    }
+
+    //--------------------------------------------------------------------------
+    AddressSpaceID FutureMapImpl::get_gather_parent(void) const
+    //--------------------------------------------------------------------------
+    {
+#ifdef DEBUG_LEGION
+      assert(!is_owner());
+#endif
+      // Nodes form a radix tree relative to the owner so that the
+      // owner only ever sends the map to a handful of nodes
+      const AddressSpaceID total = runtime->total_address_spaces;
+      const AddressSpaceID relative = 
+        (local_space + total - owner_space) % total;
+      const AddressSpaceID parent = 
+        (relative - 1) / Runtime::legion_collective_radix;
+      return (owner_space + parent) % total;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void FutureMapImpl::handle_future_map_all_request(
+                   Deserializer &derez, Runtime *runtime, AddressSpaceID source)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      DistributedID did;
+      derez.deserialize(did);
+      std::set<RtEvent> done_events;
+      WrapperReferenceMutator mutator(done_events);
+      // Interior nodes of the tree may not have a copy yet
+      FutureMapImpl *impl = 
+        runtime->find_or_create_future_map(did, NULL, &mutator);
+      if (!done_events.empty())
+      {
+        RtEvent wait_on = Runtime::merge_events(done_events);
+        wait_on.lg_wait();
+      }
+      if (!impl->is_owner())
+      {
+        bool send_now = true;
+        bool send_request = false;
+        {
+          AutoLock g_lock(impl->gc_lock);
+          if (!impl->has_all_futures)
+          {
+            // We'll forward the map when it arrives from our parent
+            impl->all_futures_waiters.push_back(source);
+            send_now = false;
+            if (!impl->all_futures_ready.exists())
+            {
+              impl->all_futures_ready = Runtime::create_rt_user_event();
+              send_request = true;
+            }
+          }
+        }
+        if (send_request)
+        {
+          Serializer rez;
+          {
+            RezCheck z2(rez);
+            rez.serialize(did);
+          }
+          runtime->send_future_map_request_all(impl->get_gather_parent(), rez);
+        }
+        if (!send_now)
+          return;
+      }
+      impl->send_all_futures(source);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void FutureMapImpl::handle_future_map_all_response(
+                                          Deserializer &derez, Runtime *runtime)
+    //--------------------------------------------------------------------------
+    {
+      DerezCheck z(derez);
+      DistributedID did;
+      derez.deserialize(did);
+      // Should always find it since we or one of our children asked
+      FutureMapImpl *impl = runtime->find_or_create_future_map(did, NULL, NULL);
+      std::set<RtEvent> done_events;
+      WrapperReferenceMutator mutator(done_events);
+      impl->unpack_all_futures(derez, &mutator);
+      if (!done_events.empty())
+      {
+        RtEvent wait_on = Runtime::merge_events(done_events);
+        wait_on.lg_wait();
+      }
+    }
+
     /////////////////////////////////////////////////////////////
     // Physical Region Impl 
     /////////////////////////////////////////////////////////////
@@ -1439,6 +1726,14 @@ namespace Legion {
     {
       if (!mapped)
         return;
+      // Regions of leaf tasks without an unmap event have nothing to
+      // wait for since the task could only start once they were valid
+      if (leaf_region && !trigger_on_unmap && !wait_for_unmap.exists())
+      {
+        valid = false;
+        mapped = false;
+        return;
+      }
       wait_until_valid(true/*silence warnings*/);
       if (trigger_on_unmap)
       {
@@ -1498,6 +1793,7 @@ namespace Legion {
 #endif
       references.add_instance(ref);
       ref.add_valid_reference(PHYSICAL_REGION_REF);
+      mapped_versions.clear();
     }
 
     //--------------------------------------------------------------------------
@@ -1514,8 +1810,36 @@ namespace Legion {
       if (!references.empty())
         references.add_valid_references(PHYSICAL_REGION_REF);
       termination_event = term_event;
-      trigger_on_unmap = true;
+      // Leaf tasks don't make unmap events since nothing waits on them
+      trigger_on_unmap = term_event.exists();
       wait_for_unmap = wait_for;
+      mapped_versions.clear();
+    }
+
+    //--------------------------------------------------------------------------
+    void PhysicalRegionImpl::record_mapped_versions(
+                                                const FieldVersions &versions)
+    //--------------------------------------------------------------------------
+    {
+      mapped_versions = versions;
+    }
+
+    //--------------------------------------------------------------------------
+    bool PhysicalRegionImpl::has_mapped_versions(
+                                          const FieldVersions &versions) const
+    //--------------------------------------------------------------------------
+    {
+      if (mapped_versions.empty() || 
+          (mapped_versions.size() != versions.size()))
+        return false;
+      for (FieldVersions::const_iterator it = versions.begin();
+            it != versions.end(); it++)
+      {
+        FieldVersions::const_iterator finder = mapped_versions.find(it->first);
+        if ((finder == mapped_versions.end()) || (finder->second != it->second))
+          return false;
+      }
+      return true;
     }
 
     //--------------------------------------------------------------------------
@@ -2010,7 +2334,7 @@ namespace Legion {
       // Note we use the external wait to be sure 
       // we don't get drafted by the Realm runtime
       ApBarrier previous = Runtime::get_previous_phase(mpi_wait_barrier);
-      if (!previous.has_triggered())
+      if (!spin_until_triggered(previous))
       {
         // We can't call external wait directly on the barrier
         // right now, so as a work-around we'll make an event
@@ -2039,11 +2363,36 @@ namespace Legion {
       // Wait for Legion to be ready to run
       // No need to avoid being drafted by the
       // Realm runtime here
-      legion_wait_barrier.wait();
+      if (!spin_until_triggered(Runtime::get_previous_phase(
+                                  legion_wait_barrier)))
+        legion_wait_barrier.wait();
       // Now we can advance our wait barrier
       Runtime::advance_barrier(legion_wait_barrier);
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ bool MPILegionHandshakeImpl::spin_until_triggered(ApEvent event)
+    //--------------------------------------------------------------------------
+    {
+      if (event.has_triggered())
+        return true;
+      if (Runtime::handshake_spin_time == 0)
+        return false;
+      // Both sides of a handshake are in the same process so the other
+      // side's arrival triggers the barrier locally. Polling it for a
+      // little while is much faster than putting this thread to sleep
+      // and waiting for it to be woken back up when control switches
+      // back and forth quickly.
+      const long long deadline = Realm::Clock::current_time_in_microseconds()
+                                 + Runtime::handshake_spin_time;
+      do
+      {
+        if (event.has_triggered())
+          return true;
+      } while (Realm::Clock::current_time_in_microseconds() < deadline);
+      return false;
+    }
+
     //--------------------------------------------------------------------------
     PhaseBarrier MPILegionHandshakeImpl::get_legion_wait_phase_barrier(void)
     //--------------------------------------------------------------------------
@@ -2469,7 +2818,8 @@ namespace Legion {
       : runtime(rt), local_proc(proc), proc_kind(kind), 
         stealing_disabled(no_steal), replay_execution(replay), 
         next_local_index(0), task_scheduler_enabled(false), 
-        total_active_contexts(0)
+        task_scheduler_parked(false), scheduler_generation(0), 
+        ready_epoch(0), total_active_contexts(0)
     //--------------------------------------------------------------------------
     {
       this->local_queue_lock = Reservation::create_reservation();
@@ -2489,7 +2839,8 @@ namespace Legion {
       : runtime(NULL), local_proc(Processor::NO_PROC),
         proc_kind(Processor::LOC_PROC), stealing_disabled(false), 
         replay_execution(false), next_local_index(0),
-        task_scheduler_enabled(false), total_active_contexts(0)
+        task_scheduler_enabled(false), task_scheduler_parked(false),
+        scheduler_generation(0), ready_epoch(0), total_active_contexts(0)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -2500,6 +2851,9 @@ namespace Legion {
     ProcessorManager::~ProcessorManager(void)
     //--------------------------------------------------------------------------
     {
+      for (std::map<MapperID,ReadyQueue*>::const_iterator it = 
+            ready_queues.begin(); it != ready_queues.end(); it++)
+        delete it->second;
       ready_queues.clear();
       local_queue_lock.destroy_reservation();
       local_queue_lock = Reservation::NO_RESERVATION;
@@ -2525,6 +2879,8 @@ namespace Legion {
       for (std::map<MapperID,std::pair<MapperManager*,bool> >::iterator it = 
             mappers.begin(); it != mappers.end(); it++)
       {
+        if (Runtime::mapper_call_statistics)
+          it->second.first->report_call_statistics();
         if (it->second.second)
           delete it->second.first;
       }
@@ -2578,7 +2934,7 @@ namespace Legion {
       {
         mappers[mid] = std::pair<MapperManager*,bool>(m, own); 
         AutoLock q_lock(queue_lock);
-        ready_queues[mid] = std::list<TaskOp*>();
+        ready_queues[mid] = new ReadyQueue();
       }
     }
 
@@ -2641,31 +2997,65 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void ProcessorManager::perform_scheduling(void)
+    void ProcessorManager::perform_scheduling(unsigned generation)
     //--------------------------------------------------------------------------
     {
-      perform_mapping_operations(); 
+      unsigned long long start_epoch;
+      {
+        AutoLock q_lock(queue_lock);
+        // A parked scheduler can still be sitting in the queue after
+        // new work launched a fresh one, so stale schedulers do nothing
+        if (generation != scheduler_generation)
+          return;
+        task_scheduler_parked = false;
+        start_epoch = ready_epoch;
+      }
+      const bool progress = perform_mapping_operations(); 
       // Now re-take the lock and re-check the condition to see 
       // if the next scheduling task should be launched
       AutoLock q_lock(queue_lock);
       if (total_active_contexts > 0)
       {
         task_scheduler_enabled = true;
-        launch_task_scheduler();
+        // If none of the mappers wanted any of the tasks and nothing
+        // new showed up then there is no point in spinning, so park
+        // the scheduler behind all other work until we get woken up
+        if (!progress && (start_epoch == ready_epoch))
+        {
+          task_scheduler_parked = true;
+          launch_task_scheduler(LG_LOW_PRIORITY);
+        }
+        else
+          launch_task_scheduler();
       }
       else
         task_scheduler_enabled = false; 
     } 
 
     //--------------------------------------------------------------------------
-    void ProcessorManager::launch_task_scheduler(void)
+    void ProcessorManager::launch_task_scheduler(LgPriority priority)
     //--------------------------------------------------------------------------
     {
+      // Better be called while holding the queue lock
       SchedulerArgs sched_args;
       sched_args.proc = local_proc;
-      runtime->issue_runtime_meta_task(sched_args, LG_LATENCY_PRIORITY);
+      sched_args.generation = ++scheduler_generation;
+      runtime->issue_runtime_meta_task(sched_args, priority);
     } 
 
+    //--------------------------------------------------------------------------
+    void ProcessorManager::wake_task_scheduler(void)
+    //--------------------------------------------------------------------------
+    {
+      // Better be called while holding the queue lock
+      ready_epoch++;
+      if (task_scheduler_parked)
+      {
+        task_scheduler_parked = false;
+        launch_task_scheduler();
+      }
+    }
+
     //--------------------------------------------------------------------------
     void ProcessorManager::activate_context(InnerContext *context)
     //--------------------------------------------------------------------------
@@ -2678,7 +3068,10 @@ namespace Legion {
 #endif
       state.active = true;
       if (state.owned_tasks > 0)
+      {
         increment_active_contexts();
+        wake_task_scheduler();
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -2714,6 +3107,7 @@ namespace Legion {
       if ((total_active_contexts == 0) && !task_scheduler_enabled)
       {
         task_scheduler_enabled = true;
+        task_scheduler_parked = false;
         launch_task_scheduler();
       }
       total_active_contexts++;
@@ -2756,14 +3150,16 @@ namespace Legion {
           continue;
         
         // Construct a vector of tasks eligible for stealing
+        ReadyQueue *queue = find_ready_queue(stealer);
+        if (queue == NULL)
+          continue;
         Mapper::StealRequestInput input;
         input.thief_proc = thief;
         std::vector<const Task*> &mapper_tasks = input.stealable_tasks;
         {
-          AutoLock q_lock(queue_lock,1,false/*exclusive*/);
-          std::list<TaskOp*> &target_list = ready_queues[stealer];
+          AutoLock r_lock(queue->ready_lock,1,false/*exclusive*/);
           for (std::list<TaskOp*>::const_iterator it = 
-                target_list.begin(); it != target_list.end(); it++)
+                queue->tasks.begin(); it != queue->tasks.end(); it++)
           {
             if ((*it)->is_stealable() && !(*it)->is_locally_mapped())
               mapper_tasks.push_back(*it);
@@ -2777,31 +3173,32 @@ namespace Legion {
         const std::set<const Task*> &to_steal = output.stolen_tasks;
         if (!to_steal.empty())
         {
-          // See if we can still get it out of the queue
-          AutoLock q_lock(queue_lock);
-          std::list<TaskOp*> &target_list = ready_queues[stealer];
-          for (std::set<const Task*>::const_iterator steal_it = 
-                to_steal.begin(); steal_it != to_steal.end(); steal_it++)
+          // See if we can still get them out of the queue, which 
+          // we can do with a single pass over the queue
           {
-            TaskOp *target = static_cast<TaskOp*>(
-                              const_cast<Task*>(*steal_it));
-            bool found = false;
-            for (std::list<TaskOp*>::iterator it = target_list.begin();
-                  it != target_list.end(); it++)
+            AutoLock r_lock(queue->ready_lock);
+            for (std::list<TaskOp*>::iterator it = queue->tasks.begin();
+                  (it != queue->tasks.end()) && 
+                  (temp_stolen.size() < to_steal.size()); /*nothing*/)
             {
-              if ((*it) == target)
+              if (to_steal.find(*it) != to_steal.end())
               {
-                target_list.erase(it);
-                found = true;
-                break;
+                temp_stolen.push_back(*it);
+                it = queue->tasks.erase(it);
               }
+              else
+                it++;
             }
-            if (found)
+          }
+          if (!temp_stolen.empty())
+          {
+            // Wait until we are no longer holding the lock
+            // to mark that these are no longer outstanding tasks
+            AutoLock q_lock(queue_lock);
+            for (unsigned idx = 0; idx < temp_stolen.size(); idx++)
             {
-              temp_stolen.push_back(target);
-              // Wait until we are no longer holding the lock
-              // to mark that this is no longer an outstanding task
-              ContextID ctx_id = target->get_context()->get_context_id();
+              ContextID ctx_id = 
+                temp_stolen[idx]->get_context()->get_context_id();
               ContextState &state = context_states[ctx_id];
 #ifdef DEBUG_LEGION
               assert(state.owned_tasks > 0);
@@ -2833,10 +3230,14 @@ namespace Legion {
               temp_stolen[idx]->get_context()->get_context_id();
             AutoLock q_lock(queue_lock);
             ContextState &state = context_states[ctx_id];
-            ready_queues[stealer].push_front(temp_stolen[idx]);
             if (state.active && (state.owned_tasks == 0))
               increment_active_contexts();
             state.owned_tasks++;
+            {
+              AutoLock r_lock(queue->ready_lock);
+              queue->tasks.push_front(temp_stolen[idx]);
+            }
+            wake_task_scheduler();
           }
         }
 
@@ -2894,14 +3295,34 @@ namespace Legion {
       // vector is of a fixed size
       ContextID ctx_id = task->get_context()->get_context_id();
       AutoLock q_lock(queue_lock);
+      std::map<MapperID,ReadyQueue*>::const_iterator finder = 
+        ready_queues.find(task->map_id);
 #ifdef DEBUG_LEGION
-      assert(ready_queues.find(task->map_id) != ready_queues.end());
+      assert(finder != ready_queues.end());
 #endif
       ContextState &state = context_states[ctx_id];
-      ready_queues[task->map_id].push_back(task);
       if (state.active && (state.owned_tasks == 0))
         increment_active_contexts();
       state.owned_tasks++;
+      {
+        AutoLock r_lock(finder->second->ready_lock);
+        finder->second->tasks.push_back(task);
+      }
+      wake_task_scheduler();
+    }
+
+    //--------------------------------------------------------------------------
+    ProcessorManager::ReadyQueue* ProcessorManager::find_ready_queue(
+                                                                MapperID mid)
+    //--------------------------------------------------------------------------
+    {
+      // Ready queues are never removed so the pointer stays valid
+      AutoLock q_lock(queue_lock,1,false/*exclusive*/);
+      std::map<MapperID,ReadyQueue*>::const_iterator finder = 
+        ready_queues.find(mid);
+      if (finder == ready_queues.end())
+        return NULL;
+      return finder->second;
     }
 
     //--------------------------------------------------------------------------
@@ -2918,9 +3339,10 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void ProcessorManager::perform_mapping_operations(void)
+    bool ProcessorManager::perform_mapping_operations(void)
     //--------------------------------------------------------------------------
     {
+      bool progress = false;
       std::multimap<Processor,MapperID> stealing_targets;
       std::vector<MapperID> mappers_with_stealable_work;
       std::vector<std::pair<MapperID,MapperManager*> > current_mappers;
@@ -2942,19 +3364,22 @@ namespace Legion {
       {
         MapperID map_id = it->first;
         MapperManager *mapper = it->second;
+        ReadyQueue *queue = find_ready_queue(map_id);
+#ifdef DEBUG_LEGION
+        assert(queue != NULL);
+#endif
         Mapper::SelectMappingInput input;
         std::list<const Task*> &visible_tasks = input.ready_tasks;
         // We also need to capture the generations here
-        std::list<GenerationID> visible_generations;
+        std::map<const Task*,GenerationID> visible_generations;
         // Pull out the current tasks for this mapping operation
         {
-          AutoLock q_lock(queue_lock,1,false/*exclusive*/);
-          std::list<TaskOp*> &target_list = ready_queues[map_id];
+          AutoLock r_lock(queue->ready_lock,1,false/*exclusive*/);
           for (std::list<TaskOp*>::const_iterator it = 
-                target_list.begin(); it != target_list.end(); it++)
+                queue->tasks.begin(); it != queue->tasks.end(); it++)
           {
             visible_tasks.push_back(*it);
-            visible_generations.push_back((*it)->get_generation());
+            visible_generations[*it] = (*it)->get_generation();
           }
         }
         // Ask the mapper which tasks it would like to schedule
@@ -2968,94 +3393,78 @@ namespace Legion {
         // that we can't actually find the task because it has been
         // stolen from the queue while we were deciding what to
         // map.  It's also possible the task is no longer in the same
-        // place if the queue was prepended to.
+        // place if the queue was prepended to. Everything selected
+        // is removed in a single pass over the queue.
+        std::vector<TaskOp*> selected_tasks;
+        if (!output.map_tasks.empty() || !output.relocate_tasks.empty())
         {
-          // First things first: filter our visible list before we are holding
-          // the lock on the ready queues
-          std::list<GenerationID>::iterator gen_it = 
-            visible_generations.begin();
-          for (std::list<const Task*>::iterator vis_it = visible_tasks.begin();
-                vis_it != visible_tasks.end(); /*nothing*/)
+          const size_t total_selected = 
+            output.map_tasks.size() + output.relocate_tasks.size();
+          AutoLock r_lock(queue->ready_lock);
+          for (std::list<TaskOp*>::iterator it = queue->tasks.begin();
+                (it != queue->tasks.end()) && 
+                (selected_tasks.size() < total_selected); /*nothing*/)
           {
-            // Check to see if this is a task that we care about
-            if ((output.map_tasks.find(*vis_it) != output.map_tasks.end()) ||
-                (output.relocate_tasks.find(*vis_it) != 
-                 output.relocate_tasks.end()))
+            // In order to be the same task, they need to have the
+            // same pointer and have the same generation
+            std::map<const Task*,GenerationID>::const_iterator gen_finder =
+              visible_generations.find(*it);
+            if ((gen_finder != visible_generations.end()) &&
+                (gen_finder->second == (*it)->get_generation()) &&
+                ((output.map_tasks.find(*it) != output.map_tasks.end()) ||
+                 (output.relocate_tasks.find(*it) != 
+                  output.relocate_tasks.end())))
             {
-              vis_it++; // still care about it
-              gen_it++;
+              selected_tasks.push_back(*it);
+              it = queue->tasks.erase(it);
             }
-            else // Otherwise we don't care so we can erase it
+            else
+              it++;
+          }
+        }
+        if (!stealing_disabled)
+        {
+          AutoLock r_lock(queue->ready_lock,1,false/*exclusive*/);
+          for (std::list<TaskOp*>::const_iterator it =
+                queue->tasks.begin(); it != queue->tasks.end(); it++)
+          {
+            if ((*it)->is_stealable())
             {
-              vis_it = visible_tasks.erase(vis_it);
-              gen_it = visible_generations.erase(gen_it);
+              mappers_with_stealable_work.push_back(map_id);
+              break;
             }
           }
-          // Reset the iterator to the start
-          gen_it = visible_generations.begin();
+        }
+        if (selected_tasks.empty())
+          continue;
+        progress = true;
+        // Mark that these tasks are no longer owned by their contexts
+        // in one batch now that they are out of the queue
+        {
           AutoLock q_lock(queue_lock);
-          std::list<TaskOp*> &rqueue = ready_queues[map_id];
-          for (std::list<const Task*>::iterator vis_it = visible_tasks.begin(); 
-                vis_it != visible_tasks.end(); gen_it++)
+          for (std::vector<TaskOp*>::const_iterator it = 
+                selected_tasks.begin(); it != selected_tasks.end(); it++)
           {
-            bool found = false;
-            for (std::list<TaskOp*>::iterator it = rqueue.begin();
-                  it != rqueue.end(); it++)
-            {
-              // In order to be the same task, they need to have the
-              // same pointer and have the same generation
-              if (((*it) == (*vis_it)) &&
-                  ((*gen_it) == (*it)->get_generation()))
-              {
-                rqueue.erase(it);
-                found = true;
-                break;
-              }
-            }
-            if (!found) // stolen
-            {
-              // Remove it from our list
-              vis_it = visible_tasks.erase(vis_it);
-            }
-            else
-            {
-              // Wait until we are not holding the queue lock
-              // to mark that this task is no longer outstanding
-              TaskOp *task = static_cast<TaskOp*>(const_cast<Task*>(*vis_it));
-              ContextID ctx_id = task->get_context()->get_context_id(); 
-              ContextState &state = context_states[ctx_id];
+            ContextID ctx_id = (*it)->get_context()->get_context_id(); 
+            ContextState &state = context_states[ctx_id];
 #ifdef DEBUG_LEGION
-              assert(state.owned_tasks > 0);
+            assert(state.owned_tasks > 0);
 #endif
-              state.owned_tasks--;
-              if (state.active && (state.owned_tasks == 0))
-                decrement_active_contexts();
-              vis_it++;
-            }
-          }
-          if (!stealing_disabled)
-          {
-            for (std::list<TaskOp*>::const_iterator it =
-                  rqueue.begin(); it != rqueue.end(); it++)
-            {
-              if ((*it)->is_stealable())
-              {
-                mappers_with_stealable_work.push_back(map_id);
-                break;
-              }
-            }
+            state.owned_tasks--;
+            if (state.active && (state.owned_tasks == 0))
+              decrement_active_contexts();
           }
         }
         // Now that we've removed them from the queue, issue the
         // mapping analysis calls
         TriggerTaskArgs trigger_args;
-        for (std::list<const Task*>::iterator vis_it = visible_tasks.begin();
-              vis_it != visible_tasks.end(); vis_it++)
+        for (std::vector<TaskOp*>::const_iterator it = 
+              selected_tasks.begin(); it != selected_tasks.end(); it++)
         {
-          TaskOp *task = static_cast<TaskOp*>(const_cast<Task*>(*vis_it));
+          TaskOp *task = *it;
           // Update the target processor for this task if necessary
           std::map<const Task*,Processor>::const_iterator finder = 
-            output.relocate_tasks.find(*vis_it);
+            output.relocate_tasks.find(task);
           const bool send_remotely = (finder != output.relocate_tasks.end());
           if (send_remotely)
             task->set_target_proc(finder->second);
@@ -3079,6 +3488,7 @@ namespace Legion {
       // Finally issue any steal requeusts
       if (!stealing_disabled && !stealing_targets.empty())
         runtime->send_steal_request(stealing_targets, local_proc);
+      return progress;
     }
 
     //--------------------------------------------------------------------------
@@ -3103,7 +3513,12 @@ namespace Legion {
       : memory(m), owner_space(m.address_space()), 
         is_owner(m.address_space() == rt->address_space),
         capacity(m.capacity()), remaining_capacity(capacity), runtime(rt), 
-        manager_lock(Reservation::create_reservation())
+        manager_lock(Reservation::create_reservation()),
+        total_instance_lookups(0), total_candidates_examined(0),
+        max_candidates_examined(0), allocated_bytes(0),
+        eager_collection_pending(false), total_eager_collections(0),
+        total_eager_bytes_collected(0), total_allocation_retries(0),
+        total_allocation_retry_time(0)
     //--------------------------------------------------------------------------
     {
     }
@@ -3139,9 +3554,23 @@ namespace Legion {
     void MemoryManager::prepare_for_shutdown(void)
     //--------------------------------------------------------------------------
     {
+      if (total_instance_lookups > 0)
+        log_run.info("Memory " IDFMT " examined %llu instance candidates over "
+                     "%llu lookups (maximum %llu in one lookup)", memory.id,
+                     total_candidates_examined, total_instance_lookups,
+                     max_candidates_examined);
+      if (total_allocation_retries > 0)
+        log_run.info("Memory " IDFMT " spent %llu us in %llu allocation "
+                     "retries after failed allocations", memory.id,
+                     total_allocation_retry_time, total_allocation_retries);
+      if (total_eager_collections > 0)
+        log_run.info("Memory " IDFMT " eagerly collected %llu bytes in %llu "
+                     "passes", memory.id, total_eager_bytes_collected,
+                     total_eager_collections);
       // Only need to do things if we are the owner memory
       if (is_owner)
       {
+        release_recycled_instances(false/*only expired*/);
         std::vector<PhysicalManager*> instances;
         {
           AutoLock m_lock(manager_lock,1,false/*exclusive*/);
@@ -3197,6 +3626,7 @@ namespace Legion {
       // that we were made valid to begin with
       InstanceInfo &info = current_instances[manager];
       info.instance_size = inst_size;
+      index_instance(manager);
     }
 
     //--------------------------------------------------------------------------
@@ -3207,6 +3637,7 @@ namespace Legion {
  #ifdef DEBUG_LEGION
       assert(current_instances.find(manager) != current_instances.end());
 #endif     
+      unindex_instance(manager);
       current_instances.erase(manager);
     }
 
@@ -3224,6 +3655,7 @@ namespace Legion {
 #endif
       if (finder->second.current_state != VALID_STATE)
         finder->second.current_state = ACTIVE_STATE;
+      finder->second.last_use = Realm::Clock::current_time_in_microseconds();
     }
 
     //--------------------------------------------------------------------------
@@ -3252,6 +3684,8 @@ namespace Legion {
 #endif
           Runtime::trigger_event(info.deferred_collect);
           // Now we can delete our entry because it has been deleted
+          unindex_instance(manager);
+          allocated_bytes -= info.instance_size;
           current_instances.erase(finder);
           if (is_owner)
             remove_reference = true;
@@ -3286,6 +3720,7 @@ namespace Legion {
         assert(finder->second.current_state == ACTIVE_STATE);
 #endif
       finder->second.current_state = VALID_STATE;
+      finder->second.last_use = Realm::Clock::current_time_in_microseconds();
     }
 
     //--------------------------------------------------------------------------
@@ -4294,7 +4729,10 @@ namespace Legion {
           std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
             current_instances.find(manager);
           if (finder == current_instances.end())
+          {
             current_instances[manager] = InstanceInfo();
+            index_instance(manager);
+          }
           if (created && min_priority)
           {
             std::pair<MapperID,Processor> key(mapper_id,processor);
@@ -4331,7 +4769,10 @@ namespace Legion {
           std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
             current_instances.find(manager);
           if (finder == current_instances.end())
+          {
             current_instances[manager] = InstanceInfo();
+            index_instance(manager);
+          }
           if (min_priority)
           {
             InstanceInfo &info = current_instances[manager];
@@ -4542,18 +4983,17 @@ namespace Legion {
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints.specialized_constraint,
+                               false/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
+      record_instance_lookup(candidates.size());
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -4596,18 +5036,17 @@ namespace Legion {
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints->specialized_constraint,
+                               false/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
+      record_instance_lookup(candidates.size());
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -4651,17 +5090,16 @@ namespace Legion {
       // Hold the lock while iterating here
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints.specialized_constraint,
+                               false/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.insert(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.insert(*it);
         }
+        record_instance_lookup(indexed.size());
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -4702,16 +5140,15 @@ namespace Legion {
       // Hold the lock while iterating here
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints->specialized_constraint,
+                               false/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          if (!it->first->meets_region_tree(regions))
-            continue;
-          candidates.insert(it->first);
+          candidates.insert(*it);
         }
+        record_instance_lookup(indexed.size());
       }
       // If we have any candidates check their constraints
       if (!candidates.empty())
@@ -4754,16 +5191,17 @@ namespace Legion {
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints.specialized_constraint,
+                               true/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
         {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
+      record_instance_lookup(candidates.size());
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -4807,16 +5245,17 @@ namespace Legion {
       std::deque<PhysicalManager*> candidates;
       {
         AutoLock m_lock(manager_lock, 1, false/*exclusive*/);
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints->specialized_constraint,
+                               true/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
         {
-          // Only consider ones that are currently valid
-          if (it->second.current_state != VALID_STATE)
-            continue;
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.push_back(it->first);
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(*it);
         }
       }
+      record_instance_lookup(candidates.size());
       // If we have any candidates check their constraints
       bool found = false;
       if (!candidates.empty())
@@ -4874,6 +5313,143 @@ namespace Legion {
       }
     }
 
+    //--------------------------------------------------------------------------
+    void MemoryManager::find_indexed_instances(
+                                 const std::vector<LogicalRegion> &regions,
+                                 const SpecializedConstraint &specialized,
+                                 bool only_valid,
+                                 std::vector<PhysicalManager*> &result) const
+    //--------------------------------------------------------------------------
+    {
+      std::map<RegionTreeID,std::map<LayoutSignature,
+        std::set<PhysicalManager*> > >::const_iterator first_tree, last_tree;
+      if (!regions.empty())
+      {
+        // Instances can only satisfy the request if all the
+        // regions come from the same region tree as the instance
+        const RegionTreeID tree_id = regions[0].get_tree_id();
+        for (unsigned idx = 1; idx < regions.size(); idx++)
+          if (regions[idx].get_tree_id() != tree_id)
+            return;
+        first_tree = instance_index.find(tree_id);
+        if (first_tree == instance_index.end())
+          return;
+        last_tree = first_tree;
+        last_tree++;
+      }
+      else
+      {
+        first_tree = instance_index.begin();
+        last_tree = instance_index.end();
+      }
+      for (std::map<RegionTreeID,std::map<LayoutSignature,
+            std::set<PhysicalManager*> > >::const_iterator tit = 
+            first_tree; tit != last_tree; tit++)
+      {
+        // Specialized constraints are only entailed by instances with
+        // exactly the same kind and reduction operator unless the
+        // request doesn't ask for any specialization
+        std::map<LayoutSignature,std::set<PhysicalManager*> >::const_iterator
+          first_sig, last_sig;
+        if (specialized.kind != NO_SPECIALIZE)
+        {
+          first_sig = tit->second.find(
+              LayoutSignature(specialized.kind, specialized.redop));
+          if (first_sig == tit->second.end())
+            continue;
+          last_sig = first_sig;
+          last_sig++;
+        }
+        else
+        {
+          first_sig = tit->second.begin();
+          last_sig = tit->second.end();
+        }
+        for (std::map<LayoutSignature,std::set<PhysicalManager*> >::
+              const_iterator sit = first_sig; sit != last_sig; sit++)
+        {
+          for (std::set<PhysicalManager*>::const_iterator it = 
+                sit->second.begin(); it != sit->second.end(); it++)
+          {
+            std::map<PhysicalManager*,InstanceInfo>::const_iterator finder = 
+              current_instances.find(*it);
+#ifdef DEBUG_LEGION
+            assert(finder != current_instances.end());
+#endif
+            if (only_valid)
+            {
+              // Only consider ones that are currently valid
+              if (finder->second.current_state != VALID_STATE)
+                continue;
+            }
+            // Skip it if has already been collected
+            else if (finder->second.current_state == ACTIVE_COLLECTED_STATE)
+              continue;
+            result.push_back(*it);
+          }
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::record_instance_lookup(size_t candidates_examined)
+    //--------------------------------------------------------------------------
+    {
+      // These are only statistics and lookups only hold the manager
+      // lock in non-exclusive mode so update them atomically
+      const unsigned long long examined = candidates_examined;
+      __sync_fetch_and_add(&total_instance_lookups, 1);
+      __sync_fetch_and_add(&total_candidates_examined, examined);
+      unsigned long long current = max_candidates_examined;
+      while (current < examined)
+      {
+        const unsigned long long previous = 
+          __sync_val_compare_and_swap(&max_candidates_examined, 
+                                      current, examined);
+        if (previous == current)
+          break;
+        current = previous;
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::index_instance(PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      const SpecializedConstraint &specialized = 
+        manager->layout->constraints->specialized_constraint;
+      instance_index[manager->region_node->handle.get_tree_id()][
+        LayoutSignature(specialized.kind, specialized.redop)].insert(manager);
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::unindex_instance(PhysicalManager *manager)
+    //--------------------------------------------------------------------------
+    {
+      std::map<RegionTreeID,std::map<LayoutSignature,
+        std::set<PhysicalManager*> > >::iterator tree_finder = 
+          instance_index.find(manager->region_node->handle.get_tree_id());
+#ifdef DEBUG_LEGION
+      assert(tree_finder != instance_index.end());
+#endif
+      const SpecializedConstraint &specialized = 
+        manager->layout->constraints->specialized_constraint;
+      std::map<LayoutSignature,std::set<PhysicalManager*> >::iterator 
+        sig_finder = tree_finder->second.find(
+            LayoutSignature(specialized.kind, specialized.redop));
+#ifdef DEBUG_LEGION
+      assert(sig_finder != tree_finder->second.end());
+      assert(sig_finder->second.find(manager) != sig_finder->second.end());
+#endif
+      sig_finder->second.erase(manager);
+      if (sig_finder->second.empty())
+      {
+        tree_finder->second.erase(sig_finder);
+        if (tree_finder->second.empty())
+          instance_index.erase(tree_finder);
+      }
+    }
+
     //--------------------------------------------------------------------------
     template<bool SMALLER>
     MemoryManager::CollectableInfo<SMALLER>::CollectableInfo(PhysicalManager *m,
@@ -5025,6 +5601,31 @@ namespace Legion {
                               builder.create_physical_instance(runtime->forest);
       if (manager != NULL)
         return manager;
+      // Record how long we spend trying to make room for the instance
+      const unsigned long long start = 
+        Realm::Clock::current_time_in_microseconds();
+      manager = collect_and_allocate(builder);
+      const unsigned long long stop = 
+        Realm::Clock::current_time_in_microseconds();
+      __sync_fetch_and_add(&total_allocation_retries, 1);
+      __sync_fetch_and_add(&total_allocation_retry_time, stop - start);
+      return manager;
+    }
+
+    //--------------------------------------------------------------------------
+    PhysicalManager* MemoryManager::collect_and_allocate(
+                                                      InstanceBuilder &builder)
+    //--------------------------------------------------------------------------
+    {
+      // If we're holding onto any recycled instances then give
+      // their storage back to the memory and try again
+      if (release_recycled_instances(false/*only expired*/))
+      {
+        PhysicalManager *manager = 
+          builder.create_physical_instance(runtime->forest);
+        if (manager != NULL)
+          return manager;
+      }
       // If that didn't work find the set of immediately collectable regions
       // Rank them by size and then by GC priority
       // Start with all the ones larger than given size and try to 
@@ -5136,22 +5737,19 @@ namespace Legion {
 #endif
         AutoLock m_lock(manager_lock);
         // Find our candidates
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints.specialized_constraint,
+                               false/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
         {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          // Check if the region trees are the same
-          if (!it->first->meets_region_tree(regions))
-            continue;
           // If we already considered it we don't have to do it again
-          if (candidates.find(it->first) != candidates.end())
+          if (candidates.find(*it) != candidates.end())
             continue;
           // We found an alternate candidate so break out so we can test it
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.insert(it->first);
-          alternate = it->first;
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.insert(*it);
+          alternate = *it;
           // We found an alternate so we can break out
           break;
         }
@@ -5170,6 +5768,9 @@ namespace Legion {
         info.instance_size = instance_size;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,proc)] = priority;
+        info.last_use = Realm::Clock::current_time_in_microseconds();
+        index_instance(manager);
+        allocated_bytes += instance_size;
         // Break out because we are done
         break;
       } while (true);
@@ -5186,6 +5787,7 @@ namespace Legion {
       // If we have a GC_NEVER_PRIORITY then we have to add the valid reference
       if (priority == GC_NEVER_PRIORITY)
         manager->add_base_valid_ref(NEVER_GC_REF);
+      check_eager_collection();
       return manager;
     }
 
@@ -5246,22 +5848,19 @@ namespace Legion {
 #endif
         AutoLock m_lock(manager_lock);
         // Find our candidates
-        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
-              current_instances.begin(); it != current_instances.end(); it++)
-        {
-          // Skip it if has already been collected
-          if (it->second.current_state == ACTIVE_COLLECTED_STATE)
-            continue;
-          // Check if the region trees are the same
-          if (!it->first->meets_region_tree(regions))
-            continue;
+        std::vector<PhysicalManager*> indexed;
+        find_indexed_instances(regions, constraints->specialized_constraint,
+                               false/*only valid*/, indexed);
+        for (std::vector<PhysicalManager*>::const_iterator it = 
+              indexed.begin(); it != indexed.end(); it++)
+        {
           // If we already considered it we don't have to do it again
-          if (candidates.find(it->first) != candidates.end())
+          if (candidates.find(*it) != candidates.end())
             continue;
           // We found an alternate candidate so break out so we can test it
-          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
-          candidates.insert(it->first);
-          alternate = it->first;
+          (*it)->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.insert(*it);
+          alternate = *it;
           // We found an alternate so we can break out
           break;
         }
@@ -5280,6 +5879,9 @@ namespace Legion {
         info.instance_size = instance_size;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,proc)] = priority;
+        info.last_use = Realm::Clock::current_time_in_microseconds();
+        index_instance(manager);
+        allocated_bytes += instance_size;
         // Break out because we are done
         break;
       } while (true);
@@ -5295,6 +5897,7 @@ namespace Legion {
       }
       if (priority == GC_NEVER_PRIORITY)
         manager->add_base_valid_ref(NEVER_GC_REF);
+      check_eager_collection();
       return manager;
     }
 
@@ -5327,6 +5930,9 @@ namespace Legion {
         info.instance_size = instance_size;
         info.mapper_priorities[
           std::pair<MapperID,Processor>(mapper_id,p)] = priority;
+        info.last_use = Realm::Clock::current_time_in_microseconds();
+        index_instance(manager);
+        allocated_bytes += instance_size;
       }
       // Now we can add any references that we need to
       if (acquire)
@@ -5338,6 +5944,7 @@ namespace Legion {
       }
       if (priority == GC_NEVER_PRIORITY)
         manager->add_base_valid_ref(NEVER_GC_REF);
+      check_eager_collection();
     }
 
     //--------------------------------------------------------------------------
@@ -5369,9 +5976,13 @@ namespace Legion {
 #ifdef DEBUG_LEGION
           assert(finder->second.current_state == COLLECTABLE_STATE);
 #endif
-          current_instances.erase(finder);
+          unindex_instance(manager);
           if (is_owner)
+          {
+            allocated_bytes -= finder->second.instance_size;
             remove_reference = true;
+          }
+          current_instances.erase(finder);
         }
       }
       manager->perform_deletion(deletion_precondition);
@@ -5380,6 +5991,216 @@ namespace Legion {
         delete manager;
     }
 
+    //--------------------------------------------------------------------------
+    void MemoryManager::check_eager_collection(void)
+    //--------------------------------------------------------------------------
+    {
+      if ((Runtime::gc_high_water_mark == 0) || (capacity == 0))
+        return;
+      {
+        AutoLock m_lock(manager_lock);
+        if (eager_collection_pending)
+          return;
+        if (allocated_bytes < 
+            ((capacity / 100) * Runtime::gc_high_water_mark))
+          return;
+        eager_collection_pending = true;
+      }
+      EagerCollectionArgs args;
+      args.manager = this;
+      runtime->issue_runtime_meta_task(args, LG_LOW_PRIORITY);
+    }
+
+    //--------------------------------------------------------------------------
+    void MemoryManager::perform_eager_collection(void)
+    //--------------------------------------------------------------------------
+    {
+      // Collect down to a bit below the high-water mark so that we 
+      // don't end up running this again for every new instance
+      const unsigned low_water_mark = 
+        (Runtime::gc_high_water_mark > LEGION_EAGER_GC_HYSTERESIS) ?
+        (Runtime::gc_high_water_mark - LEGION_EAGER_GC_HYSTERESIS) : 0;
+      const size_t target_bytes = (capacity / 100) * low_water_mark;
+      // Anything we're holding for recycling goes first
+      release_recycled_instances(false/*only expired*/);
+      std::vector<EagerCandidate> candidates;
+      {
+        AutoLock m_lock(manager_lock,1,false/*exclusive*/);
+        for (std::map<PhysicalManager*,InstanceInfo>::const_iterator it = 
+              current_instances.begin(); it != current_instances.end(); it++)
+        {
+          if (it->second.current_state != COLLECTABLE_STATE)
+            continue;
+          it->first->add_base_resource_ref(MEMORY_MANAGER_REF);
+          candidates.push_back(EagerCandidate(it->first, 
+                it->second.instance_size, it->second.min_priority,
+                it->second.last_use));
+        }
+      }
+      std::sort(candidates.begin(), candidates.end());
+      size_t bytes_collected = 0;
+      for (std::vector<EagerCandidate>::const_iterator it = 
+            candidates.begin(); it != candidates.end(); it++)
+      {
+        if ((allocated_bytes > target_bytes) && 
+            it->manager->try_active_deletion())
+        {
+          record_deleted_instance(it->manager);
+          bytes_collected += it->instance_size;
+        }
+        if (it->manager->remove_base_resource_ref(MEMORY_MANAGER_REF))
+          delete it->manager;
+      }
+      __sync_fetch_and_add(&total_eager_collections, 1);
+      __sync_fetch_and_add(&total_eager_bytes_collected, bytes_collected);
+      AutoLock m_lock(manager_lock);
+      eager_collection_pending = false;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void MemoryManager::handle_eager_collection(const void *args)
+    //--------------------------------------------------------------------------
+    {
+      const EagerCollectionArgs *eargs = (const EagerCollectionArgs*)args;
+      eargs->manager->perform_eager_collection();
+    }
+
+    //--------------------------------------------------------------------------
+    bool MemoryManager::EagerCandidate::operator<(
+                                           const EagerCandidate &rhs) const
+    //--------------------------------------------------------------------------
+    {
+      // Collect the highest priorities first, then the instances that
+      // have gone the longest without being used, then the largest ones
+      if (priority != rhs.priority)
+        return (priority > rhs.priority);
+      if (last_use != rhs.last_use)
+        return (last_use < rhs.last_use);
+      if (instance_size != rhs.instance_size)
+        return (instance_size > rhs.instance_size);
+      return (manager < rhs.manager);
+    }
+
+    //--------------------------------------------------------------------------
+    bool MemoryManager::recycle_instance(PhysicalManager *manager,
+                                         RtEvent collected)
+    //--------------------------------------------------------------------------
+    {
+      if ((Runtime::instance_recycle_window == 0) || !is_owner)
+        return false;
+      // The tools identify instances by their names so we can't
+      // reuse them for different managers when they are watching
+      if ((runtime->profiler != NULL) || Runtime::legion_spy_enabled)
+        return false;
+      // Only recycle normal instances over a region's index space, 
+      // reduction instances have to be initialized when they are made
+      // and external instances don't own their storage
+      if (manager->own_domain || manager->pointer_constraint.is_valid ||
+          (manager->instance_domain == NULL))
+        return false;
+      const SpecializedKind kind = 
+        manager->layout->constraints->specialized_constraint.get_kind();
+      if ((kind != NO_SPECIALIZE) && (kind != NORMAL_SPECIALIZE))
+        return false;
+      // Fields with custom serdez have to be destroyed
+      std::vector<PhysicalInstance::DestroyedField> serdez_fields;
+      manager->layout->compute_destroyed_fields(serdez_fields);
+      if (!serdez_fields.empty())
+        return false;
+      RecycledInstance recycled;
+      recycled.instance = manager->instance;
+      recycled.layout = manager->layout;
+      recycled.domain = manager->instance_domain->handle;
+      recycled.collected = collected;
+      recycled.expiration = Realm::Clock::current_time_in_microseconds() +
+                            Runtime::instance_recycle_window;
+      recycled.layout->add_reference();
+      std::vector<RecycledInstance> to_release;
+      {
+        AutoLock m_lock(manager_lock);
+        recycled_instances.push_back(recycled);
+        // Bound the number of instances that we hold onto
+        while (recycled_instances.size() > LEGION_MAX_RECYCLED_INSTANCES)
+        {
+          to_release.push_back(recycled_instances.front());
+          recycled_instances.pop_front();
+        }
+      }
+      for (std::vector<RecycledInstance>::const_iterator it = 
+            to_release.begin(); it != to_release.end(); it++)
+      {
+        it->instance.destroy(it->collected);
+        if (it->layout->remove_reference())
+          delete it->layout;
+      }
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    bool MemoryManager::find_recycled_instance(LayoutDescription *layout,
+                                               IndexSpace domain,
+                                               PhysicalInstance &instance,
+                                               ApEvent &ready)
+    //--------------------------------------------------------------------------
+    {
+      // Get rid of anything that has been sitting around too long first
+      release_recycled_instances(true/*only expired*/);
+      AutoLock m_lock(manager_lock);
+      // Search from the newest since it is most likely to match
+      for (std::list<RecycledInstance>::reverse_iterator it = 
+            recycled_instances.rbegin(); it != recycled_instances.rend(); it++)
+      {
+        if ((it->layout != layout) || (it->domain != domain))
+          continue;
+        instance = it->instance;
+        // The storage can be used as soon as the previous instance
+        // would have been destroyed
+        ready = ApEvent(it->collected);
+        // The reference on the layout goes back with the instance
+        recycled_instances.erase(--(it.base()));
+        return true;
+      }
+      return false;
+    }
+
+    //--------------------------------------------------------------------------
+    bool MemoryManager::release_recycled_instances(bool only_expired)
+    //--------------------------------------------------------------------------
+    {
+      std::vector<RecycledInstance> to_release;
+      {
+        AutoLock m_lock(manager_lock);
+        if (recycled_instances.empty())
+          return false;
+        if (only_expired)
+        {
+          const unsigned long long now = 
+            Realm::Clock::current_time_in_microseconds();
+          // Instances are in order of when they were recycled
+          while (!recycled_instances.empty() &&
+                 (recycled_instances.front().expiration <= now))
+          {
+            to_release.push_back(recycled_instances.front());
+            recycled_instances.pop_front();
+          }
+        }
+        else
+        {
+          to_release.insert(to_release.end(), 
+              recycled_instances.begin(), recycled_instances.end());
+          recycled_instances.clear();
+        }
+      }
+      for (std::vector<RecycledInstance>::const_iterator it = 
+            to_release.begin(); it != to_release.end(); it++)
+      {
+        it->instance.destroy(it->collected);
+        if (it->layout->remove_reference())
+          delete it->layout;
+      }
+      return !to_release.empty();
+    }
+
     //--------------------------------------------------------------------------
     template<bool SMALLER>
     PhysicalManager* MemoryManager::delete_and_allocate(
@@ -5404,6 +6225,14 @@ namespace Legion {
             // If we succeeded we are done
             if (manager != NULL)
               return manager;
+            // The deleted instances might have been recycled in which
+            // case we need to release their storage and try again
+            if (release_recycled_instances(false/*only expired*/))
+            {
+              manager = builder.create_physical_instance(runtime->forest);
+              if (manager != NULL)
+                return manager;
+            }
           }
         }
       }
@@ -5448,6 +6277,19 @@ namespace Legion {
       sending_index += sizeof(packaged_messages);
       last_message_event = RtEvent::NO_RT_EVENT;
       partial = false;
+      aggregating = false;
+      flush_launched = false;
+      first_aggregated = 0;
+      if (Runtime::message_statistics)
+      {
+        kind_messages = (size_t*)calloc(LAST_SEND_KIND, sizeof(size_t));
+        kind_bytes = (size_t*)calloc(LAST_SEND_KIND, sizeof(size_t));
+      }
+      else
+      {
+        kind_messages = NULL;
+        kind_bytes = NULL;
+      }
       // Set up the receiving buffer
       received_messages = 0;
       receiving_index = 0;
@@ -5472,6 +6314,10 @@ namespace Legion {
       free(receiving_buffer);
       receiving_buffer = NULL;
       receiving_buffer_size = 0;
+      if (kind_messages != NULL)
+        free(kind_messages);
+      if (kind_bytes != NULL)
+        free(kind_bytes);
     }
 
     //--------------------------------------------------------------------------
@@ -5483,9 +6329,16 @@ namespace Legion {
       // First check to see if the message fits in the current buffer    
       // including the overhead for the message: kind and size
       size_t buffer_size = rez.get_used_bytes();
-      const char *buffer = (const char*)rez.get_buffer();
+      // Copy the chunks of the serializer straight into the sending
+      // buffer so they never have to be coalesced first
+      const Serializer::Chunk *chunk = rez.get_chunks();
       // Need to hold the lock when manipulating the buffer
       AutoLock s_lock(send_lock);
+      if (kind_messages != NULL)
+      {
+        kind_messages[k]++;
+        kind_bytes[k] += buffer_size;
+      }
       if ((sending_index+buffer_size+sizeof(k)+sizeof(buffer_size)) > 
           sending_buffer_size)
       {
@@ -5500,24 +6353,29 @@ namespace Legion {
         sending_index += sizeof(k);
         *((size_t*)(sending_buffer+sending_index)) = buffer_size;
         sending_index += sizeof(buffer_size);
-        while (buffer_size > 0)
+        for ( ; chunk != NULL; chunk = chunk->next)
         {
-          unsigned remaining = sending_buffer_size - sending_index;
-          if (remaining == 0)
-            send_message(false/*complete*/, runtime, 
-                         target, response, shutdown);
-          remaining = sending_buffer_size - sending_index;
-#ifdef DEBUG_LEGION
-          assert(remaining > 0); // should be space after the send
-#endif
-          // Figure out how much to copy into the buffer
-          unsigned to_copy = (remaining < buffer_size) ? 
-                                            remaining : buffer_size;
-          memcpy(sending_buffer+sending_index,buffer,to_copy);
-          buffer_size -= to_copy;
-          buffer += to_copy;
-          sending_index += to_copy;
-        } 
+          const char *buffer = chunk->data();
+          size_t chunk_size = chunk->used;
+          while (chunk_size > 0)
+          {
+            unsigned remaining = sending_buffer_size - sending_index;
+            if (remaining == 0)
+              send_message(false/*complete*/, runtime, 
+                           target, response, shutdown);
+            remaining = sending_buffer_size - sending_index;
+#ifdef DEBUG_LEGION
+            assert(remaining > 0); // should be space after the send
+#endif
+            // Figure out how much to copy into the buffer
+            unsigned to_copy = (remaining < chunk_size) ? 
+                                              remaining : chunk_size;
+            memcpy(sending_buffer+sending_index,buffer,to_copy);
+            chunk_size -= to_copy;
+            buffer += to_copy;
+            sending_index += to_copy;
+          }
+        }
       }
       else
       {
@@ -5527,12 +6385,105 @@ namespace Legion {
         sending_index += sizeof(k);
         *((size_t*)(sending_buffer+sending_index)) = buffer_size;
         sending_index += sizeof(buffer_size);
-        // Then copy over the buffer
-        memcpy(sending_buffer+sending_index,buffer,buffer_size); 
-        sending_index += buffer_size;
+        // Then copy over the chunks
+        for ( ; chunk != NULL; chunk = chunk->next)
+        {
+          memcpy(sending_buffer+sending_index,chunk->data(),chunk->used);
+          sending_index += chunk->used;
+        }
       }
       if (flush)
-        send_message(true/*complete*/, runtime, target, response, shutdown);
+      {
+        if ((Runtime::message_aggregation_window == 0) || response || 
+            shutdown || (buffer_size > Runtime::small_message_size) ||
+            is_urgent_message(k))
+          send_message(true/*complete*/, runtime, target, response, shutdown);
+        else
+        {
+          // Hold small messages back so they can be aggregated with the
+          // messages that follow them, the window bounds how long the 
+          // oldest held message waits and a meta-task makes sure they
+          // are still sent if nothing else comes along
+          const long long now = Realm::Clock::current_time_in_microseconds();
+          if (!aggregating)
+          {
+            aggregating = true;
+            first_aggregated = now;
+          }
+          if ((now - first_aggregated) >= 
+              (long long)Runtime::message_aggregation_window)
+            send_message(true/*complete*/, runtime, target, response, shutdown);
+          else if (!flush_launched)
+          {
+            flush_launched = true;
+            FlushAggregatedArgs args;
+            args.channel = this;
+            args.target = target;
+            runtime->issue_runtime_meta_task(args, LG_LATENCY_PRIORITY);
+          }
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void VirtualChannel::flush_aggregated_messages(Runtime *runtime,
+                                                   Processor target)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock s_lock(send_lock);
+      flush_launched = false;
+      // Anything sent since the meta-task was launched took the
+      // aggregated messages along with it
+      if (aggregating)
+        send_message(true/*complete*/, runtime, target, 
+                     false/*response*/, false/*shutdown*/);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ bool VirtualChannel::is_urgent_message(MessageKind kind)
+    //--------------------------------------------------------------------------
+    {
+      // Messages that remote nodes are likely blocked waiting on are
+      // never held back for aggregation, responses are covered by the
+      // response flag and everything else can afford a short delay
+      switch (kind)
+      {
+        case TASK_MESSAGE:
+        case SLICE_DISTRIBUTION:
+        case STEAL_MESSAGE:
+        case SEND_FUTURE_RESULT:
+        case SEND_ATOMIC_RESERVATION_REQUEST:
+        case SEND_MAPPER_MESSAGE:
+        case SEND_TOP_LEVEL_TASK_REQUEST:
+        case SEND_TOP_LEVEL_TASK_COMPLETE:
+        case SEND_MPI_RANK_EXCHANGE:
+        case SEND_SHUTDOWN_NOTIFICATION:
+        case SEND_SHUTDOWN_RESPONSE:
+          return true;
+        default:
+          break;
+      }
+      return false;
+    }
+
+    //--------------------------------------------------------------------------
+    void VirtualChannel::report_message_statistics(AddressSpaceID local_space,
+                                                   AddressSpaceID remote_space,
+                                                   VirtualChannelKind kind)
+    //--------------------------------------------------------------------------
+    {
+      if (kind_messages == NULL)
+        return;
+      LG_MESSAGE_DESCRIPTIONS(message_names);
+      for (unsigned idx = 0; idx < LAST_SEND_KIND; idx++)
+      {
+        if (kind_messages[idx] == 0)
+          continue;
+        log_run.print("Messages from node %d to node %d on channel %d: "
+                      "%s %zd messages %zd bytes", local_space, remote_space,
+                      kind, message_names[idx], kind_messages[idx], 
+                      kind_bytes[idx]);
+      }
     }
 
     //--------------------------------------------------------------------------
@@ -5584,13 +6535,19 @@ namespace Legion {
       else
         header = FULL_MESSAGE;
       packaged_messages = 0;
+      aggregating = false;
     }
 
     //--------------------------------------------------------------------------
-    void VirtualChannel::confirm_shutdown(ShutdownManager *shutdown_manager,
-                                          bool phase_one)
+    bool VirtualChannel::confirm_shutdown(ShutdownManager *shutdown_manager,
+                                          bool phase_one, bool retry)
     //--------------------------------------------------------------------------
     {
+      // A little hack here for slow gasnet conduits
+      // If the last message event didn't trigger yet, make sure its just
+      // because we haven't gotten the return message yet. Rather than
+      // sleeping here we ask the caller to retry us after a grace period
+      // that is shared by all the channels that need it.
       AutoLock s_lock(send_lock);
       if (phase_one)
       {
@@ -5600,14 +6557,9 @@ namespace Legion {
         // node for the event, otherwise Realm could lie to us
         if (!last_message_event.has_triggered())
         {
-          // A little hack here for slow gasnet conduits
-          // If the event didn't trigger yet, make sure its just
-          // because we haven't gotten the return message yet
-          usleep(1000);
-          if (!last_message_event.has_triggered())
-            shutdown_manager->record_pending_message(last_message_event);
-          else
-            observed_recent = false;
+          if (!retry)
+            return true;
+          shutdown_manager->record_pending_message(last_message_event);
         }
         else
           observed_recent = false;
@@ -5618,14 +6570,12 @@ namespace Legion {
           shutdown_manager->record_recent_message(); 
         else if (!last_message_event.has_triggered())
         {
-          // A little hack here for slow gasnet conduits
-          // If the event didn't trigger yet, make sure its just
-          // because we haven't gotten the return message yet
-          usleep(1000);
-          if (!last_message_event.has_triggered())
-            shutdown_manager->record_recent_message();
+          if (!retry)
+            return true;
+          shutdown_manager->record_recent_message();
         }
       }
+      return false;
     }
 
     //--------------------------------------------------------------------------
@@ -5690,6 +6640,7 @@ namespace Legion {
                                          const char *args, size_t arglen)
     //--------------------------------------------------------------------------
     {
+      DETAILED_PROFILER(runtime, VIRTUAL_CHANNEL_HANDLE_MESSAGES_CALL);
       // For profiling if we are doing it
       unsigned long long start = 0, stop = 0;
       for (unsigned idx = 0; idx < num_messages; idx++)
@@ -5939,6 +6890,22 @@ namespace Legion {
               runtime->handle_slice_remote_commit(derez);
               break;
             }
+          case SLICE_DISTRIBUTION:
+            {
+              runtime->handle_slice_distribution(derez);
+              break;
+            }
+          case SLICE_AGGREGATE_RETURN:
+            {
+              runtime->handle_slice_aggregate_return(derez, 
+                                                remote_address_space);
+              break;
+            }
+          case SLICE_AGGREGATE_COUNT:
+            {
+              runtime->handle_slice_aggregate_count(derez);
+              break;
+            }
           case DISTRIBUTED_REMOTE_REGISTRATION:
             {
               runtime->handle_did_remote_registration(derez, 
@@ -5960,6 +6927,11 @@ namespace Legion {
               runtime->handle_did_remote_resource_update(derez);
               break;
             }
+          case DISTRIBUTED_RELEASE_BATCH:
+            {
+              runtime->handle_did_remote_release_batch(derez);
+              break;
+            }
           case DISTRIBUTED_CREATE_ADD:
             {
               runtime->handle_did_create_add(derez);
@@ -6101,6 +7073,17 @@ namespace Legion {
               runtime->handle_future_map_future_response(derez);
               break;
             }
+          case SEND_FUTURE_MAP_ALL_REQUEST:
+            {
+              runtime->handle_future_map_all_request(derez,
+                                        remote_address_space);
+              break;
+            }
+          case SEND_FUTURE_MAP_ALL_RESPONSE:
+            {
+              runtime->handle_future_map_all_response(derez);
+              break;
+            }
           case SEND_MAPPER_MESSAGE:
             {
               runtime->handle_mapper_message(derez);
@@ -6514,6 +7497,9 @@ namespace Legion {
     {
       for (unsigned idx = 0; idx < MAX_NUM_VIRTUAL_CHANNELS; idx++)
       {
+        if (Runtime::message_statistics)
+          channels[idx].report_message_statistics(runtime->address_space,
+                        remote_address_space, (VirtualChannelKind)idx);
         channels[idx].~VirtualChannel();
       }
       free(channels);
@@ -6551,12 +7537,15 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void MessageManager::confirm_shutdown(ShutdownManager *shutdown_manager, 
-                                          bool phase_one)
+    bool MessageManager::confirm_shutdown(ShutdownManager *shutdown_manager, 
+                                          bool phase_one, bool retry)
     //--------------------------------------------------------------------------
     {
+      bool needs_retry = false;
       for (unsigned idx = 0; idx < MAX_NUM_VIRTUAL_CHANNELS; idx++)
-        channels[idx].confirm_shutdown(shutdown_manager, phase_one);
+        if (channels[idx].confirm_shutdown(shutdown_manager, phase_one, retry))
+          needs_retry = true;
+      return needs_retry;
     }
 
     /////////////////////////////////////////////////////////////
@@ -6601,7 +7590,7 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    bool ShutdownManager::attempt_shutdown(void)
+    bool ShutdownManager::attempt_shutdown(RtEvent local_precondition)
     //--------------------------------------------------------------------------
     {
       // Do the broadcast tree to the other nodes
@@ -6620,18 +7609,26 @@ namespace Legion {
       
       if (!targets.empty())
       {
-        // Set the number of needed_responses
-        needed_responses = targets.size();
+        // Set the number of needed_responses, including one for 
+        // our own local work so that we can't finalize until it is done
+        needed_responses = targets.size() + 1;
         Serializer rez;
         rez.serialize(this);
         rez.serialize(phase);
         for (std::vector<AddressSpaceID>::const_iterator it = 
               targets.begin(); it != targets.end(); it++)
           runtime->send_shutdown_notification(*it, rez); 
-        return false;
+        // Our children are now doing their own work in parallel with us
+        if (local_precondition.exists() && 
+            !local_precondition.has_triggered())
+          local_precondition.lg_wait();
+        return handle_response(true/*success*/, std::set<RtEvent>());
       }
       else // no messages means we can finalize right now
       {
+        if (local_precondition.exists() && 
+            !local_precondition.has_triggered())
+          local_precondition.lg_wait();
         finalize();
         return true;
       }
@@ -6856,26 +7853,60 @@ namespace Legion {
     RtEvent GarbageCollectionEpoch::launch(void)
     //--------------------------------------------------------------------------
     {
-      // Set remaining to the total number of collections
-      remaining = collections.size();
+      // Group the views by the event that their collection has to wait
+      // for so that views which become ready together are batched together
+      std::map<RtEvent,std::vector<LogicalView*> > ready_groups;
+      for (std::map<LogicalView*,std::set<ApEvent> >::const_iterator it =
+            collections.begin(); it != collections.end(); it++)
+      {
+        RtEvent precondition = Runtime::protect_merge_events(it->second);
+        if (precondition.exists() && precondition.has_triggered())
+          precondition = RtEvent::NO_RT_EVENT;
+        ready_groups[precondition].push_back(it->first);
+      }
+      // Then pack the groups into batches of bounded size, each of which
+      // is collected by one meta-task once all of its views are ready.
+      // Views that are ready now are never put in a batch with views 
+      // that still have to wait.
+      std::vector<RtEvent> preconditions;
+      std::set<RtEvent> batch_events;
+      for (std::map<RtEvent,std::vector<LogicalView*> >::const_iterator git =
+            ready_groups.begin(); git != ready_groups.end(); git++)
+      {
+        for (std::vector<LogicalView*>::const_iterator it = 
+              git->second.begin(); it != git->second.end(); it++)
+        {
+          if (batches.empty() || 
+              (batches.back().size() == LEGION_GC_COLLECT_BATCH_SIZE) ||
+              (git->first.exists() && batch_events.empty()))
+          {
+            if (!batches.empty())
+              preconditions.push_back(Runtime::merge_events(batch_events));
+            batch_events.clear();
+            batches.resize(batches.size() + 1);
+          }
+          batches.back().push_back(*it);
+          if (git->first.exists())
+            batch_events.insert(git->first);
+        }
+      }
+      if (!batches.empty())
+        preconditions.push_back(Runtime::merge_events(batch_events));
+#ifdef DEBUG_LEGION
+      assert(preconditions.size() == batches.size());
+#endif
+      // Set remaining to the total number of meta-tasks
+      remaining = preconditions.size();
+      // Avoid the deletion race by never touching the epoch again 
+      // after the last meta-task has been launched
       GarbageCollectionArgs args;
       args.epoch = this;
       std::set<RtEvent> events;
-      for (std::map<LogicalView*,std::set<ApEvent> >::const_iterator it =
-            collections.begin(); it != collections.end(); /*nothing*/)
+      for (unsigned idx = 0; idx < preconditions.size(); idx++)
       {
-        args.view = it->first;
-        RtEvent precondition = Runtime::protect_merge_events(it->second);
-        // Avoid the deletion race by testing the condition 
-        // before launching the task
-        it++;
-        bool done = (it == collections.end());
-        RtEvent e = runtime->issue_runtime_meta_task(args,
-                                         LG_THROUGHPUT_PRIORITY, NULL,
-                                         precondition);
-        events.insert(e);
-        if (done)
-          break;
+        args.batch = idx;
+        events.insert(runtime->issue_runtime_meta_task(args,
+                        LG_THROUGHPUT_PRIORITY, NULL, preconditions[idx]));
       }
       return Runtime::merge_events(events);
     }
@@ -6885,12 +7916,21 @@ namespace Legion {
                                               const GarbageCollectionArgs *args)
     //--------------------------------------------------------------------------
     {
-      std::map<LogicalView*,std::set<ApEvent> >::iterator finder = 
-        collections.find(args->view);
+      DETAILED_PROFILER(runtime, GARBAGE_COLLECTION_DEFERRED_COLLECT_CALL);
 #ifdef DEBUG_LEGION
-      assert(finder != collections.end());
+      assert(args->batch < batches.size());
 #endif
-      LogicalView::handle_deferred_collect(args->view, finder->second);
+      const std::vector<LogicalView*> &views = batches[args->batch];
+      for (std::vector<LogicalView*>::const_iterator it = 
+            views.begin(); it != views.end(); it++)
+      {
+        std::map<LogicalView*,std::set<ApEvent> >::iterator finder = 
+          collections.find(*it);
+#ifdef DEBUG_LEGION
+        assert(finder != collections.end());
+#endif
+        LogicalView::handle_deferred_collect(*it, finder->second);
+      }
       // See if we are done
       return (__sync_add_and_fetch(&remaining, -1) == 0);
     }
@@ -7620,13 +8660,17 @@ namespace Legion {
         user_data = NULL;
       // Perform the registration, the normal case is not to have separate
       // runtime instances, but if we do have them, we only register on
-      // the local processor
+      // the local processor. Static registrations at start-up are
+      // batched by the runtime and handed to Realm all at once.
       if (!Runtime::separate_runtime_instances)
       {
-        Realm::ProfilingRequestSet profiling_requests;
-        ready_event = ApEvent(Processor::register_task_by_kind(
-            get_processor_kind(true), false/*global*/, descriptor_id, 
-            *realm_descriptor, profiling_requests, user_data, user_data_size));
+        if (!runtime->defer_realm_registration(this))
+        {
+          Realm::ProfilingRequestSet profiling_requests;
+          ready_event = ApEvent(Processor::register_task_by_kind(
+              get_processor_kind(true), false/*global*/, descriptor_id, 
+              *realm_descriptor, profiling_requests, user_data, user_data_size));
+        }
       }
       else
       {
@@ -7897,6 +8941,38 @@ namespace Legion {
       impl->broadcast_variant(done, origin, local);
     }
 
+    //--------------------------------------------------------------------------
+    /*static*/ void VariantImpl::register_realm_variants(
+                                     const std::vector<VariantImpl*> &variants)
+    //--------------------------------------------------------------------------
+    {
+      // Group the variants by processor kind so that each kind needs
+      // only a single Realm registration operation and event
+      std::map<Processor::Kind,std::vector<VariantImpl*> > by_kind;
+      for (std::vector<VariantImpl*>::const_iterator it = 
+            variants.begin(); it != variants.end(); it++)
+        by_kind[(*it)->get_processor_kind(true)].push_back(*it);
+      for (std::map<Processor::Kind,std::vector<VariantImpl*> >::const_iterator
+            kit = by_kind.begin(); kit != by_kind.end(); kit++)
+      {
+        std::vector<Processor::TaskRegistrationDesc> tasks(kit->second.size());
+        for (unsigned idx = 0; idx < kit->second.size(); idx++)
+        {
+          const VariantImpl *impl = kit->second[idx];
+          tasks[idx].func_id = impl->descriptor_id;
+          tasks[idx].codedesc = impl->realm_descriptor;
+          tasks[idx].user_data = impl->user_data;
+          tasks[idx].user_data_len = impl->user_data_size;
+        }
+        Realm::ProfilingRequestSet profiling_requests;
+        const ApEvent ready(Processor::register_tasks_by_kind(kit->first,
+                          false/*global*/, tasks, profiling_requests));
+        for (std::vector<VariantImpl*>::const_iterator it = 
+              kit->second.begin(); it != kit->second.end(); it++)
+          (*it)->ready_event = ready;
+      }
+    }
+
     //--------------------------------------------------------------------------
     /*static*/ AddressSpaceID VariantImpl::get_owner_space(VariantID vid,
                                                            Runtime *runtime)
@@ -8088,6 +9164,11 @@ namespace Legion {
       derez.deserialize(constraints_name, name_len);
       // unpack the constraints
       deserialize(derez); 
+      // Any results we computed before now are no longer valid
+      AutoLock lay(layout_lock);
+      conflict_cache.clear();
+      entailment_cache.clear();
+      no_pointer_entailment_cache.clear();
     }
 
     //--------------------------------------------------------------------------
@@ -8111,11 +9192,12 @@ namespace Legion {
                                     unsigned total_dims)
     //--------------------------------------------------------------------------
     {
+      const CacheKey key(constraints->layout_id, total_dims);
       // Check to see if the result is in the cache
       {
         AutoLock lay(layout_lock,1,false/*exclusive*/);
-        std::map<LayoutConstraintID,bool>::const_iterator finder = 
-          entailment_cache.find(constraints->layout_id);
+        std::map<CacheKey,bool>::const_iterator finder = 
+          entailment_cache.find(key);
         if (finder != entailment_cache.end())
           return finder->second;
       }
@@ -8123,7 +9205,7 @@ namespace Legion {
       bool result = entails(*constraints, total_dims);
       // Save the result in the cache
       AutoLock lay(layout_lock);
-      entailment_cache[constraints->layout_id] = result;
+      entailment_cache[key] = result;
       return result;
     }
 
@@ -8140,11 +9222,12 @@ namespace Legion {
                                       unsigned total_dims)
     //--------------------------------------------------------------------------
     {
+      const CacheKey key(constraints->layout_id, total_dims);
       // Check to see if the result is in the cache
       {
         AutoLock lay(layout_lock,1,false/*exclusive*/);
-        std::map<LayoutConstraintID,bool>::const_iterator finder = 
-          conflict_cache.find(constraints->layout_id);
+        std::map<CacheKey,bool>::const_iterator finder = 
+          conflict_cache.find(key);
         if (finder != conflict_cache.end())
           return finder->second;
       }
@@ -8152,7 +9235,7 @@ namespace Legion {
       bool result = conflicts(*constraints, total_dims);
       // Save the result in the cache
       AutoLock lay(layout_lock);
-      conflict_cache[constraints->layout_id] = result;
+      conflict_cache[key] = result;
       return result;
     }
 
@@ -8169,11 +9252,12 @@ namespace Legion {
                             LayoutConstraints *constraints, unsigned total_dims)
     //--------------------------------------------------------------------------
     {
+      const CacheKey key(constraints->layout_id, total_dims);
       // See if we have it in the cache
       {
         AutoLock lay(layout_lock,1,false/*exclusive*/);
-        std::map<LayoutConstraintID,bool>::const_iterator finder = 
-          no_pointer_entailment_cache.find(constraints->layout_id);
+        std::map<CacheKey,bool>::const_iterator finder = 
+          no_pointer_entailment_cache.find(key);
         if (finder != no_pointer_entailment_cache.end())
           return finder->second;
       }
@@ -8181,7 +9265,7 @@ namespace Legion {
       bool result = entails_without_pointer(*constraints, total_dims);
       // Save the result in the cache
       AutoLock lay(layout_lock);
-      no_pointer_entailment_cache[constraints->layout_id] = result;
+      no_pointer_entailment_cache[key] = result;
       return result;
     }
 
@@ -8359,6 +9443,21 @@ namespace Legion {
       return true;
     }
 
+    //--------------------------------------------------------------------------
+    bool IdentityProjectionFunctor::get_affine_projection(int dim,
+                                  coord_t *transform, coord_t *offset) const
+    //--------------------------------------------------------------------------
+    {
+      // The color of the child is the point itself
+      for (int i = 0; i < dim; i++)
+      {
+        for (int j = 0; j < dim; j++)
+          transform[i*dim + j] = (i == j) ? 1 : 0;
+        offset[i] = 0;
+      }
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     unsigned IdentityProjectionFunctor::get_depth(void) const
     //--------------------------------------------------------------------------
@@ -8374,19 +9473,24 @@ namespace Legion {
     ProjectionFunction::ProjectionFunction(ProjectionID pid, 
                                            ProjectionFunctor *func)
       : depth(func->get_depth()), is_exclusive(func->is_exclusive()),
-        projection_id(pid), functor(func)
+        is_functional(func->is_functional()), projection_id(pid), functor(func)
     //--------------------------------------------------------------------------
     {
       if (is_exclusive)
         projection_reservation = Reservation::create_reservation();
       else
         projection_reservation = Reservation::NO_RESERVATION;
+      if (is_functional)
+        cache_reservation = Reservation::create_reservation();
+      else
+        cache_reservation = Reservation::NO_RESERVATION;
     }
 
     //--------------------------------------------------------------------------
     ProjectionFunction::ProjectionFunction(const ProjectionFunction &rhs)
       : depth(rhs.depth), is_exclusive(rhs.is_exclusive), 
-        projection_id(rhs.projection_id), functor(rhs.functor)
+        is_functional(rhs.is_functional), projection_id(rhs.projection_id),
+        functor(rhs.functor)
     //--------------------------------------------------------------------------
     {
       // should never be called
@@ -8402,6 +9506,8 @@ namespace Legion {
         delete functor;
       if (projection_reservation.exists())
         projection_reservation.destroy_reservation();
+      if (cache_reservation.exists())
+        cache_reservation.destroy_reservation();
     }
 
     //--------------------------------------------------------------------------
@@ -8413,39 +9519,39 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(req.handle_type != SINGULAR);
 #endif
+      LogicalRegion result;
+      if (is_functional && find_cached_projection(req, point, result))
+        return result;
       if (projection_reservation.exists())
       {
         AutoLock p_lock(projection_reservation);
         if (req.handle_type == PART_PROJECTION)
         {
-          LogicalRegion result = functor->project(task, idx, 
-                                                  req.partition, point); 
+          result = functor->project(task, idx, req.partition, point); 
           check_projection_partition_result(req, task, idx, result, runtime);
-          return result;
         }
         else
         {
-          LogicalRegion result = functor->project(task, idx, req.region, point);
+          result = functor->project(task, idx, req.region, point);
           check_projection_region_result(req, task, idx, result, runtime);
-          return result;
         }
       }
       else
       {
         if (req.handle_type == PART_PROJECTION)
         {
-          LogicalRegion result = functor->project(task, idx, 
-                                                  req.partition, point);
+          result = functor->project(task, idx, req.partition, point);
           check_projection_partition_result(req, task, idx, result, runtime);
-          return result;
         }
         else
         {
-          LogicalRegion result = functor->project(task, idx, req.region, point);
+          result = functor->project(task, idx, req.region, point);
           check_projection_region_result(req, task, idx, result, runtime);
-          return result;
         }
       }
+      if (is_functional)
+        record_cached_projection(req, point, result);
+      return result;
     }
 
     //--------------------------------------------------------------------------
@@ -8456,31 +9562,43 @@ namespace Legion {
 #ifdef DEBUG_LEGION
       assert(req.handle_type != SINGULAR);
 #endif
+      // Functional projections only need to project the points that
+      // we have never seen before
+      std::vector<PointTask*> missing;
+      if (is_functional && 
+          find_cached_projections(req, idx, point_tasks, missing))
+        return;
+      const std::vector<PointTask*> &to_project = 
+        is_functional ? missing : point_tasks;
       if (projection_reservation.exists())
       {
         AutoLock p_lock(projection_reservation);
         if (req.handle_type == PART_PROJECTION)
         {
           for (std::vector<PointTask*>::const_iterator it = 
-                point_tasks.begin(); it != point_tasks.end(); it++)
+                to_project.begin(); it != to_project.end(); it++)
           {
             LogicalRegion result = functor->project(*it, idx, req.partition, 
                                                     (*it)->get_domain_point());
             check_projection_partition_result(req, static_cast<Task*>(*it), 
                                               idx, result, runtime);
             (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
           }
         }
         else
         {
           for (std::vector<PointTask*>::const_iterator it = 
-                point_tasks.begin(); it != point_tasks.end(); it++)
+                to_project.begin(); it != to_project.end(); it++)
           {
             LogicalRegion result = functor->project(*it, idx, req.region, 
                                                     (*it)->get_domain_point());
             check_projection_region_result(req, static_cast<Task*>(*it), 
                                            idx, result, runtime);
             (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
           }
         }
       }
@@ -8489,25 +9607,29 @@ namespace Legion {
         if (req.handle_type == PART_PROJECTION)
         {
           for (std::vector<PointTask*>::const_iterator it = 
-                point_tasks.begin(); it != point_tasks.end(); it++)
+                to_project.begin(); it != to_project.end(); it++)
           {
             LogicalRegion result = functor->project(*it, idx, req.partition, 
                                                     (*it)->get_domain_point());
             check_projection_partition_result(req, static_cast<Task*>(*it), 
                                               idx, result, runtime);
             (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
           }
         }
         else
         {
           for (std::vector<PointTask*>::const_iterator it = 
-                point_tasks.begin(); it != point_tasks.end(); it++)
+                to_project.begin(); it != to_project.end(); it++)
           {
             LogicalRegion result = functor->project(*it, idx, req.region, 
                                                     (*it)->get_domain_point());
             check_projection_region_result(req, static_cast<Task*>(*it), 
                                            idx, result, runtime);
             (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
           }
         }
       }
@@ -8524,29 +9646,40 @@ namespace Legion {
       assert(req.handle_type != SINGULAR);
       assert(mappable != NULL);
 #endif
+      // Functional projections only need to project the points that
+      // we have never seen before
+      std::vector<ProjectionPoint*> missing;
+      if (is_functional && find_cached_projections(req, idx, points, missing))
+        return;
+      const std::vector<ProjectionPoint*> &to_project = 
+        is_functional ? missing : points;
       if (projection_reservation.exists())
       {
         AutoLock p_lock(projection_reservation);
         if (req.handle_type == PART_PROJECTION)
         {
           for (std::vector<ProjectionPoint*>::const_iterator it = 
-                points.begin(); it != points.end(); it++)
+                to_project.begin(); it != to_project.end(); it++)
           {
             LogicalRegion result = functor->project(mappable, idx, 
                 req.partition, (*it)->get_domain_point());
             check_projection_partition_result(req, op, idx, result, runtime);
             (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
           }
         }
         else
         {
           for (std::vector<ProjectionPoint*>::const_iterator it = 
-                points.begin(); it != points.end(); it++)
+                to_project.begin(); it != to_project.end(); it++)
           {
             LogicalRegion result = functor->project(mappable, idx, req.region,
                                                     (*it)->get_domain_point());
             check_projection_region_result(req, op, idx, result, runtime);
             (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
           }
         }
       }
@@ -8555,26 +9688,120 @@ namespace Legion {
         if (req.handle_type == PART_PROJECTION)
         {
           for (std::vector<ProjectionPoint*>::const_iterator it = 
-                points.begin(); it != points.end(); it++)
+                to_project.begin(); it != to_project.end(); it++)
           {
             LogicalRegion result = functor->project(mappable, idx,
                 req.partition, (*it)->get_domain_point());
             check_projection_partition_result(req, op, idx, result, runtime);
             (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
           }
         }
         else
-        {
-          for (std::vector<ProjectionPoint*>::const_iterator it = 
-                points.begin(); it != points.end(); it++)
-          {
-            LogicalRegion result = functor->project(mappable, idx, req.region,
-                                                    (*it)->get_domain_point());
-            check_projection_region_result(req, op, idx, result, runtime);
-            (*it)->set_projection_result(idx, result);
-          }
-        }
+        {
+          for (std::vector<ProjectionPoint*>::const_iterator it = 
+                to_project.begin(); it != to_project.end(); it++)
+          {
+            LogicalRegion result = functor->project(mappable, idx, req.region,
+                                                    (*it)->get_domain_point());
+            check_projection_region_result(req, op, idx, result, runtime);
+            (*it)->set_projection_result(idx, result);
+            if (is_functional)
+              record_cached_projection(req, (*it)->get_domain_point(), result);
+          }
+        }
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    bool ProjectionFunction::find_cached_projection(
+                 const RegionRequirement &req, const DomainPoint &point, 
+                 LogicalRegion &result)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock c_lock(cache_reservation,1,false/*exclusive*/);
+      const std::map<DomainPoint,LogicalRegion> *cache = NULL;
+      if (req.handle_type == PART_PROJECTION)
+      {
+        std::map<LogicalPartition,
+                 std::map<DomainPoint,LogicalRegion> >::const_iterator
+                   finder = partition_cache.find(req.partition);
+        if (finder == partition_cache.end())
+          return false;
+        cache = &finder->second;
+      }
+      else
+      {
+        std::map<LogicalRegion,
+                 std::map<DomainPoint,LogicalRegion> >::const_iterator
+                   finder = region_cache.find(req.region);
+        if (finder == region_cache.end())
+          return false;
+        cache = &finder->second;
+      }
+      std::map<DomainPoint,LogicalRegion>::const_iterator finder = 
+        cache->find(point);
+      if (finder == cache->end())
+        return false;
+      result = finder->second;
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    template<typename T>
+    bool ProjectionFunction::find_cached_projections(
+                 const RegionRequirement &req, unsigned idx,
+                 const std::vector<T*> &points, std::vector<T*> &missing)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock c_lock(cache_reservation,1,false/*exclusive*/);
+      const std::map<DomainPoint,LogicalRegion> *cache = NULL;
+      if (req.handle_type == PART_PROJECTION)
+      {
+        std::map<LogicalPartition,
+                 std::map<DomainPoint,LogicalRegion> >::const_iterator
+                   finder = partition_cache.find(req.partition);
+        if (finder != partition_cache.end())
+          cache = &finder->second;
+      }
+      else
+      {
+        std::map<LogicalRegion,
+                 std::map<DomainPoint,LogicalRegion> >::const_iterator
+                   finder = region_cache.find(req.region);
+        if (finder != region_cache.end())
+          cache = &finder->second;
+      }
+      if (cache == NULL)
+      {
+        missing = points;
+        return false;
+      }
+      for (typename std::vector<T*>::const_iterator it = 
+            points.begin(); it != points.end(); it++)
+      {
+        std::map<DomainPoint,LogicalRegion>::const_iterator finder = 
+          cache->find((*it)->get_domain_point());
+        if (finder != cache->end())
+          (*it)->set_projection_result(idx, finder->second);
+        else
+          missing.push_back(*it);
       }
+      return missing.empty();
+    }
+
+    //--------------------------------------------------------------------------
+    void ProjectionFunction::record_cached_projection(
+                 const RegionRequirement &req, const DomainPoint &point, 
+                 LogicalRegion result)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock c_lock(cache_reservation);
+      if (req.handle_type == PART_PROJECTION)
+        partition_cache[req.partition][point] = result;
+      else
+        region_cache[req.region][point] = result;
     }
 
     //--------------------------------------------------------------------------
@@ -8756,6 +9983,7 @@ namespace Legion {
         message_manager_lock(Reservation::create_reservation()),
         proc_spaces(processor_spaces),
         task_variant_lock(Reservation::create_reservation()),
+        batch_realm_registrations(false),
         layout_constraints_lock(Reservation::create_reservation()),
         unique_index_space_id((unique == 0) ? runtime_stride : unique),
         unique_index_partition_id((unique == 0) ? runtime_stride : unique), 
@@ -8776,7 +10004,9 @@ namespace Legion {
         processor_mapping_lock(Reservation::create_reservation()),
         distributed_id_lock(Reservation::create_reservation()),
         unique_distributed_id((unique == 0) ? runtime_stride : unique),
+        available_distributed_count(0),
         distributed_collectable_lock(Reservation::create_reservation()),
+        reference_release_lock(Reservation::create_reservation()),
         is_launch_lock(Reservation::create_reservation()),
         gc_epoch_lock(Reservation::create_reservation()), gc_epoch_counter(0),
         context_lock(Reservation::create_reservation()),
@@ -9300,6 +10530,8 @@ namespace Legion {
       distributed_id_lock = Reservation::NO_RESERVATION;
       distributed_collectable_lock.destroy_reservation();
       distributed_collectable_lock = Reservation::NO_RESERVATION;
+      reference_release_lock.destroy_reservation();
+      reference_release_lock = Reservation::NO_RESERVATION;
       is_launch_lock.destroy_reservation();
       is_launch_lock = Reservation::NO_RESERVATION;
       gc_epoch_lock.destroy_reservation();
@@ -9331,6 +10563,13 @@ namespace Legion {
         get_pending_variant_table();
       if (!pending_variants.empty())
       {
+        // Batch up the Realm registrations for all the static variants
+        // so we make one registration per processor kind instead of 
+        // one for every variant
+        {
+          AutoLock tv_lock(task_variant_lock);
+          batch_realm_registrations = true;
+        }
         for (std::deque<PendingVariantRegistration*>::const_iterator it =
               pending_variants.begin(); it != pending_variants.end(); it++)
         {
@@ -9339,6 +10578,14 @@ namespace Legion {
           if (!Runtime::separate_runtime_instances)
             delete *it;
         }
+        std::vector<VariantImpl*> to_register;
+        {
+          AutoLock tv_lock(task_variant_lock);
+          batch_realm_registrations = false;
+          to_register.swap(pending_realm_registrations);
+        }
+        if (!to_register.empty())
+          VariantImpl::register_realm_variants(to_register);
         // avoid races on separate runtime instances
         if (!Runtime::separate_runtime_instances)
           pending_variants.clear();
@@ -9405,7 +10652,13 @@ namespace Legion {
                                     Runtime::prof_logfile,
                                     total_address_spaces,
                                     Runtime::prof_footprint_threshold,
-                                    Runtime::prof_target_latency);
+                                    Runtime::prof_target_latency,
+                                    Runtime::prof_counters,
+                                    Runtime::prof_proc_chunks,
+                                    Runtime::prof_sample_interval,
+                                    Runtime::prof_sample_random,
+                                    Runtime::prof_sample_tasks,
+                                    Runtime::prof_aggregate);
       LG_MESSAGE_DESCRIPTIONS(lg_message_descriptions);
       profiler->record_message_kinds(lg_message_descriptions, LAST_SEND_KIND);
       MAPPER_CALL_NAMES(lg_mapper_calls);
@@ -10046,6 +11299,26 @@ namespace Legion {
       return result;
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::begin_dependent_partition_batch(Context ctx)
+    //--------------------------------------------------------------------------
+    {
+      if (ctx == DUMMY_CONTEXT)
+        REPORT_DUMMY_CONTEXT(
+            "Illegal dummy context begin dependent partition batch!");
+      ctx->begin_dependent_partition_batch();
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::end_dependent_partition_batch(Context ctx)
+    //--------------------------------------------------------------------------
+    {
+      if (ctx == DUMMY_CONTEXT)
+        REPORT_DUMMY_CONTEXT(
+            "Illegal dummy context end dependent partition batch!");
+      ctx->end_dependent_partition_batch();
+    }
+
     //--------------------------------------------------------------------------
     IndexPartition Runtime::create_pending_partition(Context ctx, 
                                                      IndexSpace parent, 
@@ -11540,7 +12813,7 @@ namespace Legion {
                     "task %s (ID %lld)", tid, ctx->get_task_name(),
                     ctx->get_unique_id());
 #endif
-      FutureImpl *result = new FutureImpl(this, true/*register*/,
+      FutureImpl *result = new FutureImpl(this, false/*register*/,
                               get_available_distributed_id(true),
                               address_space, ctx->get_owner_task());
       // Make this here to get a local reference on it now
@@ -12224,6 +13497,17 @@ namespace Legion {
       return vid;
     }
 
+    //--------------------------------------------------------------------------
+    bool Runtime::defer_realm_registration(VariantImpl *impl)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock tv_lock(task_variant_lock);
+      if (!batch_realm_registrations)
+        return false;
+      pending_realm_registrations.push_back(impl);
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     TaskImpl* Runtime::find_or_create_task_impl(TaskID task_id)
     //--------------------------------------------------------------------------
@@ -12988,6 +14272,36 @@ namespace Legion {
            DEFAULT_VIRTUAL_CHANNEL, true/*flush*/, true/*response*/);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::send_slice_distribution(AddressSpaceID target, 
+                                          Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      // Same channel as the task messages that it carries
+      find_messenger(target)->send_message(rez, SLICE_DISTRIBUTION,
+                                    DEFAULT_VIRTUAL_CHANNEL, true/*flush*/);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::send_slice_aggregate_return(AddressSpaceID target,
+                                              Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      // Very important that this goes on the physical state channel
+      // so that it is properly serialized with state updates
+      find_messenger(target)->send_message(rez, SLICE_AGGREGATE_RETURN,
+           DEFAULT_VIRTUAL_CHANNEL, true/*flush*/, true/*response*/);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::send_slice_aggregate_count(AddressSpaceID target,
+                                             Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      find_messenger(target)->send_message(rez, SLICE_AGGREGATE_COUNT,
+           DEFAULT_VIRTUAL_CHANNEL, true/*flush*/, true/*response*/);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::send_did_remote_registration(AddressSpaceID target, 
                                                Serializer &rez)
@@ -13024,6 +14338,15 @@ namespace Legion {
                                     REFERENCE_VIRTUAL_CHANNEL, true/*flush*/);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::send_did_remote_release_batch(AddressSpaceID target,
+                                                Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      find_messenger(target)->send_message(rez, DISTRIBUTED_RELEASE_BATCH,
+                                    REFERENCE_VIRTUAL_CHANNEL, true/*flush*/);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::send_did_add_create_reference(AddressSpaceID target,
                                                  Serializer &rez)
@@ -13241,6 +14564,24 @@ namespace Legion {
                   FUTURE_VIRTUAL_CHANNEL, true/*flush*/, true/*response*/);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::send_future_map_request_all(AddressSpaceID target,
+                                              Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      find_messenger(target)->send_message(rez, SEND_FUTURE_MAP_ALL_REQUEST,
+                                        FUTURE_VIRTUAL_CHANNEL, true/*flush*/);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::send_future_map_response_all(AddressSpaceID target,
+                                               Serializer &rez)
+    //--------------------------------------------------------------------------
+    {
+      find_messenger(target)->send_message(rez, SEND_FUTURE_MAP_ALL_RESPONSE,
+                  FUTURE_VIRTUAL_CHANNEL, true/*flush*/, true/*response*/);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::send_mapper_message(AddressSpaceID target, Serializer &rez)
     //--------------------------------------------------------------------------
@@ -14056,6 +15397,28 @@ namespace Legion {
       IndexTask::process_slice_commit(derez);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::handle_slice_distribution(Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      SliceAggregator::handle_slice_distribution(this, derez);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::handle_slice_aggregate_return(Deserializer &derez,
+                                                AddressSpaceID source)
+    //--------------------------------------------------------------------------
+    {
+      SliceAggregator::handle_aggregate_return(this, derez, source);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::handle_slice_aggregate_count(Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      SliceAggregator::handle_aggregate_count(this, derez);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::handle_did_remote_registration(Deserializer &derez,
                                                  AddressSpaceID source)
@@ -14085,6 +15448,13 @@ namespace Legion {
       DistributedCollectable::handle_did_remote_resource_update(this, derez); 
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::handle_did_remote_release_batch(Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      DistributedCollectable::handle_did_remote_release_batch(this, derez);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::handle_did_create_add(Deserializer &derez)
     //--------------------------------------------------------------------------
@@ -14290,6 +15660,21 @@ namespace Legion {
       FutureMapImpl::handle_future_map_future_response(derez, this);
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::handle_future_map_all_request(Deserializer &derez,
+                                                AddressSpaceID source)
+    //--------------------------------------------------------------------------
+    {
+      FutureMapImpl::handle_future_map_all_request(derez, this, source);
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::handle_future_map_all_response(Deserializer &derez)
+    //--------------------------------------------------------------------------
+    {
+      FutureMapImpl::handle_future_map_all_response(derez, this);
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::handle_mapper_message(Deserializer &derez)
     //--------------------------------------------------------------------------
@@ -14895,7 +16280,8 @@ namespace Legion {
     }
 
     //--------------------------------------------------------------------------
-    void Runtime::process_schedule_request(Processor proc)
+    void Runtime::process_schedule_request(Processor proc, 
+                                           unsigned generation)
     //--------------------------------------------------------------------------
     {
 #ifdef DEBUG_LEGION
@@ -14903,7 +16289,7 @@ namespace Legion {
 #endif
       log_run.debug("Running scheduler on processor " IDFMT "", proc.id);
       ProcessorManager *manager = proc_managers[proc];
-      manager->perform_scheduling();
+      manager->perform_scheduling(generation);
 #ifdef TRACE_ALLOCATION
       unsigned long long trace_count = 
         __sync_fetch_and_add(&allocation_tracing_count,1); 
@@ -15080,6 +16466,41 @@ namespace Legion {
                                                         bool has_lock)
     //--------------------------------------------------------------------------
     {
+      if (!has_lock)
+      {
+        if (local_did_owner == NULL)
+          local_did_owner = this;
+        if (local_did_owner == this)
+        {
+          // See if we have any recycled IDs in our local cache first
+          if (local_did_count > 0)
+            return local_dids[--local_did_count];
+          // Then see if we have any left in our block of fresh IDs
+          if (local_did_next < local_did_limit)
+          {
+            const DistributedID result = local_did_next;
+            local_did_next += runtime_stride;
+            return result;
+          }
+          // If nobody has handed back any IDs to the runtime then
+          // we can reserve a new block without taking the lock
+          if (available_distributed_count == 0)
+          {
+            const DistributedID result = 
+              __sync_fetch_and_add(&unique_distributed_id,
+                  LEGION_DISTRIBUTED_ID_BLOCK * runtime_stride);
+            local_did_next = result + runtime_stride;
+            local_did_limit = 
+              result + LEGION_DISTRIBUTED_ID_BLOCK * runtime_stride;
+#ifdef DEBUG_LEGION
+            assert(local_did_limit <= LEGION_DISTRIBUTED_ID_MASK);
+#endif
+            return result;
+          }
+        }
+      }
+      // Note the code below can run on a different thread when it is
+      // done as a continuation so it must not touch the local caches
       if (need_cont)
       {
 #ifdef DEBUG_LEGION
@@ -15099,10 +16520,11 @@ namespace Legion {
       {
         DistributedID result = available_distributed_ids.front();
         available_distributed_ids.pop_front();
+        available_distributed_count--;
         return result;
       }
-      DistributedID result = unique_distributed_id;
-      unique_distributed_id += runtime_stride;
+      DistributedID result = 
+        __sync_fetch_and_add(&unique_distributed_id, runtime_stride);
 #ifdef DEBUG_LEGION
       assert(result < LEGION_DISTRIBUTED_ID_MASK);
 #endif
@@ -15121,8 +16543,33 @@ namespace Legion {
       // Don't recycle distributed IDs if we're doing LegionSpy or LegionGC
 #ifndef LEGION_GC
 #ifndef LEGION_SPY
-      AutoLock d_lock(distributed_id_lock);
-      available_distributed_ids.push_back(did);
+      if (local_did_owner == NULL)
+        local_did_owner = this;
+      if (local_did_owner != this)
+      {
+        AutoLock d_lock(distributed_id_lock);
+        available_distributed_ids.push_back(did);
+        available_distributed_count++;
+      }
+      else if (local_did_count == LEGION_DISTRIBUTED_ID_CACHE)
+      {
+        // Our local cache is full so hand half of it back to the
+        // runtime in one batch where other threads can get them.
+        // Pull them out before taking the lock since we might end
+        // up running on a different thread once we get it.
+        const unsigned to_move = LEGION_DISTRIBUTED_ID_CACHE / 2;
+        DistributedID batch[LEGION_DISTRIBUTED_ID_CACHE / 2];
+        local_did_count -= to_move;
+        for (unsigned idx = 0; idx < to_move; idx++)
+          batch[idx] = local_dids[local_did_count + idx];
+        local_dids[local_did_count++] = did;
+        AutoLock d_lock(distributed_id_lock);
+        for (unsigned idx = 0; idx < to_move; idx++)
+          available_distributed_ids.push_back(batch[idx]);
+        available_distributed_count += to_move;
+      }
+      else
+        local_dids[local_did_count++] = did;
 #endif
 #endif
 #ifdef DEBUG_LEGION
@@ -15301,6 +16748,73 @@ namespace Legion {
       return false;
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::defer_remote_reference_release(AddressSpaceID target,
+                                                 DistributedID did,
+                                                 ReferenceKind kind,
+                                                 unsigned count, bool is_owner)
+    //--------------------------------------------------------------------------
+    {
+      // Removing references late is always safe since it can only delay
+      // collection, so we accumulate them per node and let a meta-task
+      // send everything that builds up before it runs as one message
+      bool launch_flush = false;
+      {
+        AutoLock r_lock(reference_release_lock);
+        std::map<AddressSpaceID,std::map<DistributedID,
+          PendingReferenceRelease> >::iterator finder = 
+            pending_reference_releases.find(target);
+        if (finder == pending_reference_releases.end())
+        {
+          finder = pending_reference_releases.insert(std::make_pair(target,
+                std::map<DistributedID,PendingReferenceRelease>())).first;
+          launch_flush = true;
+        }
+        PendingReferenceRelease &pending = finder->second[did];
+        pending.counts[kind] += count;
+        pending.is_owner = is_owner;
+      }
+      if (launch_flush)
+      {
+        FlushReferenceReleasesArgs args;
+        args.target = target;
+        issue_runtime_meta_task(args, LG_THROUGHPUT_PRIORITY);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void Runtime::flush_remote_reference_releases(AddressSpaceID target)
+    //--------------------------------------------------------------------------
+    {
+      std::map<DistributedID,PendingReferenceRelease> releases;
+      {
+        AutoLock r_lock(reference_release_lock);
+        std::map<AddressSpaceID,std::map<DistributedID,
+          PendingReferenceRelease> >::iterator finder = 
+            pending_reference_releases.find(target);
+#ifdef DEBUG_LEGION
+        assert(finder != pending_reference_releases.end());
+#endif
+        releases.swap(finder->second);
+        pending_reference_releases.erase(finder);
+      }
+      Serializer rez;
+      {
+        RezCheck z(rez);
+        rez.serialize<size_t>(releases.size());
+        for (std::map<DistributedID,PendingReferenceRelease>::const_iterator
+              it = releases.begin(); it != releases.end(); it++)
+        {
+          rez.serialize(it->first);
+          rez.serialize<bool>(it->second.is_owner);
+          rez.serialize(it->second.counts[VALID_REF_KIND]);
+          rez.serialize(it->second.counts[GC_REF_KIND]);
+          rez.serialize(it->second.counts[RESOURCE_REF_KIND]);
+        }
+      }
+      send_did_remote_release_batch(target, rez);
+    }
+
     //--------------------------------------------------------------------------
     LogicalView* Runtime::find_or_request_logical_view(DistributedID did,
                                                        RtEvent &ready)
@@ -15666,20 +17180,18 @@ namespace Legion {
       log_shutdown.info("Received notification on node %d for phase %d",
                         address_space, phase);
       // If this is the first phase, do all our normal stuff
+      RtEvent gc_done;
       if (phase == ShutdownManager::CHECK_TERMINATION)
       {
-        // Launch our last garbage collection epoch and wait for it to
-        // finish so we can try to have no outstanding tasks
-        RtEvent gc_done;
+        // Launch our last garbage collection epoch, the shutdown manager
+        // will wait for it to finish after notifying the nodes below us
+        // so the whole tree collects in parallel
+        AutoLock gc(gc_epoch_lock);
+        if (current_gc_epoch != NULL)
         {
-          AutoLock gc(gc_epoch_lock);
-          if (current_gc_epoch != NULL)
-          {
-            gc_done = current_gc_epoch->launch();
-            current_gc_epoch = NULL;
-          }
+          gc_done = current_gc_epoch->launch();
+          current_gc_epoch = NULL;
         }
-        gc_done.lg_wait();
       }
       else if ((phase == ShutdownManager::CHECK_SHUTDOWN) && 
                 !prepared_for_shutdown)
@@ -15690,7 +17202,7 @@ namespace Legion {
       ShutdownManager *shutdown_manager = 
         new ShutdownManager(phase, this, source, 
                             LEGION_SHUTDOWN_RADIX, owner);
-      if (shutdown_manager->attempt_shutdown())
+      if (shutdown_manager->attempt_shutdown(gc_done))
         delete shutdown_manager;
     }
 
@@ -15722,10 +17234,22 @@ namespace Legion {
 #endif
       }
       // Check all our message managers for outstanding messages
+      // Any channels still waiting on an acknowledgement get one
+      // shared grace period before we check them again
+      std::vector<MessageManager*> to_retry;
       for (unsigned idx = 0; idx < MAX_NUM_NODES; idx++)
       {
-        if (message_managers[idx] != NULL)
-          message_managers[idx]->confirm_shutdown(shutdown_manager, phase_one);
+        if ((message_managers[idx] != NULL) && 
+            message_managers[idx]->confirm_shutdown(shutdown_manager, 
+                                            phase_one, false/*retry*/))
+          to_retry.push_back(message_managers[idx]);
+      }
+      if (!to_retry.empty())
+      {
+        usleep(1000);
+        for (std::vector<MessageManager*>::const_iterator it = 
+              to_retry.begin(); it != to_retry.end(); it++)
+          (*it)->confirm_shutdown(shutdown_manager, phase_one, true/*retry*/);
       }
     }
 
@@ -17274,7 +18798,7 @@ namespace Legion {
     Future Runtime::help_create_future(Operation *op /*= NULL*/)
     //--------------------------------------------------------------------------
     {
-      return Future(new FutureImpl(this, true/*register*/,
+      return Future(new FutureImpl(this, false/*register*/,
                                    get_available_distributed_id(true),
                                    address_space, op));
     }
@@ -17331,6 +18855,35 @@ namespace Legion {
       finder->second.diff_bytes -= free_size;
     }
 
+    //--------------------------------------------------------------------------
+    void Runtime::trace_slab(AllocationType type, SlabEventKind kind)
+    //--------------------------------------------------------------------------
+    {
+      AutoLock a_lock(allocation_lock);
+      std::map<AllocationType,AllocationTracker>::iterator finder = 
+        allocation_manager.find(type);
+      switch (kind)
+      {
+        case SLAB_CREATED_EVENT:
+          {
+            finder->second.slabs_created++;
+            break;
+          }
+        case SLAB_REFILL_EVENT:
+          {
+            finder->second.slab_refills++;
+            break;
+          }
+        case SLAB_RETURN_EVENT:
+          {
+            finder->second.slab_returns++;
+            break;
+          }
+        default:
+          assert(false);
+      }
+    }
+
     //--------------------------------------------------------------------------
     void Runtime::dump_allocation_info(void)
     //--------------------------------------------------------------------------
@@ -17350,11 +18903,17 @@ namespace Legion {
             get_allocation_name(it->first), address_space,
             it->second.total_allocations, it->second.total_bytes,
             it->second.diff_allocations, it->second.diff_bytes);
+        if (it->second.slabs_created > 0)
+          log_allocation.info("%s on %d: slabs=%d refills=%d returns=%d",
+              get_allocation_name(it->first), address_space,
+              it->second.slabs_created, it->second.slab_refills,
+              it->second.slab_returns);
         it->second.diff_allocations = 0;
         it->second.diff_bytes = 0;
       }
       log_allocation.info(" ");
     }
+#endif
 
     //--------------------------------------------------------------------------
     /*static*/ const char* Runtime::get_allocation_name(AllocationType type)
@@ -17567,7 +19126,27 @@ namespace Legion {
       }
       return NULL;
     }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void Runtime::get_internal_memory_usage(
+                      std::map<std::string,std::pair<size_t,size_t> > &usage)
+    //--------------------------------------------------------------------------
+    {
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+      long long bytes[LAST_ALLOC];
+      long long count[LAST_ALLOC];
+      AllocationCounters::sum_counters(bytes, count);
+      for (int idx = 0; idx < LAST_ALLOC; idx++)
+      {
+        // Sums can be briefly negative while other threads are still
+        // allocating and freeing, so skip anything that isn't live
+        if ((bytes[idx] <= 0) || (count[idx] <= 0))
+          continue;
+        usage[get_allocation_name(AllocationType(idx))] =
+          std::pair<size_t,size_t>(bytes[idx], count[idx]);
+      }
 #endif
+    }
 
 #ifdef DEBUG_LEGION
     //--------------------------------------------------------------------------
@@ -18021,14 +19600,32 @@ namespace Legion {
                                       DEFAULT_MAX_TASK_WINDOW;
     /*static*/ unsigned Runtime::initial_task_window_hysteresis =
                                       DEFAULT_TASK_WINDOW_HYSTERESIS;
+    /*static*/ bool Runtime::adaptive_task_window = false;
+    /*static*/ int Runtime::adaptive_window_min = LEGION_ADAPTIVE_WINDOW_MIN;
+    /*static*/ int Runtime::adaptive_window_max = LEGION_ADAPTIVE_WINDOW_MAX;
     /*static*/ unsigned Runtime::initial_tasks_to_schedule = 
                                       DEFAULT_MIN_TASKS_TO_SCHEDULE;
     /*static*/ unsigned Runtime::max_message_size = 
                                       DEFAULT_MAX_MESSAGE_SIZE;
+    /*static*/ unsigned Runtime::message_aggregation_window = 
+                                      LEGION_DEFAULT_MESSAGE_WINDOW;
+    /*static*/ unsigned Runtime::small_message_size = 
+                                      LEGION_SMALL_MESSAGE_SIZE;
+    /*static*/ bool Runtime::message_statistics = false;
+    /*static*/ bool Runtime::copy_statistics = false;
+    /*static*/ int Runtime::slice_distribution_radix = 
+                                      LEGION_SLICE_DISTRIBUTION_RADIX;
     /*static*/ unsigned Runtime::gc_epoch_size = 
                                       DEFAULT_GC_EPOCH_SIZE;
     /*static*/ unsigned Runtime::max_local_fields = 
                                       DEFAULT_LOCAL_FIELDS;
+    /*static*/ unsigned Runtime::instance_recycle_window = 
+                                      DEFAULT_INSTANCE_RECYCLE_WINDOW;
+    /*static*/ unsigned Runtime::gc_high_water_mark = 
+                                      DEFAULT_GC_HIGH_WATER_MARK;
+    /*static*/ unsigned Runtime::max_map_task_batch = 
+                                      DEFAULT_MAP_TASK_BATCH_SIZE;
+    /*static*/ unsigned Runtime::handshake_spin_time = 0;
     /*static*/ bool Runtime::runtime_started = false;
     /*static*/ bool Runtime::runtime_backgrounded = false;
     /*static*/ bool Runtime::runtime_warnings = false;
@@ -18044,6 +19641,7 @@ namespace Legion {
 #endif
     /*static*/ bool Runtime::dynamic_independence_tests = true;
     /*static*/ bool Runtime::legion_spy_enabled = false;
+    /*static*/ const char* Runtime::legion_spy_logfile = NULL;
     /*static*/ bool Runtime::enable_test_mapper = false;
     /*static*/ bool Runtime::legion_ldb_enabled = false;
     /*static*/ const char* Runtime::replay_file = NULL;
@@ -18061,6 +19659,10 @@ namespace Legion {
                       Runtime::pending_handshakes = NULL;
     /*static*/ bool Runtime::program_order_execution = false;
     /*static*/ bool Runtime::verify_disjointness = false;
+    /*static*/ bool Runtime::cache_dependent_partitions = false;
+    /*static*/ unsigned Runtime::auto_trace_max_length = 0;
+    /*static*/ bool Runtime::parallel_logical_analysis = false;
+    /*static*/ bool Runtime::mapper_call_statistics = false;
 #ifdef DEBUG_LEGION
     /*static*/ bool Runtime::logging_region_tree_state = false;
     /*static*/ bool Runtime::verbose_logging = false;
@@ -18074,6 +19676,12 @@ namespace Legion {
     /*static*/ const char* Runtime::prof_logfile = NULL;
     /*static*/ size_t Runtime::prof_footprint_threshold = 128 << 20;
     /*static*/ size_t Runtime::prof_target_latency = 100;
+    /*static*/ bool Runtime::prof_counters = false;
+    /*static*/ bool Runtime::prof_proc_chunks = false;
+    /*static*/ unsigned Runtime::prof_sample_interval = 1;
+    /*static*/ bool Runtime::prof_sample_random = false;
+    /*static*/ const char* Runtime::prof_sample_tasks = NULL;
+    /*static*/ bool Runtime::prof_aggregate = false;
     /*static*/ bool Runtime::slow_debug_ok = false;
 #ifdef TRACE_ALLOCATION
     /*static*/ std::map<AllocationType,Runtime::AllocationTracker>
@@ -18172,22 +19780,45 @@ namespace Legion {
 #else
         legion_spy_enabled = false;
 #endif
+        legion_spy_logfile = NULL;
         enable_test_mapper = false;
         legion_ldb_enabled = false;
         replay_file = NULL;
         initial_task_window_size = DEFAULT_MAX_TASK_WINDOW;
         initial_task_window_hysteresis = DEFAULT_TASK_WINDOW_HYSTERESIS;
+        adaptive_task_window = false;
+        adaptive_window_min = LEGION_ADAPTIVE_WINDOW_MIN;
+        adaptive_window_max = LEGION_ADAPTIVE_WINDOW_MAX;
         initial_tasks_to_schedule = DEFAULT_MIN_TASKS_TO_SCHEDULE;
         max_message_size = DEFAULT_MAX_MESSAGE_SIZE;
+        message_aggregation_window = LEGION_DEFAULT_MESSAGE_WINDOW;
+        small_message_size = LEGION_SMALL_MESSAGE_SIZE;
+        message_statistics = false;
+        copy_statistics = false;
+        slice_distribution_radix = LEGION_SLICE_DISTRIBUTION_RADIX;
         gc_epoch_size = DEFAULT_GC_EPOCH_SIZE;
         max_local_fields = DEFAULT_LOCAL_FIELDS;
+        instance_recycle_window = DEFAULT_INSTANCE_RECYCLE_WINDOW;
+        gc_high_water_mark = DEFAULT_GC_HIGH_WATER_MARK;
+        max_map_task_batch = DEFAULT_MAP_TASK_BATCH_SIZE;
+        handshake_spin_time = 0;
         program_order_execution = false;
+        mapper_call_statistics = false;
         verify_disjointness = false;
+        cache_dependent_partitions = false;
+        auto_trace_max_length = 0;
+        parallel_logical_analysis = false;
         num_profiling_nodes = 0;
         serializer_type = "binary";
         prof_logfile = NULL;
         prof_footprint_threshold = 128 << 20;
         prof_target_latency = 100;
+        prof_counters = false;
+        prof_proc_chunks = false;
+        prof_sample_interval = 1;
+        prof_sample_random = false;
+        prof_sample_tasks = NULL;
+        prof_aggregate = false;
 	slow_debug_ok = false;
         legion_collective_radix = LEGION_COLLECTIVE_RADIX;
         legion_collective_log_radix = 0;
@@ -18216,16 +19847,37 @@ namespace Legion {
           if (!strcmp(argv[i],"-lg:safe_mapper"))
             unsafe_mapper = false;
           BOOL_ARG("-lg:inorder",program_order_execution);
+          BOOL_ARG("-lg:mapper_stats",mapper_call_statistics);
           BOOL_ARG("-lg:disjointness",verify_disjointness);
+          BOOL_ARG("-lg:partition_cache",cache_dependent_partitions);
+          INT_ARG("-lg:auto_trace", auto_trace_max_length);
+          BOOL_ARG("-lg:parallel_analysis",parallel_logical_analysis);
           INT_ARG("-lg:window", initial_task_window_size);
           INT_ARG("-lg:hysteresis", initial_task_window_hysteresis);
+          BOOL_ARG("-lg:window_adaptive", adaptive_task_window);
+          INT_ARG("-lg:window_min", adaptive_window_min);
+          INT_ARG("-lg:window_max", adaptive_window_max);
           INT_ARG("-lg:sched", initial_tasks_to_schedule);
           INT_ARG("-lg:message",max_message_size);
+          INT_ARG("-lg:message_window",message_aggregation_window);
+          INT_ARG("-lg:small_message",small_message_size);
+          INT_ARG("-lg:slice_radix",slice_distribution_radix);
+          BOOL_ARG("-lg:message_stats",message_statistics);
+          BOOL_ARG("-lg:copy_stats",copy_statistics);
           INT_ARG("-lg:epoch", gc_epoch_size);
           INT_ARG("-lg:local", max_local_fields);
+          INT_ARG("-lg:recycle", instance_recycle_window);
+          INT_ARG("-lg:gc_high_water", gc_high_water_mark);
+          INT_ARG("-lg:map_batch", max_map_task_batch);
+          INT_ARG("-lg:handshake_spin", handshake_spin_time);
           if (!strcmp(argv[i],"-lg:no_dyn"))
             dynamic_independence_tests = false;
           BOOL_ARG("-lg:spy",legion_spy_enabled);
+          if (!strcmp(argv[i],"-lg:spy_logfile"))
+          {
+            legion_spy_logfile = argv[++i];
+            continue;
+          }
           BOOL_ARG("-lg:test",enable_test_mapper);
           INT_ARG("-lg:delay", delay_start);
           if (!strcmp(argv[i],"-lg:replay"))
@@ -18278,6 +19930,16 @@ namespace Legion {
             continue;
           }
           INT_ARG("-lg:prof_latency",prof_target_latency);
+          BOOL_ARG("-lg:prof_counters",prof_counters);
+          BOOL_ARG("-lg:prof_chunks",prof_proc_chunks);
+          INT_ARG("-lg:prof_sample",prof_sample_interval);
+          BOOL_ARG("-lg:prof_sample_random",prof_sample_random);
+          if (!strcmp(argv[i],"-lg:prof_sample_tasks"))
+          {
+            prof_sample_tasks = argv[++i];
+            continue;
+          }
+          BOOL_ARG("-lg:prof_aggregate",prof_aggregate);
 
 	  BOOL_ARG("-lg:debug_ok",slow_debug_ok);
           
@@ -18357,7 +20019,17 @@ namespace Legion {
 #endif
       }
       if (legion_spy_enabled)
+      {
+        // Switch Legion Spy over to its binary log before the first record
+        if (legion_spy_logfile != NULL)
+        {
+          Machine::ProcessorQuery local_procs(Machine::get_machine());
+          local_procs.local_address_space();
+          LegionSpy::open_binary_log(legion_spy_logfile,
+                                     local_procs.begin()->address_space());
+        }
         LegionSpy::log_legion_spy_config();
+      }
 #ifdef DEBUG_LEGION
       if ((num_profiling_nodes > 0) && !slow_debug_ok)
       {
@@ -19179,6 +20851,11 @@ namespace Legion {
                 LegionSpy::log_memory_kind(kind, "L1");
                 break;
               }
+            case GPU_MANAGED_MEM:
+              {
+                LegionSpy::log_memory_kind(kind, "Managed");
+                break;
+              }
             default:
               assert(false); // unknown memory kind
           }
@@ -19360,7 +21037,7 @@ namespace Legion {
             const ProcessorManager::SchedulerArgs *sched_args = 
               (const ProcessorManager::SchedulerArgs*)args;
             Runtime::get_runtime(p)->process_schedule_request(
-                                                            sched_args->proc);
+                                  sched_args->proc, sched_args->generation);
             break;
           }
         case LG_MESSAGE_ID:
@@ -19380,6 +21057,8 @@ namespace Legion {
           {
             const Operation::DeferredReadyArgs *deferred_ready_args = 
               (const Operation::DeferredReadyArgs*)args;
+            DETAILED_PROFILER(deferred_ready_args->proxy_this->runtime,
+                              OPERATION_TRIGGER_READY_CALL);
             deferred_ready_args->proxy_this->trigger_ready();
             break;
           }
@@ -19416,6 +21095,8 @@ namespace Legion {
           {
             const Operation::DeferredExecuteArgs *deferred_mapping_args = 
               (const Operation::DeferredExecuteArgs*)args;
+            DETAILED_PROFILER(deferred_mapping_args->proxy_this->runtime,
+                              OPERATION_DEFERRED_EXECUTE_CALL);
             deferred_mapping_args->proxy_this->deferred_execute();
             break;
           }
@@ -19461,6 +21142,8 @@ namespace Legion {
           {
             const Operation::TriggerCompleteArgs *trigger_complete_args =
               (const Operation::TriggerCompleteArgs*)args;
+            DETAILED_PROFILER(trigger_complete_args->proxy_this->runtime,
+                              OPERATION_TRIGGER_COMPLETE_CALL);
             trigger_complete_args->proxy_this->trigger_complete();
             break;
           }
@@ -19469,6 +21152,8 @@ namespace Legion {
             // Key off of args here instead of data
             const ProcessorManager::TriggerOpArgs *trigger_args = 
                             (const ProcessorManager::TriggerOpArgs*)args;
+            DETAILED_PROFILER(trigger_args->op->runtime,
+                              OPERATION_TRIGGER_MAPPING_CALL);
             trigger_args->op->trigger_mapping();
             break;
           }
@@ -19477,6 +21162,8 @@ namespace Legion {
             // Key off of args here instead of data
             const ProcessorManager::TriggerTaskArgs *trigger_args = 
                           (const ProcessorManager::TriggerTaskArgs*)args;
+            DETAILED_PROFILER(trigger_args->op->runtime,
+                              TASK_TRIGGER_MAPPING_CALL);
             trigger_args->op->trigger_mapping(); 
             break;
           }
@@ -19915,6 +21602,32 @@ namespace Legion {
             IndexSpaceNode::handle_tighten_index_space(args);
             break;
           }
+        case LG_LOGICAL_ANALYSIS_TASK_ID:
+          {
+            RegionTreeForest::handle_logical_analysis(args);
+            break;
+          }
+        case LG_EAGER_COLLECTION_TASK_ID:
+          {
+            MemoryManager::handle_eager_collection(args);
+            break;
+          }
+        case LG_FLUSH_REFERENCE_RELEASES_TASK_ID:
+          {
+            const FlushReferenceReleasesArgs *flush_args = 
+              (const FlushReferenceReleasesArgs*)args;
+            Runtime::get_runtime(p)->flush_remote_reference_releases(
+                                                        flush_args->target);
+            break;
+          }
+        case LG_FLUSH_AGGREGATED_MESSAGES_TASK_ID:
+          {
+            const VirtualChannel::FlushAggregatedArgs *flush_args = 
+              (const VirtualChannel::FlushAggregatedArgs*)args;
+            flush_args->channel->flush_aggregated_messages(
+                                Runtime::get_runtime(p), flush_args->target);
+            break;
+          }
         case LG_PROF_OUTPUT_TASK_ID:
           {
             const LegionProfiler::LgOutputTaskArgs *oargs = 
@@ -20083,6 +21796,51 @@ namespace Legion {
       cargs->continuation->execute();
     }
 
+#ifndef LEGION_DISABLE_ALLOCATION_COUNTERS
+    /*static*/ __thread AllocationCounters* AllocationCounters::local = NULL;
+    /*static*/ AllocationCounters* AllocationCounters::all_counters = NULL;
+
+    //--------------------------------------------------------------------------
+    /*static*/ AllocationCounters* AllocationCounters::register_thread(void)
+    //--------------------------------------------------------------------------
+    {
+      // Use calloc so that the counters start out at zero
+      AllocationCounters *result = 
+        static_cast<AllocationCounters*>(calloc(1, sizeof(AllocationCounters)));
+      assert(result != NULL);
+      // Leak these intentionally so the sums include exited threads
+      AllocationCounters *head;
+      do {
+        head = all_counters;
+        result->next = head;
+      } while (!__sync_bool_compare_and_swap(&all_counters, head, result));
+      local = result;
+      return result;
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void AllocationCounters::sum_counters(long long *bytes,
+                                                     long long *count)
+    //--------------------------------------------------------------------------
+    {
+      for (int idx = 0; idx < LAST_ALLOC; idx++)
+      {
+        bytes[idx] = 0;
+        count[idx] = 0;
+      }
+      for (const AllocationCounters *counters = 
+            __sync_fetch_and_add(&all_counters, 0); counters != NULL;
+            counters = counters->next)
+      {
+        for (int idx = 0; idx < LAST_ALLOC; idx++)
+        {
+          bytes[idx] += counters->bytes[idx];
+          count[idx] += counters->count[idx];
+        }
+      }
+    }
+#endif
+
 #ifdef TRACE_ALLOCATION
     //--------------------------------------------------------------------------
     /*static*/ void LegionAllocation::trace_allocation(
@@ -20140,6 +21898,16 @@ namespace Legion {
       }
       runtime->trace_free(a, size, elems);
     }
+
+    //--------------------------------------------------------------------------
+    /*static*/ void LegionAllocation::trace_slab(AllocationType a,
+                                                 SlabEventKind kind)
+    //--------------------------------------------------------------------------
+    {
+      Runtime *rt = Runtime::the_runtime;
+      if (rt != NULL)
+        rt->trace_slab(a, kind);
+    }
 #endif
 
   }; // namespace Internal 
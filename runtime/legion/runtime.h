@@ -170,6 +170,9 @@ namespace Legion {
     public:
       FutureMapImpl* freeze(TaskContext *ctx);
       void unfreeze(void);
+    protected:
+      // Check whether a point already holds exactly this argument
+      static bool same_argument(const Future &current, const TaskArgument &arg);
     public:
       Runtime *const runtime;
     private:
@@ -185,7 +188,10 @@ namespace Legion {
      * copy them from one node to another.  Future implementations
      * are always made first on the owner node and then moved
      * remotely.  We use the distributed collectable scheme
-     * to manage garbage collection of distributed futures
+     * to manage garbage collection of distributed futures.
+     * Futures are only registered with the runtime once they
+     * are packed up for another node, and small values are
+     * stored inline in the future rather than on the heap.
      */
     class FutureImpl : public DistributedCollectable,
                        public LegionHeapify<FutureImpl> {
@@ -230,6 +236,9 @@ namespace Legion {
       // A special function for predicates to peek
       // at the boolean value of a future if it is set
       bool get_boolean_value(bool &valid);
+      // Pack the name of the future for another node, which also
+      // registers it with the runtime if this is the first time
+      void pack_future(Serializer &rez);
     public:
       virtual void notify_active(ReferenceMutator *mutator);
       virtual void notify_valid(ReferenceMutator *mutator);
@@ -240,6 +249,7 @@ namespace Legion {
     protected:
       void mark_sampled(void);
       void broadcast_result(void);
+      void free_result(void);
       void register_waiter(AddressSpaceID sid);
     public:
       void record_future_registered(ReferenceMutator *creator);
@@ -260,6 +270,12 @@ namespace Legion {
       ApUserEvent ready_event;
       void *result; 
       size_t result_size;
+      // Small results live here instead of in a heap allocation
+      union {
+        long long as_int;
+        double as_double;
+        char bytes[LEGION_FUTURE_INLINE_SIZE];
+      } inline_result;
       volatile bool empty;
       volatile bool sampled;
       // On the owner node, keep track of the registered waiters
@@ -315,6 +331,17 @@ namespace Legion {
                               Runtime *runtime, AddressSpaceID source);
       static void handle_future_map_future_response(Deserializer &derez,
                                                     Runtime *runtime);
+    public:
+      // Fetch every point of a remote future map in one message
+      void request_all_futures(void);
+      void pack_all_futures(Serializer &rez);
+      void unpack_all_futures(Deserializer &derez, ReferenceMutator *mutator);
+      void send_all_futures(AddressSpaceID target);
+      AddressSpaceID get_gather_parent(void) const;
+      static void handle_future_map_all_request(Deserializer &derez,
+                              Runtime *runtime, AddressSpaceID source);
+      static void handle_future_map_all_response(Deserializer &derez,
+                                                 Runtime *runtime);
     public:
       TaskContext *const context;
       // Either an index space task or a must epoch op
@@ -324,6 +351,12 @@ namespace Legion {
       ApEvent ready_event;
       std::map<DomainPoint,Future> futures;
       bool valid;
+    private:
+      // Non-owner copies can pull the whole map down a radix tree
+      // rooted at the owner, each node caching it for its children
+      RtUserEvent all_futures_ready;
+      std::vector<AddressSpaceID> all_futures_waiters;
+      bool has_all_futures;
 #ifdef DEBUG_LEGION
     private:
       std::vector<Domain> valid_domains;
@@ -382,6 +415,11 @@ namespace Legion {
       void get_references(InstanceSet &instances) const;
       void get_memories(std::set<Memory>& memories) const;
       void get_fields(std::vector<FieldID>& fields) const;
+    public:
+      // Remember the versions of the fields that the references were
+      // valid for so a remapping can tell if anything changed since
+      void record_mapped_versions(const FieldVersions &versions);
+      bool has_mapped_versions(const FieldVersions &versions) const;
 #if defined(PRIVILEGE_CHECKS) || defined(BOUNDS_CHECKS)
     public:
       const char* get_task_name(void) const;
@@ -423,6 +461,7 @@ namespace Legion {
       bool made_accessor;
       ApUserEvent termination_event;
       ApEvent wait_for_unmap;
+      FieldVersions mapped_versions;
 #ifdef BOUNDS_CHECKS
     private:
       Domain bounds;
@@ -502,6 +541,8 @@ namespace Legion {
       PhaseBarrier get_legion_wait_phase_barrier(void);
       PhaseBarrier get_legion_arrive_phase_barrier(void);
       void advance_legion_handshake(void);
+    protected:
+      static bool spin_until_triggered(ApEvent event);
     private:
       const bool init_in_MPI;
       const int mpi_participants;
@@ -562,6 +603,7 @@ namespace Legion {
         static const LgTaskID TASK_ID = LG_SCHEDULER_ID;
       public:
         Processor proc;
+        unsigned generation;
       };
       struct TriggerTaskArgs : public LgTaskArgs<TriggerTaskArgs> {
       public:
@@ -583,6 +625,20 @@ namespace Legion {
         size_t length;
         int radix;
       };
+      struct ReadyQueue {
+      public:
+        ReadyQueue(void)
+          : ready_lock(Reservation::create_reservation()) { }
+        ~ReadyQueue(void) { ready_lock.destroy_reservation(); }
+      private:
+        ReadyQueue(const ReadyQueue &rhs);
+        ReadyQueue& operator=(const ReadyQueue &rhs);
+      public:
+        // Each mapper has its own lock on its tasks so adding and
+        // scheduling tasks for different mappers never contend
+        Reservation ready_lock;
+        std::list<TaskOp*> tasks;
+      };
     public:
       ProcessorManager(Processor proc, Processor::Kind proc_kind,
                        Runtime *rt, unsigned default_mappers,  
@@ -600,8 +656,9 @@ namespace Legion {
       void replace_default_mapper(MapperManager *m, bool own);
       MapperManager* find_mapper(MapperID mid, bool need_lock = true) const;
     public:
-      void perform_scheduling(void);
-      void launch_task_scheduler(void);
+      void perform_scheduling(unsigned generation);
+      void launch_task_scheduler(LgPriority priority = LG_LATENCY_PRIORITY);
+      void wake_task_scheduler(void);
     public:
       void activate_context(InnerContext *context);
       void deactivate_context(InnerContext *context);
@@ -617,7 +674,8 @@ namespace Legion {
       inline void find_visible_memories(std::set<Memory> &visible) const
         { visible = visible_memories; }
     protected:
-      void perform_mapping_operations(void);
+      bool perform_mapping_operations(void);
+      ReadyQueue* find_ready_queue(MapperID mid);
       void issue_advertisements(MapperID mid);
     protected:
       void increment_active_contexts(void);
@@ -639,6 +697,13 @@ namespace Legion {
       // Scheduling state
       Reservation queue_lock;
       bool task_scheduler_enabled;
+      // The scheduler parks at low priority after a pass in which no
+      // mapper picked any tasks, until new work wakes it up again
+      bool task_scheduler_parked;
+      // Only the most recently launched scheduler task does any work
+      unsigned scheduler_generation;
+      // Bumped every time a task is added to a ready queue
+      unsigned long long ready_epoch;
       unsigned total_active_contexts;
       struct ContextState {
       public:
@@ -651,7 +716,7 @@ namespace Legion {
       std::vector<ContextState> context_states;
     protected:
       // For each mapper, a list of tasks that are ready to map
-      std::map<MapperID,std::list<TaskOp*> > ready_queues;
+      std::map<MapperID,ReadyQueue*> ready_queues;
       // Mapper objects
       std::map<MapperID,std::pair<MapperManager*,bool/*own*/> > mappers;
       // Reservations for accessing mappers
@@ -690,12 +755,14 @@ namespace Legion {
         InstanceInfo(void)
           : current_state(COLLECTABLE_STATE), 
             deferred_collect(RtUserEvent::NO_RT_USER_EVENT),
-            instance_size(0), min_priority(0) { }
+            instance_size(0), min_priority(0), last_use(0) { }
       public:
         InstanceState current_state;
         RtUserEvent deferred_collect;
         size_t instance_size;
         GCPriority min_priority;
+        // Time in microseconds when the instance was last used
+        unsigned long long last_use;
         std::map<std::pair<MapperID,Processor>,GCPriority> mapper_priorities;
       };
       template<bool SMALLER>
@@ -716,6 +783,33 @@ namespace Legion {
         size_t instance_size;
         GCPriority priority;
       };
+      struct EagerCandidate {
+      public:
+        EagerCandidate(PhysicalManager *m, size_t size, GCPriority p,
+                       unsigned long long use)
+          : manager(m), instance_size(size), priority(p), last_use(use) { }
+      public:
+        bool operator<(const EagerCandidate &rhs) const;
+      public:
+        PhysicalManager *manager;
+        size_t instance_size;
+        GCPriority priority;
+        unsigned long long last_use;
+      };
+      struct EagerCollectionArgs : public LgTaskArgs<EagerCollectionArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_EAGER_COLLECTION_TASK_ID;
+      public:
+        MemoryManager *manager;
+      };
+      struct RecycledInstance {
+      public:
+        PhysicalInstance instance;
+        LayoutDescription *layout;
+        IndexSpace domain;
+        RtEvent collected;
+        unsigned long long expiration;
+      };
     public:
       MemoryManager(Memory mem, Runtime *rt);
       MemoryManager(const MemoryManager &rhs);
@@ -779,6 +873,15 @@ namespace Legion {
       void record_created_instance( PhysicalManager *manager, bool acquire,
                                     MapperID mapper_id, Processor proc,
                                     GCPriority priority, bool remote);
+    public:
+      bool recycle_instance(PhysicalManager *manager, RtEvent collected);
+      bool find_recycled_instance(LayoutDescription *layout, IndexSpace domain,
+                                  PhysicalInstance &instance, ApEvent &ready);
+      bool release_recycled_instances(bool only_expired);
+    public:
+      void check_eager_collection(void);
+      void perform_eager_collection(void);
+      static void handle_eager_collection(const void *args);
     public:
       void process_instance_request(Deserializer &derez, AddressSpaceID source);
       void process_instance_response(Deserializer &derez,AddressSpaceID source);
@@ -817,11 +920,18 @@ namespace Legion {
                                                         &candidates) const;
       void release_candidate_references(const std::deque<PhysicalManager*>
                                                         &candidates) const;
+      // Must be called while holding the manager lock
+      void find_indexed_instances(const std::vector<LogicalRegion> &regions,
+                                  const SpecializedConstraint &specialized,
+                                  bool only_valid,
+                                  std::vector<PhysicalManager*> &result) const;
+      void record_instance_lookup(size_t candidates_examined);
     protected:
       PhysicalManager* allocate_physical_instance(
                                     const LayoutConstraintSet &constraints,
                                     const std::vector<LogicalRegion> &regions,
                                     UniqueID creator_id);
+      PhysicalManager* collect_and_allocate(InstanceBuilder &builder);
       PhysicalManager* find_and_record(PhysicalManager *manager, 
                                     const LayoutConstraintSet &constraints,
                                     const std::vector<LogicalRegion> &regions,
@@ -837,6 +947,9 @@ namespace Legion {
                                     Processor proc, GCPriority priority,
                                     bool tight_region_bounds, bool remote);
       void record_deleted_instance(PhysicalManager *manager); 
+      // Must be called while holding the manager lock
+      void index_instance(PhysicalManager *manager);
+      void unindex_instance(PhysicalManager *manager);
       void find_instances_by_state(size_t needed_size, InstanceState state, 
                      std::set<CollectableInfo<true> > &smaller_instances,
                      std::set<CollectableInfo<false> > &larger_instances) const;
@@ -866,6 +979,28 @@ namespace Legion {
       // It is only valid on the owner node
       LegionMap<PhysicalManager*,InstanceInfo,
                 MEMORY_INSTANCES_ALLOC>::tracked current_instances;
+      // An index over the current instances by region tree (which also
+      // determines the field space) and then by the kind of specialized
+      // layout so lookups only have to consider plausible candidates
+      typedef std::pair<SpecializedKind,ReductionOpID> LayoutSignature;
+      std::map<RegionTreeID,std::map<LayoutSignature,
+                  std::set<PhysicalManager*> > > instance_index;
+      // Statistics on how many candidates our lookups examine
+      unsigned long long total_instance_lookups;
+      unsigned long long total_candidates_examined;
+      unsigned long long max_candidates_examined;
+      // Storage of recently collected instances that we hold onto for
+      // a short window in case someone asks for the same layout again,
+      // ordered from oldest to newest
+      std::list<RecycledInstance> recycled_instances;
+      // Bytes in instances that this memory is currently tracking
+      size_t allocated_bytes;
+      bool eager_collection_pending;
+      // Statistics for tuning eager collection
+      unsigned long long total_eager_collections;
+      unsigned long long total_eager_bytes_collected;
+      unsigned long long total_allocation_retries;
+      unsigned long long total_allocation_retry_time;
     };
 
     /**
@@ -884,6 +1019,13 @@ namespace Legion {
         PARTIAL_MESSAGE,
         FINAL_MESSAGE,
       };
+      struct FlushAggregatedArgs : public LgTaskArgs<FlushAggregatedArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_FLUSH_AGGREGATED_MESSAGES_TASK_ID;
+      public:
+        VirtualChannel *channel;
+        Processor target;
+      };
     public:
       VirtualChannel(VirtualChannelKind kind,AddressSpaceID local_address_space,
                      size_t max_message_size, LegionProfiler *profiler);
@@ -897,7 +1039,14 @@ namespace Legion {
                            bool response, bool shutdown);
       void process_message(const void *args, size_t arglen, 
                         Runtime *runtime, AddressSpaceID remote_address_space);
-      void confirm_shutdown(ShutdownManager *shutdown_manager, bool phase_one);
+      bool confirm_shutdown(ShutdownManager *shutdown_manager, 
+                            bool phase_one, bool retry);
+      void flush_aggregated_messages(Runtime *runtime, Processor target);
+      void report_message_statistics(AddressSpaceID local_space,
+                                     AddressSpaceID remote_space,
+                                     VirtualChannelKind kind);
+    public:
+      static bool is_urgent_message(MessageKind kind);
     private:
       void send_message(bool complete, Runtime *runtime, 
                         Processor target, bool response, bool shutdown);
@@ -915,6 +1064,13 @@ namespace Legion {
       MessageHeader header;
       unsigned packaged_messages;
       bool partial;
+      // State for aggregating small messages that asked to be flushed
+      bool aggregating;
+      bool flush_launched;
+      long long first_aggregated;
+      // Messages and bytes sent for each kind with -lg:message_stats
+      size_t *kind_messages;
+      size_t *kind_bytes;
       // State for receiving messages
       // No lock for receiving messages since we know
       // that they are ordered
@@ -959,8 +1115,8 @@ namespace Legion {
                         VirtualChannelKind channel, bool flush, 
                         bool response = false, bool shutdown = false);
       void receive_message(const void *args, size_t arglen);
-      void confirm_shutdown(ShutdownManager *shutdown_manager,
-                            bool phase_one);
+      bool confirm_shutdown(ShutdownManager *shutdown_manager,
+                            bool phase_one, bool retry);
     public:
       const AddressSpaceID remote_address_space;
     private:
@@ -998,7 +1154,7 @@ namespace Legion {
     public:
       ShutdownManager& operator=(const ShutdownManager &rhs);
     public:
-      bool attempt_shutdown(void);
+      bool attempt_shutdown(RtEvent local_precondition = RtEvent::NO_RT_EVENT);
       bool handle_response(bool success, const std::set<RtEvent> &to_add);
     protected:
       void finalize(void);
@@ -1034,7 +1190,7 @@ namespace Legion {
         static const LgTaskID TASK_ID = LG_DEFERRED_COLLECT_ID;
       public:
         GarbageCollectionEpoch *epoch;
-        LogicalView *view;
+        unsigned batch;
       };
     public:
       GarbageCollectionEpoch(Runtime *runtime);
@@ -1051,6 +1207,8 @@ namespace Legion {
       Runtime *const runtime;
       int remaining;
       std::map<LogicalView*,std::set<ApEvent> > collections;
+      // Groups of views that are each collected by a single meta-task
+      std::vector<std::vector<LogicalView*> > batches;
     };
 
     /**
@@ -1254,6 +1412,8 @@ namespace Legion {
       static AddressSpaceID get_owner_space(VariantID vid, Runtime *runtime);
       static void handle_variant_response(Runtime *runtime, 
                                           Deserializer &derez);
+      static void register_realm_variants(
+                                  const std::vector<VariantImpl*> &variants);
     public:
       const VariantID vid;
       TaskImpl *const owner;
@@ -1350,9 +1510,13 @@ namespace Legion {
       char *constraints_name;
       Reservation layout_lock;
     protected:
-      std::map<LayoutConstraintID,bool> conflict_cache;
-      std::map<LayoutConstraintID,bool> entailment_cache;
-      std::map<LayoutConstraintID,bool> no_pointer_entailment_cache;
+      // Results of tests against other registered constraints, these
+      // depend on the number of dimensions of the instance layout so
+      // the dimensions are part of the key
+      typedef std::pair<LayoutConstraintID,unsigned> CacheKey;
+      std::map<CacheKey,bool> conflict_cache;
+      std::map<CacheKey,bool> entailment_cache;
+      std::map<CacheKey,bool> no_pointer_entailment_cache;
     protected:
       NodeSet remote_instances;
     };
@@ -1373,6 +1537,8 @@ namespace Legion {
                                     LogicalPartition upper_bound,
                                     const DomainPoint &point);
       virtual bool is_exclusive(void) const;
+      virtual bool get_affine_projection(int dim, coord_t *transform,
+                                         coord_t *offset) const;
       virtual unsigned get_depth(void) const;
     };
 
@@ -1423,13 +1589,32 @@ namespace Legion {
       void check_projection_partition_result(const RegionRequirement &req,
                                           Operation *op, unsigned idx,
                                           LogicalRegion result, Runtime *rt);
+    protected:
+      // Caching of results for functional projection functors
+      bool find_cached_projection(const RegionRequirement &req,
+                                  const DomainPoint &point,
+                                  LogicalRegion &result);
+      template<typename T>
+      bool find_cached_projections(const RegionRequirement &req,
+                                   unsigned idx,
+                                   const std::vector<T*> &points,
+                                   std::vector<T*> &missing);
+      void record_cached_projection(const RegionRequirement &req,
+                                    const DomainPoint &point,
+                                    LogicalRegion result);
     public:
       const int depth; 
       const bool is_exclusive;
+      const bool is_functional;
       const ProjectionID projection_id;
       ProjectionFunctor *const functor;
     private:
       Reservation projection_reservation;
+      Reservation cache_reservation;
+      std::map<LogicalRegion,
+               std::map<DomainPoint,LogicalRegion> > region_cache;
+      std::map<LogicalPartition,
+               std::map<DomainPoint,LogicalRegion> > partition_cache;
     }; 
 
     /**
@@ -1501,6 +1686,22 @@ namespace Legion {
         TaskContext *ctx;
         FutureImpl *result;
       }; 
+      struct FlushReferenceReleasesArgs : 
+        public LgTaskArgs<FlushReferenceReleasesArgs> {
+      public:
+        static const LgTaskID TASK_ID = LG_FLUSH_REFERENCE_RELEASES_TASK_ID;
+      public:
+        AddressSpaceID target;
+      };
+    public:
+      struct PendingReferenceRelease {
+      public:
+        PendingReferenceRelease(void)
+          : is_owner(false) { counts[0] = counts[1] = counts[2] = 0; }
+      public:
+        unsigned counts[3]; // indexed by ReferenceKind
+        bool is_owner;
+      };
     public:
       struct ProcessorGroupInfo {
       public:
@@ -1635,6 +1836,8 @@ namespace Legion {
                                                PartitionKind part_kind,
                                                Color color,
                                                MapperID id, MappingTagID tag);
+      void begin_dependent_partition_batch(Context ctx);
+      void end_dependent_partition_batch(Context ctx);
       IndexPartition create_pending_partition(Context ctx, IndexSpace parent,
                                               IndexSpace color_space,
                                               PartitionKind part_kind,
@@ -1969,6 +2172,7 @@ namespace Legion {
                                  CodeDescriptor *realm,
                                  bool ret, VariantID vid = AUTO_GENERATE_ID,
                                  bool check_task_id = true);
+      bool defer_realm_registration(VariantImpl *impl);
       TaskImpl* find_or_create_task_impl(TaskID task_id);
       TaskImpl* find_task_impl(TaskID task_id);
       VariantImpl* find_variant_impl(TaskID task_id, VariantID variant_id,
@@ -2050,11 +2254,16 @@ namespace Legion {
       void send_slice_remote_mapped(Processor target, Serializer &rez);
       void send_slice_remote_complete(Processor target, Serializer &rez);
       void send_slice_remote_commit(Processor target, Serializer &rez);
+      void send_slice_distribution(AddressSpaceID target, Serializer &rez);
+      void send_slice_aggregate_return(AddressSpaceID target,Serializer &rez);
+      void send_slice_aggregate_count(AddressSpaceID target, Serializer &rez);
       void send_did_remote_registration(AddressSpaceID target, Serializer &rez);
       void send_did_remote_valid_update(AddressSpaceID target, Serializer &rez);
       void send_did_remote_gc_update(AddressSpaceID target, Serializer &rez);
       void send_did_remote_resource_update(AddressSpaceID target,
                                            Serializer &rez);
+      void send_did_remote_release_batch(AddressSpaceID target, 
+                                         Serializer &rez);
       void send_did_add_create_reference(AddressSpaceID target,Serializer &rez);
       void send_did_remove_create_reference(AddressSpaceID target,
                                             Serializer &rez, bool flush = true);
@@ -2087,6 +2296,8 @@ namespace Legion {
                                           Serializer &rez);
       void send_future_map_response_future(AddressSpaceID target,
                                            Serializer &rez);
+      void send_future_map_request_all(AddressSpaceID target, Serializer &rez);
+      void send_future_map_response_all(AddressSpaceID target,Serializer &rez);
       void send_mapper_message(AddressSpaceID target, Serializer &rez);
       void send_mapper_broadcast(AddressSpaceID target, Serializer &rez);
       void send_task_impl_semantic_request(AddressSpaceID target, 
@@ -2218,11 +2429,16 @@ namespace Legion {
                                       AddressSpaceID source);
       void handle_slice_remote_complete(Deserializer &derez);
       void handle_slice_remote_commit(Deserializer &derez);
+      void handle_slice_distribution(Deserializer &derez);
+      void handle_slice_aggregate_return(Deserializer &derez,
+                                         AddressSpaceID source);
+      void handle_slice_aggregate_count(Deserializer &derez);
       void handle_did_remote_registration(Deserializer &derez, 
                                           AddressSpaceID source);
       void handle_did_remote_valid_update(Deserializer &derez);
       void handle_did_remote_gc_update(Deserializer &derez);
       void handle_did_remote_resource_update(Deserializer &derez);
+      void handle_did_remote_release_batch(Deserializer &derez);
       void handle_did_create_add(Deserializer &derez);
       void handle_did_create_remove(Deserializer &derez);
       void handle_did_remote_unregister(Deserializer &derez);
@@ -2261,6 +2477,9 @@ namespace Legion {
       void handle_future_map_future_request(Deserializer &derez,
                                             AddressSpaceID source);
       void handle_future_map_future_response(Deserializer &derez);
+      void handle_future_map_all_request(Deserializer &derez,
+                                         AddressSpaceID source);
+      void handle_future_map_all_response(Deserializer &derez);
       void handle_mapper_message(Deserializer &derez);
       void handle_mapper_broadcast(Deserializer &derez);
       void handle_task_impl_semantic_request(Deserializer &derez,
@@ -2416,6 +2635,13 @@ namespace Legion {
       DistributedCollectable* weak_find_distributed_collectable(
                                                            DistributedID did);
       bool find_pending_collectable_location(DistributedID did,void *&location);
+    public:
+      // Reference removals are buffered per node and sent in batches
+      void defer_remote_reference_release(AddressSpaceID target,
+                                          DistributedID did,
+                                          ReferenceKind kind,
+                                          unsigned count, bool is_owner);
+      void flush_remote_reference_releases(AddressSpaceID target);
     public:
       LogicalView* find_or_request_logical_view(DistributedID did,
                                                 RtEvent &ready);
@@ -2620,9 +2846,15 @@ namespace Legion {
     public:
       void trace_allocation(AllocationType type, size_t size, int elems);
       void trace_free(AllocationType type, size_t size, int elems);
+      void trace_slab(AllocationType type, SlabEventKind kind);
       void dump_allocation_info(void);
-      static const char* get_allocation_name(AllocationType type);
 #endif
+    public:
+      static const char* get_allocation_name(AllocationType type);
+      // Live bytes and allocations for each kind of internal data
+      // structure in this process, keyed by the name of the kind
+      static void get_internal_memory_usage(
+                      std::map<std::string,std::pair<size_t,size_t> > &usage);
     public:
       // These are the static methods that become the meta-tasks
       // for performing all the needed runtime operations
@@ -2660,7 +2892,7 @@ namespace Legion {
     protected:
       // Internal runtime methods invoked by the above static methods
       // after the find the right runtime instance to call
-      void process_schedule_request(Processor p);
+      void process_schedule_request(Processor p, unsigned generation);
       void process_message_task(const void *args, size_t arglen);
     public:
       // The Runtime wrapper for this class
@@ -2712,6 +2944,9 @@ namespace Legion {
       Reservation task_variant_lock;
       std::map<TaskID,TaskImpl*> task_table;
       std::deque<VariantImpl*> variant_table;
+      // Variants whose Realm registration is being batched
+      bool batch_realm_registrations;
+      std::vector<VariantImpl*> pending_realm_registrations;
     protected:
       // Constraint sets
       Reservation layout_constraints_lock;
@@ -2760,15 +2995,22 @@ namespace Legion {
       std::map<Processor,unsigned> processor_mapping;
     protected:
       Reservation distributed_id_lock;
+      // Updated atomically since threads reserve blocks without the lock
       DistributedID unique_distributed_id;
       LegionDeque<DistributedID,
           RUNTIME_DISTRIBUTED_ALLOC>::tracked available_distributed_ids;
+      // Can be read without the lock as a hint, only changed with it
+      volatile size_t available_distributed_count;
     protected:
       Reservation distributed_collectable_lock;
       LegionMap<DistributedID,DistributedCollectable*,
                 RUNTIME_DIST_COLLECT_ALLOC>::tracked dist_collectables;
       std::map<DistributedID,
         std::pair<DistributedCollectable*,RtUserEvent> > pending_collectables;
+    protected:
+      Reservation reference_release_lock;
+      std::map<AddressSpaceID,std::map<DistributedID,
+                PendingReferenceRelease> > pending_reference_releases;
     protected:
       Reservation is_launch_lock;
       std::map<std::pair<Domain,TypeTag>,IndexSpace> index_launch_spaces;
@@ -2798,12 +3040,17 @@ namespace Legion {
       public:
         AllocationTracker(void)
           : total_allocations(0), total_bytes(0),
-            diff_allocations(0), diff_bytes(0) { }
+            diff_allocations(0), diff_bytes(0),
+            slabs_created(0), slab_refills(0), slab_returns(0) { }
       public:
         unsigned total_allocations;
         size_t         total_bytes;
         int       diff_allocations;
         off_t           diff_bytes;
+        // Activity of the LegionSlabAllocator for this type
+        unsigned     slabs_created;
+        unsigned      slab_refills;
+        unsigned      slab_returns;
       };
       Reservation allocation_lock; // leak this lock intentionally
       // Make these static so they live through the end of the runtime
@@ -2980,10 +3227,22 @@ namespace Legion {
       static Processor::TaskFuncID legion_main_id;
       static int initial_task_window_size;
       static unsigned initial_task_window_hysteresis;
+      static bool adaptive_task_window;
+      static int adaptive_window_min;
+      static int adaptive_window_max;
       static unsigned initial_tasks_to_schedule;
       static unsigned max_message_size;
+      static unsigned message_aggregation_window;
+      static unsigned small_message_size;
+      static bool message_statistics;
+      static bool copy_statistics;
+      static int slice_distribution_radix;
       static unsigned gc_epoch_size;
       static unsigned max_local_fields;
+      static unsigned instance_recycle_window;
+      static unsigned gc_high_water_mark;
+      static unsigned max_map_task_batch;
+      static unsigned handshake_spin_time;
       static bool runtime_started;
       static bool runtime_backgrounded;
       static bool runtime_warnings;
@@ -2995,6 +3254,7 @@ namespace Legion {
       static bool unsafe_mapper;
       static bool dynamic_independence_tests;
       static bool legion_spy_enabled;
+      static const char* legion_spy_logfile;
       static bool enable_test_mapper;
       static bool legion_ldb_enabled;
       static const char* replay_file;
@@ -3019,12 +3279,22 @@ namespace Legion {
 #endif
       static bool program_order_execution;
       static bool verify_disjointness;
+      static bool cache_dependent_partitions;
+      static unsigned auto_trace_max_length;
+      static bool parallel_logical_analysis;
+      static bool mapper_call_statistics;
     public:
       static unsigned num_profiling_nodes;
       static const char* serializer_type;
       static const char* prof_logfile;
       static size_t prof_footprint_threshold;
       static size_t prof_target_latency;
+      static bool prof_counters;
+      static bool prof_proc_chunks;
+      static unsigned prof_sample_interval;
+      static bool prof_sample_random;
+      static const char* prof_sample_tasks;
+      static bool prof_aggregate;
       static bool slow_debug_ok;
     public:
       static inline ApEvent merge_events(ApEvent e1, ApEvent e2);
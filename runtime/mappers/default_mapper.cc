@@ -26,6 +26,11 @@
 #define STATIC_BREADTH_FIRST          false
 #define STATIC_STEALING_ENABLED       false
 #define STATIC_MAX_SCHEDULE_COUNT     8
+#define STATIC_NUMA_AWARE             true
+#define STATIC_GPU_LOCALITY           false
+#define STATIC_SPECULATE              false
+#define STATIC_CONCURRENT             false
+#define STATIC_SPILL                  false
 
 // This is the default implementation of the mapper interface for 
 // the general low level runtime
@@ -65,7 +70,11 @@ namespace Legion {
         max_steal_count(STATIC_MAX_STEAL_COUNT),
         breadth_first_traversal(STATIC_BREADTH_FIRST),
         stealing_enabled(STATIC_STEALING_ENABLED),
-        max_schedule_count(STATIC_MAX_SCHEDULE_COUNT)
+        max_schedule_count(STATIC_MAX_SCHEDULE_COUNT),
+        numa_aware(STATIC_NUMA_AWARE), gpu_locality(STATIC_GPU_LOCALITY),
+        speculate_predicates(STATIC_SPECULATE),
+        concurrent_mapping(STATIC_CONCURRENT),
+        spill_instances(STATIC_SPILL)
     //--------------------------------------------------------------------------
     {
       log_mapper.spew("Initializing the default mapper for "
@@ -93,6 +102,11 @@ namespace Legion {
           BOOL_ARG("-dm:steal", stealing_enabled);
           BOOL_ARG("-dm:bft", breadth_first_traversal);
           INT_ARG("-dm:sched", max_schedule_count);
+          BOOL_ARG("-dm:numa", numa_aware);
+          BOOL_ARG("-dm:gpu_locality", gpu_locality);
+          BOOL_ARG("-dm:speculate", speculate_predicates);
+          BOOL_ARG("-dm:concurrent", concurrent_mapping);
+          BOOL_ARG("-dm:spill", spill_instances);
 #undef BOOL_ARG
 #undef INT_ARG
         }
@@ -104,6 +118,18 @@ namespace Legion {
                            "for enabling stealing at the moment.");
         stealing_enabled = false;
       }
+      // Serialized mappers never need to lock anything, so only make
+      // the reservations if we're going to be mapping concurrently
+      if (concurrent_mapping)
+      {
+        for (unsigned idx = 0; idx < CACHE_SHARDS; idx++)
+        {
+          variant_locks[idx] = Reservation::create_reservation();
+          mapping_locks[idx] = Reservation::create_reservation();
+        }
+        round_robin_lock = Reservation::create_reservation();
+        cache_lock = Reservation::create_reservation();
+      }
       // Get all the processors and gpus on the local node
       Machine::ProcessorQuery all_procs(machine);
       for (Machine::ProcessorQuery::iterator it = all_procs.begin();
@@ -209,6 +235,44 @@ namespace Legion {
         }
       }
       assert(!local_cpus.empty()); // better have some cpus
+      // Group our processors by NUMA domain so that blocks of points
+      // next to each other in an index launch end up on the same socket
+      if (numa_aware)
+      {
+        default_sort_processors_by_socket(local_cpus);
+        default_sort_processors_by_socket(local_omps);
+      }
+      // Record the framebuffer topology of our GPUs
+      if (gpu_locality && (local_gpus.size() > 1))
+      {
+        for (std::vector<Processor>::const_iterator it = 
+              local_gpus.begin(); it != local_gpus.end(); it++)
+        {
+          Machine::MemoryQuery fb_query(machine);
+          fb_query.only_kind(Memory::GPU_FB_MEM);
+          fb_query.best_affinity_to(*it);
+          if (fb_query.count() > 0)
+            gpu_framebuffers[*it] = fb_query.first();
+        }
+        std::vector<Machine::ProcessorMemoryAffinity> affinity;
+        for (std::map<Processor,Memory>::const_iterator gpu_it = 
+              gpu_framebuffers.begin(); gpu_it != 
+              gpu_framebuffers.end(); gpu_it++)
+        {
+          for (std::map<Processor,Memory>::const_iterator fb_it = 
+                gpu_framebuffers.begin(); fb_it != 
+                gpu_framebuffers.end(); fb_it++)
+          {
+            if (fb_it->second == gpu_it->second)
+              continue;
+            affinity.clear();
+            machine.get_proc_mem_affinity(affinity, gpu_it->first, 
+                                          fb_it->second);
+            if (!affinity.empty())
+              gpu_peer_framebuffers[gpu_it->first].insert(fb_it->second);
+          }
+        }
+      }
       // check to make sure we complete sets of ios, cpus, and gpus
       for (unsigned idx = 0; idx < remote_cpus.size(); idx++) {
 	if (idx == node_id) continue;  // ignore our own node
@@ -279,10 +343,35 @@ namespace Legion {
                             (short_mask << (i*short_bits))) >> (i*short_bits));
     }
 
+    //--------------------------------------------------------------------------
+    DefaultMapper::AutoCacheLock::AutoCacheLock(Reservation r, bool exclusive)
+      : lock(r)
+    //--------------------------------------------------------------------------
+    {
+      if (!lock.exists())
+        return;
+      Realm::Event retry = 
+        lock.try_acquire(false/*retry*/, 0/*mode*/, exclusive);
+      while (retry.exists())
+      {
+        retry.wait();
+        retry = lock.try_acquire(true/*retry*/, 0/*mode*/, exclusive);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    DefaultMapper::AutoCacheLock::~AutoCacheLock(void)
+    //--------------------------------------------------------------------------
+    {
+      if (lock.exists())
+        lock.release();
+    }
+
     //--------------------------------------------------------------------------
     long DefaultMapper::default_generate_random_integer(void) const
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       return nrand48(random_number_generator);
     }
     
@@ -290,6 +379,7 @@ namespace Legion {
     double DefaultMapper::default_generate_random_real(void) const
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       return erand48(random_number_generator);
     }
 
@@ -310,6 +400,22 @@ namespace Legion {
     {
       log_mapper.spew("Deleting default mapper for processor " IDFMT "",
                   local_proc.id);
+      for (std::map<Memory,std::pair<unsigned,size_t> >::const_iterator it = 
+            socket_memory_usage.begin(); it != socket_memory_usage.end(); it++)
+        log_mapper.info("Default mapper on processor " IDFMT " created %u "
+                        "instances using %zu bytes in NUMA memory " IDFMT "",
+                        local_proc.id, it->second.first, it->second.second,
+                        it->first.id);
+      if (concurrent_mapping)
+      {
+        for (unsigned idx = 0; idx < CACHE_SHARDS; idx++)
+        {
+          variant_locks[idx].destroy_reservation();
+          mapping_locks[idx].destroy_reservation();
+        }
+        round_robin_lock.destroy_reservation();
+        cache_lock.destroy_reservation();
+      }
       free(const_cast<char*>(mapper_name));
     }
 
@@ -334,6 +440,9 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Default mapper operates with the serialized re-entrant sync model
+      // unless it has been asked to protect its own state
+      if (concurrent_mapping)
+        return CONCURRENT_MAPPER_MODEL;
       return SERIALIZED_REENTRANT_MAPPER_MODEL;
     }
 
@@ -481,6 +590,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_cpu(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       Processor result = local_cpus[next_local_cpu++];
       if (next_local_cpu == local_cpus.size())
         next_local_cpu = 0;
@@ -493,6 +603,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_cpu();
+      AutoCacheLock r_lock(round_robin_lock);
       if (!next_global_cpu.exists())
       {
         global_cpu_query = new Machine::ProcessorQuery(machine);
@@ -513,6 +624,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_gpu(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       Processor result = local_gpus[next_local_gpu++];
       if (next_local_gpu == local_gpus.size())
         next_local_gpu = 0;
@@ -525,6 +637,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_gpu();
+      AutoCacheLock r_lock(round_robin_lock);
       if (!next_global_gpu.exists())
       {
         global_gpu_query = new Machine::ProcessorQuery(machine);
@@ -545,6 +658,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_io(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       Processor result = local_ios[next_local_io++];
       if (next_local_io == local_ios.size())
         next_local_io = 0;
@@ -557,6 +671,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_io();
+      AutoCacheLock r_lock(round_robin_lock);
       if (!next_global_io.exists())
       {
         global_io_query = new Machine::ProcessorQuery(machine);
@@ -577,6 +692,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_py(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       Processor result = local_pys[next_local_py++];
       if (next_local_py == local_pys.size())
         next_local_py = 0;
@@ -589,6 +705,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_py();
+      AutoCacheLock r_lock(round_robin_lock);
       if (!next_global_py.exists())
       {
         global_py_query = new Machine::ProcessorQuery(machine);
@@ -609,6 +726,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_procset(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       Processor result = local_procsets[next_local_procset++];
       if (next_local_procset == local_procsets.size())
         next_local_procset = 0;
@@ -621,6 +739,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_procset();
+      AutoCacheLock r_lock(round_robin_lock);
       if (!next_global_procset.exists())
       {
         global_procset_query = new Machine::ProcessorQuery(machine);
@@ -641,6 +760,7 @@ namespace Legion {
     Processor DefaultMapper::default_get_next_local_omp(void)
     //--------------------------------------------------------------------------
     {
+      AutoCacheLock r_lock(round_robin_lock);
       Processor result = local_omps[next_local_omp++];
       if (next_local_omp == local_omps.size())
         next_local_omp = 0;
@@ -653,6 +773,7 @@ namespace Legion {
     {
       if (total_nodes == 1)
         return default_get_next_local_omp();
+      AutoCacheLock r_lock(round_robin_lock);
       if (!next_global_omp.exists())
       {
         global_omp_query = new Machine::ProcessorQuery(machine);
@@ -676,12 +797,23 @@ namespace Legion {
                                      Processor::Kind specific)
     //--------------------------------------------------------------------------
     {
-      // Do a quick test to see if we have cached the result
-      std::map<TaskID,VariantInfo>::const_iterator finder = 
-                                        preferred_variants.find(task.task_id);
-      if (finder != preferred_variants.end() && 
-          (!needs_tight_bound || finder->second.tight_bound))
-        return finder->second;
+      // Do a quick test to see if we have cached the result, copy it out
+      // since another mapper call could update the entry concurrently
+      const unsigned shard = cache_shard(task.task_id);
+      bool has_cached = false;
+      VariantInfo cached;
+      {
+        AutoCacheLock v_lock(variant_locks[shard], false/*exclusive*/);
+        std::map<TaskID,VariantInfo>::const_iterator finder = 
+          preferred_variants[shard].find(task.task_id);
+        if (finder != preferred_variants[shard].end())
+        {
+          cached = finder->second;
+          has_cached = true;
+        }
+      }
+      if (has_cached && (!needs_tight_bound || cached.tight_bound))
+        return cached;
 
       Machine::ProcessorQuery all_procsets(machine);
       all_procsets.only_kind(Processor::PROC_SET);
@@ -711,8 +843,7 @@ namespace Legion {
       {
         variants.clear();
         Processor::Kind best_kind = Processor::NO_KIND;
-        if (finder == preferred_variants.end() || 
-            (specific != Processor::NO_KIND))
+        if (!has_cached || (specific != Processor::NO_KIND))
         {
           // Do the weak part first and figure out which processor kind
           // we want to focus on first
@@ -793,7 +924,7 @@ namespace Legion {
         {
           // We already know which kind to focus, so just get our 
           // variants for this processor kind
-          best_kind = finder->second.proc_kind;
+          best_kind = cached.proc_kind;
           runtime->find_valid_variants(ctx, task.task_id, 
                                               variants, best_kind);
         }
@@ -878,7 +1009,8 @@ namespace Legion {
               }
             }
           }
-          preferred_variants[task.task_id] = result;
+          AutoCacheLock v_lock(variant_locks[shard]);
+          preferred_variants[shard][task.task_id] = result;
         }
         return result;
       }
@@ -1184,11 +1316,14 @@ namespace Legion {
         if(exset.processor_constraint.kind == Processor::PROC_SET) {
 
            // Before we do anything else, see if it is in the cache
-           std::map<Domain,std::vector<TaskSlice> >::const_iterator finder =
-             procset_slices_cache.find(input.domain);
-           if (finder != procset_slices_cache.end()) {
-                   output.slices = finder->second;
-                   return;
+           {
+             AutoCacheLock c_lock(cache_lock, false/*exclusive*/);
+             std::map<Domain,std::vector<TaskSlice> >::const_iterator finder =
+               procset_slices_cache.find(input.domain);
+             if (finder != procset_slices_cache.end()) {
+                     output.slices = finder->second;
+                     return;
+             }
            }
 
           output.slices.resize(input.domain.get_volume());
@@ -1203,6 +1338,7 @@ namespace Legion {
           }
 
           // Save the result in the cache
+          AutoCacheLock c_lock(cache_lock);
           procset_slices_cache[input.domain] = output.slices;
           return;
         }
@@ -1266,11 +1402,14 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       // Before we do anything else, see if it is in the cache
-      std::map<Domain,std::vector<TaskSlice> >::const_iterator finder = 
-        cached_slices.find(input.domain);
-      if (finder != cached_slices.end()) {
-        output.slices = finder->second;
-        return;
+      {
+        AutoCacheLock c_lock(cache_lock, false/*exclusive*/);
+        std::map<Domain,std::vector<TaskSlice> >::const_iterator finder = 
+          cached_slices.find(input.domain);
+        if (finder != cached_slices.end()) {
+          output.slices = finder->second;
+          return;
+        }
       }
 
 #if 1
@@ -1407,6 +1546,7 @@ namespace Legion {
 #endif
 
       // Save the result in the cache
+      AutoCacheLock c_lock(cache_lock);
       cached_slices[input.domain] = output.slices;
     }
 
@@ -1427,6 +1567,20 @@ namespace Legion {
       output.postmap_task = false;
       // Figure out our target processors
       default_policy_select_target_processors(ctx, task, output.target_procs);
+      // GPU tasks can move to another local GPU that already has their data
+      Processor target_proc = task.target_proc;
+      if (gpu_locality && (target_kind == Processor::TOC_PROC) &&
+          !gpu_framebuffers.empty() && !task.must_epoch_task &&
+          input.premapped_regions.empty() &&
+          (task.target_proc.address_space() == node_id))
+      {
+        target_proc = default_policy_select_gpu_by_locality(ctx, task, input);
+        if (target_proc != task.target_proc)
+        {
+          output.target_procs.clear();
+          output.target_procs.push_back(target_proc);
+        }
+      }
 
       // See if we have an inner variant, if we do virtually map all the regions
       // We don't even both caching these since they are so simple
@@ -1468,16 +1622,16 @@ namespace Legion {
                   reduction_indexes.end(); it++)
             {
               Memory target_memory = default_policy_select_target_memory(ctx,
-                                                         task.target_proc,
+                                                         target_proc,
                                                          task.regions[*it]);
               std::set<FieldID> copy = task.regions[*it].privilege_fields;
-              if (!default_create_custom_instances(ctx, task.target_proc,
+              if (!default_create_custom_instances(ctx, target_proc,
                   target_memory, task.regions[*it], *it, copy, 
                   layout_constraints, false/*needs constraint check*/, 
                   output.chosen_instances[*it]))
               {
                 default_report_failed_instance_creation(task, *it, 
-                                            task.target_proc, target_memory);
+                                            target_proc, target_memory);
               }
             }
           }
@@ -1489,32 +1643,48 @@ namespace Legion {
         default_policy_select_task_cache_policy(ctx, task);
 
       // First, let's see if we've cached a result of this task mapping
-      const unsigned long long task_hash = compute_task_hash(task);
-      std::pair<TaskID,Processor> cache_key(task.task_id, task.target_proc);
-      std::map<std::pair<TaskID,Processor>,
-               std::list<CachedTaskMapping> >::const_iterator 
-        finder = cached_task_mappings.find(cache_key);
+      std::vector<unsigned long long> task_signature;
+      const unsigned long long task_hash = 
+        compute_task_signature(task, task_signature);
+      std::pair<TaskID,Processor> cache_key(task.task_id, target_proc);
+      const unsigned shard = cache_shard(task.task_id);
       // This flag says whether we need to recheck the field constraints,
       // possibly because a new field was allocated in a region, so our old
       // cached physical instance(s) is(are) no longer valid
       bool needs_field_constraint_check = false;
-      if (cache_policy == DEFAULT_CACHE_POLICY_ENABLE && finder != cached_task_mappings.end())
+      if (cache_policy == DEFAULT_CACHE_POLICY_ENABLE)
       {
         bool found = false;
         bool has_reductions = false;
-        // Iterate through and see if we can find one with our variant and hash
-        for (std::list<CachedTaskMapping>::const_iterator it = 
-              finder->second.begin(); it != finder->second.end(); it++)
         {
-          if ((it->variant == output.chosen_variant) &&
-              (it->task_hash == task_hash))
+          AutoCacheLock m_lock(mapping_locks[shard], false/*exclusive*/);
+          std::map<std::pair<TaskID,Processor>,
+                   std::multimap<unsigned long long,
+                                 CachedTaskMapping> >::const_iterator 
+            finder = cached_task_mappings[shard].find(cache_key);
+          if (finder != cached_task_mappings[shard].end())
           {
-            // Have to copy it before we do the external call which 
-            // might invalidate our iterator
-            output.chosen_instances = it->mapping;
-            has_reductions = it->has_reductions;
-            found = true;
-            break;
+            // Only look at the mappings with our hash and then check that
+            // the variant and the requirements really are the same
+            std::pair<std::multimap<unsigned long long,
+                                    CachedTaskMapping>::const_iterator,
+                      std::multimap<unsigned long long,
+                                    CachedTaskMapping>::const_iterator> range =
+              finder->second.equal_range(task_hash);
+            for (std::multimap<unsigned long long,CachedTaskMapping>::
+                  const_iterator it = range.first; it != range.second; it++)
+            {
+              if ((it->second.variant == output.chosen_variant) &&
+                  (it->second.task_signature == task_signature))
+              {
+                // Have to copy it before we do the external call which 
+                // might invalidate our iterator
+                output.chosen_instances = it->second.mapping;
+                has_reductions = it->second.has_reductions;
+                found = true;
+                break;
+              }
+            }
           }
         }
         if (found)
@@ -1531,16 +1701,16 @@ namespace Legion {
               if (task.regions[idx].privilege == REDUCE)
               {
                 Memory target_memory = default_policy_select_target_memory(ctx,
-                                                         task.target_proc,
+                                                         target_proc,
                                                          task.regions[idx]);
                 std::set<FieldID> copy = task.regions[idx].privilege_fields;
-                if (!default_create_custom_instances(ctx, task.target_proc,
+                if (!default_create_custom_instances(ctx, target_proc,
                     target_memory, task.regions[idx], idx, copy, 
                     layout_constraints, needs_field_constraint_check, 
                     output.chosen_instances[idx]))
                 {
                   default_report_failed_instance_creation(task, idx, 
-                                              task.target_proc, target_memory);
+                                              target_proc, target_memory);
                 }
               }
             }
@@ -1557,7 +1727,8 @@ namespace Legion {
           // Have to renew our iterators since they might have been
           // invalidated during the 'acquire_and_filter_instances' call
           default_remove_cached_task(ctx, output.chosen_variant,
-                        task_hash, cache_key, output.chosen_instances);
+                        task_hash, task_signature, cache_key, 
+                        output.chosen_instances);
         }
       }
       // We didn't find a cached version of the mapping so we need to 
@@ -1580,6 +1751,7 @@ namespace Legion {
       // Now we need to go through and make instances for any of our
       // regions which do not have space for certain fields
       bool has_reductions = false;
+      bool has_spills = false;
       for (unsigned idx = 0; idx < task.regions.size(); idx++)
       {
         if (done_regions[idx])
@@ -1591,18 +1763,18 @@ namespace Legion {
           continue;
         // See if this is a reduction      
         Memory target_memory = default_policy_select_target_memory(ctx,
-                                                         task.target_proc,
+                                                         target_proc,
                                                          task.regions[idx]);
         if (task.regions[idx].privilege == REDUCE)
         {
           has_reductions = true;
-          if (!default_create_custom_instances(ctx, task.target_proc,
+          if (!default_create_spillable_instances(ctx, target_proc,
                   target_memory, task.regions[idx], idx, missing_fields[idx],
                   layout_constraints, needs_field_constraint_check,
-                  output.chosen_instances[idx]))
+                  output.chosen_instances[idx], has_spills))
           {
             default_report_failed_instance_creation(task, idx, 
-                                        task.target_proc, target_memory);
+                                        target_proc, target_memory);
           }
           continue;
         }
@@ -1642,21 +1814,27 @@ namespace Legion {
             continue;
         }
         // Otherwise make normal instances for the given region
-        if (!default_create_custom_instances(ctx, task.target_proc,
+        if (!default_create_spillable_instances(ctx, target_proc,
                 target_memory, task.regions[idx], idx, missing_fields[idx],
                 layout_constraints, needs_field_constraint_check,
-                output.chosen_instances[idx]))
+                output.chosen_instances[idx], has_spills))
         {
           default_report_failed_instance_creation(task, idx,
-                                      task.target_proc, target_memory);
+                                      target_proc, target_memory);
         }
       }
-      if (cache_policy == DEFAULT_CACHE_POLICY_ENABLE) {
+      // Don't cache mappings with spilled instances so that the next
+      // instance of this task tries the framebuffer again
+      if ((cache_policy == DEFAULT_CACHE_POLICY_ENABLE) && !has_spills) {
         // Now that we are done, let's cache the result so we can use it later
-        std::list<CachedTaskMapping> &map_list = cached_task_mappings[cache_key];
-        map_list.push_back(CachedTaskMapping());
-        CachedTaskMapping &cached_result = map_list.back();
+        AutoCacheLock m_lock(mapping_locks[shard]);
+        std::multimap<unsigned long long,CachedTaskMapping>::iterator 
+          cached = cached_task_mappings[shard][cache_key].insert(
+              std::pair<unsigned long long,CachedTaskMapping>(task_hash,
+                                                        CachedTaskMapping()));
+        CachedTaskMapping &cached_result = cached->second;
         cached_result.task_hash = task_hash;
+        cached_result.task_signature.swap(task_signature);
         cached_result.variant = output.chosen_variant;
         cached_result.mapping = output.chosen_instances;
         cached_result.has_reductions = has_reductions;
@@ -1751,6 +1929,81 @@ namespace Legion {
         target_procs.push_back(task.target_proc);
     }
 
+    //--------------------------------------------------------------------------
+    Processor DefaultMapper::default_policy_select_gpu_by_locality(
+                                    MapperContext ctx, const Task &task,
+                                    const MapTaskInput &input)
+    //--------------------------------------------------------------------------
+    {
+      // Estimate how many bytes of valid data for this task each local
+      // framebuffer already holds from the region sizes and fields
+      std::map<Memory,size_t> valid_bytes;
+      for (unsigned idx = 0; idx < task.regions.size(); idx++)
+      {
+        const RegionRequirement &req = task.regions[idx];
+        // Skip requirements that never read their data
+        if ((req.privilege == NO_ACCESS) || (req.privilege == REDUCE) ||
+            (req.privilege == WRITE_DISCARD) || req.privilege_fields.empty())
+          continue;
+        size_t volume = 0;
+        for (std::vector<PhysicalInstance>::const_iterator it = 
+              input.valid_instances[idx].begin(); it != 
+              input.valid_instances[idx].end(); it++)
+        {
+          const Memory location = it->get_location();
+          if (location.kind() != Memory::GPU_FB_MEM)
+            continue;
+          if (volume == 0)
+            volume = runtime->get_index_space_domain(ctx,
+                        req.region.get_index_space()).get_volume();
+          size_t field_bytes = 0;
+          for (std::set<FieldID>::const_iterator fit = 
+                req.privilege_fields.begin(); fit != 
+                req.privilege_fields.end(); fit++)
+            if (it->has_field(*fit))
+              field_bytes += runtime->get_field_size(ctx,
+                                req.region.get_field_space(), *fit);
+          valid_bytes[location] += volume * field_bytes;
+        }
+      }
+      if (valid_bytes.empty())
+        return task.target_proc;
+      // Data in our own framebuffer counts double, data that we can 
+      // read directly from a peer's framebuffer avoids going over PCIe
+      Processor result = task.target_proc;
+      size_t best_score = 0;
+      for (std::map<Processor,Memory>::const_iterator gpu_it = 
+            gpu_framebuffers.begin(); gpu_it != gpu_framebuffers.end(); gpu_it++)
+      {
+        size_t score = 0;
+        std::map<Memory,size_t>::const_iterator finder = 
+          valid_bytes.find(gpu_it->second);
+        if (finder != valid_bytes.end())
+          score += 2 * finder->second;
+        std::map<Processor,std::set<Memory> >::const_iterator peer_finder =
+          gpu_peer_framebuffers.find(gpu_it->first);
+        if (peer_finder != gpu_peer_framebuffers.end())
+        {
+          for (std::set<Memory>::const_iterator it = 
+                peer_finder->second.begin(); it != 
+                peer_finder->second.end(); it++)
+          {
+            finder = valid_bytes.find(*it);
+            if (finder != valid_bytes.end())
+              score += finder->second;
+          }
+        }
+        // Only move away from the original target for a strictly better one
+        if ((score > best_score) || 
+            ((score == best_score) && (gpu_it->first == task.target_proc)))
+        {
+          result = gpu_it->first;
+          best_score = score;
+        }
+      }
+      return result;
+    }
+
     //--------------------------------------------------------------------------
     TaskPriority DefaultMapper::default_policy_select_task_priority(
                                     MapperContext ctx, const Task &task)
@@ -1773,24 +2026,35 @@ namespace Legion {
     //--------------------------------------------------------------------------
     void DefaultMapper::default_remove_cached_task(MapperContext ctx,
         VariantID chosen_variant, unsigned long long task_hash,
+        const std::vector<unsigned long long> &task_signature,
         const std::pair<TaskID,Processor> &cache_key,
         const std::vector<std::vector<PhysicalInstance> > &post_filter)
     //--------------------------------------------------------------------------
     {
-      std::map<std::pair<TaskID,Processor>,
-               std::list<CachedTaskMapping> >::iterator
-                 finder = cached_task_mappings.find(cache_key);
-      if (finder != cached_task_mappings.end())
+      // Keep a list of instances for which we need to downgrade
+      // their garbage collection priorities since we are no
+      // longer caching the results
+      std::deque<PhysicalInstance> to_downgrade;
+      const unsigned shard = cache_shard(cache_key.first);
       {
-        // Keep a list of instances for which we need to downgrade
-        // their garbage collection priorities since we are no
-        // longer caching the results
-        std::deque<PhysicalInstance> to_downgrade;
-        for (std::list<CachedTaskMapping>::iterator it = 
-              finder->second.begin(); it != finder->second.end(); it++)
+        AutoCacheLock m_lock(mapping_locks[shard]);
+        std::map<std::pair<TaskID,Processor>,
+                 std::multimap<unsigned long long,
+                               CachedTaskMapping> >::iterator
+                   finder = cached_task_mappings[shard].find(cache_key);
+        if (finder == cached_task_mappings[shard].end())
+          return;
+        std::pair<std::multimap<unsigned long long,
+                                CachedTaskMapping>::iterator,
+                  std::multimap<unsigned long long,
+                                CachedTaskMapping>::iterator> range =
+          finder->second.equal_range(task_hash);
+        for (std::multimap<unsigned long long,CachedTaskMapping>::iterator 
+              cit = range.first; cit != range.second; cit++)
         {
+          CachedTaskMapping *it = &(cit->second);
           if ((it->variant == chosen_variant) &&
-              (it->task_hash == task_hash))
+              (it->task_signature == task_signature))
           {
             // Record all the instances for which we will need to
             // down grade their garbage collection priority 
@@ -1828,19 +2092,56 @@ namespace Legion {
                 }
               }
             }
-            finder->second.erase(it);
+            finder->second.erase(cit);
             break;
           }
         }
         if (finder->second.empty())
-          cached_task_mappings.erase(finder);
-        if (!to_downgrade.empty())
+          cached_task_mappings[shard].erase(finder);
+      }
+      if (!to_downgrade.empty())
+      {
+        for (std::deque<PhysicalInstance>::const_iterator it =
+              to_downgrade.begin(); it != to_downgrade.end(); it++)
+          runtime->set_garbage_collection_priority(ctx, *it, 0/*priority*/);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_invalidate_cached_tasks(MapperContext ctx,
+                                                        TaskID task_id)
+    //--------------------------------------------------------------------------
+    {
+      // Drop every cached mapping for this task on any processor, this is
+      // the path for derived mappers that know the old mappings are stale
+      std::deque<PhysicalInstance> to_downgrade;
+      const unsigned shard = cache_shard(task_id);
+      {
+        AutoCacheLock m_lock(mapping_locks[shard]);
+        std::map<std::pair<TaskID,Processor>,
+                 std::multimap<unsigned long long,
+                               CachedTaskMapping> >::iterator it = 
+          cached_task_mappings[shard].lower_bound(
+              std::pair<TaskID,Processor>(task_id, Processor::NO_PROC));
+        while ((it != cached_task_mappings[shard].end()) && 
+               (it->first.first == task_id))
         {
-          for (std::deque<PhysicalInstance>::const_iterator it =
-                to_downgrade.begin(); it != to_downgrade.end(); it++)
-            runtime->set_garbage_collection_priority(ctx, *it, 0/*priority*/);
+          for (std::multimap<unsigned long long,CachedTaskMapping>::
+                const_iterator cit = it->second.begin(); 
+                cit != it->second.end(); cit++)
+            for (unsigned idx = 0; idx < cit->second.mapping.size(); idx++)
+              to_downgrade.insert(to_downgrade.end(),
+                  cit->second.mapping[idx].begin(), 
+                  cit->second.mapping[idx].end());
+          std::map<std::pair<TaskID,Processor>,
+                   std::multimap<unsigned long long,
+                             CachedTaskMapping> >::iterator to_delete = it++;
+          cached_task_mappings[shard].erase(to_delete);
         }
       }
+      for (std::deque<PhysicalInstance>::const_iterator it =
+            to_downgrade.begin(); it != to_downgrade.end(); it++)
+        runtime->set_garbage_collection_priority(ctx, *it, 0/*priority*/);
     }
 
     //--------------------------------------------------------------------------
@@ -1848,34 +2149,48 @@ namespace Legion {
                                                                const Task &task)
     //--------------------------------------------------------------------------
     {
-      // Use Sean's "cheesy" hash function    
-      const unsigned long long c1 = 0x5491C27F12DB3FA5; // big number, mix 1+0s
-      const unsigned long long c2 = 353435097; // chosen by fair dice roll
-      // We have to hash all region requirements including region names,
+      std::vector<unsigned long long> signature;
+      return compute_task_signature(task, signature);
+    }
+
+    //--------------------------------------------------------------------------
+    /*static*/ unsigned long long DefaultMapper::compute_task_signature(
+              const Task &task, std::vector<unsigned long long> &signature)
+    //--------------------------------------------------------------------------
+    {
+      // We have to record all region requirements including region names,
       // privileges, coherence modes, reduction operators, and fields
-      unsigned long long result = c2 + task.task_id;
+      signature.push_back(task.task_id);
       for (unsigned idx = 0; idx < task.regions.size(); idx++)
       {
         const RegionRequirement &req = task.regions[idx];
-        result = result * c1 + c2 + req.handle_type;
+        signature.push_back(req.handle_type);
         if (req.handle_type != PART_PROJECTION) {
-          result = result * c1 + c2 + req.region.get_tree_id();
-          result = result * c1 + c2 + req.region.get_index_space().get_id();
-          result = result * c1 + c2 + req.region.get_field_space().get_id();
+          signature.push_back(req.region.get_tree_id());
+          signature.push_back(req.region.get_index_space().get_id());
+          signature.push_back(req.region.get_field_space().get_id());
         } else {
-          result = result * c1 + c2 + req.partition.get_tree_id();
-          result = result * c1 + c2 + 
-                                  req.partition.get_index_partition().get_id();
-          result = result * c1 + c2 + req.partition.get_field_space().get_id();
+          signature.push_back(req.partition.get_tree_id());
+          signature.push_back(req.partition.get_index_partition().get_id());
+          signature.push_back(req.partition.get_field_space().get_id());
         }
+        // Record the number of fields so the signature is unambiguous
+        signature.push_back(req.privilege_fields.size());
         for (std::set<FieldID>::const_iterator it = 
               req.privilege_fields.begin(); it != 
               req.privilege_fields.end(); it++)
-          result = result * c1 + c2 + *it;
-        result = result * c1 + c2 + req.privilege;
-        result = result * c1 + c2 + req.prop;
-        result = result * c1 + c2 + req.redop;
+          signature.push_back(*it);
+        signature.push_back(req.privilege);
+        signature.push_back(req.prop);
+        signature.push_back(req.redop);
       }
+      // Use Sean's "cheesy" hash function    
+      const unsigned long long c1 = 0x5491C27F12DB3FA5; // big number, mix 1+0s
+      const unsigned long long c2 = 353435097; // chosen by fair dice roll
+      unsigned long long result = c2;
+      for (std::vector<unsigned long long>::const_iterator it = 
+            signature.begin(); it != signature.end(); it++)
+        result = result * c1 + c2 + *it;
       return result;
     }
 
@@ -2013,10 +2328,25 @@ namespace Legion {
     {
       // TODO: deal with the updates in machine model which will
       //       invalidate this cache
-      std::map<Processor,Memory>::iterator it =
-        cached_target_memory.find(target_proc);
-      if (it != cached_target_memory.end()) return it->second;
+      {
+        AutoCacheLock c_lock(cache_lock, false/*exclusive*/);
+        std::map<Processor,Memory>::const_iterator finder =
+          cached_target_memory.find(target_proc);
+        if (finder != cached_target_memory.end()) return finder->second;
+      }
 
+      // CPUs and OpenMP processors always use their closest NUMA memory
+      if (numa_aware && ((target_proc.kind() == Processor::LOC_PROC) ||
+                         (target_proc.kind() == Processor::OMP_PROC)))
+      {
+        Memory socket = default_find_socket_memory(target_proc);
+        if (socket.exists())
+        {
+          AutoCacheLock c_lock(cache_lock);
+          cached_target_memory[target_proc] = socket;
+          return socket;
+        }
+      }
       // Find the visible memories from the processor for the given kind
       Machine::MemoryQuery visible_memories(machine);
       visible_memories.has_affinity_to(target_proc);
@@ -2043,10 +2373,137 @@ namespace Legion {
         }
       }
       assert(chosen.exists());
+      AutoCacheLock c_lock(cache_lock);
       cached_target_memory[target_proc] = chosen;
       return chosen;
     }
 
+    //--------------------------------------------------------------------------
+    Memory DefaultMapper::default_policy_select_spill_memory(MapperContext ctx,
+                                                   Processor target_proc,
+                                                   Memory target_memory)
+    //--------------------------------------------------------------------------
+    {
+      // Only framebuffers spill, into the zero-copy memory with the
+      // highest bandwidth to the processor so the task can still run there
+      if (target_memory.kind() != Memory::GPU_FB_MEM)
+        return Memory::NO_MEMORY;
+      Machine::MemoryQuery zcopy_memories(machine);
+      zcopy_memories.only_kind(Memory::Z_COPY_MEM);
+      zcopy_memories.has_affinity_to(target_proc);
+      Memory chosen = Memory::NO_MEMORY;
+      unsigned best_bandwidth = 0;
+      std::vector<Machine::ProcessorMemoryAffinity> affinity(1);
+      for (Machine::MemoryQuery::iterator it = zcopy_memories.begin();
+            it != zcopy_memories.end(); it++)
+      {
+        affinity.clear();
+        machine.get_proc_mem_affinity(affinity, target_proc, *it,
+                                      false /*not just local affinities*/);
+        assert(affinity.size() == 1);
+        if (!chosen.exists() || (affinity[0].bandwidth > best_bandwidth)) {
+          chosen = *it;
+          best_bandwidth = affinity[0].bandwidth;
+        }
+      }
+      return chosen;
+    }
+
+    //--------------------------------------------------------------------------
+    Memory DefaultMapper::default_find_socket_memory(Processor proc)
+    //--------------------------------------------------------------------------
+    {
+      {
+        AutoCacheLock c_lock(cache_lock, false/*exclusive*/);
+        std::map<Processor,Memory>::const_iterator finder = 
+          cached_socket_memory.find(proc);
+        if (finder != cached_socket_memory.end())
+          return finder->second;
+      }
+      // Socket memories can be visible from every CPU so pick the one
+      // that has the highest bandwidth to this processor
+      Machine::MemoryQuery socket_memories(machine);
+      socket_memories.only_kind(Memory::SOCKET_MEM);
+      socket_memories.has_affinity_to(proc);
+      Memory chosen = Memory::NO_MEMORY;
+      unsigned best_bandwidth = 0;
+      std::vector<Machine::ProcessorMemoryAffinity> affinity(1);
+      for (Machine::MemoryQuery::iterator it = socket_memories.begin();
+            it != socket_memories.end(); it++)
+      {
+        affinity.clear();
+        machine.get_proc_mem_affinity(affinity, proc, *it,
+                                      false /*not just local affinities*/);
+        assert(affinity.size() == 1);
+        if (!chosen.exists() || (affinity[0].bandwidth > best_bandwidth)) {
+          chosen = *it;
+          best_bandwidth = affinity[0].bandwidth;
+        }
+      }
+      AutoCacheLock c_lock(cache_lock);
+      cached_socket_memory[proc] = chosen;
+      return chosen;
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_sort_processors_by_socket(
+                                                std::vector<Processor> &procs)
+    //--------------------------------------------------------------------------
+    {
+      if (procs.size() < 2)
+        return;
+      // Keep the original order within each socket
+      std::vector<Memory> sockets;
+      std::map<Memory,std::vector<Processor> > by_socket;
+      for (std::vector<Processor>::const_iterator it = 
+            procs.begin(); it != procs.end(); it++)
+      {
+        Memory socket = default_find_socket_memory(*it);
+        std::map<Memory,std::vector<Processor> >::iterator finder = 
+          by_socket.find(socket);
+        if (finder == by_socket.end())
+        {
+          sockets.push_back(socket);
+          by_socket[socket].push_back(*it);
+        }
+        else
+          finder->second.push_back(*it);
+      }
+      // Nothing to do if they are all on the same socket 
+      if (sockets.size() == 1)
+        return;
+      procs.clear();
+      for (std::vector<Memory>::const_iterator it = 
+            sockets.begin(); it != sockets.end(); it++)
+      {
+        const std::vector<Processor> &socket_procs = by_socket[*it];
+        procs.insert(procs.end(), socket_procs.begin(), socket_procs.end());
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_record_socket_usage(MapperContext ctx,
+                              Memory target_memory, LogicalRegion region,
+                              const LayoutConstraintSet &constraints)
+    //--------------------------------------------------------------------------
+    {
+      // This is an estimate from the size of the region and the fields
+      // since the mapper cannot see the actual size of the instance
+      size_t field_bytes = 0;
+      const std::vector<FieldID> &fields = 
+        constraints.field_constraint.get_field_set();
+      for (std::vector<FieldID>::const_iterator it = 
+            fields.begin(); it != fields.end(); it++)
+        field_bytes += runtime->get_field_size(ctx, 
+                                        region.get_field_space(), *it);
+      const Domain domain = 
+        runtime->get_index_space_domain(ctx, region.get_index_space());
+      AutoCacheLock c_lock(cache_lock);
+      std::pair<unsigned,size_t> &usage = socket_memory_usage[target_memory];
+      usage.first++;
+      usage.second += domain.get_volume() * field_bytes;
+    }
+
     //--------------------------------------------------------------------------
     LayoutConstraintID DefaultMapper::default_policy_select_layout_constraints(
                                     MapperContext ctx, Memory target_memory, 
@@ -2064,18 +2521,22 @@ namespace Legion {
         force_new_instances = true;
         std::pair<Memory::Kind,ReductionOpID> constraint_key(
             target_memory.kind(), req.redop);
-        std::map<std::pair<Memory::Kind,ReductionOpID>,LayoutConstraintID>::
-          const_iterator finder = reduction_constraint_cache.find(
-                                                            constraint_key);
-        // No need to worry about field constraint checks here
-        // since we don't actually have any field constraints
-        if (finder != reduction_constraint_cache.end())
-          return finder->second;
+        {
+          AutoCacheLock c_lock(cache_lock, false/*exclusive*/);
+          std::map<std::pair<Memory::Kind,ReductionOpID>,LayoutConstraintID>::
+            const_iterator finder = reduction_constraint_cache.find(
+                                                              constraint_key);
+          // No need to worry about field constraint checks here
+          // since we don't actually have any field constraints
+          if (finder != reduction_constraint_cache.end())
+            return finder->second;
+        }
         LayoutConstraintSet constraints;
         default_policy_select_constraints(ctx, constraints, target_memory, req);
         LayoutConstraintID result = 
           runtime->register_layout(ctx, constraints);
         // Save the result
+        AutoCacheLock c_lock(cache_lock);
         reduction_constraint_cache[constraint_key] = result;
         return result;
       }
@@ -2086,17 +2547,27 @@ namespace Legion {
       // See if we've already made a constraint set for this layout
       std::pair<Memory::Kind,FieldSpace> constraint_key(target_memory.kind(),
                                                req.region.get_field_space());
-      std::map<std::pair<Memory::Kind,FieldSpace>,LayoutConstraintID>::
-        const_iterator finder = layout_constraint_cache.find(constraint_key);
-      if (finder != layout_constraint_cache.end())
+      bool has_cached = false;
+      LayoutConstraintID cached = 0;
+      {
+        AutoCacheLock c_lock(cache_lock, false/*exclusive*/);
+        std::map<std::pair<Memory::Kind,FieldSpace>,LayoutConstraintID>::
+          const_iterator finder = layout_constraint_cache.find(constraint_key);
+        if (finder != layout_constraint_cache.end())
+        {
+          cached = finder->second;
+          has_cached = true;
+        }
+      }
+      if (has_cached)
       {
         // If we don't need a constraint check we are already good
         if (!needs_field_constraint_check)
-          return finder->second;
+          return cached;
         // Check that the fields still are the same, if not, fall through
         // so that we make a new set of constraints
         const LayoutConstraintSet &old_constraints =
-                runtime->find_layout_constraints(ctx, finder->second);
+                runtime->find_layout_constraints(ctx, cached);
         // Should be only one unless things have changed
         const std::vector<FieldID> &old_set = 
                           old_constraints.field_constraint.get_field_set();
@@ -2117,7 +2588,7 @@ namespace Legion {
             }
           }
           if (still_equal)
-            return finder->second;
+            return cached;
         }
         // Otherwise we fall through and make a new constraint which
         // will also update the cache
@@ -2132,6 +2603,7 @@ namespace Legion {
       // call could have registered the exact same registration constraints
       // here if we were preempted during the registration call. The 
       // constraint sets are identical though so it's all good.
+      AutoCacheLock c_lock(cache_lock);
       layout_constraint_cache[constraint_key] = result;
       return result; 
     }
@@ -2184,6 +2656,46 @@ namespace Legion {
     }
 
 
+    //--------------------------------------------------------------------------
+    bool DefaultMapper::default_create_spillable_instances(MapperContext ctx,
+                          Processor target_proc, Memory target_memory,
+                          const RegionRequirement &req, unsigned index,
+                          std::set<FieldID> &needed_fields,
+                          const TaskLayoutConstraintSet &layout_constraints,
+                          bool needs_field_constraint_check,
+                          std::vector<PhysicalInstance> &instances,
+                          bool &spilled)
+    //--------------------------------------------------------------------------
+    {
+      if (!spill_instances)
+        return default_create_custom_instances(ctx, target_proc, 
+                  target_memory, req, index, needed_fields, layout_constraints,
+                  needs_field_constraint_check, instances);
+      // Save what we need to start over since a failed attempt
+      // can leave some of the instances made and fields consumed
+      const std::set<FieldID> original_fields = needed_fields;
+      const size_t original_instances = instances.size();
+      if (default_create_custom_instances(ctx, target_proc, target_memory,
+                req, index, needed_fields, layout_constraints,
+                needs_field_constraint_check, instances))
+        return true;
+      Memory spill_memory = 
+        default_policy_select_spill_memory(ctx, target_proc, target_memory);
+      if (!spill_memory.exists())
+        return false;
+      log_mapper.debug("Default mapper spilling region requirement %d "
+                       "from memory " IDFMT " to memory " IDFMT,
+                       index, target_memory.id, spill_memory.id);
+      needed_fields = original_fields;
+      instances.resize(original_instances);
+      if (!default_create_custom_instances(ctx, target_proc, spill_memory,
+                req, index, needed_fields, layout_constraints,
+                needs_field_constraint_check, instances))
+        return false;
+      spilled = true;
+      return true;
+    }
+
     //--------------------------------------------------------------------------
     bool DefaultMapper::default_make_instance(MapperContext ctx, 
         Memory target_memory, const LayoutConstraintSet &constraints,
@@ -2213,6 +2725,9 @@ namespace Legion {
                 kind, target_memory, result, meets, (req.privilege == REDUCE));
         if (priority != 0)
           runtime->set_garbage_collection_priority(ctx, result,priority);
+        if (target_memory.kind() == Memory::SOCKET_MEM)
+          default_record_socket_usage(ctx, target_memory, 
+                                      target_region, constraints);
       }
       return true;
     }
@@ -2486,8 +3001,7 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       log_mapper.spew("Default speculate for Task in %s", get_mapper_name());
-      // Default mapper doesn't speculate
-      output.speculate = false;
+      default_policy_speculate(ctx, output);
     }
 
     //--------------------------------------------------------------------------
@@ -2734,8 +3248,23 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       log_mapper.spew("Default speculate for Copy in %s", get_mapper_name());
-      // Default mapper doesn't speculate
-      output.speculate = false;
+      default_policy_speculate(ctx, output);
+    }
+
+    //--------------------------------------------------------------------------
+    void DefaultMapper::default_policy_speculate(MapperContext ctx,
+                                                 SpeculativeOutput &output)
+    //--------------------------------------------------------------------------
+    {
+      // Without speculation the runtime holds the dependence analysis
+      // of the operation, and everything issued after it, until the
+      // predicate resolves. When enabled we guess that predicates are
+      // true, which is the common case for loops testing convergence,
+      // and only speculate on the mapping. The execution stays guarded
+      // by the predicate so a wrong guess just poisons the launch.
+      output.speculate = speculate_predicates;
+      output.speculative_value = true;
+      output.speculate_mapping_only = true;
     }
 
     //--------------------------------------------------------------------------
@@ -101,6 +101,9 @@ namespace Legion {
       struct CachedTaskMapping {
       public:
         unsigned long long                          task_hash;
+        // The exact values that went into the hash so that 
+        // collisions can never reuse the wrong mapping
+        std::vector<unsigned long long>             task_signature;
         VariantID                                   variant;
         std::vector<std::vector<PhysicalInstance> > mapping;
         bool                                        has_reductions;
@@ -318,6 +321,9 @@ namespace Legion {
                                     MapperContext ctx,
                                     const Task &task,
                                     std::vector<Processor> &target_procs);
+      virtual Processor default_policy_select_gpu_by_locality(
+                                    MapperContext ctx, const Task &task,
+                                    const MapTaskInput &input);
       virtual TaskPriority default_policy_select_task_priority(
                                     MapperContext ctx, const Task &task);
       virtual CachedMappingPolicy default_policy_select_task_cache_policy(
@@ -340,6 +346,9 @@ namespace Legion {
       virtual Memory default_policy_select_target_memory(MapperContext ctx, 
                                     Processor target_proc,
                                     const RegionRequirement &req);
+      virtual Memory default_policy_select_spill_memory(MapperContext ctx,
+                                    Processor target_proc,
+                                    Memory target_memory);
       virtual LayoutConstraintID default_policy_select_layout_constraints(
                                     MapperContext ctx, Memory target_memory,
                                     const RegionRequirement &req,
@@ -368,6 +377,8 @@ namespace Legion {
                                     const LayoutConstraintSet &constraints,
                                     bool force_new_instances, 
                                     bool meets_constraints);
+      virtual void default_policy_speculate(MapperContext ctx,
+                                    SpeculativeOutput &output);
       virtual int default_policy_select_garbage_collection_priority(
                                     MapperContext ctx, 
                                     MappingKind kind, Memory memory, 
@@ -383,6 +394,24 @@ namespace Legion {
                                     const MapperContext ctx, 
                                     LogicalRegion region,
                                     PhysicalInstance target_instance);
+    protected:
+      // Scoped hold on one of the reservations that protect the mapper's
+      // internal state when it runs with the concurrent mapper model, it
+      // does nothing for serialized mappers since they never make them.
+      // Never perform a runtime call while holding one of these locks.
+      class AutoCacheLock {
+      public:
+        AutoCacheLock(Reservation lock, bool exclusive = true);
+        ~AutoCacheLock(void);
+      private:
+        AutoCacheLock(const AutoCacheLock &rhs);
+        AutoCacheLock& operator=(const AutoCacheLock &rhs);
+      private:
+        const Reservation lock;
+      };
+      static const unsigned CACHE_SHARDS = 16;
+      static inline unsigned cache_shard(TaskID task_id)
+        { return (task_id % CACHE_SHARDS); }
     protected: // help for generating random numbers
       long default_generate_random_integer(void) const;
       double default_generate_random_real(void) const;
@@ -418,6 +447,16 @@ namespace Legion {
                               const TaskLayoutConstraintSet &layout_constraints,
                               bool needs_field_constraint_check,
                               std::vector<PhysicalInstance> &instances);
+      // Same as above but falls back to the spill memory for the
+      // target memory if the instances don't fit and spilling is on
+      bool default_create_spillable_instances(MapperContext ctx,
+                              Processor target, Memory target_memory,
+                              const RegionRequirement &req, unsigned index,
+                              std::set<FieldID> &needed_fields, // will destroy
+                              const TaskLayoutConstraintSet &layout_constraints,
+                              bool needs_field_constraint_check,
+                              std::vector<PhysicalInstance> &instances,
+                              bool &spilled);
       bool default_make_instance(MapperContext ctx, Memory target_memory,
                               const LayoutConstraintSet &constraints, 
                               PhysicalInstance &result, MappingKind kind,
@@ -428,9 +467,16 @@ namespace Legion {
                               Memory target_memory) const;
       void default_remove_cached_task(MapperContext ctx, VariantID variant,
                               unsigned long long task_hash,
+                              const std::vector<unsigned long long> &signature,
                               const std::pair<TaskID,Processor> &cache_key,
                               const std::vector<
                                 std::vector<PhysicalInstance> > &post_filter);
+      void default_invalidate_cached_tasks(MapperContext ctx, TaskID task_id);
+      Memory default_find_socket_memory(Processor proc);
+      void default_sort_processors_by_socket(std::vector<Processor> &procs);
+      void default_record_socket_usage(MapperContext ctx, 
+                              Memory target_memory, LogicalRegion region,
+                              const LayoutConstraintSet &constraints);
       template<bool IS_SRC>
       void default_create_copy_instance(MapperContext ctx, const Copy &copy,
                               const RegionRequirement &req, unsigned index,
@@ -461,6 +507,8 @@ namespace Legion {
                             long long int factor, 
                             const Rect<DIM,coord_t> &rect_to_factor);
       static unsigned long long compute_task_hash(const Task &task);
+      static unsigned long long compute_task_signature(const Task &task,
+                              std::vector<unsigned long long> &signature);
       static inline bool physical_sort_func(
                          const std::pair<PhysicalInstance,unsigned> &left,
                          const std::pair<PhysicalInstance,unsigned> &right)
@@ -501,21 +549,39 @@ namespace Legion {
                               *global_io_query, *global_procset_query,
                               *global_omp_query, *global_py_query;
     protected: 
-      // Cached mapping information about the application
+      // Cached mapping information about the application. The variant and
+      // task mapping caches are sharded by task ID so that mapper calls
+      // for different tasks don't contend in the concurrent model.
       std::map<Domain,std::vector<TaskSlice> > gpu_slices_cache,
                                                cpu_slices_cache,
                                                io_slices_cache,
                                                procset_slices_cache,
                                                omp_slices_cache,
                                                py_slices_cache;
-      std::map<TaskID,VariantInfo>             preferred_variants; 
+      std::map<TaskID,VariantInfo>     preferred_variants[CACHE_SHARDS]; 
       std::map<std::pair<TaskID,Processor>,
-               std::list<CachedTaskMapping> >  cached_task_mappings;
+               std::multimap<unsigned long long,
+                 CachedTaskMapping> > cached_task_mappings[CACHE_SHARDS];
       std::map<std::pair<Memory::Kind,FieldSpace>,
                LayoutConstraintID>             layout_constraint_cache;
       std::map<std::pair<Memory::Kind,ReductionOpID>,
                LayoutConstraintID>             reduction_constraint_cache;
       std::map<Processor,Memory>               cached_target_memory;
+      std::map<Processor,Memory>               cached_socket_memory;
+      // The framebuffer of each local GPU and the framebuffers of
+      // other GPUs that it can access directly as a peer
+      std::map<Processor,Memory>               gpu_framebuffers;
+      std::map<Processor,std::set<Memory> >    gpu_peer_framebuffers;
+      // Instances and bytes that this mapper has created in each NUMA memory
+      std::map<Memory,std::pair<unsigned,size_t> > socket_memory_usage;
+    protected:
+      // Locks for the state above, these only exist in the concurrent model
+      Reservation variant_locks[CACHE_SHARDS];
+      Reservation mapping_locks[CACHE_SHARDS];
+      // Protects the round-robin state and the random number generator
+      Reservation round_robin_lock;
+      // Protects the slice, memory, and layout constraint caches
+      Reservation cache_lock;
     protected:
       // The maximum number of tasks a mapper will allow to be stolen at a time
       // Controlled by -dm:thefts
@@ -530,6 +596,23 @@ namespace Legion {
       bool stealing_enabled;
       // The maximum number of tasks scheduled per step
       unsigned max_schedule_count;
+      // Prefer the NUMA memory closest to CPU and OpenMP processors
+      // Controlled by -dm:numa
+      bool numa_aware;
+      // Move GPU tasks to the GPU with the most valid data for them
+      // Controlled by -dm:gpu_locality
+      bool gpu_locality;
+      // Speculatively map predicated tasks and copies as if their 
+      // predicates were true, controlled by -dm:speculate
+      bool speculate_predicates;
+      // Use the concurrent mapper model so that mapper calls can run in
+      // parallel on different utility processors, controlled by
+      // -dm:concurrent
+      bool concurrent_mapping;
+      // Put task instances that don't fit in a GPU framebuffer in
+      // zero-copy memory instead of failing the mapping, controlled
+      // by -dm:spill
+      bool spill_instances;
     };
 
   }; // namespace Mapping
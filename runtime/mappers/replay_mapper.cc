@@ -16,6 +16,10 @@
 #include "mappers/replay_mapper.h"
 #include "legion/legion_utilities.h"
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 namespace Legion {
   namespace Mapping {
 
@@ -36,7 +40,9 @@ namespace Legion {
     ReplayMapper::ReplayMapper(MapperRuntime *rt, Machine m, Processor local,
                                const char *replay_file, const char *name)
       : Mapper(rt), machine(m), local_proc(local), 
-        mapper_name((name == NULL) ? create_replay_name(local) : name)
+        mapper_name((name == NULL) ? create_replay_name(local) : name),
+        index_file(NULL), index_mapping(NULL), index_mapping_size(0),
+        task_index(NULL), num_task_index(0)
     //--------------------------------------------------------------------------
     {
       FILE *f = fopen(replay_file, "rb");
@@ -127,6 +133,15 @@ namespace Legion {
       ignore_result(fread(&top_level_id, sizeof(top_level_id), 1, f));
       unsigned num_tasks;
       ignore_result(fread(&num_tasks, sizeof(num_tasks), 1, f));
+      // If the file has a task index then we skip over all the tasks
+      // now and only read each one the first time it is needed
+      TaskIndexFooter footer;
+      if (map_task_index(f, footer))
+      {
+        assert(footer.num_entries == num_tasks);
+        fseek(f, footer.tasks_end, SEEK_SET);
+        num_tasks = 0;
+      }
       for (unsigned idx = 0; idx < num_tasks; idx++)
       {
         std::pair<UniqueID,DomainPoint> key;
@@ -169,7 +184,10 @@ namespace Legion {
         ignore_result(fread(&uid, sizeof(uid), 1, f));
         release_mappings[uid] = unpack_release_mapping(f);
       }
-      fclose(f);
+      if (task_index != NULL)
+        index_file = f;
+      else
+        fclose(f);
     }
 
     //--------------------------------------------------------------------------
@@ -187,6 +205,10 @@ namespace Legion {
     //--------------------------------------------------------------------------
     {
       free(const_cast<char*>(mapper_name));
+      if (index_mapping != NULL)
+        munmap(index_mapping, index_mapping_size);
+      if (index_file != NULL)
+        fclose(index_file);
     }
 
     //--------------------------------------------------------------------------
@@ -1285,9 +1307,7 @@ namespace Legion {
       if (finder != original_mappings.end())
       {
         // We've already got it
-        std::pair<UniqueID,DomainPoint> key(finder->second, p);
-        assert(task_mappings.find(key) != task_mappings.end());
-        return task_mappings[key];
+        return load_task_mapping(finder->second, p);
       }
       if (parent)
       {
@@ -1306,18 +1326,14 @@ namespace Legion {
           runtime->wait_on_mapper_event(ctx, wait_finder->second);
         // When we wake up it should be there
         assert(original_mappings.find(unique_id) != original_mappings.end());
-        std::pair<UniqueID,DomainPoint> key(original_mappings[unique_id], p);
-        assert(task_mappings.find(key) != task_mappings.end());
-        return task_mappings[key];
+        return load_task_mapping(original_mappings[unique_id], p);
       }
       else if (task.get_depth() == 0)
       {
         // Handle the root case
-        std::pair<UniqueID,DomainPoint> key(top_level_id, p);
-        assert(task_mappings.find(key) != task_mappings.end());
         // Save the ID 
         original_mappings[unique_id] = top_level_id;
-        return task_mappings[key];
+        return load_task_mapping(top_level_id, p);
       }
       else
       {
@@ -1336,6 +1352,17 @@ namespace Legion {
         {
           // If this is an index task, just return the first one
           // with the proper ID
+          if (task_index != NULL)
+          {
+            const TaskIndexEntry *entry = 
+              find_task_index_entry(original_id, NULL/*any point*/);
+            assert(entry != NULL);
+            DomainPoint point;
+            point.dim = entry->dim;
+            for (int i = 0; i < entry->dim; i++)
+              point.point_data[i] = entry->point[i];
+            return load_task_mapping(original_id, point);
+          }
           for (std::map<std::pair<UniqueID,DomainPoint>,
                         TaskMappingInfo*>::const_iterator it = 
                 task_mappings.begin(); it != task_mappings.end(); it++)
@@ -1346,11 +1373,121 @@ namespace Legion {
           assert(false);
         }
         // Single task case
-        std::pair<UniqueID,DomainPoint> key(original_id, p);
-        assert(task_mappings.find(key) != task_mappings.end());
-        // Save the ID
-        return task_mappings[key];
+        return load_task_mapping(original_id, p);
+      }
+    }
+
+    //--------------------------------------------------------------------------
+    bool ReplayMapper::map_task_index(FILE *f, TaskIndexFooter &footer)
+    //--------------------------------------------------------------------------
+    {
+      // Older replay files do not have an index so look for the footer
+      // and go back to where we were if we can't find it
+      const long current = ftell(f);
+      if ((fseek(f, -long(sizeof(footer)), SEEK_END) != 0) ||
+          (fread(&footer, sizeof(footer), 1, f) != 1) ||
+          (footer.magic != TASK_INDEX_MAGIC) || 
+          (footer.version != TASK_INDEX_VERSION))
+      {
+        fseek(f, current, SEEK_SET);
+        return false;
+      }
+      struct stat file_stats;
+      if (fstat(fileno(f), &file_stats) != 0)
+      {
+        fseek(f, current, SEEK_SET);
+        return false;
+      }
+      index_mapping_size = file_stats.st_size;
+      index_mapping = mmap(NULL, index_mapping_size, PROT_READ, 
+                           MAP_SHARED, fileno(f), 0);
+      if (index_mapping == MAP_FAILED)
+      {
+        log_replay.warning("Unable to memory map replay file index, "
+                           "falling back to loading all task mappings.");
+        index_mapping = NULL;
+        index_mapping_size = 0;
+        fseek(f, current, SEEK_SET);
+        return false;
+      }
+      assert((footer.index_offset + 
+          footer.num_entries * sizeof(TaskIndexEntry)) <= index_mapping_size);
+      task_index = reinterpret_cast<const TaskIndexEntry*>(
+          static_cast<const char*>(index_mapping) + footer.index_offset);
+      num_task_index = footer.num_entries;
+      fseek(f, current, SEEK_SET);
+      return true;
+    }
+
+    //--------------------------------------------------------------------------
+    const ReplayMapper::TaskIndexEntry* ReplayMapper::find_task_index_entry(
+                     UniqueID original_id, const DomainPoint *point) const
+    //--------------------------------------------------------------------------
+    {
+      // Binary search for the first entry that is not less than the key,
+      // a NULL point finds the first entry for the unique ID
+      size_t lower = 0, upper = num_task_index;
+      while (lower < upper)
+      {
+        const size_t middle = lower + (upper - lower) / 2;
+        const TaskIndexEntry &entry = task_index[middle];
+        bool less = false;
+        if (entry.unique_id != (unsigned long long)original_id)
+          less = (entry.unique_id < (unsigned long long)original_id);
+        else if (point != NULL)
+        {
+          if (entry.dim != point->dim)
+            less = (entry.dim < point->dim);
+          else
+          {
+            for (int i = 0; i < entry.dim; i++)
+            {
+              if (entry.point[i] == point->point_data[i])
+                continue;
+              less = (entry.point[i] < point->point_data[i]);
+              break;
+            }
+          }
+        }
+        if (less)
+          lower = middle + 1;
+        else
+          upper = middle;
+      }
+      if (lower == num_task_index)
+        return NULL;
+      const TaskIndexEntry &result = task_index[lower];
+      if (result.unique_id != (unsigned long long)original_id)
+        return NULL;
+      if (point != NULL)
+      {
+        if (result.dim != point->dim)
+          return NULL;
+        for (int i = 0; i < result.dim; i++)
+          if (result.point[i] != point->point_data[i])
+            return NULL;
       }
+      return &result;
+    }
+
+    //--------------------------------------------------------------------------
+    ReplayMapper::TaskMappingInfo* ReplayMapper::load_task_mapping(
+                           UniqueID original_id, const DomainPoint &point)
+    //--------------------------------------------------------------------------
+    {
+      const std::pair<UniqueID,DomainPoint> key(original_id, point);
+      std::map<std::pair<UniqueID,DomainPoint>,TaskMappingInfo*>::
+        const_iterator finder = task_mappings.find(key);
+      if (finder != task_mappings.end())
+        return finder->second;
+      // If it's not here then it must be in the index still
+      assert(task_index != NULL);
+      const TaskIndexEntry *entry = find_task_index_entry(original_id, &point);
+      assert(entry != NULL);
+      fseek(index_file, entry->offset, SEEK_SET);
+      TaskMappingInfo *result = unpack_task_mapping(index_file);
+      task_mappings[key] = result;
+      return result;
     }
 
     //--------------------------------------------------------------------------
@@ -125,6 +125,26 @@ namespace Legion {
       public:
         TemporaryMapping *temporary;
       };
+      // These match the task index that Legion Spy appends to the end of
+      // replay files, entries are sorted by unique ID and then by point
+      struct TaskIndexEntry {
+      public:
+        unsigned long long unique_id;
+        int dim;
+        int padding;
+        long long point[3];
+        unsigned long long offset;
+      };
+      struct TaskIndexFooter {
+      public:
+        unsigned long long index_offset;
+        unsigned long long num_entries;
+        unsigned long long tasks_end;
+        unsigned magic;
+        unsigned version;
+      };
+      static const unsigned TASK_INDEX_MAGIC = 0x4C525049; // LRPI
+      static const unsigned TASK_INDEX_VERSION = 1;
     public:
       enum ReplayMessageKind {
         ID_MAPPING_MESSAGE,
@@ -334,6 +354,11 @@ namespace Legion {
       CopyMappingInfo* unpack_copy_mapping(FILE *f) const;
       CloseMappingInfo* unpack_close_mapping(FILE *f) const;
       ReleaseMappingInfo* unpack_release_mapping(FILE *f) const;
+      bool map_task_index(FILE *f, TaskIndexFooter &footer);
+      const TaskIndexEntry* find_task_index_entry(UniqueID original_id, 
+                                  const DomainPoint *point) const;
+      TaskMappingInfo* load_task_mapping(UniqueID original_id,
+                                         const DomainPoint &point);
       RequirementMapping* unpack_requirement(FILE *f) const;
       TemporaryMapping* unpack_temporary(FILE *f) const;
       TunableMapping* unpack_tunable(FILE *f) const;
@@ -354,6 +379,14 @@ namespace Legion {
       const Machine machine;
       const Processor local_proc;
       const char *const mapper_name;
+    protected:
+      // When the replay file has a task index we keep it open and 
+      // memory map the index so that tasks are only read when needed
+      FILE                                               *index_file;
+      void                                               *index_mapping;
+      size_t                                             index_mapping_size;
+      const TaskIndexEntry                               *task_index;
+      size_t                                             num_task_index;
     protected:
       std::map<unsigned long,InstanceInfo*>              instance_infos;
       std::map<std::pair<UniqueID/*original*/,DomainPoint>,TaskMappingInfo*>
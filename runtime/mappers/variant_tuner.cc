@@ -0,0 +1,303 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "mappers/variant_tuner.h"
+
+#include <stdio.h>
+
+namespace Legion {
+  namespace Mapping {
+    namespace Utilities {
+
+      /************************
+       * Variant Tuner
+       ************************/
+
+      //------------------------------------------------------------------------
+      VariantTuner::VariantTuner(unsigned needed, unsigned max)
+        : needed_samples((needed > 0) ? needed : 1),
+          max_samples((max > 0) ? max : 1)
+      //------------------------------------------------------------------------
+      {
+      }
+
+      //------------------------------------------------------------------------
+      void VariantTuner::set_needed_samples(unsigned num_samples)
+      //------------------------------------------------------------------------
+      {
+        if (num_samples > 0)
+          needed_samples = num_samples;
+      }
+
+      //------------------------------------------------------------------------
+      void VariantTuner::set_max_samples(unsigned max)
+      //------------------------------------------------------------------------
+      {
+        if (max > 0)
+          max_samples = max;
+      }
+
+      //------------------------------------------------------------------------
+      VariantID VariantTuner::select_variant(MapperRuntime *runtime,
+                 MapperContext ctx, const Task &task, Processor::Kind kind)
+      //------------------------------------------------------------------------
+      {
+        std::vector<VariantID> variants;
+        runtime->find_valid_variants(ctx, task.task_id, variants, kind);
+        if (variants.empty())
+          return 0;
+        const TuningKey key(task.task_id,
+            compute_size_class(compute_task_volume(runtime, ctx, task)), kind);
+        const VariantID result =
+          select_variant(key.task_id, key.size_class, kind, variants);
+        // Remember what we picked so we can attribute the profiling
+        // response back to this variant when it comes in
+        PendingSample &sample = pending[task.get_unique_id()];
+        sample.key = key;
+        sample.variant = result;
+        results[key][result].in_flight++;
+        return result;
+      }
+
+      //------------------------------------------------------------------------
+      VariantID VariantTuner::select_variant(TaskID task_id,
+                     unsigned size_class, Processor::Kind kind,
+                     const std::vector<VariantID> &variants) const
+      //------------------------------------------------------------------------
+      {
+        if (variants.empty())
+          return 0;
+        TuningMap::const_iterator finder =
+          results.find(TuningKey(task_id, size_class, kind));
+        // Never seen this bucket before so start exploring with the first
+        if (finder == results.end())
+          return variants.front();
+        // Still warming up if any variant is short on samples, in which
+        // case we explore the one with the fewest samples (counting the
+        // ones still in flight so index space launches spread out)
+        VariantID explore = 0;
+        unsigned explore_count = needed_samples;
+        VariantID best = variants.front();
+        double best_time = -1.0;
+        for (std::vector<VariantID>::const_iterator it =
+              variants.begin(); it != variants.end(); it++)
+        {
+          VariantStatsMap::const_iterator var_finder =
+            finder->second.find(*it);
+          if (var_finder == finder->second.end())
+            return *it;
+          const VariantStats &stats = var_finder->second;
+          if (stats.samples < needed_samples)
+          {
+            const unsigned count = stats.samples + stats.in_flight;
+            if (count < explore_count)
+            {
+              explore = *it;
+              explore_count = count;
+            }
+            continue;
+          }
+          if ((best_time < 0.0) || (stats.mean_time < best_time))
+          {
+            best = *it;
+            best_time = stats.mean_time;
+          }
+        }
+        if (explore > 0)
+          return explore;
+        return best;
+      }
+
+      //------------------------------------------------------------------------
+      void VariantTuner::request_profiling(ProfilingRequest &requests) const
+      //------------------------------------------------------------------------
+      {
+        requests.add_measurement<ProfilingMeasurements::OperationTimeline>();
+      }
+
+      //------------------------------------------------------------------------
+      bool VariantTuner::record_profiling(const Task &task,
+                                        const Mapper::TaskProfilingInfo &input)
+      //------------------------------------------------------------------------
+      {
+        std::map<UniqueID,PendingSample>::iterator finder =
+          pending.find(task.get_unique_id());
+        if (finder == pending.end())
+          return false;
+        const PendingSample sample = finder->second;
+        pending.erase(finder);
+        VariantStats &stats = results[sample.key][sample.variant];
+        if (stats.in_flight > 0)
+          stats.in_flight--;
+        ProfilingMeasurements::OperationTimeline timeline;
+        if (!input.profiling_responses.get_measurement(timeline))
+          return false;
+        if ((timeline.start_time ==
+              ProfilingMeasurements::OperationTimeline::INVALID_TIMESTAMP) ||
+            (timeline.end_time < timeline.start_time))
+          return false;
+        record_sample(sample.key.task_id, sample.key.size_class,
+                      sample.key.kind, sample.variant,
+                      timeline.end_time - timeline.start_time);
+        return true;
+      }
+
+      //------------------------------------------------------------------------
+      void VariantTuner::record_sample(TaskID task_id, unsigned size_class,
+                               Processor::Kind kind, VariantID variant,
+                               long long execution_time)
+      //------------------------------------------------------------------------
+      {
+        VariantStats &stats =
+          results[TuningKey(task_id, size_class, kind)][variant];
+        if (stats.samples < max_samples)
+          stats.samples++;
+        // Running mean until we hit the maximum number of samples
+        // and then an exponential moving average after that
+        stats.mean_time +=
+          (double(execution_time) - stats.mean_time) / stats.samples;
+        if ((stats.min_time < 0) || (execution_time < stats.min_time))
+          stats.min_time = execution_time;
+      }
+
+      //------------------------------------------------------------------------
+      bool VariantTuner::is_tuned(TaskID task_id, unsigned size_class,
+                                  Processor::Kind kind,
+                                  const std::vector<VariantID> &variants) const
+      //------------------------------------------------------------------------
+      {
+        TuningMap::const_iterator finder =
+          results.find(TuningKey(task_id, size_class, kind));
+        if (finder == results.end())
+          return variants.empty();
+        for (std::vector<VariantID>::const_iterator it =
+              variants.begin(); it != variants.end(); it++)
+        {
+          VariantStatsMap::const_iterator var_finder =
+            finder->second.find(*it);
+          if ((var_finder == finder->second.end()) ||
+              (var_finder->second.samples < needed_samples))
+            return false;
+        }
+        return true;
+      }
+
+      //------------------------------------------------------------------------
+      bool VariantTuner::save(const char *filename) const
+      //------------------------------------------------------------------------
+      {
+        FILE *f = fopen(filename, "w");
+        if (f == NULL)
+          return false;
+        fprintf(f, "# task size_class kind variant samples mean_ns min_ns\n");
+        for (TuningMap::const_iterator it = results.begin();
+              it != results.end(); it++)
+        {
+          for (VariantStatsMap::const_iterator vit = it->second.begin();
+                vit != it->second.end(); vit++)
+          {
+            if (vit->second.samples == 0)
+              continue;
+            fprintf(f, "%u %u %d %lu %u %.1f %lld\n", it->first.task_id,
+                    it->first.size_class, int(it->first.kind),
+                    (unsigned long)vit->first, vit->second.samples,
+                    vit->second.mean_time, vit->second.min_time);
+          }
+        }
+        fclose(f);
+        return true;
+      }
+
+      //------------------------------------------------------------------------
+      bool VariantTuner::load(const char *filename)
+      //------------------------------------------------------------------------
+      {
+        FILE *f = fopen(filename, "r");
+        if (f == NULL)
+          return false;
+        char line[256];
+        while (fgets(line, sizeof(line), f) != NULL)
+        {
+          if (line[0] == '#')
+            continue;
+          unsigned task_id, size_class, samples;
+          int kind;
+          unsigned long variant;
+          double mean_time;
+          long long min_time;
+          if (sscanf(line, "%u %u %d %lu %u %lf %lld", &task_id, &size_class,
+                     &kind, &variant, &samples, &mean_time, &min_time) != 7)
+            continue;
+          if (samples == 0)
+            continue;
+          VariantStats &stats = results[TuningKey(task_id, size_class,
+                                  Processor::Kind(kind))][VariantID(variant)];
+          // Merge with anything we already have, weighted by sample count
+          const unsigned total = stats.samples + samples;
+          stats.mean_time = (stats.mean_time * stats.samples +
+                             mean_time * samples) / total;
+          stats.samples = (total < max_samples) ? total : max_samples;
+          if ((stats.min_time < 0) || (min_time < stats.min_time))
+            stats.min_time = min_time;
+        }
+        fclose(f);
+        return true;
+      }
+
+      //------------------------------------------------------------------------
+      /*static*/ unsigned VariantTuner::compute_size_class(size_t volume)
+      //------------------------------------------------------------------------
+      {
+        unsigned result = 0;
+        while (volume > 1)
+        {
+          volume >>= 1;
+          result++;
+        }
+        return result;
+      }
+
+      //------------------------------------------------------------------------
+      /*static*/ size_t VariantTuner::compute_task_volume(
+                   MapperRuntime *runtime, MapperContext ctx, const Task &task)
+      //------------------------------------------------------------------------
+      {
+        // The input size is the total number of points in all the
+        // regions the task is going to touch
+        size_t volume = 0;
+        for (std::vector<RegionRequirement>::const_iterator it =
+              task.regions.begin(); it != task.regions.end(); it++)
+        {
+          if (!it->region.exists())
+            continue;
+          volume += runtime->get_index_space_domain(ctx,
+                          it->region.get_index_space()).get_volume();
+        }
+        return volume;
+      }
+
+      //------------------------------------------------------------------------
+      VariantTuner::VariantStats::VariantStats(void)
+        : samples(0), in_flight(0), mean_time(0.0), min_time(-1)
+      //------------------------------------------------------------------------
+      {
+      }
+
+    }; // namespace Utilities
+  }; // namespace Mapping
+}; // namespace Legion
+
+// EOF
+
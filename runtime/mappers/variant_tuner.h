@@ -0,0 +1,160 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+
+#ifndef __VARIANT_TUNER__
+#define __VARIANT_TUNER__
+
+#include "legion.h"
+#include "legion/legion_mapping.h"
+
+#include <map>
+#include <vector>
+
+namespace Legion {
+  namespace Mapping {
+    namespace Utilities {
+
+      /**
+       * \class VariantTuner
+       * The Variant Tuner is a profile-guided autotuner that mappers
+       * can use to pick between the variants of a task. Executions are
+       * bucketed by task ID, processor kind and the size class of the
+       * input (the base-2 logarithm of the number of points the task
+       * touches). During a warm-up phase the tuner cycles through all
+       * the valid variants in a bucket until each of them has been
+       * measured the needed number of times. After that it always
+       * returns the variant with the lowest mean execution time.
+       *
+       * A mapper uses it by calling 'select_variant' from map_task,
+       * 'request_profiling' to ask for a timeline of the task, and
+       * 'record_profiling' from report_profiling. The tuned results
+       * can be written out with 'save' and read back with 'load' so
+       * that subsequent runs do not need to warm up again.
+       *
+       * The tuner does no synchronization of its own; mappers that
+       * are not serialized must protect it with their own lock.
+       */
+      class VariantTuner {
+      public:
+        VariantTuner(unsigned needed_samples = 3, unsigned max_samples = 32);
+      public:
+        /**
+         * Set the number of samples needed for each variant before
+         * the tuner will stop exploring it. The default is three.
+         */
+        void set_needed_samples(unsigned num_samples);
+        /**
+         * Set the maximum number of samples that contribute to the
+         * mean for each variant. Once the limit is reached the mean
+         * is updated as a moving average so the tuner can follow
+         * drift in performance. The default is 32.
+         */
+        void set_max_samples(unsigned max_samples);
+      public:
+        /**
+         * Pick a variant for the task for processors of the given kind.
+         * Returns zero if the task has no variants for that kind.
+         */
+        VariantID select_variant(MapperRuntime *runtime, MapperContext ctx,
+                                 const Task &task, Processor::Kind kind);
+        VariantID select_variant(TaskID task_id, unsigned size_class,
+                                 Processor::Kind kind,
+                                 const std::vector<VariantID> &variants) const;
+        /**
+         * Add the measurements that the tuner needs to a request set
+         */
+        void request_profiling(ProfilingRequest &requests) const;
+        /**
+         * Record the profiling response for a task previously handed
+         * to 'select_variant'. Returns true if a sample was recorded.
+         */
+        bool record_profiling(const Task &task,
+                              const Mapper::TaskProfilingInfo &input);
+        void record_sample(TaskID task_id, unsigned size_class,
+                           Processor::Kind kind, VariantID variant,
+                           long long execution_time);
+        /**
+         * Check whether every one of the given variants has been
+         * measured enough times for the tuner to have converged.
+         */
+        bool is_tuned(TaskID task_id, unsigned size_class, Processor::Kind kind,
+                      const std::vector<VariantID> &variants) const;
+      public:
+        /**
+         * Write the tuned results to a text file and read them back.
+         * Loading merges into the samples already recorded. Both
+         * return false if the file could not be opened.
+         */
+        bool save(const char *filename) const;
+        bool load(const char *filename);
+      public:
+        static unsigned compute_size_class(size_t volume);
+        static size_t compute_task_volume(MapperRuntime *runtime,
+                                          MapperContext ctx, const Task &task);
+      public:
+        struct VariantStats {
+        public:
+          VariantStats(void);
+        public:
+          unsigned samples;
+          unsigned in_flight; // not saved
+          double mean_time;
+          long long min_time;
+        };
+        struct TuningKey {
+        public:
+          TuningKey(void)
+            : task_id(0), size_class(0), kind(Processor::NO_KIND) { }
+          TuningKey(TaskID tid, unsigned size, Processor::Kind k)
+            : task_id(tid), size_class(size), kind(k) { }
+        public:
+          inline bool operator<(const TuningKey &rhs) const
+          {
+            if (task_id < rhs.task_id) return true;
+            if (task_id > rhs.task_id) return false;
+            if (size_class < rhs.size_class) return true;
+            if (size_class > rhs.size_class) return false;
+            return (kind < rhs.kind);
+          }
+        public:
+          TaskID task_id;
+          unsigned size_class;
+          Processor::Kind kind;
+        };
+        typedef std::map<VariantID,VariantStats> VariantStatsMap;
+        typedef std::map<TuningKey,VariantStatsMap> TuningMap;
+      public:
+        const TuningMap& get_tuning_results(void) const { return results; }
+      protected:
+        struct PendingSample {
+        public:
+          TuningKey key;
+          VariantID variant;
+        };
+      protected:
+        unsigned needed_samples;
+        unsigned max_samples;
+        TuningMap results;
+        // Tasks that have been handed a variant but not yet profiled
+        std::map<UniqueID,PendingSample> pending;
+      };
+
+    }; // namespace Utilities
+  }; // namespace Mapping
+}; // namespace Legion
+
+#endif // __VARIANT_TUNER__
+
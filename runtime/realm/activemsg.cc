@@ -55,6 +55,8 @@ static const void *ignore_gasnet_warning2 __attribute__((unused)) = (void *)_gas
 #include "realm/activemsg.h"
 
 #include <queue>
+#include <algorithm>
+#include <deque>
 #include <assert.h>
 #ifdef REALM_PROFILE_AM_HANDLERS
 #include <math.h>
@@ -63,6 +65,7 @@ static const void *ignore_gasnet_warning2 __attribute__((unused)) = (void *)_gas
 #ifdef DETAILED_MESSAGE_TIMING
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <time.h>
 #endif
 
 #include "realm/threads.h"
@@ -71,7 +74,8 @@ static const void *ignore_gasnet_warning2 __attribute__((unused)) = (void *)_gas
 
 #define NO_DEBUG_AMREQUESTS
 
-enum { MSGID_LONG_EXTENSION = 253,
+enum { MSGID_AGGREGATE = 251,
+       MSGID_LONG_EXTENSION = 253,
        MSGID_FLIP_REQ = 254,
        MSGID_FLIP_ACK = 255 };
 
@@ -235,27 +239,55 @@ public:
 
   void add_incoming_message(int sender, IncomingMessage *msg);
 
-  void start_handler_threads(int count, size_t stack_size);
+  void start_handler_threads(int count, int bulk_count, size_t stack_size);
 
   void shutdown(void);
 
+  // takes all the queued messages from one sender - if there are bulk
+  //  handler threads, no other thread will be given messages from that
+  //  sender until return_messages is called
   IncomingMessage *get_messages(int &sender, bool wait = true);
 
+  // called (only if there are bulk handler threads) once a thread is done
+  //  with a sender's messages - any that were not handled go back to the
+  //  front of that sender's queue
+  void return_messages(int sender, IncomingMessage *remaining);
+
   void handler_thread_loop(void);
+  void bulk_handler_thread_loop(void);
 
 protected:
+  void run_message(IncomingMessage *msg, int batch_index);
+
+  // hands a sender's messages (starting with a bulk one) to the bulk
+  //  handler threads
+  void offload_messages(int sender, IncomingMessage *msgs);
+  IncomingMessage *get_bulk_messages(int &sender);
+
   int nodes;
   int shutdown_flag;
+  // senders are only serialized (and bulk messages only recognized) if
+  //  there are bulk handler threads to offload to
+  bool offload_bulk;
   IncomingMessage **heads;
   IncomingMessage ***tails;
+  bool *in_progress;  // is a thread handling this sender's messages?
   int *todo_list; // list of nodes with non-empty message lists
   int todo_oldest, todo_newest;
   gasnet_hsl_t mutex;
   gasnett_cond_t condvar;
   Realm::CoreReservation *core_rsrv;
   std::vector<Realm::Thread *> handler_threads;
+  // messages whose handlers are too slow to run on the normal handler
+  //  threads, along with everything queued after them from the same sender
+  std::deque<std::pair<int, IncomingMessage *> > bulk_queue;
+  gasnett_cond_t bulk_condvar;
+  std::vector<Realm::Thread *> bulk_handler_threads;
 };
 
+// which handler threads may run each message type
+static unsigned char handler_classes[256];
+
 void init_deferred_frees(void)
 {
   gasnet_hsl_init(&deferred_free_mutex);
@@ -362,6 +394,33 @@ struct OutgoingMessage {
 #endif
 };
 
+// handlers used to unpack the messages in an aggregate, indexed by msgid
+static InlineHandlerFnptr inline_handlers[256];
+
+// each message in an aggregate is a header followed by its arguments and
+//  then its payload, with both padded out to 8 bytes so that payloads are as
+//  aligned as they would be if sent on their own
+struct AggregateRecordHeader {
+  int msgid;
+  int num_args;
+  unsigned payload_size;
+  unsigned pad;
+};
+
+static inline size_t aggregate_payload_offset(int num_args)
+{
+  return ((sizeof(AggregateRecordHeader) + num_args * sizeof(handlerarg_t) + 7) & ~(size_t)7);
+}
+
+static inline size_t aggregate_record_size(int num_args, size_t payload_size)
+{
+  return aggregate_payload_offset(num_args) + ((payload_size + 7) & ~(size_t)7);
+}
+
+// number of endpoints with a partially-filled aggregate - lets the polling
+//  threads skip the scan when nothing is being aggregated
+static int num_aggregating_endpoints = 0;
+
 Realm::Logger log_sdp("srcdatapool");
 
 class SrcDataPool {
@@ -380,6 +439,10 @@ public:
   // allocators must already hold the lock - prove it by passing a reference
   void *alloc_srcptr(size_t size_needed, Lock& held_lock);
 
+  // attempts to allocate a small srcptr from the size-class caches without
+  //  taking the main lock - returns 0 if nothing suitable is cached
+  void *alloc_srcptr_cached(size_t size_needed);
+
   // enqueuing a pending message must also hold the lock
   void add_pending(OutgoingMessage *msg, Lock& held_lock);
 
@@ -392,6 +455,8 @@ public:
 
   // release spilled memory (usually by moving it into actual srcdatapool)
   void release_spill_memory(size_t size_released, int msgtype, Lock& held_lock);
+  // same, but only takes the lock if there are suspended spillers to wake
+  void release_spill_memory(size_t size_released, int msgtype);
 
   void print_spill_data(Realm::Logger::LoggingLevel level = Realm::Logger::LEVEL_WARNING);
 
@@ -400,9 +465,39 @@ public:
 protected:
   size_t round_up_size(size_t size);
 
+  // records a new allocation in 'in_use' and 'block_classes'
+  void note_allocation(char *ptr, size_t size);
+
+  // removes any free ranges adjacent to [ptr, ptr+size) from the free list
+  //  and grows the range to cover them
+  void merge_free_neighbors(char *&ptr, size_t& size);
+
+  // moves every cached small block back into the main free list and stops
+  //  caching (so that pending allocations can see all free memory) or
+  //  resumes caching - must hold the main lock
+  void set_caching(bool enabled, Lock& held_lock);
+
+  static const size_t BLOCK_SIZE = 64;
+
+  // small allocations are released to (and reallocated from) per-size-class
+  //  free lists instead of the main free list - these lists are sharded
+  //  across several locks so that concurrent senders (and the thread
+  //  handling srcptr releases) don't all serialize on the main lock
+  // cached blocks remain in 'in_use' as far as the main allocator is
+  //  concerned
+  static const int NUM_SIZE_CLASSES = 64;  // 64B to 4KB
+  static const int NUM_CACHE_SHARDS = 8;
+  struct CacheShard {
+    gasnet_hsl_t mutex;
+    bool enabled;
+    size_t cached_bytes;
+    std::vector<char *> free_blocks[NUM_SIZE_CLASSES];
+  };
+
   friend class SrcDataPool::Lock;
   gasnet_hsl_t mutex;
   gasnett_cond_t condvar;
+  char *base_ptr;
   size_t total_size;
   std::map<char *, size_t> free_list;
   std::queue<OutgoingMessage *> pending_allocations;
@@ -410,13 +505,26 @@ protected:
   std::map<char *, size_t> in_use;
   std::map<void *, ssize_t> alloc_counts;
 
-  size_t current_spill_bytes, peak_spill_bytes, current_spill_threshold;
+  CacheShard cache_shards[NUM_CACHE_SHARDS];
+  size_t max_cached_bytes_per_shard;
+  // size class (plus one, with zero meaning "not cacheable") of each
+  //  allocation, indexed by its first block, so that a release can be
+  //  cached without looking up 'in_use'
+  unsigned char *block_classes;
+  size_t cache_hits, cache_misses;
+  int num_cache_shards_assigned;
+
+  volatile size_t current_spill_bytes;
+  size_t peak_spill_bytes, current_spill_threshold;
+  // memory that actually spilled because the pool was exhausted
+  size_t total_spill_bytes, total_spill_count;
 #define TRACK_PER_MESSAGE_SPILLING
 #ifdef TRACK_PER_MESSAGE_SPILLING
   size_t current_permsg_spill_bytes[256], peak_permsg_spill_bytes[256];
   size_t total_permsg_spill_bytes[256];
 #endif
-  int current_suspended_spillers, total_suspended_spillers;
+  volatile int current_suspended_spillers;
+  int total_suspended_spillers;
   double total_suspended_time;
 public:
   static size_t max_spill_bytes;
@@ -432,6 +540,9 @@ size_t SrcDataPool::print_spill_step = 1 << 30;       // default = 1 GB
 // certain threads are exempt from the max spillage due to deadlock concerns
 namespace ThreadLocal {
   __thread bool always_allow_spilling = false;
+
+  // shard of the srcdatapool's size-class caches this thread checks first
+  __thread int sdp_cache_shard = -1;
 };
 
 // wrapper so we don't have to expose SrcDataPool implementation
@@ -445,10 +556,24 @@ SrcDataPool::SrcDataPool(void *base, size_t size)
 {
   gasnet_hsl_init(&mutex);
   gasnett_cond_init(&condvar);
+  base_ptr = (char *)base;
   free_list[(char *)base] = size;
   total_size = size;
 
+  for(int i = 0; i < NUM_CACHE_SHARDS; i++) {
+    gasnet_hsl_init(&cache_shards[i].mutex);
+    cache_shards[i].enabled = true;
+    cache_shards[i].cached_bytes = 0;
+  }
+  // don't let the caches hold more than a quarter of the pool
+  max_cached_bytes_per_shard = size / (4 * NUM_CACHE_SHARDS);
+  block_classes = (unsigned char *)calloc((size + BLOCK_SIZE - 1) / BLOCK_SIZE, 1);
+  assert(block_classes != 0);
+  cache_hits = cache_misses = 0;
+  num_cache_shards_assigned = 0;
+
   current_spill_bytes = peak_spill_bytes = 0;
+  total_spill_bytes = total_spill_count = 0;
 #ifdef TRACK_PER_MESSAGE_SPILLING
   for(int i = 0; i < 256; i++)
     current_permsg_spill_bytes[i] = peak_permsg_spill_bytes[i] = total_permsg_spill_bytes[i] = 0;
@@ -471,11 +596,11 @@ SrcDataPool::~SrcDataPool(void)
     }
   }
   printf("SrcDataPool:  node %d: %zd total srcptrs, %zd nonzero\n", gasnet_mynode(), total, nonzero);
+  free(block_classes);
 }
 
 size_t SrcDataPool::round_up_size(size_t size)
 {
-  const size_t BLOCK_SIZE = 64;
   size_t remainder = size % BLOCK_SIZE;
   if(remainder)
     return size + (BLOCK_SIZE - remainder);
@@ -510,7 +635,7 @@ void *SrcDataPool::alloc_srcptr(size_t size_needed, Lock& held_lock)
 
       char *srcptr = it->first;
       free_list.erase(it);
-      in_use[srcptr] = size_needed;
+      note_allocation(srcptr, size_needed);
 
       return srcptr;
     }
@@ -535,18 +660,140 @@ void *SrcDataPool::alloc_srcptr(size_t size_needed, Lock& held_lock)
     it = free_list.find(smallest_upper_bound);
     char *srcptr = it->first + (it->second - size_needed);
     it->second -= size_needed;
-    in_use[srcptr] = size_needed;
+    note_allocation(srcptr, size_needed);
 
     log_sdp.debug("found %p + %zd > %zd", it->first, it->second, size_needed);
 
     return srcptr;
   }
 
+  // before giving up, see if the memory sitting in the size-class caches
+  //  would help - caching stays off if this allocation still fails, so that
+  //  any pending allocations it leads to see every release
+  bool caches_were_enabled = cache_shards[0].enabled;
+  if(caches_were_enabled) {
+    set_caching(false, held_lock);
+    void *srcptr = alloc_srcptr(size_needed, held_lock);
+    if(srcptr)
+      set_caching(true, held_lock);
+    return srcptr;
+  }
+
   // allocation failed - let caller decide what to do (probably add it as a
   //   pending allocation after maybe moving data)
   return 0;
 }
 
+void *SrcDataPool::alloc_srcptr_cached(size_t size_needed)
+{
+  size_needed = round_up_size(size_needed);
+  if(size_needed > (NUM_SIZE_CLASSES * BLOCK_SIZE))
+    return 0;
+  int size_class = (size_needed / BLOCK_SIZE) - 1;
+
+  int first_shard = ThreadLocal::sdp_cache_shard;
+  if(first_shard < 0) {
+    first_shard = (__sync_fetch_and_add(&num_cache_shards_assigned, 1) %
+		   NUM_CACHE_SHARDS);
+    ThreadLocal::sdp_cache_shard = first_shard;
+  }
+
+  // start with this thread's shard, but releases are spread over all of
+  //  them, so try the others too
+  for(int i = 0; i < NUM_CACHE_SHARDS; i++) {
+    CacheShard& shard = cache_shards[(first_shard + i) % NUM_CACHE_SHARDS];
+    if(shard.free_blocks[size_class].empty())
+      continue;  // unlocked check - may miss a block, which is harmless
+
+    char *srcptr = 0;
+    gasnet_hsl_lock(&shard.mutex);
+    if(shard.enabled && !shard.free_blocks[size_class].empty()) {
+      srcptr = shard.free_blocks[size_class].back();
+      shard.free_blocks[size_class].pop_back();
+      shard.cached_bytes -= size_needed;
+    }
+    gasnet_hsl_unlock(&shard.mutex);
+
+    if(srcptr) {
+      __sync_fetch_and_add(&cache_hits, 1);
+      log_sdp.debug("found %p + %zd - cached", srcptr, size_needed);
+      return srcptr;
+    }
+  }
+
+  __sync_fetch_and_add(&cache_misses, 1);
+  return 0;
+}
+
+void SrcDataPool::note_allocation(char *ptr, size_t size)
+{
+  in_use[ptr] = size;
+  block_classes[(ptr - base_ptr) / BLOCK_SIZE] =
+    ((size <= (NUM_SIZE_CLASSES * BLOCK_SIZE)) ? (size / BLOCK_SIZE) : 0);
+}
+
+void SrcDataPool::merge_free_neighbors(char *&ptr, size_t& size)
+{
+  if(free_list.empty())
+    return;
+
+  std::map<char *, size_t>::iterator above = free_list.lower_bound(ptr);
+
+  // look below first
+  while(above != free_list.begin()) {
+    std::map<char *, size_t>::iterator below = above;  below--;
+
+    log_sdp.spew("merge?  %p+%zd %p+%zd NONE", below->first, below->second, ptr, size);
+
+    if((below->first + below->second) != ptr)
+      break;
+
+    ptr = below->first;
+    size += below->second;
+    free_list.erase(below);
+  }
+
+  // now look above
+  while(above != free_list.end()) {
+    log_sdp.spew("merge?  NONE %p+%zd %p+%zd", ptr, size, above->first, above->second);
+
+    if((ptr + size) != above->first)
+      break;
+
+    size += above->second;
+    std::map<char *, size_t>::iterator to_nuke(above++);
+    free_list.erase(to_nuke);
+  }
+}
+
+void SrcDataPool::set_caching(bool enabled, Lock& held_lock)
+{
+  // lock order is always main lock then shard lock
+  for(int i = 0; i < NUM_CACHE_SHARDS; i++) {
+    CacheShard& shard = cache_shards[i];
+    gasnet_hsl_lock(&shard.mutex);
+    shard.enabled = enabled;
+    if(!enabled) {
+      for(int j = 0; j < NUM_SIZE_CLASSES; j++) {
+	for(std::vector<char *>::const_iterator it = shard.free_blocks[j].begin();
+	    it != shard.free_blocks[j].end();
+	    ++it) {
+	  char *ptr = *it;
+	  std::map<char *, size_t>::iterator it2 = in_use.find(ptr);
+	  assert(it2 != in_use.end());
+	  size_t size = it2->second;
+	  in_use.erase(it2);
+	  merge_free_neighbors(ptr, size);
+	  free_list[ptr] = size;
+	}
+	shard.free_blocks[j].clear();
+      }
+      shard.cached_bytes = 0;
+    }
+    gasnet_hsl_unlock(&shard.mutex);
+  }
+}
+
 void SrcDataPool::add_pending(OutgoingMessage *msg, Lock& held_lock)
 {
   // simple - just add to our queue
@@ -561,6 +808,13 @@ void SrcDataPool::add_pending(OutgoingMessage *msg, Lock& held_lock)
   }
 
   pending_allocations.push(msg);
+
+  // the payload is now sitting in (or about to be copied to) spill memory
+  total_spill_bytes += msg->payload_size;
+  total_spill_count++;
+#ifdef TRACK_PER_MESSAGE_SPILLING
+  total_permsg_spill_bytes[msg->msgid] += msg->payload_size;
+#endif
 }
 
 void SrcDataPool::release_srcptr(void *srcptr)
@@ -569,6 +823,26 @@ void SrcDataPool::release_srcptr(void *srcptr)
 
   log_sdp.debug("releasing srcptr = %p", srcptr);
 
+  // small blocks go back to a size-class cache if possible - the shard is
+  //  picked by address to spread releases out
+  int size_class = block_classes[(srcptr_c - base_ptr) / BLOCK_SIZE];
+  if(size_class > 0) {
+    size_t block_index = (srcptr_c - base_ptr) / BLOCK_SIZE;
+    CacheShard& shard = cache_shards[block_index % NUM_CACHE_SHARDS];
+    size_t size = size_class * BLOCK_SIZE;
+    bool cached = false;
+    gasnet_hsl_lock(&shard.mutex);
+    if(shard.enabled &&
+       ((shard.cached_bytes + size) <= max_cached_bytes_per_shard)) {
+      shard.free_blocks[size_class - 1].push_back(srcptr_c);
+      shard.cached_bytes += size;
+      cached = true;
+    }
+    gasnet_hsl_unlock(&shard.mutex);
+    if(cached)
+      return;
+  }
+
   // releasing a srcptr span may result in some pending allocations being
   //   satisfied - keep a list so their actual copies can happen without
   //   holding the SDP lock
@@ -586,35 +860,7 @@ void SrcDataPool::release_srcptr(void *srcptr)
     assert(free_list.find(srcptr_c) == free_list.end());
 
     // see if we can absorb any adjacent ranges
-    if(!free_list.empty()) {
-      std::map<char *, size_t>::iterator above = free_list.lower_bound(srcptr_c);
-      
-      // look below first
-      while(above != free_list.begin()) {
-	std::map<char *, size_t>::iterator below = above;  below--;
-	
-	log_sdp.spew("merge?  %p+%zd %p+%zd NONE", below->first, below->second, srcptr_c, size);
-
-	if((below->first + below->second) != srcptr_c)
-	  break;
-
-	srcptr_c = below->first;
-	size += below->second;
-	free_list.erase(below);
-      }
-
-      // now look above
-      while(above != free_list.end()) {
-	log_sdp.spew("merge?  NONE %p+%zd %p+%zd", srcptr_c, size, above->first, above->second);
-
-	if((srcptr_c + size) != above->first)
-	  break;
-
-	size += above->second;
-	std::map<char *, size_t>::iterator to_nuke(above++);
-	free_list.erase(to_nuke);
-      }
-    }
+    merge_free_neighbors(srcptr_c, size);
 
     // is this possibly-merged span large enough to satisfy the first pending
     //  allocation (if any)?
@@ -623,7 +869,7 @@ void SrcDataPool::release_srcptr(void *srcptr)
       OutgoingMessage *msg = pending_allocations.front();
       pending_allocations.pop();
       size_t act_size = round_up_size(msg->payload_size);
-      in_use[srcptr_c] = act_size;
+      note_allocation(srcptr_c, act_size);
       satisfied.push_back(std::make_pair(msg, srcptr_c));
 
       // was anything left?  if so, add it to the list of free spans
@@ -641,6 +887,10 @@ void SrcDataPool::release_srcptr(void *srcptr)
 	satisfied.push_back(std::make_pair(msg, ptr));
 	pending_allocations.pop();
       }
+
+      // once nobody is waiting, small releases can be cached again
+      if(pending_allocations.empty())
+	set_caching(true, held_lock);
     } else {
       // no?  then no other span will either, so just add this to the free list
       //  and return
@@ -663,12 +913,14 @@ void SrcDataPool::release_srcptr(void *srcptr)
 bool SrcDataPool::alloc_spill_memory(size_t size_needed, int msgtype, Lock& held_lock,
 				     bool first_try)
 {
+  // releases may decrease the spill count without holding the lock, so the
+  //  fit check here is conservative and the update must be atomic
   size_t new_spill_bytes = current_spill_bytes + size_needed;
 
   // case 1: it fits, so add to total and see if we need to print stuff
   if((max_spill_bytes == 0) || ThreadLocal::always_allow_spilling ||
      (new_spill_bytes <= max_spill_bytes)) {
-    current_spill_bytes = new_spill_bytes;
+    new_spill_bytes = __sync_add_and_fetch(&current_spill_bytes, size_needed);
     if(new_spill_bytes > peak_spill_bytes) {
       peak_spill_bytes = new_spill_bytes;
       if(peak_spill_bytes >= current_spill_threshold) {
@@ -677,8 +929,8 @@ bool SrcDataPool::alloc_spill_memory(size_t size_needed, int msgtype, Lock& held
       }
     }
 #ifdef TRACK_PER_MESSAGE_SPILLING
-    size_t new_permsg_spill_bytes = current_permsg_spill_bytes[msgtype] + size_needed;
-    current_permsg_spill_bytes[msgtype] = new_permsg_spill_bytes;
+    size_t new_permsg_spill_bytes = __sync_add_and_fetch(&current_permsg_spill_bytes[msgtype],
+							 size_needed);
     if(new_permsg_spill_bytes > peak_permsg_spill_bytes[msgtype])
       peak_permsg_spill_bytes[msgtype] = new_permsg_spill_bytes;
 #endif
@@ -694,7 +946,8 @@ bool SrcDataPool::alloc_spill_memory(size_t size_needed, int msgtype, Lock& held
 		    << current_spill_bytes << " + " << size_needed << " > " << max_spill_bytes;
 
   // if this is the first try for this message, increase the total waiter count and complain
-  current_suspended_spillers++;
+  // (atomically, so that an unlocked release either sees us or we see it)
+  __sync_fetch_and_add(&current_suspended_spillers, 1);
   if(first_try) {
     total_suspended_spillers++;
     if(total_suspended_spillers == 1)
@@ -711,7 +964,7 @@ bool SrcDataPool::alloc_spill_memory(size_t size_needed, int msgtype, Lock& held
 		      << current_spill_bytes << " + " << size_needed << " > " << max_spill_bytes << "?";
   }
 
-  current_suspended_spillers--;
+  __sync_fetch_and_sub(&current_suspended_spillers, 1);
 
   double t2 = Realm::Clock::current_time();
   double delta = t2 - t1;
@@ -724,10 +977,10 @@ bool SrcDataPool::alloc_spill_memory(size_t size_needed, int msgtype, Lock& held
 
 void SrcDataPool::release_spill_memory(size_t size_released, int msgtype, Lock& held_lock)
 {
-  current_spill_bytes -= size_released;
+  __sync_fetch_and_sub(&current_spill_bytes, size_released);
 
 #ifdef TRACK_PER_MESSAGE_SPILLING
-  current_permsg_spill_bytes[msgtype] -= size_released;
+  __sync_fetch_and_sub(&current_permsg_spill_bytes[msgtype], size_released);
 #endif
 
   // if there are any threads blocked on spilling data, wake them
@@ -737,12 +990,31 @@ void SrcDataPool::release_spill_memory(size_t size_released, int msgtype, Lock&
   }
 }
 
+void SrcDataPool::release_spill_memory(size_t size_released, int msgtype)
+{
+  __sync_fetch_and_sub(&current_spill_bytes, size_released);
+
+#ifdef TRACK_PER_MESSAGE_SPILLING
+  __sync_fetch_and_sub(&current_permsg_spill_bytes[msgtype], size_released);
+#endif
+
+  // only need the lock (and the condvar) if somebody is waiting
+  if(current_suspended_spillers > 0) {
+    Lock held_lock(*this);
+    log_spill.debug() << "waking " << current_suspended_spillers << " suspended spillers";
+    gasnett_cond_broadcast(&condvar);
+  }
+}
+
 void SrcDataPool::print_spill_data(Realm::Logger::LoggingLevel level)
 {
   Realm::LoggerMessage msg = log_spill.newmsg(level);
 
   msg << "current spill usage = "
-      << current_spill_bytes << " bytes, peak = " << peak_spill_bytes;
+      << current_spill_bytes << " bytes, peak = " << peak_spill_bytes
+      << ", total spilled = " << total_spill_bytes << " bytes in "
+      << total_spill_count << " messages"
+      << ", cache hits = " << cache_hits << " misses = " << cache_misses;
 #ifdef TRACK_PER_MESSAGE_SPILLING
   for(int i = 0; i < 256; i++)
     if(total_permsg_spill_bytes[i] > 0)
@@ -873,6 +1145,42 @@ static int num_lmbs = 2;
 static size_t lmb_size = 1 << 20; // 1 MB
 static bool force_long_messages = true;
 static int max_msgs_to_send = 8;
+// message aggregation is disabled unless a maximum aggregate size is given
+static size_t aggregate_max_bytes = 0;
+static size_t aggregate_max_msg_size = 256;
+static long long aggregate_max_wait_ns = 20000; // 20 us
+
+// how the network gets polled (-ll:amsg_poll)
+enum PollingMode {
+  POLL_SPIN,       // polling threads spin continuously on a shared core
+  POLL_DEDICATED,  // as above, but the polling threads get a core to themselves
+  POLL_ADAPTIVE,   // polling threads back off when idle, based on arrival rate
+  POLL_PIGGYBACK   // adaptive, and idle processor threads poll before sleeping
+};
+static PollingMode polling_mode = POLL_SPIN;
+static long long polling_max_backoff_ns = 50000; // 50 us
+static long long idle_polling_ns = 20000; // 20 us
+
+// bumped for every message received or queued for sending - the adaptive
+//  polling modes use it to tell whether a pass found anything to do
+static volatile long long polling_activity = 0;
+
+static inline void note_polling_activity(void)
+{
+  if(polling_mode >= POLL_ADAPTIVE)
+    __sync_fetch_and_add(&polling_activity, 1);
+}
+
+// cost/benefit accounting for the polling strategy, reported at shutdown
+struct PollingStats {
+  long long passes, active_passes;
+  long long total_ns, sleep_ns;
+  // delay a backoff added before a pass that found activity (i.e. an upper
+  //  bound on the extra latency seen by that activity)
+  long long added_latency_ns, max_added_latency_ns;
+  long long idle_passes, idle_poll_ns;  // by processor threads
+};
+static PollingStats polling_stats;
 
 // returns the largest payload that can be sent to a node (to a non-pinned
 //   address)
@@ -1017,18 +1325,21 @@ static DetailedMessageTiming detailed_message_timing;
 #endif
 
 IncomingMessageManager::IncomingMessageManager(int _nodes, Realm::CoreReservationSet& crs)
-  : nodes(_nodes), shutdown_flag(0)
+  : nodes(_nodes), shutdown_flag(0), offload_bulk(false)
 {
   heads = new IncomingMessage *[nodes];
   tails = new IncomingMessage **[nodes];
+  in_progress = new bool[nodes];
   for(int i = 0; i < nodes; i++) {
     heads[i] = 0;
     tails[i] = 0;
+    in_progress[i] = false;
   }
   todo_list = new int[nodes + 1];  // an extra entry to distinguish full from empty
   todo_oldest = todo_newest = 0;
   gasnet_hsl_init(&mutex);
   gasnett_cond_init(&condvar);
+  gasnett_cond_init(&bulk_condvar);
 
   core_rsrv = new Realm::CoreReservation("AM handlers", crs,
 					 Realm::CoreReservationParameters());
@@ -1038,6 +1349,7 @@ IncomingMessageManager::~IncomingMessageManager(void)
 {
   delete[] heads;
   delete[] tails;
+  delete[] in_progress;
   delete[] todo_list;
 }
 
@@ -1054,20 +1366,28 @@ void IncomingMessageManager::add_incoming_message(int sender, IncomingMessage *m
     tails[sender] = &(msg->next_msg);
   } else {
     // this starts a list, and the node needs to be added to the todo list
+    //  (unless a thread is still working on earlier messages, in which case
+    //  it will do so when it's done)
     heads[sender] = msg;
     tails[sender] = &(msg->next_msg);
-    todo_list[todo_newest] = sender;
-    todo_newest++;
-    if(todo_newest > nodes)
-      todo_newest = 0;
-    assert(todo_newest != todo_oldest);  // should never wrap around
-    gasnett_cond_broadcast(&condvar);  // wake up any sleepers
+    if(!in_progress[sender]) {
+      todo_list[todo_newest] = sender;
+      todo_newest++;
+      if(todo_newest > nodes)
+	todo_newest = 0;
+      assert(todo_newest != todo_oldest);  // should never wrap around
+      gasnett_cond_broadcast(&condvar);  // wake up any sleepers
+    }
   }
   gasnet_hsl_unlock(&mutex);
 }
 
-void IncomingMessageManager::start_handler_threads(int count, size_t stack_size)
+void IncomingMessageManager::start_handler_threads(int count, int bulk_count,
+						   size_t stack_size)
 {
+  // must be decided before any handler thread starts
+  offload_bulk = (bulk_count > 0);
+
   handler_threads.resize(count);
 
   Realm::ThreadLaunchParameters tlp;
@@ -1078,6 +1398,13 @@ void IncomingMessageManager::start_handler_threads(int count, size_t stack_size)
 							     &IncomingMessageManager::handler_thread_loop>(this,
 													   tlp,
 													   *core_rsrv);
+
+  bulk_handler_threads.resize(bulk_count);
+  for(int i = 0; i < bulk_count; i++)
+    bulk_handler_threads[i] = Realm::Thread::create_kernel_thread<IncomingMessageManager,
+								  &IncomingMessageManager::bulk_handler_thread_loop>(this,
+														     tlp,
+														     *core_rsrv);
 }
 
 void IncomingMessageManager::shutdown(void)
@@ -1086,6 +1413,7 @@ void IncomingMessageManager::shutdown(void)
   if(!shutdown_flag) {
     shutdown_flag = true;
     gasnett_cond_broadcast(&condvar);  // wake up any sleepers
+    gasnett_cond_broadcast(&bulk_condvar);
   }
   gasnet_hsl_unlock(&mutex);
 
@@ -1096,6 +1424,14 @@ void IncomingMessageManager::shutdown(void)
     delete (*it);
   }
   handler_threads.clear();
+
+  for(std::vector<Realm::Thread *>::iterator it = bulk_handler_threads.begin();
+      it != bulk_handler_threads.end();
+      it++) {
+    (*it)->join();
+    delete (*it);
+  }
+  bulk_handler_threads.clear();
 }
 
 IncomingMessage *IncomingMessageManager::get_messages(int &sender, bool wait)
@@ -1127,6 +1463,13 @@ IncomingMessage *IncomingMessageManager::get_messages(int &sender, bool wait)
     retval = heads[sender];
     heads[sender] = 0;
     tails[sender] = 0;
+    // messages from a given sender are handled by one thread at a time so
+    //  that they are handled in the order they were sent, even when some
+    //  are passed to the bulk handler threads
+    if(offload_bulk) {
+      assert(!in_progress[sender]);
+      in_progress[sender] = true;
+    }
 #ifdef DEBUG_INCOMING
     printf("handling incoming messages from %d\n", sender);
 #endif
@@ -1135,6 +1478,60 @@ IncomingMessage *IncomingMessageManager::get_messages(int &sender, bool wait)
   return retval;
 }    
 
+void IncomingMessageManager::return_messages(int sender, IncomingMessage *remaining)
+{
+  gasnet_hsl_lock(&mutex);
+  assert(in_progress[sender]);
+  in_progress[sender] = false;
+
+  // unhandled messages go in front of anything that arrived in the meantime
+  if(remaining) {
+    IncomingMessage *last = remaining;
+    while(last->next_msg)
+      last = last->next_msg;
+    last->next_msg = heads[sender];
+    if(!heads[sender])
+      tails[sender] = &(last->next_msg);
+    heads[sender] = remaining;
+  }
+
+  if(heads[sender]) {
+    todo_list[todo_newest] = sender;
+    todo_newest++;
+    if(todo_newest > nodes)
+      todo_newest = 0;
+    assert(todo_newest != todo_oldest);  // should never wrap around
+    gasnett_cond_broadcast(&condvar);  // wake up any sleepers
+  }
+  gasnet_hsl_unlock(&mutex);
+}
+
+void IncomingMessageManager::offload_messages(int sender, IncomingMessage *msgs)
+{
+  // sender stays in progress until the bulk handler thread returns whatever
+  //  it doesn't handle itself
+  gasnet_hsl_lock(&mutex);
+  bulk_queue.push_back(std::make_pair(sender, msgs));
+  gasnett_cond_signal(&bulk_condvar);
+  gasnet_hsl_unlock(&mutex);
+}
+
+IncomingMessage *IncomingMessageManager::get_bulk_messages(int &sender)
+{
+  gasnet_hsl_lock(&mutex);
+  while(bulk_queue.empty() && !shutdown_flag)
+    gasnett_cond_wait(&bulk_condvar, &mutex.lock);
+  IncomingMessage *retval = 0;
+  sender = -1;
+  if(!bulk_queue.empty()) {
+    sender = bulk_queue.front().first;
+    retval = bulk_queue.front().second;
+    bulk_queue.pop_front();
+  }
+  gasnet_hsl_unlock(&mutex);
+  return retval;
+}
+
 static IncomingMessageManager *incoming_message_manager = 0;
 
 extern void enqueue_incoming(NodeID sender, IncomingMessage *msg)
@@ -1144,6 +1541,26 @@ extern void enqueue_incoming(NodeID sender, IncomingMessage *msg)
 #endif
   assert(incoming_message_manager != 0);
   incoming_message_manager->add_incoming_message(sender, msg);
+  note_polling_activity();
+}
+
+void IncomingMessageManager::run_message(IncomingMessage *msg, int batch_index)
+{
+#ifdef DETAILED_MESSAGE_TIMING
+  int timing_idx = detailed_message_timing.get_next_index(); // grab this while we still hold the lock
+  CurrentTime start_time;
+#endif
+  msg->run_handler();
+#ifdef DETAILED_MESSAGE_TIMING
+  detailed_message_timing.record(timing_idx, 
+				 msg->get_peer(),
+				 msg->get_msgid(),
+				 -18, // 0xee - flagged as an incoming message,
+				 msg->get_msgsize(),
+				 batch_index, // how many messages we handle in a batch
+				 start_time, CurrentTime());
+#endif
+  delete msg;
 }
 
 void IncomingMessageManager::handler_thread_loop(void)
@@ -1160,31 +1577,87 @@ void IncomingMessageManager::handler_thread_loop(void)
 #endif
       break;
     }
-#ifdef DETAILED_MESSAGE_TIMING
     int count = 0;
-#endif
     while(current_msg) {
+      // a slow handler goes to the bulk handler threads, and takes the rest
+      //  of this sender's messages with it to preserve ordering
+      if(offload_bulk &&
+	 (handler_classes[current_msg->get_msgid()] == AM_HANDLER_BULK)) {
+	offload_messages(sender, current_msg);
+	break;
+      }
       IncomingMessage *next_msg = current_msg->next_msg;
-#ifdef DETAILED_MESSAGE_TIMING
-      int timing_idx = detailed_message_timing.get_next_index(); // grab this while we still hold the lock
-      CurrentTime start_time;
-#endif
-      current_msg->run_handler();
-#ifdef DETAILED_MESSAGE_TIMING
-      detailed_message_timing.record(timing_idx, 
-				     current_msg->get_peer(),
-				     current_msg->get_msgid(),
-				     -18, // 0xee - flagged as an incoming message,
-				     current_msg->get_msgsize(),
-				     count++, // how many messages we handle in a batch
-				     start_time, CurrentTime());
-#endif
-      delete current_msg;
+      run_message(current_msg, count++);
       current_msg = next_msg;
     }
+    if(offload_bulk && !current_msg)
+      return_messages(sender, 0);
   }
 }
 
+void IncomingMessageManager::bulk_handler_thread_loop(void)
+{
+  // messages enqueued in response to incoming messages can never be stalled
+  ThreadLocal::always_allow_spilling = true;
+
+  while (true) {
+    int sender = -1;
+    IncomingMessage *current_msg = get_bulk_messages(sender);
+    if(!current_msg)
+      break;
+
+    // keep going as long as the messages are bulk ones - the rest go back
+    //  to the normal handler threads
+    int count = 0;
+    do {
+      IncomingMessage *next_msg = current_msg->next_msg;
+      run_message(current_msg, count++);
+      current_msg = next_msg;
+    } while(current_msg &&
+	    (handler_classes[current_msg->get_msgid()] == AM_HANDLER_BULK));
+    return_messages(sender, current_msg);
+  }
+}
+
+// runs the handlers for every message packed into an aggregate, in the
+//  order they were sent
+class IncomingAggregateMessage : public IncomingMessage {
+public:
+  IncomingAggregateMessage(int _sender, const void *_msgdata, size_t _msglen,
+			   int _count)
+    : sender(_sender), msgdata(_msgdata), msglen(_msglen), count(_count)
+  {}
+
+  virtual void run_handler(void)
+  {
+    const char *pos = (const char *)msgdata;
+    for(int i = 0; i < count; i++) {
+      const AggregateRecordHeader *rh = (const AggregateRecordHeader *)pos;
+      assert((pos + sizeof(AggregateRecordHeader)) <= ((const char *)msgdata + msglen));
+      InlineHandlerFnptr fnptr = inline_handlers[rh->msgid];
+      assert(fnptr != 0);
+      (*fnptr)(sender,
+	       (const handlerarg_t *)(pos + sizeof(AggregateRecordHeader)),
+	       rh->num_args,
+	       (rh->payload_size ? (pos + aggregate_payload_offset(rh->num_args)) : 0),
+	       rh->payload_size);
+      pos += aggregate_record_size(rh->num_args, rh->payload_size);
+    }
+    assert(pos <= ((const char *)msgdata + msglen));
+    // the aggregate as a whole occupied one slot in the LMB
+    handle_long_msgptr(sender, msgdata);
+  }
+
+  virtual int get_peer(void) { return sender; }
+  virtual int get_msgid(void) { return MSGID_AGGREGATE; }
+  virtual size_t get_msgsize(void) { return msglen; }
+
+  int sender;
+  const void *msgdata;
+  size_t msglen;
+  int count;
+};
+
 class ActiveMessageEndpoint {
 public:
   struct ChunkInfo {
@@ -1213,6 +1686,13 @@ public:
     //cur_long_size = 0;
     next_outgoing_message_id = 0;
 
+    agg_buffer = 0;
+    agg_used = 0;
+    agg_count = 0;
+    agg_oldest = 0;
+    agg_wait_ns = 0;
+    agg_queued = 0;
+
     lmb_w_bases = new char *[num_lmbs];
     lmb_r_bases = new char *[num_lmbs];
     lmb_r_counts = new int[num_lmbs];
@@ -1393,6 +1873,8 @@ public:
             cur_write_offset = ((cur_write_offset >> 7) + 1) << 7;
 	  cur_write_count++;
 	  out_long_hdrs.pop();
+	  if(hdr->msgid == MSGID_AGGREGATE)
+	    agg_queued--;
 	  still_more = !(out_short_hdrs.empty() && out_long_hdrs.empty());
 
 #ifdef DETAILED_MESSAGE_TIMING
@@ -1474,6 +1956,11 @@ public:
 
   bool enqueue_message(OutgoingMessage *hdr, bool in_order)
   {
+    // small messages may be packed into an aggregate rather than being sent
+    //  on their own
+    if(can_aggregate(hdr))
+      return aggregate_message(hdr);
+
     // BEFORE we take the message manager's mutex, we reserve the ability to
     //  allocate spill data
     if((hdr->payload_size > 0) &&
@@ -1500,9 +1987,15 @@ public:
     // tell caller if we were empty before for managing todo lists
     bool was_empty = out_short_hdrs.empty() && out_long_hdrs.empty();
 
+    // anything already aggregated has to go out ahead of this message
+    if(agg_count > 0)
+      flush_aggregate_locked(AGG_FLUSH_ORDER);
+
     // messages that don't need space in the LMB can progress when the LMB is full
-    //  (unless they need to maintain ordering with long packets)
-    if(!in_order && (hdr->payload_size <= gasnet_AMMaxMedium()))
+    //  (unless they need to maintain ordering with long packets, or with
+    //  the messages in an aggregate that hasn't been sent yet)
+    if(!in_order && (agg_queued == 0) &&
+       (hdr->payload_size <= gasnet_AMMaxMedium()))
       out_short_hdrs.push(hdr);
     else
       out_long_hdrs.push(hdr);
@@ -1514,6 +2007,96 @@ public:
     return was_empty;
   }
 
+  bool can_aggregate(const OutgoingMessage *hdr) const
+  {
+    return ((aggregate_max_bytes > 0) &&
+	    (inline_handlers[hdr->msgid] != 0) &&
+	    (hdr->dstptr == 0) &&
+	    ((hdr->payload_mode == PAYLOAD_NONE) ||
+	     (hdr->payload_mode == PAYLOAD_EMPTY) ||
+	     (hdr->payload_size <= aggregate_max_msg_size)));
+  }
+
+  // copies a message into the current aggregate (starting a new one if
+  //  needed) and destroys it - returns true if a full aggregate was
+  //  enqueued AND we were empty before
+  bool aggregate_message(OutgoingMessage *hdr)
+  {
+    size_t payload_bytes = (((hdr->payload_mode == PAYLOAD_NONE) ||
+			     (hdr->payload_mode == PAYLOAD_EMPTY)) ?
+			      0 : hdr->payload_size);
+    size_t rec_size = aggregate_record_size(hdr->num_args, payload_bytes);
+    assert(rec_size <= aggregate_max_bytes);
+
+    gasnet_hsl_lock(&mutex);
+
+    bool was_empty = out_short_hdrs.empty() && out_long_hdrs.empty();
+    bool flushed = false;
+
+    if((agg_count > 0) && ((agg_used + rec_size) > aggregate_max_bytes)) {
+      flush_aggregate_locked(AGG_FLUSH_FULL);
+      flushed = true;
+    }
+
+    if(agg_count == 0) {
+      agg_buffer = (char *)malloc(aggregate_max_bytes);
+      assert(agg_buffer != 0);
+      agg_oldest = Realm::Clock::current_time_in_nanoseconds();
+      __sync_fetch_and_add(&num_aggregating_endpoints, 1);
+    }
+
+    char *rec = agg_buffer + agg_used;
+    AggregateRecordHeader *rh = (AggregateRecordHeader *)rec;
+    rh->msgid = hdr->msgid;
+    rh->num_args = hdr->num_args;
+    rh->payload_size = payload_bytes;
+    rh->pad = 0;
+    memcpy(rec + sizeof(AggregateRecordHeader), hdr->args,
+	   hdr->num_args * sizeof(handlerarg_t));
+    if(payload_bytes > 0)
+      hdr->payload_src->copy_data(rec + aggregate_payload_offset(hdr->num_args));
+    agg_used += rec_size;
+    agg_count++;
+
+    if(flushed)
+      gasnett_cond_signal(&cond);
+
+    gasnet_hsl_unlock(&mutex);
+
+    // the original message has been absorbed into the aggregate - make
+    //  sure its destructor doesn't try to free or un-spill anything
+    if(hdr->payload_src) {
+      delete hdr->payload_src;
+      hdr->payload_src = 0;
+    }
+    hdr->payload_mode = PAYLOAD_NONE;
+    hdr->payload_size = 0;
+    delete hdr;
+
+    return flushed && was_empty;
+  }
+
+  // sends the current aggregate if it has been waiting long enough (or
+  //  unconditionally if 'force' is set) - returns true if it was sent AND we
+  //  were empty before
+  bool flush_aggregate_if_aged(long long now, bool force)
+  {
+    // unlocked check to skip endpoints with nothing aggregated
+    if(agg_count == 0)
+      return false;
+
+    bool was_empty = false;
+    gasnet_hsl_lock(&mutex);
+    if((agg_count > 0) &&
+       (force || ((now - agg_oldest) >= agg_wait_ns))) {
+      was_empty = out_short_hdrs.empty() && out_long_hdrs.empty();
+      flush_aggregate_locked(force ? AGG_FLUSH_ORDER : AGG_FLUSH_AGED);
+      gasnett_cond_signal(&cond);
+    }
+    gasnet_hsl_unlock(&mutex);
+    return was_empty;
+  }
+
   // returns true if a message is enqueue AND we were empty before
   bool handle_long_msgptr(const void *ptr)
   {
@@ -1658,6 +2241,74 @@ public:
   }
 
 protected:
+  enum AggregateFlushReason {
+    AGG_FLUSH_FULL,   // next message didn't fit
+    AGG_FLUSH_AGED,   // oldest message waited as long as it should
+    AGG_FLUSH_ORDER,  // a non-aggregated message must follow (or shutdown)
+  };
+
+  // turns the current aggregate into a message at the back of the long
+  //  queue - must hold the endpoint mutex
+  void flush_aggregate_locked(AggregateFlushReason reason)
+  {
+    assert(agg_count > 0);
+
+    handlerarg_t args[5];
+    args[0] = BaseMedium::MESSAGE_ID_MAGIC;
+    args[1] = BaseMedium::MESSAGE_CHUNKS_MAGIC;
+    args[2] = 0;  // srcptr, filled in by send_long
+    args[3] = 0;
+    args[4] = agg_count;
+    OutgoingMessage *hdr = new OutgoingMessage(MSGID_AGGREGATE, 5, args);
+    hdr->set_payload(new ContiguousPayload(agg_buffer, agg_used, PAYLOAD_FREE),
+		     agg_used, PAYLOAD_FREE);
+
+    // the aggregate's buffer counts as spill memory like any other
+    //  PAYLOAD_FREE message, but we can't stall while holding the endpoint
+    //  mutex, so it is exempt from the spill limit (it's bounded by the
+    //  aggregate size anyway)
+    {
+      SrcDataPool::Lock held_lock(*srcdatapool);
+      bool prev_allow = ThreadLocal::always_allow_spilling;
+      ThreadLocal::always_allow_spilling = true;
+#ifndef NDEBUG
+      bool ok =
+#endif
+	srcdatapool->alloc_spill_memory(agg_used, MSGID_AGGREGATE,
+					held_lock, true /*first_try*/);
+      assert(ok);
+      ThreadLocal::always_allow_spilling = prev_allow;
+    }
+    hdr->reserve_srcdata();
+    out_long_hdrs.push(hdr);
+    // until this is sent, non-aggregated messages have to queue behind it
+    //  (see enqueue_message)
+    agg_queued++;
+
+    // adapt how long the polling thread lets an aggregate wait: back off
+    //  when waiting doesn't gather anything, and wait longer when messages
+    //  are showing up faster than we're sending them
+    switch(reason) {
+    case AGG_FLUSH_FULL:
+      agg_wait_ns = std::min(agg_wait_ns * 2 + 1000, aggregate_max_wait_ns);
+      break;
+    case AGG_FLUSH_AGED:
+      if(agg_count <= 1)
+	agg_wait_ns /= 2;
+      else
+	agg_wait_ns = std::min(agg_wait_ns + (aggregate_max_wait_ns >> 3) + 1,
+			       aggregate_max_wait_ns);
+      break;
+    case AGG_FLUSH_ORDER:
+      break;
+    }
+
+    agg_buffer = 0;
+    agg_used = 0;
+    agg_count = 0;
+    __sync_fetch_and_sub(&num_aggregating_endpoints, 1);
+  }
+
   void send_short(OutgoingMessage *hdr)
   {
     Realm::DetailedTimer::ScopedPush sp(TIME_AM);
@@ -2064,6 +2715,13 @@ public:
   //size_t cur_long_size;
   std::map<int/*message id*/,ChunkInfo> observed_messages;
   int next_outgoing_message_id;
+  // current (partially-filled) aggregate, if agg_count > 0
+  char *agg_buffer;
+  size_t agg_used;
+  int agg_count;
+  long long agg_oldest;
+  long long agg_wait_ns;  // adapted between 0 and aggregate_max_wait_ns
+  int agg_queued;  // flushed aggregates still in out_long_hdrs
 #ifdef TRACE_MESSAGES
   int sent_messages;
   int received_messages;
@@ -2120,8 +2778,17 @@ void OutgoingMessage::reserve_srcdata(void)
     // try to get the needed space in the srcdata pool
     assert(srcdatapool);
 
-    void *srcptr = 0;
-    {
+    // small payloads can often be satisfied from the size-class caches
+    //  without touching the pool's main lock
+    void *srcptr = srcdatapool->alloc_srcptr_cached(payload_size);
+    if(srcptr != 0) {
+      if((payload_mode == PAYLOAD_COPY) || (payload_mode == PAYLOAD_FREE)) {
+	log_spill.debug() << "returning " << payload_size << " unneeded bytes of spill";
+	srcdatapool->release_spill_memory(payload_size, msgid);
+      }
+      payload_mode = PAYLOAD_SRCPTR;
+      payload = srcptr;
+    } else {
       // take the SDP lock
       SrcDataPool::Lock held_lock(*srcdatapool);
 
@@ -2234,8 +2901,14 @@ public:
 
     // for worker threads
     shutdown_flag = false;
+    Realm::CoreReservationParameters params;
+    if(polling_mode == POLL_DEDICATED) {
+      params.set_num_cores(1);
+      params.set_alu_usage(params.CORE_USAGE_EXCLUSIVE);
+      params.set_ldst_usage(params.CORE_USAGE_SHARED);
+    }
     core_rsrv = new Realm::CoreReservation("EndpointManager workers", crs,
-					   Realm::CoreReservationParameters());
+					   params);
   }
 
   ~EndpointManager(void)
@@ -2261,6 +2934,7 @@ public:
     // wake up any sleepers
     gasnett_cond_broadcast(&condvar);
     gasnet_hsl_unlock(&mutex);
+    note_polling_activity();
   }
 
   void handle_flip_request(gasnet_node_t src, int flip_buffer, int flip_count)
@@ -2328,6 +3002,18 @@ public:
     if(was_empty)
       add_todo_entry(target);
   }
+  // called by the polling threads to send aggregates that have waited long
+  //  enough (or all of them, if 'force' is set)
+  void flush_aggregates(bool force)
+  {
+    if(num_aggregating_endpoints == 0)
+      return;
+
+    long long now = Realm::Clock::current_time_in_nanoseconds();
+    for(int i = 0; i < total_endpoints; i++)
+      if(endpoints[i] && endpoints[i]->flush_aggregate_if_aged(now, force))
+	add_todo_entry(i);
+  }
   void handle_long_msgptr(gasnet_node_t source, const void *ptr)
   {
     bool was_empty = endpoints[source]->handle_long_msgptr(ptr);
@@ -2402,6 +3088,21 @@ private:
 
 static EndpointManager *endpoint_manager;
 
+static std::vector<void (*)(void)> polling_callbacks;
+
+void add_polling_callback(void (*fnptr)(void))
+{
+  polling_callbacks.push_back(fnptr);
+}
+
+static inline void perform_polling_callbacks(void)
+{
+  for(std::vector<void (*)(void)>::const_iterator it = polling_callbacks.begin();
+      it != polling_callbacks.end();
+      it++)
+    (*it)();
+}
+
 static void handle_flip_req(gasnet_token_t token,
 		     int flip_buffer, int flip_count)
 {
@@ -2418,6 +3119,28 @@ static void handle_flip_ack(gasnet_token_t token,
   endpoint_manager->handle_flip_ack(src, ack_buffer);
 }
 
+static void handle_aggregate(gasnet_token_t token, void *buf, size_t nbytes,
+			     gasnet_handlerarg_t arg0, gasnet_handlerarg_t arg1,
+			     gasnet_handlerarg_t arg2, gasnet_handlerarg_t arg3,
+			     gasnet_handlerarg_t arg4)
+{
+  NodeID src = get_message_source(token);
+  bool handle_now = adjust_long_msgsize(src, buf, nbytes, arg0, arg1);
+  if(handle_now) {
+    IncomingAggregateMessage *imsg = new IncomingAggregateMessage(src, buf, nbytes, arg4);
+    uint64_t srcptr = (((uint64_t)(uint32_t)arg2) |
+		       (((uint64_t)(uint32_t)arg3) << 32));
+    enqueue_incoming(src, imsg);
+    // as with other mediums, release the srcptr immediately
+    if(srcptr) {
+      record_message(src, true);
+      send_srcptr_release(token, srcptr);
+    } else
+      record_message(src, false);
+  } else
+    record_message(src, false);
+}
+
 static const int MAX_HANDLERS = 128;
 static gasnet_handlerentry_t handlers[MAX_HANDLERS];
 static int hcount = 0;
@@ -2429,6 +3152,12 @@ void add_handler_entry(int msgid, void (*fnptr)())
   handlers[hcount].fnptr = fnptr;
   hcount++;
 }
+
+void add_inline_handler_entry(int msgid, InlineHandlerFnptr fnptr)
+{
+  assert((msgid >= 0) && (msgid < 256));
+  inline_handlers[msgid] = fnptr;
+}
 			   
 void init_endpoints(int gasnet_mem_size_in_mb,
 		    int registered_mem_size_in_mb,
@@ -2478,6 +3207,58 @@ void init_endpoints(int gasnet_mem_size_in_mb,
       SrcDataPool::max_spill_bytes = ((size_t)atoi(argv[++i])) << 20; // convert MB to bytes
       continue;
     }
+
+    if(!strcmp(argv[i], "-ll:amsg_agg")) {
+      aggregate_max_bytes = atoi(argv[++i]);
+      continue;
+    }
+
+    if(!strcmp(argv[i], "-ll:amsg_aggmsg")) {
+      aggregate_max_msg_size = atoi(argv[++i]);
+      continue;
+    }
+
+    if(!strcmp(argv[i], "-ll:amsg_aggwait")) {
+      aggregate_max_wait_ns = atoi(argv[++i]) * 1000LL; // convert us to ns
+      continue;
+    }
+
+    if(!strcmp(argv[i], "-ll:amsg_poll")) {
+      const char *mode = argv[++i];
+      if(!strcmp(mode, "spin"))
+	polling_mode = POLL_SPIN;
+      else if(!strcmp(mode, "dedicated"))
+	polling_mode = POLL_DEDICATED;
+      else if(!strcmp(mode, "adaptive"))
+	polling_mode = POLL_ADAPTIVE;
+      else if(!strcmp(mode, "piggyback"))
+	polling_mode = POLL_PIGGYBACK;
+      else {
+	log_amsg.fatal() << "unknown polling mode '" << mode << "' (expected spin, dedicated, adaptive or piggyback)";
+	assert(0);
+      }
+      continue;
+    }
+
+    if(!strcmp(argv[i], "-ll:amsg_pollmax")) {
+      polling_max_backoff_ns = atoi(argv[++i]) * 1000LL; // convert us to ns
+      continue;
+    }
+
+    if(!strcmp(argv[i], "-ll:amsg_idlepoll")) {
+      idle_polling_ns = atoi(argv[++i]) * 1000LL; // convert us to ns
+      continue;
+    }
+  }
+
+  if(aggregate_max_bytes > 0) {
+    // an aggregate has to fit in an LMB, and has to be able to hold the
+    //  largest message we'll put in it
+    if(aggregate_max_bytes > lmb_size)
+      aggregate_max_bytes = lmb_size;
+    if(aggregate_record_size(16, aggregate_max_msg_size) > aggregate_max_bytes)
+      aggregate_max_msg_size = (aggregate_max_bytes -
+				aggregate_payload_offset(16)) & ~(size_t)7;
   }
 
   size_t total_lmb_size = (gasnet_nodes() * 
@@ -2515,7 +3296,7 @@ void init_endpoints(int gasnet_mem_size_in_mb,
   }
 #endif
 
-  assert(hcount < (MAX_HANDLERS - 3));
+  assert(hcount < (MAX_HANDLERS - 4));
   handlers[hcount].index = MSGID_FLIP_REQ;
   handlers[hcount].fnptr = (void (*)())handle_flip_req;
   hcount++;
@@ -2525,10 +3306,14 @@ void init_endpoints(int gasnet_mem_size_in_mb,
   handlers[hcount].index = MSGID_RELEASE_SRCPTR;
   handlers[hcount].fnptr = (void (*)())SrcDataPool::release_srcptr_handler;
   hcount++;
+  handlers[hcount].index = MSGID_AGGREGATE;
+  handlers[hcount].fnptr = (void (*)())handle_aggregate;
+  hcount++;
 #ifdef ACTIVE_MESSAGE_TRACE
   record_am_handler(MSGID_FLIP_REQ, "Flip Request AM");
   record_am_handler(MSGID_FLIP_ACK, "Flip Acknowledgement AM");
   record_am_handler(MSGID_RELEASE_SRCPTR, "Release Source Pointer AM");
+  record_am_handler(MSGID_AGGREGATE, "Aggregated Messages AM");
 #endif
 
   CHECK_GASNET( gasnet_attach(handlers, hcount,
@@ -2575,11 +3360,65 @@ void init_endpoints(int gasnet_mem_size_in_mb,
 //  to the caller rather than spinning
 void do_some_polling(void)
 {
+  perform_polling_callbacks();
+
+  endpoint_manager->flush_aggregates(false /*!force*/);
+
   endpoint_manager->push_messages(max_msgs_to_send);
 
   CHECK_GASNET( gasnet_AMPoll() );
 }
 
+long long idle_polling_window_ns(void)
+{
+  return ((polling_mode == POLL_PIGGYBACK) ? idle_polling_ns : 0);
+}
+
+void do_idle_polling(const volatile long long *stop_counter,
+		     long long stop_value)
+{
+  long long start = Realm::Clock::current_time_in_nanoseconds();
+  long long deadline = start + idle_polling_ns;
+  long long now = start;
+  long long passes = 0;
+  while((*stop_counter == stop_value) && (now < deadline)) {
+    do_some_polling();
+    passes++;
+    now = Realm::Clock::current_time_in_nanoseconds();
+  }
+  __sync_fetch_and_add(&polling_stats.idle_passes, passes);
+  __sync_fetch_and_add(&polling_stats.idle_poll_ns, now - start);
+}
+
+static const char *polling_mode_name(PollingMode mode)
+{
+  switch(mode) {
+  case POLL_SPIN: return "spin";
+  case POLL_DEDICATED: return "dedicated";
+  case POLL_ADAPTIVE: return "adaptive";
+  case POLL_PIGGYBACK: return "piggyback";
+  }
+  return "unknown";
+}
+
+static void report_polling_stats(void)
+{
+  const PollingStats& s = polling_stats;
+  double cpu_pct = ((s.total_ns > 0) ?
+		    (100.0 * (s.total_ns - s.sleep_ns) / s.total_ns) : 0.0);
+  long long avg_pass_ns = ((s.passes > 0) ?
+			   ((s.total_ns - s.sleep_ns) / s.passes) : 0);
+  long long avg_added_ns = ((s.active_passes > 0) ?
+			    (s.added_latency_ns / s.active_passes) : 0);
+  log_amsg.info() << "polling: mode=" << polling_mode_name(polling_mode)
+		  << " passes=" << s.passes << " active=" << s.active_passes
+		  << " cpu=" << cpu_pct << "% pass=" << avg_pass_ns << "ns"
+		  << " added_latency(avg/max)=" << avg_added_ns << "/"
+		  << s.max_added_latency_ns << "ns"
+		  << " idle_passes=" << s.idle_passes
+		  << " idle_poll=" << s.idle_poll_ns << "ns";
+}
+
 void EndpointManager::start_polling_threads(int count)
 {
   polling_threads.resize(count);
@@ -2592,7 +3431,7 @@ void EndpointManager::start_polling_threads(int count)
 
 void EndpointManager::stop_threads(void)
 {
-  // none of our threads actually sleep, so we can just set the flag and wait for them to notice
+  // our threads never sleep for long, so we can just set the flag and wait for them to notice
   shutdown_flag = true;
   
   for(std::vector<Realm::Thread *>::iterator it = polling_threads.begin();
@@ -2603,6 +3442,8 @@ void EndpointManager::stop_threads(void)
   }
   polling_threads.clear();
 
+  report_polling_stats();
+
 #ifdef CHECK_OUTGOING_MESSAGES
   if(todo_oldest != todo_newest) {
     fprintf(stderr, "HELP!  shutdown occured with messages outstanding on node %d!\n", gasnet_mynode());
@@ -2630,15 +3471,84 @@ void EndpointManager::stop_threads(void)
 
 void EndpointManager::polling_worker_loop(void)
 {
+  bool adaptive = (polling_mode >= POLL_ADAPTIVE);
+  long long last_activity = polling_activity;
+  long long last_activity_time = Realm::Clock::current_time_in_nanoseconds();
+  long long mean_gap_ns = polling_max_backoff_ns;  // smoothed inter-arrival time
+  long long backoff_ns = 0;
+  long long slept_ns = 0;  // sleeping done since the last active pass
+  long long pass_start = last_activity_time;
+  // accumulated locally and added to the global stats on the way out
+  PollingStats stats;
+  memset(&stats, 0, sizeof(stats));
+
   while(true) {
+    // callbacks (e.g. aggregation flushes) go first so that any messages they
+    //  generate are pushed out on this same pass
+    perform_polling_callbacks();
+
+    // send aggregates that have waited long enough (or everything, once
+    //  we're shutting down)
+    endpoint_manager->flush_aggregates(shutdown_flag);
+
     bool still_more = endpoint_manager->push_messages(max_msgs_to_send);
 
     // check for shutdown, but only if we've pushed all of our messages
-    if(shutdown_flag && !still_more)
+    if(shutdown_flag && !still_more) {
+      __sync_fetch_and_add(&polling_stats.passes, stats.passes);
+      __sync_fetch_and_add(&polling_stats.active_passes, stats.active_passes);
+      __sync_fetch_and_add(&polling_stats.total_ns, stats.total_ns);
+      __sync_fetch_and_add(&polling_stats.sleep_ns, stats.sleep_ns);
+      __sync_fetch_and_add(&polling_stats.added_latency_ns, stats.added_latency_ns);
+      if(stats.max_added_latency_ns > polling_stats.max_added_latency_ns)
+	polling_stats.max_added_latency_ns = stats.max_added_latency_ns;
       break;
+    }
 
     CHECK_GASNET( gasnet_AMPoll() );
 
+    long long pass_end = Realm::Clock::current_time_in_nanoseconds();
+    long long pass_sleep = 0;
+    bool active = true;
+    if(adaptive) {
+      long long activity = polling_activity;
+      active = (activity != last_activity) || still_more;
+      if(active) {
+	// track the arrival rate and go back to polling flat out
+	mean_gap_ns += ((pass_end - last_activity_time) - mean_gap_ns) / 8;
+	last_activity = activity;
+	last_activity_time = pass_end;
+	backoff_ns = 0;
+      } else if(!shutdown_flag) {
+	// back off exponentially, but keep the extra delay small compared
+	//  to the typical time between messages
+	long long cap = std::min(polling_max_backoff_ns, mean_gap_ns / 4);
+	backoff_ns = std::min(cap, std::max(backoff_ns * 2, 1000LL));
+	if(backoff_ns > 0) {
+	  struct timespec ts;
+	  ts.tv_sec = backoff_ns / 1000000000LL;
+	  ts.tv_nsec = backoff_ns % 1000000000LL;
+	  nanosleep(&ts, 0);
+	  long long after = Realm::Clock::current_time_in_nanoseconds();
+	  pass_sleep = after - pass_end;
+	  pass_end = after;
+	}
+      }
+    }
+
+    stats.passes++;
+    stats.total_ns += pass_end - pass_start;
+    stats.sleep_ns += pass_sleep;
+    if(active) {
+      stats.active_passes++;
+      stats.added_latency_ns += slept_ns;
+      if(slept_ns > stats.max_added_latency_ns)
+	stats.max_added_latency_ns = slept_ns;
+      slept_ns = 0;
+    } else
+      slept_ns += pass_sleep;
+    pass_start = pass_end;
+
 #ifdef TRACE_MESSAGES
     // see if it's time to write out another update
     int now = (int)(Realm::Clock::current_time());
@@ -2657,11 +3567,18 @@ void start_polling_threads(int count)
   endpoint_manager->start_polling_threads(count);
 }
 
-void start_handler_threads(int count, Realm::CoreReservationSet& crs, size_t stack_size)
+void start_handler_threads(int count, int bulk_count,
+			   Realm::CoreReservationSet& crs, size_t stack_size)
 {
   incoming_message_manager = new IncomingMessageManager(gasnet_nodes(), crs);
 
-  incoming_message_manager->start_handler_threads(count, stack_size);
+  incoming_message_manager->start_handler_threads(count, bulk_count, stack_size);
+}
+
+void set_message_handler_class(int msgid, ActiveMessageHandlerClass hclass)
+{
+  assert((msgid >= 0) && (msgid < 256));
+  handler_classes[msgid] = hclass;
 }
 
 void stop_activemsg_threads(void)
@@ -2951,6 +3868,22 @@ void do_some_polling(void)
   assert(0 && "compiled without USE_GASNET - active messages not available!");
 }
 
+long long idle_polling_window_ns(void)
+{
+  // nothing to poll
+  return 0;
+}
+
+void do_idle_polling(const volatile long long *stop_counter,
+		     long long stop_value)
+{
+}
+
+void add_polling_callback(void (*fnptr)(void))
+{
+  // no polling threads without GASNet
+}
+
 size_t get_lmb_size(NodeID target_node)
 {
   return 0;
@@ -2990,6 +3923,11 @@ void add_handler_entry(int msgid, void (*fnptr)())
   // ignored
 }
 
+void add_inline_handler_entry(int msgid, InlineHandlerFnptr fnptr)
+{
+  // ignored
+}
+
 void init_endpoints(int gasnet_mem_size_in_mb,
 		    int registered_mem_size_in_mb,
 		    int registered_ib_mem_size_in_mb,
@@ -3003,10 +3941,15 @@ void start_polling_threads(int)
 {
 }
 
-void start_handler_threads(int, Realm::CoreReservationSet&, size_t)
+void start_handler_threads(int, int, Realm::CoreReservationSet&, size_t)
 {
 }
 
+void set_message_handler_class(int msgid, ActiveMessageHandlerClass hclass)
+{
+  // ignored
+}
+
 void stop_activemsg_threads(void)
 {
 }
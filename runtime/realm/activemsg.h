@@ -23,6 +23,7 @@
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <vector>
 
 #include <sys/types.h>
@@ -70,6 +71,7 @@
       METADATA_INVALIDATE_ACK_MSGID,
       XFERDES_REMOTEWRITE_MSGID,
       XFERDES_REMOTEWRITE_ACK_MSGID,
+      XFERDES_REMOTEWRITE_COMPRESSED_MSGID,
       XFERDES_CREATE_MSGID,
       XFERDES_DESTROY_MSGID,
       XFERDES_NOTIFY_COMPLETION_MSGID,
@@ -88,12 +90,22 @@
       REMOTE_IB_ALLOC_REQUEST_MSGID,
       REMOTE_IB_ALLOC_RESPONSE_MSGID,
       REMOTE_IB_FREE_REQUEST_MSGID,
+      REMOTE_IB_CACHE_CONTROL_MSGID,
       REMOTE_COPY_MSGID,
       REMOTE_FILL_MSGID,
       MEM_STORAGE_ALLOC_REQ_MSGID,
       MEM_STORAGE_ALLOC_RESP_MSGID,
       MEM_STORAGE_RELEASE_REQ_MSGID,
       MEM_STORAGE_RELEASE_RESP_MSGID,
+      EVENT_BATCH_MSGID,
+      EVENT_TREE_UPDATE_MSGID,
+      BARRIER_COMBINE_MSGID,
+      LOCK_REVOKE_MSGID,
+      SPAWN_TASK_BATCH_MSGID,
+      NODE_ANNOUNCE_BUNDLE_MSGID,
+      METADATA_BATCH_REQUEST_MSGID,
+      METADATA_BATCH_RESPONSE_MSGID,
+      REGISTER_TASK_BATCH_MSGID,
     };
 
 
@@ -190,7 +202,10 @@ extern void init_endpoints(int gasnet_mem_size_in_mb,
 			   Realm::CoreReservationSet& crs,
 			   int argc, const char *argv[]);
 extern void start_polling_threads(int count);
-extern void start_handler_threads(int count, Realm::CoreReservationSet& crs, size_t stacksize);
+// 'bulk_count' threads (if any) handle messages registered as bulk below,
+//  leaving the other 'count' threads free for quick handlers
+extern void start_handler_threads(int count, int bulk_count,
+				  Realm::CoreReservationSet& crs, size_t stacksize);
 extern void stop_activemsg_threads(void);
 extern void report_activemsg_status(FILE *f);
 
@@ -202,6 +217,28 @@ extern size_t get_lmb_size(NodeID target_node);
 //  to the caller rather than spinning
 extern void do_some_polling(void);
 
+// with piggyback polling (-ll:amsg_poll piggyback), processor threads that
+//  run out of work help with polling for a while before going to sleep -
+//  this returns how long (0 if not enabled), and do_idle_polling polls until
+//  that time is up or '*stop_counter' no longer equals 'stop_value'
+extern long long idle_polling_window_ns(void);
+extern void do_idle_polling(const volatile long long *stop_counter,
+			    long long stop_value);
+
+// registers a function to be called by the polling thread(s) on every pass
+//  (e.g. to flush aggregated messages) - must be called before polling
+//  threads are started, and the function must be thread-safe and cheap
+extern void add_polling_callback(void (*fnptr)(void));
+
+// message types with slow handlers (e.g. large copies) can be marked as bulk
+//  so that, if there are bulk handler threads, they don't hold up other
+//  messages - messages from a given sender are still handled in order
+enum ActiveMessageHandlerClass {
+  AM_HANDLER_QUICK,  // default
+  AM_HANDLER_BULK,
+};
+extern void set_message_handler_class(int msgid, ActiveMessageHandlerClass hclass);
+
 /* Necessary base structure for all medium and long active messages */
 struct BaseMedium {
   static const handlerarg_t MESSAGE_ID_MAGIC = 0x0bad0bad;
@@ -496,6 +533,28 @@ struct MessageRawArgs<MSGTYPE, MSGID, SHORT_HNDL_PTR, MED_HNDL_PTR, n> { \
     record_message(src, false); \
     enqueue_incoming(src, imsg); \
   } \
+\
+  /* used to run the handler directly for a message that arrived */ \
+  /*  as part of an aggregate */ \
+  static void handler_inline_short(NodeID src, const handlerarg_t *args, \
+				   int num_args, const void *buf, size_t nbytes) \
+  { \
+    ISHORT imsg(src); \
+    memset(&imsg.u, 0, sizeof(imsg.u)); \
+    memcpy(&imsg.u.raw, args, num_args * sizeof(handlerarg_t)); \
+    imsg.run_handler(); \
+  } \
+\
+  static void handler_inline_medium(NodeID src, const handlerarg_t *args, \
+				    int num_args, const void *buf, size_t nbytes) \
+  { \
+    /* not using IMED::run_handler - the payload is not in its own LMB slot */ \
+    IMED imsg(src, buf, nbytes); \
+    memset(&imsg.u, 0, sizeof(imsg.u)); \
+    memcpy(&imsg.u.raw, args, num_args * sizeof(handlerarg_t)); \
+    ActiveMsgProfilingHelper<MSGID> amph; \
+    (*MED_HNDL_PTR)(imsg.u.typed, buf, nbytes); \
+  } \
 \
   static void handler_medium(token_t token, void *buf, size_t nbytes, \
                              HANDLERARG_PARAMS_ ## n ) \
@@ -551,6 +610,13 @@ union AtLeastEightBytes {
 
 extern void add_handler_entry(int msgid, void (*fnptr)());
 
+// small messages headed to the same node may be packed into a single
+//  aggregate message - the receiver unpacks them and runs their handlers
+//  with these (registered along with the normal GASNet handler)
+typedef void (*InlineHandlerFnptr)(NodeID src, const handlerarg_t *args,
+				   int num_args, const void *buf, size_t nbytes);
+extern void add_inline_handler_entry(int msgid, InlineHandlerFnptr fnptr);
+
 template <int MSGID, class MSGTYPE, void (*FNPTR)(MSGTYPE)>
 class ActiveMessageShortNoReply {
  public:
@@ -566,6 +632,7 @@ class ActiveMessageShortNoReply {
   {
     assert(sizeof(MessageRawArgsType) <= 64);  // max of 16 4-byte args
     add_handler_entry(MSGID, reinterpret_cast<void (*)()>(MessageRawArgsType::handler_short));
+    add_inline_handler_entry(MSGID, MessageRawArgsType::handler_inline_short);
 #ifdef ACTIVE_MESSAGE_TRACE
     record_am_handler(MSGID, description);
 #endif
@@ -609,6 +676,7 @@ class ActiveMessageMediumNoReply {
   {
     assert(sizeof(MessageRawArgsType) <= 64);  // max of 16 4-byte args
     add_handler_entry(MSGID, reinterpret_cast<void (*)()>(MessageRawArgsType::handler_medium));
+    add_inline_handler_entry(MSGID, MessageRawArgsType::handler_inline_medium);
 #ifdef ACTIVE_MESSAGE_TRACE
     record_am_handler(MSGID, description);
 #endif
@@ -824,7 +892,7 @@ inline void init_endpoints(gasnet_handlerentry_t *handlers, int hcount,
 }
 
 inline void start_polling_threads(int) {}
-inline void start_handler_threads(int, Realm::CoreReservationSet&, size_t) {}
+inline void start_handler_threads(int, int, Realm::CoreReservationSet&, size_t) {}
 inline void stop_activemsg_threads(void)
 {
   if(fake_gasnet_mem_base)
@@ -833,6 +901,8 @@ inline void stop_activemsg_threads(void)
 }
     
 inline void do_some_polling(void) {}
+inline long long idle_polling_window_ns(void) { return 0; }
+inline void do_idle_polling(const volatile long long *, long long) {}
 inline size_t get_lmb_size(int target_node) { return 0; }
 
 #endif // ifdef USE_GASNET
@@ -24,6 +24,7 @@
 #include "realm/transfer/channel.h"
 
 #include "realm/cuda/cudart_hijack.h"
+#include "realm/cuda/cuda_redop.h"
 
 #include "realm/activemsg.h"
 #include "realm/utils.h"
@@ -46,12 +47,17 @@ namespace Realm {
   //
   // class GPUStream
 
-    GPUStream::GPUStream(GPU *_gpu, GPUWorker *_worker)
+    GPUStream::GPUStream(GPU *_gpu, GPUWorker *_worker, int _priority /*= 0*/)
       : gpu(_gpu), worker(_worker)
     {
       assert(worker != 0);
-      CHECK_CU( cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING) );
-      log_stream.info() << "CUDA stream " << stream << " created for GPU " << gpu;
+      if(_priority != 0)
+	CHECK_CU( cuStreamCreateWithPriority(&stream, CU_STREAM_NON_BLOCKING,
+					     _priority) );
+      else
+	CHECK_CU( cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING) );
+      log_stream.info() << "CUDA stream " << stream << " created for GPU " << gpu
+			<< " (priority=" << _priority << ")";
     }
 
     GPUStream::~GPUStream(void)
@@ -59,6 +65,14 @@ namespace Realm {
       // log_stream.info() << "CUDA stream " << stream << " destroyed - max copies = " 
       // 			<< pending_copies.capacity() << ", max events = " << pending_events.capacity();
 
+#ifdef REALM_USE_CUDA_GRAPHS
+      for(std::map<std::vector<uintptr_t>, CapturedGraph>::iterator it = graphs.begin();
+	  it != graphs.end();
+	  ++it)
+	if(it->second.exec)
+	  CHECK_CU( cuGraphExecDestroy(it->second.exec) );
+#endif
+
       CHECK_CU( cuStreamDestroy(stream) );
     }
 
@@ -135,6 +149,45 @@ namespace Realm {
     //   current) - returns true if any work remains
     bool GPUStream::issue_copies(void)
     {
+#ifdef REALM_USE_CUDA_GRAPHS
+      if(gpu->module->cfg_graph_cache_size > 0) {
+	while(true) {
+	  // take everything that's pending so that a repeated sequence can be
+	  //  recognized as a whole
+	  std::vector<GPUMemcpy *> batch;
+	  {
+	    AutoHSLLock al(mutex);
+
+	    if(pending_copies.empty())
+	      return false;  // no work left
+
+	    while(!pending_copies.empty()) {
+	      batch.push_back(pending_copies.front());
+	      pending_copies.pop_front();
+	    }
+	  }
+
+	  AutoGPUContext agc(gpu);
+	  // fences (and anything else that can't be captured) break the batch
+	  //  up into runs of copies
+	  std::vector<GPUMemcpy *> run;
+	  std::vector<uintptr_t> desc;
+	  for(std::vector<GPUMemcpy *>::const_iterator it = batch.begin();
+	      it != batch.end();
+	      ++it)
+	    if((*it)->describe(desc)) {
+	      run.push_back(*it);
+	    } else {
+	      issue_copy_run(run, desc);
+	      run.clear();
+	      desc.clear();
+	      (*it)->execute(this);
+	    }
+	  issue_copy_run(run, desc);
+	}
+      }
+#endif
+
       while(true) {
 	GPUMemcpy *copy = 0;
 	{
@@ -156,6 +209,80 @@ namespace Realm {
       }
     }
 
+    void GPUStream::issue_copy_run(const std::vector<GPUMemcpy *>& run,
+				   const std::vector<uintptr_t>& desc)
+    {
+#ifdef REALM_USE_CUDA_GRAPHS
+      // a graph only pays off for more than one copy, and is only captured
+      //  the second time a run is seen
+      if(run.size() > 1) {
+	std::map<std::vector<uintptr_t>, CapturedGraph>::iterator it = graphs.find(desc);
+	if(it == graphs.end()) {
+	  // no attempt at LRU - if we've filled up, just start over
+	  if(graphs.size() >= gpu->module->cfg_graph_cache_size) {
+	    for(it = graphs.begin(); it != graphs.end(); ++it)
+	      if(it->second.exec)
+		CHECK_CU( cuGraphExecDestroy(it->second.exec) );
+	    graphs.clear();
+	  }
+	  it = graphs.insert(std::make_pair(desc, CapturedGraph())).first;
+	}
+	CapturedGraph& g = it->second;
+	g.uses++;
+
+	if(!g.exec && !g.uncapturable && (g.uses >= 2)) {
+	  // capture only records the copies - nothing is issued until the
+	  //  graph is launched
+	  CUgraph graph = 0;
+	  bool ok = (cuStreamBeginCapture(stream,
+					  CU_STREAM_CAPTURE_MODE_THREAD_LOCAL) == CUDA_SUCCESS);
+	  if(ok) {
+	    for(std::vector<GPUMemcpy *>::const_iterator it2 = run.begin();
+		it2 != run.end();
+		++it2)
+	      (*it2)->issue(this);
+	    ok = ((cuStreamEndCapture(stream, &graph) == CUDA_SUCCESS) &&
+		  (graph != 0));
+	  }
+	  if(ok) {
+#if CUDA_VERSION >= 12000
+	    ok = (cuGraphInstantiate(&g.exec, graph, 0) == CUDA_SUCCESS);
+#else
+	    ok = (cuGraphInstantiate(&g.exec, graph, 0, 0, 0) == CUDA_SUCCESS);
+#endif
+	  }
+	  if(graph)
+	    CHECK_CU( cuGraphDestroy(graph) );
+	  if(!ok) {
+	    log_stream.info() << "graph capture failed on stream " << stream
+			      << " - copies will be issued individually";
+	    g.exec = 0;
+	    g.uncapturable = true;
+	  } else
+	    log_stream.debug() << "captured graph of " << run.size()
+			       << " copies on stream " << stream;
+	}
+
+	if(g.exec) {
+	  CHECK_CU( cuGraphLaunch(g.exec, stream) );
+	  for(std::vector<GPUMemcpy *>::const_iterator it2 = run.begin();
+	      it2 != run.end();
+	      ++it2) {
+	    GPUCompletionNotification *n = (*it2)->get_notification();
+	    if(n)
+	      add_notification(n);
+	  }
+	  return;
+	}
+      }
+#endif
+
+      for(std::vector<GPUMemcpy *>::const_iterator it = run.begin();
+	  it != run.end();
+	  ++it)
+	(*it)->execute(this);
+    }
+
     bool GPUStream::reap_events(void)
     {
       // peek at the first event
@@ -293,6 +420,22 @@ namespace Realm {
       }
     }
 
+    bool GPUMemcpy1D::describe(std::vector<uintptr_t>& desc) const
+    {
+      desc.push_back(1);
+      desc.push_back(kind);
+      desc.push_back((uintptr_t)dst);
+      desc.push_back((uintptr_t)src);
+      desc.push_back(elmt_size);
+      return true;
+    }
+
+    void GPUMemcpy1D::issue(GPUStream *stream)
+    {
+      local_stream = stream;
+      do_span(0, 1);
+    }
+
     void GPUMemcpy1D::execute(GPUStream *stream)
     {
       DetailedTimer::ScopedPush sp(TIME_COPY);
@@ -330,11 +473,36 @@ namespace Realm {
     GPUMemcpy2D::~GPUMemcpy2D(void)
     {}
 
+    bool GPUMemcpy2D::describe(std::vector<uintptr_t>& desc) const
+    {
+      desc.push_back(2);
+      desc.push_back(kind);
+      desc.push_back((uintptr_t)dst);
+      desc.push_back((uintptr_t)src);
+      desc.push_back(dst_stride);
+      desc.push_back(src_stride);
+      desc.push_back(bytes);
+      desc.push_back(lines);
+      return true;
+    }
+
     void GPUMemcpy2D::execute(GPUStream *stream)
     {
       log_gpudma.info("gpu memcpy 2d: dst=%p src=%p "
                    "dst_off=%ld src_off=%ld bytes=%ld lines=%ld kind=%d",
 		      dst, src, (long)dst_stride, (long)src_stride, (long)bytes, (long)lines, kind); 
+      issue(stream);
+
+      if(notification)
+	stream->add_notification(notification);
+
+      log_gpudma.info("gpu memcpy 2d complete: dst=%p src=%p "
+                   "dst_off=%ld src_off=%ld bytes=%ld lines=%ld kind=%d",
+		      dst, src, (long)dst_stride, (long)src_stride, (long)bytes, (long)lines, kind);
+    }
+
+    void GPUMemcpy2D::issue(GPUStream *stream)
+    {
       CUDA_MEMCPY2D copy_info;
       if (kind == GPU_MEMCPY_PEER_TO_PEER) {
         // If we're doing peer to peer, just let unified memory it deal with it
@@ -360,13 +528,6 @@ namespace Realm {
       copy_info.WidthInBytes = bytes;
       copy_info.Height = lines;
       CHECK_CU( cuMemcpy2DAsync(&copy_info, stream->get_stream()) );
-
-      if(notification)
-	stream->add_notification(notification);
-
-      log_gpudma.info("gpu memcpy 2d complete: dst=%p src=%p "
-                   "dst_off=%ld src_off=%ld bytes=%ld lines=%ld kind=%d",
-		      dst, src, (long)dst_stride, (long)src_stride, (long)bytes, (long)lines, kind);
     }
 
   ////////////////////////////////////////////////////////////////////////
@@ -391,6 +552,22 @@ namespace Realm {
     GPUMemcpy3D::~GPUMemcpy3D(void)
     {}
     
+    bool GPUMemcpy3D::describe(std::vector<uintptr_t>& desc) const
+    {
+      desc.push_back(3);
+      desc.push_back(kind);
+      desc.push_back((uintptr_t)dst);
+      desc.push_back((uintptr_t)src);
+      desc.push_back(dst_stride);
+      desc.push_back(src_stride);
+      desc.push_back(dst_height);
+      desc.push_back(src_height);
+      desc.push_back(bytes);
+      desc.push_back(height);
+      desc.push_back(depth);
+      return true;
+    }
+
     void GPUMemcpy3D::execute(GPUStream *stream)
     {
       log_gpudma.info("gpu memcpy 3d: dst=%p src=%p"
@@ -399,6 +576,21 @@ namespace Realm {
                       dst, src, (long)dst_stride, (long)src_stride,
                       (long)dst_height, (long)src_height, (long)bytes, (long)height,
                       (long)depth, kind);
+      issue(stream);
+
+      if(notification)
+        stream->add_notification(notification);
+
+       log_gpudma.info("gpu memcpy 3d complete: dst=%p src=%p"
+		       "dst_off=%ld src_off=%ld dst_hei = %ld src_hei = %ld"
+		       "bytes=%ld height=%ld depth=%ld kind=%d",
+		       dst, src, (long)dst_stride, (long)src_stride,
+		       (long)dst_height, (long)src_height, (long)bytes, (long)height,
+		       (long)depth, kind);
+    }
+
+    void GPUMemcpy3D::issue(GPUStream *stream)
+    {
       CUDA_MEMCPY3D copy_info;
       if (kind == GPU_MEMCPY_PEER_TO_PEER) {
         // If we're doing peer to peer, just let unified memory it deal with it
@@ -431,16 +623,6 @@ namespace Realm {
       copy_info.Height = height;
       copy_info.Depth = depth;
       CHECK_CU( cuMemcpy3DAsync(&copy_info, stream->get_stream()) );
-
-      if(notification)
-        stream->add_notification(notification);
-
-       log_gpudma.info("gpu memcpy 3d complete: dst=%p src=%p"
-		       "dst_off=%ld src_off=%ld dst_hei = %ld src_hei = %ld"
-		       "bytes=%ld height=%ld depth=%ld kind=%d",
-		       dst, src, (long)dst_stride, (long)src_stride,
-		       (long)dst_height, (long)src_height, (long)bytes, (long)height,
-		       (long)depth, kind);
     }
 
     ////////////////////////////////////////////////////////////////////////
@@ -948,6 +1130,63 @@ namespace Realm {
     }
 
 
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class GPUReduction
+
+    GPUReduction::GPUReduction(GPU *_gpu, const ReductionOpUntyped *_redop,
+			       bool _fold, CUdeviceptr _dst, CUdeviceptr _src,
+			       size_t _count,
+			       GPUCompletionNotification *_notification)
+      : GPUMemcpy(_gpu, GPU_MEMCPY_DEVICE_TO_DEVICE), redop(_redop),
+	fold(_fold), dst(_dst), src(_src), count(_count),
+	notification(_notification)
+    {}
+
+    GPUReduction::~GPUReduction(void)
+    {}
+
+    void GPUReduction::execute(GPUStream *stream)
+    {
+      DetailedTimer::ScopedPush sp(TIME_COPY);
+      // other reductions into the same instance may be running on other
+      //  streams, so always use the non-exclusive (atomic) kernels
+      const void *kernel = (fold ? redop->cuda_fold_nonexcl_fn :
+			           redop->cuda_apply_nonexcl_fn);
+      assert(kernel != 0);
+      CUfunction f = gpu->lookup_function(kernel);
+
+      ReductionKernelArgs args;
+      args.lhs_base = dst;
+      args.lhs_stride = (fold ? redop->sizeof_rhs : redop->sizeof_lhs);
+      args.rhs_base = src;
+      args.rhs_stride = redop->sizeof_rhs;
+      args.count = count;
+      void *params[] = { &args };
+
+      // kernels use a grid-stride loop, so the grid can be capped
+      const unsigned threads_per_block = 256;
+      const size_t max_blocks = 1024;
+      size_t blocks = (count + threads_per_block - 1) / threads_per_block;
+      if(blocks > max_blocks)
+	blocks = max_blocks;
+
+      CUstream raw_stream = stream->get_stream();
+      log_gpudma.info() << "gpu reduction: dst=" << (void *)dst
+			<< " src=" << (void *)src << " count=" << count
+			<< (fold ? " fold" : " apply");
+      CHECK_CU( cuLaunchKernel(f,
+			       blocks, 1, 1,
+			       threads_per_block, 1, 1,
+			       0 /*shared*/,
+			       raw_stream,
+			       params, NULL) );
+
+      if(notification)
+	stream->add_notification(notification);
+    }
+
+
     ////////////////////////////////////////////////////////////////////////
     //
     // class GPUEventPool
@@ -1066,6 +1305,9 @@ namespace Realm {
 
     namespace ThreadLocal {
       static __thread GPUProcessor *current_gpu_proc = 0;
+      // the stream picked for the running task - kept per thread so that a
+      //  task that suspends doesn't pick up another task's stream
+      static __thread GPUStream *current_gpu_stream = 0;
     };
 
     // this flag will be set on the first call into any of the hijack code in
@@ -1089,9 +1331,10 @@ namespace Realm {
       // push the CUDA context for this GPU onto this thread
       gpu_proc->gpu->push_context();
 
-      // bump the current stream
-      // TODO: sanity-check whether this even works right when GPU tasks suspend
-      GPUStream *s = gpu_proc->gpu->switch_to_next_task_stream();
+      // pick a stream for this task
+      GPUStream *s = gpu_proc->gpu->acquire_task_stream();
+      assert(ThreadLocal::current_gpu_stream == 0);
+      ThreadLocal::current_gpu_stream = s;
 
       // we'll use a "work fence" to track when the kernels launched by this task actually
       //  finish - this must be added to the task _BEFORE_ we execute
@@ -1103,6 +1346,9 @@ namespace Realm {
       // now enqueue the fence on the local stream
       fence->enqueue_on_stream(s);
 
+      gpu_proc->gpu->release_task_stream(s);
+      ThreadLocal::current_gpu_stream = 0;
+
       // A useful debugging macro
 #ifdef FORCE_GPU_STREAM_SYNCHRONIZE
       CHECK_CU( cuStreamSynchronize(s->get_stream()) );
@@ -1142,6 +1388,8 @@ namespace Realm {
       : LocalTaskProcessor(_me, Processor::TOC_PROC)
       , gpu(_gpu)
     {
+      memset(function_cache, 0, sizeof(function_cache));
+
       Realm::CoreReservationParameters params;
       params.set_num_cores(1);
       params.set_alu_usage(params.CORE_USAGE_SHARED);
@@ -1168,13 +1416,79 @@ namespace Realm {
       delete core_rsrv;
     }
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class GPUCopyStreams
+
+    GPUCopyStreams::GPUCopyStreams(void)
+      : small_bytes(0), next_bulk(0)
+    {}
+
+    void GPUCopyStreams::create_streams(GPU *gpu, GPUWorker *worker,
+					unsigned num_streams, size_t _small_bytes)
+    {
+      if(num_streams < 1)
+	num_streams = 1;
+      small_bytes = _small_bytes;
+
+      if(num_streams == 1) {
+	streams.push_back(new GPUStream(gpu, worker));
+	return;
+      }
+
+      // stream 0 is reserved for small copies and gets the highest priority
+      //  the context offers, the rest keep the default priority
+      int least_pri, greatest_pri;
+      CHECK_CU( cuCtxGetStreamPriorityRange(&least_pri, &greatest_pri) );
+      streams.push_back(new GPUStream(gpu, worker, greatest_pri));
+      for(unsigned i = 1; i < num_streams; i++)
+	streams.push_back(new GPUStream(gpu, worker));
+    }
+
+    void GPUCopyStreams::destroy_streams(void)
+    {
+      while(!streams.empty()) {
+	delete streams.back();
+	streams.pop_back();
+      }
+    }
+
+    void GPUCopyStreams::add_copy(GPUMemcpy *copy, size_t bytes)
+    {
+      if((streams.size() == 1) || (bytes <= small_bytes)) {
+	streams[0]->add_copy(copy);
+	return;
+      }
+
+      unsigned idx = __sync_fetch_and_add(&next_bulk, 1);
+      streams[1 + (idx % (streams.size() - 1))]->add_copy(copy);
+    }
+
+    void GPUCopyStreams::add_fence(GPU *gpu, GPUMemcpyKind kind,
+				   Realm::Operation *op)
+    {
+      // one fence per stream - the operation isn't complete until all of
+      //  its async work items are
+      for(std::vector<GPUStream *>::iterator it = streams.begin();
+	  it != streams.end();
+	  ++it) {
+	GPUWorkFence *f = new GPUWorkFence(op);
+
+	// this must be done before we enqueue the callback with CUDA
+	op->add_async_work_item(f);
+
+	(*it)->add_copy(new GPUMemcpyFence(gpu, kind, f));
+      }
+    }
+
+
     void GPU::copy_to_fb(off_t dst_offset, const void *src, size_t bytes,
 			 GPUCompletionNotification *notification /*= 0*/)
     {
       GPUMemcpy *copy = new GPUMemcpy1D(this,
 					(void *)(fbmem->base + dst_offset),
 					src, bytes, GPU_MEMCPY_HOST_TO_DEVICE, notification);
-      host_to_device_stream->add_copy(copy);
+      host_to_device_streams.add_copy(copy, bytes);
     }
 
     void GPU::copy_from_fb(void *dst, off_t src_offset, size_t bytes,
@@ -1183,7 +1497,7 @@ namespace Realm {
       GPUMemcpy *copy = new GPUMemcpy1D(this,
 					dst, (const void *)(fbmem->base + src_offset),
 					bytes, GPU_MEMCPY_DEVICE_TO_HOST, notification);
-      device_to_host_stream->add_copy(copy);
+      device_to_host_streams.add_copy(copy, bytes);
     } 
 
     void GPU::copy_within_fb(off_t dst_offset, off_t src_offset,
@@ -1194,7 +1508,7 @@ namespace Realm {
 					(void *)(fbmem->base + dst_offset),
 					(const void *)(fbmem->base + src_offset),
 					bytes, GPU_MEMCPY_DEVICE_TO_DEVICE, notification);
-      device_to_device_stream->add_copy(copy);
+      device_to_device_streams.add_copy(copy, bytes);
     }
 
     void GPU::copy_to_fb_2d(off_t dst_offset, const void *src, 
@@ -1206,7 +1520,7 @@ namespace Realm {
 					(void *)(fbmem->base + dst_offset),
 					src, dst_stride, src_stride, bytes, lines,
 					GPU_MEMCPY_HOST_TO_DEVICE, notification);
-      host_to_device_stream->add_copy(copy);
+      host_to_device_streams.add_copy(copy, bytes * lines);
     }
 
     void GPU::copy_to_fb_3d(off_t dst_offset, const void *src,
@@ -1221,7 +1535,7 @@ namespace Realm {
                                         dst_height, src_height,
                                         bytes, height, depth,
 					GPU_MEMCPY_HOST_TO_DEVICE, notification);
-      host_to_device_stream->add_copy(copy);
+      host_to_device_streams.add_copy(copy, bytes * height * depth);
     }
 
     void GPU::copy_from_fb_2d(void *dst, off_t src_offset,
@@ -1233,7 +1547,7 @@ namespace Realm {
 					(const void *)(fbmem->base + src_offset),
 					dst_stride, src_stride, bytes, lines,
 					GPU_MEMCPY_DEVICE_TO_HOST, notification);
-      device_to_host_stream->add_copy(copy);
+      device_to_host_streams.add_copy(copy, bytes * lines);
     }
 
     void GPU::copy_from_fb_3d(void *dst, off_t src_offset,
@@ -1248,7 +1562,7 @@ namespace Realm {
                                         dst_height, src_height,
                                         bytes, height, depth,
 					GPU_MEMCPY_DEVICE_TO_HOST, notification);
-      device_to_host_stream->add_copy(copy);
+      device_to_host_streams.add_copy(copy, bytes * height * depth);
     }
 
     void GPU::copy_within_fb_2d(off_t dst_offset, off_t src_offset,
@@ -1261,7 +1575,7 @@ namespace Realm {
 					(const void *)(fbmem->base + src_offset),
 					dst_stride, src_stride, bytes, lines,
 					GPU_MEMCPY_DEVICE_TO_DEVICE, notification);
-      device_to_device_stream->add_copy(copy);
+      device_to_device_streams.add_copy(copy, bytes * lines);
     }
 
     void GPU::copy_within_fb_3d(off_t dst_offset, off_t src_offset,
@@ -1277,7 +1591,7 @@ namespace Realm {
                                         dst_height, src_height,
                                         bytes, height, depth,
 					GPU_MEMCPY_DEVICE_TO_DEVICE, notification);
-      device_to_device_stream->add_copy(copy);
+      device_to_device_streams.add_copy(copy, bytes * height * depth);
     }
 
     void GPU::copy_to_peer(GPU *dst, off_t dst_offset,
@@ -1288,7 +1602,7 @@ namespace Realm {
 					(void *)(dst->fbmem->base + dst_offset),
 					(const void *)(fbmem->base + src_offset),
 					bytes, GPU_MEMCPY_PEER_TO_PEER, notification);
-      peer_to_peer_stream->add_copy(copy);
+      peer_to_peer_streams.add_copy(copy, bytes);
     }
 
     void GPU::copy_to_peer_2d(GPU *dst,
@@ -1302,7 +1616,7 @@ namespace Realm {
 					(const void *)(fbmem->base + src_offset),
 					dst_stride, src_stride, bytes, lines,
 					GPU_MEMCPY_PEER_TO_PEER, notification);
-      peer_to_peer_stream->add_copy(copy);
+      peer_to_peer_streams.add_copy(copy, bytes * lines);
     }
 
     void GPU::copy_to_peer_3d(GPU *dst, off_t dst_offset, off_t src_offset,
@@ -1318,68 +1632,110 @@ namespace Realm {
                                         dst_height, src_height,
                                         bytes, height, depth,
 					GPU_MEMCPY_PEER_TO_PEER, notification);
-      peer_to_peer_stream->add_copy(copy);
+      peer_to_peer_streams.add_copy(copy, bytes * height * depth);
     }
 
-    void GPU::fence_to_fb(Realm::Operation *op)
+    bool GPU::can_reduce_in_fb(Memory src_mem, const ReductionOpUntyped *redop,
+			       bool fold) const
     {
-      GPUWorkFence *f = new GPUWorkFence(op);
+      if(fold ? (redop->cuda_fold_nonexcl_fn == 0) :
+	        (redop->cuda_apply_nonexcl_fn == 0))
+	return false;
+      return ((src_mem == fbmem->me) || (peer_fbs.count(src_mem) > 0));
+    }
 
-      // this must be done before we enqueue the callback with CUDA
-      op->add_async_work_item(f);
+    void GPU::reduce_in_fb(off_t dst_offset, CUdeviceptr src, size_t count,
+			   const ReductionOpUntyped *redop, bool fold,
+			   GPUCompletionNotification *notification /*= 0*/)
+    {
+      GPUMemcpy *copy = new GPUReduction(this, redop, fold,
+					 fbmem->base + dst_offset, src,
+					 count, notification);
+      device_to_device_streams.add_copy(copy, count * redop->sizeof_rhs);
+    }
 
-      host_to_device_stream->add_copy(new GPUMemcpyFence(this,
-							 GPU_MEMCPY_HOST_TO_DEVICE,
-							 f));
+    void GPU::fence_to_fb(Realm::Operation *op)
+    {
+      host_to_device_streams.add_fence(this, GPU_MEMCPY_HOST_TO_DEVICE, op);
     }
 
     void GPU::fence_from_fb(Realm::Operation *op)
     {
-      GPUWorkFence *f = new GPUWorkFence(op);
-
-      // this must be done before we enqueue the callback with CUDA
-      op->add_async_work_item(f);
-
-      device_to_host_stream->add_copy(new GPUMemcpyFence(this,
-							 GPU_MEMCPY_DEVICE_TO_HOST,
-							 f));
+      device_to_host_streams.add_fence(this, GPU_MEMCPY_DEVICE_TO_HOST, op);
     }
 
     void GPU::fence_within_fb(Realm::Operation *op)
     {
-      GPUWorkFence *f = new GPUWorkFence(op);
-
-      // this must be done before we enqueue the callback with CUDA
-      op->add_async_work_item(f);
-
-      device_to_device_stream->add_copy(new GPUMemcpyFence(this,
-							   GPU_MEMCPY_DEVICE_TO_DEVICE,
-							   f));
+      device_to_device_streams.add_fence(this, GPU_MEMCPY_DEVICE_TO_DEVICE, op);
     }
 
     void GPU::fence_to_peer(Realm::Operation *op, GPU *dst)
     {
-      GPUWorkFence *f = new GPUWorkFence(op);
-
-      // this must be done before we enqueue the callback with CUDA
-      op->add_async_work_item(f);
-
-      peer_to_peer_stream->add_copy(new GPUMemcpyFence(this,
-						       GPU_MEMCPY_PEER_TO_PEER,
-						       f));
+      peer_to_peer_streams.add_fence(this, GPU_MEMCPY_PEER_TO_PEER, op);
     }
 
     GPUStream *GPU::get_current_task_stream(void)
     {
+      if(ThreadLocal::current_gpu_stream)
+	return ThreadLocal::current_gpu_stream;
       return task_streams[current_stream];
     }
 
-    GPUStream *GPU::switch_to_next_task_stream(void)
+    // called with the GPU's context current
+    GPUStream *GPU::acquire_task_stream(void)
     {
-      current_stream++;
-      if(current_stream >= task_streams.size())
-	current_stream = 0;
-      return task_streams[current_stream];
+      AutoHSLLock al(task_stream_mutex);
+
+      unsigned num_streams = task_streams.size();
+      unsigned pick = (current_stream + 1) % num_streams;
+
+      // independent tasks only overlap on the device if they land on
+      //  different streams, so look for the next stream that has no running
+      //  task and whose last task's work has finished
+      if(module->cfg_idle_task_streams) {
+	for(unsigned i = 1; i <= num_streams; i++) {
+	  unsigned idx = (current_stream + i) % num_streams;
+	  if(task_stream_users[idx] > 0)
+	    continue;
+	  CUevent e = task_stream_events[idx];
+	  if(e != 0) {
+	    CUresult res = cuEventQuery(e);
+	    if(res == CUDA_ERROR_NOT_READY)
+	      continue;
+	    // no other kind of error is expected
+	    assert(res == CUDA_SUCCESS);
+	    event_pool.return_event(e);
+	    task_stream_events[idx] = 0;
+	  }
+	  pick = idx;
+	  break;
+	}
+	// if every stream is busy, we fall back to round-robin
+      }
+
+      current_stream = pick;
+      task_stream_users[pick]++;
+      return task_streams[pick];
+    }
+
+    void GPU::release_task_stream(GPUStream *stream)
+    {
+      AutoHSLLock al(task_stream_mutex);
+
+      unsigned idx = 0;
+      while(task_streams[idx] != stream) {
+	idx++;
+	assert(idx < task_streams.size());
+      }
+      assert(task_stream_users[idx] > 0);
+      task_stream_users[idx]--;
+
+      if(module->cfg_idle_task_streams) {
+	// an event already recorded on this stream can simply be re-recorded
+	if(task_stream_events[idx] == 0)
+	  task_stream_events[idx] = event_pool.get_event();
+	CHECK_CU( cuEventRecord(task_stream_events[idx], stream->get_stream()) );
+      }
     }
 
     void GPUProcessor::shutdown(void)
@@ -1559,12 +1915,139 @@ namespace Realm {
     GPUFBMemory::GPUFBMemory(Memory _me, GPU *_gpu, CUdeviceptr _base, size_t _size)
       : MemoryImpl(_me, _size, MKIND_GPUFB, 512, Memory::GPU_FB_MEM)
       , gpu(_gpu), base(_base)
+      , cached_bytes(0), cache_limit(_gpu->module->cfg_fb_cache_size_in_mb << 20)
     {
       free_blocks[0] = size;
     }
 
     GPUFBMemory::~GPUFBMemory(void) {}
 
+    // size classes are powers of two (min 4KB) so that a cached block is
+    //  never more than twice as large as the request it's reused for
+    /*static*/ size_t GPUFBMemory::cache_size_class(size_t bytes)
+    {
+      size_t sc = 4096;
+      while(sc < bytes)
+	sc <<= 1;
+      return sc;
+    }
+
+    bool GPUFBMemory::allocate_storage_local(RegionInstance i,
+					     size_t bytes, size_t alignment,
+					     size_t& offset)
+    {
+      if((bytes > 0) && (cache_limit > 0)) {
+	CachedBlock *blk = 0;
+	{
+	  AutoHSLLock al(cache_mutex);
+	  std::map<size_t, std::vector<CachedBlock *> >::iterator it = cached_blocks.find(cache_size_class(bytes));
+	  if(it != cached_blocks.end()) {
+	    // most recently freed first
+	    std::vector<CachedBlock *>& v = it->second;
+	    for(size_t idx = v.size(); idx > 0; idx--) {
+	      CachedBlock *b = v[idx - 1];
+	      if(((b->last - b->first) >= bytes) &&
+		 ((alignment == 0) || ((b->first % alignment) == 0))) {
+		blk = b;
+		v.erase(v.begin() + (idx - 1));
+		cached_bytes -= (b->last - b->first);
+		break;
+	      }
+	    }
+	  }
+	}
+
+	if(blk) {
+	  {
+	    AutoHSLLock al(allocator_mutex);
+	    allocator.attach(i, blk);
+	  }
+	  offset = blk->first;
+	  return true;
+	}
+      }
+
+      if(MemoryImpl::allocate_storage_local(i, bytes, alignment, offset))
+	return true;
+
+      // out of space - give any cached blocks back to the allocator and try
+      //  again
+      if(flush_cache(0))
+	return MemoryImpl::allocate_storage_local(i, bytes, alignment, offset);
+
+      return false;
+    }
+
+    void GPUFBMemory::release_storage_local(RegionInstance i)
+    {
+      if(cache_limit == 0) {
+	MemoryImpl::release_storage_local(i);
+	return;
+      }
+
+      CachedBlock *blk;
+      {
+	AutoHSLLock al(allocator_mutex);
+	blk = allocator.detach(i);
+	// blocks too large to ever be cached go straight back
+	if(blk && ((blk->last - blk->first) > cache_limit)) {
+	  allocator.deallocate_range(blk);
+	  blk = 0;
+	}
+      }
+
+      // zero-size allocations have no block
+      if(!blk)
+	return;
+
+      bool over_limit;
+      {
+	AutoHSLLock al(cache_mutex);
+	size_t bytes = blk->last - blk->first;
+	cached_blocks[cache_size_class(bytes)].push_back(blk);
+	cached_bytes += bytes;
+	over_limit = (cached_bytes > cache_limit);
+      }
+
+      // deferred release - trim back below the limit
+      if(over_limit)
+	flush_cache(cache_limit);
+    }
+
+    bool GPUFBMemory::flush_cache(size_t keep_bytes)
+    {
+      std::vector<CachedBlock *> to_release;
+      {
+	AutoHSLLock al(cache_mutex);
+	// largest blocks go first (and the oldest within a size class), since
+	//  they're the least likely to be reused and do the most for
+	//  fragmentation
+	while((cached_bytes > keep_bytes) && !cached_blocks.empty()) {
+	  std::map<size_t, std::vector<CachedBlock *> >::iterator it = cached_blocks.end();
+	  --it;
+	  std::vector<CachedBlock *>& v = it->second;
+	  while((cached_bytes > keep_bytes) && !v.empty()) {
+	    CachedBlock *b = v.front();
+	    v.erase(v.begin());
+	    cached_bytes -= (b->last - b->first);
+	    to_release.push_back(b);
+	  }
+	  if(v.empty())
+	    cached_blocks.erase(it);
+	}
+      }
+
+      if(to_release.empty())
+	return false;
+
+      AutoHSLLock al(allocator_mutex);
+      for(std::vector<CachedBlock *>::iterator it = to_release.begin();
+	  it != to_release.end();
+	  ++it)
+	allocator.deallocate_range(*it);
+      return true;
+    }
+
     off_t GPUFBMemory::alloc_bytes(size_t size)
     {
       return alloc_bytes_local(size);
@@ -1592,6 +2075,53 @@ namespace Realm {
       bcn.wait();
     }
 
+    bool GPUFBMemory::fill_bytes(off_t offset, size_t size,
+				 const void *pattern, size_t pattern_size)
+    {
+      // cuMemset handles patterns of 1, 2, or 4 bytes directly - 8- and
+      //  16-byte patterns are done as one strided 2D memset per 32-bit word
+      size_t period = fill_pattern_period(pattern, pattern_size);
+      CUdeviceptr dst = base + offset;
+      if((period > 16) || ((period & (period - 1)) != 0) ||
+	 ((size % period) != 0) || ((dst % period) != 0))
+	return false;
+
+      // the default stream doesn't synchronize with our (non-blocking)
+      //  streams, so waiting on it only waits for these memsets
+      AutoGPUContext agc(gpu);
+      switch(period) {
+      case 1:
+	{
+	  CHECK_CU( cuMemsetD8Async(dst,
+				    *static_cast<const unsigned char *>(pattern),
+				    size, 0) );
+	  break;
+	}
+      case 2:
+	{
+	  unsigned short val;
+	  memcpy(&val, pattern, 2);
+	  CHECK_CU( cuMemsetD16Async(dst, val, size >> 1, 0) );
+	  break;
+	}
+      default:
+	{
+	  for(size_t ofs = 0; ofs < period; ofs += 4) {
+	    unsigned int val;
+	    memcpy(&val, static_cast<const char *>(pattern) + ofs, 4);
+	    if(period == 4)
+	      CHECK_CU( cuMemsetD32Async(dst, val, size >> 2, 0) );
+	    else
+	      CHECK_CU( cuMemsetD2D32Async(dst + ofs, period, val,
+					   1, size / period, 0) );
+	  }
+	  break;
+	}
+      }
+      CHECK_CU( cuStreamSynchronize(0) );
+      return true;
+    }
+
     void *GPUFBMemory::get_direct_ptr(off_t offset, size_t size)
     {
       return (void *)(base + offset);
@@ -1647,6 +2177,126 @@ namespace Realm {
       return ID(me).memory.owner_node;
     }
 
+
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class GPUManagedMemory
+
+    GPUManagedMemory::GPUManagedMemory(Memory _me, CudaModule *_module, size_t _size)
+      : MemoryImpl(_me, _size, MKIND_MANAGED, 256, Memory::GPU_MANAGED_MEM)
+      , module(_module), base(0), can_prefetch(false)
+    {
+      // borrow GPU 0's context for the allocation call
+      {
+	AutoGPUContext agc(module->gpus[0]);
+	CHECK_CU( cuMemAllocManaged(&base, size, CU_MEM_ATTACH_GLOBAL) );
+      }
+
+#if CUDA_VERSION >= 8000
+      can_prefetch = true;
+      for(std::vector<GPU *>::iterator it = module->gpus.begin();
+	  it != module->gpus.end();
+	  it++) {
+	int concurrent = 0;
+	CHECK_CU( cuDeviceGetAttribute(&concurrent,
+				       CU_DEVICE_ATTRIBUTE_CONCURRENT_MANAGED_ACCESS,
+				       (*it)->info->device) );
+	if(!concurrent)
+	  can_prefetch = false;
+      }
+      if(can_prefetch)
+	for(std::vector<GPU *>::iterator it = module->gpus.begin();
+	    it != module->gpus.end();
+	    it++) {
+	  AutoGPUContext agc(*it);
+	  CUstream stream;
+	  CHECK_CU( cuStreamCreate(&stream, CU_STREAM_NON_BLOCKING) );
+	  prefetch_streams.push_back(stream);
+	}
+#endif
+      if(!can_prefetch)
+	log_gpu.info() << "managed memory " << me << ": prefetching not supported";
+
+      free_blocks[0] = size;
+    }
+
+    GPUManagedMemory::~GPUManagedMemory(void)
+    {
+      assert(base == 0);
+    }
+
+    void GPUManagedMemory::cleanup(void)
+    {
+      for(size_t i = 0; i < prefetch_streams.size(); i++) {
+	AutoGPUContext agc(module->gpus[i]);
+	CHECK_CU( cuStreamDestroy(prefetch_streams[i]) );
+      }
+      prefetch_streams.clear();
+
+      AutoGPUContext agc(module->gpus[0]);
+      CHECK_CU( cuMemFree(base) );
+      base = 0;
+    }
+
+    off_t GPUManagedMemory::alloc_bytes(size_t size)
+    {
+      return alloc_bytes_local(size);
+    }
+
+    void GPUManagedMemory::free_bytes(off_t offset, size_t size)
+    {
+      free_bytes_local(offset, size);
+    }
+
+    void GPUManagedMemory::get_bytes(off_t offset, void *dst, size_t size)
+    {
+      memcpy(dst, (char *)base + offset, size);
+    }
+
+    void GPUManagedMemory::put_bytes(off_t offset, const void *src, size_t size)
+    {
+      memcpy((char *)base + offset, src, size);
+    }
+
+    void *GPUManagedMemory::get_direct_ptr(off_t offset, size_t size)
+    {
+      return ((char *)base + offset);
+    }
+
+    int GPUManagedMemory::get_home_node(off_t offset, size_t size)
+    {
+      return ID(me).memory.owner_node;
+    }
+
+    void GPUManagedMemory::prefetch_for_copy(off_t offset, size_t size, Memory peer)
+    {
+#if CUDA_VERSION >= 8000
+      if(!can_prefetch || (size == 0))
+	return;
+
+      // copies to or from an FB are done by that GPU's copy engines, and
+      //  everything else is done by the CPU
+      size_t index = 0;
+      CUdevice target = CU_DEVICE_CPU;
+      for(size_t i = 0; i < module->gpus.size(); i++)
+	if(module->gpus[i]->fbmem && (module->gpus[i]->fbmem->me == peer)) {
+	  index = i;
+	  target = module->gpus[i]->info->device;
+	  break;
+	}
+
+      AutoGPUContext agc(module->gpus[index]);
+      // this is only a hint - if it fails, the copy just takes page faults
+      CUresult ret = cuMemPrefetchAsync(base + offset, size, target,
+					prefetch_streams[index]);
+      if(ret != CUDA_SUCCESS)
+	log_gpu.info() << "managed memory prefetch failed: mem=" << me
+		       << " offset=" << offset << " size=" << size
+		       << " error=" << ret;
+#endif
+    }
+
     // Helper methods for emulating the cuda runtime
     /*static*/ GPUProcessor* GPUProcessor::get_current_gpu_proc(void)
     {
@@ -1725,6 +2375,16 @@ namespace Realm {
       CHECK_CU( cuEventRecord(e, current->get_stream()) );
     }
 
+    bool GPUProcessor::event_query(cudaEvent_t event)
+    {
+      CUevent e = event;
+      CUresult res = cuEventQuery(e);
+      if(res == CUDA_ERROR_NOT_READY)
+	return false;
+      CHECK_CU( res );
+      return true;
+    }
+
     void GPUProcessor::event_synchronize(cudaEvent_t event)
     {
       // TODO: consider suspending task rather than busy-waiting here...
@@ -1763,6 +2423,19 @@ namespace Realm {
       memcpy(&kernel_args[offset], arg, size);
     }
 
+    CUfunction GPUProcessor::lookup_function(const void *func)
+    {
+      // host function stubs are at least 16B aligned
+      FunctionCacheEntry &entry =
+        function_cache[(reinterpret_cast<uintptr_t>(func) >> 4) &
+                       (FUNCTION_CACHE_SIZE - 1)];
+      if(entry.host_fun != func) {
+        entry.handle = gpu->lookup_function(func);
+        entry.host_fun = func;
+      }
+      return entry.handle;
+    }
+
     void GPUProcessor::launch(const void *func)
     {
       // make sure we have a launch config
@@ -1770,7 +2443,7 @@ namespace Realm {
       LaunchConfig &config = launch_configs.back();
 
       // Find our function
-      CUfunction f = gpu->lookup_function(func);
+      CUfunction f = lookup_function(func);
 
       size_t arg_size = kernel_args.size();
       void *extra[] = { 
@@ -1797,6 +2470,43 @@ namespace Realm {
       kernel_args.clear();
     }
 
+    void GPUProcessor::launch_kernel(const void *func,
+                                     dim3 grid_dim,
+                                     dim3 block_dim,
+                                     void **args,
+                                     size_t shared_memory,
+                                     cudaStream_t stream)
+    {
+      // the arguments are already an array of pointers, which the driver
+      //  takes as is - no need to marshal them into kernel_args
+      CUfunction f = lookup_function(func);
+
+      CUstream raw_stream = gpu->get_current_task_stream()->get_stream();
+      log_stream.debug() << "kernel " << func << " added to stream " << raw_stream;
+
+      CHECK_CU( cuLaunchKernel(f,
+                               grid_dim.x, grid_dim.y, grid_dim.z,
+                               block_dim.x, block_dim.y, block_dim.z,
+                               shared_memory,
+                               raw_stream,
+                               args, NULL) );
+    }
+
+    void GPUProcessor::pop_call_configuration(dim3 *grid_dim, dim3 *block_dim,
+                                              size_t *shared_memory, void *stream)
+    {
+      // nvcc pushes the <<<>>> configuration and pops it right before it
+      //  calls cudaLaunchKernel
+      assert(!launch_configs.empty());
+      LaunchConfig &config = launch_configs.back();
+      *grid_dim = config.grid;
+      *block_dim = config.block;
+      *shared_memory = config.shared;
+      // we only have the one task stream for now
+      *(static_cast<cudaStream_t *>(stream)) = 0;
+      launch_configs.pop_back();
+    }
+
     void GPUProcessor::gpu_memcpy(void *dst, const void *src, size_t size,
 				  cudaMemcpyKind kind)
     {
@@ -1893,14 +2603,24 @@ namespace Realm {
 
       event_pool.init_pool();
 
-      host_to_device_stream = new GPUStream(this, worker);
-      device_to_host_stream = new GPUStream(this, worker);
-      device_to_device_stream = new GPUStream(this, worker);
-      peer_to_peer_stream = new GPUStream(this, worker);
+      host_to_device_streams.create_streams(this, worker,
+					    module->cfg_copy_streams,
+					    module->cfg_small_copy_bytes);
+      device_to_host_streams.create_streams(this, worker,
+					    module->cfg_copy_streams,
+					    module->cfg_small_copy_bytes);
+      device_to_device_streams.create_streams(this, worker,
+					      module->cfg_copy_streams,
+					      module->cfg_small_copy_bytes);
+      peer_to_peer_streams.create_streams(this, worker,
+					  module->cfg_copy_streams,
+					  module->cfg_small_copy_bytes);
 
       task_streams.resize(num_streams);
       for(int idx = 0; idx < num_streams; idx++)
 	task_streams[idx] = new GPUStream(this, worker);
+      task_stream_users.resize(num_streams, 0);
+      task_stream_events.resize(num_streams, 0);
 
       pop_context();
 
@@ -1912,13 +2632,17 @@ namespace Realm {
     {
       push_context();
 
+      for(size_t idx = 0; idx < task_stream_events.size(); idx++)
+	if(task_stream_events[idx] != 0)
+	  event_pool.return_event(task_stream_events[idx]);
+
       event_pool.empty_pool();
 
       // destroy streams
-      delete host_to_device_stream;
-      delete device_to_host_stream;
-      delete device_to_device_stream;
-      delete peer_to_peer_stream;
+      host_to_device_streams.destroy_streams();
+      device_to_host_streams.destroy_streams();
+      device_to_device_streams.destroy_streams();
+      peer_to_peer_streams.destroy_streams();
       while(!task_streams.empty()) {
 	delete task_streams.back();
 	task_streams.pop_back();
@@ -1970,6 +2694,18 @@ namespace Realm {
 	runtime->add_proc_mem_affinity(pma);
       }
 
+      // managed memory is as fast as the FB once pages have migrated here,
+      //  which makes it a place a mapper can leave data that both CPUs and
+      //  GPUs use without any copies at all
+      if(module->managedmem) {
+	Machine::ProcessorMemoryAffinity pma;
+	pma.p = p;
+	pma.m = module->managedmem->me;
+	pma.bandwidth = 100; // "large"
+	pma.latency = 50;    // "ok" until a fault
+	runtime->add_proc_mem_affinity(pma);
+      }
+
       // peer access
       for(std::vector<GPU *>::iterator it = module->gpus.begin();
 	  it != module->gpus.end();
@@ -2011,6 +2747,16 @@ namespace Realm {
 	AutoGPUContext agc(this);
 
 	CHECK_CU( cuMemAlloc(&fbmem_base, size) );
+
+	// with GPUDirect RDMA the network reads the framebuffer directly,
+	//  so memory operations on it must be synchronous for the NIC to
+	//  see the results of completed kernels and copies
+	if(module->cfg_gpudirect) {
+	  unsigned sync_memops = 1;
+	  CHECK_CU( cuPointerSetAttribute(&sync_memops,
+					  CU_POINTER_ATTRIBUTE_SYNC_MEMOPS,
+					  fbmem_base) );
+	}
       }
 
       Memory m = runtime->next_local_memory_id();
@@ -2192,7 +2938,15 @@ namespace Realm {
       , cfg_pin_sysmem(true)
       , cfg_fences_use_callbacks(false)
       , cfg_suppress_hijack_warning(false)
+      , cfg_gpudirect(false)
+      , cfg_idle_task_streams(false)
+      , cfg_graph_cache_size(0)
+      , cfg_copy_streams(1)
+      , cfg_fb_cache_size_in_mb(0)
+      , cfg_small_copy_bytes(64 << 10)
+      , cfg_managed_mem_size_in_mb(0)
       , shared_worker(0), zcmem_cpu_base(0), zcib_cpu_base(0), zcmem(0)
+      , managedmem(0)
     {}
       
     CudaModule::~CudaModule(void)
@@ -2276,7 +3030,14 @@ namespace Realm {
 	  .add_option_int("-ll:gpuworker", m->cfg_use_shared_worker)
 	  .add_option_int("-ll:pin", m->cfg_pin_sysmem)
 	  .add_option_bool("-cuda:callbacks", m->cfg_fences_use_callbacks)
-	  .add_option_bool("-cuda:nohijack", m->cfg_suppress_hijack_warning);
+	  .add_option_bool("-cuda:nohijack", m->cfg_suppress_hijack_warning)
+	  .add_option_bool("-cuda:gpudirect", m->cfg_gpudirect)
+	  .add_option_bool("-cuda:idlestreams", m->cfg_idle_task_streams)
+	  .add_option_int("-cuda:graphs", m->cfg_graph_cache_size)
+	  .add_option_int("-cuda:copystreams", m->cfg_copy_streams)
+	  .add_option_int("-cuda:fbcache", m->cfg_fb_cache_size_in_mb)
+	  .add_option_int("-cuda:smallcopy", m->cfg_small_copy_bytes)
+	  .add_option_int("-ll:msize", m->cfg_managed_mem_size_in_mb);
 	
 	bool ok = cp.parse_command_line(cmdline);
 	if(!ok) {
@@ -2385,6 +3146,18 @@ namespace Realm {
 	}
       }
 
+      // a single managed memory for everybody (off unless a size is given)
+      if((cfg_managed_mem_size_in_mb > 0) && !gpus.empty()) {
+	Memory m = runtime->next_local_memory_id();
+	managedmem = new GPUManagedMemory(m, this, cfg_managed_mem_size_in_mb << 20);
+	runtime->add_memory(managedmem);
+
+	// unified addressing lets every GPU's copy engines reach managed
+	//  memory directly, so FB copies don't need to stage through sysmem
+	for(unsigned i = 0; i < gpus.size(); i++)
+	  gpus[i]->pinned_sysmems.insert(managedmem->me);
+      }
+
       // allocate intermediate buffers in ZC memory for DMA engine
       if ((cfg_zc_ib_size_in_mb > 0) && !gpus.empty()) {
         CUdeviceptr zcib_gpu_base;
@@ -2453,9 +3226,11 @@ namespace Realm {
 	for(std::vector<MemoryImpl *>::iterator it = all_local_mems.begin();
 	    it != all_local_mems.end();
 	    it++) {
-	  // ignore FB/ZC memories or anything that doesn't have a "direct" pointer
+	  // ignore FB/ZC/managed memories or anything that doesn't have a
+	  //  "direct" pointer
 	  if(((*it)->kind == MemoryImpl::MKIND_GPUFB) ||
-	     ((*it)->kind == MemoryImpl::MKIND_ZEROCOPY))
+	     ((*it)->kind == MemoryImpl::MKIND_ZEROCOPY) ||
+	     ((*it)->kind == MemoryImpl::MKIND_MANAGED))
 	    continue;
 
 	  void *base = (*it)->get_direct_ptr(0, (*it)->size);
@@ -2535,6 +3310,9 @@ namespace Realm {
       }
       dedicated_workers.clear();
 
+      if(managedmem)
+	managedmem->cleanup();
+
       // use GPU 0's context to free ZC memory (if any)
       if(zcmem_cpu_base) {
 	assert(!gpus.empty());
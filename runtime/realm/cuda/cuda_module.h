@@ -29,6 +29,7 @@
 #include "realm/indexspace.h"
 #include "realm/proc_impl.h"
 #include "realm/mem_impl.h"
+#include "realm/redop.h"
 
 #define CHECK_CUDART(cmd) do { \
   cudaError_t ret = (cmd); \
@@ -63,6 +64,11 @@
 } while(0)
 #endif
 
+// graphs need stream capture with a capture mode, which arrived in 10.1
+#if CUDA_VERSION >= 10010
+#define REALM_USE_CUDA_GRAPHS
+#endif
+
 namespace Realm {
   namespace Cuda {
 
@@ -70,6 +76,7 @@ namespace Realm {
     class GPUWorker;
     struct GPUInfo;
     class GPUZCMemory;
+    class GPUManagedMemory;
 
     // our interface to the rest of the runtime
     class CudaModule : public Module {
@@ -111,6 +118,13 @@ namespace Realm {
       bool cfg_use_background_workers, cfg_use_shared_worker, cfg_pin_sysmem;
       bool cfg_fences_use_callbacks;
       bool cfg_suppress_hijack_warning;
+      bool cfg_gpudirect;
+      bool cfg_idle_task_streams;
+      unsigned cfg_graph_cache_size;
+      unsigned cfg_copy_streams;
+      size_t cfg_fb_cache_size_in_mb;
+      size_t cfg_small_copy_bytes;
+      size_t cfg_managed_mem_size_in_mb;
 
       // "global" variables live here too
       GPUWorker *shared_worker;
@@ -119,6 +133,7 @@ namespace Realm {
       std::vector<GPU *> gpus;
       void *zcmem_cpu_base, *zcib_cpu_base;
       GPUZCMemory *zcmem;
+      GPUManagedMemory *managedmem;
     };
 
     REGISTER_REALM_MODULE(CudaModule);
@@ -179,6 +194,14 @@ namespace Realm {
       virtual ~GPUMemcpy(void) { }
     public:
       virtual void execute(GPUStream *stream) = 0;
+
+      // copies that can be captured into a CUDA graph append a description
+      //  of themselves (kind, addresses, shape) and return true - a graph is
+      //  only replayed for a sequence of copies with identical descriptions
+      virtual bool describe(std::vector<uintptr_t>& desc) const { return false; }
+      // issues just the copy itself, without any completion notification
+      virtual void issue(GPUStream *stream) { assert(0); }
+      virtual GPUCompletionNotification *get_notification(void) const { return 0; }
     public:
       GPU *const gpu;
     protected:
@@ -221,6 +244,9 @@ namespace Realm {
     public:
       void do_span(off_t pos, size_t len);
       virtual void execute(GPUStream *stream);
+      virtual bool describe(std::vector<uintptr_t>& desc) const;
+      virtual void issue(GPUStream *stream);
+      virtual GPUCompletionNotification *get_notification(void) const { return notification; }
     protected:
       void *dst;
       const void *src;
@@ -243,6 +269,9 @@ namespace Realm {
 
     public:
       virtual void execute(GPUStream *stream);
+      virtual bool describe(std::vector<uintptr_t>& desc) const;
+      virtual void issue(GPUStream *stream);
+      virtual GPUCompletionNotification *get_notification(void) const { return notification; }
     protected:
       void *dst;
       const void *src;
@@ -265,6 +294,9 @@ namespace Realm {
 
     public:
       virtual void execute(GPUStream *stream);
+      virtual bool describe(std::vector<uintptr_t>& desc) const;
+      virtual void issue(GPUStream *stream);
+      virtual GPUCompletionNotification *get_notification(void) const { return notification; }
     protected:
       void *dst;
       const void *src;
@@ -273,13 +305,36 @@ namespace Realm {
       GPUCompletionNotification *notification;
     };
 
+    // applies a reduction op to a contiguous run of elements in GPU memory
+    //  using the op's registered CUDA kernels - issued like a copy so that
+    //  it is ordered with them and covered by the same fences
+    class GPUReduction : public GPUMemcpy {
+    public:
+      GPUReduction(GPU *_gpu, const ReductionOpUntyped *_redop, bool _fold,
+		   CUdeviceptr _dst, CUdeviceptr _src, size_t _count,
+		   GPUCompletionNotification *_notification);
+
+      virtual ~GPUReduction(void);
+
+    public:
+      virtual void execute(GPUStream *stream);
+    protected:
+      const ReductionOpUntyped *redop;
+      bool fold;
+      CUdeviceptr dst, src;
+      size_t count;
+      GPUCompletionNotification *notification;
+    };
+
     // a class that represents a CUDA stream and work associated with 
     //  it (e.g. queued copies, events in flight)
     // a stream is also associated with a GPUWorker that it will register
     //  with when async work needs doing
     class GPUStream {
     public:
-      GPUStream(GPU *_gpu, GPUWorker *_worker);
+      // a nonzero priority uses cuStreamCreateWithPriority (lower numbers
+      //  are higher priorities, as in CUDA)
+      GPUStream(GPU *_gpu, GPUWorker *_worker, int _priority = 0);
       ~GPUStream(void);
 
       GPU *get_gpu(void) const;
@@ -299,6 +354,11 @@ namespace Realm {
       void add_event(CUevent event, GPUWorkFence *fence, 
 		     GPUCompletionNotification *notification);
 
+      // issues a run of consecutive capturable copies, as a CUDA graph if
+      //  possible
+      void issue_copy_run(const std::vector<GPUMemcpy *>& run,
+			  const std::vector<uintptr_t>& desc);
+
       GPU *gpu;
       GPUWorker *worker;
 
@@ -323,6 +383,19 @@ namespace Realm {
 #else
       std::deque<PendingEvent> pending_events;
 #endif
+
+#ifdef REALM_USE_CUDA_GRAPHS
+      // graphs captured from runs of copies that have been seen repeatedly,
+      //  keyed by the runs' descriptions (only touched by the worker issuing
+      //  copies, so no lock needed)
+      struct CapturedGraph {
+	CapturedGraph(void) : uses(0), uncapturable(false), exec(0) {}
+	unsigned uses;
+	bool uncapturable;
+	CUgraphExec exec;
+      };
+      std::map<std::vector<uintptr_t>, CapturedGraph> graphs;
+#endif
     };
 
     // a GPUWorker is responsible for making progress on one or more GPUStreams -
@@ -379,6 +452,30 @@ namespace Realm {
       std::vector<CUevent> available_events;
     };
 
+    // the set of streams used for one direction of copies - with a single
+    //  stream everything is issued in order; with more, copies no larger than
+    //  'small_bytes' get a dedicated high-priority stream so that they never
+    //  wait behind bulk transfers, and larger copies are spread round-robin
+    //  over the remaining streams
+    class GPUCopyStreams {
+    public:
+      GPUCopyStreams(void);
+
+      void create_streams(GPU *gpu, GPUWorker *worker,
+			  unsigned num_streams, size_t _small_bytes);
+      void destroy_streams(void);
+
+      void add_copy(GPUMemcpy *copy, size_t bytes);
+
+      // a fence covers the copies on every stream of this direction
+      void add_fence(GPU *gpu, GPUMemcpyKind kind, Realm::Operation *op);
+
+    protected:
+      std::vector<GPUStream *> streams;
+      size_t small_bytes;
+      unsigned next_bulk;
+    };
+
     struct FatBin;
     struct RegisteredVariable;
     struct RegisteredFunction;
@@ -467,6 +564,15 @@ namespace Realm {
                            size_t bytes, size_t height, size_t depth,
 			   GPUCompletionNotification *notification = 0);
 
+      // reductions into this framebuffer from this or a peer framebuffer
+      //  run on the device if the reduction op has CUDA kernels
+      bool can_reduce_in_fb(Memory src_mem, const ReductionOpUntyped *redop,
+			    bool fold) const;
+
+      void reduce_in_fb(off_t dst_offset, CUdeviceptr src, size_t count,
+			const ReductionOpUntyped *redop, bool fold,
+			GPUCompletionNotification *notification = 0);
+
       void fence_to_fb(Realm::Operation *op);
       void fence_from_fb(Realm::Operation *op);
       void fence_within_fb(Realm::Operation *op);
@@ -474,7 +580,11 @@ namespace Realm {
 
       bool can_access_peer(GPU *peer);
 
-      GPUStream *switch_to_next_task_stream(void);
+      // picks the stream for a new task (round-robin, or the next idle stream
+      //  with -cuda:idlestreams) - release_task_stream is called once the
+      //  task has launched all of its work
+      GPUStream *acquire_task_stream(void);
+      void release_task_stream(GPUStream *stream);
       GPUStream *get_current_task_stream(void);
 
     protected:
@@ -497,12 +607,17 @@ namespace Realm {
       std::set<Memory> peer_fbs;
 
       // streams for different copy types and a pile for actual tasks
-      GPUStream *host_to_device_stream;
-      GPUStream *device_to_host_stream;
-      GPUStream *device_to_device_stream;
-      GPUStream *peer_to_peer_stream;
+      GPUCopyStreams host_to_device_streams;
+      GPUCopyStreams device_to_host_streams;
+      GPUCopyStreams device_to_device_streams;
+      GPUCopyStreams peer_to_peer_streams;
       std::vector<GPUStream *> task_streams;
       unsigned current_stream;
+      // the number of running tasks using each task stream, and an event
+      //  recorded after the last task on it (only with -cuda:idlestreams)
+      GASNetHSL task_stream_mutex;
+      std::vector<unsigned> task_stream_users;
+      std::vector<CUevent> task_stream_events;
 
       GPUEventPool event_pool;
 
@@ -539,6 +654,7 @@ namespace Realm {
       void event_create(cudaEvent_t *event, int flags);
       void event_destroy(cudaEvent_t event);
       void event_record(cudaEvent_t event, cudaStream_t stream);
+      bool event_query(cudaEvent_t event);
       void event_synchronize(cudaEvent_t event);
       void event_elapsed_time(float *ms, cudaEvent_t start, cudaEvent_t end);
       
@@ -546,6 +662,10 @@ namespace Realm {
 			  size_t shared_memory, cudaStream_t stream);
       void setup_argument(const void *arg, size_t size, size_t offset);
       void launch(const void *func);
+      void launch_kernel(const void *func, dim3 grid_dim, dim3 block_dim,
+                         void **args, size_t shared_memory, cudaStream_t stream);
+      void pop_call_configuration(dim3 *grid_dim, dim3 *block_dim,
+                                  size_t *shared_memory, void *stream);
 
       void gpu_memcpy(void *dst, const void *src, size_t size, cudaMemcpyKind kind);
       void gpu_memcpy_async(void *dst, const void *src, size_t size,
@@ -576,6 +696,16 @@ namespace Realm {
       std::vector<LaunchConfig> launch_configs;
       std::vector<char> kernel_args;
 
+      // direct-mapped cache in front of GPU::lookup_function so that
+      //  launches don't search the map of registered functions
+      CUfunction lookup_function(const void *func);
+      static const unsigned FUNCTION_CACHE_SIZE = 64;
+      struct FunctionCacheEntry {
+        const void *host_fun;
+        CUfunction handle;
+      };
+      FunctionCacheEntry function_cache[FUNCTION_CACHE_SIZE];
+
     protected:
       Realm::CoreReservation *core_rsrv;
     };
@@ -594,13 +724,39 @@ namespace Realm {
       virtual void get_bytes(off_t offset, void *dst, size_t size);
       virtual void put_bytes(off_t offset, const void *src, size_t size);
 
+      virtual bool fill_bytes(off_t offset, size_t size,
+			      const void *pattern, size_t pattern_size);
+
       virtual void *get_direct_ptr(off_t offset, size_t size);
 
       virtual int get_home_node(off_t offset, size_t size);
 
+    protected:
+      // recently released instance storage is kept (still allocated in the
+      //  range allocator, but detached from its instance) in per-size-class
+      //  free lists so that the churn of short-lived instances doesn't hit
+      //  the shared allocator - blocks go back to the allocator when the
+      //  cache grows past its limit or an allocation would otherwise fail
+      typedef BasicRangeAllocator<size_t, RegionInstance>::Range CachedBlock;
+
+      virtual bool allocate_storage_local(RegionInstance i,
+					  size_t bytes, size_t alignment,
+					  size_t& offset);
+      virtual void release_storage_local(RegionInstance i);
+
+      static size_t cache_size_class(size_t bytes);
+
+      // returns true if anything was released
+      bool flush_cache(size_t keep_bytes);
+
     public:
       GPU *gpu;
       CUdeviceptr base;
+
+    protected:
+      GASNetHSL cache_mutex;
+      std::map<size_t, std::vector<CachedBlock *> > cached_blocks;
+      size_t cached_bytes, cache_limit;
     };
 
     class GPUZCMemory : public MemoryImpl {
@@ -626,6 +782,44 @@ namespace Realm {
       char *cpu_base;
     };
 
+    // CUDA managed memory - one allocation that the CPUs and every GPU
+    //  address directly, with the driver migrating pages to whoever touches
+    //  them
+    class GPUManagedMemory : public MemoryImpl {
+    public:
+      GPUManagedMemory(Memory _me, CudaModule *_module, size_t _size);
+
+      virtual ~GPUManagedMemory(void);
+
+      virtual off_t alloc_bytes(size_t size);
+
+      virtual void free_bytes(off_t offset, size_t size);
+
+      virtual void get_bytes(off_t offset, void *dst, size_t size);
+
+      virtual void put_bytes(off_t offset, const void *src, size_t size);
+
+      virtual void *get_direct_ptr(off_t offset, size_t size);
+
+      virtual int get_home_node(off_t offset, size_t size);
+
+      // migrates the range to the GPU whose FB is 'peer' (or to the CPU for
+      //  any other peer) ahead of the copy
+      virtual void prefetch_for_copy(off_t offset, size_t size, Memory peer);
+
+      // frees the allocation - must be called while the GPU contexts exist
+      void cleanup(void);
+
+    public:
+      CudaModule *module;
+      CUdeviceptr base;
+      // prefetching needs concurrent managed access on every GPU
+      bool can_prefetch;
+      // one non-blocking stream per GPU, so prefetches don't serialize with
+      //  tasks or copies
+      std::vector<CUstream> prefetch_streams;
+    };
+
   }; // namespace LowLevel
 }; // namespace LegionRuntime
 
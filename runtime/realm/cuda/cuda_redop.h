@@ -0,0 +1,85 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// CUDA kernels for applying reduction ops to data in GPU memory
+
+// the kernel templates are only visible to files compiled by nvcc, and the
+//  REDOP's apply (and fold, if present) must be callable from device code
+//  (e.g. marked __CUDA_HD__) - non-exclusive versions are expected to use
+//  atomics, as concurrent reductions into the same instance may run on
+//  different streams
+
+#ifndef REALM_CUDA_REDOP_H
+#define REALM_CUDA_REDOP_H
+
+#include "realm/redop.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace Realm {
+  namespace Cuda {
+
+    // the arguments of every reduction kernel - the DMA system fills these
+    //  in and launches the kernel through its registered handle
+    struct ReductionKernelArgs {
+      uintptr_t lhs_base, lhs_stride;
+      uintptr_t rhs_base, rhs_stride;
+      size_t count;
+    };
+
+#ifdef __CUDACC__
+
+    template <typename REDOP, bool EXCL>
+    __global__ void apply_cuda_kernel(ReductionKernelArgs args)
+    {
+      for(size_t idx = blockIdx.x * blockDim.x + threadIdx.x;
+	  idx < args.count;
+	  idx += size_t(blockDim.x) * gridDim.x)
+	REDOP::template apply<EXCL>(*reinterpret_cast<typename REDOP::LHS *>(args.lhs_base +
+									      idx * args.lhs_stride),
+				    *reinterpret_cast<const typename REDOP::RHS *>(args.rhs_base +
+										    idx * args.rhs_stride));
+    }
+
+    template <typename REDOP, bool EXCL>
+    __global__ void fold_cuda_kernel(ReductionKernelArgs args)
+    {
+      for(size_t idx = blockIdx.x * blockDim.x + threadIdx.x;
+	  idx < args.count;
+	  idx += size_t(blockDim.x) * gridDim.x)
+	REDOP::template fold<EXCL>(*reinterpret_cast<typename REDOP::RHS *>(args.lhs_base +
+									     idx * args.lhs_stride),
+				   *reinterpret_cast<const typename REDOP::RHS *>(args.rhs_base +
+										   idx * args.rhs_stride));
+    }
+
+    // records the CUDA kernels for REDOP in 'redop' (which should have been
+    //  made by ReductionOpUntyped::create_reduction_op<REDOP>) - call this
+    //  before registering the reduction op with the runtime
+    template <typename REDOP>
+    void add_cuda_redop_kernels(ReductionOpUntyped *redop)
+    {
+      redop->cuda_apply_excl_fn = reinterpret_cast<const void *>(&apply_cuda_kernel<REDOP, true>);
+      redop->cuda_apply_nonexcl_fn = reinterpret_cast<const void *>(&apply_cuda_kernel<REDOP, false>);
+      redop->cuda_fold_excl_fn = reinterpret_cast<const void *>(&fold_cuda_kernel<REDOP, true>);
+      redop->cuda_fold_nonexcl_fn = reinterpret_cast<const void *>(&fold_cuda_kernel<REDOP, false>);
+    }
+#endif
+
+  }; // namespace Cuda
+}; // namespace Realm
+
+#endif
@@ -113,10 +113,13 @@ namespace Realm {
       // intercept and then either execute using the driver API or 
       // modify in ways that are important to Legion.
 
-      static GPUProcessor *get_gpu_or_die(const char *funcname)
+      static inline GPUProcessor *get_gpu_or_die(const char *funcname)
       {
 	// mark that the hijack code is active - this covers the calls below
-	cudart_hijack_active = true;
+	//  (only store when it changes so that GPU threads launching kernels
+	//  don't keep writing the same shared cache line)
+	if(!cudart_hijack_active)
+	  cudart_hijack_active = true;
 
 	GPUProcessor *p = GPUProcessor::get_current_gpu_proc();
 	if(!p) {
@@ -148,6 +151,12 @@ namespace Realm {
 	return cudaSuccess;
       }
 
+      cudaError_t cudaEventQuery(cudaEvent_t event)
+      {
+	GPUProcessor *p = get_gpu_or_die("cudaEventQuery");
+	return (p->event_query(event) ? cudaSuccess : cudaErrorNotReady);
+      }
+
       cudaError_t cudaEventSynchronize(cudaEvent_t event)
       {
 	GPUProcessor *p = get_gpu_or_die("cudaEventSynchronize");
@@ -227,6 +236,43 @@ namespace Realm {
 	return cudaSuccess;
       }
 
+      cudaError_t cudaLaunchKernel(const void *func,
+				   dim3 grid_dim,
+				   dim3 block_dim,
+				   void **args,
+				   size_t shared_memory,
+				   cudaStream_t stream)
+      {
+	GPUProcessor *p = get_gpu_or_die("cudaLaunchKernel");
+	p->launch_kernel(func, grid_dim, block_dim, args, shared_memory, stream);
+	return cudaSuccess;
+      }
+
+#if CUDART_VERSION >= 9020
+      // starting with CUDA 9.2, nvcc turns <<<>>> into a push of the
+      //  configuration and a cudaLaunchKernel that pops it
+      unsigned __cudaPushCallConfiguration(dim3 grid_dim,
+					   dim3 block_dim,
+					   size_t shared_memory,
+					   void *stream)
+      {
+	GPUProcessor *p = get_gpu_or_die("__cudaPushCallConfiguration");
+	p->configure_call(grid_dim, block_dim, shared_memory,
+			  static_cast<cudaStream_t>(stream));
+	return 0;
+      }
+
+      cudaError_t __cudaPopCallConfiguration(dim3 *grid_dim,
+					     dim3 *block_dim,
+					     size_t *shared_memory,
+					     void *stream)
+      {
+	GPUProcessor *p = get_gpu_or_die("__cudaPopCallConfiguration");
+	p->pop_call_configuration(grid_dim, block_dim, shared_memory, stream);
+	return cudaSuccess;
+      }
+#endif
+
       cudaError_t cudaMalloc(void **ptr, size_t size)
       {
 	/*GPUProcessor *p =*/ get_gpu_or_die("cudaMalloc");
@@ -443,7 +489,7 @@ namespace Realm {
       {
 	GPUProcessor *p = get_gpu_or_die("cudaFuncGetAttributes");
 
-	CUfunction handle = p->gpu->lookup_function(func);
+	CUfunction handle = p->lookup_function(func);
 
 #define GET_FUNC_ATTR(member, name)   \
 	do {			\
@@ -22,12 +22,179 @@
 #include "realm/deppart/inst_helper.h"
 #include "realm/logging.h"
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define REALM_BYFIELD_USE_SIMD
+#include <immintrin.h>
+#endif
+
 namespace Realm {
 
   extern Logger log_part;
   extern Logger log_uop_timing;
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // color run scanning
+  //
+  // the by-field scan spends nearly all of its time finding where one
+  //  color ends and the next begins along a strip of the instance - the
+  //  generic version compares one element at a time (with an arbitrary
+  //  stride), while the common dense int/bool fields compare a whole vector
+  //  at a time (AVX-512, AVX2 or SSE2, picked at startup)
+
+  // returns the length (at least 1, at most 'count') of the run of elements
+  //  equal to data[0]
+  template <typename FT>
+  static size_t scan_color_run_generic(const FT *data, ptrdiff_t stride,
+				       size_t count)
+  {
+    const char *base = reinterpret_cast<const char *>(data);
+    const FT first = *data;
+    size_t i = 1;
+    while((i < count) && (*reinterpret_cast<const FT *>(base + i * stride) == first))
+      i++;
+    return i;
+  }
+
+#ifdef REALM_BYFIELD_USE_SIMD
+  enum {
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_AVX512,
+  };
+
+  static int detect_simd_level(void)
+  {
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx512f"))
+      return SIMD_AVX512;
+    if(__builtin_cpu_supports("avx2"))
+      return SIMD_AVX2;
+    return SIMD_SSE2;
+  }
+
+  static const int simd_level = detect_simd_level();
+
+  static size_t scan_run_dense32_sse2(const int *data, size_t count)
+  {
+    const __m128i first = _mm_set1_epi32(data[0]);
+    size_t i = 1;
+    while((i + 4) <= count) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+      int eq = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, first)));
+      if(eq != 0xf)
+	return i + __builtin_ctz(~eq);
+      i += 4;
+    }
+    while((i < count) && (data[i] == data[0])) i++;
+    return i;
+  }
+
+  __attribute__((target("avx2")))
+  static size_t scan_run_dense32_avx2(const int *data, size_t count)
+  {
+    const __m256i first = _mm256_set1_epi32(data[0]);
+    size_t i = 1;
+    while((i + 8) <= count) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+      int eq = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, first)));
+      if(eq != 0xff)
+	return i + __builtin_ctz(~eq);
+      i += 8;
+    }
+    while((i < count) && (data[i] == data[0])) i++;
+    return i;
+  }
+
+  __attribute__((target("avx512f")))
+  static size_t scan_run_dense32_avx512(const int *data, size_t count)
+  {
+    const __m512i first = _mm512_set1_epi32(data[0]);
+    size_t i = 1;
+    while((i + 16) <= count) {
+      __m512i v = _mm512_loadu_si512(reinterpret_cast<const void *>(data + i));
+      __mmask16 ne = _mm512_cmpneq_epi32_mask(v, first);
+      if(ne)
+	return i + __builtin_ctz(ne);
+      i += 16;
+    }
+    while((i < count) && (data[i] == data[0])) i++;
+    return i;
+  }
+
+  static size_t scan_run_dense8_sse2(const char *data, size_t count)
+  {
+    const __m128i first = _mm_set1_epi8(data[0]);
+    size_t i = 1;
+    while((i + 16) <= count) {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+      int eq = _mm_movemask_epi8(_mm_cmpeq_epi8(v, first));
+      if(eq != 0xffff)
+	return i + __builtin_ctz(~eq);
+      i += 16;
+    }
+    while((i < count) && (data[i] == data[0])) i++;
+    return i;
+  }
+
+  __attribute__((target("avx2")))
+  static size_t scan_run_dense8_avx2(const char *data, size_t count)
+  {
+    const __m256i first = _mm256_set1_epi8(data[0]);
+    size_t i = 1;
+    while((i + 32) <= count) {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+      unsigned eq = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, first));
+      if(eq != 0xffffffffU)
+	return i + __builtin_ctz(~eq);
+      i += 32;
+    }
+    while((i < count) && (data[i] == data[0])) i++;
+    return i;
+  }
+#endif
+
+  template <typename FT>
+  struct ColorRunScanner {
+    static size_t scan(const FT *data, ptrdiff_t stride, size_t count)
+    {
+      return scan_color_run_generic(data, stride, count);
+    }
+  };
+
+#ifdef REALM_BYFIELD_USE_SIMD
+  template <>
+  struct ColorRunScanner<int> {
+    static size_t scan(const int *data, ptrdiff_t stride, size_t count)
+    {
+      if(stride != sizeof(int))
+	return scan_color_run_generic(data, stride, count);
+      switch(simd_level) {
+      case SIMD_AVX512: return scan_run_dense32_avx512(data, count);
+      case SIMD_AVX2: return scan_run_dense32_avx2(data, count);
+      default: return scan_run_dense32_sse2(data, count);
+      }
+    }
+  };
+
+  // bools are compared bytewise, which is fine since they're always 0 or 1
+  template <>
+  struct ColorRunScanner<bool> {
+    static size_t scan(const bool *data, ptrdiff_t stride, size_t count)
+    {
+      if((stride != 1) || (sizeof(bool) != 1))
+	return scan_color_run_generic(data, stride, count);
+      const char *cdata = reinterpret_cast<const char *>(data);
+      if(simd_level >= SIMD_AVX2)
+	return scan_run_dense8_avx2(cdata, count);
+      else
+	return scan_run_dense8_sse2(cdata, count);
+    }
+  };
+#endif
+
+
   template <int N, typename T>
   template <typename FT>
   Event IndexSpace<N,T>::create_subspaces_by_field(const std::vector<FieldDataDescriptor<IndexSpace<N,T>,FT> >& field_data,
@@ -110,7 +277,12 @@ namespace Realm {
   void ByFieldMicroOp<N,T,FT>::populate_bitmasks(std::map<FT, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
-    AffineAccessor<FT,N,T> a_data(inst, field_offset);
+    HostAffineAccessor<FT,N,T> a_data(inst, field_offset);
+
+    // colors tend to come in long runs, so remember the last one we saw
+    //  rather than doing a map lookup for every strip
+    FT last_val = FT();
+    BM *last_bmp = 0;
 
     // double iteration - use the instance's space first, since it's probably smaller
     for(IndexSpaceIterator<N,T> it(inst_space); it.valid; it.step()) {
@@ -118,30 +290,35 @@ namespace Realm {
 	const Rect<N,T>& r = it2.rect;
 	Point<N,T> p = r.lo;
 	while(true) {
-	  FT val = a_data.read(p);
-	  Point<N,T> p2 = p;
-	  while(p2.x < r.hi.x) {
-	    Point<N,T> p3 = p2;
-	    p3.x++;
-	    FT val2 = a_data.read(p3);
-	    if(val != val2) {
-	      // record old strip
+	  // walk the strip along x one run of equal colors at a time
+	  const char *base = reinterpret_cast<const char *>(a_data.ptr(p));
+	  ptrdiff_t stride = a_data.strides[0];
+	  size_t len = (size_t)(r.hi.x - r.lo.x) + 1;
+	  size_t ofs = 0;
+	  while(ofs < len) {
+	    const FT *data = reinterpret_cast<const FT *>(base + ofs * stride);
+	    size_t run = ColorRunScanner<FT>::scan(data, stride, len - ofs);
+	    const FT& val = *data;
+
+	    // record the strip
+	    if(!last_bmp || !(val == last_val)) {
 	      BM *&bmp = bitmasks[val];
 	      if(!bmp) bmp = new BM;
-	      bmp->add_rect(Rect<N,T>(p,p2));
-	      //std::cout << val << ": " << p << ".." << p2 << std::endl;
-	      val = val2;
-	      p = p3;
+	      last_bmp = bmp;
+	      last_val = val;
 	    }
-	    p2 = p3;
+	    Point<N,T> lo = p, hi = p;
+	    lo.x = r.lo.x + (T)ofs;
+	    hi.x = r.lo.x + (T)(ofs + run - 1);
+	    last_bmp->add_rect(Rect<N,T>(lo, hi));
+	    //std::cout << val << ": " << lo << ".." << hi << std::endl;
+
+	    ofs += run;
 	  }
-	  // record whatever strip we have at the end
-	  BM *&bmp = bitmasks[val];
-	  if(!bmp) bmp = new BM;
-	  bmp->add_rect(Rect<N,T>(p,p2));
-	  //std::cout << val << ": " << p << ".." << p2 << std::endl;
 
 	  // are we done?
+	  Point<N,T> p2 = p;
+	  p2.x = r.hi.x;
 	  if(p2 == r.hi) break;
 
 	  // now go to the next span, if there is one (can't be in 1-D)
@@ -304,19 +481,28 @@ namespace Realm {
   template <int N, typename T, typename FT>
   void ByFieldOperation<N,T,FT>::execute(void)
   {
-    for(size_t i = 0; i < subspaces.size(); i++)
-      SparsityMapImpl<N,T>::lookup(subspaces[i])->set_contributor_count(field_data.size());
-
+    // large instances are scanned in pieces, each of which is a contributor
+    std::vector<std::vector<IndexSpace<N,T> > > pieces(field_data.size());
+    size_t total_pieces = 0;
     for(size_t i = 0; i < field_data.size(); i++) {
-      ByFieldMicroOp<N,T,FT> *uop = new ByFieldMicroOp<N,T,FT>(parent,
-							       field_data[i].index_space,
-							       field_data[i].inst,
-							       field_data[i].field_offset);
-      for(size_t j = 0; j < colors.size(); j++)
-	uop->add_sparsity_output(colors[j], subspaces[j]);
-      //uop.set_value_set(colors);
-      uop->dispatch(this, true /* ok to run in this thread */);
+      split_for_parallel_uops(field_data[i].index_space, pieces[i]);
+      total_pieces += pieces[i].size();
     }
+
+    for(size_t i = 0; i < subspaces.size(); i++)
+      SparsityMapImpl<N,T>::lookup(subspaces[i])->set_contributor_count(total_pieces);
+
+    for(size_t i = 0; i < field_data.size(); i++)
+      for(size_t k = 0; k < pieces[i].size(); k++) {
+	ByFieldMicroOp<N,T,FT> *uop = new ByFieldMicroOp<N,T,FT>(parent,
+								 pieces[i][k],
+								 field_data[i].inst,
+								 field_data[i].field_offset);
+	for(size_t j = 0; j < colors.size(); j++)
+	  uop->add_sparsity_output(colors[j], subspaces[j]);
+	//uop.set_value_set(colors);
+	uop->dispatch(this, true /* ok to run in this thread */);
+      }
   }
 
   template <int N, typename T, typename FT>
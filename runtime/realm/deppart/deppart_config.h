@@ -27,6 +27,11 @@ namespace Realm {
     extern int cfg_max_rects_in_approximation;
     extern size_t cfg_max_bytes_per_packet;
     extern bool cfg_worker_threads_sleep;
+    extern size_t cfg_min_points_per_uop;
+    extern size_t cfg_bulk_rects_min_points;
+    extern size_t cfg_bitmap_min_entries;
+    extern int cfg_bitmap_min_density;
+    extern size_t cfg_approx_filter_bits;
 
   };
 
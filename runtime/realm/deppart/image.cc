@@ -166,7 +166,7 @@ namespace Realm {
   void ImageMicroOp<N,T,N2,T2>::populate_bitmasks_ptrs(std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
-    AffineAccessor<Point<N,T>,N2,T2> a_data(inst, field_offset);
+    HostAffineAccessor<Point<N,T>,N2,T2> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
     for(IndexSpaceIterator<N2,T2> it(inst_space); it.valid; it.step()) {
@@ -201,7 +201,7 @@ namespace Realm {
   void ImageMicroOp<N,T,N2,T2>::populate_bitmasks_ranges(std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
-    AffineAccessor<Rect<N,T>,N2,T2> a_data(inst, field_offset);
+    HostAffineAccessor<Rect<N,T>,N2,T2> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
     for(IndexSpaceIterator<N2,T2> it(inst_space); it.valid; it.step()) {
@@ -231,12 +231,36 @@ namespace Realm {
     }
   }
 
+  // an approximate image feeds both a bounded rectangle list and a filter
+  template <int N, typename T>
+  class ApproxImageBuilder {
+  public:
+    ApproxImageBuilder(DenseRectangleList<N,T>& _rects, ApproxImageFilter<N,T>& _filter)
+      : rects(_rects), filter(_filter) {}
+
+    void add_point(const Point<N,T>& p)
+    {
+      rects.add_point(p);
+      filter.add_point(p);
+    }
+
+    void add_rect(const Rect<N,T>& r)
+    {
+      rects.add_rect(r);
+      filter.add_rect(r);
+    }
+
+  protected:
+    DenseRectangleList<N,T>& rects;
+    ApproxImageFilter<N,T>& filter;
+  };
+
   template <int N, typename T, int N2, typename T2>
   template <typename BM>
   void ImageMicroOp<N,T,N2,T2>::populate_approx_bitmask_ptrs(BM& bitmask)
   {
     // for now, one access for the whole instance
-    AffineAccessor<Point<N,T>,N2,T2> a_data(inst, field_offset);
+    HostAffineAccessor<Point<N,T>,N2,T2> a_data(inst, field_offset);
     //std::cout << "a_data = " << a_data << "\n";
 
     // simple image operation - project ever 
@@ -255,7 +279,7 @@ namespace Realm {
   void ImageMicroOp<N,T,N2,T2>::populate_approx_bitmask_ranges(BM& bitmask)
   {
     // for now, one access for the whole instance
-    AffineAccessor<Rect<N,T>,N2,T2> a_data(inst, field_offset);
+    HostAffineAccessor<Rect<N,T>,N2,T2> a_data(inst, field_offset);
     //std::cout << "a_data = " << a_data << "\n";
 
     // simple image operation - project ever 
@@ -270,54 +294,71 @@ namespace Realm {
   }
 
   template <int N, typename T, int N2, typename T2>
-  void ImageMicroOp<N,T,N2,T2>::execute(void)
+  template <typename BM>
+  void ImageMicroOp<N,T,N2,T2>::compute_sparsity_outputs(void)
   {
-    TimeStamp ts("ImageMicroOp::execute", true, &log_uop_timing);
-
-    if(!sparsity_outputs.empty()) {
-      //std::map<int, DenseRectangleList<N,T> *> rect_map;
-      std::map<int, HybridRectangleList<N,T> *> rect_map;
+    std::map<int, BM *> rect_map;
 
-      if(is_ranged)
-	populate_bitmasks_ranges(rect_map);
-      else
-	populate_bitmasks_ptrs(rect_map);
+    if(is_ranged)
+      populate_bitmasks_ranges(rect_map);
+    else
+      populate_bitmasks_ptrs(rect_map);
 
 #ifdef DEBUG_PARTITIONING
-      std::cout << rect_map.size() << " non-empty images present in instance " << inst << std::endl;
-      for(typename std::map<int, DenseRectangleList<N,T> *>::const_iterator it = rect_map.begin();
-	  it != rect_map.end();
-	  it++)
-	std::cout << "  " << sources[it->first] << " = " << it->second->rects.size() << " rectangles" << std::endl;
+    std::cout << rect_map.size() << " non-empty images present in instance " << inst << std::endl;
+    for(typename std::map<int, BM *>::const_iterator it = rect_map.begin();
+	it != rect_map.end();
+	it++)
+      std::cout << "  " << sources[it->first] << " = " << it->second->convert_to_vector().size() << " rectangles" << std::endl;
 #endif
 
-      // iterate over sparsity outputs and contribute to all (even if we didn't have any
-      //  points found for it)
-      for(size_t i = 0; i < sparsity_outputs.size(); i++) {
-	SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(sparsity_outputs[i]);
-	typename std::map<int, HybridRectangleList<N,T> *>::const_iterator it2 = rect_map.find(i);
-	if(it2 != rect_map.end()) {
-	  impl->contribute_dense_rect_list(it2->second->convert_to_vector());
-	  delete it2->second;
-	} else
-	  impl->contribute_nothing();
-      }
+    // iterate over sparsity outputs and contribute to all (even if we didn't have any
+    //  points found for it)
+    for(size_t i = 0; i < sparsity_outputs.size(); i++) {
+      SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(sparsity_outputs[i]);
+      typename std::map<int, BM *>::const_iterator it2 = rect_map.find(i);
+      if(it2 != rect_map.end()) {
+	impl->contribute_dense_rect_list(it2->second->convert_to_vector());
+	delete it2->second;
+      } else
+	impl->contribute_nothing();
+    }
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void ImageMicroOp<N,T,N2,T2>::execute(void)
+  {
+    TimeStamp ts("ImageMicroOp::execute", true, &log_uop_timing);
+
+    if(!sparsity_outputs.empty()) {
+      // images of large instances are likely to be large and badly ordered,
+      //  which the bulk builder handles in (near) linear time
+      if(inst_space.bounds.volume() >= DeppartConfig::cfg_bulk_rects_min_points)
+	compute_sparsity_outputs<BulkRectangleBuilder<N,T> >();
+      else
+	compute_sparsity_outputs<HybridRectangleList<N,T> >();
     }
 
     if(approx_output_index != -1) {
       DenseRectangleList<N,T> approx_rects(DeppartConfig::cfg_max_rects_in_approximation);
+      // the parent space is the bounding box of the preimage's targets
+      ApproxImageFilter<N,T> filter;
+      filter.configure(parent_space.bounds, DeppartConfig::cfg_approx_filter_bits);
+      ApproxImageBuilder<N,T> builder(approx_rects, filter);
 
       if(is_ranged)
-	populate_approx_bitmask_ranges(approx_rects);
+	populate_approx_bitmask_ranges(builder);
       else
-	populate_approx_bitmask_ptrs(approx_rects);
+	populate_approx_bitmask_ptrs(builder);
 
       if(requestor == my_node_id) {
 	PreimageOperation<N2,T2,N,T> *op = reinterpret_cast<PreimageOperation<N2,T2,N,T> *>(approx_output_op);
-	op->provide_sparse_image(approx_output_index, &approx_rects.rects[0], approx_rects.rects.size());
+	op->provide_sparse_image(approx_output_index, &approx_rects.rects[0], approx_rects.rects.size(),
+				 filter);
       } else {
 	ApproxImageResponseMessage::send_request<N2,T2,N,T>(requestor, approx_output_op, approx_output_index,
-							    &approx_rects.rects[0], approx_rects.rects.size());
+							    &approx_rects.rects[0], approx_rects.rects.size(),
+							    filter);
       }
     }
   }
@@ -522,40 +563,54 @@ namespace Realm {
 
       uop->dispatch(this, true /* ok to run in this thread */);
     } else {
-      // launch full cross-product of image micro ops right away
-      for(size_t i = 0; i < sources.size(); i++)
-	SparsityMapImpl<N,T>::lookup(images[i])->set_contributor_count(ptr_data.size() +
-								       range_data.size());
-
+      // launch full cross-product of image micro ops right away (large
+      //  instances are split into pieces, each of which is a contributor)
+      std::vector<std::vector<IndexSpace<N2,T2> > > ptr_pieces(ptr_data.size());
+      std::vector<std::vector<IndexSpace<N2,T2> > > range_pieces(range_data.size());
+      size_t total_pieces = 0;
       for(size_t i = 0; i < ptr_data.size(); i++) {
-	ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
-								   ptr_data[i].index_space,
-								   ptr_data[i].inst,
-								   ptr_data[i].field_offset,
-								   false /*ptrs*/);
-	for(size_t j = 0; j < sources.size(); j++)
-          if(diff_rhss.empty())
-	    uop->add_sparsity_output(sources[j], images[j]);
-          else
-	    uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
-
-	uop->dispatch(this, true /* ok to run in this thread */);
+	split_for_parallel_uops(ptr_data[i].index_space, ptr_pieces[i]);
+	total_pieces += ptr_pieces[i].size();
       }
-
       for(size_t i = 0; i < range_data.size(); i++) {
-	ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
-								   range_data[i].index_space,
-								   range_data[i].inst,
-								   range_data[i].field_offset,
-								   true /*ranges*/);
-	for(size_t j = 0; j < sources.size(); j++)
-          if(diff_rhss.empty())
-	    uop->add_sparsity_output(sources[j], images[j]);
-          else
-	    uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
-
-	uop->dispatch(this, true /* ok to run in this thread */);
+	split_for_parallel_uops(range_data[i].index_space, range_pieces[i]);
+	total_pieces += range_pieces[i].size();
       }
+
+      for(size_t i = 0; i < sources.size(); i++)
+	SparsityMapImpl<N,T>::lookup(images[i])->set_contributor_count(total_pieces);
+
+      for(size_t i = 0; i < ptr_data.size(); i++)
+	for(size_t k = 0; k < ptr_pieces[i].size(); k++) {
+	  ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
+								     ptr_pieces[i][k],
+								     ptr_data[i].inst,
+								     ptr_data[i].field_offset,
+								     false /*ptrs*/);
+	  for(size_t j = 0; j < sources.size(); j++)
+	    if(diff_rhss.empty())
+	      uop->add_sparsity_output(sources[j], images[j]);
+	    else
+	      uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
+
+	  uop->dispatch(this, true /* ok to run in this thread */);
+	}
+
+      for(size_t i = 0; i < range_data.size(); i++)
+	for(size_t k = 0; k < range_pieces[i].size(); k++) {
+	  ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
+								     range_pieces[i][k],
+								     range_data[i].inst,
+								     range_data[i].field_offset,
+								     true /*ranges*/);
+	  for(size_t j = 0; j < sources.size(); j++)
+	    if(diff_rhss.empty())
+	      uop->add_sparsity_output(sources[j], images[j]);
+	    else
+	      uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
+
+	  uop->dispatch(this, true /* ok to run in this thread */);
+	}
     }
   }
 
@@ -575,8 +630,6 @@ namespace Realm {
 
       log_part.info() << overlaps_by_source.size() << " overlaps for source " << i;
 
-      SparsityMapImpl<N,T>::lookup(images[i])->set_contributor_count(overlaps_by_source.size());
-
       // now scatter these values into the overlaps_by_field_data
       for(std::set<int>::const_iterator it = overlaps_by_source.begin();
 	  it != overlaps_by_source.end();
@@ -585,26 +638,50 @@ namespace Realm {
     }
     delete overlap_tester;
 
+    // large instances are split into pieces, each of which contributes to
+    //  every image its instance overlaps
+    std::vector<std::vector<IndexSpace<N2,T2> > > pieces(ptr_data.size() +
+							 range_data.size());
+    std::vector<int> contrib_counts(sources.size(), 0);
+    for(size_t i = 0; i < pieces.size(); i++) {
+      if(overlaps_by_field_data[i].empty()) continue;
+
+      if(i < ptr_data.size())
+	split_for_parallel_uops(ptr_data[i].index_space, pieces[i]);
+      else
+	split_for_parallel_uops(range_data[i - ptr_data.size()].index_space, pieces[i]);
+
+      for(std::set<int>::const_iterator it = overlaps_by_field_data[i].begin();
+	  it != overlaps_by_field_data[i].end();
+	  it++)
+	contrib_counts[*it] += pieces[i].size();
+    }
+
+    for(size_t i = 0; i < sources.size(); i++)
+      SparsityMapImpl<N,T>::lookup(images[i])->set_contributor_count(contrib_counts[i]);
+
     for(size_t i = 0; i < ptr_data.size(); i++) {
       const std::set<int>& overlaps = overlaps_by_field_data[i];
       size_t n = overlaps.size();
       if(n == 0) continue;
 
-      ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
-								 ptr_data[i].index_space,
-								 ptr_data[i].inst,
-								 ptr_data[i].field_offset,
-								 false /*ptrs*/);
-      for(std::set<int>::const_iterator it = overlaps.begin();
-	  it != overlaps.end();
-	  it++) {
-	int j = *it;
-        if(diff_rhss.empty())
-	  uop->add_sparsity_output(sources[j], images[j]);
-        else
-	  uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
+      for(size_t k = 0; k < pieces[i].size(); k++) {
+	ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
+								   pieces[i][k],
+								   ptr_data[i].inst,
+								   ptr_data[i].field_offset,
+								   false /*ptrs*/);
+	for(std::set<int>::const_iterator it = overlaps.begin();
+	    it != overlaps.end();
+	    it++) {
+	  int j = *it;
+	  if(diff_rhss.empty())
+	    uop->add_sparsity_output(sources[j], images[j]);
+	  else
+	    uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
+	}
+	uop->dispatch(this, true /* ok to run in this thread */);
       }
-      uop->dispatch(this, true /* ok to run in this thread */);
     }
 
     for(size_t i = 0; i < range_data.size(); i++) {
@@ -612,21 +689,24 @@ namespace Realm {
       size_t n = overlaps.size();
       if(n == 0) continue;
 
-      ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
-								 range_data[i].index_space,
-								 range_data[i].inst,
-								 range_data[i].field_offset,
-								 true /*ranges*/);
-      for(std::set<int>::const_iterator it = overlaps.begin();
-	  it != overlaps.end();
-	  it++) {
-	int j = *it;
-        if(diff_rhss.empty())
-	  uop->add_sparsity_output(sources[j], images[j]);
-        else
-	  uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
+      const std::vector<IndexSpace<N2,T2> >& p = pieces[i + ptr_data.size()];
+      for(size_t k = 0; k < p.size(); k++) {
+	ImageMicroOp<N,T,N2,T2> *uop = new ImageMicroOp<N,T,N2,T2>(parent,
+								   p[k],
+								   range_data[i].inst,
+								   range_data[i].field_offset,
+								   true /*ranges*/);
+	for(std::set<int>::const_iterator it = overlaps.begin();
+	    it != overlaps.end();
+	    it++) {
+	  int j = *it;
+	  if(diff_rhss.empty())
+	    uop->add_sparsity_output(sources[j], images[j]);
+	  else
+	    uop->add_sparsity_output_with_difference(sources[j], diff_rhss[j], images[j]);
+	}
+	uop->dispatch(this, true /* ok to run in this thread */);
       }
-      uop->dispatch(this, true /* ok to run in this thread */);
     }
   }
 
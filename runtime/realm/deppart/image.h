@@ -66,6 +66,11 @@ namespace Realm {
     template <typename BM>
     void populate_approx_bitmask_ptrs(BM& bitmask);
 
+    // fills in and contributes to the sparsity outputs using the given kind
+    //  of rectangle list
+    template <typename BM>
+    void compute_sparsity_outputs(void);
+
     template <typename BM>
     void populate_approx_bitmask_ranges(BM& bitmask);
 
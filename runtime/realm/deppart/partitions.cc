@@ -20,6 +20,8 @@
 #include "realm/profiling.h"
 
 #include "realm/runtime_impl.h"
+#include "realm/inst_impl.h"
+#include "realm/mem_impl.h"
 #include "realm/deppart/inst_helper.h"
 #include "realm/deppart/rectlist.h"
 
@@ -28,6 +30,8 @@
 #include "realm/deppart/byfield.h"
 #include "realm/deppart/setops.h"
 
+#include <algorithm>
+
 namespace Realm {
 
   Logger log_part("part");
@@ -48,6 +52,11 @@ namespace Realm {
     int cfg_max_rects_in_approximation = 32;
     size_t cfg_max_bytes_per_packet = 2048;//32768;
     bool cfg_worker_threads_sleep = false;
+    size_t cfg_min_points_per_uop = 1 << 20;
+    size_t cfg_bulk_rects_min_points = 1 << 16;
+    size_t cfg_bitmap_min_entries = 1024;
+    int cfg_bitmap_min_density = 50;  // percent
+    size_t cfg_approx_filter_bits = 0;  // preimage target filter (0 = off)
   };
 
   // TODO: C++11 has type_traits and std::make_unsigned
@@ -240,48 +249,154 @@ namespace Realm {
   void OverlapTester<N,T>::add_index_space(int label, const IndexSpace<N,T>& space,
 					   bool use_approx /*= true*/)
   {
-    labels.push_back(label);
-    spaces.push_back(space);
-    approxs.push_back(use_approx);
+    if(space.dense()) {
+      if(!space.bounds.empty()) {
+	all_rects.push_back(space.bounds);
+	all_labels.push_back(label);
+      }
+    } else if(use_approx) {
+      SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(space.sparsity);
+      const std::vector<Rect<N,T> >& approx_rects = impl->get_approx_rects();
+      for(typename std::vector<Rect<N,T> >::const_iterator it = approx_rects.begin();
+	  it != approx_rects.end();
+	  it++) {
+	Rect<N,T> isect = space.bounds.intersection(*it);
+	if(isect.empty()) continue;
+	all_rects.push_back(isect);
+	all_labels.push_back(label);
+      }
+    } else {
+      for(IndexSpaceIterator<N,T> it(space); it.valid; it.step()) {
+	all_rects.push_back(it.rect);
+	all_labels.push_back(label);
+      }
+    }
+  }
+
+  // orders indices of rectangles by the centers of the rectangles in one
+  //  dimension
+  template <int N, typename T>
+  class RectCenterCompare {
+  public:
+    RectCenterCompare(const std::vector<Rect<N,T> >& _rects, int _dim)
+      : rects(_rects), dim(_dim) {}
+    bool operator()(size_t a, size_t b) const
+    {
+      // compare halves separately to avoid overflow
+      T ca = (rects[a].lo[dim] >> 1) + (rects[a].hi[dim] >> 1);
+      T cb = (rects[b].lo[dim] >> 1) + (rects[b].hi[dim] >> 1);
+      return ca < cb;
+    }
+  protected:
+    const std::vector<Rect<N,T> >& rects;
+    int dim;
+  };
+
+  template <int N, typename T>
+  void OverlapTester<N,T>::build_node(size_t node_idx, size_t first, size_t count)
+  {
+    Rect<N,T> bbox = all_rects[first];
+    for(size_t i = 1; i < count; i++)
+      bbox = bbox.union_bbox(all_rects[first + i]);
+    nodes[node_idx].bounds = bbox;
+
+    if(count <= MAX_RECTS_PER_LEAF) {
+      nodes[node_idx].first = first;
+      nodes[node_idx].count = count;
+      return;
+    }
+
+    // split at the median along the widest dimension of the bounds
+    int dim = 0;
+    for(int i = 1; i < N; i++)
+      if((bbox.hi[i] - bbox.lo[i]) > (bbox.hi[dim] - bbox.lo[dim]))
+	dim = i;
+
+    std::vector<size_t> order(count);
+    for(size_t i = 0; i < count; i++)
+      order[i] = first + i;
+    size_t half = count / 2;
+    std::nth_element(order.begin(), order.begin() + half, order.end(),
+		     RectCenterCompare<N,T>(all_rects, dim));
+    std::vector<Rect<N,T> > sorted_rects(count);
+    std::vector<int> sorted_labels(count);
+    for(size_t i = 0; i < count; i++) {
+      sorted_rects[i] = all_rects[order[i]];
+      sorted_labels[i] = all_labels[order[i]];
+    }
+    std::copy(sorted_rects.begin(), sorted_rects.end(), all_rects.begin() + first);
+    std::copy(sorted_labels.begin(), sorted_labels.end(), all_labels.begin() + first);
+
+    size_t child = nodes.size();
+    nodes.resize(child + 2);
+    nodes[node_idx].first = child;
+    nodes[node_idx].count = 0;
+    build_node(child, first, half);
+    build_node(child + 1, first + half, count - half);
   }
 
   template <int N, typename T>
   void OverlapTester<N,T>::construct(void)
   {
-    // nothing special yet
+    nodes.clear();
+    if(all_rects.empty())
+      return;
+    nodes.reserve(2 * ((all_rects.size() + MAX_RECTS_PER_LEAF - 1) / MAX_RECTS_PER_LEAF));
+    nodes.resize(1);
+    build_node(0, 0, all_rects.size());
   }
 
   template <int N, typename T>
-  void OverlapTester<N,T>::test_overlap(const Rect<N,T> *rects, size_t count, std::set<int>& overlaps)
+  void OverlapTester<N,T>::query(const Rect<N,T>& r, std::set<int>& overlaps) const
   {
-    for(size_t i = 0; i < labels.size(); i++)
-      if(approxs[i]) {
-	for(size_t j = 0; j < count; j++)
-	  if(spaces[i].overlaps_approx(rects[j])) {
-	    overlaps.insert(labels[i]);
-	    break;
-	  }
+    if(nodes.empty() || !nodes[0].bounds.overlaps(r))
+      return;
+
+    std::vector<size_t> todo;
+    todo.push_back(0);
+    while(!todo.empty()) {
+      const BVHNode& n = nodes[todo.back()];
+      todo.pop_back();
+      if(n.count > 0) {
+	for(size_t i = n.first; i < n.first + n.count; i++)
+	  if(all_rects[i].overlaps(r))
+	    overlaps.insert(all_labels[i]);
       } else {
-	for(size_t j = 0; j < count; j++)
-	  if(spaces[i].overlaps(rects[j])) {
-	    overlaps.insert(labels[i]);
-	    break;
-	  }
+	for(size_t c = n.first; c < n.first + 2; c++)
+	  if(nodes[c].bounds.overlaps(r))
+	    todo.push_back(c);
       }
+    }
+  }
+
+  template <int N, typename T>
+  void OverlapTester<N,T>::test_overlap(const Rect<N,T> *rects, size_t count, std::set<int>& overlaps)
+  {
+    for(size_t i = 0; i < count; i++)
+      query(rects[i], overlaps);
   }
 
   template <int N, typename T>
   void OverlapTester<N,T>::test_overlap(const IndexSpace<N,T>& space, std::set<int>& overlaps,
 					bool approx)
   {
-    for(size_t i = 0; i < labels.size(); i++)
-      if(approxs[i] && approx) {
-	if(space.overlaps_approx(spaces[i]))
-	  overlaps.insert(labels[i]);
-      } else {
-	if(space.overlaps(spaces[i]))
-	  overlaps.insert(labels[i]);
+    if(space.dense()) {
+      if(!space.bounds.empty())
+	query(space.bounds, overlaps);
+    } else if(approx) {
+      SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(space.sparsity);
+      const std::vector<Rect<N,T> >& approx_rects = impl->get_approx_rects();
+      for(typename std::vector<Rect<N,T> >::const_iterator it = approx_rects.begin();
+	  it != approx_rects.end();
+	  it++) {
+	Rect<N,T> isect = space.bounds.intersection(*it);
+	if(!isect.empty())
+	  query(isect, overlaps);
       }
+    } else {
+      for(IndexSpaceIterator<N,T> it(space); it.valid; it.step())
+	query(it.rect, overlaps);
+    }
   }
 
 
@@ -359,6 +474,49 @@ namespace Realm {
   }
 
 
+  template <int N, typename T>
+  void split_for_parallel_uops(const IndexSpace<N,T>& space,
+			       std::vector<IndexSpace<N,T> >& pieces)
+  {
+    size_t max_pieces = 1;
+    if((DeppartConfig::cfg_num_partitioning_workers > 1) &&
+       (DeppartConfig::cfg_min_points_per_uop > 0) &&
+       !space.bounds.empty()) {
+      max_pieces = space.bounds.volume() / DeppartConfig::cfg_min_points_per_uop;
+      if(max_pieces > (size_t)DeppartConfig::cfg_num_partitioning_workers)
+	max_pieces = DeppartConfig::cfg_num_partitioning_workers;
+    }
+
+    // pick the widest dimension to cut along
+    int dim = 0;
+    size_t extent = 0;
+    if(max_pieces > 1)
+      for(int i = 0; i < N; i++) {
+	size_t e = (size_t)(space.bounds.hi[i] - space.bounds.lo[i]) + 1;
+	if(e > extent) {
+	  extent = e;
+	  dim = i;
+	}
+      }
+    if(max_pieces > extent)
+      max_pieces = extent;
+
+    if(max_pieces <= 1) {
+      pieces.push_back(space);
+      return;
+    }
+
+    // the pieces keep the original sparsity map, which iteration clips to
+    //  each piece's bounds
+    for(size_t i = 0; i < max_pieces; i++) {
+      IndexSpace<N,T> piece = space;
+      piece.bounds.lo[dim] = space.bounds.lo[dim] + (T)((extent * i) / max_pieces);
+      piece.bounds.hi[dim] = space.bounds.lo[dim] + (T)((extent * (i + 1)) / max_pieces) - 1;
+      pieces.push_back(piece);
+    }
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class AsyncMicroOp
@@ -454,6 +612,33 @@ namespace Realm {
     }
   }
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // staging of field data for the cpu
+
+  void *stage_instance_data(RegionInstance inst, ptrdiff_t& delta)
+  {
+    RegionInstanceImpl *r_impl = get_runtime()->get_instance_impl(inst);
+    // have to stall on metadata if it's not available...
+    if(!r_impl->metadata.is_valid())
+      r_impl->request_metadata().wait();
+    assert(r_impl->metadata.layout);
+    MemoryImpl *mem = get_runtime()->get_memory_impl(r_impl->memory);
+    if(mem->kind != MemoryImpl::MKIND_GPUFB)
+      return 0;
+
+    size_t bytes = r_impl->metadata.layout->bytes_used;
+    void *staging = malloc(bytes);
+    assert(staging != 0);
+    inst.read_untyped(0, staging, bytes);
+    char *direct = static_cast<char *>(inst.pointer_untyped(0, bytes));
+    delta = static_cast<char *>(staging) - direct;
+    log_part.debug() << "staged " << bytes << " bytes of " << inst
+		     << " from " << r_impl->memory << " for the cpu";
+    return staging;
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class ComputeOverlapMicroOp<N,T>
@@ -784,6 +969,11 @@ namespace Realm {
 
     cp.add_option_int("-dp:workers", DeppartConfig::cfg_num_partitioning_workers);
     cp.add_option_bool("-dp:noisectopt", DeppartConfig::cfg_disable_intersection_optimization);
+    cp.add_option_int("-dp:splitpts", DeppartConfig::cfg_min_points_per_uop);
+    cp.add_option_int("-dp:bulkpts", DeppartConfig::cfg_bulk_rects_min_points);
+    cp.add_option_int("-dp:bitmapents", DeppartConfig::cfg_bitmap_min_entries);
+    cp.add_option_int("-dp:bitmapdensity", DeppartConfig::cfg_bitmap_min_density);
+    cp.add_option_int("-dp:approxbits", DeppartConfig::cfg_approx_filter_bits);
 
     cp.parse_command_line(cmdline);
   }
@@ -896,6 +1086,7 @@ namespace Realm {
 #define DOIT(N,T) \
   template struct IndexSpace<N,T>; \
   template void PartitioningMicroOp::sparsity_map_ready(SparsityMapImpl<N,T>*, bool); \
+  template void split_for_parallel_uops(const IndexSpace<N,T>&, std::vector<IndexSpace<N,T> >&); \
   template class OverlapTester<N,T>; \
   template class ComputeOverlapMicroOp<N,T>;
   FOREACH_NT(DOIT)
@@ -53,9 +53,24 @@ namespace Realm {
     void test_overlap(const SparsityMapImpl<N,T> *sparsity, std::set<int>& overlaps, bool approx);
 
   protected:
-    std::vector<int> labels;
-    std::vector<IndexSpace<N,T> > spaces;
-    std::vector<bool> approxs;
+    // the rectangles of all the added spaces are kept in a bounding volume
+    //  hierarchy, built once by construct(), so that each query only visits
+    //  the parts of the tree whose bounds it overlaps
+    static const size_t MAX_RECTS_PER_LEAF = 8;
+
+    struct BVHNode {
+      Rect<N,T> bounds;
+      // leaves hold rects [first, first+count), inner nodes have 'count' == 0
+      //  and children 'first' and 'first'+1
+      size_t first, count;
+    };
+
+    void build_node(size_t node_idx, size_t first, size_t count);
+    void query(const Rect<N,T>& r, std::set<int>& overlaps) const;
+
+    std::vector<Rect<N,T> > all_rects;
+    std::vector<int> all_labels;
+    std::vector<BVHNode> nodes;
   };
 
   template <typename T>
@@ -73,10 +88,22 @@ namespace Realm {
     void test_overlap(const SparsityMapImpl<1,T> *sparsity, std::set<int>& overlaps, bool approx);
 
   protected:
-    IntervalTree<T,int> interval_tree;
+    FlatIntervalTree<T,int> interval_tree;
   };
 
 
+  // splits an instance's index space into pieces along its widest dimension
+  //  so that the byfield/image/preimage micro-ops for that instance can be
+  //  spread over the partitioning workers - each piece contributes to the
+  //  output sparsity maps separately, so callers have to count every piece
+  //  as a contributor
+  // there's only ever one piece unless there are multiple workers and the
+  //  bounds hold at least cfg_min_points_per_uop points per piece
+  template <int N, typename T>
+  void split_for_parallel_uops(const IndexSpace<N,T>& space,
+			       std::vector<IndexSpace<N,T> >& pieces);
+
+
   /////////////////////////////////////////////////////////////////////////
 
   class AsyncMicroOp : public Operation::AsyncWorkItem {
@@ -124,6 +151,40 @@ namespace Realm {
     AsyncMicroOp *async_microop;
   };
 
+  // if the cpu can't read an instance's memory directly (i.e. it's in a GPU
+  //  framebuffer), copies the instance's data to a host buffer with a single
+  //  bulk read and returns it, along with the buffer's offset from the
+  //  instance's direct pointer - returns 0 if no copy is needed
+  void *stage_instance_data(RegionInstance inst, ptrdiff_t& delta);
+
+  // an affine accessor that micro-ops can use on the cpu no matter where
+  //  the field data lives, so that partitioning by data in a framebuffer
+  //  doesn't need a copy to system memory first
+  template <typename FT, int N, typename T>
+  class HostAffineAccessor : public AffineAccessor<FT,N,T> {
+  public:
+    HostAffineAccessor(RegionInstance inst, FieldID field_id)
+      : AffineAccessor<FT,N,T>(inst, field_id)
+    {
+      ptrdiff_t delta = 0;
+      staging = stage_instance_data(inst, delta);
+      if(staging)
+	this->base += delta;
+    }
+
+    ~HostAffineAccessor(void)
+    {
+      if(staging)
+	free(staging);
+    }
+
+  protected:
+    HostAffineAccessor(const HostAffineAccessor& copy_from);
+    HostAffineAccessor& operator=(const HostAffineAccessor& copy_from);
+
+    void *staging;
+  };
+
   template <int N, typename T>
   class ComputeOverlapMicroOp : public PartitioningMicroOp {
   public:
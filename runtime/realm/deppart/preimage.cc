@@ -121,7 +121,7 @@ namespace Realm {
   void PreimageMicroOp<N,T,N2,T2>::populate_bitmasks_ptrs(std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
-    AffineAccessor<Point<N2,T2>,N,T> a_data(inst, field_offset);
+    HostAffineAccessor<Point<N2,T2>,N,T> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
     for(IndexSpaceIterator<N,T> it(inst_space); it.valid; it.step()) {
@@ -147,7 +147,7 @@ namespace Realm {
   void PreimageMicroOp<N,T,N2,T2>::populate_bitmasks_ranges(std::map<int, BM *>& bitmasks)
   {
     // for now, one access for the whole instance
-    AffineAccessor<Rect<N2,T2>,N,T> a_data(inst, field_offset);
+    HostAffineAccessor<Rect<N2,T2>,N,T> a_data(inst, field_offset);
 
     // double iteration - use the instance's space first, since it's probably smaller
     for(IndexSpaceIterator<N,T> it(inst_space); it.valid; it.step()) {
@@ -169,10 +169,10 @@ namespace Realm {
   }
 
   template <int N, typename T, int N2, typename T2>
-  void PreimageMicroOp<N,T,N2,T2>::execute(void)
+  template <typename BM>
+  void PreimageMicroOp<N,T,N2,T2>::compute_sparsity_outputs(void)
   {
-    TimeStamp ts("PreimageMicroOp::execute", true, &log_uop_timing);
-    std::map<int, DenseRectangleList<N,T> *> rect_map;
+    std::map<int, BM *> rect_map;
 
     if(is_ranged)
       populate_bitmasks_ranges(rect_map);
@@ -181,10 +181,10 @@ namespace Realm {
 
 #ifdef DEBUG_PARTITIONING
     std::cout << rect_map.size() << " non-empty preimages present in instance " << inst << std::endl;
-    for(typename std::map<int, DenseRectangleList<N,T> *>::const_iterator it = rect_map.begin();
+    for(typename std::map<int, BM *>::const_iterator it = rect_map.begin();
 	it != rect_map.end();
 	it++)
-      std::cout << "  " << targets[it->first] << " = " << it->second->rects.size() << " rectangles" << std::endl;
+      std::cout << "  " << targets[it->first] << " = " << it->second->convert_to_vector().size() << " rectangles" << std::endl;
 #endif
 
     // iterate over sparsity outputs and contribute to all (even if we didn't have any
@@ -192,9 +192,9 @@ namespace Realm {
     int empty_count = 0;
     for(size_t i = 0; i < sparsity_outputs.size(); i++) {
       SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(sparsity_outputs[i]);
-      typename std::map<int, DenseRectangleList<N,T> *>::const_iterator it2 = rect_map.find(i);
+      typename std::map<int, BM *>::const_iterator it2 = rect_map.find(i);
       if(it2 != rect_map.end()) {
-	impl->contribute_dense_rect_list(it2->second->rects);
+	impl->contribute_dense_rect_list(it2->second->convert_to_vector());
 	delete it2->second;
       } else {
 	impl->contribute_nothing();
@@ -205,6 +205,19 @@ namespace Realm {
       log_part.info() << empty_count << " empty preimages (out of " << sparsity_outputs.size() << ")";
   }
 
+  template <int N, typename T, int N2, typename T2>
+  void PreimageMicroOp<N,T,N2,T2>::execute(void)
+  {
+    TimeStamp ts("PreimageMicroOp::execute", true, &log_uop_timing);
+
+    // preimages of large instances can be heavily fragmented, which the bulk
+    //  builder handles in (near) linear time
+    if(inst_space.bounds.volume() >= DeppartConfig::cfg_bulk_rects_min_points)
+      compute_sparsity_outputs<BulkRectangleBuilder<N,T> >();
+    else
+      compute_sparsity_outputs<DenseRectangleList<N,T> >();
+  }
+
   template <int N, typename T, int N2, typename T2>
   void PreimageMicroOp<N,T,N2,T2>::dispatch(PartitioningOperation *op, bool inline_ok)
   {
@@ -390,36 +403,98 @@ namespace Realm {
 
       uop->dispatch(this, true /* ok to run in this thread */);
     } else {
+      // every target overlaps every instance, and large instances are split
+      //  into pieces that each contribute
+      std::set<int> all_targets;
+      for(size_t j = 0; j < targets.size(); j++)
+	all_targets.insert(j);
+      contrib_counts.resize(preimages.size(), 0);
+
+      for(size_t i = 0; i < ptr_data.size(); i++)
+	dispatch_overlapping_uops(ptr_data[i].index_space,
+				  ptr_data[i].inst,
+				  ptr_data[i].field_offset,
+				  false /*ptrs*/, all_targets,
+				  true /* ok to run in this thread */);
+
+      for(size_t i = 0; i < range_data.size(); i++)
+	dispatch_overlapping_uops(range_data[i].index_space,
+				  range_data[i].inst,
+				  range_data[i].field_offset,
+				  true /*ranges*/, all_targets,
+				  true /* ok to run in this thread */);
+
       for(size_t i = 0; i < preimages.size(); i++)
-	SparsityMapImpl<N,T>::lookup(preimages[i])->set_contributor_count(ptr_data.size() +
-									  range_data.size());
+	SparsityMapImpl<N,T>::lookup(preimages[i])->set_contributor_count(contrib_counts[i]);
+    }
+  }
 
-      for(size_t i = 0; i < ptr_data.size(); i++) {
-	PreimageMicroOp<N,T,N2,T2> *uop = new PreimageMicroOp<N,T,N2,T2>(parent,
-									 ptr_data[i].index_space,
-									 ptr_data[i].inst,
-									 ptr_data[i].field_offset,
-									 false /*ptrs*/);
-	for(size_t j = 0; j < targets.size(); j++)
-	  uop->add_sparsity_output(targets[j], preimages[j]);
-	uop->dispatch(this, true /* ok to run in this thread */);
-      }
+  template <int N, typename T, int N2, typename T2>
+  void PreimageOperation<N,T,N2,T2>::dispatch_overlapping_uops(const IndexSpace<N,T>& space,
+							       RegionInstance inst,
+							       size_t field_offset,
+							       bool is_ranged,
+							       const std::set<int>& overlaps,
+							       bool inline_ok)
+  {
+    std::vector<IndexSpace<N,T> > pieces;
+    split_for_parallel_uops(space, pieces);
 
-      for(size_t i = 0; i < range_data.size(); i++) {
-	PreimageMicroOp<N,T,N2,T2> *uop = new PreimageMicroOp<N,T,N2,T2>(parent,
-									 range_data[i].index_space,
-									 range_data[i].inst,
-									 range_data[i].field_offset,
-									 true /*ranges*/);
-	for(size_t j = 0; j < targets.size(); j++)
-	  uop->add_sparsity_output(targets[j], preimages[j]);
-	uop->dispatch(this, true /* ok to run in this thread */);
+    // the counts have to include every piece before any of them is dispatched
+    for(std::set<int>::const_iterator it = overlaps.begin();
+	it != overlaps.end();
+	it++)
+      __sync_fetch_and_add(&contrib_counts[*it], (int)pieces.size());
+
+    for(size_t k = 0; k < pieces.size(); k++) {
+      PreimageMicroOp<N,T,N2,T2> *uop = new PreimageMicroOp<N,T,N2,T2>(parent,
+								       pieces[k],
+								       inst,
+								       field_offset,
+								       is_ranged);
+      for(std::set<int>::const_iterator it = overlaps.begin();
+	  it != overlaps.end();
+	  it++)
+	uop->add_sparsity_output(targets[*it], preimages[*it]);
+      uop->dispatch(this, inline_ok);
+    }
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void PreimageOperation<N,T,N2,T2>::prune_overlaps(const ApproxImageFilter<N2,T2>& filter,
+						    std::set<int>& overlaps)
+  {
+    if(!filter.is_useful())
+      return;
+
+    size_t pruned = 0;
+    std::set<int>::iterator it = overlaps.begin();
+    while(it != overlaps.end()) {
+      const IndexSpace<N2,T2>& target = targets[*it];
+      bool hit = false;
+      if(target.dense()) {
+	hit = filter.may_overlap(target.bounds);
+      } else {
+	// the overlap tester already made the approximate data valid
+	SparsityMapImpl<N2,T2> *impl = SparsityMapImpl<N2,T2>::lookup(target.sparsity);
+	const std::vector<Rect<N2,T2> >& approx_rects = impl->get_approx_rects();
+	for(size_t i = 0; (i < approx_rects.size()) && !hit; i++)
+	  hit = filter.may_overlap(target.bounds.intersection(approx_rects[i]));
+      }
+      if(hit) {
+	++it;
+      } else {
+	overlaps.erase(it++);
+	pruned++;
       }
     }
+    if(pruned > 0)
+      log_part.info() << "approx image filter pruned " << pruned << " targets";
   }
 
   template <int N, typename T, int N2, typename T2>
-  void PreimageOperation<N,T,N2,T2>::provide_sparse_image(int index, const Rect<N2,T2> *rects, size_t count)
+  void PreimageOperation<N,T,N2,T2>::provide_sparse_image(int index, const Rect<N2,T2> *rects, size_t count,
+							  const ApproxImageFilter<N2,T2>& filter)
   {
     // atomically check the overlap tester's readiness and queue us if not
     bool tester_ready = false;
@@ -430,6 +505,7 @@ namespace Realm {
       } else {
 	std::vector<Rect<N2,T2> >& r = pending_sparse_images[index];
 	r.insert(r.end(), rects, rects + count);
+	pending_filters[index] = filter;
       }
     }
 
@@ -437,38 +513,23 @@ namespace Realm {
       // see which of the targets this image overlaps
       std::set<int> overlaps;
       overlap_tester->test_overlap(rects, count, overlaps);
+      prune_overlaps(filter, overlaps);
       if((size_t)index < ptr_data.size()) {
 	log_part.info() << "image of ptr_data[" << index << "] overlaps " << overlaps.size() << " targets";
-	PreimageMicroOp<N,T,N2,T2> *uop = new PreimageMicroOp<N,T,N2,T2>(parent,
-									 ptr_data[index].index_space,
-									 ptr_data[index].inst,
-									 ptr_data[index].field_offset,
-									 false /*ptrs*/);
-	for(std::set<int>::const_iterator it2 = overlaps.begin();
-	    it2 != overlaps.end();
-	    it2++) {
-	  int j = *it2;
-	  __sync_fetch_and_add(&contrib_counts[j], 1);
-	  uop->add_sparsity_output(targets[j], preimages[j]);
-	}
-	uop->dispatch(this, false /* do not run in this thread */);
+	dispatch_overlapping_uops(ptr_data[index].index_space,
+				  ptr_data[index].inst,
+				  ptr_data[index].field_offset,
+				  false /*ptrs*/, overlaps,
+				  false /* do not run in this thread */);
       } else {
 	size_t rel_index = index - ptr_data.size();
 	assert(rel_index < range_data.size());
 	log_part.info() << "image of range_data[" << rel_index << "] overlaps " << overlaps.size() << " targets";
-	PreimageMicroOp<N,T,N2,T2> *uop = new PreimageMicroOp<N,T,N2,T2>(parent,
-									 range_data[rel_index].index_space,
-									 range_data[rel_index].inst,
-									 range_data[rel_index].field_offset,
-									 true /*ranges*/);
-	for(std::set<int>::const_iterator it2 = overlaps.begin();
-	    it2 != overlaps.end();
-	    it2++) {
-	  int j = *it2;
-	  __sync_fetch_and_add(&contrib_counts[j], 1);
-	  uop->add_sparsity_output(targets[j], preimages[j]);
-	}
-	uop->dispatch(this, false /* do not run in this thread */);
+	dispatch_overlapping_uops(range_data[rel_index].index_space,
+				  range_data[rel_index].inst,
+				  range_data[rel_index].field_offset,
+				  true /*ranges*/, overlaps,
+				  false /* do not run in this thread */);
       }
 
       // if these were the last sparse images, we can now set the contributor counts
@@ -488,11 +549,13 @@ namespace Realm {
   {
     // atomically set the overlap tester and see if there are any pending entries
     std::map<int, std::vector<Rect<N2,T2> > > pending;
+    std::map<int, ApproxImageFilter<N2,T2> > filters;
     {
       AutoHSLLock al(mutex);
       assert(overlap_tester == 0);
       overlap_tester = static_cast<OverlapTester<N2,T2> *>(tester);
       pending.swap(pending_sparse_images);
+      filters.swap(pending_filters);
     }
 
     // now issue work for any sparse images we got before the tester was ready
@@ -505,38 +568,23 @@ namespace Realm {
 	// see which of the targets that image overlaps
 	std::set<int> overlaps;
 	overlap_tester->test_overlap(&it->second[0], it->second.size(), overlaps);
+	prune_overlaps(filters[it->first], overlaps);
 	if(idx < ptr_data.size()) {
 	  log_part.info() << "image of ptr_data[" << idx << "] overlaps " << overlaps.size() << " targets";
-	  PreimageMicroOp<N,T,N2,T2> *uop = new PreimageMicroOp<N,T,N2,T2>(parent,
-									   ptr_data[idx].index_space,
-									   ptr_data[idx].inst,
-									   ptr_data[idx].field_offset,
-									   false /*ptrs*/);
-	  for(std::set<int>::const_iterator it2 = overlaps.begin();
-	      it2 != overlaps.end();
-	      it2++) {
-	    int j = *it2;
-	    __sync_fetch_and_add(&contrib_counts[j], 1);
-	    uop->add_sparsity_output(targets[j], preimages[j]);
-	  }
-	  uop->dispatch(this, true /* ok to run in this thread */);
+	  dispatch_overlapping_uops(ptr_data[idx].index_space,
+				    ptr_data[idx].inst,
+				    ptr_data[idx].field_offset,
+				    false /*ptrs*/, overlaps,
+				    true /* ok to run in this thread */);
 	} else {
 	  size_t rel_index = idx - ptr_data.size();
 	  assert(rel_index < range_data.size());
 	  log_part.info() << "image of range_data[" << rel_index << "] overlaps " << overlaps.size() << " targets";
-	  PreimageMicroOp<N,T,N2,T2> *uop = new PreimageMicroOp<N,T,N2,T2>(parent,
-									   range_data[rel_index].index_space,
-									   range_data[rel_index].inst,
-									   range_data[rel_index].field_offset,
-									   true /*ranges*/);
-	  for(std::set<int>::const_iterator it2 = overlaps.begin();
-	      it2 != overlaps.end();
-	      it2++) {
-	    int j = *it2;
-	    __sync_fetch_and_add(&contrib_counts[j], 1);
-	    uop->add_sparsity_output(targets[j], preimages[j]);
-	  }
-	  uop->dispatch(this, true /* ok to run in this thread */);
+	  dispatch_overlapping_uops(range_data[rel_index].index_space,
+				    range_data[rel_index].inst,
+				    range_data[rel_index].field_offset,
+				    true /*ranges*/, overlaps,
+				    true /* ok to run in this thread */);
 	}
       }
 
@@ -568,9 +616,14 @@ namespace Realm {
 									 const void *data, size_t datalen)
   {
     PreimageOperation<NT::N,T,N2T::N,T2> *op = reinterpret_cast<PreimageOperation<NT::N,T,N2T::N,T2> *>(args->approx_output_op);
+    size_t rect_bytes = args->num_rects * sizeof(Rect<N2T::N,T2>);
+    assert(rect_bytes <= datalen);
+    ApproxImageFilter<N2T::N,T2> filter;
+    filter.deserialize(static_cast<const char *>(data) + rect_bytes,
+		       datalen - rect_bytes);
     op->provide_sparse_image(args->approx_output_index,
 			     static_cast<const Rect<N2T::N,T2> *>(data),
-			     datalen / sizeof(Rect<N2T::N,T2>));
+			     args->num_rects, filter);
   }
 
   /*static*/ void ApproxImageResponseMessage::handle_request(RequestArgs args,
@@ -19,6 +19,7 @@
 #define REALM_DEPPART_PREIMAGE_H
 
 #include "realm/deppart/partitions.h"
+#include "realm/deppart/rectlist.h"
 
 namespace Realm {
 
@@ -59,6 +60,11 @@ namespace Realm {
     template <typename BM>
     void populate_bitmasks_ranges(std::map<int, BM *>& bitmasks);
 
+    // fills in and contributes to the sparsity outputs using the given kind
+    //  of rectangle list
+    template <typename BM>
+    void compute_sparsity_outputs(void);
+
     IndexSpace<N,T> parent_space, inst_space;
     RegionInstance inst;
     size_t field_offset;
@@ -90,9 +96,22 @@ namespace Realm {
 
     virtual void set_overlap_tester(void *tester);
 
-    void provide_sparse_image(int index, const Rect<N2,T2> *rects, size_t count);
+    void provide_sparse_image(int index, const Rect<N2,T2> *rects, size_t count,
+			      const ApproxImageFilter<N2,T2>& filter);
 
   protected:
+    // splits the field data's index space (see split_for_parallel_uops) and
+    //  dispatches a micro op for each piece that contributes to the
+    //  preimages of the given targets, counting each piece in contrib_counts
+    void dispatch_overlapping_uops(const IndexSpace<N,T>& space,
+				   RegionInstance inst, size_t field_offset,
+				   bool is_ranged, const std::set<int>& overlaps,
+				   bool inline_ok);
+
+    // removes targets from 'overlaps' that the filter shows cannot
+    //  intersect the image
+    void prune_overlaps(const ApproxImageFilter<N2,T2>& filter, std::set<int>& overlaps);
+
     IndexSpace<N,T> parent;
     std::vector<FieldDataDescriptor<IndexSpace<N,T>,Point<N2,T2> > > ptr_data;
     std::vector<FieldDataDescriptor<IndexSpace<N,T>,Rect<N2,T2> > > range_data;
@@ -101,6 +120,7 @@ namespace Realm {
     GASNetHSL mutex;
     OverlapTester<N2,T2> *overlap_tester;
     std::map<int, std::vector<Rect<N2,T2> > > pending_sparse_images;
+    std::map<int, ApproxImageFilter<N2,T2> > pending_filters;
     int remaining_sparse_images;
     std::vector<int> contrib_counts;
     AsyncMicroOp *dummy_overlap_uop;
@@ -111,6 +131,7 @@ namespace Realm {
       DynamicTemplates::TagType type_tag;
       intptr_t approx_output_op;
       int approx_output_index;
+      int num_rects;  // rects are followed by a serialized ApproxImageFilter
     };
 
     struct DecodeHelper {
@@ -126,21 +147,30 @@ namespace Realm {
 
     template <int N, typename T, int N2, typename T2>
     static void send_request(NodeID target, intptr_t output_op, int output_index,
-			     const Rect<N2,T2> *rects, size_t count);
+			     const Rect<N2,T2> *rects, size_t count,
+			     const ApproxImageFilter<N2,T2>& filter);
   };
 
   template <int N, typename T, int N2, typename T2>
   /*static*/ void ApproxImageResponseMessage::send_request(NodeID target, 
 							   intptr_t output_op, int output_index,
-							   const Rect<N2,T2> *rects, size_t count)
+							   const Rect<N2,T2> *rects, size_t count,
+							   const ApproxImageFilter<N2,T2>& filter)
   {
     RequestArgs args;
 
     args.type_tag = NTNT_TemplateHelper::encode_tag<N,T,N2,T2>();
     args.approx_output_op = output_op;
     args.approx_output_index = output_index;
+    args.num_rects = count;
+
+    size_t rect_bytes = count * sizeof(Rect<N2,T2>);
+    std::vector<char> payload(rect_bytes + filter.serialized_size());
+    if(rect_bytes > 0)
+      memcpy(&payload[0], rects, rect_bytes);
+    filter.serialize(&payload[rect_bytes]);
 
-    Message::request(target, args, rects, count * sizeof(Rect<N2,T2>), PAYLOAD_COPY);
+    Message::request(target, args, &payload[0], payload.size(), PAYLOAD_COPY);
   }
     
 };
@@ -53,6 +53,8 @@ namespace Realm {
 
     void merge_rects(size_t upper_bound);
 
+    const std::vector<Rect<N,T> >& convert_to_vector(void) const { return rects; }
+
     std::vector<Rect<N,T> > rects;
     size_t max_rects;
   };
@@ -82,6 +84,83 @@ namespace Realm {
   template <int N, typename T>
   std::ostream& operator<<(std::ostream& os, const HybridRectangleList<N,T>& hrl);
 
+  // the BulkRectangleBuilder is for outputs that are expected to be large and
+  //  badly ordered (e.g. images on unstructured meshes) - rather than merging
+  //  each new rectangle into a sorted list, inputs are appended to a flat
+  //  array that is periodically radix sorted and coalesced in a single linear
+  //  pass (memory stays proportional to the coalesced output plus one batch)
+  // works best when every input is a strip along x (all points are) - if
+  //  not, it falls back to a DenseRectangleList for everything (still fed in
+  //  sorted order)
+  template <int N, typename T>
+  class BulkRectangleBuilder {
+  public:
+    static const size_t MIN_BATCH_SIZE = 1 << 20;
+
+    BulkRectangleBuilder(void);
+    ~BulkRectangleBuilder(void);
+
+    void add_point(const Point<N,T>& p);
+
+    void add_rect(const Rect<N,T>& r);
+
+    const std::vector<Rect<N,T> >& convert_to_vector(void);
+
+  protected:
+    // not copyable (owns 'fallback')
+    BulkRectangleBuilder(const BulkRectangleBuilder<N,T>& copy_from);
+    BulkRectangleBuilder<N,T>& operator=(const BulkRectangleBuilder<N,T>& copy_from);
+
+    void compact(void);
+
+    std::vector<Rect<N,T> > pending;  // unsorted, not yet coalesced
+    std::vector<Rect<N,T> > rects;    // sorted and coalesced
+    bool all_strips;
+    DenseRectangleList<N,T> *fallback;
+  };
+
+  // an ApproxImageFilter is a Bloom filter over fixed-size cells of a bounding
+  //  box, built alongside an approximate image - it can say for certain that
+  //  a rectangle contains none of the points that were added, with a much
+  //  finer granularity than a short list of approximating rectangles
+  // a filter that has been given too many distinct cells to be useful gives
+  //  up and reports everything as possibly overlapping
+  template <int N, typename T>
+  class ApproxImageFilter {
+  public:
+    static const int NUM_HASHES = 3;
+
+    ApproxImageFilter(void);
+
+    // a filter with no bits (the default) accepts everything
+    void configure(const Rect<N,T>& _bounds, size_t num_bits);
+
+    void add_point(const Point<N,T>& p);
+
+    void add_rect(const Rect<N,T>& r);
+
+    // returns false only if no added point can be in 'r'
+    bool may_overlap(const Rect<N,T>& r) const;
+
+    bool is_useful(void) const { return !saturated && !bits.empty(); }
+
+    // flat representation for sending in messages
+    size_t serialized_size(void) const;
+    void serialize(void *buffer) const;
+    void deserialize(const void *buffer, size_t bytes);
+
+  protected:
+    void add_cell(const Point<N,T>& cell);
+    bool test_cell(const Point<N,T>& cell) const;
+    size_t cell_count(const Rect<N,T>& r) const;
+
+    Rect<N,T> bounds;
+    int cell_shift;
+    size_t cells_added;
+    bool saturated;
+    std::vector<unsigned long long> bits;
+  };
+
 };
 
 #endif // REALM_DEPPART_RECTLIST_H
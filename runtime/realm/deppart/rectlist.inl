@@ -20,6 +20,9 @@
 
 #include "realm/deppart/rectlist.h"
 
+#include <limits>
+#include <string.h>
+
 namespace Realm {
 
   ////////////////////////////////////////////////////////////////////////
@@ -440,6 +443,380 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class BulkRectangleBuilder<N,T>
+
+  // maps a coordinate to an unsigned key with the same ordering
+  template <typename T>
+  inline unsigned long long radix_key(T v)
+  {
+    unsigned long long k = (unsigned long long)v;
+    if(std::numeric_limits<T>::is_signed)
+      k ^= (1ULL << (8 * sizeof(T) - 1));
+    // drop any sign extension
+    return k & (~0ULL >> (8 * (sizeof(unsigned long long) - sizeof(T))));
+  }
+
+  // stable LSD radix sort of rectangles by a list of coordinates, most
+  //  significant first - a key code d < N means lo[d] and N + d means hi[d]
+  // byte positions on which all keys agree are skipped, which is the
+  //  common case for the high bytes of coordinates
+  template <int N, typename T>
+  inline void radix_sort_rects(std::vector<Rect<N,T> >& v,
+			       const int *key_codes, int num_codes)
+  {
+    size_t n = v.size();
+    if(n < 2) return;
+    std::vector<Rect<N,T> > tmp(n);
+    std::vector<unsigned long long> keys(n);
+    for(int c = num_codes - 1; c >= 0; c--) {
+      int code = key_codes[c];
+      for(unsigned b = 0; b < sizeof(T); b++) {
+	for(size_t i = 0; i < n; i++)
+	  keys[i] = radix_key((code < N) ? v[i].lo[code] : v[i].hi[code - N]);
+	size_t counts[256];
+	for(int j = 0; j < 256; j++) counts[j] = 0;
+	for(size_t i = 0; i < n; i++)
+	  counts[(keys[i] >> (8 * b)) & 0xff]++;
+	if(counts[(keys[0] >> (8 * b)) & 0xff] == n)
+	  continue;  // every key has the same byte here
+	size_t total = 0;
+	for(int j = 0; j < 256; j++) {
+	  size_t c2 = counts[j];
+	  counts[j] = total;
+	  total += c2;
+	}
+	for(size_t i = 0; i < n; i++)
+	  tmp[counts[(keys[i] >> (8 * b)) & 0xff]++] = v[i];
+	v.swap(tmp);
+      }
+    }
+  }
+
+  template <int N, typename T>
+  inline BulkRectangleBuilder<N,T>::BulkRectangleBuilder(void)
+    : all_strips(true), fallback(0)
+  {}
+
+  template <int N, typename T>
+  inline BulkRectangleBuilder<N,T>::~BulkRectangleBuilder(void)
+  {
+    delete fallback;
+  }
+
+  template <int N, typename T>
+  inline void BulkRectangleBuilder<N,T>::add_point(const Point<N,T>& p)
+  {
+    pending.push_back(Rect<N,T>(p, p));
+    if(pending.size() >= std::max(rects.size(), (size_t)MIN_BATCH_SIZE))
+      compact();
+  }
+
+  template <int N, typename T>
+  inline void BulkRectangleBuilder<N,T>::add_rect(const Rect<N,T>& r)
+  {
+    if(r.empty()) return;
+    for(int i = 1; i < N; i++)
+      if(r.lo[i] != r.hi[i])
+	all_strips = false;
+    pending.push_back(r);
+    if(pending.size() >= std::max(rects.size(), (size_t)MIN_BATCH_SIZE))
+      compact();
+  }
+
+  template <int N, typename T>
+  inline void BulkRectangleBuilder<N,T>::compact(void)
+  {
+    if(pending.empty()) return;
+
+    // sort by row (all dimensions but x, slowest first) and then by x
+    int row_order[N];
+    for(int i = 0; i < N; i++)
+      row_order[i] = (N - 1 - i);
+    radix_sort_rects(pending, row_order, N);
+
+    if(!all_strips || fallback) {
+      // general rectangles need the full merging logic
+      if(!fallback) {
+	fallback = new DenseRectangleList<N,T>;
+	for(size_t i = 0; i < rects.size(); i++)
+	  fallback->add_rect(rects[i]);
+	rects.clear();
+      }
+      for(size_t i = 0; i < pending.size(); i++)
+	fallback->add_rect(pending[i]);
+      pending.clear();
+      return;
+    }
+
+    // merge the previous output (already in row order) with the new batch,
+    //  coalescing strips in the same row that overlap or touch
+    std::vector<Rect<N,T> > merged;
+    merged.reserve(rects.size() + pending.size());
+    size_t a = 0, b = 0;
+    while((a < rects.size()) || (b < pending.size())) {
+      const Rect<N,T> *next;
+      if(b >= pending.size())
+	next = &rects[a++];
+      else if(a >= rects.size())
+	next = &pending[b++];
+      else {
+	// compare in row order
+	bool take_a = false;
+	bool decided = false;
+	for(int i = N - 1; (i >= 0) && !decided; i--)
+	  if(rects[a].lo[i] != pending[b].lo[i]) {
+	    take_a = (rects[a].lo[i] < pending[b].lo[i]);
+	    decided = true;
+	  }
+	next = (take_a || !decided) ? &rects[a++] : &pending[b++];
+      }
+
+      if(!merged.empty()) {
+	Rect<N,T>& last = merged.back();
+	bool same_row = true;
+	for(int i = 1; i < N; i++)
+	  if(last.lo[i] != next->lo[i]) {
+	    same_row = false;
+	    break;
+	  }
+	if(same_row && (next->lo.x <= (last.hi.x + 1))) {
+	  if(next->hi.x > last.hi.x)
+	    last.hi.x = next->hi.x;
+	  continue;
+	}
+      }
+      merged.push_back(*next);
+    }
+    rects.swap(merged);
+    pending.clear();
+  }
+
+  template <int N, typename T>
+  inline const std::vector<Rect<N,T> >& BulkRectangleBuilder<N,T>::convert_to_vector(void)
+  {
+    compact();
+
+    if(fallback) {
+      rects.swap(fallback->rects);
+      delete fallback;
+      fallback = 0;
+      all_strips = false;
+      return rects;
+    }
+
+    // for N > 1, the strips can also be stacked along the second dimension
+    //  when consecutive rows have identical extents in everything else - sort
+    //  so that such strips are adjacent and do one more linear pass
+    if((N > 1) && (rects.size() > 1)) {
+      int stack_order[2 * N];
+      int k = 0;
+      for(int i = N - 1; i >= 2; i--)
+	stack_order[k++] = i;
+      stack_order[k++] = 0;      // lo.x
+      stack_order[k++] = N + 0;  // hi.x
+      stack_order[k++] = 1;      // then the row being stacked
+      radix_sort_rects(rects, stack_order, k);
+
+      size_t out = 0;
+      for(size_t i = 1; i < rects.size(); i++) {
+	Rect<N,T>& last = rects[out];
+	const Rect<N,T>& r = rects[i];
+	bool stackable = ((last.lo.x == r.lo.x) && (last.hi.x == r.hi.x) &&
+			  ((last.hi[1] + 1) == r.lo[1]));
+	for(int j = 2; (j < N) && stackable; j++)
+	  if((last.lo[j] != r.lo[j]) || (last.hi[j] != r.hi[j]))
+	    stackable = false;
+	if(stackable)
+	  last.hi[1] = r.hi[1];
+	else
+	  rects[++out] = r;
+      }
+      rects.resize(out + 1);
+    }
+
+    return rects;
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class ApproxImageFilter<N,T>
+
+  template <int N, typename T>
+  inline ApproxImageFilter<N,T>::ApproxImageFilter(void)
+    : cell_shift(0), cells_added(0), saturated(false)
+  {}
+
+  template <int N, typename T>
+  inline size_t ApproxImageFilter<N,T>::cell_count(const Rect<N,T>& r) const
+  {
+    size_t count = 1;
+    for(int i = 0; i < N; i++)
+      count *= size_t((r.hi[i] >> cell_shift) - (r.lo[i] >> cell_shift)) + 1;
+    return count;
+  }
+
+  template <int N, typename T>
+  inline void ApproxImageFilter<N,T>::configure(const Rect<N,T>& _bounds, size_t num_bits)
+  {
+    bounds = _bounds;
+    cells_added = 0;
+    saturated = false;
+    bits.clear();
+    if(bounds.empty() || (num_bits == 0))
+      return;
+
+    // pick the smallest cells that keep the number of cells in the bounds
+    //  to a quarter of the number of bits
+    size_t max_cells = std::max(num_bits >> 2, size_t(1));
+    cell_shift = 0;
+    while((cell_count(bounds) > max_cells) && (cell_shift < int(8 * sizeof(T)) - 1))
+      cell_shift++;
+
+    bits.resize((num_bits + 63) >> 6, 0);
+  }
+
+  // a cheap 64-bit mix (from splitmix64)
+  static inline unsigned long long approx_filter_mix(unsigned long long x)
+  {
+    x += 0x9e3779b97f4a7c15ULL;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+  }
+
+  template <int N, typename T>
+  inline void ApproxImageFilter<N,T>::add_cell(const Point<N,T>& cell)
+  {
+    unsigned long long h = 0;
+    for(int i = 0; i < N; i++)
+      h = approx_filter_mix(h ^ (unsigned long long)(long long)cell[i]);
+    unsigned long long h2 = approx_filter_mix(h) | 1;
+    size_t nbits = bits.size() << 6;
+    bool changed = false;
+    for(int k = 0; k < NUM_HASHES; k++) {
+      size_t b = (h + k * h2) % nbits;
+      unsigned long long mask = 1ULL << (b & 63);
+      if((bits[b >> 6] & mask) == 0) {
+	bits[b >> 6] |= mask;
+	changed = true;
+      }
+    }
+    // once the number of distinct cells reaches half the number of bits, the
+    //  false positive rate is high enough that the filter isn't worth sending
+    if(changed && (++cells_added > (nbits >> 1)))
+      saturated = true;
+  }
+
+  template <int N, typename T>
+  inline bool ApproxImageFilter<N,T>::test_cell(const Point<N,T>& cell) const
+  {
+    unsigned long long h = 0;
+    for(int i = 0; i < N; i++)
+      h = approx_filter_mix(h ^ (unsigned long long)(long long)cell[i]);
+    unsigned long long h2 = approx_filter_mix(h) | 1;
+    size_t nbits = bits.size() << 6;
+    for(int k = 0; k < NUM_HASHES; k++) {
+      size_t b = (h + k * h2) % nbits;
+      if(((bits[b >> 6] >> (b & 63)) & 1) == 0)
+	return false;
+    }
+    return true;
+  }
+
+  template <int N, typename T>
+  inline void ApproxImageFilter<N,T>::add_point(const Point<N,T>& p)
+  {
+    if(!is_useful() || !bounds.contains(p))
+      return;
+    Point<N,T> cell;
+    for(int i = 0; i < N; i++)
+      cell[i] = p[i] >> cell_shift;
+    add_cell(cell);
+  }
+
+  template <int N, typename T>
+  inline void ApproxImageFilter<N,T>::add_rect(const Rect<N,T>& r)
+  {
+    if(!is_useful())
+      return;
+    Rect<N,T> clipped = bounds.intersection(r);
+    if(clipped.empty())
+      return;
+    Rect<N,T> cells;
+    for(int i = 0; i < N; i++) {
+      cells.lo[i] = clipped.lo[i] >> cell_shift;
+      cells.hi[i] = clipped.hi[i] >> cell_shift;
+    }
+    for(PointInRectIterator<N,T> pir(cells); pir.valid && !saturated; pir.step())
+      add_cell(pir.p);
+  }
+
+  template <int N, typename T>
+  inline bool ApproxImageFilter<N,T>::may_overlap(const Rect<N,T>& r) const
+  {
+    if(!is_useful())
+      return true;
+    Rect<N,T> clipped = bounds.intersection(r);
+    if(clipped.empty())
+      return false;
+    Rect<N,T> cells;
+    for(int i = 0; i < N; i++) {
+      cells.lo[i] = clipped.lo[i] >> cell_shift;
+      cells.hi[i] = clipped.hi[i] >> cell_shift;
+    }
+    for(PointInRectIterator<N,T> pir(cells); pir.valid; pir.step())
+      if(test_cell(pir.p))
+	return true;
+    return false;
+  }
+
+  // serialized form is the bounds, the cell shift, and then the bits (if the
+  //  filter is useful) - an empty buffer is a filter that accepts everything
+  template <int N, typename T>
+  inline size_t ApproxImageFilter<N,T>::serialized_size(void) const
+  {
+    if(!is_useful())
+      return 0;
+    return (sizeof(Rect<N,T>) + sizeof(int) +
+	    (bits.size() * sizeof(unsigned long long)));
+  }
+
+  template <int N, typename T>
+  inline void ApproxImageFilter<N,T>::serialize(void *buffer) const
+  {
+    if(!is_useful())
+      return;
+    char *pos = static_cast<char *>(buffer);
+    memcpy(pos, &bounds, sizeof(Rect<N,T>));
+    pos += sizeof(Rect<N,T>);
+    memcpy(pos, &cell_shift, sizeof(int));
+    pos += sizeof(int);
+    memcpy(pos, &bits[0], bits.size() * sizeof(unsigned long long));
+  }
+
+  template <int N, typename T>
+  inline void ApproxImageFilter<N,T>::deserialize(const void *buffer, size_t bytes)
+  {
+    bits.clear();
+    saturated = false;
+    cells_added = 0;
+    if(bytes == 0)
+      return;
+    const char *pos = static_cast<const char *>(buffer);
+    assert(bytes > (sizeof(Rect<N,T>) + sizeof(int)));
+    memcpy(&bounds, pos, sizeof(Rect<N,T>));
+    pos += sizeof(Rect<N,T>);
+    memcpy(&cell_shift, pos, sizeof(int));
+    pos += sizeof(int);
+    size_t nwords = (bytes - sizeof(Rect<N,T>) - sizeof(int)) / sizeof(unsigned long long);
+    bits.resize(nwords);
+    memcpy(&bits[0], pos, nwords * sizeof(unsigned long long));
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class HybridRectangleList<1,T>
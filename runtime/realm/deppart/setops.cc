@@ -977,18 +977,9 @@ namespace Realm {
       if(it->dense()) {
 	bitmask.add_rect(it->bounds);
       } else {
-	SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(it->sparsity);
-	const std::vector<SparsityMapEntry<N,T> >& entries = impl->get_entries();
-	for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it2 = entries.begin();
-	    it2 != entries.end();
-	    it2++) {
-	  Rect<N,T> isect = it->bounds.intersection(it2->bounds);
-	  if(isect.empty())
-	    continue;
-	  assert(!it2->sparsity.exists());
-	  assert(it2->bitmap == 0);
-	  bitmask.add_rect(isect);
-	}
+	// the iterator takes care of bitmap-based sparsity maps
+	for(IndexSpaceIterator<N,T> it2(*it); it2.valid; it2.step())
+	  bitmask.add_rect(it2.rect);
       }
     }
   }
@@ -1355,18 +1346,8 @@ namespace Realm {
     if(lhs.dense()) {
       todo.push_back(lhs.bounds);
     } else {
-      SparsityMapImpl<N,T> *l_impl = SparsityMapImpl<N,T>::lookup(lhs.sparsity);
-      const std::vector<SparsityMapEntry<N,T> >& entries = l_impl->get_entries();
-      for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = entries.begin();
-	  it != entries.end();
-	  it++) {
-	Rect<N,T> isect = lhs.bounds.intersection(it->bounds);
-	if(isect.empty())
-	  continue;
-	assert(!it->sparsity.exists());
-	assert(it->bitmap == 0);
-	todo.push_back(isect);
-      }
+      for(IndexSpaceIterator<N,T> it(lhs); it.valid; it.step())
+	todo.push_back(it.rect);
     }
 
     while(!todo.empty()) {
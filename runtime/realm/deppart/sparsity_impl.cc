@@ -170,12 +170,24 @@ namespace Realm {
   //
   // class SparsityMapImpl<N,T>
 
+  // orders rectangles by their lower bound in a given dimension
+  template <int N, typename T>
+  struct RectLoCompare {
+    RectLoCompare(int _dim) : dim(_dim) {}
+    bool operator()(const Rect<N,T>& lhs, const Rect<N,T>& rhs) const
+    {
+      return lhs.lo[dim] < rhs.lo[dim];
+    }
+    int dim;
+  };
+
   template <int N, typename T>
   SparsityMapImpl<N,T>::SparsityMapImpl(SparsityMap<N,T> _me)
     : me(_me), remaining_contributor_count(0)
     , precise_requested(false), approx_requested(false)
     , precise_ready_event(Event::NO_EVENT), approx_ready_event(Event::NO_EVENT)
     , sizeof_precise(0)
+    , chunk_directory_valid(false)
   {}
 
   template <int N, typename T>
@@ -336,7 +348,7 @@ namespace Realm {
 	    this->entries.resize(n + count - 1);
 	    assert(!this->entries[n - 1].sparsity.exists());
 	    assert(this->entries[n - 1].bitmap == 0);
-	    this->entries[n - 1].bounds.hi = rects[0].lo;
+	    this->entries[n - 1].bounds.hi = rects[0].hi;
 	    for(size_t i = 1; i < count; i++) {
 	      this->entries[n - 1 + i].bounds = rects[i];
 	      this->entries[n - 1 + i].sparsity.id = 0; // no sparsity map
@@ -583,8 +595,13 @@ namespace Realm {
 	  it != this->entries.end();
 	  it++) {
 	if(it->bitmap) {
-	  // TODO: send bitmap
-	  assert(0);
+	  // bitmaps are sent as their runs - the receiver decides for itself
+	  //  whether to rebuild a bitmap
+	  Rect<N,T> run;
+	  for(bool ok = it->bitmap->next_run(it->bounds, run, true /*first*/);
+	      ok;
+	      ok = it->bitmap->next_run(it->bounds, run, false /*!first*/))
+	    rects.push_back(run);
 	}
 	else if(it->sparsity.exists()) {
 	  // TODO: ?
@@ -594,9 +611,47 @@ namespace Realm {
 	}
       }
 	
-      const Rect<N,T> *rdata = &rects[0];
-      size_t remaining = rects.size();
       const size_t max_to_send = DeppartConfig::cfg_max_bytes_per_packet / sizeof(Rect<N,T>);
+      size_t num_chunks = (rects.size() + max_to_send - 1) / max_to_send;
+
+      if((num_chunks > 1) && (num_chunks <= max_to_send)) {
+	// send a directory of chunk bounds followed by the chunks themselves,
+	//  each of which can be used on its own - in 1-D the entries are
+	//  already sorted, otherwise sort along the widest dimension so that
+	//  each chunk's bounds are reasonably tight
+	if(N > 1) {
+	  Rect<N,T> bbox = rects[0];
+	  for(size_t i = 1; i < rects.size(); i++)
+	    bbox = bbox.union_bbox(rects[i]);
+	  int dim = 0;
+	  for(int i = 1; i < N; i++)
+	    if((bbox.hi[i] - bbox.lo[i]) > (bbox.hi[dim] - bbox.lo[dim]))
+	      dim = i;
+	  std::sort(rects.begin(), rects.end(), RectLoCompare<N,T>(dim));
+	}
+
+	std::vector<Rect<N,T> > dir(num_chunks);
+	for(size_t i = 0; i < num_chunks; i++) {
+	  size_t first = i * max_to_send;
+	  size_t last = std::min(first + max_to_send, rects.size());
+	  dir[i] = rects[first];
+	  for(size_t j = first + 1; j < last; j++)
+	    dir[i] = dir[i].union_bbox(rects[j]);
+	}
+	RemoteSparsityContribMessage::send_request<N,T>(requestor, me, seq_id, 1,
+							&dir[0], num_chunks,
+							RemoteSparsityContribMessage::CHUNK_DIRECTORY);
+	for(size_t i = 0; i < num_chunks; i++) {
+	  size_t first = i * max_to_send;
+	  size_t count = std::min(max_to_send, rects.size() - first);
+	  RemoteSparsityContribMessage::send_request<N,T>(requestor, me, seq_id, 1,
+							  &rects[first], count, i);
+	}
+	return;
+      }
+
+      const Rect<N,T> *rdata = (rects.empty() ? 0 : &rects[0]);
+      size_t remaining = rects.size();
       // send partial messages first
       while(remaining > max_to_send) {
 	RemoteSparsityContribMessage::send_request<N,T>(requestor, me, seq_id, 0,
@@ -611,7 +666,213 @@ namespace Realm {
 						      rdata, remaining);
     }
   }
-  
+
+  template <int N, typename T>
+  Event SparsityMapImpl<N,T>::make_valid_subset(const Rect<N,T>& subset)
+  {
+    // maps we own are either complete or not
+    if(this->entries_valid || (ID(me).sparsity.creator_node == my_node_id))
+      return make_valid(true /*precise*/);
+
+    bool request_precise = false;
+    Event e = Event::NO_EVENT;
+    {
+      AutoHSLLock al(mutex);
+
+      if(this->entries_valid || subset_arrived(subset))
+	return Event::NO_EVENT;
+
+      if(!precise_requested) {
+	request_precise = true;
+	precise_requested = true;
+      }
+      e = GenEventImpl::create_genevent()->current_event();
+      subset_waiters.push_back(std::make_pair(subset, e));
+    }
+
+    if(request_precise)
+      RemoteSparsityRequestMessage::send_request(ID(me).sparsity.creator_node, me,
+						 false /*!approx*/,
+						 true /*precise*/);
+
+    return e;
+  }
+
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::get_entries_subset(const Rect<N,T>& subset,
+						std::vector<Rect<N,T> >& rects)
+  {
+    if(!this->entries_valid) {
+      // wait (if needed) for the pieces we care about
+      Event e = make_valid_subset(subset);
+      if(e.exists())
+	e.wait();
+    }
+
+    if(!this->entries_valid) {
+      AutoHSLLock al(mutex);
+
+      if(!this->entries_valid) {
+	assert(subset_arrived(subset));
+	for(typename std::map<int, std::vector<Rect<N,T> > >::const_iterator it = arrived_chunks.begin();
+	    it != arrived_chunks.end();
+	    it++) {
+	  if(!chunk_bounds[it->first].overlaps(subset))
+	    continue;
+	  for(typename std::vector<Rect<N,T> >::const_iterator it2 = it->second.begin();
+	      it2 != it->second.end();
+	      it2++) {
+	    Rect<N,T> isect = it2->intersection(subset);
+	    if(!isect.empty())
+	      rects.push_back(isect);
+	  }
+	}
+	// 1-D users expect sorted rectangles
+	if(N == 1)
+	  std::sort(rects.begin(), rects.end(), RectLoCompare<N,T>(0));
+	return;
+      }
+    }
+
+    // entries are valid and immutable, so no lock needed
+    for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = this->entries.begin();
+	it != this->entries.end();
+	it++) {
+      Rect<N,T> isect = it->bounds.intersection(subset);
+      if(isect.empty())
+	continue;
+      assert(!it->sparsity.exists());
+      if(it->bitmap) {
+	Rect<N,T> run;
+	for(bool ok = it->bitmap->next_run(isect, run, true /*first*/);
+	    ok;
+	    ok = it->bitmap->next_run(isect, run, false /*!first*/))
+	  rects.push_back(run);
+      } else
+	rects.push_back(isect);
+    }
+  }
+
+  template <int N, typename T>
+  bool SparsityMapImpl<N,T>::subset_arrived(const Rect<N,T>& subset) const
+  {
+    if(!chunk_directory_valid)
+      return false;
+    for(size_t i = 0; i < chunk_bounds.size(); i++)
+      if(chunk_bounds[i].overlaps(subset) &&
+	 (arrived_chunks.count(i) == 0))
+	return false;
+    return true;
+  }
+
+  template <int N, typename T>
+  bool SparsityMapImpl<N,T>::all_chunks_arrived(void) const
+  {
+    return (chunk_directory_valid &&
+	    (arrived_chunks.size() == chunk_bounds.size()));
+  }
+
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::collect_subset_waiters(std::vector<Event>& to_trigger,
+						    bool all)
+  {
+    size_t i = 0;
+    while(i < subset_waiters.size()) {
+      if(all || subset_arrived(subset_waiters[i].first)) {
+	to_trigger.push_back(subset_waiters[i].second);
+	subset_waiters[i] = subset_waiters.back();
+	subset_waiters.pop_back();
+      } else
+	i++;
+    }
+  }
+
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::receive_chunk_directory(const Rect<N,T> *bounds, size_t count)
+  {
+    std::vector<Event> to_trigger;
+    bool complete;
+    {
+      AutoHSLLock al(mutex);
+
+      assert(!chunk_directory_valid);
+      chunk_bounds.assign(bounds, bounds + count);
+      chunk_directory_valid = true;
+      complete = all_chunks_arrived();
+      if(!complete)
+	collect_subset_waiters(to_trigger, false /*!all*/);
+    }
+
+    if(complete)
+      assemble_chunks();
+
+    for(std::vector<Event>::const_iterator it = to_trigger.begin();
+	it != to_trigger.end();
+	it++)
+      GenEventImpl::trigger(*it, false /*!poisoned*/);
+  }
+
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::receive_chunk(int chunk_index,
+					   const Rect<N,T> *rects, size_t count)
+  {
+    std::vector<Event> to_trigger;
+    bool complete;
+    {
+      AutoHSLLock al(mutex);
+
+      assert(arrived_chunks.count(chunk_index) == 0);
+      arrived_chunks[chunk_index].assign(rects, rects + count);
+      complete = all_chunks_arrived();
+      if(!complete)
+	collect_subset_waiters(to_trigger, false /*!all*/);
+    }
+
+    if(complete)
+      assemble_chunks();
+
+    for(std::vector<Event>::const_iterator it = to_trigger.begin();
+	it != to_trigger.end();
+	it++)
+      GenEventImpl::trigger(*it, false /*!poisoned*/);
+  }
+
+  // once the last chunk arrives, the chunks are concatenated into the entry
+  //  list - the owner's entries were already disjoint (and in 1-D, sorted), so
+  //  no merging is needed
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::assemble_chunks(void)
+  {
+    {
+      AutoHSLLock al(mutex);
+
+      size_t total = 0;
+      for(typename std::map<int, std::vector<Rect<N,T> > >::const_iterator it = arrived_chunks.begin();
+	  it != arrived_chunks.end();
+	  it++)
+	total += it->second.size();
+      this->entries.resize(total);
+      size_t n = 0;
+      for(typename std::map<int, std::vector<Rect<N,T> > >::const_iterator it = arrived_chunks.begin();
+	  it != arrived_chunks.end();
+	  it++)
+	for(typename std::vector<Rect<N,T> >::const_iterator it2 = it->second.begin();
+	    it2 != it->second.end();
+	    it2++) {
+	  this->entries[n].bounds = *it2;
+	  this->entries[n].sparsity.id = 0; // no sparsity map
+	  this->entries[n].bitmap = 0;
+	  n++;
+	}
+      // the chunks are still used by get_entries_subset until finalize()
+      //  marks the entries valid
+    }
+
+    // this is a remote sparsity map, so sanity check that we requested the data
+    assert(precise_requested);
+    finalize();
+  }
+
   template <int N, typename T>
   static inline bool non_overlapping_bounds_1d_comp(const SparsityMapEntry<N,T>& lhs,
 						    const SparsityMapEntry<N,T>& rhs)
@@ -693,6 +954,46 @@ namespace Realm {
     // std::cout << " ]]]\n";
   }
 
+  template <int N, typename T>
+  void SparsityMapImpl<N,T>::convert_to_bitmap_if_dense(void)
+  {
+    Rect<N,T> bbox = this->entries[0].bounds;
+    size_t total = 0;
+    for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = this->entries.begin();
+	it != this->entries.end();
+	it++) {
+      // leave things alone if there's anything other than plain rectangles
+      if(it->sparsity.exists() || (it->bitmap != 0))
+	return;
+      bbox = bbox.union_bbox(it->bounds);
+      total += it->bounds.volume();
+    }
+
+    // the bitmap has to be both denser than the configured threshold and
+    //  smaller than the list of entries it replaces
+    size_t bbox_volume = bbox.volume();
+    if((total * 100) < (bbox_volume * DeppartConfig::cfg_bitmap_min_density))
+      return;
+    size_t bitmap_bytes = HierarchicalBitMap<N,T>::bytes_needed(bbox);
+    if(bitmap_bytes >= (this->entries.size() * sizeof(SparsityMapEntry<N,T>)))
+      return;
+
+    HierarchicalBitMap<N,T> *bitmap = new HierarchicalBitMap<N,T>(bbox);
+    for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = this->entries.begin();
+	it != this->entries.end();
+	it++)
+      bitmap->set_rect(it->bounds);
+
+    log_part.info() << "sparsity " << me << ": replacing " << this->entries.size()
+		    << " entries with a bitmap: bounds=" << bbox
+		    << " density=" << ((total * 100) / bbox_volume) << "%";
+
+    this->entries.resize(1);
+    this->entries[0].bounds = bbox;
+    this->entries[0].sparsity.id = 0;
+    this->entries[0].bitmap = bitmap;
+  }
+
   template <int N, typename T>
   void SparsityMapImpl<N,T>::finalize(void)
   {
@@ -723,6 +1024,12 @@ namespace Realm {
       this->approx_valid = true;
     }
 
+    // a long list of rectangles that covers most of its bounding box is
+    //  replaced by a single bitmap entry
+    if((DeppartConfig::cfg_bitmap_min_entries > 0) &&
+       (this->entries.size() >= DeppartConfig::cfg_bitmap_min_entries))
+      convert_to_bitmap_if_dense();
+
 #ifdef DEBUG_PARTITIONING
     std::cout << "finalizing " << this << ", " << this->entries.size() << " entries" << std::endl;
     for(size_t i = 0; i < this->entries.size(); i++)
@@ -737,11 +1044,14 @@ namespace Realm {
     Event trigger_precise = Event::NO_EVENT;
     Event trigger_approx = Event::NO_EVENT;
     std::vector<PartitioningMicroOp *> precise_waiters_copy, approx_waiters_copy;
+    std::vector<Event> subset_triggers;
     {
       AutoHSLLock al(mutex);
 
       assert(!this->entries_valid);
       this->entries_valid = true;
+      // any chunks this was assembled from are no longer needed
+      arrived_chunks.clear();
       precise_requested = false;
       if(precise_ready_event.exists()) {
 	trigger_precise = precise_ready_event;
@@ -751,6 +1061,8 @@ namespace Realm {
       precise_waiters_copy.swap(precise_waiters);
       approx_waiters_copy.swap(approx_waiters);
 
+      collect_subset_waiters(subset_triggers, true /*all*/);
+
       sendto_precise = remote_precise_waiters;
       remote_precise_waiters.clear();
     }
@@ -789,6 +1101,11 @@ namespace Realm {
 
     if(trigger_precise.exists())
       GenEventImpl::trigger(trigger_precise, false /*!poisoned*/);
+
+    for(std::vector<Event>::const_iterator it = subset_triggers.begin();
+	it != subset_triggers.end();
+	it++)
+      GenEventImpl::trigger(*it, false /*!poisoned*/);
   }
 
 
@@ -857,6 +1174,17 @@ namespace Realm {
     log_part.info() << "received remote contribution: sparsity=" << sparsity << " len=" << datalen;
     size_t count = datalen / sizeof(Rect<NT::N,T>);
     assert((datalen % sizeof(Rect<NT::N,T>)) == 0);
+    if(args->chunk_index == CHUNK_DIRECTORY) {
+      SparsityMapImpl<NT::N,T>::lookup(sparsity)->receive_chunk_directory((const Rect<NT::N,T> *)data,
+									  count);
+      return;
+    }
+    if(args->chunk_index != CONTRIBUTION) {
+      SparsityMapImpl<NT::N,T>::lookup(sparsity)->receive_chunk(args->chunk_index,
+								(const Rect<NT::N,T> *)data,
+								count);
+      return;
+    }
     bool last_fragment = fragment_assembler.add_fragment(args->sender,
 							 args->sequence_id,
 							 args->sequence_count);
@@ -877,7 +1205,8 @@ namespace Realm {
 							     int sequence_id,
 							     int sequence_count,
 							     const Rect<N,T> *rects,
-							     size_t count)
+							     size_t count,
+							     int chunk_index /*= CONTRIBUTION*/)
   {
     RequestArgs args;
 
@@ -886,6 +1215,7 @@ namespace Realm {
     args.sparsity_id = sparsity.id;
     args.sequence_id = sequence_id;
     args.sequence_count = sequence_count;
+    args.chunk_index = chunk_index;
 
     Message::request(target, args, rects, count * sizeof(Rect<N,T>),
 		     PAYLOAD_COPY);
@@ -59,10 +59,32 @@ namespace Realm {
     void remote_data_request(NodeID requestor, bool send_precise, bool send_approx);
     void remote_data_reply(NodeID requestor, bool send_precise, bool send_approx);
 
+    // precise data for a remote sparsity map is delivered in chunks, each
+    //  covering a known bounding box, so that users that only care about a
+    //  subset of the map can start before the whole thing has arrived
+    // make_valid_subset returns an event that triggers once all the data
+    //  overlapping 'subset' is present, and get_entries_subset then returns
+    //  the (disjoint) rectangles of the map that lie within 'subset'
+    Event make_valid_subset(const Rect<N,T>& subset);
+    void get_entries_subset(const Rect<N,T>& subset, std::vector<Rect<N,T> >& rects);
+
+    void receive_chunk_directory(const Rect<N,T> *bounds, size_t count);
+    void receive_chunk(int chunk_index, const Rect<N,T> *rects, size_t count);
+
     SparsityMap<N,T> me;
 
   protected:
     void finalize(void);
+
+    // replaces the entry list with a bitmap if it's dense enough to be worth it
+    void convert_to_bitmap_if_dense(void);
+
+    // these must be called with the mutex held
+    bool subset_arrived(const Rect<N,T>& subset) const;
+    bool all_chunks_arrived(void) const;
+    void collect_subset_waiters(std::vector<Event>& to_trigger, bool all);
+
+    void assemble_chunks(void);
     
     int remaining_contributor_count;
     GASNetHSL mutex;
@@ -72,6 +94,12 @@ namespace Realm {
     NodeSet remote_precise_waiters, remote_approx_waiters;
     NodeSet remote_sharers;
     size_t sizeof_precise;
+
+    // state for precise data arriving in chunks from the owner
+    bool chunk_directory_valid;
+    std::vector<Rect<N,T> > chunk_bounds;
+    std::map<int, std::vector<Rect<N,T> > > arrived_chunks;
+    std::vector<std::pair<Rect<N,T>, Event> > subset_waiters;
   };
 
   // we need a type-erased wrapper to store in the runtime's lookup table
@@ -173,6 +201,12 @@ namespace Realm {
       ID::IDType sparsity_id;
       int sequence_id;
       int sequence_count;
+      int chunk_index;  // CONTRIBUTION, CHUNK_DIRECTORY, or index of a chunk
+    };
+
+    enum {
+      CONTRIBUTION = -1,
+      CHUNK_DIRECTORY = -2,
     };
 
     struct DecodeHelper {
@@ -189,7 +223,8 @@ namespace Realm {
     template <int N, typename T>
     static void send_request(NodeID target, SparsityMap<N,T> sparsity,
 			     int sequence_id, int sequence_count,
-			     const Rect<N,T> *rects, size_t count);
+			     const Rect<N,T> *rects, size_t count,
+			     int chunk_index = CONTRIBUTION);
   };
 
 }; // namespace Realm
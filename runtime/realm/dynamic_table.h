@@ -64,7 +64,10 @@ namespace Realm {
       NodeBase *new_tree_node(int level, IT first_index, IT last_index,
 			      int owner, typename ALLOCATOR::FreeList *free_list);
 
-      // lock protects _changes_ to 'root', but not access to it
+      // lock protects _changes_ to 'root', but not access to it - 'root' and
+      //  the child pointers in inner nodes are published with release stores
+      //  and read with acquire loads, so lookups of existing entries never
+      //  take a lock
       LT lock;
       NodeBase * volatile root;
     };
@@ -90,6 +93,31 @@ namespace Realm {
       LT lock;
       ET * volatile first_free;
       IT volatile next_alloc;
+
+      // entries move between the shared list and a set of per-thread caches
+      //  (each with its own lock, since tasks can migrate between threads)
+      //  in batches, so alloc/free from many threads don't all serialize on
+      //  'lock'
+      static const int NUM_CACHES = 16;
+      static const int CACHE_BATCH = 32;
+      static const int CACHE_MAX = 2 * CACHE_BATCH;
+
+      // each cache is padded by a cache line rather than aligned to one
+      //  (free lists are allocated with plain new, which doesn't honor extended
+      //  alignment before C++17), which still keeps each cache's fields off of
+      //  its neighbors' (and the shared list's) cache lines
+      struct LocalCache {
+	char padding[64];
+	LT lock;
+	ET *first_free;
+	int count;
+      };
+
+    protected:
+      // returns the calling thread's cache (assigned round-robin on first use)
+      static int cache_index(void);
+
+      LocalCache caches[NUM_CACHES];
     };
 	
 }; // namespace Realm
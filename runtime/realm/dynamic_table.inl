@@ -20,6 +20,10 @@
 
 namespace Realm {
 
+  // free list cache assigned to the current thread, or -1 if none yet
+  extern __thread int current_free_list_cache;
+  extern int next_free_list_cache;
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class DynamicTableNodeBase<LT, IT>
@@ -102,7 +106,7 @@ namespace Realm {
       elems_addressable <<= ALLOCATOR::INNER_BITS;
     }
 
-    NodeBase *n = root;
+    NodeBase *n = __atomic_load_n(&root, __ATOMIC_ACQUIRE);
     if (!n || (n->level < level_needed))
       return false;
 
@@ -120,7 +124,7 @@ namespace Realm {
 	      ((((IT)1) << ALLOCATOR::INNER_BITS) - 1));
       assert((i >= 0) && (((size_t)i) < ALLOCATOR::INNER_TYPE::SIZE));
 
-      NodeBase *child = inner->elems[i];
+      NodeBase *child = __atomic_load_n(&inner->elems[i], __ATOMIC_ACQUIRE);
       if(child == 0) {
 	return false;	
       }
@@ -146,28 +150,30 @@ namespace Realm {
 
     // in the common case, we won't need to add levels to the tree - grab the root (no lock)
     // and see if it covers the range that includes our index
-    NodeBase *n = root;
+    NodeBase *n = __atomic_load_n(&root, __ATOMIC_ACQUIRE);
     if(!n || (n->level < level_needed)) {
       // root doesn't appear to be high enough - take lock and fix it if it's really
       //  not high enough
       lock.lock();
 
-      if(!root) {
+      n = root;
+      if(!n) {
 	// simple case - just create a root node at the level we want
-	root = new_tree_node(level_needed, 0, elems_addressable - 1, owner, free_list);
+	n = new_tree_node(level_needed, 0, elems_addressable - 1, owner, free_list);
       } else {
 	// some of the tree already exists - add new layers on top
-	while(root->level < level_needed) {
-	  int parent_level = root->level + 1;
+	while(n->level < level_needed) {
+	  int parent_level = n->level + 1;
 	  IT parent_first = 0;
-	  IT parent_last = (((root->last_index + 1) << ALLOCATOR::INNER_BITS) - 1);
+	  IT parent_last = (((n->last_index + 1) << ALLOCATOR::INNER_BITS) - 1);
 	  NodeBase *parent = new_tree_node(parent_level, parent_first, parent_last, owner, free_list);
 	  typename ALLOCATOR::INNER_TYPE *inner = static_cast<typename ALLOCATOR::INNER_TYPE *>(parent);
-	  inner->elems[0] = root;
-	  root = parent;
+	  inner->elems[0] = n;
+	  n = parent;
 	}
       }
-      n = root;
+      // publish the fully-constructed (sub)tree
+      __atomic_store_n(&root, n, __ATOMIC_RELEASE);
 
       lock.unlock();
     }
@@ -185,7 +191,7 @@ namespace Realm {
 	      ((((IT)1) << ALLOCATOR::INNER_BITS) - 1));
       assert((i >= 0) && (((size_t)i) < ALLOCATOR::INNER_TYPE::SIZE));
 
-      NodeBase *child = inner->elems[i];
+      NodeBase *child = __atomic_load_n(&inner->elems[i], __ATOMIC_ACQUIRE);
       if(child == 0) {
 	// need to populate subtree
 
@@ -193,15 +199,16 @@ namespace Realm {
 	inner->lock.lock();
 
 	// now that lock is held, see if we really need to make new node
-	if(inner->elems[i] == 0) {
+	child = inner->elems[i];
+	if(child == 0) {
 	  int child_level = inner->level - 1;
 	  int child_shift = (ALLOCATOR::LEAF_BITS + child_level * ALLOCATOR::INNER_BITS);
 	  IT child_first = inner->first_index + (i << child_shift);
 	  IT child_last = inner->first_index + ((i + 1) << child_shift) - 1;
 
-	  inner->elems[i] = new_tree_node(child_level, child_first, child_last, owner, free_list);
+	  child = new_tree_node(child_level, child_first, child_last, owner, free_list);
+	  __atomic_store_n(&inner->elems[i], child, __ATOMIC_RELEASE);
 	}
-	child = inner->elems[i];
 
 	inner->lock.unlock();
       }
@@ -227,12 +234,40 @@ namespace Realm {
   template <typename ALLOCATOR>
   DynamicTableFreeList<ALLOCATOR>::DynamicTableFreeList(DynamicTable<ALLOCATOR>& _table, int _owner)
     : table(_table), owner(_owner), first_free(0), next_alloc(0)
-  {}
+  {
+    for(int i = 0; i < NUM_CACHES; i++) {
+      caches[i].first_free = 0;
+      caches[i].count = 0;
+    }
+  }
+
+  template <typename ALLOCATOR>
+  inline /*static*/ int DynamicTableFreeList<ALLOCATOR>::cache_index(void)
+  {
+    int idx = current_free_list_cache;
+    if(idx < 0) {
+      idx = __sync_fetch_and_add(&next_free_list_cache, 1) % NUM_CACHES;
+      current_free_list_cache = idx;
+    }
+    return idx;
+  }
 
   template <typename ALLOCATOR>
   typename DynamicTableFreeList<ALLOCATOR>::ET *DynamicTableFreeList<ALLOCATOR>::alloc_entry(void)
   {
-    // take the lock first, since we're messing with the free list
+    // fast path - pop from this thread's cache
+    LocalCache& c = caches[cache_index()];
+    c.lock.lock();
+    ET *entry = c.first_free;
+    if(entry) {
+      c.first_free = entry->next_free;
+      c.count--;
+      c.lock.unlock();
+      return entry;
+    }
+    c.lock.unlock();
+
+    // cache is empty - take the lock on the shared list and grab a batch
     lock.lock();
 
     // if the free list is empty, we can fill it up by referencing the next entry to be allocated -
@@ -251,20 +286,60 @@ namespace Realm {
       lock.lock();
     }
 
-    typename DynamicTable<ALLOCATOR>::ET *entry = first_free;
-    first_free = entry->next_free;
+    // we return the first entry and move up to CACHE_BATCH-1 more to the cache
+    entry = first_free;
+    ET *batch_first = entry->next_free;
+    ET *batch_last = 0;
+    int batch_size = 0;
+    for(ET *e = batch_first; e && (batch_size < (CACHE_BATCH - 1)); e = e->next_free) {
+      batch_last = e;
+      batch_size++;
+    }
+    first_free = (batch_last ? batch_last->next_free : 0);
     lock.unlock();
 
+    if(batch_size > 0) {
+      c.lock.lock();
+      batch_last->next_free = c.first_free;
+      c.first_free = batch_first;
+      c.count += batch_size;
+      c.lock.unlock();
+    }
+
     return entry;
   }
 
   template <typename ALLOCATOR>
   void DynamicTableFreeList<ALLOCATOR>::free_entry(ET *entry)
   {
-    // just stick ourselves on front of free list
+    // just stick ourselves on front of this thread's cache
+    LocalCache& c = caches[cache_index()];
+    c.lock.lock();
+    entry->next_free = c.first_free;
+    c.first_free = entry;
+    if(++c.count <= CACHE_MAX) {
+      c.lock.unlock();
+      return;
+    }
+
+    // cache is too big - keep the CACHE_BATCH most recently freed entries and
+    //  give the rest back to the shared list
+    ET *keep_last = c.first_free;
+    for(int i = 1; i < CACHE_BATCH; i++)
+      keep_last = keep_last->next_free;
+    ET *batch_first = keep_last->next_free;
+    keep_last->next_free = 0;
+    c.count = CACHE_BATCH;
+    c.lock.unlock();
+
+    // the detached entries are ours alone, so find the end without any lock
+    ET *batch_last = batch_first;
+    while(batch_last->next_free)
+      batch_last = batch_last->next_free;
+
     lock.lock();
-    entry->next_free = first_free;
-    first_free = entry;
+    batch_last->next_free = first_free;
+    first_free = batch_first;
     lock.unlock();
   }
 
@@ -20,6 +20,8 @@
 #include "realm/logging.h"
 #include "realm/threads.h"
 #include "realm/profiling.h"
+#include "realm/event_trace.h"
+#include "realm/sampling.h"
 
 namespace Realm {
 
@@ -259,6 +261,12 @@ namespace Realm {
 
     Thread *thread = Thread::self();
     if(thread) {
+      // short waits are cheaper to spin through than to suspend for
+      long long spin_start = 0;
+      if(EventWaitSpinner::spin(*this, e, gen, poisoned,
+				EventWaitSpinner::TASK_WAIT, spin_start))
+	return;
+
       log_event.info() << "thread blocked: thread=" << thread << " event=" << *this;
       // see if we are being asked to profile these waits
       ProfilingMeasurements::OperationEventWaits::WaitInterval *interval = 0;
@@ -271,6 +279,7 @@ namespace Realm {
       thread->wait_for_condition(EventTriggeredCondition(e, gen, interval), poisoned);
       if(interval)
 	interval->record_wait_end();
+      EventWaitSpinner::record_block(*this, EventWaitSpinner::TASK_WAIT, spin_start);
       log_event.info() << "thread resumed: thread=" << thread << " event=" << *this << " poisoned=" << poisoned;
       return;
     }
@@ -310,10 +319,111 @@ namespace Realm {
     
     // waiting on an event does not count against the low level's time
     DetailedTimer::ScopedPush sp2(TIME_NONE);
+
+    long long spin_start = 0;
+    if(EventWaitSpinner::spin(*this, e, gen, poisoned,
+			      EventWaitSpinner::EXTERNAL_WAIT, spin_start))
+      return;
     
     log_event.info() << "external thread blocked: event=" << *this;
     e->external_wait(gen, poisoned);
     log_event.info() << "external thread resumed: event=" << *this;
+    EventWaitSpinner::record_block(*this, EventWaitSpinner::EXTERNAL_WAIT, spin_start);
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class EventWaitSpinner
+  //
+
+  namespace Config {
+    int event_wait_spin_ns = 2000;
+  };
+
+  // negative means "not learned yet"
+  /*static*/ long long EventWaitSpinner::spin_limit_ns[EventWaitSpinner::NUM_SLOTS] = { -1, -1, -1, -1 };
+
+  static ProfilingGauges::EventCounter<long long> *event_waits_spun = 0;
+  static ProfilingGauges::EventCounter<long long> *event_waits_blocked = 0;
+
+  static inline void spin_pause(void)
+  {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__ ("yield" : : : "memory");
+#else
+    __sync_synchronize();
+#endif
+  }
+
+  /*static*/ void EventWaitSpinner::create_gauges(void)
+  {
+    event_waits_spun = new ProfilingGauges::EventCounter<long long>("realm/event waits spun");
+    event_waits_blocked = new ProfilingGauges::EventCounter<long long>("realm/event waits blocked");
+  }
+
+  /*static*/ int EventWaitSpinner::slot(Event event, WaitKind kind)
+  {
+    return ((kind == TASK_WAIT) ? 0 : 2) + (ID(event).is_barrier() ? 1 : 0);
+  }
+
+  /*static*/ bool EventWaitSpinner::spin(Event event, EventImpl *impl,
+					 EventImpl::gen_t gen, bool& poisoned,
+					 WaitKind kind, long long& start_ns)
+  {
+    start_ns = 0;
+    if(Config::event_wait_spin_ns <= 0)
+      return false;
+
+    long long limit = __atomic_load_n(&spin_limit_ns[slot(event, kind)],
+				      __ATOMIC_RELAXED);
+    if(limit < 0)
+      limit = Config::event_wait_spin_ns / 4;
+
+    start_ns = Clock::current_time_in_nanoseconds();
+    long long deadline = start_ns + limit;
+    do {
+      // don't hammer on the event (or the clock) on every iteration
+      for(int i = 0; i < 16; i++)
+	spin_pause();
+      if(impl->has_triggered(gen, poisoned)) {
+	if(event_waits_spun)
+	  (*event_waits_spun) += 1;
+	return true;
+      }
+    } while(Clock::current_time_in_nanoseconds() < deadline);
+
+    return false;
+  }
+
+  /*static*/ void EventWaitSpinner::record_block(Event event, WaitKind kind,
+						 long long start_ns)
+  {
+    if(event_waits_blocked)
+      (*event_waits_blocked) += 1;
+
+    // nothing to learn if we didn't spin
+    if(start_ns == 0)
+      return;
+
+    long long waited = Clock::current_time_in_nanoseconds() - start_ns;
+    long long max_spin = Config::event_wait_spin_ns;
+    long long *limitp = &spin_limit_ns[slot(event, kind)];
+    long long limit = __atomic_load_n(limitp, __ATOMIC_RELAXED);
+    if(limit < 0)
+      limit = max_spin / 4;
+
+    if(waited < max_spin) {
+      // a somewhat longer spin would have caught this one
+      limit = std::min(max_spin, 2 * waited);
+    } else {
+      // too long to spin through - back off, but keep probing
+      limit = limit / 2;
+      if(limit < MIN_SPIN_NS)
+	limit = MIN_SPIN_NS;
+    }
+    __atomic_store_n(limitp, limit, __ATOMIC_RELAXED);
   }
 
   void Event::cancel_operation(const void *reason_data, size_t reason_len) const
@@ -659,14 +769,8 @@ namespace Realm {
       {
 	bool poisoned = false;
 	if(wait_for.has_triggered_faultaware(poisoned)) {
-	  if(poisoned) {
-	    // always count faults, but don't necessarily propagate
-	    bool first_fault = (__sync_fetch_and_add(&faults_observed, 1) == 0);
-	    if(first_fault && !ignore_faults) {
-	      log_poison.info() << "event merger early poison: after=" << finish_event;
-	      GenEventImpl::trigger(finish_event, true /*poisoned*/);
-	    }
-	  }
+	  if(poisoned)
+	    record_fault();
 	  // either way we return to the caller without updating the count_needed
 	  return;
 	}
@@ -677,6 +781,24 @@ namespace Realm {
 	EventImpl::add_waiter(wait_for, this);
       }
 
+      // accounts for inputs that will be reported through event_triggered
+      //  by somebody else (e.g. the nodes of a merge tree)
+      void add_inputs(int count)
+      {
+	__sync_fetch_and_add(&count_needed, count);
+      }
+
+      // always count faults, but only propagate the first one (and only
+      //  if we're not ignoring them)
+      void record_fault(void)
+      {
+	bool first_fault = (__sync_fetch_and_add(&faults_observed, 1) == 0);
+	if(first_fault && !ignore_faults) {
+	  log_poison.info() << "event merger poisoned: after=" << finish_event;
+	  GenEventImpl::trigger(finish_event, true /*poisoned*/);
+	}
+      }
+
       // arms the merged event once you're done adding input events - just
       //  decrements the count for the implicit 'init done' event
       // return a boolean saying whether it triggered upon arming (which
@@ -690,13 +812,8 @@ namespace Realm {
       virtual bool event_triggered(Event triggered, bool poisoned)
       {
 	// if the input is poisoned, we propagate that poison eagerly
-	if(poisoned) {
-	  bool first_fault = (__sync_fetch_and_add(&faults_observed, 1) == 0);
-	  if(first_fault && !ignore_faults) {
-	    log_poison.info() << "event merger poisoned: after=" << finish_event;
-	    GenEventImpl::trigger(finish_event, true /*poisoned*/);
-	  }
-	}
+	if(poisoned)
+	  record_fault();
 
 	int count_left = __sync_fetch_and_add(&count_needed, -1);
 
@@ -732,12 +849,179 @@ namespace Realm {
       int faults_observed;
     };
 
+    // merges with lots of inputs spread them over a tree of these so that
+    //  each counter sees at most MERGE_TREE_FANIN decrements - a node reports
+    //  to its parent once all of its inputs have triggered, and poison goes
+    //  straight to the root
+    class EventMergerTreeNode : public EventWaiter {
+    public:
+      EventMergerTreeNode(EventMerger *_root, EventWaiter *_parent)
+	: root(_root)
+	, parent(_parent)
+	, count_needed(1)
+      {
+      }
+
+      virtual ~EventMergerTreeNode(void)
+      {
+      }
+
+      // registers on a sorted list of untriggered events - inputs that share
+      //  a GenEventImpl are registered in one go
+      void add_events(const Event *events, size_t count)
+      {
+	__sync_fetch_and_add(&count_needed, (int)count);
+
+	std::vector<EventImpl::gen_t> gens;
+	size_t i = 0;
+	while(i < count) {
+	  if(!ID(events[i]).is_event()) {
+	    EventImpl::add_waiter(events[i], this);
+	    i++;
+	    continue;
+	  }
+
+	  GenEventImpl *impl = get_genevent_impl(events[i]);
+	  gens.clear();
+	  do {
+	    gens.push_back(ID(events[i]).event.generation);
+	    i++;
+	  } while((i < count) && ID(events[i]).is_event() &&
+		  (get_genevent_impl(events[i]) == impl));
+	  impl->add_waiters(&gens[0], gens.size(), this);
+	}
+      }
+
+      void add_child(void)
+      {
+	__sync_fetch_and_add(&count_needed, 1);
+      }
+
+      // same protocol as EventMerger::arm
+      bool arm(void)
+      {
+	return event_triggered(Event::NO_EVENT, false /*!poisoned*/);
+      }
+
+      virtual bool event_triggered(Event triggered, bool poisoned)
+      {
+	if(poisoned)
+	  root->record_fault();
+
+	int count_left = __sync_fetch_and_add(&count_needed, -1);
+	if(count_left > 1)
+	  return false;
+
+	// all done - tell our parent, which might be done as well
+	if(parent->event_triggered(Event::NO_EVENT, false /*!poisoned*/))
+	  delete parent;
+	return true;
+      }
+
+      virtual void print(std::ostream& os) const
+      {
+	os << "event merger tree node: " << root->get_finish_event() << " left=" << count_needed;
+      }
+
+      virtual Event get_finish_event(void) const
+      {
+	return root->get_finish_event();
+      }
+
+    protected:
+      EventMerger *root;
+      EventWaiter *parent;
+      int count_needed;
+      // keep neighboring nodes' counters off of each other's cache lines
+      char padding[64];
+    };
+
+    static const size_t MERGE_TREE_FANIN = 64;
+    // merges at least this big get the up-front filtering and the tree
+    static const size_t MERGE_TREE_THRESHOLD = 4 * MERGE_TREE_FANIN;
+
+    // builds the subtree for 'events' under 'parent' (which must already
+    //  be counting on it)
+    static void build_merge_tree(EventMerger *root, EventWaiter *parent,
+				 const Event *events, size_t count)
+    {
+      EventMergerTreeNode *node = new EventMergerTreeNode(root, parent);
+      if(count <= MERGE_TREE_FANIN) {
+	node->add_events(events, count);
+      } else {
+	// split into at most MERGE_TREE_FANIN similarly-sized pieces
+	size_t chunk = (count + MERGE_TREE_FANIN - 1) / MERGE_TREE_FANIN;
+	for(size_t start = 0; start < count; start += chunk) {
+	  node->add_child();
+	  build_merge_tree(root, node, events + start,
+			   std::min(chunk, count - start));
+	}
+      }
+      if(node->arm())
+	delete node;
+    }
+
+    // large merges filter out triggered (and duplicate) inputs before
+    //  creating anything, and then wait on the rest via a merge tree
+    template <typename IT>
+    static Event merge_many_events(IT first, IT last, size_t size, bool ignore_faults)
+    {
+      std::vector<Event> pending;
+      pending.reserve(size);
+      for(IT it = first; it != last; it++) {
+	bool poisoned = false;
+	if((*it).has_triggered_faultaware(poisoned)) {
+	  if(poisoned && !ignore_faults) {
+	    log_poison.info() << "merging events - " << (*it) << " already poisoned";
+	    return *it;
+	  }
+	} else
+	  pending.push_back(*it);
+      }
+
+      // sorting also puts generations of the same event next to each other
+      std::sort(pending.begin(), pending.end());
+      pending.erase(std::unique(pending.begin(), pending.end()), pending.end());
+
+      log_event.debug() << "merging events - " << pending.size() << " of " << size << " not triggered";
+
+#ifndef EVENT_GRAPH_TRACE
+      if(pending.empty()) return Event::NO_EVENT;
+      if((pending.size() == 1) && !ignore_faults) return pending[0];
+#endif
+
+      Event finish_event = GenEventImpl::create_genevent()->current_event();
+      EventMerger *m = new EventMerger(finish_event, ignore_faults);
+
+#ifdef EVENT_GRAPH_TRACE
+      log_event_graph.info("Event Merge: (" IDFMT ",%d) %ld", 
+			   finish_event.id, finish_event.gen, size);
+      for(IT it = first; it != last; it++)
+        log_event_graph.info("Event Precondition: (" IDFMT ",%d) (" IDFMT ",%d)",
+                             finish_event.id, finish_event.gen,
+                             it->id, it->gen);
+#endif
+
+      if(!pending.empty()) {
+	m->add_inputs(1);
+	build_merge_tree(m, m, &pending[0], pending.size());
+      }
+
+      if(m->arm())
+        delete m;
+
+      return finish_event;
+    }
+
     // creates an event that won't trigger until all input events have
     /*static*/ Event GenEventImpl::merge_events(const std::set<Event>& wait_for,
 						bool ignore_faults)
     {
       if (wait_for.empty())
         return Event::NO_EVENT;
+      if(wait_for.size() >= MERGE_TREE_THRESHOLD)
+	return merge_many_events(wait_for.begin(), wait_for.end(),
+				 wait_for.size(), ignore_faults);
       // scan through events to see how many exist/haven't fired - we're
       //  interested in counts of 0, 1, or 2+ - also remember the first
       //  event we saw for the count==1 case
@@ -808,6 +1092,9 @@ namespace Realm {
     {
       if (wait_for.empty())
         return Event::NO_EVENT;
+      if(wait_for.size() >= MERGE_TREE_THRESHOLD)
+	return merge_many_events(wait_for.begin(), wait_for.end(),
+				 wait_for.size(), ignore_faults);
       // scan through events to see how many exist/haven't fired - we're
       //  interested in counts of 0, 1, or 2+ - also remember the first
       //  event we saw for the count==1 case
@@ -1029,6 +1316,7 @@ namespace Realm {
 	item.action = EventTraceItem::ACT_CREATE;
       }
 #endif
+      EventTraceRing::record(EventTraceRing::ACT_CREATE, impl->current_event().id);
       return impl;
     }
 
@@ -1042,6 +1330,7 @@ namespace Realm {
         item.action = EventTraceItem::ACT_WAIT;
       }
 #endif
+      EventTraceRing::record(EventTraceRing::ACT_WAIT, make_event(needed_gen).id);
       // no early check here as the caller will generally have tried has_triggered()
       //  before allocating its EventWaiter object
 
@@ -1066,6 +1355,11 @@ namespace Realm {
 	    assert(owner != my_node_id);
 	    trigger_now = true;
 	    trigger_poisoned = it->second;
+	  } else if((owner != my_node_id) &&
+		    EventTriggerHints::known_triggered(make_event(needed_gen))) {
+	    // 2b) the owner has told us in passing that this generation triggered cleanly
+	    trigger_now = true;
+	    trigger_poisoned = false;
 	  } else {
 	    // 3) we don't know of a trigger of this event, so record the waiter and subscribe if needed
 
@@ -1107,6 +1401,80 @@ namespace Realm {
       return true;  // waiter is always either enqueued or triggered right now
     }
 
+    void GenEventImpl::add_waiters(const gen_t *needed_gens, size_t count,
+				   EventWaiter *waiter)
+    {
+      for(size_t i = 0; i < count; i++)
+	EventTraceRing::record(EventTraceRing::ACT_WAIT, make_event(needed_gens[i]).id);
+
+      // generations that have already triggered, and whether they were poisoned
+      std::vector<std::pair<gen_t, bool> > trigger_now;
+
+      int subscribe_owner = -1;
+      gen_t subscribe_gen = 0;
+      gen_t previous_subscribe_gen = 0;
+      {
+	AutoHSLLock a(mutex);
+
+	// same three cases as add_waiter, just without dropping the mutex
+	for(size_t i = 0; i < count; i++) {
+	  gen_t needed_gen = needed_gens[i];
+
+	  if(needed_gen <= generation) {
+	    trigger_now.push_back(std::make_pair(needed_gen,
+						 is_generation_poisoned(needed_gen)));
+	    continue;
+	  }
+
+	  std::map<gen_t, bool>::const_iterator it = local_triggers.find(needed_gen);
+	  if(it != local_triggers.end()) {
+	    assert(owner != my_node_id);
+	    trigger_now.push_back(std::make_pair(needed_gen, it->second));
+	    continue;
+	  }
+
+	  if((owner != my_node_id) &&
+	     EventTriggerHints::known_triggered(make_event(needed_gen))) {
+	    trigger_now.push_back(std::make_pair(needed_gen, false));
+	    continue;
+	  }
+
+	  if(needed_gen == (generation + 1)) {
+	    current_local_waiters.push_back(waiter);
+	  } else {
+	    assert(owner != my_node_id);
+	    future_local_waiters[needed_gen].push_back(waiter);
+	  }
+
+	  // a subscription to the newest generation covers all the older ones
+	  if((owner != my_node_id) && (gen_subscribed < needed_gen)) {
+	    if(subscribe_owner == -1)
+	      previous_subscribe_gen = gen_subscribed;
+	    gen_subscribed = needed_gen;
+	    subscribe_gen = needed_gen;
+	    subscribe_owner = owner;
+	  }
+	}
+      }
+
+      if(subscribe_owner != -1)
+	EventSubscribeMessage::send_request(subscribe_owner,
+					    make_event(subscribe_gen),
+					    previous_subscribe_gen);
+
+      for(std::vector<std::pair<gen_t, bool> >::const_iterator it = trigger_now.begin();
+	  it != trigger_now.end();
+	  it++) {
+	bool nuke = waiter->event_triggered(make_event(it->first), it->second);
+	// the caller is supposed to be holding the waiter open
+	assert(!nuke);
+	if(nuke) {
+	  delete waiter;
+	  break;
+	}
+      }
+    }
+
     inline bool GenEventImpl::is_generation_poisoned(gen_t gen) const
     {
       // common case: no poisoned generations
@@ -1151,6 +1519,9 @@ namespace Realm {
   /*static*/ void EventTriggerMessage::send_request(NodeID target, Event event,
 						    bool poisoned)
   {
+    if(EventMessageBatcher::add_trigger(target, event, poisoned))
+      return;
+
     RequestArgs args;
 
     args.node = my_node_id;
@@ -1164,28 +1535,538 @@ namespace Realm {
 						   int num_poisoned,
 						   const EventImpl::gen_t *poisoned_generations)
   {
+    if(EventMessageBatcher::add_update(target, event,
+				       num_poisoned, poisoned_generations))
+      return;
+
     RequestArgs args;
 
     args.event = event;
+    args.num_poisoned = num_poisoned;
 
-    Message::request(target, args,
-		     poisoned_generations, num_poisoned * sizeof(EventImpl::gen_t),
-		     PAYLOAD_KEEP);
+    std::vector<Event> hints;
+    if(EventTriggerHints::collect(target, hints) == 0) {
+      Message::request(target, args,
+		       poisoned_generations, num_poisoned * sizeof(EventImpl::gen_t),
+		       PAYLOAD_KEEP);
+      return;
+    }
+
+    size_t poisoned_bytes = num_poisoned * sizeof(EventImpl::gen_t);
+    size_t datalen = poisoned_bytes + hints.size() * sizeof(Event);
+    char *data = (char *)malloc(datalen);
+    if(num_poisoned > 0)
+      memcpy(data, poisoned_generations, poisoned_bytes);
+    memcpy(data + poisoned_bytes, &hints[0], hints.size() * sizeof(Event));
+    Message::request(target, args, data, datalen, PAYLOAD_FREE);
   }
 
+  namespace Config {
+    int event_tree_threshold = 0;
+    int event_tree_fanout = 4;
+  };
+
+  // collects the members of a NodeSet into a (sorted) vector
+  struct NodeListBuilder {
+    NodeListBuilder(std::vector<NodeID>& _nodes) : nodes(_nodes) {}
+    inline void apply(NodeID target) { nodes.push_back(target); }
+    std::vector<NodeID>& nodes;
+  };
+
   /*static*/ void EventUpdateMessage::broadcast_request(const NodeSet& targets, Event event,
 							int num_poisoned,
 							const EventImpl::gen_t *poisoned_generations)
   {
+    // large subscriber sets go down a tree instead of being sent (or batched)
+    //  one node at a time
+    if((Config::event_tree_threshold > 0) && (Config::event_tree_fanout > 1) &&
+       (targets.size() >= (size_t)(Config::event_tree_threshold))) {
+      std::vector<NodeID> nodes;
+      nodes.reserve(targets.size());
+      NodeListBuilder nlb(nodes);
+      targets.map(nlb);
+      EventTreeUpdateMessage::send_requests(&nodes[0], &nodes[0] + nodes.size(),
+					    event, num_poisoned, poisoned_generations);
+      return;
+    }
+
+    if(EventMessageBatcher::add_update(targets, event,
+				       num_poisoned, poisoned_generations))
+      return;
+
     MediumBroadcastHelper<EventUpdateMessage> args;
 
+    // (no trigger hints - everybody gets the same payload)
     args.event = event;
+    args.num_poisoned = num_poisoned;
 
     args.broadcast(targets,
 		   poisoned_generations, num_poisoned * sizeof(EventImpl::gen_t),
 		   PAYLOAD_KEEP);
   }
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class EventTreeUpdateMessage
+  //
+
+  // the payload is the poisoned generations followed by the list of nodes
+  //  the recipient must forward the update to
+
+  /*static*/ void EventTreeUpdateMessage::send_requests(const NodeID *first,
+							const NodeID *last,
+							Event event,
+							int num_poisoned,
+							const EventImpl::gen_t *poisoned_generations)
+  {
+    size_t count = last - first;
+    if(count == 0) return;
+
+    size_t fanout = Config::event_tree_fanout;
+    if(fanout < 2) fanout = 2;
+    if(fanout > count) fanout = count;
+
+    size_t gen_bytes = num_poisoned * sizeof(EventImpl::gen_t);
+
+    // split the nodes into 'fanout' nearly-equal contiguous chunks - the
+    //  first node of each chunk receives the update and forwards it to
+    //  the rest of its chunk
+    size_t start = 0;
+    for(size_t i = 0; i < fanout; i++) {
+      size_t end = start + (count - start) / (fanout - i);
+      assert(end > start);
+
+      RequestArgs args;
+      args.event = event;
+      args.num_poisoned = num_poisoned;
+      args.num_forwards = end - start - 1;
+
+      size_t datalen = gen_bytes + args.num_forwards * sizeof(NodeID);
+      if(datalen > 0) {
+	char *data = (char *)malloc(datalen);
+	assert(data != 0);
+	if(gen_bytes > 0)
+	  memcpy(data, poisoned_generations, gen_bytes);
+	if(args.num_forwards > 0)
+	  memcpy(data + gen_bytes, first + start + 1,
+		 args.num_forwards * sizeof(NodeID));
+	Message::request(first[start], args, data, datalen, PAYLOAD_FREE);
+      } else
+	Message::request(first[start], args, 0, 0, PAYLOAD_NONE);
+
+      start = end;
+    }
+    assert(start == count);
+  }
+
+  /*static*/ void EventTreeUpdateMessage::handle_request(RequestArgs args,
+							 const void *data, size_t datalen)
+  {
+    assert(datalen == (args.num_poisoned * sizeof(EventImpl::gen_t) +
+		       args.num_forwards * sizeof(NodeID)));
+    const EventImpl::gen_t *new_poisoned_gens = (const EventImpl::gen_t *)data;
+    const NodeID *forwards = (const NodeID *)(((const char *)data) +
+					      (args.num_poisoned * sizeof(EventImpl::gen_t)));
+
+    log_event.debug() << "event tree update: event=" << args.event
+		      << " poisoned=" << args.num_poisoned
+		      << " forwards=" << args.num_forwards;
+
+    // pass the update along first so that it doesn't wait on local processing
+    if(args.num_forwards > 0)
+      send_requests(forwards, forwards + args.num_forwards, args.event,
+		    args.num_poisoned, new_poisoned_gens);
+
+    GenEventImpl *impl = get_runtime()->get_genevent_impl(args.event);
+    impl->process_update(ID(args.event).event.generation,
+			 (args.num_poisoned ? new_poisoned_gens : 0),
+			 args.num_poisoned);
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class EventBatchMessage
+  //
+
+  // each entry in a batch is an Event followed by an int count - a count of
+  //  -1 (or -2) is a trigger (poisoned, if -2) sent to the owner, while a
+  //  non-negative count is an update carrying that many poisoned generations
+  static const int BATCH_ENTRY_TRIGGER = -1;
+  static const int BATCH_ENTRY_TRIGGER_POISONED = -2;
+
+  /*static*/ void EventBatchMessage::send_request(NodeID target, int num_entries,
+						  void *data, size_t datalen)
+  {
+    RequestArgs args;
+
+    args.sender = my_node_id;
+    args.num_entries = num_entries;
+
+    std::vector<Event> hints;
+    args.num_hints = EventTriggerHints::collect(target, hints);
+    if(args.num_hints > 0) {
+      data = realloc(data, datalen + hints.size() * sizeof(Event));
+      memcpy((char *)data + datalen, &hints[0], hints.size() * sizeof(Event));
+      datalen += hints.size() * sizeof(Event);
+    }
+
+    Message::request(target, args, data, datalen, PAYLOAD_FREE);
+  }
+
+  /*static*/ void EventBatchMessage::handle_request(RequestArgs args,
+						    const void *data, size_t datalen)
+  {
+    log_event.debug() << "event batch: sender=" << args.sender
+		      << " entries=" << args.num_entries;
+
+    Serialization::FixedBufferDeserializer fbd(data, datalen);
+    std::vector<EventImpl::gen_t> poisoned_gens;
+    for(int i = 0; i < args.num_entries; i++) {
+      Event event;
+      int count;
+#ifndef NDEBUG
+      bool ok =
+#endif
+	(fbd >> event) && (fbd >> count);
+      assert(ok);
+
+      GenEventImpl *impl = get_runtime()->get_genevent_impl(event);
+      if(count < 0) {
+	impl->trigger(ID(event).event.generation, args.sender,
+		      (count == BATCH_ENTRY_TRIGGER_POISONED));
+      } else {
+	poisoned_gens.resize(count);
+	if(count > 0) {
+#ifndef NDEBUG
+	  bool ok =
+#endif
+	    fbd.extract_bytes(&poisoned_gens[0], count * sizeof(EventImpl::gen_t));
+	  assert(ok);
+	}
+	impl->process_update(ID(event).event.generation,
+			     (count ? &poisoned_gens[0] : 0), count);
+      }
+    }
+
+    if(args.num_hints > 0) {
+      std::vector<Event> hints(args.num_hints);
+#ifndef NDEBUG
+      bool ok =
+#endif
+	fbd.extract_bytes(&hints[0], args.num_hints * sizeof(Event));
+      assert(ok);
+      EventTriggerHints::apply(&hints[0], args.num_hints);
+    }
+    assert(fbd.bytes_left() == 0);
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class EventTriggerHints
+  //
+
+  namespace Config {
+    int event_hint_cache_size = 4096;
+    int event_hints_per_msg = 16;
+  };
+
+  /*static*/ Event::id_t *EventTriggerHints::recent = 0;
+  /*static*/ unsigned long long EventTriggerHints::recent_count = 0;
+  /*static*/ unsigned long long *EventTriggerHints::sent_upto = 0;
+  /*static*/ Event::id_t *EventTriggerHints::cache = 0;
+  /*static*/ size_t EventTriggerHints::cache_mask = 0;
+
+  /*static*/ void EventTriggerHints::init(int num_nodes)
+  {
+    if((Config::event_hint_cache_size <= 0) || (num_nodes <= 1))
+      return;
+
+    // round the cache up to a power of two
+    size_t cache_size = 1;
+    while(cache_size < (size_t)Config::event_hint_cache_size)
+      cache_size <<= 1;
+    cache = new Event::id_t[cache_size];
+    for(size_t i = 0; i < cache_size; i++)
+      cache[i] = 0;
+    cache_mask = cache_size - 1;
+
+    if(Config::event_hints_per_msg > 0) {
+      sent_upto = new unsigned long long[num_nodes];
+      for(int i = 0; i < num_nodes; i++)
+	sent_upto[i] = 0;
+      recent = new Event::id_t[RECENT_TRIGGERS];
+      for(int i = 0; i < RECENT_TRIGGERS; i++)
+	recent[i] = 0;
+    }
+  }
+
+  /*static*/ void EventTriggerHints::record_local_trigger(Event e)
+  {
+    if(!recent) return;
+
+    unsigned long long idx = __sync_fetch_and_add(&recent_count, 1);
+    __atomic_store_n(&recent[idx % RECENT_TRIGGERS], e.id, __ATOMIC_RELEASE);
+  }
+
+  /*static*/ int EventTriggerHints::collect(NodeID target, std::vector<Event>& hints)
+  {
+    if(!recent) return 0;
+
+    // no lock here - two senders racing on the same target might send the
+    //  same hints twice (or skip some), which is harmless
+    unsigned long long last = __atomic_load_n(&recent_count, __ATOMIC_ACQUIRE);
+    unsigned long long first = sent_upto[target];
+    if(first >= last) return 0;
+    if((last - first) > (unsigned long long)Config::event_hints_per_msg)
+      first = last - Config::event_hints_per_msg;
+    sent_upto[target] = last;
+
+    int added = 0;
+    for(unsigned long long i = first; i < last; i++) {
+      Event e;
+      e.id = __atomic_load_n(&recent[i % RECENT_TRIGGERS], __ATOMIC_ACQUIRE);
+      // a slot that hasn't been filled in yet (or that has been overwritten
+      //  by a newer trigger) still names a real trigger or is empty
+      if(e.id == 0) continue;
+      hints.push_back(e);
+      added++;
+    }
+    return added;
+  }
+
+  // the cache is indexed by the event with its generation stripped off
+  static inline Event::id_t event_base_id(Event e)
+  {
+    ID id(e);
+    id.event.generation = 0;
+    return id.convert<Event>().id;
+  }
+
+  /*static*/ void EventTriggerHints::apply(const Event *hints, int count)
+  {
+    if(!cache) return;
+
+    for(int i = 0; i < count; i++) {
+      Event::id_t base = event_base_id(hints[i]);
+      size_t slot = (base ^ (base >> 20)) & cache_mask;
+      Event prev;
+      prev.id = __atomic_load_n(&cache[slot], __ATOMIC_RELAXED);
+      // don't replace a newer generation of the same event
+      if((prev.id != 0) && (event_base_id(prev) == base) &&
+	 (ID(prev).event.generation >= ID(hints[i]).event.generation))
+	continue;
+      __atomic_store_n(&cache[slot], hints[i].id, __ATOMIC_RELAXED);
+    }
+  }
+
+  /*static*/ bool EventTriggerHints::known_triggered(Event e)
+  {
+    if(!cache) return false;
+
+    Event::id_t base = event_base_id(e);
+    size_t slot = (base ^ (base >> 20)) & cache_mask;
+    Event::id_t cached = __atomic_load_n(&cache[slot], __ATOMIC_RELAXED);
+    if(cached == 0) return false;
+    Event ce;
+    ce.id = cached;
+    return ((event_base_id(ce) == base) &&
+	    (ID(ce).event.generation >= ID(e).event.generation));
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class EventMessageBatcher
+  //
+
+  namespace Config {
+    int event_batch_latency_us = 0;
+    int event_batch_max_bytes = 4096;
+  };
+
+  /*static*/ EventMessageBatcher *EventMessageBatcher::batcher = 0;
+
+  EventMessageBatcher::Batch::Batch(void)
+    : dbs(0), num_entries(0), oldest_entry_time(0)
+  {}
+
+  EventMessageBatcher::EventMessageBatcher(int _num_nodes,
+					   long long _flush_latency_ns,
+					   size_t _max_batch_bytes)
+    : num_nodes(_num_nodes)
+    , flush_latency_ns(_flush_latency_ns)
+    , max_batch_bytes(_max_batch_bytes)
+    , nonempty_batches(0)
+  {
+    batches.resize(num_nodes);
+    for(int i = 0; i < num_nodes; i++)
+      batches[i] = new Batch;
+  }
+
+  EventMessageBatcher::~EventMessageBatcher(void)
+  {
+    for(int i = 0; i < num_nodes; i++) {
+      assert(batches[i]->num_entries == 0);
+      delete batches[i]->dbs;
+      delete batches[i];
+    }
+  }
+
+  /*static*/ void EventMessageBatcher::init_batching(int num_nodes)
+  {
+    if((Config::event_batch_latency_us <= 0) || (num_nodes <= 1))
+      return;
+
+    batcher = new EventMessageBatcher(num_nodes,
+				      Config::event_batch_latency_us * 1000LL,
+				      Config::event_batch_max_bytes);
+    add_polling_callback(&EventMessageBatcher::polling_callback);
+  }
+
+  /*static*/ void EventMessageBatcher::shutdown_batching(void)
+  {
+    if(!batcher)
+      return;
+
+    batcher->flush(true /*force*/);
+    // leave the batcher in place - a polling thread may still be looking at it
+  }
+
+  /*static*/ void EventMessageBatcher::polling_callback(void)
+  {
+    // quick check without taking any locks
+    if(batcher->nonempty_batches > 0)
+      batcher->flush(false /*!force*/);
+  }
+
+  /*static*/ bool EventMessageBatcher::add_trigger(NodeID target, Event event,
+						   bool poisoned)
+  {
+    if(!batcher)
+      return false;
+
+    batcher->add_entry(target, event,
+		       (poisoned ? BATCH_ENTRY_TRIGGER_POISONED : BATCH_ENTRY_TRIGGER),
+		       0);
+    return true;
+  }
+
+  /*static*/ bool EventMessageBatcher::add_update(NodeID target, Event event,
+						  int num_poisoned,
+						  const EventImpl::gen_t *poisoned_generations)
+  {
+    if(!batcher)
+      return false;
+
+    batcher->add_entry(target, event, num_poisoned, poisoned_generations);
+    return true;
+  }
+
+  struct EventBatchBroadcastHelper {
+    inline void apply(NodeID target)
+    {
+      EventMessageBatcher::add_update(target, event,
+				      num_poisoned, poisoned_generations);
+    }
+
+    Event event;
+    int num_poisoned;
+    const EventImpl::gen_t *poisoned_generations;
+  };
+
+  /*static*/ bool EventMessageBatcher::add_update(const NodeSet& targets, Event event,
+						  int num_poisoned,
+						  const EventImpl::gen_t *poisoned_generations)
+  {
+    if(!batcher)
+      return false;
+
+    EventBatchBroadcastHelper helper;
+    helper.event = event;
+    helper.num_poisoned = num_poisoned;
+    helper.poisoned_generations = poisoned_generations;
+    targets.map(helper);
+    return true;
+  }
+
+  void EventMessageBatcher::add_entry(NodeID target, Event event, int count,
+				      const EventImpl::gen_t *poisoned_generations)
+  {
+    assert((target >= 0) && (target < num_nodes));
+    Batch *b = batches[target];
+
+    int to_send_entries = 0;
+    size_t to_send_bytes = 0;
+    void *to_send = 0;
+    {
+      AutoHSLLock al(b->mutex);
+
+      if(b->num_entries == 0) {
+	if(!b->dbs)
+	  b->dbs = new Serialization::DynamicBufferSerializer(max_batch_bytes);
+	b->oldest_entry_time = Clock::current_time_in_nanoseconds();
+	__sync_fetch_and_add(&nonempty_batches, 1);
+      }
+
+      bool ok = ((*(b->dbs) << event) && (*(b->dbs) << count));
+      if(count > 0)
+	ok = ok && b->dbs->append_bytes(poisoned_generations,
+					count * sizeof(EventImpl::gen_t));
+      assert(ok);
+      b->num_entries++;
+
+      // send right away if we've filled the batch
+      if(b->dbs->bytes_used() >= max_batch_bytes) {
+	to_send_entries = b->num_entries;
+	to_send_bytes = b->dbs->bytes_used();
+	to_send = b->dbs->detach_buffer(-1 /*no trim*/);
+	delete b->dbs;
+	b->dbs = 0;
+	b->num_entries = 0;
+	__sync_fetch_and_sub(&nonempty_batches, 1);
+      }
+    }
+
+    if(to_send)
+      EventBatchMessage::send_request(target, to_send_entries,
+				      to_send, to_send_bytes);
+  }
+
+  void EventMessageBatcher::flush(bool force)
+  {
+    long long now = (force ? 0 : Clock::current_time_in_nanoseconds());
+
+    for(int i = 0; i < num_nodes; i++) {
+      Batch *b = batches[i];
+      // unlocked check to skip empty batches
+      if(b->num_entries == 0)
+	continue;
+
+      int to_send_entries = 0;
+      size_t to_send_bytes = 0;
+      void *to_send = 0;
+      {
+	AutoHSLLock al(b->mutex);
+
+	if((b->num_entries == 0) ||
+	   (!force && ((now - b->oldest_entry_time) < flush_latency_ns)))
+	  continue;
+
+	to_send_entries = b->num_entries;
+	to_send_bytes = b->dbs->bytes_used();
+	to_send = b->dbs->detach_buffer(-1 /*no trim*/);
+	delete b->dbs;
+	b->dbs = 0;
+	b->num_entries = 0;
+	__sync_fetch_and_sub(&nonempty_batches, 1);
+      }
+
+      EventBatchMessage::send_request(i, to_send_entries,
+				      to_send, to_send_bytes);
+    }
+  }
+
+
   /*static*/ void EventSubscribeMessage::send_request(NodeID target, Event event, EventImpl::gen_t previous_gen)
   {
     RequestArgs args;
@@ -1400,8 +2281,19 @@ namespace Realm {
 						       const void *data, size_t datalen)
     {
       const EventImpl::gen_t *new_poisoned_gens = (const EventImpl::gen_t *)data;
-      int new_poisoned_count = datalen / sizeof(EventImpl::gen_t);
-      assert((new_poisoned_count * sizeof(EventImpl::gen_t)) == datalen);  // no remainders or overflow please
+      int new_poisoned_count = args.num_poisoned;
+      size_t poisoned_bytes = new_poisoned_count * sizeof(EventImpl::gen_t);
+      assert(poisoned_bytes <= datalen);
+
+      // anything after the poisoned generations is trigger hints
+      size_t num_hints = (datalen - poisoned_bytes) / sizeof(Event);
+      assert((poisoned_bytes + num_hints * sizeof(Event)) == datalen);  // no remainders or overflow please
+      if(num_hints > 0) {
+	// copy out - the hints aren't necessarily aligned
+	std::vector<Event> hints(num_hints);
+	memcpy(&hints[0], (const char *)data + poisoned_bytes, num_hints * sizeof(Event));
+	EventTriggerHints::apply(&hints[0], num_hints);
+      }
 
       log_event.debug() << "event update: event=" << args.event
 			<< " poisoned=" << ArrayOstreamHelper<EventImpl::gen_t>(new_poisoned_gens, new_poisoned_count);
@@ -1438,7 +2330,9 @@ namespace Realm {
       // perspective yet
       if(!has_local_triggers) {
 	poisoned = false;
-	return false;
+	// a hint piggybacked on some other message from the owner may know better
+	return ((owner != my_node_id) &&
+		EventTriggerHints::known_triggered(make_event(needed_gen)));
       }
 
       // both easy cases failed, so take the lock that lets us see which local triggers exist
@@ -1454,6 +2348,8 @@ namespace Realm {
 	  poisoned = it->second;
 	}
       }
+      if(!locally_triggered && (owner != my_node_id))
+	locally_triggered = EventTriggerHints::known_triggered(make_event(needed_gen));
       return locally_triggered;
     }
 
@@ -1526,6 +2422,9 @@ namespace Realm {
         item.action = EventTraceItem::ACT_TRIGGER;
       }
 #endif
+      EventTraceRing::record((poisoned ? EventTraceRing::ACT_POISON :
+				             EventTraceRing::ACT_TRIGGER),
+			     e.id);
 
       std::vector<EventWaiter *> to_wake;
 
@@ -1534,6 +2433,7 @@ namespace Realm {
 
 	NodeSet to_update;
 	bool free_event = false;
+	bool hintable = false;
 
 	{
 	  AutoHSLLock a(mutex);
@@ -1561,8 +2461,15 @@ namespace Realm {
 
 	  // we'll free the event unless it's maxed out on poisoned generations
 	  free_event = (num_poisoned_generations < POISONED_GENERATION_LIMIT);
+
+	  // other nodes can only be told about triggers in passing if no
+	  //  generation up to this one was poisoned
+	  hintable = (num_poisoned_generations == 0);
 	}
 
+	if(hintable)
+	  EventTriggerHints::record_local_trigger(make_event(gen_triggered));
+
 	// any remote nodes to notify?
 	if(!to_update.empty())
 	  EventUpdateMessage::broadcast_request(to_update, 
@@ -1706,6 +2613,7 @@ namespace Realm {
 	item.action = EventTraceItem::ACT_CREATE;
       }
 #endif
+      EventTraceRing::record(EventTraceRing::ACT_CREATE, impl->current_barrier().id);
       return impl;
     }
 
@@ -1961,6 +2869,14 @@ static void *bytedup(const void *data, size_t datalen)
 	return;
       }
 
+      // untimestamped arrivals headed for another node may be combined with
+      //  others on the way there
+      if((owner != my_node_id) && (timestamp == 0) &&
+	 BarrierArrivalCombiner::add_arrivals(this, barrier_gen, delta,
+					      (reduce_value_size ? 1 : 0),
+					      reduce_value, reduce_value_size))
+	return;
+
       log_barrier.info() << "barrier adjustment: event=" << b
 			 << " delta=" << delta << " ts=" << timestamp;
 
@@ -2138,6 +3054,7 @@ static void *bytedup(const void *data, size_t datalen)
 
       if(trigger_gen != 0) {
 	log_barrier.info() << "barrier trigger: event=" << me << "/" << trigger_gen;
+	EventTraceRing::record(EventTraceRing::ACT_TRIGGER, make_barrier(trigger_gen).id);
 
 	// notify local waiters first
 	Barrier b = make_barrier(trigger_gen);
@@ -2219,6 +3136,8 @@ static void *bytedup(const void *data, size_t datalen)
 
     bool BarrierImpl::add_waiter(gen_t needed_gen, EventWaiter *waiter/*, bool pre_subscribed = false*/)
     {
+      EventTraceRing::record(EventTraceRing::ACT_WAIT, make_barrier(needed_gen).id);
+
       bool trigger_now = false;
       {
 	AutoHSLLock a(mutex);
@@ -2492,4 +3411,235 @@ static void *bytedup(const void *data, size_t datalen)
       Message::request(target, args);
     }
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class BarrierCombineMessage
+  //
+
+  // delivers 'num_values' reduction values (each 'value_size' bytes) and a
+  //  total arrival delta to the local BarrierImpl
+  static void apply_combined_arrivals(Barrier barrier, int delta, int num_values,
+				      const char *values, size_t value_size)
+  {
+    BarrierImpl *impl = get_runtime()->get_barrier_impl(barrier);
+    EventImpl::gen_t gen = ID(barrier).barrier.generation;
+
+    // keep going up the tree if we're not the owner
+    if(BarrierArrivalCombiner::add_arrivals(impl, gen, delta,
+					    num_values, values, value_size))
+      return;
+
+    // all but the last value are applied without any arrivals so that the
+    //  generation cannot trigger until every value is in
+    for(int i = 0; i < num_values - 1; i++)
+      impl->adjust_arrival(gen, 0, 0, Event::NO_EVENT,
+			   my_node_id, false /*!forwarded*/,
+			   values + (i * value_size), value_size);
+    impl->adjust_arrival(gen, delta, 0, Event::NO_EVENT,
+			 my_node_id, false /*!forwarded*/,
+			 (num_values ? (values + ((num_values - 1) * value_size)) : 0),
+			 (num_values ? value_size : 0));
+  }
+
+  /*static*/ void BarrierCombineMessage::handle_request(RequestArgs args,
+							const void *data, size_t datalen)
+  {
+    log_barrier.info() << "received combined barrier arrivals: barrier=" << args.barrier
+		       << " delta=" << args.delta << " values=" << args.num_values;
+    size_t value_size = (args.num_values ? (datalen / args.num_values) : 0);
+    assert((value_size * args.num_values) == datalen);
+    apply_combined_arrivals(args.barrier, args.delta, args.num_values,
+			    (const char *)data, value_size);
+  }
+
+  /*static*/ void BarrierCombineMessage::send_request(NodeID target, Barrier barrier,
+						      int delta, int num_values,
+						      void *data, size_t datalen)
+  {
+    RequestArgs args;
+
+    args.barrier = barrier;
+    args.delta = delta;
+    args.num_values = num_values;
+
+    if(data)
+      Message::request(target, args, data, datalen, PAYLOAD_FREE);
+    else
+      Message::request(target, args, 0, 0, PAYLOAD_NONE);
+  }
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class BarrierArrivalCombiner
+  //
+
+  namespace Config {
+    int barrier_combine_latency_us = 0;
+    int barrier_combine_fanout = 4;
+  };
+
+  /*static*/ BarrierArrivalCombiner *BarrierArrivalCombiner::combiner = 0;
+
+  BarrierArrivalCombiner::BarrierArrivalCombiner(int _num_nodes, int _fanout,
+						 long long _flush_latency_ns)
+    : num_nodes(_num_nodes)
+    , fanout(_fanout)
+    , flush_latency_ns(_flush_latency_ns)
+    , num_pending(0)
+  {}
+
+  BarrierArrivalCombiner::~BarrierArrivalCombiner(void)
+  {
+    assert(pending.empty());
+  }
+
+  /*static*/ void BarrierArrivalCombiner::init_combining(int num_nodes)
+  {
+    if((Config::barrier_combine_latency_us <= 0) || (num_nodes <= 1))
+      return;
+
+    combiner = new BarrierArrivalCombiner(num_nodes,
+					  Config::barrier_combine_fanout,
+					  Config::barrier_combine_latency_us * 1000LL);
+    add_polling_callback(&BarrierArrivalCombiner::polling_callback);
+  }
+
+  /*static*/ void BarrierArrivalCombiner::shutdown_combining(void)
+  {
+    if(!combiner)
+      return;
+
+    combiner->flush(true /*force*/);
+    // leave the combiner in place - a polling thread may still be looking at it
+  }
+
+  /*static*/ void BarrierArrivalCombiner::polling_callback(void)
+  {
+    // quick check without taking any locks
+    if(combiner->num_pending > 0)
+      combiner->flush(false /*!force*/);
+  }
+
+  NodeID BarrierArrivalCombiner::parent_node(NodeID owner) const
+  {
+    if(fanout <= 0)
+      return owner;
+
+    // number nodes relative to the owner, which is the root of the tree
+    int rank = (my_node_id - owner + num_nodes) % num_nodes;
+    assert(rank > 0);
+    int parent_rank = (rank - 1) / fanout;
+    return (owner + parent_rank) % num_nodes;
+  }
+
+  /*static*/ bool BarrierArrivalCombiner::add_arrivals(BarrierImpl *impl,
+						       EventImpl::gen_t barrier_gen,
+						       int delta, int num_values,
+						       const void *values,
+						       size_t value_size)
+  {
+    if(!combiner || (impl->owner == my_node_id))
+      return false;
+
+    Barrier b = impl->make_barrier(barrier_gen);
+
+    log_barrier.info() << "combining barrier arrival: barrier=" << b
+		       << " delta=" << delta << " values=" << num_values;
+
+    // the reduction op is only known on nodes that have seen a trigger of
+    //  this barrier - without it, values are carried along unreduced
+    const ReductionOpUntyped *redop = impl->redop;
+    bool can_fold = ((redop != 0) && redop->is_foldable);
+
+    AutoHSLLock al(combiner->mutex);
+
+    std::map<ID::IDType, Pending>::iterator it = combiner->pending.find(b.id);
+    if(it == combiner->pending.end()) {
+      Pending& p = combiner->pending[b.id];
+      p.barrier = b;
+      p.delta = 0;
+      p.num_values = 0;
+      p.value_size = value_size;
+      p.values = 0;
+      p.oldest_entry_time = Clock::current_time_in_nanoseconds();
+      it = combiner->pending.find(b.id);
+      __sync_fetch_and_add(&combiner->num_pending, 1);
+    }
+    Pending& p = it->second;
+
+    p.delta += delta;
+
+    if(num_values > 0) {
+      if(p.num_values == 0)
+	p.value_size = value_size;
+      else
+	assert(p.value_size == value_size);
+
+      const char *src = (const char *)values;
+      int i = 0;
+      if(can_fold && (p.num_values == 1)) {
+	// fold everything into the one value we already have
+	for(/*nothing*/; i < num_values; i++)
+	  redop->fold(p.values, src + (i * value_size), 1, true /*exclusive*/);
+      } else if(can_fold && (p.num_values == 0)) {
+	p.values = (char *)malloc(value_size);
+	assert(p.values != 0);
+	memcpy(p.values, src, value_size);
+	p.num_values = 1;
+	for(i = 1; i < num_values; i++)
+	  redop->fold(p.values, src + (i * value_size), 1, true /*exclusive*/);
+      } else {
+	p.values = (char *)realloc(p.values, (p.num_values + num_values) * value_size);
+	assert(p.values != 0);
+	memcpy(p.values + (p.num_values * value_size), src, num_values * value_size);
+	p.num_values += num_values;
+      }
+    }
+
+    return true;
+  }
+
+  void BarrierArrivalCombiner::flush(bool force)
+  {
+    long long now = (force ? 0 : Clock::current_time_in_nanoseconds());
+
+    std::vector<Pending> to_send;
+    {
+      AutoHSLLock al(mutex);
+
+      std::map<ID::IDType, Pending>::iterator it = pending.begin();
+      while(it != pending.end()) {
+	if(force || ((now - it->second.oldest_entry_time) >= flush_latency_ns)) {
+	  to_send.push_back(it->second);
+	  pending.erase(it++);
+	  __sync_fetch_and_sub(&num_pending, 1);
+	} else
+	  it++;
+      }
+    }
+
+    for(std::vector<Pending>::const_iterator it = to_send.begin();
+	it != to_send.end();
+	it++) {
+      // ownership may have changed (even to us) while the arrivals were held
+      BarrierImpl *impl = get_runtime()->get_barrier_impl(it->barrier);
+      NodeID owner = impl->owner;
+      if(owner == my_node_id) {
+	apply_combined_arrivals(it->barrier, it->delta, it->num_values,
+				it->values, it->value_size);
+	if(it->values)
+	  free(it->values);
+	continue;
+      }
+
+      NodeID target = parent_node(owner);
+      log_barrier.info() << "sending combined barrier arrivals: barrier=" << it->barrier
+			 << " delta=" << it->delta << " values=" << it->num_values
+			 << " dest=" << target;
+      BarrierCombineMessage::send_request(target, it->barrier, it->delta,
+					  it->num_values, it->values,
+					  it->num_values * it->value_size);
+    }
+  }
+
 }; // namespace Realm
@@ -24,6 +24,7 @@
 #include "realm/faults.h"
 
 #include "realm/activemsg.h"
+#include "realm/serialize.h"
 
 #include <vector>
 #include <map>
@@ -75,6 +76,37 @@ namespace Realm {
       static bool detect_event_chain(Event search_from, Event target, int max_depth, bool print_chain);
     };
 
+    // decides how long Event::wait and Event::external_wait spin before
+    //  giving up the processor - a limit is learned for each kind of wait
+    //  from whether recent waits would have been caught by a longer spin
+    class EventWaitSpinner {
+    public:
+      enum WaitKind {
+	TASK_WAIT,
+	EXTERNAL_WAIT,
+      };
+
+      // registers the spun/blocked wait counters with the sampling profiler
+      static void create_gauges(void);
+
+      // spins until the event triggers (returning true) or the limit for
+      //  this kind of wait runs out - 'start_ns' is needed by record_block
+      static bool spin(Event event, EventImpl *impl, EventImpl::gen_t gen,
+		       bool& poisoned, WaitKind kind, long long& start_ns);
+
+      // called once a wait that couldn't be satisfied by spinning is over
+      static void record_block(Event event, WaitKind kind, long long start_ns);
+
+    protected:
+      static int slot(Event event, WaitKind kind);
+
+      // a genevent and a barrier limit for each kind of wait
+      static const int NUM_SLOTS = 4;
+      // the limit never drops below this, so that it can recover
+      static const long long MIN_SPIN_NS = 250;
+      static long long spin_limit_ns[NUM_SLOTS];
+    };
+
     class GenEventImpl : public EventImpl {
     public:
       static const ID::ID_Types ID_TYPE = ID::ID_EVENT;
@@ -98,6 +130,11 @@ namespace Realm {
 
       virtual bool add_waiter(gen_t needed_gen, EventWaiter *waiter);
 
+      // registers the same waiter on several generations with a single
+      //  mutex acquisition (and at most one subscription) - the waiter must
+      //  not be able to complete until after this returns
+      void add_waiters(const gen_t *needed_gens, size_t count, EventWaiter *waiter);
+
       // creates an event that won't trigger until all input events have
       static Event merge_events(const std::set<Event>& wait_for,
 				bool ignore_faults);
@@ -288,6 +325,7 @@ namespace Realm {
   struct EventUpdateMessage {
     struct RequestArgs : public BaseMedium {
       Event event;
+      int num_poisoned;  // poisoned generations are followed by trigger hints
 
       void apply(NodeID target);
     };
@@ -304,6 +342,138 @@ namespace Realm {
 				  int num_poisoned, const EventImpl::gen_t *poisoned_generations);
   };
 
+  // EventTreeUpdateMessage is used instead of EventUpdateMessage when an event has
+  //   many remote subscribers - each recipient processes the update and then
+  //   forwards it to a subset of the remaining subscribers, so the owner only
+  //   sends O(fanout) messages and the broadcast depth is O(log N)
+
+  struct EventTreeUpdateMessage {
+    struct RequestArgs : public BaseMedium {
+      Event event;
+      int num_poisoned;
+      int num_forwards;
+    };
+
+    static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+    typedef ActiveMessageMediumNoReply<EVENT_TREE_UPDATE_MSGID,
+				       RequestArgs,
+				       handle_request> Message;
+
+    // sends the update to up to 'fanout' of the nodes in [first,last), each
+    //  of which is responsible for forwarding it to its share of the rest
+    static void send_requests(const NodeID *first, const NodeID *last, Event event,
+			      int num_poisoned, const EventImpl::gen_t *poisoned_generations);
+  };
+
+  // EventBatchMessage carries any number of aggregated event triggers and
+  //   updates for a single destination node
+
+  struct EventBatchMessage {
+    struct RequestArgs : public BaseMedium {
+      NodeID sender;
+      int num_entries;
+      int num_hints;  // trigger hints appended after the entries
+    };
+
+    static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+    typedef ActiveMessageMediumNoReply<EVENT_BATCH_MSGID,
+				       RequestArgs,
+				       handle_request> Message;
+
+    // takes ownership of 'data'
+    static void send_request(NodeID target, int num_entries,
+			     void *data, size_t datalen);
+  };
+
+  // every node keeps a small ring of recent triggers of events it owns (as
+  //  long as they have never been poisoned) and piggybacks the ones a given
+  //  node hasn't seen yet on event messages to that node - the receiver
+  //  remembers the newest triggered generation of each remote event in a
+  //  direct-mapped cache that is consulted before declaring a remote event
+  //  untriggered
+  class EventTriggerHints {
+  public:
+    static void init(int num_nodes);
+
+    // called by the owner with the mutex NOT held
+    static void record_local_trigger(Event e);
+
+    // appends hints not yet sent to 'target' and returns how many were added
+    static int collect(NodeID target, std::vector<Event>& hints);
+
+    static void apply(const Event *hints, int count);
+
+    // returns true if the given generation (or a later one) of a remote
+    //  event is known to have triggered without poison
+    static bool known_triggered(Event e);
+
+  protected:
+    static const int RECENT_TRIGGERS = 256;
+
+    static Event::id_t *recent;
+    static unsigned long long recent_count;
+    // how far into 'recent' each node has been told
+    static unsigned long long *sent_upto;
+
+    static Event::id_t *cache;
+    static size_t cache_mask;
+  };
+
+  // when enabled (with a non-zero flush latency), triggers and updates headed
+  //  for the same node are collected into a batch that is sent when it is
+  //  full or when its oldest entry has waited for the flush latency
+  // aged batches are flushed by the network polling thread(s)
+  class EventMessageBatcher {
+  public:
+    EventMessageBatcher(int _num_nodes, long long _flush_latency_ns,
+			size_t _max_batch_bytes);
+    ~EventMessageBatcher(void);
+
+    // returns false if batching is not enabled, in which case the caller
+    //  should send the message itself
+    static bool add_trigger(NodeID target, Event event, bool poisoned);
+    static bool add_update(NodeID target, Event event,
+			   int num_poisoned, const EventImpl::gen_t *poisoned_generations);
+    static bool add_update(const NodeSet& targets, Event event,
+			   int num_poisoned, const EventImpl::gen_t *poisoned_generations);
+
+    // creates the batcher (if enabled by the command line) and hooks it up
+    //  to the network polling
+    static void init_batching(int num_nodes);
+    // sends anything that's left and destroys the batcher
+    static void shutdown_batching(void);
+
+    // sends any batches whose oldest entry has aged out (or all non-empty
+    //  batches if 'force' is set)
+    void flush(bool force);
+
+  protected:
+    static void polling_callback(void);
+
+    void add_entry(NodeID target, Event event, int count,
+		   const EventImpl::gen_t *poisoned_generations);
+
+    struct Batch {
+      Batch(void);
+
+      GASNetHSL mutex;
+      Serialization::DynamicBufferSerializer *dbs;
+      int num_entries;
+      long long oldest_entry_time;
+    };
+
+    static EventMessageBatcher *batcher;
+
+    int num_nodes;
+    long long flush_latency_ns;
+    size_t max_batch_bytes;
+    std::vector<Batch *> batches;
+    // number of non-empty batches - lets the polling callback skip the scan
+    int nonempty_batches;
+  };
+
     struct BarrierAdjustMessage {
       struct RequestArgs : public BaseMedium {
 	int sender;
@@ -382,6 +552,78 @@ namespace Realm {
 
       static void send_request(NodeID target, Barrier barrier, NodeID owner);
     };
+
+    // BarrierCombineMessage carries the combined effect of any number of
+    //  untimestamped arrivals at a single barrier generation - reduction values
+    //  are folded together where the reduction op is known, and concatenated
+    //  otherwise
+
+    struct BarrierCombineMessage {
+      struct RequestArgs : public BaseMedium {
+	Barrier barrier;
+	int delta;
+	int num_values;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<BARRIER_COMBINE_MSGID,
+					 RequestArgs,
+					 handle_request> Message;
+
+      // takes ownership of 'data'
+      static void send_request(NodeID target, Barrier barrier, int delta,
+			       int num_values, void *data, size_t datalen);
+    };
+
+    // when enabled (with a non-zero combining latency), arrivals at barriers
+    //  owned by other nodes are held briefly and combined with any other
+    //  arrivals for the same generation before being sent up a tree rooted
+    //  at the owner - intermediate nodes of the tree combine what they receive
+    //  in the same way, so the owner sees O(fanout) messages per generation
+    // only arrivals without a timestamp (i.e. not ordered against an arrival
+    //  count adjustment) are combined
+    class BarrierArrivalCombiner {
+    public:
+      BarrierArrivalCombiner(int _num_nodes, int _fanout, long long _flush_latency_ns);
+      ~BarrierArrivalCombiner(void);
+
+      static void init_combining(int num_nodes);
+      static void shutdown_combining(void);
+
+      // returns false if combining is not enabled, in which case the caller
+      //  should deliver the arrival(s) itself
+      static bool add_arrivals(BarrierImpl *impl, EventImpl::gen_t barrier_gen,
+			       int delta, int num_values,
+			       const void *values, size_t value_size);
+
+      // sends any combined arrivals that have aged out (or all of them if
+      //  'force' is set)
+      void flush(bool force);
+
+      // the next node on the path from this node to 'owner'
+      NodeID parent_node(NodeID owner) const;
+
+    protected:
+      static void polling_callback(void);
+
+      struct Pending {
+	Barrier barrier;
+	int delta;
+	int num_values;
+	size_t value_size;
+	char *values;
+	long long oldest_entry_time;
+      };
+
+      static BarrierArrivalCombiner *combiner;
+
+      int num_nodes, fanout;
+      long long flush_latency_ns;
+      GASNetHSL mutex;
+      std::map<ID::IDType, Pending> pending;
+      int num_pending;
+    };
 	
 }; // namespace Realm
 
@@ -0,0 +1,169 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "realm/event_trace.h"
+
+#include "realm/activemsg.h"
+#include "realm/timers.h"
+
+#include <string.h>
+#include <errno.h>
+#include <sstream>
+
+namespace Realm {
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class EventTraceRing
+  //
+
+  /*static*/ volatile bool EventTraceRing::enabled = false;
+  /*static*/ size_t EventTraceRing::entries_per_thread = 4096;
+  /*static*/ std::string EventTraceRing::dump_filename;
+  /*static*/ EventTraceRing * volatile EventTraceRing::all_rings = 0;
+  /*static*/ int EventTraceRing::num_rings = 0;
+
+  static __thread EventTraceRing *thread_ring = 0;
+
+  EventTraceRing::EventTraceRing(size_t _capacity)
+    : capacity(_capacity)
+    , num_written(0)
+    , ring_index(0)
+    , next_ring(0)
+  {
+    records = new Record[capacity];
+  }
+
+  /*static*/ void EventTraceRing::configure(size_t _entries_per_thread,
+					    const std::string& _dump_filename)
+  {
+    // round up to a power of two so that ring indexing is a mask
+    size_t cap = 1;
+    while(cap < _entries_per_thread)
+      cap <<= 1;
+    entries_per_thread = cap;
+    dump_filename = _dump_filename;
+  }
+
+  /*static*/ void EventTraceRing::set_enabled(bool _enabled)
+  {
+    enabled = _enabled;
+  }
+
+  /*static*/ EventTraceRing *EventTraceRing::create_ring(void)
+  {
+    EventTraceRing *ring = new EventTraceRing(entries_per_thread);
+    ring->ring_index = __sync_fetch_and_add(&num_rings, 1);
+
+    // lock-free push onto the list of all rings
+    while(true) {
+      EventTraceRing *old_head = all_rings;
+      ring->next_ring = old_head;
+      if(__sync_bool_compare_and_swap(&all_rings, old_head, ring))
+	break;
+    }
+    return ring;
+  }
+
+  /*static*/ void EventTraceRing::record_slow(Action action, Event::id_t id)
+  {
+    EventTraceRing *ring = thread_ring;
+    if(!ring)
+      thread_ring = ring = create_ring();
+
+    size_t idx = ring->num_written;
+    Record& r = ring->records[idx & (ring->capacity - 1)];
+    r.time_ns = Clock::current_time_in_nanoseconds();
+    r.id = id;
+    r.action = action;
+    // publish the record before advancing the count that a dump looks at
+    __sync_synchronize();
+    ring->num_written = idx + 1;
+  }
+
+  static const char *action_name(int action)
+  {
+    switch(action) {
+    case EventTraceRing::ACT_CREATE: return "create";
+    case EventTraceRing::ACT_TRIGGER: return "trigger";
+    case EventTraceRing::ACT_POISON: return "poison";
+    case EventTraceRing::ACT_WAIT: return "wait";
+    default: return "???";
+    }
+  }
+
+  /*static*/ void EventTraceRing::dump(FILE *f)
+  {
+    for(EventTraceRing *ring = all_rings; ring; ring = ring->next_ring) {
+      size_t written = ring->num_written;
+      size_t first = ((written > ring->capacity) ? (written - ring->capacity) : 0);
+      fprintf(f, "EVENT TRACE: node=%d ring=%d records=%zd dropped=%zd\n",
+	      my_node_id, ring->ring_index, written - first, first);
+      for(size_t i = first; i < written; i++) {
+	const Record& r = ring->records[i & (ring->capacity - 1)];
+	fprintf(f, "  %lld " IDFMT " %s\n",
+		r.time_ns, (unsigned long long)r.id, action_name(r.action));
+      }
+    }
+    fflush(f);
+  }
+
+  /*static*/ void EventTraceRing::dump(std::ostream& os)
+  {
+    for(EventTraceRing *ring = all_rings; ring; ring = ring->next_ring) {
+      size_t written = ring->num_written;
+      size_t first = ((written > ring->capacity) ? (written - ring->capacity) : 0);
+      os << "EVENT TRACE: node=" << my_node_id << " ring=" << ring->ring_index
+	 << " records=" << (written - first) << " dropped=" << first << "\n";
+      for(size_t i = first; i < written; i++) {
+	const Record& r = ring->records[i & (ring->capacity - 1)];
+	os << "  " << r.time_ns << " " << std::hex << r.id << std::dec
+	   << " " << action_name(r.action) << "\n";
+      }
+    }
+    os.flush();
+  }
+
+  /*static*/ void EventTraceRing::dump_to_file(bool use_stderr)
+  {
+    if(!all_rings)
+      return;
+
+    if(dump_filename.empty()) {
+      if(use_stderr)
+	dump(stderr);
+      return;
+    }
+
+    // replace % with node number, as the logger does
+    std::string fn = dump_filename;
+    size_t pct = fn.find_first_of('%');
+    if(pct != std::string::npos) {
+      std::ostringstream oss;
+      oss << fn.substr(0, pct) << my_node_id << fn.substr(pct + 1);
+      fn = oss.str();
+    }
+
+    FILE *f = fopen(fn.c_str(), "w");
+    if(!f) {
+      fprintf(stderr, "could not open event trace file '%s': %s\n",
+	      fn.c_str(), strerror(errno));
+      return;
+    }
+    dump(f);
+    fclose(f);
+  }
+
+}; // namespace Realm
@@ -0,0 +1,100 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// always-available, low-overhead tracing of event operations into per-thread
+//  ring buffers
+
+#ifndef REALM_EVENT_TRACE_H
+#define REALM_EVENT_TRACE_H
+
+#include "realm/event.h"
+
+#include <iostream>
+#include <string>
+#include <stdio.h>
+
+namespace Realm {
+
+  // each thread that records an event operation gets its own ring buffer
+  //  holding its most recent operations - recording is lock-free (each ring
+  //  has a single writer) and costs a single load and branch when tracing is
+  //  disabled, so this can be left compiled in and switched on (or off) at
+  //  runtime
+  // rings are never freed, so a dump can safely be performed at any time
+  //  (including from a fault handler or a debugger), although records being
+  //  written concurrently with a dump may be shown torn
+  class EventTraceRing {
+  public:
+    enum Action {
+      ACT_CREATE,
+      ACT_TRIGGER,
+      ACT_POISON,   // a poisoned trigger
+      ACT_WAIT,
+    };
+
+    struct Record {
+      long long time_ns;
+      Event::id_t id;
+      int action;
+    };
+
+    // sets the number of records each thread's ring holds (rounded up to a
+    //  power of two) and the file (with an optional '%' for the node number)
+    //  written by dump_to_file - rings created before this call keep their
+    //  size
+    static void configure(size_t _entries_per_thread,
+			  const std::string& _dump_filename);
+
+    static void set_enabled(bool _enabled);
+    static bool is_enabled(void) { return enabled; }
+
+    static void record(Action action, Event::id_t id)
+    {
+      if(enabled)
+	record_slow(action, id);
+    }
+
+    // writes all rings, oldest record first within each ring
+    static void dump(std::ostream& os);
+    static void dump(FILE *f);
+
+    // writes all rings to the configured file - if none was given, writes to
+    //  stderr if 'use_stderr' is set and otherwise does nothing
+    // does nothing if no records have ever been made
+    static void dump_to_file(bool use_stderr);
+
+  protected:
+    EventTraceRing(size_t _capacity);
+
+    static void record_slow(Action action, Event::id_t id);
+    static EventTraceRing *create_ring(void);
+
+    static volatile bool enabled;
+    static size_t entries_per_thread;
+    static std::string dump_filename;
+    // all rings ever created, linked through 'next_ring'
+    static EventTraceRing * volatile all_rings;
+    static int num_rings;
+
+    Record *records;
+    size_t capacity;  // always a power of two
+    volatile size_t num_written;
+    int ring_index;
+    EventTraceRing *next_ring;
+  };
+
+}; // namespace Realm
+
+#endif // ifndef REALM_EVENT_TRACE_H
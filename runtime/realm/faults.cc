@@ -23,7 +23,10 @@
 #include <execinfo.h>
 #include <cxxabi.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <unwind.h>
 #include <iomanip>
+#include <map>
 
 namespace Realm {
 
@@ -111,12 +114,35 @@ namespace Realm {
     return newhash;
   }
   
+  // glibc's backtrace() can take locks (e.g. to load libgcc_s on first use),
+  //  so walk the stack with the unwinder directly
+  struct UnwindState {
+    intptr_t *pcs;
+    int skip;
+    int count;
+    int max_count;
+  };
+
+  static _Unwind_Reason_Code unwind_callback(struct _Unwind_Context *ctx, void *arg)
+  {
+    UnwindState *state = static_cast<UnwindState *>(arg);
+    if(state->skip > 0) {
+      state->skip--;
+      return _URC_NO_REASON;
+    }
+    intptr_t pc = _Unwind_GetIP(ctx);
+    if(pc == 0)
+      return _URC_END_OF_STACK;
+    state->pcs[state->count++] = pc;
+    return ((state->count < state->max_count) ? _URC_NO_REASON :
+	                                         _URC_END_OF_STACK);
+  }
+
   // captures the current back trace, skipping 'skip' frames, and optionally
   //   limiting the total depth - this is fairly quick as it just walks the stack
   //   and records pointers
   void Backtrace::capture_backtrace(int skip /*= 0*/, int max_depth /*= 0*/)
   {
-    intptr_t *rawptrs;
     // if we weren't given a max depth, pick 100 for now
     if(max_depth <= 0)
       max_depth = 100;
@@ -126,23 +152,51 @@ namespace Realm {
       skip = 0;
     skip++;
 
-    // allocate space for the result of backtrace(), including the stuff on
-    //  the front we're going to skip
-    assert(sizeof(void *) == sizeof(intptr_t));
-    rawptrs = (intptr_t *)alloca(sizeof(void *) * (max_depth + skip));
-    int count = backtrace((void **)rawptrs, max_depth + skip);
-    assert(count >= 0);
-    
+    UnwindState state;
+    state.pcs = (intptr_t *)alloca(sizeof(intptr_t) * max_depth);
+    state.skip = skip;
+    state.count = 0;
+    state.max_count = max_depth;
+    _Unwind_Backtrace(unwind_callback, &state);
+
     pcs.clear();
     symbols.clear();
 
-    if(count > skip)
-      pcs.insert(pcs.end(), rawptrs + skip, rawptrs + count);
+    pcs.insert(pcs.end(), state.pcs, state.pcs + state.count);
 
     // recompute the hash too
     pc_hash = compute_hash();
   }
 
+  // symbol lookups are expensive and the same PCs show up over and over, so
+  //  remember the answers
+  static pthread_mutex_t symbol_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+  static std::map<intptr_t, std::string> symbol_cache;
+
+  /*static*/ std::string Backtrace::lookup_symbol(intptr_t pc)
+  {
+    pthread_mutex_lock(&symbol_cache_mutex);
+    std::map<intptr_t, std::string>::const_iterator it = symbol_cache.find(pc);
+    if(it != symbol_cache.end()) {
+      std::string result = it->second;
+      pthread_mutex_unlock(&symbol_cache_mutex);
+      return result;
+    }
+    pthread_mutex_unlock(&symbol_cache_mutex);
+
+    std::string result;
+    char **s = backtrace_symbols((void * const *)&pc, 1);
+    if(s) {
+      result.assign(s[0]);
+      free(s);
+    }
+
+    pthread_mutex_lock(&symbol_cache_mutex);
+    symbol_cache[pc] = result;
+    pthread_mutex_unlock(&symbol_cache_mutex);
+    return result;
+  }
+
   // attempts to map the pointers in the back trace to symbol names - this can be
   //   more expensive
   void Backtrace::lookup_symbols(void)
@@ -153,15 +207,9 @@ namespace Realm {
     symbols.resize(pcs.size());
 
     for(size_t i = 0; i < pcs.size(); i++) {
-      // try backtrace_symbols() first
-      char **s = backtrace_symbols((void * const *)&(pcs[i]), 1);
-      if(s) {
-	symbols[i].assign(s[0]);
-	free(s);
-	continue;
-      }
-
-      symbols[i] = "unknown";
+      symbols[i] = lookup_symbol(pcs[i]);
+      if(symbols[i].empty())
+	symbols[i] = "unknown";
     }
   }
 
@@ -173,8 +221,12 @@ namespace Realm {
     os << "stack trace: " << bt.pcs.size() << " frames" << std::endl;
     for(size_t i = 0; i < bt.pcs.size(); i++) {
       os << "  [" << i << "] = ";
-      if(!bt.symbols.empty() && !bt.symbols[i].empty()) {
-        char *s = (char *)(bt.symbols[i].c_str());
+      // symbols are looked up here if they weren't already
+      std::string symbol = (bt.symbols.empty() ?
+			      Backtrace::lookup_symbol(bt.pcs[i]) :
+			      bt.symbols[i]);
+      if(!symbol.empty()) {
+        char *s = (char *)(symbol.c_str());
         char *lp = s;
         bool print_raw = true;
         while(*lp && (*lp != '(')) lp++;
@@ -198,7 +250,7 @@ namespace Realm {
           }
         }
         if(print_raw)
-	  os << bt.symbols[i];
+	  os << symbol;
       } else {
         os << std::hex << std::setfill('0') << std::setw(sizeof(intptr_t)*2) << bt.pcs[i];
         os << std::dec << std::setfill(' ');
@@ -71,12 +71,14 @@ namespace Realm {
     bool prune(const Backtrace &other);
 
     // captures the current back trace, skipping 'skip' frames, and optionally
-    //   limiting the total depth - this isn't as simple as as stack walk any more,
-    //   so you probably don't want to ask for these during any normal execution paths
+    //   limiting the total depth - only raw PCs are recorded (no symbol lookup
+    //   and no locks taken), so this is cheap enough to leave enabled
     void capture_backtrace(int skip = 0, int max_depth = 0);
 
     // attempts to map the pointers in the back trace to symbol names - this can be
-    //   much more expensive
+    //   much more expensive, although lookups are cached per PC - printing a
+    //   backtrace does this implicitly, so it's only needed before shipping a
+    //   backtrace to another process
     void lookup_symbols(void);
 
     friend std::ostream& operator<<(std::ostream& os, const Backtrace& bt);
@@ -84,6 +86,10 @@ namespace Realm {
   protected:
     intptr_t compute_hash(int depth = 0) const;
 
+    // returns the (cached) symbol name for a single PC, or an empty string
+    //  if it can't be determined
+    static std::string lookup_symbol(intptr_t pc);
+
     intptr_t pc_hash; // used for fast comparisons
     std::vector<intptr_t> pcs;
     std::vector<std::string> symbols;
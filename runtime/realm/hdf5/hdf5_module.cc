@@ -63,6 +63,8 @@ namespace Realm {
 	CommandLineParser cp;
 
 	cp.add_option_bool("-hdf5:showerrors", m->cfg_showerrors);
+	cp.add_option_int("-hdf5:threads", Config::hdf5_io_threads);
+	cp.add_option_bool("-hdf5:mpio", Config::hdf5_use_mpio);
 	
 	bool ok = cp.parse_command_line(cmdline);
 	if(!ok) {
@@ -102,6 +104,20 @@ namespace Realm {
 			<< (m->threadsafe ? " (thread-safe)" : " (NOT thread-safe)");
       }
 
+      if(Config::hdf5_use_mpio) {
+#ifdef H5_HAVE_PARALLEL
+	int mpi_initialized = 0;
+	MPI_Initialized(&mpi_initialized);
+	if(!mpi_initialized) {
+	  log_hdf5.warning() << "-hdf5:mpio requires MPI to be initialized - ignoring";
+	  Config::hdf5_use_mpio = false;
+	}
+#else
+	log_hdf5.warning() << "HDF5 library was built without parallel support - ignoring -hdf5:mpio";
+	Config::hdf5_use_mpio = false;
+#endif
+      }
+
       hdf5mod = m; // hack for now
       return m;
     }
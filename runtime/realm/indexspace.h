@@ -370,6 +370,27 @@ namespace Realm {
                Event wait_on = Event::NO_EVENT,
                ReductionOpID redop_id = 0, bool red_fold = false) const;
 
+    // indirect copies - 'indirect' names a field of Point<N2,T2>'s covering
+    //  this space, and each point's data is gathered from (or scattered to)
+    //  the point it names in the 'srcs' (or 'dsts') instances, which cover
+    //  'indirect_space' - the index instance must be directly accessible
+    //  from the node that owns the indirectly-addressed instances
+    template <int N2, typename T2>
+    Event gather(const IndexSpace<N2,T2> &indirect_space,
+                 const CopySrcDstField &indirect,
+                 const std::vector<CopySrcDstField> &srcs,
+                 const std::vector<CopySrcDstField> &dsts,
+                 const ProfilingRequestSet &requests,
+                 Event wait_on = Event::NO_EVENT) const;
+
+    template <int N2, typename T2>
+    Event scatter(const IndexSpace<N2,T2> &indirect_space,
+                  const CopySrcDstField &indirect,
+                  const std::vector<CopySrcDstField> &srcs,
+                  const std::vector<CopySrcDstField> &dsts,
+                  const ProfilingRequestSet &requests,
+                  Event wait_on = Event::NO_EVENT) const;
+
     // partitioning operations
 
     // index-based:
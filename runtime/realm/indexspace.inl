@@ -890,9 +890,8 @@ namespace Realm {
       if(e.sparsity.exists()) {
 	assert(0);
       }
-      if(e.bitmap != 0) {
-	assert(0);
-      }
+      if(e.bitmap != 0)
+	return e.bitmap->is_set(p);
       return true;
     } else {
       for(typename std::vector<SparsityMapEntry<N,T> >::const_iterator it = entries.begin();
@@ -902,7 +901,8 @@ namespace Realm {
 	if(it->sparsity.exists()) {
 	  assert(0);
 	} else if(it->bitmap != 0) {
-	  assert(0);
+	  if(it->bitmap->is_set(p))
+	    return true;
 	} else {
 	  return true;
 	}
@@ -946,7 +946,8 @@ namespace Realm {
 	if(it->sparsity.exists()) {
 	  assert(0);
 	} else if(it->bitmap != 0) {
-	  assert(0);
+	  if(it->bitmap->any_set(it->bounds.intersection(r)))
+	    return true;
 	} else {
 	  return true;
 	}
@@ -999,7 +1000,7 @@ namespace Realm {
       if(it->sparsity.exists()) {
 	assert(0);
       } else if(it->bitmap != 0) {
-	assert(0);
+	total += it->bitmap->count_set(isect);
       } else {
 	total += isect.volume();
       }
@@ -1404,9 +1405,12 @@ namespace Realm {
 	rect = restriction.intersection(e.bounds);
 	if(!rect.empty()) {
 	  assert(!e.sparsity.exists());
-	  assert(e.bitmap == 0);
-	  valid = true;
-	  return;
+	  // a bitmap entry is walked one run of set points at a time
+	  if((e.bitmap == 0) ||
+	     e.bitmap->next_run(restriction.intersection(e.bounds), rect, true /*first*/)) {
+	    valid = true;
+	    return;
+	  }
 	}
 	cur_entry++;
       }
@@ -1444,9 +1448,12 @@ namespace Realm {
 	rect = restriction.intersection(e.bounds);
 	if(!rect.empty()) {
 	  assert(!e.sparsity.exists());
-	  assert(e.bitmap == 0);
-	  valid = true;
-	  return;
+	  // a bitmap entry is walked one run of set points at a time
+	  if((e.bitmap == 0) ||
+	     e.bitmap->next_run(restriction.intersection(e.bounds), rect, true /*first*/)) {
+	    valid = true;
+	    return;
+	  }
 	}
 	cur_entry++;
       }
@@ -1467,10 +1474,17 @@ namespace Realm {
       return false;
     }
 
-    // TODO: handle iteration within a sparsity entry
+    const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
+
+    // a bitmap entry may have more runs left in it
+    {
+      const SparsityMapEntry<N,T>& e = entries[cur_entry];
+      if((e.bitmap != 0) &&
+	 e.bitmap->next_run(restriction.intersection(e.bounds), rect, false /*!first*/))
+	return true;
+    }
 
     // move onto the next sparsity entry (that overlaps our restriction)
-    const std::vector<SparsityMapEntry<N,T> >& entries = s_impl->get_entries();
     for(cur_entry++; cur_entry < entries.size(); cur_entry++) {
       const SparsityMapEntry<N,T>& e = entries[cur_entry];
       rect = restriction.intersection(e.bounds);
@@ -1484,7 +1498,9 @@ namespace Realm {
       }
 
       assert(!e.sparsity.exists());
-      assert(e.bitmap == 0);
+      if((e.bitmap != 0) &&
+	 !e.bitmap->next_run(restriction.intersection(e.bounds), rect, true /*first*/))
+	continue;
       return true;
     }
 
@@ -210,6 +210,35 @@ namespace Realm {
       return LegionRuntime::Accessor::RegionAccessor<LegionRuntime::Accessor::AccessorType::Generic>(LegionRuntime::Accessor::AccessorType::Generic::Untyped(*this));
     }
 
+    /*static*/ Event RegionInstance::prefetch_metadata(const std::vector<RegionInstance>& insts)
+    {
+      std::set<Event> wait_on;
+      std::map<NodeID, std::vector<ID::IDType> > to_request;
+      for(std::vector<RegionInstance>::const_iterator it = insts.begin();
+	  it != insts.end();
+	  ++it) {
+	NodeID owner = ID(*it).instance.creator_node;
+	if(owner == my_node_id) continue;
+	RegionInstanceImpl *impl = get_runtime()->get_instance_impl(*it);
+	bool must_send = false;
+	Event e = impl->metadata.begin_request(must_send);
+	if(e.exists())
+	  wait_on.insert(e);
+	if(must_send)
+	  to_request[owner].push_back(it->id);
+      }
+
+      for(std::map<NodeID, std::vector<ID::IDType> >::const_iterator it = to_request.begin();
+	  it != to_request.end();
+	  ++it)
+	if(it->second.size() == 1)
+	  MetadataRequestMessage::send_request(it->first, it->second[0]);
+	else
+	  MetadataBatchRequestMessage::send_request(it->first, it->second);
+
+      return Event::merge_events(wait_on);
+    }
+
     const InstanceLayoutGeneric *RegionInstance::get_layout(void) const
     {
       RegionInstanceImpl *r_impl = get_runtime()->get_instance_impl(*this);
@@ -678,11 +707,15 @@ namespace Realm {
   template <int N, typename T>
   /*static*/ Serialization::PolymorphicSerdezSubclass<InstanceLayoutPiece<N,T>, AffineLayoutPiece<N,T> > AffineLayoutPiece<N,T>::serdez_subclass;
 
+  template <int N, typename T>
+  /*static*/ Serialization::PolymorphicSerdezSubclass<InstanceLayoutPiece<N,T>, BlockedLayoutPiece<N,T> > BlockedLayoutPiece<N,T>::serdez_subclass;
+
   template <int N, typename T>
   /*static*/ Serialization::PolymorphicSerdezSubclass<InstanceLayoutGeneric, InstanceLayout<N,T> > InstanceLayout<N,T>::serdez_subclass;
 
 #define DOIT(N,T) \
   template class AffineLayoutPiece<N,T>; \
+  template class BlockedLayoutPiece<N,T>; \
   template class InstanceLayout<N,T>;
   FOREACH_NT(DOIT)
 #undef DOIT
@@ -26,6 +26,7 @@ namespace Realm {
 
   InstanceLayoutConstraints::InstanceLayoutConstraints(const std::map<FieldID, size_t>& field_sizes,
 						       size_t block_size)
+    : blocked_elements(0)
   {
     // use the field sizes to generate "offsets" as unique IDs
     switch(block_size) {
@@ -65,14 +66,28 @@ namespace Realm {
 
     default:
       {
-	// hybrid - blech
-	assert(0);
+	// hybrid - all fields in the same group, laid out in blocks of
+	//  'block_size' elements
+	field_groups.resize(1);
+	field_groups[0].resize(field_sizes.size());
+	size_t i = 0;
+	for(std::map<FieldID, size_t>::const_iterator it = field_sizes.begin();
+	    it != field_sizes.end();
+	    ++it, ++i) {
+	  field_groups[0][i].field_id = it->first;
+	  field_groups[0][i].offset = -1;
+	  field_groups[0][i].size = it->second;
+	  field_groups[0][i].alignment = it->second; // natural alignment 
+	}
+	blocked_elements = block_size;
+	break;
       }
     }
   }
 
   InstanceLayoutConstraints::InstanceLayoutConstraints(const std::vector<size_t>& field_sizes,
 						       size_t block_size)
+    : blocked_elements(0)
   {
     // use the field sizes to generate "offsets" as unique IDs
     switch(block_size) {
@@ -110,8 +125,20 @@ namespace Realm {
 
     default:
       {
-	// hybrid - blech
-	assert(0);
+	// hybrid - all fields in the same group, laid out in blocks of
+	//  'block_size' elements
+	field_groups.resize(1);
+	field_groups[0].resize(field_sizes.size());
+	size_t offset = 0;
+	for(size_t i = 0; i < field_sizes.size(); i++) {
+	  field_groups[0][i].field_id = offset;
+	  field_groups[0][i].offset = -1;
+	  field_groups[0][i].size = field_sizes[i];
+	  field_groups[0][i].alignment = field_sizes[i]; // natural alignment 
+	  offset += field_sizes[i];
+	}
+	blocked_elements = block_size;
+	break;
       }
     }
   }
@@ -29,7 +29,7 @@ namespace Realm {
 
   class InstanceLayoutConstraints {
   public:
-    InstanceLayoutConstraints(void) { }
+    InstanceLayoutConstraints(void) : blocked_elements(0) { }
     InstanceLayoutConstraints(const std::map<FieldID, size_t>& field_sizes,
 			      size_t block_size);
     InstanceLayoutConstraints(const std::vector<size_t>& field_sizes,
@@ -47,9 +47,17 @@ namespace Realm {
     typedef std::vector<FieldInfo> FieldGroup;
 
     std::vector<FieldGroup> field_groups;
+
+    // if greater than 1, each field group is laid out in blocks of this many
+    //  elements (in the first dimension), with each field's elements in a
+    //  block contiguous and starting on a SIMD-friendly boundary (i.e. an
+    //  "array of structs of arrays") - explicit field offsets are ignored
+    size_t blocked_elements;
   };
 
 
+  template <int N, typename T> class InstanceLayout;
+
   // instance layouts are templated on the type of the IndexSpace used to
   //  index them, but they all inherit from a generic version
   class InstanceLayoutGeneric {
@@ -72,6 +80,13 @@ namespace Realm {
     static InstanceLayoutGeneric *choose_instance_layout(IndexSpace<N,T> is,
 							 const InstanceLayoutConstraints& ilc);
 
+  protected:
+    template <int N, typename T>
+    static void choose_blocked_layout(InstanceLayout<N,T> *layout,
+				      const std::vector<Rect<N,T> >& piece_bounds,
+				      const InstanceLayoutConstraints& ilc);
+
+  public:
     size_t bytes_used;
     size_t alignment_reqd;
 
@@ -103,6 +118,7 @@ namespace Realm {
       InvalidLayoutType,
       AffineLayoutType,
       HDF5LayoutType,
+      BlockedLayoutType,
     };
 
     InstanceLayoutPiece(void);
@@ -149,6 +165,44 @@ namespace Realm {
     size_t offset;
   };
 
+  // in a blocked piece, the first dimension is split into blocks of
+  //  'block_elements' elements - within a block, a field's elements are
+  //  'lane_stride' bytes apart, 'strides[0]' is the distance between blocks,
+  //  and the other dimensions have the usual per-element strides
+  template <int N, typename T>
+  class BlockedLayoutPiece : public InstanceLayoutPiece<N,T> {
+  public:
+    BlockedLayoutPiece(void);
+
+    template <typename S>
+    static InstanceLayoutPiece<N,T> *deserialize_new(S& deserializer);
+
+    virtual size_t calculate_offset(const Point<N,T>& p) const;
+
+    virtual void relocate(size_t base_offset);
+
+    virtual void print(std::ostream& os) const;
+
+    // number of elements from 'p' to the end of its block (inclusive)
+    size_t lanes_left_in_block(const Point<N,T>& p) const;
+
+    // if 'subrect' lies within a single block, provides the affine offset
+    //  and strides that address it (e.g. for an AffineAccessor)
+    bool get_affine_equivalent(const Rect<N,T>& subrect,
+			       size_t& affine_offset,
+			       Point<N, size_t>& affine_strides) const;
+
+    static Serialization::PolymorphicSerdezSubclass<InstanceLayoutPiece<N,T>, BlockedLayoutPiece<N,T> > serdez_subclass;
+
+    template <typename S>
+    bool serialize(S& serializer) const;
+
+    Point<N, size_t> strides;
+    size_t offset;
+    size_t block_elements;
+    size_t lane_stride;
+  };
+
   template <int N, typename T>
   class InstancePieceList {
   public:
@@ -315,6 +369,13 @@ namespace Realm {
     __CUDA_HD__
     FT& operator[](const Point<N,T>& p) const;
 
+    // bulk access: returns a pointer to the element at 'subrect.lo' and sets
+    //  'elements' to the number of elements that can be accessed contiguously
+    //  from there without leaving 'subrect' - the whole subrect if it is dense,
+    //  otherwise the extent of a unit-stride dimension (or 1 if there is none)
+    __CUDA_HD__
+    FT *ptr(const Rect<N,T>& subrect, size_t& elements) const;
+
     __CUDA_HD__
     bool is_dense_arbitrary(const Rect<N,T> &bounds) const; // any dimension ordering
     __CUDA_HD__
@@ -343,6 +404,56 @@ namespace Realm {
   template <typename FT, int N, typename T>
   std::ostream& operator<<(std::ostream& os, const AffineAccessor<FT,N,T>& a);
 
+  // a variant of AffineAccessor whose dimension ordering is fixed at compile
+  //  time - the fastest-varying dimension (0 for COL_MAJOR, N-1 otherwise) is
+  //  known to have a stride of sizeof(FT), which lets the compiler vectorize
+  //  loops over it; the constructors check this against the instance's
+  //  actual layout
+  template <typename FT, int N, typename T = int, bool COL_MAJOR = true>
+  class DenseAffineAccessor {
+  public:
+    static const int FAST_DIM = (COL_MAJOR ? 0 : (N - 1));
+
+    __CUDA_HD__
+    DenseAffineAccessor(void);
+    // NOTE: these constructors will die horribly if the conversion is not
+    //  allowed - call is_compatible(...) first if you're not sure
+
+    // implicitly tries to cover the entire instance's domain
+    DenseAffineAccessor(RegionInstance inst,
+			FieldID field_id, size_t subfield_offset = 0);
+
+    // limits domain to a subrectangle
+    DenseAffineAccessor(RegionInstance inst,
+			FieldID field_id, const Rect<N,T>& subrect,
+			size_t subfield_offset = 0);
+
+    static bool is_compatible(RegionInstance inst, FieldID field_id);
+    static bool is_compatible(RegionInstance inst, FieldID field_id, const Rect<N,T>& subrect);
+
+    __CUDA_HD__
+    FT *ptr(const Point<N,T>& p) const;
+    __CUDA_HD__
+    FT read(const Point<N,T>& p) const;
+    __CUDA_HD__
+    void write(const Point<N,T>& p, FT newval) const;
+
+    __CUDA_HD__
+    FT& operator[](const Point<N,T>& p) const;
+
+    // bulk access: returns a pointer to the element at 'subrect.lo' and sets
+    //  'elements' to the number of contiguous elements along FAST_DIM that
+    //  remain in 'subrect'
+    __CUDA_HD__
+    FT *ptr(const Rect<N,T>& subrect, size_t& elements) const;
+
+    intptr_t base;
+    Point<N, ptrdiff_t> strides;  // strides[FAST_DIM] is always sizeof(FT)
+
+  protected:
+    static bool has_dense_fast_dim(const AffineAccessor<FT,N,T>& a);
+  };
+
 }; // namespace Realm
 
 #include "realm/inst_layout.inl"
@@ -104,6 +104,11 @@ namespace Realm {
       }
     }
 
+    if(ilc.blocked_elements > 1) {
+      choose_blocked_layout(layout, piece_bounds, ilc);
+      return layout;
+    }
+
     // TODO: merge identical piece lists
     layout->piece_lists.resize(ilc.field_groups.size());
     for(size_t li = 0; li < ilc.field_groups.size(); li++) {
@@ -194,6 +199,89 @@ namespace Realm {
     return layout;
   }
 
+  template <int N, typename T>
+  inline /*static*/ void InstanceLayoutGeneric::choose_blocked_layout(InstanceLayout<N,T> *layout,
+								      const std::vector<Rect<N,T> >& piece_bounds,
+								      const InstanceLayoutConstraints& ilc)
+  {
+    size_t lanes = ilc.blocked_elements;
+
+    // first lay out a single block of each group - each field's lanes start
+    //  at a multiple of the instance's (SIMD) alignment, or the field's own
+    //  alignment if that is larger
+    // fields of the same size in a group share a piece list, as their pieces
+    //  differ only in lane stride (the field offset within the block covers
+    //  the rest)
+    std::vector<size_t> block_sizes(ilc.field_groups.size());
+    std::vector<size_t> block_aligns(ilc.field_groups.size());
+    std::vector<std::map<int, int> > lists_by_size(ilc.field_groups.size());
+    int num_lists = 0;
+    for(size_t gi = 0; gi < ilc.field_groups.size(); gi++) {
+      const InstanceLayoutConstraints::FieldGroup& fg = ilc.field_groups[gi];
+      size_t bsize = 0;
+      size_t balign = layout->alignment_reqd;
+      for(std::vector<InstanceLayoutConstraints::FieldInfo>::const_iterator it = fg.begin();
+	  it != fg.end();
+	  ++it) {
+	size_t falign = layout->alignment_reqd;
+	if((it->alignment > 1) && ((falign % it->alignment) != 0))
+	  falign = lcm(falign, size_t(it->alignment));
+	size_t offset = round_up(bsize, falign);
+	bsize = offset + (lanes * it->size);
+	balign = lcm(balign, falign);
+
+	std::map<int, int>::iterator it2 = lists_by_size[gi].find(it->size);
+	if(it2 == lists_by_size[gi].end())
+	  it2 = lists_by_size[gi].insert(std::make_pair(it->size, num_lists++)).first;
+
+	// should not have seen this field before
+	assert(layout->fields.count(it->field_id) == 0);
+	InstanceLayoutGeneric::FieldLayout& fl = layout->fields[it->field_id];
+	fl.list_idx = it2->second;
+	fl.rel_offset = offset;
+	fl.size_in_bytes = it->size;
+      }
+      block_sizes[gi] = round_up(bsize, balign);
+      block_aligns[gi] = balign;
+      layout->alignment_reqd = lcm(layout->alignment_reqd, balign);
+    }
+
+    // all the piece lists must exist before any pieces are added to them
+    layout->piece_lists.resize(num_lists);
+
+    for(size_t gi = 0; gi < ilc.field_groups.size(); gi++) {
+      for(typename std::vector<Rect<N,T> >::const_iterator it = piece_bounds.begin();
+	  it != piece_bounds.end();
+	  ++it) {
+	const Rect<N,T>& bbox = *it;
+
+	size_t piece_start = round_up(layout->bytes_used, block_aligns[gi]);
+	Point<N, size_t> strides;
+	size_t num_blocks = ((bbox.hi[0] - bbox.lo[0]) / lanes) + 1;
+	strides[0] = block_sizes[gi];
+	size_t stride = block_sizes[gi] * num_blocks;
+	for(int i = 1; i < N; i++) {
+	  strides[i] = stride;
+	  stride *= (bbox.hi[i] - bbox.lo[i] + 1);
+	}
+
+	for(std::map<int, int>::const_iterator it2 = lists_by_size[gi].begin();
+	    it2 != lists_by_size[gi].end();
+	    ++it2) {
+	  BlockedLayoutPiece<N,T> *piece = new BlockedLayoutPiece<N,T>;
+	  piece->bounds = bbox;
+	  piece->offset = piece_start;
+	  piece->strides = strides;
+	  piece->block_elements = lanes;
+	  piece->lane_stride = it2->first;
+	  layout->piece_lists[it2->second].pieces.push_back(piece);
+	}
+
+	layout->bytes_used = piece_start + stride;
+      }
+    }
+  }
+
   template <typename S>
   inline bool serialize(S& serializer, const InstanceLayoutGeneric& ilg)
   {
@@ -298,6 +386,93 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class BlockedLayoutPiece<N,T>
+
+  template <int N, typename T>
+  inline BlockedLayoutPiece<N,T>::BlockedLayoutPiece(void)
+    : InstanceLayoutPiece<N,T>(InstanceLayoutPiece<N,T>::BlockedLayoutType)
+  {}
+
+  template <int N, typename T>
+  template <typename S>
+  /*static*/ inline InstanceLayoutPiece<N,T> *BlockedLayoutPiece<N,T>::deserialize_new(S& s)
+  {
+    BlockedLayoutPiece<N,T> *blp = new BlockedLayoutPiece<N,T>;
+    if((s >> blp->bounds) &&
+       (s >> blp->strides) &&
+       (s >> blp->offset) &&
+       (s >> blp->block_elements) &&
+       (s >> blp->lane_stride)) {
+      return blp;
+    } else {
+      delete blp;
+      return 0;
+    }
+  }
+
+  template <int N, typename T>
+  inline size_t BlockedLayoutPiece<N,T>::calculate_offset(const Point<N,T>& p) const
+  {
+    size_t rel = p[0] - this->bounds.lo[0];
+    size_t ofs = (offset +
+		  ((rel / block_elements) * strides[0]) +
+		  ((rel % block_elements) * lane_stride));
+    for(int i = 1; i < N; i++)
+      ofs += (p[i] - this->bounds.lo[i]) * strides[i];
+    return ofs;
+  }
+
+  template <int N, typename T>
+  inline void BlockedLayoutPiece<N,T>::relocate(size_t base_offset)
+  {
+    offset += base_offset;
+  }
+
+  template <int N, typename T>
+  void BlockedLayoutPiece<N,T>::print(std::ostream& os) const
+  {
+    os << this->bounds << "->blocked(" << block_elements << "x" << lane_stride
+       << ":" << strides << "+" << offset << ")";
+  }
+
+  template <int N, typename T>
+  inline size_t BlockedLayoutPiece<N,T>::lanes_left_in_block(const Point<N,T>& p) const
+  {
+    size_t rel = p[0] - this->bounds.lo[0];
+    return (block_elements - (rel % block_elements));
+  }
+
+  template <int N, typename T>
+  inline bool BlockedLayoutPiece<N,T>::get_affine_equivalent(const Rect<N,T>& subrect,
+							     size_t& affine_offset,
+							     Point<N, size_t>& affine_strides) const
+  {
+    size_t rel_lo = subrect.lo[0] - this->bounds.lo[0];
+    size_t rel_hi = subrect.hi[0] - this->bounds.lo[0];
+    if((rel_lo / block_elements) != (rel_hi / block_elements))
+      return false;
+
+    affine_strides = strides;
+    affine_strides[0] = lane_stride;
+    // (unsigned) wraparound is fine here, just as for affine pieces
+    affine_offset = calculate_offset(subrect.lo) - affine_strides.dot(subrect.lo);
+    return true;
+  }
+
+  template <int N, typename T>
+  template <typename S>
+  inline bool BlockedLayoutPiece<N,T>::serialize(S& s) const
+  {
+    return ((s << this->bounds) &&
+	    (s << strides) &&
+	    (s << offset) &&
+	    (s << block_elements) &&
+	    (s << lane_stride));
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class InstancePieceList<N,T>
@@ -717,19 +892,33 @@ namespace Realm {
     const InstancePieceList<N,T>& ipl = layout->piece_lists[it->second.list_idx];
     
     // find the piece that holds the lo corner of the subrect and insist it
-    //  exists, covers the whole subrect, and is affine
+    //  exists, covers the whole subrect, and is affine (or is blocked and
+    //  the subrect is within a single block)
     const InstanceLayoutPiece<N,T> *ilp = ipl.find_piece(subrect.lo);
     assert(ilp && ilp->bounds.contains(subrect));
-    assert((ilp->layout_type == InstanceLayoutPiece<N,T>::AffineLayoutType));
-    const AffineLayoutPiece<N,T> *alp = static_cast<const AffineLayoutPiece<N,T> *>(ilp);
+    size_t piece_offset;
+    if(ilp->layout_type == InstanceLayoutPiece<N,T>::BlockedLayoutType) {
+      const BlockedLayoutPiece<N,T> *blp = static_cast<const BlockedLayoutPiece<N,T> *>(ilp);
+      Point<N, size_t> piece_strides;
+#ifndef NDEBUG
+      bool ok =
+#endif
+	blp->get_affine_equivalent(subrect, piece_offset, piece_strides);
+      assert(ok);
+      strides = piece_strides;
+    } else {
+      assert((ilp->layout_type == InstanceLayoutPiece<N,T>::AffineLayoutType));
+      const AffineLayoutPiece<N,T> *alp = static_cast<const AffineLayoutPiece<N,T> *>(ilp);
+      piece_offset = alp->offset;
+      strides = alp->strides;
+    }
     base = reinterpret_cast<intptr_t>(inst.pointer_untyped(0,
 							   layout->bytes_used));
     assert(base != 0);
-    base += alp->offset + it->second.rel_offset + subfield_offset;
-    strides = alp->strides;
+    base += piece_offset + it->second.rel_offset + subfield_offset;
 #ifdef REALM_ACCESSOR_DEBUG
     dbg_inst = inst;
-    dbg_bounds = alp->bounds;
+    dbg_bounds = ilp->bounds;
 #endif
   }
 
@@ -770,11 +959,17 @@ namespace Realm {
     const InstancePieceList<N,T>& ipl = layout->piece_lists[it->second.list_idx];
     
     // find the piece that holds the lo corner of the subrect and insist it
-    //  exists, covers the whole subrect, and is affine
+    //  exists, covers the whole subrect, and is affine (or is blocked and
+    //  the subrect is within a single block)
     const InstanceLayoutPiece<N,T> *ilp = ipl.find_piece(subrect.lo);
     if(!(ilp && ilp->bounds.contains(subrect)))
       return false;
-    if(ilp->layout_type != InstanceLayoutPiece<N,T>::AffineLayoutType)
+    if(ilp->layout_type == InstanceLayoutPiece<N,T>::BlockedLayoutType) {
+      size_t piece_offset;
+      Point<N, size_t> piece_strides;
+      if(!static_cast<const BlockedLayoutPiece<N,T> *>(ilp)->get_affine_equivalent(subrect, piece_offset, piece_strides))
+	return false;
+    } else if(ilp->layout_type != InstanceLayoutPiece<N,T>::AffineLayoutType)
       return false;
     void *base = inst.pointer_untyped(0, layout->bytes_used);
     if(base == 0)
@@ -826,6 +1021,22 @@ namespace Realm {
     return *(this->get_ptr(p));
   }
 
+  template <typename FT, int N, typename T> __CUDA_HD__
+  inline FT *AffineAccessor<FT,N,T>::ptr(const Rect<N,T>& subrect, size_t& elements) const
+  {
+    if(is_dense_arbitrary(subrect)) {
+      elements = subrect.volume();
+    } else {
+      elements = 1;
+      for(int i = 0; i < N; i++)
+	if(strides[i] == ptrdiff_t(sizeof(FT))) {
+	  elements = subrect.hi[i] - subrect.lo[i] + 1;
+	  break;
+	}
+    }
+    return this->get_ptr(subrect.lo);
+  }
+
   template <typename FT, int N, typename T> __CUDA_HD__
   inline bool AffineAccessor<FT,N,T>::is_dense_arbitrary(const Rect<N,T> &bounds) const
   {
@@ -890,4 +1101,100 @@ namespace Realm {
     return os;
   }
 
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class DenseAffineAccessor<FT,N,T,COL_MAJOR>
+
+  template <typename FT, int N, typename T, bool COL_MAJOR>
+  /*static*/ const int DenseAffineAccessor<FT,N,T,COL_MAJOR>::FAST_DIM;
+
+  template <typename FT, int N, typename T, bool COL_MAJOR>
+  __CUDA_HD__
+  inline DenseAffineAccessor<FT,N,T,COL_MAJOR>::DenseAffineAccessor(void)
+    : base(0)
+  {}
+
+  template <typename FT, int N, typename T, bool COL_MAJOR>
+  inline DenseAffineAccessor<FT,N,T,COL_MAJOR>::DenseAffineAccessor(RegionInstance inst,
+								    FieldID field_id,
+								    size_t subfield_offset /*= 0*/)
+  {
+    AffineAccessor<FT,N,T> a(inst, field_id, subfield_offset);
+    // an empty instance has no strides to check
+    assert((a.base == 0) || has_dense_fast_dim(a));
+    base = a.base;
+    strides = a.strides;
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR>
+  inline DenseAffineAccessor<FT,N,T,COL_MAJOR>::DenseAffineAccessor(RegionInstance inst,
+								    FieldID field_id,
+								    const Rect<N,T>& subrect,
+								    size_t subfield_offset /*= 0*/)
+  {
+    AffineAccessor<FT,N,T> a(inst, field_id, subrect, subfield_offset);
+    assert((a.base == 0) || has_dense_fast_dim(a));
+    base = a.base;
+    strides = a.strides;
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR>
+  inline /*static*/ bool DenseAffineAccessor<FT,N,T,COL_MAJOR>::is_compatible(RegionInstance inst, FieldID field_id)
+  {
+    if(!AffineAccessor<FT,N,T>::is_compatible(inst, field_id))
+      return false;
+    return has_dense_fast_dim(AffineAccessor<FT,N,T>(inst, field_id));
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR>
+  inline /*static*/ bool DenseAffineAccessor<FT,N,T,COL_MAJOR>::is_compatible(RegionInstance inst, FieldID field_id, const Rect<N,T>& subrect)
+  {
+    if(!AffineAccessor<FT,N,T>::is_compatible(inst, field_id, subrect))
+      return false;
+    return has_dense_fast_dim(AffineAccessor<FT,N,T>(inst, field_id, subrect));
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR>
+  inline /*static*/ bool DenseAffineAccessor<FT,N,T,COL_MAJOR>::has_dense_fast_dim(const AffineAccessor<FT,N,T>& a)
+  {
+    return (a.strides[FAST_DIM] == ptrdiff_t(sizeof(FT)));
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR> __CUDA_HD__
+  inline FT *DenseAffineAccessor<FT,N,T,COL_MAJOR>::ptr(const Point<N,T>& p) const
+  {
+    // the fast dimension's stride is a compile-time constant
+    intptr_t rawptr = base + (p[FAST_DIM] * ptrdiff_t(sizeof(FT)));
+    for(int i = 0; i < N; i++)
+      if(i != FAST_DIM)
+	rawptr += p[i] * strides[i];
+    return reinterpret_cast<FT *>(rawptr);
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR> __CUDA_HD__
+  inline FT DenseAffineAccessor<FT,N,T,COL_MAJOR>::read(const Point<N,T>& p) const
+  {
+    return *(this->ptr(p));
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR> __CUDA_HD__
+  inline void DenseAffineAccessor<FT,N,T,COL_MAJOR>::write(const Point<N,T>& p, FT newval) const
+  {
+    *(this->ptr(p)) = newval;
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR> __CUDA_HD__
+  inline FT& DenseAffineAccessor<FT,N,T,COL_MAJOR>::operator[](const Point<N,T>& p) const
+  {
+    return *(this->ptr(p));
+  }
+
+  template <typename FT, int N, typename T, bool COL_MAJOR> __CUDA_HD__
+  inline FT *DenseAffineAccessor<FT,N,T,COL_MAJOR>::ptr(const Rect<N,T>& subrect, size_t& elements) const
+  {
+    elements = subrect.hi[FAST_DIM] - subrect.lo[FAST_DIM] + 1;
+    return this->ptr(subrect.lo);
+  }
+
 }; // namespace Realm
@@ -104,6 +104,11 @@ namespace Realm {
 
     Event get_ready_event(void) const;
 
+    // starts fetching the metadata for each of the given instances that
+    //  isn't already valid on this node (with one request message per owner
+    //  node) and returns an event that triggers once all of it has arrived
+    static Event prefetch_metadata(const std::vector<RegionInstance>& insts);
+
     // calls to create_instance return immediately with a handle, but also
     //  return an event that must be used as a precondition for any use (or
     //  destruction) of the instance
@@ -176,6 +181,15 @@ namespace Realm {
 				      Event wait_on = Event::NO_EVENT);
 #endif
 
+    // hints that the given part of a file or HDF5 instance will be copied
+    //  from soon - its data is read into staging buffers in the background
+    //  so those copies needn't wait on the file (ignored for other kinds of
+    //  instances, if the instance is not local or not yet ready, or unless
+    //  staging is enabled with -ll:staging_mb)
+    template <int N, typename T>
+    void prefetch(const Rect<N,T>& subrect,
+		  const std::vector<FieldID>& field_ids) const;
+
     void destroy(Event wait_on = Event::NO_EVENT) const;
 
     AddressSpace address_space(void) const;
@@ -101,6 +101,69 @@ namespace Realm {
     TreeNode *root;
     size_t count;
   };
+
+  // a flattened alternative to IntervalTree for interval sets that are built
+  //  once and then queried many times - intervals are kept sorted by start in
+  //  plain arrays and the tree is implicit in the array indices (each node
+  //  also records the largest end point in its subtree), so a query touches
+  //  a handful of contiguous cache lines instead of chasing node pointers
+  //
+  // intervals are inclusive on both ends, like IntervalTree, and the query
+  //  methods have the same names and marker interface
+  template <typename IT, typename LT>
+  class FlatIntervalTree {
+  public:
+    FlatIntervalTree(void);
+    ~FlatIntervalTree(void);
+
+    bool empty(void) const;
+    size_t size(void) const;
+
+    // added intervals are not visible to queries until construct_tree
+    void add_interval(IT iv_start, IT iv_end, LT iv_label);
+
+    template <typename IR>
+    void add_intervals(const IR& iv_ranges, LT iv_label);
+
+    // (re)builds the whole tree in O(n log n), including any intervals that
+    //  were already present
+    void construct_tree(void);
+
+    template <typename MARKER>
+    void test_interval(IT iv_start, IT iv_end, MARKER& marker) const;
+
+    void test_interval(IT iv_start, IT iv_end, std::vector<bool>& labels_found) const;
+    void test_interval(IT iv_start, IT iv_end, std::set<LT>& labels_found) const;
+
+    // batch queries - 'iv_ranges' need not be sorted
+    template <typename IR, typename MARKER>
+    void test_intervals(const IR& iv_ranges, MARKER& marker) const;
+
+    template <typename IR>
+    void test_intervals(const IR& iv_ranges, std::vector<bool>& labels_found) const;
+
+    template <typename IR>
+    void test_intervals(const IR& iv_ranges, std::set<LT>& labels_found) const;
+
+    // provided for compatibility with IntervalTree - sorting gives no extra
+    //  benefit here
+    template <typename IR, typename MARKER>
+    void test_sorted_intervals(const IR& iv_ranges, MARKER& marker) const;
+
+    template <typename IR>
+    void test_sorted_intervals(const IR& iv_ranges, std::vector<bool>& labels_found) const;
+
+    template <typename IR>
+    void test_sorted_intervals(const IR& iv_ranges, std::set<LT>& labels_found) const;
+
+  protected:
+    std::vector<IT> pending_starts, pending_ends;
+    std::vector<LT> pending_labels;
+    // sorted by start, with max_ends[i] covering the subtree rooted at i
+    std::vector<IT> starts, ends, max_ends;
+    std::vector<LT> labels;
+    int max_level;  // level of the root, or -1 if empty
+  };
       
 };
 
@@ -516,4 +516,250 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class FlatIntervalTree<IT,LT>
+
+  // the implicit tree is laid over the sorted arrays: leaves are the even
+  //  indices, and a node at level k has an index whose low k bits are all
+  //  ones, with children at index -/+ 2^(k-1) - the tree is complete, so some
+  //  internal nodes on the right edge lie beyond the end of the arrays and
+  //  have no interval of their own
+
+  template <typename IT, typename LT>
+  inline FlatIntervalTree<IT,LT>::FlatIntervalTree(void)
+    : max_level(-1)
+  {}
+
+  template <typename IT, typename LT>
+  inline FlatIntervalTree<IT,LT>::~FlatIntervalTree(void)
+  {}
+
+  template <typename IT, typename LT>
+  inline bool FlatIntervalTree<IT,LT>::empty(void) const
+  {
+    return starts.empty();
+  }
+
+  template <typename IT, typename LT>
+  inline size_t FlatIntervalTree<IT,LT>::size(void) const
+  {
+    return starts.size();
+  }
+
+  template <typename IT, typename LT>
+  inline void FlatIntervalTree<IT,LT>::add_interval(IT iv_start, IT iv_end, LT iv_label)
+  {
+    // ignore empty intervals
+    if(iv_start > iv_end)
+      return;
+    pending_starts.push_back(iv_start);
+    pending_ends.push_back(iv_end);
+    pending_labels.push_back(iv_label);
+  }
+
+  template <typename IT, typename LT>
+  template <typename IR>
+  inline void FlatIntervalTree<IT,LT>::add_intervals(const IR& iv_ranges, LT iv_label)
+  {
+    size_t new_count = iv_ranges.size();
+    pending_starts.reserve(pending_starts.size() + new_count);
+    pending_ends.reserve(pending_ends.size() + new_count);
+    pending_labels.reserve(pending_labels.size() + new_count);
+    for(size_t i = 0; i < new_count; i++) {
+      if(iv_ranges.start(i) > iv_ranges.end(i)) continue;
+      pending_starts.push_back(iv_ranges.start(i));
+      pending_ends.push_back(iv_ranges.end(i));
+      pending_labels.push_back(iv_label);
+    }
+  }
+
+  template <typename IT, typename LT>
+  inline void FlatIntervalTree<IT,LT>::construct_tree(void)
+  {
+    // gather old and new intervals and sort them (via a permutation) by start
+    std::vector<IT> all_starts(starts);
+    std::vector<IT> all_ends(ends);
+    std::vector<LT> all_labels(labels);
+    all_starts.insert(all_starts.end(), pending_starts.begin(), pending_starts.end());
+    all_ends.insert(all_ends.end(), pending_ends.begin(), pending_ends.end());
+    all_labels.insert(all_labels.end(), pending_labels.begin(), pending_labels.end());
+    pending_starts.clear();
+    pending_ends.clear();
+    pending_labels.clear();
+
+    size_t n = all_starts.size();
+    std::vector<int> order(n);
+    for(size_t i = 0; i < n; i++)
+      order[i] = i;
+    std::sort(order.begin(), order.end(), StartSorter<IT>(all_starts));
+
+    starts.resize(n);
+    ends.resize(n);
+    labels.resize(n);
+    max_ends.resize(n);
+    for(size_t i = 0; i < n; i++) {
+      starts[i] = all_starts[order[i]];
+      ends[i] = all_ends[order[i]];
+      labels[i] = all_labels[order[i]];
+    }
+
+    if(n == 0) {
+      max_level = -1;
+      return;
+    }
+
+    // leaves first
+    size_t last_i = 0;
+    IT last_max = ends[0];
+    for(size_t i = 0; i < n; i += 2) {
+      last_i = i;
+      last_max = max_ends[i] = ends[i];
+    }
+
+    // then each level of internal nodes - 'last_i'/'last_max' track the
+    //  rightmost real node on the level below, which stands in for a right
+    //  child that lies past the end of the arrays
+    int k = 1;
+    for(; (size_t(1) << k) <= n; k++) {
+      size_t x = size_t(1) << (k - 1);
+      size_t i0 = (x << 1) - 1;
+      size_t step = x << 2;
+      for(size_t i = i0; i < n; i += step) {
+	IT e = ends[i];
+	if(max_ends[i - x] > e) e = max_ends[i - x];
+	IT e_right = ((i + x) < n) ? max_ends[i + x] : last_max;
+	if(e_right > e) e = e_right;
+	max_ends[i] = e;
+      }
+      last_i = ((last_i >> k) & 1) ? (last_i - x) : (last_i + x);
+      if((last_i < n) && (max_ends[last_i] > last_max))
+	last_max = max_ends[last_i];
+    }
+    max_level = k - 1;
+  }
+
+  template <typename IT, typename LT>
+  template <typename MARKER>
+  inline void FlatIntervalTree<IT,LT>::test_interval(IT iv_start, IT iv_end,
+						     MARKER& marker) const
+  {
+    if(max_level < 0)
+      return;
+
+    // iterative walk - each entry is a node index, its level, and whether
+    //  its left subtree has already been handled
+    struct StackEntry {
+      size_t x;
+      int k;
+      bool left_done;
+    };
+    // at most two entries per level
+    StackEntry stack[2 * (8 * sizeof(size_t)) + 2];
+    int depth = 0;
+    size_t n = starts.size();
+
+    stack[depth].x = (size_t(1) << max_level) - 1;
+    stack[depth].k = max_level;
+    stack[depth].left_done = false;
+    depth++;
+
+    while(depth > 0) {
+      StackEntry z = stack[--depth];
+      if(z.k <= 3) {
+	// small subtrees are cheaper to scan linearly
+	size_t i0 = (z.x >> z.k) << z.k;
+	size_t i1 = i0 + (size_t(1) << (z.k + 1)) - 1;
+	if(i1 > n) i1 = n;
+	for(size_t i = i0; (i < i1) && (starts[i] <= iv_end); i++)
+	  if(ends[i] >= iv_start)
+	    marker.mark_overlap(starts[i], ends[i], labels[i]);
+      } else if(!z.left_done) {
+	// revisit this node after its left subtree, which is only worth
+	//  walking if something in it reaches iv_start
+	size_t y = z.x - (size_t(1) << (z.k - 1));
+	stack[depth].x = z.x;
+	stack[depth].k = z.k;
+	stack[depth].left_done = true;
+	depth++;
+	if((y >= n) || (max_ends[y] >= iv_start)) {
+	  stack[depth].x = y;
+	  stack[depth].k = z.k - 1;
+	  stack[depth].left_done = false;
+	  depth++;
+	}
+      } else if((z.x < n) && (starts[z.x] <= iv_end)) {
+	// everything to the right starts at or after this node
+	if(ends[z.x] >= iv_start)
+	  marker.mark_overlap(starts[z.x], ends[z.x], labels[z.x]);
+	stack[depth].x = z.x + (size_t(1) << (z.k - 1));
+	stack[depth].k = z.k - 1;
+	stack[depth].left_done = false;
+	depth++;
+      }
+    }
+  }
+
+  template <typename IT, typename LT>
+  inline void FlatIntervalTree<IT,LT>::test_interval(IT iv_start, IT iv_end, std::vector<bool>& labels_found) const
+  {
+    VectorMarker<IT,LT> marker(labels_found);
+    test_interval(iv_start, iv_end, marker);
+  }
+
+  template <typename IT, typename LT>
+  inline void FlatIntervalTree<IT,LT>::test_interval(IT iv_start, IT iv_end, std::set<LT>& labels_found) const
+  {
+    SetMarker<IT,LT> marker(labels_found);
+    test_interval(iv_start, iv_end, marker);
+  }
+
+  template <typename IT, typename LT>
+  template <typename IR, typename MARKER>
+  inline void FlatIntervalTree<IT,LT>::test_intervals(const IR& iv_ranges, MARKER& marker) const
+  {
+    for(size_t i = 0; i < iv_ranges.size(); i++)
+      test_interval(iv_ranges.start(i), iv_ranges.end(i), marker);
+  }
+
+  template <typename IT, typename LT>
+  template <typename IR>
+  void FlatIntervalTree<IT,LT>::test_intervals(const IR& iv_ranges, std::vector<bool>& labels_found) const
+  {
+    VectorMarker<IT,LT> marker(labels_found);
+    test_intervals(iv_ranges, marker);
+  }
+
+  template <typename IT, typename LT>
+  template <typename IR>
+  void FlatIntervalTree<IT,LT>::test_intervals(const IR& iv_ranges, std::set<LT>& labels_found) const
+  {
+    SetMarker<IT,LT> marker(labels_found);
+    test_intervals(iv_ranges, marker);
+  }
+
+  template <typename IT, typename LT>
+  template <typename IR, typename MARKER>
+  inline void FlatIntervalTree<IT,LT>::test_sorted_intervals(const IR& iv_ranges, MARKER& marker) const
+  {
+    test_intervals(iv_ranges, marker);
+  }
+
+  template <typename IT, typename LT>
+  template <typename IR>
+  void FlatIntervalTree<IT,LT>::test_sorted_intervals(const IR& iv_ranges, std::vector<bool>& labels_found) const
+  {
+    VectorMarker<IT,LT> marker(labels_found);
+    test_intervals(iv_ranges, marker);
+  }
+
+  template <typename IT, typename LT>
+  template <typename IR>
+  void FlatIntervalTree<IT,LT>::test_sorted_intervals(const IR& iv_ranges, std::set<LT>& labels_found) const
+  {
+    SetMarker<IT,LT> marker(labels_found);
+    test_intervals(iv_ranges, marker);
+  }
+
+
 }; // namespace Realm
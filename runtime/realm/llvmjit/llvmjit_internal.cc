@@ -28,6 +28,13 @@
 #include <llvm-c/ExecutionEngine.h>
 #include <llvm-c/IRReader.h>
 
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
 #define LLVM_VERSION (10 * LLVM_VERSION_MAJOR) + LLVM_VERSION_MINOR
 #if REALM_LLVM_VERSION != LLVM_VERSION
   #error mismatch between REALM_LLVM_VERSION and LLVM header files!
@@ -42,6 +49,17 @@
   #warning unsupported (or at least untested) LLVM version!
 #endif
 
+// the object cache needs the C++ API, which can't be made weak, and the
+//  object cache interface we use appeared in 3.6
+#if !defined(REALM_ALLOW_MISSING_LLVM_LIBS) && !defined(USE_OLD_JIT) && (LLVM_VERSION >= 36)
+  #define USE_OBJECT_CACHE
+  #include <llvm/ExecutionEngine/ExecutionEngine.h>
+  #include <llvm/ExecutionEngine/ObjectCache.h>
+  #include <llvm/IR/Module.h>
+  #include <llvm/Support/Host.h>
+  #include <llvm/Support/MemoryBuffer.h>
+#endif
+
 #ifdef REALM_ALLOW_MISSING_LLVM_LIBS
 // declare all of the LLVM C API calls we use as weak symbols
 #pragma weak LLVMAddModule
@@ -117,6 +135,107 @@ namespace Realm {
     };
 #endif
 
+    // 64-bit FNV-1a - only has to be good enough to tell IR blobs apart
+    static uint64_t hash_bytes(const void *data, size_t len,
+			       uint64_t h = 0xcbf29ce484222325ULL)
+    {
+      const unsigned char *p = static_cast<const unsigned char *>(data);
+      for(size_t i = 0; i < len; i++) {
+	h ^= p[i];
+	h *= 0x100000001b3ULL;
+      }
+      return h;
+    }
+
+    static std::string hash_to_string(uint64_t h)
+    {
+      char buffer[20];
+      snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)h);
+      return buffer;
+    }
+
+#ifdef USE_OBJECT_CACHE
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class JitObjectCache
+
+    // MCJIT asks this before compiling a module and tells it about the
+    //  object code afterwards - modules are named after the hash of their IR,
+    //  and the target (triple and host cpu/features) is folded into the
+    //  file name as well
+    class JitObjectCache : public llvm::ObjectCache {
+    public:
+      JitObjectCache(const std::string& _directory, const std::string& triple)
+	: directory(_directory)
+	, target_hash(0)
+      {
+	std::string target = triple;
+	target += ':';
+	target += llvm::sys::getHostCPUName().str();
+	llvm::StringMap<bool> features;
+	if(llvm::sys::getHostCPUFeatures(features))
+	  for(llvm::StringMap<bool>::const_iterator it = features.begin();
+	      it != features.end();
+	      ++it)
+	    if(it->getValue())
+	      target_hash ^= hash_bytes(it->getKey().data(), it->getKey().size());
+	target_hash ^= hash_bytes(target.data(), target.size());
+	log_llvmjit.info() << "object cache: dir=" << directory << " target=" << target;
+
+	// create the directory if needed - racing with other processes is fine
+	if((mkdir(directory.c_str(), 0777) != 0) && (errno != EEXIST))
+	  log_llvmjit.warning() << "could not create object cache directory '" << directory << "': " << strerror(errno);
+      }
+
+      virtual void notifyObjectCompiled(const llvm::Module *m,
+					llvm::MemoryBufferRef obj)
+      {
+	std::string filename = object_filename(m);
+	// write to a temporary file first so that concurrent readers never
+	//  see a partial object
+	std::string tmpname = filename + "." + hash_to_string(getpid());
+	FILE *f = fopen(tmpname.c_str(), "wb");
+	if(!f) {
+	  log_llvmjit.warning() << "could not write object cache entry '" << tmpname << "': " << strerror(errno);
+	  return;
+	}
+	size_t written = fwrite(obj.getBufferStart(), 1, obj.getBufferSize(), f);
+	bool ok = ((fclose(f) == 0) && (written == obj.getBufferSize()));
+	if(ok && (rename(tmpname.c_str(), filename.c_str()) == 0)) {
+	  log_llvmjit.debug() << "object cache store: " << filename << " (" << written << " bytes)";
+	} else {
+	  log_llvmjit.warning() << "could not write object cache entry '" << filename << "'";
+	  unlink(tmpname.c_str());
+	}
+      }
+
+      virtual std::unique_ptr<llvm::MemoryBuffer> getObject(const llvm::Module *m)
+      {
+	std::string filename = object_filename(m);
+	llvm::ErrorOr<std::unique_ptr<llvm::MemoryBuffer> > mb = llvm::MemoryBuffer::getFile(filename);
+	if(!mb) {
+	  log_llvmjit.debug() << "object cache miss: " << filename;
+	  return nullptr;
+	}
+	log_llvmjit.debug() << "object cache hit: " << filename;
+	return std::move(mb.get());
+      }
+
+    protected:
+      std::string object_filename(const llvm::Module *m) const
+      {
+	return (directory + "/" + m->getModuleIdentifier() + "-" +
+		hash_to_string(target_hash) + ".o");
+      }
+
+      std::string directory;
+      uint64_t target_hash;
+    };
+#else
+    // no object cache support in this build
+    class JitObjectCache {};
+#endif
+
     ////////////////////////////////////////////////////////////////////////
     //
     // class LLVMJitInternal
@@ -131,7 +250,8 @@ namespace Realm {
     }
 #endif
 
-    LLVMJitInternal::LLVMJitInternal(void)
+    LLVMJitInternal::LLVMJitInternal(const std::string& cache_dir)
+      : object_cache(0)
     {
       context = LLVMContextCreate();
 
@@ -211,6 +331,15 @@ namespace Realm {
 #endif
 	}
 
+	if(!cache_dir.empty()) {
+#ifdef USE_OBJECT_CACHE
+	  object_cache = new JitObjectCache(cache_dir, triple);
+	  llvm::unwrap(host_exec_engine)->setObjectCache(object_cache);
+#else
+	  log_llvmjit.warning() << "object cache not supported by this build - ignoring cache directory";
+#endif
+	}
+
 	// should be safe to dispose of triple now?
 	LLVMDisposeMessage(triple);
       }
@@ -222,6 +351,7 @@ namespace Realm {
     {
       LLVMDisposeExecutionEngine(host_exec_engine);
       LLVMContextDispose(context);
+      delete object_cache;
     }
 
     void *LLVMJitInternal::llvmir_to_fnptr(const ByteArray& ir,
@@ -231,6 +361,11 @@ namespace Realm {
       if(!host_exec_engine)
 	return 0;
 
+      // the module is named after the buffer, which is named after the IR,
+      //  so that the object cache can find code compiled from the same IR
+      std::string modname = "realm_jit_" + hash_to_string(hash_bytes(ir.base(),
+								       ir.size()));
+
       // may need to manually add null-termination here
       LLVMMemoryBufferRef mb;
       if((ir.size() == 0) || (((const char *)(ir.base()))[ir.size() - 1] != 0)) {
@@ -240,12 +375,12 @@ namespace Realm {
 	nullterm[ir.size()] = 0;
 	mb = LLVMCreateMemoryBufferWithMemoryRangeCopy(nullterm,
 	                                               ir.size()+1,
-	                                               "membuf");
+	                                               modname.c_str());
 	delete[] nullterm;
       } else {
 	mb = LLVMCreateMemoryBufferWithMemoryRange((const char *)(ir.base()),
 						   ir.size(),
-						   "membuf",
+						   modname.c_str(),
 						   true /*RequiresTerminator*/);
       }
 
@@ -29,9 +29,13 @@ typedef struct LLVMTarget *LLVMTargetRef;
 namespace Realm {
   namespace LLVMJit {
 
+    class JitObjectCache;
+
     class LLVMJitInternal {
     public:
-      LLVMJitInternal(void);
+      // if 'cache_dir' is non-empty, compiled object code is saved there and
+      //  reused by later processes that JIT the same IR for the same target
+      LLVMJitInternal(const std::string& cache_dir);
       ~LLVMJitInternal(void);
 
       void *llvmir_to_fnptr(const ByteArray& ir, const std::string& entry_symbol);
@@ -44,6 +48,7 @@ namespace Realm {
       LLVMContextRef context;
       LLVMExecutionEngineRef host_exec_engine;
       LLVMTargetRef nvptx_machine;
+      JitObjectCache *object_cache;
     };
 
   }; // namespace LLVMJit
@@ -60,6 +60,7 @@ namespace Realm {
       virtual void cleanup(void);
 
     public:
+      std::string cfg_cache_dir;
 
       LLVMJitInternal *internal;
     };
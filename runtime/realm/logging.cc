@@ -20,15 +20,18 @@
 #include "realm/activemsg.h"
 
 #include "realm/cmdline.h"
+#include "realm/timers.h"
 
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <errno.h>
+#include <stdint.h>
 
 #include <set>
 #include <map>
+#include <deque>
 
 namespace Realm {
 
@@ -136,6 +139,260 @@ namespace Realm {
     pthread_mutex_t mutex;
   };
 
+  // per-thread buffering of log output - each thread appends to its own
+  //  chunk without taking any locks, and a background thread (or an explicit
+  //  flush) drains the chunks of all threads into the inner stream
+  class LoggerStreamBuffered : public LoggerOutputStream {
+  public:
+    LoggerStreamBuffered(LoggerOutputStream *_stream, size_t _chunk_size,
+			 int _flush_interval_ms);
+    virtual ~LoggerStreamBuffered(void);
+
+    virtual void write(const char *buffer, size_t len);
+    virtual void flush(void);
+
+  protected:
+    struct Chunk {
+      char *data;
+      volatile size_t used;  // written only by the owning thread
+      size_t flushed;        // written only while holding the mutex
+    };
+
+    struct ThreadBuffer {
+      LoggerStreamBuffered *owner;
+      Chunk *current;        // only changed while holding the mutex
+      bool exited;
+    };
+
+    ThreadBuffer *register_thread(void);
+    Chunk *alloc_chunk(void);
+    void drain_chunk(Chunk *c);
+    void drain_all(void);
+
+    static void thread_exit(void *arg);
+    static void *flusher_thread_entry(void *arg);
+    void flusher_thread_loop(void);
+
+    LoggerOutputStream *stream;
+    size_t chunk_size;
+    int flush_interval_ms;
+    pthread_key_t tls_key;
+    pthread_mutex_t mutex;
+    pthread_cond_t condvar;
+    pthread_t flusher_thread;
+    bool shutdown_requested;
+    std::vector<ThreadBuffer *> threads;
+    std::deque<Chunk *> retired_chunks;  // in retirement order
+    std::vector<Chunk *> free_chunks;
+  };
+
+  LoggerStreamBuffered::LoggerStreamBuffered(LoggerOutputStream *_stream,
+					     size_t _chunk_size,
+					     int _flush_interval_ms)
+    : stream(_stream), chunk_size(_chunk_size)
+    , flush_interval_ms(_flush_interval_ms), shutdown_requested(false)
+  {
+    pthread_key_create(&tls_key, &LoggerStreamBuffered::thread_exit);
+    pthread_mutex_init(&mutex, 0);
+    pthread_cond_init(&condvar, 0);
+#ifndef NDEBUG
+    int ret =
+#endif
+      pthread_create(&flusher_thread, 0,
+		     &LoggerStreamBuffered::flusher_thread_entry, this);
+    assert(ret == 0);
+  }
+
+  LoggerStreamBuffered::~LoggerStreamBuffered(void)
+  {
+    pthread_mutex_lock(&mutex);
+    shutdown_requested = true;
+    pthread_cond_signal(&condvar);
+    pthread_mutex_unlock(&mutex);
+    pthread_join(flusher_thread, 0);
+
+    // no more thread exit callbacks after this
+    pthread_key_delete(tls_key);
+
+    drain_all();
+    stream->flush();
+    for(std::vector<ThreadBuffer *>::iterator it = threads.begin();
+	it != threads.end();
+	it++) {
+      free_chunks.push_back((*it)->current);
+      delete *it;
+    }
+    for(std::vector<Chunk *>::iterator it = free_chunks.begin();
+	it != free_chunks.end();
+	it++) {
+      free((*it)->data);
+      delete *it;
+    }
+
+    pthread_cond_destroy(&condvar);
+    pthread_mutex_destroy(&mutex);
+    delete stream;
+  }
+
+  LoggerStreamBuffered::ThreadBuffer *LoggerStreamBuffered::register_thread(void)
+  {
+    ThreadBuffer *tb = new ThreadBuffer;
+    tb->owner = this;
+    tb->exited = false;
+    pthread_mutex_lock(&mutex);
+    tb->current = alloc_chunk();
+    threads.push_back(tb);
+    pthread_mutex_unlock(&mutex);
+    pthread_setspecific(tls_key, tb);
+    return tb;
+  }
+
+  // must be called while holding the mutex
+  LoggerStreamBuffered::Chunk *LoggerStreamBuffered::alloc_chunk(void)
+  {
+    Chunk *c;
+    if(!free_chunks.empty()) {
+      c = free_chunks.back();
+      free_chunks.pop_back();
+    } else {
+      c = new Chunk;
+      c->data = (char *)malloc(chunk_size);
+      assert(c->data != 0);
+    }
+    c->used = 0;
+    c->flushed = 0;
+    return c;
+  }
+
+  void LoggerStreamBuffered::write(const char *buffer, size_t len)
+  {
+    ThreadBuffer *tb = static_cast<ThreadBuffer *>(pthread_getspecific(tls_key));
+    if(!tb)
+      tb = register_thread();
+
+    // fast path: room in our current chunk - copy the data and then publish
+    //  the new length to the flusher
+    Chunk *c = tb->current;
+    size_t used = c->used;
+    if((used + len) <= chunk_size) {
+      memcpy(c->data + used, buffer, len);
+      __sync_synchronize();
+      c->used = used + len;
+      return;
+    }
+
+    // slow path: retire the current chunk and start a new one
+    pthread_mutex_lock(&mutex);
+    retired_chunks.push_back(c);
+    tb->current = alloc_chunk();
+    if(len <= chunk_size) {
+      memcpy(tb->current->data, buffer, len);
+      tb->current->used = len;
+    } else {
+      // too big to buffer - drain everything (to preserve this thread's
+      //  ordering) and write the message directly
+      drain_all();
+      stream->write(buffer, len);
+    }
+    pthread_cond_signal(&condvar);
+    pthread_mutex_unlock(&mutex);
+  }
+
+  void LoggerStreamBuffered::flush(void)
+  {
+    pthread_mutex_lock(&mutex);
+    drain_all();
+    stream->flush();
+    pthread_mutex_unlock(&mutex);
+  }
+
+  // must be called while holding the mutex
+  void LoggerStreamBuffered::drain_chunk(Chunk *c)
+  {
+    size_t used = c->used;
+    __sync_synchronize();
+    if(used > c->flushed) {
+      stream->write(c->data + c->flushed, used - c->flushed);
+      c->flushed = used;
+    }
+  }
+
+  // must be called while holding the mutex
+  void LoggerStreamBuffered::drain_all(void)
+  {
+    // retired chunks first - a thread can only retire a chunk while holding
+    //  the mutex, so each thread's current chunk is newer than anything it
+    //  has retired
+    while(!retired_chunks.empty()) {
+      Chunk *c = retired_chunks.front();
+      retired_chunks.pop_front();
+      drain_chunk(c);
+      free_chunks.push_back(c);
+    }
+
+    size_t i = 0;
+    while(i < threads.size()) {
+      ThreadBuffer *tb = threads[i];
+      drain_chunk(tb->current);
+      if(tb->exited) {
+	free_chunks.push_back(tb->current);
+	delete tb;
+	threads[i] = threads.back();
+	threads.pop_back();
+      } else
+	i++;
+    }
+  }
+
+  /*static*/ void LoggerStreamBuffered::thread_exit(void *arg)
+  {
+    ThreadBuffer *tb = static_cast<ThreadBuffer *>(arg);
+    LoggerStreamBuffered *self = tb->owner;
+    pthread_mutex_lock(&self->mutex);
+    tb->exited = true;
+    pthread_mutex_unlock(&self->mutex);
+  }
+
+  /*static*/ void *LoggerStreamBuffered::flusher_thread_entry(void *arg)
+  {
+    static_cast<LoggerStreamBuffered *>(arg)->flusher_thread_loop();
+    return 0;
+  }
+
+  void LoggerStreamBuffered::flusher_thread_loop(void)
+  {
+    pthread_mutex_lock(&mutex);
+    while(!shutdown_requested) {
+      struct timespec ts;
+      clock_gettime(CLOCK_REALTIME, &ts);
+      long long ns = ts.tv_nsec + (long long)flush_interval_ms * 1000000LL;
+      ts.tv_sec += ns / 1000000000LL;
+      ts.tv_nsec = ns % 1000000000LL;
+      pthread_cond_timedwait(&condvar, &mutex, &ts);
+      drain_all();
+    }
+    pthread_mutex_unlock(&mutex);
+  }
+
+  // binary log records - the file starts with an 8-byte magic string and
+  //  the node id, followed by a sequence of records, each a fixed header and
+  //  then 'length' bytes of payload (see tools/realm_log_decode.py)
+  static const char BINARY_LOG_MAGIC[8] = { 'R', 'L', 'M', 'L', 'O', 'G', '0', '1' };
+
+  enum {
+    BINARY_RECORD_CATEGORY = 0,  // payload is the category name
+    BINARY_RECORD_MESSAGE = 1,   // payload is the message text
+  };
+
+  struct BinaryRecordHeader {
+    uint8_t type;
+    uint8_t level;
+    uint16_t category;
+    uint32_t length;
+    uint64_t timestamp;  // ns since epoch
+    uint64_t thread;
+  };
+
   class LoggerConfig {
   protected:
     LoggerConfig(void);
@@ -155,12 +412,20 @@ namespace Realm {
   protected:
     bool parse_level_argument(const std::string& s);
 
+    FILE *open_log_file(const std::string& logname);
+    LoggerOutputStream *wrap_stream(LoggerOutputStream *s);
+    bool category_in_list(const std::string& list, const std::string& name);
+
     bool cmdline_read;
     Logger::LoggingLevel default_level, stderr_level;
     std::map<std::string, Logger::LoggingLevel> category_levels;
     std::string cats_enabled;
     std::set<Logger *> pending_configs;
-    LoggerOutputStream *stream, *stderr_stream;
+    LoggerOutputStream *stream, *stderr_stream, *binary_stream;
+    size_t buffer_kb;
+    int flush_interval_ms;
+    std::string binary_cats;
+    unsigned short next_binary_id;
   };
 
   LoggerConfig::LoggerConfig(void)
@@ -169,11 +434,16 @@ namespace Realm {
     , stderr_level(Logger::LEVEL_ERROR)
     , stream(0)
     , stderr_stream(0)
+    , binary_stream(0)
+    , buffer_kb(0)
+    , flush_interval_ms(100)
+    , next_binary_id(0)
   {}
 
   LoggerConfig::~LoggerConfig(void)
   {
     delete stream;
+    delete binary_stream;
   }
 
   /*static*/ LoggerConfig *LoggerConfig::get_config(void)
@@ -187,6 +457,8 @@ namespace Realm {
     LoggerConfig *cfg = get_config();
     if(cfg->stream)
       cfg->stream->flush();
+    if(cfg->binary_stream)
+      cfg->binary_stream->flush();
   }
 
   template <>
@@ -285,15 +557,93 @@ namespace Realm {
     return true;
   }
 
+  // opens a log file, keying off a leading + for appending and replacing
+  //  a % with the node number
+  FILE *LoggerConfig::open_log_file(const std::string& logname)
+  {
+    bool append = false;
+    size_t start = 0;
+
+    if(logname[0] == '+') {
+      append = true;
+      start++;
+    }
+
+    FILE *f = 0;
+    size_t pct = logname.find_first_of('%', start);
+    if(pct == std::string::npos) {
+      // no node number - everybody uses the same file
+      if(max_node_id > 0) {
+	if(!append) {
+	  if(my_node_id == 0)
+	    fprintf(stderr, "WARNING: all ranks are logging to the same output file - appending is forced and output may be jumbled\n");
+	  append = true;
+	}
+      }
+      const char *fn = logname.c_str() + start;
+      f = fopen(fn, append ? "a" : "w");
+      if(!f) {
+	fprintf(stderr, "could not open log file '%s': %s\n", fn, strerror(errno));
+	exit(1);
+      }
+    } else {
+      // replace % with node number
+      char filename[256];
+      sprintf(filename, "%.*s%d%s",
+	      (int)(pct - start), logname.c_str() + start, my_node_id, logname.c_str() + pct + 1);
+
+      f = fopen(filename, append ? "a" : "w");
+      if(!f) {
+	fprintf(stderr, "could not open log file '%s': %s\n", filename, strerror(errno));
+	exit(1);
+      }
+    }
+    // per-thread buffering (if enabled) happens above the FILE
+    setbuf(f, 0); // disable output buffering
+    return f;
+  }
+
+  // -logbuffer selects per-thread buffering, otherwise all writes to the
+  //  stream are serialized with a mutex
+  LoggerOutputStream *LoggerConfig::wrap_stream(LoggerOutputStream *s)
+  {
+    if(buffer_kb > 0)
+      return new LoggerStreamBuffered(s, buffer_kb << 10,
+				      ((flush_interval_ms > 0) ? flush_interval_ms : 100));
+    else
+      return new LoggerStreamSerialized<LoggerOutputStream>(s, true);
+  }
+
+  bool LoggerConfig::category_in_list(const std::string& list,
+				      const std::string& name)
+  {
+    const char *p = list.c_str();
+    int l = name.length();
+    const char *n = name.c_str();
+    while(*p) {
+      if(((p[l] == '\0') || (p[l] == ',')) && !strncmp(p, n, l))
+	return true;
+      // skip to after next comma
+      while(*p && (*p != ',')) p++;
+      while(*p && (*p == ',')) p++;
+    }
+    return false;
+  }
+
   void LoggerConfig::read_command_line(std::vector<std::string>& cmdline)
   {
     std::string logname;
+    std::string binary_logname = "binlog_%.dat";
 
     bool ok = CommandLineParser()
       .add_option_string("-cat", cats_enabled)
       .add_option_string("-logfile", logname)
       .add_option_method("-level", this, &LoggerConfig::parse_level_argument)
       .add_option_int("-errlevel", stderr_level)
+      .add_option_int("-logbuffer", buffer_kb)
+      .add_option_int("-logflush", flush_interval_ms)
+      .add_option_string("-logbinary", binary_cats)
+      .add_option_string("-logbinfile", binary_logname)
       .parse_command_line(cmdline);
 
     if(!ok) {
@@ -305,62 +655,17 @@ namespace Realm {
     if(logname.empty()) {
       // the gasnet UDP job spawner (amudprun) seems to buffer stdout, so make stderr the default
 #ifdef GASNET_CONDUIT_UDP
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stderr, false),
-							    true);
+      stream = wrap_stream(new LoggerFileStream(stderr, false));
 #else
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stdout, false),
-							    true);
+      stream = wrap_stream(new LoggerFileStream(stdout, false));
 #endif
     } else if(logname == "stdout") {
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stdout, false),
-							    true);
+      stream = wrap_stream(new LoggerFileStream(stdout, false));
     } else if(logname == "stderr") {
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(stderr, false),
-							    true);
+      stream = wrap_stream(new LoggerFileStream(stderr, false));
     } else {
-      // we're going to open a file, but key off a + for appending and
-      //  look for a % for node number insertion
-      bool append = false;
-      size_t start = 0;
-
-      if(logname[0] == '+') {
-	append = true;
-	start++;
-      }
-
-      FILE *f = 0;
-      size_t pct = logname.find_first_of('%', start);
-      if(pct == std::string::npos) {
-	// no node number - everybody uses the same file
-	if(max_node_id > 0) {
-	  if(!append) {
-	    if(my_node_id == 0)
-	      fprintf(stderr, "WARNING: all ranks are logging to the same output file - appending is forced and output may be jumbled\n");
-	    append = true;
-	  }
-	}
-	const char *fn = logname.c_str() + start;
-	f = fopen(fn, append ? "a" : "w");
-	if(!f) {
-	  fprintf(stderr, "could not open log file '%s': %s\n", fn, strerror(errno));
-	  exit(1);
-	}
-      } else {
-	// replace % with node number
-	char filename[256];
-	sprintf(filename, "%.*s%d%s",
-		(int)(pct - start), logname.c_str() + start, my_node_id, logname.c_str() + pct + 1);
-
-	f = fopen(filename, append ? "a" : "w");
-	if(!f) {
-	  fprintf(stderr, "could not open log file '%s': %s\n", filename, strerror(errno));
-	  exit(1);
-	}
-      }
-      // TODO: consider buffering in some cases?
-      setbuf(f, 0); // disable output buffering
-      stream = new LoggerStreamSerialized<LoggerFileStream>(new LoggerFileStream(f, true),
-							    true);
+      FILE *f = open_log_file(logname);
+      stream = wrap_stream(new LoggerFileStream(f, true));
 
       // when logging to a file, also sent critical-enough messages to stderr
       if(stderr_level < Logger::LEVEL_NONE)
@@ -368,6 +673,21 @@ namespace Realm {
 								     true);
     }
 
+    // categories selected for binary logging get their own file
+    if(!binary_cats.empty()) {
+      if(binary_logname.find_first_of('%') == std::string::npos) {
+	fprintf(stderr, "binary log file name must contain a %% for the node number\n");
+	exit(1);
+      }
+      FILE *f = open_log_file(binary_logname);
+      // the file header must precede any buffered records
+      LoggerFileStream *fs = new LoggerFileStream(f, true);
+      int32_t node = my_node_id;
+      fs->write(BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC));
+      fs->write((const char *)&node, sizeof(node));
+      binary_stream = wrap_stream(fs);
+    }
+
     atexit(LoggerConfig::flush_all_streams);
 
     cmdline_read = true;
@@ -389,24 +709,10 @@ namespace Realm {
     }
 
     // see if this logger is one of the categories we want
-    if(!cats_enabled.empty()) {
-      bool found = false;
-      const char *p = cats_enabled.c_str();
-      int l = logger->get_name().length();
-      const char *n = logger->get_name().c_str();
-      while(*p) {
-	if(((p[l] == '\0') || (p[l] == ',')) && !strncmp(p, n, l)) {
-	  found = true;
-	  break;
-	}
-	// skip to after next comma
-	while(*p && (*p != ',')) p++;
-	while(*p && (*p == ',')) p++;
-      }
-      if(!found) {
-	//printf("'%s' not in '%s'\n", n, cats_enabled);
-	return;
-      }
+    if(!cats_enabled.empty() &&
+       !category_in_list(cats_enabled, logger->get_name())) {
+      //printf("'%s' not in '%s'\n", n, cats_enabled);
+      return;
     }
 
     // see if the level for this category has been customized
@@ -415,10 +721,31 @@ namespace Realm {
     if(it != category_levels.end())
       level = it->second;
 
-    // give this logger a copy of the global stream
-    logger->add_stream(stream, level, 
-		       false,  /* don't delete */
-		       false); /* don't flush each write */
+    // binary categories go only to the binary stream - the category name
+    //  is recorded once so the decoder can map ids back to names
+    if(binary_stream && category_in_list(binary_cats, logger->get_name())) {
+      logger->binary_id = next_binary_id++;
+      BinaryRecordHeader hdr;
+      hdr.type = BINARY_RECORD_CATEGORY;
+      hdr.level = 0;
+      hdr.category = logger->binary_id;
+      hdr.length = logger->get_name().length();
+      hdr.timestamp = 0;
+      hdr.thread = 0;
+      std::string rec((const char *)&hdr, sizeof(hdr));
+      rec.append(logger->get_name());
+      binary_stream->write(rec.data(), rec.length());
+
+      logger->add_stream(binary_stream, level,
+			 false,  /* don't delete */
+			 false,  /* don't flush each write */
+			 true);  /* binary */
+    } else {
+      // give this logger a copy of the global stream
+      logger->add_stream(stream, level, 
+			 false,  /* don't delete */
+			 false); /* don't flush each write */
+    }
 
     // also use the stderr_stream, if present
     // make sure not to log at a level noisier than requested for this category
@@ -434,7 +761,7 @@ namespace Realm {
   // class Logger
 
   Logger::Logger(const std::string& _name)
-    : name(_name), log_level(LEVEL_NONE)
+    : name(_name), log_level(LEVEL_NONE), binary_id(0)
   {
     LoggerConfig::get_config()->configure(this);
   }
@@ -462,6 +789,44 @@ namespace Realm {
     if(msg.length() == 0)
       return;
 
+    // binary streams get a fixed header instead of the formatted prefix,
+    //  and are never truncated
+    bool text_needed = false;
+    for(std::vector<LogStream>::iterator it = streams.begin();
+	it != streams.end();
+	it++) {
+      if(level < it->min_level)
+	continue;
+
+      if(!it->binary) {
+	text_needed = true;
+	continue;
+      }
+
+      static const size_t MAXLEN = 4096;
+      char buffer[MAXLEN];
+      size_t total = sizeof(BinaryRecordHeader) + msg.length();
+      char *rec = ((total <= MAXLEN) ? buffer : (char *)malloc(total));
+      BinaryRecordHeader *hdr = reinterpret_cast<BinaryRecordHeader *>(rec);
+      hdr->type = BINARY_RECORD_MESSAGE;
+      hdr->level = level;
+      hdr->category = binary_id;
+      hdr->length = msg.length();
+      hdr->timestamp = Clock::current_time_in_nanoseconds(true /*absolute*/);
+      hdr->thread = (uint64_t)pthread_self();
+      memcpy(rec + sizeof(BinaryRecordHeader), msg.data(), msg.length());
+
+      it->s->write(rec, total);
+
+      if(it->flush_each_write || (level >= LEVEL_ERROR))
+	it->s->flush();
+
+      if(rec != buffer)
+	free(rec);
+    }
+    if(!text_needed)
+      return;
+
     // build message string, including prefix
     static const int MAXLEN = 4096;
     char buffer[MAXLEN];
@@ -487,12 +852,12 @@ namespace Realm {
         for(std::vector<LogStream>::iterator it = streams.begin();
             it != streams.end();
             it++) {
-          if(level < it->min_level)
+          if((level < it->min_level) || it->binary)
             continue;
 
           it->s->write(full_buffer, full_len);
 
-          if(it->flush_each_write)
+          if(it->flush_each_write || (level >= LEVEL_ERROR))
             it->s->flush();
         }
         free(full_buffer);
@@ -509,24 +874,28 @@ namespace Realm {
     for(std::vector<LogStream>::iterator it = streams.begin();
 	it != streams.end();
 	it++) {
-      if(level < it->min_level)
+      if((level < it->min_level) || it->binary)
 	continue;
 
       it->s->write(buffer, len);
 
-      if(it->flush_each_write)
+      // errors are flushed right away so that buffered output isn't lost
+      //  if we're about to crash
+      if(it->flush_each_write || (level >= LEVEL_ERROR))
 	it->s->flush();
     }
   }
 
   void Logger::add_stream(LoggerOutputStream *s, LoggingLevel min_level,
-			  bool delete_when_done, bool flush_each_write)
+			  bool delete_when_done, bool flush_each_write,
+			  bool binary)
   {
     LogStream ls;
     ls.s = s;
     ls.min_level = min_level;
     ls.delete_when_done = delete_when_done;
     ls.flush_each_write = flush_each_write;
+    ls.binary = binary;
     streams.push_back(ls);
 
     // update our logging level if needed
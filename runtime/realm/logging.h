@@ -112,18 +112,21 @@ namespace Realm {
     friend class LoggerConfig;
     
     void add_stream(LoggerOutputStream *s, LoggingLevel min_level,
-                    bool delete_when_done, bool flush_each_write);
+                    bool delete_when_done, bool flush_each_write,
+                    bool binary = false);
     
     struct LogStream {
       LoggerOutputStream *s;
       LoggingLevel min_level;
       bool delete_when_done;
       bool flush_each_write;
+      bool binary;  // write compact binary records instead of text
     };
     
     std::string name;
     std::vector<LogStream> streams;
     LoggingLevel log_level;  // the min level of any stream
+    unsigned short binary_id;  // category id used in binary records
   };
   
   class LoggerMessage {
@@ -23,6 +23,8 @@
 #include "realm/activemsg.h"
 #include "realm/transfer/channel.h"
 
+#include <algorithm>
+
 TYPE_IS_SERIALIZABLE(Realm::NodeAnnounceTag);
 TYPE_IS_SERIALIZABLE(Realm::Memory);
 TYPE_IS_SERIALIZABLE(Realm::Memory::Kind);
@@ -43,6 +45,15 @@ namespace Realm {
       delete it->second;
   }
 
+  template <typename KT, typename VT>
+  inline void append_map_keys(const std::map<KT,VT *>& m, std::vector<KT>& keys)
+  {
+    for(typename std::map<KT,VT *>::const_iterator it = m.begin();
+	it != m.end();
+	++it)
+      keys.push_back(it->first);
+  }
+
   static inline bool is_local_affinity(const Machine::ProcessorMemoryAffinity& pma)
   {
     return ID(pma.p).proc.owner_node == ID(pma.m).memory.owner_node;
@@ -361,6 +372,7 @@ namespace Realm {
     MachineImpl *machine_singleton = 0;
 
   MachineImpl::MachineImpl(void)
+    : generation(0)
   {
     assert(machine_singleton == 0);
     machine_singleton = this;
@@ -385,6 +397,7 @@ namespace Realm {
       // these can be the source of a RemoteWrite, but it's non-ideal
     case Memory::SYSTEM_MEM:
     case Memory::Z_COPY_MEM:
+    case Memory::GPU_MANAGED_MEM:
       {
 	send_ok = true;
 	recv_ok = true;
@@ -685,6 +698,22 @@ namespace Realm {
     return get_nodeinfo(ID(m).memory.owner_node);
   }
 
+  const MachineProcInfo *MachineImpl::get_proc_info(Processor p) const
+  {
+    const MachineNodeInfo *ni = get_nodeinfo(p);
+    if(!ni) return 0;
+    std::map<Processor, MachineProcInfo *>::const_iterator it = ni->procs.find(p);
+    return ((it != ni->procs.end()) ? it->second : 0);
+  }
+
+  const MachineMemInfo *MachineImpl::get_mem_info(Memory m) const
+  {
+    const MachineNodeInfo *ni = get_nodeinfo(m);
+    if(!ni) return 0;
+    std::map<Memory, MachineMemInfo *>::const_iterator it = ni->mems.find(m);
+    return ((it != ni->mems.end()) ? it->second : 0);
+  }
+
     void MachineImpl::get_local_processors(std::set<Processor>& pset) const
     {
       // TODO: consider using a reader/writer lock here instead
@@ -1075,6 +1104,9 @@ namespace Realm {
       ptr->add_proc_mem_affinity(pma);
     }
 
+    // any cached query results are now stale
+    __sync_fetch_and_add(&generation, 1);
+
     if(!lock_held) mutex.unlock();
   }
 
@@ -1102,6 +1134,9 @@ namespace Realm {
       ptr->add_mem_mem_affinity(mma);
     }
 
+    // any cached query results are now stale
+    __sync_fetch_and_add(&generation, 1);
+
     if(!lock_held) mutex.unlock();
   }
 
@@ -1332,6 +1367,118 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MachineQueryCache<T>
+  //
+
+  template <typename T>
+  MachineQueryResults<T>::MachineQueryResults(unsigned _generation)
+    : references(1)
+    , generation(_generation)
+  {}
+
+  template <typename T>
+  void MachineQueryResults<T>::add_reference(void)
+  {
+    __sync_fetch_and_add(&references, 1);
+  }
+
+  template <typename T>
+  void MachineQueryResults<T>::remove_reference(void)
+  {
+    int left = __sync_sub_and_fetch(&references, 1);
+    if(left == 0)
+      delete this;
+  }
+
+  template <typename T>
+  MachineQueryCache<T>::MachineQueryCache(void)
+    : cache_generation(0)
+  {}
+
+  template <typename T>
+  MachineQueryCache<T>::~MachineQueryCache(void)
+  {
+    clear();
+  }
+
+  template <typename T>
+  void MachineQueryCache<T>::clear(void)
+  {
+    for(typename std::map<std::vector<unsigned long long>, MachineQueryResults<T> *>::const_iterator it = entries.begin();
+	it != entries.end();
+	++it)
+      it->second->remove_reference();
+    entries.clear();
+  }
+
+  template <typename T>
+  MachineQueryResults<T> *MachineQueryCache<T>::lookup(const std::vector<unsigned long long>& key,
+						       unsigned generation)
+  {
+    AutoHSLLock al(mutex);
+    if(generation != cache_generation) {
+      // the machine model has changed - nothing we have is valid anymore
+      clear();
+      cache_generation = generation;
+      return 0;
+    }
+    typename std::map<std::vector<unsigned long long>, MachineQueryResults<T> *>::const_iterator it = entries.find(key);
+    if(it == entries.end())
+      return 0;
+    it->second->add_reference();
+    return it->second;
+  }
+
+  template <typename T>
+  void MachineQueryCache<T>::insert(const std::vector<unsigned long long>& key,
+				    MachineQueryResults<T> *results)
+  {
+    AutoHSLLock al(mutex);
+    // results computed against an older model are not worth keeping
+    if(results->generation < cache_generation)
+      return;
+    if((results->generation > cache_generation) || (entries.size() >= MAX_ENTRIES)) {
+      clear();
+      cache_generation = results->generation;
+    }
+    MachineQueryResults<T> *& ptr = entries[key];
+    if(ptr)
+      ptr->remove_reference();
+    results->add_reference();
+    ptr = results;
+  }
+
+  // query matches are kept in the order a scan of the node infos finds
+  //  them: by owner node and then by ID
+  struct QueryMatchOrder {
+    bool operator()(Processor a, Processor b) const
+    {
+      if(ID(a).proc.owner_node != ID(b).proc.owner_node)
+	return (ID(a).proc.owner_node < ID(b).proc.owner_node);
+      return (a.id < b.id);
+    }
+
+    bool operator()(Memory a, Memory b) const
+    {
+      if(ID(a).memory.owner_node != ID(b).memory.owner_node)
+	return (ID(a).memory.owner_node < ID(b).memory.owner_node);
+      return (a.id < b.id);
+    }
+  };
+
+  // tags that keep the cache keys of different predicates distinct
+  enum {
+    PRED_PROC_HAS_AFFINITY = 1,
+    PRED_PROC_BEST_AFFINITY,
+    PRED_MEM_HAS_PROC_AFFINITY,
+    PRED_MEM_HAS_MEM_AFFINITY,
+    PRED_MEM_BEST_PROC_AFFINITY,
+    PRED_MEM_BEST_MEM_AFFINITY
+  };
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class ProcessorHasAffinityPredicate
@@ -1370,6 +1517,26 @@ namespace Realm {
   }
 
 
+  bool ProcessorHasAffinityPredicate::append_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(PRED_PROC_HAS_AFFINITY);
+    key.push_back(memory.id);
+    key.push_back(min_bandwidth);
+    key.push_back(max_latency);
+    return true;
+  }
+
+  bool ProcessorHasAffinityPredicate::get_candidates(MachineImpl *machine,
+						     std::vector<Processor>& candidates) const
+  {
+    // only processors with some affinity to the memory can match
+    const MachineMemInfo *info = machine->get_mem_info(memory);
+    if(info)
+      append_map_keys(info->pmas.all, candidates);
+    return true;
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class ProcessorBestAffinityPredicate
@@ -1417,6 +1584,26 @@ namespace Realm {
   }
 
 
+  bool ProcessorBestAffinityPredicate::append_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(PRED_PROC_BEST_AFFINITY);
+    key.push_back(memory.id);
+    key.push_back(bandwidth_weight);
+    key.push_back(latency_weight);
+    return true;
+  }
+
+  bool ProcessorBestAffinityPredicate::get_candidates(MachineImpl *machine,
+						      std::vector<Processor>& candidates) const
+  {
+    // only processors with some affinity to the memory can match
+    const MachineMemInfo *info = machine->get_mem_info(memory);
+    if(info)
+      append_map_keys(info->pmas.all, candidates);
+    return true;
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class ProcessorQueryImpl
@@ -1427,6 +1614,7 @@ namespace Realm {
     , machine((MachineImpl *)_machine.impl)
     , is_restricted_node(false)
     , is_restricted_kind(false)
+    , results(0)
   {}
      
   ProcessorQueryImpl::ProcessorQueryImpl(const ProcessorQueryImpl& copy_from)
@@ -1436,6 +1624,7 @@ namespace Realm {
     , restricted_node_id(copy_from.restricted_node_id)
     , is_restricted_kind(copy_from.is_restricted_kind)
     , restricted_kind(copy_from.restricted_kind)
+    , results(0)
   {
     predicates.reserve(copy_from.predicates.size());
     for(std::vector<ProcQueryPredicate *>::const_iterator it = copy_from.predicates.begin();
@@ -1447,6 +1636,8 @@ namespace Realm {
   ProcessorQueryImpl::~ProcessorQueryImpl(void)
   {
     assert(references == 0);
+    if(results)
+      results->remove_reference();
     for(std::vector<ProcQueryPredicate *>::iterator it = predicates.begin();
 	it != predicates.end();
 	it++)
@@ -1480,6 +1671,7 @@ namespace Realm {
 
   void ProcessorQueryImpl::restrict_to_node(int new_node_id)
   {
+    invalidate_results();
     // attempts to restrict to two different nodes results in no possible match
     if(is_restricted_node && (new_node_id != restricted_node_id)) {
       restricted_node_id = -1;
@@ -1491,6 +1683,7 @@ namespace Realm {
 
   void ProcessorQueryImpl::restrict_to_kind(Processor::Kind new_kind)
   {
+    invalidate_results();
     // attempts to restrict to two different kind results in no possible match
     // (use node restriction to enforce this)
     if(is_restricted_kind && (new_kind != restricted_kind)) {
@@ -1505,36 +1698,66 @@ namespace Realm {
   void ProcessorQueryImpl::add_predicate(ProcQueryPredicate *pred)
   {
     // a writer is always unique, so no need for mutexes
+    invalidate_results();
     predicates.push_back(pred);
   }
 
-  Processor ProcessorQueryImpl::first_match(void) const
+  void ProcessorQueryImpl::invalidate_results(void)
   {
-#ifdef USE_OLD_AFFINITIES
-    if(is_restricted_node && (restricted_node_id < 0)) return Processor::NO_PROC;
-    Processor lowest = Processor::NO_PROC;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Processor p =(*it).p;
-	if(is_restricted_node && (ID(p).proc.owner_node != (unsigned)restricted_node_id))
+    // only called by the (unique) writer, so no need for the mutex
+    if(results) {
+      results->remove_reference();
+      results = 0;
+    }
+  }
+
+  bool ProcessorQueryImpl::get_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(is_restricted_node ? 1 : 0);
+    key.push_back(is_restricted_node ? restricted_node_id : 0);
+    key.push_back(is_restricted_kind ? 1 : 0);
+    key.push_back(is_restricted_kind ? restricted_kind : 0);
+    for(std::vector<ProcQueryPredicate *>::const_iterator it = predicates.begin();
+	it != predicates.end();
+	it++)
+      if(!(*it)->append_cache_key(key))
+	return false;
+    return true;
+  }
+
+  void ProcessorQueryImpl::compute_matches(std::vector<Processor>& matches) const
+  {
+    if(is_restricted_node && (restricted_node_id < 0)) return;
+
+    // if a predicate can name its candidates from the affinity maps, test
+    //  just those rather than every processor in the machine
+    for(std::vector<ProcQueryPredicate *>::const_iterator it = predicates.begin();
+	it != predicates.end();
+	it++) {
+      std::vector<Processor> candidates;
+      if(!(*it)->get_candidates(machine, candidates))
+	continue;
+
+      std::sort(candidates.begin(), candidates.end(), QueryMatchOrder());
+      for(std::vector<Processor>::const_iterator it2 = candidates.begin();
+	  it2 != candidates.end();
+	  it2++) {
+	if(is_restricted_node && (ID(*it2).proc.owner_node != (unsigned)restricted_node_id))
 	  continue;
-	if(is_restricted_kind && (p.kind() != restricted_kind))
+	if(is_restricted_kind && (it2->kind() != restricted_kind))
 	  continue;
-	bool ok = true;
-	for(std::vector<ProcQueryPredicate *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, p);
-	if(ok && (!lowest.exists() || (p.id < lowest.id)))
-	  lowest = p;
+	const MachineProcInfo *info = machine->get_proc_info(*it2);
+	bool ok = (info != 0);
+	for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
+	    ok && (it3 != predicates.end());
+	    it3++)
+	  ok = (*it3)->matches_predicate(machine, *it2, info);
+	if(ok)
+	  matches.push_back(*it2);
       }
+      return;
     }
-    return lowest;
-#else
+
     std::map<int, MachineNodeInfo *>::const_iterator it;
     if(is_restricted_node)
       it = machine->nodeinfos.lower_bound(restricted_node_id);
@@ -1555,25 +1778,91 @@ namespace Realm {
 	plist = &(it->second->procs);
 
       if(plist) {
-	std::map<Processor, MachineProcInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
+	for(std::map<Processor, MachineProcInfo *>::const_iterator it2 = plist->begin();
+	    it2 != plist->end();
+	    ++it2) {
 	  bool ok = true;
 	  for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
 	      ok && (it3 != predicates.end());
 	      it3++)
 	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
 	  if(ok)
-	    return it2->first;
-
-	  // try next processor (if it exists)
-	  ++it2;
+	    matches.push_back(it2->first);
 	}
       }
 
-      // try the next node (if it exists)
       ++it;
     }
-    return Processor::NO_PROC;
+  }
+
+  MachineQueryResults<Processor> *ProcessorQueryImpl::get_results(void) const
+  {
+    // sample the generation before looking at the model so that a
+    //  concurrent change can't be missed
+    unsigned generation = __sync_fetch_and_add(&machine->generation, 0);
+
+    {
+      AutoHSLLock al(results_mutex);
+      if(results && (results->generation == generation)) {
+	results->add_reference();
+	return results;
+      }
+    }
+
+    // next best is an identical query made by someone else
+    std::vector<unsigned long long> key;
+    bool cacheable = get_cache_key(key);
+    MachineQueryResults<Processor> *r = 0;
+    if(cacheable)
+      r = machine->proc_query_cache.lookup(key, generation);
+    if(!r) {
+      r = new MachineQueryResults<Processor>(generation);
+      compute_matches(r->matches);
+      if(cacheable)
+	machine->proc_query_cache.insert(key, r);
+    }
+
+    {
+      AutoHSLLock al(results_mutex);
+      if(results)
+	results->remove_reference();
+      r->add_reference();
+      results = r;
+    }
+    return r;
+  }
+
+  Processor ProcessorQueryImpl::first_match(void) const
+  {
+#ifdef USE_OLD_AFFINITIES
+    if(is_restricted_node && (restricted_node_id < 0)) return Processor::NO_PROC;
+    Processor lowest = Processor::NO_PROC;
+    {
+      // problem with nested locks here...
+      //AutoHSLLock al(machine->mutex);
+      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
+	  it != machine->proc_mem_affinities.end();
+	  it++) {
+	Processor p =(*it).p;
+	if(is_restricted_node && (ID(p).proc.owner_node != (unsigned)restricted_node_id))
+	  continue;
+	if(is_restricted_kind && (p.kind() != restricted_kind))
+	  continue;
+	bool ok = true;
+	for(std::vector<ProcQueryPredicate *>::const_iterator it2 = predicates.begin();
+	    ok && (it2 != predicates.end());
+	    it2++)
+	  ok &= (*it2)->matches_predicate(machine, p);
+	if(ok && (!lowest.exists() || (p.id < lowest.id)))
+	  lowest = p;
+      }
+    }
+    return lowest;
+#else
+    MachineQueryResults<Processor> *r = get_results();
+    Processor p = (r->matches.empty() ? Processor::NO_PROC : r->matches[0]);
+    r->remove_reference();
+    return p;
 #endif
   }
 
@@ -1606,48 +1895,14 @@ namespace Realm {
     }
     return lowest;
 #else
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    // start where we left off
-    it = machine->nodeinfos.find(ID(after).proc.owner_node);
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Processor, MachineProcInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Processor::Kind, std::map<Processor, MachineProcInfo *> >::const_iterator it2 = it->second->proc_by_kind.find(restricted_kind);
-	if(it2 != it->second->proc_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->procs);
-
-      if(plist) {
-        std::map<Processor, MachineProcInfo *>::const_iterator it2;
-	// same node?  if so, skip past ones we've done
-	if(it->first == ID(after).proc.owner_node)
-	  it2 = plist->upper_bound(after);
-	else
-	  it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    return it2->first;
-
-	  // try next processor (if it exists)
-	  ++it2;
-	}
-      }
-
-      // try the next node (if it exists)
-      ++it;
-    }
-    return Processor::NO_PROC;
+    MachineQueryResults<Processor> *r = get_results();
+    std::vector<Processor>::const_iterator it = std::upper_bound(r->matches.begin(),
+							  r->matches.end(),
+							  after,
+							  QueryMatchOrder());
+    Processor p = ((it != r->matches.end()) ? *it : Processor::NO_PROC);
+    r->remove_reference();
+    return p;
 #endif
   }
 
@@ -1678,45 +1933,9 @@ namespace Realm {
     }
     return pset.size();
 #else
-    size_t count = 0;
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Processor, MachineProcInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Processor::Kind, std::map<Processor, MachineProcInfo *> >::const_iterator it2 = it->second->proc_by_kind.find(restricted_kind);
-	if(it2 != it->second->proc_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->procs);
-
-      if(plist) {
-	std::map<Processor, MachineProcInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    count += 1;
-
-	  // continue to next processor (if it exists)
-	  ++it2;
-	}
-      }
-
-      // continue to the next node (if it exists)
-      ++it;
-    }
+    MachineQueryResults<Processor> *r = get_results();
+    size_t count = r->matches.size();
+    r->remove_reference();
     return count;
 #endif
   }
@@ -1751,48 +1970,10 @@ namespace Realm {
       }
     }
 #else
-    size_t count = 0;
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Processor, MachineProcInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Processor::Kind, std::map<Processor, MachineProcInfo *> >::const_iterator it2 = it->second->proc_by_kind.find(restricted_kind);
-	if(it2 != it->second->proc_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->procs);
-
-      if(plist) {
-	std::map<Processor, MachineProcInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<ProcQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok) {
-	    count++;
-	    if((count == 1) || ((lrand48() % count) == 0))
-	      chosen = it2->first;
-	  }
-
-	  // continue to next processor (if it exists)
-	  ++it2;
-	}
-      }
-
-      // continue to the next node (if it exists)
-      ++it;
-    }
+    MachineQueryResults<Processor> *r = get_results();
+    if(!r->matches.empty())
+      chosen = r->matches[lrand48() % r->matches.size()];
+    r->remove_reference();
 #endif
     return chosen;
   }
@@ -1836,12 +2017,32 @@ namespace Realm {
   }
 
 
-  ////////////////////////////////////////////////////////////////////////
-  //
-  // class MemoryHasMemAffinityPredicate
-  //
-
-  MemoryHasMemAffinityPredicate::MemoryHasMemAffinityPredicate(Memory _memory,
+  bool MemoryHasProcAffinityPredicate::append_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(PRED_MEM_HAS_PROC_AFFINITY);
+    key.push_back(proc.id);
+    key.push_back(min_bandwidth);
+    key.push_back(max_latency);
+    return true;
+  }
+
+  bool MemoryHasProcAffinityPredicate::get_candidates(MachineImpl *machine,
+						      std::vector<Memory>& candidates) const
+  {
+    // only memories with some affinity to the processor can match
+    const MachineProcInfo *info = machine->get_proc_info(proc);
+    if(info)
+      append_map_keys(info->pmas.all, candidates);
+    return true;
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MemoryHasMemAffinityPredicate
+  //
+
+  MemoryHasMemAffinityPredicate::MemoryHasMemAffinityPredicate(Memory _memory,
 							       unsigned _min_bandwidth,
 							       unsigned _max_latency)
     : memory(_memory)
@@ -1874,6 +2075,26 @@ namespace Realm {
   }
 
 
+  bool MemoryHasMemAffinityPredicate::append_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(PRED_MEM_HAS_MEM_AFFINITY);
+    key.push_back(memory.id);
+    key.push_back(min_bandwidth);
+    key.push_back(max_latency);
+    return true;
+  }
+
+  bool MemoryHasMemAffinityPredicate::get_candidates(MachineImpl *machine,
+						     std::vector<Memory>& candidates) const
+  {
+    // only memories with an affinity to the target memory can match
+    const MachineMemInfo *info = machine->get_mem_info(memory);
+    if(info)
+      append_map_keys(info->mmas_in.all, candidates);
+    return true;
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class MemoryBestProcAffinityPredicate
@@ -1921,6 +2142,26 @@ namespace Realm {
   }
 
 
+  bool MemoryBestProcAffinityPredicate::append_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(PRED_MEM_BEST_PROC_AFFINITY);
+    key.push_back(proc.id);
+    key.push_back(bandwidth_weight);
+    key.push_back(latency_weight);
+    return true;
+  }
+
+  bool MemoryBestProcAffinityPredicate::get_candidates(MachineImpl *machine,
+						       std::vector<Memory>& candidates) const
+  {
+    // only memories with some affinity to the processor can match
+    const MachineProcInfo *info = machine->get_proc_info(proc);
+    if(info)
+      append_map_keys(info->pmas.all, candidates);
+    return true;
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class MemoryBestMemAffinityPredicate
@@ -1968,6 +2209,26 @@ namespace Realm {
   }
 
 
+  bool MemoryBestMemAffinityPredicate::append_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(PRED_MEM_BEST_MEM_AFFINITY);
+    key.push_back(memory.id);
+    key.push_back(bandwidth_weight);
+    key.push_back(latency_weight);
+    return true;
+  }
+
+  bool MemoryBestMemAffinityPredicate::get_candidates(MachineImpl *machine,
+						      std::vector<Memory>& candidates) const
+  {
+    // only memories with an affinity to the target memory can match
+    const MachineMemInfo *info = machine->get_mem_info(memory);
+    if(info)
+      append_map_keys(info->mmas_in.all, candidates);
+    return true;
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class MemoryQueryImpl
@@ -1978,6 +2239,7 @@ namespace Realm {
     , machine((MachineImpl *)_machine.impl)
     , is_restricted_node(false)
     , is_restricted_kind(false)
+    , results(0)
   {}
      
   MemoryQueryImpl::MemoryQueryImpl(const MemoryQueryImpl& copy_from)
@@ -1987,6 +2249,7 @@ namespace Realm {
     , restricted_node_id(copy_from.restricted_node_id)
     , is_restricted_kind(copy_from.is_restricted_kind)
     , restricted_kind(copy_from.restricted_kind)
+    , results(0)
   {
     predicates.reserve(copy_from.predicates.size());
     for(std::vector<MemoryQueryPredicate *>::const_iterator it = copy_from.predicates.begin();
@@ -1998,6 +2261,8 @@ namespace Realm {
   MemoryQueryImpl::~MemoryQueryImpl(void)
   {
     assert(references == 0);
+    if(results)
+      results->remove_reference();
     for(std::vector<MemoryQueryPredicate *>::iterator it = predicates.begin();
 	it != predicates.end();
 	it++)
@@ -2031,6 +2296,7 @@ namespace Realm {
 
   void MemoryQueryImpl::restrict_to_node(int new_node_id)
   {
+    invalidate_results();
     // attempts to restrict to two different nodes results in no possible match
     if(is_restricted_node && (new_node_id != restricted_node_id)) {
       restricted_node_id = -1;
@@ -2042,6 +2308,7 @@ namespace Realm {
 
   void MemoryQueryImpl::restrict_to_kind(Memory::Kind new_kind)
   {
+    invalidate_results();
     // attempts to restrict to two different kind results in no possible match
     // (use node restriction to enforce this)
     if(is_restricted_kind && (new_kind != restricted_kind)) {
@@ -2056,36 +2323,66 @@ namespace Realm {
   void MemoryQueryImpl::add_predicate(MemoryQueryPredicate *pred)
   {
     // a writer is always unique, so no need for mutexes
+    invalidate_results();
     predicates.push_back(pred);
   }
 
-  Memory MemoryQueryImpl::first_match(void) const
+  void MemoryQueryImpl::invalidate_results(void)
   {
-#if USE_OLD_AFFINITIES
-    if(is_restricted_node && (restricted_node_id < 0)) return Memory::NO_MEMORY;
-    Memory lowest = Memory::NO_MEMORY;
-    {
-      // problem with nested locks here...
-      //AutoHSLLock al(machine->mutex);
-      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
-	  it != machine->proc_mem_affinities.end();
-	  it++) {
-	Memory m =(*it).m;
-	if(is_restricted_node && (ID(m).memory.owner_node != (unsigned)restricted_node_id))
+    // only called by the (unique) writer, so no need for the mutex
+    if(results) {
+      results->remove_reference();
+      results = 0;
+    }
+  }
+
+  bool MemoryQueryImpl::get_cache_key(std::vector<unsigned long long>& key) const
+  {
+    key.push_back(is_restricted_node ? 1 : 0);
+    key.push_back(is_restricted_node ? restricted_node_id : 0);
+    key.push_back(is_restricted_kind ? 1 : 0);
+    key.push_back(is_restricted_kind ? restricted_kind : 0);
+    for(std::vector<MemoryQueryPredicate *>::const_iterator it = predicates.begin();
+	it != predicates.end();
+	it++)
+      if(!(*it)->append_cache_key(key))
+	return false;
+    return true;
+  }
+
+  void MemoryQueryImpl::compute_matches(std::vector<Memory>& matches) const
+  {
+    if(is_restricted_node && (restricted_node_id < 0)) return;
+
+    // if a predicate can name its candidates from the affinity maps, test
+    //  just those rather than every memory in the machine
+    for(std::vector<MemoryQueryPredicate *>::const_iterator it = predicates.begin();
+	it != predicates.end();
+	it++) {
+      std::vector<Memory> candidates;
+      if(!(*it)->get_candidates(machine, candidates))
+	continue;
+
+      std::sort(candidates.begin(), candidates.end(), QueryMatchOrder());
+      for(std::vector<Memory>::const_iterator it2 = candidates.begin();
+	  it2 != candidates.end();
+	  it2++) {
+	if(is_restricted_node && (ID(*it2).memory.owner_node != (unsigned)restricted_node_id))
 	  continue;
-	if(is_restricted_kind && (m.kind() != restricted_kind))
+	if(is_restricted_kind && (it2->kind() != restricted_kind))
 	  continue;
-	bool ok = true;
-	for(std::vector<MemoryQueryPredicate *>::const_iterator it2 = predicates.begin();
-	    ok && (it2 != predicates.end());
-	    it2++)
-	  ok &= (*it2)->matches_predicate(machine, m);
-	if(ok && (!lowest.exists() || (m.id < lowest.id)))
-	  lowest = m;
+	const MachineMemInfo *info = machine->get_mem_info(*it2);
+	bool ok = (info != 0);
+	for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
+	    ok && (it3 != predicates.end());
+	    it3++)
+	  ok = (*it3)->matches_predicate(machine, *it2, info);
+	if(ok)
+	  matches.push_back(*it2);
       }
+      return;
     }
-    return lowest;
-#else
+
     std::map<int, MachineNodeInfo *>::const_iterator it;
     if(is_restricted_node)
       it = machine->nodeinfos.lower_bound(restricted_node_id);
@@ -2106,25 +2403,91 @@ namespace Realm {
 	plist = &(it->second->mems);
 
       if(plist) {
-	std::map<Memory, MachineMemInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
+	for(std::map<Memory, MachineMemInfo *>::const_iterator it2 = plist->begin();
+	    it2 != plist->end();
+	    ++it2) {
 	  bool ok = true;
 	  for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
 	      ok && (it3 != predicates.end());
 	      it3++)
 	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
 	  if(ok)
-	    return it2->first;
-
-	  // try next memory (if it exists)
-	  ++it2;
+	    matches.push_back(it2->first);
 	}
       }
 
-      // try the next node (if it exists)
       ++it;
     }
-    return Memory::NO_MEMORY;
+  }
+
+  MachineQueryResults<Memory> *MemoryQueryImpl::get_results(void) const
+  {
+    // sample the generation before looking at the model so that a
+    //  concurrent change can't be missed
+    unsigned generation = __sync_fetch_and_add(&machine->generation, 0);
+
+    {
+      AutoHSLLock al(results_mutex);
+      if(results && (results->generation == generation)) {
+	results->add_reference();
+	return results;
+      }
+    }
+
+    // next best is an identical query made by someone else
+    std::vector<unsigned long long> key;
+    bool cacheable = get_cache_key(key);
+    MachineQueryResults<Memory> *r = 0;
+    if(cacheable)
+      r = machine->mem_query_cache.lookup(key, generation);
+    if(!r) {
+      r = new MachineQueryResults<Memory>(generation);
+      compute_matches(r->matches);
+      if(cacheable)
+	machine->mem_query_cache.insert(key, r);
+    }
+
+    {
+      AutoHSLLock al(results_mutex);
+      if(results)
+	results->remove_reference();
+      r->add_reference();
+      results = r;
+    }
+    return r;
+  }
+
+  Memory MemoryQueryImpl::first_match(void) const
+  {
+#if USE_OLD_AFFINITIES
+    if(is_restricted_node && (restricted_node_id < 0)) return Memory::NO_MEMORY;
+    Memory lowest = Memory::NO_MEMORY;
+    {
+      // problem with nested locks here...
+      //AutoHSLLock al(machine->mutex);
+      for(std::vector<Machine::ProcessorMemoryAffinity>::const_iterator it = machine->proc_mem_affinities.begin();
+	  it != machine->proc_mem_affinities.end();
+	  it++) {
+	Memory m =(*it).m;
+	if(is_restricted_node && (ID(m).memory.owner_node != (unsigned)restricted_node_id))
+	  continue;
+	if(is_restricted_kind && (m.kind() != restricted_kind))
+	  continue;
+	bool ok = true;
+	for(std::vector<MemoryQueryPredicate *>::const_iterator it2 = predicates.begin();
+	    ok && (it2 != predicates.end());
+	    it2++)
+	  ok &= (*it2)->matches_predicate(machine, m);
+	if(ok && (!lowest.exists() || (m.id < lowest.id)))
+	  lowest = m;
+      }
+    }
+    return lowest;
+#else
+    MachineQueryResults<Memory> *r = get_results();
+    Memory m = (r->matches.empty() ? Memory::NO_MEMORY : r->matches[0]);
+    r->remove_reference();
+    return m;
 #endif
   }
 
@@ -2157,48 +2520,14 @@ namespace Realm {
     }
     return lowest;
 #else
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    // start where we left off
-    it = machine->nodeinfos.find(ID(after).memory.owner_node);
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Memory, MachineMemInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> >::const_iterator it2 = it->second->mem_by_kind.find(restricted_kind);
-	if(it2 != it->second->mem_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->mems);
-
-      if(plist) {
-        std::map<Memory, MachineMemInfo *>::const_iterator it2;
-	// same node?  if so, skip past ones we've done
-	if(it->first == ID(after).memory.owner_node)
-	  it2 = plist->upper_bound(after);
-	else
-	  it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    return it2->first;
-
-	  // try next memory (if it exists)
-	  ++it2;
-	}
-      }
-
-      // try the next node (if it exists)
-      ++it;
-    }
-    return Memory::NO_MEMORY;
+    MachineQueryResults<Memory> *r = get_results();
+    std::vector<Memory>::const_iterator it = std::upper_bound(r->matches.begin(),
+							  r->matches.end(),
+							  after,
+							  QueryMatchOrder());
+    Memory m = ((it != r->matches.end()) ? *it : Memory::NO_MEMORY);
+    r->remove_reference();
+    return m;
 #endif
   }
 
@@ -2229,45 +2558,9 @@ namespace Realm {
     }
     return pset.size();
 #else
-    size_t count = 0;
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Memory, MachineMemInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> >::const_iterator it2 = it->second->mem_by_kind.find(restricted_kind);
-	if(it2 != it->second->mem_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->mems);
-
-      if(plist) {
-	std::map<Memory, MachineMemInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok)
-	    count += 1;
-
-	  // continue to next memory (if it exists)
-	  ++it2;
-	}
-      }
-
-      // continue to the next node (if it exists)
-      ++it;
-    }
+    MachineQueryResults<Memory> *r = get_results();
+    size_t count = r->matches.size();
+    r->remove_reference();
     return count;
 #endif
   }
@@ -2302,48 +2595,10 @@ namespace Realm {
       }
     }
 #else
-    size_t count = 0;
-    std::map<int, MachineNodeInfo *>::const_iterator it;
-    if(is_restricted_node)
-      it = machine->nodeinfos.lower_bound(restricted_node_id);
-    else
-      it = machine->nodeinfos.begin();
-    while(it != machine->nodeinfos.end()) {
-      if(is_restricted_node && (it->first != restricted_node_id))
-	break;
-
-      const std::map<Memory, MachineMemInfo *> *plist;
-      if(is_restricted_kind) {
-	std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> >::const_iterator it2 = it->second->mem_by_kind.find(restricted_kind);
-	if(it2 != it->second->mem_by_kind.end())
-	  plist = &(it2->second);
-	else
-	  plist = 0;
-      } else
-	plist = &(it->second->mems);
-
-      if(plist) {
-	std::map<Memory, MachineMemInfo *>::const_iterator it2 = plist->begin();
-	while(it2 != plist->end()) {
-	  bool ok = true;
-	  for(std::vector<MemoryQueryPredicate *>::const_iterator it3 = predicates.begin();
-	      ok && (it3 != predicates.end());
-	      it3++)
-	    ok = (*it3)->matches_predicate(machine, it2->first, it2->second);
-	  if(ok) {
-	    count++;
-	    if((count == 1) || ((lrand48() % count) == 0))
-	      chosen = it2->first;
-	  }
-
-	  // continue to next memory (if it exists)
-	  ++it2;
-	}
-      }
-
-      // continue to the next node (if it exists)
-      ++it;
-    }
+    MachineQueryResults<Memory> *r = get_results();
+    if(!r->matches.empty())
+      chosen = r->matches[lrand48() % r->matches.size()];
+    r->remove_reference();
 #endif
     return chosen;
   }
@@ -2354,35 +2609,49 @@ namespace Realm {
   // class NodeAnnounceMessage
   //
 
+  namespace Config {
+    int announce_tree_fanout = 8;
+  };
+
   static int announcements_received = 0;
 
-  /*static*/ void NodeAnnounceMessage::handle_request(RequestArgs args,
-						      const void *data,
-						      size_t datalen)
+  // applies another node's announcement to our view of the machine
+  static void apply_node_announcement(NodeID node_id, unsigned num_procs,
+				      unsigned num_memories, unsigned num_ib_memories,
+				      const void *data, size_t datalen)
   {
-    DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
     log_annc.info("%d: received announce from %d (%d procs, %d memories)\n",
 		  my_node_id,
-		  args.node_id,
-		  args.num_procs,
-		  args.num_memories);
+		  node_id,
+		  num_procs,
+		  num_memories);
     
-    Node *n = &(get_runtime()->nodes[args.node_id]);
-    n->processors.resize(args.num_procs);
-    n->memories.resize(args.num_memories);
-    n->ib_memories.resize(args.num_ib_memories);
+    Node *n = &(get_runtime()->nodes[node_id]);
+    n->processors.resize(num_procs);
+    n->memories.resize(num_memories);
+    n->ib_memories.resize(num_ib_memories);
 
     // do the parsing of this data inside a mutex because it touches common
     //  data structures
     {
-      get_machine()->parse_node_announce_data(args.node_id, args.num_procs,
-					      args.num_memories, args.num_ib_memories,
+      get_machine()->parse_node_announce_data(node_id, num_procs,
+					      num_memories, num_ib_memories,
 					      data, datalen, true);
 
       __sync_fetch_and_add(&announcements_received, 1);
     }
   }
 
+  /*static*/ void NodeAnnounceMessage::handle_request(RequestArgs args,
+						      const void *data,
+						      size_t datalen)
+  {
+    DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
+    apply_node_announcement(args.node_id, args.num_procs,
+			    args.num_memories, args.num_ib_memories,
+			    data, datalen);
+  }
+
   /*static*/ void NodeAnnounceMessage::send_request(NodeID target,
 						    unsigned num_procs,
 						    unsigned num_memories,
@@ -2400,6 +2669,140 @@ namespace Realm {
     Message::request(target, args, data, datalen, payload_mode);
   }
 
+  // the announcement tree is a heap-ordered tree over all nodes, rooted at
+  //  node 0
+
+  static NodeID announce_tree_parent(NodeID node)
+  {
+    return (node - 1) / Config::announce_tree_fanout;
+  }
+
+  static bool in_announce_subtree(NodeID node, NodeID subtree_root)
+  {
+    while(node > subtree_root)
+      node = announce_tree_parent(node);
+    return (node == subtree_root);
+  }
+
+  static int announce_subtree_size(NodeID subtree_root)
+  {
+    int count = 1;
+    for(int i = 1; i <= Config::announce_tree_fanout; i++) {
+      NodeID child = subtree_root * Config::announce_tree_fanout + i;
+      if(child > max_node_id) break;
+      count += announce_subtree_size(child);
+    }
+    return count;
+  }
+
+  // within a bundle, each announcement is a record header followed by the
+  //  announcement data
+  struct NodeAnnounceRecordHeader {
+    NodeID node_id;
+    unsigned num_procs;
+    unsigned num_memories;
+    unsigned num_ib_memories;
+    size_t datalen;
+  };
+
+  // every record (header and data) of our own subtree, by node - kept so
+  //  that they can be sent on to our children during the broadcast
+  static GASNetHSL announce_records_mutex;
+  static std::map<NodeID, std::vector<char> > announce_records;
+  static int announce_records_gathered = 0;
+
+  // sends records to 'target' in as few bundles as the long message buffer
+  //  size allows
+  static void send_announce_records(NodeID target,
+				    NodeAnnounceBundleMessage::Phase phase,
+				    const std::vector<const std::vector<char> *>& records)
+  {
+    size_t max_bytes = get_lmb_size(target);
+    std::vector<char> bundle;
+    unsigned count = 0;
+    for(std::vector<const std::vector<char> *>::const_iterator it = records.begin();
+	it != records.end();
+	++it) {
+      if((count > 0) && (max_bytes > 0) &&
+	 ((bundle.size() + (*it)->size()) > max_bytes)) {
+	NodeAnnounceBundleMessage::send_request(target, phase, count,
+						&bundle[0], bundle.size());
+	bundle.clear();
+	count = 0;
+      }
+      bundle.insert(bundle.end(), (*it)->begin(), (*it)->end());
+      count++;
+    }
+    if(count > 0)
+      NodeAnnounceBundleMessage::send_request(target, phase, count,
+					      &bundle[0], bundle.size());
+  }
+
+  /*static*/ void NodeAnnounceMessage::announce_to_all(unsigned num_procs,
+						       unsigned num_memories,
+						       unsigned num_ib_memories,
+						       const void *data,
+						       size_t datalen)
+  {
+    if(Config::announce_tree_fanout < 2) {
+      for(NodeID i = 0; i <= max_node_id; i++)
+	if(i != my_node_id)
+	  send_request(i, num_procs, num_memories, num_ib_memories,
+		       data, datalen, PAYLOAD_COPY);
+      return;
+    }
+
+    // add our own record to the ones our subtree will send us
+    {
+      NodeAnnounceRecordHeader hdr;
+      hdr.node_id = my_node_id;
+      hdr.num_procs = num_procs;
+      hdr.num_memories = num_memories;
+      hdr.num_ib_memories = num_ib_memories;
+      hdr.datalen = datalen;
+
+      AutoHSLLock al(announce_records_mutex);
+      std::vector<char>& rec = announce_records[my_node_id];
+      rec.resize(sizeof(hdr) + datalen);
+      memcpy(&rec[0], &hdr, sizeof(hdr));
+      if(datalen > 0)
+	memcpy(&rec[sizeof(hdr)], data, datalen);
+    }
+
+    // wait until everything below us has been gathered
+    int expected = announce_subtree_size(my_node_id) - 1;
+    while(__sync_fetch_and_add(&announce_records_gathered, 0) < expected)
+      do_some_polling();
+
+    // the records map no longer changes, so it can be read without the lock
+
+    // each child gets the rest of our subtree now - everything from outside
+    //  our subtree will be forwarded as it arrives from our parent
+    for(int i = 1; i <= Config::announce_tree_fanout; i++) {
+      NodeID child = my_node_id * Config::announce_tree_fanout + i;
+      if(child > max_node_id) break;
+      std::vector<const std::vector<char> *> records;
+      for(std::map<NodeID, std::vector<char> >::const_iterator it = announce_records.begin();
+	  it != announce_records.end();
+	  ++it)
+	if(!in_announce_subtree(it->first, child))
+	  records.push_back(&(it->second));
+      send_announce_records(child, NodeAnnounceBundleMessage::PHASE_BROADCAST,
+			    records);
+    }
+
+    if(my_node_id != 0) {
+      std::vector<const std::vector<char> *> records;
+      for(std::map<NodeID, std::vector<char> >::const_iterator it = announce_records.begin();
+	  it != announce_records.end();
+	  ++it)
+	records.push_back(&(it->second));
+      send_announce_records(announce_tree_parent(my_node_id),
+			    NodeAnnounceBundleMessage::PHASE_GATHER,
+			    records);
+    }
+  }
+
   /*static*/ void NodeAnnounceMessage::await_all_announcements(void)
   {
     // wait until we hear from everyone else?
@@ -2407,6 +2810,70 @@ namespace Realm {
       do_some_polling();
 
     log_annc.info("node %d has received all of its announcements", my_node_id);
+
+    // the tree's copies of the records are no longer needed
+    announce_records.clear();
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class NodeAnnounceBundleMessage
+  //
+
+  /*static*/ void NodeAnnounceBundleMessage::handle_request(RequestArgs args,
+							    const void *data,
+							    size_t datalen)
+  {
+    DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
+    log_annc.debug() << "received " << args.num_records << " announcements from " << args.sender
+		     << " (phase " << args.phase << ")";
+
+    // everything from our parent came from outside our subtree, so our
+    //  children need all of it too - forward before parsing
+    if(args.phase == PHASE_BROADCAST)
+      for(int i = 1; i <= Config::announce_tree_fanout; i++) {
+	NodeID child = my_node_id * Config::announce_tree_fanout + i;
+	if(child > max_node_id) break;
+	send_request(child, PHASE_BROADCAST, args.num_records, data, datalen);
+      }
+
+    const char *pos = (const char *)data;
+    for(unsigned i = 0; i < args.num_records; i++) {
+      NodeAnnounceRecordHeader hdr;
+      assert((size_t)((pos + sizeof(hdr)) - (const char *)data) <= datalen);
+      memcpy(&hdr, pos, sizeof(hdr));
+      size_t reclen = sizeof(hdr) + hdr.datalen;
+      assert((size_t)((pos + reclen) - (const char *)data) <= datalen);
+
+      // keep a copy of records from our subtree for the broadcast
+      if(args.phase == PHASE_GATHER) {
+	AutoHSLLock al(announce_records_mutex);
+	announce_records[hdr.node_id].assign(pos, pos + reclen);
+      }
+
+      apply_node_announcement(hdr.node_id, hdr.num_procs,
+			      hdr.num_memories, hdr.num_ib_memories,
+			      pos + sizeof(hdr), hdr.datalen);
+      pos += reclen;
+    }
+
+    if(args.phase == PHASE_GATHER)
+      __sync_fetch_and_add(&announce_records_gathered, args.num_records);
+  }
+
+  /*static*/ void NodeAnnounceBundleMessage::send_request(NodeID target,
+							  Phase phase,
+							  unsigned num_records,
+							  const void *data,
+							  size_t datalen)
+  {
+    RequestArgs args;
+
+    args.sender = my_node_id;
+    args.phase = phase;
+    args.num_records = num_records;
+    Message::request(target, args, data, datalen, PAYLOAD_COPY);
   }
 
 }; // namespace Realm
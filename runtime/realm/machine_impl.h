@@ -80,6 +80,45 @@ namespace Realm {
     std::map<Memory::Kind, std::map<Memory, MachineMemInfo *> > mem_by_kind;
   };
 
+  // the (sorted) matches of a processor or memory query - these are shared
+  //  between queries and the machine's query cache, and are never modified
+  //  once computed
+  template <typename T>
+  struct MachineQueryResults {
+    MachineQueryResults(unsigned _generation);
+
+    void add_reference(void);
+    void remove_reference(void);
+
+    int references;
+    unsigned generation;  // machine model generation the matches came from
+    std::vector<T> matches;
+  };
+
+  // memoizes query results, keyed by a description of the query - entries
+  //  are discarded whenever the machine model changes
+  template <typename T>
+  class MachineQueryCache {
+  public:
+    MachineQueryCache(void);
+    ~MachineQueryCache(void);
+
+    // returns a new reference to valid cached results, or 0 if there are none
+    MachineQueryResults<T> *lookup(const std::vector<unsigned long long>& key,
+				   unsigned generation);
+    void insert(const std::vector<unsigned long long>& key,
+		MachineQueryResults<T> *results);
+
+    static const size_t MAX_ENTRIES = 1024;
+
+  protected:
+    void clear(void);
+
+    GASNetHSL mutex;
+    unsigned cache_generation;
+    std::map<std::vector<unsigned long long>, MachineQueryResults<T> *> entries;
+  };
+
     class MachineImpl {
     public:
       MachineImpl(void);
@@ -137,6 +176,15 @@ namespace Realm {
 
       std::map<int, MachineNodeInfo *> nodeinfos;
 
+      // bumped whenever the machine model changes, invalidating any
+      //  cached query results
+      unsigned generation;
+      MachineQueryCache<Processor> proc_query_cache;
+      MachineQueryCache<Memory> mem_query_cache;
+
+      const MachineProcInfo *get_proc_info(Processor p) const;
+      const MachineMemInfo *get_mem_info(Memory m) const;
+
     protected:
       MachineNodeInfo *get_nodeinfo(int node) const;
       MachineNodeInfo *get_nodeinfo(Processor p) const;
@@ -152,6 +200,21 @@ namespace Realm {
 
       virtual bool matches_predicate(MachineImpl *machine, T thing,
 				     const T2 *info = 0) const = 0;
+
+      // appends a description of the predicate to 'key' - returns false if
+      //  results of queries using this predicate cannot be shared
+      virtual bool append_cache_key(std::vector<unsigned long long>& key) const
+      {
+	return false;
+      }
+
+      // fills in a superset of the things that can match the predicate,
+      //  using the affinity maps - returns false if no such list is available
+      virtual bool get_candidates(MachineImpl *machine,
+				  std::vector<T>& candidates) const
+      {
+	return false;
+      }
     };
 
     typedef QueryPredicate<Processor,MachineProcInfo> ProcQueryPredicate;
@@ -165,6 +228,10 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Processor thing,
 				     const MachineProcInfo *info = 0) const;
 
+      virtual bool append_cache_key(std::vector<unsigned long long>& key) const;
+      virtual bool get_candidates(MachineImpl *machine,
+				  std::vector<Processor>& candidates) const;
+
     protected:
       Memory memory;
       unsigned min_bandwidth;
@@ -180,6 +247,10 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Processor thing,
 				     const MachineProcInfo *info = 0) const;
 
+      virtual bool append_cache_key(std::vector<unsigned long long>& key) const;
+      virtual bool get_candidates(MachineImpl *machine,
+				  std::vector<Processor>& candidates) const;
+
     protected:
       Memory memory;
       int bandwidth_weight;
@@ -211,6 +282,12 @@ namespace Realm {
       Processor random_match(void) const;
 
     protected:
+      // returns a reference to an up-to-date list of matches
+      MachineQueryResults<Processor> *get_results(void) const;
+      bool get_cache_key(std::vector<unsigned long long>& key) const;
+      void compute_matches(std::vector<Processor>& matches) const;
+      void invalidate_results(void);
+
       int references;
       MachineImpl *machine;
       bool is_restricted_node;
@@ -218,6 +295,10 @@ namespace Realm {
       bool is_restricted_kind;
       Processor::Kind restricted_kind;
       std::vector<ProcQueryPredicate *> predicates;     
+      // matches are computed on first use and reused until the query or
+      //  the machine model changes
+      mutable GASNetHSL results_mutex;
+      mutable MachineQueryResults<Processor> *results;
     };            
 
     typedef QueryPredicate<Memory, MachineMemInfo> MemoryQueryPredicate;
@@ -231,6 +312,10 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual bool append_cache_key(std::vector<unsigned long long>& key) const;
+      virtual bool get_candidates(MachineImpl *machine,
+				  std::vector<Memory>& candidates) const;
+
     protected:
       Processor proc;
       unsigned min_bandwidth;
@@ -246,6 +331,10 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual bool append_cache_key(std::vector<unsigned long long>& key) const;
+      virtual bool get_candidates(MachineImpl *machine,
+				  std::vector<Memory>& candidates) const;
+
     protected:
       Memory memory;
       unsigned min_bandwidth;
@@ -261,6 +350,10 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual bool append_cache_key(std::vector<unsigned long long>& key) const;
+      virtual bool get_candidates(MachineImpl *machine,
+				  std::vector<Memory>& candidates) const;
+
     protected:
       Processor proc;
       int bandwidth_weight;
@@ -276,6 +369,10 @@ namespace Realm {
       virtual bool matches_predicate(MachineImpl *machine, Memory thing,
 				     const MachineMemInfo *info = 0) const;
 
+      virtual bool append_cache_key(std::vector<unsigned long long>& key) const;
+      virtual bool get_candidates(MachineImpl *machine,
+				  std::vector<Memory>& candidates) const;
+
     protected:
       Memory memory;
       int bandwidth_weight;
@@ -307,6 +404,12 @@ namespace Realm {
       Memory random_match(void) const;
 
     protected:
+      // returns a reference to an up-to-date list of matches
+      MachineQueryResults<Memory> *get_results(void) const;
+      bool get_cache_key(std::vector<unsigned long long>& key) const;
+      void compute_matches(std::vector<Memory>& matches) const;
+      void invalidate_results(void);
+
       int references;
       MachineImpl *machine;
       bool is_restricted_node;
@@ -314,6 +417,10 @@ namespace Realm {
       bool is_restricted_kind;
       Memory::Kind restricted_kind;
       std::vector<MemoryQueryPredicate *> predicates;     
+      // matches are computed on first use and reused until the query or
+      //  the machine model changes
+      mutable GASNetHSL results_mutex;
+      mutable MachineQueryResults<Memory> *results;
     };            
 
     extern MachineImpl *machine_singleton;
@@ -349,9 +456,40 @@ namespace Realm {
 			     unsigned num_memories, unsigned num_ib_memories,
 			     const void *data, size_t datalen, int payload_mode);
 
+    // sends this node's announcement to every other node, either directly
+    //  or through the announcement tree (see NodeAnnounceBundleMessage)
+    static void announce_to_all(unsigned num_procs, unsigned num_memories,
+				unsigned num_ib_memories,
+				const void *data, size_t datalen);
+
     static void await_all_announcements(void);
   };
 
+  // carries the announcements of one or more nodes - bundles travel up the
+  //  announcement tree until node 0 has heard from everybody, and then back
+  //  down it so that each node receives each announcement exactly once
+  struct NodeAnnounceBundleMessage {
+    enum Phase {
+      PHASE_GATHER,     // child -> parent, announcements from child's subtree
+      PHASE_BROADCAST   // parent -> child, announcements from outside it
+    };
+
+    struct RequestArgs : public BaseMedium {
+      NodeID sender;
+      int phase;
+      unsigned num_records;
+    };
+
+    static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+    typedef ActiveMessageMediumNoReply<NODE_ANNOUNCE_BUNDLE_MSGID,
+				       RequestArgs,
+				       handle_request> Message;
+
+    static void send_request(NodeID target, Phase phase, unsigned num_records,
+			     const void *data, size_t datalen);
+  };
+
 	
 }; // namespace Realm
 
@@ -43,6 +43,13 @@ static const void *ignore_gasnet_warning1 __attribute__((unused)) = (void *)_gas
 namespace Realm {
 
   Logger log_malloc("malloc");
+
+  namespace Config {
+    // if true, instance allocation uses best fit (rather than first fit) to
+    //  select a free range
+    bool alloc_best_fit = false;
+    int gasnet_mem_home_pct = 0;
+  };
   Logger log_copy("copy");
   extern Logger log_inst; // in inst_impl.cc
 
@@ -96,6 +103,9 @@ namespace Realm {
       , peak_usage(stringbuilder() << "realm/mem " << _me << "/peak_usage")
       , peak_footprint(stringbuilder() << "realm/mem " << _me << "/peak_footprint")
     {
+      allocator.set_policy(Config::alloc_best_fit ?
+			     BasicRangeAllocator<size_t, RegionInstance>::BEST_FIT :
+			     BasicRangeAllocator<size_t, RegionInstance>::FIRST_FIT);
       allocator.add_range(0, _size);
     }
 
@@ -111,6 +121,11 @@ namespace Realm {
 	     me.id, 
 	     (size_t)peak_usage, peak_usage / 1048576.0,
 	     (size_t)peak_footprint, peak_footprint / 1048576.0);
+      printf("Memory " IDFMT " allocator: free=%zd (%.1f MB) largest=%zd (%.1f MB) ranges=%zd fragmentation=%.3f\n",
+	     me.id,
+	     (size_t)allocator.get_total_free(), allocator.get_total_free() / 1048576.0,
+	     (size_t)allocator.get_largest_free(), allocator.get_largest_free() / 1048576.0,
+	     allocator.get_num_free_ranges(), allocator.get_fragmentation());
 #endif
     }
 
@@ -386,11 +401,7 @@ namespace Realm {
       // TODO: ideally use something like (size_t)-2 here, but that will
       //  currently confuse the file read/write path in dma land
       size_t offset = (size_t)0; // this will be used for zero-size allocs
-      bool ok;
-      {
-	AutoHSLLock al(allocator_mutex);
-	ok = allocator.allocate(i, bytes, alignment, offset);
-      }
+      bool ok = allocate_storage_local(i, bytes, alignment, offset);
 
       if(ID(i).instance.creator_node == my_node_id) {
 	// local notification of result
@@ -406,6 +417,44 @@ namespace Realm {
       return true /*immediate notification*/;
     }
 
+    bool MemoryImpl::allocate_storage_local(RegionInstance i,
+					    size_t bytes, size_t alignment,
+					    size_t& offset)
+    {
+      AutoHSLLock al(allocator_mutex);
+      return allocator.allocate(i, bytes, alignment, offset);
+    }
+
+    void MemoryImpl::release_storage_local(RegionInstance i)
+    {
+      AutoHSLLock al(allocator_mutex);
+      allocator.deallocate(i);
+    }
+
+    bool MemoryImpl::fill_bytes(off_t offset, size_t size,
+				const void *pattern, size_t pattern_size)
+    {
+      // only memories whose direct pointers are usable by the CPU
+      if((kind != MKIND_SYSMEM) && (kind != MKIND_ZEROCOPY) &&
+	 (kind != MKIND_MANAGED))
+	return false;
+      void *dst = get_direct_ptr(offset, size);
+      if(!dst)
+	return false;
+      fill_with_pattern(dst, size, pattern, pattern_size);
+      return true;
+    }
+
+    void MemoryImpl::get_allocator_stats(size_t& total_free, size_t& largest_free,
+					     size_t& num_free_ranges, double& fragmentation)
+    {
+      AutoHSLLock al(allocator_mutex);
+      total_free = allocator.get_total_free();
+      largest_free = allocator.get_largest_free();
+      num_free_ranges = allocator.get_num_free_ranges();
+      fragmentation = allocator.get_fragmentation();
+    }
+
     // release storage associated with an instance
     void MemoryImpl::release_instance_storage(RegionInstance i,
 					      Event precondition)
@@ -423,10 +472,7 @@ namespace Realm {
       // TODO: memory needs to handle non-ready releases
       assert(precondition.has_triggered());
 
-      {
-	AutoHSLLock al(allocator_mutex);
-	allocator.deallocate(i);
-      }
+      release_storage_local(i);
 
       if(ID(i).instance.creator_node == my_node_id) {
 	// local notification of result
@@ -602,14 +648,84 @@ namespace Realm {
 
       size = size_per_node * num_nodes;
       memory_stride = MEMORY_STRIDE;
+
+      // carve out the home regions from the end of each node's share,
+      //  keeping the striped part a whole number of blocks
+      home_per_node = (size_per_node / 100) * std::min(std::max(Config::gasnet_mem_home_pct, 0), 100);
+      striped_per_node = ((size_per_node - home_per_node) / memory_stride) * memory_stride;
+      home_per_node = size_per_node - striped_per_node;
+      striped_size = striped_per_node * num_nodes;
       
-      free_blocks[0] = size;
+      free_blocks[0] = striped_size;
       // tell new allocator about the available memory too
-      allocator.add_range(0, size);
+      allocator.add_range(0, striped_size);
+
+      if(home_per_node > 0) {
+	home_allocators.resize(num_nodes);
+	for(int i = 0; i < num_nodes; i++) {
+	  home_allocators[i] = new BasicRangeAllocator<size_t, RegionInstance>;
+	  home_allocators[i]->set_policy(Config::alloc_best_fit ?
+					   BasicRangeAllocator<size_t, RegionInstance>::BEST_FIT :
+					   BasicRangeAllocator<size_t, RegionInstance>::FIRST_FIT);
+	  size_t first = striped_size + (i * home_per_node);
+	  home_allocators[i]->add_range(first, first + home_per_node);
+	}
+      }
     }
 
     GASNetMemory::~GASNetMemory(void)
     {
+      for(size_t i = 0; i < home_allocators.size(); i++)
+	delete home_allocators[i];
+    }
+
+    char *GASNetMemory::translate(off_t offset, int& node, size_t& contig_bytes) const
+    {
+      if(offset < striped_size) {
+	off_t blkid = (offset / memory_stride / num_nodes);
+	off_t blkoffset = offset % memory_stride;
+	node = (offset / memory_stride) % num_nodes;
+	contig_bytes = memory_stride - blkoffset;
+	return segbases[node] + (blkid * memory_stride) + blkoffset;
+      } else {
+	off_t home_offset = offset - striped_size;
+	node = home_offset / home_per_node;
+	assert(node < num_nodes);
+	off_t rel_offset = home_offset % home_per_node;
+	contig_bytes = home_per_node - rel_offset;
+	return segbases[node] + striped_per_node + rel_offset;
+      }
+    }
+
+    bool GASNetMemory::allocate_storage_local(RegionInstance i,
+					      size_t bytes, size_t alignment,
+					      size_t& offset)
+    {
+      if(!home_allocators.empty()) {
+	NodeID home = ID(i).instance.creator_node;
+	AutoHSLLock al(allocator_mutex);
+	if(home_allocators[home]->allocate(i, bytes, alignment, offset)) {
+	  homed_instances[i] = home;
+	  return true;
+	}
+      }
+
+      return MemoryImpl::allocate_storage_local(i, bytes, alignment, offset);
+    }
+
+    void GASNetMemory::release_storage_local(RegionInstance i)
+    {
+      {
+	AutoHSLLock al(allocator_mutex);
+	std::map<RegionInstance, NodeID>::iterator it = homed_instances.find(i);
+	if(it != homed_instances.end()) {
+	  home_allocators[it->second]->deallocate(i);
+	  homed_instances.erase(it);
+	  return;
+	}
+      }
+
+      MemoryImpl::release_storage_local(i);
     }
 
     off_t GASNetMemory::alloc_bytes(size_t size)
@@ -634,15 +750,14 @@ namespace Realm {
     {
       char *dst_c = (char *)dst;
       while(size > 0) {
-	off_t blkid = (offset / memory_stride / num_nodes);
-	off_t node = (offset / memory_stride) % num_nodes;
-	off_t blkoffset = offset % memory_stride;
-	size_t chunk_size = memory_stride - blkoffset;
+	int node;
+	size_t chunk_size;
+	char *src_c = translate(offset, node, chunk_size);
 	if(chunk_size > size) chunk_size = size;
 #ifdef USE_GASNET
-	gasnet_get(dst_c, node, segbases[node]+(blkid * memory_stride)+blkoffset, chunk_size);
+	gasnet_get(dst_c, node, src_c, chunk_size);
 #else
-	memcpy(dst_c, segbases[node]+(blkid * memory_stride)+blkoffset, chunk_size);
+	memcpy(dst_c, src_c, chunk_size);
 #endif
 	offset += chunk_size;
 	dst_c += chunk_size;
@@ -654,15 +769,14 @@ namespace Realm {
     {
       char *src_c = (char *)src; // dropping const on purpose...
       while(size > 0) {
-	off_t blkid = (offset / memory_stride / num_nodes);
-	off_t node = (offset / memory_stride) % num_nodes;
-	off_t blkoffset = offset % memory_stride;
-	size_t chunk_size = memory_stride - blkoffset;
+	int node;
+	size_t chunk_size;
+	char *dst_c = translate(offset, node, chunk_size);
 	if(chunk_size > size) chunk_size = size;
 #ifdef USE_GASNET
-	gasnet_put(node, segbases[node]+(blkid * memory_stride)+blkoffset, src_c, chunk_size);
+	gasnet_put(node, dst_c, src_c, chunk_size);
 #else
-	memcpy(segbases[node]+(blkid * memory_stride)+blkoffset, src_c, chunk_size);
+	memcpy(dst_c, src_c, chunk_size);
 #endif
 	offset += chunk_size;
 	src_c += chunk_size;
@@ -701,11 +815,13 @@ namespace Realm {
 
     int GASNetMemory::get_home_node(off_t offset, size_t size)
     {
-      off_t start_blk = offset / memory_stride;
-      off_t end_blk = (offset + size - 1) / memory_stride;
-      if(start_blk != end_blk) return -1;
+      // a range has a home node only if it's entirely in one node's memory
+      int node;
+      size_t contig_bytes;
+      translate(offset, node, contig_bytes);
+      if(size > contig_bytes) return -1;
 
-      return start_blk % num_nodes;
+      return node;
     }
 
     void GASNetMemory::get_batch(size_t batch_size,
@@ -724,16 +840,12 @@ namespace Realm {
 	char *dst_c = (char *)(dsts[i]);
 	size_t size = sizes[i];
 
-	off_t blkid = (offset / memory_stride / num_nodes);
-	off_t node = (offset / memory_stride) % num_nodes;
-	off_t blkoffset = offset % memory_stride;
-
 	while(size > 0) {
-	  size_t chunk_size = memory_stride - blkoffset;
+	  int node;
+	  size_t chunk_size;
+	  char *src_c = translate(offset, node, chunk_size);
 	  if(chunk_size > size) chunk_size = size;
 
-	  char *src_c = (segbases[node] +
-			 (blkid * memory_stride) + blkoffset);
 #ifdef USE_GASNET
 	  if(node != my_node_id) {
 	    gasnet_get_nbi(dst_c, node, src_c, chunk_size);
@@ -743,11 +855,9 @@ namespace Realm {
 	    memcpy(dst_c, src_c, chunk_size);
 	  }
 
+	  offset += chunk_size;
 	  dst_c += chunk_size;
 	  size -= chunk_size;
-	  blkoffset = 0;
-	  node = (node + 1) % num_nodes;
-	  if(node == 0) blkid++;
 	}
       }
       DetailedTimer::pop_timer();
@@ -784,16 +894,12 @@ namespace Realm {
 	const char *src_c = (char *)(srcs[i]);
 	size_t size = sizes[i];
 
-	off_t blkid = (offset / memory_stride / num_nodes);
-	off_t node = (offset / memory_stride) % num_nodes;
-	off_t blkoffset = offset % memory_stride;
-
 	while(size > 0) {
-	  size_t chunk_size = memory_stride - blkoffset;
+	  int node;
+	  size_t chunk_size;
+	  char *dst_c = translate(offset, node, chunk_size);
 	  if(chunk_size > size) chunk_size = size;
 
-	  char *dst_c = (segbases[node] +
-			 (blkid * memory_stride) + blkoffset);
 #ifdef USE_GASNET
 	  if(node != my_node_id) {
 	    gasnet_put_nbi(node, dst_c, (void *)src_c, chunk_size);
@@ -803,11 +909,9 @@ namespace Realm {
 	    memcpy(dst_c, src_c, chunk_size);
 	  }
 
+	  offset += chunk_size;
 	  src_c += chunk_size;
 	  size -= chunk_size;
-	  blkoffset = 0;
-	  node = (node + 1) % num_nodes;
-	  if(node == 0) blkid++;
 	}
       }
       DetailedTimer::pop_timer();
@@ -1002,6 +1106,46 @@ namespace Realm {
   static PartialWriteMap partial_remote_writes;
   static GASNetHSL partial_remote_writes_lock;
 
+  // notes the arrival of one piece of a sequenced remote write (or reduce),
+  //  acking the fence if it has already arrived and this was the last piece
+  static void record_partial_remote_write(unsigned sender, unsigned sequence_id)
+  {
+    PartialWriteKey key;
+    key.sender = sender;
+    key.sequence_id = sequence_id;
+    partial_remote_writes_lock.lock();
+    PartialWriteMap::iterator it = partial_remote_writes.find(key);
+    if(it == partial_remote_writes.end()) {
+      // first reference to this one
+      PartialWriteEntry entry;
+      entry.fence = 0;
+      entry.remaining_count = -1;
+      partial_remote_writes[key] = entry;
+#ifdef DEBUG_PWT
+      printf("PWT: %d: new entry for %d/%d: %p, %d\n",
+	     my_node_id, key.sender, key.sequence_id,
+	     entry.fence, entry.remaining_count);
+#endif
+    } else {
+      // have an existing entry (either another write or the fence)
+      PartialWriteEntry& entry = it->second;
+#ifdef DEBUG_PWT
+      printf("PWT: %d: have entry for %d/%d: %p, %d -> %d\n",
+	     my_node_id, key.sender, key.sequence_id,
+	     entry.fence,
+	     entry.remaining_count, entry.remaining_count - 1);
+#endif
+      entry.remaining_count--;
+      if(entry.remaining_count == 0) {
+	// we're the last write, and we've already got the fence, so 
+	//  respond
+	RemoteWriteFenceAckMessage::send_request(sender, entry.fence);
+	partial_remote_writes.erase(it);
+      }
+    }
+    partial_remote_writes_lock.unlock();
+  }
+
   /*static*/ void RemoteWriteMessage::handle_request(RequestArgs args,
 						     const void *data,
 						     size_t datalen)
@@ -1046,45 +1190,8 @@ namespace Realm {
       impl->put_bytes(args.offset, data, datalen);
 
     // track the sequence ID to know when the full RDMA is done
-    if(args.sequence_id > 0) {
-      PartialWriteKey key;
-      key.sender = args.sender;
-      key.sequence_id = args.sequence_id;
-      partial_remote_writes_lock.lock();
-      PartialWriteMap::iterator it = partial_remote_writes.find(key);
-      if(it == partial_remote_writes.end()) {
-	// first reference to this one
-	PartialWriteEntry entry;
-	entry.fence = 0;
-	entry.remaining_count = -1;
-	partial_remote_writes[key] = entry;
-#ifdef DEBUG_PWT
-	printf("PWT: %d: new entry for %d/%d: %p, %d\n",
-	       my_node_id, key.sender, key.sequence_id,
-	       entry.fence, entry.remaining_count);
-#endif
-      } else {
-	// have an existing entry (either another write or the fence)
-	PartialWriteEntry& entry = it->second;
-#ifdef DEBUG_PWT
-	printf("PWT: %d: have entry for %d/%d: %p, %d -> %d\n",
-	       my_node_id, key.sender, key.sequence_id,
-	       entry.fence,
-	       entry.remaining_count, entry.remaining_count - 1);
-#endif
-	entry.remaining_count--;
-	if(entry.remaining_count == 0) {
-	  // we're the last write, and we've already got the fence, so 
-	  //  respond
-          RemoteWriteFenceAckMessage::send_request(args.sender,
-                                                   entry.fence);
-	  partial_remote_writes.erase(it);
-	  partial_remote_writes_lock.unlock();
-	  return;
-	}
-      }
-      partial_remote_writes_lock.unlock();
-    }
+    if(args.sequence_id > 0)
+      record_partial_remote_write(args.sender, args.sequence_id);
   }
 
   ////////////////////////////////////////////////////////////////////////
@@ -1112,45 +1219,8 @@ namespace Realm {
     assert(datalen == 0);
 
     // track the sequence ID to know when the full RDMA is done
-    if(args.sequence_id > 0) {
-      PartialWriteKey key;
-      key.sender = args.sender;
-      key.sequence_id = args.sequence_id;
-      partial_remote_writes_lock.lock();
-      PartialWriteMap::iterator it = partial_remote_writes.find(key);
-      if(it == partial_remote_writes.end()) {
-	// first reference to this one
-	PartialWriteEntry entry;
-	entry.fence = 0;
-	entry.remaining_count = -1;
-	partial_remote_writes[key] = entry;
-#ifdef DEBUG_PWT
-	printf("PWT: %d: new entry for %d/%d: %p, %d\n",
-	       my_node_id, key.sender, key.sequence_id,
-	       entry.fence, entry.remaining_count);
-#endif
-      } else {
-	// have an existing entry (either another write or the fence)
-	PartialWriteEntry& entry = it->second;
-#ifdef DEBUG_PWT
-	printf("PWT: %d: have entry for %d/%d: %p, %d -> %d\n",
-	       my_node_id, key.sender, key.sequence_id,
-	       entry.fence,
-	       entry.remaining_count, entry.remaining_count - 1);
-#endif
-	entry.remaining_count--;
-	if(entry.remaining_count == 0) {
-	  // we're the last write, and we've already got the fence, so
-	  //  respond
-          RemoteWriteFenceAckMessage::send_request(args.sender,
-                                                   entry.fence);
-	  partial_remote_writes.erase(it);
-	  partial_remote_writes_lock.unlock();
-	  return;
-	}
-      }
-      partial_remote_writes_lock.unlock();
-    }
+    if(args.sequence_id > 0)
+      record_partial_remote_write(args.sender, args.sequence_id);
   }
 
   ////////////////////////////////////////////////////////////////////////
@@ -1195,45 +1265,8 @@ namespace Realm {
 			   args.stride, redop->sizeof_rhs, count, false /*not exclusive*/);
 
     // track the sequence ID to know when the full RDMA is done
-    if(args.sequence_id > 0) {
-      PartialWriteKey key;
-      key.sender = args.sender;
-      key.sequence_id = args.sequence_id;
-      partial_remote_writes_lock.lock();
-      PartialWriteMap::iterator it = partial_remote_writes.find(key);
-      if(it == partial_remote_writes.end()) {
-	// first reference to this one
-	PartialWriteEntry entry;
-	entry.fence = 0;
-	entry.remaining_count = -1;
-	partial_remote_writes[key] = entry;
-#ifdef DEBUG_PWT
-	printf("PWT: %d: new entry for %d/%d: %p, %d\n",
-	       my_node_id, key.sender, key.sequence_id,
-	       entry.fence, entry.remaining_count);
-#endif
-      } else {
-	// have an existing entry (either another write or the fence)
-	PartialWriteEntry& entry = it->second;
-#ifdef DEBUG_PWT
-	printf("PWT: %d: have entry for %d/%d: %p, %d -> %d\n",
-	       my_node_id, key.sender, key.sequence_id,
-	       entry.fence,
-	       entry.remaining_count, entry.remaining_count - 1);
-#endif
-	entry.remaining_count--;
-	if(entry.remaining_count == 0) {
-	  // we're the last write, and we've already got the fence, so 
-	  //  respond
-          RemoteWriteFenceAckMessage::send_request(args.sender,
-                                                   entry.fence);
-	  partial_remote_writes.erase(it);
-	  partial_remote_writes_lock.unlock();
-	  return;
-	}
-      }
-      partial_remote_writes_lock.unlock();
-    }
+    if(args.sequence_id > 0)
+      record_partial_remote_write(args.sender, args.sequence_id);
   }
 
   
@@ -1248,9 +1281,12 @@ namespace Realm {
   {
     MemoryImpl *impl = get_runtime()->get_memory_impl(args.mem);
     
-    log_copy.debug("received remote reduction list request: mem=" IDFMT ", offset=%zd, size=%zd, redopid=%d",
-		   args.mem.id, (ssize_t)args.offset, datalen, args.redopid);
+    log_copy.debug("received remote reduction list request: mem=" IDFMT ", offset=%zd, size=%zd, redopid=%d, seq=%d/%d",
+		   args.mem.id, (ssize_t)args.offset, datalen, args.redopid,
+		   args.sender, args.sequence_id);
 
+    // this handler runs on a bulk handler thread (if there are any), so the
+    //  application of even a large batch doesn't hold up message polling
     switch(impl->kind) {
     case MemoryImpl::MKIND_SYSMEM:
     case MemoryImpl::MKIND_ZEROCOPY:
@@ -1268,6 +1304,10 @@ namespace Realm {
 				   data);
       }
     }
+
+    // track the sequence ID to know when the whole batch is done
+    if(args.sequence_id > 0)
+      record_partial_remote_write(args.sender, args.sequence_id);
   }
 
   /*static*/ void RemoteReduceListMessage::send_request(NodeID target,
@@ -1276,17 +1316,82 @@ namespace Realm {
 							ReductionOpID redopid,
 							const void *data,
 							size_t datalen,
-							int payload_mode)
+							int payload_mode,
+							unsigned sequence_id /*= 0*/)
   {
     RequestArgs args;
 
     args.mem = mem;
     args.offset = offset;
     args.redopid = redopid;
+    args.sender = my_node_id;
+    args.sequence_id = sequence_id;
     Message::request(target, args, data, datalen, payload_mode);
   }
   
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class RemoteReduceListBatch
+  //
+
+  RemoteReduceListBatch::RemoteReduceListBatch(NodeID _target, Memory _mem,
+					       off_t _offset,
+					       ReductionOpID _redopid,
+					       unsigned _sequence_id)
+    : target(_target), mem(_mem), offset(_offset), redopid(_redopid)
+    , sequence_id(_sequence_id), buffered_entries(0), messages_sent(0)
+  {
+    const ReductionOpUntyped *redop = get_runtime()->reduce_op_table[redopid];
+    entry_size = redop->sizeof_list_entry;
+    assert(entry_size > 0);
+    // fill each message as far as the network allows (if it tells us)
+    size_t max_bytes = get_lmb_size(target);
+    if(max_bytes == 0)
+      max_bytes = 1 << 20;
+    max_entries = max_bytes / entry_size;
+    if(max_entries == 0)
+      max_entries = 1;
+    buffer.resize(max_entries * entry_size);
+  }
+
+  RemoteReduceListBatch::~RemoteReduceListBatch(void)
+  {
+    // unsent entries would be silently dropped
+    assert(buffered_entries == 0);
+  }
+
+  void RemoteReduceListBatch::add_entries(const void *entries, size_t count)
+  {
+    const char *src = static_cast<const char *>(entries);
+    while(count > 0) {
+      size_t to_copy = std::min(count, max_entries - buffered_entries);
+      memcpy(&buffer[buffered_entries * entry_size], src, to_copy * entry_size);
+      buffered_entries += to_copy;
+      src += to_copy * entry_size;
+      count -= to_copy;
+      if(buffered_entries == max_entries)
+	send_buffer();
+    }
+  }
+
+  unsigned RemoteReduceListBatch::flush(void)
+  {
+    if(buffered_entries > 0)
+      send_buffer();
+    return messages_sent;
+  }
+
+  void RemoteReduceListBatch::send_buffer(void)
+  {
+    RemoteReduceListMessage::send_request(target, mem, offset, redopid,
+					  &buffer[0], buffered_entries * entry_size,
+					  PAYLOAD_COPY, sequence_id);
+    buffered_entries = 0;
+    messages_sent++;
+  }
+  
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class RemoteWriteFence
@@ -1796,12 +1901,89 @@ namespace Realm {
       }
     }
 
-    void do_remote_apply_red_list(int node, Memory mem, off_t offset,
-				  ReductionOpID redopid,
-				  const void *data, size_t datalen)
+    unsigned do_remote_apply_red_list(int node, Memory mem, off_t offset,
+				      ReductionOpID redopid,
+				      const void *data, size_t datalen,
+				      unsigned sequence_id)
+    {
+      const ReductionOpUntyped *redop = get_runtime()->reduce_op_table[redopid];
+      assert((datalen % redop->sizeof_list_entry) == 0);
+      RemoteReduceListBatch batch(node, mem, offset, redopid, sequence_id);
+      batch.add_entries(data, datalen / redop->sizeof_list_entry);
+      return batch.flush();
+    }
+
+    size_t fill_pattern_period(const void *pattern, size_t pattern_size)
+    {
+      const char *p = static_cast<const char *>(pattern);
+      for(size_t period = 1; (period <= 16) && (period < pattern_size); period <<= 1) {
+	if((pattern_size % period) != 0)
+	  break;
+	bool repeats = true;
+	for(size_t ofs = period; repeats && (ofs < pattern_size); ofs += period)
+	  repeats = (memcmp(p, p + ofs, period) == 0);
+	if(repeats)
+	  return period;
+      }
+      return pattern_size;
+    }
+
+    template <typename T>
+    static void fill_wide(void *dst, size_t count, const void *pattern)
+    {
+      T val;
+      memcpy(&val, pattern, sizeof(T));
+      T *out = static_cast<T *>(dst);
+      for(size_t i = 0; i < count; i++)
+	out[i] = val;
+    }
+
+    void fill_with_pattern(void *dst, size_t size,
+			   const void *pattern, size_t pattern_size)
     {
-      RemoteReduceListMessage::send_request(node, mem, offset, redopid,
-					    data, datalen, PAYLOAD_COPY);
+      char *out = static_cast<char *>(dst);
+      size_t period = fill_pattern_period(pattern, pattern_size);
+      size_t done = 0;
+
+      if(period == 1) {
+	memset(out, *static_cast<const unsigned char *>(pattern), size);
+	return;
+      }
+
+      if(((period == 2) || (period == 4) || (period == 8) || (period == 16)) &&
+	 ((reinterpret_cast<uintptr_t>(out) % period) == 0)) {
+	size_t count = size / period;
+	switch(period) {
+	case 2: fill_wide<uint16_t>(out, count, pattern); break;
+	case 4: fill_wide<uint32_t>(out, count, pattern); break;
+	case 8: fill_wide<uint64_t>(out, count, pattern); break;
+	case 16:
+	  {
+	    uint64_t val[2];
+	    memcpy(val, pattern, 16);
+	    uint64_t *out64 = reinterpret_cast<uint64_t *>(out);
+	    for(size_t i = 0; i < count; i++) {
+	      out64[2 * i] = val[0];
+	      out64[2 * i + 1] = val[1];
+	    }
+	    break;
+	  }
+	}
+	done = count * period;
+      } else {
+	// copy the pattern once, and then keep doubling the filled region
+	done = std::min(size, pattern_size);
+	memcpy(out, pattern, done);
+	while(done < size) {
+	  size_t chunk = std::min(done, size - done);
+	  memcpy(out + done, out, chunk);
+	  done += chunk;
+	}
+      }
+
+      // partial copy of the pattern at the end, if any
+      if(done < size)
+	memcpy(out + done, pattern, size - done);
     }
 
     void do_remote_fence(Memory mem, unsigned sequence_id, unsigned num_writes,
@@ -29,6 +29,8 @@
 #include "realm/event_impl.h"
 #include "realm/rsrv_impl.h"
 
+#include <set>
+
 #ifdef USE_HDF
 #include <hdf5.h>
 #endif
@@ -37,6 +39,16 @@ namespace Realm {
 
   class RegionInstanceImpl;
 
+  namespace Config {
+    // if true, instance allocation uses best fit (rather than first fit) to
+    //  select a free range
+    extern bool alloc_best_fit;
+    // percentage of each node's share of the GASNet global memory that is
+    //  set aside for instances homed on that node (rather than striped
+    //  across all nodes)
+    extern int gasnet_mem_home_pct;
+  };
+
   // manages a basic free list of ranges (using range type RT) and allocated
   //  ranges, which are tagged (tag type TT)
   // NOT thread-safe - must be protected from outside
@@ -51,17 +63,53 @@ namespace Realm {
       Range *prev_free, *next_free;  // double-linked list of just free ranges
     };
 
+    // first fit walks the free ranges in address order and takes the first that
+    //  works, while best fit takes the smallest free range that works
+    enum AllocPolicy {
+      FIRST_FIT,
+      BEST_FIT
+    };
+
     std::map<TT, Range *> allocated;  // direct lookup of allocated ranges by tag
     std::map<RT, Range *> by_first;   // direct lookup of all ranges by first
+    // sized-based lookup of free ranges - ties are broken by the range's address
+    //  in memory (not the range's first), which is fine since we only care about size
+    std::set<std::pair<RT, Range *> > free_by_size;
     Range sentinel;
-    // TODO: sized-based lookup of free ranges
+    AllocPolicy policy;
+    RT total_free;
 
     BasicRangeAllocator(void);
     ~BasicRangeAllocator(void);
 
+    void set_policy(AllocPolicy _policy);
+
     void add_range(RT first, RT last);
     bool allocate(TT tag, RT size, RT alignment, RT& first);
     void deallocate(TT tag);
+
+    // a detached range stays allocated but is no longer associated with any
+    //  tag - it can later be attached to a (possibly different) tag or
+    //  returned to the free list directly
+    Range *detach(TT tag);
+    void attach(TT tag, Range *r);
+    void deallocate_range(Range *r);
+
+    // statistics on the free ranges - fragmentation is reported as a value in
+    //  [0, 1) that is the fraction of the free space that is NOT part of the
+    //  largest free range (i.e. 0 means all free space is contiguous)
+    RT get_total_free(void) const;
+    RT get_largest_free(void) const;
+    size_t get_num_free_ranges(void) const;
+    double get_fragmentation(void) const;
+
+  protected:
+    // finds a free range that can satisfy the request (using the current
+    //  policy) - returns the sentinel if nothing fits
+    Range *find_free_range(RT size, RT alignment);
+
+    void add_free_range_size(Range *r);
+    void remove_free_range_size(Range *r);
   };
   
     class MemoryImpl {
@@ -77,6 +125,7 @@ namespace Realm {
 	MKIND_GPUFB,   // GPU framebuffer memory (accessible via cudaMemcpy)
 
 	MKIND_ZEROCOPY, // CPU memory, pinned for GPU access
+	MKIND_MANAGED, // CUDA managed memory, migrated between CPU and GPUs
 	MKIND_DISK,    // disk memory accessible by owner node
 	MKIND_FILE,    // file memory accessible by owner node
 #ifdef USE_HDF
@@ -104,6 +153,19 @@ namespace Realm {
       virtual void release_instance_storage(RegionInstance i,
 					    Event precondition);
 
+      // the owner-node halves of the above - these do the actual work on the
+      //  instance allocator and may be overridden to put a cache in front of
+      //  it
+      virtual bool allocate_storage_local(RegionInstance i,
+					  size_t bytes, size_t alignment,
+					  size_t& offset);
+      virtual void release_storage_local(RegionInstance i);
+
+      // statistics on the instance allocator's free space (only meaningful on
+      //  the memory's owner node)
+      void get_allocator_stats(size_t& total_free, size_t& largest_free,
+			       size_t& num_free_ranges, double& fragmentation);
+
       off_t alloc_bytes_local(size_t size);
       void free_bytes_local(off_t offset, size_t size);
 
@@ -116,6 +178,12 @@ namespace Realm {
       virtual void get_bytes(off_t offset, void *dst, size_t size) = 0;
       virtual void put_bytes(off_t offset, const void *src, size_t size) = 0;
 
+      // fills 'size' bytes at 'offset' with back-to-back copies of 'pattern'
+      //  (the last of which may be partial) if the memory has a fast way to
+      //  do so - returns false if the caller must use put_bytes instead
+      virtual bool fill_bytes(off_t offset, size_t size,
+			      const void *pattern, size_t pattern_size);
+
       virtual void apply_reduction_list(off_t offset, const ReductionOpUntyped *redop,
 					size_t count, const void *entry_buffer)
       {
@@ -125,6 +193,11 @@ namespace Realm {
       virtual void *get_direct_ptr(off_t offset, size_t size) = 0;
       virtual int get_home_node(off_t offset, size_t size) = 0;
 
+      // hints that [offset, offset+size) is about to be copied to or from
+      //  'peer' - memories that move data on demand can start moving it
+      //  toward whoever will access it (default == do nothing)
+      virtual void prefetch_for_copy(off_t offset, size_t size, Memory peer) {}
+
       virtual void *local_reg_base(void) { return 0; };
 
       Memory::Kind get_kind(void) const;
@@ -199,6 +272,13 @@ namespace Realm {
       virtual void *get_direct_ptr(off_t offset, size_t size);
       virtual int get_home_node(off_t offset, size_t size);
 
+      // instances are placed in the home region of the node that created
+      //  them when there's room, and striped otherwise
+      virtual bool allocate_storage_local(RegionInstance i,
+					  size_t bytes, size_t alignment,
+					  size_t& offset);
+      virtual void release_storage_local(RegionInstance i);
+
       void get_batch(size_t batch_size,
 		     const off_t *offsets, void * const *dsts, 
 		     const size_t *sizes);
@@ -208,10 +288,20 @@ namespace Realm {
 		     const size_t *sizes);
 
     protected:
+      // returns the node holding 'offset' and the address there, along with
+      //  how many bytes are contiguous from that point
+      char *translate(off_t offset, int& node, size_t& contig_bytes) const;
+
       int num_nodes;
       off_t memory_stride;
       std::vector<char *> segbases;
       //std::map<off_t, off_t> free_blocks;
+      // the striped part of the address space comes first, followed by one
+      //  contiguous home region per node
+      off_t striped_size;
+      size_t striped_per_node, home_per_node;
+      std::vector<BasicRangeAllocator<size_t, RegionInstance> *> home_allocators;
+      std::map<RegionInstance, NodeID> homed_instances;
     };
 
     class DiskMemory : public MemoryImpl {
@@ -453,6 +543,8 @@ namespace Realm {
 	Memory mem;
 	off_t offset;
 	ReductionOpID redopid;
+	unsigned sender;
+	unsigned sequence_id;
       };
 
       static void handle_request(RequestArgs args, const void *data, size_t datalen);
@@ -463,7 +555,38 @@ namespace Realm {
 
       static void send_request(NodeID target, Memory mem, off_t offset,
 			       ReductionOpID redopid,
-			       const void *data, size_t datalen, int payload_mode);
+			       const void *data, size_t datalen, int payload_mode,
+			       unsigned sequence_id = 0);
+    };
+
+    // accumulates reduction list entries headed for a single remote memory
+    //  and sends them in batches as large as a medium message allows - the
+    //  number of messages returned by flush() goes to do_remote_fence (with
+    //  the same sequence ID) to learn when all of them have been applied
+    class RemoteReduceListBatch {
+    public:
+      RemoteReduceListBatch(NodeID _target, Memory _mem, off_t _offset,
+			    ReductionOpID _redopid, unsigned _sequence_id);
+      ~RemoteReduceListBatch(void);
+
+      void add_entries(const void *entries, size_t count);
+
+      // sends any buffered entries and returns the total number of messages
+      //  sent by this batch
+      unsigned flush(void);
+
+    protected:
+      void send_buffer(void);
+
+      NodeID target;
+      Memory mem;
+      off_t offset;
+      ReductionOpID redopid;
+      unsigned sequence_id;
+      size_t entry_size, max_entries;
+      std::vector<char> buffer;
+      size_t buffered_entries;
+      unsigned messages_sent;
     };
     
     class RemoteWriteFence : public Operation::AsyncWorkItem {
@@ -546,6 +669,15 @@ namespace Realm {
 
     extern void do_remote_fence(Memory mem, unsigned sequence_id,
                                 unsigned count, RemoteWriteFence *fence);
+
+    // returns the smallest power-of-two length (up to 16 bytes) at which
+    //  'pattern' repeats, or 'pattern_size' if there isn't one
+    extern size_t fill_pattern_period(const void *pattern, size_t pattern_size);
+
+    // fills CPU-accessible memory with copies of 'pattern', using memset or
+    //  wide stores when the pattern allows
+    extern void fill_with_pattern(void *dst, size_t size,
+				  const void *pattern, size_t pattern_size);
     
 }; // namespace Realm
 
@@ -38,6 +38,8 @@ namespace Realm {
   template <typename RT, typename TT>
   inline BasicRangeAllocator<RT,TT>::BasicRangeAllocator(void)
     : sentinel((RT)-1,0)
+    , policy(FIRST_FIT)
+    , total_free(0)
   {
     // sentinel is the start and end of both dllists
     sentinel.prev = sentinel.next = &sentinel;
@@ -56,6 +58,30 @@ namespace Realm {
     }
   }
 
+  template <typename RT, typename TT>
+  inline void BasicRangeAllocator<RT,TT>::set_policy(AllocPolicy _policy)
+  {
+    policy = _policy;
+  }
+
+  template <typename RT, typename TT>
+  inline void BasicRangeAllocator<RT,TT>::add_free_range_size(Range *r)
+  {
+    free_by_size.insert(std::make_pair(r->last - r->first, r));
+    total_free += (r->last - r->first);
+  }
+
+  template <typename RT, typename TT>
+  inline void BasicRangeAllocator<RT,TT>::remove_free_range_size(Range *r)
+  {
+#ifndef NDEBUG
+    size_t count =
+#endif
+      free_by_size.erase(std::make_pair(r->last - r->first, r));
+    assert(count == 1);
+    total_free -= (r->last - r->first);
+  }
+
   template <typename RT, typename TT>
   inline void BasicRangeAllocator<RT,TT>::add_range(RT first, RT last)
   {
@@ -76,19 +102,39 @@ namespace Realm {
       // free block list
       newr->prev_free = prev_free; newr->next_free = prev_free->next_free;
       prev_free->next_free = newr->next_free->prev_free = newr;
+      by_first[first] = newr;
+      add_free_range_size(newr);
       return;
     }
 
     assert(0);
   }
-   
+
   template <typename RT, typename TT>
-  inline bool BasicRangeAllocator<RT,TT>::allocate(TT tag, RT size, RT alignment, RT& alloc_first)
+  inline typename BasicRangeAllocator<RT,TT>::Range *BasicRangeAllocator<RT,TT>::find_free_range(RT size, RT alignment)
   {
-    // empty allocation requests are trivial
-    if(size == 0) {
-      allocated[tag] = 0;
-      return true;
+    // quick rejection if even the largest free range is too small - alignment
+    //  can only make things worse
+    if(free_by_size.empty() || (free_by_size.rbegin()->first < size))
+      return &sentinel;
+
+    if(policy == BEST_FIT) {
+      // walk free ranges in increasing size, starting from the first one that's
+      //  big enough without considering alignment
+      for(typename std::set<std::pair<RT, Range *> >::const_iterator it = free_by_size.lower_bound(std::make_pair(size, (Range *)0));
+	  it != free_by_size.end();
+	  ++it) {
+	Range *r = it->second;
+	RT ofs = 0;
+	if(alignment) {
+	  RT rem = r->first % alignment;
+	  if(rem > 0)
+	    ofs = alignment - rem;
+	}
+	if((r->last - r->first) >= (size + ofs))
+	  return r;
+      }
+      return &sentinel;
     }
 
     // walk free ranges and just take the first that fits
@@ -101,88 +147,139 @@ namespace Realm {
 	  ofs = alignment - rem;
       }
       // do we have enough space?
-      if((r->last - r->first) >= (size + ofs)) {
-	// yes, but we may need chop things up to make the exact range we want
-	alloc_first = r->first + ofs;
-	RT alloc_last = alloc_first + size;
-
-        // do we need to carve off a new (free) block before us?
-        if(alloc_first != r->first) {
-          Range *new_prev = new Range(r->first, alloc_first);
-          r->first = alloc_first;
-          new_prev->prev = r->prev; new_prev->prev->next = new_prev;
-          new_prev->next = r;
-          r->prev = new_prev;
-          new_prev->prev_free = r->prev_free;
-          new_prev->prev_free->next_free = new_prev;
-          new_prev->next_free = r;
-          r->prev_free = new_prev;
-        }
-
-	// four cases to deal with
-	if(alloc_last == r->last) {
-	  if(alloc_first == r->first) {
-	    // case 1 - exact fit
-	    //
-	    // all we have to do here is remove this range from the free range dlist
-	    //  and add to the allocated lookup map
-	    r->prev_free->next_free = r->next_free;
-	    r->next_free->prev_free = r->prev_free;
-	    r->prev_free = r->next_free = 0;
-
-	    allocated[tag] = r;
-	    return true;
-	  } else {
-	    // case 2 - leftover at beginning
-	    assert(0);
-	  }
-	} else {
-	  if(alloc_first == r->first) {
-	    // case 3 - leftover at end
-	    Range *r_after = new Range(alloc_last, r->last);
-	    by_first[alloc_last] = r_after;
-	    r->last = alloc_last;
-
-	    // r_after goes after r in all block list
-	    r_after->prev = r; r_after->next = r->next;
-	    r->next->prev = r_after; r->next = r_after;
-
-	    // r_after replaces r in the free block list
-	    r_after->prev_free = r->prev_free;
-	    r_after->next_free = r->next_free;
-	    r->prev_free->next_free = r_after;
-	    r->next_free->prev_free = r_after;
-	    r->prev_free = r->next_free = 0;
-
-	    allocated[tag] = r;
-	    return true;
-	  } else {
-	    // case 4 - leftover on both sides
-	    assert(0);
-	  }
-	}
-      }
+      if((r->last - r->first) >= (size + ofs))
+	return r;
 
       // no, go to next one
       r = r->next_free;
     }
-    // allocation failed
+    return &sentinel;
+  }
+   
+  template <typename RT, typename TT>
+  inline bool BasicRangeAllocator<RT,TT>::allocate(TT tag, RT size, RT alignment, RT& alloc_first)
+  {
+    // empty allocation requests are trivial
+    if(size == 0) {
+      allocated[tag] = 0;
+      return true;
+    }
+
+    Range *r = find_free_range(size, alignment);
+    if(r == &sentinel) {
+      // allocation failed
+      return false;
+    }
+
+    RT ofs = 0;
+    if(alignment) {
+      RT rem = r->first % alignment;
+      if(rem > 0)
+	ofs = alignment - rem;
+    }
+
+    // this range is no longer free in its current form - any leftover pieces
+    //  are added back to the size index below
+    remove_free_range_size(r);
+
+    // we may need chop things up to make the exact range we want
+    alloc_first = r->first + ofs;
+    RT alloc_last = alloc_first + size;
+
+    // do we need to carve off a new (free) block before us?
+    if(alloc_first != r->first) {
+      Range *new_prev = new Range(r->first, alloc_first);
+      by_first[new_prev->first] = new_prev;
+      r->first = alloc_first;
+      by_first[r->first] = r;
+      new_prev->prev = r->prev; new_prev->prev->next = new_prev;
+      new_prev->next = r;
+      r->prev = new_prev;
+      new_prev->prev_free = r->prev_free;
+      new_prev->prev_free->next_free = new_prev;
+      new_prev->next_free = r;
+      r->prev_free = new_prev;
+      add_free_range_size(new_prev);
+    }
+
+    // four cases to deal with
+    if(alloc_last == r->last) {
+      if(alloc_first == r->first) {
+	// case 1 - exact fit
+	//
+	// all we have to do here is remove this range from the free range dlist
+	//  and add to the allocated lookup map
+	r->prev_free->next_free = r->next_free;
+	r->next_free->prev_free = r->prev_free;
+	r->prev_free = r->next_free = 0;
+
+	allocated[tag] = r;
+	return true;
+      } else {
+	// case 2 - leftover at beginning
+	assert(0);
+      }
+    } else {
+      if(alloc_first == r->first) {
+	// case 3 - leftover at end
+	Range *r_after = new Range(alloc_last, r->last);
+	by_first[alloc_last] = r_after;
+	r->last = alloc_last;
+
+	// r_after goes after r in all block list
+	r_after->prev = r; r_after->next = r->next;
+	r->next->prev = r_after; r->next = r_after;
+
+	// r_after replaces r in the free block list
+	r_after->prev_free = r->prev_free;
+	r_after->next_free = r->next_free;
+	r->prev_free->next_free = r_after;
+	r->next_free->prev_free = r_after;
+	r->prev_free = r->next_free = 0;
+	add_free_range_size(r_after);
+
+	allocated[tag] = r;
+	return true;
+      } else {
+	// case 4 - leftover on both sides
+	assert(0);
+      }
+    }
+    // not reachable
     return false;
   }
 
   template <typename RT, typename TT>
   inline void BasicRangeAllocator<RT,TT>::deallocate(TT tag)
+  {
+    Range *r = detach(tag);
+
+    // if there was no Range associated with this tag, it was an zero-size
+    //  allocation, and there's nothing to add to the free list
+    if(r)
+      deallocate_range(r);
+  }
+
+  template <typename RT, typename TT>
+  inline typename BasicRangeAllocator<RT,TT>::Range *BasicRangeAllocator<RT,TT>::detach(TT tag)
   {
     typename std::map<TT, Range *>::iterator it = allocated.find(tag);
     assert(it != allocated.end());
     Range *r = it->second;
     allocated.erase(it);
+    return r;
+  }
 
-    // if there was no Range associated with this tag, it was an zero-size
-    //  allocation, and there's nothing to add to the free list
-    if(!r)
-      return;
+  template <typename RT, typename TT>
+  inline void BasicRangeAllocator<RT,TT>::attach(TT tag, Range *r)
+  {
+    assert(allocated.count(tag) == 0);
+    allocated[tag] = r;
+  }
 
+  template <typename RT, typename TT>
+  inline void BasicRangeAllocator<RT,TT>::deallocate_range(Range *r)
+  {
     // need to add ourselves back to the free list - find previous and next
     //  free entries (which have non-null prev_free/next_free pointers)
     Range *prev_free = r->prev;
@@ -200,6 +297,13 @@ namespace Realm {
     bool merge_prev = (prev_free == r->prev) && (prev_free != &sentinel);
     bool merge_next = (next_free == r->next) && (next_free != &sentinel);
 
+    // any free neighbors we merge with leave the size index, and the merged
+    //  result is added back at the end
+    if(merge_prev)
+      remove_free_range_size(r->prev);
+    if(merge_next)
+      remove_free_range_size(r->next);
+
     // four cases - ordered to match the allocation cases
     if(!merge_next) {
       if(!merge_prev) {
@@ -271,7 +375,35 @@ namespace Realm {
 	delete old_next;
       }
     }
+
+    add_free_range_size(r);
   };
+
+  template <typename RT, typename TT>
+  inline RT BasicRangeAllocator<RT,TT>::get_total_free(void) const
+  {
+    return total_free;
+  }
+
+  template <typename RT, typename TT>
+  inline RT BasicRangeAllocator<RT,TT>::get_largest_free(void) const
+  {
+    return (free_by_size.empty() ? 0 : free_by_size.rbegin()->first);
+  }
+
+  template <typename RT, typename TT>
+  inline size_t BasicRangeAllocator<RT,TT>::get_num_free_ranges(void) const
+  {
+    return free_by_size.size();
+  }
+
+  template <typename RT, typename TT>
+  inline double BasicRangeAllocator<RT,TT>::get_fragmentation(void) const
+  {
+    if(total_free == 0)
+      return 0.0;
+    return (1.0 - ((double)get_largest_free() / (double)total_free));
+  }
   
     
 }; // namespace Realm
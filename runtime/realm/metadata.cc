@@ -94,8 +94,24 @@ namespace Realm {
       // sanity-check - should never be requesting data from ourselves
       assert(owner != my_node_id);
 
-      Event e = Event::NO_EVENT;
       bool issue_request = false;
+      Event e = begin_request(issue_request);
+
+      if(issue_request)
+	MetadataRequestMessage::send_request(owner, id);
+
+      return e;
+    }
+
+    Event MetadataBase::begin_request(bool& must_send)
+    {
+      must_send = false;
+
+      // early out - valid data need not be re-requested
+      if(state == STATE_VALID) 
+	return Event::NO_EVENT;
+
+      Event e = Event::NO_EVENT;
       {
 	AutoHSLLock a(mutex);
 
@@ -113,7 +129,7 @@ namespace Realm {
 	    state = STATE_REQUESTED;
 	    valid_event = GenEventImpl::create_genevent()->current_event();
             e = valid_event;
-	    issue_request = true;
+	    must_send = true;
 	    break;
 	  }
 
@@ -133,9 +149,6 @@ namespace Realm {
 	}
       }
 
-      if(issue_request)
-	MetadataRequestMessage::send_request(owner, id);
-
       return e;
     }
 
@@ -329,6 +342,110 @@ namespace Realm {
   }
 
   
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MetadataBatchRequestMessage
+  //
+
+  /*static*/ void MetadataBatchRequestMessage::handle_request(RequestArgs args,
+							      const void *data,
+							      size_t datalen)
+  {
+    assert(datalen == (args.count * sizeof(ID::IDType)));
+    const ID::IDType *ids = static_cast<const ID::IDType *>(data);
+
+    // each entry in the response is an ID, a size, and that many bytes of
+    //  serialized metadata
+    Serialization::DynamicBufferSerializer dbs(256);
+    int num_valid = 0;
+    for(int i = 0; i < args.count; i++) {
+      ID id(ids[i]);
+      if(id.is_instance()) {
+	RegionInstanceImpl *impl = get_runtime()->get_instance_impl(ids[i]);
+	bool valid = impl->metadata.handle_request(args.node);
+	if(valid) {
+	  size_t md_len = 0;
+	  void *md = impl->metadata.serialize(md_len);
+	  bool ok = ((dbs << ids[i]) &&
+		     (dbs << md_len) &&
+		     dbs.append_bytes(md, md_len));
+	  assert(ok);
+	  free(md);
+	  num_valid++;
+	}
+      } else {
+	assert(0);
+      }
+    }
+
+    log_metadata.info() << "batch metadata request from " << args.node
+			<< ": " << args.count << " ids, " << num_valid << " valid";
+
+    if(num_valid > 0) {
+      size_t resp_len = dbs.bytes_used();
+      MetadataBatchResponseMessage::send_request(args.node, num_valid,
+						 dbs.detach_buffer(), resp_len);
+    }
+  }
+
+  /*static*/ void MetadataBatchRequestMessage::send_request(NodeID target,
+							    const std::vector<ID::IDType>& ids)
+  {
+    RequestArgs args;
+
+    args.node = my_node_id;
+    args.count = ids.size();
+    Message::request(target, args, &ids[0], ids.size() * sizeof(ID::IDType),
+		     PAYLOAD_COPY);
+  }
+
+  
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class MetadataBatchResponseMessage
+  //
+
+  /*static*/ void MetadataBatchResponseMessage::handle_request(RequestArgs args,
+							       const void *data,
+							       size_t datalen)
+  {
+    Serialization::FixedBufferDeserializer fbd(data, datalen);
+    for(int i = 0; i < args.count; i++) {
+      ID::IDType id;
+      size_t md_len;
+#ifndef NDEBUG
+      bool ok =
+#endif
+	(fbd >> id) && (fbd >> md_len);
+      assert(ok);
+      const void *md = fbd.peek_bytes(md_len);
+      assert(md != 0);
+
+      log_metadata.info("metadata for " IDFMT " received (batched) - %zd bytes",
+			id, md_len);
+
+      if(ID(id).is_instance()) {
+	RegionInstanceImpl *impl = get_runtime()->get_instance_impl(id);
+	impl->metadata.deserialize(md, md_len);
+	impl->metadata.handle_response();
+      } else {
+	assert(0);
+      }
+      fbd.extract_bytes(0, md_len);
+    }
+    assert(fbd.bytes_left() == 0);
+  }
+
+  /*static*/ void MetadataBatchResponseMessage::send_request(NodeID target, int count,
+							     void *data, size_t datalen)
+  {
+    RequestArgs args;
+
+    args.count = count;
+    Message::request(target, args, data, datalen, PAYLOAD_FREE);
+  }
+
+  
   ////////////////////////////////////////////////////////////////////////
   //
   // class MetadataInvalidateMessage
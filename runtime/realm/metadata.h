@@ -49,6 +49,10 @@ namespace Realm {
 
       // returns an Event for when data will be valid
       Event request_data(int owner, ID::IDType id);
+      // like request_data, but leaves the sending of the request to the
+      //  caller (so that it can be batched with others) - 'must_send' is
+      //  set if this call moved the metadata into the REQUESTED state
+      Event begin_request(bool& must_send);
       void await_data(bool block = true);  // request must have already been made
       void handle_response(void);
       void handle_invalidate(void);
@@ -98,6 +102,41 @@ namespace Realm {
 				    const void *data, size_t datalen);
     };
 
+    // batched versions of the above - a request carries a list of IDs, all
+    //  owned by the target node, and the response carries the metadata for
+    //  every one of them that was already valid (the rest are sent
+    //  individually once they become valid)
+    struct MetadataBatchRequestMessage {
+      struct RequestArgs : public BaseMedium {
+	NodeID node;
+	int count;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<METADATA_BATCH_REQUEST_MSGID,
+					 RequestArgs,
+					 handle_request> Message;
+
+      static void send_request(NodeID target, const std::vector<ID::IDType>& ids);
+    };
+
+    struct MetadataBatchResponseMessage {
+      struct RequestArgs : public BaseMedium {
+	int count;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<METADATA_BATCH_RESPONSE_MSGID,
+					 RequestArgs,
+					 handle_request> Message;
+
+      // takes ownership of 'data'
+      static void send_request(NodeID target, int count,
+			       void *data, size_t datalen);
+    };
+
     struct MetadataInvalidateMessage {
       struct RequestArgs {
 	int owner;
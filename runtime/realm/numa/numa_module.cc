@@ -39,6 +39,8 @@ namespace Realm {
     LocalNumaProcessor(Processor _me, int _numa_node,
 		       CoreReservationSet& crs, size_t _stack_size);
     virtual ~LocalNumaProcessor(void);
+
+    virtual int get_numa_domain(void) const;
   protected:
     int numa_node;
     CoreReservation *core_rsrv;
@@ -72,6 +74,11 @@ namespace Realm {
     set_scheduler(sched);
   }
 
+  /*virtual*/ int LocalNumaProcessor::get_numa_domain(void) const
+  {
+    return numa_node;
+  }
+
   LocalNumaProcessor::~LocalNumaProcessor(void)
   {
     delete core_rsrv;
@@ -91,6 +98,9 @@ namespace Realm {
       , cfg_num_numa_cpus(0)
       , cfg_pin_memory(false)
       , cfg_stack_size_in_mb(2)
+      , cfg_transparent_hugepages(false)
+      , cfg_hugepage_size_in_mb(0)
+      , cfg_prefault_threads(0)
     {
     }
       
@@ -111,7 +121,10 @@ namespace Realm {
 	cp.add_option_int("-ll:nsize", m->cfg_numa_mem_size_in_mb)
 	  .add_option_int("-ll:ncsize", m->cfg_numa_nocpu_mem_size_in_mb)
 	  .add_option_int("-ll:ncpu", m->cfg_num_numa_cpus)
-	  .add_option_bool("-numa:pin", m->cfg_pin_memory);
+	  .add_option_bool("-numa:pin", m->cfg_pin_memory)
+	  .add_option_bool("-numa:thp", m->cfg_transparent_hugepages)
+	  .add_option_int("-numa:hugepages", m->cfg_hugepage_size_in_mb)
+	  .add_option_int("-numa:prefault", m->cfg_prefault_threads);
 	
 	bool ok = cp.parse_command_line(cmdline);
 	if(!ok) {
@@ -189,6 +202,16 @@ namespace Realm {
       return m;
     }
 
+    // the page backing to ask numasysif for
+    size_t NumaModule::hugepage_size(void) const
+    {
+      if(cfg_hugepage_size_in_mb > 0)
+	return (cfg_hugepage_size_in_mb << 20);
+      if(cfg_transparent_hugepages)
+	return NUMASYSIF_TRANSPARENT_HUGEPAGES;
+      return 0;
+    }
+
     // do any general initialization - this is called after all configuration is
     //  complete
     void NumaModule::initialize(RuntimeImpl *runtime)
@@ -203,7 +226,9 @@ namespace Realm {
 	assert(mem_size > 0);
 	void *base = numasysif_alloc_mem(it->first,
 					 mem_size,
-					 cfg_pin_memory);
+					 cfg_pin_memory,
+					 hugepage_size(),
+					 cfg_prefault_threads);
 	if(!base) {
 	  log_numa.fatal() << "allocation of " << mem_size << " bytes in NUMA node " << it->first << " failed!";
 	  assert(false);
@@ -330,7 +355,8 @@ namespace Realm {
 	  ++it) {
 	size_t mem_size = numa_mem_sizes[it->first];
 	assert(mem_size > 0);
-	bool ok = numasysif_free_mem(it->first, it->second, mem_size);
+	bool ok = numasysif_free_mem(it->first, it->second, mem_size,
+				     hugepage_size());
 	if(!ok)
 	  log_numa.error() << "failed to free memory in NUMA node " << it->first << ": ptr=" << it->second;
       }
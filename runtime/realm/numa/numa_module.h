@@ -57,12 +57,18 @@ namespace Realm {
       //  after all memories/processors/etc. have been shut down and destroyed
       virtual void cleanup(void);
 
+    protected:
+      size_t hugepage_size(void) const;
+
     public:
       size_t cfg_numa_mem_size_in_mb;
       ssize_t cfg_numa_nocpu_mem_size_in_mb;
       int cfg_num_numa_cpus;
       bool cfg_pin_memory;
       size_t cfg_stack_size_in_mb;
+      bool cfg_transparent_hugepages;
+      size_t cfg_hugepage_size_in_mb;  // explicit huge pages if non-zero
+      int cfg_prefault_threads;
 
       // "global" variables live here too
       std::map<int, void *> numa_mem_bases;
@@ -26,6 +26,7 @@
 #include <errno.h>
 
 #include <vector>
+#include <algorithm>
 
 #ifdef __linux__
 #include <alloca.h>
@@ -35,6 +36,7 @@
 #include <dirent.h>
 #include <sched.h>
 #include <ctype.h>
+#include <pthread.h>
 #include <sys/mman.h>
 
 namespace {
@@ -312,43 +314,203 @@ namespace Realm {
 #endif
   }
 
-  // allocate memory on a given NUMA node - pin if requested
-  void *numasysif_alloc_mem(int node, size_t bytes, bool pin)
+#ifdef __linux__
+  // explicit huge page mappings have to cover a whole number of pages
+  static size_t mapping_size(size_t bytes, size_t hugepage_size)
+  {
+    if(hugepage_size > NUMASYSIF_TRANSPARENT_HUGEPAGES)
+      return ((bytes + hugepage_size - 1) / hugepage_size) * hugepage_size;
+    else
+      return bytes;
+  }
+#endif
+
+  // allocate memory on a given NUMA node (or anywhere if node < 0) - pin if
+  //  requested, and pre-fault the pages from 'prefault_threads' threads
+  //  running in that node if non-zero
+  void *numasysif_alloc_mem(int node, size_t bytes, bool pin,
+			    size_t hugepage_size /*= 0*/,
+			    int prefault_threads /*= 0*/)
   {
 #ifdef __linux__
     // get memory from mmap
-    // TODO: hugetlbfs, if possible
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if(hugepage_size > NUMASYSIF_TRANSPARENT_HUGEPAGES) {
+#ifdef MAP_HUGETLB
+      // the page size is encoded as its log2 in the upper flag bits
+      int shift = 0;
+      while((size_t(1) << shift) < hugepage_size) shift++;
+      if((size_t(1) << shift) != hugepage_size) {
+	fprintf(stderr, "huge page size is not a power of 2: %zd\n", hugepage_size);
+	return 0;
+      }
+      flags |= MAP_HUGETLB | (shift << 26 /*MAP_HUGE_SHIFT*/);
+#else
+      fprintf(stderr, "explicit huge pages not supported\n");
+      return 0;
+#endif
+    }
+    size_t map_bytes = mapping_size(bytes, hugepage_size);
     void *base = mmap(0,
-		      bytes, 
+		      map_bytes,
 		      PROT_READ | PROT_WRITE,
-		      MAP_PRIVATE | MAP_ANONYMOUS,
+		      flags,
 		      -1,
 		      0);
-    if(!base) return 0;
+    if(base == MAP_FAILED) {
+      fprintf(stderr, "mmap of %zd bytes failed: %s\n", map_bytes, strerror(errno));
+      return 0;
+    }
 
-    // use the bind call for the rest
-    if(numasysif_bind_mem(node, base, bytes, pin))
-      return base;
+#ifdef MADV_HUGEPAGE
+    // transparent huge pages are only a hint - failure is not fatal
+    if(hugepage_size == NUMASYSIF_TRANSPARENT_HUGEPAGES)
+      if(madvise(base, map_bytes, MADV_HUGEPAGE) != 0)
+	fprintf(stderr, "madvise(MADV_HUGEPAGE) failed: %s\n", strerror(errno));
+#endif
+
+    // use the bind call for the rest, but pages have to be faulted (in
+    //  parallel, if requested) before they are pinned
+    if(((node < 0) || numasysif_bind_mem(node, base, map_bytes, false)) &&
+       ((prefault_threads <= 0) ||
+	numasysif_prefault_mem(node, base, map_bytes, prefault_threads))) {
+      if(!pin || (mlock(base, map_bytes) == 0))
+	return base;
+      fprintf(stderr, "mlock failed for memory on node %d: %s\n", node, strerror(errno));
+    }
 
     // if not, clean up and return failure
-    numasysif_free_mem(node, base, bytes);
+    numasysif_free_mem(node, base, bytes, hugepage_size);
     return 0;
 #else
     return 0;
 #endif
   }
 
-  // free memory allocated on a given NUMA node
-  bool numasysif_free_mem(int node, void *base, size_t bytes)
+  // free memory allocated on a given NUMA node - 'hugepage_size' must match
+  //  what was used for the allocation
+  bool numasysif_free_mem(int node, void *base, size_t bytes,
+			  size_t hugepage_size /*= 0*/)
   {
 #ifdef __linux__
-    int ret = munmap(base, bytes);
+    int ret = munmap(base, mapping_size(bytes, hugepage_size));
     return(ret == 0);
 #else
     return false;
 #endif
   }
 
+#ifdef __linux__
+  namespace {
+    struct PrefaultArgs {
+      char *start;
+      size_t bytes;
+      size_t stride;
+      bool bind;
+      cpu_set_t cpus;
+    };
+
+    void *prefault_thread(void *data)
+    {
+      const PrefaultArgs *args = (const PrefaultArgs *)data;
+      if(args->bind)
+	sched_setaffinity(0, sizeof(args->cpus), &(args->cpus));
+      // a write is needed - a read of an untouched anonymous page just maps
+      //  the shared zero page
+      volatile char *p = args->start;
+      for(size_t ofs = 0; ofs < args->bytes; ofs += args->stride)
+	p[ofs] = 0;
+      return 0;
+    }
+  };
+
+  // fills in 'cpus' with the cpus of 'node' that we're allowed to run on
+  static bool get_node_cpus(int node, cpu_set_t& cpus)
+  {
+    cpu_set_t avail_cpus;
+    if(sched_getaffinity(0, sizeof(avail_cpus), &avail_cpus) != 0)
+      return false;
+
+    char fname[80];
+    sprintf(fname, "/sys/devices/system/node/node%d/cpulist", node);
+    FILE *f = fopen(fname, "r");
+    if(!f) {
+      fprintf(stderr, "can't read '%s': %s\n", fname, strerror(errno));
+      return false;
+    }
+    char line[4096];
+    CPU_ZERO(&cpus);
+    if(fgets(line, sizeof(line), f)) {
+      // format is a comma-separated list of cpus and ranges (e.g. "0-7,16-23")
+      char *p = line;
+      while(isdigit(*p)) {
+	int lo = strtol(p, &p, 10);
+	int hi = lo;
+	if(*p == '-')
+	  hi = strtol(p + 1, &p, 10);
+	for(int i = lo; (i <= hi) && (i < CPU_SETSIZE); i++)
+	  if(CPU_ISSET(i, &avail_cpus))
+	    CPU_SET(i, &cpus);
+	if(*p == ',') p++;
+      }
+    }
+    fclose(f);
+    return(CPU_COUNT(&cpus) > 0);
+  }
+#endif
+
+  // touches every page of the given range in parallel from 'num_threads'
+  //  threads bound to the cpus of 'node' (or unbound if node < 0)
+  bool numasysif_prefault_mem(int node, void *base, size_t bytes,
+			      int num_threads)
+  {
+#ifdef __linux__
+    if(num_threads < 1)
+      num_threads = 1;
+    size_t stride = sysconf(_SC_PAGESIZE);
+    std::vector<PrefaultArgs> args(num_threads);
+    bool bind = (node >= 0) && get_node_cpus(node, args[0].cpus);
+    // split on page boundaries
+    size_t pages = (bytes + stride - 1) / stride;
+    for(int i = 0; i < num_threads; i++) {
+      size_t first = (pages * i) / num_threads;
+      size_t last = (pages * (i + 1)) / num_threads;
+      args[i].start = (char *)base + (first * stride);
+      args[i].bytes = std::min(bytes, last * stride) - (first * stride);
+      args[i].stride = stride;
+      args[i].bind = bind;
+      if(i > 0)
+	args[i].cpus = args[0].cpus;
+    }
+
+    // the calling thread does the first piece itself
+    std::vector<pthread_t> threads(num_threads);
+    std::vector<bool> started(num_threads, false);
+    bool ok = true;
+    for(int i = 1; i < num_threads; i++)
+      started[i] = (pthread_create(&threads[i], 0,
+				   prefault_thread, &args[i]) == 0);
+    {
+      // restore our own affinity afterwards
+      cpu_set_t old_cpus;
+      bool restore = bind && (sched_getaffinity(0, sizeof(old_cpus), &old_cpus) == 0);
+      prefault_thread(&args[0]);
+      // pieces we couldn't get a thread for are done here as well
+      for(int i = 1; i < num_threads; i++)
+	if(!started[i])
+	  prefault_thread(&args[i]);
+      if(restore)
+	sched_setaffinity(0, sizeof(old_cpus), &old_cpus);
+    }
+    for(int i = 1; i < num_threads; i++)
+      if(started[i] && (pthread_join(threads[i], 0) != 0))
+	ok = false;
+    return ok;
+#else
+    return false;
+#endif
+  }
+
   // bind already-allocated memory to a given node - pin if requested
   // may fail if the memory has already been touched
   bool numasysif_bind_mem(int node, void *base, size_t bytes, bool pin)
@@ -53,11 +53,27 @@ namespace Realm {
   //  per hop
   int numasysif_get_distance(int node1, int node2);
 
-  // allocate memory on a given NUMA node - pin if requested
-  void *numasysif_alloc_mem(int node, size_t bytes, bool pin);
-
-  // free memory allocated on a given NUMA node
-  bool numasysif_free_mem(int node, void *base, size_t bytes);
+  // page backing requests for numasysif_alloc_mem - 0 means normal pages, this
+  //  asks for transparent huge pages, and any other value is the size of the
+  //  explicit (hugetlbfs) pages to use (e.g. 2MB or 1GB)
+  static const size_t NUMASYSIF_TRANSPARENT_HUGEPAGES = 1;
+
+  // allocate memory on a given NUMA node (or anywhere if node < 0) - pin if
+  //  requested, and pre-fault the pages from 'prefault_threads' threads
+  //  running in that node if non-zero
+  void *numasysif_alloc_mem(int node, size_t bytes, bool pin,
+			    size_t hugepage_size = 0,
+			    int prefault_threads = 0);
+
+  // free memory allocated on a given NUMA node - 'hugepage_size' must match
+  //  what was used for the allocation
+  bool numasysif_free_mem(int node, void *base, size_t bytes,
+			  size_t hugepage_size = 0);
+
+  // touches every page of the given range in parallel from 'num_threads'
+  //  threads bound to the cpus of 'node' (or unbound if node < 0)
+  bool numasysif_prefault_mem(int node, void *base, size_t bytes,
+			      int num_threads);
 
   // bind already-allocated memory to a given node - pin if requested
   // may fail if the memory has already been touched
@@ -19,6 +19,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
 namespace Realm {
   extern Logger log_omp;
@@ -51,6 +52,158 @@ namespace Realm {
       else
 	return 0;
     }
+
+    int omp_get_level(void)
+    {
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      int level = 0;
+      if(wi)
+	for(const ThreadPool::WorkItem *item = wi->work_item;
+	    item != 0;
+	    item = item->parent_work_item)
+	  level++;
+      return level;
+    }
+  };
+
+  // a chunk [first, last] of some loop's iterations, along with what's
+  //  needed to map them back to the caller's iteration space
+  struct LoopChunk {
+    int64_t first, last;
+    int64_t count, lower, incr;
+  };
+
+  // loops encountered outside of any parallel region (or not on an OpenMP
+  //  processor at all) are run entirely by the calling thread
+  namespace ThreadLocal {
+    __thread bool serial_loop_pending = false;
+    __thread LoopChunk serial_loop;
+  };
+
+  // joins a dynamically-scheduled loop of 'count' iterations
+  static void start_shared_loop(int kind, int64_t count, int64_t chunk,
+				int64_t lower, int64_t incr)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(!wi || !wi->work_item) {
+      ThreadLocal::serial_loop_pending = (count > 0);
+      ThreadLocal::serial_loop.first = 0;
+      ThreadLocal::serial_loop.last = count - 1;
+      ThreadLocal::serial_loop.count = count;
+      ThreadLocal::serial_loop.lower = lower;
+      ThreadLocal::serial_loop.incr = incr;
+      return;
+    }
+    wi->start_loop(kind, count, chunk, lower, incr);
+  }
+
+  // claims the next chunk of the caller's current loop
+  static bool next_shared_chunk(LoopChunk& chunk)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(!wi || !wi->work_item) {
+      if(!ThreadLocal::serial_loop_pending)
+	return false;
+      ThreadLocal::serial_loop_pending = false;
+      chunk = ThreadLocal::serial_loop;
+      return true;
+    }
+    if(!wi->next_chunk(chunk.first, chunk.last))
+      return false;
+    chunk.count = wi->cur_loop->count;
+    chunk.lower = wi->cur_loop->lower;
+    chunk.incr = wi->cur_loop->incr;
+    return true;
+  }
+
+  // starts a team of up to 'nthreads' threads (including the caller) from
+  //  the caller's pool - the other members run 'fnptr(data)' and the caller
+  //  is expected to do the same before calling end_parallel_region
+  static void begin_parallel_region(ThreadPool::WorkerInfo *wi,
+				    void (*fnptr)(void *data), void *data,
+				    int nthreads)
+  {
+    std::set<int> worker_ids;
+    wi->pool->claim_workers(nthreads - 1, worker_ids);
+    int act_threads = 1 + worker_ids.size();
+
+    ThreadPool::WorkItem *work = new ThreadPool::WorkItem;
+    work->remaining_workers = act_threads;
+    wi->push_work_item(work);
+
+    wi->thread_id = 0;
+    wi->num_threads = act_threads;
+    int idx = 1;
+    for(std::set<int>::const_iterator it = worker_ids.begin();
+	it != worker_ids.end();
+	++it) {
+      wi->pool->start_worker(*it, idx, act_threads, fnptr, data, work);
+      idx++;
+    }
+  }
+
+  static void end_parallel_region(ThreadPool::WorkerInfo *wi)
+  {
+    // the master helps run the team's tasks before the region can end
+    wi->finish_tasks();
+    ThreadPool::WorkItem *work = wi->pop_work_item();
+    assert(work != 0);
+    // make sure all workers have finished
+    if(__sync_sub_and_fetch(&(work->remaining_workers), 1) > 0) {
+      log_omp.info() << "waiting for workers to complete";
+      while(__sync_sub_and_fetch(&(work->remaining_workers), 0) > 0)
+	sched_yield();
+    }
+    delete work;
+  }
+
+  struct BulkExecuteArgs {
+    void (*fnptr)(void *data, size_t first, size_t last);
+    void *data;
+    size_t count;
+  };
+
+  // each member of the team takes one contiguous block of the indices
+  static void bulk_execute_entry(void *data)
+  {
+    const BulkExecuteArgs *args = static_cast<const BulkExecuteArgs *>(data);
+    size_t id = omp_get_thread_num();
+    size_t num_threads = omp_get_num_threads();
+    size_t base = args->count / num_threads;
+    size_t extra = args->count % num_threads;
+    size_t first = (id * base) + ((id < extra) ? id : extra);
+    size_t last = first + base + ((id < extra) ? 1 : 0);
+    if(first < last)
+      (args->fnptr)(args->data, first, last);
+  }
+
+  // application-visible Realm extension - always generated
+  extern "C" {
+    // runs 'fnptr(data, first, last)' over blocks [first, last) that cover
+    //  [0, count), using a team from the calling thread's pool so that bulk
+    //  work inside a task uses the cores of its OpenMP processor - outside
+    //  of an OpenMP processor the caller just runs it all
+    void realm_omp_bulk_execute(void (*fnptr)(void *data, size_t first, size_t last),
+				void *data, size_t count)
+    {
+      if(count == 0)
+	return;
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      if(!wi || (count == 1)) {
+	(*fnptr)(data, 0, count);
+	return;
+      }
+      BulkExecuteArgs args;
+      args.fnptr = fnptr;
+      args.data = data;
+      args.count = count;
+      int nthreads = omp_get_max_threads();
+      if((size_t)nthreads > count)
+	nthreads = count;
+      begin_parallel_region(wi, bulk_execute_entry, &args, nthreads);
+      bulk_execute_entry(&args);
+      end_parallel_region(wi);
+    }
   };
 
 #ifdef REALM_OPENMP_GOMP_SUPPORT
@@ -64,24 +217,8 @@ namespace Realm {
 	return;
       }
 
-      std::set<int> worker_ids;
-      wi->pool->claim_workers(nthreads - 1, worker_ids);
-      int act_threads = 1 + worker_ids.size();
-
-      ThreadPool::WorkItem *work = new ThreadPool::WorkItem;
-      work->remaining_workers = act_threads;
-      wi->push_work_item(work);
-
-      wi->thread_id = 0;
-      wi->num_threads = act_threads;
-      int idx = 1;
-      for(std::set<int>::const_iterator it = worker_ids.begin();
-	  it != worker_ids.end();
-	  ++it) {
-	wi->pool->start_worker(*it, idx, act_threads, fnptr, data, work);
-	idx++;
-      }
       // in GOMP, the master thread runs fnptr itself, so we just return
+      begin_parallel_region(wi, fnptr, data, nthreads);
     }
 
     void GOMP_parallel_end(void)
@@ -93,15 +230,7 @@ namespace Realm {
       if(!wi)
 	return;
 
-      ThreadPool::WorkItem *work = wi->pop_work_item();
-      assert(work != 0);
-      // make sure all workers have finished
-      if(__sync_sub_and_fetch(&(work->remaining_workers), 1) > 0) {
-	log_omp.info() << "waiting for workers to complete";
-	while(__sync_sub_and_fetch(&(work->remaining_workers), 0) > 0)
-	  sched_yield();
-      }
-      delete work;
+      end_parallel_region(wi);
     }
 
     void GOMP_parallel(void (*fnptr)(void *data), void *data, unsigned nthreads, unsigned int flags)
@@ -111,6 +240,209 @@ namespace Realm {
       GOMP_parallel_end();
     }
   };
+
+  // GOMP loops are [start, end) with a signed increment
+  static bool gomp_loop_next(long *istart, long *iend)
+  {
+    LoopChunk chunk;
+    if(!next_shared_chunk(chunk))
+      return false;
+    *istart = chunk.lower + chunk.first * chunk.incr;
+    *iend = chunk.lower + (chunk.last + 1) * chunk.incr;
+    return true;
+  }
+
+  static void gomp_loop_init(int kind, long start, long end, long incr, long chunk)
+  {
+    int64_t count = 0;
+    if((incr > 0) && (start < end))
+      count = (end - start + incr - 1) / incr;
+    if((incr < 0) && (start > end))
+      count = (start - end - incr - 1) / -incr;
+    start_shared_loop(kind, count, chunk, start, incr);
+  }
+
+  static bool gomp_loop_start(int kind, long start, long end, long incr, long chunk,
+			      long *istart, long *iend)
+  {
+    gomp_loop_init(kind, start, end, incr, chunk);
+    return gomp_loop_next(istart, iend);
+  }
+
+  // combined parallel/loop constructs have the master set up the schedule
+  //  before the team runs - the workers join it on their first 'next' call
+  static void gomp_parallel_loop(int kind,
+				 void (*fnptr)(void *data), void *data, unsigned nthreads,
+				 long start, long end, long incr, long chunk)
+  {
+    GOMP_parallel_start(fnptr, data, nthreads);
+    gomp_loop_init(kind, start, end, incr, chunk);
+    fnptr(data);
+    GOMP_parallel_end();
+  }
+
+  extern "C" {
+    bool GOMP_loop_dynamic_start(long start, long end, long incr, long chunk,
+				 long *istart, long *iend)
+    {
+      return gomp_loop_start(ThreadPool::LoopSchedule::LOOP_DYNAMIC,
+			     start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_guided_start(long start, long end, long incr, long chunk,
+				long *istart, long *iend)
+    {
+      return gomp_loop_start(ThreadPool::LoopSchedule::LOOP_GUIDED,
+			     start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_nonmonotonic_dynamic_start(long start, long end, long incr, long chunk,
+					      long *istart, long *iend)
+    {
+      return GOMP_loop_dynamic_start(start, end, incr, chunk, istart, iend);
+    }
+
+    bool GOMP_loop_nonmonotonic_guided_start(long start, long end, long incr, long chunk,
+					     long *istart, long *iend)
+    {
+      return GOMP_loop_guided_start(start, end, incr, chunk, istart, iend);
+    }
+
+    // we don't parse OMP_SCHEDULE, so runtime-scheduled loops are dynamic
+    bool GOMP_loop_runtime_start(long start, long end, long incr,
+				 long *istart, long *iend)
+    {
+      return GOMP_loop_dynamic_start(start, end, incr, 1, istart, iend);
+    }
+
+    bool GOMP_loop_dynamic_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_guided_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_nonmonotonic_dynamic_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_nonmonotonic_guided_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    bool GOMP_loop_runtime_next(long *istart, long *iend)
+    {
+      return gomp_loop_next(istart, iend);
+    }
+
+    void GOMP_parallel_loop_dynamic(void (*fnptr)(void *data), void *data,
+				    unsigned nthreads, long start, long end,
+				    long incr, long chunk, unsigned flags)
+    {
+      gomp_parallel_loop(ThreadPool::LoopSchedule::LOOP_DYNAMIC,
+			 fnptr, data, nthreads, start, end, incr, chunk);
+    }
+
+    void GOMP_parallel_loop_guided(void (*fnptr)(void *data), void *data,
+				   unsigned nthreads, long start, long end,
+				   long incr, long chunk, unsigned flags)
+    {
+      gomp_parallel_loop(ThreadPool::LoopSchedule::LOOP_GUIDED,
+			 fnptr, data, nthreads, start, end, incr, chunk);
+    }
+
+    void GOMP_parallel_loop_nonmonotonic_dynamic(void (*fnptr)(void *data), void *data,
+						 unsigned nthreads, long start, long end,
+						 long incr, long chunk, unsigned flags)
+    {
+      GOMP_parallel_loop_dynamic(fnptr, data, nthreads, start, end, incr, chunk, flags);
+    }
+
+    void GOMP_parallel_loop_nonmonotonic_guided(void (*fnptr)(void *data), void *data,
+						unsigned nthreads, long start, long end,
+						long incr, long chunk, unsigned flags)
+    {
+      GOMP_parallel_loop_guided(fnptr, data, nthreads, start, end, incr, chunk, flags);
+    }
+
+    void GOMP_parallel_loop_runtime(void (*fnptr)(void *data), void *data,
+				    unsigned nthreads, long start, long end,
+				    long incr, unsigned flags)
+    {
+      GOMP_parallel_loop_dynamic(fnptr, data, nthreads, start, end, incr, 1, flags);
+    }
+
+    void GOMP_loop_end(void)
+    {
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      if(wi && wi->work_item)
+	wi->end_loop(true);
+    }
+
+    void GOMP_loop_end_nowait(void)
+    {
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      if(wi && wi->work_item)
+	wi->end_loop(false);
+    }
+
+    // newer compilers pass dependences and a priority as well - we ignore
+    //  them, along with the flags
+    void GOMP_task(void (*fnptr)(void *data), void *data,
+		   void (*cpyfn)(void *dst, void *src),
+		   long arg_size, long arg_align, bool if_clause,
+		   unsigned flags)
+    {
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      if(!wi) {
+	log_omp.warning() << "OpenMP task on non-OpenMP Realm processor!";
+	fnptr(data);
+	return;
+      }
+
+      if(!if_clause) {
+	// undeferred - the arguments can stay where the caller has them
+	ThreadPool::Task *task = ThreadPool::alloc_task(0);
+	task->fnptr = fnptr;
+	task->data = data;
+	wi->begin_undeferred_task(task);
+	fnptr(data);
+	wi->end_undeferred_task(task);
+	return;
+      }
+
+      // the arguments have to be captured for whoever runs the task later
+      ThreadPool::Task *task = ThreadPool::alloc_task(arg_size + arg_align - 1);
+      char *args = (char *)((((uintptr_t)(task->data)) + arg_align - 1) &
+			    ~(uintptr_t)(arg_align - 1));
+      if(cpyfn)
+	cpyfn(args, data);
+      else
+	memcpy(args, data, arg_size);
+      task->fnptr = fnptr;
+      task->data = args;
+      wi->spawn_task(task);
+    }
+
+    void GOMP_taskwait(void)
+    {
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      if(wi)
+	wi->wait_for_children();
+    }
+
+    void GOMP_taskyield(void)
+    {
+      Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+      if(wi)
+	wi->run_queued_task();
+    }
+  };
 #endif
 
 #ifdef REALM_OPENMP_KMP_SUPPORT
@@ -123,6 +455,16 @@ namespace Realm {
   typedef void (*kmpc_reduce)(void *lhs_data, void *rhs_data);
   typedef int32_t kmp_critical_name;
 
+  // only the leading fields of the compiler's task descriptor are ours to
+  //  look at - the rest (and the shareds) are opaque
+  struct kmp_task_t;
+  typedef kmp_int32 (*kmp_routine_entry_t)(kmp_int32 global_tid, void *task);
+  struct kmp_task_t {
+    void *shareds;
+    kmp_routine_entry_t routine;
+    kmp_int32 part_id;
+  };
+
   extern "C" {
     void __kmpc_begin(ident_t *loc, kmp_int32 flags);
     void __kmpc_end(ident_t *loc);
@@ -156,6 +498,42 @@ namespace Realm {
 				   kmp_uint64 *pstride,
 				   kmp_uint64 incr, kmp_uint64 chunk);
     void __kmpc_for_static_fini(ident_t *loc, kmp_int32 global_tid);
+    void __kmpc_dispatch_init_4(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 schedtype,
+				kmp_int32 lower, kmp_int32 upper,
+				kmp_int32 incr, kmp_int32 chunk);
+    void __kmpc_dispatch_init_4u(ident_t *loc, kmp_int32 global_tid,
+				 kmp_int32 schedtype,
+				 kmp_uint32 lower, kmp_uint32 upper,
+				 kmp_int32 incr, kmp_int32 chunk);
+    void __kmpc_dispatch_init_8(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 schedtype,
+				kmp_int64 lower, kmp_int64 upper,
+				kmp_int64 incr, kmp_int64 chunk);
+    void __kmpc_dispatch_init_8u(ident_t *loc, kmp_int32 global_tid,
+				 kmp_int32 schedtype,
+				 kmp_uint64 lower, kmp_uint64 upper,
+				 kmp_int64 incr, kmp_int64 chunk);
+    int __kmpc_dispatch_next_4(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 *plastiter,
+			       kmp_int32 *plower, kmp_int32 *pupper,
+			       kmp_int32 *pstride);
+    int __kmpc_dispatch_next_4u(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 *plastiter,
+				kmp_uint32 *plower, kmp_uint32 *pupper,
+				kmp_int32 *pstride);
+    int __kmpc_dispatch_next_8(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 *plastiter,
+			       kmp_int64 *plower, kmp_int64 *pupper,
+			       kmp_int64 *pstride);
+    int __kmpc_dispatch_next_8u(ident_t *loc, kmp_int32 global_tid,
+				kmp_int32 *plastiter,
+				kmp_uint64 *plower, kmp_uint64 *pupper,
+				kmp_int64 *pstride);
+    void __kmpc_dispatch_fini_4(ident_t *loc, kmp_int32 global_tid);
+    void __kmpc_dispatch_fini_4u(ident_t *loc, kmp_int32 global_tid);
+    void __kmpc_dispatch_fini_8(ident_t *loc, kmp_int32 global_tid);
+    void __kmpc_dispatch_fini_8u(ident_t *loc, kmp_int32 global_tid);
     kmp_int32 __kmpc_reduce_nowait(ident_t *loc, kmp_int32 global_tid,
 				   kmp_int32 nvars, size_t reduce_size,
 				   void *reduce_data, kmpc_reduce reduce_func,
@@ -165,6 +543,21 @@ namespace Realm {
 
     void __kmpc_serialized_parallel(ident_t *loc, kmp_int32 global_tid);
     void __kmpc_end_serialized_parallel(ident_t *loc, kmp_int32 global_tid);
+
+    kmp_task_t *__kmpc_omp_task_alloc(ident_t *loc, kmp_int32 global_tid,
+				      kmp_int32 flags,
+				      size_t sizeof_kmp_task_t,
+				      size_t sizeof_shareds,
+				      kmp_routine_entry_t task_entry);
+    kmp_int32 __kmpc_omp_task(ident_t *loc, kmp_int32 global_tid,
+			      kmp_task_t *new_task);
+    void __kmpc_omp_task_begin_if0(ident_t *loc, kmp_int32 global_tid,
+				   kmp_task_t *new_task);
+    void __kmpc_omp_task_complete_if0(ident_t *loc, kmp_int32 global_tid,
+				      kmp_task_t *new_task);
+    kmp_int32 __kmpc_omp_taskwait(ident_t *loc, kmp_int32 global_tid);
+    kmp_int32 __kmpc_omp_taskyield(ident_t *loc, kmp_int32 global_tid,
+				   int end_part);
   };
 
   struct kmp_thunk {
@@ -387,6 +780,7 @@ namespace Realm {
     (*invoker)(&thunk);
 
     // and then we immediately clean things up (c.f. GOMP_parallel_end)
+    wi->finish_tasks();
     ThreadPool::WorkItem *work2 = wi->pop_work_item();
     assert(work == work2);
     // make sure all workers have finished
@@ -493,6 +887,173 @@ namespace Realm {
     //printf("static_fini(%p, %d)\n", loc, global_tid);
   }
 
+  // templated code for __kmpc_dispatch_init_{4,4u,8,8u} - T is the loop
+  //  variable's type and ST the (always signed) stride's type
+  template <typename T, typename ST>
+  static inline void kmpc_dispatch_init(ident_t *loc, kmp_int32 global_tid,
+					kmp_int32 schedtype,
+					T lower, T upper, ST incr, ST chunk)
+  {
+    int64_t count = 0;
+    if((incr > 0) && (lower <= upper))
+      count = 1 + (upper - lower) / incr;
+    if((incr < 0) && (lower >= upper))
+      count = 1 + (lower - upper) / -incr;
+
+    //printf("dispatch_init(%p, %d, %d)\n", loc, global_tid, schedtype);
+    // strip the monotonic/nonmonotonic modifiers and fold ordered variants
+    //  onto their unordered equivalents (we don't implement __kmpc_ordered)
+    int sched = schedtype & ~((1 << 29) | (1 << 30));
+    if(sched > 64)
+      sched -= 32;
+
+    int kind;
+    int64_t chunk_size = chunk;
+    switch(sched) {
+    case 33 /* kmp_sch_static_chunked */:
+    case 35 /* kmp_sch_dynamic_chunked */:
+    case 37 /* kmp_sch_runtime */:
+    case 38 /* kmp_sch_auto */:
+    case 39 /* kmp_sch_trapezoidal */:
+    case 44 /* kmp_sch_static_steal */:
+      {
+	kind = ThreadPool::LoopSchedule::LOOP_DYNAMIC;
+	break;
+      }
+
+    case 34 /* kmp_sch_static */:
+    case 40 /* kmp_sch_static_greedy */:
+    case 41 /* kmp_sch_static_balanced */:
+      {
+	// one chunk per thread, although not necessarily in thread order
+	Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+	int nthreads = (wi ? wi->num_threads : 1);
+	kind = ThreadPool::LoopSchedule::LOOP_DYNAMIC;
+	chunk_size = (count + nthreads - 1) / nthreads;
+	break;
+      }
+
+    case 36 /* kmp_sch_guided_chunked */:
+    case 42 /* kmp_sch_guided_iterative_chunked */:
+    case 43 /* kmp_sch_guided_analytical_chunked */:
+      {
+	kind = ThreadPool::LoopSchedule::LOOP_GUIDED;
+	break;
+      }
+
+    default: assert(false);
+    }
+
+    start_shared_loop(kind, count, chunk_size, (int64_t)lower, (int64_t)incr);
+  }
+
+  // templated code for __kmpc_dispatch_next_{4,4u,8,8u}
+  template <typename T, typename ST>
+  static inline int kmpc_dispatch_next(ident_t *loc, kmp_int32 global_tid,
+				       kmp_int32 *plastiter,
+				       T *plower, T *pupper, ST *pstride)
+  {
+    LoopChunk chunk;
+    if(!next_shared_chunk(chunk))
+      return 0;
+
+    // unsigned wraparound does the right thing for negative strides
+    T lower = (T)(chunk.lower);
+    T incr = (T)(chunk.incr);
+    *plower = lower + (T)(chunk.first) * incr;
+    *pupper = lower + (T)(chunk.last) * incr;
+    if(pstride)
+      *pstride = (ST)(chunk.incr);
+    if(plastiter)
+      *plastiter = (chunk.last == (chunk.count - 1));
+    return 1;
+  }
+
+  void __kmpc_dispatch_init_4(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 schedtype,
+			      kmp_int32 lower, kmp_int32 upper,
+			      kmp_int32 incr, kmp_int32 chunk)
+  {
+    kmpc_dispatch_init<kmp_int32, kmp_int32>(loc, global_tid, schedtype,
+					     lower, upper, incr, chunk);
+  }
+
+  void __kmpc_dispatch_init_4u(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 schedtype,
+			       kmp_uint32 lower, kmp_uint32 upper,
+			       kmp_int32 incr, kmp_int32 chunk)
+  {
+    kmpc_dispatch_init<kmp_uint32, kmp_int32>(loc, global_tid, schedtype,
+					      lower, upper, incr, chunk);
+  }
+
+  void __kmpc_dispatch_init_8(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 schedtype,
+			      kmp_int64 lower, kmp_int64 upper,
+			      kmp_int64 incr, kmp_int64 chunk)
+  {
+    kmpc_dispatch_init<kmp_int64, kmp_int64>(loc, global_tid, schedtype,
+					     lower, upper, incr, chunk);
+  }
+
+  void __kmpc_dispatch_init_8u(ident_t *loc, kmp_int32 global_tid,
+			       kmp_int32 schedtype,
+			       kmp_uint64 lower, kmp_uint64 upper,
+			       kmp_int64 incr, kmp_int64 chunk)
+  {
+    kmpc_dispatch_init<kmp_uint64, kmp_int64>(loc, global_tid, schedtype,
+					      lower, upper, incr, chunk);
+  }
+
+  int __kmpc_dispatch_next_4(ident_t *loc, kmp_int32 global_tid,
+			     kmp_int32 *plastiter,
+			     kmp_int32 *plower, kmp_int32 *pupper,
+			     kmp_int32 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_int32, kmp_int32>(loc, global_tid, plastiter,
+						    plower, pupper, pstride);
+  }
+
+  int __kmpc_dispatch_next_4u(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 *plastiter,
+			      kmp_uint32 *plower, kmp_uint32 *pupper,
+			      kmp_int32 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_uint32, kmp_int32>(loc, global_tid, plastiter,
+						     plower, pupper, pstride);
+  }
+
+  int __kmpc_dispatch_next_8(ident_t *loc, kmp_int32 global_tid,
+			     kmp_int32 *plastiter,
+			     kmp_int64 *plower, kmp_int64 *pupper,
+			     kmp_int64 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_int64, kmp_int64>(loc, global_tid, plastiter,
+						    plower, pupper, pstride);
+  }
+
+  int __kmpc_dispatch_next_8u(ident_t *loc, kmp_int32 global_tid,
+			      kmp_int32 *plastiter,
+			      kmp_uint64 *plower, kmp_uint64 *pupper,
+			      kmp_int64 *pstride)
+  {
+    return kmpc_dispatch_next<kmp_uint64, kmp_int64>(loc, global_tid, plastiter,
+						     plower, pupper, pstride);
+  }
+
+  // only used for ordered loops, which are run unordered
+  void __kmpc_dispatch_fini_4(ident_t *loc, kmp_int32 global_tid)
+  {}
+
+  void __kmpc_dispatch_fini_4u(ident_t *loc, kmp_int32 global_tid)
+  {}
+
+  void __kmpc_dispatch_fini_8(ident_t *loc, kmp_int32 global_tid)
+  {}
+
+  void __kmpc_dispatch_fini_8u(ident_t *loc, kmp_int32 global_tid)
+  {}
+
   kmp_int32 __kmpc_reduce_nowait(ident_t *loc, kmp_int32 global_tid,
 				 kmp_int32 nvars, size_t reduce_size,
 				 void *reduce_data, kmpc_reduce reduce_func,
@@ -535,11 +1096,93 @@ namespace Realm {
       return;
 
     // pop the top work item and make sure we're the only worker
+    wi->finish_tasks();
     ThreadPool::WorkItem *work = wi->pop_work_item();
     assert(work != 0);
     assert(work->remaining_workers == 1);
     delete work;
   }
+
+  // a kmp task descriptor (and its shareds) lives in the argument data of
+  //  one of our tasks
+  static void kmp_task_invoke(void *data)
+  {
+    kmp_task_t *task = (kmp_task_t *)data;
+    kmp_int32 global_tid = __kmpc_global_thread_num(0);
+    (task->routine)(global_tid, task);
+  }
+
+  kmp_task_t *__kmpc_omp_task_alloc(ident_t *loc, kmp_int32 global_tid,
+				    kmp_int32 flags,
+				    size_t sizeof_kmp_task_t,
+				    size_t sizeof_shareds,
+				    kmp_routine_entry_t task_entry)
+  {
+    // shareds are pointer-aligned after the descriptor
+    size_t shareds_offset = ((sizeof_kmp_task_t + sizeof(void *) - 1) &
+			     ~(sizeof(void *) - 1));
+    ThreadPool::Task *task = ThreadPool::alloc_task(shareds_offset + sizeof_shareds);
+    task->fnptr = &kmp_task_invoke;
+    kmp_task_t *kmp_task = (kmp_task_t *)(task->data);
+    kmp_task->shareds = (sizeof_shareds ?
+			   ((char *)(task->data) + shareds_offset) :
+			   0);
+    kmp_task->routine = task_entry;
+    kmp_task->part_id = 0;
+    return kmp_task;
+  }
+
+  kmp_int32 __kmpc_omp_task(ident_t *loc, kmp_int32 global_tid,
+			    kmp_task_t *new_task)
+  {
+    ThreadPool::Task *task = ThreadPool::task_from_data(new_task);
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(!wi) {
+      log_omp.warning() << "OpenMP task on non-OpenMP Realm processor!";
+      (task->fnptr)(task->data);
+      ThreadPool::free_task(task);
+      return 0;
+    }
+
+    wi->spawn_task(task);
+    return 0;
+  }
+
+  void __kmpc_omp_task_begin_if0(ident_t *loc, kmp_int32 global_tid,
+				 kmp_task_t *new_task)
+  {
+    // the caller runs the task's routine itself
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi)
+      wi->begin_undeferred_task(ThreadPool::task_from_data(new_task));
+  }
+
+  void __kmpc_omp_task_complete_if0(ident_t *loc, kmp_int32 global_tid,
+				    kmp_task_t *new_task)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi)
+      wi->end_undeferred_task(ThreadPool::task_from_data(new_task));
+    else
+      ThreadPool::free_task(ThreadPool::task_from_data(new_task));
+  }
+
+  kmp_int32 __kmpc_omp_taskwait(ident_t *loc, kmp_int32 global_tid)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi)
+      wi->wait_for_children();
+    return 0;
+  }
+
+  kmp_int32 __kmpc_omp_taskyield(ident_t *loc, kmp_int32 global_tid,
+				 int end_part)
+  {
+    Realm::ThreadPool::WorkerInfo *wi = Realm::ThreadPool::get_worker_info();
+    if(wi)
+      wi->run_queued_task();
+    return 0;
+  }
 #endif
 
 }; // namespace Realm
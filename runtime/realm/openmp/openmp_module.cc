@@ -18,6 +18,7 @@
 #include "realm/openmp/openmp_threadpool.h"
 
 #include "realm/numa/numasysif.h"
+#include "realm/numa/numa_module.h"
 #include "realm/logging.h"
 #include "realm/cmdline.h"
 #include "realm/proc_impl.h"
@@ -243,6 +244,12 @@ namespace Realm {
     {
       Module::create_processors(runtime);
 
+      // if we're binding to numa domains, the numa module (if loaded) tells
+      //  us which of the system memories are local to which domain
+      const Numa::NumaModule *numa_module = 0;
+      if(cfg_use_numa)
+	numa_module = dynamic_cast<const Numa::NumaModule *>(runtime->get_module("numa"));
+
       for(std::set<int>::const_iterator it = active_numa_domains.begin();
 	  it != active_numa_domains.end();
 	  ++it) {
@@ -275,14 +282,34 @@ namespace Realm {
 	    pma.p = p;
 	    pma.m = (*it2)->me;
 
-	    // use the same made-up numbers as in
-	    //  runtime_impl.cc
-	    if(kind == Memory::SYSTEM_MEM) {
-	      pma.bandwidth = 100;  // "large"
-	      pma.latency = 5;      // "small"
+	    int mem_node = -1;
+	    if(numa_module && (cpu_node >= 0))
+	      for(std::map<int, MemoryImpl *>::const_iterator it3 = numa_module->memories.begin();
+		  it3 != numa_module->memories.end();
+		  ++it3)
+		if(it3->second == *it2) {
+		  mem_node = it3->first;
+		  break;
+		}
+
+	    int d = ((mem_node >= 0) ?
+		       numasysif_get_distance(cpu_node, mem_node) :
+		       -1);
+	    if(d >= 0) {
+	      // same scale as the numa module uses for its own processors, so
+	      //  the domain-local memory is the best choice for this processor
+	      pma.bandwidth = 150 - d;
+	      pma.latency = d / 10;     // Linux uses a cost of ~10/hop
 	    } else {
-	      pma.bandwidth = 80;   // "large"
-	      pma.latency = 10;     // "small"
+	      // use the same made-up numbers as in
+	      //  runtime_impl.cc
+	      if(kind == Memory::SYSTEM_MEM) {
+		pma.bandwidth = 100;  // "large"
+		pma.latency = 5;      // "small"
+	      } else {
+		pma.bandwidth = 80;   // "large"
+		pma.latency = 10;     // "small"
+	      }
 	    }
 	    
 	    runtime->add_proc_mem_affinity(pma);
@@ -18,6 +18,8 @@
 
 #include "realm/logging.h"
 
+#include <stdlib.h>
+
 namespace Realm {
 
   Logger log_pool("threadpool");
@@ -26,6 +28,26 @@ namespace Realm {
     __thread ThreadPool::WorkerInfo *threadpool_workerinfo = 0;
   };
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class ThreadPool::WorkItem
+
+  ThreadPool::WorkItem::WorkItem(void)
+    : outstanding_tasks(0)
+  {
+    master_task.fnptr = 0;
+    master_task.data = 0;
+    master_task.parent = 0;
+    master_task.work_item = this;
+    master_task.refs = 1;
+    for(int i = 0; i < MAX_LIVE_LOOPS; i++) {
+      loops[i].avail = i;
+      loops[i].active = -1;
+      loops[i].remaining_threads = 0;
+    }
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class ThreadPool::WorkerInfo
@@ -34,8 +56,14 @@ namespace Realm {
   {
     new_work->prev_thread_id = thread_id;
     new_work->prev_num_threads = num_threads;
+    new_work->prev_loop_count = loop_count;
+    new_work->prev_cur_loop = cur_loop;
+    new_work->prev_cur_task = cur_task;
     new_work->parent_work_item = work_item;
     work_item = new_work;
+    loop_count = 0;
+    cur_loop = 0;
+    cur_task = &(new_work->master_task);
   }
 
   ThreadPool::WorkItem *ThreadPool::WorkerInfo::pop_work_item(void)
@@ -43,15 +71,280 @@ namespace Realm {
     WorkItem *old_item = work_item;
     thread_id = old_item->prev_thread_id;
     num_threads = old_item->prev_num_threads;
+    loop_count = old_item->prev_loop_count;
+    cur_loop = old_item->prev_cur_loop;
+    cur_task = old_item->prev_cur_task;
     work_item = old_item->parent_work_item;
     return old_item;
   }
 
+  void ThreadPool::WorkerInfo::start_loop(int kind, int64_t count, int64_t chunk,
+					   int64_t lower, int64_t incr)
+  {
+    assert(work_item != 0);
+    assert(cur_loop == 0);
+    int loop_id = loop_count++;
+    LoopSchedule *ls = &(work_item->loops[loop_id % WorkItem::MAX_LIVE_LOOPS]);
+
+    // wait for the slot to be released by the loop that used it last, unless
+    //  another thread has already set it up for us
+    while(true) {
+      if(ls->active == loop_id)
+	break;
+      if((ls->avail == loop_id) &&
+	 __sync_bool_compare_and_swap(&(ls->avail), loop_id, -1)) {
+	ls->kind = kind;
+	ls->num_threads = num_threads;
+	ls->count = count;
+	ls->chunk = ((chunk > 0) ? chunk : 1);
+	ls->lower = lower;
+	ls->incr = incr;
+	ls->next = 0;
+	ls->remaining_threads = num_threads;
+	// publish the schedule before anybody can see it as active
+	__sync_synchronize();
+	ls->active = loop_id;
+	break;
+      }
+      sched_yield();
+    }
+    cur_loop = ls;
+  }
+
+  bool ThreadPool::WorkerInfo::next_chunk(int64_t& first, int64_t& last)
+  {
+    if(cur_loop == 0) {
+      // join a loop that was initialized on our behalf (e.g. by a combined
+      //  parallel/loop construct), waiting for it if needed
+      int loop_id = loop_count++;
+      LoopSchedule *ls = &(work_item->loops[loop_id % WorkItem::MAX_LIVE_LOOPS]);
+      while(ls->active != loop_id)
+	sched_yield();
+      __sync_synchronize();
+      cur_loop = ls;
+    }
+
+    LoopSchedule *ls = cur_loop;
+    if(ls->kind == LoopSchedule::LOOP_GUIDED) {
+      // take a shrinking fraction of what's left, no smaller than the chunk
+      while(true) {
+	int64_t cur = ls->next;
+	if(cur >= ls->count)
+	  break;
+	int64_t left = ls->count - cur;
+	int64_t size = left / (2 * ls->num_threads);
+	if(size < ls->chunk)
+	  size = ls->chunk;
+	if(size > left)
+	  size = left;
+	if(__sync_bool_compare_and_swap(&(ls->next), cur, cur + size)) {
+	  first = cur;
+	  last = cur + size - 1;
+	  return true;
+	}
+      }
+    } else {
+      int64_t cur = __sync_fetch_and_add(&(ls->next), ls->chunk);
+      if(cur < ls->count) {
+	first = cur;
+	last = (((ls->count - cur) > ls->chunk) ? (cur + ls->chunk) : ls->count) - 1;
+	return true;
+      }
+    }
+
+    // loop is exhausted - leave it
+    end_loop(false);
+    return false;
+  }
+
+  void ThreadPool::WorkerInfo::end_loop(bool wait)
+  {
+    // the id of the most recently joined loop, in case we've already left it
+    int loop_id = loop_count - 1;
+    LoopSchedule *ls = &(work_item->loops[loop_id % WorkItem::MAX_LIVE_LOOPS]);
+
+    if(cur_loop != 0) {
+      assert(cur_loop == ls);
+      cur_loop = 0;
+      // last thread out releases the slot for the loop that will reuse it
+      if(__sync_sub_and_fetch(&(ls->remaining_threads), 1) == 0) {
+	ls->active = -1;
+	__sync_synchronize();
+	ls->avail = loop_id + WorkItem::MAX_LIVE_LOOPS;
+      }
+    }
+
+    if(wait) {
+      // a slot never returns to a loop id it has released
+      while(ls->active == loop_id)
+	sched_yield();
+    }
+  }
+
+
+  void ThreadPool::WorkerInfo::spawn_task(Task *task)
+  {
+    if(!work_item) {
+      // not in a team - nobody else could run it anyway
+      begin_undeferred_task(task);
+      (task->fnptr)(task->data);
+      end_undeferred_task(task);
+      return;
+    }
+
+    task->parent = cur_task;
+    task->work_item = work_item;
+    task->refs = 1;
+    __sync_fetch_and_add(&(cur_task->refs), 1);
+    __sync_fetch_and_add(&(work_item->outstanding_tasks), 1);
+
+    while(__sync_lock_test_and_set(&task_lock, 1)) {}
+    task_queue.push_back(task);
+    __sync_lock_release(&task_lock);
+  }
+
+  void ThreadPool::WorkerInfo::begin_undeferred_task(Task *task)
+  {
+    task->parent = cur_task;
+    task->work_item = 0;
+    task->refs = 1;
+    if(cur_task)
+      __sync_fetch_and_add(&(cur_task->refs), 1);
+    cur_task = task;
+  }
+
+  void ThreadPool::WorkerInfo::end_undeferred_task(Task *task)
+  {
+    assert(cur_task == task);
+    cur_task = task->parent;
+    release_task(task);
+  }
+
+  ThreadPool::Task *ThreadPool::WorkerInfo::take_task(bool from_back,
+						      const WorkItem *team)
+  {
+    // peek without the lock so that idle scans don't fight over empty queues
+    if(task_queue.empty())
+      return 0;
+
+    // a thread that starts a nested team may still have tasks of the outer
+    //  team queued - those have to wait until it gets back to that team
+    Task *task = 0;
+    while(__sync_lock_test_and_set(&task_lock, 1)) {}
+    if(!task_queue.empty()) {
+      if(from_back) {
+	if(task_queue.back()->work_item == team) {
+	  task = task_queue.back();
+	  task_queue.pop_back();
+	}
+      } else {
+	if(task_queue.front()->work_item == team) {
+	  task = task_queue.front();
+	  task_queue.pop_front();
+	}
+      }
+    }
+    __sync_lock_release(&task_lock);
+    return task;
+  }
+
+  bool ThreadPool::WorkerInfo::run_queued_task(void)
+  {
+    if(!work_item)
+      return false;
+
+    Task *task = take_task(true /*from_back*/, work_item);
+
+    if(!task) {
+      // steal from a teammate, starting with our neighbor
+      int n = pool->worker_infos.size();
+      int me = this - &(pool->worker_infos[0]);
+      for(int i = 1; (i < n) && !task; i++)
+	task = pool->worker_infos[(me + i) % n].take_task(false /*!from_back*/,
+							  work_item);
+    }
+
+    if(!task)
+      return false;
+
+    execute_task(task);
+    return true;
+  }
+
+  void ThreadPool::WorkerInfo::execute_task(Task *task)
+  {
+    Task *prev_task = cur_task;
+    cur_task = task;
+    (task->fnptr)(task->data);
+    cur_task = prev_task;
+
+    WorkItem *task_work = task->work_item;
+    release_task(task);
+    if(task_work)
+      __sync_fetch_and_sub(&(task_work->outstanding_tasks), 1);
+  }
+
+  /*static*/ void ThreadPool::WorkerInfo::release_task(Task *task)
+  {
+    // implicit tasks are never freed this way - they hold on to their
+    //  own reference
+    Task *parent = task->parent;
+    if(__sync_sub_and_fetch(&(task->refs), 1) == 0)
+      free_task(task);
+    if(parent && (__sync_sub_and_fetch(&(parent->refs), 1) == 0))
+      free_task(parent);
+  }
+
+  void ThreadPool::WorkerInfo::wait_for_children(void)
+  {
+    if(!cur_task)
+      return;
+    while(cur_task->refs > 1)
+      if(!run_queued_task())
+	sched_yield();
+  }
+
+  void ThreadPool::WorkerInfo::finish_tasks(void)
+  {
+    if(!work_item)
+      return;
+    while(work_item->outstanding_tasks > 0)
+      if(!run_queued_task())
+	sched_yield();
+  }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
   // class ThreadPool
 
+  // task header is padded so that argument data is 16B-aligned
+  static const size_t TASK_HEADER_BYTES = ((sizeof(ThreadPool::Task) + 15) & ~size_t(15));
+
+  /*static*/ ThreadPool::Task *ThreadPool::alloc_task(size_t data_bytes)
+  {
+    void *mem = 0;
+    int ret = posix_memalign(&mem, 16, TASK_HEADER_BYTES + data_bytes);
+    assert(ret == 0);
+    Task *task = static_cast<Task *>(mem);
+    task->fnptr = 0;
+    task->data = static_cast<char *>(mem) + TASK_HEADER_BYTES;
+    task->parent = 0;
+    task->work_item = 0;
+    task->refs = 1;
+    return task;
+  }
+
+  /*static*/ void ThreadPool::free_task(Task *task)
+  {
+    free(task);
+  }
+
+  /*static*/ ThreadPool::Task *ThreadPool::task_from_data(void *data)
+  {
+    return reinterpret_cast<Task *>(static_cast<char *>(data) - TASK_HEADER_BYTES);
+  }
+
   ThreadPool::ThreadPool(int _num_workers)
     : num_workers(_num_workers)
   {
@@ -68,6 +361,10 @@ namespace Realm {
       wi.fnptr = 0;
       wi.data = 0;
       wi.work_item = 0;
+      wi.loop_count = 0;
+      wi.cur_loop = 0;
+      wi.cur_task = 0;
+      wi.task_lock = 0;
     }
 
     log_pool.info() << "pool " << (void *)this << " started - " << num_workers << " workers";
@@ -123,7 +420,18 @@ namespace Realm {
       case WorkerInfo::WORKER_ACTIVE:
 	{
 	  log_pool.info() << "worker " << wi->thread_id << "/" << wi->num_threads << " executing: " << (void *)(wi->fnptr) << "(" << wi->data << ")";
+	  Task implicit_task;
+	  implicit_task.fnptr = wi->fnptr;
+	  implicit_task.data = wi->data;
+	  implicit_task.parent = 0;
+	  implicit_task.work_item = wi->work_item;
+	  implicit_task.refs = 1;
+	  wi->cur_task = &implicit_task;
 	  (wi->fnptr)(wi->data);
+	  // the end of the region is a barrier that all of the team's tasks
+	  //  have to finish before
+	  wi->finish_tasks();
+	  wi->cur_task = 0;
 	  log_pool.info() << "worker " << wi->thread_id << "/" << wi->num_threads << " done";
 	  __sync_fetch_and_sub(&(wi->work_item->remaining_workers), 1);
 	  wi->status = WorkerInfo::WORKER_IDLE;
@@ -197,6 +505,8 @@ namespace Realm {
     wi->fnptr = fnptr;
     wi->data = data;
     wi->work_item = work_item;
+    wi->loop_count = 0;
+    wi->cur_loop = 0;
     __sync_bool_compare_and_swap(&(wi->status),
 				 WorkerInfo::WORKER_CLAIMED,
 				 WorkerInfo::WORKER_ACTIVE);
@@ -19,6 +19,9 @@
 
 #include "realm/threads.h"
 
+#include <stdint.h>
+#include <deque>
+
 namespace Realm {
 
   class ThreadPool {
@@ -32,11 +35,67 @@ namespace Realm {
     // entry point for workers - does not return until thread pool is shut down
     void worker_entry(void);
 
+    // shared state for a dynamically-scheduled (or guided) worksharing loop -
+    //  iterations are numbered 0..count-1 and each thread claims a chunk of
+    //  them with a single atomic update
+    struct LoopSchedule {
+      enum Kind {
+	LOOP_DYNAMIC,
+	LOOP_GUIDED,
+      };
+      int kind;
+      int num_threads;
+      int64_t count;
+      int64_t chunk;  // fixed size for dynamic, minimum size for guided
+      // the caller's first iteration and increment (unsigned loop bounds
+      //  are stored as their bit patterns)
+      int64_t lower;
+      int64_t incr;
+      volatile int64_t next;
+      // a slot can next be initialized for loop number 'avail' and is
+      //  serving loop number 'active' (or -1) until its last thread leaves
+      volatile int avail;
+      volatile int active;
+      volatile int remaining_threads;
+    };
+
+    struct WorkItem;
+
+    // an OpenMP task - its argument data (if any) lives in the same
+    //  allocation, right after the header
+    struct Task {
+      void (*fnptr)(void *data);
+      void *data;
+      Task *parent;
+      WorkItem *work_item;
+      // one for the task's own execution plus one per unfinished child -
+      //  the task is freed when this drops to zero
+      volatile int refs;
+    };
+
+    // allocates a task with room for 'data_bytes' of (16B-aligned)
+    //  argument data, which 'data' points at
+    static Task *alloc_task(size_t data_bytes);
+    static void free_task(Task *task);
+    static Task *task_from_data(void *data);
+
     struct WorkItem {
+      WorkItem(void);
+
       int prev_thread_id;
       int prev_num_threads;
+      int prev_loop_count;
+      LoopSchedule *prev_cur_loop;
+      Task *prev_cur_task;
       WorkItem *parent_work_item;
       int remaining_workers;
+      volatile int outstanding_tasks;
+      Task master_task;  // implicit task of the thread that started the team
+
+      // threads may run ahead into later 'nowait' loops, so a few loop
+      //  schedules can be live at once
+      static const int MAX_LIVE_LOOPS = 4;
+      LoopSchedule loops[MAX_LIVE_LOOPS];
     };
 
     struct WorkerInfo {
@@ -55,9 +114,61 @@ namespace Realm {
       void (*fnptr)(void *data);
       void *data;
       WorkItem *work_item;
+      int loop_count;  // loops joined so far in the current work item
+      LoopSchedule *cur_loop;  // loop this thread is claiming chunks from
 
       void push_work_item(WorkItem *new_work);
       WorkItem *pop_work_item(void);
+
+      // joins the next worksharing loop of the current work item - the first
+      //  thread of the team to arrive initializes the shared schedule
+      void start_loop(int kind, int64_t count, int64_t chunk,
+		      int64_t lower, int64_t incr);
+
+      // claims the next chunk [first, last] of the current loop, joining the
+      //  next loop (as initialized by another thread) if not in one - returns
+      //  false once the loop is exhausted, at which point the caller has left
+      //  the loop (otherwise 'cur_loop' describes the loop the chunk is from)
+      bool next_chunk(int64_t& first, int64_t& last);
+
+      // leaves the current loop (if still in one) and, if 'wait' is set,
+      //  waits for the rest of the team to leave it as well
+      void end_loop(bool wait);
+
+      // makes 'task' a child of the current task and queues it for any member
+      //  of the team to run - runs it immediately outside of a team
+      void spawn_task(Task *task);
+
+      // brackets the caller's own execution of 'task' (e.g. for an 'if(0)'
+      //  task), making it the current task in between
+      void begin_undeferred_task(Task *task);
+      void end_undeferred_task(Task *task);
+
+      // runs one queued task of the current team, preferring the newest one
+      //  on our own queue and otherwise stealing the oldest one from another
+      //  thread - returns false if nothing was found
+      bool run_queued_task(void);
+
+      // waits (running tasks meanwhile) for the current task's children
+      void wait_for_children(void);
+
+      // waits (running tasks meanwhile) for every task of the current team,
+      //  as happens at the end of a parallel region
+      void finish_tasks(void);
+
+      Task *cur_task;  // explicit or implicit task being run by this thread
+
+      // per-thread task deque - the owner works at the back, thieves take
+      //  from the front
+      volatile int task_lock;
+      std::deque<Task *> task_queue;
+
+    protected:
+      void execute_task(Task *task);
+      static void release_task(Task *task);
+      // takes the task at one end of this thread's queue if it belongs to
+      //  'team'
+      Task *take_task(bool from_back, const WorkItem *team);
     };
       
     // returns the WorkerInfo (if any) associated with the caller (which
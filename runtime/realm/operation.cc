@@ -18,11 +18,124 @@
 #include "realm/faults.h"
 #include "realm/runtime_impl.h"
 
+#include <new>
+#include <stdlib.h>
+
 namespace Realm {
 
   Logger log_optable("optable");
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class OperationPool
+  //
+
+  namespace {
+    // free objects are chained through their first word
+    struct FreeObject {
+      FreeObject *next;
+    };
+
+    struct ThreadCache {
+      FreeObject *heads[OperationPool::NUM_SIZE_CLASSES];
+      size_t counts[OperationPool::NUM_SIZE_CLASSES];
+    };
+
+    // zero-initialized, so no constructor needed for the thread-local copy
+    __thread ThreadCache op_pool_cache;
+
+    struct SharedFreeList {
+      GASNetHSL mutex;
+      FreeObject *head;
+      size_t count;
+    };
+
+    SharedFreeList op_pool_shared[OperationPool::NUM_SIZE_CLASSES];
+  };
+
+  /*static*/ void *OperationPool::allocate(size_t bytes)
+  {
+    size_t cls = (bytes + SIZE_CLASS_BYTES - 1) / SIZE_CLASS_BYTES;
+#ifndef REALM_DISABLE_OPERATION_POOL
+    if((cls > 0) && (cls <= NUM_SIZE_CLASSES)) {
+      ThreadCache& tc = op_pool_cache;
+      size_t idx = cls - 1;
+      FreeObject *obj = tc.heads[idx];
+      if(!obj) {
+	// refill from the shared list, or carve a new slab if that's empty too
+	SharedFreeList& sfl = op_pool_shared[idx];
+	{
+	  AutoHSLLock al(sfl.mutex);
+	  size_t taken = 0;
+	  while(sfl.head && (taken < TRANSFER_BATCH)) {
+	    FreeObject *next = sfl.head->next;
+	    sfl.head->next = obj;
+	    obj = sfl.head;
+	    sfl.head = next;
+	    taken++;
+	  }
+	  sfl.count -= taken;
+	  tc.counts[idx] = taken;
+	}
+	if(!obj) {
+	  size_t obj_bytes = cls * SIZE_CLASS_BYTES;
+	  size_t per_slab = SLAB_BYTES / obj_bytes;
+	  char *slab = static_cast<char *>(malloc(per_slab * obj_bytes));
+	  if(!slab) throw std::bad_alloc();
+	  // slabs are never returned to the heap - they just get recycled
+	  for(size_t i = 0; i < per_slab; i++) {
+	    FreeObject *f = reinterpret_cast<FreeObject *>(slab + (i * obj_bytes));
+	    f->next = obj;
+	    obj = f;
+	  }
+	  tc.counts[idx] = per_slab;
+	}
+      }
+      tc.heads[idx] = obj->next;
+      tc.counts[idx]--;
+      return obj;
+    }
+#endif
+    void *ptr = malloc(bytes);
+    if(!ptr) throw std::bad_alloc();
+    return ptr;
+  }
+
+  /*static*/ void OperationPool::deallocate(void *ptr, size_t bytes)
+  {
+    if(!ptr) return;
+    size_t cls = (bytes + SIZE_CLASS_BYTES - 1) / SIZE_CLASS_BYTES;
+#ifndef REALM_DISABLE_OPERATION_POOL
+    if((cls > 0) && (cls <= NUM_SIZE_CLASSES)) {
+      ThreadCache& tc = op_pool_cache;
+      size_t idx = cls - 1;
+      FreeObject *obj = static_cast<FreeObject *>(ptr);
+      obj->next = tc.heads[idx];
+      tc.heads[idx] = obj;
+      tc.counts[idx]++;
+      if(tc.counts[idx] > THREAD_CACHE_MAX) {
+	// give a batch back to the shared list so that threads that mostly
+	//  free (e.g. dma threads completing copies) don't hoard objects
+	FreeObject *first = tc.heads[idx];
+	FreeObject *last = first;
+	for(size_t i = 1; i < TRANSFER_BATCH; i++)
+	  last = last->next;
+	tc.heads[idx] = last->next;
+	tc.counts[idx] -= TRANSFER_BATCH;
+	SharedFreeList& sfl = op_pool_shared[idx];
+	AutoHSLLock al(sfl.mutex);
+	last->next = sfl.head;
+	sfl.head = first;
+	sfl.count += TRANSFER_BATCH;
+      }
+      return;
+    }
+#endif
+    free(ptr);
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class Operation
@@ -48,7 +161,8 @@ namespace Realm {
     case Status::WAITING:
       {
 	// normal behavior
-	timeline.record_ready_time();
+	if(wants_timeline)
+	  timeline.record_ready_time();
 	return true;
       }
 
@@ -76,7 +190,8 @@ namespace Realm {
     case Status::READY:
       {
 	// normal behavior
-	timeline.record_start_time();
+	if(wants_timeline)
+	  timeline.record_start_time();
 	return true;
       }
 
@@ -96,7 +211,8 @@ namespace Realm {
 
   void Operation::mark_finished(bool successful)
   {
-    timeline.record_end_time();
+    if(wants_timeline)
+      timeline.record_end_time();
 
     // update this count first
     if(!successful)
@@ -130,7 +246,8 @@ namespace Realm {
       // don't update error_code/details - that was already provided in the interrupt request
     }
 
-    timeline.record_complete_time();
+    if(wants_timeline)
+      timeline.record_complete_time();
 
     __sync_fetch_and_add(&failed_work_items, 1);
 
@@ -165,7 +282,8 @@ namespace Realm {
 	   (prev == Status::TERMINATED_EARLY) ||
 	   (prev == Status::CANCELLED));
 
-    timeline.record_complete_time();
+    if(wants_timeline)
+      timeline.record_complete_time();
 
     send_profiling_data();
 
@@ -218,6 +336,11 @@ namespace Realm {
     mark_finished(false /*unsuccessful*/);
   }
 
+  /*virtual*/ void Operation::boost_priority(int new_priority, int depth)
+  {
+    // nothing to do by default
+  }
+
   void Operation::send_profiling_data(void)
   {
     if(requests.request_count() > 0) {
@@ -249,12 +372,19 @@ namespace Realm {
   {
     requests.clear();
     measurements.clear();
+    wants_timeline = false;
+    wants_event_waits = false;
   }
 
   void Operation::reconstruct_measurements()
   {
+    if(requests.request_count() == 0)
+      return;
     measurements.import_requests(requests);
-    timeline.record_create_time();
+    wants_timeline = measurements.wants_measurement<ProfilingMeasurements::OperationTimeline>();
+    wants_event_waits = measurements.wants_measurement<ProfilingMeasurements::OperationEventWaits>();
+    if(wants_timeline)
+      timeline.record_create_time();
   }
 
   std::ostream& operator<<(std::ostream& os, const Operation *op)
@@ -512,6 +642,35 @@ namespace Realm {
 #endif
   }
     
+  void OperationTable::boost_priority(Event finish_event, int new_priority,
+				      int depth)
+  {
+#ifdef REALM_USE_OPERATION_TABLE
+    // "hash" the id to figure out which subtable to use
+    int subtable = finish_event.id % NUM_TABLES;
+    GASNetHSL& mutex = mutexes[subtable];
+    Table& table = tables[subtable];
+
+    Operation *local_op = 0;
+    {
+      AutoHSLLock al(mutex);
+
+      // remote operations (and ones that are already done) are left alone
+      Table::iterator it = table.find(finish_event);
+      if((it != table.end()) && it->second.local_op) {
+	local_op = it->second.local_op;
+	local_op->add_reference();
+      }
+    }
+
+    if(local_op) {
+      log_optable.debug() << "event " << finish_event << " - operation " << (void *)local_op << " boosted to priority " << new_priority;
+      local_op->boost_priority(new_priority, depth);
+      local_op->remove_reference();
+    }
+#endif
+  }
+
   /*static*/ void OperationTable::register_handlers(void)
   {
   }
@@ -26,6 +26,24 @@
 
 namespace Realm {
 
+  // a slab allocator for operations and their async work items - objects are
+  //  grouped into size classes, and each thread keeps a small cache of free
+  //  objects per class so that the common allocate/free pattern doesn't touch
+  //  the heap at all - objects freed on a different thread than they were
+  //  allocated on are returned to a shared per-class list in batches
+  class OperationPool {
+  public:
+    static const size_t SIZE_CLASS_BYTES = 64;
+    static const size_t NUM_SIZE_CLASSES = 32;  // i.e. up to 2KB objects
+    static const size_t SLAB_BYTES = 65536;
+    static const size_t THREAD_CACHE_MAX = 64;
+    static const size_t TRANSFER_BATCH = 32;
+
+    // requests larger than the biggest size class fall through to malloc/free
+    static void *allocate(size_t bytes);
+    static void deallocate(void *ptr, size_t bytes);
+  };
+
   class Operation {
   protected:
     // must be subclassed
@@ -36,6 +54,12 @@ namespace Realm {
     virtual ~Operation(void);
 
   public:
+    // all operations (and subclasses, e.g. tasks and dma requests) come from
+    //  the operation pool - the virtual destructor guarantees we get the size
+    //  of the most-derived object back on deletion
+    static void *operator new(size_t bytes);
+    static void operator delete(void *ptr, size_t bytes);
+
     void add_reference(void);
     void remove_reference(void);
 
@@ -62,6 +86,11 @@ namespace Realm {
 
     virtual void print(std::ostream& os) const = 0;
 
+    // requests that the operation (and, up to 'depth' levels, whatever it is
+    //  waiting on) be scheduled at least at 'new_priority' because something
+    //  more important depends on it - the default is to ignore the request
+    virtual void boost_priority(int new_priority, int depth);
+
     // abstract class to describe asynchronous work started by an operation
     //  that must finish for the operation to become "complete"
     class AsyncWorkItem {
@@ -69,6 +98,9 @@ namespace Realm {
       AsyncWorkItem(Operation *_op);
       virtual ~AsyncWorkItem(void);
 
+      static void *operator new(size_t bytes);
+      static void operator delete(void *ptr, size_t bytes);
+
       void mark_finished(bool successful);
 
       virtual void request_cancellation(void) = 0;
@@ -108,6 +140,9 @@ namespace Realm {
     typedef ProfilingMeasurements::OperationStatus Status;
     ProfilingMeasurements::OperationStatus status;
     ProfilingMeasurements::OperationTimeline timeline;
+    // timeline/wait bookkeeping is skipped unless a profiling request asks
+    //  for it
+    bool wants_timeline;
     bool wants_event_waits;
     ProfilingMeasurements::OperationEventWaits waits;
     ProfilingRequestSet requests; 
@@ -131,6 +166,10 @@ namespace Realm {
     void add_remote_operation(Event finish_event, int remote_note);
 
     void request_cancellation(Event finish_event, const void *reason_data, size_t reason_size);
+
+    // passes a priority boost on to the local operation (if any) that will
+    //  trigger 'finish_event'
+    void boost_priority(Event finish_event, int new_priority, int depth);
     
     static void register_handlers(void);
 
@@ -35,9 +35,26 @@ namespace Realm {
   {
     status.result = ProfilingMeasurements::OperationStatus::WAITING;
     status.error_code = 0;
-    measurements.import_requests(requests); 
-    timeline.record_create_time();
-    wants_event_waits = measurements.wants_measurement<ProfilingMeasurements::OperationEventWaits>();
+    if(requests.request_count() > 0) {
+      measurements.import_requests(requests);
+      wants_timeline = measurements.wants_measurement<ProfilingMeasurements::OperationTimeline>();
+      wants_event_waits = measurements.wants_measurement<ProfilingMeasurements::OperationEventWaits>();
+      if(wants_timeline)
+	timeline.record_create_time();
+    } else {
+      wants_timeline = false;
+      wants_event_waits = false;
+    }
+  }
+
+  /*static*/ inline void *Operation::operator new(size_t bytes)
+  {
+    return OperationPool::allocate(bytes);
+  }
+
+  /*static*/ inline void Operation::operator delete(void *ptr, size_t bytes)
+  {
+    OperationPool::deallocate(ptr, bytes);
   }
 
   inline void Operation::add_reference(void)
@@ -110,6 +127,17 @@ namespace Realm {
   {
   }
 
+  /*static*/ inline void *Operation::AsyncWorkItem::operator new(size_t bytes)
+  {
+    return OperationPool::allocate(bytes);
+  }
+
+  /*static*/ inline void Operation::AsyncWorkItem::operator delete(void *ptr,
+								  size_t bytes)
+  {
+    OperationPool::deallocate(ptr, bytes);
+  }
+
   inline void Operation::AsyncWorkItem::mark_finished(bool successful)
   {
     op->work_item_finished(this, successful);
@@ -83,11 +83,40 @@ namespace Realm {
 
     void set_gauge(ProfilingGauges::AbsoluteRangeGauge<int> *new_gauge);
 
+    // by default, every put() takes the queue's lock - with many producers (e.g. event
+    //  triggers on several threads) that lock becomes the bottleneck, so a queue can
+    //  instead accept new items onto a lock-free list of pending insertions
+    // one producer becomes responsible for draining pending items into the queue
+    //  (with the lock held, so notification callbacks still see the same locking
+    //  behavior), while all others return right away
+    // this must be chosen before the queue is used by multiple threads
+    void set_lockfree_put(bool enabled);
+
   protected:
     // helper that performs notifications for a new item - returns true if a callback
     //  consumes the item
     bool perform_notifications(T item, priority_t item_priority);
 
+    // inserts an item into the queue proper - lock must be held by caller
+    void insert_locked(T item, priority_t priority, bool add_to_back);
+
+    // moves everything on the pending list into the queue - lock must be held by
+    //  caller - returns the number of items moved
+    int drain_pending_locked(void);
+
+    struct PendingItem {
+      T item;
+      priority_t priority;
+      bool add_to_back;
+      PendingItem *next;
+    };
+
+    bool lockfree_put;
+    // pending insertions (a LIFO of items - reversed when drained) and a count of
+    //  the pending insertions that have not yet been accounted for by a drainer
+    PendingItem * volatile pending_head;
+    volatile int pending_count;
+
     // 'highest_priority' may be read without the lock held, but only written with the lock
     priority_t highest_priority;
 
@@ -26,7 +26,10 @@ namespace Realm {
 
   template <typename T, typename LT>
   inline PriorityQueue<T, LT>::PriorityQueue(void)
-    : highest_priority (PRI_NEG_INF)
+    : lockfree_put (false)
+    , pending_head (0)
+    , pending_count (0)
+    , highest_priority (PRI_NEG_INF)
     , entries_in_queue (0)
   {
   }
@@ -34,7 +37,13 @@ namespace Realm {
   template <typename T, typename LT>
   inline PriorityQueue<T, LT>::~PriorityQueue(void)
   {
-    // STL cleans everything up
+    // STL cleans up everything except any pending insertions that were never
+    //  drained (which should only happen if the queue is destroyed mid-put)
+    while(pending_head) {
+      PendingItem *p = pending_head;
+      pending_head = p->next;
+      delete p;
+    }
   }
 
   // two ways to add an item -
@@ -55,9 +64,51 @@ namespace Realm {
     if(entries_in_queue)
       (*entries_in_queue) += 1;
 
+    if(lockfree_put) {
+      // push onto the pending list without taking the lock
+      PendingItem *p = new PendingItem;
+      p->item = item;
+      p->priority = priority;
+      p->add_to_back = add_to_back;
+      while(true) {
+	PendingItem *old_head = pending_head;
+	p->next = old_head;
+	if(__sync_bool_compare_and_swap(&pending_head, old_head, p))
+	  break;
+      }
+
+      // the producer that moves the count away from zero is responsible for
+      //  draining - everybody else is done
+      if(__sync_fetch_and_add(&pending_count, 1) != 0)
+	return;
+
+      lock.lock();
+      while(true) {
+	int drained = drain_pending_locked();
+	// keep going until we've accounted for at least as many items as have been
+	//  announced - a non-positive count means any stragglers have already been
+	//  moved into the queue by us (or will be drained by whoever announces next)
+	if(__sync_sub_and_fetch(&pending_count, drained) <= 0)
+	  break;
+      }
+      lock.unlock();
+      return;
+    }
+
     // step 2: take the lock
     lock.lock();
 
+    insert_locked(item, priority, add_to_back);
+
+    // all done
+    lock.unlock();
+  }
+
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::insert_locked(T item,
+						  priority_t priority,
+						  bool add_to_back)
+  {
     // step 3: if this is higher priority than anybody else, do notification callbacks
     if(priority > highest_priority) {
       // remember the original one in case this gets immediately grabbed
@@ -70,7 +121,6 @@ namespace Realm {
       if(perform_notifications(item, priority)) {
 	// item was taken, so restore original highest priority and exit
 	highest_priority = orig_highest;
-	lock.unlock();
 	if(entries_in_queue)
 	  (*entries_in_queue) -= 1;
 	return;
@@ -85,9 +135,36 @@ namespace Realm {
       dq.push_back(item);
     else
       dq.push_front(item);
+  }
 
-    // all done
-    lock.unlock();
+  template <typename T, typename LT>
+  inline int PriorityQueue<T, LT>::drain_pending_locked(void)
+  {
+    // grab the entire pending list at once
+    PendingItem *p = __sync_lock_test_and_set(&pending_head, (PendingItem *)0);
+    if(!p)
+      return 0;
+
+    // list is in LIFO order - reverse it so that items are inserted in the order
+    //  in which they were put
+    PendingItem *fifo = 0;
+    int count = 0;
+    while(p) {
+      PendingItem *next = p->next;
+      p->next = fifo;
+      fifo = p;
+      p = next;
+      count++;
+    }
+
+    while(fifo) {
+      PendingItem *next = fifo->next;
+      insert_locked(fifo->item, fifo->priority, fifo->add_to_back);
+      delete fifo;
+      fifo = next;
+    }
+
+    return count;
   }
 
   // getting an item is always from the front of the list and can be filtered to
@@ -100,6 +177,13 @@ namespace Realm {
     // body is protected by lock
     lock.lock();
 
+    // pick up any pending insertions so we don't miss something better - the
+    //  designated drainer (if any) will notice they've been accounted for
+    if(lockfree_put && pending_head) {
+      int drained = drain_pending_locked();
+      __sync_fetch_and_sub(&pending_count, drained);
+    }
+
     // empty queue - early out
     if(queue.empty()) {
       lock.unlock();
@@ -179,6 +263,9 @@ namespace Realm {
   template <typename T, typename LT>
   inline bool PriorityQueue<T, LT>::empty(priority_t higher_than /*= PRI_NEG_INF*/) const
   {
+    // pending insertions are of unknown priority, so count them as non-empty
+    if(lockfree_put && pending_head)
+      return false;
     return(highest_priority <= higher_than);
   }
 
@@ -233,4 +320,10 @@ namespace Realm {
     entries_in_queue = new_gauge;
   }
 
+  template <typename T, typename LT>
+  inline void PriorityQueue<T, LT>::set_lockfree_put(bool enabled)
+  {
+    lockfree_put = enabled;
+  }
+
 }; // namespace Realm
@@ -329,6 +329,69 @@ namespace Realm {
       return finish_event;
     }
 
+    /*static*/ Event Processor::register_tasks_by_kind(Kind target_kind, bool global,
+						       const std::vector<TaskRegistrationDesc>& tasks,
+						       const ProfilingRequestSet& prs)
+    {
+      // some sanity checks first
+      for(std::vector<TaskRegistrationDesc>::const_iterator it = tasks.begin();
+	  it != tasks.end();
+	  it++)
+	if(it->codedesc->type() != TypeConv::from_cpp_type<TaskFuncPtr>()) {
+	  log_taskreg.fatal() << "attempt to register a task function of improper type: " << it->codedesc->type();
+	  assert(0);
+	}
+
+      // one operation and one event covers the whole batch
+      Event finish_event = GenEventImpl::create_genevent()->current_event();
+
+      TaskBatchRegistration *tro = new TaskBatchRegistration(tasks, finish_event, prs);
+      get_runtime()->optable.add_local_operation(finish_event, tro);
+      // we haven't told anybody about this operation yet, so cancellation really shouldn't
+      //  be possible
+#ifndef NDEBUG
+      bool ok_to_run =
+#endif
+	(tro->mark_ready() && tro->mark_started());
+      assert(ok_to_run);
+
+      // do local processors first
+      std::set<Processor> local_procs;
+      get_runtime()->machine->get_local_processors_by_kind(local_procs, target_kind);
+      for(std::set<Processor>::const_iterator it = local_procs.begin();
+	  it != local_procs.end();
+	  it++) {
+	ProcessorImpl *p = get_runtime()->get_processor_impl(*it);
+	for(size_t i = 0; i < tro->func_ids.size(); i++)
+	  p->register_task(tro->func_ids[i], tro->codedescs[i], tro->userdatas[i]);
+      }
+
+      if(global && !tasks.empty()) {
+	// remote processors need a portable implementation available
+	for(size_t i = 0; i < tro->codedescs.size(); i++)
+	  if(!tro->codedescs[i].has_portable_implementations()) {
+	    log_taskreg.fatal() << "cannot remotely register a task with no portable implementations";
+	    assert(0);
+	  }
+
+	// every node gets the whole batch in one message
+	for(NodeID target = 0; target <= max_node_id; target++) {
+	  // skip ourselves
+	  if(target == my_node_id)
+	    continue;
+
+	  RemoteTaskRegistration *reg_op = new RemoteTaskRegistration(tro, target);
+	  tro->add_async_work_item(reg_op);
+	  RegisterTaskBatchMessage::send_request(target, target_kind,
+						 tro->func_ids, tro->codedescs,
+						 tro->userdatas, reg_op);
+	}
+      }
+
+      tro->mark_finished(true /*successful*/);
+      return finish_event;
+    }
+
     // reports an execution fault in the currently running task
     /*static*/ void Processor::report_execution_fault(int reason,
 						      const void *reason_data,
@@ -348,6 +411,16 @@ namespace Realm {
       }
     }
 
+    /*static*/ void Processor::continue_task_after(Event wait_on,
+						   const void *args,
+						   size_t arglen)
+    {
+      // only tasks can be continued
+      Task *task = dynamic_cast<Task *>(Thread::self()->get_operation());
+      assert(task != 0);
+      task->request_continuation(wait_on, args, arglen);
+    }
+
     // reports a problem with a processor in general (this is primarily for fault injection)
     void Processor::report_processor_fault(int reason,
 					   const void *reason_data,
@@ -421,11 +494,21 @@ namespace Realm {
   // class ProcessorGroup
   //
 
+  namespace Config {
+    int group_dispatch_mode = 0;
+    int group_affinity_slack_us = 50;
+  };
+
     ProcessorGroup::ProcessorGroup(void)
       : ProcessorImpl(Processor::NO_PROC, Processor::PROC_GROUP),
 	members_valid(false), members_requested(false), next_free(0)
       , ready_task_count(0)
     {
+      task_queue.set_lockfree_put(Config::lockfree_task_queues);
+      for(size_t i = 0; i < PRODUCER_HINTS; i++) {
+	producer_hints[i].event = 0;
+	producer_hints[i].member = -1;
+      }
     }
 
     ProcessorGroup::~ProcessorGroup(void)
@@ -460,6 +543,22 @@ namespace Realm {
       members_requested = true;
       members_valid = true;
 
+      // load-aware dispatch is only possible if we can see every member's load
+      if(Config::group_dispatch_mode != 0) {
+	for(std::vector<ProcessorImpl *>::const_iterator it = members.begin();
+	    it != members.end();
+	    it++) {
+	  LocalTaskProcessor *ltp = dynamic_cast<LocalTaskProcessor *>(*it);
+	  if(!ltp) {
+	    log_task.info() << "group " << me << " contains non-local member "
+			    << (*it)->me << " - using shared queue dispatch";
+	    local_members.clear();
+	    break;
+	  }
+	  local_members.push_back(ltp);
+	}
+      }
+
       // now that we exist, profile our queue depth
       std::string gname = stringbuilder() << "realm/proc " << me << "/ready tasks";
       ready_task_count = new ProfilingGauges::AbsoluteRangeGauge<int>(gname);
@@ -478,13 +577,63 @@ namespace Realm {
 
     void ProcessorGroup::enqueue_task(Task *task)
     {
+      // in load-aware mode, hand the task directly to the chosen member
+      if(!local_members.empty()) {
+	choose_member(task)->enqueue_task(task);
+	return;
+      }
+
       // put it into the task queue - one of the member procs will eventually grab it
-      if(task->mark_ready())
+      if(task->mark_ready()) {
+	task->ready_queue = &task_queue;
 	task_queue.put(task, task->priority);
+      }
       else
 	task->mark_finished(false /*!successful*/);
     }
 
+    LocalTaskProcessor *ProcessorGroup::choose_member(Task *task)
+    {
+      long long now = Clock::current_time_in_nanoseconds();
+
+      int best = 0;
+      long long best_wait = local_members[0]->estimated_wait_ns(now);
+      for(size_t i = 1; (i < local_members.size()) && (best_wait > 0); i++) {
+	long long wait = local_members[i]->estimated_wait_ns(now);
+	if(wait < best_wait) {
+	  best = i;
+	  best_wait = wait;
+	}
+      }
+
+      // if the task's precondition is a task we dispatched, prefer the
+      //  member that ran it unless it's much busier than the best choice
+      if(task->before_event.exists()) {
+	size_t idx = task->before_event.id % PRODUCER_HINTS;
+	int producer = -1;
+	{
+	  AutoHSLLock al(producer_mutex);
+	  if(producer_hints[idx].event == task->before_event.id)
+	    producer = producer_hints[idx].member;
+	}
+	if((producer >= 0) && (producer != best)) {
+	  long long wait = local_members[producer]->estimated_wait_ns(now);
+	  if(wait <= (best_wait + Config::group_affinity_slack_us * 1000LL))
+	    best = producer;
+	}
+      }
+
+      Event finish = task->get_finish_event();
+      if(finish.exists()) {
+	size_t idx = finish.id % PRODUCER_HINTS;
+	AutoHSLLock al(producer_mutex);
+	producer_hints[idx].event = finish.id;
+	producer_hints[idx].member = best;
+      }
+
+      return local_members[best];
+    }
+
     void ProcessorGroup::add_to_group(ProcessorGroup *group)
     {
       // recursively add all of our members
@@ -524,6 +673,21 @@ namespace Realm {
   // class DeferredTaskSpawn
   //
 
+  namespace Config {
+    bool task_priority_inheritance = false;
+  };
+
+    DeferredTaskSpawn::DeferredTaskSpawn(ProcessorImpl *_proc, Task *_task)
+      : proc(_proc), task(_task)
+    {
+      // a raised-priority task that has to wait lends its priority to the
+      //  operation it's waiting on (and, transitively, a few levels beyond)
+      if(Config::task_priority_inheritance && (task->priority > 0) &&
+	 task->before_event.exists())
+	get_runtime()->optable.boost_priority(task->before_event, task->priority,
+					      MAX_INHERIT_DEPTH);
+    }
+
     bool DeferredTaskSpawn::event_triggered(Event e, bool poisoned)
     {
       if(poisoned) {
@@ -584,6 +748,10 @@ namespace Realm {
 						 Event start_event, Event finish_event,
 						 int priority)
   {
+    if(SpawnTaskBatcher::add_spawn(target, proc, func_id, args, arglen, prs,
+				   start_event, finish_event, priority))
+      return;
+
     RequestArgs r_args;
 
     r_args.proc = proc;
@@ -598,19 +766,240 @@ namespace Realm {
       Message::request(target, r_args, args, arglen, PAYLOAD_COPY);
     } else {
       // need to serialize both the task args and the profiling request
-      //  into a single payload
-      // allocate a little extra initial space for the profiling requests, but not too
-      //  much in case the copy sits around outside the srcdatapool for a long time
-      // (if we need more than this, we'll pay for a realloc during serialization, but it
-      //  will still work correctly)
-      Serialization::DynamicBufferSerializer dbs(arglen + 512);
-
-      dbs.append_bytes(args, arglen);
-      dbs << *prs;
-
-      size_t datalen = dbs.bytes_used();
-      void *data = dbs.detach_buffer(-1);  // don't trim - this buffer has a short life
-      Message::request(target, r_args, data, datalen, PAYLOAD_FREE);
+      //  into a single payload - (large) task args are referenced rather
+      //  than copied, so the only copy is the one made by the message layer
+      Serialization::SpanListSerializer sls(512);
+
+      sls.append_bytes(args, arglen);
+      sls << *prs;
+
+      SpanList spans;
+      sls.get_spans(spans);
+      Message::request(target, r_args, spans, sls.bytes_used(), PAYLOAD_COPY);
+    }
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class SpawnTaskBatchMessage
+  //
+
+  // each spawn in a batch is the processor, function, events, priority and
+  //  argument length, followed by the arguments and then a flag saying
+  //  whether a profiling request set follows
+
+  /*static*/ void SpawnTaskBatchMessage::send_request(NodeID target, int num_tasks,
+						      void *data, size_t datalen)
+  {
+    RequestArgs args;
+
+    args.sender = my_node_id;
+    args.num_tasks = num_tasks;
+
+    Message::request(target, args, data, datalen, PAYLOAD_FREE);
+  }
+
+  /*static*/ void SpawnTaskBatchMessage::handle_request(RequestArgs args,
+							const void *data,
+							size_t datalen)
+  {
+    DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
+    log_task.debug() << "received remote spawn batch: sender=" << args.sender
+		     << " tasks=" << args.num_tasks;
+
+    Serialization::FixedBufferDeserializer fbd(data, datalen);
+    for(int i = 0; i < args.num_tasks; i++) {
+      Processor proc;
+      Processor::TaskFuncID func_id;
+      Event start_event, finish_event;
+      int priority;
+      size_t arglen;
+      bool has_prs;
+#ifndef NDEBUG
+      bool ok =
+#endif
+	((fbd >> proc) && (fbd >> func_id) &&
+	 (fbd >> start_event) && (fbd >> finish_event) &&
+	 (fbd >> priority) && (fbd >> arglen));
+      assert(ok);
+      // the spawn copies the arguments, so refer to them in place
+      const void *task_args = fbd.peek_bytes(arglen);
+      fbd.extract_bytes(0, arglen);
+
+      ProfilingRequestSet prs;
+#ifndef NDEBUG
+      ok =
+#endif
+	(fbd >> has_prs);
+      assert(ok);
+      if(has_prs) {
+#ifndef NDEBUG
+	ok =
+#endif
+	  (fbd >> prs);
+	assert(ok);
+      }
+
+      ProcessorImpl *p = get_runtime()->get_processor_impl(proc);
+      p->spawn_task(func_id, task_args, arglen, prs,
+		    start_event, finish_event, priority);
+    }
+    assert(fbd.bytes_left() == 0);
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class SpawnTaskBatcher
+  //
+
+  namespace Config {
+    int spawn_batch_latency_us = 0;
+    int spawn_batch_max_bytes = 8192;
+  };
+
+  /*static*/ SpawnTaskBatcher *SpawnTaskBatcher::batcher = 0;
+
+  SpawnTaskBatcher::Batch::Batch(void)
+    : dbs(0), num_tasks(0), oldest_entry_time(0)
+  {}
+
+  SpawnTaskBatcher::SpawnTaskBatcher(int _num_nodes,
+				     long long _flush_latency_ns,
+				     size_t _max_batch_bytes)
+    : num_nodes(_num_nodes)
+    , flush_latency_ns(_flush_latency_ns)
+    , max_batch_bytes(_max_batch_bytes)
+    , nonempty_batches(0)
+  {
+    batches.resize(num_nodes);
+    for(int i = 0; i < num_nodes; i++)
+      batches[i] = new Batch;
+  }
+
+  SpawnTaskBatcher::~SpawnTaskBatcher(void)
+  {
+    for(int i = 0; i < num_nodes; i++) {
+      assert(batches[i]->num_tasks == 0);
+      delete batches[i]->dbs;
+      delete batches[i];
+    }
+  }
+
+  /*static*/ void SpawnTaskBatcher::init_batching(int num_nodes)
+  {
+    if((Config::spawn_batch_latency_us <= 0) || (num_nodes <= 1))
+      return;
+
+    batcher = new SpawnTaskBatcher(num_nodes,
+				   Config::spawn_batch_latency_us * 1000LL,
+				   Config::spawn_batch_max_bytes);
+    add_polling_callback(&SpawnTaskBatcher::polling_callback);
+  }
+
+  /*static*/ void SpawnTaskBatcher::shutdown_batching(void)
+  {
+    if(!batcher)
+      return;
+
+    batcher->flush(true /*force*/);
+    // leave the batcher in place - a polling thread may still be looking at it
+  }
+
+  /*static*/ void SpawnTaskBatcher::polling_callback(void)
+  {
+    // quick check without taking any locks
+    if(batcher->nonempty_batches > 0)
+      batcher->flush(false /*!force*/);
+  }
+
+  /*static*/ bool SpawnTaskBatcher::add_spawn(NodeID target, Processor proc,
+					      Processor::TaskFuncID func_id,
+					      const void *args, size_t arglen,
+					      const ProfilingRequestSet *prs,
+					      Event start_event, Event finish_event,
+					      int priority)
+  {
+    if(!batcher)
+      return false;
+
+    assert((target >= 0) && (target < batcher->num_nodes));
+    Batch *b = batcher->batches[target];
+
+    int to_send_tasks = 0;
+    size_t to_send_bytes = 0;
+    void *to_send = 0;
+    {
+      AutoHSLLock al(b->mutex);
+
+      if(b->num_tasks == 0) {
+	if(!b->dbs)
+	  b->dbs = new Serialization::DynamicBufferSerializer(batcher->max_batch_bytes);
+	b->oldest_entry_time = Clock::current_time_in_nanoseconds();
+	__sync_fetch_and_add(&batcher->nonempty_batches, 1);
+      }
+
+      bool has_prs = (prs && !prs->empty());
+      bool ok = ((*(b->dbs) << proc) && (*(b->dbs) << func_id) &&
+		 (*(b->dbs) << start_event) && (*(b->dbs) << finish_event) &&
+		 (*(b->dbs) << priority) && (*(b->dbs) << arglen) &&
+		 b->dbs->append_bytes(args, arglen) &&
+		 (*(b->dbs) << has_prs));
+      if(has_prs)
+	ok = ok && (*(b->dbs) << *prs);
+      assert(ok);
+      b->num_tasks++;
+
+      // send right away if we've filled the batch
+      if(b->dbs->bytes_used() >= batcher->max_batch_bytes) {
+	to_send_tasks = b->num_tasks;
+	to_send_bytes = b->dbs->bytes_used();
+	to_send = b->dbs->detach_buffer(-1 /*no trim*/);
+	delete b->dbs;
+	b->dbs = 0;
+	b->num_tasks = 0;
+	__sync_fetch_and_sub(&batcher->nonempty_batches, 1);
+      }
+    }
+
+    if(to_send)
+      SpawnTaskBatchMessage::send_request(target, to_send_tasks,
+					  to_send, to_send_bytes);
+    return true;
+  }
+
+  void SpawnTaskBatcher::flush(bool force)
+  {
+    long long now = (force ? 0 : Clock::current_time_in_nanoseconds());
+
+    for(int i = 0; i < num_nodes; i++) {
+      Batch *b = batches[i];
+      // unlocked check to skip empty batches
+      if(b->num_tasks == 0)
+	continue;
+
+      int to_send_tasks = 0;
+      size_t to_send_bytes = 0;
+      void *to_send = 0;
+      {
+	AutoHSLLock al(b->mutex);
+
+	if((b->num_tasks == 0) ||
+	   (!force && ((now - b->oldest_entry_time) < flush_latency_ns)))
+	  continue;
+
+	to_send_tasks = b->num_tasks;
+	to_send_bytes = b->dbs->bytes_used();
+	to_send = b->dbs->detach_buffer(-1 /*no trim*/);
+	delete b->dbs;
+	b->dbs = 0;
+	b->num_tasks = 0;
+	__sync_fetch_and_sub(&nonempty_batches, 1);
+      }
+
+      SpawnTaskBatchMessage::send_request(i, to_send_tasks,
+					  to_send, to_send_bytes);
     }
   }
 
@@ -673,13 +1062,72 @@ namespace Realm {
     args.kind = kind;
     args.reg_op = reg_op;
 
-    Serialization::DynamicBufferSerializer dbs(1024);
-    dbs << procs;
-    dbs << codedesc;
-    dbs << ByteArrayRef(userdata, userlen);
+    // user data is referenced rather than copied into the serializer
+    Serialization::SpanListSerializer sls(1024);
+    sls << procs;
+    sls << codedesc;
+    sls << ByteArrayRef(userdata, userlen);
+
+    SpanList spans;
+    sls.get_spans(spans);
+    Message::request(target, args, spans, sls.bytes_used(), PAYLOAD_COPY);
+  }
+
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class RegisterTaskBatchMessage
+  //
+
+  /*static*/ void RegisterTaskBatchMessage::handle_request(RequestArgs args, const void *data, size_t datalen)
+  {
+    std::vector<Processor::TaskFuncID> func_ids;
+    std::vector<CodeDescriptor> codedescs;
+    std::vector<ByteArray> userdatas;
+
+    Serialization::FixedBufferDeserializer fbd(data, datalen);
+#ifndef NDEBUG
+    bool ok =
+#endif
+      ((fbd >> func_ids) && (fbd >> codedescs) && (fbd >> userdatas));
+    assert(ok && (fbd.bytes_left() == 0));
+    assert((func_ids.size() == codedescs.size()) &&
+	   (func_ids.size() == userdatas.size()));
+
+    std::set<Processor> local_procs;
+    get_runtime()->machine->get_local_processors_by_kind(local_procs, args.kind);
+    for(std::set<Processor>::const_iterator it = local_procs.begin();
+	it != local_procs.end();
+	it++) {
+      ProcessorImpl *p = get_runtime()->get_processor_impl(*it);
+      for(size_t i = 0; i < func_ids.size(); i++)
+	p->register_task(func_ids[i], codedescs[i], userdatas[i]);
+    }
+
+    RegisterTaskCompleteMessage::send_request(args.sender, args.reg_op,
+					      true /*successful*/);
+  }
+
+  /*static*/ void RegisterTaskBatchMessage::send_request(NodeID target,
+							 Processor::Kind kind,
+							 const std::vector<Processor::TaskFuncID>& func_ids,
+							 const std::vector<CodeDescriptor>& codedescs,
+							 const std::vector<ByteArray>& userdatas,
+							 RemoteTaskRegistration *reg_op)
+  {
+    RequestArgs args;
+
+    args.sender = my_node_id;
+    args.kind = kind;
+    args.reg_op = reg_op;
+
+    Serialization::DynamicBufferSerializer dbs(4096);
+    dbs << func_ids;
+    dbs << codedescs;
+    dbs << userdatas;
 
     size_t datalen = dbs.bytes_used();
-    void *data = dbs.detach_buffer(-1 /*no trim*/);
+    void *data = dbs.detach_buffer();
     Message::request(target, args, data, datalen, PAYLOAD_FREE);
   }
 
@@ -773,9 +1221,17 @@ namespace Realm {
                                          int _num_cores)
     : ProcessorImpl(_me, _kind, _num_cores)
     , sched(0)
+    , steal_filter(this)
     , ready_task_count(stringbuilder() << "realm/proc " << me << "/ready tasks")
+    , track_load(Config::group_dispatch_mode != 0)
+    , load_epoch_ns(Clock::current_time_in_nanoseconds())
+    , queued_tasks(0), active_tasks(0), active_start_sum(0)
+    , busy_ns_total(0), tasks_completed(0)
+    , busy_time(stringbuilder() << "realm/proc " << me << "/busy ns")
+    , tasks_run(stringbuilder() << "realm/proc " << me << "/tasks run")
   {
     task_queue.set_gauge(&ready_task_count);
+    task_queue.set_lockfree_put(Config::lockfree_task_queues);
   }
 
   LocalTaskProcessor::~LocalTaskProcessor(void)
@@ -815,12 +1271,51 @@ namespace Realm {
     sched->add_task_queue(&group->task_queue);
   }
 
+  void LocalTaskProcessor::add_steal_victim(LocalTaskProcessor *victim)
+  {
+    assert(victim != this);
+    sched->set_steal_filter(&steal_filter);
+    sched->add_steal_queue(&victim->task_queue);
+  }
+
+  /*virtual*/ int LocalTaskProcessor::get_numa_domain(void) const
+  {
+    return -1;
+  }
+
+  bool LocalTaskProcessor::StealFilter::can_steal(Task *task)
+  {
+    // we can only run tasks for which we have a registration
+    return (proc->task_table.count(task->func_id) > 0);
+  }
+
+  long long LocalTaskProcessor::estimated_wait_ns(long long now) const
+  {
+    // these reads aren't mutually consistent, but this is just an estimate
+    long long rel_now = now - load_epoch_ns;
+    long long in_task = (active_tasks * rel_now) - active_start_sum;
+    if(in_task < 0) in_task = 0;
+
+    long long queued = queued_tasks;
+    if(queued < 0) queued = 0;
+    long long done = tasks_completed;
+    // assume a short task until we've seen some
+    long long avg_task_ns = ((done > 0) ? (busy_ns_total / done) : 10000);
+
+    return (in_task + (queued * avg_task_ns)) / ((num_cores > 1) ? num_cores : 1);
+  }
+
   void LocalTaskProcessor::enqueue_task(Task *task)
   {
     // just jam it into the task queue
-    if(task->mark_ready())
+    if(task->mark_ready()) {
+      if(track_load) {
+	__sync_fetch_and_add(&queued_tasks, 1);
+	task->queued_counter = &queued_tasks;
+      }
+      task->ready_queue = &task_queue;
       task_queue.put(task, task->priority);
-    else
+    } else
       task->mark_finished(false /*!successful*/);
   }
 
@@ -908,9 +1403,28 @@ namespace Realm {
 
     log_taskreg.debug() << "task " << func_id << " executing on " << me << ": " << ((void *)(tte.fnptr));
 
+    if(!track_load) {
+      (tte.fnptr)(task_args.base(), task_args.size(),
+		  tte.user_data.base(), tte.user_data.size(),
+		  me);
+      return;
+    }
+
+    long long start = Clock::current_time_in_nanoseconds() - load_epoch_ns;
+    __sync_fetch_and_add(&active_start_sum, start);
+    __sync_fetch_and_add(&active_tasks, 1);
+
     (tte.fnptr)(task_args.base(), task_args.size(),
 		tte.user_data.base(), tte.user_data.size(),
 		me);
+
+    long long elapsed = (Clock::current_time_in_nanoseconds() - load_epoch_ns) - start;
+    __sync_fetch_and_sub(&active_tasks, 1);
+    __sync_fetch_and_sub(&active_start_sum, start);
+    __sync_fetch_and_add(&busy_ns_total, elapsed);
+    __sync_fetch_and_add(&tasks_completed, 1);
+    busy_time += elapsed;
+    tasks_run += 1;
   }
 
   // blocks until things are cleaned up
@@ -931,6 +1445,9 @@ namespace Realm {
     }
 #endif
 
+    // stop watching any peers' queues before anybody starts getting torn down
+    sched->remove_steal_queues();
+
     sched->shutdown();
   }
   
@@ -1074,12 +1591,44 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class TaskBatchRegistration
+  //
+
+  TaskBatchRegistration::TaskBatchRegistration(const std::vector<Processor::TaskRegistrationDesc>& _tasks,
+					       Event _finish_event, const ProfilingRequestSet &_requests)
+    : Operation(_finish_event, _requests)
+  {
+    func_ids.reserve(_tasks.size());
+    codedescs.reserve(_tasks.size());
+    userdatas.resize(_tasks.size());
+    for(size_t i = 0; i < _tasks.size(); i++) {
+      func_ids.push_back(_tasks[i].func_id);
+      codedescs.push_back(*(_tasks[i].codedesc));
+      userdatas[i] = ByteArrayRef(_tasks[i].user_data, _tasks[i].user_data_len);
+    }
+    log_taskreg.debug() << "task batch registration created: op=" << (void *)this
+			<< " tasks=" << _tasks.size() << " finish=" << _finish_event;
+  }
+
+  TaskBatchRegistration::~TaskBatchRegistration(void)
+  {
+    log_taskreg.debug() << "task batch registration destroyed: op=" << (void *)this;
+  }
+
+  void TaskBatchRegistration::print(std::ostream& os) const
+  {
+    os << "TaskBatchRegistration(tasks=" << func_ids.size() << ")";
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class RemoteTaskRegistration
   //
 
-  RemoteTaskRegistration::RemoteTaskRegistration(TaskRegistration *reg_op, int _target_node)
+  RemoteTaskRegistration::RemoteTaskRegistration(Operation *reg_op, int _target_node)
     : Operation::AsyncWorkItem(reg_op)
     , target_node(_target_node)
   {}
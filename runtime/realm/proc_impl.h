@@ -96,10 +96,32 @@ namespace Realm {
 
       virtual void add_to_group(ProcessorGroup *group);
 
+      // allows this processor to steal ready tasks from 'victim' when it is idle
+      //  (victims are tried in the order they are added)
+      void add_steal_victim(LocalTaskProcessor *victim);
+
+      // the NUMA domain this processor's threads run in, or -1 if unknown
+      virtual int get_numa_domain(void) const;
+
+      // estimate of how long (in ns) a task enqueued now would wait before
+      //  starting, based on our queue depth and the time already spent in
+      //  currently-running tasks - used by load-aware group dispatch
+      long long estimated_wait_ns(long long now) const;
+
     protected:
       void set_scheduler(ThreadedTaskScheduler *_sched);
 
+      // a task may only be stolen if we have a matching task registered
+      class StealFilter : public ThreadedTaskScheduler::StealFilter {
+      public:
+	StealFilter(LocalTaskProcessor *_proc) : proc(_proc) {}
+	virtual bool can_steal(Task *task);
+      protected:
+	LocalTaskProcessor *proc;
+      };
+
       ThreadedTaskScheduler *sched;
+      StealFilter steal_filter;
       PriorityQueue<Task *, GASNetHSL> task_queue;
       ProfilingGauges::AbsoluteRangeGauge<int> ready_task_count;
 
@@ -112,6 +134,19 @@ namespace Realm {
 
       virtual void execute_task(Processor::TaskFuncID func_id,
 				const ByteArrayRef& task_args);
+
+      // load tracking - all updated with atomics, and times are relative to
+      //  load_epoch_ns to keep the sums of start times from overflowing
+      // (skipped entirely unless load-aware group dispatch is enabled)
+      bool track_load;
+      long long load_epoch_ns;
+      int queued_tasks;  // enqueued but not yet picked up by a worker
+      int active_tasks;
+      long long active_start_sum;
+      long long busy_ns_total;
+      long long tasks_completed;
+      ProfilingGauges::EventCounter<long long> busy_time;
+      ProfilingGauges::EventCounter<long long> tasks_run;
     };
 
     // three simple subclasses for:
@@ -201,15 +236,32 @@ namespace Realm {
 
       void request_group_members(void);
 
+      // picks the member a task should be sent to for load-aware dispatch
+      LocalTaskProcessor *choose_member(Task *task);
+
       PriorityQueue<Task *, GASNetHSL> task_queue;
       ProfilingGauges::AbsoluteRangeGauge<int> *ready_task_count;
+
+      // members that can accept dispatched tasks - empty if any member isn't
+      //  a local task processor, in which case the shared queue is always used
+      std::vector<LocalTaskProcessor *> local_members;
+
+      // remembers which member ran recent tasks, so that a task whose
+      //  precondition is another task's completion can follow its producer
+      //  (and the data it produced)
+      static const size_t PRODUCER_HINTS = 256;
+      struct ProducerHint {
+	Event::id_t event;
+	int member;
+      };
+      GASNetHSL producer_mutex;
+      ProducerHint producer_hints[PRODUCER_HINTS];
     };
     
     // this is generally useful to all processor implementations, so put it here
     class DeferredTaskSpawn : public EventWaiter {
     public:
-      DeferredTaskSpawn(ProcessorImpl *_proc, Task *_task) 
-        : proc(_proc), task(_task) {}
+      DeferredTaskSpawn(ProcessorImpl *_proc, Task *_task);
 
       virtual ~DeferredTaskSpawn(void)
       {
@@ -221,6 +273,8 @@ namespace Realm {
       virtual Event get_finish_event(void) const;
 
     protected:
+      static const int MAX_INHERIT_DEPTH = 4;
+
       ProcessorImpl *proc;
       Task *task;
     };
@@ -244,9 +298,27 @@ namespace Realm {
       ByteArray userdata;
     };
 
+    // registration of a batch of tasks as a single operation
+    class TaskBatchRegistration : public Operation {
+    public:
+      TaskBatchRegistration(const std::vector<Processor::TaskRegistrationDesc>& _tasks,
+			    Event _finish_event, const ProfilingRequestSet &_requests);
+
+    protected:
+      // deletion performed when reference count goes to zero
+      virtual ~TaskBatchRegistration(void);
+
+    public:
+      virtual void print(std::ostream& os) const;
+
+      std::vector<Processor::TaskFuncID> func_ids;
+      std::vector<CodeDescriptor> codedescs;
+      std::vector<ByteArray> userdatas;
+    };
+
     class RemoteTaskRegistration : public Operation::AsyncWorkItem {
     public:
-      RemoteTaskRegistration(TaskRegistration *reg_op, int _target_node);
+      RemoteTaskRegistration(Operation *reg_op, int _target_node);
 
       virtual void request_cancellation(void);
 
@@ -282,6 +354,77 @@ namespace Realm {
 			       Event start_event, Event finish_event,
 			       int priority);
     };
+
+    // SpawnTaskBatchMessage carries any number of aggregated task spawns for
+    //   processors on a single destination node
+
+    struct SpawnTaskBatchMessage {
+      struct RequestArgs : public BaseMedium {
+	NodeID sender;
+	int num_tasks;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<SPAWN_TASK_BATCH_MSGID,
+ 	                                 RequestArgs,
+ 	                                 handle_request> Message;
+
+      // takes ownership of 'data'
+      static void send_request(NodeID target, int num_tasks,
+			       void *data, size_t datalen);
+    };
+
+    // when enabled (with a non-zero flush latency), spawns headed for the same
+    //  node are collected into a batch that is sent when it is full or when
+    //  its oldest spawn has waited for the flush latency
+    // aged batches are flushed by the network polling thread(s)
+    class SpawnTaskBatcher {
+    public:
+      SpawnTaskBatcher(int _num_nodes, long long _flush_latency_ns,
+		       size_t _max_batch_bytes);
+      ~SpawnTaskBatcher(void);
+
+      // returns false if batching is not enabled, in which case the caller
+      //  should send the message itself
+      static bool add_spawn(NodeID target, Processor proc,
+			    Processor::TaskFuncID func_id,
+			    const void *args, size_t arglen,
+			    const ProfilingRequestSet *prs,
+			    Event start_event, Event finish_event,
+			    int priority);
+
+      // creates the batcher (if enabled by the command line) and hooks it up
+      //  to the network polling
+      static void init_batching(int num_nodes);
+      // sends anything that's left
+      static void shutdown_batching(void);
+
+      // sends any batches whose oldest spawn has aged out (or all non-empty
+      //  batches if 'force' is set)
+      void flush(bool force);
+
+    protected:
+      static void polling_callback(void);
+
+      struct Batch {
+	Batch(void);
+
+	GASNetHSL mutex;
+	Serialization::DynamicBufferSerializer *dbs;
+	int num_tasks;
+	long long oldest_entry_time;
+      };
+
+      static SpawnTaskBatcher *batcher;
+
+      int num_nodes;
+      long long flush_latency_ns;
+      size_t max_batch_bytes;
+      std::vector<Batch *> batches;
+      // number of non-empty batches - lets the polling callback skip the scan
+      int nonempty_batches;
+    };
     
     struct RegisterTaskMessage {
       struct RequestArgs : public BaseMedium {
@@ -306,6 +449,28 @@ namespace Realm {
 			       RemoteTaskRegistration *reg_op);
     };
     
+    // registers a whole batch of tasks on all processors of a kind
+    struct RegisterTaskBatchMessage {
+      struct RequestArgs : public BaseMedium {
+	NodeID sender;
+	Processor::Kind kind;
+	RemoteTaskRegistration *reg_op;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<REGISTER_TASK_BATCH_MSGID,
+ 	                                 RequestArgs,
+ 	                                 handle_request> Message;
+
+      static void send_request(NodeID target,
+			       Processor::Kind kind,
+			       const std::vector<Processor::TaskFuncID>& func_ids,
+			       const std::vector<CodeDescriptor>& codedescs,
+			       const std::vector<ByteArray>& userdatas,
+			       RemoteTaskRegistration *reg_op);
+    };
+    
     struct RegisterTaskCompleteMessage {
       struct RequestArgs {
 	NodeID sender;
@@ -77,6 +77,21 @@ namespace Realm {
 	TASK_ID_FIRST_AVAILABLE    = 4,
       };
 
+      // latency classes partition the task priority space - a ready task in
+      //  a more latency-sensitive class is always started ahead of any ready
+      //  task in a less sensitive class, while the priority within the class
+      //  orders tasks of the same class
+      enum LatencyClass {
+	LATENCY_BATCH = -1,
+	LATENCY_DEFAULT = 0,
+	LATENCY_INTERACTIVE = 1
+      };
+
+      // returns the spawn() priority for a given class and in-class priority
+      //  (which is clamped to +/- 2^19) - LATENCY_DEFAULT leaves priorities in
+      //  that range unchanged
+      static int latency_class_priority(LatencyClass lc, int priority = 0);
+
       Event spawn(TaskFuncID func_id, const void *args, size_t arglen,
 		  Event wait_on = Event::NO_EVENT, int priority = 0) const;
 
@@ -87,6 +102,17 @@ namespace Realm {
 
       static Processor get_executing_processor(void);
 
+      // lets the currently running task wait for an event as a continuation
+      //  instead of blocking - once the task function returns, the task is
+      //  not finished, but is run again on the same processor after 'wait_on'
+      //  has triggered, with a copy of 'args' as its arguments (so 'args'
+      //  must hold whatever state is needed to pick up where it left off)
+      // no thread or stack is held while the task waits, and its finish event
+      //  triggers only when an invocation returns without calling this - a
+      //  poisoned 'wait_on' terminates the task instead
+      static void continue_task_after(Event wait_on,
+				      const void *args, size_t arglen);
+
       // dynamic task registration - this may be done for:
       //  1) a specific processor/group (anywhere in the system)
       //  2) for all processors of a given type, either in the local address space/process,
@@ -106,6 +132,21 @@ namespace Realm {
 					 const ProfilingRequestSet& prs,
 					 const void *user_data = 0, size_t user_data_len = 0);
 
+      // bulk registration - registers many tasks for all processors of a given type
+      //  with a single event, and (if global) a single message per node rather than
+      //  one per task per node - the code descriptors are referenced, not copied, so
+      //  they must stay valid until the call returns
+      struct TaskRegistrationDesc {
+	TaskFuncID func_id;
+	const CodeDescriptor *codedesc;
+	const void *user_data;
+	size_t user_data_len;
+      };
+
+      static Event register_tasks_by_kind(Kind target_kind, bool global,
+					  const std::vector<TaskRegistrationDesc>& tasks,
+					  const ProfilingRequestSet& prs);
+
       // reports an execution fault in the currently running task
       static void report_execution_fault(int reason,
 					 const void *reason_data, size_t reason_size);
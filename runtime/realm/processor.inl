@@ -39,5 +39,14 @@ namespace Realm {
     return ThreadLocal::current_processor;
   }
 
+  /*static*/ inline int Processor::latency_class_priority(LatencyClass lc,
+							  int priority /*= 0*/)
+  {
+    const int half_span = 1 << 19;
+    if(priority < -half_span) priority = -half_span;
+    if(priority > (half_span - 1)) priority = half_span - 1;
+    return (int(lc) * 2 * half_span) + priority;
+  }
+
 
 }; // namespace Realm  
@@ -14,6 +14,7 @@
  */
 
 #include "realm/procset/procset_module.h"
+#include "realm/procset/procset_team.h"
 
 #include "realm/logging.h"
 #include "realm/cmdline.h"
@@ -22,10 +23,270 @@
 #include "realm/runtime_impl.h"
 #include "realm/utils.h"
 
+#include <pthread.h>
+#include <sched.h>
+
 namespace Realm {
 
    Logger log_procset("procset");
 
+  namespace ProcSet {
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class TeamImpl
+    //
+
+    // the cores of a processor set - the master (member 0) is whichever
+    //  thread is running the task, and the rest are dedicated kernel threads
+    //  that spin briefly and then sleep between parallel regions
+    class TeamImpl {
+    public:
+      TeamImpl(int _num_threads);
+      ~TeamImpl(void);
+
+      // called by the master - returns false if a region is already active
+      bool try_run(void (*fn)(void *), void *data);
+
+      // entry point for the non-master kernel threads
+      void worker_entry(void);
+
+      void barrier(void);
+
+      // wakes up and joins all the workers
+      void shutdown(void);
+
+      int num_threads;
+      std::vector<Thread *> worker_threads;
+
+    protected:
+      void run_member(int index);
+
+      pthread_mutex_t mutex;
+      pthread_cond_t condvar;
+      int next_worker_index;
+      volatile bool shutdown_flag;
+      volatile int busy;
+      // bumped (under the mutex) to start each parallel region
+      volatile unsigned region_generation;
+      volatile int members_remaining;
+      void (*work_fn)(void *);
+      void *work_data;
+      // barrier state - the last member to arrive resets the count and then
+      //  bumps the generation to release everyone else
+      volatile int barrier_arrived;
+      volatile unsigned barrier_generation;
+    };
+
+    namespace ThreadLocal {
+      // team of the procset whose task is running on this thread (master only)
+      __thread TeamImpl *task_team = 0;
+      // team region this thread is currently in (size == 0 means none) - a
+      //  serialized region has a size of 1 and no team
+      __thread TeamImpl *region_team = 0;
+      __thread int region_index = 0;
+      __thread int region_size = 0;
+    };
+
+    // waits are short (the team's cores are dedicated), so spin for a while
+    //  before giving up the core
+    static inline void spin_wait(int& count)
+    {
+      if(++count > 1000)
+	sched_yield();
+    }
+
+    TeamImpl::TeamImpl(int _num_threads)
+      : num_threads(_num_threads)
+      , next_worker_index(0)
+      , shutdown_flag(false)
+      , busy(0)
+      , region_generation(0)
+      , members_remaining(0)
+      , work_fn(0)
+      , work_data(0)
+      , barrier_arrived(0)
+      , barrier_generation(0)
+    {
+      pthread_mutex_init(&mutex, 0);
+      pthread_cond_init(&condvar, 0);
+    }
+
+    TeamImpl::~TeamImpl(void)
+    {
+      assert(worker_threads.empty());
+      pthread_cond_destroy(&condvar);
+      pthread_mutex_destroy(&mutex);
+    }
+
+    bool TeamImpl::try_run(void (*fn)(void *), void *data)
+    {
+      if(!__sync_bool_compare_and_swap(&busy, 0, 1))
+	return false;
+
+      work_fn = fn;
+      work_data = data;
+      members_remaining = num_threads - 1;
+
+      pthread_mutex_lock(&mutex);
+      region_generation++;
+      pthread_cond_broadcast(&condvar);
+      pthread_mutex_unlock(&mutex);
+
+      run_member(0);
+
+      int count = 0;
+      while(members_remaining > 0)
+	spin_wait(count);
+      __sync_synchronize();
+
+      busy = 0;
+      return true;
+    }
+
+    void TeamImpl::worker_entry(void)
+    {
+      pthread_mutex_lock(&mutex);
+      int index = ++next_worker_index;
+      pthread_mutex_unlock(&mutex);
+
+      unsigned seen = 0;
+      while(true) {
+	int count = 0;
+	while((region_generation == seen) && !shutdown_flag && (count < 1000))
+	  count++;
+	if((region_generation == seen) && !shutdown_flag) {
+	  pthread_mutex_lock(&mutex);
+	  while((region_generation == seen) && !shutdown_flag)
+	    pthread_cond_wait(&condvar, &mutex);
+	  pthread_mutex_unlock(&mutex);
+	}
+	// the master waits for every worker before starting another region,
+	//  so a new generation always means exactly one more region to run
+	if(region_generation == seen)
+	  break;
+	seen = region_generation;
+	__sync_synchronize();
+
+	run_member(index);
+
+	__sync_fetch_and_sub(&members_remaining, 1);
+      }
+    }
+
+    void TeamImpl::run_member(int index)
+    {
+      ThreadLocal::region_team = this;
+      ThreadLocal::region_index = index;
+      ThreadLocal::region_size = num_threads;
+
+      (*work_fn)(work_data);
+
+      ThreadLocal::region_team = 0;
+      ThreadLocal::region_index = 0;
+      ThreadLocal::region_size = 0;
+    }
+
+    void TeamImpl::barrier(void)
+    {
+      unsigned gen = barrier_generation;
+      __sync_synchronize();
+      if(__sync_add_and_fetch(&barrier_arrived, 1) == num_threads) {
+	barrier_arrived = 0;
+	__sync_fetch_and_add(&barrier_generation, 1);
+      } else {
+	int count = 0;
+	while(barrier_generation == gen)
+	  spin_wait(count);
+	__sync_synchronize();
+      }
+    }
+
+    void TeamImpl::shutdown(void)
+    {
+      pthread_mutex_lock(&mutex);
+      shutdown_flag = true;
+      pthread_cond_broadcast(&condvar);
+      pthread_mutex_unlock(&mutex);
+
+      for(std::vector<Thread *>::const_iterator it = worker_threads.begin();
+	  it != worker_threads.end();
+	  ++it)
+	(*it)->join();
+
+      worker_threads.clear();
+    }
+
+
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class Team
+    //
+
+    /*static*/ void Team::run(void (*fn)(void *data), void *data)
+    {
+      // nested regions (or concurrent ones from another task on the same
+      //  processor) run serially on the caller
+      TeamImpl *team = ThreadLocal::task_team;
+      if(team && (team->num_threads > 1) && (ThreadLocal::region_size == 0) &&
+	 team->try_run(fn, data))
+	return;
+
+      TeamImpl *old_team = ThreadLocal::region_team;
+      int old_index = ThreadLocal::region_index;
+      int old_size = ThreadLocal::region_size;
+      ThreadLocal::region_team = 0;
+      ThreadLocal::region_index = 0;
+      ThreadLocal::region_size = 1;
+
+      (*fn)(data);
+
+      ThreadLocal::region_team = old_team;
+      ThreadLocal::region_index = old_index;
+      ThreadLocal::region_size = old_size;
+    }
+
+    /*static*/ int Team::num_threads(void)
+    {
+      if(ThreadLocal::region_size > 0)
+	return ThreadLocal::region_size;
+      // outside of a region, report the size the next 'run' would use
+      if(ThreadLocal::task_team)
+	return ThreadLocal::task_team->num_threads;
+      return 1;
+    }
+
+    /*static*/ int Team::thread_index(void)
+    {
+      return ThreadLocal::region_index;
+    }
+
+    /*static*/ void Team::barrier(void)
+    {
+      if(ThreadLocal::region_team)
+	ThreadLocal::region_team->barrier();
+    }
+
+    /*static*/ void Team::partition(size_t lo, size_t hi,
+				    size_t& my_lo, size_t& my_hi)
+    {
+      if(hi <= lo) {
+	my_lo = my_hi = lo;
+	return;
+      }
+      size_t count = num_threads();
+      size_t index = thread_index();
+      size_t total = hi - lo;
+      size_t base = total / count;
+      size_t extra = total % count;
+      // the first 'extra' members get one additional element
+      my_lo = lo + (index * base) + ((index < extra) ? index : extra);
+      my_hi = my_lo + base + ((index < extra) ? 1 : 0);
+    }
+
+  }; // namespace ProcSet
+
+
    ////////////////////////////////////////////////////////////////////////
    //
    // class LocalProcessorSet
@@ -36,8 +297,15 @@ namespace Realm {
 		       size_t _stack_size, int _num_cores,
 		       bool _force_kthreads);
      virtual ~LocalProcessorSet(void);
+
+     virtual void shutdown(void);
+
    protected:
-     CoreReservation *core_rsrv;
+     virtual void execute_task(Processor::TaskFuncID func_id,
+			       const ByteArrayRef& task_args);
+
+     ProcSet::TeamImpl *team;
+     std::vector<CoreReservation *> core_rsrvs;
    };
 
 
@@ -47,34 +315,86 @@ namespace Realm {
      : LocalTaskProcessor(_me, Processor::PROC_SET, _num_cores)
 
    {
-     CoreReservationParameters params;
-     params.set_num_cores(_num_cores);
-     params.set_alu_usage(params.CORE_USAGE_EXCLUSIVE);
-     params.set_fpu_usage(params.CORE_USAGE_EXCLUSIVE);
-     params.set_ldst_usage(params.CORE_USAGE_SHARED);
-     params.set_max_stack_size(_stack_size);
+     team = new ProcSet::TeamImpl(_num_cores);
+
+     // tasks start on the master core
+     {
+       CoreReservationParameters params;
+       params.set_num_cores(1);
+       params.set_alu_usage(params.CORE_USAGE_EXCLUSIVE);
+       params.set_fpu_usage(params.CORE_USAGE_EXCLUSIVE);
+       params.set_ldst_usage(params.CORE_USAGE_SHARED);
+       params.set_max_stack_size(_stack_size);
 
-     std::string name = stringbuilder() << "proc set " << _me;
+       std::string name = stringbuilder() << "proc set " << _me << " (master)";
 
-     core_rsrv = new CoreReservation(name, crs, params);
+       CoreReservation *rsrv = new CoreReservation(name, crs, params);
+       core_rsrvs.push_back(rsrv);
 
  #ifdef REALM_USE_USER_THREADS
-     if(!_force_kthreads) {
-       UserThreadTaskScheduler *sched = new UserThreadTaskScheduler(me, *core_rsrv);
-       // no config settings we want to tweak yet
-       set_scheduler(sched);
-     } else 
+       if(!_force_kthreads) {
+	 UserThreadTaskScheduler *sched = new UserThreadTaskScheduler(me, *rsrv);
+	 // no config settings we want to tweak yet
+	 set_scheduler(sched);
+       } else 
  #endif
-     {
-       KernelThreadTaskScheduler *sched = new KernelThreadTaskScheduler(me, *core_rsrv);
-       sched->cfg_max_idle_workers = 3; // keep a few idle threads around
-       set_scheduler(sched);
+       {
+	 KernelThreadTaskScheduler *sched = new KernelThreadTaskScheduler(me, *rsrv);
+	 sched->cfg_max_idle_workers = 3; // keep a few idle threads around
+	 set_scheduler(sched);
+       }
+     }
+
+     // the rest of the team runs in kernel threads that never context switch
+     for(int i = 1; i < _num_cores; i++) {
+       CoreReservationParameters params;
+       params.set_num_cores(1);
+       params.set_alu_usage(params.CORE_USAGE_EXCLUSIVE);
+       params.set_fpu_usage(params.CORE_USAGE_EXCLUSIVE);
+       params.set_ldst_usage(params.CORE_USAGE_SHARED);
+       params.set_max_stack_size(_stack_size);
+
+       std::string name = stringbuilder() << "proc set " << _me << " (worker " << i << ")";
+
+       CoreReservation *rsrv = new CoreReservation(name, crs, params);
+       core_rsrvs.push_back(rsrv);
+
+       ThreadLaunchParameters tlp;
+       Thread *t = Thread::create_kernel_thread<ProcSet::TeamImpl,
+						&ProcSet::TeamImpl::worker_entry>(team,
+										  tlp,
+										  *rsrv);
+       team->worker_threads.push_back(t);
      }
    }
 
    LocalProcessorSet::~LocalProcessorSet(void)
    {
-     delete core_rsrv;
+     for(std::vector<CoreReservation *>::const_iterator it = core_rsrvs.begin();
+	 it != core_rsrvs.end();
+	 ++it)
+       delete *it;
+     core_rsrvs.clear();
+   }
+
+   void LocalProcessorSet::shutdown(void)
+   {
+     log_procset.info() << "shutting down";
+     team->shutdown();
+     delete team;
+
+     LocalTaskProcessor::shutdown();
+   }
+
+   void LocalProcessorSet::execute_task(Processor::TaskFuncID func_id,
+					const ByteArrayRef& task_args)
+   {
+     // make the team available to the task through ProcSet::Team - this is
+     //  left set afterwards because the only threads that run our tasks are
+     //  ones that belong to this processor
+     ProcSet::ThreadLocal::task_team = team;
+
+     LocalTaskProcessor::execute_task(func_id, task_args);
    }
 
 
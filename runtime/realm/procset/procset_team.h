@@ -0,0 +1,60 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// team-parallel execution for tasks running on PROC_SET processors
+
+#ifndef REALM_PROCSET_TEAM_H
+#define REALM_PROCSET_TEAM_H
+
+#include <stddef.h>
+
+namespace Realm {
+
+  namespace ProcSet {
+
+    // a PROC_SET processor owns a team of cores - its tasks start on the
+    //  team's master core and use 'run' to fan work out to every core in the
+    //  team, which share memory and can synchronize with 'barrier'
+    //
+    // all calls are safe from any thread - outside of a procset task (or
+    //  when 'run' is nested) the team is just the calling thread
+    //
+    // team members must not wait on Realm events inside a region
+    class Team {
+    public:
+      // runs 'fn(data)' on every member of the calling task's team (the
+      //  caller is member 0) and returns once all members have finished
+      static void run(void (*fn)(void *data), void *data);
+
+      // size of the current team and the caller's index within it
+      static int num_threads(void);
+      static int thread_index(void);
+
+      // waits until every member of the current team has arrived - must be
+      //  called by all members (or none) inside 'run'
+      static void barrier(void);
+
+      // splits [lo, hi) into num_threads() contiguous pieces whose sizes
+      //  differ by at most one and returns the caller's piece as
+      //  [my_lo, my_hi)
+      static void partition(size_t lo, size_t hi,
+			    size_t& my_lo, size_t& my_hi);
+    };
+
+  }; // namespace ProcSet
+
+}; // namespace Realm
+
+#endif
@@ -32,6 +32,24 @@ namespace Realm {
   };
   typedef ssize_t Py_ssize_t;
 
+  // Python 3.12+ sub-interpreter configuration and status
+  struct PyInterpreterConfig {
+    int use_main_obmalloc;
+    int allow_fork;
+    int allow_exec;
+    int allow_threads;
+    int allow_daemon_threads;
+    int check_multi_interp_extensions;
+    int gil;
+  };
+  static const int PyInterpreterConfig_OWN_GIL = 2;
+  struct PyStatus {
+    int _type;  // 0 == ok
+    const char *func;
+    const char *err_msg;
+    int exitcode;
+  };
+
   // This class contains interpreter-specific instances of Python API calls.
   class PythonAPI {
   public:
@@ -61,6 +79,13 @@ namespace Realm {
     void (*PyEval_RestoreThread)(PyThreadState *);
     PyThreadState *(*PyEval_SaveThread)(void);
 
+    PyThreadState *(*Py_NewInterpreter)(void);
+    void (*Py_EndInterpreter)(PyThreadState *);
+    // these are only present in newer versions (null otherwise)
+    PyStatus (*Py_NewInterpreterFromConfig)(PyThreadState **,
+					    const PyInterpreterConfig *);
+    PyInterpreterState *(*PyThreadState_GetInterpreter)(PyThreadState *);
+
     void (*PyErr_PrintEx)(int set_sys_last_vars);
 
     PyObject *(*PyImport_ImportModule)(const char *);
@@ -91,6 +116,19 @@ namespace Realm {
     void import_module(const std::string& module_name);
     void run_string(const std::string& script_text);
 
+    PyInterpreterState *get_interpreter_state(PyThreadState *pythread);
+
+    // processors that share a single copy of libpython (i.e. no dlmopen) each
+    //  get a sub-interpreter of one process-wide interpreter instead - with
+    //  Python 3.12+, each sub-interpreter has its own GIL
+    // creation returns the sub-interpreter's initial thread state, which is
+    //  current (and holds the GIL) on return, and 'interp' is set to the
+    //  shared interpreter whose api should be used
+    static PyThreadState *create_subinterpreter(PythonInterpreter *& interp);
+    // called with the sub-interpreter's initial thread state current - the
+    //  last one to be destroyed takes down the shared interpreter too
+    static void destroy_subinterpreter(PyThreadState *pythread);
+
   protected:
     void *handle;
 #ifdef REALM_USE_DLMOPEN
@@ -110,7 +148,8 @@ namespace Realm {
     LocalPythonProcessor(Processor _me, int _numa_node,
                          CoreReservationSet& crs, size_t _stack_size,
 			 const std::vector<std::string>& _import_modules,
-			 const std::vector<std::string>& _init_scripts);
+			 const std::vector<std::string>& _init_scripts,
+			 bool _use_subinterpreter);
     virtual ~LocalPythonProcessor(void);
 
     virtual void enqueue_task(Task *task);
@@ -148,6 +187,7 @@ namespace Realm {
     bool perform_task_registration(TaskRegistration *treg);
 
     int numa_node;
+    bool use_subinterpreter;
     CoreReservation *core_rsrv;
     const std::vector<std::string>& import_modules;
     const std::vector<std::string>& init_scripts;
@@ -23,6 +23,7 @@
 #include "realm/threads.h"
 #include "realm/runtime_impl.h"
 #include "realm/utils.h"
+#include "realm/activemsg.h"
 
 #include <dlfcn.h>
 #include <link.h>
@@ -55,6 +56,13 @@ namespace Realm {
     get_symbol(this->PyEval_RestoreThread, "PyEval_RestoreThread");
     get_symbol(this->PyEval_SaveThread, "PyEval_SaveThread");
 
+    get_symbol(this->Py_NewInterpreter, "Py_NewInterpreter");
+    get_symbol(this->Py_EndInterpreter, "Py_EndInterpreter");
+    get_symbol(this->Py_NewInterpreterFromConfig, "Py_NewInterpreterFromConfig",
+	       true /*missing_ok*/);
+    get_symbol(this->PyThreadState_GetInterpreter, "PyThreadState_GetInterpreter",
+	       true /*missing_ok*/);
+
     get_symbol(this->PyErr_PrintEx, "PyErr_PrintEx");
 
     get_symbol(this->PyImport_ImportModule, "PyImport_ImportModule");
@@ -265,6 +273,104 @@ namespace Realm {
     (api->Py_DecRef)(mainmod);
   }
 
+  PyInterpreterState *PythonInterpreter::get_interpreter_state(PyThreadState *pythread)
+  {
+    // the layout of PyThreadState changed in Python 3, but the accessor
+    //  only showed up in 3.9
+    if(api->PyThreadState_GetInterpreter)
+      return (api->PyThreadState_GetInterpreter)(pythread);
+    else
+      return pythread->interp;
+  }
+
+  namespace {
+    // the process-wide interpreter that sub-interpreters are created from
+    GASNetHSL shared_interpreter_mutex;
+    PythonInterpreter *shared_interpreter = 0;
+    PyThreadState *shared_main_thread = 0;
+    int shared_interpreter_users = 0;
+  };
+
+  /*static*/ PyThreadState *PythonInterpreter::create_subinterpreter(PythonInterpreter *& interp)
+  {
+    AutoHSLLock al(shared_interpreter_mutex);
+
+    if(!shared_interpreter) {
+      log_py.info() << "creating shared interpreter";
+      shared_interpreter = new PythonInterpreter;
+      // default state is GIL _released_
+      shared_main_thread = (shared_interpreter->api->PyEval_SaveThread)();
+    }
+    shared_interpreter_users++;
+    interp = shared_interpreter;
+
+    // new interpreters are created from the main interpreter's thread state
+    PythonAPI *api = shared_interpreter->api;
+    // the swap has to happen even if asserts are compiled out
+    PyThreadState *prev_thread = (api->PyThreadState_Swap)(0);
+    assert(prev_thread == 0);
+    (void)prev_thread;
+    (api->PyEval_RestoreThread)(shared_main_thread);
+
+    PyThreadState *pythread = 0;
+    if(api->Py_NewInterpreterFromConfig) {
+      // isolated enough to get a GIL of our own
+      PyInterpreterConfig config;
+      config.use_main_obmalloc = 0;
+      config.allow_fork = 0;
+      config.allow_exec = 0;
+      config.allow_threads = 1;
+      config.allow_daemon_threads = 0;
+      config.check_multi_interp_extensions = 1;
+      config.gil = PyInterpreterConfig_OWN_GIL;
+      PyStatus status = (api->Py_NewInterpreterFromConfig)(&pythread, &config);
+      if(status._type != 0) {
+	log_py.fatal() << "sub-interpreter creation failed: " << (status.err_msg ? status.err_msg : "(unknown)");
+	assert(false);
+      }
+    } else {
+      // older versions share the GIL between all sub-interpreters, so
+      //  tasks only overlap while one of them has released it
+      pythread = (api->Py_NewInterpreter)();
+      if(!pythread) {
+	log_py.fatal() << "sub-interpreter creation failed";
+	(api->PyErr_PrintEx)(0);
+	assert(false);
+      }
+    }
+    log_py.debug() << "created sub-interpreter: " << pythread;
+
+    // either way, the new thread state is current and holds its GIL
+    return pythread;
+  }
+
+  /*static*/ void PythonInterpreter::destroy_subinterpreter(PyThreadState *pythread)
+  {
+    AutoHSLLock al(shared_interpreter_mutex);
+
+    assert(shared_interpreter != 0);
+    PythonAPI *api = shared_interpreter->api;
+    log_py.debug() << "destroying sub-interpreter: " << pythread;
+    (api->Py_EndInterpreter)(pythread);
+    // 3.12+ (which is also when per-interpreter GILs arrived) releases the
+    //  GIL on the way out, but older versions leave it held with no current
+    //  thread state
+    if(!api->Py_NewInterpreterFromConfig) {
+      (api->PyThreadState_Swap)(shared_main_thread);
+      (api->PyEval_SaveThread)();
+    }
+
+    if(--shared_interpreter_users == 0) {
+      log_py.info() << "destroying shared interpreter";
+      (api->PyEval_RestoreThread)(shared_main_thread);
+      // c.f. LocalPythonProcessor::destroy_interpreter
+      (api->PyRun_SimpleString)("__import__('threading').current_thread()");
+      delete shared_interpreter;
+      shared_interpreter = 0;
+      shared_main_thread = 0;
+    }
+  }
+
   
   ////////////////////////////////////////////////////////////////////////
   //
@@ -296,7 +402,7 @@ namespace Realm {
     }
 
     // always create and remember our own python thread - does NOT require GIL
-    PyThreadState *pythread = (pyproc->interpreter->api->PyThreadState_New)(pyproc->master_thread->interp);
+    PyThreadState *pythread = (pyproc->interpreter->api->PyThreadState_New)(pyproc->interpreter->get_interpreter_state(pyproc->master_thread));
     log_py.debug() << "created python thread: " << pythread;
     
     assert(pythread != 0);
@@ -376,6 +482,13 @@ namespace Realm {
 	}
       }
 
+      // a duplicate entry for a boosted task that already ran (or is running)
+      //  just gets dropped
+      if(task && !task->claim_for_execution()) {
+	task->remove_reference();
+	continue;
+      }
+
       // did we find work to do?
       if(task) {
 	// one fewer unassigned worker
@@ -543,15 +656,18 @@ namespace Realm {
                                              CoreReservationSet& crs,
                                              size_t _stack_size,
 					     const std::vector<std::string>& _import_modules,
-					     const std::vector<std::string>& _init_scripts)
+					     const std::vector<std::string>& _init_scripts,
+					     bool _use_subinterpreter)
     : ProcessorImpl(_me, Processor::PY_PROC)
     , numa_node(_numa_node)
+    , use_subinterpreter(_use_subinterpreter)
     , import_modules(_import_modules)
     , init_scripts(_init_scripts)
     , interpreter(0)
     , ready_task_count(stringbuilder() << "realm/proc " << me << "/ready tasks")
   {
     task_queue.set_gauge(&ready_task_count);
+    task_queue.set_lockfree_put(Config::lockfree_task_queues);
 
     CoreReservationParameters params;
     params.set_num_cores(1);
@@ -587,9 +703,13 @@ namespace Realm {
   {
     assert(interpreter == 0);
   
-    // create a python interpreter that stays entirely within this thread
-    interpreter = new PythonInterpreter;
-    master_thread = (interpreter->api->PyThreadState_Get)();
+    if(use_subinterpreter) {
+      master_thread = PythonInterpreter::create_subinterpreter(interpreter);
+    } else {
+      // create a python interpreter that stays entirely within this thread
+      interpreter = new PythonInterpreter;
+      master_thread = (interpreter->api->PyThreadState_Get)();
+    }
 
     // always need the python threading module
     interpreter->import_module("threading");
@@ -629,7 +749,10 @@ namespace Realm {
     //  to deal with the case where 'import threading' never got called
     (interpreter->api->PyRun_SimpleString)("__import__('threading').current_thread()");
 
-    delete interpreter;
+    if(use_subinterpreter)
+      PythonInterpreter::destroy_subinterpreter(master_thread);
+    else
+      delete interpreter;
     interpreter = 0;
     master_thread = 0;
   }
@@ -816,6 +939,7 @@ namespace Realm {
       , cfg_num_python_cpus(0)
       , cfg_use_numa(false)
       , cfg_stack_size_in_mb(2)
+      , cfg_use_subinterpreters(false)
     {
     }
 
@@ -841,6 +965,7 @@ namespace Realm {
         cp.add_option_int("-ll:py", m->cfg_num_python_cpus)
 	  .add_option_int("-ll:pynuma", m->cfg_use_numa)
 	  .add_option_int("-ll:pystack", m->cfg_stack_size_in_mb)
+	  .add_option_bool("-ll:pysubinterp", m->cfg_use_subinterpreters)
 	  .add_option_stringlist("-ll:pyimport", m->cfg_import_modules)
 	  .add_option_stringlist("-ll:pyinit", m->cfg_init_scripts);
 
@@ -864,10 +989,11 @@ namespace Realm {
       }
 
 #ifndef REALM_USE_DLMOPEN
-      // Multiple CPUs are only allowed if we're using dlmopen.
-      if(m->cfg_num_python_cpus > 1) {
-        log_py.fatal() << "support for multiple Python CPUs is not available: recompile with USE_DLMOPEN";
-        assert(false);
+      // without dlmopen, there's only one copy of libpython, so multiple
+      //  CPUs have to use sub-interpreters of it
+      if((m->cfg_num_python_cpus > 1) && !m->cfg_use_subinterpreters) {
+        log_py.info() << "multiple Python CPUs without dlmopen - using sub-interpreters";
+        m->cfg_use_subinterpreters = true;
       }
 #endif
 
@@ -929,7 +1055,8 @@ namespace Realm {
                                                        runtime->core_reservation_set(),
                                                        cfg_stack_size_in_mb << 20,
 						       cfg_import_modules,
-						       cfg_init_scripts);
+						       cfg_init_scripts,
+						       cfg_use_subinterpreters);
           runtime->add_processor(pi);
 
           // create affinities between this processor and system/reg memories
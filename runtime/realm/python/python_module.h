@@ -68,6 +68,7 @@ namespace Realm {
       int cfg_num_python_cpus;
       bool cfg_use_numa;
       size_t cfg_stack_size_in_mb;
+      bool cfg_use_subinterpreters;
       std::vector<std::string> cfg_import_modules;
       std::vector<std::string> cfg_init_scripts;
 
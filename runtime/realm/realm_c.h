@@ -69,7 +69,8 @@ typedef enum realm_processor_kind_t {
   __op__(FILE_MEM, "file memory visible to all processors on a node") \
   __op__(LEVEL3_CACHE, "CPU L3 Visible to all processors on the node, better performance to processors on same socket") \
   __op__(LEVEL2_CACHE, "CPU L2 Visible to all processors on the node, better performance to one processor") \
-  __op__(LEVEL1_CACHE, "CPU L1 Visible to all processors on the node, better performance to one processor")
+  __op__(LEVEL1_CACHE, "CPU L1 Visible to all processors on the node, better performance to one processor") \
+  __op__(GPU_MANAGED_MEM, "Managed memory visible to all CPUs within a node and one or more GPUs, migrated on demand")
 
 typedef enum realm_memory_kind_t {
 #define C_ENUMS(name, desc) name,
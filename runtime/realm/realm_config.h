@@ -37,6 +37,11 @@
 //define REALM_USE_KERNEL_AIO
 #endif
 
+// if set (normally by the build system), uses Linux's io_uring interface for
+//  async file I/O, falling back to the interface above if the kernel doesn't
+//  support it
+//define REALM_USE_IO_URING
+
 // dynamic loading via dlfcn and a not-completely standard dladdr extension
 #ifdef USE_LIBDL
 #define REALM_USE_DLFCN
@@ -66,9 +71,130 @@ namespace Realm {
     //  specified limit
     extern int event_loop_detection_limit;
 
+    // if non-zero, event triggers and updates to the same remote node are
+    //  aggregated for up to this many microseconds before being sent
+    extern int event_batch_latency_us;
+    // maximum payload of a batch of event messages before it is sent
+    extern int event_batch_max_bytes;
+    // event updates going to at least this many remote subscribers are sent
+    //  down a tree with the given fanout (a threshold of 0 or a fanout below 2
+    //  disables the tree, which is the default)
+    extern int event_tree_threshold;
+    extern int event_tree_fanout;
+
+    // Event::wait and Event::external_wait spin for up to this many
+    //  nanoseconds before suspending/blocking - the actual limit is learned
+    //  from recent waits (0 disables spinning)
+    extern int event_wait_spin_ns;
+
+    // event update and batch messages carry up to event_hints_per_msg recent
+    //  (unpoisoned) triggers of other events owned by the sender, which the
+    //  receiver remembers in a cache of this many entries so that polling of
+    //  remote events can be answered locally (0 disables either)
+    extern int event_hint_cache_size;
+    extern int event_hints_per_msg;
+
+    // if non-zero, spawns of tasks on remote processors of the same node are
+    //  aggregated for up to this many microseconds (or until the batch
+    //  reaches spawn_batch_max_bytes) before being sent
+    extern int spawn_batch_latency_us;
+    extern int spawn_batch_max_bytes;
+
+    // if non-zero, untimestamped arrivals at remotely-owned barriers are
+    //  combined for up to this many microseconds and then sent up a tree of
+    //  the given fanout towards the owner (a fanout of 0 sends directly to
+    //  the owner)
+    extern int barrier_combine_latency_us;
+    extern int barrier_combine_fanout;
+
+    // at startup, node announcements are gathered up a tree of this fanout
+    //  rooted at node 0 and then broadcast back down it (a fanout below 2
+    //  sends every announcement directly to every other node)
+    extern int announce_tree_fanout;
+
+    // if non-zero, memcpy-channel copies of at least dma_parallel_copy_kb
+    //  are split across this many helper threads (plus the dma thread)
+    extern int dma_memcpy_threads;
+    extern int dma_parallel_copy_kb;
+    // serializing at least this many custom serdez elements is split the
+    //  same way (0 disables this)
+    extern int dma_parallel_serdez_elems;
+    // memcpy-channel copies of at least this many KB use non-temporal
+    //  (cache-bypassing) stores, on the assumption that a destination that
+    //  large won't be read again soon (0 disables this)
+    extern int dma_nontemporal_copy_kb;
+
+    // remote writes of at least this many KB into registered memory are done
+    //  as one-sided puts instead of active message payloads, and the target
+    //  is only told once the data has landed (0 disables puts)
+    extern int dma_rdma_put_kb;
+
+    // remote writes of at least this many KB from cpu-visible memories are
+    //  compressed (zero and repeated words) before they're sent, if that
+    //  makes them smaller and they fit in one message (0 disables this)
+    extern int dma_compress_kb;
+
+    // if true, the memcpy channel's bandwidth and latency estimates (used to
+    //  choose between copy paths) are measured at startup
+    extern bool dma_calibrate_paths;
+
+    // if non-zero, HDF5 reads from datasets stored without filters are split
+    //  on chunk boundaries and read straight from the file by this many
+    //  helper threads (plus the dma thread)
+    extern int hdf5_io_threads;
+    // if true (and HDF5 was built with parallel support), HDF5 files are
+    //  accessed through the MPI-IO driver with collective buffering
+    extern bool hdf5_use_mpio;
+
+    // if true (and io_uring is in use), local cpu-addressable memories are
+    //  registered with the kernel so that file I/O to/from them needn't pin
+    //  pages on every operation - requires a sufficient RLIMIT_MEMLOCK
+    extern bool aio_register_buffers;
+
+    // if true, copies to/from file instances memcpy through a shared mapping
+    //  of the file instead of issuing a read/write per fragment, with
+    //  madvise hints based on the copy's access pattern
+    extern bool file_mmap;
+
+    // intermediate buffers freed by copies are kept for reuse by later
+    //  copies, up to this many MB per memory on each node (0, the default,
+    //  disables this)
+    extern int ib_cache_mb;
+
+    // data read ahead of copies from file and HDF5 instances (see
+    //  RegionInstance::prefetch) is staged in up to this many MB on each
+    //  node (0, the default, disables prefetching)
+    extern int staging_cache_mb;
+
+    // the field groupings computed for a copy are remembered for up to this
+    //  many distinct sets of src/dst fields (0 disables this)
+    extern int copy_plan_cache_size;
+
     // if true, worker threads that might have used user-level thread switching
     //  fall back to kernel threading
     extern bool force_kernel_threads;
+
+    // if true, processor task queues accept new tasks via a lock-free list of
+    //  pending insertions rather than taking the queue lock on every enqueue
+    extern bool lockfree_task_queues;
+
+    // if true, idle local task processors may steal ready tasks from other
+    //  processors of the same kind on this node
+    extern bool task_stealing;
+
+    // how tasks launched on a processor group reach its members:
+    //  0 = members pull from a single shared queue
+    //  1 = each task is pushed to the least-loaded member (by queue depth and
+    //      time spent in running tasks)
+    extern int group_dispatch_mode;
+    // in load-aware mode, a task follows the member that ran its precondition
+    //  task unless that member's estimated wait exceeds the best by this much
+    extern int group_affinity_slack_us;
+
+    // if true, a task spawned with a positive priority that has to wait on
+    //  a precondition raises the priority of the local task or copy that
+    //  will trigger that precondition (and of what that is waiting on)
+    extern bool task_priority_inheritance;
   };
 };
 #endif
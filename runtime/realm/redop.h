@@ -34,9 +34,110 @@ namespace Realm {
       // both of these are optional
       static const RHS identity;
       static void fold(RHS& rhs1, RHS rhs2);
+
+      // also optional - kernels for contiguous arrays of elements, used in
+      //  place of per-element calls for bulk reductions (see
+      //  ReductionKernels below for vectorizable building blocks)
+      template <bool EXCL>
+      static void apply_bulk(LHS *lhs, const RHS *rhs, size_t count);
+      template <bool EXCL>
+      static void fold_bulk(RHS *rhs1, const RHS *rhs2, size_t count);
     };
 #endif
 
+    // simple loops over contiguous, non-overlapping arrays that compilers
+    //  turn into SIMD code for arithmetic types - these are only correct for
+    //  exclusive reductions (i.e. EXCL == true), so a REDOP's bulk kernels
+    //  should fall back to per-element atomic updates otherwise
+    namespace ReductionKernels {
+      template <typename T>
+      inline void sum(T * __restrict__ lhs, const T * __restrict__ rhs, size_t count)
+      {
+	for(size_t i = 0; i < count; i++)
+	  lhs[i] += rhs[i];
+      }
+
+      template <typename T>
+      inline void product(T * __restrict__ lhs, const T * __restrict__ rhs, size_t count)
+      {
+	for(size_t i = 0; i < count; i++)
+	  lhs[i] *= rhs[i];
+      }
+
+      template <typename T>
+      inline void min(T * __restrict__ lhs, const T * __restrict__ rhs, size_t count)
+      {
+	for(size_t i = 0; i < count; i++)
+	  lhs[i] = (rhs[i] < lhs[i]) ? rhs[i] : lhs[i];
+      }
+
+      template <typename T>
+      inline void max(T * __restrict__ lhs, const T * __restrict__ rhs, size_t count)
+      {
+	for(size_t i = 0; i < count; i++)
+	  lhs[i] = (rhs[i] > lhs[i]) ? rhs[i] : lhs[i];
+      }
+    };
+
+    // detects whether a REDOP supplies the optional bulk kernels
+    template <class REDOP>
+    struct ReductionOpHasBulkKernels {
+      typedef char yes;
+      typedef struct { char c[2]; } no;
+
+      template <typename U, void (*)(typename U::LHS *, const typename U::RHS *, size_t)>
+      struct ApplyCheck {};
+      template <typename U, void (*)(typename U::RHS *, const typename U::RHS *, size_t)>
+      struct FoldCheck {};
+
+      template <typename U> static yes test_apply(ApplyCheck<U, &U::template apply_bulk<true> > *);
+      template <typename U> static no test_apply(...);
+      template <typename U> static yes test_fold(FoldCheck<U, &U::template fold_bulk<true> > *);
+      template <typename U> static no test_fold(...);
+
+      static const bool has_apply = (sizeof(test_apply<REDOP>(0)) == sizeof(yes));
+      static const bool has_fold = (sizeof(test_fold<REDOP>(0)) == sizeof(yes));
+    };
+
+    // calls a REDOP's bulk kernels if it has them, or loops over elements
+    template <class REDOP, bool HAS_APPLY = ReductionOpHasBulkKernels<REDOP>::has_apply>
+    struct ReductionOpBulkApply {
+      template <bool EXCL>
+      static void apply(typename REDOP::LHS *lhs, const typename REDOP::RHS *rhs, size_t count)
+      {
+	for(size_t i = 0; i < count; i++)
+	  REDOP::template apply<EXCL>(lhs[i], rhs[i]);
+      }
+    };
+
+    template <class REDOP>
+    struct ReductionOpBulkApply<REDOP, true> {
+      template <bool EXCL>
+      static void apply(typename REDOP::LHS *lhs, const typename REDOP::RHS *rhs, size_t count)
+      {
+	REDOP::template apply_bulk<EXCL>(lhs, rhs, count);
+      }
+    };
+
+    template <class REDOP, bool HAS_FOLD = ReductionOpHasBulkKernels<REDOP>::has_fold>
+    struct ReductionOpBulkFold {
+      template <bool EXCL>
+      static void fold(typename REDOP::RHS *rhs1, const typename REDOP::RHS *rhs2, size_t count)
+      {
+	for(size_t i = 0; i < count; i++)
+	  REDOP::template fold<EXCL>(rhs1[i], rhs2[i]);
+      }
+    };
+
+    template <class REDOP>
+    struct ReductionOpBulkFold<REDOP, true> {
+      template <bool EXCL>
+      static void fold(typename REDOP::RHS *rhs1, const typename REDOP::RHS *rhs2, size_t count)
+      {
+	REDOP::template fold_bulk<EXCL>(rhs1, rhs2, count);
+      }
+    };
+
     class ReductionOpUntyped {
     public:
       size_t sizeof_lhs;
@@ -45,6 +146,13 @@ namespace Realm {
       bool has_identity;
       bool is_foldable;
 
+      // optional CUDA kernels (the host-side handles of __global__
+      //  functions) for reductions whose data lives in GPU memory - these
+      //  are filled in by add_cuda_redop_kernels in realm/cuda/cuda_redop.h
+      //  and are left null for reduction ops registered from host code
+      const void *cuda_apply_excl_fn, *cuda_apply_nonexcl_fn;
+      const void *cuda_fold_excl_fn, *cuda_fold_nonexcl_fn;
+
       template <class REDOP>
 	static ReductionOpUntyped *create_reduction_op(void);
 
@@ -76,7 +184,9 @@ namespace Realm {
 			 bool _has_identity, bool _is_foldable)
 	: sizeof_lhs(_sizeof_lhs), sizeof_rhs(_sizeof_rhs),
 	  sizeof_list_entry(_sizeof_list_entry),
-  	  has_identity(_has_identity), is_foldable(_is_foldable) {}
+  	  has_identity(_has_identity), is_foldable(_is_foldable),
+	  cuda_apply_excl_fn(0), cuda_apply_nonexcl_fn(0),
+	  cuda_fold_excl_fn(0), cuda_fold_nonexcl_fn(0) {}
     };
 
 #ifdef NEED_TO_FIX_REDUCTION_LISTS_FOR_DEPPART
@@ -106,19 +216,22 @@ namespace Realm {
       {
 	typename REDOP::LHS *lhs = static_cast<typename REDOP::LHS *>(lhs_ptr);
 	const typename REDOP::RHS *rhs = static_cast<const typename REDOP::RHS *>(rhs_ptr);
-	if(exclusive) {
-	  for(size_t i = 0; i < count; i++)
-	    REDOP::template apply<true>(lhs[i], rhs[i]);
-	} else {
-	  for(size_t i = 0; i < count; i++)
-	    REDOP::template apply<false>(lhs[i], rhs[i]);
-	}
+	if(exclusive)
+	  ReductionOpBulkApply<REDOP>::template apply<true>(lhs, rhs, count);
+	else
+	  ReductionOpBulkApply<REDOP>::template apply<false>(lhs, rhs, count);
       }
 
       virtual void apply_strided(void *lhs_ptr, const void *rhs_ptr,
 				 off_t lhs_stride, off_t rhs_stride, size_t count,
 				 bool exclusive = false) const
       {
+	// dense strides can use the (possibly bulk) contiguous path
+	if((lhs_stride == off_t(sizeof(typename REDOP::LHS))) &&
+	   (rhs_stride == off_t(sizeof(typename REDOP::RHS)))) {
+	  apply(lhs_ptr, rhs_ptr, count, exclusive);
+	  return;
+	}
 	if(exclusive) {
 	  for(size_t i = 0; i < count; i++) {
 	    REDOP::template apply<true>(*static_cast<typename REDOP::LHS *>(lhs_ptr),
@@ -141,19 +254,21 @@ namespace Realm {
       {
 	typename REDOP::RHS *rhs1 = static_cast<typename REDOP::RHS *>(rhs1_ptr);
 	const typename REDOP::RHS *rhs2 = static_cast<const typename REDOP::RHS *>(rhs2_ptr);
-	if(exclusive) {
-	  for(size_t i = 0; i < count; i++)
-	    REDOP::template fold<true>(rhs1[i], rhs2[i]);
-	} else {
-	  for(size_t i = 0; i < count; i++)
-	    REDOP::template fold<false>(rhs1[i], rhs2[i]);
-	}
+	if(exclusive)
+	  ReductionOpBulkFold<REDOP>::template fold<true>(rhs1, rhs2, count);
+	else
+	  ReductionOpBulkFold<REDOP>::template fold<false>(rhs1, rhs2, count);
       }
 
       virtual void fold_strided(void *lhs_ptr, const void *rhs_ptr,
 				off_t lhs_stride, off_t rhs_stride, size_t count,
 				bool exclusive = false) const
       {
+	if((lhs_stride == off_t(sizeof(typename REDOP::RHS))) &&
+	   (rhs_stride == off_t(sizeof(typename REDOP::RHS)))) {
+	  fold(lhs_ptr, rhs_ptr, count, exclusive);
+	  return;
+	}
 	if(exclusive) {
 	  for(size_t i = 0; i < count; i++) {
 	    REDOP::template fold<true>(*static_cast<typename REDOP::RHS *>(lhs_ptr),
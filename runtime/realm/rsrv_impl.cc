@@ -233,11 +233,18 @@ namespace Realm {
 	assert(impl->owner == my_node_id);
 	assert(impl->count == ReservationImpl::ZERO_COUNT);
 	assert(impl->mode == ReservationImpl::MODE_EXCL);
+	assert(impl->excl_waiters.empty());
 	assert(impl->local_waiters.size() == 0);
         assert(impl->remote_waiter_mask.empty());
 	assert(!impl->in_use);
 
 	impl->in_use = true;
+	// forget about whoever used the previous incarnation
+	for(int i = 0; i < ReservationImpl::ACCESS_HISTORY; i++)
+	  impl->access_history[i] = -1;
+	// a new reservation is idle and locally owned, so the fast path is fine
+	__sync_synchronize();
+	impl->fast_state = ReservationImpl::FAST_FREE;
 
 	log_reservation.info() << "reservation created: rsrv=" << impl->me;
 	return impl->me;
@@ -325,8 +332,16 @@ namespace Realm {
       log_reservation.spew("count init " IDFMT "=[%p]=%d", me.id, &count, count);
       mode = 0;
       in_use = false;
+      fast_state = FAST_DISABLED;
       remote_waiter_mask = NodeSet(); 
       remote_sharer_mask = NodeSet();
+      remote_revoked_mask = NodeSet();
+      lease = LEASE_NONE;
+      lease_revoked = false;
+      revoke_pending = false;
+      for(int i = 0; i < ACCESS_HISTORY; i++)
+	access_history[i] = -1;
+      access_history_pos = 0;
       requested = false;
       if(_data_size) {
 	local_data = malloc(_data_size);
@@ -339,6 +354,172 @@ namespace Realm {
       }
     }
 
+    void ReservationImpl::disable_fast_path(void)
+    {
+      while(true) {
+	int prev = fast_state;
+	if(prev == FAST_DISABLED) return;
+	if(__sync_bool_compare_and_swap(&fast_state, prev, FAST_DISABLED)) {
+	  assert(count == ZERO_COUNT);
+	  if(prev == FAST_HELD) {
+	    // somebody holds it exclusively via the fast path - account for them
+	    mode = MODE_EXCL;
+	    count = ZERO_COUNT + 1;
+	  }
+	  return;
+	}
+      }
+    }
+
+    // called from the fast path too, so no mutex - the history is only a
+    //  hint, so a lost update here and there doesn't matter
+    void ReservationImpl::record_access(NodeID node)
+    {
+      unsigned pos = __atomic_fetch_add(&access_history_pos, 1, __ATOMIC_RELAXED);
+      __atomic_store_n(&access_history[pos % ACCESS_HISTORY], node,
+		       __ATOMIC_RELAXED);
+    }
+
+    bool ReservationImpl::should_migrate(NodeID node) const
+    {
+      int hits = 0;
+      for(int i = 0; i < ACCESS_HISTORY; i++)
+	if(__atomic_load_n(&access_history[i], __ATOMIC_RELAXED) == node)
+	  hits++;
+      return (hits >= MIGRATE_THRESHOLD);
+    }
+
+    void ReservationImpl::collect_revokes(NodeSet& to_revoke)
+    {
+      // exclusive leases come back on their own
+      if(mode == MODE_EXCL) return;
+
+      for(NodeSet::const_iterator it = remote_sharer_mask.begin();
+	  it != remote_sharer_mask.end();
+	  it++)
+	if(!remote_revoked_mask.contains(*it)) {
+	  remote_revoked_mask.add(*it);
+	  to_revoke.add(*it);
+	}
+    }
+
+    void ReservationImpl::prepare_grant(NodeID target, unsigned req_mode,
+					bool allow_migrate,
+					PendingGrant& grant)
+    {
+      grant.target = target;
+      for(int i = 0; i < ACCESS_HISTORY; i++)
+	grant.history[i] = __atomic_load_n(&access_history[i], __ATOMIC_RELAXED);
+
+      if(allow_migrate && should_migrate(target)) {
+	// the requester is the main user of this reservation, so ownership
+	//  (and the list of other remote waiters) moves there
+	log_reservation.debug() << "migrating reservation: rsrv=" << me
+				<< " new_owner=" << target;
+	grant.mode = MODE_EXCL;
+	grant.lease = LEASE_NONE;
+	grant.waiters = remote_waiter_mask;
+	owner = target;
+	remote_waiter_mask.clear();
+      } else {
+	// stay the owner and lease it out instead
+	grant.mode = req_mode;
+	grant.lease = ((req_mode == MODE_EXCL) ? LEASE_EXCL : LEASE_SHARED);
+	grant.waiters.clear();
+	mode = req_mode;
+	remote_sharer_mask.add(target);
+      }
+    }
+
+    void ReservationImpl::choose_next_holder(WaiterList& to_wake,
+					     PendingGrant& grant)
+    {
+      assert(owner == my_node_id);
+      assert(count == ZERO_COUNT);
+      assert(remote_sharer_mask.empty());
+
+      // local waiters (or a retry list) come first
+      if(select_local_waiters(to_wake)) {
+	assert(!to_wake.empty());
+	record_access(my_node_id);
+	return;
+      }
+
+      // we can grant to a remote waiter (if any) if we don't expect any local retries
+      if(!remote_waiter_mask.empty() && retry_count.empty()) {
+	// TODO: use iterator - all we need is *begin()
+	NodeID next = 0;  while(!remote_waiter_mask.contains(next)) next++;
+	remote_waiter_mask.remove(next);
+
+	// we don't know what mode the waiter wanted, so it gets exclusive access
+	prepare_grant(next, MODE_EXCL, true /*allow_migrate*/, grant);
+	return;
+      }
+
+      // nobody wants it?  just sits in available state
+      assert(excl_waiters.empty());
+      assert(local_waiters.empty());
+      assert(retry_events.empty());
+
+      // if no retries are expected, the fast path can take over again
+      if(remote_waiter_mask.empty() && retry_count.empty()) {
+	__sync_synchronize();
+	fast_state = FAST_FREE;
+      }
+    }
+
+    void ReservationImpl::send_grant(const PendingGrant& grant)
+    {
+      if(grant.target == -1) return;
+
+      // Make a buffer for storing the access history, our waiter mask and
+      //  the local data
+      size_t waiter_count = grant.waiters.size();
+      size_t payload_size = ((ACCESS_HISTORY + waiter_count + 1) * sizeof(int) +
+			     local_data_size);
+      int *payload = (int*)malloc(payload_size);
+      int *pos = payload;
+      for(int i = 0; i < ACCESS_HISTORY; i++)
+	*pos++ = grant.history[i];
+      *pos++ = waiter_count;
+      // TODO: switch to iterator
+      PackFunctor functor(pos);
+      grant.waiters.map(functor);
+      pos = functor.pos;
+      memcpy(pos, local_data, local_data_size);
+      LockGrantMessage::send_request(grant.target, me, grant.mode,
+				     ((grant.lease == LEASE_NONE) ?
+				        grant.target : my_node_id),
+				     grant.lease,
+				     payload, payload_size, PAYLOAD_FREE);
+#ifdef LOCK_TRACING
+      {
+	LockTraceItem &item = Tracer<LockTraceItem>::trace_item();
+	item.lock_id = me.id;
+	item.owner = grant.target;
+	item.action = LockTraceItem::ACT_REMOTE_GRANT;
+      }
+#endif
+    }
+
+    // helper for NodeSet::map
+    struct RevokeFunctor {
+    public:
+      RevokeFunctor(Reservation _lock) : lock(_lock) {}
+      void apply(int target) { LockRevokeMessage::send_request(target, lock); }
+    public:
+      Reservation lock;
+    };
+
+    void ReservationImpl::send_revokes(const NodeSet& targets)
+    {
+      if(targets.empty()) return;
+
+      log_reservation.debug() << "revoking shared leases: rsrv=" << me;
+      RevokeFunctor functor(me);
+      targets.map(functor);
+    }
+
     /*static*/ void LockRequestMessage::send_request(NodeID target,
 						     NodeID req_node,
 						     Reservation lock,
@@ -363,12 +544,15 @@ namespace Realm {
       // can't send messages while holding mutex, so remember args and who
       //  (if anyone) to send to
       int req_forward_target = -1;
-      int grant_target = -1;
-      NodeSet copy_waiters;
+      ReservationImpl::PendingGrant grant;
+      grant.target = -1;
+      NodeSet to_revoke;
 
       do {
 	AutoHSLLock a(impl->mutex);
 
+	impl->disable_fast_path();
+
 	// case 1: we don't even own the lock any more - pass the request on
 	//  to whoever we think the owner is
 	if(impl->owner != my_node_id) {
@@ -384,27 +568,42 @@ namespace Realm {
 	assert((ID(impl->me).rsrv.creator_node != my_node_id) ||
 	       impl->in_use);
 
-	// case 2: we're the owner, and nobody is holding the lock, so grant
-	//  it to the (original) requestor
+	impl->record_access(args.node);
+
+	// case 2: we're the owner, and nobody is holding the lock, so either
+	//  migrate it to the (original) requestor or lease it to them
 	if((impl->count == ReservationImpl::ZERO_COUNT) && 
            (impl->remote_sharer_mask.empty())) {
-          assert(impl->remote_waiter_mask.empty());
-
 	  log_reservation.debug("granting reservation request: reservation=" IDFMT ", node=%d, mode=%d",
 				args.lock.id, args.node, args.mode);
-	  grant_target = args.node;
-          copy_waiters = impl->remote_waiter_mask;
+	  impl->prepare_grant(args.node, args.mode, true /*allow_migrate*/,
+			      grant);
+	  break;
+	}
 
-	  impl->owner = args.node;
+	// case 3: a shared request that is compatible with the current
+	//  holders can get a shared lease right away if nobody is waiting
+	if((args.mode != ReservationImpl::MODE_EXCL) &&
+	   (impl->mode == args.mode) &&
+	   !impl->remote_sharer_mask.contains(args.node) &&
+	   impl->remote_revoked_mask.empty() &&
+	   impl->remote_waiter_mask.empty() &&
+	   impl->excl_waiters.empty() &&
+	   impl->local_waiters.empty()) {
+	  log_reservation.debug("sharing reservation: reservation=" IDFMT ", node=%d, mode=%d",
+				args.lock.id, args.node, args.mode);
+	  impl->prepare_grant(args.node, args.mode, false /*!allow_migrate*/,
+			      grant);
 	  break;
 	}
 
-	// case 3: we're the owner, but we can't grant the lock right now -
-	//  just set a bit saying that the node is waiting and get back to
-	//  work
+	// case 4: we're the owner, but we can't grant the lock right now -
+	//  set a bit saying that the node is waiting and ask any shared lease
+	//  holders to give their leases back
 	log_reservation.debug("deferring reservation request: reservation=" IDFMT ", node=%d, mode=%d (count=%d cmode=%d)",
 			      args.lock.id, args.node, args.mode, impl->count, impl->mode);
         impl->remote_waiter_mask.add(args.node);
+	impl->collect_revokes(to_revoke);
       } while(0);
 
       if(req_forward_target != -1)
@@ -421,54 +620,113 @@ namespace Realm {
 #endif
       }
 
-      if(grant_target != -1)
-      {
-        // Make a buffer for storing our waiter mask and the the local data
-	size_t waiter_count = copy_waiters.size();
-        size_t payload_size = ((waiter_count+1) * sizeof(int)) + impl->local_data_size;
-        int *payload = (int*)malloc(payload_size);
-	int *pos = payload;
-	*pos++ = waiter_count;
-	// TODO: switch to iterator
-        ReservationImpl::PackFunctor functor(pos);
-        copy_waiters.map(functor);
-        pos = functor.pos;
-	//for(int i = 0; i < MAX_NUM_NODES; i++)
-	//  if(copy_waiters.contains(i))
-	//    *pos++ = i;
-        memcpy(pos, impl->local_data, impl->local_data_size);
-	LockGrantMessage::send_request(grant_target, args.lock,
-				       0, // always grant exclusive for now
-				       payload, payload_size, PAYLOAD_FREE);
-#ifdef LOCK_TRACING
-        {
-          LockTraceItem &item = Tracer<LockTraceItem>::trace_item();
-          item.lock_id = impl->me.id;
-          item.owner = grant_target;
-          item.action = LockTraceItem::ACT_REMOTE_GRANT;
-        }
-#endif
-      }
+      impl->send_grant(grant);
+      impl->send_revokes(to_revoke);
     }
 
     /*static*/ void LockReleaseMessage::send_request(NodeID target,
-						     Reservation lock)
+						     Reservation lock,
+						     const void *data,
+						     size_t datalen)
     {
       RequestArgs args;
 
       args.node = my_node_id;
+      args.lock = lock;
+      Message::request(target, args, data, datalen, PAYLOAD_COPY);
+    }
+
+    /*static*/ void LockReleaseMessage::handle_request(RequestArgs args,
+						       const void *data,
+						       size_t datalen)
+    {
+      DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
+      ReservationImpl *impl = get_runtime()->get_lock_impl(args.lock);
+
+      log_reservation.debug("reservation lease returned: reservation=" IDFMT ", node=%d",
+			    args.lock.id, args.node);
+
+      ReservationImpl::WaiterList to_wake;
+      ReservationImpl::PendingGrant grant;
+      grant.target = -1;
+
+      {
+	AutoHSLLock a(impl->mutex);
+
+	impl->disable_fast_path();
+
+	// ownership never moves while leases are outstanding
+	assert(impl->owner == my_node_id);
+	assert(impl->remote_sharer_mask.contains(args.node));
+	impl->remote_sharer_mask.remove(args.node);
+	impl->remote_revoked_mask.remove(args.node);
+
+	// an exclusive lease brings back the (possibly modified) data
+	if(datalen > 0) {
+	  assert(datalen == impl->local_data_size);
+	  memcpy(impl->local_data, data, datalen);
+	}
+
+	if(impl->remote_sharer_mask.empty() &&
+	   (impl->count == ReservationImpl::ZERO_COUNT))
+	  impl->choose_next_holder(to_wake, grant);
+      }
+
+      impl->send_grant(grant);
+
+      for(ReservationImpl::WaiterList::iterator it = to_wake.begin();
+	  it != to_wake.end();
+	  it++) {
+	log_reservation.debug() << "release trigger: reservation=" << args.lock << " event=" << (*it);
+	GenEventImpl::trigger(*it, false /*!poisoned*/);
+      }
+    }
+
+    /*static*/ void LockRevokeMessage::send_request(NodeID target,
+						    Reservation lock)
+    {
+      RequestArgs args;
+
       args.lock = lock;
       Message::request(target, args);
     }
 
-    /*static*/ void LockReleaseMessage::handle_request(RequestArgs args)
+    /*static*/ void LockRevokeMessage::handle_request(RequestArgs args)
     {
       DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
-      assert(0);
+      ReservationImpl *impl = get_runtime()->get_lock_impl(args.lock);
+
+      int release_target = -1;
+      {
+	AutoHSLLock a(impl->mutex);
+
+	if(impl->lease != ReservationImpl::LEASE_SHARED) {
+	  // either the lease is already on its way back, or we haven't seen
+	  //  its grant yet - in the latter case, our request is still
+	  //  outstanding and the grant will apply the revoke
+	  if(impl->requested && (impl->owner != my_node_id))
+	    impl->revoke_pending = true;
+	  return;
+	}
+
+	impl->lease_revoked = true;
+
+	// give it back now if nobody is using it, otherwise the last local
+	//  release will do it
+	if(impl->count == ReservationImpl::ZERO_COUNT) {
+	  release_target = impl->owner;
+	  impl->lease = ReservationImpl::LEASE_NONE;
+	  impl->mode = 0;
+	}
+      }
+
+      if(release_target != -1)
+	LockReleaseMessage::send_request(release_target, args.lock, 0, 0);
     }
 
     /*static*/ void LockGrantMessage::send_request(NodeID target,
 						   Reservation lock, unsigned mode,
+						   NodeID owner, unsigned lease,
 						   const void *data, size_t datalen,
 						   int payload_mode)
     {
@@ -476,6 +734,8 @@ namespace Realm {
 
       args.lock = lock;
       args.mode = mode;
+      args.owner = owner;
+      args.lease = lease;
       Message::request(target, args, data, datalen, payload_mode);
     }
 
@@ -483,10 +743,13 @@ namespace Realm {
 						     const void *data, size_t datalen)
     {
       DetailedTimer::ScopedPush sp(TIME_LOW_LEVEL);
-      log_reservation.debug(          "reservation request granted: reservation=" IDFMT " mode=%d", // mask=%lx",
-	       args.lock.id, args.mode); //, args.remote_waiter_mask);
+      log_reservation.debug(          "reservation request granted: reservation=" IDFMT " mode=%d lease=%d",
+	       args.lock.id, args.mode, args.lease);
 
       ReservationImpl::WaiterList to_wake;
+      int lock_request_target = -1;
+      unsigned request_mode = 0;
+      int release_target = -1;
 
       ReservationImpl *impl = get_runtime()->get_lock_impl(args.lock);
       {
@@ -495,32 +758,96 @@ namespace Realm {
 	// make sure we were really waiting for this lock
 	assert(impl->owner != my_node_id);
 	assert(impl->requested);
+	impl->requested = false;
 
-	// first, update our copy of the protected data (if any)
 	const int *pos = (const int *)data;
+	NodeID history[ReservationImpl::ACCESS_HISTORY];
+	for(int i = 0; i < ReservationImpl::ACCESS_HISTORY; i++)
+	  history[i] = *pos++;
 
 	size_t waiter_count = *pos++;
-	assert(datalen == (((waiter_count+1) * sizeof(int)) + impl->local_data_size));
-	impl->remote_waiter_mask.clear();
-	for(size_t i = 0; i < waiter_count; i++)
-	  impl->remote_waiter_mask.add(*pos++);
+	assert(datalen == (((ReservationImpl::ACCESS_HISTORY + waiter_count + 1) *
+			    sizeof(int)) + impl->local_data_size));
 
 	// is there local data to grab?
 	if(impl->local_data_size > 0)
-          memcpy(impl->local_data, pos, impl->local_data_size);
+          memcpy(impl->local_data, pos + waiter_count, impl->local_data_size);
 
-	if(args.mode == 0) // take ownership if given exclusive access
-	  impl->owner = my_node_id;
 	impl->mode = args.mode;
-	impl->requested = false;
 
+	if(args.lease == ReservationImpl::LEASE_NONE) {
+	  // take ownership, along with the remote waiters and access history
+	  impl->owner = my_node_id;
+	  impl->lease = ReservationImpl::LEASE_NONE;
+	  impl->remote_waiter_mask.clear();
+	  for(size_t i = 0; i < waiter_count; i++)
+	    impl->remote_waiter_mask.add(pos[i]);
+	  for(int i = 0; i < ReservationImpl::ACCESS_HISTORY; i++)
+	    impl->access_history[i] = history[i];
+	  impl->record_access(my_node_id);
+	} else {
+	  assert(waiter_count == 0);
+	  impl->owner = args.owner;
+	  impl->lease = args.lease;
+	  // only a shared lease is ever revoked
+	  impl->lease_revoked = (impl->revoke_pending &&
+				 (args.lease == ReservationImpl::LEASE_SHARED));
+	}
+	impl->revoke_pending = false;
+
+	if(args.lease != ReservationImpl::LEASE_SHARED) {
 #ifndef NDEBUG
-	bool any_local =
+	  bool any_local =
 #endif
-	  impl->select_local_waiters(to_wake);
-	assert(any_local);
+	    impl->select_local_waiters(to_wake);
+	  assert(any_local);
+	} else {
+	  // a shared lease only covers waiters (and retries) for its mode
+	  std::map<unsigned, ReservationImpl::WaiterList>::iterator it = impl->local_waiters.find(args.mode);
+	  if(it != impl->local_waiters.end()) {
+	    impl->count += it->second.size();
+	    to_wake.swap(it->second);
+	    impl->local_waiters.erase(it);
+	  }
+	  std::map<unsigned, Event>::iterator it2 = impl->retry_events.find(args.mode);
+	  if(it2 != impl->retry_events.end()) {
+	    to_wake.push_back(it2->second);
+	    impl->retry_events.erase(it2);
+	  }
+
+	  // if the lease was revoked before it got here and nobody is using
+	  //  it, give it straight back
+	  if(impl->lease_revoked &&
+	     (impl->count == ReservationImpl::ZERO_COUNT)) {
+	    release_target = impl->owner;
+	    impl->lease = ReservationImpl::LEASE_NONE;
+	    impl->mode = 0;
+	  }
+
+	  // anybody else has to ask again
+	  if(!impl->excl_waiters.empty()) {
+	    request_mode = ReservationImpl::MODE_EXCL;
+	    lock_request_target = impl->owner;
+	  } else if(!impl->local_waiters.empty()) {
+	    request_mode = impl->local_waiters.begin()->first;
+	    lock_request_target = impl->owner;
+	  } else if(!impl->retry_events.empty()) {
+	    request_mode = impl->retry_events.begin()->first;
+	    lock_request_target = impl->owner;
+	  }
+	  if(lock_request_target != -1)
+	    impl->requested = true;
+	}
       }
 
+      // a returned lease has to be sent before the new request
+      if(release_target != -1)
+	LockReleaseMessage::send_request(release_target, args.lock, 0, 0);
+
+      if(lock_request_target != -1)
+	LockRequestMessage::send_request(lock_request_target, my_node_id,
+					 args.lock, request_mode);
+
       for(ReservationImpl::WaiterList::iterator it = to_wake.begin();
 	  it != to_wake.end();
 	  it++) {
@@ -542,9 +869,23 @@ namespace Realm {
       // collapse exclusivity into mode
       if(exclusive) new_mode = MODE_EXCL;
 
+      // fast path: an idle, locally-owned reservation can be taken exclusively
+      //  without the mutex (placeholders and retries need to update counts)
+      if((new_mode == MODE_EXCL) &&
+	 ((acquire_type == ACQUIRE_BLOCKING) || (acquire_type == ACQUIRE_NONBLOCKING)) &&
+	 (fast_state == FAST_FREE) &&
+	 __sync_bool_compare_and_swap(&fast_state, FAST_FREE, FAST_HELD)) {
+	record_access(my_node_id);
+	if(after_lock.exists())
+	  GenEventImpl::trigger(after_lock, false /*!poisoned*/);
+	return after_lock;
+      }
+
       bool got_lock = false;
       int lock_request_target = -1;
+      int release_target = -1;
       WaiterList bonus_grants;
+      NodeSet to_revoke;
 
       {
 	AutoHSLLock a(mutex); // hold mutex on lock while we check things
@@ -554,6 +895,8 @@ namespace Realm {
 	assert((ID(me).rsrv.creator_node != my_node_id) ||
 	       in_use);
 
+	disable_fast_path();
+
 	// if this is just a placeholder nonblocking acquire, update the retry_count and
 	//  return immediately
 	if(acquire_type == ACQUIRE_NONBLOCKING_PLACEHOLDER) {
@@ -571,13 +914,17 @@ namespace Realm {
           }
 #endif
 	  // case 1: we own the lock
-	  // can we grant it?  (don't if there is a higher priority waiter)
-	  if((count == ZERO_COUNT) ||
+	  // can we grant it?  (don't if there is a higher priority waiter or
+	  //  remote leases are being revoked)
+	  if(((count == ZERO_COUNT) && remote_sharer_mask.empty()) ||
 	     ((mode == new_mode) &&
 	      (mode != MODE_EXCL) &&
+	      excl_waiters.empty() &&
+	      remote_revoked_mask.empty() &&
 	      (local_waiters.empty() || (local_waiters.begin()->first > mode)))) {
 	    mode = new_mode;
 	    count++;
+	    record_access(my_node_id);
 	    log_reservation.spew("count ++(1) [%p]=%d", &count, count);
 	    got_lock = true;
 	    // fun special case here - if we grant a shared mode and there were local waiters and/or
@@ -604,19 +951,30 @@ namespace Realm {
               item.action = LockTraceItem::ACT_LOCAL_GRANT;
             }
 #endif
+	  } else {
+	    // remote shared leases are in the way - ask for them back
+	    collect_revokes(to_revoke);
 	  }
 	} else {
 	  // somebody else owns it
 	
-	  // are we sharing?
-	  if((count > ZERO_COUNT) && (mode == new_mode)) {
-	    // we're allowed to grant additional sharers with the same mode
+	  // are we sharing?  a shared lease that hasn't been revoked lets us
+	  //  grant additional sharers with the same mode (even after our last
+	  //  local release)
+	  if((lease == LEASE_SHARED) && !lease_revoked &&
+	     (mode == new_mode) && excl_waiters.empty()) {
 	    assert(mode != MODE_EXCL);
-	    if(mode == new_mode) {
-	      count++;
-	      log_reservation.spew("count ++(2) [%p]=%d", &count, count);
-	      got_lock = true;
-	    }
+	    count++;
+	    log_reservation.spew("count ++(2) [%p]=%d", &count, count);
+	    got_lock = true;
+	  }
+
+	  // an idle shared lease in the wrong mode is of no use to us - give
+	  //  it back so the owner doesn't have to revoke it
+	  if(!got_lock && (lease == LEASE_SHARED) && (count == ZERO_COUNT)) {
+	    release_target = owner;
+	    lease = LEASE_NONE;
+	    mode = 0;
 	  }
 	
 	  // if we didn't get the lock, we'll have to ask for it from the
@@ -655,7 +1013,10 @@ namespace Realm {
 	    {
 	      if(!after_lock.exists())
 		after_lock = GenEventImpl::create_genevent()->current_event();
-	      local_waiters[new_mode].push_back(after_lock);
+	      if(new_mode == MODE_EXCL)
+		excl_waiters.push_back(after_lock);
+	      else
+		local_waiters[new_mode].push_back(after_lock);
 	      break;
 	    }
 
@@ -703,6 +1064,12 @@ namespace Realm {
 	}
       }
 
+      // a returned lease has to be sent before the new request
+      if(release_target != -1)
+	LockReleaseMessage::send_request(release_target, me, 0, 0);
+
+      send_revokes(to_revoke);
+
       if(lock_request_target != -1)
       {
 	LockRequestMessage::send_request(lock_request_target, my_node_id,
@@ -741,19 +1108,15 @@ namespace Realm {
     //  priority than any blocking waiter
     bool ReservationImpl::select_local_waiters(WaiterList& to_wake)
     {
-      if(local_waiters.empty() && retry_events.empty())
+      if(excl_waiters.empty() && local_waiters.empty() && retry_events.empty())
 	return false;
 
-      // further favor exclusive waiters
-      if(local_waiters.find(MODE_EXCL) != local_waiters.end()) {
-	WaiterList& excl_waiters = local_waiters[MODE_EXCL];
+      // further favor exclusive waiters - the lock is handed directly to the
+      //  one at the front of the queue
+      if(!excl_waiters.empty()) {
 	to_wake.push_back(excl_waiters.front());
 	excl_waiters.pop_front();
-	  
-	// if the set of exclusive waiters is empty, delete it
-	if(excl_waiters.size() == 0)
-	  local_waiters.erase(MODE_EXCL);
-	  
+
 	mode = MODE_EXCL;
 	count = ZERO_COUNT + 1;
 	log_reservation.spew("count <-1 [%p]=%d", &count, count);
@@ -792,13 +1155,21 @@ namespace Realm {
 
     void ReservationImpl::release(void)
     {
+      // fast path: nobody else showed up while we held it via the fast path
+      if((fast_state == FAST_HELD) &&
+	 __sync_bool_compare_and_swap(&fast_state, FAST_HELD, FAST_FREE))
+	return;
+
       // make a list of events that we be woken - can't do it while holding the
       //  lock's mutex (because the event we trigger might try to take the lock)
       WaiterList to_wake;
 
       int release_target = -1;
-      int grant_target = -1;
-      NodeSet copy_waiters;
+      bool release_data = false;
+      int lock_request_target = -1;
+      unsigned request_mode = 0;
+      PendingGrant grant;
+      grant.target = -1;
 
       do {
 #ifdef RSRV_DEBUG_MSGS
@@ -807,6 +1178,8 @@ namespace Realm {
 #endif
 	AutoHSLLock a(mutex); // hold mutex on lock for entire function
 
+	disable_fast_path();
+
 	assert(count > ZERO_COUNT);
 
 	// if this isn't the last holder of the lock, just decrement count
@@ -819,55 +1192,58 @@ namespace Realm {
 #endif
 	if(count > ZERO_COUNT) break;
 
-	// case 1: if we were sharing somebody else's lock, tell them we're
-	//  done
+	// case 1: if we were holding a lease on somebody else's lock, keep a
+	//  shared lease around for the next shared acquire unless the owner
+	//  wants it back (or we have waiters that need a different mode),
+	//  otherwise tell the owner we're done
 	if(owner != my_node_id) {
-	  assert(mode != MODE_EXCL);
-	  mode = 0;
+	  if((lease == LEASE_SHARED) && !lease_revoked &&
+	     excl_waiters.empty() && local_waiters.empty())
+	    break;
 
 	  release_target = owner;
-	  break;
-	}
+	  release_data = (lease == LEASE_EXCL);
+	  lease = LEASE_NONE;
+	  mode = 0;
 
-	// case 2: we own the lock, so we can give it to a local waiter (or a retry list)
-	bool any_local = select_local_waiters(to_wake);
-	if(any_local) {
-	  // we'll wake the blocking waiter(s) below
-	  assert(!to_wake.empty());
+	  // anybody still waiting locally has to ask again
+	  if(!requested) {
+	    if(!excl_waiters.empty()) {
+	      request_mode = MODE_EXCL;
+	      lock_request_target = owner;
+	    } else if(!local_waiters.empty()) {
+	      request_mode = local_waiters.begin()->first;
+	      lock_request_target = owner;
+	    } else if(!retry_events.empty()) {
+	      request_mode = retry_events.begin()->first;
+	      lock_request_target = owner;
+	    }
+	    if(lock_request_target != -1)
+	      requested = true;
+	  }
 	  break;
 	}
 
-	// case 3: we can grant to a remote waiter (if any) if we don't expect any local retries
-	if(!remote_waiter_mask.empty() && retry_count.empty()) {
-	  // nobody local wants it, but another node does
-	  //HACK int new_owner = remote_waiter_mask.find_first_set();
-	  // TODO: use iterator - all we need is *begin()
-          int new_owner = 0;  while(!remote_waiter_mask.contains(new_owner)) new_owner++;
-          remote_waiter_mask.remove(new_owner);
-
-#ifdef RSRV_DEBUG_MSGS
-	  log_reservation.debug(              "reservation going to remote waiter: new=%d", // mask=%lx",
-		   new_owner); //, remote_waiter_mask);
-#endif
+	// case 2: we own the lock, but other nodes still hold shared leases -
+	//  the last one to come back picks the next holder
+	if(!remote_sharer_mask.empty()) break;
 
-	  grant_target = new_owner;
-          copy_waiters = remote_waiter_mask;
-
-	  owner = new_owner;
-          remote_waiter_mask = NodeSet();
-	}
-
-	// nobody wants it?  just sits in available state
-	assert(local_waiters.empty());
-	assert(retry_events.empty());
-	assert(remote_waiter_mask.empty());
+	// case 3: we own the lock, so we can give it to a local waiter (or a
+	//  retry list), a remote waiter, or just let it sit idle
+	choose_next_holder(to_wake, grant);
       } while(0);
 
       if(release_target != -1)
       {
 	log_reservation.debug("releasing reservation " IDFMT " back to owner %d",
 			      me.id, release_target);
-	LockReleaseMessage::send_request(release_target, me);
+	// nobody can touch the data between here and the next grant, so
+	//  it's safe to read it without the mutex
+	if(release_data)
+	  LockReleaseMessage::send_request(release_target, me,
+					   local_data, local_data_size);
+	else
+	  LockReleaseMessage::send_request(release_target, me, 0, 0);
 #ifdef LOCK_TRACING
         {
           LockTraceItem &item = Tracer<LockTraceItem>::trace_item();
@@ -878,34 +1254,11 @@ namespace Realm {
 #endif
       }
 
-      if(grant_target != -1)
-      {
-        // Make a buffer for storing our waiter mask and the the local data
-	size_t waiter_count = copy_waiters.size();
-        size_t payload_size = ((waiter_count+1) * sizeof(int)) + local_data_size;
-        int *payload = (int*)malloc(payload_size);
-	int *pos = payload;
-	*pos++ = waiter_count;
-	// TODO: switch to iterator
-        PackFunctor functor(pos);
-        copy_waiters.map(functor);
-        pos = functor.pos;
-	//for(int i = 0; i < MAX_NUM_NODES; i++)
-	//  if(copy_waiters.contains(i))
-	//    *pos++ = i;
-        memcpy(pos, local_data, local_data_size);
-	LockGrantMessage::send_request(grant_target, me,
-				       0, // TODO: figure out shared cases
-				       payload, payload_size, PAYLOAD_FREE);
-#ifdef LOCK_TRACING
-        {
-          LockTraceItem &item = Tracer<LockTraceItem>::trace_item();
-          item.lock_id = me.id;
-          item.owner = grant_target;
-          item.action = LockTraceItem::ACT_REMOTE_GRANT;
-        }
-#endif
-      }
+      if(lock_request_target != -1)
+	LockRequestMessage::send_request(lock_request_target, my_node_id,
+					 me, request_mode);
+
+      send_grant(grant);
 
       if(!to_wake.empty()) {
 	for(WaiterList::iterator it = to_wake.begin();
@@ -924,6 +1277,11 @@ namespace Realm {
       // checking the owner can be done atomically, so doesn't need mutex
       if(owner != my_node_id) return false;
 
+      // a fast-path hold is always exclusive, and a free fast path means idle
+      int fs = fast_state;
+      if(fs == FAST_HELD) return ((check_mode == MODE_EXCL) || excl_ok);
+      if(fs == FAST_FREE) return false;
+
       // conservative check on lock count also doesn't need mutex
       if(count == ZERO_COUNT) return false;
 
@@ -945,12 +1303,16 @@ namespace Realm {
       {
 	AutoHSLLock al(mutex);
 
+	disable_fast_path();
+
 	// should only get here if the current node holds an exclusive lock
 	assert(owner == my_node_id);
 	assert(count == 1 + ZERO_COUNT);
 	assert(mode == MODE_EXCL);
+	assert(excl_waiters.empty());
 	assert(local_waiters.size() == 0);
         assert(remote_waiter_mask.empty());
+	assert(remote_sharer_mask.empty());
 	assert(in_use);
         // Mark that we no longer own our data
         if (own_local)
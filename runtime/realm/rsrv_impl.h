@@ -75,8 +75,48 @@ namespace Realm {
 
       GASNetHSL mutex; // controls which local thread has access to internal data (not runtime-visible lock)
 
-      // bitmasks of which remote nodes are waiting on a lock (or sharing it)
+      // uncontended exclusive acquires/releases of a locally-owned reservation
+      //  just CAS this word - anything else (sharing, waiters, remote traffic)
+      //  first moves it to FAST_DISABLED under the mutex, folding a fast-path
+      //  hold into 'count'/'mode', and it only goes back to FAST_FREE once the
+      //  reservation is idle again
+      enum { FAST_FREE, FAST_HELD, FAST_DISABLED };
+      volatile int fast_state;
+
+      // must be called with mutex held
+      void disable_fast_path(void);
+
+      // bitmasks of which remote nodes are waiting on a lock (or holding a
+      //  lease on it)
       NodeSet remote_waiter_mask, remote_sharer_mask;
+
+      // the owner can lease the reservation to another node instead of giving
+      //  up ownership - the holder sends a LockReleaseMessage when it is done
+      //  with an exclusive lease, but keeps a shared (read) lease after its
+      //  last local release until the owner revokes it
+      enum { LEASE_NONE, LEASE_EXCL, LEASE_SHARED };
+      unsigned lease;      // lease (if any) we hold from 'owner'
+      bool lease_revoked;  // owner wants our shared lease back
+      // revokes are not ordered with respect to the grant of the lease they
+      //  are for, so one that shows up while our request is still in flight
+      //  is held until the grant arrives
+      bool revoke_pending;
+      NodeSet remote_revoked_mask;  // (owner) sharers asked to return leases
+
+      // asks any shared lease holders that haven't been asked yet to return
+      //  their leases - mutex must be held
+      void collect_revokes(NodeSet& to_revoke);
+
+      // recent acquirers (local grants and remote requests), used by the owner
+      //  to decide between migrating ownership to a requester and leasing -
+      //  the history travels with ownership
+      static const int ACCESS_HISTORY = 8;
+      static const int MIGRATE_THRESHOLD = 5;
+      NodeID access_history[ACCESS_HISTORY];
+      unsigned access_history_pos;
+
+      void record_access(NodeID node);
+      bool should_migrate(NodeID node) const;
       //std::list<LockWaiter *> local_waiters; // set of local threads that are waiting on lock
 
 #ifdef REALM_RSRV_USE_CIRCQUEUE
@@ -85,6 +125,10 @@ namespace Realm {
       typedef std::deque<Event> WaiterList;
 #endif
 
+      // exclusive waiters get their own queue (they're always the highest
+      //  priority and the common case under contention) - shared waiters are
+      //  grouped by mode
+      WaiterList excl_waiters;
       std::map<unsigned, WaiterList> local_waiters;
       std::map<unsigned, unsigned> retry_count;
       std::map<unsigned, Event> retry_events;
@@ -120,6 +164,28 @@ namespace Realm {
 
       bool select_local_waiters(WaiterList& to_wake);
 
+      // a grant (of ownership or a lease) to be sent once the mutex is released
+      struct PendingGrant {
+	NodeID target;  // -1 if none
+	unsigned mode;
+	unsigned lease;
+	NodeSet waiters;  // remote waiters, passed along with ownership
+	NodeID history[ACCESS_HISTORY];
+      };
+
+      // decides between migration and a lease for 'target' and updates
+      //  local state accordingly - mutex must be held
+      void prepare_grant(NodeID target, unsigned req_mode, bool allow_migrate,
+			 PendingGrant& grant);
+
+      // picks the next holder(s) of a locally-owned reservation that has just
+      //  become idle - mutex must be held
+      void choose_next_holder(WaiterList& to_wake, PendingGrant& grant);
+
+      // mutex must NOT be held for these
+      void send_grant(const PendingGrant& grant);
+      void send_revokes(const NodeSet& targets);
+
       void release(void);
 
       bool is_locked(unsigned check_mode, bool excl_ok);
@@ -208,15 +274,32 @@ namespace Realm {
 			     Reservation lock, unsigned mode);
   };
 
+  // returns a lease to the owner (with the protected data for an exclusive lease)
   struct LockReleaseMessage {
-    struct RequestArgs {
+    struct RequestArgs : public BaseMedium {
       NodeID node;
       Reservation lock;
     };
     
+    static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+    typedef ActiveMessageMediumNoReply<LOCK_RELEASE_MSGID,
+				       RequestArgs,
+				       handle_request> Message;
+
+    static void send_request(NodeID target, Reservation lock,
+			     const void *data, size_t datalen);
+  };
+
+  // asks a node to return its shared lease once it is no longer in use
+  struct LockRevokeMessage {
+    struct RequestArgs {
+      Reservation lock;
+    };
+
     static void handle_request(RequestArgs args);
 
-    typedef ActiveMessageShortNoReply<LOCK_RELEASE_MSGID,
+    typedef ActiveMessageShortNoReply<LOCK_REVOKE_MSGID,
 				      RequestArgs,
 				      handle_request> Message;
 
@@ -227,6 +310,8 @@ namespace Realm {
     struct RequestArgs : public BaseMedium {
       Reservation lock;
       unsigned mode;
+      NodeID owner;    // owner after the grant
+      unsigned lease;  // LEASE_NONE for a transfer of ownership
     };
 
     static void handle_request(RequestArgs args, const void *data, size_t datalen);
@@ -236,7 +321,8 @@ namespace Realm {
 				       handle_request> Message;
 
     static void send_request(NodeID target, Reservation lock,
-			     unsigned mode, const void *data, size_t datalen,
+			     unsigned mode, NodeID owner, unsigned lease,
+			     const void *data, size_t datalen,
 			     int payload_mode);
   };
 
@@ -22,9 +22,11 @@
 #include "realm/inst_impl.h"
 
 #include "realm/activemsg.h"
+#include "realm/event_trace.h"
 #include "realm/deppart/preimage.h"
 
 #include "realm/cmdline.h"
+#include "realm/numa/numasysif.h"
 
 #include "realm/codedesc.h"
 
@@ -102,6 +104,10 @@ namespace Realm {
   Logger log_collective("collective");
   extern Logger log_task; // defined in proc_impl.cc
   extern Logger log_taskreg; // defined in proc_impl.cc
+
+  // per-thread cache assignment for DynamicTableFreeList (dynamic_table.inl)
+  int next_free_list_cache = 0;
+  __thread int current_free_list_cache = -1;
   
   ////////////////////////////////////////////////////////////////////////
   //
@@ -121,6 +127,7 @@ namespace Realm {
       fprintf(stderr,"Process %d on node %s is frozen!\n", 
                       process_id, hostname);
       fflush(stderr);
+      EventTraceRing::dump_to_file(true /*use_stderr*/);
       while (true)
         sleep(1);
     }
@@ -603,6 +610,14 @@ namespace Realm {
     // if true, worker threads that might have used user-level thread switching
     //  fall back to kernel threading
     bool force_kernel_threads = false;
+
+    // if true, processor task queues accept new tasks via a lock-free list of
+    //  pending insertions rather than taking the queue lock on every enqueue
+    bool lockfree_task_queues = false;
+
+    // if true, idle local task processors may steal ready tasks from other
+    //  processors of the same kind on this node
+    bool task_stealing = false;
   };
 
   CoreModule::CoreModule(void)
@@ -610,6 +625,8 @@ namespace Realm {
     , num_cpu_procs(1), num_util_procs(1), num_io_procs(0)
     , concurrent_io_threads(1)  // Legion does not support values > 1 right now
     , sysmem_size_in_mb(512), stack_size_in_mb(2)
+    , sysmem_transparent_hugepages(false), sysmem_hugepage_size_in_mb(0)
+    , sysmem_prefault_threads(0), sysmem_base(0), sysmem_hugepage_size(0)
   {}
 
   CoreModule::~CoreModule(void)
@@ -627,6 +644,9 @@ namespace Realm {
       .add_option_int("-ll:io", m->num_io_procs)
       .add_option_int("-ll:concurrent_io", m->concurrent_io_threads)
       .add_option_int("-ll:csize", m->sysmem_size_in_mb)
+      .add_option_bool("-ll:cthp", m->sysmem_transparent_hugepages)
+      .add_option_int("-ll:chugepages", m->sysmem_hugepage_size_in_mb)
+      .add_option_int("-ll:cprefault", m->sysmem_prefault_threads)
       .add_option_int("-ll:stacksize", m->stack_size_in_mb, true /*keep*/)
       .parse_command_line(cmdline);
 
@@ -640,8 +660,25 @@ namespace Realm {
     Module::create_memories(runtime);
 
     if(sysmem_size_in_mb > 0) {
+      if(sysmem_hugepage_size_in_mb > 0)
+	sysmem_hugepage_size = sysmem_hugepage_size_in_mb << 20;
+      else if(sysmem_transparent_hugepages)
+	sysmem_hugepage_size = NUMASYSIF_TRANSPARENT_HUGEPAGES;
+      if((sysmem_hugepage_size > 0) || (sysmem_prefault_threads > 0)) {
+	// not bound to any particular numa domain
+	sysmem_base = numasysif_alloc_mem(-1, sysmem_size_in_mb << 20,
+					  false /*!pin*/,
+					  sysmem_hugepage_size,
+					  sysmem_prefault_threads);
+	if(!sysmem_base) {
+	  log_runtime.fatal() << "allocation of " << sysmem_size_in_mb << " MB of system memory failed!";
+	  assert(false);
+	}
+      }
+
       Memory m = runtime->next_local_memory_id();
-      MemoryImpl *mi = new LocalCPUMemory(m, sysmem_size_in_mb << 20);
+      MemoryImpl *mi = new LocalCPUMemory(m, sysmem_size_in_mb << 20,
+					  sysmem_base);
       runtime->add_memory(mi);
     }
   }
@@ -700,7 +737,13 @@ namespace Realm {
   //  after all memories/processors/etc. have been shut down and destroyed
   void CoreModule::cleanup(void)
   {
-    // nothing to clean up
+    if(sysmem_base) {
+      bool ok = numasysif_free_mem(-1, sysmem_base, sysmem_size_in_mb << 20,
+				   sysmem_hugepage_size);
+      if(!ok)
+	log_runtime.error() << "failed to free system memory: ptr=" << sysmem_base;
+      sysmem_base = 0;
+    }
 
     Module::cleanup();
   }
@@ -828,6 +871,16 @@ namespace Realm {
       return code_translators;
     }
 
+    Module *RuntimeImpl::get_module(const std::string& name) const
+    {
+      for(std::vector<Module *>::const_iterator it = modules.begin();
+	  it != modules.end();
+	  ++it)
+	if((*it)->get_name() == name)
+	  return *it;
+      return 0;
+    }
+
     static void add_proc_mem_affinities(MachineImpl *machine,
 					const std::set<Processor>& procs,
 					const std::set<Memory>& mems,
@@ -1056,8 +1109,10 @@ namespace Realm {
       stack_size_in_mb = 2;
       //unsigned cpu_worker_threads = 1;
       unsigned dma_worker_threads = 1;
+      unsigned dma_channel_worker_threads = 0;  // 0 = one shared queue
       unsigned active_msg_worker_threads = 1;
       unsigned active_msg_handler_threads = 1;
+      unsigned active_msg_bulk_handler_threads = 0;
 #ifdef EVENT_TRACING
       size_t   event_trace_block_size = 1 << 20;
       double   event_trace_exp_arrv_rate = 1e3;
@@ -1080,9 +1135,11 @@ namespace Realm {
 	.add_option_int("-ll:dsize", disk_mem_size_in_mb)
 	.add_option_int("-ll:stacksize", stack_size_in_mb)
 	.add_option_int("-ll:dma", dma_worker_threads)
+	.add_option_int("-ll:dma_channel_workers", dma_channel_worker_threads)
         .add_option_bool("-ll:pin_dma", pin_dma_threads)
 	.add_option_int("-ll:amsg", active_msg_worker_threads)
 	.add_option_int("-ll:ahandlers", active_msg_handler_threads)
+	.add_option_int("-ll:bulk_ahandlers", active_msg_bulk_handler_threads)
 	.add_option_int("-ll:dummy_rsrv_ok", dummy_reservation_ok)
 	.add_option_bool("-ll:show_rsrv", show_reservations)
 	.add_option_int("-ll:ht_sharing", hyperthread_sharing);
@@ -1100,7 +1157,51 @@ namespace Realm {
 #endif
 
       cp.add_option_int("-realm:eventloopcheck", Config::event_loop_detection_limit);
+      cp.add_option_int("-ll:event_batch_us", Config::event_batch_latency_us);
+      cp.add_option_int("-ll:event_batch_size", Config::event_batch_max_bytes);
+      cp.add_option_int("-ll:spawn_batch_us", Config::spawn_batch_latency_us);
+      cp.add_option_int("-ll:spawn_batch_size", Config::spawn_batch_max_bytes);
+      cp.add_option_int("-ll:event_tree_threshold", Config::event_tree_threshold);
+      cp.add_option_int("-ll:event_tree_fanout", Config::event_tree_fanout);
+      cp.add_option_int("-ll:wait_spin_ns", Config::event_wait_spin_ns);
+      cp.add_option_int("-ll:event_hint_cache", Config::event_hint_cache_size);
+      cp.add_option_int("-ll:event_hints", Config::event_hints_per_msg);
+      cp.add_option_int("-ll:barrier_combine_us", Config::barrier_combine_latency_us);
+      cp.add_option_int("-ll:barrier_combine_fanout", Config::barrier_combine_fanout);
+      cp.add_option_int("-ll:announce_fanout", Config::announce_tree_fanout);
+      cp.add_option_int("-ll:dma_memcpy_threads", Config::dma_memcpy_threads);
+      cp.add_option_int("-ll:dma_parallel_kb", Config::dma_parallel_copy_kb);
+      cp.add_option_int("-ll:dma_serdez_elems", Config::dma_parallel_serdez_elems);
+      cp.add_option_int("-ll:dma_nt_kb", Config::dma_nontemporal_copy_kb);
+      cp.add_option_int("-ll:rdma_put_kb", Config::dma_rdma_put_kb);
+      cp.add_option_int("-ll:compress_kb", Config::dma_compress_kb);
+      cp.add_option_bool("-ll:dma_calibrate", Config::dma_calibrate_paths);
+      cp.add_option_bool("-ll:aio_regbuf", Config::aio_register_buffers);
+      cp.add_option_bool("-ll:file_mmap", Config::file_mmap);
+      cp.add_option_int("-ll:ib_cache_mb", Config::ib_cache_mb);
+      cp.add_option_int("-ll:staging_mb", Config::staging_cache_mb);
+      cp.add_option_int("-ll:plan_cache", Config::copy_plan_cache_size);
       cp.add_option_bool("-ll:force_kthreads", Config::force_kernel_threads);
+      cp.add_option_bool("-ll:lockfree_queues", Config::lockfree_task_queues);
+      cp.add_option_bool("-ll:steal", Config::task_stealing);
+      cp.add_option_int("-ll:group_dispatch", Config::group_dispatch_mode);
+      cp.add_option_int("-ll:group_slack_us", Config::group_affinity_slack_us);
+      cp.add_option_bool("-ll:pri_inherit", Config::task_priority_inheritance);
+      cp.add_option_bool("-ll:alloc_bestfit", Config::alloc_best_fit);
+      cp.add_option_int("-ll:ghome_pct", Config::gasnet_mem_home_pct);
+
+      // time to spend calibrating the timestamp counter (0 = always use
+      //  the OS's monotonic clock, which is the default so that startup
+      //  isn't delayed)
+      int tsc_calibration_ms = 0;
+      cp.add_option_int("-ll:tsc_calib", tsc_calibration_ms);
+
+      bool event_ring_enabled = false;
+      size_t event_ring_size = 4096;
+      std::string event_ring_file;
+      cp.add_option_bool("-ll:event_ring", event_ring_enabled)
+	.add_option_int("-ll:event_ring_size", event_ring_size)
+	.add_option_string("-ll:event_ring_file", event_ring_file);
 
       // these are actually parsed in activemsg.cc, but consume them here for now
       size_t dummy = 0;
@@ -1110,7 +1211,14 @@ namespace Realm {
 	.add_option_int("-ll:sdpsize", dummy)
 	.add_option_int("-ll:spillwarn", dummy)
 	.add_option_int("-ll:spillstep", dummy)
-	.add_option_int("-ll:spillstall", dummy);
+	.add_option_int("-ll:spillstall", dummy)
+	.add_option_int("-ll:amsg_agg", dummy)
+	.add_option_int("-ll:amsg_aggmsg", dummy)
+	.add_option_int("-ll:amsg_aggwait", dummy)
+	.add_option_int("-ll:amsg_pollmax", dummy)
+	.add_option_int("-ll:amsg_idlepoll", dummy);
+      std::string dummy_str;
+      cp.add_option_string("-ll:amsg_poll", dummy_str);
 
       bool cmdline_ok = cp.parse_command_line(cmdline);
 
@@ -1119,6 +1227,9 @@ namespace Realm {
 	exit(1);
       }
 
+      EventTraceRing::configure(event_ring_size, event_ring_file);
+      EventTraceRing::set_enabled(event_ring_enabled);
+
 #ifndef EVENT_TRACING
       if(!event_trace_file.empty()) {
 	fprintf(stderr, "WARNING: event tracing requested, but not enabled at compile time!\n");
@@ -1178,18 +1289,24 @@ namespace Realm {
       core_reservations = new CoreReservationSet(core_map);
 
       sampling_profiler.configure_from_cmdline(cmdline, *core_reservations);
+      EventWaitSpinner::create_gauges();
 
       // initialize barrier timestamp
       BarrierImpl::barrier_adjustment_timestamp = (((Barrier::timestamp_t)(my_node_id)) << BarrierImpl::BARRIER_TIMESTAMP_NODEID_SHIFT) + 1;
 
       NodeAnnounceMessage::Message::add_handler_entries("Node Announce AM");
+      NodeAnnounceBundleMessage::Message::add_handler_entries("Node Announce Bundle AM");
       SpawnTaskMessage::Message::add_handler_entries("Spawn Task AM");
+      SpawnTaskBatchMessage::Message::add_handler_entries("Spawn Task Batch AM");
       LockRequestMessage::Message::add_handler_entries("Lock Request AM");
       LockReleaseMessage::Message::add_handler_entries("Lock Release AM");
       LockGrantMessage::Message::add_handler_entries("Lock Grant AM");
+      LockRevokeMessage::Message::add_handler_entries("Lock Revoke AM");
       EventSubscribeMessage::Message::add_handler_entries("Event Subscribe AM");
       EventTriggerMessage::Message::add_handler_entries("Event Trigger AM");
       EventUpdateMessage::Message::add_handler_entries("Event Update AM");
+      EventBatchMessage::Message::add_handler_entries("Event Batch AM");
+      EventTreeUpdateMessage::Message::add_handler_entries("Event Tree Update AM");
       RemoteMemAllocRequest::Request::add_handler_entries("Remote Memory Allocation Request AM");
       RemoteMemAllocRequest::Response::add_handler_entries("Remote Memory Allocation Response AM");
       //CreateInstanceRequest::Request::add_handler_entries("Create Instance Request AM");
@@ -1214,12 +1331,16 @@ namespace Realm {
       BarrierSubscribeMessage::Message::add_handler_entries("Barrier Subscribe AM");
       BarrierTriggerMessage::Message::add_handler_entries("Barrier Trigger AM");
       BarrierMigrationMessage::Message::add_handler_entries("Barrier Migration AM");
+      BarrierCombineMessage::Message::add_handler_entries("Barrier Combine AM");
       MetadataRequestMessage::Message::add_handler_entries("Metadata Request AM");
       MetadataResponseMessage::Message::add_handler_entries("Metadata Response AM");
+      MetadataBatchRequestMessage::Message::add_handler_entries("Metadata Batch Request AM");
+      MetadataBatchResponseMessage::Message::add_handler_entries("Metadata Batch Response AM");
       MetadataInvalidateMessage::Message::add_handler_entries("Metadata Invalidate AM");
       MetadataInvalidateAckMessage::Message::add_handler_entries("Metadata Inval Ack AM");
       XferDesRemoteWriteMessage::Message::add_handler_entries("XferDes Remote Write AM");
       XferDesRemoteWriteAckMessage::Message::add_handler_entries("XferDes Remote Write Ack AM");
+      XferDesRemoteCompressedWriteMessage::Message::add_handler_entries("XferDes Remote Compressed Write AM");
       XferDesCreateMessage::Message::add_handler_entries("Create XferDes Request AM");
       XferDesDestroyMessage::Message::add_handler_entries("Destroy XferDes Request AM");
       NotifyXferDesCompleteMessage::Message::add_handler_entries("Notify XferDes Completion Request AM");
@@ -1227,6 +1348,7 @@ namespace Realm {
       UpdateBytesReadMessage::Message::add_handler_entries("Update Bytes Read AM");
       RegisterTaskMessage::Message::add_handler_entries("Register Task AM");
       RegisterTaskCompleteMessage::Message::add_handler_entries("Register Task Complete AM");
+      RegisterTaskBatchMessage::Message::add_handler_entries("Register Task Batch AM");
       RemoteMicroOpMessage::Message::add_handler_entries("Remote Micro Op AM");
       RemoteMicroOpCompleteMessage::Message::add_handler_entries("Remote Micro Op Complete AM");
       RemoteSparsityContribMessage::Message::add_handler_entries("Remote Sparsity Contrib AM");
@@ -1238,6 +1360,7 @@ namespace Realm {
       RemoteIBAllocRequestAsync::Message::add_handler_entries("Remote IB Alloc Request AM");
       RemoteIBAllocResponseAsync::Message::add_handler_entries("Remote IB Alloc Response AM");
       RemoteIBFreeRequestAsync::Message::add_handler_entries("Remote IB Free Request AM");
+      RemoteIBCacheControlAsync::Message::add_handler_entries("Remote IB Cache Control AM");
       MemStorageAllocRequest::Message::add_handler_entries("Memory Storage Alloc Request");
       MemStorageAllocResponse::Message::add_handler_entries("Memory Storage Alloc Response");
       MemStorageReleaseRequest::Message::add_handler_entries("Memory Storage Release Request");
@@ -1245,6 +1368,17 @@ namespace Realm {
       //TestMessage::add_handler_entries("Test AM");
       //TestMessage2::add_handler_entries("Test 2 AM");
 
+      // handlers that copy (or reduce) whole payloads into memory can take
+      //  a while - let bulk handler threads (if requested) deal with them
+      if(active_msg_bulk_handler_threads > 0) {
+	set_message_handler_class(REMOTE_WRITE_MSGID, AM_HANDLER_BULK);
+	set_message_handler_class(REMOTE_REDUCE_MSGID, AM_HANDLER_BULK);
+	set_message_handler_class(REMOTE_SERDEZ_MSGID, AM_HANDLER_BULK);
+	set_message_handler_class(REMOTE_REDLIST_MSGID, AM_HANDLER_BULK);
+	set_message_handler_class(XFERDES_REMOTEWRITE_MSGID, AM_HANDLER_BULK);
+      }
+      set_message_handler_class(XFERDES_REMOTEWRITE_COMPRESSED_MSGID, AM_HANDLER_BULK);
+
       nodes = new Node[max_node_id + 1];
 
       // create allocators for local node events/locks/index spaces - do this before we start handling
@@ -1265,6 +1399,10 @@ namespace Realm {
 	}
       }
 
+      // switch clocks before anybody (including the network) picks a zero time
+      if(tsc_calibration_ms > 0)
+	Realm::Clock::calibrate_tsc(tsc_calibration_ms);
+
       init_endpoints(gasnet_mem_size_in_mb, reg_mem_size_in_mb, reg_ib_mem_size_in_mb,
 		     *core_reservations,
 		     *argc, (const char **)*argv);
@@ -1322,9 +1460,16 @@ namespace Realm {
 	}
       }
       
+      // must be set up before the polling threads start
+      EventMessageBatcher::init_batching(max_node_id + 1);
+      SpawnTaskBatcher::init_batching(max_node_id + 1);
+      EventTriggerHints::init(max_node_id + 1);
+      BarrierArrivalCombiner::init_combining(max_node_id + 1);
+
       start_polling_threads(active_msg_worker_threads);
 
       start_handler_threads(active_msg_handler_threads,
+			    active_msg_bulk_handler_threads,
 			    *core_reservations,
 			    stack_size_in_mb << 20);
 
@@ -1334,6 +1479,7 @@ namespace Realm {
 #endif
 
       start_dma_worker_threads(dma_worker_threads,
+			       dma_channel_worker_threads,
 			       *core_reservations);
 
       PartitioningOpQueue::start_worker_threads(*core_reservations);
@@ -1399,6 +1545,43 @@ namespace Realm {
 	  it++)
 	(*it)->create_processors(this);
 
+      // if requested, let CPU and utility processors steal from their peers of
+      //  the same kind - other kinds (e.g. GPUs) run tasks that are tied to
+      //  resources of that particular processor, so they never steal
+      if(Config::task_stealing) {
+	std::map<Processor::Kind, std::vector<LocalTaskProcessor *> > peers_by_kind;
+	for(std::vector<ProcessorImpl *>::const_iterator it = n->processors.begin();
+	    it != n->processors.end();
+	    it++) {
+	  if(((*it)->kind != Processor::LOC_PROC) &&
+	     ((*it)->kind != Processor::UTIL_PROC))
+	    continue;
+	  LocalTaskProcessor *ltp = dynamic_cast<LocalTaskProcessor *>(*it);
+	  if(ltp)
+	    peers_by_kind[ltp->kind].push_back(ltp);
+	}
+
+	for(std::map<Processor::Kind, std::vector<LocalTaskProcessor *> >::const_iterator it = peers_by_kind.begin();
+	    it != peers_by_kind.end();
+	    it++) {
+	  const std::vector<LocalTaskProcessor *>& peers = it->second;
+	  // steal from neighbors in round-robin order so that victims are spread
+	  //  out, but try all the victims in our own NUMA domain (treating an
+	  //  unknown domain as a match) before going to another one
+	  for(size_t i = 0; i < peers.size(); i++) {
+	    int domain = peers[i]->get_numa_domain();
+	    for(int pass = 0; pass < 2; pass++)
+	      for(size_t j = 1; j < peers.size(); j++) {
+		LocalTaskProcessor *victim = peers[(i + j) % peers.size()];
+		int vdomain = victim->get_numa_domain();
+		bool local = ((domain < 0) || (vdomain < 0) || (vdomain == domain));
+		if(local == (pass == 0))
+		  peers[i]->add_steal_victim(victim);
+	      }
+	  }
+	}
+      }
+
       LocalCPUMemory *reg_ib_mem;
       if(reg_ib_mem_size_in_mb > 0) {
 #ifdef USE_GASNET
@@ -1583,6 +1766,15 @@ namespace Realm {
 				  40,  // "large" bandwidth
 				  3   // "small" latency
 				  );
+
+	  // managed memory is as good as sysmem once pages have migrated, but
+	  //  the first touch after a GPU has used them costs a fault
+	  add_proc_mem_affinities(machine,
+				  procs_by_kind[k],
+				  mems_by_kind[Memory::GPU_MANAGED_MEM],
+				  40,  // "large" bandwidth
+				  10   // "medium" latency
+				  );
 	}
       }
       {
@@ -1714,15 +1906,11 @@ namespace Realm {
 #endif
 
 	// now announce ourselves to everyone else
-	for(NodeID i = 0; i <= max_node_id; i++)
-	  if(i != my_node_id)
-	    NodeAnnounceMessage::send_request(i,
-					      num_procs,
-					      num_memories,
-					      num_ib_memories,
-					      dbs.get_buffer(),
-					      dbs.bytes_used(),
-					      PAYLOAD_COPY);
+	NodeAnnounceMessage::announce_to_all(num_procs,
+					     num_memories,
+					     num_ib_memories,
+					     dbs.get_buffer(),
+					     dbs.bytes_used());
 
 	NodeAnnounceMessage::await_all_announcements();
 
@@ -2138,6 +2326,9 @@ namespace Realm {
       PartitioningOpQueue::stop_worker_threads();
       stop_dma_worker_threads();
       stop_dma_system();
+      BarrierArrivalCombiner::shutdown_combining();
+      SpawnTaskBatcher::shutdown_batching();
+      EventMessageBatcher::shutdown_batching();
       stop_activemsg_threads();
 
       sampling_profiler.shutdown();
@@ -2158,6 +2349,8 @@ namespace Realm {
 	event_trace_file = 0;
       }
 #endif
+      EventTraceRing::dump_to_file(false /*!use_stderr*/);
+
 #ifdef LOCK_TRACING
       if (lock_trace_file)
       {
@@ -2492,6 +2685,7 @@ namespace Realm {
       fflush(stderr);
       free(buffer);
       free(funcname);
+      EventTraceRing::dump_to_file(true /*use_stderr*/);
       // returning would almost certainly cause this signal to be raised again,
       //  so sleep for a second in case other threads also want to chronicle
       //  their own deaths, and then exit
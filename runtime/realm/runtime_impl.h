@@ -180,6 +180,13 @@ namespace Realm {
       int num_cpu_procs, num_util_procs, num_io_procs;
       int concurrent_io_threads;
       size_t sysmem_size_in_mb, stack_size_in_mb;
+      // system memory can be mapped (and pre-faulted) by us instead of
+      //  coming from the heap
+      bool sysmem_transparent_hugepages;
+      size_t sysmem_hugepage_size_in_mb;
+      int sysmem_prefault_threads;
+      void *sysmem_base;
+      size_t sysmem_hugepage_size;
     };
 
     REGISTER_REALM_MODULE(CoreModule);
@@ -294,6 +301,9 @@ namespace Realm {
 
       const std::vector<CodeTranslator *>& get_code_translators(void) const;
 
+      // returns the module with the given name, or null if it wasn't loaded
+      Module *get_module(const std::string& name) const;
+
     protected:
       ID::IDType num_local_memories, num_local_ib_memories, num_local_processors;
 
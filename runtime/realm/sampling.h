@@ -41,6 +41,28 @@ namespace Realm {
     //  when profiling is not active so that they don't need to be guarded by
     //  compile-time ifdef's
 
+    // updates are spread over a few per-thread shards using relaxed atomics -
+    //  readers and the sampler combine the shards, so updates from hot paths
+    //  rarely contend with each other
+    // gauges live in arbitrary (and arbitrarily aligned) objects, so instead
+    //  of being aligned, each shard is preceded by a cache line of padding,
+    //  which keeps it off of any line used by its neighbors
+    static const int NUM_GAUGE_SHARDS = 4;
+    static const size_t GAUGE_SHARD_PADDING = 64;
+
+    template <typename T>
+    struct GaugeShard {
+      char pad[GAUGE_SHARD_PADDING];
+      T value;
+    };
+
+    template <typename T>
+    struct GaugeRangeShard {
+      char pad[GAUGE_SHARD_PADDING];
+      T minval;
+      T maxval;
+    };
+
     // parent class for all gauges
     class Gauge {
     public:
@@ -67,8 +89,13 @@ namespace Realm {
       static void add_gauge(T *gauge, SamplingProfiler *_profiler);
       void remove_gauge(void);
 
+      // returns the calling thread's shard (assigned round-robin on first use)
+      static int shard_index(void);
+
       GaugeSampler *sampler;
 
+      static int next_shard_index;
+
     public:
       // don't actually call this - it's here for linker fun
       static size_t instantiate_templates(void);
@@ -100,7 +127,9 @@ namespace Realm {
     protected:
       friend class Realm::GaugeSampler;
 
-      T curval;  // current gauge value
+      // current value is base + the sum of all the shards' deltas
+      T base;
+      GaugeShard<T> deltas[NUM_GAUGE_SHARDS];
     };
 
     template <typename T>
@@ -136,9 +165,11 @@ namespace Realm {
     protected:
       friend class Realm::GaugeSampler;
 
+      void update_range(T newval);
+
       T curval;  // current gauge value
-      T minval;  // max value seen since last sample
-      T maxval;  // min value seen since last sample
+      // min/max value seen since last sample (combined across shards)
+      GaugeRangeShard<T> ranges[NUM_GAUGE_SHARDS];
     };
 
     template <typename T = int>
@@ -162,7 +193,8 @@ namespace Realm {
     protected:
       friend class Realm::GaugeSampler;
 
-      T events;  // events recorded since last sample
+      // events recorded since last sample (summed across shards)
+      GaugeShard<T> events[NUM_GAUGE_SHARDS];
     };
 
   }; // namespace ProfilingGauges
@@ -24,6 +24,9 @@ namespace Realm {
 
   namespace ProfilingGauges {
 
+    // shard assigned to the current thread, or -1 if none yet
+    extern __thread int current_gauge_shard;
+
     ////////////////////////////////////////////////////////////////////////
     //
     // class Gauge
@@ -40,6 +43,16 @@ namespace Realm {
 	remove_gauge();
     }
 
+    inline /*static*/ int Gauge::shard_index(void)
+    {
+      int idx = current_gauge_shard;
+      if(idx < 0) {
+	idx = __sync_fetch_and_add(&next_shard_index, 1) % NUM_GAUGE_SHARDS;
+	current_gauge_shard = idx;
+      }
+      return idx;
+    }
+
 
     ////////////////////////////////////////////////////////////////////////
     //
@@ -50,42 +63,52 @@ namespace Realm {
     inline AbsoluteGauge<T>::AbsoluteGauge(const std::string& _name, T _initval,
 					   SamplingProfiler *_profiler /*= 0*/)
       : Gauge(_name)
-      , curval(_initval)
+      , base(_initval)
     {
+      for(int i = 0; i < NUM_GAUGE_SHARDS; i++)
+	deltas[i].value = 0;
       add_gauge(this, _profiler);  // may (eventually) set sampler as a side-effect
     }
 
     template <typename T>
     AbsoluteGauge<T>& AbsoluteGauge<T>::operator=(const AbsoluteGauge<T>& copy_from)
     {
-      curval = copy_from.curval;
+      (*this) = T(copy_from);
       return *this;
     }
 
     template <typename T>
     inline AbsoluteGauge<T>::operator T(void) const
     {
-      return curval;
+      T val = __atomic_load_n(&base, __ATOMIC_RELAXED);
+      for(int i = 0; i < NUM_GAUGE_SHARDS; i++)
+	val += __atomic_load_n(&deltas[i].value, __ATOMIC_RELAXED);
+      return val;
     }
 
     template <typename T>
     inline AbsoluteGauge<T>& AbsoluteGauge<T>::operator=(T to_set)
     {
-      curval = to_set;
+      // fold the shards' deltas into the base rather than resetting them,
+      //  so that a concurrent += isn't lost (setting is the slow path)
+      T sum = 0;
+      for(int i = 0; i < NUM_GAUGE_SHARDS; i++)
+	sum += __atomic_load_n(&deltas[i].value, __ATOMIC_RELAXED);
+      __atomic_store_n(&base, to_set - sum, __ATOMIC_RELAXED);
       return *this;
     }
 
     template <typename T>
     inline AbsoluteGauge<T>& AbsoluteGauge<T>::operator+=(T to_add)
     {
-      curval += to_add;
+      __atomic_fetch_add(&deltas[shard_index()].value, to_add, __ATOMIC_RELAXED);
       return *this;
     }
 
     template <typename T>
     inline AbsoluteGauge<T>& AbsoluteGauge<T>::operator-=(T to_sub)
     {
-      curval -= to_sub;
+      __atomic_fetch_sub(&deltas[shard_index()].value, to_sub, __ATOMIC_RELAXED);
       return *this;
     }
 
@@ -100,53 +123,62 @@ namespace Realm {
 						     SamplingProfiler *_profiler /*= 0*/)
       : Gauge(_name)
       , curval(_initval)
-      , minval(_initval)
-      , maxval(_initval)
     {
+      for(int i = 0; i < NUM_GAUGE_SHARDS; i++) {
+	ranges[i].minval = _initval;
+	ranges[i].maxval = _initval;
+      }
       add_gauge(this, _profiler);  // may (eventually) set sampler as a side-effect
     }
 
     template <typename T>
     AbsoluteRangeGauge<T>& AbsoluteRangeGauge<T>::operator=(const AbsoluteRangeGauge<T>& copy_from)
     {
-      (*this) = copy_from.curval;
+      (*this) = T(copy_from);
       return *this;
     }
 
     template <typename T>
     inline AbsoluteRangeGauge<T>::operator T(void) const
     {
-      return curval;
+      return __atomic_load_n(&curval, __ATOMIC_RELAXED);
+    }
+
+    // min/max only need to be updated in the calling thread's shard - the
+    //  compare-and-swaps are almost never contended
+    template <typename T>
+    inline void AbsoluteRangeGauge<T>::update_range(T newval)
+    {
+      GaugeRangeShard<T>& r = ranges[shard_index()];
+      T oldmin = __atomic_load_n(&r.minval, __ATOMIC_RELAXED);
+      while((newval < oldmin) &&
+	    !__atomic_compare_exchange_n(&r.minval, &oldmin, newval, true,
+					 __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
+      T oldmax = __atomic_load_n(&r.maxval, __ATOMIC_RELAXED);
+      while((newval > oldmax) &&
+	    !__atomic_compare_exchange_n(&r.maxval, &oldmax, newval, true,
+					 __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {}
     }
 
     template <typename T>
     inline AbsoluteRangeGauge<T>& AbsoluteRangeGauge<T>::operator=(T to_set)
     {
-      curval = to_set;
-      while(true) {
-	T oldmin = minval;
-	if(minval < curval) break;
-	if(__sync_bool_compare_and_swap(&minval, oldmin, curval)) break;
-      }
-      while(true) {
-	T oldmax = maxval;
-	if(maxval > curval) break;
-	if(__sync_bool_compare_and_swap(&maxval, oldmax, curval)) break;
-      }
+      __atomic_store_n(&curval, to_set, __ATOMIC_RELAXED);
+      update_range(to_set);
       return *this;
     }
 
     template <typename T>
     inline AbsoluteRangeGauge<T>& AbsoluteRangeGauge<T>::operator+=(T to_add)
     {
-      (*this) = (curval + to_add);
+      update_range(__atomic_add_fetch(&curval, to_add, __ATOMIC_RELAXED));
       return *this;
     }
 
     template <typename T>
     inline AbsoluteRangeGauge<T>& AbsoluteRangeGauge<T>::operator-=(T to_sub)
     {
-      *this = (curval - to_sub);
+      update_range(__atomic_sub_fetch(&curval, to_sub, __ATOMIC_RELAXED));
       return *this;
     }
 
@@ -160,16 +192,25 @@ namespace Realm {
     inline EventCounter<T>::EventCounter(const std::string& _name,
 					 SamplingProfiler *_profiler /*= 0*/)
       : Gauge(_name)
-      , events(0)
     {
+      for(int i = 0; i < NUM_GAUGE_SHARDS; i++)
+	events[i].value = 0;
       add_gauge(this, _profiler);  // may (eventually) set sampler as a side-effect
     }
 
+    template <typename T>
+    inline EventCounter<T>::operator T(void) const
+    {
+      T count = 0;
+      for(int i = 0; i < NUM_GAUGE_SHARDS; i++)
+	count += __atomic_load_n(&events[i].value, __ATOMIC_RELAXED);
+      return count;
+    }
+
     template <typename T>
     inline EventCounter<T>& EventCounter<T>::operator+=(T to_add)
     {
-      // must be an atomic fetch-and-add
-      __sync_fetch_and_add(&events, to_add);
+      __atomic_fetch_add(&events[shard_index()].value, to_add, __ATOMIC_RELAXED);
       return *this;
     }
 
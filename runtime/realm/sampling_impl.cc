@@ -118,30 +118,37 @@ namespace Realm {
   void GaugeSampler::perform_sample(ProfilingGauges::AbsoluteGauge<T>& gauge,
 				    typename ProfilingGauges::AbsoluteGauge<T>::Sample &sample)
   {
-    // simple copy is all we need
-    sample.value = gauge.curval;
+    // sum of the base and all the shards
+    sample.value = T(gauge);
   }
 
   template <typename T>
   void GaugeSampler::perform_sample(ProfilingGauges::AbsoluteRangeGauge<T>& gauge,
 				    typename ProfilingGauges::AbsoluteRangeGauge<T>::Sample &sample)
   {
-    // want a consistent sample of current/min/max, and then reset min/max to current
-    sample.value = gauge.curval;
-    do {
-      sample.minval = gauge.minval;
-    } while(!__sync_bool_compare_and_swap(&gauge.minval, sample.minval, sample.value));
-    do {
-      sample.maxval = gauge.maxval;
-    } while(!__sync_bool_compare_and_swap(&gauge.maxval, sample.maxval, sample.value));
+    // combine min/max from every shard, resetting each to the current value
+    sample.value = T(gauge);
+    sample.minval = sample.value;
+    sample.maxval = sample.value;
+    for(int i = 0; i < ProfilingGauges::NUM_GAUGE_SHARDS; i++) {
+      T v = __atomic_exchange_n(&gauge.ranges[i].minval, sample.value,
+				__ATOMIC_RELAXED);
+      if(v < sample.minval) sample.minval = v;
+      v = __atomic_exchange_n(&gauge.ranges[i].maxval, sample.value,
+			      __ATOMIC_RELAXED);
+      if(v > sample.maxval) sample.maxval = v;
+    }
   }
 
   template <typename T>
   void GaugeSampler::perform_sample(ProfilingGauges::EventCounter<T>& gauge,
 				    typename ProfilingGauges::EventCounter<T>::Sample &sample)
   {
-    // need to atomically read the value and write 0 back
-    sample.count = __sync_fetch_and_and(&gauge.events, 0);
+    // need to atomically read each shard's count and write 0 back
+    sample.count = 0;
+    for(int i = 0; i < ProfilingGauges::NUM_GAUGE_SHARDS; i++)
+      sample.count += __atomic_exchange_n(&gauge.events[i].value, T(0),
+					  __ATOMIC_RELAXED);
   }
 
 
@@ -803,6 +810,10 @@ namespace Realm {
 	gauge->sampler = DefaultSamplerHandler::get_handler().add_gauge_to_default_sampler(gauge);
     }
 
+    /*static*/ int Gauge::next_shard_index = 0;
+
+    __thread int current_gauge_shard = -1;
+
     void Gauge::remove_gauge(void)
     {
       SamplingProfilerImpl *profiler = sampler->profiler;
@@ -90,11 +90,12 @@ char operator,(const is_copy_serializable::inner&, const T&);
 
 namespace Realm {
   namespace Serialization {
-    // there are three kinds of serializer we use and a single deserializer:
+    // there are four kinds of serializer we use and a single deserializer:
     //  a) FixedBufferSerializer - accepts a fixed-size buffer and fills into while preventing overflow
     //  b) DynamicBufferSerializer - serializes data into an automatically-regrowing buffer
     //  c) ByteCountSerializer - doesn't actually store data, just counts how big it would be
-    //  d) FixedBufferDeserializer - deserializes from a fixed-size buffer
+    //  d) SpanListSerializer - like (b), but large byte ranges are referenced rather than copied
+    //  e) FixedBufferDeserializer - deserializes from a fixed-size buffer
 
     class FixedBufferSerializer {
     public:
@@ -157,6 +158,41 @@ namespace Realm {
       size_t count;
     };
 
+    // small items are copied into an internal buffer, but byte ranges of at
+    //  least 'min_reference_bytes' (e.g. the contents of a ByteArray) are
+    //  only referenced - the caller must keep them valid and unchanged until
+    //  the spans have been consumed (e.g. by an active message sent with
+    //  PAYLOAD_COPY, which copies them once at injection)
+    class SpanListSerializer {
+    public:
+      SpanListSerializer(size_t initial_size, size_t _min_reference_bytes = 1024);
+      ~SpanListSerializer(void);
+
+      size_t bytes_used(void) const;
+      // appends the spans making up the serialized data, in order - these
+      //  are invalidated by any further serialization
+      void get_spans(std::vector<std::pair<const void *, size_t> >& spans) const;
+
+      bool enforce_alignment(size_t granularity);
+      bool append_bytes(const void *data, size_t datalen);
+      template <typename T> bool append_serializable(const T& data);
+
+      template <typename T> bool operator<<(const T& val);
+      template <typename T> bool operator&(const T& val);
+
+    protected:
+      struct ReferencedSpan {
+	size_t inline_offset;  // position in the inline data it comes before
+	const void *base;
+	size_t bytes;
+      };
+
+      DynamicBufferSerializer inline_data;
+      size_t min_reference_bytes;
+      std::vector<ReferencedSpan> references;
+      size_t referenced_bytes;
+    };
+
     class FixedBufferDeserializer {
     public:
       FixedBufferDeserializer(const void *buffer, size_t size);
@@ -263,6 +299,7 @@ namespace Realm {
       static bool serialize(FixedBufferSerializer& serializer, const T& obj);
       static bool serialize(DynamicBufferSerializer& serializer, const T& obj);
       static bool serialize(ByteCountSerializer& serializer, const T& obj);
+      static bool serialize(SpanListSerializer& serializer, const T& obj);
 
       static T *deserialize_new(FixedBufferDeserializer& deserializer);
 
@@ -290,6 +327,7 @@ namespace Realm {
       virtual bool serialize(FixedBufferSerializer& serializer, const T& obj) const = 0;
       virtual bool serialize(DynamicBufferSerializer& serializer, const T& obj) const = 0;
       virtual bool serialize(ByteCountSerializer& serializer, const T& obj) const = 0;
+      virtual bool serialize(SpanListSerializer& serializer, const T& obj) const = 0;
       
       virtual T *deserialize_new(FixedBufferDeserializer& deserializer) const = 0;
 
@@ -307,6 +345,7 @@ namespace Realm {
       virtual bool serialize(FixedBufferSerializer& serializer, const T1& obj) const;
       virtual bool serialize(DynamicBufferSerializer& serializer, const T1& obj) const;
       virtual bool serialize(ByteCountSerializer& serializer, const T1& obj) const;
+      virtual bool serialize(SpanListSerializer& serializer, const T1& obj) const;
       
       virtual T1 *deserialize_new(FixedBufferDeserializer& deserializer) const;
     };
@@ -314,6 +314,90 @@ namespace Realm {
     }
 
 
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class SpanListSerializer
+    //
+
+    inline SpanListSerializer::SpanListSerializer(size_t initial_size,
+						  size_t _min_reference_bytes /*= 1024*/)
+      : inline_data(initial_size)
+      , min_reference_bytes(_min_reference_bytes)
+      , referenced_bytes(0)
+    {}
+
+    inline SpanListSerializer::~SpanListSerializer(void)
+    {}
+
+    inline size_t SpanListSerializer::bytes_used(void) const
+    {
+      return inline_data.bytes_used() + referenced_bytes;
+    }
+
+    inline void SpanListSerializer::get_spans(std::vector<std::pair<const void *, size_t> >& spans) const
+    {
+      const char *base = static_cast<const char *>(inline_data.get_buffer());
+      size_t done = 0;
+      for(std::vector<ReferencedSpan>::const_iterator it = references.begin();
+	  it != references.end();
+	  ++it) {
+	if(it->inline_offset > done) {
+	  spans.push_back(std::make_pair(base + done, it->inline_offset - done));
+	  done = it->inline_offset;
+	}
+	spans.push_back(std::make_pair(it->base, it->bytes));
+      }
+      size_t used = inline_data.bytes_used();
+      if(used > done)
+	spans.push_back(std::make_pair(base + done, used - done));
+    }
+
+    inline bool SpanListSerializer::enforce_alignment(size_t granularity)
+    {
+      // alignment is relative to the start of the whole payload, which the
+      //  receiver's deserializer sees as a single contiguous buffer
+      size_t used = bytes_used();
+      size_t padding = ((used + granularity - 1) / granularity * granularity) - used;
+      while(padding-- > 0) {
+	char zero = 0;
+	inline_data.append_serializable(zero);
+      }
+      return true;
+    }
+
+    inline bool SpanListSerializer::append_bytes(const void *data, size_t datalen)
+    {
+      if(datalen < min_reference_bytes)
+	return inline_data.append_bytes(data, datalen);
+
+      ReferencedSpan span;
+      span.inline_offset = inline_data.bytes_used();
+      span.base = data;
+      span.bytes = datalen;
+      references.push_back(span);
+      referenced_bytes += datalen;
+      return true;
+    }
+
+    template <typename T>
+    bool SpanListSerializer::append_serializable(const T& data)
+    {
+      return inline_data.append_serializable(data);
+    }
+
+    template <typename T>
+    bool SpanListSerializer::operator<<(const T& data)
+    {
+      return SerializationHelper<T, is_copy_serializable::test<T>::value>::serialize_scalar(*this, data);
+    }
+
+    template <typename T>
+    bool SpanListSerializer::operator&(const T& data)
+    {
+      return SerializationHelper<T, is_copy_serializable::test<T>::value>::serialize_scalar(*this, data);
+    }
+
+
     ////////////////////////////////////////////////////////////////////////
     //
     // class FixedBufferDeserializer
@@ -667,6 +751,18 @@ namespace Realm {
       return (serializer << sc->tag) && sc->serialize(serializer, obj);
     }
 
+    template <typename T>
+    inline /*static*/ bool PolymorphicSerdezHelper<T>::serialize(SpanListSerializer& serializer, const T& obj)
+    {
+      const char *type_name = typeid(obj).name();
+      if(get_subclasses().by_typename.count(type_name) == 0) {
+	std::cerr << "FATAL: class " << type_name << " not registered with serdez helper for " << typeid(T).name() << std::endl;
+	assert(0);
+      }
+      const PolymorphicSerdezIntfc<T> *sc = get_subclasses().by_typename[type_name];
+      return (serializer << sc->tag) && sc->serialize(serializer, obj);
+    }
+
     template <typename T>
     inline /*static*/ T *PolymorphicSerdezHelper<T>::deserialize_new(FixedBufferDeserializer& deserializer)
     {
@@ -731,6 +827,12 @@ namespace Realm {
     {
       return static_cast<const T2&>(obj).serialize(serializer);
     }
+
+    template <typename T1, typename T2>
+    inline bool PolymorphicSerdezSubclass<T1,T2>::serialize(SpanListSerializer& serializer, const T1& obj) const
+    {
+      return static_cast<const T2&>(obj).serialize(serializer);
+    }
       
     template <typename T1, typename T2>
     inline T1 *PolymorphicSerdezSubclass<T1,T2>::deserialize_new(FixedBufferDeserializer& deserializer) const
@@ -86,6 +86,52 @@ namespace Realm {
     HierarchicalBitMap<N,T> *bitmap;
   };
 
+  // a HierarchicalBitMap is a dense array of bits (with the first dimension
+  //  varying fastest) describing which points of its bounding rectangle are
+  //  present - it is used in place of a list of rectangles for sparsity maps
+  //  that are mostly full but have many scattered holes
+  // a second level of bits records which words of the first level are
+  //  non-zero, allowing large empty areas to be skipped quickly
+  template <int N, typename T>
+  class HierarchicalBitMap {
+  public:
+    HierarchicalBitMap(const Rect<N,T>& _bounds);
+
+    // 'r' must be contained in the bitmap's bounds
+    void set_rect(const Rect<N,T>& r);
+
+    bool is_set(const Point<N,T>& p) const;
+
+    // queries on a subrectangle 'r' of the bitmap's bounds
+    size_t count_set(const Rect<N,T>& r) const;
+    bool any_set(const Rect<N,T>& r) const;
+
+    // finds the next run of set points (in the first dimension) within
+    //  'restriction' - if 'first' is set, the search starts at the beginning
+    //  of 'restriction', otherwise it starts just after the previous run
+    //  given in 'run' - returns false if there are no more runs
+    bool next_run(const Rect<N,T>& restriction, Rect<N,T>& run, bool first) const;
+
+    // number of bytes used by the bitmap for a given rectangle
+    static size_t bytes_needed(const Rect<N,T>& r);
+
+    Rect<N,T> bounds;
+
+  protected:
+    size_t bit_index(const Point<N,T>& p) const;
+
+    // returns the first bit in [first, last] that is set (or clear if
+    //  'want_set' is false), or last+1 if there is none
+    size_t scan_bits(size_t first, size_t last, bool want_set) const;
+
+    // steps 'p' to the start of the next row of 'r', returning false if
+    //  there isn't one
+    static bool next_row(const Rect<N,T>& r, Point<N,T>& p);
+
+    std::vector<unsigned long long> bits;
+    std::vector<unsigned long long> summary;  // one bit per word of 'bits'
+  };
+
   template <int N, typename T>
   class SparsityMapPublicImpl {
   protected:
@@ -53,6 +53,185 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class HierarchicalBitMap<N,T>
+
+  template <int N, typename T>
+  inline HierarchicalBitMap<N,T>::HierarchicalBitMap(const Rect<N,T>& _bounds)
+    : bounds(_bounds)
+  {
+    size_t nbits = bounds.volume();
+    size_t nwords = (nbits + 63) >> 6;
+    bits.resize(nwords, 0);
+    summary.resize((nwords + 63) >> 6, 0);
+  }
+
+  template <int N, typename T>
+  inline /*static*/ size_t HierarchicalBitMap<N,T>::bytes_needed(const Rect<N,T>& r)
+  {
+    size_t nwords = (r.volume() + 63) >> 6;
+    return (nwords + ((nwords + 63) >> 6)) * sizeof(unsigned long long);
+  }
+
+  template <int N, typename T>
+  inline size_t HierarchicalBitMap<N,T>::bit_index(const Point<N,T>& p) const
+  {
+    size_t idx = 0;
+    size_t stride = 1;
+    for(int i = 0; i < N; i++) {
+      idx += size_t(p[i] - bounds.lo[i]) * stride;
+      stride *= size_t(bounds.hi[i] - bounds.lo[i]) + 1;
+    }
+    return idx;
+  }
+
+  template <int N, typename T>
+  inline /*static*/ bool HierarchicalBitMap<N,T>::next_row(const Rect<N,T>& r,
+							    Point<N,T>& p)
+  {
+    for(int i = 1; i < N; i++) {
+      if(p[i] < r.hi[i]) {
+	p[i]++;
+	p.x = r.lo.x;
+	return true;
+      }
+      p[i] = r.lo[i];
+    }
+    return false;
+  }
+
+  template <int N, typename T>
+  inline size_t HierarchicalBitMap<N,T>::scan_bits(size_t first, size_t last,
+						   bool want_set) const
+  {
+    size_t i = first;
+    while(i <= last) {
+      size_t w = i >> 6;
+      if(want_set) {
+	// skip over words known to be all zeros
+	unsigned long long s = summary[w >> 6] >> (w & 63);
+	if(s == 0) {
+	  i = ((w | 63) + 1) << 6;
+	  continue;
+	}
+	if((s & 1) == 0) {
+	  i = (w + __builtin_ctzll(s)) << 6;
+	  continue;
+	}
+      }
+      unsigned long long word = (want_set ? bits[w] : ~bits[w]);
+      word &= ~0ULL << (i & 63);
+      if(word != 0) {
+	size_t found = (w << 6) + __builtin_ctzll(word);
+	return ((found <= last) ? found : (last + 1));
+      }
+      i = (w + 1) << 6;
+    }
+    return last + 1;
+  }
+
+  template <int N, typename T>
+  inline void HierarchicalBitMap<N,T>::set_rect(const Rect<N,T>& r)
+  {
+    if(r.empty()) return;
+    Point<N,T> p = r.lo;
+    do {
+      size_t first = bit_index(p);
+      size_t last = first + size_t(r.hi.x - r.lo.x);
+      size_t w_first = first >> 6;
+      size_t w_last = last >> 6;
+      for(size_t w = w_first; w <= w_last; w++) {
+	unsigned long long mask = ~0ULL;
+	if(w == w_first)
+	  mask &= ~0ULL << (first & 63);
+	if(w == w_last)
+	  mask &= ~0ULL >> (63 - (last & 63));
+	bits[w] |= mask;
+	summary[w >> 6] |= 1ULL << (w & 63);
+      }
+    } while(next_row(r, p));
+  }
+
+  template <int N, typename T>
+  inline bool HierarchicalBitMap<N,T>::is_set(const Point<N,T>& p) const
+  {
+    size_t idx = bit_index(p);
+    return ((bits[idx >> 6] >> (idx & 63)) & 1) != 0;
+  }
+
+  template <int N, typename T>
+  inline size_t HierarchicalBitMap<N,T>::count_set(const Rect<N,T>& r) const
+  {
+    if(r.empty()) return 0;
+    size_t total = 0;
+    Point<N,T> p = r.lo;
+    do {
+      size_t first = bit_index(p);
+      size_t last = first + size_t(r.hi.x - r.lo.x);
+      size_t w_first = first >> 6;
+      size_t w_last = last >> 6;
+      for(size_t w = w_first; w <= w_last; w++) {
+	unsigned long long word = bits[w];
+	if(w == w_first)
+	  word &= ~0ULL << (first & 63);
+	if(w == w_last)
+	  word &= ~0ULL >> (63 - (last & 63));
+	total += __builtin_popcountll(word);
+      }
+    } while(next_row(r, p));
+    return total;
+  }
+
+  template <int N, typename T>
+  inline bool HierarchicalBitMap<N,T>::any_set(const Rect<N,T>& r) const
+  {
+    if(r.empty()) return false;
+    Point<N,T> p = r.lo;
+    do {
+      size_t first = bit_index(p);
+      size_t last = first + size_t(r.hi.x - r.lo.x);
+      if(scan_bits(first, last, true) <= last)
+	return true;
+    } while(next_row(r, p));
+    return false;
+  }
+
+  template <int N, typename T>
+  inline bool HierarchicalBitMap<N,T>::next_run(const Rect<N,T>& restriction,
+						Rect<N,T>& run, bool first) const
+  {
+    if(restriction.empty()) return false;
+    Point<N,T> p;
+    if(first) {
+      p = restriction.lo;
+    } else {
+      p = run.hi;
+      if(p.x < restriction.hi.x) {
+	p.x++;
+      } else {
+	if(!next_row(restriction, p))
+	  return false;
+      }
+    }
+    while(true) {
+      size_t start = bit_index(p);
+      size_t last = start + size_t(restriction.hi.x - p.x);
+      size_t s = scan_bits(start, last, true);
+      if(s <= last) {
+	size_t e = scan_bits(s, last, false);
+	run.lo = p;
+	run.hi = p;
+	run.lo.x = p.x + T(s - start);
+	run.hi.x = p.x + T(e - 1 - start);
+	return true;
+      }
+      if(!next_row(restriction, p))
+	return false;
+    }
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class SparsityMapPublicImpl<N,T>
@@ -35,9 +35,19 @@ namespace Realm {
 	     Event _before_event,
 	     Event _finish_event, int _priority)
     : Operation(_finish_event, reqs), proc(_proc), func_id(_func_id),
-      args(_args, _arglen), before_event(_before_event), priority(_priority),
-      executing_thread(0)
+      before_event(_before_event), priority(_priority),
+      queued_counter(0), ready_queue(0), executing_thread(0), claimed(0),
+      continuation_requested(false), resuming(false)
   {
+    continuation_waiter.task = this;
+    if(_arglen <= INLINE_ARG_BYTES) {
+      if(_arglen > 0)
+	memcpy(inline_args, _args, _arglen);
+      args.changeref(inline_args, _arglen);
+    } else {
+      heap_args.set(_args, _arglen);
+      args.changeref(heap_args.base(), _arglen);
+    }
     log_task.info() << "task " << (void *)this << " created: func=" << func_id
 		    << " proc=" << _proc << " arglen=" << _arglen
 		    << " before=" << _before_event << " after=" << _finish_event;
@@ -54,6 +64,14 @@ namespace Realm {
 
   bool Task::mark_ready(void)
   {
+    // a continuation is still running as far as everybody else is concerned
+    if(resuming) {
+      log_task.info() << "task " << (void *)this << " resumed: func=" << func_id
+		      << " proc=" << proc << " arglen=" << args.size()
+		      << " after=" << finish_event;
+      return true;
+    }
+
     log_task.info() << "task " << (void *)this << " ready: func=" << func_id
 		    << " proc=" << proc << " arglen=" << args.size()
 		    << " before=" << before_event << " after=" << finish_event;
@@ -89,8 +107,10 @@ namespace Realm {
       status.error_code = error_code;
       status.error_details.set(reason_data, reason_size);
       Thread *t = executing_thread;
-      assert(t != 0);
-      t->signal(Thread::TSIG_INTERRUPT, true /*async*/);
+      // a task suspended as a continuation has no thread - it will notice
+      //  the request when it is resumed
+      if(t != 0)
+	t->signal(Thread::TSIG_INTERRUPT, true /*async*/);
       return true;
     }
 
@@ -98,12 +118,136 @@ namespace Realm {
     return false;
   }
 
+  /*virtual*/ void Task::boost_priority(int new_priority, int depth)
+  {
+    // priorities only ever go up
+    int old_priority = priority;
+    while(true) {
+      if(new_priority <= old_priority)
+	return;
+      int prev = __sync_val_compare_and_swap(&priority, old_priority, new_priority);
+      if(prev == old_priority) break;
+      old_priority = prev;
+    }
+
+    log_task.debug() << "task " << (void *)this << " priority boosted: " << old_priority << " -> " << new_priority;
+
+    switch(__sync_fetch_and_add(&status.result, 0)) {
+    case Status::WAITING:
+      {
+	// not ready yet, so it'll be queued with the new priority - see if
+	//  whatever it's waiting on can be hurried along too
+	if((depth > 0) && before_event.exists())
+	  get_runtime()->optable.boost_priority(before_event, new_priority, depth - 1);
+	break;
+      }
+
+    case Status::READY:
+      {
+	// already in a queue at the old priority - add a second entry at the
+	//  new priority, which holds its own reference
+	PriorityQueue<Task *, GASNetHSL> *q = __sync_fetch_and_add(&ready_queue, 0);
+	if(q) {
+	  add_reference();
+	  q->put(this, new_priority);
+	}
+	break;
+      }
+
+    default:
+      // running or done - too late to help
+      break;
+    }
+  }
+
+  bool Task::claim_for_execution(void)
+  {
+    return __sync_bool_compare_and_swap(&claimed, 0, 1);
+  }
+
+  void Task::request_continuation(Event wait_on, const void *_args, size_t _arglen)
+  {
+    // the last request made by an invocation wins
+    continuation_requested = true;
+    continuation_event = wait_on;
+    continuation_args.set(_args, _arglen);
+  }
+
+  void Task::suspend_for_continuation(void)
+  {
+    continuation_requested = false;
+    log_task.info() << "task " << (void *)this << " suspended: func=" << func_id
+		    << " proc=" << proc << " wait_on=" << continuation_event
+		    << " after=" << finish_event;
+
+    // the body has returned, so nothing refers to the old arguments any more
+    size_t arglen = continuation_args.size();
+    if(arglen <= INLINE_ARG_BYTES) {
+      if(arglen > 0)
+	memcpy(inline_args, continuation_args.base(), arglen);
+      args.changeref(inline_args, arglen);
+      heap_args.clear();
+    } else {
+      heap_args = continuation_args;
+      args.changeref(heap_args.base(), arglen);
+    }
+    continuation_args.clear();
+    executing_thread = 0;
+
+    bool poisoned = false;
+    if(continuation_event.has_triggered_faultaware(poisoned))
+      resume_continuation(poisoned);
+    else
+      EventImpl::add_waiter(continuation_event, &continuation_waiter);
+  }
+
+  void Task::resume_continuation(bool poisoned)
+  {
+    if(poisoned) {
+      log_poison.info() << "terminating poisoned continuation - task=" << (void *)this
+			<< " after=" << finish_event;
+      mark_terminated(Faults::ERROR_POISONED_PRECONDITION,
+		      ByteArray(&continuation_event, sizeof(continuation_event)));
+      return;
+    }
+
+    // any stale entries for this task still sitting in a ready queue (from
+    //  priority boosts) will have failed to claim it until now, and whichever
+    //  entry claims it next will be after the event has triggered
+    resuming = true;
+    __sync_bool_compare_and_swap(&claimed, 1, 0);
+    get_runtime()->get_processor_impl(proc)->enqueue_task(this);
+  }
+
+  bool Task::ContinuationWaiter::event_triggered(Event e, bool poisoned)
+  {
+    task->resume_continuation(poisoned);
+    // we're part of the task - don't delete us
+    return false;
+  }
+
+  void Task::ContinuationWaiter::print(std::ostream& os) const
+  {
+    os << "task continuation: func=" << task->func_id << " proc=" << task->proc
+       << " finish=" << task->get_finish_event();
+  }
+
+  Event Task::ContinuationWaiter::get_finish_event(void) const
+  {
+    return task->get_finish_event();
+  }
+
   void Task::execute_on_processor(Processor p)
   {
     // if the processor isn't specified, use what's in the task object
     if(!p.exists())
       p = this->proc;
 
+    if(queued_counter) {
+      __sync_fetch_and_sub(queued_counter, 1);
+      queued_counter = 0;
+    }
+
     //Processor::TaskFuncPtr fptr = get_runtime()->task_table[func_id];
 #if 0
     char argstr[100];
@@ -134,8 +278,20 @@ namespace Realm {
     // set up any requested performance counters
     thread->setup_perf_counters(measurements);
 
-    // mark that we're starting the task, checking for cancellation
-    bool ok_to_run = mark_started();
+    // mark that we're starting the task, checking for cancellation - a
+    //  resumed continuation has already started, but may have been asked
+    //  to stop while it was suspended
+    bool ok_to_run;
+    if(resuming) {
+      resuming = false;
+      if(__sync_fetch_and_add(&status.result, 0) == Status::INTERRUPT_REQUESTED) {
+	thread->stop_operation(this);
+	mark_terminated(status.error_code, status.error_details);
+	return;
+      }
+      ok_to_run = true;
+    } else
+      ok_to_run = mark_started();
 
     if(ok_to_run) {
       // make sure the current processor is set during execution of the task
@@ -152,9 +308,13 @@ namespace Realm {
 	  thread->stop_perf_counters();
 	  thread->stop_operation(this);
 	  thread->record_perf_counters(measurements);
-	  mark_finished(true /*successful*/);
+	  if(continuation_requested)
+	    suspend_for_continuation();
+	  else
+	    mark_finished(true /*successful*/);
 	}
 	catch (const ExecutionException& e) {
+	  continuation_requested = false;
 	  e.populate_profiling_measurements(measurements);
 	  thread->stop_operation(this);
 	  mark_terminated(e.error_code, e.details);
@@ -168,7 +328,10 @@ namespace Realm {
 	thread->stop_perf_counters();
 	thread->stop_operation(this);
 	thread->record_perf_counters(measurements);
-	mark_finished(true /*successful*/);
+	if(continuation_requested)
+	  suspend_for_continuation();
+	else
+	  mark_finished(true /*successful*/);
       }
 
       // and clear the TLS when we're done
@@ -304,7 +467,8 @@ namespace Realm {
   //
 
   ThreadedTaskScheduler::ThreadedTaskScheduler(void)
-    : shutdown_flag(false)
+    : steal_filter(0)
+    , shutdown_flag(false)
     , active_worker_count(0)
     , unassigned_worker_count(0)
     , wcu_task_queues(this)
@@ -336,6 +500,67 @@ namespace Realm {
     queue->add_subscription(&wcu_task_queues);
   }
 
+  void ThreadedTaskScheduler::add_steal_queue(TaskQueue *queue)
+  {
+    AutoHSLLock al(lock);
+
+    steal_queues.push_back(queue);
+
+    // we want to be woken up when the owner of this queue has work too
+    queue->add_subscription(&wcu_task_queues);
+  }
+
+  void ThreadedTaskScheduler::remove_steal_queues(void)
+  {
+    AutoHSLLock al(lock);
+
+    for(std::vector<TaskQueue *>::const_iterator it = steal_queues.begin();
+	it != steal_queues.end();
+	it++)
+      (*it)->remove_subscription(&wcu_task_queues);
+    steal_queues.clear();
+  }
+
+  void ThreadedTaskScheduler::set_steal_filter(StealFilter *filter)
+  {
+    AutoHSLLock al(lock);
+
+    steal_filter = filter;
+  }
+
+  // attempts to take a task from one of the steal queues - lock must be held
+  Task *ThreadedTaskScheduler::steal_task(int *task_priority)
+  {
+    for(std::vector<TaskQueue *>::const_iterator it = steal_queues.begin();
+	it != steal_queues.end();
+	it++) {
+      // peek first so that we don't disturb the victim's queue for a task we
+      //  can't run
+      Task *task = (*it)->peek(0);
+      if(!task || (steal_filter && !steal_filter->can_steal(task)))
+	continue;
+
+      int priority;
+      Task *stolen = (*it)->get(&priority);
+      if(!stolen)
+	continue;  // owner got there first
+
+      // the owner may also have replaced the front of the queue between the peek
+      //  and the get - double-check anything we didn't look at
+      if((stolen != task) && steal_filter && !steal_filter->can_steal(stolen)) {
+	(*it)->put(stolen, priority, false); // back on front of list
+	continue;
+      }
+
+      log_sched.debug() << "task stolen: sched=" << this << " task=" << (void *)stolen
+			<< " owner=" << stolen->proc;
+      *task_priority = priority;
+      return stolen;
+    }
+
+    return 0;
+  }
+
   // helper for tracking/sanity-checking worker counts
   void ThreadedTaskScheduler::update_worker_count(int active_delta,
 						  int unassigned_delta,
@@ -551,6 +776,17 @@ namespace Realm {
 	  }
 	}
 
+	// if our own queues are empty, see if a peer has work it isn't getting to
+	if(!task && !steal_queues.empty())
+	  task = steal_task(&task_priority);
+
+	// a duplicate entry for a boosted task that already ran (or is running)
+	//  just gets dropped
+	if(task && !task->claim_for_execution()) {
+	  task->remove_reference();
+	  continue;
+	}
+
 	// did we find work to do?
 	if(task) {
 	  // we've now got some assigned work, so fire up a new idle worker if we were the last
@@ -667,6 +903,10 @@ namespace Realm {
     // drop our scheduler lock while we wait
     lock.unlock();
 
+    // if enabled, help with network polling for a bit before going to sleep
+    if(idle_polling_window_ns() > 0)
+      do_idle_polling(work_counter.counter_address(), old_work_counter);
+
     work_counter.wait_for_work(old_work_counter);
 
     lock.lock();
@@ -54,16 +54,67 @@ namespace Realm {
       
       void execute_on_processor(Processor p);
 
+      // raises the task's priority, re-queueing it if it's already ready or
+      //  passing the boost on to its precondition if it's still waiting
+      virtual void boost_priority(int new_priority, int depth);
+
+      // a boosted task can be in a ready queue more than once (each extra
+      //  entry holds a reference) - whoever dequeues an entry must claim the
+      //  task before running it, and drop the reference if the claim fails
+      bool claim_for_execution(void);
+
+      // called (via Processor::continue_task_after) from a running task that
+      //  wants to be run again with new arguments once 'wait_on' triggers
+      //  rather than finishing when it returns
+      void request_continuation(Event wait_on, const void *_args, size_t _arglen);
+
       Processor proc;
       Processor::TaskFuncID func_id;
-      ByteArray args;
+      // refers to either inline_args (for small argument buffers) or heap_args
+      ByteArrayRef args;
       Event before_event;
       int priority;
 
+      // if non-null, decremented when a worker picks up the task (used by
+      //  processors to track their queue depth)
+      int *queued_counter;
+
+      // the queue the task was made ready in, for re-queueing on a boost
+      PriorityQueue<Task *, GASNetHSL> *ready_queue;
+
     protected:
       virtual void mark_completed(void);
 
+      // called once the body has returned after requesting a continuation
+      void suspend_for_continuation(void);
+      void resume_continuation(bool poisoned);
+
+      // a suspended task waits for its continuation's event with this rather
+      //  than with a heap-allocated waiter, so all it costs is the Task itself
+      class ContinuationWaiter : public EventWaiter {
+      public:
+	virtual bool event_triggered(Event e, bool poisoned);
+	virtual void print(std::ostream& os) const;
+	virtual Event get_finish_event(void) const;
+
+	Task *task;
+      };
+
       Thread *executing_thread;
+      int claimed;
+
+      // continuation requested by the running invocation (if any)
+      bool continuation_requested;
+      Event continuation_event;
+      ByteArray continuation_args;
+      // set from when a continuation is requeued until it starts running
+      bool resuming;
+      ContinuationWaiter continuation_waiter;
+
+      // most task arguments are small enough to be stored in the Task itself
+      static const size_t INLINE_ARG_BYTES = 64;
+      ByteArray heap_args;
+      char inline_args[INLINE_ARG_BYTES] __attribute__((aligned(16)));
     };
 
     // a task scheduler in which one or more worker threads execute tasks from one
@@ -82,6 +133,20 @@ namespace Realm {
 
       virtual void add_task_queue(TaskQueue *queue);
 
+      // work stealing: a steal queue belongs to some other scheduler and is only
+      //  consulted when none of our own task queues have anything to offer - the
+      //  (optional) filter decides whether a given task may be run by this scheduler
+      class StealFilter {
+      public:
+	virtual ~StealFilter(void) {}
+	virtual bool can_steal(Task *task) = 0;
+      };
+
+      void add_steal_queue(TaskQueue *queue);
+      // must be called before the owner(s) of any steal queues are destroyed
+      void remove_steal_queues(void);
+      void set_steal_filter(StealFilter *filter);
+
       virtual void start(void) = 0;
       virtual void shutdown(void) = 0;
 
@@ -105,8 +170,13 @@ namespace Realm {
       virtual void worker_wake(Thread *to_wake) = 0;
       virtual void worker_terminate(Thread *switch_to) = 0;
 
+      // attempts to take a task from one of the steal queues - lock must be held
+      Task *steal_task(int *task_priority);
+
       GASNetHSL lock;
       std::vector<TaskQueue *> task_queues;
+      std::vector<TaskQueue *> steal_queues;
+      StealFilter *steal_filter;
       std::vector<Thread *> idle_workers;
       std::set<Thread *> blocked_workers;
 
@@ -138,6 +208,9 @@ namespace Realm {
 
 	long long read_counter(void) const;
 
+	// for code that wants to watch the counter without taking locks
+	const volatile long long *counter_address(void) const { return &counter; }
+
 	// returns true if there is new work since the old_counter value was read
 	// this is non-blocking, and may be called while holding another lock
 	bool check_for_work(long long old_counter);
@@ -35,6 +35,15 @@
 #endif
 
 #ifdef REALM_USE_USER_THREADS
+// on x86_64 Linux, user threads switch with a few instructions of assembly
+//  that only save callee-saved state - swapcontext also saves/restores the
+//  signal mask, which costs a system call on every switch
+#if defined(__x86_64__) && defined(__linux__) && !defined(REALM_NO_FAST_USWITCH)
+#define REALM_USE_FAST_USWITCH
+#endif
+#include <sys/mman.h>
+#include <unistd.h>
+#include <stdint.h>
 #include <ucontext.h>
 #ifdef __MACH__
 // MacOS has (loudly) deprecated set/get/make/swapcontext,
@@ -62,6 +71,7 @@ inline void makecontext_wrap(ucontext_t *u, void (*fn)(), int args, ...) { makec
 #include <signal.h>
 #include <string>
 #include <map>
+#include <vector>
 
 #ifdef __linux__
 // needed for scanning Linux's /sys
@@ -72,6 +82,13 @@ inline void makecontext_wrap(ucontext_t *u, void (*fn)(), int args, ...) { makec
 #endif
 #endif
 
+#ifdef REALM_USE_PERF_EVENTS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdint.h>
+#endif
+
 #ifndef CHECK_LIBC
 #define CHECK_LIBC(cmd) do { \
   errno = 0; \
@@ -104,6 +121,10 @@ namespace Realm {
   };
 #endif
 
+#ifdef REALM_USE_PERF_EVENTS
+  Logger log_perfev("perfevent");
+#endif
+
   namespace ThreadLocal {
     /*extern*/ __thread Thread *current_thread = 0;
   };
@@ -266,6 +287,79 @@ namespace Realm {
     }
   }
 
+  typedef std::map<const CoreMap::Proc *, CoreReservationParameters::CoreUsage> CoreUsageMap;
+
+  // assigns procs from 'candidates' (in order) to 'rsrv' until it has enough,
+  //  updating the usage maps as it goes - returns false if it came up short
+  static bool assign_procs(CoreReservation *rsrv, bool has_exclusive,
+			   const std::vector<const CoreMap::Proc *>& candidates,
+			   CoreUsageMap& alu_usage, CoreUsageMap& fpu_usage,
+			   CoreUsageMap& ldst_usage,
+			   std::set<const CoreMap::Proc *>& procs)
+  {
+    // iterate over all the possibly available processors and see if any fit
+    for(std::vector<const CoreMap::Proc *>::const_iterator it = candidates.begin();
+	it != candidates.end();
+	it++)
+    {
+      const CoreMap::Proc *p = *it;
+
+      // is there already conflicting usage?
+      if(!(can_add_usage(alu_usage, rsrv->params.alu_usage, p, p->shares_alu) &&
+	   can_add_usage(fpu_usage, rsrv->params.fpu_usage, p, p->shares_fpu) &&
+	   can_add_usage(ldst_usage, rsrv->params.ldst_usage, p, p->shares_ldst)))
+	continue;
+
+      // yes, do so and add this to the assigned procs
+      add_usage(alu_usage, rsrv->params.alu_usage, p, p->shares_alu);
+      add_usage(fpu_usage, rsrv->params.fpu_usage, p, p->shares_fpu);
+      add_usage(ldst_usage, rsrv->params.ldst_usage, p, p->shares_ldst);
+      procs.insert(p);
+
+      // an exclusive reservation request stops as soon as we have enough, while
+      //  a shared reservation will use any/all compatible processors
+      if(has_exclusive && ((int)(procs.size()) >= rsrv->params.num_cores))
+	break;
+    }
+
+    return ((int)(procs.size()) >= rsrv->params.num_cores);
+  }
+
+  // returns the (known) cache domains of the procs that have been given to
+  //  'rsrv', either in an existing allocation or earlier in this attempt
+  static bool get_cache_domains(const CoreMap& cm, const CoreReservation *rsrv,
+				const std::map<CoreReservation *, CoreReservation::Allocation *>& allocs,
+				const std::map<CoreReservation *, std::set<const CoreMap::Proc *> >& assigned_procs,
+				std::set<int>& domains)
+  {
+    std::map<CoreReservation *, std::set<const CoreMap::Proc *> >::const_iterator it =
+      assigned_procs.find(const_cast<CoreReservation *>(rsrv));
+    if(it != assigned_procs.end()) {
+      for(std::set<const CoreMap::Proc *>::const_iterator it2 = it->second.begin();
+	  it2 != it->second.end();
+	  it2++)
+	if((*it2)->cache_domain != CoreMap::CACHE_DOMAIN_UNKNOWN)
+	  domains.insert((*it2)->cache_domain);
+      return true;
+    }
+
+    std::map<CoreReservation *, CoreReservation::Allocation *>::const_iterator it2 =
+      allocs.find(const_cast<CoreReservation *>(rsrv));
+    if((it2 != allocs.end()) && it2->second) {
+      for(std::set<int>::const_iterator it3 = it2->second->proc_ids.begin();
+	  it3 != it2->second->proc_ids.end();
+	  it3++) {
+	CoreMap::ProcMap::const_iterator it4 = cm.all_procs.find(*it3);
+	if((it4 != cm.all_procs.end()) &&
+	   (it4->second->cache_domain != CoreMap::CACHE_DOMAIN_UNKNOWN))
+	  domains.insert(it4->second->cache_domain);
+      }
+      return true;
+    }
+
+    return false;
+  }
+
   // attempts to find an allocation satisfying all the reservation requests in 'allocs' -
   //  if any allocations are already present, those are preserved (possibly causing the
   //  allocation attempt to fail)
@@ -273,7 +367,7 @@ namespace Realm {
 				 std::map<CoreReservation *, CoreReservation::Allocation *>& allocs)
   {
     // we'll need to keep track of the usage level of each core
-    std::map<const CoreMap::Proc *, CoreReservationParameters::CoreUsage> alu_usage, fpu_usage, ldst_usage;
+    CoreUsageMap alu_usage, fpu_usage, ldst_usage;
     std::map<const CoreMap::Proc *, int> user_count;
 
     // iterate through the requests and sort them by whether or not they have any exclusivity
@@ -360,39 +454,63 @@ namespace Realm {
 	}
       }
 
+      // reservations with a cache affinity to another reservation in this
+      //  same group go after the others so that their target is placed first
+      std::vector<CoreReservation *> ordered, dependent;
       for(std::set<CoreReservation *>::iterator it2 = it->second.begin();
 	  it2 != it->second.end();
 	  it2++) {
+	const CoreReservation *target = (*it2)->params.cache_affinity_rsrv;
+	if(((*it2)->params.cache_affinity != CoreReservationParameters::CACHE_AFFINITY_DONTCARE) &&
+	   target && (it->second.count(const_cast<CoreReservation *>(target)) > 0))
+	  dependent.push_back(*it2);
+	else
+	  ordered.push_back(*it2);
+      }
+      ordered.insert(ordered.end(), dependent.begin(), dependent.end());
+
+      for(std::vector<CoreReservation *>::iterator it2 = ordered.begin();
+	  it2 != ordered.end();
+	  it2++) {
 	CoreReservation *rsrv = *it2;
 	std::set<const CoreMap::Proc *>& procs = assigned_procs[rsrv];
 
-	// iterate over all the possibly available processors and see if any fit
-	for(std::vector<const CoreMap::Proc *>::iterator it3 = pm.begin();
-	    it3 != pm.end();
-	    it3++)
-	{
-	  const CoreMap::Proc *p = *it3;
-
-	  // is there already conflicting usage?
-	  if(!(can_add_usage(alu_usage, rsrv->params.alu_usage, p, p->shares_alu) &&
-	       can_add_usage(fpu_usage, rsrv->params.fpu_usage, p, p->shares_fpu) &&
-	       can_add_usage(ldst_usage, rsrv->params.ldst_usage, p, p->shares_ldst)))
-	    continue;
-
-	  // yes, do so and add this to the assigned procs
-	  add_usage(alu_usage, rsrv->params.alu_usage, p, p->shares_alu);
-	  add_usage(fpu_usage, rsrv->params.fpu_usage, p, p->shares_fpu);
-	  add_usage(ldst_usage, rsrv->params.ldst_usage, p, p->shares_ldst);
-	  procs.insert(p);
-
-	  // an exclusive reservation request stops as soon as we have enough, while
-	  //  a shared reservation will use any/all compatible processors
-	  if(has_exclusive && ((int)(procs.size()) >= rsrv->params.num_cores))
-	    break;
+	// with a cache affinity, first try only the procs that satisfy it
+	bool assigned = false;
+	std::set<int> target_domains;
+	if((rsrv->params.cache_affinity != CoreReservationParameters::CACHE_AFFINITY_DONTCARE) &&
+	   rsrv->params.cache_affinity_rsrv &&
+	   get_cache_domains(cm, rsrv->params.cache_affinity_rsrv,
+			     allocs, assigned_procs, target_domains) &&
+	   !target_domains.empty()) {
+	  bool want_same = (rsrv->params.cache_affinity == CoreReservationParameters::CACHE_AFFINITY_SAME);
+	  std::vector<const CoreMap::Proc *> preferred;
+	  for(std::vector<const CoreMap::Proc *>::const_iterator it3 = pm.begin();
+	      it3 != pm.end();
+	      it3++)
+	    if(((*it3)->cache_domain != CoreMap::CACHE_DOMAIN_UNKNOWN) &&
+	       ((target_domains.count((*it3)->cache_domain) > 0) == want_same))
+	      preferred.push_back(*it3);
+
+	  // work on copies of the usage so a failed attempt leaves no trace
+	  CoreUsageMap alu_copy(alu_usage), fpu_copy(fpu_usage), ldst_copy(ldst_usage);
+	  std::set<const CoreMap::Proc *> procs_copy;
+	  if(assign_procs(rsrv, has_exclusive, preferred,
+			  alu_copy, fpu_copy, ldst_copy, procs_copy)) {
+	    alu_usage.swap(alu_copy);
+	    fpu_usage.swap(fpu_copy);
+	    ldst_usage.swap(ldst_copy);
+	    procs.swap(procs_copy);
+	    assigned = true;
+	  } else
+	    log_thread.info() << "reservation ('" << rsrv->name << "') cannot satisfy cache affinity to '"
+			      << rsrv->params.cache_affinity_rsrv->name << "' - ignoring";
 	}
 
-	// if we didn't get enough, we've failed this allocation
-	if((int)(procs.size()) < rsrv->params.num_cores) {
+	if(!assigned &&
+	   !assign_procs(rsrv, has_exclusive, pm,
+			 alu_usage, fpu_usage, ldst_usage, procs)) {
+	  // if we didn't get enough, we've failed this allocation
 	  log_thread.warning() << "reservation ('" << rsrv->name << "') cannot be satisfied";
 	  return false;
 	}
@@ -829,20 +947,175 @@ namespace Realm {
   // class UserThread
 
 #ifdef REALM_USE_USER_THREADS
+#ifdef REALM_USE_FAST_USWITCH
+  // a user context is just a saved stack pointer - the callee-saved registers
+  //  and the SSE/x87 control words are pushed onto the stack being switched
+  //  away from
+  struct UserContext {
+    void *sp;
+  };
+
+  extern "C" void realm_uswitch_x86_64(void **save_sp, void *new_sp);
+
+  asm(".text\n"
+      ".globl realm_uswitch_x86_64\n"
+      ".hidden realm_uswitch_x86_64\n"
+      ".type realm_uswitch_x86_64,@function\n"
+      "realm_uswitch_x86_64:\n"
+      "  pushq %rbp\n"
+      "  pushq %rbx\n"
+      "  pushq %r12\n"
+      "  pushq %r13\n"
+      "  pushq %r14\n"
+      "  pushq %r15\n"
+      "  subq $8, %rsp\n"
+      "  stmxcsr (%rsp)\n"
+      "  fnstcw 4(%rsp)\n"
+      "  movq %rsp, (%rdi)\n"
+      "  movq %rsi, %rsp\n"
+      "  ldmxcsr (%rsp)\n"
+      "  fldcw 4(%rsp)\n"
+      "  addq $8, %rsp\n"
+      "  popq %r15\n"
+      "  popq %r14\n"
+      "  popq %r13\n"
+      "  popq %r12\n"
+      "  popq %rbx\n"
+      "  popq %rbp\n"
+      "  ret\n"
+      ".size realm_uswitch_x86_64,.-realm_uswitch_x86_64\n");
+
+  static int init_user_context(UserContext *ctx, void *stack_base, size_t stack_size,
+			       void (*entry)(void))
+  {
+    // build the frame realm_uswitch_x86_64 expects to pop: control words,
+    //  six callee-saved registers, and a "return" address of the entry
+    //  point, which must see the stack as if it had just been called
+    uintptr_t top = (reinterpret_cast<uintptr_t>(stack_base) + stack_size) & ~(uintptr_t)15;
+    unsigned long long *sp = reinterpret_cast<unsigned long long *>(top);
+    *--sp = 0;  // fake return address for the entry function
+    *--sp = reinterpret_cast<uintptr_t>(entry);
+    for(int i = 0; i < 6; i++)
+      *--sp = 0;  // rbp, rbx, r12-r15
+    unsigned mxcsr;
+    unsigned short fpucw;
+    asm volatile("stmxcsr %0" : "=m" (mxcsr));
+    asm volatile("fnstcw %0" : "=m" (fpucw));
+    *--sp = (((unsigned long long)fpucw) << 32) | mxcsr;
+    ctx->sp = sp;
+    return 0;
+  }
+
+  static inline int switch_user_context(UserContext *from, UserContext *to)
+  {
+    realm_uswitch_x86_64(&from->sp, to->sp);
+    return 0;
+  }
+#else
+  typedef ucontext_t UserContext;
+
+  static int init_user_context(UserContext *ctx, void *stack_base, size_t stack_size,
+			       void (*entry)(void))
+  {
+    int ret = getcontext(ctx);
+    if(ret != 0)
+      return ret;
+
+    ctx->uc_link = 0; // we don't expect it to ever fall through
+    ctx->uc_stack.ss_sp = stack_base;
+    ctx->uc_stack.ss_size = stack_size;
+    ctx->uc_stack.ss_flags = 0;
+
+    // grr...  entry point takes int's, which might not hold a void *
+    // we'll just fish our UserThread * out of TLS
+    makecontext(ctx, entry, 0);
+    return 0;
+  }
+
+  static inline int switch_user_context(UserContext *from, UserContext *to)
+  {
+    return swapcontext(from, to);
+  }
+#endif
+
+  // user thread stacks are mmap'd with an inaccessible guard page below them
+  //  (so an overflow faults instead of silently corrupting the heap) and are
+  //  recycled through a per-size pool instead of being unmapped, since worker
+  //  threads come and go as tasks block
+  namespace UserThreadStacks {
+    static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+    static std::map<size_t, std::vector<void *> > pool;
+    static const size_t MAX_POOLED_PER_SIZE = 256;
+
+    static size_t page_size(void)
+    {
+      static size_t cached = 0;
+      if(cached == 0)
+	cached = sysconf(_SC_PAGESIZE);
+      return cached;
+    }
+
+    // rounds up to whole pages
+    static size_t adjust_size(size_t size)
+    {
+      size_t pgsz = page_size();
+      return (size + pgsz - 1) & ~(pgsz - 1);
+    }
+
+    static void *alloc_stack(size_t size)
+    {
+      pthread_mutex_lock(&pool_mutex);
+      std::vector<void *>& free_stacks = pool[size];
+      if(!free_stacks.empty()) {
+	void *base = free_stacks.back();
+	free_stacks.pop_back();
+	pthread_mutex_unlock(&pool_mutex);
+	return base;
+      }
+      pthread_mutex_unlock(&pool_mutex);
+
+      size_t guard = page_size();
+      int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_STACK
+      flags |= MAP_STACK;
+#endif
+      void *mapping = mmap(0, size + guard, PROT_READ | PROT_WRITE, flags, -1, 0);
+      if(mapping == MAP_FAILED) {
+	log_thread.fatal() << "failed to map user thread stack: size=" << size << " errno=" << errno;
+	assert(0);
+      }
+      CHECK_LIBC( mprotect(mapping, guard, PROT_NONE) );
+      return static_cast<char *>(mapping) + guard;
+    }
+
+    static void free_stack(void *base, size_t size)
+    {
+      pthread_mutex_lock(&pool_mutex);
+      std::vector<void *>& free_stacks = pool[size];
+      if(free_stacks.size() < MAX_POOLED_PER_SIZE) {
+	free_stacks.push_back(base);
+	pthread_mutex_unlock(&pool_mutex);
+	return;
+      }
+      pthread_mutex_unlock(&pool_mutex);
+
+      size_t guard = page_size();
+      munmap(static_cast<char *>(base) - guard, size + guard);
+    }
+  };
+
   namespace {
     int uswitch_test_check_flag = 1;
-    ucontext_t uswitch_test_ctx1, uswitch_test_ctx2;
+    UserContext uswitch_test_ctx1, uswitch_test_ctx2;
 
-    void uswitch_test_entry(int arg)
+    void uswitch_test_entry(void)
     {
-      log_thread.debug() << "uswitch test: adding: " << uswitch_test_check_flag << " " << arg;
-      __sync_fetch_and_add(&uswitch_test_check_flag, arg);
+      log_thread.debug() << "uswitch test: adding: " << uswitch_test_check_flag << " 66";
+      __sync_fetch_and_add(&uswitch_test_check_flag, 66);
       errno = 0;
-      int ret = swapcontext(&uswitch_test_ctx2, &uswitch_test_ctx1);
-      if(ret != 0) {
-	log_thread.fatal() << "uswitch test: swap out failed: " << ret << " " << errno;
-	assert(0);
-      }
+      int ret = switch_user_context(&uswitch_test_ctx2, &uswitch_test_ctx1);
+      log_thread.fatal() << "uswitch test: swap out failed: " << ret << " " << errno;
+      assert(0);
     }
   }
 
@@ -850,44 +1123,35 @@ namespace Realm {
   //  reasons unknown, so allow code to test to see if it's working first
   /*static*/ bool Thread::test_user_switch_support(size_t stack_size /*= 1 << 20*/)
   {
+    stack_size = UserThreadStacks::adjust_size(stack_size);
+    void *stack_base = UserThreadStacks::alloc_stack(stack_size);
+
     errno = 0;
-    int ret;
-    ret = getcontext(&uswitch_test_ctx2);
+    int ret = init_user_context(&uswitch_test_ctx2, stack_base, stack_size,
+				uswitch_test_entry);
     if(ret != 0) {
       log_thread.info() << "uswitch test: getcontext failed: " << ret << " " << errno;
+      UserThreadStacks::free_stack(stack_base, stack_size);
       return false;
     }
-    void *stack_base = malloc(stack_size);
-    if(!stack_base) {
-      log_thread.info() << "uswitch test: stack malloc failed";
-      return false;
-    }
-    uswitch_test_ctx2.uc_link = 0; // we don't expect it to ever fall through
-    uswitch_test_ctx2.uc_stack.ss_sp = stack_base;
-    uswitch_test_ctx2.uc_stack.ss_size = stack_size;
-    uswitch_test_ctx2.uc_stack.ss_flags = 0;
-    makecontext(&uswitch_test_ctx2,
-		reinterpret_cast<void(*)()>(uswitch_test_entry),
-		1, 66);
 
     // now try to swap and back
     errno = 0;
-    ret = swapcontext(&uswitch_test_ctx1, &uswitch_test_ctx2);
+    ret = switch_user_context(&uswitch_test_ctx1, &uswitch_test_ctx2);
     if(ret != 0) {
       log_thread.info() << "uswitch test: swap in failed: " << ret << " " << errno;
-      free(stack_base);
+      UserThreadStacks::free_stack(stack_base, stack_size);
       return false;
     }
 
     int val = __sync_fetch_and_add(&uswitch_test_check_flag, 0);
+    UserThreadStacks::free_stack(stack_base, stack_size);
     if(val != 67) {
       log_thread.info() << "uswitch test: val mismatch: " << val << " != 67";
-      free(stack_base);
       return false;
     }
 
     log_thread.debug() << "uswitch test: check succeeded";
-    free(stack_base);
     return true;
   }
 
@@ -915,11 +1179,9 @@ namespace Realm {
     void *target;
     void (*entry_wrapper)(void *);
     int magic;
-#ifndef __MACH__
-    ucontext_t ctx;
-#else
+    UserContext ctx;
+#ifdef __MACH__
     // valgrind says Darwin's getcontext is writing past the end of ctx?
-    ucontext_t ctx;
     int padding[512];
 #endif
     void *stack_base;
@@ -943,11 +1205,11 @@ namespace Realm {
     assert(!running);
 
     if(stack_base != 0)
-      free(stack_base);
+      UserThreadStacks::free_stack(stack_base, stack_size);
   }
 
   namespace ThreadLocal {
-    __thread ucontext_t *host_context = 0;
+    __thread UserContext *host_context = 0;
     // current_user_thread is redundant with current_thread, but kept for debugging
     //  purposes for now
     __thread UserThread *current_user_thread = 0;
@@ -999,19 +1261,10 @@ namespace Realm {
       stack_size = 2 << 20; // pick something - 2MB ?
     }
 
-    stack_base = malloc(stack_size);
-    assert(stack_base != 0);
-
-    CHECK_LIBC( getcontext(&ctx) );
+    stack_size = UserThreadStacks::adjust_size(stack_size);
+    stack_base = UserThreadStacks::alloc_stack(stack_size);
 
-    ctx.uc_link = 0; // we don't expect it to ever fall through
-    ctx.uc_stack.ss_sp = stack_base;
-    ctx.uc_stack.ss_size = stack_size;
-    ctx.uc_stack.ss_flags = 0;
-
-    // grr...  entry point takes int's, which might not hold a void *
-    // we'll just fish our UserThread * out of TLS
-    makecontext(&ctx, uthread_entry, 0);
+    CHECK_LIBC( init_user_context(&ctx, stack_base, stack_size, uthread_entry) );
 
     update_state(STATE_STARTUP);    
   }
@@ -1043,14 +1296,14 @@ namespace Realm {
       assert(ThreadLocal::host_context == 0);
 
       // this holds the host's state
-      ucontext_t host_ctx;
+      UserContext host_ctx;
 
       ThreadLocal::host_context = &host_ctx;
       ThreadLocal::current_user_thread = switch_to;
       ThreadLocal::current_host_thread = ThreadLocal::current_thread;
       ThreadLocal::current_thread = switch_to;
 
-      CHECK_LIBC( swapcontext(&host_ctx, &switch_to->ctx) );
+      CHECK_LIBC( switch_user_context(&host_ctx, &switch_to->ctx) );
 
       assert(ThreadLocal::current_user_thread == 0);
       assert(ThreadLocal::host_context == &host_ctx);
@@ -1069,7 +1322,7 @@ namespace Realm {
 	ThreadLocal::current_thread = switch_to;
 
 	// a switch between two user contexts - nice and simple
-	CHECK_LIBC( swapcontext(&switch_from->ctx, &switch_to->ctx) );
+	CHECK_LIBC( switch_user_context(&switch_from->ctx, &switch_to->ctx) );
 
 	assert(switch_from->running == false);
 	switch_from->host_pthread = pthread_self();
@@ -1081,7 +1334,7 @@ namespace Realm {
 	ThreadLocal::current_thread = ThreadLocal::current_host_thread;
 	ThreadLocal::current_host_thread = 0;
 
-	CHECK_LIBC( swapcontext(&switch_from->ctx, ThreadLocal::host_context) );
+	CHECK_LIBC( switch_user_context(&switch_from->ctx, ThreadLocal::host_context) );
 
 	// if we get control back
 	assert(switch_from->running == false);
@@ -1187,23 +1440,31 @@ namespace Realm {
 	it++)
       delete it->second;
 
-    // now clear out the two maps
+    // now clear out the maps
     all_procs.clear();
     by_domain.clear();
+    by_cache_domain.clear();
   }
 
   /*static*/ CoreMap *CoreMap::create_synthetic(int num_domains,
 						int cores_per_domain,
 						int hyperthreads /*= 1*/,
-						int fp_cluster_size /*= 1*/)
+						int fp_cluster_size /*= 1*/,
+						int cache_domain_size /*= 0*/)
   {
     CoreMap *cm = new CoreMap;
 
     // processor ids will just be monotonically increasing
     int next_id = 0;
 
+    if(cache_domain_size <= 0)
+      cache_domain_size = cores_per_domain;
+    int caches_per_domain = (cores_per_domain + cache_domain_size - 1) / cache_domain_size;
+
     for(int d = 0; d < num_domains; d++) {
       for(int c = 0; c < cores_per_domain; c++) {
+	int cache_domain = (d * caches_per_domain) + (c / cache_domain_size);
+
 	std::set<Proc *> fp_procs;
 
 	for(int f = 0; f < fp_cluster_size; f++) {
@@ -1216,10 +1477,12 @@ namespace Realm {
 
 	    p->id = id;
 	    p->domain = d;
+	    p->cache_domain = cache_domain;
 	    // kernel proc id list is empty - this is synthetic
 
 	    cm->all_procs[id] = p;
 	    cm->by_domain[d][id] = p;
+	    cm->by_cache_domain[cache_domain][id] = p;
 
 	    ht_procs.insert(p);
 	    fp_procs.insert(p);
@@ -1270,6 +1533,44 @@ namespace Realm {
   }
 
 #ifdef __linux__
+  // the last-level cache domain of a cpu is named by the lowest-numbered cpu
+  //  that shares the highest-level data/unified cache with it
+  static int linux_cache_domain(int cpu_id)
+  {
+    int best_level = 0;
+    int domain = CoreMap::CACHE_DOMAIN_UNKNOWN;
+    for(int index = 0; ; index++) {
+      char path[1024];
+      sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/level", cpu_id, index);
+      FILE *f = fopen(path, "r");
+      if(!f) break;  // no more caches
+      int level;
+      int count = fscanf(f, "%d", &level);
+      fclose(f);
+      if((count != 1) || (level <= best_level)) continue;
+
+      sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/type", cpu_id, index);
+      f = fopen(path, "r");
+      if(!f) continue;
+      char type[32];
+      count = fscanf(f, "%31s", type);
+      fclose(f);
+      if((count != 1) || !strcmp(type, "Instruction")) continue;
+
+      sprintf(path, "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", cpu_id, index);
+      f = fopen(path, "r");
+      if(!f) continue;
+      int first_cpu;
+      count = fscanf(f, "%d", &first_cpu);
+      fclose(f);
+      if(count != 1) continue;
+
+      best_level = level;
+      domain = first_cpu;
+    }
+    return domain;
+  }
+
   static CoreMap *extract_core_map_from_linux_sys(bool hyperthread_sharing)
   {
     cpu_set_t cset;
@@ -1337,10 +1638,13 @@ namespace Realm {
 
 	p->id = cpu_id;
 	p->domain = node_id;
+	p->cache_domain = linux_cache_domain(cpu_id);
 	p->kernel_proc_ids.insert(cpu_id);
 
 	cm->all_procs[cpu_id] = p;
 	cm->by_domain[node_id][cpu_id] = p;
+	if(p->cache_domain != CoreMap::CACHE_DOMAIN_UNKNOWN)
+	  cm->by_cache_domain[p->cache_domain][cpu_id] = p;
 
 	// add to HT sets to deal with in a bit
 	ht_sets[std::make_pair(node_id, core_id)].insert(p);
@@ -1422,6 +1726,21 @@ namespace Realm {
   }
 #endif
 
+  // the outermost cache above an object is its last-level cache domain
+  static int hwloc_cache_domain(hwloc_obj_t obj)
+  {
+    int domain = CoreMap::CACHE_DOMAIN_UNKNOWN;
+    for(hwloc_obj_t a = obj->parent; a; a = a->parent) {
+#if HWLOC_API_VERSION >= 0x00020000
+      if(hwloc_obj_type_is_cache(a->type))
+#else
+      if(a->type == HWLOC_OBJ_CACHE)
+#endif
+	domain = a->logical_index;
+    }
+    return domain;
+  }
+
   static CoreMap *extract_core_map_from_hwloc(bool hyperthread_sharing)
   {
     CoreMap *cm = new CoreMap;
@@ -1449,10 +1768,13 @@ namespace Realm {
 
           p->id = cpu_id;
           p->domain = node_id;
+          p->cache_domain = hwloc_cache_domain(obj);
           p->kernel_proc_ids.insert(cpu_id);
 
           cm->all_procs[cpu_id] = p;
           cm->by_domain[node_id][cpu_id] = p;
+          if(p->cache_domain != CoreMap::CACHE_DOMAIN_UNKNOWN)
+            cm->by_cache_domain[p->cache_domain][cpu_id] = p;
 
           // add to HT sets to deal with in a bit
           ht_sets[std::make_pair(node_id, core_id)].insert(p);
@@ -1495,6 +1817,7 @@ namespace Realm {
       int num_cores = 1;
       int hyperthreads = 1;
       int fp_cluster_size = 1;
+      int cache_domain_size = 0;
       while(true) {
 	if(!(p[0] && (p[1] == '=') && isdigit(p[2]))) break;
 
@@ -1505,6 +1828,7 @@ namespace Realm {
 	if(p[0] == 'c') num_cores = x; else
 	if(p[0] == 'h') hyperthreads = x; else
 	if(p[0] == 'f') fp_cluster_size = x; else
+	if(p[0] == 'l') cache_domain_size = x; else
 	  break;
 	p = p2;
 
@@ -1514,7 +1838,8 @@ namespace Realm {
       }
       // if parsing reached the end of string, we're good
       if(*p == 0) {
-	return CoreMap::create_synthetic(num_domains, num_cores, hyperthreads, fp_cluster_size);
+	return CoreMap::create_synthetic(num_domains, num_cores, hyperthreads, fp_cluster_size,
+					 cache_domain_size);
       } else {
 	const char *orig = getenv("REALM_SYNTHETIC_CORE_MAP");
 	log_thread.error("Error parsing REALM_SYNTHETIC_CORE_MAP: '%.*s(^)%s'",
@@ -1582,6 +1907,8 @@ namespace Realm {
 	  }
 	  os << ">";
 	}
+	if(p->cache_domain != CoreMap::CACHE_DOMAIN_UNKNOWN)
+	  os << " cache=" << p->cache_domain;
 
 	show_share_set(os, "alu", p->shares_alu);
 	show_share_set(os, "fpu", p->shares_fpu);
@@ -1829,6 +2156,325 @@ namespace Realm {
 #endif
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class PerfEventCounters
+
+#ifdef REALM_USE_PERF_EVENTS
+  namespace PerfEvents {
+
+    struct EventDesc {
+      uint32_t type;
+      uint64_t config;
+    };
+
+#define REALM_HW_CACHE(id, result) \
+    (PERF_COUNT_HW_CACHE_##id | (PERF_COUNT_HW_CACHE_OP_READ << 8) | \
+     (PERF_COUNT_HW_CACHE_RESULT_##result << 16))
+
+    // indexed by PerfEventCounters::EVENT_*
+    static const EventDesc event_descs[PerfEventCounters::NUM_EVENTS] = {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+      { PERF_TYPE_HW_CACHE, REALM_HW_CACHE(L1I, ACCESS) },
+      { PERF_TYPE_HW_CACHE, REALM_HW_CACHE(L1I, MISS) },
+      { PERF_TYPE_HW_CACHE, REALM_HW_CACHE(L1D, ACCESS) },
+      { PERF_TYPE_HW_CACHE, REALM_HW_CACHE(L1D, MISS) },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+      { PERF_TYPE_HW_CACHE, REALM_HW_CACHE(ITLB, MISS) },
+      { PERF_TYPE_HW_CACHE, REALM_HW_CACHE(DTLB, MISS) },
+    };
+
+#undef REALM_HW_CACHE
+
+    // small groups are read with a single syscall and fit in the general
+    //  purpose counters of every PMU we care about - the kernel multiplexes
+    //  between groups if there are more than the hardware can hold at once
+    static const int MAX_GROUP_SIZE = 4;
+
+    // counters opened by a kernel thread - these count only while that
+    //  thread is running, and are never closed until the thread exits
+    struct HostCounters {
+      int fds[PerfEventCounters::NUM_EVENTS];    // -1 = not opened yet
+      bool unavailable[PerfEventCounters::NUM_EVENTS];
+      int group[PerfEventCounters::NUM_EVENTS];  // which group
+      int slot[PerfEventCounters::NUM_EVENTS];   // position in group
+      int leader_fds[PerfEventCounters::NUM_EVENTS];
+      int group_sizes[PerfEventCounters::NUM_EVENTS];
+      int num_groups;
+    };
+
+    static __thread HostCounters *host_counters = 0;
+    static pthread_key_t host_counters_key;
+    static pthread_once_t host_counters_once = PTHREAD_ONCE_INIT;
+
+    static void destroy_host_counters(void *arg)
+    {
+      HostCounters *hc = static_cast<HostCounters *>(arg);
+      // close members before their group leaders
+      for(int i = PerfEventCounters::NUM_EVENTS - 1; i >= 0; i--)
+	if(hc->fds[i] >= 0)
+	  close(hc->fds[i]);
+      delete hc;
+    }
+
+    static void create_host_counters_key(void)
+    {
+      pthread_key_create(&host_counters_key, destroy_host_counters);
+    }
+
+    static HostCounters *get_host_counters(void)
+    {
+      if(!host_counters) {
+	pthread_once(&host_counters_once, create_host_counters_key);
+	HostCounters *hc = new HostCounters;
+	for(int i = 0; i < PerfEventCounters::NUM_EVENTS; i++) {
+	  hc->fds[i] = -1;
+	  hc->unavailable[i] = false;
+	}
+	hc->num_groups = 0;
+	pthread_setspecific(host_counters_key, hc);
+	host_counters = hc;
+      }
+      return host_counters;
+    }
+
+    // opens any events in 'mask' that this kernel thread hasn't opened yet,
+    //  returning the subset of 'mask' that is actually available
+    static unsigned open_events(HostCounters *hc, unsigned mask)
+    {
+      unsigned avail = 0;
+      for(int i = 0; i < PerfEventCounters::NUM_EVENTS; i++) {
+	if(!(mask & (1U << i))) continue;
+	if(hc->unavailable[i]) continue;
+	if(hc->fds[i] >= 0) {
+	  avail |= (1U << i);
+	  continue;
+	}
+
+	// join the newest group if it has room, otherwise start a new one
+	int g = hc->num_groups - 1;
+	bool new_group = ((g < 0) || (hc->group_sizes[g] >= MAX_GROUP_SIZE));
+
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = event_descs[i].type;
+	attr.config = event_descs[i].config;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.read_format = (PERF_FORMAT_GROUP |
+			    PERF_FORMAT_TOTAL_TIME_ENABLED |
+			    PERF_FORMAT_TOTAL_TIME_RUNNING);
+	int fd = syscall(__NR_perf_event_open, &attr,
+			 0 /*this thread*/, -1 /*any cpu*/,
+			 (new_group ? -1 : hc->leader_fds[g]), 0);
+	if(fd < 0) {
+	  log_perfev.info() << "event " << i << " unavailable: " << strerror(errno);
+	  hc->unavailable[i] = true;
+	  continue;
+	}
+
+	if(new_group) {
+	  g = hc->num_groups++;
+	  hc->leader_fds[g] = fd;
+	  hc->group_sizes[g] = 0;
+	}
+	hc->fds[i] = fd;
+	hc->group[i] = g;
+	hc->slot[i] = hc->group_sizes[g]++;
+	avail |= (1U << i);
+      }
+      return avail;
+    }
+
+    // reads the current value of every event in 'mask', along with the
+    //  enabled/running times of its group (for multiplexing correction)
+    static void read_events(HostCounters *hc, unsigned mask,
+			    long long *vals, long long *enabled,
+			    long long *running)
+    {
+      uint64_t buffer[3 + MAX_GROUP_SIZE];
+      int last_group = -1;
+      for(int i = 0; i < PerfEventCounters::NUM_EVENTS; i++) {
+	if(!(mask & (1U << i))) continue;
+	int g = hc->group[i];
+	if(g != last_group) {
+	  ssize_t amt = read(hc->leader_fds[g], buffer, sizeof(buffer));
+	  if(amt < (ssize_t)(3 * sizeof(uint64_t)))
+	    memset(buffer, 0, sizeof(buffer));
+	  last_group = g;
+	}
+	// layout is { nr, time_enabled, time_running, value[nr] }
+	vals[i] = ((hc->slot[i] < (int)buffer[0]) ? buffer[3 + hc->slot[i]] : 0);
+	enabled[i] = buffer[1];
+	running[i] = buffer[2];
+      }
+    }
+
+  };
+
+  PerfEventCounters::PerfEventCounters(void)
+    : event_mask(0)
+  {
+    for(int i = 0; i < NUM_EVENTS; i++)
+      counts[i] = 0;
+  }
+
+  PerfEventCounters::~PerfEventCounters(void)
+  {}
+
+  /*static*/ PerfEventCounters *PerfEventCounters::setup_counters(const ProfilingMeasurementCollection& pmc)
+  {
+    unsigned mask = 0;
+    if(pmc.wants_measurement<ProfilingMeasurements::IPCPerfCounters>())
+      mask |= ((1U << EVENT_INSTS) | (1U << EVENT_CYCLES) |
+	       (1U << EVENT_BRANCHES));
+    if(pmc.wants_measurement<ProfilingMeasurements::L1ICachePerfCounters>())
+      mask |= ((1U << EVENT_L1I_ACCESSES) | (1U << EVENT_L1I_MISSES));
+    if(pmc.wants_measurement<ProfilingMeasurements::L1DCachePerfCounters>())
+      mask |= ((1U << EVENT_L1D_ACCESSES) | (1U << EVENT_L1D_MISSES));
+    // perf has no generic L2 event, but the last-level cache is the L3 on
+    //  everything we run on
+    if(pmc.wants_measurement<ProfilingMeasurements::L3CachePerfCounters>())
+      mask |= ((1U << EVENT_LLC_ACCESSES) | (1U << EVENT_LLC_MISSES));
+    if(pmc.wants_measurement<ProfilingMeasurements::TLBPerfCounters>())
+      mask |= ((1U << EVENT_ITLB_MISSES) | (1U << EVENT_DTLB_MISSES));
+    if(pmc.wants_measurement<ProfilingMeasurements::BranchPredictionPerfCounters>())
+      mask |= ((1U << EVENT_BRANCHES) | (1U << EVENT_BRANCH_MISSES));
+
+    // exit early if none present
+    if(mask == 0) return 0;
+
+    // this is called on the thread that will run the task, so make sure it
+    //  has the events open
+    mask = PerfEvents::open_events(PerfEvents::get_host_counters(), mask);
+    if(mask == 0) return 0;
+
+    PerfEventCounters *ctrs = new PerfEventCounters;
+    ctrs->event_mask = mask;
+    return ctrs;
+  }
+
+  void PerfEventCounters::cleanup(void)
+  {
+    delete this;
+  }
+
+  void PerfEventCounters::start(void)
+  {
+    PerfEvents::read_events(PerfEvents::get_host_counters(), event_mask,
+			    start_vals, start_enabled, start_running);
+  }
+
+  void PerfEventCounters::stop(void)
+  {
+    long long vals[NUM_EVENTS], enabled[NUM_EVENTS], running[NUM_EVENTS];
+    PerfEvents::read_events(PerfEvents::get_host_counters(), event_mask,
+			    vals, enabled, running);
+    for(int i = 0; i < NUM_EVENTS; i++) {
+      if(!(event_mask & (1U << i))) continue;
+      long long delta = vals[i] - start_vals[i];
+      long long d_enabled = enabled[i] - start_enabled[i];
+      long long d_running = running[i] - start_running[i];
+      // scale up if the kernel multiplexed this group with others
+      if((d_running > 0) && (d_running < d_enabled))
+	delta = (long long)(delta * ((double)d_enabled / d_running));
+      counts[i] += delta;
+    }
+  }
+
+  void PerfEventCounters::resume(void)
+  {
+    // we may be on a different kernel thread (with user threads), which
+    //  needs its own events opened
+    PerfEvents::HostCounters *hc = PerfEvents::get_host_counters();
+    unsigned avail = PerfEvents::open_events(hc, event_mask);
+    event_mask &= avail;
+    PerfEvents::read_events(hc, event_mask,
+			    start_vals, start_enabled, start_running);
+  }
+
+  void PerfEventCounters::suspend(void)
+  {
+    // same as stop
+    stop();
+  }
+
+  // returns the count for an event if it was measured, or -1 if not
+  static inline long long get_perf_val(int event, unsigned event_mask,
+				       const long long *counts,
+				       int& found_count)
+  {
+    if(event_mask & (1U << event)) {
+      found_count++;
+      return counts[event];
+    } else
+      return -1;
+  }
+
+  void PerfEventCounters::record(ProfilingMeasurementCollection& pmc)
+  {
+    if(pmc.wants_measurement<ProfilingMeasurements::IPCPerfCounters>()) {
+      ProfilingMeasurements::IPCPerfCounters ctrs;
+      int found_count = 0;
+      ctrs.total_insts  = get_perf_val(EVENT_INSTS, event_mask, counts, found_count);
+      ctrs.total_cycles = get_perf_val(EVENT_CYCLES, event_mask, counts, found_count);
+      ctrs.fp_insts     = -1;
+      ctrs.ld_insts     = -1;
+      ctrs.st_insts     = -1;
+      ctrs.br_insts     = get_perf_val(EVENT_BRANCHES, event_mask, counts, found_count);
+      if(found_count > 0)
+	pmc.add_measurement(ctrs);
+    }
+    if(pmc.wants_measurement<ProfilingMeasurements::L1ICachePerfCounters>()) {
+      ProfilingMeasurements::L1ICachePerfCounters ctrs;
+      int found_count = 0;
+      ctrs.accesses = get_perf_val(EVENT_L1I_ACCESSES, event_mask, counts, found_count);
+      ctrs.misses   = get_perf_val(EVENT_L1I_MISSES, event_mask, counts, found_count);
+      if(found_count > 0)
+	pmc.add_measurement(ctrs);
+    }
+    if(pmc.wants_measurement<ProfilingMeasurements::L1DCachePerfCounters>()) {
+      ProfilingMeasurements::L1DCachePerfCounters ctrs;
+      int found_count = 0;
+      ctrs.accesses = get_perf_val(EVENT_L1D_ACCESSES, event_mask, counts, found_count);
+      ctrs.misses   = get_perf_val(EVENT_L1D_MISSES, event_mask, counts, found_count);
+      if(found_count > 0)
+	pmc.add_measurement(ctrs);
+    }
+    if(pmc.wants_measurement<ProfilingMeasurements::L3CachePerfCounters>()) {
+      ProfilingMeasurements::L3CachePerfCounters ctrs;
+      int found_count = 0;
+      ctrs.accesses = get_perf_val(EVENT_LLC_ACCESSES, event_mask, counts, found_count);
+      ctrs.misses   = get_perf_val(EVENT_LLC_MISSES, event_mask, counts, found_count);
+      if(found_count > 0)
+	pmc.add_measurement(ctrs);
+    }
+    if(pmc.wants_measurement<ProfilingMeasurements::TLBPerfCounters>()) {
+      ProfilingMeasurements::TLBPerfCounters ctrs;
+      int found_count = 0;
+      ctrs.inst_misses = get_perf_val(EVENT_ITLB_MISSES, event_mask, counts, found_count);
+      ctrs.data_misses = get_perf_val(EVENT_DTLB_MISSES, event_mask, counts, found_count);
+      if(found_count > 0)
+	pmc.add_measurement(ctrs);
+    }
+    if(pmc.wants_measurement<ProfilingMeasurements::BranchPredictionPerfCounters>()) {
+      ProfilingMeasurements::BranchPredictionPerfCounters ctrs;
+      int found_count = 0;
+      ctrs.total_branches = get_perf_val(EVENT_BRANCHES, event_mask, counts, found_count);
+      ctrs.taken_branches = -1;
+      ctrs.mispredictions = get_perf_val(EVENT_BRANCH_MISSES, event_mask, counts, found_count);
+      if(found_count > 0)
+	pmc.add_measurement(ctrs);
+    }
+  }
+#endif
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // initialize/cleanup
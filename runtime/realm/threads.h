@@ -43,6 +43,12 @@
 #include <papi.h>
 #endif
 
+// without PAPI, hardware counters are read through Linux's perf_event
+//  interface, which needs no extra library
+#if defined(__linux__) && !defined(REALM_USE_PAPI) && !defined(REALM_NO_PERF_EVENTS)
+#define REALM_USE_PERF_EVENTS
+#endif
+
 namespace Realm {
 
   namespace Threading {
@@ -77,6 +83,9 @@ namespace Realm {
 #ifdef REALM_USE_PAPI
   class PAPICounters;
 #endif
+#ifdef REALM_USE_PERF_EVENTS
+  class PerfEventCounters;
+#endif
 
   //template <class CONDTYPE> class ThreadWaker;
 
@@ -219,6 +228,9 @@ namespace Realm {
 
 #ifdef REALM_USE_PAPI
     PAPICounters *papi_counters;
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    PerfEventCounters *perf_counters;
 #endif
   };
 
@@ -307,6 +319,11 @@ namespace Realm {
   //  all) it intends to use the integer, floating-point, and load/store datapaths of the core(s).
   //  A reservation with EXCLUSIVE use is compatible with those expecting MINIMAL use of the
   //  same datapath, but not with any other reservation desiring EXCLUSIVE or SHARED access.
+  // A reservation can also ask for cores in the same (or a different) last-level cache domain
+  //  as another reservation's cores.  This is a preference - if it can't be met, the
+  //  reservation is satisfied as if no cache affinity had been requested.
+  class CoreReservation;
+
   class CoreReservationParameters {
   public:
     enum CoreUsage { CORE_USAGE_NONE,
@@ -314,6 +331,10 @@ namespace Realm {
 		     CORE_USAGE_SHARED,
 		     CORE_USAGE_EXCLUSIVE };
 
+    enum CacheAffinity { CACHE_AFFINITY_DONTCARE,
+			 CACHE_AFFINITY_SAME,
+			 CACHE_AFFINITY_DIFFERENT };
+
     static const int NUMA_DOMAIN_DONTCARE = -1;
     static const ptrdiff_t STACK_SIZE_DEFAULT = -1;
     static const ptrdiff_t HEAP_SIZE_DEFAULT = -1;
@@ -325,6 +346,8 @@ namespace Realm {
     WithDefault<CoreUsage, CORE_USAGE_SHARED>  ldst_usage;  // "memory" datapath usage
     WithDefault<ptrdiff_t, STACK_SIZE_DEFAULT> max_stack_size;
     WithDefault<ptrdiff_t, HEAP_SIZE_DEFAULT>  max_heap_size;
+    WithDefault<CacheAffinity, CACHE_AFFINITY_DONTCARE> cache_affinity;
+    const CoreReservation *cache_affinity_rsrv; // reservation 'cache_affinity' refers to
 
     CoreReservationParameters(void);
 
@@ -335,6 +358,8 @@ namespace Realm {
     CoreReservationParameters& set_ldst_usage(CoreUsage new_ldst_usage);
     CoreReservationParameters& set_max_stack_size(ptrdiff_t new_max_stack_size);
     CoreReservationParameters& set_max_heap_size(ptrdiff_t new_max_heap_size);
+    CoreReservationParameters& set_cache_affinity(CacheAffinity new_cache_affinity,
+						  const CoreReservation& relative_to);
   };
 
   class CoreReservationSet;
@@ -390,13 +415,18 @@ namespace Realm {
     static CoreMap *discover_core_map(bool hyperthread_sharing);
 
     // creates a simple synthetic core map - it is symmetric and hierarchical:
-    //   numa domains -> cores -> fp clusters (shared fpu) -> hyperthreads (shared alu/ldst)
+    //   numa domains -> cache domains -> cores -> fp clusters (shared fpu) -> hyperthreads (shared alu/ldst)
+    // a 'cache_domain_size' of 0 puts all the cores of a numa domain in a single cache domain
     static CoreMap *create_synthetic(int num_domains, int cores_per_domain,
-				     int hyperthreads = 1, int fp_cluster_size = 1);
+				     int hyperthreads = 1, int fp_cluster_size = 1,
+				     int cache_domain_size = 0);
+
+    static const int CACHE_DOMAIN_UNKNOWN = -1;
 
     struct Proc {
       int id;      // a unique integer id
       int domain;  // which (NUMA) domain is it in
+      int cache_domain;  // which last-level (e.g. L3) cache it shares, or CACHE_DOMAIN_UNKNOWN
       std::set<int> kernel_proc_ids;  // set of kernel processor IDs (might be empty)
       std::set<Proc *> shares_alu;    // which other procs does this share an ALU with
       std::set<Proc *> shares_fpu;    // which other procs does this share an FPU with
@@ -408,6 +438,7 @@ namespace Realm {
 
     ProcMap all_procs;
     DomainMap by_domain;
+    DomainMap by_cache_domain;  // only procs with a known cache domain
   };
 
   // manages a set of core reservations and if/how they are satisfied
@@ -543,6 +574,52 @@ namespace Realm {
   };
 #endif
 
+#ifdef REALM_USE_PERF_EVENTS
+  // per-task view of hardware counters read with perf_event - the counter
+  //  groups themselves are opened on first use by each kernel thread and
+  //  stay open, so a task only pays for a read() of each group it needs when
+  //  it starts/stops/suspends/resumes
+  class PerfEventCounters {
+  protected:
+    PerfEventCounters(void);
+    ~PerfEventCounters(void);
+
+  public:
+    static PerfEventCounters *setup_counters(const ProfilingMeasurementCollection& pmc);
+    void cleanup(void);
+
+    void start(void);
+    void suspend(void);
+    void resume(void);
+    void stop(void);
+    void record(ProfilingMeasurementCollection& pmc);
+
+    enum {
+      EVENT_INSTS,
+      EVENT_CYCLES,
+      EVENT_BRANCHES,
+      EVENT_BRANCH_MISSES,
+      EVENT_L1I_ACCESSES,
+      EVENT_L1I_MISSES,
+      EVENT_L1D_ACCESSES,
+      EVENT_L1D_MISSES,
+      EVENT_LLC_ACCESSES,
+      EVENT_LLC_MISSES,
+      EVENT_ITLB_MISSES,
+      EVENT_DTLB_MISSES,
+      NUM_EVENTS
+    };
+
+  protected:
+    unsigned event_mask;          // events this task wants (and are available)
+    long long counts[NUM_EVENTS]; // accumulated (scaled) counts
+    // values from the current host thread at the last start/resume
+    long long start_vals[NUM_EVENTS];
+    long long start_enabled[NUM_EVENTS];
+    long long start_running[NUM_EVENTS];
+  };
+#endif
+
   // move this somewhere else
 
   class DummyLock {
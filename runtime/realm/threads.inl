@@ -82,6 +82,12 @@ namespace Realm {
     , current_op(0)
     , exception_handler_count(0)
     , signal_count(0)
+#ifdef REALM_USE_PAPI
+    , papi_counters(0)
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    , perf_counters(0)
+#endif
   {
   }
 
@@ -220,6 +226,9 @@ namespace Realm {
 #ifdef REALM_USE_PAPI
     if(thread->papi_counters) thread->papi_counters->suspend();
 #endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(thread->perf_counters) thread->perf_counters->suspend();
+#endif
 
     // we're interacting with the scheduler, so check for signals first
     if(thread->signal_count > 0)
@@ -247,6 +256,9 @@ namespace Realm {
     // finally, resume any performance counters
 #ifdef REALM_USE_PAPI
     if(thread->papi_counters) thread->papi_counters->resume();
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(thread->perf_counters) thread->perf_counters->resume();
 #endif
   }
 
@@ -276,6 +288,9 @@ namespace Realm {
   {
 #ifdef REALM_USE_PAPI
     papi_counters = PAPICounters::setup_counters(pmc);
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    perf_counters = PerfEventCounters::setup_counters(pmc);
 #endif
   }
 
@@ -283,6 +298,9 @@ namespace Realm {
   {
 #ifdef REALM_USE_PAPI
     if(papi_counters) papi_counters->start();
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(perf_counters) perf_counters->start();
 #endif
   }
 
@@ -290,6 +308,9 @@ namespace Realm {
   {
 #ifdef REALM_USE_PAPI
     if(papi_counters) papi_counters->stop();
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(perf_counters) perf_counters->stop();
 #endif
   }
 
@@ -301,6 +322,13 @@ namespace Realm {
       papi_counters->cleanup();
       papi_counters = 0; // cleanup call might delete, or save it for later
     }
+#endif
+#ifdef REALM_USE_PERF_EVENTS
+    if(perf_counters) {
+      perf_counters->record(pmc);
+      perf_counters->cleanup();
+      perf_counters = 0;
+    }
 #endif
   }
 
@@ -368,8 +396,9 @@ namespace Realm {
   // class CoreReservationParameters
 
   inline CoreReservationParameters::CoreReservationParameters(void)
+    : cache_affinity_rsrv(0)
   {
-    // default constructors on fields do all the work
+    // default constructors on the other fields do all the work
   }
   
   inline CoreReservationParameters& CoreReservationParameters::set_num_cores(int new_num_cores)
@@ -414,6 +443,14 @@ namespace Realm {
     return *this;
   }
 
+  inline CoreReservationParameters& CoreReservationParameters::set_cache_affinity(CacheAffinity new_cache_affinity,
+										   const CoreReservation& relative_to)
+  {
+    this->cache_affinity = new_cache_affinity;
+    this->cache_affinity_rsrv = &relative_to;
+    return *this;
+  }
+
 
 };
 
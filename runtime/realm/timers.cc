@@ -18,6 +18,7 @@
 #include "realm/timers.h"
 
 #include <string.h>
+#include <stdio.h>
 #include <list>
 
 pthread_key_t thread_timer_key;
@@ -27,6 +28,95 @@ namespace Realm {
   // if set_zero_time() is not called, relative time will equal absolute time
   /*static*/ long long Clock::zero_time = 0;
 
+  /*static*/ volatile bool Clock::use_tsc = false;
+  /*static*/ unsigned long long Clock::tsc_base = 0;
+  /*static*/ long long Clock::tsc_base_ns = 0;
+  /*static*/ unsigned long long Clock::tsc_mult = 0;
+
+#if defined(__x86_64__) && !defined(__MACH__)
+  static inline unsigned long long read_tsc(void)
+  {
+    unsigned lo, hi;
+    __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+    return ((unsigned long long)hi << 32) | lo;
+  }
+
+  // samples the TSC and the monotonic clock together, retrying to find the
+  //  tightest bracket (i.e. least likely to have been interrupted) and using
+  //  its midpoint
+  static void paired_sample(unsigned long long& tsc, long long& ns)
+  {
+    unsigned long long best_window = ~0ULL;
+    for(int i = 0; i < 16; i++) {
+      struct timespec ts;
+      unsigned long long t0 = read_tsc();
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      unsigned long long t1 = read_tsc();
+      if((t1 - t0) < best_window) {
+	best_window = t1 - t0;
+	tsc = t0 + ((t1 - t0) >> 1);
+	ns = (1000000000LL * ts.tv_sec) + ts.tv_nsec;
+      }
+    }
+  }
+
+  // the counter has to tick at a constant rate regardless of P-/C-states,
+  //  and the kernel has to agree that it's synchronized across cores (it
+  //  falls back to another clocksource if it isn't)
+  static bool tsc_is_usable(void)
+  {
+    unsigned eax, ebx, ecx, edx;
+    __asm__ __volatile__ ("cpuid"
+			  : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			  : "a" (0x80000000));
+    if(eax < 0x80000007)
+      return false;
+    __asm__ __volatile__ ("cpuid"
+			  : "=a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx)
+			  : "a" (0x80000007));
+    if((edx & (1 << 8)) == 0)
+      return false;
+
+    FILE *f = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+    if(!f)
+      return false;
+    char buffer[32];
+    bool ok = (fgets(buffer, sizeof(buffer), f) != 0) && !strncmp(buffer, "tsc", 3);
+    fclose(f);
+    return ok;
+  }
+#endif
+
+  /*static*/ bool Clock::calibrate_tsc(int calibration_ms)
+  {
+#if defined(__x86_64__) && !defined(__MACH__)
+    if(use_tsc || !tsc_is_usable())
+      return false;
+
+    unsigned long long tsc0, tsc1;
+    long long ns0, ns1;
+    paired_sample(tsc0, ns0);
+    struct timespec req;
+    req.tv_sec = calibration_ms / 1000;
+    req.tv_nsec = (calibration_ms % 1000) * 1000000;
+    nanosleep(&req, 0);
+    paired_sample(tsc1, ns1);
+
+    if((tsc1 <= tsc0) || (ns1 <= ns0))
+      return false;
+
+    // 32.32 fixed-point nanoseconds per tick
+    tsc_mult = (((unsigned __int128)(ns1 - ns0)) << 32) / (tsc1 - tsc0);
+    tsc_base = tsc1;
+    tsc_base_ns = ns1;
+    __sync_synchronize();
+    use_tsc = true;
+    return true;
+#else
+    return false;
+#endif
+  }
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class MultiNodeRollUp
@@ -49,6 +49,10 @@ namespace Realm {
   //  seconds - uses a double to store fractional seconds
   //  microseconds - uses a 64-bit integer, no fractional microseconds
   //  nanoseconds - uses a 64-bit integer, no fractional nanoseconds
+  //
+  // Relative time comes from the processor's timestamp counter once it has been
+  //  calibrated (if the counter is invariant and the OS trusts it), and from
+  //  the OS's monotonic clock otherwise.
   class Clock {
   public:
     static double current_time(bool absolute = false);
@@ -61,8 +65,23 @@ namespace Realm {
     // set_zero_time() should only be called by the runtime init code
     static void set_zero_time(void);
 
+    // calibrates the timestamp counter against the monotonic clock over the
+    //  given interval and switches relative time over to it - returns false
+    //  (and leaves the clock unchanged) if the counter isn't usable
+    // like set_zero_time, this is for the runtime init code only
+    static bool calibrate_tsc(int calibration_ms);
+
   protected:
+    static long long raw_time_in_nanoseconds(bool absolute);
+
     static long long zero_time;
+
+    // conversion from timestamp counter to monotonic nanoseconds:
+    //  ns = tsc_base_ns + (((tsc - tsc_base) * tsc_mult) >> 32)
+    static volatile bool use_tsc;
+    static unsigned long long tsc_base;
+    static long long tsc_base_ns;
+    static unsigned long long tsc_mult;
   };
 
   class Logger;
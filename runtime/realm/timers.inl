@@ -33,8 +33,17 @@ namespace Realm {
   //
   // class Clock
 
-  inline /*static*/ double Clock::current_time(bool absolute /*= false*/)
+  inline /*static*/ long long Clock::raw_time_in_nanoseconds(bool absolute)
   {
+#if defined(__x86_64__) && !defined(__MACH__)
+    // calibrated timestamp counter stands in for CLOCK_MONOTONIC
+    if(!absolute && use_tsc) {
+      unsigned lo, hi;
+      __asm__ __volatile__ ("rdtsc" : "=a" (lo), "=d" (hi));
+      unsigned long long delta = (((unsigned long long)hi << 32) | lo) - tsc_base;
+      return tsc_base_ns + (long long)(((unsigned __int128)delta * tsc_mult) >> 32);
+    }
+#endif
 #ifdef __MACH__
     mach_timespec_t ts;
     clock_serv_t cclock;
@@ -45,43 +54,28 @@ namespace Realm {
     struct timespec ts;
     clock_gettime(absolute ? CLOCK_REALTIME : CLOCK_MONOTONIC, &ts);
 #endif
-    double t = ts.tv_sec + (1e-9 * ts.tv_nsec);
+    return (1000000000LL * ts.tv_sec) + ts.tv_nsec;
+  }
+
+  inline /*static*/ double Clock::current_time(bool absolute /*= false*/)
+  {
+    long long t = raw_time_in_nanoseconds(absolute);
     if(!absolute)
-      t -= 1e-9 * zero_time;
-    return t;
+      t -= zero_time;
+    return 1e-9 * t;
   }
   
   inline /*static*/ long long Clock::current_time_in_microseconds(bool absolute /*= false*/)
   {
-#ifdef __MACH__
-    mach_timespec_t ts;
-    clock_serv_t cclock;
-    host_get_clock_service(mach_host_self(), CALENDAR_CLOCK, &cclock);
-    clock_get_time(cclock, &ts);
-    mach_port_deallocate(mach_task_self(), cclock);
-#else
-    struct timespec ts;
-    clock_gettime(absolute ? CLOCK_REALTIME : CLOCK_MONOTONIC, &ts);
-#endif
-    long long t = (1000000LL * ts.tv_sec) + (ts.tv_nsec / 1000);
+    long long t = raw_time_in_nanoseconds(absolute);
     if(!absolute)
-      t -= zero_time / 1000;
-    return t;
+      t -= zero_time;
+    return t / 1000;
   }
   
   inline /*static*/ long long Clock::current_time_in_nanoseconds(bool absolute /*= false*/)
   {
-#ifdef __MACH__
-    mach_timespec_t ts;
-    clock_serv_t cclock;
-    host_get_clock_service(mach_host_self(), CALENDAR_CLOCK, &cclock);
-    clock_get_time(cclock, &ts);
-    mach_port_deallocate(mach_task_self(), cclock);
-#else
-    struct timespec ts;
-    clock_gettime(absolute ? CLOCK_REALTIME : CLOCK_MONOTONIC, &ts);
-#endif
-    long long t = (1000000000LL * ts.tv_sec) + ts.tv_nsec;
+    long long t = raw_time_in_nanoseconds(absolute);
     if(!absolute)
       t -= zero_time;
     return t;
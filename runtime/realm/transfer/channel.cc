@@ -17,6 +17,15 @@
 #include "realm/transfer/channel.h"
 #include "realm/transfer/channel_disk.h"
 #include "realm/transfer/transfer.h"
+#include <errno.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef USE_GASNET
+#include <gasnet.h>
+#endif
 
 TYPE_IS_SERIALIZABLE(Realm::XferOrder::Type);
 TYPE_IS_SERIALIZABLE(Realm::XferDes::XferKind);
@@ -27,6 +36,18 @@ namespace Realm {
     Logger log_request("request");
     Logger log_xd("xd");
 
+    namespace Config {
+      int dma_memcpy_threads = 0;
+      int dma_parallel_copy_kb = 4 << 10; // 4 MB
+      int dma_parallel_serdez_elems = 4096;
+      int dma_nontemporal_copy_kb = 0;
+      int dma_rdma_put_kb = 64;
+      int dma_compress_kb = 0;
+      bool dma_calibrate_paths = true;
+      int hdf5_io_threads = 0;
+      bool hdf5_use_mpio = false;
+    };
+
       // TODO: currently we use dma_all_gpus to track the set of GPU* created
 #ifdef USE_CUDA
       std::vector<Cuda::GPU*> dma_all_gpus;
@@ -1666,6 +1687,90 @@ namespace Realm {
 
      extern Logger log_hdf5;
 
+      // variable-length data and references aren't stored in the dataset
+      //  itself, so those can't be read directly
+      static bool hdf5_type_is_fixed(hid_t type_id)
+      {
+	switch(H5Tget_class(type_id)) {
+	case H5T_VLEN:
+	case H5T_REFERENCE:
+	  return false;
+	case H5T_STRING:
+	  return (H5Tis_variable_str(type_id) == 0);
+	case H5T_ARRAY:
+	  {
+	    hid_t super_id;
+	    CHECK_HDF5( super_id = H5Tget_super(type_id) );
+	    bool fixed = hdf5_type_is_fixed(super_id);
+	    CHECK_HDF5( H5Tclose(super_id) );
+	    return fixed;
+	  }
+	case H5T_COMPOUND:
+	  {
+	    int nmembers = H5Tget_nmembers(type_id);
+	    for(int i = 0; i < nmembers; i++) {
+	      hid_t member_id;
+	      CHECK_HDF5( member_id = H5Tget_member_type(type_id, i) );
+	      bool fixed = hdf5_type_is_fixed(member_id);
+	      CHECK_HDF5( H5Tclose(member_id) );
+	      if(!fixed) return false;
+	    }
+	    return true;
+	  }
+	default:
+	  return true;
+	}
+      }
+
+      static void get_dataset_layout(hid_t dset_id, int fd,
+				     HDFDatasetLayout& layout)
+      {
+	hid_t space_id;
+	CHECK_HDF5( space_id = H5Dget_space(dset_id) );
+	layout.ndims = H5Sget_simple_extent_ndims(space_id);
+	assert((layout.ndims >= 0) && (layout.ndims <= H5S_MAX_RANK));
+	CHECK_HDF5( H5Sget_simple_extent_dims(space_id, layout.dims, 0) );
+	CHECK_HDF5( H5Sclose(space_id) );
+
+	hid_t type_id;
+	CHECK_HDF5( type_id = H5Dget_type(dset_id) );
+	layout.elem_size = H5Tget_size(type_id);
+	bool fixed = hdf5_type_is_fixed(type_id);
+	CHECK_HDF5( H5Tclose(type_id) );
+
+	hid_t dcpl_id;
+	CHECK_HDF5( dcpl_id = H5Dget_create_plist(dset_id) );
+	H5D_layout_t storage = H5Pget_layout(dcpl_id);
+	layout.chunked = (storage == H5D_CHUNKED);
+	if(layout.chunked) {
+	  int rank = H5Pget_chunk(dcpl_id, H5S_MAX_RANK, layout.chunk);
+	  assert(rank == layout.ndims);
+	} else {
+	  for(int i = 0; i < layout.ndims; i++)
+	    layout.chunk[i] = layout.dims[i];
+	}
+	// filtered (e.g. compressed) chunks have to be decoded by the library
+	bool raw = ((H5Pget_nfilters(dcpl_id) == 0) &&
+		    (H5Pget_external_count(dcpl_id) == 0));
+	CHECK_HDF5( H5Pclose(dcpl_id) );
+
+	layout.fd = fd;
+	layout.offset = HADDR_UNDEF;
+	layout.direct = false;
+	if((fd >= 0) && fixed && raw && (layout.ndims > 0)) {
+	  if(layout.chunked) {
+#if H5_VERSION_GE(1,10,5)
+	    // chunk addresses are looked up as we go
+	    layout.direct = true;
+#endif
+	  } else if(storage == H5D_CONTIGUOUS) {
+	    // undefined if no storage has been allocated yet
+	    layout.offset = H5Dget_offset(dset_id);
+	    layout.direct = (layout.offset != HADDR_UNDEF);
+	  }
+	}
+      }
+
       long HDFXferDes::get_requests(Request** requests, long nr)
       {
         long idx = 0;
@@ -1686,6 +1791,10 @@ namespace Realm {
 
 	  // some sort of per-channel max request size?
 	  size_t max_bytes = 1 << 20;
+	  // direct reads are spread across the helper threads, so give each of
+	  //  them that much to do
+	  if((kind == XferDes::XFER_HDF_READ) && (Config::hdf5_io_threads > 0))
+	    max_bytes *= (1 + Config::hdf5_io_threads);
 
 	  // if we're not the first in the chain, and we know the total bytes
 	  //  written by the predecessor, don't exceed that
@@ -1778,13 +1887,50 @@ namespace Realm {
 	      info = it->second;
 	    } else {
 	      info = new HDFFileInfo;
+	      info->xfer_plist_id = H5P_DEFAULT;
+	      info->fd = -1;
+	      hid_t fapl_id = H5P_DEFAULT;
+#ifdef H5_HAVE_PARALLEL
+	      if(Config::hdf5_use_mpio) {
+		// nodes issue their transfers independently, so the only
+		//  communicator we can use collectively is our own, but that
+		//  still lets MPI-IO aggregate our accesses into large
+		//  contiguous file requests
+		MPI_Info mpi_info;
+		MPI_Info_create(&mpi_info);
+		MPI_Info_set(mpi_info, (char *)"romio_cb_read", (char *)"enable");
+		MPI_Info_set(mpi_info, (char *)"romio_cb_write", (char *)"enable");
+		CHECK_HDF5( fapl_id = H5Pcreate(H5P_FILE_ACCESS) );
+		CHECK_HDF5( H5Pset_fapl_mpio(fapl_id, MPI_COMM_SELF, mpi_info) );
+		MPI_Info_free(&mpi_info);
+		CHECK_HDF5( info->xfer_plist_id = H5Pcreate(H5P_DATASET_XFER) );
+		CHECK_HDF5( H5Pset_dxpl_mpio(info->xfer_plist_id,
+					     H5FD_MPIO_COLLECTIVE) );
+	      }
+#endif
 	      // have to open the file
 	      CHECK_HDF5( info->file_id = H5Fopen(hdf5_info.filename->c_str(),
 						  ((kind == XferDes::XFER_HDF_READ) ?
 					             H5F_ACC_RDONLY :
 					             H5F_ACC_RDWR),
-						  H5P_DEFAULT) );
+						  fapl_id) );
 	      log_hdf5.info() << "H5Fopen(\"" << *hdf5_info.filename << "\") = " << info->file_id;
+	      if(fapl_id != H5P_DEFAULT)
+		CHECK_HDF5( H5Pclose(fapl_id) );
+	      // direct reads need file addresses to be file offsets, which is
+	      //  only the case for the default (sec2) driver
+	      if((kind == XferDes::XFER_HDF_READ) &&
+		 (Config::hdf5_io_threads > 0) && !Config::hdf5_use_mpio) {
+		hid_t access_id;
+		CHECK_HDF5( access_id = H5Fget_access_plist(info->file_id) );
+		if(H5Pget_driver(access_id) == H5FD_SEC2) {
+		  info->fd = open(hdf5_info.filename->c_str(), O_RDONLY);
+		  if(info->fd < 0)
+		    log_hdf5.warning() << "direct reads disabled for \"" << *hdf5_info.filename
+				       << "\": open failed: " << strerror(errno);
+		}
+		CHECK_HDF5( H5Pclose(access_id) );
+	      }
 	      file_infos[*hdf5_info.filename] = info;
 	    }
 	  }
@@ -1800,6 +1946,8 @@ namespace Realm {
 					     H5P_DEFAULT) );
 	      log_hdf5.info() << "H5Dopen2(" << info->file_id << ", \"" << *hdf5_info.dsetname << "\") = " << dset_id;
 	      info->dset_ids[*hdf5_info.dsetname] = dset_id;
+	      get_dataset_layout(dset_id, info->fd,
+				 info->layouts[*hdf5_info.dsetname]);
 	    }
 	  }
 	  hid_t dtype_id;
@@ -1807,6 +1955,10 @@ namespace Realm {
 
 	  new_req->dataset_id = dset_id;
 	  new_req->datatype_id = dtype_id;
+	  new_req->xfer_plist_id = info->xfer_plist_id;
+	  new_req->layout = &(info->layouts[*hdf5_info.dsetname]);
+	  new_req->filename = hdf5_info.filename;
+	  new_req->dsetname = hdf5_info.dsetname;
 
 	  std::vector<hsize_t> mem_dims = hdf5_info.extent;
 	  CHECK_HDF5( new_req->mem_space_id = H5Screate_simple(mem_dims.size(), mem_dims.data(), NULL) );
@@ -1979,6 +2131,10 @@ namespace Realm {
 	  }
 	  log_hdf5.info() << "H5Fclose(" << it->second->file_id << " /* \"" << it->first << "\" */)";
 	  CHECK_HDF5( H5Fclose(it->second->file_id) );
+	  if(it->second->xfer_plist_id != H5P_DEFAULT)
+	    CHECK_HDF5( H5Pclose(it->second->xfer_plist_id) );
+	  if(it->second->fd >= 0)
+	    close(it->second->fd);
 	  delete it->second;
 	}
       }
@@ -2197,24 +2353,283 @@ namespace Realm {
         channel->stop();
       }
 
+      // copies with streaming stores that bypass the cache, for destinations
+      //  that won't be read again soon - falls back to memcpy if SSE2 isn't
+      //  available
+      static void memcpy_nontemporal(void *dst, const void *src, size_t bytes)
+      {
+#ifdef __SSE2__
+	char *d = (char *)dst;
+	const char *s = (const char *)src;
+	// get the destination 16B-aligned first
+	size_t head = (16 - ((uintptr_t)d & 15)) & 15;
+	if(head > bytes) head = bytes;
+	if(head) {
+	  memcpy(d, s, head);
+	  d += head; s += head; bytes -= head;
+	}
+	while(bytes >= 64) {
+	  __m128i v0 = _mm_loadu_si128((const __m128i *)(s + 0));
+	  __m128i v1 = _mm_loadu_si128((const __m128i *)(s + 16));
+	  __m128i v2 = _mm_loadu_si128((const __m128i *)(s + 32));
+	  __m128i v3 = _mm_loadu_si128((const __m128i *)(s + 48));
+	  _mm_stream_si128((__m128i *)(d + 0), v0);
+	  _mm_stream_si128((__m128i *)(d + 16), v1);
+	  _mm_stream_si128((__m128i *)(d + 32), v2);
+	  _mm_stream_si128((__m128i *)(d + 48), v3);
+	  d += 64; s += 64; bytes -= 64;
+	}
+	if(bytes)
+	  memcpy(d, s, bytes);
+	// streaming stores are weakly ordered - make sure they're visible
+	//  before anybody is told the copy is done
+	_mm_sfence();
+#else
+	memcpy(dst, src, bytes);
+#endif
+      }
+
+      MemcpyHelperPool::MemcpyHelperPool(int _num_helpers)
+	: num_helpers(_num_helpers), is_stopped(false)
+      {
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&work_cond, NULL);
+	pthread_cond_init(&done_cond, NULL);
+      }
+
+      MemcpyHelperPool::~MemcpyHelperPool()
+      {
+	assert(chunks.empty());
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&work_cond);
+	pthread_cond_destroy(&done_cond);
+      }
+
+      void MemcpyHelperPool::start_threads(CoreReservation& rsrv,
+					   std::vector<Thread *>& threads)
+      {
+	Realm::ThreadLaunchParameters tlp;
+	for(int i = 0; i < num_helpers; i++) {
+	  Realm::Thread *t = Realm::Thread::create_kernel_thread<MemcpyHelperPool,
+							 &MemcpyHelperPool::helper_thread_loop>(this,
+												tlp,
+												rsrv,
+												0 /* default scheduler*/);
+	  threads.push_back(t);
+	}
+      }
+
+      void MemcpyHelperPool::stop()
+      {
+	pthread_mutex_lock(&lock);
+	is_stopped = true;
+	pthread_cond_broadcast(&work_cond);
+	pthread_mutex_unlock(&lock);
+      }
+
+      void MemcpyHelperPool::copy(void *dst, const void *src, size_t bytes,
+				  bool nontemporal)
+      {
+	// one piece per helper plus one for us, in page-multiple chunks
+	const size_t CHUNK_ALIGN = 4096;
+	size_t pieces = num_helpers + 1;
+	size_t chunk_size = ((bytes / pieces) + CHUNK_ALIGN - 1) & ~(CHUNK_ALIGN - 1);
+	if(chunk_size < CHUNK_ALIGN) chunk_size = CHUNK_ALIGN;
+
+	std::vector<Chunk> work;
+	size_t ofs = 0;
+	while(ofs < bytes) {
+	  Chunk c;
+	  c.kind = Chunk::COPY;
+	  c.dst = (char *)dst + ofs;
+	  c.src = (const char *)src + ofs;
+	  c.bytes = std::min(chunk_size, bytes - ofs);
+	  c.nontemporal = nontemporal;
+	  c.serdez_op = 0;
+	  c.field_size = c.count = 0;
+	  c.result = 0;
+	  c.remaining = 0;
+	  work.push_back(c);
+	  ofs += c.bytes;
+	}
+	if(!work.empty())
+	  run_chunks(work);
+      }
+
+      size_t MemcpyHelperPool::serialize(const CustomSerdezUntyped *serdez_op,
+					 const void *src, size_t field_size,
+					 size_t count, void *dst)
+      {
+	// one piece per helper plus one for us
+	size_t pieces = std::min(count, (size_t)(num_helpers + 1));
+	if(pieces == 0)
+	  return 0;
+	size_t per_piece = (count + pieces - 1) / pieces;
+
+	std::vector<Chunk> work;
+	for(size_t ofs = 0; ofs < count; ofs += per_piece) {
+	  Chunk c;
+	  c.kind = Chunk::SERDEZ_SIZE;
+	  c.dst = 0;
+	  c.src = (const char *)src + (ofs * field_size);
+	  c.bytes = 0;
+	  c.nontemporal = false;
+	  c.serdez_op = serdez_op;
+	  c.field_size = field_size;
+	  c.count = std::min(per_piece, count - ofs);
+	  c.result = 0;
+	  c.remaining = 0;
+	  work.push_back(c);
+	}
+
+	// the serialized size of each piece is computed first, so that every
+	//  piece knows where its output starts and they can all be filled in
+	//  at once
+	std::vector<size_t> sizes(work.size(), 0);
+	for(size_t i = 0; i < work.size(); i++)
+	  work[i].result = &sizes[i];
+	run_chunks(work);
+
+	std::vector<size_t> used(work.size(), 0);
+	size_t total = 0;
+	for(size_t i = 0; i < work.size(); i++) {
+	  work[i].kind = Chunk::SERDEZ_SERIALIZE;
+	  work[i].dst = (char *)dst + total;
+	  work[i].result = &used[i];
+	  total += sizes[i];
+	}
+	run_chunks(work);
+
+	for(size_t i = 0; i < work.size(); i++)
+	  assert(used[i] == sizes[i]);
+	return total;
+      }
+
+      void MemcpyHelperPool::run_chunk(const Chunk& c)
+      {
+	switch(c.kind) {
+	case Chunk::COPY:
+	  if(c.nontemporal)
+	    memcpy_nontemporal(c.dst, c.src, c.bytes);
+	  else
+	    memcpy(c.dst, c.src, c.bytes);
+	  break;
+	case Chunk::SERDEZ_SIZE:
+	  *c.result = c.serdez_op->serialized_size(c.src, c.field_size, c.count);
+	  break;
+	case Chunk::SERDEZ_SERIALIZE:
+	  *c.result = c.serdez_op->serialize(c.src, c.field_size, c.count, c.dst);
+	  break;
+	}
+      }
+
+      void MemcpyHelperPool::run_chunks(std::vector<Chunk>& work)
+      {
+	int remaining = 0;
+
+	// our own piece is the first one - queue up the rest
+	if(work.size() > 1) {
+	  pthread_mutex_lock(&lock);
+	  for(size_t i = 1; i < work.size(); i++) {
+	    work[i].remaining = &remaining;
+	    chunks.push_back(work[i]);
+	    remaining++;
+	  }
+	  pthread_cond_broadcast(&work_cond);
+	  pthread_mutex_unlock(&lock);
+	}
+
+	run_chunk(work[0]);
+
+	if(remaining > 0) {
+	  pthread_mutex_lock(&lock);
+	  while(remaining > 0)
+	    pthread_cond_wait(&done_cond, &lock);
+	  pthread_mutex_unlock(&lock);
+	}
+      }
+
+      void MemcpyHelperPool::helper_thread_loop()
+      {
+	pthread_mutex_lock(&lock);
+	while(true) {
+	  while(chunks.empty() && !is_stopped)
+	    pthread_cond_wait(&work_cond, &lock);
+	  if(chunks.empty())
+	    break;  // stopped
+	  Chunk c = chunks.front();
+	  chunks.pop_front();
+	  pthread_mutex_unlock(&lock);
+
+	  run_chunk(c);
+
+	  pthread_mutex_lock(&lock);
+	  (*c.remaining)--;
+	  if(*c.remaining == 0)
+	    pthread_cond_broadcast(&done_cond);
+	}
+	pthread_mutex_unlock(&lock);
+      }
+
       static const Memory::Kind cpu_mem_kinds[] = { Memory::SYSTEM_MEM,
 						    Memory::REGDMA_MEM,
-						    Memory::Z_COPY_MEM };
+						    Memory::Z_COPY_MEM,
+						    Memory::GPU_MANAGED_MEM };
       static const size_t num_cpu_mem_kinds = sizeof(cpu_mem_kinds) / sizeof(cpu_mem_kinds[0]);
 
+      // measures this node's memcpy bandwidth (in MB/s) and per-copy latency
+      //  (in ns) with a short microbenchmark the first time it is called
+      static void calibrate_memcpy(unsigned& bw, unsigned& latency)
+      {
+	static unsigned cached_bw = 0;
+	static unsigned cached_latency = 0;
+	if(cached_bw == 0) {
+	  if(Config::dma_calibrate_paths) {
+	    const size_t bytes = 8 << 20;
+	    const int reps = 4;
+	    char *src = (char *)malloc(bytes);
+	    char *dst = (char *)malloc(bytes);
+	    assert((src != 0) && (dst != 0));
+	    // first copy also faults in the pages
+	    memset(src, 0, bytes);
+	    memcpy(dst, src, bytes);
+	    long long t1 = Clock::current_time_in_nanoseconds();
+	    for(int i = 0; i < reps; i++)
+	      memcpy(dst, src, bytes);
+	    long long t2 = Clock::current_time_in_nanoseconds();
+	    const int small_reps = 1000;
+	    for(int i = 0; i < small_reps; i++)
+	      memcpy(dst + (i & 63) * 64, src, 64);
+	    long long t3 = Clock::current_time_in_nanoseconds();
+	    free(src);
+	    free(dst);
+	    // bytes per ns * 1000 = MB/s
+	    cached_bw = std::max((long long)1, ((long long)bytes * reps * 1000) / std::max(t2 - t1, (long long)1));
+	    cached_latency = (t3 - t2) / small_reps;
+	    log_new_dma.info() << "memcpy calibration: bw=" << cached_bw << " MB/s, latency=" << cached_latency << " ns";
+	  } else {
+	    cached_bw = 10000;
+	    cached_latency = 100;
+	  }
+	}
+	bw = cached_bw;
+	latency = cached_latency;
+      }
+
       MemcpyChannel::MemcpyChannel(long max_nr)
 	: Channel(XferDes::XFER_MEM_CPY)
       {
         capacity = max_nr;
         is_stopped = false;
+        helpers = 0;
         sleep_threads = false;
         pthread_mutex_init(&pending_lock, NULL);
         pthread_mutex_init(&finished_lock, NULL);
         pthread_cond_init(&pending_cond, NULL);
         //cbs = (MemcpyRequest**) calloc(max_nr, sizeof(MemcpyRequest*));
-	unsigned bw = 0; // TODO
-	unsigned latency = 0;
-	// any combination of SYSTEM/REGDMA/Z_COPY_MEM
+	unsigned bw, latency;
+	calibrate_memcpy(bw, latency);
+	// any combination of SYSTEM/REGDMA/Z_COPY/GPU_MANAGED_MEM
 	for(size_t i = 0; i < num_cpu_mem_kinds; i++)
 	  for(size_t j = 0; j < num_cpu_mem_kinds; j++)
 	    add_path(cpu_mem_kinds[i], false,
@@ -2348,10 +2763,11 @@ namespace Realm {
 		      void *dst = req->xd->dst_mem->get_direct_ptr(dst_info.base_offset,
 								   bytes_avail);
 		      assert(dst != 0);
-		      bytes_used = req->xd->src_serdez_op->serialize(src,
-								     field_size,
-								     num_elems,
-								     dst);
+		      bytes_used = serialize_elems(req->xd->src_serdez_op,
+						   src,
+						   field_size,
+						   num_elems,
+						   dst);
 		      if(bytes_used == max_bytes) {
 			req->xd->dst_iter->confirm_step();
 		      } else {
@@ -2375,10 +2791,11 @@ namespace Realm {
 			    (bytes_left >= maxser_size)) {
 			size_t todo = std::min(num_elems - elems_done,
 					       bytes_left / maxser_size);
-			size_t amt = req->xd->src_serdez_op->serialize(((const char *)src) + (elems_done * field_size),
-								       field_size,
-								       todo,
-								       dst);
+			size_t amt = serialize_elems(req->xd->src_serdez_op,
+						     ((const char *)src) + (elems_done * field_size),
+						     field_size,
+						     todo,
+						     dst);
 			assert(amt <= bytes_left);
 			elems_done += todo;
 			bytes_left -= amt;
@@ -2463,10 +2880,11 @@ namespace Realm {
 			  void *dst = req->xd->dst_mem->get_direct_ptr(dst_info.base_offset,
 								       amt);
 			  assert(dst != 0);
-			  size_t amt2 = req->xd->src_serdez_op->serialize(((const char *)src) + (elems_done * field_size),
-									  field_size,
-									  num_elems - elems_done,
-									  dst);
+			  size_t amt2 = serialize_elems(req->xd->src_serdez_op,
+							((const char *)src) + (elems_done * field_size),
+							field_size,
+							num_elems - elems_done,
+							dst);
 			  bytes_used += amt2;
 			  if(amt2 == max_remain) {
 			    req->xd->dst_iter->confirm_step();
@@ -2670,7 +3088,7 @@ namespace Realm {
 		    req->xd->read_bytes_total += bytes_used;
 		  } else {
 		    // normal copy
-		    memcpy(dst, src, req->nbytes);
+		    copy_bytes(dst, src, req->nbytes);
 		  }
 		}
 		if(req->dim == Request::DIM_1D) break;
@@ -2737,6 +3155,29 @@ namespace Realm {
         */
       }
 
+      void MemcpyChannel::copy_bytes(void *dst, const void *src, size_t bytes)
+      {
+	bool nontemporal = ((Config::dma_nontemporal_copy_kb > 0) &&
+			    (bytes >= ((size_t)Config::dma_nontemporal_copy_kb << 10)));
+	if(helpers && (bytes >= ((size_t)Config::dma_parallel_copy_kb << 10)))
+	  helpers->copy(dst, src, bytes, nontemporal);
+	else if(nontemporal)
+	  memcpy_nontemporal(dst, src, bytes);
+	else
+	  memcpy(dst, src, bytes);
+      }
+
+      size_t MemcpyChannel::serialize_elems(const CustomSerdezUntyped *serdez_op,
+					    const void *src, size_t field_size,
+					    size_t count, void *dst)
+      {
+	if(helpers && (Config::dma_parallel_serdez_elems > 0) &&
+	   (count >= (size_t)Config::dma_parallel_serdez_elems))
+	  return helpers->serialize(serdez_op, src, field_size, count, dst);
+	else
+	  return serdez_op->serialize(src, field_size, count, dst);
+      }
+
       void MemcpyChannel::pull()
       {
         pthread_mutex_lock(&finished_lock);
@@ -2770,9 +3211,10 @@ namespace Realm {
       {
         capacity = max_nr;
 
-	unsigned bw = 0; // TODO
-	unsigned latency = 0;
-	// any combination of SYSTEM/REGDMA/Z_COPY_MEM
+	// nominal network estimates
+	unsigned bw = 5000;
+	unsigned latency = 5000;
+	// any combination of SYSTEM/REGDMA/Z_COPY/GPU_MANAGED_MEM
 	for(size_t i = 0; i < num_cpu_mem_kinds; i++)
 	  if(_kind == XferDes::XFER_GASNET_READ)
 	    add_path(Memory::GLOBAL_MEM, true,
@@ -2826,21 +3268,264 @@ namespace Realm {
         return capacity;
       }
 
+#ifdef USE_GASNET
+      struct RemoteWriteChannel::PendingPuts {
+	struct Entry {
+	  RemoteWriteRequest *req;
+	  gasnet_handle_t handle;
+	};
+	GASNetHSL mutex;
+	std::deque<Entry> entries;
+      };
+#else
+      struct RemoteWriteChannel::PendingPuts {};
+#endif
+
       RemoteWriteChannel::RemoteWriteChannel(long max_nr)
 	: Channel(XferDes::XFER_REMOTE_WRITE)
+	, pending_puts(new PendingPuts)
       {
         capacity = max_nr;
 
-	unsigned bw = 0; // TODO
-	unsigned latency = 0;
-	// any combination of SYSTEM/REGDMA/Z_COPY_MEM
+	// nominal network estimates
+	unsigned bw = 5000;
+	unsigned latency = 5000;
+	// any combination of SYSTEM/REGDMA/Z_COPY/GPU_MANAGED_MEM
 	for(size_t i = 0; i < num_cpu_mem_kinds; i++)
 	  add_path(cpu_mem_kinds[i], false,
 		   Memory::REGDMA_MEM, true,
 		   bw, latency, false, false);
       }
 
-      RemoteWriteChannel::~RemoteWriteChannel() {}
+      RemoteWriteChannel::~RemoteWriteChannel()
+      {
+	delete pending_puts;
+      }
+
+      void RemoteWriteChannel::add_gpudirect_path(Memory fbmem)
+      {
+	// same estimates as the cpu memories, but without a staging copy
+	//  through zero-copy memory in front of it
+	add_path(fbmem, Memory::REGDMA_MEM, true,
+		 5000, 5000, false, false);
+      }
+
+      bool RemoteWriteChannel::start_put(RemoteWriteRequest *req)
+      {
+#ifdef USE_GASNET
+	// framebuffer data can only be read by the network, never copied
+	//  into an active message, so those always use a put
+	if((req->xd->src_mem->kind != MemoryImpl::MKIND_GPUFB) &&
+	   ((Config::dma_rdma_put_kb <= 0) ||
+	    (req->nbytes < ((size_t)(Config::dma_rdma_put_kb) << 10))))
+	  return false;
+
+	gasnet_begin_nbi_accessregion();
+	if(req->dim == Request::DIM_1D) {
+	  gasnet_put_nbi_bulk(req->dst_node, req->dst_base,
+			      const_cast<void *>(req->src_base), req->nbytes);
+	} else {
+	  assert(req->dim == Request::DIM_2D);
+	  // dest MUST be continuous
+	  assert(req->nlines <= 1 || ((size_t)req->dst_str) == req->nbytes);
+	  for(size_t l = 0; l < req->nlines; l++)
+	    gasnet_put_nbi_bulk(req->dst_node,
+				static_cast<char *>(req->dst_base) + (l * req->nbytes),
+				const_cast<char *>(static_cast<const char *>(req->src_base)) + (l * req->src_str),
+				req->nbytes);
+	}
+	PendingPuts::Entry e;
+	e.req = req;
+	e.handle = gasnet_end_nbi_accessregion();
+
+	AutoHSLLock al(pending_puts->mutex);
+	pending_puts->entries.push_back(e);
+	return true;
+#else
+	return false;
+#endif
+      }
+
+      void RemoteWriteChannel::complete_put(RemoteWriteRequest *req)
+      {
+	// the data is already in place, so the target only needs to hear about
+	//  it if there's a next XD that's waiting for it
+	if(req->xd->next_xd_guid != XferDes::XFERDES_NO_GUID)
+	  XferDesRemoteWriteMessage::send_request(
+            req->dst_node, 0, 0, 0, req,
+	    req->xd->next_xd_guid, req->write_seq_pos, req->write_seq_count,
+	    (req->xd->iteration_completed ? req->xd->write_bytes_total : (size_t)-1));
+
+	// and there's no ack to wait for either
+	req->xd->notify_request_read_done(req);
+	req->xd->notify_request_write_done(req);
+	notify_completion();
+      }
+
+      namespace {
+	// The compressed format works on 64-bit words, each XORed with the
+	//  word before it so that zeros and repeated values both become zero.
+	//  Each line is a series of runs with a 32-bit header: if the top bit
+	//  is set it's a run of that many zero words (with no data), otherwise
+	//  that many words follow.  Trailing bytes of a line that don't make a
+	//  whole word are copied as-is.
+	static const uint32_t ZERO_RUN = 0x80000000U;
+	static const size_t MAX_RUN = 0x7fffffffU;
+
+	// returns the compressed size, or 0 if it would be more than 'limit'
+	size_t compress_lines(const char *src, size_t line_bytes,
+			      off_t src_str, size_t nlines,
+			      char *dst, size_t limit)
+	{
+	  const size_t words = line_bytes >> 3;
+	  const size_t tail = line_bytes & 7;
+	  uint64_t prev = 0;
+	  size_t pos = 0;
+	  for(size_t l = 0; l < nlines; l++) {
+	    const char *line = src + (l * src_str);
+	    size_t w = 0;
+	    while(w < words) {
+	      if((pos + sizeof(uint32_t)) > limit)
+		return 0;
+	      uint32_t *hdr = reinterpret_cast<uint32_t *>(dst + pos);
+	      pos += sizeof(uint32_t);
+	      uint64_t val;
+	      memcpy(&val, line + (w << 3), sizeof(val));
+	      size_t count = 0;
+	      if(val == prev) {
+		do {
+		  count++;
+		  if((w + count) == words) break;
+		  memcpy(&val, line + ((w + count) << 3), sizeof(val));
+		} while((val == prev) && (count < MAX_RUN));
+		*hdr = ZERO_RUN | count;
+	      } else {
+		// a literal run only stops for two repeats in a row, since
+		//  a zero run costs a header for it and the next literal run
+		do {
+		  if((pos + sizeof(val)) > limit)
+		    return 0;
+		  uint64_t delta = val ^ prev;
+		  memcpy(dst + pos, &delta, sizeof(delta));
+		  pos += sizeof(delta);
+		  prev = val;
+		  count++;
+		  if((w + count) == words) break;
+		  memcpy(&val, line + ((w + count) << 3), sizeof(val));
+		  if((val == prev) && ((w + count + 1) < words)) {
+		    uint64_t next;
+		    memcpy(&next, line + ((w + count + 1) << 3), sizeof(next));
+		    if(next == prev)
+		      break;
+		  }
+		} while(count < MAX_RUN);
+		*hdr = count;
+	      }
+	      w += count;
+	    }
+	    if(tail > 0) {
+	      if((pos + tail) > limit)
+		return 0;
+	      memcpy(dst + pos, line + (words << 3), tail);
+	      pos += tail;
+	    }
+	  }
+	  return pos;
+	}
+
+	void decompress_lines(const char *src, size_t srclen,
+			      char *dst, size_t line_bytes, size_t nlines)
+	{
+	  const size_t words = line_bytes >> 3;
+	  const size_t tail = line_bytes & 7;
+	  uint64_t prev = 0;
+	  size_t pos = 0;
+	  for(size_t l = 0; l < nlines; l++) {
+	    size_t w = 0;
+	    while(w < words) {
+	      assert((pos + sizeof(uint32_t)) <= srclen);
+	      uint32_t hdr;
+	      memcpy(&hdr, src + pos, sizeof(hdr));
+	      pos += sizeof(hdr);
+	      size_t count = hdr & ~ZERO_RUN;
+	      assert((count > 0) && ((w + count) <= words));
+	      if((hdr & ZERO_RUN) != 0) {
+		for(size_t i = 0; i < count; i++, dst += sizeof(prev))
+		  memcpy(dst, &prev, sizeof(prev));
+	      } else {
+		assert((pos + (count << 3)) <= srclen);
+		for(size_t i = 0; i < count; i++, dst += sizeof(prev)) {
+		  uint64_t delta;
+		  memcpy(&delta, src + pos, sizeof(delta));
+		  pos += sizeof(delta);
+		  prev ^= delta;
+		  memcpy(dst, &prev, sizeof(prev));
+		}
+	      }
+	      w += count;
+	    }
+	    if(tail > 0) {
+	      assert((pos + tail) <= srclen);
+	      memcpy(dst, src + pos, tail);
+	      pos += tail;
+	      dst += tail;
+	    }
+	  }
+	  assert(pos == srclen);
+	}
+      };
+
+      bool RemoteWriteChannel::start_compressed_write(RemoteWriteRequest *req)
+      {
+	// framebuffer data can't be read by the cpu to compress it
+	if((Config::dma_compress_kb <= 0) ||
+	   (req->xd->src_mem->kind == MemoryImpl::MKIND_GPUFB))
+	  return false;
+	const size_t nlines = ((req->dim == Request::DIM_1D) ? 1 : req->nlines);
+	const size_t total_bytes = req->nbytes * nlines;
+	if(total_bytes < ((size_t)(Config::dma_compress_kb) << 10))
+	  return false;
+	// dest MUST be continuous
+	assert(nlines <= 1 || ((size_t)req->dst_str) == req->nbytes);
+
+	// it has to fit in a single message and is only worth sending if it
+	//  saves at least an eighth of the bytes
+	typedef XferDesRemoteCompressedWriteMessage::Header Header;
+	size_t limit = total_bytes - (total_bytes >> 3);
+	size_t lmb_size = get_lmb_size(req->dst_node);
+	if(limit > lmb_size)
+	  limit = lmb_size;
+	if(limit <= sizeof(Header))
+	  return false;
+	char *payload = static_cast<char *>(malloc(limit));
+	assert(payload != 0);
+	size_t compressed = compress_lines(static_cast<const char *>(req->src_base),
+					   req->nbytes,
+					   ((nlines > 1) ? req->src_str : 0),
+					   nlines, payload + sizeof(Header),
+					   limit - sizeof(Header));
+	if(compressed == 0) {
+	  free(payload);
+	  return false;
+	}
+
+	Header *hdr = reinterpret_cast<Header *>(payload);
+	hdr->dst_buf = req->dst_base;
+	hdr->line_bytes = req->nbytes;
+	hdr->nlines = nlines;
+	hdr->next_xd_guid = req->xd->next_xd_guid;
+	hdr->span_start = req->write_seq_pos;
+	hdr->span_size = req->write_seq_count;
+	hdr->pre_bytes_total = (req->xd->iteration_completed ?
+				  req->xd->write_bytes_total :
+				  (size_t)-1);
+	log_request.debug() << "compressed remote write: " << total_bytes
+			    << " -> " << compressed << " bytes";
+	XferDesRemoteCompressedWriteMessage::send_request(req->dst_node, payload,
+							  sizeof(Header) + compressed,
+							  req);
+	return true;
+      }
 
       long RemoteWriteChannel::submit(Request** requests, long nr)
       {
@@ -2848,6 +3533,19 @@ namespace Realm {
         for (long i = 0; i < nr; i ++) {
           RemoteWriteRequest* req = (RemoteWriteRequest*) requests[i];
 	  assert(!req->xd->src_serdez_op && !req->xd->dst_serdez_op); // no serdez support
+	  // compressible writes are sent as smaller messages instead, which
+	  //  are acked like any other remote write
+	  if(start_compressed_write(req)) {
+	    __sync_fetch_and_sub(&capacity, 1);
+	    continue;
+	  }
+	  // large writes go straight into the (registered) destination with a
+	  //  one-sided put - see pull() for their completion
+	  if(start_put(req)) {
+	    __sync_fetch_and_sub(&capacity, 1);
+	    continue;
+	  }
+	  assert(req->xd->src_mem->kind != MemoryImpl::MKIND_GPUFB);
 	  // send a request if there's data or if there's a next XD to update
 	  if((req->nbytes > 0) ||
 	     (req->xd->next_xd_guid != XferDes::XFERDES_NO_GUID)) {
@@ -2894,6 +3592,25 @@ namespace Realm {
 
       void RemoteWriteChannel::pull()
       {
+#ifdef USE_GASNET
+	std::vector<RemoteWriteRequest *> completed;
+	{
+	  AutoHSLLock al(pending_puts->mutex);
+	  std::deque<PendingPuts::Entry>::iterator it = pending_puts->entries.begin();
+	  while(it != pending_puts->entries.end()) {
+	    if(gasnet_try_syncnb(it->handle) == GASNET_OK) {
+	      completed.push_back(it->req);
+	      it = pending_puts->entries.erase(it);
+	    } else
+	      ++it;
+	  }
+	}
+	// completion sends messages, so do it outside the lock
+	for(std::vector<RemoteWriteRequest *>::iterator it = completed.begin();
+	    it != completed.end();
+	    ++it)
+	  complete_put(*it);
+#endif
       }
 
       long RemoteWriteChannel::available()
@@ -2913,8 +3630,9 @@ namespace Realm {
 	switch(_kind) {
 	case XferDes::XFER_GPU_TO_FB:
 	  {
-	    unsigned bw = 0; // TODO
-	    unsigned latency = 0;
+	    // nominal PCIe estimates
+	    unsigned bw = 10000;
+	    unsigned latency = 10000;
 	    for(std::set<Memory>::const_iterator it = src_gpu->pinned_sysmems.begin();
 		it != src_gpu->pinned_sysmems.end();
 		++it)
@@ -2925,8 +3643,9 @@ namespace Realm {
 
 	case XferDes::XFER_GPU_FROM_FB:
 	  {
-	    unsigned bw = 0; // TODO
-	    unsigned latency = 0;
+	    // nominal PCIe estimates
+	    unsigned bw = 10000;
+	    unsigned latency = 10000;
 	    for(std::set<Memory>::const_iterator it = src_gpu->pinned_sysmems.begin();
 		it != src_gpu->pinned_sysmems.end();
 		++it)
@@ -2938,16 +3657,16 @@ namespace Realm {
 	case XferDes::XFER_GPU_IN_FB:
 	  {
 	    // self-path
-	    unsigned bw = 0; // TODO
-	    unsigned latency = 0;
+	    unsigned bw = 200000;
+	    unsigned latency = 5000;
 	    add_path(fbm, fbm, bw, latency, false, false);
 	  }
 
 	case XferDes::XFER_GPU_PEER_FB:
 	  {
 	    // just do paths to peers - they'll do the other side
-	    unsigned bw = 0; // TODO
-	    unsigned latency = 0;
+	    unsigned bw = 20000;
+	    unsigned latency = 10000;
 	    for(std::set<Memory>::const_iterator it = src_gpu->peer_fbs.begin();
 		it != src_gpu->peer_fbs.end();
 		++it)
@@ -3065,14 +3784,206 @@ namespace Realm {
 #endif
 
 #ifdef USE_HDF
+      static void hdf5_pread(int fd, void *dst, size_t bytes, off_t offset)
+      {
+	char *pos = (char *)dst;
+	while(bytes > 0) {
+	  ssize_t amt = pread(fd, pos, bytes, offset);
+	  if(amt < 0) {
+	    if(errno == EINTR) continue;
+	    log_hdf5.fatal() << "direct read failed: fd=" << fd << " offset=" << offset
+			     << " bytes=" << bytes << ": " << strerror(errno);
+	    assert(0);
+	  }
+	  if(amt == 0) {
+	    log_hdf5.fatal() << "direct read past end of file: fd=" << fd
+			     << " offset=" << offset << " bytes=" << bytes;
+	    assert(0);
+	  }
+	  pos += amt;
+	  bytes -= amt;
+	  offset += amt;
+	}
+      }
+
+      static void read_piece(const HDFReadPiece& p)
+      {
+	const HDFDatasetLayout *layout = p.req->layout;
+	int n = layout->ndims;
+	size_t elem_size = layout->elem_size;
+
+	// a chunk is read whole and then scattered, while a contiguous
+	//  dataset is read in place
+	char *buffer = 0;
+	if(layout->chunked) {
+	  buffer = (char *)malloc(p.chunk_bytes);
+	  assert(buffer != 0);
+	  hdf5_pread(layout->fd, buffer, p.chunk_bytes, p.chunk_addr);
+	}
+
+	// merge trailing dimensions that the piece covers completely in both
+	//  the source and the (dense) destination
+	int d = n - 1;
+	size_t run = p.hi[d] - p.lo[d] + 1;
+	while(d > 0) {
+	  hsize_t extent = p.hi[d] - p.lo[d] + 1;
+	  if((extent != layout->chunk[d]) || (extent != p.req_ext[d]))
+	    break;
+	  d--;
+	  run *= p.hi[d] - p.lo[d] + 1;
+	}
+
+	hsize_t pt[H5S_MAX_RANK];
+	for(int i = 0; i < n; i++)
+	  pt[i] = p.lo[i];
+	while(true) {
+	  size_t src_idx = 0;
+	  size_t dst_idx = 0;
+	  for(int i = 0; i < n; i++) {
+	    src_idx = (src_idx * layout->chunk[i]) + (pt[i] - p.chunk_lo[i]);
+	    dst_idx = (dst_idx * p.req_ext[i]) + (pt[i] - p.req_lo[i]);
+	  }
+	  char *dst = ((char *)(p.req->mem_base)) + (dst_idx * elem_size);
+	  if(buffer)
+	    memcpy(dst, buffer + (src_idx * elem_size), run * elem_size);
+	  else
+	    hdf5_pread(layout->fd, dst, run * elem_size,
+		       layout->offset + (src_idx * elem_size));
+
+	  int i = d - 1;
+	  while(i >= 0) {
+	    if(++pt[i] <= p.hi[i]) break;
+	    pt[i] = p.lo[i];
+	    i--;
+	  }
+	  if(i < 0) break;
+	}
+
+	if(buffer)
+	  free(buffer);
+      }
+
+      // reads part of a request through the library - used for chunks that
+      //  have never been written, which read back as the fill value
+      static void read_box_through_library(const HDFRequest *req,
+					   const hsize_t *lo, const hsize_t *hi,
+					   const hsize_t *req_lo)
+      {
+	int n = req->layout->ndims;
+	hsize_t count[H5S_MAX_RANK], mem_start[H5S_MAX_RANK];
+	for(int i = 0; i < n; i++) {
+	  count[i] = hi[i] - lo[i] + 1;
+	  mem_start[i] = lo[i] - req_lo[i];
+	}
+	hid_t file_space_id, mem_space_id;
+	CHECK_HDF5( file_space_id = H5Scopy(req->file_space_id) );
+	CHECK_HDF5( H5Sselect_hyperslab(file_space_id, H5S_SELECT_SET, lo, 0, count, 0) );
+	CHECK_HDF5( mem_space_id = H5Scopy(req->mem_space_id) );
+	CHECK_HDF5( H5Sselect_hyperslab(mem_space_id, H5S_SELECT_SET, mem_start, 0, count, 0) );
+	CHECK_HDF5( H5Dread(req->dataset_id, req->datatype_id,
+			    mem_space_id, file_space_id,
+			    req->xfer_plist_id, req->mem_base) );
+	CHECK_HDF5( H5Sclose(mem_space_id) );
+	CHECK_HDF5( H5Sclose(file_space_id) );
+      }
+
+      HDFHelperPool::HDFHelperPool(int _num_helpers)
+	: num_helpers(_num_helpers), is_stopped(false)
+      {
+	pthread_mutex_init(&lock, NULL);
+	pthread_cond_init(&work_cond, NULL);
+	pthread_cond_init(&done_cond, NULL);
+      }
+
+      HDFHelperPool::~HDFHelperPool()
+      {
+	assert(pieces.empty());
+	pthread_mutex_destroy(&lock);
+	pthread_cond_destroy(&work_cond);
+	pthread_cond_destroy(&done_cond);
+      }
+
+      void HDFHelperPool::start_threads(CoreReservation& rsrv,
+					std::vector<Thread *>& threads)
+      {
+	Realm::ThreadLaunchParameters tlp;
+	for(int i = 0; i < num_helpers; i++) {
+	  Realm::Thread *t = Realm::Thread::create_kernel_thread<HDFHelperPool,
+							 &HDFHelperPool::helper_thread_loop>(this,
+											     tlp,
+											     rsrv,
+											     0 /* default scheduler*/);
+	  threads.push_back(t);
+	}
+      }
+
+      void HDFHelperPool::stop()
+      {
+	pthread_mutex_lock(&lock);
+	is_stopped = true;
+	pthread_cond_broadcast(&work_cond);
+	pthread_mutex_unlock(&lock);
+      }
+
+      void HDFHelperPool::read_pieces(std::vector<HDFReadPiece>& to_read)
+      {
+	int remaining = to_read.size();
+
+	pthread_mutex_lock(&lock);
+	for(size_t i = 0; i < to_read.size(); i++) {
+	  to_read[i].remaining = &remaining;
+	  pieces.push_back(&to_read[i]);
+	}
+	pthread_cond_broadcast(&work_cond);
+
+	// help out until everything has been started, then wait for the rest
+	while(!pieces.empty()) {
+	  HDFReadPiece *p = pieces.front();
+	  pieces.pop_front();
+	  pthread_mutex_unlock(&lock);
+
+	  read_piece(*p);
+
+	  pthread_mutex_lock(&lock);
+	  (*p->remaining)--;
+	}
+	while(remaining > 0)
+	  pthread_cond_wait(&done_cond, &lock);
+	pthread_mutex_unlock(&lock);
+      }
+
+      void HDFHelperPool::helper_thread_loop()
+      {
+	pthread_mutex_lock(&lock);
+	while(true) {
+	  while(pieces.empty() && !is_stopped)
+	    pthread_cond_wait(&work_cond, &lock);
+	  if(pieces.empty())
+	    break;  // stopped
+	  HDFReadPiece *p = pieces.front();
+	  pieces.pop_front();
+	  pthread_mutex_unlock(&lock);
+
+	  read_piece(*p);
+
+	  pthread_mutex_lock(&lock);
+	  (*p->remaining)--;
+	  if(*p->remaining == 0)
+	    pthread_cond_broadcast(&done_cond);
+	}
+	pthread_mutex_unlock(&lock);
+      }
+
       HDFChannel::HDFChannel(long max_nr, XferDes::XferKind _kind)
 	: Channel(_kind)
+	, helpers(0)
       {
         capacity = max_nr;
 
-	unsigned bw = 0; // TODO
-	unsigned latency = 0;
-	// any combination of SYSTEM/REGDMA/Z_COPY_MEM
+	// nominal storage estimates
+	unsigned bw = 1000;
+	unsigned latency = 100000;
+	// any combination of SYSTEM/REGDMA/Z_COPY/GPU_MANAGED_MEM
 	for(size_t i = 0; i < num_cpu_mem_kinds; i++)
 	  if(_kind == XferDes::XFER_HDF_READ)
 	    add_path(Memory::HDF_MEM, false,
@@ -3093,14 +4004,25 @@ namespace Realm {
           HDFRequest* req = hdf_reqs[i];
 	  assert(!req->xd->src_serdez_op && !req->xd->dst_serdez_op); // no serdez support
           //pthread_rwlock_rdlock(req->rwlock);
-          if (kind == XferDes::XFER_HDF_READ)
-            CHECK_HDF5( H5Dread(req->dataset_id, req->datatype_id,
-				req->mem_space_id, req->file_space_id,
-				H5P_DEFAULT, req->mem_base) );
-	  else
+          if (kind == XferDes::XFER_HDF_READ) {
+	    if(read_staged(req))
+	      ; // prefetched - nothing to read
+	    else if(helpers && req->layout && req->layout->direct)
+	      read_direct(req);
+	    else
+	      CHECK_HDF5( H5Dread(req->dataset_id, req->datatype_id,
+				  req->mem_space_id, req->file_space_id,
+				  req->xfer_plist_id, req->mem_base) );
+	  } else {
+	    StagingCache *staging = StagingCache::get_singleton();
+	    if(staging && req->filename)
+	      staging->write_started(*req->filename);
             CHECK_HDF5( H5Dwrite(req->dataset_id, req->datatype_id,
 				 req->mem_space_id, req->file_space_id,
-				 H5P_DEFAULT, req->mem_base) );
+				 req->xfer_plist_id, req->mem_base) );
+	    if(staging && req->filename)
+	      staging->write_finished(*req->filename);
+	  }
           //pthread_rwlock_unlock(req->rwlock);
           req->xd->notify_request_read_done(req);
           req->xd->notify_request_write_done(req);
@@ -3108,7 +4030,155 @@ namespace Realm {
         return nr;
       }
 
-      void HDFChannel::pull() {}
+      // splits a read into pieces that never share a chunk and spreads them
+      //  across the helper threads
+      void HDFChannel::read_direct(HDFRequest *req)
+      {
+	const HDFDatasetLayout *layout = req->layout;
+	int n = layout->ndims;
+
+	HDFReadPiece proto;
+	memset(&proto, 0, sizeof(proto));
+	proto.req = req;
+	proto.chunk_addr = HADDR_UNDEF;
+	hsize_t lo[H5S_MAX_RANK], hi[H5S_MAX_RANK];
+	CHECK_HDF5( H5Sget_select_bounds(req->file_space_id, lo, hi) );
+	for(int i = 0; i < n; i++) {
+	  proto.req_lo[i] = lo[i];
+	  proto.req_ext[i] = hi[i] - lo[i] + 1;
+	}
+
+	std::vector<HDFReadPiece> pieces;
+	if(layout->chunked) {
+#if H5_VERSION_GE(1,10,5)
+	  // one piece per chunk touched by the request
+	  hsize_t c[H5S_MAX_RANK];
+	  for(int i = 0; i < n; i++)
+	    c[i] = lo[i] - (lo[i] % layout->chunk[i]);
+	  while(true) {
+	    HDFReadPiece p = proto;
+	    for(int i = 0; i < n; i++) {
+	      p.chunk_lo[i] = c[i];
+	      p.lo[i] = std::max(c[i], lo[i]);
+	      p.hi[i] = std::min(c[i] + layout->chunk[i] - 1, hi[i]);
+	    }
+	    unsigned filter_mask;
+	    hsize_t chunk_bytes;
+	    CHECK_HDF5( H5Dget_chunk_info_by_coord(req->dataset_id, c,
+						   &filter_mask,
+						   &p.chunk_addr,
+						   &chunk_bytes) );
+	    if(p.chunk_addr == HADDR_UNDEF) {
+	      read_box_through_library(req, p.lo, p.hi, lo);
+	    } else {
+	      p.chunk_bytes = chunk_bytes;
+	      pieces.push_back(p);
+	    }
+
+	    int i = n - 1;
+	    while(i >= 0) {
+	      c[i] += layout->chunk[i];
+	      if(c[i] <= hi[i]) break;
+	      c[i] = lo[i] - (lo[i] % layout->chunk[i]);
+	      i--;
+	    }
+	    if(i < 0) break;
+	  }
+#else
+	  assert(0);
+#endif
+	} else {
+	  // one slab per thread, split along the slowest-varying dimension
+	  //  that has more than one row
+	  int sd = 0;
+	  while((sd < (n - 1)) && (proto.req_ext[sd] == 1))
+	    sd++;
+	  hsize_t parts = std::min((hsize_t)(helpers->get_num_helpers() + 1),
+				   proto.req_ext[sd]);
+	  for(hsize_t j = 0; j < parts; j++) {
+	    HDFReadPiece p = proto;
+	    for(int i = 0; i < n; i++) {
+	      p.lo[i] = lo[i];
+	      p.hi[i] = hi[i];
+	    }
+	    p.lo[sd] = lo[sd] + ((proto.req_ext[sd] * j) / parts);
+	    p.hi[sd] = lo[sd] + ((proto.req_ext[sd] * (j + 1)) / parts) - 1;
+	    pieces.push_back(p);
+	  }
+	}
+
+	if(!pieces.empty())
+	  helpers->read_pieces(pieces);
+      }
+
+      bool HDFChannel::read_staged(HDFRequest *req)
+      {
+	StagingCache *staging = StagingCache::get_singleton();
+	if(!staging || !req->filename)
+	  return false;
+
+	hsize_t lo[H5S_MAX_RANK], hi[H5S_MAX_RANK];
+	int n = H5Sget_simple_extent_ndims(req->file_space_id);
+	assert((n > 0) && (n <= H5S_MAX_RANK));
+	CHECK_HDF5( H5Sget_select_bounds(req->file_space_id, lo, hi) );
+	size_t box_lo[H5S_MAX_RANK], box_extent[H5S_MAX_RANK];
+	for(int i = 0; i < n; i++) {
+	  box_lo[i] = lo[i];
+	  box_extent[i] = hi[i] - lo[i] + 1;
+	}
+	return staging->get(*req->filename, *req->dsetname, n,
+			    box_lo, box_extent,
+			    H5Tget_size(req->datatype_id), req->mem_base);
+      }
+
+      // reads one prefetched box into its staging buffer - the library
+      //  isn't necessarily thread-safe, so this happens on the dma thread
+      static bool stage_hdf5_read(StagingCache::Entry *e)
+      {
+	hid_t file_id = H5Fopen(e->filename.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+	if(file_id < 0)
+	  return false;
+	bool ok = false;
+	hid_t dset_id = H5Dopen2(file_id, e->dsetname.c_str(), H5P_DEFAULT);
+	if(dset_id >= 0) {
+	  int n = e->lo.size();
+	  std::vector<hsize_t> start(e->lo.begin(), e->lo.end());
+	  std::vector<hsize_t> count(e->extent.begin(), e->extent.end());
+	  hid_t type_id = H5Dget_type(dset_id);
+	  hid_t file_space_id = H5Dget_space(dset_id);
+	  hid_t mem_space_id = H5Screate_simple(n, count.data(), 0);
+	  ok = ((type_id >= 0) && (file_space_id >= 0) && (mem_space_id >= 0) &&
+		(H5Tget_size(type_id) == e->elem_size) &&
+		(H5Sget_simple_extent_ndims(file_space_id) == n) &&
+		(H5Sselect_hyperslab(file_space_id, H5S_SELECT_SET,
+				     start.data(), 0, count.data(), 0) >= 0) &&
+		(H5Dread(dset_id, type_id, mem_space_id, file_space_id,
+			 H5P_DEFAULT, e->buffer) >= 0));
+	  if(mem_space_id >= 0) H5Sclose(mem_space_id);
+	  if(file_space_id >= 0) H5Sclose(file_space_id);
+	  if(type_id >= 0) H5Tclose(type_id);
+	  H5Dclose(dset_id);
+	}
+	H5Fclose(file_id);
+	if(!ok)
+	  log_hdf5.warning() << "prefetch of \"" << e->filename << "\":\""
+			     << e->dsetname << "\" failed";
+	return ok;
+      }
+
+      void HDFChannel::pull()
+      {
+	// one prefetch at a time, so copies that are actually waiting don't
+	//  sit behind a long queue of them
+	if(kind == XferDes::XFER_HDF_READ) {
+	  StagingCache *staging = StagingCache::get_singleton();
+	  if(staging) {
+	    StagingCache::Entry *e = staging->next_to_issue(true /*hdf5*/);
+	    if(e)
+	      staging->read_done(e, stage_hdf5_read(e));
+	  }
+	}
+      }
 
       long HDFChannel::available()
       {
@@ -3136,6 +4206,28 @@ namespace Realm {
 	  XferDesRemoteWriteAckMessage::send_request(args.sender, args.req);
       }
 
+      /*static*/
+      void XferDesRemoteCompressedWriteMessage::handle_request(RequestArgs args,
+							       const void *data,
+							       size_t datalen)
+      {
+	assert(datalen >= sizeof(Header));
+	const Header *hdr = static_cast<const Header *>(data);
+	decompress_lines(static_cast<const char *>(data) + sizeof(Header),
+			 datalen - sizeof(Header),
+			 static_cast<char *>(hdr->dst_buf),
+			 hdr->line_bytes, hdr->nlines);
+
+	// the rest is the same as an uncompressed remote write
+	if(hdr->next_xd_guid != XferDes::XFERDES_NO_GUID)
+	  xferDes_queue->update_pre_bytes_write(hdr->next_xd_guid,
+						hdr->span_start,
+						hdr->span_size,
+						hdr->pre_bytes_total);
+
+	XferDesRemoteWriteAckMessage::send_request(args.sender, args.req);
+      }
+
       /*static*/
       void XferDesRemoteWriteAckMessage::handle_request(RequestArgs args)
       {
@@ -3610,6 +4702,10 @@ namespace Realm {
           r->add_dma_channel(gpu_from_fb_channel);
           r->add_dma_channel(gpu_in_fb_channel);
           r->add_dma_channel(gpu_peer_fb_channel);
+#ifdef USE_GASNET
+	  if((*it)->fbmem && (*it)->module->cfg_gpudirect)
+	    remote_channel->add_gpudirect_path((*it)->fbmem->me);
+#endif
         }
 #endif
 
@@ -3632,6 +4728,21 @@ namespace Realm {
           worker_threads.push_back(t);
         }
 
+        // helper threads for splitting up large memcpys
+        if(Config::dma_memcpy_threads > 0) {
+          memcpy_helpers = new MemcpyHelperPool(Config::dma_memcpy_threads);
+          memcpy_helpers->start_threads(*core_rsrv, helper_threads);
+          memcpy_channel->set_helper_pool(memcpy_helpers);
+        }
+#ifdef USE_HDF
+        // and for reading HDF5 data straight from the file
+        if((Config::hdf5_io_threads > 0) && !Config::hdf5_use_mpio) {
+          hdf_helpers = new HDFHelperPool(Config::hdf5_io_threads);
+          hdf_helpers->start_threads(*core_rsrv, helper_threads);
+          channel_manager->get_hdf_read_channel()->set_helper_pool(hdf_helpers);
+        }
+#endif
+
 #ifdef USE_DEDICATED_MEMCPY_THREADS
         // Next we create memcpy threads
         memcpy_threads =(MemcpyThread**) calloc(num_memcpy_threads, sizeof(MemcpyThread*));
@@ -3668,6 +4779,30 @@ namespace Realm {
           delete (*it);
         }
         worker_threads.clear();
+        // no dma threads are left to hand work to the helpers
+        if(memcpy_helpers)
+          memcpy_helpers->stop();
+#ifdef USE_HDF
+        if(hdf_helpers)
+          hdf_helpers->stop();
+#endif
+        for(std::vector<Realm::Thread *>::iterator it = helper_threads.begin();
+            it != helper_threads.end();
+            it++) {
+          (*it)->join();
+          delete (*it);
+        }
+        helper_threads.clear();
+        if(memcpy_helpers) {
+          delete memcpy_helpers;
+          memcpy_helpers = NULL;
+        }
+#ifdef USE_HDF
+        if(hdf_helpers) {
+          delete hdf_helpers;
+          hdf_helpers = NULL;
+        }
+#endif
         for (int i = 0; i < num_threads; i++)
           delete dma_threads[i];
         for (int i = 0; i < num_memcpy_threads; i++)
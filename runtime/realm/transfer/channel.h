@@ -251,11 +251,28 @@ namespace Realm {
 #endif
 
 #ifdef USE_HDF
+    // what we know about how an open dataset is stored - if its data sits in
+    //  the file unfiltered, reads can bypass the library and go straight to
+    //  the file
+    struct HDFDatasetLayout {
+      int ndims;
+      hsize_t dims[H5S_MAX_RANK];
+      hsize_t chunk[H5S_MAX_RANK]; // == dims for contiguous datasets
+      bool chunked;
+      bool direct;      // data can be read with pread() on 'fd'
+      haddr_t offset;   // file offset of a contiguous dataset's data
+      size_t elem_size;
+      int fd;
+    };
+
     class HDFRequest : public Request {
     public:
       void *mem_base; // could be source or dest
       hid_t dataset_id, datatype_id;
       hid_t mem_space_id, file_space_id;
+      hid_t xfer_plist_id;
+      const HDFDatasetLayout *layout;
+      const std::string *filename, *dsetname;
     };
 #endif
 
@@ -562,7 +579,10 @@ namespace Realm {
 
       struct HDFFileInfo {
 	hid_t file_id;
+	hid_t xfer_plist_id;
+	int fd; // -1 unless direct reads are possible
 	std::map<std::string, hid_t> dset_ids;
+	std::map<std::string, HDFDatasetLayout> layouts;
       };
 
     private:
@@ -731,6 +751,54 @@ namespace Realm {
       std::deque<MemcpyRequest*> thread_queue;
     };
 
+    // splits large copies into chunks shared between the calling thread and
+    //  a set of helper threads
+    class MemcpyHelperPool {
+    public:
+      MemcpyHelperPool(int _num_helpers);
+      ~MemcpyHelperPool();
+
+      void start_threads(CoreReservation& rsrv, std::vector<Thread *>& threads);
+      void stop();
+
+      // returns once all 'bytes' have been copied
+      void copy(void *dst, const void *src, size_t bytes, bool nontemporal);
+
+      // serializes 'count' elements (spaced 'field_size' apart) into 'dst',
+      //  which must have room for all of them - returns the bytes used
+      size_t serialize(const CustomSerdezUntyped *serdez_op,
+		       const void *src, size_t field_size, size_t count,
+		       void *dst);
+
+      void helper_thread_loop();
+
+    private:
+      struct Chunk {
+	enum Kind { COPY, SERDEZ_SIZE, SERDEZ_SERIALIZE };
+	Kind kind;
+	char *dst;
+	const char *src;
+	size_t bytes;
+	bool nontemporal;
+	// for the serdez kinds, 'count' elements starting at 'src'
+	const CustomSerdezUntyped *serdez_op;
+	size_t field_size, count;
+	size_t *result;
+	int *remaining;
+      };
+
+      void run_chunk(const Chunk& c);
+      // runs the first chunk on the calling thread and the rest on the
+      //  helpers, returning once they're all done
+      void run_chunks(std::vector<Chunk>& work);
+
+      int num_helpers;
+      bool is_stopped;
+      std::deque<Chunk> chunks;
+      pthread_mutex_t lock;
+      pthread_cond_t work_cond, done_cond;
+    };
+
     class MemcpyChannel : public Channel {
     public:
       MemcpyChannel(long max_nr);
@@ -749,8 +817,17 @@ namespace Realm {
 				 unsigned *bw_ret = 0,
 				 unsigned *lat_ret = 0);
 
+      // large copies are split across 'helpers', if non-null
+      void set_helper_pool(MemcpyHelperPool *_helpers) { helpers = _helpers; }
+
       bool is_stopped;
     private:
+      void copy_bytes(void *dst, const void *src, size_t bytes);
+      size_t serialize_elems(const CustomSerdezUntyped *serdez_op,
+			     const void *src, size_t field_size, size_t count,
+			     void *dst);
+
+      MemcpyHelperPool *helpers;
       std::deque<MemcpyRequest*> pending_queue, finished_queue;
       pthread_mutex_t pending_lock, finished_lock;
       pthread_cond_t pending_cond;
@@ -781,11 +858,24 @@ namespace Realm {
       void notify_completion() {
         __sync_fetch_and_add(&capacity, 1);
       }
+      // lets the network read directly from a local framebuffer
+      //  (requires a GPUDirect RDMA-capable network layer)
+      void add_gpudirect_path(Memory fbmem);
     private:
+      // starts a one-sided put of the request's data, if it qualifies
+      bool start_put(RemoteWriteRequest *req);
+      void complete_put(RemoteWriteRequest *req);
+      // sends the request's data compressed, if it qualifies and that
+      //  actually makes it smaller
+      bool start_compressed_write(RemoteWriteRequest *req);
+
       // RemoteWriteChannel is maintained by dma threads
       // and active message threads, so we need atomic ops
       // for preventing data race
       long capacity;
+      // puts that are still in flight (only used with GASNet)
+      struct PendingPuts;
+      PendingPuts *pending_puts;
     };
    
 #ifdef USE_CUDA
@@ -804,6 +894,40 @@ namespace Realm {
 #endif
 
 #ifdef USE_HDF
+    // one chunk (or, for contiguous datasets, one slab) of a direct read
+    struct HDFReadPiece {
+      const HDFRequest *req;
+      hsize_t lo[H5S_MAX_RANK], hi[H5S_MAX_RANK]; // dataset coords, inclusive
+      hsize_t req_lo[H5S_MAX_RANK], req_ext[H5S_MAX_RANK];
+      hsize_t chunk_lo[H5S_MAX_RANK];
+      haddr_t chunk_addr;
+      size_t chunk_bytes;
+      int *remaining;
+    };
+
+    class HDFHelperPool {
+    public:
+      HDFHelperPool(int _num_helpers);
+      ~HDFHelperPool();
+
+      void start_threads(CoreReservation& rsrv, std::vector<Thread *>& threads);
+      void stop();
+
+      // returns once every piece has been read - the caller works on them too
+      void read_pieces(std::vector<HDFReadPiece>& pieces);
+
+      int get_num_helpers() const { return num_helpers; }
+
+      void helper_thread_loop();
+
+    private:
+      int num_helpers;
+      bool is_stopped;
+      std::deque<HDFReadPiece *> pieces;
+      pthread_mutex_t lock;
+      pthread_cond_t work_cond, done_cond;
+    };
+
     class HDFChannel : public Channel {
     public:
       HDFChannel(long max_nr, XferDes::XferKind _kind);
@@ -811,8 +935,15 @@ namespace Realm {
       long submit(Request** requests, long nr);
       void pull();
       long available();
+
+      void set_helper_pool(HDFHelperPool *_helpers) { helpers = _helpers; }
+
     private:
+      bool read_staged(HDFRequest *req);
+      void read_direct(HDFRequest *req);
+
       long capacity;
+      HDFHelperPool *helpers;
     };
 #endif
 
@@ -1080,6 +1211,38 @@ namespace Realm {
       }
     };
 
+    // the payload is a Header followed by the compressed data, which is
+    //  decompressed straight into the destination on the target node
+    struct XferDesRemoteCompressedWriteMessage {
+      struct RequestArgs : public BaseMedium {
+        RemoteWriteRequest *req;
+        NodeID sender;
+      };
+
+      struct Header {
+        void *dst_buf;
+        size_t line_bytes, nlines;
+	XferDesID next_xd_guid;
+	size_t span_start, span_size, pre_bytes_total;
+      };
+
+      static void handle_request(RequestArgs args, const void *data, size_t datalen);
+
+      typedef ActiveMessageMediumNoReply<XFERDES_REMOTEWRITE_COMPRESSED_MSGID,
+                                         RequestArgs,
+                                         handle_request> Message;
+
+      // takes ownership of the payload, which must have been malloc'd
+      static void send_request(NodeID target, void *payload, size_t datalen,
+                               RemoteWriteRequest* req)
+      {
+        RequestArgs args;
+        args.req = req;
+        args.sender = my_node_id;
+        Message::request(target, args, payload, datalen, PAYLOAD_FREE);
+      }
+    };
+
     struct XferDesRemoteWriteAckMessage {
       struct RequestArgs {
         RemoteWriteRequest* req;
@@ -1241,6 +1404,10 @@ namespace Realm {
         num_threads = 0;
         num_memcpy_threads = 0;
         dma_threads = NULL;
+        memcpy_helpers = NULL;
+#ifdef USE_HDF
+        hdf_helpers = NULL;
+#endif
       }
 
       ~XferDesQueue() {
@@ -1431,7 +1598,12 @@ namespace Realm {
       int num_threads, num_memcpy_threads;
       DMAThread** dma_threads;
       MemcpyThread** memcpy_threads;
+      MemcpyHelperPool* memcpy_helpers;
+#ifdef USE_HDF
+      HDFHelperPool* hdf_helpers;
+#endif
       std::vector<Thread*> worker_threads;
+      std::vector<Thread*> helper_threads;
     };
 
     XferDesQueue* get_xdq_singleton();
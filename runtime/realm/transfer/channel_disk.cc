@@ -15,6 +15,10 @@
  */
 
 #include "realm/transfer/channel_disk.h"
+#include "realm/realm_config.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 namespace Realm {
 
@@ -46,6 +50,8 @@ namespace Realm {
 		_max_req_size, _priority,
                 _order, _kind, _complete_fence)
       , fd(-1) // defer file open
+      , map_attempted(false), mapped_base(0), mapped_size(0)
+      , next_seq_off(-1), cur_advice(MADV_NORMAL)
     {
       // grab the file's name from the instance metadata
       RegionInstanceImpl *impl = get_runtime()->get_instance_impl(inst);
@@ -110,7 +116,12 @@ namespace Realm {
 	      assert(fd >= 0);
 	    }
 	    reqs[i]->fd = fd;
+	    reqs[i]->filename = &filename;
+	    map_file();
+	    reqs[i]->mapped_base = (((size_t)(reqs[i]->file_off + reqs[i]->nbytes) <= mapped_size) ?
+				      mapped_base : 0);
           }
+	  advise_access(reqs, new_nr);
           break;
         }
         case XferDes::XFER_FILE_WRITE:
@@ -134,7 +145,12 @@ namespace Realm {
 	      assert(fd >= 0);
 	    }
 	    reqs[i]->fd = fd;
+	    reqs[i]->filename = &filename;
+	    map_file();
+	    reqs[i]->mapped_base = (((size_t)(reqs[i]->file_off + reqs[i]->nbytes) <= mapped_size) ?
+				      mapped_base : 0);
           }
+	  advise_access(reqs, new_nr);
           break;
         }
         default:
@@ -150,11 +166,75 @@ namespace Realm {
 
     void FileXferDes::notify_request_write_done(Request* req)
     {
+      if(kind == XferDes::XFER_FILE_WRITE) {
+	StagingCache *staging = StagingCache::get_singleton();
+	if(staging)
+	  staging->write_finished(*((FileRequest *)req)->filename);
+      }
       default_notify_request_write_done(req);
     }
 
+    void FileXferDes::map_file(void)
+    {
+      if(map_attempted || !Config::file_mmap) return;
+      map_attempted = true;
+
+      struct stat st;
+      if((fstat(fd, &st) != 0) || (st.st_size == 0))
+	return;
+
+      int prot = ((kind == XferDes::XFER_FILE_READ) ? PROT_READ :
+		                                      (PROT_READ | PROT_WRITE));
+      void *base = mmap(0, st.st_size, prot, MAP_SHARED, fd, 0);
+      if(base == MAP_FAILED) {
+	log_new_dma.info() << "mmap of \"" << filename << "\" failed ("
+			   << strerror(errno) << ") - using explicit I/O";
+	return;
+      }
+      mapped_base = static_cast<char *>(base);
+      mapped_size = st.st_size;
+    }
+
+    void FileXferDes::advise_access(FileRequest** reqs, long nr)
+    {
+      if(!mapped_base) return;
+
+      // a copy that walks through the file in order gets aggressive
+      //  readahead, but once one jumps around, stop the kernel from pulling
+      //  in pages it won't use
+      for(long i = 0; i < nr; i++) {
+	if(!reqs[i]->mapped_base) continue;
+	bool sequential = ((next_seq_off < 0) ||
+			   (reqs[i]->file_off == next_seq_off));
+	next_seq_off = reqs[i]->file_off + reqs[i]->nbytes;
+	int advice = ((sequential && (cur_advice != MADV_RANDOM)) ? MADV_SEQUENTIAL :
+		                                                    MADV_RANDOM);
+	if(advice != cur_advice) {
+	  madvise(mapped_base, mapped_size, advice);
+	  cur_advice = advice;
+	}
+      }
+
+      // for reads, ask for everything this batch needs up front so that the
+      //  page faults in the copies overlap with each other
+      if(kind == XferDes::XFER_FILE_READ) {
+	static const size_t page_size = sysconf(_SC_PAGESIZE);
+	for(long i = 0; i < nr; i++) {
+	  if(!reqs[i]->mapped_base) continue;
+	  size_t lo = reqs[i]->file_off & ~(page_size - 1);
+	  size_t hi = reqs[i]->file_off + reqs[i]->nbytes;
+	  madvise(mapped_base + lo, hi - lo, MADV_WILLNEED);
+	}
+      }
+    }
+
     void FileXferDes::flush()
     {
+      if(mapped_base) {
+	munmap(mapped_base, mapped_size);
+	mapped_base = 0;
+	mapped_size = 0;
+      }
       if(fd >= 0) {
 	close(fd);
 	fd = -1;
@@ -268,15 +348,17 @@ namespace Realm {
 
       static const Memory::Kind cpu_mem_kinds[] = { Memory::SYSTEM_MEM,
 						    Memory::REGDMA_MEM,
-						    Memory::Z_COPY_MEM };
+						    Memory::Z_COPY_MEM,
+						    Memory::GPU_MANAGED_MEM };
       static const size_t num_cpu_mem_kinds = sizeof(cpu_mem_kinds) / sizeof(cpu_mem_kinds[0]);
 
     FileChannel::FileChannel(long max_nr, XferDes::XferKind _kind)
       : Channel(_kind)
     {
-      unsigned bw = 0; // TODO
-      unsigned latency = 0;
-      // any combination of SYSTEM/REGDMA/Z_COPY_MEM
+      // nominal storage estimates
+      unsigned bw = 1000;
+      unsigned latency = 100000;
+      // any combination of SYSTEM/REGDMA/Z_COPY/GPU_MANAGED_MEM
       for(size_t i = 0; i < num_cpu_mem_kinds; i++)
 	if(_kind == XferDes::XFER_FILE_READ)
 	  add_path(Memory::FILE_MEM, false,
@@ -295,15 +377,45 @@ namespace Realm {
     long FileChannel::submit(Request** requests, long nr)
     {
       AsyncFileIOContext* aio_ctx = AsyncFileIOContext::get_singleton();
+      StagingCache *staging = StagingCache::get_singleton();
+      static const std::string no_dataset;
       for (long i = 0; i < nr; i++) {
         FileRequest* req = (FileRequest*) requests[i];
 	assert(!req->xd->src_serdez_op && !req->xd->dst_serdez_op); // no serdez support
         switch (kind) {
           case XferDes::XFER_FILE_READ:
+	  {
+	    // data that was prefetched doesn't need to come from the file
+	    size_t lo = req->file_off;
+	    size_t extent = req->nbytes;
+	    if(staging && staging->get(*req->filename, no_dataset,
+				       1, &lo, &extent, 1, req->mem_base)) {
+	      req->xd->notify_request_read_done(req);
+	      req->xd->notify_request_write_done(req);
+	      break;
+	    }
+	    // a mapped file is just memory (page cache hits don't even need
+	    //  the kernel)
+	    if(req->mapped_base) {
+	      memcpy(req->mem_base, req->mapped_base + req->file_off, req->nbytes);
+	      req->xd->notify_request_read_done(req);
+	      req->xd->notify_request_write_done(req);
+	      break;
+	    }
             aio_ctx->enqueue_read(req->fd, req->file_off,
                                   req->nbytes, req->mem_base, req);
             break;
+	  }
           case XferDes::XFER_FILE_WRITE:
+	    // finished in FileXferDes::notify_request_write_done
+	    if(staging)
+	      staging->write_started(*req->filename);
+	    if(req->mapped_base) {
+	      memcpy(req->mapped_base + req->file_off, req->mem_base, req->nbytes);
+	      req->xd->notify_request_read_done(req);
+	      req->xd->notify_request_write_done(req);
+	      break;
+	    }
             aio_ctx->enqueue_write(req->fd, req->file_off,
                                    req->nbytes, req->mem_base, req);
             break;
@@ -316,6 +428,25 @@ namespace Realm {
 
     void FileChannel::pull()
     {
+      // start any prefetches that have been asked for
+      if(kind == XferDes::XFER_FILE_READ) {
+	StagingCache *staging = StagingCache::get_singleton();
+	if(staging) {
+	  AsyncFileIOContext* aio_ctx = AsyncFileIOContext::get_singleton();
+	  StagingCache::Entry *e;
+	  while((e = staging->next_to_issue(false /*!hdf5*/)) != 0) {
+	    e->fd = open(e->filename.c_str(), O_RDONLY);
+	    if(e->fd < 0) {
+	      log_new_dma.warning() << "prefetch of \"" << e->filename
+				    << "\" failed: " << strerror(errno);
+	      staging->read_done(e, false /*!ok*/);
+	      continue;
+	    }
+	    aio_ctx->enqueue_staging_read(e->fd, e->lo[0], e->extent[0],
+					  e->buffer, &e->ready);
+	  }
+	}
+      }
       AsyncFileIOContext::get_singleton()->make_progress();
     }
 
@@ -327,9 +458,10 @@ namespace Realm {
     DiskChannel::DiskChannel(long max_nr, XferDes::XferKind _kind)
       : Channel(_kind)
     {
-      unsigned bw = 0; // TODO
-      unsigned latency = 0;
-      // any combination of SYSTEM/REGDMA/Z_COPY_MEM
+      // nominal storage estimates
+      unsigned bw = 1000;
+      unsigned latency = 100000;
+      // any combination of SYSTEM/REGDMA/Z_COPY/GPU_MANAGED_MEM
       for(size_t i = 0; i < num_cpu_mem_kinds; i++)
 	if(_kind == XferDes::XFER_DISK_READ)
 	  add_path(Memory::DISK_MEM, false,
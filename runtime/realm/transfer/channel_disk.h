@@ -25,6 +25,8 @@ namespace Realm {
       int fd;
       void *mem_base; // could be source or dest
       off_t file_off;
+      const std::string *filename;
+      char *mapped_base; // non-null if the file is mapped into memory
     };
     class DiskRequest : public Request {
     public:
@@ -57,10 +59,20 @@ namespace Realm {
       void notify_request_write_done(Request* req);
       void flush();
     private:
+      // maps the file (if enabled and possible) and advises the kernel on
+      //  how the next 'nr' requests will access it
+      void map_file(void);
+      void advise_access(FileRequest** reqs, long nr);
+
       FileRequest* file_reqs;
       std::string filename;
       int fd; // The file that stores the physical instance
       //const char *buf_base;
+      bool map_attempted;
+      char *mapped_base;
+      size_t mapped_size;
+      off_t next_seq_off; // where a sequential access would continue
+      int cur_advice;
     };
 
     class DiskXferDes : public XferDes {
@@ -19,6 +19,10 @@
 #include "realm/deppart/inst_helper.h"
 #include "realm/mem_impl.h"
 #include "realm/inst_impl.h"
+#include "realm/transfer/lowlevel_dma.h"
+#ifdef USE_HDF
+#include "realm/hdf5/hdf5_access.h"
+#endif
 
 #include <sys/types.h>
 #include <time.h>
@@ -285,6 +289,93 @@ namespace Realm {
 							   const ProfilingRequestSet&, \
 							   Event);
   FOREACH_NT(DOIT)
+  #undef DOIT
+
+  extern Logger log_dma;
+
+  template <int N, typename T>
+  void RegionInstance::prefetch(const Rect<N,T>& subrect,
+				const std::vector<FieldID>& field_ids) const
+  {
+    StagingCache *sc = StagingCache::get_singleton();
+    if(!sc) return;
+
+    if(ID(*this).instance.owner_node != my_node_id) {
+      log_dma.warning() << "prefetch ignored for remote instance " << *this;
+      return;
+    }
+    RegionInstanceImpl *impl = get_runtime()->get_instance_impl(*this);
+    Memory::Kind kind = impl->memory.kind();
+    if((kind != Memory::FILE_MEM) && (kind != Memory::HDF_MEM))
+      return;
+    if(!impl->metadata.is_valid()) {
+      log_dma.info() << "prefetch ignored for instance that isn't ready: " << *this;
+      return;
+    }
+    const InstanceLayout<N,T> *layout = dynamic_cast<const InstanceLayout<N,T> *>(impl->metadata.layout);
+    assert(layout != 0);
+
+    size_t queued = 0;
+    for(std::vector<FieldID>::const_iterator it = field_ids.begin();
+	it != field_ids.end();
+	++it) {
+      std::map<FieldID, InstanceLayoutGeneric::FieldLayout>::const_iterator it2 = layout->fields.find(*it);
+      assert(it2 != layout->fields.end());
+      size_t field_size = it2->second.size_in_bytes;
+      const InstancePieceList<N,T>& piece_list = layout->piece_lists[it2->second.list_idx];
+      for(typename std::vector<InstanceLayoutPiece<N,T> *>::const_iterator it3 = piece_list.pieces.begin();
+	  it3 != piece_list.pieces.end();
+	  ++it3) {
+	Rect<N,T> isect = subrect.intersection((*it3)->bounds);
+	if(isect.empty()) continue;
+
+	switch((*it3)->layout_type) {
+	case InstanceLayoutPiece<N,T>::AffineLayoutType:
+	case InstanceLayoutPiece<N,T>::BlockedLayoutType:
+	  {
+	    // stage the whole range of the file that the rectangle touches
+	    //  (offsets grow with every coordinate in both layouts)
+	    const InstanceLayoutPiece<N,T> *ilp = *it3;
+	    size_t start = (impl->metadata.inst_offset + it2->second.rel_offset +
+			    ilp->calculate_offset(isect.lo));
+	    size_t end = (impl->metadata.inst_offset + it2->second.rel_offset +
+			  ilp->calculate_offset(isect.hi) + field_size);
+	    queued += sc->add(impl->metadata.filename, std::string(),
+			      std::vector<size_t>(1, start),
+			      std::vector<size_t>(1, end - start),
+			      1);
+	    break;
+	  }
+#ifdef USE_HDF
+	case InstanceLayoutPiece<N,T>::HDF5LayoutType:
+	  {
+	    // same translation to dataset coordinates as the HDF5 iterator
+	    //  uses - HDF5 is row-major, so dimensions are reversed
+	    const HDF5LayoutPiece<N,T> *hlp = static_cast<const HDF5LayoutPiece<N,T> *>(*it3);
+	    std::vector<size_t> lo(N), extent(N);
+	    for(int d = 0; d < N; d++) {
+	      lo[N - 1 - d] = (isect.lo[d] - hlp->bounds.lo[d] + hlp->offset[d]);
+	      extent[N - 1 - d] = (isect.hi[d] - isect.lo[d] + 1);
+	    }
+	    queued += sc->add(hlp->filename, hlp->dsetname, lo, extent,
+			      field_size);
+	    break;
+	  }
+#endif
+	default:
+	  break;
+	}
+      }
+    }
+    log_dma.info() << "prefetch: inst=" << *this << " subrect=" << subrect
+		   << " staged=" << queued;
+  }
+
+  #define DOIT(N,T) \
+  template void RegionInstance::prefetch<N,T>(const Rect<N,T>&, \
+					      const std::vector<FieldID>&) const;
+  FOREACH_NT(DOIT)
+  #undef DOIT
 
 
 
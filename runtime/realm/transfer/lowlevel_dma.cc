@@ -29,12 +29,18 @@
 #else
 #include <aio.h>
 #endif
+#ifdef REALM_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
 
 #ifdef USE_CUDA
 #include "realm/cuda/cuda_module.h"
 #endif
 
 #include <queue>
+#include <set>
 #include <algorithm>
 #include <iomanip>
 
@@ -58,6 +64,13 @@ namespace Realm {
     Logger log_ib_alloc("ib_alloc");
     //extern Logger log_new_dma;
     Logger log_aio("aio");
+
+    namespace Config {
+      bool aio_register_buffers = false;
+      bool file_mmap = false;
+      int ib_cache_mb = 0;
+      int staging_cache_mb = 0;
+    };
 #ifdef EVENT_GRAPH_TRACE
     extern Logger log_event_graph;
     extern Event find_enclosing_termination_event(void);
@@ -99,32 +112,96 @@ namespace Realm {
     protected:
       GASNetHSL queue_mutex;
       std::map<Memory, std::queue<IBAllocRequest*> *> queues;
+      // memories whose caching has been turned off because of waiting
+      //  requests
+      std::set<Memory> reclaiming;
+    };
+
+    // intermediate buffers released on this node, kept for reuse by later
+    //  copies to avoid the allocation (and for remote memories, the round
+    //  trip) - buffers are rounded up to size classes (four per power of two,
+    //  so at most 25% larger than requested) so that similar copies can
+    //  share them
+    class IBCache {
+    public:
+      IBCache(size_t _max_bytes_per_mem);
+      ~IBCache(void);
+
+      static size_t size_class(size_t ib_size);
+
+      // returns an offset, or -1 if nothing of that size is cached
+      off_t get(Memory mem, size_t size);
+
+      // returns false if the buffer should be freed instead
+      bool put(Memory mem, size_t size, off_t offset);
+
+      // turns caching for 'mem' on or off - turning it off hands back
+      //  everything that was cached so it can be freed
+      void set_enabled(Memory mem, bool enabled,
+		       std::vector<std::pair<off_t, size_t> >& to_free);
+
+    protected:
+      struct MemCache {
+	MemCache(void) : enabled(true), cached_bytes(0) {}
+	bool enabled;
+	size_t cached_bytes;
+	std::map<size_t, std::vector<off_t> > free_offsets;
+      };
+
+      GASNetHSL mutex;
+      size_t max_bytes_per_mem;
+      std::map<Memory, MemCache> caches;
+      size_t hits, misses;
     };
 
     class DmaRequest;
 
     class DmaRequestQueue {
     public:
-      DmaRequestQueue(CoreReservationSet& crs);
+      // if 'split_channels' is false, every request goes through a single
+      //  shared queue
+      DmaRequestQueue(CoreReservationSet& crs, bool _split_channels);
+      ~DmaRequestQueue(void);
 
+      // requests are routed to the queue for the channel they need
       void enqueue_request(DmaRequest *r);
 
-      DmaRequest *dequeue_request(bool sleep = true);
-
       void shutdown_queue(void);
 
+      // starts 'count' workers for each queue
       void start_workers(int count);
 
-      void worker_thread_loop(void);
+      static DmaChannel choose_channel(const DmaRequest *r);
 
     protected:
-      GASNetHSL queue_mutex;
-      GASNetCondVar queue_condvar;
-      std::map<int, std::list<DmaRequest *> *> queues;
-      int queue_sleepers;
-      bool shutdown_flag;
-      CoreReservation core_rsrv;
-      std::vector<Thread *> worker_threads;
+      // requests for a single channel, with a list per priority level
+      class ChannelQueue {
+      public:
+	ChannelQueue(const std::string& name, CoreReservationSet& crs);
+	~ChannelQueue(void);
+
+	void enqueue_request(DmaRequest *r);
+
+	DmaRequest *dequeue_request(bool sleep = true);
+
+	void shutdown_queue(void);
+
+	void start_workers(int count);
+
+	void worker_thread_loop(void);
+
+      protected:
+	GASNetHSL queue_mutex;
+	GASNetCondVar queue_condvar;
+	std::map<int, std::list<DmaRequest *> *> queues;
+	int queue_sleepers;
+	bool shutdown_flag;
+	CoreReservation core_rsrv;
+	std::vector<Thread *> worker_threads;
+      };
+
+      bool split_channels;
+      ChannelQueue *channels[DMA_CHANNEL_COUNT];  // only [0] if not split
     };
 
   ////////////////////////////////////////////////////////////////////////
@@ -159,6 +236,23 @@ namespace Realm {
       os << "DmaRequest";
     }
 
+    /*virtual*/ void DmaRequest::boost_priority(int new_priority, int depth)
+    {
+      // once queued, the channel's per-priority lists would have to be
+      //  reshuffled, so only requests still waiting are affected
+      if(state >= STATE_QUEUED)
+	return;
+      int old_priority = priority;
+      while(new_priority > old_priority) {
+	int prev = __sync_val_compare_and_swap(&priority, old_priority, new_priority);
+	if(prev == old_priority) {
+	  log_dma.debug() << "dma request " << (void *)this << " priority boosted: " << old_priority << " -> " << new_priority;
+	  break;
+	}
+	old_priority = prev;
+      }
+    }
+
 
   ////////////////////////////////////////////////////////////////////////
   //
@@ -174,96 +268,573 @@ namespace Realm {
     }
 
     static PendingIBQueue *ib_req_queue = 0;
+    static IBCache *ib_cache = 0;
+
+#define IB_MAX_SIZE size_t(64 * 1024 * 1024)
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class IBCache
+  //
+
+    IBCache::IBCache(size_t _max_bytes_per_mem)
+      : max_bytes_per_mem(_max_bytes_per_mem), hits(0), misses(0)
+    {}
+
+    IBCache::~IBCache(void)
+    {
+      log_ib_alloc.info() << "ib cache: hits=" << hits << " misses=" << misses;
+    }
+
+    /*static*/ size_t IBCache::size_class(size_t ib_size)
+    {
+      if(ib_size >= IB_MAX_SIZE)
+	return ib_size;
+      size_t sc = 4096;
+      while(sc < ib_size)
+	sc <<= 1;
+      // split (sc/2, sc] into four classes
+      if(sc > 4096) {
+	size_t step = sc >> 3;
+	sc = ((ib_size + step - 1) / step) * step;
+      }
+      return std::min(sc, IB_MAX_SIZE);
+    }
+
+    off_t IBCache::get(Memory mem, size_t size)
+    {
+      AutoHSLLock al(mutex);
+      std::map<Memory, MemCache>::iterator it = caches.find(mem);
+      if(it != caches.end()) {
+	std::map<size_t, std::vector<off_t> >::iterator it2 = it->second.free_offsets.find(size);
+	if((it2 != it->second.free_offsets.end()) && !it2->second.empty()) {
+	  off_t offset = it2->second.back();
+	  it2->second.pop_back();
+	  it->second.cached_bytes -= size;
+	  hits++;
+	  return offset;
+	}
+      }
+      misses++;
+      return -1;
+    }
+
+    bool IBCache::put(Memory mem, size_t size, off_t offset)
+    {
+      AutoHSLLock al(mutex);
+      MemCache& mc = caches[mem];
+      if(!mc.enabled || ((mc.cached_bytes + size) > max_bytes_per_mem))
+	return false;
+      mc.free_offsets[size].push_back(offset);
+      mc.cached_bytes += size;
+      return true;
+    }
+
+    void IBCache::set_enabled(Memory mem, bool enabled,
+			      std::vector<std::pair<off_t, size_t> >& to_free)
+    {
+      AutoHSLLock al(mutex);
+      MemCache& mc = caches[mem];
+      mc.enabled = enabled;
+      if(enabled) return;
+      for(std::map<size_t, std::vector<off_t> >::const_iterator it = mc.free_offsets.begin();
+	  it != mc.free_offsets.end();
+	  it++)
+	for(std::vector<off_t>::const_iterator it2 = it->second.begin();
+	    it2 != it->second.end();
+	    it2++)
+	  to_free.push_back(std::make_pair(*it2, it->first));
+      mc.free_offsets.clear();
+      mc.cached_bytes = 0;
+    }
+
+    static void broadcast_ib_caching(Memory mem, bool enabled);
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class StagingCache
+  //
+
+    static StagingCache *staging_cache = 0;
+
+    // prefetches are staged in pieces of about this size, so that a large
+    //  hint can be partially satisfied and copies needn't line up with it
+    static const size_t STAGING_PIECE_BYTES = 4 << 20;
+
+    StagingCache::StagingCache(size_t _max_bytes)
+      : max_bytes(_max_bytes), cur_bytes(0), use_counter(0)
+      , hits(0), misses(0)
+    {}
+
+    StagingCache::~StagingCache(void)
+    {
+      log_dma.info() << "staging cache: hits=" << hits << " misses=" << misses;
+      // nothing can be in flight once the dma system has been shut down
+      for(std::list<Entry *>::iterator it = entries.begin();
+	  it != entries.end();
+	  ++it)
+	free_entry(*it);
+    }
+
+    /*static*/ StagingCache *StagingCache::get_singleton(void)
+    {
+      return staging_cache;
+    }
+
+    void StagingCache::free_entry(Entry *e)
+    {
+      if(e->fd >= 0)
+	close(e->fd);
+      free(e->buffer);
+      cur_bytes -= e->bytes;
+      delete e;
+    }
+
+    // must be called with the lock held
+    bool StagingCache::make_room(size_t bytes)
+    {
+      if(bytes > max_bytes)
+	return false;
+      while((cur_bytes + bytes) > max_bytes) {
+	// evict stale entries first, then the least recently used
+	std::list<Entry *>::iterator victim = entries.end();
+	for(std::list<Entry *>::iterator it = entries.begin();
+	    it != entries.end();
+	    ++it) {
+	  Entry *e = *it;
+	  // can't free a buffer that a read or a copy is still using
+	  if((e->issued && !e->ready) || (e->users > 0))
+	    continue;
+	  if(e->stale) {
+	    victim = it;
+	    break;
+	  }
+	  // entries that haven't been read yet aren't worth evicting
+	  if(!e->issued)
+	    continue;
+	  if((victim == entries.end()) || (e->last_use < (*victim)->last_use))
+	    victim = it;
+	}
+	if(victim == entries.end())
+	  return false;
+	free_entry(*victim);
+	entries.erase(victim);
+      }
+      return true;
+    }
+
+    size_t StagingCache::add(const std::string& filename,
+			     const std::string& dsetname,
+			     const std::vector<size_t>& lo,
+			     const std::vector<size_t>& extent,
+			     size_t elem_size)
+    {
+      assert(!lo.empty() && (lo.size() == extent.size()));
+      size_t row_bytes = elem_size;
+      for(size_t i = 1; i < extent.size(); i++)
+	row_bytes *= extent[i];
+      if(row_bytes == 0)
+	return 0;
+      size_t rows_per_piece = std::max(STAGING_PIECE_BYTES / row_bytes,
+				       (size_t)1);
+
+      AutoHSLLock al(mutex);
+      size_t queued = 0;
+      for(size_t row = 0; row < extent[0]; row += rows_per_piece) {
+	std::vector<size_t> piece_lo(lo), piece_extent(extent);
+	piece_lo[0] = lo[0] + row;
+	piece_extent[0] = std::min(rows_per_piece, extent[0] - row);
+
+	// skip anything that's already staged (or on its way)
+	bool dup = false;
+	for(std::list<Entry *>::const_iterator it = entries.begin();
+	    it != entries.end();
+	    ++it)
+	  if(!(*it)->stale && ((*it)->filename == filename) &&
+	     ((*it)->dsetname == dsetname) && ((*it)->lo == piece_lo) &&
+	     ((*it)->extent == piece_extent) && ((*it)->elem_size == elem_size)) {
+	    dup = true;
+	    break;
+	  }
+	if(dup) continue;
+
+	size_t bytes = piece_extent[0] * row_bytes;
+	if(!make_room(bytes))
+	  break;
+	void *buffer = malloc(bytes);
+	if(!buffer)
+	  break;
+
+	Entry *e = new Entry;
+	e->filename = filename;
+	e->dsetname = dsetname;
+	e->lo = piece_lo;
+	e->extent = piece_extent;
+	e->elem_size = elem_size;
+	e->bytes = bytes;
+	e->buffer = buffer;
+	e->fd = -1;
+	e->issued = false;
+	e->stale = false;
+	e->ready = false;
+	e->users = 0;
+	e->last_use = ++use_counter;
+	entries.push_back(e);
+	cur_bytes += bytes;
+	queued += bytes;
+      }
+      return queued;
+    }
+
+    StagingCache::Entry *StagingCache::next_to_issue(bool hdf5)
+    {
+      AutoHSLLock al(mutex);
+      for(std::list<Entry *>::iterator it = entries.begin();
+	  it != entries.end();
+	  ++it) {
+	Entry *e = *it;
+	if(!e->issued && !e->stale && (e->dsetname.empty() != hdf5)) {
+	  e->issued = true;
+	  return e;
+	}
+      }
+      return 0;
+    }
+
+    void StagingCache::read_done(Entry *e, bool ok)
+    {
+      AutoHSLLock al(mutex);
+      if(!ok)
+	e->stale = true;
+      __sync_synchronize();  // data must be visible before the flag
+      e->ready = true;
+    }
+
+    bool StagingCache::get(const std::string& filename,
+			   const std::string& dsetname,
+			   int ndims, const size_t *lo, const size_t *extent,
+			   size_t elem_size, void *dst)
+    {
+      // find entries that cover the requested rows between them
+      std::vector<std::pair<Entry *, size_t> > pieces;  // entry, first row
+      {
+	AutoHSLLock al(mutex);
+	if(writes_in_flight.count(filename) > 0) {
+	  misses++;
+	  return false;
+	}
+	size_t row = lo[0];
+	size_t end = lo[0] + extent[0];
+	while(row < end) {
+	  Entry *found = 0;
+	  for(std::list<Entry *>::iterator it = entries.begin();
+	      it != entries.end();
+	      ++it) {
+	    Entry *e = *it;
+	    if(!e->ready || e->stale || (e->elem_size != elem_size) ||
+	       ((int)(e->lo.size()) != ndims) ||
+	       (e->filename != filename) || (e->dsetname != dsetname))
+	      continue;
+	    bool covers = ((e->lo[0] <= row) &&
+			   (row < (e->lo[0] + e->extent[0])));
+	    for(int i = 1; covers && (i < ndims); i++)
+	      covers = ((e->lo[i] <= lo[i]) &&
+			((lo[i] + extent[i]) <= (e->lo[i] + e->extent[i])));
+	    if(covers) {
+	      found = e;
+	      break;
+	    }
+	  }
+	  if(!found) {
+	    misses++;
+	    return false;
+	  }
+	  pieces.push_back(std::make_pair(found, row));
+	  row = found->lo[0] + found->extent[0];
+	}
+	for(size_t i = 0; i < pieces.size(); i++) {
+	  pieces[i].first->users++;
+	  pieces[i].first->last_use = ++use_counter;
+	}
+	hits++;
+      }
+
+      // copy without holding the lock, one run along the last dimension at
+      //  a time
+      for(size_t i = 0; i < pieces.size(); i++) {
+	Entry *e = pieces[i].first;
+	size_t row_lo = pieces[i].second;
+	size_t row_hi = std::min(e->lo[0] + e->extent[0], lo[0] + extent[0]);
+	size_t run = ((ndims == 1) ? (row_hi - row_lo) : extent[ndims - 1]) * elem_size;
+
+	std::vector<size_t> pt(lo, lo + ndims);
+	pt[0] = row_lo;
+	while(true) {
+	  size_t src_idx = 0;
+	  size_t dst_idx = 0;
+	  for(int d = 0; d < ndims; d++) {
+	    src_idx = (src_idx * e->extent[d]) + (pt[d] - e->lo[d]);
+	    dst_idx = (dst_idx * extent[d]) + (pt[d] - lo[d]);
+	  }
+	  memcpy(((char *)dst) + (dst_idx * elem_size),
+		 ((const char *)(e->buffer)) + (src_idx * elem_size),
+		 run);
+
+	  int d = ndims - 2;
+	  while(d >= 0) {
+	    size_t limit = ((d == 0) ? row_hi : (lo[d] + extent[d]));
+	    if(++pt[d] < limit) break;
+	    pt[d] = ((d == 0) ? row_lo : lo[d]);
+	    d--;
+	  }
+	  if(d < 0) break;
+	}
+      }
+
+      {
+	AutoHSLLock al(mutex);
+	for(size_t i = 0; i < pieces.size(); i++)
+	  pieces[i].first->users--;
+      }
+      return true;
+    }
+
+    // must be called with the lock held
+    void StagingCache::mark_stale(const std::string& filename)
+    {
+      for(std::list<Entry *>::iterator it = entries.begin();
+	  it != entries.end();
+	  ++it)
+	if((*it)->filename == filename)
+	  (*it)->stale = true;
+    }
+
+    void StagingCache::write_started(const std::string& filename)
+    {
+      AutoHSLLock al(mutex);
+      writes_in_flight[filename]++;
+      mark_stale(filename);
+    }
+
+    void StagingCache::write_finished(const std::string& filename)
+    {
+      AutoHSLLock al(mutex);
+      // staged reads issued while the write was in flight may have seen
+      //  old data
+      mark_stale(filename);
+      std::map<std::string, int>::iterator it = writes_in_flight.find(filename);
+      assert(it != writes_in_flight.end());
+      if(--(it->second) == 0)
+	writes_in_flight.erase(it);
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class PendingIBQueue
+  //
 
     PendingIBQueue::PendingIBQueue() {}
 
     void PendingIBQueue::enqueue_request(Memory tgt_mem, IBAllocRequest* req)
     {
-      AutoHSLLock al(queue_mutex);
-      assert(ID(tgt_mem).memory.owner_node == my_node_id);
-      // If we can allocate in target memory, no need to pend the request
-      off_t ib_offset = get_runtime()->get_memory_impl(tgt_mem)->alloc_bytes(req->ib_size);
-      if (ib_offset >= 0) {
-        if (req->owner == my_node_id) {
-          // local ib alloc request
-          CopyRequest* cr = (CopyRequest*) req->req;
-          RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(req->src_inst_id);
-          RegionInstanceImpl *dst_impl = get_runtime()->get_instance_impl(req->dst_inst_id);
-          InstPair inst_pair(src_impl->me, dst_impl->me);
-          cr->handle_ib_response(req->idx, inst_pair, req->ib_size, ib_offset);
+      bool start_reclaim = false;
+      {
+        AutoHSLLock al(queue_mutex);
+        assert(ID(tgt_mem).memory.owner_node == my_node_id);
+        // If we can allocate in target memory, no need to pend the request
+        off_t ib_offset = get_runtime()->get_memory_impl(tgt_mem)->alloc_bytes(req->ib_size);
+        if (ib_offset >= 0) {
+          if (req->owner == my_node_id) {
+            // local ib alloc request
+            CopyRequest* cr = (CopyRequest*) req->req;
+            RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(req->src_inst_id);
+            RegionInstanceImpl *dst_impl = get_runtime()->get_instance_impl(req->dst_inst_id);
+            InstPair inst_pair(src_impl->me, dst_impl->me);
+            cr->handle_ib_response(req->idx, inst_pair, req->ib_size, ib_offset);
+          } else {
+            // remote ib alloc request
+            RemoteIBAllocResponseAsync::send_request(req->owner, req->req, req->idx,
+                req->src_inst_id, req->dst_inst_id, req->ib_size, ib_offset); 
+          }
+          // Remember to free IBAllocRequest
+          delete req;
+
+          return;
+        }
+        log_ib_alloc.info("enqueue_request: src_inst(%llx) dst_inst(%llx) "
+                          "no enough space in memory(%llx)", req->src_inst_id, req->dst_inst_id, tgt_mem.id);
+        //log_ib_alloc.info() << " (" << req->src_inst_id << "," 
+        //  << req->dst_inst_id << "): no enough space in memory" << tgt_mem;
+        std::map<Memory, std::queue<IBAllocRequest*> *>::iterator it = queues.find(tgt_mem);
+        if (it == queues.end()) {
+          std::queue<IBAllocRequest*> *q = new std::queue<IBAllocRequest*>;
+          q->push(req);
+          queues[tgt_mem] = q;
+          //log_ib_alloc.info("enqueue_request: queue_length(%lu)", q->size());
         } else {
-          // remote ib alloc request
-          RemoteIBAllocResponseAsync::send_request(req->owner, req->req, req->idx,
-              req->src_inst_id, req->dst_inst_id, req->ib_size, ib_offset); 
+          it->second->push(req);
+          //log_ib_alloc.info("enqueue_request: queue_length(%lu)", it->second->size());
         }
-        // Remember to free IBAllocRequest
-        delete req;
-
-        return;
-      }
-      log_ib_alloc.info("enqueue_request: src_inst(%llx) dst_inst(%llx) "
-                        "no enough space in memory(%llx)", req->src_inst_id, req->dst_inst_id, tgt_mem.id);
-      //log_ib_alloc.info() << " (" << req->src_inst_id << "," 
-      //  << req->dst_inst_id << "): no enough space in memory" << tgt_mem;
-      std::map<Memory, std::queue<IBAllocRequest*> *>::iterator it = queues.find(tgt_mem);
-      if (it == queues.end()) {
-        std::queue<IBAllocRequest*> *q = new std::queue<IBAllocRequest*>;
-        q->push(req);
-        queues[tgt_mem] = q;
-        //log_ib_alloc.info("enqueue_request: queue_length(%lu)", q->size());
-      } else {
-        it->second->push(req);
-        //log_ib_alloc.info("enqueue_request: queue_length(%lu)", it->second->size());
+        // buffers cached by copies might be what's standing in the way
+        if(ib_cache && reclaiming.insert(tgt_mem).second)
+          start_reclaim = true;
+      }
+      if(start_reclaim) {
+        log_ib_alloc.info() << "reclaiming cached intermediate buffers in " << tgt_mem;
+        broadcast_ib_caching(tgt_mem, false /*!enabled*/);
       }
     }
 
     void PendingIBQueue::dequeue_request(Memory tgt_mem)
     {
-      AutoHSLLock al(queue_mutex);
-      assert(ID(tgt_mem).memory.owner_node == my_node_id);
-      std::map<Memory, std::queue<IBAllocRequest*> *>::iterator it = queues.find(tgt_mem);
-      // no pending ib requests
-      if (it == queues.end()) return;
-      while (!it->second->empty()) {
-        IBAllocRequest* req = it->second->front();
-        off_t ib_offset = get_runtime()->get_memory_impl(tgt_mem)->alloc_bytes(req->ib_size);
-        if (ib_offset < 0) break;
-        //printf("req: src_inst_id(%llx) dst_inst_id(%llx) ib_size(%lu) idx(%d)\n", req->src_inst_id, req->dst_inst_id, req->ib_size, req->idx);
-        // deal with the completed ib alloc request
-        log_ib_alloc.info() << "IBAllocRequest (" << req->src_inst_id << "," 
-          << req->dst_inst_id << "): completed!";
-        if (req->owner == my_node_id) {
-          // local ib alloc request
-          CopyRequest* cr = (CopyRequest*) req->req;
-          RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(req->src_inst_id);
-          RegionInstanceImpl *dst_impl = get_runtime()->get_instance_impl(req->dst_inst_id);
-          InstPair inst_pair(src_impl->me, dst_impl->me);
-          cr->handle_ib_response(req->idx, inst_pair, req->ib_size, ib_offset);
-        } else {
-          // remote ib alloc request
-          RemoteIBAllocResponseAsync::send_request(req->owner, req->req, req->idx,
-              req->src_inst_id, req->dst_inst_id, req->ib_size, ib_offset); 
+      bool end_reclaim = false;
+      {
+        AutoHSLLock al(queue_mutex);
+        assert(ID(tgt_mem).memory.owner_node == my_node_id);
+        std::map<Memory, std::queue<IBAllocRequest*> *>::iterator it = queues.find(tgt_mem);
+        // no pending ib requests
+        if (it == queues.end()) return;
+        while (!it->second->empty()) {
+          IBAllocRequest* req = it->second->front();
+          off_t ib_offset = get_runtime()->get_memory_impl(tgt_mem)->alloc_bytes(req->ib_size);
+          if (ib_offset < 0) break;
+          //printf("req: src_inst_id(%llx) dst_inst_id(%llx) ib_size(%lu) idx(%d)\n", req->src_inst_id, req->dst_inst_id, req->ib_size, req->idx);
+          // deal with the completed ib alloc request
+          log_ib_alloc.info() << "IBAllocRequest (" << req->src_inst_id << "," 
+            << req->dst_inst_id << "): completed!";
+          if (req->owner == my_node_id) {
+            // local ib alloc request
+            CopyRequest* cr = (CopyRequest*) req->req;
+            RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(req->src_inst_id);
+            RegionInstanceImpl *dst_impl = get_runtime()->get_instance_impl(req->dst_inst_id);
+            InstPair inst_pair(src_impl->me, dst_impl->me);
+            cr->handle_ib_response(req->idx, inst_pair, req->ib_size, ib_offset);
+          } else {
+            // remote ib alloc request
+            RemoteIBAllocResponseAsync::send_request(req->owner, req->req, req->idx,
+                req->src_inst_id, req->dst_inst_id, req->ib_size, ib_offset); 
+          }
+          it->second->pop();
+          // Remember to free IBAllocRequest
+          delete req;
+        }
+        // if queue is empty, delete from list
+        if(it->second->empty()) {
+          delete it->second;
+          queues.erase(it);
+          if(reclaiming.erase(tgt_mem) > 0)
+            end_reclaim = true;
         }
-        it->second->pop();
-        // Remember to free IBAllocRequest
-        delete req;
       }
-      // if queue is empty, delete from list
-      if(it->second->empty()) {
-	delete it->second;
-	queues.erase(it);
+      if(end_reclaim)
+        broadcast_ib_caching(tgt_mem, true /*enabled*/);
+    }
+
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class DmaRequestQueue
+  //
+
+    DmaRequestQueue::DmaRequestQueue(CoreReservationSet& crs,
+				     bool _split_channels)
+      : split_channels(_split_channels)
+    {
+      static const char *channel_names[DMA_CHANNEL_COUNT] = {
+	"memcpy", "gasnet", "gpu", "file"
+      };
+      for(int i = 0; i < DMA_CHANNEL_COUNT; i++)
+	channels[i] = 0;
+      if(split_channels) {
+	for(int i = 0; i < DMA_CHANNEL_COUNT; i++)
+	  channels[i] = new ChannelQueue(std::string("DMA request queue (") +
+					   channel_names[i] + ")",
+					 crs);
+      } else
+	channels[0] = new ChannelQueue("DMA request queue", crs);
+    }
+
+    DmaRequestQueue::~DmaRequestQueue(void)
+    {
+      for(int i = 0; i < DMA_CHANNEL_COUNT; i++)
+	if(channels[i])
+	  delete channels[i];
+    }
+
+    /*static*/ DmaChannel DmaRequestQueue::choose_channel(const DmaRequest *r)
+    {
+      std::vector<Memory> mems;
+      r->get_memories(mems);
+
+      // the slowest memory involved decides the channel
+      int channel = DMA_CHANNEL_MEMCPY;
+      for(std::vector<Memory>::const_iterator it = mems.begin();
+	  it != mems.end();
+	  ++it) {
+	if(!it->exists()) continue;
+	MemoryImpl *m = get_runtime()->get_memory_impl(*it);
+	int c;
+	switch(m->kind) {
+	case MemoryImpl::MKIND_DISK:
+	case MemoryImpl::MKIND_FILE:
+#ifdef USE_HDF
+	case MemoryImpl::MKIND_HDF:
+#endif
+	  c = DMA_CHANNEL_FILE; break;
+	case MemoryImpl::MKIND_GPUFB:
+	  c = DMA_CHANNEL_GPU; break;
+	case MemoryImpl::MKIND_GLOBAL:
+	case MemoryImpl::MKIND_RDMA:
+	case MemoryImpl::MKIND_REMOTE:
+	  c = DMA_CHANNEL_GASNET; break;
+	default:
+	  c = DMA_CHANNEL_MEMCPY; break;
+	}
+	if(c > channel)
+	  channel = c;
       }
+      return (DmaChannel)channel;
+    }
+
+    void DmaRequestQueue::enqueue_request(DmaRequest *r)
+    {
+      if(!split_channels) {
+	channels[0]->enqueue_request(r);
+	return;
+      }
+      DmaChannel c = choose_channel(r);
+      log_dma.debug() << "request " << (void *)r << " queued on channel " << c;
+      channels[c]->enqueue_request(r);
+    }
+
+    void DmaRequestQueue::shutdown_queue(void)
+    {
+      for(int i = 0; i < DMA_CHANNEL_COUNT; i++)
+	if(channels[i])
+	  channels[i]->shutdown_queue();
+    }
+
+    void DmaRequestQueue::start_workers(int count)
+    {
+      for(int i = 0; i < DMA_CHANNEL_COUNT; i++)
+	if(channels[i])
+	  channels[i]->start_workers(count);
     }
 
-    DmaRequestQueue::DmaRequestQueue(CoreReservationSet& crs)
+    DmaRequestQueue::ChannelQueue::ChannelQueue(const std::string& name,
+						CoreReservationSet& crs)
       : queue_condvar(queue_mutex)
-      , core_rsrv("DMA request queue", crs, CoreReservationParameters())
+      , core_rsrv(name, crs, CoreReservationParameters())
     {
       queue_sleepers = 0;
       shutdown_flag = false;
     }
 
-    void DmaRequestQueue::shutdown_queue(void)
+    DmaRequestQueue::ChannelQueue::~ChannelQueue(void)
+    {
+      assert(worker_threads.empty());
+    }
+
+    void DmaRequestQueue::ChannelQueue::shutdown_queue(void)
     {
       queue_mutex.lock();
 
@@ -285,7 +856,7 @@ namespace Realm {
       worker_threads.clear();
     }
 
-    void DmaRequestQueue::enqueue_request(DmaRequest *r)
+    void DmaRequestQueue::ChannelQueue::enqueue_request(DmaRequest *r)
     {
       // Record that it is ready - check for cancellation though
       bool ok_to_run = r->mark_ready();
@@ -319,7 +890,7 @@ namespace Realm {
       queue_mutex.unlock();
     }
 
-    DmaRequest *DmaRequestQueue::dequeue_request(bool sleep /*= true*/)
+    DmaRequest *DmaRequestQueue::ChannelQueue::dequeue_request(bool sleep /*= true*/)
     {
       queue_mutex.lock();
 
@@ -592,13 +1163,32 @@ namespace Realm {
       Message::request(target, args);
     }
 
+    static void update_ib_caching(Memory mem, bool enabled);
 
-#define IB_MAX_SIZE size_t(64 * 1024 * 1024)
+    ////////////////////////////////////////////////////////////////////////
+    //
+    // class RemoteIBCacheControlAsync
+    //
+
+    /*static*/ void RemoteIBCacheControlAsync::handle_request(RequestArgs args)
+    {
+      update_ib_caching(args.memory, args.enable);
+    }
+
+    /*static*/ void RemoteIBCacheControlAsync::send_request(NodeID target, Memory tgt_mem, bool enable)
+    {
+      RequestArgs args;
+      args.memory = tgt_mem;
+      args.enable = enable;
+      Message::request(target, args);
+    }
 
     void free_intermediate_buffer(DmaRequest* req, Memory mem, off_t offset, size_t size)
     {
       //CopyRequest* cr = (CopyRequest*) req;
       //AutoHSLLock al(cr->ib_mutex);
+      if(ib_cache && ib_cache->put(mem, size, offset))
+	return;
       if(ID(mem).memory.owner_node == my_node_id) {
         get_runtime()->get_memory_impl(mem)->free_bytes(offset, size);
         ib_req_queue->dequeue_request(mem);
@@ -609,6 +1199,28 @@ namespace Realm {
     }
 
 
+    // frees (or resumes caching) buffers in 'mem' on this node
+    static void update_ib_caching(Memory mem, bool enabled)
+    {
+      if(!ib_cache) return;
+      std::vector<std::pair<off_t, size_t> > to_free;
+      ib_cache->set_enabled(mem, enabled, to_free);
+      for(std::vector<std::pair<off_t, size_t> >::const_iterator it = to_free.begin();
+	  it != to_free.end();
+	  it++)
+	free_intermediate_buffer(0, mem, it->first, it->second);
+    }
+
+    // called on the owner of 'mem' when allocations there start (or stop)
+    //  having to wait
+    static void broadcast_ib_caching(Memory mem, bool enabled)
+    {
+      for(NodeID n = 0; n <= max_node_id; n++)
+	if(n != my_node_id)
+	  RemoteIBCacheControlAsync::send_request(n, mem, enabled);
+      update_ib_caching(mem, enabled);
+    }
+
     void CopyRequest::alloc_intermediate_buffer(InstPair inst_pair, Memory tgt_mem, int idx)
     {
       assert(oas_by_inst->find(inst_pair) != oas_by_inst->end());
@@ -629,6 +1241,14 @@ namespace Realm {
 
       size_t ib_size = std::min(domain_size * ib_elmnt_size + serdez_pad,
 				IB_MAX_SIZE);
+      if(ib_cache) {
+	ib_size = IBCache::size_class(ib_size);
+	off_t ib_offset = ib_cache->get(tgt_mem, ib_size);
+	if(ib_offset >= 0) {
+	  handle_ib_response(idx, inst_pair, ib_size, ib_offset);
+	  return;
+	}
+      }
       //log_ib_alloc.info("alloc_ib: src_inst_id(%llx) dst_inst_id(%llx) idx(%d) size(%lu) memory(%llx)", inst_pair.first.id, inst_pair.second.id, idx, ib_size, tgt_mem.id);
       if (ID(tgt_mem).memory.owner_node == my_node_id) {
         // create local intermediate buffer
@@ -679,6 +1299,17 @@ namespace Realm {
 	  return false;
 	}
 
+	// get requests for any missing instance metadata in flight together
+	//  rather than discovering them one at a time below
+	if(!just_check) {
+	  std::vector<RegionInstance> insts;
+	  for(OASByInst::iterator it = oas_by_inst->begin(); it != oas_by_inst->end(); it++) {
+	    insts.push_back(it->first.first);
+	    insts.push_back(it->first.second);
+	  }
+	  RegionInstance::prefetch_metadata(insts);
+	}
+
 	// now go through all instance pairs
 	for(OASByInst::iterator it = oas_by_inst->begin(); it != oas_by_inst->end(); it++) {
 	  RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(it->first.first);
@@ -778,6 +1409,18 @@ namespace Realm {
 	    return true;  // not enqueued, but never going to be
 	  } else {
 	    log_dma.debug("request %p - before event triggered", this);
+	    // the data is final now, so memories that migrate on demand can
+	    //  start moving it toward the other side of the copy
+	    for(OASByInst::iterator it = oas_by_inst->begin(); it != oas_by_inst->end(); it++) {
+	      RegionInstanceImpl *src_impl = get_runtime()->get_instance_impl(it->first.first);
+	      RegionInstanceImpl *dst_impl = get_runtime()->get_instance_impl(it->first.second);
+	      get_runtime()->get_memory_impl(src_impl->memory)->prefetch_for_copy(src_impl->metadata.alloc_offset,
+										 src_impl->metadata.size,
+										 dst_impl->memory);
+	      get_runtime()->get_memory_impl(dst_impl->memory)->prefetch_for_copy(dst_impl->metadata.alloc_offset,
+										 dst_impl->metadata.size,
+										 src_impl->memory);
+	    }
 	    state = STATE_ALLOC_IB;
 	  }
 	} else {
@@ -1074,6 +1717,112 @@ namespace Realm {
     }
 #endif
 
+#ifdef REALM_USE_IO_URING
+    inline int io_uring_setup(unsigned entries, struct io_uring_params *p)
+    {
+      return syscall(__NR_io_uring_setup, entries, p);
+    }
+
+    inline int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+			      unsigned flags)
+    {
+      return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+		     (void *)0, (size_t)0);
+    }
+
+    inline int io_uring_register(int fd, unsigned opcode, void *arg,
+				 unsigned nr_args)
+    {
+      return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+    }
+
+    // a single read or write - the kernel may complete less than what was
+    //  asked for, in which case the rest is resubmitted
+    class IOUringOperation : public AsyncFileIOContext::AIOOperation {
+    public:
+      IOUringOperation(AsyncFileIOContext *_ctx, bool _is_write,
+		       int _fd, size_t _offset, size_t _bytes,
+		       void *_buffer, Request* request = NULL);
+      virtual void launch(void);
+      virtual bool check_completion(void);
+
+      // called (with the context's mutex held) for each completion event
+      void handle_result(int res);
+
+    public:
+      AsyncFileIOContext *ctx;
+      bool is_write;
+      int fd;
+      size_t offset, bytes;
+      char *buffer;
+    };
+
+    IOUringOperation::IOUringOperation(AsyncFileIOContext *_ctx, bool _is_write,
+				       int _fd, size_t _offset, size_t _bytes,
+				       void *_buffer, Request* request)
+      : ctx(_ctx), is_write(_is_write), fd(_fd)
+      , offset(_offset), bytes(_bytes), buffer((char *)_buffer)
+    {
+      completed = false;
+      req = request;
+    }
+
+    void IOUringOperation::launch(void)
+    {
+      // the kernel caps a single read/write at just under 2GB anyway
+      const size_t MAX_LEN = 1U << 30;
+      size_t len = std::min(bytes, MAX_LEN);
+
+      struct io_uring_sqe *sqe = ctx->next_sqe();
+      memset(sqe, 0, sizeof(*sqe));
+      int buf_index = ctx->find_registered_buffer(buffer, len);
+      if(buf_index >= 0) {
+	sqe->opcode = (is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED);
+	sqe->buf_index = buf_index;
+      } else
+	sqe->opcode = (is_write ? IORING_OP_WRITE : IORING_OP_READ);
+      sqe->fd = fd;
+      sqe->off = offset;
+      sqe->addr = (uint64_t)buffer;
+      sqe->len = len;
+      sqe->user_data = (uint64_t)this;
+      log_aio.debug("%s queued: op=%p fd=%d off=%zd bytes=%zd fixed=%d",
+		    (is_write ? "write" : "read"), this, fd, offset, len,
+		    (buf_index >= 0));
+    }
+
+    bool IOUringOperation::check_completion(void)
+    {
+      return completed;
+    }
+
+    void IOUringOperation::handle_result(int res)
+    {
+      log_aio.debug("%s returned: op=%p res=%d",
+		    (is_write ? "write" : "read"), this, res);
+      if(res == -EINTR || res == -EAGAIN) {
+	// transient - just try again
+	launch();
+	return;
+      }
+      if(res <= 0) {
+	// a read past the end of the file is an error too
+	log_aio.fatal() << (is_write ? "write" : "read") << " failed: fd=" << fd
+			<< " offset=" << offset << " bytes=" << bytes
+			<< " error=" << ((res < 0) ? strerror(-res) : "unexpected EOF");
+	assert(0);
+      }
+      if((size_t)res < bytes) {
+	offset += res;
+	buffer += res;
+	bytes -= res;
+	launch();
+	return;
+      }
+      completed = true;
+    }
+#endif
+
     class AIOFence : public Operation::AsyncWorkItem {
     public:
       AIOFence(Operation *_op) : Operation::AsyncWorkItem(_op) {}
@@ -1124,6 +1873,52 @@ namespace Realm {
 #endif
 	io_setup(max_depth, &aio_ctx);
       assert(ret == 0);
+#endif
+#ifdef REALM_USE_IO_URING
+      sq_local_tail = 0;
+      struct io_uring_params params;
+      memset(&params, 0, sizeof(params));
+      ring_fd = io_uring_setup(max_depth, &params);
+      if(ring_fd >= 0) {
+	sq_entries = params.sq_entries;
+	sq_ring_bytes = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cq_ring_bytes = (params.cq_off.cqes +
+			 params.cq_entries * sizeof(struct io_uring_cqe));
+	sqes_bytes = params.sq_entries * sizeof(struct io_uring_sqe);
+	sq_ring_base = mmap(0, sq_ring_bytes, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	cq_ring_base = mmap(0, cq_ring_bytes, PROT_READ | PROT_WRITE,
+			    MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+	sqes = (struct io_uring_sqe *)mmap(0, sqes_bytes, PROT_READ | PROT_WRITE,
+					   MAP_SHARED | MAP_POPULATE, ring_fd,
+					   IORING_OFF_SQES);
+	assert((sq_ring_base != MAP_FAILED) && (cq_ring_base != MAP_FAILED) &&
+	       (sqes != MAP_FAILED));
+
+	char *sq = (char *)sq_ring_base;
+	sq_head = (volatile unsigned *)(sq + params.sq_off.head);
+	sq_tail = (volatile unsigned *)(sq + params.sq_off.tail);
+	sq_mask = *(unsigned *)(sq + params.sq_off.ring_mask);
+	sq_array = (unsigned *)(sq + params.sq_off.array);
+	sq_local_tail = *sq_tail;
+
+	char *cq = (char *)cq_ring_base;
+	cq_head = (volatile unsigned *)(cq + params.cq_off.head);
+	cq_tail = (volatile unsigned *)(cq + params.cq_off.tail);
+	cq_mask = *(unsigned *)(cq + params.cq_off.ring_mask);
+	cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+	log_aio.info() << "using io_uring: sq_entries=" << params.sq_entries
+		       << " cq_entries=" << params.cq_entries;
+      } else {
+	log_aio.warning() << "io_uring unavailable (" << strerror(errno)
+			  << ") - falling back to "
+#ifdef REALM_USE_KERNEL_AIO
+			  << "kernel AIO";
+#else
+			  << "POSIX AIO";
+#endif
+      }
 #endif
     }
 
@@ -1137,6 +1932,73 @@ namespace Realm {
 #endif
 	io_destroy(aio_ctx);
       assert(ret == 0);
+#endif
+#ifdef REALM_USE_IO_URING
+      if(ring_fd >= 0) {
+	munmap(sqes, sqes_bytes);
+	munmap(cq_ring_base, cq_ring_bytes);
+	munmap(sq_ring_base, sq_ring_bytes);
+	close(ring_fd);  // also drops any registered buffers
+      }
+#endif
+    }
+
+#ifdef REALM_USE_IO_URING
+    struct io_uring_sqe *AsyncFileIOContext::next_sqe(void)
+    {
+      // launched operations are limited to max_depth, and each has at most
+      //  one entry in the submission queue, so this can't overflow
+      assert((sq_local_tail - *sq_head) < sq_entries);
+      unsigned idx = sq_local_tail & sq_mask;
+      sq_array[idx] = idx;
+      sq_local_tail++;
+      return &sqes[idx];
+    }
+
+    int AsyncFileIOContext::find_registered_buffer(const void *buffer,
+						   size_t bytes)
+    {
+      const char *start = (const char *)buffer;
+      for(size_t i = 0; i < registered_buffers.size(); i++) {
+	const char *base = (const char *)(registered_buffers[i].iov_base);
+	if((start >= base) &&
+	   ((start + bytes) <= (base + registered_buffers[i].iov_len)))
+	  return i;
+      }
+      return -1;
+    }
+#endif
+
+    void AsyncFileIOContext::register_buffer(void *base, size_t bytes)
+    {
+#ifdef REALM_USE_IO_URING
+      if(ring_fd < 0) return;
+      assert(launched_operations.empty() && pending_operations.empty());
+
+      // the kernel limits each registered buffer to 1GB
+      const size_t MAX_REG_BYTES = 1 << 30;
+      std::vector<struct iovec> new_buffers(registered_buffers);
+      for(size_t ofs = 0; ofs < bytes; ofs += MAX_REG_BYTES) {
+	struct iovec iov;
+	iov.iov_base = (char *)base + ofs;
+	iov.iov_len = std::min(bytes - ofs, MAX_REG_BYTES);
+	new_buffers.push_back(iov);
+      }
+
+      // there's no portable way to add to an existing registration, so
+      //  replace the whole set
+      if(!registered_buffers.empty())
+	io_uring_register(ring_fd, IORING_UNREGISTER_BUFFERS, 0, 0);
+      int ret = io_uring_register(ring_fd, IORING_REGISTER_BUFFERS,
+				  &new_buffers[0], new_buffers.size());
+      if(ret == 0) {
+	registered_buffers.swap(new_buffers);
+	log_aio.info() << "registered buffer: base=" << base << " bytes=" << bytes;
+      } else {
+	log_aio.warning() << "io_uring buffer registration failed ("
+			  << strerror(errno) << ") - I/O will use unregistered buffers";
+	registered_buffers.clear();
+      }
 #endif
     }
 
@@ -1144,56 +2006,75 @@ namespace Realm {
 					   size_t bytes, const void *buffer,
                                            Request* req)
     {
+      AIOOperation *op;
+#ifdef REALM_USE_IO_URING
+      if(ring_fd >= 0)
+	op = new IOUringOperation(this, true /*write*/,
+				  fd, offset, bytes, (void *)buffer, req);
+      else
+#endif
 #ifdef REALM_USE_KERNEL_AIO
-      KernelAIOWrite *op = new KernelAIOWrite(aio_ctx,
-					      fd, offset, bytes, buffer, req);
+      op = new KernelAIOWrite(aio_ctx, fd, offset, bytes, buffer, req);
 #else
-      PosixAIOWrite *op = new PosixAIOWrite(fd, offset, bytes, buffer, req);
+      op = new PosixAIOWrite(fd, offset, bytes, buffer, req);
 #endif
-      {
-	AutoHSLLock al(mutex);
-	if(launched_operations.size() < (size_t)max_depth) {
-	  op->launch();
-	  launched_operations.push_back(op);
-	} else {
-	  pending_operations.push_back(op);
-	}
-      }
+      enqueue_operation(op);
     }
 
     void AsyncFileIOContext::enqueue_read(int fd, size_t offset, 
 					  size_t bytes, void *buffer,
                                           Request* req)
     {
+      AIOOperation *op;
+#ifdef REALM_USE_IO_URING
+      if(ring_fd >= 0)
+	op = new IOUringOperation(this, false /*!write*/,
+				  fd, offset, bytes, buffer, req);
+      else
+#endif
 #ifdef REALM_USE_KERNEL_AIO
-      KernelAIORead *op = new KernelAIORead(aio_ctx,
-					    fd, offset, bytes, buffer, req);
+      op = new KernelAIORead(aio_ctx, fd, offset, bytes, buffer, req);
 #else
-      PosixAIORead *op = new PosixAIORead(fd, offset, bytes, buffer, req);
+      op = new PosixAIORead(fd, offset, bytes, buffer, req);
 #endif
-      {
-	AutoHSLLock al(mutex);
-	if(launched_operations.size() < (size_t)max_depth) {
-	  op->launch();
-	  launched_operations.push_back(op);
-	} else {
-	  pending_operations.push_back(op);
-	}
+      enqueue_operation(op);
+    }
+
+    void AsyncFileIOContext::enqueue_staging_read(int fd, size_t offset,
+						  size_t bytes, void *buffer,
+						  volatile bool *done)
+    {
+      AIOOperation *op;
+#ifdef REALM_USE_IO_URING
+      if(ring_fd >= 0)
+	op = new IOUringOperation(this, false /*!write*/,
+				  fd, offset, bytes, buffer);
+      else
+#endif
+#ifdef REALM_USE_KERNEL_AIO
+      op = new KernelAIORead(aio_ctx, fd, offset, bytes, buffer);
+#else
+      op = new PosixAIORead(fd, offset, bytes, buffer);
+#endif
+      op->done_flag = done;
+      enqueue_operation(op);
+    }
+
+    void AsyncFileIOContext::enqueue_operation(AIOOperation *op)
+    {
+      AutoHSLLock al(mutex);
+      if(launched_operations.size() < (size_t)max_depth) {
+	op->launch();
+	launched_operations.push_back(op);
+      } else {
+	pending_operations.push_back(op);
       }
     }
 
     void AsyncFileIOContext::enqueue_fence(DmaRequest *req)
     {
       AIOFenceOp *op = new AIOFenceOp(req);
-      {
-	AutoHSLLock al(mutex);
-	if(launched_operations.size() < (size_t)max_depth) {
-	  op->launch();
-	  launched_operations.push_back(op);
-	} else {
-	  pending_operations.push_back(op);
-	}
-      }
+      enqueue_operation(op);
     }
 
     bool AsyncFileIOContext::empty(void)
@@ -1213,6 +2094,39 @@ namespace Realm {
       AutoHSLLock al(mutex);
 
       // first, reap as many events as we can - oldest first
+#ifdef REALM_USE_IO_URING
+      if(ring_fd >= 0) {
+	// hand everything queued since the last call to the kernel in a
+	//  single system call
+	unsigned to_submit = sq_local_tail - *sq_head;
+	if(to_submit > 0) {
+	  __sync_synchronize();  // entries must be visible before the tail
+	  *sq_tail = sq_local_tail;
+	  int ret = io_uring_enter(ring_fd, to_submit, 0, 0);
+	  if(ret < 0) {
+	    // EAGAIN/EBUSY mean the kernel is out of resources for now - the
+	    //  entries stay queued and are retried on the next call
+	    if((errno != EAGAIN) && (errno != EBUSY) && (errno != EINTR)) {
+	      log_aio.fatal() << "io_uring_enter failed: " << strerror(errno);
+	      assert(0);
+	    }
+	  } else
+	    log_aio.debug("io_uring_enter submitted %d of %u", ret, to_submit);
+	}
+
+	unsigned head = *cq_head;
+	unsigned tail = *cq_tail;
+	__sync_synchronize();  // no reading of entries before the tail
+	while(head != tail) {
+	  struct io_uring_cqe *cqe = &cqes[head & cq_mask];
+	  IOUringOperation *op = (IOUringOperation *)(cqe->user_data);
+	  op->handle_result(cqe->res);
+	  head++;
+	}
+	__sync_synchronize();  // done with the entries before releasing them
+	*cq_head = head;
+      }
+#endif
 #ifdef REALM_USE_KERNEL_AIO
       while(true) {
 	struct io_event events[8];
@@ -1242,6 +2156,10 @@ namespace Realm {
           request->xd->notify_request_write_done(request);
         }
         // </NEW_DMA>
+	if(op->done_flag) {
+	  __sync_synchronize();  // data must be visible before the flag
+	  *(op->done_flag) = true;
+	}
 	delete op;
 	launched_operations.pop_front();
       }
@@ -1282,14 +2200,16 @@ namespace Realm {
 	MemoryImpl::MemoryKind src_kind = src_impl->kind;
 	
 	if((src_kind != MemoryImpl::MKIND_SYSMEM) &&
-	   (src_kind != MemoryImpl::MKIND_ZEROCOPY))
+	   (src_kind != MemoryImpl::MKIND_ZEROCOPY) &&
+	   (src_kind != MemoryImpl::MKIND_MANAGED))
 	  return false;
 
 	MemoryImpl *dst_impl = get_runtime()->get_memory_impl(dst_mem);
 	MemoryImpl::MemoryKind dst_kind = dst_impl->kind;
 	
 	if((dst_kind != MemoryImpl::MKIND_SYSMEM) &&
-	   (dst_kind != MemoryImpl::MKIND_ZEROCOPY))
+	   (dst_kind != MemoryImpl::MKIND_ZEROCOPY) &&
+	   (dst_kind != MemoryImpl::MKIND_MANAGED))
 	  return false;
 
 	return true;
@@ -1309,7 +2229,7 @@ namespace Realm {
     {
       return (kind == Memory::REGDMA_MEM || kind == Memory::LEVEL3_CACHE || kind == Memory::LEVEL2_CACHE
               || kind == Memory::LEVEL1_CACHE || kind == Memory::SYSTEM_MEM || kind == Memory::SOCKET_MEM
-              || kind == Memory::Z_COPY_MEM);
+              || kind == Memory::Z_COPY_MEM || kind == Memory::GPU_MANAGED_MEM);
     }
 
     XferDes::XferKind old_get_xfer_des(Memory src_mem, Memory dst_mem,
@@ -1336,6 +2256,7 @@ namespace Realm {
         case Memory::SYSTEM_MEM:
         case Memory::SOCKET_MEM:
         case Memory::Z_COPY_MEM:
+        case Memory::GPU_MANAGED_MEM:
           if (is_cpu_mem(dst_ll_kind)) {
 	    // can't serdez to yourself yet
 	    if((src_serdez_id != 0) && (dst_serdez_id != 0))
@@ -1445,18 +2366,51 @@ namespace Realm {
 	    return XferDes::XFER_NONE;
           return XferDes::XFER_REMOTE_WRITE;
 	}
+#if defined(USE_CUDA) && defined(USE_GASNET)
+        else if ((src_ll_kind == Memory::GPU_FB_MEM) &&
+                 (dst_ll_kind == Memory::REGDMA_MEM)) {
+	  // no serdez support, and only with GPUDirect RDMA
+	  if((src_serdez_id != 0) || (dst_serdez_id != 0))
+	    return XferDes::XFER_NONE;
+	  Cuda::GPUFBMemory *fbm = static_cast<Cuda::GPUFBMemory *>(get_runtime()->get_memory_impl(src_mem));
+	  assert(fbm != 0);
+	  if(fbm->gpu->module->cfg_gpudirect)
+	    return XferDes::XFER_REMOTE_WRITE;
+	  else
+	    return XferDes::XFER_NONE;
+	}
+#endif
         else
           return XferDes::XFER_NONE;
       }
       return XferDes::XFER_NONE;
     }
 
-    XferDes::XferKind get_xfer_des(Memory src_mem, Memory dst_mem,
-				   CustomSerdezID src_serdez_id,
-				   CustomSerdezID dst_serdez_id,
-				   ReductionOpID redop_id)
+    // copies are planned for this many bytes when comparing paths - large
+    //  enough that bandwidth matters, small enough that latency still does
+    static const size_t PATH_COST_REF_BYTES = 1 << 20;
+    // staging through an intermediate buffer has costs (allocation, an extra
+    //  request round trip) beyond the channels' own estimates
+    static const unsigned long long PATH_HOP_OVERHEAD_NS = 10000;
+
+    static unsigned long long estimate_path_cost(unsigned bw, unsigned latency,
+						 size_t bytes)
+    {
+      // bw is in MB/s (== B/us), unknown bandwidths are assumed to be slow
+      if(bw == 0)
+	bw = 100;
+      return latency + ((unsigned long long)bytes * 1000) / bw;
+    }
+
+    // picks the cheapest channel on the source node for the given path
+    static XferDes::XferKind find_best_channel(Memory src_mem, Memory dst_mem,
+					       CustomSerdezID src_serdez_id,
+					       CustomSerdezID dst_serdez_id,
+					       ReductionOpID redop_id,
+					       unsigned long long *cost_ret)
     {
       XferDes::XferKind kind = XferDes::XFER_NONE;
+      unsigned long long best_cost = 0;
 
       // look at the dma channels available on the source node
       NodeID src_node = ID(src_mem).memory.owner_node;
@@ -1470,11 +2424,30 @@ namespace Realm {
 				src_serdez_id, dst_serdez_id,
 				redop_id,
 				&bw, &latency)) {
-	  kind = (*it)->kind;
-	  break;
+	  unsigned long long cost = estimate_path_cost(bw, latency,
+						       PATH_COST_REF_BYTES);
+	  // ties go to the first channel, as before
+	  if((kind == XferDes::XFER_NONE) || (cost < best_cost)) {
+	    kind = (*it)->kind;
+	    best_cost = cost;
+	  }
 	}
       }
 
+      if(cost_ret) *cost_ret = best_cost;
+      return kind;
+    }
+
+    XferDes::XferKind get_xfer_des(Memory src_mem, Memory dst_mem,
+				   CustomSerdezID src_serdez_id,
+				   CustomSerdezID dst_serdez_id,
+				   ReductionOpID redop_id)
+    {
+      XferDes::XferKind kind = find_best_channel(src_mem, dst_mem,
+						 src_serdez_id, dst_serdez_id,
+						 redop_id, 0);
+      NodeID src_node = ID(src_mem).memory.owner_node;
+
       // check against old version
       // exceptions:
       //  1) old code didn't allow nodes other than 0 to
@@ -1492,20 +2465,24 @@ namespace Realm {
       return kind;
     }
 
-    void find_shortest_path(Memory src_mem, Memory dst_mem,
-			    CustomSerdezID serdez_id, std::vector<Memory>& path)
+    // finds the cheapest path (by the channels' bandwidth/latency estimates
+    //  plus a per-hop staging overhead) from src to dst, going through
+    //  intermediate buffer memories on either node as needed
+    static void compute_shortest_path(Memory src_mem, Memory dst_mem,
+				      CustomSerdezID serdez_id,
+				      std::vector<Memory>& path)
     {
-      // fast case - can we go straight from src to dst?
-      if(get_xfer_des(src_mem, dst_mem,
-		      serdez_id, serdez_id, 0) != XferDes::XFER_NONE) {
+      // a copy within a memory never benefits from staging
+      if((src_mem == dst_mem) &&
+	 (get_xfer_des(src_mem, dst_mem,
+		       serdez_id, serdez_id, 0) != XferDes::XFER_NONE)) {
 	path.resize(2);
 	path[0] = src_mem;
 	path[1] = dst_mem;
 	return;
       }
-      std::map<Memory, std::vector<Memory> > dist;
+
       std::set<Memory> all_mem;
-      std::queue<Memory> active_nodes;
       Node* node = &(get_runtime()->nodes[ID(src_mem).memory.owner_node]);
       for (std::vector<MemoryImpl*>::const_iterator it = node->ib_memories.begin();
            it != node->ib_memories.end(); it++) {
@@ -1518,42 +2495,89 @@ namespace Realm {
 	  all_mem.insert((*it)->me);
 	}
       }
-      for (std::set<Memory>::iterator it = all_mem.begin(); it != all_mem.end(); it++) {
-	// we know we're doing at least one hop, so no dst_serdez here
-        if (get_xfer_des(src_mem, *it,
-			 serdez_id, 0, 0) != XferDes::XFER_NONE) {
-          dist[*it] = std::vector<Memory>();
-          dist[*it].push_back(src_mem);
-          dist[*it].push_back(*it);
-          active_nodes.push(*it);
-        }
+      all_mem.erase(src_mem);
+      all_mem.erase(dst_mem);
+
+      // Dijkstra over (src, intermediate buffers..., dst) - serialization
+      //  happens on the first hop and deserialization on the last
+      std::map<Memory, unsigned long long> dist;
+      std::map<Memory, Memory> prev;
+      std::set<std::pair<unsigned long long, Memory> > frontier;
+      dist[src_mem] = 0;
+      frontier.insert(std::make_pair(0ULL, src_mem));
+      while(!frontier.empty()) {
+	std::pair<unsigned long long, Memory> cur = *frontier.begin();
+	frontier.erase(frontier.begin());
+	if(cur.second == dst_mem)
+	  break;
+	bool at_src = (cur.second == src_mem);
+
+	// the destination is always a candidate, then any buffer we haven't
+	//  finished with yet
+	std::vector<Memory> next;
+	next.push_back(dst_mem);
+	next.insert(next.end(), all_mem.begin(), all_mem.end());
+	for(std::vector<Memory>::const_iterator it = next.begin();
+	    it != next.end();
+	    ++it) {
+	  bool to_dst = (*it == dst_mem);
+	  unsigned long long hop_cost;
+	  if(find_best_channel(cur.second, *it,
+			       (at_src ? serdez_id : 0),
+			       (to_dst ? serdez_id : 0),
+			       0, &hop_cost) == XferDes::XFER_NONE)
+	    continue;
+	  unsigned long long d = cur.first + hop_cost;
+	  if(!to_dst)
+	    d += PATH_HOP_OVERHEAD_NS;
+	  std::map<Memory, unsigned long long>::iterator it2 = dist.find(*it);
+	  if((it2 != dist.end()) && (it2->second <= d))
+	    continue;
+	  if(it2 != dist.end())
+	    frontier.erase(std::make_pair(it2->second, *it));
+	  dist[*it] = d;
+	  prev[*it] = cur.second;
+	  frontier.insert(std::make_pair(d, *it));
+	}
       }
-      while (!active_nodes.empty()) {
-        Memory cur = active_nodes.front();
-        active_nodes.pop();
-        std::vector<Memory> sub_path = dist[cur];
 
-	// can we reach the destination from here (handling potential
-	//  deserialization?
-	if (get_xfer_des(cur, dst_mem, 0, serdez_id, 0) != XferDes::XFER_NONE) {
-	  path = sub_path;
-	  path.push_back(dst_mem);
-	  return;
-	}
+      if(dist.count(dst_mem) == 0) {
+	log_new_dma.fatal() << "FATAL: no path found from " << src_mem << " to " << dst_mem << " (serdez=" << serdez_id << ")";
+	assert(0);
+      }
 
-	// no, look for another intermediate hop
-        for(std::set<Memory>::iterator it = all_mem.begin(); it != all_mem.end(); it ++) {
-	  if (get_xfer_des(cur, *it, 0, 0, 0) != XferDes::XFER_NONE) {
-	    if (dist.find(*it) == dist.end()) {
-	      dist[*it] = sub_path;
-	      dist[*it].push_back(*it);
-	      active_nodes.push(*it);
-	    }
-	  }
+      path.clear();
+      for(Memory m = dst_mem; m != src_mem; m = prev[m])
+	path.push_back(m);
+      path.push_back(src_mem);
+      std::reverse(path.begin(), path.end());
+      log_new_dma.debug() << "path from " << src_mem << " to " << dst_mem
+			  << ": " << path.size() << " memories, cost=" << dist[dst_mem];
+    }
+
+    // the set of memories and channels doesn't change once the dma system
+    //  is running, so paths only need to be computed once
+    typedef std::pair<std::pair<Memory, Memory>, CustomSerdezID> PathKey;
+    static GASNetHSL path_cache_mutex;
+    static std::map<PathKey, std::vector<Memory> > path_cache;
+
+    void find_shortest_path(Memory src_mem, Memory dst_mem,
+			    CustomSerdezID serdez_id, std::vector<Memory>& path)
+    {
+      PathKey key(std::make_pair(src_mem, dst_mem), serdez_id);
+      {
+	AutoHSLLock al(path_cache_mutex);
+	std::map<PathKey, std::vector<Memory> >::const_iterator it = path_cache.find(key);
+	if(it != path_cache.end()) {
+	  path = it->second;
+	  return;
 	}
       }
-      log_new_dma.fatal() << "FATAL: no path found from " << src_mem << " to " << dst_mem << " (serdez=" << serdez_id << ")";
-      assert(0);
+
+      compute_shortest_path(src_mem, dst_mem, serdez_id, path);
+
+      AutoHSLLock al(path_cache_mutex);
+      path_cache[key] = path;
     }
 
 
@@ -1837,6 +2861,18 @@ namespace Realm {
       }
     }
 
+    void CopyRequest::get_memories(std::vector<Memory>& mems) const
+    {
+      for(OASByInst::const_iterator it = oas_by_inst->begin();
+	  it != oas_by_inst->end();
+	  ++it) {
+	mems.push_back(it->first.first.get_location());
+	mems.push_back(it->first.second.get_location());
+      }
+      // intermediate buffers count too
+      mems.insert(mems.end(), mem_path.begin(), mem_path.end());
+    }
+
     void CopyRequest::perform_dma(void)
     {
       log_dma.debug("request %p executing", this);
@@ -2102,6 +3138,15 @@ namespace Realm {
       return false;
     }
 
+    void ReduceRequest::get_memories(std::vector<Memory>& mems) const
+    {
+      for(std::vector<CopySrcDstField>::const_iterator it = srcs.begin();
+	  it != srcs.end();
+	  ++it)
+	mems.push_back(it->inst.get_location());
+      mems.push_back(dst.inst.get_location());
+    }
+
     void ReduceRequest::perform_dma(void)
     {
       log_dma.debug("request %p executing", this);
@@ -2137,6 +3182,19 @@ namespace Realm {
 
       size_t total_bytes = 0;
 
+#ifdef USE_CUDA
+      // reductions into a framebuffer from the same or a peer framebuffer
+      //  stay on the device if the reduction op has CUDA kernels
+      Cuda::GPU *dst_gpu = 0;
+      size_t gpu_reductions = 0;
+      if((dst_mem->kind == MemoryImpl::MKIND_GPUFB) &&
+	 (src_mem->kind == MemoryImpl::MKIND_GPUFB)) {
+	Cuda::GPU *gpu = static_cast<Cuda::GPUFBMemory *>(dst_mem)->gpu;
+	if(gpu->can_reduce_in_fb(src_mem->me, redop, red_fold))
+	  dst_gpu = gpu;
+      }
+#endif
+
       void *src_scratch_buffer = 0;
       void *dst_scratch_buffer = 0;
       size_t src_scratch_size = 0;
@@ -2166,6 +3224,17 @@ namespace Realm {
 
 	total_bytes += dst_bytes;
 
+#ifdef USE_CUDA
+	if(dst_gpu) {
+	  CUdeviceptr src_ptr = (static_cast<Cuda::GPUFBMemory *>(src_mem)->base +
+				 src_info.base_offset);
+	  dst_gpu->reduce_in_fb(dst_info.base_offset, src_ptr, num_elems,
+				redop, red_fold);
+	  gpu_reductions++;
+	  continue;
+	}
+#endif
+
 	// can we directly access the source data?
 	const void *src_ptr = src_mem->get_direct_ptr(src_info.base_offset,
 						      src_info.bytes_per_chunk);
@@ -2240,6 +3309,12 @@ namespace Realm {
       if(dst_scratch_size > 0)
 	free(dst_scratch_buffer);
 
+#ifdef USE_CUDA
+      // the request isn't done until the device reductions are
+      if(gpu_reductions > 0)
+	dst_gpu->fence_within_fb(this);
+#endif
+
       // if we did any actual reductions, send a fence, otherwise trigger here
       if(rdma_count > 0) {
 	RemoteWriteFence *fence = new RemoteWriteFence(this);
@@ -2459,6 +3534,11 @@ namespace Realm {
       return false;
     }
 
+    void FillRequest::get_memories(std::vector<Memory>& mems) const
+    {
+      mems.push_back(dst.inst.get_location());
+    }
+
     void FillRequest::perform_dma(void)
     {
       // if we are doing large chunks of data, we will build a buffer with
@@ -2484,6 +3564,23 @@ namespace Realm {
 	size_t act_bytes = iter->step(max_bytes, info, flags);
 	assert(act_bytes >= 0);
 
+	// first see if the memory can fill the lines itself (e.g. memset or
+	//  wide stores for CPU memories, cuMemset for GPU framebuffers)
+	{
+	  bool filled = true;
+	  for(size_t p = 0; filled && (p < info.num_planes); p++)
+	    for(size_t l = 0; filled && (l < info.num_lines); l++)
+	      filled = mem_impl->fill_bytes(info.base_offset +
+					    (p * info.plane_stride) +
+					    (l * info.line_stride),
+					    info.bytes_per_chunk,
+					    fill_buffer, fill_size);
+	  // a memory either supports fills or it doesn't, so a refusal can
+	  //  only come on the very first line
+	  if(filled)
+	    continue;
+	}
+
 	// decide whether to use the original fill buffer or one that
 	//  repeats the data several times
 	const void *use_buffer = fill_buffer;
@@ -2563,10 +3660,9 @@ namespace Realm {
       return fill_size;
     }
 
-    // for now we use a single queue for all (local) dmas
     DmaRequestQueue *dma_queue = 0;
     
-    void DmaRequestQueue::worker_thread_loop(void)
+    void DmaRequestQueue::ChannelQueue::worker_thread_loop(void)
     {
       log_dma.info("dma worker thread created");
 
@@ -2592,24 +3688,31 @@ namespace Realm {
       log_dma.info("dma worker thread terminating");
     }
 
-    void DmaRequestQueue::start_workers(int count)
+    void DmaRequestQueue::ChannelQueue::start_workers(int count)
     {
       ThreadLaunchParameters tlp;
 
       for(int i = 0; i < count; i++) {
-	Thread *t = Thread::create_kernel_thread<DmaRequestQueue,
-						 &DmaRequestQueue::worker_thread_loop>(this,
-										       tlp,
-										       core_rsrv,
-										       0 /* default scheduler*/);
+	Thread *t = Thread::create_kernel_thread<ChannelQueue,
+						 &ChannelQueue::worker_thread_loop>(this,
+										    tlp,
+										    core_rsrv,
+										    0 /* default scheduler*/);
 	worker_threads.push_back(t);
       }
     }
     
-    void start_dma_worker_threads(int count, CoreReservationSet& crs)
+    void start_dma_worker_threads(int count, int channel_count,
+				  CoreReservationSet& crs)
     {
-      dma_queue = new DmaRequestQueue(crs);
-      dma_queue->start_workers(count);
+      // per-channel queues are only used if workers were asked for
+      if(channel_count > 0) {
+	dma_queue = new DmaRequestQueue(crs, true /*split*/);
+	dma_queue->start_workers(channel_count);
+      } else {
+	dma_queue = new DmaRequestQueue(crs, false /*!split*/);
+	dma_queue->start_workers(count);
+      }
     }
 
     void stop_dma_worker_threads(void)
@@ -2624,8 +3727,27 @@ namespace Realm {
     {
       //log_dma.add_stream(&std::cerr, Logger::LEVEL_DEBUG, false, false);
       aio_context = new AsyncFileIOContext(256);
+#ifdef REALM_USE_IO_URING
+      if(Config::aio_register_buffers) {
+	const Node& n = get_runtime()->nodes[my_node_id];
+	for(std::vector<MemoryImpl *>::const_iterator it = n.memories.begin();
+	    it != n.memories.end();
+	    it++) {
+	  if(((*it)->kind != MemoryImpl::MKIND_SYSMEM) &&
+	     ((*it)->kind != MemoryImpl::MKIND_ZEROCOPY))
+	    continue;
+	  void *base = (*it)->get_direct_ptr(0, (*it)->size);
+	  if(base)
+	    aio_context->register_buffer(base, (*it)->size);
+	}
+      }
+#endif
       start_channel_manager(count, pinned, max_nr, crs);
       ib_req_queue = new PendingIBQueue();
+      if(Config::ib_cache_mb > 0)
+	ib_cache = new IBCache((size_t)Config::ib_cache_mb << 20);
+      if(Config::staging_cache_mb > 0)
+	staging_cache = new StagingCache((size_t)Config::staging_cache_mb << 20);
     }
 
     void stop_dma_system(void)
@@ -2633,8 +3755,13 @@ namespace Realm {
       stop_channel_manager();
       delete ib_req_queue;
       ib_req_queue = 0;
+      // the memories are going away anyway - don't bother freeing
+      delete ib_cache;
+      ib_cache = 0;
       delete aio_context;
       aio_context = 0;
+      delete staging_cache;
+      staging_cache = 0;
     }
 
     void handle_remote_copy(RemoteCopyArgs args, const void *data, size_t msglen)
@@ -25,6 +25,13 @@
 #include "realm/runtime_impl.h"
 #include "realm/inst_impl.h"
 
+#include <list>
+
+#ifdef REALM_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#endif
+
 namespace Realm {
   class CoreReservationSet;
 
@@ -84,6 +91,24 @@ namespace Realm {
                                off_t ib_offset, size_t ib_size);
     };
 
+    // sent by the owner of an IB memory when allocations there start (or
+    //  stop) having to wait, so that other nodes stop caching (and free)
+    //  the intermediate buffers they are holding on to
+    struct RemoteIBCacheControlAsync {
+      struct RequestArgs {
+        Memory memory;
+        bool enable;
+      };
+
+      static void handle_request(RequestArgs args);
+
+      typedef ActiveMessageShortNoReply<REMOTE_IB_CACHE_CONTROL_MSGID,
+                                        RequestArgs,
+                                        handle_request> Message;
+
+      static void send_request(NodeID target, Memory tgt_mem, bool enable);
+    };
+
     void find_shortest_path(Memory src_mem, Memory dst_mem,
 			    CustomSerdezID serdez_id, std::vector<Memory>& path);
 
@@ -116,7 +141,11 @@ namespace Realm {
 
     extern void init_dma_handler(void);
 
-    extern void start_dma_worker_threads(int count, Realm::CoreReservationSet& crs);
+    // 'count' workers serve a single request queue, unless 'channel_count' is
+    //  non-zero, in which case each channel gets its own queue and that many
+    //  workers
+    extern void start_dma_worker_threads(int count, int channel_count,
+					 Realm::CoreReservationSet& crs);
     extern void stop_dma_worker_threads(void);
 
     extern void start_dma_system(int count, bool pinned, int max_nr, Realm::CoreReservationSet& crs);
@@ -147,8 +176,20 @@ namespace Realm {
 			  size_t size, off_t& field_start, int& field_size);
     
     class DmaRequestQueue;
-    // for now we use a single queue for all (local) dmas
+    // all (local) dmas go through this queue, which can separate them by the
+    //  kind of channel they need
     extern DmaRequestQueue *dma_queue;
+
+    // with -ll:dma_channel_workers, each channel has its own priority-ordered
+    //  queue and worker threads so that slow (e.g. file) transfers can't
+    //  starve fast ones
+    enum DmaChannel {
+      DMA_CHANNEL_MEMCPY,  // local CPU-accessible memories only
+      DMA_CHANNEL_GASNET,  // global or remote memory involved
+      DMA_CHANNEL_GPU,     // GPU framebuffer involved
+      DMA_CHANNEL_FILE,    // disk, file or HDF memory involved
+      DMA_CHANNEL_COUNT
+    };
     
     typedef unsigned long long XferDesID;
     class DmaRequest : public Realm::Operation {
@@ -165,8 +206,16 @@ namespace Realm {
     public:
       virtual void print(std::ostream& os) const;
 
+      // a request that hasn't reached a channel queue yet will be queued at
+      //  the boosted priority
+      virtual void boost_priority(int new_priority, int depth);
+
       virtual bool check_readiness(bool just_check, DmaRequestQueue *rq) = 0;
 
+      // the memories read or written by this request (once it is ready),
+      //  used to choose its channel
+      virtual void get_memories(std::vector<Memory>& mems) const = 0;
+
       virtual bool handler_safe(void) = 0;
 
       virtual void perform_dma(void) = 0;
@@ -304,6 +353,8 @@ namespace Realm {
 
       virtual bool check_readiness(bool just_check, DmaRequestQueue *rq);
 
+      virtual void get_memories(std::vector<Memory>& mems) const;
+
       void perform_new_dma(Memory src_mem, Memory dst_mem);
 
       virtual void perform_dma(void);
@@ -368,6 +419,8 @@ namespace Realm {
 
       virtual bool check_readiness(bool just_check, DmaRequestQueue *rq);
 
+      virtual void get_memories(std::vector<Memory>& mems) const;
+
       virtual void perform_dma(void);
 
       virtual bool handler_safe(void) { return(false); }
@@ -409,6 +462,8 @@ namespace Realm {
 
       virtual bool check_readiness(bool just_check, DmaRequestQueue *rq);
 
+      virtual void get_memories(std::vector<Memory>& mems) const;
+
       virtual void perform_dma(void);
 
       virtual bool handler_safe(void) { return(false); }
@@ -462,29 +517,124 @@ namespace Realm {
 
       void enqueue_write(int fd, size_t offset, size_t bytes, const void *buffer, Request* req = NULL);
       void enqueue_read(int fd, size_t offset, size_t bytes, void *buffer, Request* req = NULL);
+      // a read with no request behind it - '*done' is set once it completes
+      void enqueue_staging_read(int fd, size_t offset, size_t bytes, void *buffer,
+				volatile bool *done);
       void enqueue_fence(DmaRequest *req);
 
       bool empty(void);
       long available(void);
       void make_progress(void);
 
+      // registers a range of memory that file I/O will often target - only
+      //  used by io_uring, and must be done before any I/O is enqueued
+      void register_buffer(void *base, size_t bytes);
+
       static AsyncFileIOContext* get_singleton(void);
 
       class AIOOperation {
       public:
+	AIOOperation(void) : completed(false), req(0), done_flag(0) {}
 	virtual ~AIOOperation(void) {}
 	virtual void launch(void) = 0;
 	virtual bool check_completion(void) = 0;
 	bool completed;
         void* req;
+	volatile bool *done_flag;
       };
 
+    protected:
+      void enqueue_operation(AIOOperation *op);
+
+    public:
+
       int max_depth;
       std::deque<AIOOperation *> launched_operations, pending_operations;
       GASNetHSL mutex;
 #ifdef REALM_USE_KERNEL_AIO
       aio_context_t aio_ctx;
 #endif
+#ifdef REALM_USE_IO_URING
+      // operations fill in submission queue entries as they are launched,
+      //  but they are only handed to the kernel (in a batch) by make_progress
+      struct io_uring_sqe *next_sqe(void);
+      int find_registered_buffer(const void *buffer, size_t bytes);
+
+      int ring_fd;  // < 0 if io_uring is unavailable
+      void *sq_ring_base, *cq_ring_base;
+      size_t sq_ring_bytes, cq_ring_bytes, sqes_bytes;
+      volatile unsigned *sq_head, *sq_tail, *cq_head, *cq_tail;
+      unsigned sq_mask, cq_mask, sq_entries;
+      unsigned *sq_array;
+      struct io_uring_sqe *sqes;
+      struct io_uring_cqe *cqes;
+      unsigned sq_local_tail;  // includes entries not yet visible to kernel
+      std::vector<struct iovec> registered_buffers;
+#endif
+    };
+
+    // data from file and HDF5 instances that has been read ahead of the
+    //  copies that will want it (see RegionInstance::prefetch) - the reads
+    //  themselves are issued by the file/HDF5 read channels
+    class StagingCache {
+    public:
+      StagingCache(size_t _max_bytes);
+      ~StagingCache(void);
+
+      // a box of elements from a dataset, or for a plain file (empty
+      //  'dsetname'), a 1-D range of bytes - boxes are packed densely with
+      //  the last dimension varying fastest
+      struct Entry {
+	std::string filename, dsetname;
+	std::vector<size_t> lo, extent;
+	size_t elem_size, bytes;
+	void *buffer;
+	int fd;  // used for plain files, closed when the entry is freed
+	bool issued, stale;
+	volatile bool ready;
+	int users;
+	unsigned long long last_use;
+      };
+
+      // queues reads of a box, split into pieces along its first dimension -
+      //  returns the number of bytes that could be queued
+      size_t add(const std::string& filename, const std::string& dsetname,
+		 const std::vector<size_t>& lo, const std::vector<size_t>& extent,
+		 size_t elem_size);
+
+      // returns the oldest queued entry of the given type that hasn't been
+      //  issued, marking it as issued
+      Entry *next_to_issue(bool hdf5);
+
+      // for entries whose reads aren't completed via 'ready' directly
+      void read_done(Entry *e, bool ok);
+
+      // if staged data covers the given box, copies it to 'dst' (packed the
+      //  same way) and returns true
+      bool get(const std::string& filename, const std::string& dsetname,
+	       int ndims, const size_t *lo, const size_t *extent,
+	       size_t elem_size, void *dst);
+
+      // writes to a file make any staged copies of it out of date - staged
+      //  data isn't used for the file until every write to it that has
+      //  started has also finished, and anything staged in the meantime is
+      //  dropped when it does
+      void write_started(const std::string& filename);
+      void write_finished(const std::string& filename);
+
+      static StagingCache *get_singleton(void);
+
+    protected:
+      bool make_room(size_t bytes);
+      void mark_stale(const std::string& filename);
+      void free_entry(Entry *e);
+
+      GASNetHSL mutex;
+      size_t max_bytes, cur_bytes;
+      unsigned long long use_counter;
+      std::list<Entry *> entries;
+      std::map<std::string, int> writes_in_flight;
+      size_t hits, misses;
     };
 };
 
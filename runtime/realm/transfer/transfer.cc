@@ -20,14 +20,21 @@
 #include "realm/transfer/lowlevel_dma.h"
 #include "realm/mem_impl.h"
 #include "realm/inst_layout.h"
+#include "realm/deppart/sparsity_impl.h"
 #ifdef USE_HDF
 #include "realm/hdf5/hdf5_access.h"
 #endif
 
+#include <algorithm>
+
 namespace Realm {
 
   extern Logger log_dma;
 
+  namespace Config {
+    int copy_plan_cache_size = 1024;
+  };
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class TransferIterator
@@ -1010,7 +1017,17 @@ namespace Realm {
     bool serialize(S& serializer) const;
 
   protected:
+    // sets up 'iter' for the given space - if precise data for the space's
+    //  sparsity map is still arriving, iterates over a copy of just the part
+    //  we need instead of waiting for the whole map
+    void init_iter(const IndexSpace<N,T>& is);
+    void restart_iter(void);
+    bool step_iter(void);
+
     IndexSpaceIterator<N,T> iter;
+    bool use_partial_rects;
+    std::vector<Rect<N,T> > partial_rects;
+    size_t partial_idx;
     Point<N,T> cur_point, next_point;
     bool carry;
     RegionInstanceImpl *inst_impl;
@@ -1026,8 +1043,10 @@ namespace Realm {
 								RegionInstance inst,
 								const std::vector<FieldID>& _fields,
 								size_t _extra_elems)
-    : iter(_is), field_idx(0), extra_elems(_extra_elems), tentative_valid(false)
+    : field_idx(0), extra_elems(_extra_elems), tentative_valid(false)
   {
+    init_iter(_is);
+
     // special case - skip a lot of the init if the space is empty
     if(!iter.valid) {
       inst_impl = 0;
@@ -1043,10 +1062,58 @@ namespace Realm {
 
   template <int N, typename T>
   TransferIteratorIndexSpace<N,T>::TransferIteratorIndexSpace(void)
-    : field_idx(0)
+    : use_partial_rects(false)
+    , field_idx(0)
     , tentative_valid(false)
   {}
 
+  template <int N, typename T>
+  void TransferIteratorIndexSpace<N,T>::init_iter(const IndexSpace<N,T>& is)
+  {
+    use_partial_rects = false;
+    if(!is.dense() && !is.is_valid()) {
+      SparsityMapImpl<N,T> *impl = SparsityMapImpl<N,T>::lookup(is.sparsity);
+      Event e = impl->make_valid_subset(is.bounds);
+      if(e.exists())
+	e.wait();
+      if(!is.is_valid()) {
+	impl->get_entries_subset(is.bounds, partial_rects);
+	use_partial_rects = true;
+	iter.space = is;
+	iter.restriction = is.bounds;
+	restart_iter();
+	return;
+      }
+    }
+    iter.reset(is);
+  }
+
+  template <int N, typename T>
+  void TransferIteratorIndexSpace<N,T>::restart_iter(void)
+  {
+    if(use_partial_rects) {
+      partial_idx = 0;
+      iter.valid = !partial_rects.empty();
+      if(iter.valid)
+	iter.rect = partial_rects[0];
+    } else
+      iter.reset(iter.space);
+  }
+
+  template <int N, typename T>
+  bool TransferIteratorIndexSpace<N,T>::step_iter(void)
+  {
+    if(use_partial_rects) {
+      if(++partial_idx < partial_rects.size()) {
+	iter.rect = partial_rects[partial_idx];
+	return true;
+      }
+      iter.valid = false;
+      return false;
+    } else
+      return iter.step();
+  }
+
   template <int N, typename T>
   template <typename S>
   /*static*/ TransferIterator *TransferIteratorIndexSpace<N,T>::deserialize_new(S& deserializer)
@@ -1063,7 +1130,7 @@ namespace Realm {
       return 0;
 
     TransferIteratorIndexSpace<N,T> *tiis = new TransferIteratorIndexSpace<N,T>;
-    tiis->iter.reset(is);
+    tiis->init_iter(is);
 
     if(tiis->iter.valid && inst.exists() && !fields.empty()) {
       tiis->cur_point = tiis->iter.rect.lo;
@@ -1098,7 +1165,7 @@ namespace Realm {
   void TransferIteratorIndexSpace<N,T>::reset(void)
   {
     field_idx = 0;
-    iter.reset(iter.space);
+    restart_iter();
     cur_point = iter.rect.lo;
   }
 
@@ -1205,8 +1272,45 @@ namespace Realm {
       info.line_stride = act_strides[1];
       info.num_planes = act_counts[2];
       info.plane_stride = act_strides[2];
+    } else if(layout_piece->layout_type == InstanceLayoutPiece<N,T>::BlockedLayoutType) {
+      const BlockedLayoutPiece<N,T> *blocked = static_cast<const BlockedLayoutPiece<N,T> *>(layout_piece);
+      assert(blocked->lane_stride == field_size);
+
+      // a field's elements are only contiguous within a block, so hand out
+      //  the rest of the current block or, if lines are ok and we're at the
+      //  start of a block, a run of whole blocks with one line per block
+      size_t len = iter.rect.hi[0] - cur_point[0] + 1;
+      size_t piece_limit = blocked->bounds.hi[0] - cur_point[0] + 1;
+      if(piece_limit < len)
+	len = piece_limit;
+      size_t lanes = blocked->lanes_left_in_block(cur_point);
+      size_t lines = 1;
+      if(((flags & LINES_OK) != 0) && (lanes == blocked->block_elements)) {
+	lines = std::min(len, max_elems) / lanes;
+	if(lines < 1)
+	  lines = 1;
+      }
+      if(lines > 1) {
+	len = lines * lanes;
+      } else {
+	len = std::min(len, std::min(lanes, max_elems));
+      }
+
+      for(int d = 0; d < N; d++)
+	target_subrect.hi[d] = cur_point[d];
+      target_subrect.hi[0] = cur_point[0] + len - 1;
+      total_bytes = len * field_size;
+
+      info.base_offset = (inst_impl->metadata.inst_offset +
+			  blocked->calculate_offset(cur_point) +
+			  field_rel_offset);
+      info.bytes_per_chunk = ((lines > 1) ? lanes : len) * field_size;
+      info.num_lines = lines;
+      info.line_stride = ((lines > 1) ? blocked->strides[0] : 0);
+      info.num_planes = 1;
+      info.plane_stride = 0;
     } else {
-      assert(0 && "no support for non-affine pieces yet");
+      assert(0 && "no support for this piece type yet");
     }
 
     // now set 'next_point' to the next point we want - this is just based on
@@ -1233,11 +1337,11 @@ namespace Realm {
       // if the "carry" propagated all the way through, go on to the next field
       //  (defer if tentative)
       if(carry) {
-	if(iter.step()) {
+	if(step_iter()) {
 	  cur_point = iter.rect.lo;
 	} else {
 	  field_idx++;
-	  iter.reset(iter.space);
+	  restart_iter();
 	  cur_point = iter.rect.lo;
 	}
       } else
@@ -1352,11 +1456,11 @@ namespace Realm {
       // if the "carry" propagated all the way through, go on to the next field
       //  (defer if tentative)
       if(carry) {
-	if(iter.step()) {
+	if(step_iter()) {
 	  cur_point = iter.rect.lo;
 	} else {
 	  field_idx++;
-	  iter.reset(iter.space);
+	  restart_iter();
 	  cur_point = iter.rect.lo;
 	}
       } else
@@ -1372,11 +1476,11 @@ namespace Realm {
   {
     assert(tentative_valid);
     if(carry) {
-      if(iter.step()) {
+      if(step_iter()) {
 	cur_point = iter.rect.lo;
       } else {
 	field_idx++;
-	iter.reset(iter.space);
+	restart_iter();
 	cur_point = iter.rect.lo;
       }
     } else
@@ -1406,6 +1510,321 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class TransferIteratorIndirect<N,T,N2,T2>
+  //
+
+  // walks an N-dimensional index space, but addresses the instance through
+  //  a field (of a separate 'index' instance covering the same space) holding
+  //  Point<N2,T2> values - this provides the gather side of a gather copy and
+  //  the scatter side of a scatter copy
+
+  template <int N, typename T, int N2, typename T2>
+  class TransferIteratorIndirect : public TransferIterator {
+  protected:
+    TransferIteratorIndirect(void); // used by deserializer
+  public:
+    TransferIteratorIndirect(const IndexSpace<N,T> &_is,
+			     RegionInstance _index_inst,
+			     FieldID _index_field,
+			     const Rect<N2,T2>& _target_bounds,
+			     RegionInstance inst,
+			     const std::vector<FieldID>& _fields);
+
+    template <typename S>
+    static TransferIterator *deserialize_new(S& deserializer);
+      
+    virtual ~TransferIteratorIndirect(void);
+
+    virtual Event request_metadata(void);
+
+    virtual void reset(void);
+    virtual bool done(void) const;
+    virtual size_t step(size_t max_bytes, AddressInfo& info,
+			unsigned flags,
+			bool tentative = false);
+    virtual void confirm_step(void);
+    virtual void cancel_step(void);
+
+    static Serialization::PolymorphicSerdezSubclass<TransferIterator, TransferIteratorIndirect<N,T,N2,T2> > serdez_subclass;
+
+    template <typename S>
+    bool serialize(S& serializer) const;
+
+  protected:
+    void advance(void);
+
+    IndexSpaceIterator<N,T> iter;
+    Point<N,T> cur_point, next_point;
+    bool carry;
+    RegionInstance index_inst;
+    FieldID index_field;
+    // the index instance is read directly, so the accessor is built on the
+    //  node that actually performs the step
+    bool index_acc_valid;
+    AffineAccessor<Point<N2,T2>,N,T> index_acc;
+    Rect<N2,T2> target_bounds;
+    RegionInstanceImpl *inst_impl;
+    const InstanceLayout<N2,T2> *inst_layout;
+    std::vector<FieldID> fields;
+    size_t field_idx;
+    bool tentative_valid;
+  };
+
+  template <int N, typename T, int N2, typename T2>
+  TransferIteratorIndirect<N,T,N2,T2>::TransferIteratorIndirect(const IndexSpace<N,T>& _is,
+								RegionInstance _index_inst,
+								FieldID _index_field,
+								const Rect<N2,T2>& _target_bounds,
+								RegionInstance inst,
+								const std::vector<FieldID>& _fields)
+    : index_inst(_index_inst), index_field(_index_field)
+    , index_acc_valid(false), target_bounds(_target_bounds)
+    , field_idx(0), tentative_valid(false)
+  {
+    iter.reset(_is);
+
+    // special case - skip a lot of the init if the space is empty
+    if(!iter.valid) {
+      inst_impl = 0;
+      inst_layout = 0;
+    } else {
+      cur_point = iter.rect.lo;
+
+      inst_impl = get_runtime()->get_instance_impl(inst);
+      inst_layout = dynamic_cast<const InstanceLayout<N2,T2> *>(inst.get_layout());
+      assert(inst_layout != 0);
+      fields = _fields;
+    }
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  TransferIteratorIndirect<N,T,N2,T2>::TransferIteratorIndirect(void)
+    : index_acc_valid(false), field_idx(0), tentative_valid(false)
+  {}
+
+  template <int N, typename T, int N2, typename T2>
+  template <typename S>
+  /*static*/ TransferIterator *TransferIteratorIndirect<N,T,N2,T2>::deserialize_new(S& deserializer)
+  {
+    IndexSpace<N,T> is;
+    RegionInstance index_inst;
+    FieldID index_field;
+    Rect<N2,T2> target_bounds;
+    RegionInstance inst;
+    std::vector<FieldID> fields;
+
+    if(!((deserializer >> is) &&
+	 (deserializer >> index_inst) &&
+	 (deserializer >> index_field) &&
+	 (deserializer >> target_bounds) &&
+	 (deserializer >> inst) &&
+	 (deserializer >> fields)))
+      return 0;
+
+    TransferIteratorIndirect<N,T,N2,T2> *tii = new TransferIteratorIndirect<N,T,N2,T2>;
+    tii->iter.reset(is);
+    tii->index_inst = index_inst;
+    tii->index_field = index_field;
+    tii->target_bounds = target_bounds;
+
+    if(tii->iter.valid && inst.exists() && !fields.empty()) {
+      tii->cur_point = tii->iter.rect.lo;
+      tii->fields.swap(fields);
+
+      tii->inst_impl = get_runtime()->get_instance_impl(inst);
+      tii->inst_layout = dynamic_cast<const InstanceLayout<N2,T2> *>(inst.get_layout());
+      assert(tii->inst_layout != 0);
+    } else {
+      // no iterating to do - clear out some things
+      tii->inst_impl = 0;
+      tii->inst_layout = 0;
+    }
+
+    return tii;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  TransferIteratorIndirect<N,T,N2,T2>::~TransferIteratorIndirect(void)
+  {}
+
+  template <int N, typename T, int N2, typename T2>
+  Event TransferIteratorIndirect<N,T,N2,T2>::request_metadata(void)
+  {
+    std::set<Event> events;
+    if(inst_impl && !inst_impl->metadata.is_valid())
+      events.insert(inst_impl->request_metadata());
+    if(index_inst.exists()) {
+      RegionInstanceImpl *index_impl = get_runtime()->get_instance_impl(index_inst);
+      if(!index_impl->metadata.is_valid())
+	events.insert(index_impl->request_metadata());
+    }
+
+    return Event::merge_events(events);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void TransferIteratorIndirect<N,T,N2,T2>::reset(void)
+  {
+    field_idx = 0;
+    iter.reset(iter.space);
+    cur_point = iter.rect.lo;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  bool TransferIteratorIndirect<N,T,N2,T2>::done(void) const
+  {
+    return(field_idx == fields.size());
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  size_t TransferIteratorIndirect<N,T,N2,T2>::step(size_t max_bytes, AddressInfo& info,
+						   unsigned flags,
+						   bool tentative /*= false*/)
+  {
+    assert(!done());
+    assert(!tentative_valid);
+
+    // shouldn't be here if the iterator isn't valid
+    assert(iter.valid);
+
+    if(!index_acc_valid) {
+      if(!AffineAccessor<Point<N2,T2>,N,T>::is_compatible(index_inst, index_field) ||
+	 (index_inst.pointer_untyped(0, 0) == 0)) {
+	log_dma.fatal() << "index instance for indirect copy must be affine and directly accessible: inst="
+			<< index_inst << " field=" << index_field;
+	assert(0);
+      }
+      index_acc = AffineAccessor<Point<N2,T2>,N,T>(index_inst, index_field);
+      index_acc_valid = true;
+    }
+
+    const InstancePieceList<N2,T2> *piece_list;
+    int field_rel_offset;
+    size_t field_size;
+    {
+      std::map<FieldID, InstanceLayoutGeneric::FieldLayout>::const_iterator it = inst_layout->fields.find(fields[field_idx]);
+      assert(it != inst_layout->fields.end());
+      piece_list = &inst_layout->piece_lists[it->second.list_idx];
+      field_rel_offset = it->second.rel_offset;
+      field_size = it->second.size_in_bytes;
+    }
+
+    size_t max_elems = max_bytes / field_size;
+    // less than one element?  give up immediately
+    if(max_elems == 0)
+      return 0;
+
+    // look up where the current point's target lives
+    Point<N2,T2> target = index_acc[cur_point];
+    // a bad index is an application error, and must not turn into an
+    //  out-of-bounds access even when asserts are compiled out
+    if(!target_bounds.contains(target)) {
+      log_dma.fatal() << "indirect copy index out of bounds: inst=" << index_inst
+		      << " field=" << index_field << " point=" << cur_point
+		      << " index=" << target << " bounds=" << target_bounds;
+      abort();
+    }
+    const InstanceLayoutPiece<N2,T2> *layout_piece = piece_list->find_piece(target);
+    assert(layout_piece != 0);
+    size_t offset = layout_piece->calculate_offset(target) + field_rel_offset;
+
+    // neighboring points along the innermost dimension whose targets are
+    //  also neighbors in the instance can be moved as a single chunk
+    size_t elems = 1;
+    {
+      Point<N,T> p = cur_point;
+      while((elems < max_elems) && (p[0] < iter.rect.hi[0])) {
+	p[0] += 1;
+	Point<N2,T2> t = index_acc[p];
+	if(!layout_piece->bounds.contains(t))
+	  break;
+	if(layout_piece->calculate_offset(t) + field_rel_offset !=
+	   offset + (elems * field_size))
+	  break;
+	elems++;
+      }
+    }
+
+    info.base_offset = inst_impl->metadata.inst_offset + offset;
+    info.bytes_per_chunk = elems * field_size;
+    info.num_lines = 1;
+    info.line_stride = 0;
+    info.num_planes = 1;
+    info.plane_stride = 0;
+
+    // now set 'next_point' the same way the direct iterators do, so that
+    //  both sides of the copy agree on the order of the points
+    carry = true;
+    for(int d = 0; d < N; d++) {
+      T hi = ((d == 0) ? (cur_point[0] + (T)(elems - 1)) : cur_point[d]);
+      if(carry) {
+	if(hi == iter.rect.hi[d]) {
+	  next_point[d] = iter.rect.lo[d];
+	} else {
+	  next_point[d] = hi + 1;
+	  carry = false;
+	}
+      } else
+	next_point[d] = cur_point[d];
+    }
+
+    if(tentative)
+      tentative_valid = true;
+    else
+      advance();
+
+    return elems * field_size;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void TransferIteratorIndirect<N,T,N2,T2>::advance(void)
+  {
+    // if the "carry" propagated all the way through, go on to the next
+    //  rectangle or field
+    if(carry) {
+      if(!iter.step()) {
+	field_idx++;
+	iter.reset(iter.space);
+      }
+      cur_point = iter.rect.lo;
+    } else
+      cur_point = next_point;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void TransferIteratorIndirect<N,T,N2,T2>::confirm_step(void)
+  {
+    assert(tentative_valid);
+    advance();
+    tentative_valid = false;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  void TransferIteratorIndirect<N,T,N2,T2>::cancel_step(void)
+  {
+    assert(tentative_valid);
+    tentative_valid = false;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  /*static*/ Serialization::PolymorphicSerdezSubclass<TransferIterator, TransferIteratorIndirect<N,T,N2,T2> > TransferIteratorIndirect<N,T,N2,T2>::serdez_subclass;
+
+  template <int N, typename T, int N2, typename T2>
+  template <typename S>
+  bool TransferIteratorIndirect<N,T,N2,T2>::serialize(S& serializer) const
+  {
+    return ((serializer << iter.space) &&
+	    (serializer << index_inst) &&
+	    (serializer << index_field) &&
+	    (serializer << target_bounds) &&
+	    (serializer << (inst_impl ? inst_impl->me :
+                                        RegionInstance::NO_INST)) &&
+	    (serializer << fields));
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class TransferDomain
@@ -1696,8 +2115,12 @@ namespace Realm {
   template <int N, typename T>
   Event TransferDomainIndexSpace<N,T>::request_metadata(void)
   {
-    if(!is.is_valid())
+    if(!is.is_valid()) {
+      // only the part of the sparsity map within our bounds is needed
+      if(!is.dense())
+	return SparsityMapImpl<N,T>::lookup(is.sparsity)->make_valid_subset(is.bounds);
       return is.make_valid();
+    }
 
     return Event::NO_EVENT;
   }
@@ -1705,6 +2128,18 @@ namespace Realm {
   template <int N, typename T>
   size_t TransferDomainIndexSpace<N,T>::volume(void) const
   {
+    if(!is.dense() && !is.is_valid()) {
+      // the rest of the sparsity map may still be arriving - count just the
+      //  part we cover
+      std::vector<Rect<N,T> > rects;
+      SparsityMapImpl<N,T>::lookup(is.sparsity)->get_entries_subset(is.bounds, rects);
+      size_t total = 0;
+      for(typename std::vector<Rect<N,T> >::const_iterator it = rects.begin();
+	  it != rects.end();
+	  it++)
+	total += it->volume();
+      return total;
+    }
     return is.volume();
   }
 
@@ -1748,6 +2183,141 @@ namespace Realm {
   }
 
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class TransferDomainIndirect<N,T,N2,T2>
+  //
+
+  // a domain for gather/scatter copies - instances listed in 'indirect_insts'
+  //  are addressed through the index field, all others directly
+  template <int N, typename T, int N2, typename T2>
+  class TransferDomainIndirect : public TransferDomain {
+  public:
+    TransferDomainIndirect(IndexSpace<N,T> _is,
+			   RegionInstance _index_inst, FieldID _index_field,
+			   const Rect<N2,T2>& _target_bounds,
+			   const std::vector<RegionInstance>& _indirect_insts);
+
+    template <typename S>
+    static TransferDomain *deserialize_new(S& deserializer);
+
+    virtual TransferDomain *clone(void) const;
+
+    virtual Event request_metadata(void);
+
+    virtual size_t volume(void) const;
+
+    virtual TransferIterator *create_iterator(RegionInstance inst,
+					      RegionInstance peer,
+					      const std::vector<FieldID>& fields) const;
+
+    virtual void print(std::ostream& os) const;
+
+    static Serialization::PolymorphicSerdezSubclass<TransferDomain, TransferDomainIndirect<N,T,N2,T2> > serdez_subclass;
+
+    template <typename S>
+    bool serialize(S& serializer) const;
+
+    //protected:
+    IndexSpace<N,T> is;
+    RegionInstance index_inst;
+    FieldID index_field;
+    Rect<N2,T2> target_bounds;
+    std::vector<RegionInstance> indirect_insts;
+  };
+
+  template <int N, typename T, int N2, typename T2>
+  TransferDomainIndirect<N,T,N2,T2>::TransferDomainIndirect(IndexSpace<N,T> _is,
+							    RegionInstance _index_inst,
+							    FieldID _index_field,
+							    const Rect<N2,T2>& _target_bounds,
+							    const std::vector<RegionInstance>& _indirect_insts)
+    : is(_is), index_inst(_index_inst), index_field(_index_field)
+    , target_bounds(_target_bounds), indirect_insts(_indirect_insts)
+  {}
+
+  template <int N, typename T, int N2, typename T2>
+  template <typename S>
+  /*static*/ TransferDomain *TransferDomainIndirect<N,T,N2,T2>::deserialize_new(S& deserializer)
+  {
+    IndexSpace<N,T> is;
+    RegionInstance index_inst;
+    FieldID index_field;
+    Rect<N2,T2> target_bounds;
+    std::vector<RegionInstance> indirect_insts;
+    if((deserializer >> is) &&
+       (deserializer >> index_inst) &&
+       (deserializer >> index_field) &&
+       (deserializer >> target_bounds) &&
+       (deserializer >> indirect_insts))
+      return new TransferDomainIndirect<N,T,N2,T2>(is, index_inst, index_field,
+						   target_bounds, indirect_insts);
+    else
+      return 0;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  TransferDomain *TransferDomainIndirect<N,T,N2,T2>::clone(void) const
+  {
+    return new TransferDomainIndirect<N,T,N2,T2>(is, index_inst, index_field,
+						 target_bounds, indirect_insts);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  Event TransferDomainIndirect<N,T,N2,T2>::request_metadata(void)
+  {
+    // both the direct and indirect iterators must walk the space in the
+    //  same order, so insist on the full sparsity map here
+    std::set<Event> events;
+    if(!is.is_valid())
+      events.insert(is.make_valid());
+    RegionInstanceImpl *index_impl = get_runtime()->get_instance_impl(index_inst);
+    if(!index_impl->metadata.is_valid())
+      events.insert(index_impl->request_metadata());
+
+    return Event::merge_events(events);
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  size_t TransferDomainIndirect<N,T,N2,T2>::volume(void) const
+  {
+    return is.volume();
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  TransferIterator *TransferDomainIndirect<N,T,N2,T2>::create_iterator(RegionInstance inst,
+								       RegionInstance peer,
+								       const std::vector<FieldID>& fields) const
+  {
+    if(std::find(indirect_insts.begin(), indirect_insts.end(), inst) != indirect_insts.end())
+      return new TransferIteratorIndirect<N,T,N2,T2>(is, index_inst, index_field,
+						     target_bounds, inst, fields);
+
+    size_t extra_elems = 0;
+    return new TransferIteratorIndexSpace<N,T>(is, inst, fields, extra_elems);
+  }
+  
+  template <int N, typename T, int N2, typename T2>
+  void TransferDomainIndirect<N,T,N2,T2>::print(std::ostream& os) const
+  {
+    os << is << " via " << index_inst << "[" << index_field << "] -> " << target_bounds;
+  }
+
+  template <int N, typename T, int N2, typename T2>
+  /*static*/ Serialization::PolymorphicSerdezSubclass<TransferDomain, TransferDomainIndirect<N,T,N2,T2> > TransferDomainIndirect<N,T,N2,T2>::serdez_subclass;
+
+  template <int N, typename T, int N2, typename T2>
+  template <typename S>
+  inline bool TransferDomainIndirect<N,T,N2,T2>::serialize(S& serializer) const
+  {
+    return ((serializer << is) &&
+	    (serializer << index_inst) &&
+	    (serializer << index_field) &&
+	    (serializer << target_bounds) &&
+	    (serializer << indirect_insts));
+  }
+
+
   ////////////////////////////////////////////////////////////////////////
   //
   // class TransferPlan
@@ -2016,6 +2586,100 @@ namespace Realm {
     return ev;
   }
 
+  ////////////////////////////////////////////////////////////////////////
+  //
+  // class CopyPlanCache
+  //
+
+  // the plans for a (non-reduction) copy depend only on the source and
+  //  destination fields (and the memories their instances live in, which
+  //  can't change), not on the domain, so copies that are repeated can skip
+  //  the sorting and grouping of fields
+  class CopyPlanCache {
+  public:
+    // on a hit, adds the cached plans to 'plans' and returns true
+    bool lookup(const std::vector<CopySrcDstField>& srcs,
+		const std::vector<CopySrcDstField>& dsts,
+		std::vector<TransferPlan *>& plans);
+
+    void insert(const std::vector<CopySrcDstField>& srcs,
+		const std::vector<CopySrcDstField>& dsts,
+		const std::vector<OASByInst *>& oas_by_insts);
+
+  protected:
+    struct Key {
+      std::vector<CopySrcDstField> srcs, dsts;
+
+      bool operator<(const Key& rhs) const;
+    };
+
+    GASNetHSL mutex;
+    std::map<Key, std::vector<OASByInst> > entries;
+  };
+
+  static bool field_less(const CopySrcDstField& a, const CopySrcDstField& b)
+  {
+    if(a.inst != b.inst) return a.inst < b.inst;
+    if(a.field_id != b.field_id) return a.field_id < b.field_id;
+    if(a.size != b.size) return a.size < b.size;
+    if(a.serdez_id != b.serdez_id) return a.serdez_id < b.serdez_id;
+    return a.subfield_offset < b.subfield_offset;
+  }
+
+  bool CopyPlanCache::Key::operator<(const Key& rhs) const
+  {
+    if(std::lexicographical_compare(srcs.begin(), srcs.end(),
+				    rhs.srcs.begin(), rhs.srcs.end(),
+				    field_less))
+      return true;
+    if(std::lexicographical_compare(rhs.srcs.begin(), rhs.srcs.end(),
+				    srcs.begin(), srcs.end(),
+				    field_less))
+      return false;
+    return std::lexicographical_compare(dsts.begin(), dsts.end(),
+					rhs.dsts.begin(), rhs.dsts.end(),
+					field_less);
+  }
+
+  bool CopyPlanCache::lookup(const std::vector<CopySrcDstField>& srcs,
+			     const std::vector<CopySrcDstField>& dsts,
+			     std::vector<TransferPlan *>& plans)
+  {
+    Key key;
+    key.srcs = srcs;
+    key.dsts = dsts;
+    AutoHSLLock al(mutex);
+    std::map<Key, std::vector<OASByInst> >::const_iterator it = entries.find(key);
+    if(it == entries.end())
+      return false;
+    for(std::vector<OASByInst>::const_iterator it2 = it->second.begin();
+	it2 != it->second.end();
+	++it2)
+      plans.push_back(new TransferPlanCopy(new OASByInst(*it2)));
+    return true;
+  }
+
+  void CopyPlanCache::insert(const std::vector<CopySrcDstField>& srcs,
+			     const std::vector<CopySrcDstField>& dsts,
+			     const std::vector<OASByInst *>& oas_by_insts)
+  {
+    Key key;
+    key.srcs = srcs;
+    key.dsts = dsts;
+    AutoHSLLock al(mutex);
+    // no attempt at LRU - if we've filled up, just start over
+    if(entries.size() >= (size_t)Config::copy_plan_cache_size)
+      entries.clear();
+    std::vector<OASByInst>& v = entries[key];
+    v.clear();
+    for(std::vector<OASByInst *>::const_iterator it = oas_by_insts.begin();
+	it != oas_by_insts.end();
+	++it)
+      v.push_back(**it);
+  }
+
+  static CopyPlanCache copy_plan_cache;
+
   /*static*/ bool TransferPlan::plan_copy(std::vector<TransferPlan *>& plans,
 					  const std::vector<CopySrcDstField> &srcs,
 					  const std::vector<CopySrcDstField> &dsts,
@@ -2026,7 +2690,13 @@ namespace Realm {
       // not a reduction, so sort fields by src/dst mem pairs
       //log_new_dma.info("Performing copy op");
 
+      if((Config::copy_plan_cache_size > 0) &&
+	 copy_plan_cache.lookup(srcs, dsts, plans))
+	return true;
+
       OASByMem oas_by_mem;
+      // remembered for the plan cache
+      std::vector<OASByInst *> planned;
 
       std::vector<CopySrcDstField>::const_iterator src_it = srcs.begin();
       std::vector<CopySrcDstField>::const_iterator dst_it = dsts.begin();
@@ -2062,6 +2732,7 @@ namespace Realm {
 	  (*oas_by_inst)[ip].push_back(oas);
 	  TransferPlanCopy *p = new TransferPlanCopy(oas_by_inst);
 	  plans.push_back(p);
+	  planned.push_back(oas_by_inst);
 	} else {
 	  // </SERDEZ_DMA>
 	  OASByInst *oas_by_inst;
@@ -2105,10 +2776,14 @@ namespace Realm {
 	  (*new_oas_by_inst)[it2->first] = it2->second;
 	  TransferPlanCopy *p = new TransferPlanCopy(new_oas_by_inst);
 	  plans.push_back(p);
+	  planned.push_back(new_oas_by_inst);
 	}
 	// done with original oas_by_inst
 	delete oas_by_inst;
       }
+
+      if(Config::copy_plan_cache_size > 0)
+	copy_plan_cache.insert(srcs, dsts, planned);
     } else {
       // reduction op case
 
@@ -2218,6 +2893,87 @@ namespace Realm {
     return Event::merge_events(finish_events);
   }
 
+  template <int N, typename T, int N2, typename T2>
+  static Event indirect_copy(const IndexSpace<N,T>& is,
+			     const IndexSpace<N2,T2>& indirect_space,
+			     const CopySrcDstField& indirect,
+			     const std::vector<CopySrcDstField>& srcs,
+			     const std::vector<CopySrcDstField>& dsts,
+			     bool is_gather,
+			     const ProfilingRequestSet& requests,
+			     Event wait_on)
+  {
+    if((indirect.size != sizeof(Point<N2,T2>)) ||
+       (indirect.subfield_offset != 0)) {
+      log_dma.fatal() << "index field for indirect copy must hold Point<" << N2
+		      << "> values: size=" << indirect.size;
+      assert(0);
+    }
+
+    // the instances on the indirect side are addressed through the index
+    //  field, and cannot also appear on the direct side
+    const std::vector<CopySrcDstField>& ind_fields = (is_gather ? srcs : dsts);
+    const std::vector<CopySrcDstField>& dir_fields = (is_gather ? dsts : srcs);
+    std::vector<RegionInstance> indirect_insts;
+    for(std::vector<CopySrcDstField>::const_iterator it = ind_fields.begin();
+	it != ind_fields.end();
+	++it)
+      if(std::find(indirect_insts.begin(), indirect_insts.end(), it->inst) == indirect_insts.end())
+	indirect_insts.push_back(it->inst);
+    for(std::vector<CopySrcDstField>::const_iterator it = dir_fields.begin();
+	it != dir_fields.end();
+	++it)
+      assert(std::find(indirect_insts.begin(), indirect_insts.end(), it->inst) == indirect_insts.end());
+
+    TransferDomain *td = new TransferDomainIndirect<N,T,N2,T2>(is,
+							       indirect.inst,
+							       indirect.field_id,
+							       indirect_space.bounds,
+							       indirect_insts);
+    std::vector<TransferPlan *> plans;
+    bool ok = TransferPlan::plan_copy(plans, srcs, dsts, 0 /*redop_id*/, false);
+    assert(ok);
+    ProfilingRequestSet empty_prs;
+    const ProfilingRequestSet *prsptr = &requests;
+    std::set<Event> finish_events;
+    for(std::vector<TransferPlan *>::iterator it = plans.begin();
+	it != plans.end();
+	++it) {
+      Event e = (*it)->execute_plan(td, *prsptr, wait_on, 0 /*priority*/);
+      prsptr = &empty_prs;
+      finish_events.insert(e);
+      delete *it;
+    }
+    delete td;
+    return Event::merge_events(finish_events);
+  }
+
+  template <int N, typename T>
+  template <int N2, typename T2>
+  Event IndexSpace<N,T>::gather(const IndexSpace<N2,T2> &indirect_space,
+				 const CopySrcDstField &indirect,
+				 const std::vector<CopySrcDstField> &srcs,
+				 const std::vector<CopySrcDstField> &dsts,
+				 const ProfilingRequestSet &requests,
+				 Event wait_on /*= Event::NO_EVENT*/) const
+  {
+    return indirect_copy(*this, indirect_space, indirect, srcs, dsts,
+			 true /*gather*/, requests, wait_on);
+  }
+
+  template <int N, typename T>
+  template <int N2, typename T2>
+  Event IndexSpace<N,T>::scatter(const IndexSpace<N2,T2> &indirect_space,
+				  const CopySrcDstField &indirect,
+				  const std::vector<CopySrcDstField> &srcs,
+				  const std::vector<CopySrcDstField> &dsts,
+				  const ProfilingRequestSet &requests,
+				  Event wait_on /*= Event::NO_EVENT*/) const
+  {
+    return indirect_copy(*this, indirect_space, indirect, srcs, dsts,
+			 false /*!gather*/, requests, wait_on);
+  }
+
 #define DOIT(N,T) \
   template Event IndexSpace<N,T>::copy(const std::vector<CopySrcDstField>&, \
 					const std::vector<CopySrcDstField>&, \
@@ -2232,4 +2988,21 @@ namespace Realm {
   template class TransferDomainIndexSpace<N,T>;
   FOREACH_NT(DOIT)
 
+#define DOIT2(N,T,N2,T2) \
+  template Event IndexSpace<N,T>::gather(const IndexSpace<N2,T2>&, \
+					  const CopySrcDstField&, \
+					  const std::vector<CopySrcDstField>&, \
+					  const std::vector<CopySrcDstField>&, \
+					  const ProfilingRequestSet&, \
+					  Event) const; \
+  template Event IndexSpace<N,T>::scatter(const IndexSpace<N2,T2>&, \
+					   const CopySrcDstField&, \
+					   const std::vector<CopySrcDstField>&, \
+					   const std::vector<CopySrcDstField>&, \
+					   const ProfilingRequestSet&, \
+					   Event) const; \
+  template class TransferIteratorIndirect<N,T,N2,T2>; \
+  template class TransferDomainIndirect<N,T,N2,T2>;
+  FOREACH_NTNT(DOIT2)
+
 }; // namespace Realm
@@ -150,6 +150,12 @@ ifeq ($(strip $(USE_PAPI)),1)
   LEGION_LD_FLAGS += -L$(PAPI_ROOT)/lib -lpapi
 endif
 
+# io_uring needs only kernel headers (no liburing), but a 5.6+ kernel at
+#  runtime - older kernels fall back to AIO
+ifeq ($(strip $(USE_IO_URING)),1)
+  CC_FLAGS        += -DREALM_USE_IO_URING
+endif
+
 USE_LIBDL ?= 1
 ifeq ($(strip $(USE_LIBDL)),1)
 CC_FLAGS += -DUSE_LIBDL
@@ -460,6 +466,7 @@ LOW_RUNTIME_SRC += $(LG_RT_DIR)/realm/runtime_impl.cc \
 	           $(LG_RT_DIR)/realm/deppart/byfield.cc \
 	           $(LG_RT_DIR)/realm/deppart/setops.cc \
 		   $(LG_RT_DIR)/realm/event_impl.cc \
+		   $(LG_RT_DIR)/realm/event_trace.cc \
 		   $(LG_RT_DIR)/realm/rsrv_impl.cc \
 		   $(LG_RT_DIR)/realm/proc_impl.cc \
 		   $(LG_RT_DIR)/realm/mem_impl.cc \
@@ -508,7 +515,8 @@ MAPPER_SRC	+= $(LG_RT_DIR)/mappers/default_mapper.cc \
 		   $(LG_RT_DIR)/mappers/test_mapper.cc \
 		   $(LG_RT_DIR)/mappers/replay_mapper.cc \
 		   $(LG_RT_DIR)/mappers/debug_mapper.cc \
-		   $(LG_RT_DIR)/mappers/wrapper_mapper.cc
+		   $(LG_RT_DIR)/mappers/wrapper_mapper.cc \
+		   $(LG_RT_DIR)/mappers/variant_tuner.cc
 
 HIGH_RUNTIME_SRC += $(LG_RT_DIR)/legion/legion.cc \
 		    $(LG_RT_DIR)/legion/legion_c.cc \
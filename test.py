@@ -323,7 +323,18 @@ def run_test_perf(launcher, root_dir, tmp_dir, bin_dir, env, thread_count):
             'type': 'regex',
             'pattern': r'^ELAPSED TIME\s*=\s*(.*) s$',
             'multiline': True,
-        }
+        },
+        # Record the median and tail iteration times in seconds.
+        'iteration_p50_seconds': {
+            'type': 'regex',
+            'pattern': r'^ITERATION TIME p50\s*=\s*(.*) s$',
+            'multiline': True,
+        },
+        'iteration_p99_seconds': {
+            'type': 'regex',
+            'pattern': r'^ITERATION TIME p99\s*=\s*(.*) s$',
+            'multiline': True,
+        },
     }
     regent_measurements = {
         # Hack: Use the command name as the benchmark name.
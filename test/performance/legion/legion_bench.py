@@ -0,0 +1,129 @@
+#!/usr/bin/env python
+
+# Copyright 2017 Stanford University
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+###
+### Runs the Legion runtime overhead benchmarks over a sweep of thread
+### counts, node counts and sizes and reports percentiles as JSON
+###
+
+from __future__ import print_function
+
+import argparse, itertools, json, os, sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                                '..', 'realm'))
+from realm_bench import Benchmark, Metric, get_metadata, parse_list, run_config
+
+overhead_path = 'test/performance/legion/runtime_overhead/runtime_overhead'
+overhead_metrics = [
+    Metric('us', r'^BENCH \S+ (\S+): (\S+) us$', 'us'),
+    Metric('speedup', r'^BENCH \S+ speedup: (\S+) x$', 'x'),
+]
+
+benchmarks = [
+    # per-task cost of launching tasks without regions
+    Benchmark('task_launch', overhead_path,
+              ['-bench', 'task_launch'], None, overhead_metrics),
+    # dependence analysis cost versus the number of region requirements
+    Benchmark('dependence', overhead_path,
+              ['-bench', 'dependence'], '-size', overhead_metrics),
+    # index launch cost versus the number of points in the launch domain
+    Benchmark('index_launch', overhead_path,
+              ['-bench', 'index_launch'], '-size', overhead_metrics),
+    # speedup of replaying a trace versus the number of tasks in it
+    Benchmark('trace', overhead_path,
+              ['-bench', 'trace'], '-size', overhead_metrics),
+    # mapping cost versus the number of valid instances
+    Benchmark('mapping', overhead_path,
+              ['-bench', 'mapping'], '-size', overhead_metrics),
+]
+
+def perf_result(metadata, result):
+    # one result in the format perf.py uploads and tools/perf_chart.py reads,
+    #  with the percentiles flattened into individual measurements
+    meta = dict(metadata)
+    meta['benchmark'] = 'legion_%s' % result['benchmark']
+    meta['argv'] = result['argv']
+    measurements = dict(('%s_%s' % (name, stat), value)
+                        for name, stats in result['metrics'].items()
+                        for stat, value in stats.items()
+                        if stat not in ('count', 'unit'))
+    measurements.update(result['params'])
+    return {'metadata': meta, 'measurements': measurements}
+
+def driver():
+    parser = argparse.ArgumentParser(
+        description='Run Legion runtime overhead benchmarks and report JSON results')
+    parser.add_argument('-b', '--bench', action='append',
+                        choices=[b.name for b in benchmarks],
+                        help='benchmark to run (default: all)')
+    parser.add_argument('-t', '--threads', type=parse_list, default=[1],
+                        help='comma-separated list of -ll:cpu values')
+    parser.add_argument('-n', '--nodes', type=parse_list, default=[1],
+                        help='comma-separated list of node counts')
+    parser.add_argument('-s', '--sizes', type=parse_list, default=[1, 4, 16, 64],
+                        help='comma-separated list of sizes (region requirements, '
+                             'launch points, trace length or instance count '
+                             'depending on the benchmark)')
+    parser.add_argument('-r', '--repeat', type=int, default=5,
+                        help='runs per configuration')
+    parser.add_argument('-l', '--launcher', default=os.environ.get('LAUNCHER', ''),
+                        help='launch command, with {nodes} replaced by the '
+                             'node count (e.g. "mpirun -n {nodes} -npernode 1")')
+    parser.add_argument('-o', '--output', help='JSON output file (default: stdout)')
+    parser.add_argument('--perf-dir',
+                        help='also write one perf.py-style result per '
+                             'configuration to PERF_DIR/measurements/<benchmark>/')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    parser.add_argument('extra_args', nargs=argparse.REMAINDER,
+                        help='additional arguments passed to every benchmark')
+    args = parser.parse_args()
+
+    launcher = args.launcher.split()
+    if max(args.nodes) > 1 and not any('{nodes}' in x for x in launcher):
+        parser.error('multi-node runs need a launcher that uses {nodes}')
+    extra_args = args.extra_args[1:] if args.extra_args[:1] == ['--'] else args.extra_args
+
+    selected = [b for b in benchmarks if not args.bench or b.name in args.bench]
+    metadata = get_metadata()
+    results = []
+    for bench in selected:
+        sizes = args.sizes if bench.size_flag else [None]
+        for threads, nodes, size in itertools.product(args.threads, args.nodes, sizes):
+            results.append(run_config(bench, launcher, threads, nodes, size,
+                                      args.repeat, extra_args, args.verbose))
+
+    content = json.dumps({'metadata': metadata, 'results': results},
+                         indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(content + '\n')
+    else:
+        print(content)
+
+    if args.perf_dir:
+        for i, result in enumerate(results):
+            value = perf_result(metadata, result)
+            path = os.path.join(args.perf_dir, 'measurements',
+                                value['metadata']['benchmark'])
+            if not os.path.exists(path):
+                os.makedirs(path)
+            with open(os.path.join(path, '%s_%d.json' % (metadata['date'], i)), 'w') as f:
+                json.dump(value, f, sort_keys=True)
+
+if __name__ == '__main__':
+    driver()
@@ -0,0 +1,139 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+////////////////////////////////////////////////////////////
+// Measures the latency of passing control back and forth
+// between MPI and Legion with an MPILegionHandshake. Each
+// iteration is one round trip: MPI hands off to Legion and
+// then waits for Legion to hand control back.
+//
+// Run with and without -lg:handshake_spin <us> to compare
+// the blocking and polling versions of the handshake.
+//
+// Like the mpi_interop example, this needs a GASNet build
+// that is configured with MPI compatibility.
+////////////////////////////////////////////////////////////
+
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mpi.h>
+
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskID
+{
+  TOP_LEVEL_TASK_ID,
+  HANDSHAKE_TASK_ID,
+};
+
+MPILegionHandshake handshake;
+
+static int num_iterations = 10000;
+static int num_warmup = 100;
+
+void handshake_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  for (int i = 0; i < (num_warmup + num_iterations); i++)
+  {
+    handshake.legion_wait_on_mpi();
+    handshake.legion_handoff_to_mpi();
+  }
+}
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  int size = -1;
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+  // One handshake task per rank so that both sides are in the same process
+  MustEpochLauncher must_epoch_launcher;
+  Rect<1> launch_bounds(0,size - 1);
+  ArgumentMap args_map;
+  IndexLauncher index_launcher(HANDSHAKE_TASK_ID, launch_bounds,
+                               TaskArgument(NULL, 0), args_map);
+  must_epoch_launcher.add_index_task(index_launcher);
+  runtime->execute_must_epoch(ctx, must_epoch_launcher);
+}
+
+int main(int argc, char **argv)
+{
+#ifdef GASNET_CONDUIT_MPI
+  int provided;
+  MPI_Init_thread(&argc, &argv, MPI_THREAD_MULTIPLE, &provided);
+  assert(provided == MPI_THREAD_MULTIPLE);
+#else
+  MPI_Init(&argc, &argv);
+#endif
+
+  for (int i = 1; i < argc; i++)
+  {
+    if (!strcmp(argv[i], "-i") && ((i+1) < argc))
+      num_iterations = atoi(argv[++i]);
+    else if (!strcmp(argv[i], "-w") && ((i+1) < argc))
+      num_warmup = atoi(argv[++i]);
+  }
+
+  int rank = -1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+  Runtime::configure_MPI_interoperability(rank);
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID);
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar,
+                                                      "Top Level Task");
+    Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+  }
+  {
+    TaskVariantRegistrar registrar(HANDSHAKE_TASK_ID);
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<handshake_task>(registrar,
+                                                      "Handshake Task");
+  }
+  handshake = Runtime::create_handshake(true/*MPI initial control*/,
+                                        1/*MPI participants*/,
+                                        1/*Legion participants*/);
+  Runtime::start(argc, argv, true/*background*/);
+
+  for (int i = 0; i < num_warmup; i++)
+  {
+    handshake.mpi_handoff_to_legion();
+    handshake.mpi_wait_on_legion();
+  }
+  const double start = MPI_Wtime();
+  for (int i = 0; i < num_iterations; i++)
+  {
+    handshake.mpi_handoff_to_legion();
+    handshake.mpi_wait_on_legion();
+  }
+  const double stop = MPI_Wtime();
+  printf("rank %d: %d handshake round trips in %.3f ms, "
+         "%.3f us per round trip\n", rank, num_iterations,
+         1e3 * (stop - start), 1e6 * (stop - start) / num_iterations);
+
+  Runtime::wait_for_shutdown();
+#ifndef GASNET_CONDUIT_MPI
+  MPI_Finalize();
+#endif
+
+  return 0;
+}
@@ -0,0 +1,323 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+////////////////////////////////////////////////////////////
+// Measures the overhead of the Legion runtime for operations
+// that do no work, using the default mapper. Each benchmark
+// issues a stream of empty tasks and reports the average
+// wall-clock time per operation once they have all finished:
+//
+//   task_launch  - individual tasks without regions
+//   dependence   - individual tasks with -size region
+//                  requirements on disjoint subregions
+//   index_launch - index space launches over -size points
+//   trace        - loops of -size dependent tasks with and
+//                  without tracing
+//   mapping      - tasks round-robin over -size regions, so
+//                  the mapper sees -size valid instances
+//
+// Every result is printed as a line of the form
+//   BENCH <benchmark> <metric>: <value> <unit>
+// which is what legion_bench.py parses.
+////////////////////////////////////////////////////////////
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "legion.h"
+
+using namespace Legion;
+
+enum TaskIDs {
+  TOP_LEVEL_TASK_ID,
+  EMPTY_TASK_ID,
+};
+
+enum FieldIDs {
+  FID_VAL = 101,
+};
+
+enum TraceIDs {
+  TRACE_ID_LOOP = 1,
+};
+
+struct Config {
+  const char *bench; // NULL runs all of them
+  int num_ops;
+  int size;
+  int warmup;
+};
+
+static void empty_task(const Task *task,
+                       const std::vector<PhysicalRegion> &regions,
+                       Context ctx, Runtime *runtime)
+{
+}
+
+static void report(const char *bench, const char *metric,
+                   double value, const char *unit)
+{
+  printf("BENCH %s %s: %.3f %s\n", bench, metric, value, unit);
+}
+
+static LogicalRegion create_region(Context ctx, Runtime *runtime, int points)
+{
+  Rect<1> bounds(0, points - 1);
+  IndexSpaceT<1> is = runtime->create_index_space(ctx, bounds);
+  FieldSpace fs = runtime->create_field_space(ctx);
+  {
+    FieldAllocator allocator = runtime->create_field_allocator(ctx, fs);
+    allocator.allocate_field(sizeof(int), FID_VAL);
+  }
+  return runtime->create_logical_region(ctx, is, fs);
+}
+
+static void wait_all(std::vector<Future> &futures)
+{
+  for (unsigned idx = 0; idx < futures.size(); idx++)
+    futures[idx].get_void_result();
+  futures.clear();
+}
+
+static void bench_task_launch(const Config &config,
+                              Context ctx, Runtime *runtime)
+{
+  std::vector<Future> futures;
+  futures.reserve(config.num_ops);
+  TaskLauncher launcher(EMPTY_TASK_ID, TaskArgument(NULL, 0));
+  for (int i = 0; i < config.warmup; i++)
+    futures.push_back(runtime->execute_task(ctx, launcher));
+  wait_all(futures);
+
+  const long long start = Realm::Clock::current_time_in_microseconds();
+  for (int i = 0; i < config.num_ops; i++)
+    futures.push_back(runtime->execute_task(ctx, launcher));
+  wait_all(futures);
+  const long long stop = Realm::Clock::current_time_in_microseconds();
+  report("task_launch", "task", double(stop - start) / config.num_ops, "us");
+}
+
+static void bench_dependence(const Config &config,
+                             Context ctx, Runtime *runtime)
+{
+  const int num_reqs = config.size;
+  LogicalRegion region = create_region(ctx, runtime, 16 * num_reqs);
+  Rect<1> color_bounds(0, num_reqs - 1);
+  IndexSpaceT<1> color_is = runtime->create_index_space(ctx, color_bounds);
+  IndexPartition ip =
+    runtime->create_equal_partition(ctx, region.get_index_space(), color_is);
+  LogicalPartition lp = runtime->get_logical_partition(ctx, region, ip);
+
+  TaskLauncher launcher(EMPTY_TASK_ID, TaskArgument(NULL, 0));
+  for (int r = 0; r < num_reqs; r++)
+  {
+    LogicalRegion subregion =
+      runtime->get_logical_subregion_by_color(ctx, lp, r);
+    launcher.add_region_requirement(
+        RegionRequirement(subregion, READ_WRITE, EXCLUSIVE, region));
+    launcher.add_field(r, FID_VAL);
+  }
+  std::vector<Future> futures;
+  futures.reserve(config.num_ops);
+  for (int i = 0; i < config.warmup; i++)
+    futures.push_back(runtime->execute_task(ctx, launcher));
+  wait_all(futures);
+
+  const long long start = Realm::Clock::current_time_in_microseconds();
+  for (int i = 0; i < config.num_ops; i++)
+    futures.push_back(runtime->execute_task(ctx, launcher));
+  wait_all(futures);
+  const long long stop = Realm::Clock::current_time_in_microseconds();
+  const double per_task = double(stop - start) / config.num_ops;
+  report("dependence", "task", per_task, "us");
+  report("dependence", "requirement", per_task / num_reqs, "us");
+
+  runtime->destroy_logical_region(ctx, region);
+}
+
+static void bench_index_launch(const Config &config,
+                               Context ctx, Runtime *runtime)
+{
+  const int num_points = config.size;
+  Rect<1> launch_bounds(0, num_points - 1);
+  ArgumentMap arg_map;
+  IndexLauncher launcher(EMPTY_TASK_ID, launch_bounds,
+                         TaskArgument(NULL, 0), arg_map);
+  // Keep the total number of point tasks about the same for every size
+  const int num_launches =
+    (config.num_ops + num_points - 1) / num_points;
+  std::vector<FutureMap> future_maps;
+  future_maps.reserve(num_launches);
+  for (int i = 0; i < (config.warmup + num_points - 1) / num_points; i++)
+    future_maps.push_back(runtime->execute_index_space(ctx, launcher));
+  for (unsigned idx = 0; idx < future_maps.size(); idx++)
+    future_maps[idx].wait_all_results();
+  future_maps.clear();
+
+  const long long start = Realm::Clock::current_time_in_microseconds();
+  for (int i = 0; i < num_launches; i++)
+    future_maps.push_back(runtime->execute_index_space(ctx, launcher));
+  for (unsigned idx = 0; idx < future_maps.size(); idx++)
+    future_maps[idx].wait_all_results();
+  const long long stop = Realm::Clock::current_time_in_microseconds();
+  const double per_launch = double(stop - start) / num_launches;
+  report("index_launch", "launch", per_launch, "us");
+  report("index_launch", "point", per_launch / num_points, "us");
+}
+
+static double run_loop(const Config &config, Context ctx, Runtime *runtime,
+                       LogicalRegion region, int iterations, bool traced)
+{
+  TaskLauncher launcher(EMPTY_TASK_ID, TaskArgument(NULL, 0));
+  launcher.add_region_requirement(
+      RegionRequirement(region, READ_WRITE, EXCLUSIVE, region));
+  launcher.add_field(0, FID_VAL);
+  std::vector<Future> futures;
+  futures.reserve(iterations * config.size);
+  const long long start = Realm::Clock::current_time_in_microseconds();
+  for (int i = 0; i < iterations; i++)
+  {
+    if (traced)
+      runtime->begin_trace(ctx, TRACE_ID_LOOP);
+    for (int t = 0; t < config.size; t++)
+      futures.push_back(runtime->execute_task(ctx, launcher));
+    if (traced)
+      runtime->end_trace(ctx, TRACE_ID_LOOP);
+  }
+  wait_all(futures);
+  const long long stop = Realm::Clock::current_time_in_microseconds();
+  return double(stop - start) / (iterations * config.size);
+}
+
+static void bench_trace(const Config &config, Context ctx, Runtime *runtime)
+{
+  LogicalRegion region = create_region(ctx, runtime, 16);
+  const int iterations = (config.num_ops + config.size - 1) / config.size;
+  // The first traced iteration records the trace
+  run_loop(config, ctx, runtime, region, 1, true/*traced*/);
+  const double untraced =
+    run_loop(config, ctx, runtime, region, iterations, false/*traced*/);
+  const double traced =
+    run_loop(config, ctx, runtime, region, iterations, true/*traced*/);
+  report("trace", "untraced_task", untraced, "us");
+  report("trace", "traced_task", traced, "us");
+  report("trace", "speedup", untraced / traced, "x");
+  runtime->destroy_logical_region(ctx, region);
+}
+
+static void bench_mapping(const Config &config, Context ctx, Runtime *runtime)
+{
+  const int num_regions = config.size;
+  std::vector<LogicalRegion> regions(num_regions);
+  for (int r = 0; r < num_regions; r++)
+    regions[r] = create_region(ctx, runtime, 16);
+  std::vector<TaskLauncher> launchers(num_regions,
+      TaskLauncher(EMPTY_TASK_ID, TaskArgument(NULL, 0)));
+  for (int r = 0; r < num_regions; r++)
+  {
+    launchers[r].add_region_requirement(
+        RegionRequirement(regions[r], READ_WRITE, EXCLUSIVE, regions[r]));
+    launchers[r].add_field(0, FID_VAL);
+  }
+  // Make an instance for every region before we start timing
+  std::vector<Future> futures;
+  futures.reserve(config.num_ops);
+  for (int r = 0; r < num_regions; r++)
+    futures.push_back(runtime->execute_task(ctx, launchers[r]));
+  wait_all(futures);
+
+  const long long start = Realm::Clock::current_time_in_microseconds();
+  for (int i = 0; i < config.num_ops; i++)
+    futures.push_back(runtime->execute_task(ctx, launchers[i % num_regions]));
+  wait_all(futures);
+  const long long stop = Realm::Clock::current_time_in_microseconds();
+  report("mapping", "task", double(stop - start) / config.num_ops, "us");
+
+  for (int r = 0; r < num_regions; r++)
+    runtime->destroy_logical_region(ctx, regions[r]);
+}
+
+void top_level_task(const Task *task,
+                    const std::vector<PhysicalRegion> &regions,
+                    Context ctx, Runtime *runtime)
+{
+  Config config;
+  config.bench = NULL;
+  config.num_ops = 10000;
+  config.size = 4;
+  config.warmup = 100;
+  const InputArgs &command_args = Runtime::get_input_args();
+  for (int i = 1; i < command_args.argc; i++)
+  {
+    if (!strcmp(command_args.argv[i], "-bench"))
+      config.bench = command_args.argv[++i];
+    else if (!strcmp(command_args.argv[i], "-n"))
+      config.num_ops = atoi(command_args.argv[++i]);
+    else if (!strcmp(command_args.argv[i], "-size"))
+      config.size = atoi(command_args.argv[++i]);
+    else if (!strcmp(command_args.argv[i], "-warmup"))
+      config.warmup = atoi(command_args.argv[++i]);
+  }
+  if ((config.num_ops < 1) || (config.size < 1))
+  {
+    fprintf(stderr, "-n and -size must be positive\n");
+    exit(1);
+  }
+
+  struct {
+    const char *name;
+    void (*func)(const Config&, Context, Runtime*);
+  } benchmarks[] = {
+    { "task_launch", bench_task_launch },
+    { "dependence", bench_dependence },
+    { "index_launch", bench_index_launch },
+    { "trace", bench_trace },
+    { "mapping", bench_mapping },
+  };
+  bool found = false;
+  for (unsigned idx = 0; idx < sizeof(benchmarks)/sizeof(benchmarks[0]); idx++)
+  {
+    if ((config.bench != NULL) && strcmp(config.bench, benchmarks[idx].name))
+      continue;
+    (*benchmarks[idx].func)(config, ctx, runtime);
+    found = true;
+  }
+  if (!found)
+  {
+    fprintf(stderr, "unknown benchmark '%s'\n", config.bench);
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  Runtime::set_top_level_task_id(TOP_LEVEL_TASK_ID);
+
+  {
+    TaskVariantRegistrar registrar(TOP_LEVEL_TASK_ID, "top_level");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    Runtime::preregister_task_variant<top_level_task>(registrar, "top_level");
+  }
+  {
+    TaskVariantRegistrar registrar(EMPTY_TASK_ID, "empty");
+    registrar.add_constraint(ProcessorConstraint(Processor::LOC_PROC));
+    registrar.set_leaf();
+    Runtime::preregister_task_variant<empty_task>(registrar, "empty");
+  }
+
+  return Runtime::start(argc, argv);
+}
@@ -0,0 +1,203 @@
+#!/usr/bin/env python
+
+# Copyright 2017 Stanford University
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+###
+### Runs the circuit and stencil examples on 1..N nodes with weak or
+### strong scaling and reports per-iteration percentiles as JSON
+###
+
+from __future__ import print_function
+
+import argparse, json, os, subprocess, sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.realpath(__file__)),
+                                '..', 'realm'))
+from realm_bench import Metric, get_metadata, parse_list, root_dir, summarize
+
+# With weak scaling the size is the problem size per node, and with
+#  strong scaling it is the total problem size for every node count.
+
+def circuit_args(mode, nodes, threads, size):
+    # size is the number of pieces, with one piece per cpu by default
+    pieces = size * nodes if mode == 'weak' else size
+    return ['-p', str(pieces), '-ll:cpu', str(threads)]
+
+def stencil_args(mode, nodes, threads, size):
+    # size is the edge of a size x size grid; weak scaling stacks one
+    #  grid per node along x, and every node gets a column of tiles
+    nx = size * nodes if mode == 'weak' else size
+    return ['-nx', str(nx), '-ny', str(size),
+            '-ntx', str(nodes), '-nty', str(threads),
+            '-ll:cpu', str(threads)]
+
+class App(object):
+    __slots__ = ['name', 'path', 'args', 'warmup_args', 'make_args',
+                 'default_size', 'metrics']
+    def __init__(self, name, path, args, warmup_args, make_args,
+                 default_size, metrics):
+        self.name = name
+        self.path = path                # binary, relative to the repository root
+        self.args = args
+        self.warmup_args = warmup_args  # flag that takes the warmup iterations
+        self.make_args = make_args      # (mode, nodes, threads, size) -> args
+        self.default_size = default_size  # None means one unit per cpu
+        self.metrics = metrics
+
+apps = [
+    App('circuit', 'examples/circuit/circuit',
+        ['-l', '50', '-npp', '2500', '-wpp', '10000'], '-w', circuit_args, None,
+        [Metric('iteration_s', r'^ITERATION TIME (\S+)\s*=\s*(\S+) s$', 's'),
+         Metric('elapsed_s', r'^ELAPSED TIME\s*=\s*(\S+) s$', 's')]),
+    App('stencil', 'examples/realm_stencil/realm_stencil',
+        ['-tsteps', '50'], '-tprune', stencil_args, 4096,
+        [Metric('iteration_s', r'^Iteration time (\S+): (\S+) seconds$', 's'),
+         Metric('elapsed_s', r'^Elapsed time: (\S+) seconds$', 's')]),
+]
+
+def run_config(app, launcher, mode, nodes, threads, size, warmup, repeat,
+               extra_args, verbose):
+    argv = [os.path.join(root_dir, app.path)] + app.args + extra_args
+    argv += [app.warmup_args, str(warmup)]
+    argv += app.make_args(mode, nodes, threads, size)
+    command = [x.format(nodes=nodes) for x in launcher] + argv
+
+    samples = {}
+    for _ in range(repeat):
+        if verbose:
+            print(' '.join(command), file=sys.stderr)
+        output = subprocess.check_output(command, stderr=subprocess.STDOUT).decode()
+        found = False
+        for metric in app.metrics:
+            for name, values in metric.extract(output).items():
+                samples.setdefault(name, (metric.unit, []))[1].extend(values)
+                found = True
+        if not found:
+            raise Exception('%s produced no measurements:\n%s' % (app.name, output))
+
+    # each run already reports its own percentiles, so summarize those
+    #  across runs
+    metrics = {}
+    for name, (unit, values) in samples.items():
+        metrics[name] = summarize(values)
+        metrics[name]['unit'] = unit
+    return {
+        'benchmark': app.name,
+        'params': {'mode': mode, 'nodes': nodes, 'threads': threads, 'size': size},
+        'argv': argv[1:],
+        'metrics': metrics,
+    }
+
+def add_efficiency(results):
+    # parallel efficiency relative to the smallest node count, from the
+    #  median iteration time (ideal is 1.0 for both modes)
+    for result in results:
+        base = min((r for r in results if r['benchmark'] == result['benchmark']
+                    and r['params']['threads'] == result['params']['threads']),
+                   key=lambda r: r['params']['nodes'])
+        time = result['metrics']['iteration_s_p50']['p50']
+        base_time = base['metrics']['iteration_s_p50']['p50']
+        ratio = float(base['params']['nodes']) / result['params']['nodes']
+        if result['params']['mode'] == 'weak':
+            result['efficiency'] = base_time / time
+        else:
+            result['efficiency'] = base_time * ratio / time
+
+def perf_result(metadata, result):
+    # one result in the format perf.py uploads and tools/perf_chart.py reads,
+    #  with the percentiles flattened into individual measurements
+    meta = dict(metadata)
+    meta['benchmark'] = 'legion_%s_%s' % (result['benchmark'],
+                                          result['params']['mode'])
+    meta['argv'] = result['argv']
+    measurements = dict(('%s_%s' % (name, stat), value)
+                        for name, stats in result['metrics'].items()
+                        for stat, value in stats.items()
+                        if stat not in ('count', 'unit'))
+    measurements.update(result['params'])
+    measurements['efficiency'] = result['efficiency']
+    return {'metadata': meta, 'measurements': measurements}
+
+def driver():
+    parser = argparse.ArgumentParser(
+        description='Run the circuit and stencil scaling benchmarks and report JSON results')
+    parser.add_argument('-a', '--app', action='append',
+                        choices=[a.name for a in apps],
+                        help='application to run (default: all)')
+    parser.add_argument('-m', '--mode', choices=['weak', 'strong'], default='weak',
+                        help='weak: fixed problem size per node, '
+                             'strong: fixed total problem size')
+    parser.add_argument('-n', '--nodes', type=parse_list, default=[1],
+                        help='comma-separated list of node counts')
+    parser.add_argument('-t', '--threads', type=parse_list, default=[4],
+                        help='comma-separated list of -ll:cpu values')
+    parser.add_argument('-s', '--size', type=int,
+                        help='problem size (per node for weak scaling, total '
+                             'for strong scaling): pieces for circuit, grid '
+                             'edge for stencil')
+    parser.add_argument('-w', '--warmup', type=int, default=5,
+                        help='untimed iterations before the timed ones')
+    parser.add_argument('-r', '--repeat', type=int, default=3,
+                        help='runs per configuration')
+    parser.add_argument('-l', '--launcher', default=os.environ.get('LAUNCHER', ''),
+                        help='launch command, with {nodes} replaced by the '
+                             'node count (e.g. "mpirun -n {nodes} -npernode 1")')
+    parser.add_argument('-o', '--output', help='JSON output file (default: stdout)')
+    parser.add_argument('--perf-dir',
+                        help='also write one perf.py-style result per '
+                             'configuration to PERF_DIR/measurements/<benchmark>/')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    parser.add_argument('extra_args', nargs=argparse.REMAINDER,
+                        help='additional arguments passed to every application')
+    args = parser.parse_args()
+
+    launcher = args.launcher.split()
+    if max(args.nodes) > 1 and not any('{nodes}' in x for x in launcher):
+        parser.error('multi-node runs need a launcher that uses {nodes}')
+    extra_args = args.extra_args[1:] if args.extra_args[:1] == ['--'] else args.extra_args
+
+    selected = [a for a in apps if not args.app or a.name in args.app]
+    metadata = get_metadata()
+    results = []
+    for app in selected:
+        for threads in args.threads:
+            size = args.size or app.default_size or threads
+            for nodes in args.nodes:
+                results.append(run_config(app, launcher, args.mode, nodes, threads,
+                                          size, args.warmup, args.repeat,
+                                          extra_args, args.verbose))
+    add_efficiency(results)
+
+    content = json.dumps({'metadata': metadata, 'results': results},
+                         indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(content + '\n')
+    else:
+        print(content)
+
+    if args.perf_dir:
+        for i, result in enumerate(results):
+            value = perf_result(metadata, result)
+            path = os.path.join(args.perf_dir, 'measurements',
+                                value['metadata']['benchmark'])
+            if not os.path.exists(path):
+                os.makedirs(path)
+            with open(os.path.join(path, '%s_%d.json' % (metadata['date'], i)), 'w') as f:
+                json.dump(value, f, sort_keys=True)
+
+if __name__ == '__main__':
+    driver()
@@ -0,0 +1,426 @@
+/* Copyright 2017 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// measures copy bandwidth and latency for every pair of memories (plus file
+//  and HDF5 instances) over a range of sizes, dimensionalities, and field
+//  counts, and reports the results as src x dst matrices
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <cmath>
+
+#include <realm.h>
+#include <realm/cmdline.h>
+#include <realm/id.h>
+#include <realm/utils.h>
+
+#ifdef USE_HDF
+#include <hdf5.h>
+#endif
+
+using namespace Realm;
+
+namespace TestConfig {
+  size_t min_size = 4 << 10;   // bytes per copy, over all fields
+  size_t max_size = 64 << 20;
+  int max_dim = 3;
+  int max_fields = 4;
+  int reps = 8;
+  bool remote = false;         // include memories on other nodes
+  bool no_files = false;       // skip file (and HDF5) instances
+  std::string file_prefix = "/tmp/dma_matrix";
+  std::string csv_file;
+};
+
+// TASK IDs
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+};
+
+Logger log_app("app");
+
+typedef double FieldType;
+
+// one side of a copy - either a memory or a kind of file-backed instance
+struct Endpoint {
+  enum Type { MEMORY, FILE, HDF5 };
+  Type type;
+  Memory mem;
+  std::string name;
+};
+
+struct Result {
+  int src, dst;  // indices into the endpoint list
+  int dim, fields;
+  size_t bytes;
+  double bandwidth;  // GB/s with 'reps' copies in flight
+  double latency;    // us per copy, one at a time
+};
+
+// roughly cubic bounds covering about 'elements' points
+template <int N>
+static Rect<N> make_bounds(size_t elements)
+{
+  Rect<N> r;
+  size_t remaining = elements;
+  for(int i = 0; i < N; i++) {
+    size_t extent = size_t(floor(pow(double(remaining), 1.0 / (N - i)) + 0.5));
+    if(extent < 1) extent = 1;
+    r.lo[i] = 0;
+    r.hi[i] = extent - 1;
+    remaining /= extent;
+    if(remaining < 1) remaining = 1;
+  }
+  return r;
+}
+
+#ifdef USE_HDF
+template <int N>
+static void create_hdf5_file(const std::string& file_name, const Rect<N>& bounds,
+			     const std::vector<std::string>& datasets)
+{
+  hsize_t dims[N];
+  // HDF5 is row-major, so the fastest-varying Realm dimension comes last
+  for(int i = 0; i < N; i++)
+    dims[N - 1 - i] = bounds.hi[i] - bounds.lo[i] + 1;
+
+  hid_t file_id = H5Fcreate(file_name.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  assert(file_id >= 0);
+  hid_t dataspace_id = H5Screate_simple(N, dims, NULL);
+  for(std::vector<std::string>::const_iterator it = datasets.begin();
+      it != datasets.end();
+      ++it) {
+    hid_t dataset = H5Dcreate2(file_id, it->c_str(), H5T_IEEE_F64LE, dataspace_id,
+			       H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    assert(dataset >= 0);
+    H5Dclose(dataset);
+  }
+  H5Sclose(dataspace_id);
+  H5Fclose(file_id);
+}
+#endif
+
+template <int N>
+static RegionInstance create_endpoint_instance(const Endpoint& ep,
+					       const Rect<N>& bounds,
+					       int fields, const char *tag)
+{
+  IndexSpace<N> is(bounds);
+  std::vector<FieldID> field_ids;
+  std::vector<size_t> field_sizes;
+  std::map<FieldID, size_t> field_map;
+  for(int i = 0; i < fields; i++) {
+    field_ids.push_back(i);
+    field_sizes.push_back(sizeof(FieldType));
+    field_map[i] = sizeof(FieldType);
+  }
+
+  RegionInstance inst;
+  switch(ep.type) {
+  case Endpoint::MEMORY:
+    {
+      RegionInstance::create_instance(inst, ep.mem, is, field_map,
+				      0 /*SOA*/, ProfilingRequestSet()).wait();
+      break;
+    }
+
+  case Endpoint::FILE:
+    {
+      std::string file_name = TestConfig::file_prefix + "_" + tag + ".dat";
+      RegionInstance::create_file_instance(inst, file_name.c_str(), is,
+					   field_ids, field_sizes,
+					   LEGION_FILE_CREATE,
+					   ProfilingRequestSet()).wait();
+      break;
+    }
+
+#ifdef USE_HDF
+  case Endpoint::HDF5:
+    {
+      std::string file_name = TestConfig::file_prefix + "_" + tag + ".h5";
+      std::vector<std::string> datasets;
+      for(int i = 0; i < fields; i++) {
+	char name[16];
+	snprintf(name, sizeof(name), "f%d", i);
+	datasets.push_back(name);
+      }
+      create_hdf5_file<N>(file_name, bounds, datasets);
+      std::vector<const char *> field_files;
+      for(int i = 0; i < fields; i++)
+	field_files.push_back(datasets[i].c_str());
+      RegionInstance::create_hdf5_instance(inst, file_name.c_str(), is,
+					   field_ids, field_sizes, field_files,
+					   false /*!read_only*/,
+					   ProfilingRequestSet()).wait();
+      break;
+    }
+#endif
+
+  default:
+    assert(0);
+  }
+  assert(inst.exists());
+  return inst;
+}
+
+template <int N>
+static Result measure_copy(const std::vector<Endpoint>& endpoints,
+			   int src, int dst, int fields, size_t bytes)
+{
+  Rect<N> bounds = make_bounds<N>(bytes / (fields * sizeof(FieldType)));
+  IndexSpace<N> is(bounds);
+  size_t actual_bytes = is.volume() * fields * sizeof(FieldType);
+
+  RegionInstance src_inst = create_endpoint_instance<N>(endpoints[src], bounds,
+							fields, "src");
+  RegionInstance dst_inst = create_endpoint_instance<N>(endpoints[dst], bounds,
+							fields, "dst");
+
+  std::vector<CopySrcDstField> srcs(fields), dsts(fields);
+  for(int i = 0; i < fields; i++) {
+    srcs[i].inst = src_inst;
+    srcs[i].field_id = i;
+    srcs[i].size = sizeof(FieldType);
+    dsts[i].inst = dst_inst;
+    dsts[i].field_id = i;
+    dsts[i].size = sizeof(FieldType);
+  }
+
+  // fill the source and do one copy to fault in both sides
+  FieldType fill_value = 1.0;
+  for(int i = 0; i < fields; i++)
+    is.fill(std::vector<CopySrcDstField>(1, srcs[i]), ProfilingRequestSet(),
+	    &fill_value, sizeof(fill_value)).wait();
+  is.copy(srcs, dsts, ProfilingRequestSet()).wait();
+
+  // latency: one copy at a time
+  long long t1 = Clock::current_time_in_microseconds();
+  for(int j = 0; j < TestConfig::reps; j++)
+    is.copy(srcs, dsts, ProfilingRequestSet()).wait();
+  long long t2 = Clock::current_time_in_microseconds();
+
+  // bandwidth: all copies in flight together (they all write the same data)
+  std::set<Event> events;
+  for(int j = 0; j < TestConfig::reps; j++)
+    events.insert(is.copy(srcs, dsts, ProfilingRequestSet()));
+  Event::merge_events(events).wait();
+  long long t3 = Clock::current_time_in_microseconds();
+
+  src_inst.destroy();
+  dst_inst.destroy();
+
+  Result r;
+  r.src = src;
+  r.dst = dst;
+  r.dim = N;
+  r.fields = fields;
+  r.bytes = actual_bytes;
+  r.latency = double(t2 - t1) / TestConfig::reps;
+  r.bandwidth = 1e-3 * actual_bytes * TestConfig::reps / double(t3 - t2);
+  return r;
+}
+
+static bool fits(const Endpoint& ep, size_t bytes, bool both_sides)
+{
+  if(ep.type != Endpoint::MEMORY)
+    return true;
+  // leave some room for alignment and other users
+  size_t needed = (both_sides ? 2 : 1) * bytes;
+  return (ep.mem.capacity() >= needed + (needed >> 3));
+}
+
+static void print_matrices(const std::vector<Endpoint>& endpoints,
+			   const std::vector<Result>& results)
+{
+  // one bandwidth matrix and one latency matrix per (dim, fields, bytes)
+  std::map<std::pair<std::pair<int, int>, size_t>, std::vector<const Result *> > groups;
+  for(std::vector<Result>::const_iterator it = results.begin();
+      it != results.end();
+      ++it)
+    groups[std::make_pair(std::make_pair(it->dim, it->fields), it->bytes)].push_back(&*it);
+
+  for(std::map<std::pair<std::pair<int, int>, size_t>, std::vector<const Result *> >::const_iterator it = groups.begin();
+      it != groups.end();
+      ++it) {
+    std::map<std::pair<int, int>, const Result *> cells;
+    for(std::vector<const Result *>::const_iterator it2 = it->second.begin();
+	it2 != it->second.end();
+	++it2)
+      cells[std::make_pair((*it2)->src, (*it2)->dst)] = *it2;
+
+    for(int which = 0; which < 2; which++) {
+      log_app.print() << ((which == 0) ? "bandwidth (GB/s)" : "latency (us)")
+		      << ": dim=" << it->first.first.first
+		      << " fields=" << it->first.first.second
+		      << " bytes=" << it->first.second;
+      char buffer[32];
+      std::string line = stringbuilder() << "  " << std::string(24, ' ');
+      for(size_t d = 0; d < endpoints.size(); d++) {
+	snprintf(buffer, sizeof(buffer), " %10.10s", endpoints[d].name.c_str());
+	line += buffer;
+      }
+      log_app.print() << line;
+      for(size_t s = 0; s < endpoints.size(); s++) {
+	snprintf(buffer, sizeof(buffer), "  %-24.24s", endpoints[s].name.c_str());
+	line = buffer;
+	for(size_t d = 0; d < endpoints.size(); d++) {
+	  std::map<std::pair<int, int>, const Result *>::const_iterator it2 = cells.find(std::make_pair(int(s), int(d)));
+	  if(it2 == cells.end())
+	    snprintf(buffer, sizeof(buffer), " %10s", "-");
+	  else
+	    snprintf(buffer, sizeof(buffer), " %10.3f",
+		     (which == 0) ? it2->second->bandwidth : it2->second->latency);
+	  line += buffer;
+	}
+	log_app.print() << line;
+      }
+    }
+  }
+}
+
+static void write_csv(const std::vector<Endpoint>& endpoints,
+		      const std::vector<Result>& results)
+{
+  // one row per measurement, suitable for fitting channel cost models
+  FILE *f = fopen(TestConfig::csv_file.c_str(), "w");
+  if(!f) {
+    log_app.error() << "could not open " << TestConfig::csv_file;
+    return;
+  }
+  fprintf(f, "src,dst,dim,fields,bytes,bandwidth_gbs,latency_us\n");
+  for(std::vector<Result>::const_iterator it = results.begin();
+      it != results.end();
+      ++it)
+    fprintf(f, "%s,%s,%d,%d,%zd,%g,%g\n",
+	    endpoints[it->src].name.c_str(), endpoints[it->dst].name.c_str(),
+	    it->dim, it->fields, it->bytes, it->bandwidth, it->latency);
+  fclose(f);
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  // gather the endpoints - intermediate buffer memories are internal to the
+  //  DMA system, and file/HDF memories are reached through file instances
+  std::vector<Endpoint> endpoints;
+  Machine machine = Machine::get_machine();
+  for(Machine::MemoryQuery::iterator it = Machine::MemoryQuery(machine).begin(); it; ++it) {
+    Memory m = *it;
+    if(ID(m).is_ib_memory())
+      continue;
+    if((m.kind() == Memory::FILE_MEM) || (m.kind() == Memory::HDF_MEM))
+      continue;
+    if(!TestConfig::remote && (m.address_space() != p.address_space()))
+      continue;
+    Endpoint ep;
+    ep.type = Endpoint::MEMORY;
+    ep.mem = m;
+    ep.name = stringbuilder() << m.kind() << "/" << m;
+    endpoints.push_back(ep);
+  }
+  if(!TestConfig::no_files) {
+    Endpoint ep;
+    ep.type = Endpoint::FILE;
+    ep.name = "file";
+    endpoints.push_back(ep);
+#ifdef USE_HDF
+    ep.type = Endpoint::HDF5;
+    ep.name = "hdf5";
+    endpoints.push_back(ep);
+#endif
+  }
+
+  for(size_t i = 0; i < endpoints.size(); i++)
+    log_app.print() << "endpoint " << i << ": " << endpoints[i].name;
+
+  std::vector<Result> results;
+  for(size_t bytes = TestConfig::min_size; bytes <= TestConfig::max_size; bytes <<= 2)
+    for(int dim = 1; dim <= TestConfig::max_dim; dim++)
+      for(int fields = 1; fields <= TestConfig::max_fields; fields <<= 1)
+	for(size_t s = 0; s < endpoints.size(); s++)
+	  for(size_t d = 0; d < endpoints.size(); d++) {
+	    // file-to-file copies don't exercise anything new
+	    if((endpoints[s].type != Endpoint::MEMORY) &&
+	       (endpoints[d].type != Endpoint::MEMORY))
+	      continue;
+	    if(!fits(endpoints[s], bytes, (s == d)) || !fits(endpoints[d], bytes, (s == d))) {
+	      log_app.info() << "skipping " << endpoints[s].name << " -> "
+			     << endpoints[d].name << " for " << bytes
+			     << " bytes - insufficient capacity";
+	      continue;
+	    }
+
+	    Result r;
+	    switch(dim) {
+	    case 1: r = measure_copy<1>(endpoints, s, d, fields, bytes); break;
+	    case 2: r = measure_copy<2>(endpoints, s, d, fields, bytes); break;
+	    case 3: r = measure_copy<3>(endpoints, s, d, fields, bytes); break;
+	    default: assert(0);
+	    }
+	    log_app.info() << "copy " << endpoints[s].name << " -> " << endpoints[d].name
+			   << ": dim=" << dim << " fields=" << fields
+			   << " bytes=" << r.bytes << " bw=" << r.bandwidth
+			   << " GB/s lat=" << r.latency << " us";
+	    results.push_back(r);
+	  }
+
+  print_matrices(endpoints, results);
+
+  if(!TestConfig::csv_file.empty())
+    write_csv(endpoints, results);
+}
+
+int main(int argc, char **argv)
+{
+  Runtime r;
+
+  bool ok = r.init(&argc, &argv);
+  assert(ok);
+
+  CommandLineParser cp;
+  cp.add_option_int("-minsize", TestConfig::min_size)
+    .add_option_int("-maxsize", TestConfig::max_size)
+    .add_option_int("-dims", TestConfig::max_dim)
+    .add_option_int("-fields", TestConfig::max_fields)
+    .add_option_int("-reps", TestConfig::reps)
+    .add_option_bool("-remote", TestConfig::remote)
+    .add_option_bool("-nofiles", TestConfig::no_files)
+    .add_option_string("-prefix", TestConfig::file_prefix)
+    .add_option_string("-csv", TestConfig::csv_file);
+  ok = cp.parse_command_line(argc, (const char **)argv);
+  assert(ok);
+  assert((TestConfig::max_dim >= 1) && (TestConfig::max_dim <= 3));
+
+  r.register_task(TOP_LEVEL_TASK, top_level_task);
+
+  // select a processor to run the top level task on
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = r.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  r.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  r.wait_for_shutdown();
+
+  return 0;
+}
@@ -0,0 +1,241 @@
+#!/usr/bin/env python
+
+# Copyright 2017 Stanford University
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+###
+### Runs the Realm microbenchmarks over a sweep of thread counts, node
+### counts and message sizes and reports percentiles as JSON
+###
+
+from __future__ import print_function
+
+import argparse, datetime, itertools, json, os, re, socket, subprocess, sys
+
+root_dir = os.path.realpath(
+    os.path.join(os.path.dirname(os.path.realpath(__file__)), '..', '..', '..'))
+
+class Metric(object):
+    __slots__ = ['name', 'pattern', 'unit']
+    def __init__(self, name, pattern, unit):
+        # a pattern with two groups names the metric with the first group
+        #  (e.g. one per reduction variant) and captures the value with the
+        #  second
+        self.name = name
+        self.pattern = re.compile(pattern, re.MULTILINE)
+        self.unit = unit
+    def extract(self, output):
+        values = {}
+        for match in self.pattern.finditer(output):
+            if self.pattern.groups == 2:
+                name = '%s_%s' % (self.name, re.sub(r'\W+', '_', match.group(1)))
+                value = match.group(2)
+            else:
+                name = self.name
+                value = match.group(1)
+            values.setdefault(name, []).append(float(value))
+        return values
+
+class Benchmark(object):
+    __slots__ = ['name', 'path', 'args', 'size_flag', 'metrics']
+    def __init__(self, name, path, args, size_flag, metrics):
+        self.name = name
+        self.path = path            # binary, relative to the repository root
+        self.args = args
+        self.size_flag = size_flag  # flag that takes the swept size (if any)
+        self.metrics = metrics
+
+benchmarks = [
+    Benchmark('dma_matrix',
+              'test/performance/realm/dma_matrix/dma_matrix', ['-level', 'app=2'], None,
+              [Metric('bw_gbs', r'copy (\S+ -> \S+: dim=\d+ fields=\d+ bytes=\d+) bw=(\S+) GB/s', 'GB/s'),
+               Metric('lat_us', r'copy (\S+ -> \S+: dim=\d+ fields=\d+ bytes=\d+) bw=\S+ GB/s lat=(\S+) us', 'us')]),
+    Benchmark('event_latency',
+              'test/performance/realm/event_latency/event_latency', [], None,
+              [Metric('trigger_us', r'^Average trigger time:\s*(\S+) us', 'us')]),
+    Benchmark('event_throughput',
+              'test/performance/realm/event_throughput/event_throughput', [], None,
+              [Metric('events_kps', r'^Events throughput:\s*(\S+) Thousands/s', 'K/s'),
+               Metric('triggers_kps', r'^Triggers throughput:\s*(\S+) Thousands/s', 'K/s')]),
+    Benchmark('lock_chains',
+              'test/performance/realm/lock_chains/lock_chains', [], None,
+              [Metric('grants_kps', r'^Reservation Grants/s \(in Thousands\):\s*(\S+)', 'K/s')]),
+    Benchmark('lock_contention',
+              'test/performance/realm/lock_contention/lock_contention', [], None,
+              [Metric('grants_kps', r'^Reservation Grants/s \(in Thousands\):\s*(\S+)', 'K/s')]),
+    Benchmark('reducetest',
+              'test/performance/realm/reducetest/reducetest', ['-batches', '64'], '-bsize',
+              [Metric('elapsed_s', r'^ELAPSED\((.*)\) = (\S+)', 's')]),
+    Benchmark('task_throughput',
+              'test/performance/realm/task_throughput/task_throughput', [], '-args',
+              [Metric('task_us', r'tasks complete on \S+: (\S+) us/task', 'us'),
+               Metric('spawn_tps', r'spawn rate on \S+: (\S+) tasks/s', 'tasks/s')]),
+    # memspeed's bandwidth lines are at info level, and its copy test covers
+    #  the DMA path
+    Benchmark('memspeed',
+              'test/realm/memspeed', ['-level', 'app=2'], '-b',
+              [Metric('seqwr_gbs', r'seqwr:(\S+)', 'GB/s'),
+               Metric('seqrd_gbs', r'seqrd:(\S+)', 'GB/s'),
+               Metric('rndwr_gbs', r'rndwr:(\S+)', 'GB/s'),
+               Metric('rndrd_gbs', r'rndrd:(\S+)', 'GB/s'),
+               Metric('latency_ns', r'latency:(\S+)', 'ns'),
+               Metric('copy_gbs', r'copy within \S+: (\S+) GB/s', 'GB/s')]),
+]
+
+def percentile(sorted_values, pct):
+    # linear interpolation between the closest ranks
+    if len(sorted_values) == 1:
+        return sorted_values[0]
+    pos = (len(sorted_values) - 1) * pct / 100.0
+    lo = int(pos)
+    hi = min(lo + 1, len(sorted_values) - 1)
+    return sorted_values[lo] + (sorted_values[hi] - sorted_values[lo]) * (pos - lo)
+
+def summarize(samples):
+    values = sorted(samples)
+    return {
+        'count': len(values),
+        'min': values[0],
+        'max': values[-1],
+        'mean': sum(values) / len(values),
+        'p50': percentile(values, 50),
+        'p90': percentile(values, 90),
+        'p99': percentile(values, 99),
+    }
+
+def git_output(*args):
+    try:
+        return subprocess.check_output(['git'] + list(args), cwd=root_dir).decode().strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+def get_metadata():
+    # same fields (and environment overrides) as test.py's perf runs
+    return {
+        'host': os.environ.get('CI_RUNNER_DESCRIPTION', socket.gethostname()),
+        'commit': os.environ.get('CI_BUILD_REF', git_output('rev-parse', 'HEAD')),
+        'branch': os.environ.get('CI_BUILD_REF_NAME',
+                                 git_output('rev-parse', '--abbrev-ref', 'HEAD')),
+        'date': datetime.datetime.now().isoformat(),
+    }
+
+def run_config(bench, launcher, threads, nodes, size, repeat, extra_args, verbose):
+    argv = [os.path.join(root_dir, bench.path)] + bench.args + extra_args
+    argv += ['-ll:cpu', str(threads)]
+    if size is not None:
+        argv += [bench.size_flag, str(size)]
+    command = [x.format(nodes=nodes) for x in launcher] + argv
+
+    samples = {}
+    for _ in range(repeat):
+        if verbose:
+            print(' '.join(command), file=sys.stderr)
+        output = subprocess.check_output(command, stderr=subprocess.STDOUT).decode()
+        found = False
+        for metric in bench.metrics:
+            for name, values in metric.extract(output).items():
+                samples.setdefault(name, (metric.unit, []))[1].extend(values)
+                found = True
+        if not found:
+            raise Exception('%s produced no measurements:\n%s' % (bench.name, output))
+
+    metrics = {}
+    for name, (unit, values) in samples.items():
+        metrics[name] = summarize(values)
+        metrics[name]['unit'] = unit
+    return {
+        'benchmark': bench.name,
+        'params': {'threads': threads, 'nodes': nodes, 'size': size},
+        'argv': argv[1:],
+        'metrics': metrics,
+    }
+
+def perf_result(metadata, result):
+    # one result in the format perf.py uploads and tools/perf_chart.py reads,
+    #  with the percentiles flattened into individual measurements
+    meta = dict(metadata)
+    meta['benchmark'] = 'realm_%s' % result['benchmark']
+    meta['argv'] = result['argv']
+    measurements = dict(('%s_%s' % (name, stat), value)
+                        for name, stats in result['metrics'].items()
+                        for stat, value in stats.items()
+                        if stat not in ('count', 'unit'))
+    measurements.update(result['params'])
+    return {'metadata': meta, 'measurements': measurements}
+
+def parse_list(value):
+    return [int(x) for x in value.split(',')]
+
+def driver():
+    parser = argparse.ArgumentParser(
+        description='Run Realm microbenchmarks and report JSON results')
+    parser.add_argument('-b', '--bench', action='append',
+                        choices=[b.name for b in benchmarks],
+                        help='benchmark to run (default: all)')
+    parser.add_argument('-t', '--threads', type=parse_list, default=[1],
+                        help='comma-separated list of -ll:cpu values')
+    parser.add_argument('-n', '--nodes', type=parse_list, default=[1],
+                        help='comma-separated list of node counts')
+    parser.add_argument('-s', '--sizes', type=parse_list, default=[None],
+                        help='comma-separated list of message/buffer sizes '
+                             '(only used by benchmarks that take one)')
+    parser.add_argument('-r', '--repeat', type=int, default=5,
+                        help='runs per configuration')
+    parser.add_argument('-l', '--launcher', default=os.environ.get('LAUNCHER', ''),
+                        help='launch command, with {nodes} replaced by the '
+                             'node count (e.g. "mpirun -n {nodes} -npernode 1")')
+    parser.add_argument('-o', '--output', help='JSON output file (default: stdout)')
+    parser.add_argument('--perf-dir',
+                        help='also write one perf.py-style result per '
+                             'configuration to PERF_DIR/measurements/<benchmark>/')
+    parser.add_argument('-v', '--verbose', action='store_true')
+    parser.add_argument('extra_args', nargs=argparse.REMAINDER,
+                        help='additional arguments passed to every benchmark')
+    args = parser.parse_args()
+
+    launcher = args.launcher.split()
+    if max(args.nodes) > 1 and not any('{nodes}' in x for x in launcher):
+        parser.error('multi-node runs need a launcher that uses {nodes}')
+    extra_args = args.extra_args[1:] if args.extra_args[:1] == ['--'] else args.extra_args
+
+    selected = [b for b in benchmarks if not args.bench or b.name in args.bench]
+    metadata = get_metadata()
+    results = []
+    for bench in selected:
+        sizes = args.sizes if bench.size_flag else [None]
+        for threads, nodes, size in itertools.product(args.threads, args.nodes, sizes):
+            results.append(run_config(bench, launcher, threads, nodes, size,
+                                      args.repeat, extra_args, args.verbose))
+
+    content = json.dumps({'metadata': metadata, 'results': results},
+                         indent=2, sort_keys=True)
+    if args.output:
+        with open(args.output, 'w') as f:
+            f.write(content + '\n')
+    else:
+        print(content)
+
+    if args.perf_dir:
+        for i, result in enumerate(results):
+            value = perf_result(metadata, result)
+            path = os.path.join(args.perf_dir, 'measurements',
+                                value['metadata']['benchmark'])
+            if not os.path.exists(path):
+                os.makedirs(path)
+            with open(os.path.join(path, '%s_%d.json' % (metadata['date'], i)), 'w') as f:
+                json.dump(value, f, sort_keys=True)
+
+if __name__ == '__main__':
+    driver()
@@ -0,0 +1,207 @@
+#include "realm.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <csignal>
+
+#include <unistd.h>
+
+using namespace Realm;
+
+// Task IDs, some IDs are reserved so start at first available number
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+  CONTINUED_TASK,
+  CHILD_TASK,
+};
+
+enum {
+  TEST_RESUME,
+  TEST_POISONED,
+  TEST_CANCELLED,
+  NUM_TESTS
+};
+
+// we're going to use alarm() as a watchdog to detect deadlocks
+void sigalrm_handler(int sig)
+{
+  fprintf(stderr, "HELP!  Alarm triggered - likely deadlock!\n");
+  exit(1);
+}
+
+// the first invocation of a continued task waits on 'gate' (controlled by
+//  the top-level task) and triggers 'started' once it's done, and each
+//  later one waits on a child task it spawns
+struct ContinuedTaskArgs {
+  int test;
+  int step;
+  int num_steps;
+  UserEvent gate;
+  UserEvent started;
+};
+
+int steps_run[NUM_TESTS];
+int children_run[NUM_TESTS];
+int errors = 0;
+
+void child_task(const void *args, size_t arglen,
+		const void *userdata, size_t userlen, Processor p)
+{
+  assert(arglen == sizeof(int));
+  int test = *(const int *)args;
+  __sync_fetch_and_add(&children_run[test], 1);
+}
+
+void continued_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  assert(arglen == sizeof(ContinuedTaskArgs));
+  const ContinuedTaskArgs& c_args = *(const ContinuedTaskArgs *)args;
+
+  // every invocation after the second was resumed by the child spawned by
+  //  the previous one, so that child must have run
+  if((c_args.step > 1) && (children_run[c_args.test] != (c_args.step - 1))) {
+    printf("ERROR: test %d step %d resumed with %d children run\n",
+	   c_args.test, c_args.step, children_run[c_args.test]);
+    __sync_fetch_and_add(&errors, 1);
+  }
+
+  if(c_args.step < c_args.num_steps) {
+    ContinuedTaskArgs next = c_args;
+    next.step++;
+    Event wait_on;
+    if(c_args.step == 0)
+      wait_on = c_args.gate;
+    else
+      wait_on = p.spawn(CHILD_TASK, &c_args.test, sizeof(int));
+    Processor::continue_task_after(wait_on, &next, sizeof(next));
+  }
+
+  __sync_fetch_and_add(&steps_run[c_args.test], 1);
+
+  if(c_args.step == 0)
+    c_args.started.trigger();
+}
+
+// starts a continued task and waits for its first invocation to finish
+static Event start_test(Processor p, int test, UserEvent gate)
+{
+  ContinuedTaskArgs c_args;
+  c_args.test = test;
+  c_args.step = 0;
+  c_args.num_steps = 4;
+  c_args.gate = gate;
+  c_args.started = UserEvent::create_user_event();
+  Event e = p.spawn(CONTINUED_TASK, &c_args, sizeof(c_args));
+
+  c_args.started.wait();
+  // give it a chance to actually suspend after returning (if it's running
+  //  on another processor)
+  usleep(100000);
+  return e;
+}
+
+static void check_test(int test, Event finish, bool exp_poisoned, int exp_steps)
+{
+  bool poisoned = false;
+  finish.wait_faultaware(poisoned);
+  if(poisoned != exp_poisoned) {
+    printf("ERROR: test %d finish event %s poisoned\n",
+	   test, (poisoned ? "was" : "was not"));
+    errors++;
+  }
+  if(steps_run[test] != exp_steps) {
+    printf("ERROR: test %d ran %d steps, expected %d\n",
+	   test, steps_run[test], exp_steps);
+    errors++;
+  }
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  for(int i = 0; i < NUM_TESTS; i++)
+    steps_run[i] = children_run[i] = 0;
+
+  // use a different processor for the continued tasks if we can
+  Processor target = p;
+  Machine::ProcessorQuery pq(Machine::get_machine());
+  pq.only_kind(Processor::LOC_PROC).local_address_space();
+  for(Machine::ProcessorQuery::iterator it = pq.begin(); it; ++it)
+    if(*it != p) {
+      target = *it;
+      break;
+    }
+
+  // a suspended task is not finished, and runs every step once resumed
+  {
+    UserEvent gate = UserEvent::create_user_event();
+    Event e = start_test(target, TEST_RESUME, gate);
+    if(e.has_triggered()) {
+      printf("ERROR: suspended task's finish event has triggered\n");
+      errors++;
+    }
+    gate.trigger();
+    check_test(TEST_RESUME, e, false /*!poisoned*/, 5);
+    printf("resume test done\n");
+  }
+
+  // a poisoned wait terminates the task without resuming it
+  {
+    UserEvent gate = UserEvent::create_user_event();
+    Event e = start_test(target, TEST_POISONED, gate);
+    gate.cancel();
+    check_test(TEST_POISONED, e, true /*poisoned*/, 1);
+    printf("poisoned test done\n");
+  }
+
+  // a task cancelled while suspended is terminated when it would resume
+  {
+    UserEvent gate = UserEvent::create_user_event();
+    Event e = start_test(target, TEST_CANCELLED, gate);
+    e.cancel_operation(0, 0);
+    gate.trigger();
+    check_test(TEST_CANCELLED, e, true /*poisoned*/, 1);
+    printf("cancelled test done\n");
+  }
+
+  if(errors) {
+    printf("Exiting with %d errors.\n", errors);
+    exit(1);
+  }
+
+  printf("done!\n");
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+  rt.register_task(CONTINUED_TASK, continued_task);
+  rt.register_task(CHILD_TASK, child_task);
+
+  signal(SIGALRM, sigalrm_handler);
+
+  // select a processor to run the top level task on
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  rt.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  alarm(60);
+  rt.wait_for_shutdown();
+
+  return 0;
+}
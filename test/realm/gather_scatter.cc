@@ -0,0 +1,150 @@
+#include "realm.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+
+using namespace Realm;
+
+Logger log_app("app");
+
+// Task IDs, some IDs are reserved so start at first available number
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+};
+
+// the index field is a permutation made of runs of BLOCK_SIZE consecutive
+//  points (in reverse block order), so that both the chunk coalescing and
+//  the breaks between chunks get exercised
+static const int NUM_POINTS = 1000;
+static const int BLOCK_SIZE = 10;
+
+static int permuted(int i)
+{
+  int num_blocks = NUM_POINTS / BLOCK_SIZE;
+  return ((num_blocks - 1 - (i / BLOCK_SIZE)) * BLOCK_SIZE) + (i % BLOCK_SIZE);
+}
+
+static RegionInstance make_instance(Memory m, IndexSpace<1> is, size_t field_size)
+{
+  RegionInstance inst;
+  RegionInstance::create_instance(inst, m, is,
+				  std::vector<size_t>(1, field_size),
+				  0 /*SOA*/,
+				  ProfilingRequestSet()).wait();
+  assert(inst.exists());
+  return inst;
+}
+
+static CopySrcDstField make_field(RegionInstance inst, size_t field_size)
+{
+  CopySrcDstField f;
+  f.inst = inst;
+  f.field_id = 0;
+  f.size = field_size;
+  return f;
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  int errors = 0;
+
+  // everything lives in a CPU-visible memory near us, since the index
+  //  instance has to be directly accessible
+  Memory m = Machine::MemoryQuery(Machine::get_machine())
+    .has_affinity_to(p).only_kind(Memory::SYSTEM_MEM).first();
+  assert(m.exists());
+
+  IndexSpace<1> is(Rect<1>(0, NUM_POINTS - 1));
+
+  RegionInstance idx_inst = make_instance(m, is, sizeof(Point<1>));
+  RegionInstance data_inst = make_instance(m, is, sizeof(int));
+  RegionInstance gathered_inst = make_instance(m, is, sizeof(int));
+  RegionInstance scattered_inst = make_instance(m, is, sizeof(int));
+
+  {
+    AffineAccessor<Point<1>,1> idx_acc(idx_inst, 0);
+    AffineAccessor<int,1> data_acc(data_inst, 0);
+    for(int i = 0; i < NUM_POINTS; i++) {
+      idx_acc[i] = Point<1>(permuted(i));
+      data_acc[i] = 3 * i + 1;
+    }
+  }
+
+  CopySrcDstField idx_field = make_field(idx_inst, sizeof(Point<1>));
+
+  // gather: gathered[i] = data[idx[i]]
+  {
+    std::vector<CopySrcDstField> srcs(1, make_field(data_inst, sizeof(int)));
+    std::vector<CopySrcDstField> dsts(1, make_field(gathered_inst, sizeof(int)));
+    is.gather(is, idx_field, srcs, dsts, ProfilingRequestSet()).wait();
+
+    AffineAccessor<int,1> acc(gathered_inst, 0);
+    for(int i = 0; i < NUM_POINTS; i++) {
+      int exp = 3 * permuted(i) + 1;
+      if(acc[i] != exp) {
+	if(errors < 10)
+	  log_app.error() << "gather mismatch: point=" << i << " expected=" << exp << " actual=" << acc[i];
+	errors++;
+      }
+    }
+  }
+
+  // scatter: scattered[idx[i]] = data[i]
+  {
+    std::vector<CopySrcDstField> srcs(1, make_field(data_inst, sizeof(int)));
+    std::vector<CopySrcDstField> dsts(1, make_field(scattered_inst, sizeof(int)));
+    is.scatter(is, idx_field, srcs, dsts, ProfilingRequestSet()).wait();
+
+    AffineAccessor<int,1> acc(scattered_inst, 0);
+    for(int i = 0; i < NUM_POINTS; i++) {
+      int exp = 3 * i + 1;
+      int actual = acc[permuted(i)];
+      if(actual != exp) {
+	if(errors < 10)
+	  log_app.error() << "scatter mismatch: point=" << i << " expected=" << exp << " actual=" << actual;
+	errors++;
+      }
+    }
+  }
+
+  idx_inst.destroy();
+  data_inst.destroy();
+  gathered_inst.destroy();
+  scattered_inst.destroy();
+
+  if(errors) {
+    printf("Exiting with %d errors.\n", errors);
+    exit(1);
+  }
+
+  printf("done!\n");
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+
+  // select a processor to run the top level task on
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  rt.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  rt.wait_for_shutdown();
+
+  return 0;
+}
@@ -185,6 +185,29 @@ void memspeed_gpu_task(const void *args, size_t arglen,
 
 std::set<Processor::Kind> supported_proc_kinds;
 
+// times repeated DMA copies from one instance to another and returns the
+//  bandwidth in GB/s
+static double time_copy(IndexSpace<1> d, RegionInstance src, RegionInstance dst)
+{
+  std::vector<CopySrcDstField> srcs(1), dsts(1);
+  srcs[0].inst = src;
+  srcs[0].field_id = 0;
+  srcs[0].size = sizeof(void *);
+  dsts[0].inst = dst;
+  dsts[0].field_id = 0;
+  dsts[0].size = sizeof(void *);
+
+  // first copy faults in the destination
+  d.copy(srcs, dsts, ProfilingRequestSet()).wait();
+
+  int reps = 8;
+  long long t1 = Clock::current_time_in_nanoseconds();
+  for(int j = 0; j < reps; j++)
+    d.copy(srcs, dsts, ProfilingRequestSet()).wait();
+  long long t2 = Clock::current_time_in_nanoseconds();
+  return 1.0 * reps * buffer_size / (t2 - t1);
+}
+
 void top_level_task(const void *args, size_t arglen, 
 		    const void *userdata, size_t userlen, Processor p)
 {
@@ -253,8 +276,58 @@ void top_level_task(const void *args, size_t arglen,
       e.wait();
     }
 
+    // copy test - a second instance in the same memory gives a DMA copy
+    //  whose speed depends only on the memory (and the copy engine's ability
+    //  to use it)
+    if(capacity >= 2 * buffer_size) {
+      RegionInstance inst2;
+      RegionInstance::create_instance(inst2, m, d,
+				      std::vector<size_t>(1, sizeof(void *)),
+				      0 /*SOA*/,
+				      ProfilingRequestSet()).wait();
+      assert(inst2.exists());
+
+      double copy_bw = time_copy(d, inst, inst2);
+      log_app.print() << "  copy within " << m << ": " << copy_bw << " GB/s";
+
+      inst2.destroy();
+    } else
+      log_app.info() << "skipping copy test for memory " << m << " - insufficient capacity";
+
     inst.destroy();
   }
+
+  // cross-socket copy test - with per-socket memories (-ll:nsize), copy
+  //  between every pair of them so the effect of where the copy's memory
+  //  traffic lands shows up
+  std::vector<Memory> socket_mems;
+  Machine::MemoryQuery mq(machine);
+  mq.local_address_space().only_kind(Memory::SOCKET_MEM);
+  for(Machine::MemoryQuery::iterator it = mq.begin(); it; ++it)
+    if((*it).capacity() >= buffer_size)
+      socket_mems.push_back(*it);
+  if(socket_mems.size() > 1) {
+    std::vector<RegionInstance> insts(socket_mems.size());
+    for(size_t i = 0; i < socket_mems.size(); i++) {
+      RegionInstance::create_instance(insts[i], socket_mems[i], d,
+				      std::vector<size_t>(1, sizeof(void *)),
+				      0 /*SOA*/,
+				      ProfilingRequestSet()).wait();
+      assert(insts[i].exists());
+    }
+
+    for(size_t i = 0; i < socket_mems.size(); i++)
+      for(size_t j = 0; j < socket_mems.size(); j++) {
+	if(i == j) continue;
+	double copy_bw = time_copy(d, insts[i], insts[j]);
+	log_app.print() << "  copy from " << socket_mems[i] << " to " << socket_mems[j]
+			<< ": " << copy_bw << " GB/s";
+      }
+
+    for(size_t i = 0; i < socket_mems.size(); i++)
+      insts[i].destroy();
+  } else
+    log_app.info() << "skipping cross-socket copy test - fewer than two socket memories";
 }
 
 int main(int argc, char **argv)
@@ -0,0 +1,150 @@
+#include "realm.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+#include <cstring>
+#include <csignal>
+#include <vector>
+#include <set>
+
+#include <unistd.h>
+
+using namespace Realm;
+
+// Task IDs, some IDs are reserved so start at first available number
+enum {
+  TOP_LEVEL_TASK = Processor::TASK_ID_FIRST_AVAILABLE+0,
+  WORKER_TASK,
+};
+
+// every CPU in the machine hammers on the same reservation with a mix of
+//  shared and exclusive acquires, so shared leases get handed to other nodes
+//  and revoked from them while grants are still in flight
+static const unsigned SHARED_MODE = 1;
+static const int NUM_ITERS = 200;
+
+// we're going to use alarm() as a watchdog to detect deadlocks
+void sigalrm_handler(int sig)
+{
+  fprintf(stderr, "HELP!  Alarm triggered - likely deadlock!\n");
+  exit(1);
+}
+
+struct WorkerTaskArgs {
+  Reservation rsrv;
+  int index;
+};
+
+// per-process counts of current holders - the reservation has to keep
+//  exclusive holders away from everybody else
+static int shared_holders = 0;
+static int excl_holders = 0;
+
+void worker_task(const void *args, size_t arglen,
+		 const void *userdata, size_t userlen, Processor p)
+{
+  assert(arglen == sizeof(WorkerTaskArgs));
+  const WorkerTaskArgs& w_args = *(const WorkerTaskArgs *)args;
+
+  int errors = 0;
+  for(int i = 0; i < NUM_ITERS; i++) {
+    bool exclusive = (((i + w_args.index) % 4) == 0);
+
+    w_args.rsrv.acquire(exclusive ? 0 : SHARED_MODE, exclusive).wait();
+
+    if(exclusive) {
+      int e = __sync_add_and_fetch(&excl_holders, 1);
+      int s = __sync_fetch_and_add(&shared_holders, 0);
+      if((e != 1) || (s != 0)) {
+	printf("ERROR: proc " IDFMT " iter %d: exclusive acquire with %d exclusive and %d shared holders\n",
+	       p.id, i, e, s);
+	errors++;
+      }
+    } else {
+      __sync_fetch_and_add(&shared_holders, 1);
+      int e = __sync_fetch_and_add(&excl_holders, 0);
+      if(e != 0) {
+	printf("ERROR: proc " IDFMT " iter %d: shared acquire with %d exclusive holders\n",
+	       p.id, i, e);
+	errors++;
+      }
+    }
+
+    usleep(100);
+
+    if(exclusive)
+      __sync_fetch_and_sub(&excl_holders, 1);
+    else
+      __sync_fetch_and_sub(&shared_holders, 1);
+
+    w_args.rsrv.release();
+  }
+
+  if(errors) {
+    printf("Exiting with %d errors.\n", errors);
+    exit(1);
+  }
+}
+
+void top_level_task(const void *args, size_t arglen,
+		    const void *userdata, size_t userlen, Processor p)
+{
+  std::vector<Processor> all_cpus;
+  {
+    std::set<Processor> all_processors;
+    Machine::get_machine().get_all_processors(all_processors);
+    for(std::set<Processor>::const_iterator it = all_processors.begin();
+	it != all_processors.end();
+	it++)
+      if((*it).kind() == Processor::LOC_PROC)
+	all_cpus.push_back(*it);
+  }
+
+  Reservation rsrv = Reservation::create_reservation();
+
+  std::set<Event> task_events;
+  for(size_t i = 0; i < all_cpus.size(); i++) {
+    WorkerTaskArgs w_args;
+    w_args.rsrv = rsrv;
+    w_args.index = i;
+    task_events.insert(all_cpus[i].spawn(WORKER_TASK, &w_args, sizeof(w_args)));
+  }
+  printf("%zd workers launched\n", task_events.size());
+
+  Event::merge_events(task_events).wait();
+
+  rsrv.destroy_reservation();
+
+  printf("done!\n");
+}
+
+int main(int argc, char **argv)
+{
+  Runtime rt;
+
+  rt.init(&argc, &argv);
+
+  rt.register_task(TOP_LEVEL_TASK, top_level_task);
+  rt.register_task(WORKER_TASK, worker_task);
+
+  signal(SIGALRM, sigalrm_handler);
+
+  // select a processor to run the top level task on
+  Processor p = Machine::ProcessorQuery(Machine::get_machine())
+    .only_kind(Processor::LOC_PROC)
+    .first();
+  assert(p.exists());
+
+  // collective launch of a single task - everybody gets the same finish event
+  Event e = rt.collective_spawn(p, TOP_LEVEL_TASK, 0, 0);
+
+  // request shutdown once that task is complete
+  rt.shutdown(e);
+
+  // now sleep this thread until that shutdown actually happens
+  alarm(60);
+  rt.wait_for_shutdown();
+
+  return 0;
+}
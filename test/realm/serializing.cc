@@ -242,12 +242,75 @@ void test_fixed(const char *name, const T& input, size_t exp_size)
   free(buffer);
 }
 
+template <typename T>
+void test_spanlist(const char *name, const T& input, size_t exp_size)
+{
+  // reference everything we can so that the gather is exercised
+  Realm::Serialization::SpanListSerializer sls(0, 1 /*min_reference_bytes*/);
+
+  bool ok1 = sls << input;
+  if(!ok1) {
+    std::cout << "ERROR: " << name << "spanlist serialization failed!" << std::endl;
+    error_count++;
+  }
+
+  size_t act_size = sls.bytes_used();
+  if(act_size != exp_size) {
+    std::cout << "ERROR: " << name << "spanlist size = " << act_size << " (should be " << exp_size << ")" << std::endl;
+    error_count++;
+  } else {
+    if(verbose)
+      std::cout << "OK: " << name << " spanlist size = " << act_size << std::endl;
+  }
+
+  // gather the spans the way the active message layer would
+  std::vector<std::pair<const void *, size_t> > spans;
+  sls.get_spans(spans);
+  char *buffer = (char *)malloc(act_size);
+  size_t gathered = 0;
+  for(size_t i = 0; i < spans.size(); i++) {
+    assert((gathered + spans[i].second) <= act_size);
+    memcpy(buffer + gathered, spans[i].first, spans[i].second);
+    gathered += spans[i].second;
+  }
+  if(gathered != act_size) {
+    std::cout << "ERROR: " << name << " spanlist gathered = " << gathered << " (should be " << act_size << ")" << std::endl;
+    error_count++;
+  }
+
+  Realm::Serialization::FixedBufferDeserializer fbd(buffer, act_size);
+  T output;
+
+  bool ok2 = fbd >> output;
+  if(!ok2) {
+    std::cout << "ERROR: " << name << " spanlist deserialization failed!" << std::endl;
+    error_count++;
+  }
+
+  ptrdiff_t leftover = fbd.bytes_left();
+  if(leftover != 0) {
+    std::cout << "ERROR: " << name << " spanlist leftover = " << leftover << std::endl;
+    error_count++;
+  }
+
+  if(input == output) {
+    if(verbose)
+      std::cout << "OK: " << name << " spanlist output matches" << std::endl;
+  } else {
+    std::cout << "ERROR: " << name << " spanlist output mismatch" << std::endl;
+    error_count++;
+  }
+
+  free(buffer);
+}
+
 template <typename T>
 void do_test(const char *name, const T& input, size_t exp_size = 0)
 {
   exp_size = test_dynamic(name, input, exp_size);
   test_size(name, input, exp_size);
   test_fixed(name, input, exp_size);
+  test_spanlist(name, input, exp_size);
 }
 
 template <typename T1, typename T2>
@@ -379,6 +442,13 @@ int main(int argc, const char *argv[])
   s.insert(2);
   s.insert(11);
   do_test("set<int>", s, sizeof(size_t) + s.size() * sizeof(int));
+
+  // large enough that a SpanListSerializer references it with the default
+  //  threshold
+  std::vector<int> big(4096);
+  for(size_t i = 0; i < big.size(); i++)
+    big[i] = i * 7;
+  do_test("big vector<int>", big, sizeof(size_t) + big.size() * sizeof(int));
   
   if(error_count > 0) {
     std::cout << "ERRORS FOUND" << std::endl;
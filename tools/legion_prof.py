@@ -20,7 +20,7 @@ import tempfile
 import legion_spy
 import argparse
 import sys, os, shutil
-import string, re, json, heapq, time, itertools
+import string, re, json, heapq, time, itertools, bisect
 from collections import defaultdict
 from math import sqrt, log
 from cgi import escape
@@ -54,6 +54,7 @@ memory_kinds = {
     9 : 'L3 Cache',
     10 : 'L2 Cache',
     11 : 'L1 Cache',
+    12 : 'Managed',
 }
 
 # Make sure this is up to date with legion_types.h
@@ -173,6 +174,46 @@ class PathRange(object):
     def __repr__(self):
         return "(" + str(self.start) + "," + str(self.stop) + ")"
 
+# One piece of work that can sit on the timeline critical path: a task
+# or meta-task is split into one segment per run between its waits
+class CriticalSegment(object):
+    __slots__ = ['item', 'owner', 'ready', 'start', 'stop', 'nested']
+    def __init__(self, item, owner, ready, start, stop):
+        self.item = item
+        self.owner = owner
+        # when the preconditions of this segment triggered
+        self.ready = min(ready, start) if ready is not None else start
+        self.start = start
+        self.stop = stop
+        # mapper and runtime calls run inside another segment on the
+        # same processor
+        self.nested = isinstance(item, (MapperCall, RuntimeCall))
+
+    def category(self):
+        if isinstance(self.item, Task):
+            return 'tasks'
+        if isinstance(self.item, (Copy, Fill, DepPart)):
+            return 'copies'
+        if isinstance(self.item, MapperCall):
+            return 'mapper calls'
+        if isinstance(self.item, RuntimeCall):
+            return 'runtime calls'
+        if isinstance(self.item, (MetaTask, Message)):
+            return 'meta-tasks'
+        return 'profiling'
+
+    def name(self):
+        if isinstance(self.item, Task):
+            task_kind = self.item.variant.task_kind
+            return task_kind.name if task_kind is not None else 'unnamed'
+        if isinstance(self.item, MetaTask):
+            return self.item.variant.name
+        if isinstance(self.item, MapperCall):
+            return 'Mapper Call ' + str(self.item.kind)
+        if isinstance(self.item, ProfTask):
+            return 'ProfTask'
+        return repr(self.item)
+
 class HasDependencies(object):
     def __init__(self):
         self.deps = {"in": set(), "out": set(), "parents": set(), "children" : set()}
@@ -1001,6 +1042,7 @@ class Task(Operation, TimeRange, HasDependencies, HasWaiters):
         self.variant = variant
         self.initiation = ''
         self.is_task = True
+        self.perf_counters = getattr(op, 'perf_counters', None)
 
     def assign_color(self, color):
         assert self.color is None
@@ -1022,6 +1064,12 @@ class Task(Operation, TimeRange, HasDependencies, HasWaiters):
         
     def get_info(self):
         info = '<'+str(self.op_id)+">"
+        if self.perf_counters is not None:
+            (insts, cycles, llc_accesses, llc_misses) = self.perf_counters
+            if insts >= 0 and cycles > 0:
+                info += ' IPC='+('%.2f' % (float(insts) / cycles))
+            if llc_accesses > 0 and llc_misses >= 0:
+                info += ' LLC miss='+('%.1f%%' % (100.0 * llc_misses / llc_accesses))
         return info
 
     def active_time(self):
@@ -1684,6 +1732,9 @@ class State(object):
         self.runtime_call_kinds = {}
         self.runtime_calls = {}
         self.instances = {}
+        # sampling ratios and aggregate statistics from sampled profiles
+        self.samples = {}
+        self.aggregates = {}
         self.has_spy_data = False
         self.spy_state = None
         self.callbacks = {
@@ -1702,6 +1753,7 @@ class State(object):
             "TaskWaitInfo": self.log_task_wait_info,
             "MetaWaitInfo": self.log_meta_wait_info,
             "TaskInfo": self.log_task_info,
+            "TaskPerfInfo": self.log_task_perf_info,
             "MetaInfo": self.log_meta_info,
             "CopyInfo": self.log_copy_info,
             "FillInfo": self.log_fill_info,
@@ -1712,6 +1764,8 @@ class State(object):
             "MessageInfo": self.log_message_info,
             "MapperCallInfo": self.log_mapper_call_info,
             "RuntimeCallInfo": self.log_runtime_call_info,
+            "SampleDesc": self.log_sample_desc,
+            "AggregateInfo": self.log_aggregate_info,
             "ProfTaskInfo": self.log_proftask_info
             #"UserInfo": self.log_user_info
         }
@@ -1725,6 +1779,13 @@ class State(object):
         proc = self.find_processor(proc_id)
         proc.add_task(task)
 
+    def log_task_perf_info(self, op_id, total_insts, total_cycles,
+                           llc_accesses, llc_misses):
+        # may arrive before the task itself, so hang it off the operation
+        op = self.find_op(op_id)
+        op.perf_counters = (total_insts, total_cycles,
+                            llc_accesses, llc_misses)
+
     def log_meta_info(self, op_id, lg_id, proc_id, 
                       create, ready, start, stop):
         op = self.find_op(op_id)
@@ -1918,6 +1979,25 @@ class State(object):
         proc = self.find_processor(proc_id)
         proc.add_runtime_call(call)
 
+    def log_sample_desc(self, kind, interval, total, sampled, name):
+        # sum over all of the nodes
+        if kind in self.samples:
+            _, _, old_total, old_sampled = self.samples[kind]
+            total += old_total
+            sampled += old_sampled
+        self.samples[kind] = (name, interval, total, sampled)
+
+    def log_aggregate_info(self, kind, agg_id, count,
+                           total_time, min_time, max_time):
+        key = (kind, agg_id)
+        if key in self.aggregates:
+            old_count, old_total, old_min, old_max = self.aggregates[key]
+            count += old_count
+            total_time += old_total
+            min_time = min(min_time, old_min)
+            max_time = max(max_time, old_max)
+        self.aggregates[key] = (count, total_time, min_time, max_time)
+
     def log_proftask_info(self, proc_id, op_id, start, stop):
         # we don't have a unique op_id for the profiling task itself, so we don't 
         # add to self.operations
@@ -2081,6 +2161,180 @@ class State(object):
         self.print_memory_stats(verbose)
         self.print_channel_stats(verbose)
         self.print_task_stats(verbose)
+        self.print_sample_stats(verbose)
+
+    def print_sample_stats(self, verbose):
+        if not self.samples and not self.aggregates:
+            return
+        print('****************************************************')
+        print('   SAMPLING')
+        print('****************************************************')
+        for kind, (name, interval, total, sampled) in sorted(self.samples.iteritems()):
+            print('  %s: recorded %d of %d (%.3f%%, 1 in %d requested)' % \
+                    (name, sampled, total,
+                     100.0 * sampled / total if total > 0 else 0.0, interval))
+        print()
+        for (kind, agg_id), (count, total_time, min_time, max_time) in \
+                sorted(self.aggregates.iteritems()):
+            name = self.samples[kind][0] if kind in self.samples else str(kind)
+            if kind == 0 and agg_id in self.variants:
+                name += ' ' + str(self.variants[agg_id])
+            elif kind == 1 and agg_id in self.meta_variants:
+                name += ' ' + str(self.meta_variants[agg_id])
+            elif agg_id != 0:
+                name += ' ' + str(agg_id)
+            print('  %s' % name)
+            print('       Count:   %d' % count)
+            print('       Total:   %d us' % total_time)
+            print('       Average: %.2f us' % (float(total_time) / count))
+            print('       Min:     %d us' % min_time)
+            print('       Max:     %d us' % max_time)
+            print()
+
+    def get_critical_segments(self):
+        segments = list()
+        for proc in self.processors.itervalues():
+            for item in proc.tasks:
+                if isinstance(item, UserMarker):
+                    continue
+                ready = item.ready
+                start = item.start
+                if isinstance(item, HasWaiters):
+                    for wait_interval in item.wait_intervals:
+                        segments.append(CriticalSegment(item, proc, ready, start,
+                                                        wait_interval.start))
+                        ready = wait_interval.ready
+                        start = wait_interval.end
+                segments.append(CriticalSegment(item, proc, ready, start, item.stop))
+        for channel in self.channels.itervalues():
+            for copy in channel.copies:
+                segments.append(CriticalSegment(copy, channel, copy.ready,
+                                                copy.start, copy.stop))
+        return segments
+
+    def compute_timeline_critical_path(self):
+        """
+        Walk backwards from the last piece of work to finish, charging the
+        time before each segment to whatever it was waiting on: the enclosing
+        task for mapper and runtime calls, the segment that was occupying its
+        processor or channel if it was ready but queued, and otherwise the
+        last segment to finish before its preconditions triggered. This only
+        needs profiler timestamps, not Legion Spy dependencies. Returns the
+        path in reverse order as (segment, start, stop) triples along with
+        the time spent between segments on the path.
+        """
+        segments = self.get_critical_segments()
+        if not segments:
+            return [], {}
+        segments.sort(key=lambda s: s.stop)
+        stops = [s.stop for s in segments]
+        owned = defaultdict(list)
+        for segment in segments:
+            if not segment.nested:
+                owned[segment.owner].append(segment)
+        owned_stops = dict((owner, [s.stop for s in owner_segments])
+                           for owner, owner_segments in owned.iteritems())
+
+        def latest_before(candidates, candidate_stops, time, lower=None):
+            index = bisect.bisect_right(candidate_stops, time) - 1
+            while index >= 0:
+                candidate = candidates[index]
+                if lower is not None and candidate.stop <= lower:
+                    return None
+                if id(candidate) not in visited:
+                    return candidate
+                index -= 1
+            return None
+
+        path = list()
+        gaps = defaultdict(int)
+        visited = set()
+        cur = segments[-1]
+        stop = cur.stop
+        while cur is not None:
+            visited.add(id(cur))
+            path.append((cur, cur.start, stop))
+            pred = None
+            if cur.nested:
+                # charge the enclosing segment up to the call
+                for candidate in owned[cur.owner]:
+                    if candidate.start <= cur.start and cur.stop <= candidate.stop \
+                            and id(candidate) not in visited:
+                        if pred is None or candidate.start > pred.start:
+                            pred = candidate
+                if pred is not None:
+                    cur, stop = pred, cur.start
+                    continue
+            if cur.start > cur.ready:
+                # ready but queued behind other work on the same resource
+                pred = latest_before(owned[cur.owner], owned_stops[cur.owner],
+                                     cur.start, cur.ready)
+                if pred is not None:
+                    gaps['scheduling delay'] += cur.start - pred.stop
+                    cur, stop = pred, pred.stop
+                    continue
+                gaps['scheduling delay'] += cur.start - cur.ready
+            pred = latest_before(segments, stops, cur.ready)
+            if pred is not None:
+                gaps['event latency'] += cur.ready - pred.stop
+                stop = pred.stop
+            cur = pred
+        return path, gaps
+
+    def print_critical_path(self, verbose):
+        print('****************************************************')
+        print('   CRITICAL PATH')
+        print('****************************************************')
+        path, gaps = self.compute_timeline_critical_path()
+        if not path:
+            print('No timing records found')
+            return
+        path_start = path[-1][1]
+        path_stop = path[0][2]
+        length = path_stop - path_start
+        print('Critical path: %d us from %d us to %d us (%d segments)' % \
+                (length, path_start, path_stop, len(path)))
+        print()
+        categories = defaultdict(int)
+        names = defaultdict(lambda: [0, 0])
+        for segment, start, stop in path:
+            categories[segment.category()] += stop - start
+            entry = names[(segment.category(), segment.name())]
+            entry[0] += 1
+            entry[1] += stop - start
+        categories.update(gaps)
+
+        def speedup(time, factor):
+            # an upper bound since another path can become critical
+            remaining = length - time * (1.0 - 1.0 / factor)
+            return float(length) / remaining if remaining > 0 else float('inf')
+
+        print('  %-18s %12s %8s %12s %12s' % \
+                ('Category', 'Time (us)', 'Share', 'If 2x faster', 'If free'))
+        for category, time in sorted(categories.iteritems(),
+                                     key=lambda x: x[1], reverse=True):
+            print('  %-18s %12d %7.2f%% %11.3fx %11.3fx' % \
+                    (category, time, 100.0 * time / length if length > 0 else 0.0,
+                     speedup(time, 2.0), speedup(time, float('inf'))))
+        print()
+        print('  Speedups are upper bounds for making everything in the category')
+        print('  2x faster or free, since another path may become critical.')
+        print()
+        print('  Largest contributors:')
+        contributors = sorted(names.iteritems(), key=lambda x: x[1][1], reverse=True)
+        for (category, name), (count, time) in \
+                (contributors if verbose else contributors[:20]):
+            print('  %-18s %12d %7.2f%%  %s (%d segments)' % \
+                    (category, time, 100.0 * time / length if length > 0 else 0.0,
+                     name, count))
+        if verbose:
+            print()
+            print('  Path:')
+            for segment, start, stop in reversed(path):
+                print('  %12d %12d  %-14s %s on %s' % \
+                        (start, stop, segment.category(), repr(segment.item),
+                         repr(segment.owner)))
+        print()
 
     def assign_colors(self):
         # Subtract out some colors for which we have special colors
@@ -2839,6 +3093,10 @@ def main():
     parser.add_argument(
         '-s', '--statistics', dest='print_stats', action='store_true',
         help='print statistics')
+    parser.add_argument(
+        '-c', '--critical-path', dest='print_critical_path', action='store_true',
+        help='print the critical path attributed to tasks, copies, mapper '
+             'calls and meta-tasks, with the speedup bound for each')
     parser.add_argument(
         '-v', '--verbose', dest='verbose', action='store_true',
         help='print verbose profiling information')
@@ -2853,6 +3111,17 @@ def main():
     parser.add_argument(
         '-f', '--force', dest='force', action='store_true',
         help='overwrite output directory if it exists')
+    parser.add_argument(
+        '--start', dest='start', action='store', type=float,
+        help='only load records after this time in us (needs log indexes)')
+    parser.add_argument(
+        '--stop', dest='stop', action='store', type=float,
+        help='only load records before this time in us (needs log indexes)')
+    parser.add_argument(
+        '--procs', dest='procs', action='store',
+        type=lambda s: [int(p, 0) for p in s.split(',')],
+        help='comma-separated processor ids to load records for '
+             '(needs log indexes)')
     parser.add_argument(
         dest='filenames', nargs='+',
         help='input Legion Prof log filenames')
@@ -2868,6 +3137,7 @@ def main():
     output_dirname = args.output
     copy_output_prefix = output_dirname + "_copy"
     print_stats = args.print_stats
+    print_critical_path = args.print_critical_path
     verbose = args.verbose
 
     state = State()
@@ -2875,7 +3145,9 @@ def main():
     has_binary_files = False # true if any of the files are a binary file
 
     asciiDeserializer = LegionProfASCIIDeserializer(state, state.callbacks)
-    binaryDeserializer = LegionProfBinaryDeserializer(state, state.callbacks)
+    binaryDeserializer = LegionProfBinaryDeserializer(state, state.callbacks,
+                                                      args.start, args.stop,
+                                                      args.procs)
 
     for file_name in file_names:
         file_type, version = GetFileTypeInfo(file_name)
@@ -2911,8 +3183,16 @@ def main():
     # Once we are done loading everything, do the sorting
     state.sort_time_ranges()
 
-    if print_stats:
-        state.print_stats(verbose)
+    for kind, (name, interval, total, sampled) in sorted(state.samples.iteritems()):
+        if sampled < total:
+            print('WARNING: Profile is sampled, %s records cover %d of %d '
+                  'operations' % (name, sampled, total))
+
+    if print_stats or print_critical_path:
+        if print_stats:
+            state.print_stats(verbose)
+        if print_critical_path:
+            state.print_critical_path(verbose)
     else:
         state.emit_interactive_visualization(output_dirname, show_procs,
                              file_names, show_channels, show_instances, force)
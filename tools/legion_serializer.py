@@ -21,9 +21,16 @@ import struct
 import legion_spy
 import gzip
 import io
+import os
 
 binary_filetype_pat = re.compile(r"FileType: BinaryLegionProf v: (?P<version>\d+(\.\d+)?)")
 
+# XXX: Make sure these are consistent with legion_profiling_serializer.h!
+PROF_INDEX_MAGIC = 0x4C504958
+PROF_INDEX_VERSION = 1
+PROF_METADATA_CHUNK = 0
+PROF_TIMED_CHUNK = 1
+
 def getFileObj(filename, compressed=False, buffer_size=32768):
     if compressed:
         return io.BufferedReader(gzip.open(filename, mode='rb'), buffer_size=buffer_size)
@@ -77,6 +84,7 @@ class LegionProfASCIIDeserializer(LegionDeserializer):
         "TaskWaitInfo": re.compile(prefix + r'Prof Task Wait Info (?P<op_id>[0-9]+) (?P<variant_id>[0-9]+) (?P<wait_start>[0-9]+) (?P<wait_ready>[0-9]+) (?P<wait_end>[0-9]+)'),
         "MetaWaitInfo": re.compile(prefix + r'Prof Meta Wait Info (?P<op_id>[0-9]+) (?P<lg_id>[0-9]+) (?P<wait_start>[0-9]+) (?P<wait_ready>[0-9]+) (?P<wait_end>[0-9]+)'),
         "TaskInfo": re.compile(prefix + r'Prof Task Info (?P<op_id>[0-9]+) (?P<variant_id>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<create>[0-9]+) (?P<ready>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
+        "TaskPerfInfo": re.compile(prefix + r'Prof Task Perf Info (?P<op_id>[0-9]+) (?P<total_insts>-?[0-9]+) (?P<total_cycles>-?[0-9]+) (?P<llc_accesses>-?[0-9]+) (?P<llc_misses>-?[0-9]+)'),
         "MetaInfo": re.compile(prefix + r'Prof Meta Info (?P<op_id>[0-9]+) (?P<lg_id>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<create>[0-9]+) (?P<ready>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
         "CopyInfo": re.compile(prefix + r'Prof Copy Info (?P<op_id>[0-9]+) (?P<src>[a-f0-9]+) (?P<dst>[a-f0-9]+) (?P<size>[0-9]+) (?P<create>[0-9]+) (?P<ready>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
         "FillInfo": re.compile(prefix + r'Prof Fill Info (?P<op_id>[0-9]+) (?P<dst>[a-f0-9]+) (?P<create>[0-9]+) (?P<ready>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
@@ -87,6 +95,8 @@ class LegionProfASCIIDeserializer(LegionDeserializer):
         "MessageInfo": re.compile(prefix + r'Prof Message Info (?P<kind>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
         "MapperCallInfo": re.compile(prefix + r'Prof Mapper Call Info (?P<kind>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<op_id>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
         "RuntimeCallInfo": re.compile(prefix + r'Prof Runtime Call Info (?P<kind>[0-9]+) (?P<proc_id>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)'),
+        "SampleDesc": re.compile(prefix + r'Prof Sample Desc (?P<kind>[0-9]+) (?P<interval>[0-9]+) (?P<total>[0-9]+) (?P<sampled>[0-9]+) (?P<name>[a-zA-Z0-9_]+)'),
+        "AggregateInfo": re.compile(prefix + r'Prof Aggregate Info (?P<kind>[0-9]+) (?P<agg_id>[0-9]+) (?P<count>[0-9]+) (?P<total_time>[0-9]+) (?P<min_time>[0-9]+) (?P<max_time>[0-9]+)'),
         "ProfTaskInfo": re.compile(prefix + r'Prof ProfTask Info (?P<proc_id>[a-f0-9]+) (?P<op_id>[0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+)')
         # "UserInfo": re.compile(prefix + r'Prof User Info (?P<proc_id>[a-f0-9]+) (?P<start>[0-9]+) (?P<stop>[0-9]+) (?P<name>[$()a-zA-Z0-9_]+)')
     }
@@ -103,6 +113,18 @@ class LegionProfASCIIDeserializer(LegionDeserializer):
         "kind": int,
         "opkind": int,
         "part_op": int,
+        "total_insts": long,
+        "total_cycles": long,
+        "llc_accesses": long,
+        "llc_misses": long,
+        "interval": int,
+        "total": long,
+        "sampled": long,
+        "agg_id": long,
+        "count": long,
+        "total_time": read_time,
+        "min_time": read_time,
+        "max_time": read_time,
         "proc_id": lambda x: int(x, 16),
         "mem_id": lambda x: int(x, 16),
         "src": lambda x: int(x, 16),
@@ -200,6 +222,7 @@ class LegionProfBinaryDeserializer(LegionDeserializer):
         "unsigned":           "I", # unsigned int
         "timestamp_t":        "Q", # unsigned long long
         "unsigned long long": "Q", # unsigned long long
+        "long long":          "q", # long long
         "ProcKind":           "i", # int (really an enum so this depends)
         "MemKind":            "i", # int (really an enum so this depends)
         "MessageKind":        "i", # int (really an enum so this depends)
@@ -208,9 +231,57 @@ class LegionProfBinaryDeserializer(LegionDeserializer):
         "DepPartOpKind":      "i", # int (really an enum so this depends)
     }
 
-    def __init__(self, state, callbacks):
+    def __init__(self, state, callbacks, start=None, stop=None, procs=None):
+        """
+        @param[start]/[stop]: If given, only load timed records from the
+                              chunks of a log that overlap this window (us)
+        @param[procs]:        If given, only load timed records from the
+                              chunks of these processors
+        Windows and processor filters need the index file that the runtime
+        writes next to each log, without one the whole log is read.
+        """
         LegionDeserializer.__init__(self, state, callbacks)
         self.callbacks_translated = False
+        self.start = start
+        self.stop = stop
+        self.procs = set(procs) if procs is not None else None
+
+    def read_index(self, filename):
+        index_name = filename + '.idx'
+        if not os.path.exists(index_name):
+            return None
+        with open(index_name, 'rb') as index:
+            header = index.read(8)
+            if len(header) < 8:
+                return None
+            magic, version = struct.unpack('<II', header)
+            if magic != PROF_INDEX_MAGIC or version != PROF_INDEX_VERSION:
+                print('WARNING: Ignoring unknown index file %s' % index_name)
+                return None
+            entry_size = struct.calcsize('<QQQQQII')
+            chunks = []
+            entry = index.read(entry_size)
+            while len(entry) == entry_size:
+                chunks.append(struct.unpack('<QQQQQII', entry))
+                entry = index.read(entry_size)
+            return chunks
+
+    def select_chunks(self, chunks):
+        selected = []
+        for offset, size, proc_id, start, stop, kind, _ in chunks:
+            if kind == PROF_TIMED_CHUNK:
+                # timestamps in the index are in ns
+                if self.start is not None and stop / 1000 < self.start:
+                    continue
+                if self.stop is not None and start / 1000 > self.stop:
+                    continue
+                # chunks of copies, fills and partitions have no processor
+                if self.procs is not None and proc_id != 0 and \
+                        proc_id not in self.procs:
+                    continue
+            selected.append((offset, size))
+        selected.sort()
+        return selected
 
     @staticmethod
     def create_type_reader(num_bytes, param_type):
@@ -266,8 +337,10 @@ class LegionProfBinaryDeserializer(LegionDeserializer):
 
         # change the callbacks to be by id
         if not self.callbacks_translated:
+            # older logs may not contain every kind of record
             new_callbacks = {LegionProfBinaryDeserializer.name_to_id[name]: callback 
-                               for name, callback in self.callbacks.iteritems()}
+                               for name, callback in self.callbacks.iteritems()
+                               if name in LegionProfBinaryDeserializer.name_to_id}
             self.callbacks = new_callbacks
             self.callbacks_translated = True
 
@@ -281,9 +354,16 @@ class LegionProfBinaryDeserializer(LegionDeserializer):
 
     def parse(self, filename, verbose):
         print("parsing " + str(filename))
-        def parse_file(log):
+        chunks = None
+        if self.start is not None or self.stop is not None or \
+                self.procs is not None:
+            chunks = self.read_index(filename)
+            if chunks is not None:
+                chunks = self.select_chunks(chunks)
+            elif verbose:
+                print('No index for %s, reading the whole log' % filename)
+        def parse_records(log):
             matches = 0
-            self.parse_preamble(log)
             _id_raw = log.read(4)
             while _id_raw:
                 matches += 1
@@ -296,6 +376,17 @@ class LegionProfBinaryDeserializer(LegionDeserializer):
                 self.callbacks[_id](**kwargs)
                 _id_raw = log.read(4)
             return matches
+        def parse_file(log):
+            self.parse_preamble(log)
+            if chunks is None:
+                return parse_records(log)
+            # chunks only ever hold whole records so parse each one on
+            # its own, skipping over everything outside of the window
+            matches = 0
+            for offset, size in chunks:
+                log.seek(offset)
+                matches += parse_records(io.BytesIO(log.read(size)))
+            return matches
         try:
             # Try it as a gzip file first
             with getFileObj(filename,compressed=True) as log:
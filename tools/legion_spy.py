@@ -37,6 +37,13 @@ import subprocess
 import sys
 import tempfile
 
+from legion_spy_decoder import LegionSpyBinaryDecoder
+
+# These must match the task index in mappers/replay_mapper.h
+REPLAY_INDEX_MAGIC = 0x4C525049
+REPLAY_INDEX_VERSION = 1
+REPLAY_INDEX_MAX_DIM = 3
+
 # These are imported from legion_types.h
 NO_DEPENDENCE = 0
 TRUE_DEPENDENCE = 1
@@ -7084,6 +7091,12 @@ class Task(object):
         replay_file.write(struct.pack('i', self.point.dim))
         for idx in range(self.point.dim):
             replay_file.write(struct.pack('Q',self.point.vals[idx]))
+        # Remember where the mapping starts for the task index
+        assert self.point.dim <= REPLAY_INDEX_MAX_DIM
+        index_key = (op_id, self.point.dim, 
+            tuple(self.point.vals[idx] if idx < self.point.dim else 0
+                  for idx in range(REPLAY_INDEX_MAX_DIM)))
+        index_entry = (index_key, replay_file.tell())
         # Pack the base data
         replay_file.write(struct.pack('Q', op_id)) 
         replay_file.write(struct.pack('Q', self.processor.uid))
@@ -7153,6 +7166,7 @@ class Task(object):
                 replay_file.write(struct.pack('Q',self.close_indexes[idx]))
         else:
             replay_file.write(struct.pack('I',0))
+        return index_entry
 
 class Future(object):
     __slots__ = ['state', 'iid', 'creator_uid', 'logical_creator', 
@@ -8854,820 +8868,934 @@ barrier_arrive_pat      = re.compile(
 barrier_wait_pat        = re.compile(
     prefix+"Phase Barrier Wait (?P<uid>[0-9]+) (?P<iid>[0-9a-f]+)")
 
-def parse_legion_spy_line(line, state):
-    # Quick test to see if the line is even worth considering
-    m = prefix_pat.match(line)
-    if m is None:
-        return False
-    # We order these regex matches by the frequency in which they
-    # are likely to happen in order to improve parsing time
-    # Event stuff is very likely the most frequent stuff
-    m = event_dependence_pat.match(line)
-    if m is not None:
-        e1 = state.get_event(int(m.group('id1'),16))
-        e2 = state.get_event(int(m.group('id2'),16))
-        assert e2.exists()
-        if e1.exists():
-            e2.add_incoming(e1)
-            e1.add_outgoing(e2)
-        return True
-    m = ap_user_event_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        e.set_ap_user_event()
-        return True
-    m = rt_user_event_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        e.set_rt_user_event()
-        return True
-    m = pred_event_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        e.set_pred_event()
-        return True
-    m = ap_user_event_trig_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        e.set_triggered()
-        return True
-    m = rt_user_event_trig_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        e.set_triggered()
-        return True
-    m = pred_event_trig_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        e.set_triggered()
-        return True
-    m = operation_event_pat.match(line)
-    if m is not None:
-        e1 = state.get_event(int(m.group('id1'),16))
-        e2 = state.get_event(int(m.group('id2'),16))
-        op = state.get_operation(int(m.group('uid')))
-        op.set_events(e1, e2)
-        return True
-    m = realm_copy_pat.match(line)
-    if m is not None:
-        e1 = state.get_event(int(m.group('preid'),16))
-        e2 = state.get_event(int(m.group('postid'),16))
-        copy = state.get_realm_copy(e2)
-        copy.set_start(e1)
-        op = state.get_operation(int(m.group('uid')))
-        copy.set_creator(op)
-        region = state.get_region(int(m.group('ispace')), 
-            int(m.group('fspace')), int(m.group('tid')))
-        copy.set_region(region)
-        return True
-    m = realm_copy_field_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        copy = state.get_realm_copy(e)
-        src = state.get_instance(int(m.group('srcid'),16))
-        dst = state.get_instance(int(m.group('dstid'),16))
-        copy.add_field(int(m.group('srcfid')), src, 
-                       int(m.group('dstfid')), dst, int(m.group('redop')))
-        return True
-    m = realm_copy_intersect_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        copy = state.get_realm_copy(e)
-        is_region = True if int(m.group('reg')) == 1 else False
-        if is_region:
-            copy.set_intersect(state.get_region(int(m.group('index'),16),
-              int(m.group('field')), int(m.group('tid'))))
-        else:
-            copy.set_intersect(state.get_partition(int(m.group('index'),16),
-              int(m.group('field')), int(m.group('tid'))))
-        return True
-    m = realm_fill_pat.match(line)
-    if m is not None:
-        e1 = state.get_event(int(m.group('preid'),16))
-        e2 = state.get_event(int(m.group('postid'),16))
-        fill = state.get_realm_fill(e2)
-        fill.set_start(e1)
-        op = state.get_operation(int(m.group('uid')))
-        fill.set_creator(op)
-        region = state.get_region(int(m.group('ispace')), 
-            int(m.group('fspace')), int(m.group('tid')))
-        fill.set_region(region)
-        return True
-    m = realm_fill_field_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        fill = state.get_realm_fill(e)
-        dst = state.get_instance(int(m.group('dstid'),16))
-        fill.add_field(int(m.group('fid')), dst)
-        return True
-    m = realm_fill_intersect_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('id'),16))
-        fill = state.get_realm_fill(e)
-        is_region = True if int(m.group('reg')) == 1 else False
-        if is_region:
-            fill.set_intersect(state.get_region(int(m.group('index'),16),
-              int(m.group('field')), int(m.group('tid'))))
+def parse_event_dependence(m, state):
+    e1 = state.get_event(int(m.group('id1'),16))
+    e2 = state.get_event(int(m.group('id2'),16))
+    assert e2.exists()
+    if e1.exists():
+        e2.add_incoming(e1)
+        e1.add_outgoing(e2)
+    return True
+
+def parse_ap_user_event(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    e.set_ap_user_event()
+    return True
+
+def parse_rt_user_event(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    e.set_rt_user_event()
+    return True
+
+def parse_pred_event(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    e.set_pred_event()
+    return True
+
+def parse_ap_user_event_trig(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    e.set_triggered()
+    return True
+
+def parse_rt_user_event_trig(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    e.set_triggered()
+    return True
+
+def parse_pred_event_trig(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    e.set_triggered()
+    return True
+
+def parse_operation_event(m, state):
+    e1 = state.get_event(int(m.group('id1'),16))
+    e2 = state.get_event(int(m.group('id2'),16))
+    op = state.get_operation(int(m.group('uid')))
+    op.set_events(e1, e2)
+    return True
+
+def parse_realm_copy(m, state):
+    e1 = state.get_event(int(m.group('preid'),16))
+    e2 = state.get_event(int(m.group('postid'),16))
+    copy = state.get_realm_copy(e2)
+    copy.set_start(e1)
+    op = state.get_operation(int(m.group('uid')))
+    copy.set_creator(op)
+    region = state.get_region(int(m.group('ispace')), 
+        int(m.group('fspace')), int(m.group('tid')))
+    copy.set_region(region)
+    return True
+
+def parse_realm_copy_field(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    copy = state.get_realm_copy(e)
+    src = state.get_instance(int(m.group('srcid'),16))
+    dst = state.get_instance(int(m.group('dstid'),16))
+    copy.add_field(int(m.group('srcfid')), src, 
+                   int(m.group('dstfid')), dst, int(m.group('redop')))
+    return True
+
+def parse_realm_copy_intersect(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    copy = state.get_realm_copy(e)
+    is_region = True if int(m.group('reg')) == 1 else False
+    if is_region:
+        copy.set_intersect(state.get_region(int(m.group('index'),16),
+          int(m.group('field')), int(m.group('tid'))))
+    else:
+        copy.set_intersect(state.get_partition(int(m.group('index'),16),
+          int(m.group('field')), int(m.group('tid'))))
+    return True
+
+def parse_realm_fill(m, state):
+    e1 = state.get_event(int(m.group('preid'),16))
+    e2 = state.get_event(int(m.group('postid'),16))
+    fill = state.get_realm_fill(e2)
+    fill.set_start(e1)
+    op = state.get_operation(int(m.group('uid')))
+    fill.set_creator(op)
+    region = state.get_region(int(m.group('ispace')), 
+        int(m.group('fspace')), int(m.group('tid')))
+    fill.set_region(region)
+    return True
+
+def parse_realm_fill_field(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    fill = state.get_realm_fill(e)
+    dst = state.get_instance(int(m.group('dstid'),16))
+    fill.add_field(int(m.group('fid')), dst)
+    return True
+
+def parse_realm_fill_intersect(m, state):
+    e = state.get_event(int(m.group('id'),16))
+    fill = state.get_realm_fill(e)
+    is_region = True if int(m.group('reg')) == 1 else False
+    if is_region:
+        fill.set_intersect(state.get_region(int(m.group('index'),16),
+          int(m.group('field')), int(m.group('tid'))))
+    else:
+        fill.set_intersect(state.get_partition(int(m.group('index'),16),
+          int(m.group('field')), int(m.group('tid'))))
+    return True
+
+def parse_realm_deppart(m, state):
+    e1 = state.get_event(int(m.group('preid'),16))
+    e2 = state.get_event(int(m.group('postid'),16))
+    deppart = state.get_realm_deppart(e2)
+    deppart.set_start(e1)
+    op = state.get_operation(int(m.group('uid')))
+    deppart.set_creator(op)
+    index_space = state.get_index_space(int(m.group('ispace')))
+    deppart.set_index_space(index_space) 
+    return True
+
+def parse_barrier_arrive(m, state):
+    e = state.get_event(int(m.group('iid'),16))
+    op = state.get_operation(int(m.group('uid')))
+    e.add_phase_barrier_contributor(op)
+    op.add_arrival_barrier(e)
+    return True
+
+def parse_barrier_wait(m, state):
+    e = state.get_event(int(m.group('iid'),16))
+    op = state.get_operation(int(m.group('uid')))
+    e.add_phase_barrier_waiter(op)
+    op.add_wait_barrier(e)
+    return True
+
+def parse_requirement(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    is_reg = True if int(m.group('is_reg')) == 1 else False
+    field_space = state.get_field_space(int(m.group('fspace')))
+    tid = int(m.group('tid'))
+    priv = int(m.group('priv'))
+    coher = int(m.group('coher'))
+    redop = int(m.group('redop'))
+    parent_ispace = int(m.group('pis'),16)
+    parent = state.get_region(int(m.group('pis'),16), field_space.uid, tid)
+    if is_reg:
+        index_space = state.get_index_space(int(m.group('ispace'),16))
+        region = state.get_region(index_space.uid, field_space.uid, tid) 
+        requirement = Requirement(state, int(m.group('index')), True,
+            index_space, field_space, tid, region, 
+            priv, coher, redop, parent)
+        op.add_requirement(requirement)
+    else:
+        index_partition = state.get_index_partition(int(m.group('ispace'),16))
+        partition = state.get_partition(index_partition.uid, field_space.uid, tid)
+        requirement = Requirement(state, int(m.group('index')), False,
+            index_partition, field_space, tid, partition, 
+            priv, coher, redop, parent)
+        op.add_requirement(requirement)
+    return True
+
+def parse_req_field(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    index = int(m.group('index'))
+    fid = int(m.group('fid'))
+    op.add_requirement_field(index, fid)
+    return True
+
+def parse_projection_func(m, state):
+    func = state.get_projection_function(int(m.group('pid')))
+    func.set_depth(int(m.group('depth')))
+    return True
+
+def parse_req_proj(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    index = int(m.group('index'))
+    func = state.get_projection_function(int(m.group('pid')))
+    op.set_projection_function(index, func)
+    return True
+
+def parse_index_launch_domain(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    dim = int(m.group('dim'))
+    lo = Point(dim)
+    hi = Point(dim)
+    lo.vals[0] = int(m.group('lo1'))
+    hi.vals[0] = int(m.group('hi1'))
+    if dim >= 2:
+        lo.vals[1] = int(m.group('lo2'))
+        hi.vals[1] = int(m.group('hi2'))
+        if dim >= 3:
+            lo.vals[2] = int(m.group('lo3'))
+            hi.vals[2] = int(m.group('hi3'))
+    op.set_launch_rect(Rect(lo, hi)) 
+    return True
+
+def parse_mapping_dep(m, state):
+    op1 = state.get_operation(int(m.group('prev_id')))
+    op2 = state.get_operation(int(m.group('next_id')))
+    dep = MappingDependence(op1, op2, int(m.group('pidx')),
+        int(m.group('nidx')), int(m.group('dtype')))
+    op2.add_incoming(dep)
+    op1.add_outgoing(dep)
+    # Record that we found a mapping dependence
+    state.has_mapping_deps = True
+    return True
+
+def parse_future_create(m, state):
+    future = state.get_future(int(m.group('iid'),16))
+    future.set_creator(int(m.group('uid')))
+    point = Point(int(m.group('dim')))
+    if point.dim > 0:
+        point.vals[0] = int(m.group('p1'))
+        if point.dim > 1:
+            point.vals[1] = int(m.group('p2'))
+            if point.dim > 2:
+                point.vals[2] = int(m.group('p3'))
+    future.set_point(point)
+    return True 
+
+def parse_future_use(m, state):
+    future = state.get_future(int(m.group('iid'),16))
+    future.add_uid(int(m.group('uid')))
+    return True
+
+def parse_predicate_use(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    pred = state.get_operation(int(m.group('pred')))
+    op.set_predicate(pred)
+    return True
+
+def parse_instance(m, state):
+    mem = state.get_memory(int(m.group('mid'),16))
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.set_memory(mem)
+    inst.set_redop(int(m.group('redop')))
+    return True
+
+def parse_instance_region(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    region = state.get_region(int(m.group('ispace')), 
+        int(m.group('fspace')), int(m.group('tid')))
+    inst.set_region(region)
+    return True
+
+def parse_instance_field(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.add_field(int(m.group('fid')))
+    return True
+
+def parse_instance_creator(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    proc = state.get_processor(int(m.group('proc'),16))
+    inst.set_creator(int(m.group('uid')), proc)
+    return True
+
+def parse_instance_creator_region(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    region = state.get_region(int(m.group('ispace')), 
+        int(m.group('fspace')), int(m.group('tid')))
+    inst.add_creator_region(region)
+    return True
+
+def parse_specialized_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.set_specialized_constraint(int(m.group('kind')),
+                                    int(m.group('redop')))
+    return True
+
+def parse_memory_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.set_memory_constraint(int(m.group('kind')))
+    return True
+
+def parse_field_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.set_field_constraint(int(m.group('contig')), 
+        int(m.group('inorder')), int(m.group('fields')))
+    return True
+
+def parse_field_constraint_field(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.add_field_constraint_field(int(m.group('fid')))
+    return True
+
+def parse_ordering_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.set_ordering_constraint(int(m.group('contig')), 
+                                 int(m.group('dims')))
+    return True
+
+def parse_ordering_constraint_dim(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.add_ordering_constraint_dim(int(m.group('dim')))
+    return True
+
+def parse_splitting_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.add_splitting_constraint(int(m.group('dim')),
+        int(m.group('value')), int(m.group('chunks')))
+    return True
+
+def parse_dimension_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.add_dimesion_constraint(int(m.group('dim')),
+        int(m.group('eqk')), int(m.group('value')))
+    return True
+
+def parse_alignment_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.add_alignment_constraint(int(m.group('fid')),
+        int(m.group('eqk')), int(m.group('align')))
+    return True
+
+def parse_offset_constraint(m, state):
+    inst = state.get_instance(int(m.group('iid'),16))
+    inst.add_offset_constraint(int(m.group('fid')),
+        int(m.group('offset')))
+    return True
+
+def parse_variant_decision(m, state):
+    task = state.get_task(int(m.group('uid')))
+    variant = state.get_variant(int(m.group('vid')))
+    task.set_variant(variant)
+    return True
+
+def parse_mapping_decision(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    inst = state.get_instance(int(m.group('iid'),16))
+    op.add_mapping_decision(int(m.group('idx')),
+        int(m.group('fid')), inst)
+    return True
+
+def parse_post_decision(m, state):
+    task = state.get_task(int(m.group('uid')))
+    inst = state.get_instance(int(m.group('iid'),16))
+    task.add_postmapping(int(m.group('idx')),
+        int(m.group('fid')), inst)
+    return True
+
+def parse_task_priority(m, state):
+    task = state.get_task(int(m.group('uid')))
+    task.set_priority(int(m.group('priority')))
+    return True
+
+def parse_task_processor(m, state):
+    task = state.get_task(int(m.group('uid')))
+    proc = state.get_processor(int(m.group('proc'),16))
+    task.set_processor(proc)
+    return True
+
+def parse_task_premapping(m, state):
+    task = state.get_task(int(m.group('uid')))
+    task.add_premapping(int(m.group('index')))
+    return True
+
+def parse_temporary_decision(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    inst = state.get_instance(int(m.group('iid'),16))
+    op.add_temporary_instance(int(m.group('idx')),
+        int(m.group('fid')), inst)
+    return True
+
+def parse_tunable(m, state):
+    task = state.get_task(int(m.group('uid')))
+    task.add_tunable(int(m.group('idx')), int(m.group('bytes')), m.group('value'))
+    return True
+
+def parse_task_name(m, state):
+    state.task_names[int(m.group('tid'))] = m.group('name')
+    return True
+
+def parse_task_variant(m, state):
+    variant = state.get_variant(int(m.group('vid')))
+    variant.initialize(int(m.group('inner')), int(m.group('leaf')),
+                       int(m.group('idem')), m.group('name'))
+    return True
+
+def parse_top_task(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(SINGLE_TASK_KIND)
+    op.set_name(m.group('name'))
+    op.set_task_id(int(m.group('tid')))
+    # Save the top-level uid
+    state.top_level_uid = int(m.group('uid'))
+    return True
+
+def parse_single_task(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(SINGLE_TASK_KIND)
+    op.set_name(m.group('name'))
+    op.set_task_id(int(m.group('tid')))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_index_task(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(INDEX_TASK_KIND)
+    op.set_name(m.group('name'))
+    op.set_task_id(int(m.group('tid')))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_mapping(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(MAP_OP_KIND)
+    op.set_name("Mapping Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_close(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    inter = True if int(m.group('is_inter')) == 1 else False
+    if inter:
+        read_only = True if int(m.group('is_read_only')) == 1 else False
+        if read_only:
+            op.set_op_kind(READ_ONLY_CLOSE_OP_KIND)
+            op.set_name("Read Only Close Op "+m.group('uid'))
         else:
-            fill.set_intersect(state.get_partition(int(m.group('index'),16),
-              int(m.group('field')), int(m.group('tid'))))
-        return True
-    m = realm_deppart_pat.match(line)
-    if m is not None:
-        e1 = state.get_event(int(m.group('preid'),16))
-        e2 = state.get_event(int(m.group('postid'),16))
-        deppart = state.get_realm_deppart(e2)
-        deppart.set_start(e1)
-        op = state.get_operation(int(m.group('uid')))
-        deppart.set_creator(op)
-        index_space = state.get_index_space(int(m.group('ispace')))
-        deppart.set_index_space(index_space) 
-        return True
-    m = barrier_arrive_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('iid'),16))
-        op = state.get_operation(int(m.group('uid')))
-        e.add_phase_barrier_contributor(op)
-        op.add_arrival_barrier(e)
-        return True
-    m = barrier_wait_pat.match(line)
-    if m is not None:
-        e = state.get_event(int(m.group('iid'),16))
-        op = state.get_operation(int(m.group('uid')))
-        e.add_phase_barrier_waiter(op)
-        op.add_wait_barrier(e)
-        return True
+            op.set_op_kind(INTER_CLOSE_OP_KIND)
+            op.set_name("Inter Close Op "+m.group('uid'))
+    else:
+        op.set_op_kind(POST_CLOSE_OP_KIND)
+        op.set_name("Post Close Op "+m.group('uid'))
+
+    context = state.get_task(int(m.group('ctx')))
+    # Only add this to the context if it not an intermediate
+    # close operation, otherwise add it to the context like normal
+    # because it as an actual operation
+    op.set_context(context, not inter)
+    return True
+
+def parse_internal_creator(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    creator = state.get_operation(int(m.group('cuid')))
+    op.set_creator(creator, int(m.group('idx')))
+    return True
+
+def parse_open(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(OPEN_OP_KIND)
+    op.set_name("Open Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context, False)
+    return True
+
+def parse_advance(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(ADVANCE_OP_KIND)
+    op.set_name("Advance Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context, False)
+    return True
+
+def parse_fence(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(FENCE_OP_KIND)
+    op.set_name("Fence Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_trace(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(TRACE_OP_KIND)
+    op.set_name("Trace Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_copy_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(COPY_OP_KIND)
+    op.set_name("Copy Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_fill_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(FILL_OP_KIND)
+    op.set_name("Fill Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_acquire_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(ACQUIRE_OP_KIND)
+    op.set_name("Acquire Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_release_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(RELEASE_OP_KIND)
+    op.set_name("Release Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_deletion(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(DELETION_OP_KIND)
+    op.set_name("Deletion Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_attach(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(ATTACH_OP_KIND)
+    op.set_name("Attach Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_detach(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(DETACH_OP_KIND)
+    op.set_name("Detach Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_dynamic_collective(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(DYNAMIC_COLLECTIVE_OP_KIND)
+    op.set_name("Dynamic Collective Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_timing_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(TIMING_OP_KIND)
+    op.set_name("Timing Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_predicate_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(PREDICATE_OP_KIND)
+    op.set_name("Predicate Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_must_epoch_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(MUST_EPOCH_OP_KIND)
+    # Don't add it to the context for now
+    return True
+
+def parse_dep_partition_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(DEP_PART_OP_KIND)
+    op.set_name("Dependent Partition Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_pending_partition_op(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_op_kind(PENDING_PART_OP_KIND)
+    op.set_name("Pending Partition Op "+m.group('uid'))
+    context = state.get_task(int(m.group('ctx')))
+    op.set_context(context)
+    return True
+
+def parse_target_partition(m, state):
+    op = state.get_operation(int(m.group('uid'))) 
+    index_partition = state.get_index_partition(int(m.group('pid'),16))
+    op.set_pending_partition_info(index_partition, int(m.group('kind')))
+    return True
+
+def parse_index_slice(m, state):
+    op = state.get_operation(int(m.group('index')))
+    state.slice_index[int(m.group('slice'))] = op
+    return True
+
+def parse_slice_slice(m, state):
+    state.slice_slice[int(m.group('slice2'))] = int(m.group('slice1'))
+    return True
+
+def parse_slice_point(m, state):
+    point = state.get_task(int(m.group('point')))
+    dim = int(m.group('dim'))
+    index_point = Point(dim)
+    index_point.vals[0] = int(m.group('val1'))
+    if dim > 1:
+        index_point.vals[1] = int(m.group('val2'))
+        if dim > 2:
+            index_point.vals[2] = int(m.group('val3'))
+    point.set_point(index_point)
+    state.point_slice[point] = int(m.group('slice'))
+    return True
+
+def parse_point_point(m, state):
+    p1 = state.get_task(int(m.group('point1')))
+    p2 = state.get_task(int(m.group('point2')))
+    assert p1 not in state.point_point
+    assert p2 not in state.point_point
+    # Holdoff on doing the merge until after parsing
+    state.point_point[p1] = p2
+    return True
+
+def parse_index_point(m, state):
+    point = state.get_operation(int(m.group('point')))
+    dim = int(m.group('dim'))
+    index_point = Point(dim)
+    index_point.vals[0] = int(m.group('val1'))
+    if dim > 1:
+        index_point.vals[1] = int(m.group('val2'))
+        if dim > 2:
+            index_point.vals[2] = int(m.group('val3'))
+    index = state.get_operation(int(m.group('index')))
+    index.add_point_op(point, index_point) 
+    return True
+
+def parse_op_index(m, state):
+    task = state.get_task(int(m.group('parent')))
+    task.add_operation_index(int(m.group('index')),
+                             int(m.group('child')))
+    return True
+
+def parse_close_index(m, state):
+    task = state.get_task(int(m.group('parent')))
+    task.add_close_index(int(m.group('index')),
+                         int(m.group('child')))
+    return True
+
+def parse_disjoint_close(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.add_disjoint_close_field(int(m.group('fid')))     
+    return True
+
+def parse_predicate_false(m, state):
+    op = state.get_operation(int(m.group('uid')))
+    op.set_predicate_result(False)
+    return True
+
+def parse_top_index(m, state):
+    state.get_index_space(int(m.group('uid'),16)) 
+    return True
+
+def parse_index_name(m, state):
+    ispace = state.get_index_space(int(m.group('uid'),16))
+    ispace.set_name(m.group('name'))
+    return True
+
+def parse_index_part(m, state):
+    parent = state.get_index_space(int(m.group('pid'),16))
+    part = state.get_index_partition(int(m.group('uid'),16))
+    color= Point(1)
+    color.vals[0] = int(m.group('color'))
+    part.set_parent(parent, color)
+    part.set_disjoint(True if int(m.group('disjoint')) == 1 else False)
+    return True
+
+def parse_index_part_name(m, state):
+    part = state.get_index_partition(int(m.group('uid'),16))
+    part.set_name(m.group('name'))
+    return True
+
+def parse_index_subspace(m, state):
+    ispace = state.get_index_space(int(m.group('uid'),16))
+    parent = state.get_index_partition(int(m.group('pid'),16))
+    dim = int(m.group('dim'))
+    color= Point(dim)
+    color.vals[0] = int(m.group('val1'))
+    if dim > 1:
+        color.vals[1] = int(m.group('val2'))
+        if dim > 2:
+            color.vals[2] = int(m.group('val3'))
+    ispace.set_parent(parent, color)
+    return True
+
+def parse_field_space(m, state):
+    state.get_field_space(int(m.group('uid')))
+    return True
+
+def parse_field_space_name(m, state):
+    space = state.get_field_space(int(m.group('uid')))
+    space.set_name(m.group('name'))
+    return True
+
+def parse_field_create(m, state):
+    space = state.get_field_space(int(m.group('uid')))
+    field = space.get_field(int(m.group('fid')))
+    field.size = int(m.group('size'))
+    return True
+
+def parse_field_name(m, state):
+    space = state.get_field_space(int(m.group('uid')))
+    field = space.get_field(int(m.group('fid')))
+    field.set_name(m.group('name'))
+    return True
+
+def parse_region(m, state):
+    state.get_region(int(m.group('iid'),16),
+        int(m.group('fid')),int(m.group('tid')))
+    return True
+
+def parse_region_name(m, state):
+    region = state.get_region(int(m.group('iid'),16),
+        int(m.group('fid')),int(m.group('tid')))
+    region.set_name(m.group('name'))
+    return True
+
+def parse_partition_name(m, state):
+    partition = state.get_partition(int(m.group('iid'),16),
+        int(m.group('fid')),int(m.group('tid')))
+    partition.set_name(m.group('name'))
+    return True
+
+def parse_index_space_point(m, state):
+    index_space = state.get_index_space(int(m.group('uid'),16)) 
+    dim = int(m.group('dim'))
+    point = Point(dim)
+    point.vals[0] = int(m.group('p1'))
+    if dim >= 2:
+        point.vals[1] = int(m.group('p2'))
+        if dim >= 3:
+            point.vals[2] = int(m.group('p3'))
+    index_space.add_point(point)
+    return True
+
+def parse_index_space_rect(m, state):
+    index_space = state.get_index_space(int(m.group('uid'),16))
+    dim = int(m.group('dim'))
+    lo = Point(dim)
+    hi = Point(dim)
+    lo.vals[0] = int(m.group('lo1'))
+    hi.vals[0] = int(m.group('hi1'))
+    if dim >= 2:
+        lo.vals[1] = int(m.group('lo2'))
+        hi.vals[1] = int(m.group('hi2'))
+        if dim >= 3:
+            lo.vals[2] = int(m.group('lo3'))
+            hi.vals[2] = int(m.group('hi3'))
+    index_space.add_rect(Rect(lo, hi))
+    return True
+
+def parse_empty_index_space(m, state):
+    index_space = state.get_index_space(int(m.group('uid'),16))
+    index_space.set_empty()
+    return True
+
+def parse_proc_kind(m, state):
+    state.record_processor_kind(int(m.group('kind')), m.group('name'))
+    return True
+
+def parse_mem_kind(m, state):
+    state.record_memory_kind(int(m.group('kind')), m.group('name'))
+    return True
+
+def parse_processor(m, state):
+    proc = state.get_processor(int(m.group('pid'),16))
+    kind_num = int(m.group('kind'))
+    proc.set_kind(kind_num, state.get_processor_kind(kind_num))
+    return True
+
+def parse_memory(m, state):
+    mem = state.get_memory(int(m.group('mid'),16))
+    kind_num = int(m.group('kind'))
+    mem.set_kind(kind_num, state.get_memory_kind(kind_num))
+    mem.set_capacity(int(m.group('capacity')))
+    return True
+
+def parse_proc_mem(m, state):
+    proc = state.get_processor(int(m.group('pid'),16))
+    mem = state.get_memory(int(m.group('mid'),16))
+    bandwidth = int(m.group('band'))
+    latency = int(m.group('lat'))
+    proc.add_memory(mem, bandwidth, latency)
+    mem.add_processor(proc, bandwidth, latency)
+    return True
+
+def parse_mem_mem(m, state):
+    mem1 = state.get_memory(int(m.group('mone'),16))
+    mem2 = state.get_memory(int(m.group('mtwo'),16))
+    bandwidth = int(m.group('band'))
+    latency = int(m.group('lat'))
+    mem1.add_memory(mem2, bandwidth, latency)
+    mem2.add_memory(mem1, bandwidth, latency)
+    return True
+
+def parse_config(m, state):
+    state.set_config(False)
+    return True
+
+def parse_detailed_config(m, state):
+    state.set_config(True)
+    return True
+
+# Each kind of Legion Spy line paired with its parser. We order these
+# by the frequency in which they are likely to happen in order to
+# improve parsing time
+legion_spy_parsers = [
+    (event_dependence_pat, parse_event_dependence),
+    (ap_user_event_pat, parse_ap_user_event),
+    (rt_user_event_pat, parse_rt_user_event),
+    (pred_event_pat, parse_pred_event),
+    (ap_user_event_trig_pat, parse_ap_user_event_trig),
+    (rt_user_event_trig_pat, parse_rt_user_event_trig),
+    (pred_event_trig_pat, parse_pred_event_trig),
+    (operation_event_pat, parse_operation_event),
+    (realm_copy_pat, parse_realm_copy),
+    (realm_copy_field_pat, parse_realm_copy_field),
+    (realm_copy_intersect_pat, parse_realm_copy_intersect),
+    (realm_fill_pat, parse_realm_fill),
+    (realm_fill_field_pat, parse_realm_fill_field),
+    (realm_fill_intersect_pat, parse_realm_fill_intersect),
+    (realm_deppart_pat, parse_realm_deppart),
+    (barrier_arrive_pat, parse_barrier_arrive),
+    (barrier_wait_pat, parse_barrier_wait),
     # Region requirements and mapping dependences happen often
-    m = requirement_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        is_reg = True if int(m.group('is_reg')) == 1 else False
-        field_space = state.get_field_space(int(m.group('fspace')))
-        tid = int(m.group('tid'))
-        priv = int(m.group('priv'))
-        coher = int(m.group('coher'))
-        redop = int(m.group('redop'))
-        parent_ispace = int(m.group('pis'),16)
-        parent = state.get_region(int(m.group('pis'),16), field_space.uid, tid)
-        if is_reg:
-            index_space = state.get_index_space(int(m.group('ispace'),16))
-            region = state.get_region(index_space.uid, field_space.uid, tid) 
-            requirement = Requirement(state, int(m.group('index')), True,
-                index_space, field_space, tid, region, 
-                priv, coher, redop, parent)
-            op.add_requirement(requirement)
-        else:
-            index_partition = state.get_index_partition(int(m.group('ispace'),16))
-            partition = state.get_partition(index_partition.uid, field_space.uid, tid)
-            requirement = Requirement(state, int(m.group('index')), False,
-                index_partition, field_space, tid, partition, 
-                priv, coher, redop, parent)
-            op.add_requirement(requirement)
-        return True
-    m = req_field_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        index = int(m.group('index'))
-        fid = int(m.group('fid'))
-        op.add_requirement_field(index, fid)
-        return True
-    m = projection_func_pat.match(line)
-    if m is not None:
-        func = state.get_projection_function(int(m.group('pid')))
-        func.set_depth(int(m.group('depth')))
-        return True
-    m = req_proj_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        index = int(m.group('index'))
-        func = state.get_projection_function(int(m.group('pid')))
-        op.set_projection_function(index, func)
-        return True
-    m = index_launch_domain_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        dim = int(m.group('dim'))
-        lo = Point(dim)
-        hi = Point(dim)
-        lo.vals[0] = int(m.group('lo1'))
-        hi.vals[0] = int(m.group('hi1'))
-        if dim >= 2:
-            lo.vals[1] = int(m.group('lo2'))
-            hi.vals[1] = int(m.group('hi2'))
-            if dim >= 3:
-                lo.vals[2] = int(m.group('lo3'))
-                hi.vals[2] = int(m.group('hi3'))
-        op.set_launch_rect(Rect(lo, hi)) 
-        return True
-    m = mapping_dep_pat.match(line)
-    if m is not None:
-        op1 = state.get_operation(int(m.group('prev_id')))
-        op2 = state.get_operation(int(m.group('next_id')))
-        dep = MappingDependence(op1, op2, int(m.group('pidx')),
-            int(m.group('nidx')), int(m.group('dtype')))
-        op2.add_incoming(dep)
-        op1.add_outgoing(dep)
-        # Record that we found a mapping dependence
-        state.has_mapping_deps = True
-        return True
-    m = future_create_pat.match(line)
-    if m is not None:
-        future = state.get_future(int(m.group('iid'),16))
-        future.set_creator(int(m.group('uid')))
-        point = Point(int(m.group('dim')))
-        if point.dim > 0:
-            point.vals[0] = int(m.group('p1'))
-            if point.dim > 1:
-                point.vals[1] = int(m.group('p2'))
-                if point.dim > 2:
-                    point.vals[2] = int(m.group('p3'))
-        future.set_point(point)
-        return True 
-    m = future_use_pat.match(line)
-    if m is not None:
-        future = state.get_future(int(m.group('iid'),16))
-        future.add_uid(int(m.group('uid')))
-        return True
-    m = predicate_use_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        pred = state.get_operation(int(m.group('pred')))
-        op.set_predicate(pred)
-        return True
+    (requirement_pat, parse_requirement),
+    (req_field_pat, parse_req_field),
+    (projection_func_pat, parse_projection_func),
+    (req_proj_pat, parse_req_proj),
+    (index_launch_domain_pat, parse_index_launch_domain),
+    (mapping_dep_pat, parse_mapping_dep),
+    (future_create_pat, parse_future_create),
+    (future_use_pat, parse_future_use),
+    (predicate_use_pat, parse_predicate_use),
     # Physical Instances and Mapping decisions happen frequently too
-    m = instance_pat.match(line)
-    if m is not None:
-        mem = state.get_memory(int(m.group('mid'),16))
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.set_memory(mem)
-        inst.set_redop(int(m.group('redop')))
-        return True
-    m = instance_region_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        region = state.get_region(int(m.group('ispace')), 
-            int(m.group('fspace')), int(m.group('tid')))
-        inst.set_region(region)
-        return True
-    m = instance_field_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.add_field(int(m.group('fid')))
-        return True
-    m = instance_creator_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        proc = state.get_processor(int(m.group('proc'),16))
-        inst.set_creator(int(m.group('uid')), proc)
-        return True
-    m = instance_creator_region_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        region = state.get_region(int(m.group('ispace')), 
-            int(m.group('fspace')), int(m.group('tid')))
-        inst.add_creator_region(region)
-        return True
-    m = specialized_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.set_specialized_constraint(int(m.group('kind')),
-                                        int(m.group('redop')))
-        return True
-    m = memory_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.set_memory_constraint(int(m.group('kind')))
-        return True
-    m = field_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.set_field_constraint(int(m.group('contig')), 
-            int(m.group('inorder')), int(m.group('fields')))
-        return True
-    m = field_constraint_field_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.add_field_constraint_field(int(m.group('fid')))
-        return True
-    m = ordering_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.set_ordering_constraint(int(m.group('contig')), 
-                                     int(m.group('dims')))
-        return True
-    m = ordering_constraint_dim_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.add_ordering_constraint_dim(int(m.group('dim')))
-        return True
-    m = splitting_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.add_splitting_constraint(int(m.group('dim')),
-            int(m.group('value')), int(m.group('chunks')))
-        return True
-    m = dimension_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.add_dimesion_constraint(int(m.group('dim')),
-            int(m.group('eqk')), int(m.group('value')))
-        return True
-    m = alignment_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.add_alignment_constraint(int(m.group('fid')),
-            int(m.group('eqk')), int(m.group('align')))
-        return True
-    m = offset_constraint_pat.match(line)
-    if m is not None:
-        inst = state.get_instance(int(m.group('iid'),16))
-        inst.add_offset_constraint(int(m.group('fid')),
-            int(m.group('offset')))
-        return True
-    m = variant_decision_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('uid')))
-        variant = state.get_variant(int(m.group('vid')))
-        task.set_variant(variant)
-        return True
-    m = mapping_decision_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        inst = state.get_instance(int(m.group('iid'),16))
-        op.add_mapping_decision(int(m.group('idx')),
-            int(m.group('fid')), inst)
-        return True
-    m = post_decision_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('uid')))
-        inst = state.get_instance(int(m.group('iid'),16))
-        task.add_postmapping(int(m.group('idx')),
-            int(m.group('fid')), inst)
-        return True
-    m = task_priority_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('uid')))
-        task.set_priority(int(m.group('priority')))
-        return True
-    m = task_processor_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('uid')))
-        proc = state.get_processor(int(m.group('proc'),16))
-        task.set_processor(proc)
-        return True
-    m = task_premapping_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('uid')))
-        task.add_premapping(int(m.group('index')))
-        return True
-    m = temporary_decision_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        inst = state.get_instance(int(m.group('iid'),16))
-        op.add_temporary_instance(int(m.group('idx')),
-            int(m.group('fid')), inst)
-        return True
-    m = tunable_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('uid')))
-        task.add_tunable(int(m.group('idx')), int(m.group('bytes')), m.group('value'))
-        return True
+    (instance_pat, parse_instance),
+    (instance_region_pat, parse_instance_region),
+    (instance_field_pat, parse_instance_field),
+    (instance_creator_pat, parse_instance_creator),
+    (instance_creator_region_pat, parse_instance_creator_region),
+    (specialized_constraint_pat, parse_specialized_constraint),
+    (memory_constraint_pat, parse_memory_constraint),
+    (field_constraint_pat, parse_field_constraint),
+    (field_constraint_field_pat, parse_field_constraint_field),
+    (ordering_constraint_pat, parse_ordering_constraint),
+    (ordering_constraint_dim_pat, parse_ordering_constraint_dim),
+    (splitting_constraint_pat, parse_splitting_constraint),
+    (dimension_constraint_pat, parse_dimension_constraint),
+    (alignment_constraint_pat, parse_alignment_constraint),
+    (offset_constraint_pat, parse_offset_constraint),
+    (variant_decision_pat, parse_variant_decision),
+    (mapping_decision_pat, parse_mapping_decision),
+    (post_decision_pat, parse_post_decision),
+    (task_priority_pat, parse_task_priority),
+    (task_processor_pat, parse_task_processor),
+    (task_premapping_pat, parse_task_premapping),
+    (temporary_decision_pat, parse_temporary_decision),
+    (tunable_pat, parse_tunable),
     # Operations near the top since they happen frequently
-    m = task_name_pat.match(line)
-    if m is not None:
-        state.task_names[int(m.group('tid'))] = m.group('name')
-        return True
-    m = task_variant_pat.match(line)
-    if m is not None:
-        variant = state.get_variant(int(m.group('vid')))
-        variant.initialize(int(m.group('inner')), int(m.group('leaf')),
-                           int(m.group('idem')), m.group('name'))
-        return True
-    m = top_task_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(SINGLE_TASK_KIND)
-        op.set_name(m.group('name'))
-        op.set_task_id(int(m.group('tid')))
-        # Save the top-level uid
-        state.top_level_uid = int(m.group('uid'))
-        return True
-    m = single_task_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(SINGLE_TASK_KIND)
-        op.set_name(m.group('name'))
-        op.set_task_id(int(m.group('tid')))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = index_task_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(INDEX_TASK_KIND)
-        op.set_name(m.group('name'))
-        op.set_task_id(int(m.group('tid')))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = mapping_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(MAP_OP_KIND)
-        op.set_name("Mapping Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = close_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        inter = True if int(m.group('is_inter')) == 1 else False
-        if inter:
-            read_only = True if int(m.group('is_read_only')) == 1 else False
-            if read_only:
-                op.set_op_kind(READ_ONLY_CLOSE_OP_KIND)
-                op.set_name("Read Only Close Op "+m.group('uid'))
-            else:
-                op.set_op_kind(INTER_CLOSE_OP_KIND)
-                op.set_name("Inter Close Op "+m.group('uid'))
-        else:
-            op.set_op_kind(POST_CLOSE_OP_KIND)
-            op.set_name("Post Close Op "+m.group('uid'))
-        
-        context = state.get_task(int(m.group('ctx')))
-        # Only add this to the context if it not an intermediate
-        # close operation, otherwise add it to the context like normal
-        # because it as an actual operation
-        op.set_context(context, not inter)
-        return True
-    m = internal_creator_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        creator = state.get_operation(int(m.group('cuid')))
-        op.set_creator(creator, int(m.group('idx')))
-        return True
-    m = open_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(OPEN_OP_KIND)
-        op.set_name("Open Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context, False)
-        return True
-    m = advance_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(ADVANCE_OP_KIND)
-        op.set_name("Advance Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context, False)
-        return True
-    m = fence_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(FENCE_OP_KIND)
-        op.set_name("Fence Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = trace_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(TRACE_OP_KIND)
-        op.set_name("Trace Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = copy_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(COPY_OP_KIND)
-        op.set_name("Copy Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = fill_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(FILL_OP_KIND)
-        op.set_name("Fill Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = acquire_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(ACQUIRE_OP_KIND)
-        op.set_name("Acquire Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = release_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(RELEASE_OP_KIND)
-        op.set_name("Release Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = deletion_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(DELETION_OP_KIND)
-        op.set_name("Deletion Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = attach_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(ATTACH_OP_KIND)
-        op.set_name("Attach Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = detach_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(DETACH_OP_KIND)
-        op.set_name("Detach Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = dynamic_collective_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(DYNAMIC_COLLECTIVE_OP_KIND)
-        op.set_name("Dynamic Collective Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = timing_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(TIMING_OP_KIND)
-        op.set_name("Timing Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = predicate_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(PREDICATE_OP_KIND)
-        op.set_name("Predicate Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = must_epoch_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(MUST_EPOCH_OP_KIND)
-        # Don't add it to the context for now
-        return True
-    m = dep_partition_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(DEP_PART_OP_KIND)
-        op.set_name("Dependent Partition Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = pending_partition_op_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_op_kind(PENDING_PART_OP_KIND)
-        op.set_name("Pending Partition Op "+m.group('uid'))
-        context = state.get_task(int(m.group('ctx')))
-        op.set_context(context)
-        return True
-    m = target_partition_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid'))) 
-        index_partition = state.get_index_partition(int(m.group('pid'),16))
-        op.set_pending_partition_info(index_partition, int(m.group('kind')))
-        return True
-    m = index_slice_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('index')))
-        state.slice_index[int(m.group('slice'))] = op
-        return True
-    m = slice_slice_pat.match(line)
-    if m is not None:
-        state.slice_slice[int(m.group('slice2'))] = int(m.group('slice1'))
-        return True
-    m = slice_point_pat.match(line)
-    if m is not None:
-        point = state.get_task(int(m.group('point')))
-        dim = int(m.group('dim'))
-        index_point = Point(dim)
-        index_point.vals[0] = int(m.group('val1'))
-        if dim > 1:
-            index_point.vals[1] = int(m.group('val2'))
-            if dim > 2:
-                index_point.vals[2] = int(m.group('val3'))
-        point.set_point(index_point)
-        state.point_slice[point] = int(m.group('slice'))
-        return True
-    m = point_point_pat.match(line)
-    if m is not None:
-        p1 = state.get_task(int(m.group('point1')))
-        p2 = state.get_task(int(m.group('point2')))
-        assert p1 not in state.point_point
-        assert p2 not in state.point_point
-        # Holdoff on doing the merge until after parsing
-        state.point_point[p1] = p2
-        return True
-    m = index_point_pat.match(line)
-    if m is not None:
-        point = state.get_operation(int(m.group('point')))
-        dim = int(m.group('dim'))
-        index_point = Point(dim)
-        index_point.vals[0] = int(m.group('val1'))
-        if dim > 1:
-            index_point.vals[1] = int(m.group('val2'))
-            if dim > 2:
-                index_point.vals[2] = int(m.group('val3'))
-        index = state.get_operation(int(m.group('index')))
-        index.add_point_op(point, index_point) 
-        return True
-    m = op_index_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('parent')))
-        task.add_operation_index(int(m.group('index')),
-                                 int(m.group('child')))
-        return True
-    m = close_index_pat.match(line)
-    if m is not None:
-        task = state.get_task(int(m.group('parent')))
-        task.add_close_index(int(m.group('index')),
-                             int(m.group('child')))
-        return True
-    m = disjoint_close_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.add_disjoint_close_field(int(m.group('fid')))     
-        return True
-    m = predicate_false_pat.match(line)
-    if m is not None:
-        op = state.get_operation(int(m.group('uid')))
-        op.set_predicate_result(False)
-        return True
+    (task_name_pat, parse_task_name),
+    (task_variant_pat, parse_task_variant),
+    (top_task_pat, parse_top_task),
+    (single_task_pat, parse_single_task),
+    (index_task_pat, parse_index_task),
+    (mapping_pat, parse_mapping),
+    (close_pat, parse_close),
+    (internal_creator_pat, parse_internal_creator),
+    (open_pat, parse_open),
+    (advance_pat, parse_advance),
+    (fence_pat, parse_fence),
+    (trace_pat, parse_trace),
+    (copy_op_pat, parse_copy_op),
+    (fill_op_pat, parse_fill_op),
+    (acquire_op_pat, parse_acquire_op),
+    (release_op_pat, parse_release_op),
+    (deletion_pat, parse_deletion),
+    (attach_pat, parse_attach),
+    (detach_pat, parse_detach),
+    (dynamic_collective_pat, parse_dynamic_collective),
+    (timing_op_pat, parse_timing_op),
+    (predicate_op_pat, parse_predicate_op),
+    (must_epoch_op_pat, parse_must_epoch_op),
+    (dep_partition_op_pat, parse_dep_partition_op),
+    (pending_partition_op_pat, parse_pending_partition_op),
+    (target_partition_pat, parse_target_partition),
+    (index_slice_pat, parse_index_slice),
+    (slice_slice_pat, parse_slice_slice),
+    (slice_point_pat, parse_slice_point),
+    (point_point_pat, parse_point_point),
+    (index_point_pat, parse_index_point),
+    (op_index_pat, parse_op_index),
+    (close_index_pat, parse_close_index),
+    (disjoint_close_pat, parse_disjoint_close),
+    (predicate_false_pat, parse_predicate_false),
     # Region tree shape patterns (near the bottom since they are infrequent)
-    m = top_index_pat.match(line)
-    if m is not None:
-        state.get_index_space(int(m.group('uid'),16)) 
-        return True
-    m = index_name_pat.match(line)
-    if m is not None:
-        ispace = state.get_index_space(int(m.group('uid'),16))
-        ispace.set_name(m.group('name'))
-        return True
-    m = index_part_pat.match(line)
-    if m is not None:
-        parent = state.get_index_space(int(m.group('pid'),16))
-        part = state.get_index_partition(int(m.group('uid'),16))
-        color= Point(1)
-        color.vals[0] = int(m.group('color'))
-        part.set_parent(parent, color)
-        part.set_disjoint(True if int(m.group('disjoint')) == 1 else False)
-        return True
-    m = index_part_name_pat.match(line)
-    if m is not None:
-        part = state.get_index_partition(int(m.group('uid'),16))
-        part.set_name(m.group('name'))
-        return True
-    m = index_subspace_pat.match(line)
-    if m is not None:
-        ispace = state.get_index_space(int(m.group('uid'),16))
-        parent = state.get_index_partition(int(m.group('pid'),16))
-        dim = int(m.group('dim'))
-        color= Point(dim)
-        color.vals[0] = int(m.group('val1'))
-        if dim > 1:
-            color.vals[1] = int(m.group('val2'))
-            if dim > 2:
-                color.vals[2] = int(m.group('val3'))
-        ispace.set_parent(parent, color)
-        return True
-    m = field_space_pat.match(line)
-    if m is not None:
-        state.get_field_space(int(m.group('uid')))
-        return True
-    m = field_space_name_pat.match(line)
-    if m is not None:
-        space = state.get_field_space(int(m.group('uid')))
-        space.set_name(m.group('name'))
-        return True
-    m = field_create_pat.match(line)
-    if m is not None:
-        space = state.get_field_space(int(m.group('uid')))
-        field = space.get_field(int(m.group('fid')))
-        field.size = int(m.group('size'))
-        return True
-    m = field_name_pat.match(line)
-    if m is not None:
-        space = state.get_field_space(int(m.group('uid')))
-        field = space.get_field(int(m.group('fid')))
-        field.set_name(m.group('name'))
-        return True
-    m = region_pat.match(line)
-    if m is not None:
-        state.get_region(int(m.group('iid'),16),
-            int(m.group('fid')),int(m.group('tid')))
-        return True
-    m = region_name_pat.match(line)
-    if m is not None:
-        region = state.get_region(int(m.group('iid'),16),
-            int(m.group('fid')),int(m.group('tid')))
-        region.set_name(m.group('name'))
-        return True
-    m = partition_name_pat.match(line)
-    if m is not None:
-        partition = state.get_partition(int(m.group('iid'),16),
-            int(m.group('fid')),int(m.group('tid')))
-        partition.set_name(m.group('name'))
-        return True
-    m = index_space_point_pat.match(line)
-    if m is not None:
-        index_space = state.get_index_space(int(m.group('uid'),16)) 
-        dim = int(m.group('dim'))
-        point = Point(dim)
-        point.vals[0] = int(m.group('p1'))
-        if dim >= 2:
-            point.vals[1] = int(m.group('p2'))
-            if dim >= 3:
-                point.vals[2] = int(m.group('p3'))
-        index_space.add_point(point)
-        return True
-    m = index_space_rect_pat.match(line)
-    if m is not None:
-        index_space = state.get_index_space(int(m.group('uid'),16))
-        dim = int(m.group('dim'))
-        lo = Point(dim)
-        hi = Point(dim)
-        lo.vals[0] = int(m.group('lo1'))
-        hi.vals[0] = int(m.group('hi1'))
-        if dim >= 2:
-            lo.vals[1] = int(m.group('lo2'))
-            hi.vals[1] = int(m.group('hi2'))
-            if dim >= 3:
-                lo.vals[2] = int(m.group('lo3'))
-                hi.vals[2] = int(m.group('hi3'))
-        index_space.add_rect(Rect(lo, hi))
-        return True
-    m = empty_index_space_pat.match(line)
-    if m is not None:
-        index_space = state.get_index_space(int(m.group('uid'),16))
-        index_space.set_empty()
-        return True
+    (top_index_pat, parse_top_index),
+    (index_name_pat, parse_index_name),
+    (index_part_pat, parse_index_part),
+    (index_part_name_pat, parse_index_part_name),
+    (index_subspace_pat, parse_index_subspace),
+    (field_space_pat, parse_field_space),
+    (field_space_name_pat, parse_field_space_name),
+    (field_create_pat, parse_field_create),
+    (field_name_pat, parse_field_name),
+    (region_pat, parse_region),
+    (region_name_pat, parse_region_name),
+    (partition_name_pat, parse_partition_name),
+    (index_space_point_pat, parse_index_space_point),
+    (index_space_rect_pat, parse_index_space_rect),
+    (empty_index_space_pat, parse_empty_index_space),
     # Machine kinds (at the bottom cause they are least likely)
-    m = proc_kind_pat.match(line)
-    if m is not None:
-        state.record_processor_kind(int(m.group('kind')), m.group('name'))
-        return True
-    m = mem_kind_pat.match(line)
-    if m is not None:
-        state.record_memory_kind(int(m.group('kind')), m.group('name'))
-        return True
-    m = processor_pat.match(line)
-    if m is not None:
-        proc = state.get_processor(int(m.group('pid'),16))
-        kind_num = int(m.group('kind'))
-        proc.set_kind(kind_num, state.get_processor_kind(kind_num))
-        return True
-    m = memory_pat.match(line)
-    if m is not None:
-        mem = state.get_memory(int(m.group('mid'),16))
-        kind_num = int(m.group('kind'))
-        mem.set_kind(kind_num, state.get_memory_kind(kind_num))
-        mem.set_capacity(int(m.group('capacity')))
-        return True
-    m = proc_mem_pat.match(line)
-    if m is not None:
-        proc = state.get_processor(int(m.group('pid'),16))
-        mem = state.get_memory(int(m.group('mid'),16))
-        bandwidth = int(m.group('band'))
-        latency = int(m.group('lat'))
-        proc.add_memory(mem, bandwidth, latency)
-        mem.add_processor(proc, bandwidth, latency)
-        return True
-    m = mem_mem_pat.match(line)
-    if m is not None:
-        mem1 = state.get_memory(int(m.group('mone'),16))
-        mem2 = state.get_memory(int(m.group('mtwo'),16))
-        bandwidth = int(m.group('band'))
-        latency = int(m.group('lat'))
-        mem1.add_memory(mem2, bandwidth, latency)
-        mem2.add_memory(mem1, bandwidth, latency)
-        return True
-    m = config_pat.match(line)
-    if m is not None:
-        state.set_config(False)
-        return True
-    m = detailed_config_pat.match(line)
-    if m is not None:
-        state.set_config(True)
-        return True
+    (proc_kind_pat, parse_proc_kind),
+    (mem_kind_pat, parse_mem_kind),
+    (processor_pat, parse_processor),
+    (memory_pat, parse_memory),
+    (proc_mem_pat, parse_proc_mem),
+    (mem_mem_pat, parse_mem_mem),
+    (config_pat, parse_config),
+    (detailed_config_pat, parse_detailed_config),
+]
+
+def parse_legion_spy_line(line, state):
+    # Quick test to see if the line is even worth considering
+    m = prefix_pat.match(line)
+    if m is None:
+        return False
+    for pat,parser in legion_spy_parsers:
+        m = pat.match(line)
+        if m is not None:
+            return parser(m, state)
     return False
 
 class State(object):
@@ -9735,6 +9863,8 @@ class State(object):
         return result
 
     def parse_log_file(self, file_name):
+        if LegionSpyBinaryDecoder.is_binary_log(file_name):
+            return self.parse_binary_log_file(file_name)
         print('Reading log file %s...' % file_name)
         try:
             log = open(file_name, 'r')
@@ -9764,6 +9894,39 @@ class State(object):
             print('WARNING: Skipped %d lines when reading %s' % (skipped,file_name))
         return matches
 
+    def parse_binary_log_file(self, file_name):
+        print('Reading binary log file %s...' % file_name)
+        decoder = LegionSpyBinaryDecoder(file_name)
+        # Every record with the same format goes to the same parser
+        # so only the first one has to search for it
+        format_parsers = dict()
+        matches = 0
+        skipped = 0
+        for format_id,line in decoder.records():
+            if format_id in format_parsers:
+                parser = format_parsers[format_id]
+            else:
+                parser = None
+                for pat,pat_parser in legion_spy_parsers:
+                    if pat.match(line) is not None:
+                        parser = (pat,pat_parser)
+                        break
+                format_parsers[format_id] = parser
+            if parser is not None:
+                m = parser[0].match(line)
+                if m is not None and parser[1](m, self):
+                    matches += 1
+                    continue
+            skipped += 1
+            print('Skipping line: ' + line.strip())
+        if matches == 0:
+            print('WARNING: file %s contained no valid records!' % file_name)
+        if self.verbose:
+            print('Matched %d records in %s' % (matches,file_name))
+        if skipped > 0:
+            print('WARNING: Skipped %d records when reading %s' % (skipped,file_name))
+        return matches
+
     def post_parse(self, simplify_graphs, need_physical):
         for space in self.index_spaces.itervalues():
             if space.parent is None:
@@ -10210,14 +10373,18 @@ class State(object):
             replay_file.write(struct.pack('Q',self.top_level_uid))
             # Write out the tasks first 
             replay_file.write(struct.pack('I',len(single_tasks)+total_index))
+            task_index = list()
             for op in single_tasks:
-                op.task.pack_task_replay_info(replay_file, op.uid)
+                task_index.append(
+                    op.task.pack_task_replay_info(replay_file, op.uid))
             actual_index_tasks = 0
             for task in index_tasks:
                 for point in task.points.itervalues():
-                    point.pack_task_replay_info(replay_file, task.uid)
+                    task_index.append(
+                        point.pack_task_replay_info(replay_file, task.uid))
                     actual_index_tasks += 1
             assert actual_index_tasks == total_index
+            tasks_end = replay_file.tell()
             # Write out the inlines
             replay_file.write(struct.pack('I',len(inlines)))
             for op in inlines:
@@ -10234,6 +10401,15 @@ class State(object):
             replay_file.write(struct.pack('I',len(releases)))
             for op in releases:
                 op.pack_release_replay_info(replay_file)
+            # Write out the task index sorted by unique ID and point so the
+            # replay mapper can memory map it and load tasks lazily
+            index_offset = replay_file.tell()
+            task_index.sort()
+            for (uid, dim, vals), offset in task_index:
+                replay_file.write(struct.pack('QiiqqqQ', uid, dim, 0,
+                                              vals[0], vals[1], vals[2], offset))
+            replay_file.write(struct.pack('QQQII', index_offset, len(task_index),
+                tasks_end, REPLAY_INDEX_MAGIC, REPLAY_INDEX_VERSION))
 
     def print_instance_descriptions(self):
         for inst in self.instances.itervalues():
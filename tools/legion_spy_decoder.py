@@ -0,0 +1,183 @@
+#!/usr/bin/env python
+
+# Copyright 2017 Stanford University, NVIDIA Corporation
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+###
+### Decodes binary Legion Spy logs (written with -lg:spy_logfile) back
+### into the text records that legion_spy.py parses
+###
+
+from __future__ import print_function
+import argparse
+import gzip
+import re
+import struct
+import sys
+
+# XXX: Make sure these are consistent with legion_spy.cc!
+SPY_BINARY_MAGIC = b'LGSPYBIN'
+SPY_BINARY_VERSION = 1
+SPY_HEADER = struct.Struct('<II')
+SPY_RECORD_ID = struct.Struct('<H')
+
+# Conversions in the C format strings: flags, width, precision,
+# length modifier and conversion
+conversion_pat = re.compile(
+    r'%(?P<flags>[-+ #0]*)(?P<width>\*|[0-9]*)(?P<precision>\.(?:\*|[0-9]*))?'
+    r'(?P<length>hh|h|ll|l|z|j|t|L)?(?P<conv>[diuxXocpfFeEgGaAs%])')
+
+def to_str(value):
+    if isinstance(value, str):
+        return value
+    return value.decode('utf-8', 'replace')
+
+class SpyFormat(object):
+    __slots__ = ['format_id', 'text', 'fields', 'reads']
+    def __init__(self, format_id, text):
+        self.format_id = format_id
+        self.text = ''
+        # Struct codes of each argument in the order they were logged
+        self.fields = []
+        pos = 0
+        for m in conversion_pat.finditer(text):
+            self.text += text[pos:m.start()].replace('%', '%%')
+            pos = m.end()
+            conv = m.group('conv')
+            if conv == '%':
+                self.text += '%%'
+                continue
+            width = m.group('width')
+            precision = m.group('precision') or ''
+            if width == '*':
+                self.fields.append('i')
+            if precision == '.*':
+                self.fields.append('i')
+            length = m.group('length')
+            wide = length in ('l', 'll', 'z', 'j', 't')
+            if conv in 'di':
+                self.fields.append('q' if wide else 'i')
+            elif conv in 'uxXo':
+                self.fields.append('Q' if wide else 'I')
+                if conv == 'u':
+                    conv = 'd'
+            elif conv == 'c':
+                self.fields.append('i')
+            elif conv == 'p':
+                self.fields.append('Q')
+                self.text += '0x'
+                conv = 'x'
+            elif conv in 'fFeEgGaA':
+                self.fields.append('d')
+                if conv in 'aA':
+                    conv = 'g'
+            else:
+                assert conv == 's'
+                self.fields.append('s')
+            self.text += '%' + m.group('flags') + width + precision + conv
+        self.text += text[pos:].replace('%', '%%')
+        # Group runs of fixed size fields so each run is one unpack
+        self.reads = []
+        run = ''
+        for field in self.fields:
+            if field == 's':
+                if run:
+                    self.reads.append(struct.Struct('<' + run))
+                    run = ''
+                self.reads.append(None)
+            else:
+                run += field
+        if run:
+            self.reads.append(struct.Struct('<' + run))
+
+    def decode(self, data, pos):
+        values = []
+        for read in self.reads:
+            if read is None:
+                end = data.index(b'\0', pos)
+                values.append(to_str(data[pos:end]))
+                pos = end + 1
+            else:
+                values.extend(read.unpack_from(data, pos))
+                pos += read.size
+        return self.text % tuple(values), pos
+
+class LegionSpyBinaryDecoder(object):
+    def __init__(self, file_name):
+        self.file_name = file_name
+        with open(file_name, 'rb') as log:
+            compressed = log.read(2) == b'\x1f\x8b'
+        with (gzip.open(file_name, 'rb') if compressed else
+              open(file_name, 'rb')) as log:
+            self.data = log.read()
+        if self.data[0:len(SPY_BINARY_MAGIC)] != SPY_BINARY_MAGIC:
+            raise ValueError('%s is not a binary Legion Spy log' % file_name)
+        version, self.node = SPY_HEADER.unpack_from(self.data,
+                                                    len(SPY_BINARY_MAGIC))
+        if version != SPY_BINARY_VERSION:
+            raise ValueError('%s has binary Legion Spy log version %d '
+                             'but this decoder only reads version %d' %
+                             (file_name, version, SPY_BINARY_VERSION))
+        self.formats = dict()
+        # Records are decoded back into lines with the usual logger prefix
+        self.prefix = '[%d - 0] {2}{legion_spy}: ' % self.node
+
+    @staticmethod
+    def is_binary_log(file_name):
+        try:
+            with open(file_name, 'rb') as log:
+                header = log.read(len(SPY_BINARY_MAGIC))
+                if header[0:2] == b'\x1f\x8b':
+                    with gzip.open(file_name, 'rb') as zlog:
+                        header = zlog.read(len(SPY_BINARY_MAGIC))
+        except IOError:
+            return False
+        return header == SPY_BINARY_MAGIC
+
+    def records(self):
+        # Yields the format of each record along with its decoded line
+        data = self.data
+        pos = len(SPY_BINARY_MAGIC) + SPY_HEADER.size
+        while pos + SPY_RECORD_ID.size <= len(data):
+            (format_id,) = SPY_RECORD_ID.unpack_from(data, pos)
+            pos += SPY_RECORD_ID.size
+            if format_id == 0:
+                # A new format string
+                (format_id,) = SPY_RECORD_ID.unpack_from(data, pos)
+                pos += SPY_RECORD_ID.size
+                end = data.index(b'\0', pos)
+                self.formats[format_id] = SpyFormat(format_id,
+                                                    to_str(data[pos:end]))
+                pos = end + 1
+                continue
+            line, pos = self.formats[format_id].decode(data, pos)
+            yield format_id, self.prefix + line
+        if pos != len(data):
+            print('WARNING: truncated record at the end of %s' % self.file_name)
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Decode a binary Legion Spy log into text')
+    parser.add_argument('infile', help='binary log (e.g. spy_0.log)')
+    parser.add_argument('outfile', nargs='?',
+                        help='name of output file (default is stdout)')
+    args = parser.parse_args()
+
+    decoder = LegionSpyBinaryDecoder(args.infile)
+    out = open(args.outfile, 'w') if args.outfile else sys.stdout
+    for format_id, line in decoder.records():
+        out.write(line + '\n')
+
+if __name__ == '__main__':
+    main()
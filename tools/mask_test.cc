@@ -1227,6 +1227,35 @@ void test_operation_128(const int num_iterations)
 #endif
 }
 
+#ifdef __AVX512F__
+// AVX-512 masks need MAX to be a multiple of 512
+template<int MAX, int SCALE, OpKind OP, bool VALID = ((MAX % 512) == 0)>
+struct AVX512Operation {
+  static void test(const int num_iterations) { }
+};
+
+template<int MAX, int SCALE, OpKind OP>
+struct AVX512Operation<MAX,SCALE,OP,true> {
+  static void test(const int num_iterations)
+  {
+    test_mask_operation<MAX,SCALE,OP,AVX512BitMask<MAX> >(num_iterations, "AVX512BitMask");
+    test_mask_operation<MAX,SCALE,OP,AVX512TLBitMask<MAX> >(num_iterations, "AVX512TLBitMask");
+    test_mask_operation<MAX,SCALE,OP,
+      CompoundBitMask<AVX512BitMask<MAX>,MAX,2> >(
+          num_iterations, "CompoundBitMask<AVX512BitMask<2> >");
+    test_mask_operation<MAX,SCALE,OP,
+      CompoundBitMask<AVX512BitMask<MAX>,MAX,4> >(
+          num_iterations, "CompoundBitMask<AVX512BitMask<4> >");
+    test_mask_operation<MAX,SCALE,OP,
+      CompoundBitMask<AVX512TLBitMask<MAX>,MAX,2> >(
+          num_iterations, "CompoundBitMask<AVX512TLBitMask<2> >");
+    test_mask_operation<MAX,SCALE,OP,
+      CompoundBitMask<AVX512TLBitMask<MAX>,MAX,4> >(
+          num_iterations, "CompoundBitMask<AVX512TLBitMask<4> >");
+  }
+};
+#endif
+
 template<int MAX, int SCALE, OpKind OP>
 void test_operation(const int num_iterations)
 {
@@ -1323,6 +1352,9 @@ void test_operation(const int num_iterations)
     CompoundBitMask<AVXTLBitMask<MAX>,MAX,8> >(
         num_iterations, "CompoundBitMask<AVXTLBitMask<8> >");
 #endif
+#ifdef __AVX512F__
+  AVX512Operation<MAX,SCALE,OP>::test(num_iterations);
+#endif
 }
 
 template<int SCALE>
@@ -1462,6 +1494,20 @@ int main(int argc, const char **argv)
   test_mask<AVXTLBitMask<2048> >(num_iterations,"AVXTLBitMask<2048>");
 #endif
 
+#ifdef __AVX512F__
+  printf("\nAVX512BitMask Tests\n");
+  test_mask<AVX512BitMask<512> >(num_iterations,"AVX512BitMask<512>");
+  test_mask<AVX512BitMask<1024> >(num_iterations,"AVX512BitMask<1024>");
+  test_mask<AVX512BitMask<1536> >(num_iterations,"AVX512BitMask<1536>");
+  test_mask<AVX512BitMask<2048> >(num_iterations,"AVX512BitMask<2048>");
+
+  printf("\nAVX512TLBitMask Tests\n");
+  test_mask<AVX512TLBitMask<512> >(num_iterations,"AVX512TLBitMask<512>");
+  test_mask<AVX512TLBitMask<1024> >(num_iterations,"AVX512TLBitMask<1024>");
+  test_mask<AVX512TLBitMask<1536> >(num_iterations,"AVX512TLBitMask<1536>");
+  test_mask<AVX512TLBitMask<2048> >(num_iterations,"AVX512TLBitMask<2048>");
+#endif
+
   printf("\nCompoundBitMask Tests\n");
   test_mask<CompoundBitMask<BitMask<uint64_t,64,6,0x3F>,64,2> >(
                               num_iterations,"CompoundBitMask<64,2>");
@@ -0,0 +1,61 @@
+#!/usr/bin/env python
+
+# decodes binary Realm log files (written for categories selected with
+#  -logbinary) back into the usual text format
+
+import sys
+import argparse
+import struct
+
+MAGIC = b'RLMLOG01'
+HEADER = struct.Struct('=BBHIQQ')
+RECORD_CATEGORY = 0
+RECORD_MESSAGE = 1
+
+parser = argparse.ArgumentParser()
+parser.add_argument('-t', '--timestamps', action='store_true',
+                    help='prefix each message with its timestamp (in ns)')
+parser.add_argument('-c', '--category', action='append',
+                    help='only print messages from the given categories')
+parser.add_argument('infile', help='name of input file (e.g. binlog_0.dat)')
+parser.add_argument('outfile', nargs='?',
+                    help='name of output file (default is stdout)')
+args = parser.parse_args()
+
+with open(args.infile, 'rb') as f:
+    data = f.read()
+
+if data[0:len(MAGIC)] != MAGIC:
+    print('{}: not a Realm binary log file'.format(args.infile))
+    sys.exit(1)
+(node,) = struct.unpack_from('=i', data, len(MAGIC))
+pos = len(MAGIC) + 4
+
+# category records can be interleaved with messages from other threads, so
+#  read everything before printing
+categories = {}
+messages = []
+while pos + HEADER.size <= len(data):
+    (rtype, level, cat, length, timestamp, thread) = HEADER.unpack_from(data, pos)
+    pos += HEADER.size
+    payload = data[pos:pos + length].decode('utf-8', 'replace')
+    pos += length
+    if rtype == RECORD_CATEGORY:
+        categories[cat] = payload
+    elif rtype == RECORD_MESSAGE:
+        messages.append((timestamp, thread, level, cat, payload))
+    else:
+        print('{}: unknown record type {} at offset {}'.format(args.infile, rtype, pos))
+        sys.exit(1)
+
+if pos != len(data):
+    sys.stderr.write('{}: truncated record at end of file\n'.format(args.infile))
+
+out = open(args.outfile, 'w') if args.outfile else sys.stdout
+for (timestamp, thread, level, cat, payload) in messages:
+    name = categories.get(cat, str(cat))
+    if args.category and name not in args.category:
+        continue
+    prefix = '{} '.format(timestamp) if args.timestamps else ''
+    out.write('{}[{} - {:x}] {{{}}}{{{}}}: {}\n'.format(prefix, node, thread,
+                                                   level, name, payload))
@@ -0,0 +1,312 @@
+/* Copyright 2017 Stanford University, NVIDIA Corporation
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks SweepRectangleSet against a brute-force point set and compares
+// it with RectangleSet on the ghost-region shapes that partitions produce
+
+#include <cstdio>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "legion/rectangle_set.h"
+
+#ifdef __MACH__
+#include <mach/clock.h>
+#include <mach/mach.h>
+#else
+#include <time.h>
+#endif
+
+using namespace Legion::Internal;
+
+typedef long long coord_t;
+
+inline unsigned long long current_time_in_nanoseconds(void)
+{
+#ifdef __MACH__
+  mach_timespec_t ts;
+  clock_serv_t cclock;
+  host_get_clock_service(mach_host_self(), CALENDAR_CLOCK, &cclock);
+  clock_get_time(cclock, &ts);
+  mach_port_deallocate(mach_task_self(), cclock);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+  long long t = (1000000000LL * ts.tv_sec) + ts.tv_nsec;
+  return t;
+}
+
+// Random rectangles on a small grid checked against a bitmap of points
+void test_correctness(const int num_iterations)
+{
+  const int GRID = 24;
+  int failures = 0;
+  for (int iter = 0; iter < num_iterations; iter++)
+  {
+    bool lhs_points[GRID][GRID], rhs_points[GRID][GRID];
+    memset(lhs_points, 0, sizeof(lhs_points));
+    memset(rhs_points, 0, sizeof(rhs_points));
+    SweepRectangleSet<coord_t,2,true> lhs, rhs;
+    const int num_rects = 1 + (lrand48() % 8);
+    for (int r = 0; r < (2*num_rects); r++)
+    {
+      coord_t lo[2], hi[2];
+      for (int d = 0; d < 2; d++)
+      {
+        lo[d] = lrand48() % GRID;
+        hi[d] = lo[d] + (lrand48() % (GRID - lo[d]));
+      }
+      bool (*points)[GRID] = (r < num_rects) ? lhs_points : rhs_points;
+      for (coord_t x = lo[0]; x <= hi[0]; x++)
+        for (coord_t y = lo[1]; y <= hi[1]; y++)
+          points[x][y] = true;
+      if (r < num_rects)
+        lhs.add_rectangle(lo, hi);
+      else
+        rhs.add_rectangle(lo, hi);
+    }
+    SweepRectangleSet<coord_t,2,true> results[3];
+    SweepRectangleSet<coord_t,2,true>::compute_union(lhs, rhs, results[0]);
+    SweepRectangleSet<coord_t,2,true>::compute_intersection(lhs, rhs,
+                                                            results[1]);
+    SweepRectangleSet<coord_t,2,true>::compute_difference(lhs, rhs,
+                                                          results[2]);
+    for (int op = 0; op < 3; op++)
+    {
+      bool points[GRID][GRID];
+      memset(points, 0, sizeof(points));
+      int overlaps = 0;
+      for (unsigned idx = 0; idx < results[op].size(); idx++)
+      {
+        coord_t lo[2], hi[2];
+        results[op].get_rectangle(idx, lo, hi);
+        for (coord_t x = lo[0]; x <= hi[0]; x++)
+          for (coord_t y = lo[1]; y <= hi[1]; y++)
+          {
+            if (points[x][y])
+              overlaps++;
+            points[x][y] = true;
+          }
+      }
+      bool match = (overlaps == 0);
+      for (int x = 0; x < GRID; x++)
+        for (int y = 0; y < GRID; y++)
+        {
+          bool expected;
+          if (op == 0)
+            expected = lhs_points[x][y] || rhs_points[x][y];
+          else if (op == 1)
+            expected = lhs_points[x][y] && rhs_points[x][y];
+          else
+            expected = lhs_points[x][y] && !rhs_points[x][y];
+          if (points[x][y] != expected)
+            match = false;
+          if (results[op].covers(x, y, x, y) != expected)
+            match = false;
+        }
+      if (!match)
+        failures++;
+    }
+    // Canonical form means the same points give the same boxes
+    SweepRectangleSet<coord_t,2,true> rebuilt;
+    for (int x = 0; x < GRID; x++)
+      for (int y = 0; y < GRID; y++)
+        if (lhs_points[x][y] || rhs_points[x][y])
+          rebuilt.add_rectangle(x, y, x, y);
+    if (!(rebuilt == results[0]))
+      failures++;
+  }
+  printf("Correctness: %d failures in %d iterations\n",
+          failures, num_iterations);
+  assert(failures == 0);
+}
+
+// The ghost region of a tile in a 2-D block decomposition is the halo
+// around it, built from the strips owned by each of its neighbors
+void test_ghost_2d(const int num_iterations, const int num_tiles,
+                   const coord_t tile_size, const coord_t halo)
+{
+  const coord_t extent = num_tiles * tile_size;
+  unsigned long long old_time = 0, sweep_time = 0;
+  int old_covered = 0, sweep_covered = 0;
+  for (int iter = 0; iter < num_iterations; iter++)
+  {
+    const coord_t tx = (lrand48() % num_tiles) * tile_size;
+    const coord_t ty = (lrand48() % num_tiles) * tile_size;
+    std::vector<coord_t> strips;
+    for (int nx = -1; nx <= 1; nx++)
+      for (int ny = -1; ny <= 1; ny++)
+      {
+        if ((nx == 0) && (ny == 0))
+          continue;
+        coord_t lx = (nx < 0) ? tx - halo : (nx > 0) ? tx + tile_size : tx;
+        coord_t hx = (nx < 0) ? tx - 1 : (nx > 0) ?
+          tx + tile_size + halo - 1 : tx + tile_size - 1;
+        coord_t ly = (ny < 0) ? ty - halo : (ny > 0) ? ty + tile_size : ty;
+        coord_t hy = (ny < 0) ? ty - 1 : (ny > 0) ?
+          ty + tile_size + halo - 1 : ty + tile_size - 1;
+        if ((lx < 0) || (ly < 0) || (hx >= extent) || (hy >= extent))
+          continue;
+        strips.push_back(lx); strips.push_back(ly);
+        strips.push_back(hx); strips.push_back(hy);
+      }
+    const coord_t bx = (tx > 0) ? tx - halo : tx;
+    const coord_t by = (ty > 0) ? ty - halo : ty;
+    const coord_t ex = ((tx + tile_size) < extent) ?
+      tx + tile_size + halo - 1 : tx + tile_size - 1;
+    const coord_t ey = ((ty + tile_size) < extent) ?
+      ty + tile_size + halo - 1 : ty + tile_size - 1;
+    {
+      unsigned long long start = current_time_in_nanoseconds();
+      RectangleSet<coord_t,true> set;
+      set.add_rectangle(tx, ty, tx + tile_size - 1, ty + tile_size - 1);
+      for (unsigned idx = 0; idx < strips.size(); idx += 4)
+        set.add_rectangle(strips[idx], strips[idx+1],
+                          strips[idx+2], strips[idx+3]);
+      if (set.covers(bx, by, ex, ey))
+        old_covered++;
+      old_time += (current_time_in_nanoseconds() - start);
+    }
+    {
+      unsigned long long start = current_time_in_nanoseconds();
+      SweepRectangleSet<coord_t,2,true> set;
+      set.add_rectangle(tx, ty, tx + tile_size - 1, ty + tile_size - 1);
+      for (unsigned idx = 0; idx < strips.size(); idx += 4)
+        set.add_rectangle(strips[idx], strips[idx+1],
+                          strips[idx+2], strips[idx+3]);
+      if (set.covers(bx, by, ex, ey))
+        sweep_covered++;
+      sweep_time += (current_time_in_nanoseconds() - start);
+    }
+  }
+  // Every halo is covered by the tile and its neighbors' strips
+  printf("2-D ghost (%d tiles of %lld, halo %lld): RectangleSet %.3f us "
+         "(%d/%d covered), SweepRectangleSet %.3f us (%d/%d covered)\n",
+         num_tiles, tile_size, halo,
+         old_time / (1e3 * num_iterations), old_covered, num_iterations,
+         sweep_time / (1e3 * num_iterations), sweep_covered, num_iterations);
+  assert(sweep_covered == num_iterations);
+}
+
+// Union of all the tiles in a 2-D block decomposition, as when testing
+// that the subregions of a partition cover their parent
+void test_complete_2d(const int num_iterations, const int num_tiles,
+                      const coord_t tile_size)
+{
+  const coord_t extent = num_tiles * tile_size;
+  unsigned long long old_time = 0, sweep_time = 0;
+  for (int iter = 0; iter < num_iterations; iter++)
+  {
+    {
+      unsigned long long start = current_time_in_nanoseconds();
+      RectangleSet<coord_t,true> set;
+      for (int i = 0; i < num_tiles; i++)
+        for (int j = 0; j < num_tiles; j++)
+          set.add_rectangle(i * tile_size, j * tile_size,
+                            (i+1) * tile_size - 1, (j+1) * tile_size - 1);
+      bool complete = set.covers(0, 0, extent - 1, extent - 1);
+      assert(complete);
+      old_time += (current_time_in_nanoseconds() - start);
+    }
+    {
+      unsigned long long start = current_time_in_nanoseconds();
+      SweepRectangleSet<coord_t,2,true> set;
+      for (int i = 0; i < num_tiles; i++)
+        for (int j = 0; j < num_tiles; j++)
+          set.add_rectangle(i * tile_size, j * tile_size,
+                            (i+1) * tile_size - 1, (j+1) * tile_size - 1);
+      bool complete = set.covers(0, 0, extent - 1, extent - 1);
+      assert(complete);
+      assert(set.size() == 1);
+      sweep_time += (current_time_in_nanoseconds() - start);
+    }
+  }
+  printf("2-D complete (%dx%d tiles): RectangleSet %.3f us, "
+         "SweepRectangleSet %.3f us\n", num_tiles, num_tiles,
+         old_time / (1e3 * num_iterations),
+         sweep_time / (1e3 * num_iterations));
+}
+
+// 3-D ghost regions are the halo of a cube minus the cube itself
+// (RectangleSet only handles two dimensions so there is no comparison)
+void test_ghost_3d(const int num_iterations, const coord_t tile_size,
+                   const coord_t halo)
+{
+  unsigned long long sweep_time = 0;
+  for (int iter = 0; iter < num_iterations; iter++)
+  {
+    unsigned long long start = current_time_in_nanoseconds();
+    const coord_t tile_lo[3] = { halo, halo, halo };
+    const coord_t tile_hi[3] = { halo + tile_size - 1, halo + tile_size - 1,
+                                 halo + tile_size - 1 };
+    const coord_t halo_lo[3] = { 0, 0, 0 };
+    const coord_t halo_hi[3] = { 2*halo + tile_size - 1,
+                                 2*halo + tile_size - 1,
+                                 2*halo + tile_size - 1 };
+    SweepRectangleSet<coord_t,3,true> tile, ghost;
+    tile.add_rectangle(tile_lo, tile_hi);
+    ghost.add_rectangle(halo_lo, halo_hi);
+    ghost.subtract(tile);
+    // Rebuilding it from the tile faces has to give the same set
+    SweepRectangleSet<coord_t,3,true> faces;
+    for (int d = 0; d < 3; d++)
+    {
+      coord_t lo[3], hi[3];
+      for (int k = 0; k < 3; k++)
+      {
+        lo[k] = (k < d) ? halo : 0;
+        hi[k] = (k < d) ? halo + tile_size - 1 : 2*halo + tile_size - 1;
+      }
+      hi[d] = halo - 1;
+      faces.add_rectangle(lo, hi);
+      lo[d] = halo + tile_size;
+      hi[d] = 2*halo + tile_size - 1;
+      faces.add_rectangle(lo, hi);
+    }
+    bool same = (faces == ghost);
+    assert(same);
+    bool covered = ghost.covers(halo_lo, tile_lo);
+    assert(!covered);
+    sweep_time += (current_time_in_nanoseconds() - start);
+  }
+  printf("3-D ghost (tile %lld, halo %lld): SweepRectangleSet %.3f us\n",
+         tile_size, halo, sweep_time / (1e3 * num_iterations));
+}
+
+int main(int argc, const char **argv)
+{
+  int num_iterations = 256;
+  if (argc > 1)
+    num_iterations = atoi(argv[1]);
+  printf("Iteration Count: %d\n", num_iterations);
+
+  test_correctness(num_iterations);
+
+  test_ghost_2d(num_iterations, 4, 64, 1);
+  test_ghost_2d(num_iterations, 16, 64, 2);
+  test_ghost_2d(num_iterations, 16, 1024, 4);
+
+  test_complete_2d(num_iterations, 2, 64);
+  test_complete_2d(num_iterations, 4, 64);
+  test_complete_2d(num_iterations, 8, 64);
+
+  test_ghost_3d(num_iterations, 32, 1);
+  test_ghost_3d(num_iterations, 128, 4);
+
+  return 0;
+}
+
@@ -77,6 +77,7 @@ callbacks = {
     "SliceOwner": noop,
     "TaskWaitInfo": noop,
     "MetaWaitInfo": noop,
+    "TaskPerfInfo": noop,
     "TaskInfo": log_task_info,
     "MetaInfo": log_meta_info,
     "CopyInfo": noop,
@@ -84,9 +85,12 @@ callbacks = {
     "InstCreateInfo": noop,
     "InstUsageInfo": noop,
     "InstTimelineInfo": noop,
+    "PartitionInfo": noop,
     "MessageInfo": noop,
     "MapperCallInfo": noop,
     "RuntimeCallInfo": noop,
+    "SampleDesc": noop,
+    "AggregateInfo": noop,
     "ProfTaskInfo": noop
 }
 
@@ -103,6 +107,10 @@ def main():
     parser.add_argument("-a", "--ascii", action="store_true",
                         dest="ascii_parser",
                         help="Use ASCII parser.")
+    parser.add_argument("--start", type=float,
+                        help="Only load records after this time (us).")
+    parser.add_argument("--stop", type=float,
+                        help="Only load records before this time (us).")
     parser.add_argument(dest='filenames', nargs='+',
                         help='input Legion Prof log filenames')
 
@@ -111,7 +119,8 @@ def main():
     if args.ascii_parser:
         deserializer = LegionProfASCIIDeserializer(Dummy(), callbacks)
     else:
-        deserializer = LegionProfBinaryDeserializer(None, callbacks)
+        deserializer = LegionProfBinaryDeserializer(None, callbacks,
+                                                    args.start, args.stop)
 
     if args.filenames is None:
         print("You must pass in a logfile!")
@@ -77,6 +77,7 @@ callbacks = {
     "SliceOwner": noop,
     "TaskWaitInfo": noop,
     "MetaWaitInfo": noop,
+    "TaskPerfInfo": noop,
     "TaskInfo": log_task_info,
     "MetaInfo": log_meta_info,
     "CopyInfo": noop,
@@ -84,9 +85,12 @@ callbacks = {
     "InstCreateInfo": noop,
     "InstUsageInfo": noop,
     "InstTimelineInfo": noop,
+    "PartitionInfo": noop,
     "MessageInfo": noop,
     "MapperCallInfo": noop,
     "RuntimeCallInfo": noop,
+    "SampleDesc": noop,
+    "AggregateInfo": noop,
     "ProfTaskInfo": noop
 }
 
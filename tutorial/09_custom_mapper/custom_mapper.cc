@@ -354,6 +354,13 @@ AdversarialMapper::AdversarialMapper(Machine m,
                     it->id, memory_size_in_kb);
             break;
           }
+        // Managed memory shared by the CPUs and GPUs on a single node
+        case Memory::GPU_MANAGED_MEM:
+          {
+            printf("  Managed Memory ID " IDFMT " has %zd KB\n",
+                    it->id, memory_size_in_kb);
+            break;
+          }
         default:
           assert(false);
       }